@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Utility for converting greyscale or color images into the monochrome
+// format that is drawn by Bitmap::drawBitmap(), with dithering.
+//
+// Usage: gendither [-m method] [-t threshold] [-i] name [image]
+//        gendither -p [-m method] [-t threshold] [-i] [image]
+//
+// The image can be in any of the PGM (P2, P5) or PPM (P3, P6) formats.
+// Color pixels are converted to greyscale with the ITU-R BT.601 weights.
+// The method is "threshold", "ordered" (4x4 Bayer matrix), or "floyd"
+// (Floyd-Steinberg error diffusion, the default).  Pixels at or above the
+// threshold brightness, default 128, are lit.  The -i option inverts the
+// image so that dark pixels are lit instead.
+//
+// The output is a C array for Bitmap::drawBitmap().  With -p, the output
+// is a raw PBM image with lit pixels in black instead, which can be piped
+// into genrle to create a run-length encoded bitmap.
+//
+// The arithmetic is the same as the Dither class in the DMD library,
+// so images that are converted on the device come out identical.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_SIZE    255
+
+#define METHOD_THRESHOLD    0
+#define METHOD_ORDERED      1
+#define METHOD_FLOYD        2
+
+static unsigned char grey[MAX_SIZE * MAX_SIZE];
+static unsigned char image[MAX_SIZE * ((MAX_SIZE + 7) / 8)];
+static short errors[MAX_SIZE + 2];
+
+static const unsigned char bayer[16] = {
+     0,  8,  2, 10,
+    12,  4, 14,  6,
+     3, 11,  1,  9,
+    15,  7, 13,  5
+};
+
+static int readNumber(FILE *file)
+{
+    int ch = getc(file);
+    int value = 0;
+    for (;;) {
+        while (ch != EOF && isspace(ch))
+            ch = getc(file);
+        if (ch != '#')
+            break;
+        while (ch != EOF && ch != '\n')
+            ch = getc(file);
+    }
+    if (ch == EOF || !isdigit(ch))
+        return -1;
+    while (ch != EOF && isdigit(ch)) {
+        value = value * 10 + ch - '0';
+        ch = getc(file);
+    }
+    return value;
+}
+
+// Reads a single sample and scales it to between 0 and 255.
+static int readSample(FILE *file, int plain, int maxval)
+{
+    int value;
+    if (plain) {
+        value = readNumber(file);
+    } else if (maxval > 255) {
+        value = getc(file) << 8;
+        value |= getc(file);
+    } else {
+        value = getc(file);
+    }
+    if (value < 0)
+        return -1;
+    if (value > maxval)
+        value = maxval;
+    return (value * 255 + maxval / 2) / maxval;
+}
+
+// Converts a row of greyscale pixels into packed monochrome pixels.
+static void ditherRow(unsigned char *packed, const unsigned char *data,
+                      int width, int row, int method, int threshold)
+{
+    int x, level, lit, error;
+    int right = 0;
+    int diag = 0;
+    const unsigned char *pattern = bayer + (row & 3) * 4;
+    errors[0] = 0;
+    for (x = 0; x < width; ++x) {
+        level = data[x];
+        if (method == METHOD_FLOYD) {
+            level += errors[x + 1] + right;
+            lit = (level >= threshold);
+            error = level - (lit ? 255 : 0);
+            right = (error * 7) / 16;
+            errors[x] += (error * 3) / 16;
+            errors[x + 1] = (error * 5) / 16 + diag;
+            diag = error / 16;
+        } else if (method == METHOD_ORDERED) {
+            lit = (level >= pattern[x & 3] * 16 + 8 + threshold - 128);
+        } else {
+            lit = (level >= threshold);
+        }
+        if (lit)
+            packed[x / 8] |= 0x80 >> (x % 8);
+    }
+}
+
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s [-m method] [-t threshold] [-i] name [image]\n", progname);
+    fprintf(stderr, "       %s -p [-m method] [-t threshold] [-i] [image]\n", progname);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *progname = argv[0];
+    const char *name = 0;
+    FILE *file;
+    int method = METHOD_FLOYD;
+    int threshold = 128;
+    int invert = 0;
+    int pbm = 0;
+    int format, plain, color, width, height, maxval, stride;
+    int y, r, g, b, size, index;
+
+    // Parse the command-line options.
+    while (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0') {
+        if (!strcmp(argv[1], "-m") && argc > 2) {
+            if (!strcmp(argv[2], "threshold"))
+                method = METHOD_THRESHOLD;
+            else if (!strcmp(argv[2], "ordered"))
+                method = METHOD_ORDERED;
+            else if (!strcmp(argv[2], "floyd"))
+                method = METHOD_FLOYD;
+            else
+                usage(progname);
+            argc -= 2;
+            argv += 2;
+        } else if (!strcmp(argv[1], "-t") && argc > 2) {
+            threshold = atoi(argv[2]);
+            if (threshold < 0 || threshold > 255)
+                usage(progname);
+            argc -= 2;
+            argv += 2;
+        } else if (!strcmp(argv[1], "-i")) {
+            invert = 1;
+            --argc;
+            ++argv;
+        } else if (!strcmp(argv[1], "-p")) {
+            pbm = 1;
+            --argc;
+            ++argv;
+        } else {
+            usage(progname);
+        }
+    }
+    if (!pbm) {
+        if (argc < 2)
+            usage(progname);
+        name = argv[1];
+        --argc;
+        ++argv;
+    }
+    if (argc > 2)
+        usage(progname);
+    if (argc > 1) {
+        file = fopen(argv[1], "rb");
+        if (!file) {
+            perror(argv[1]);
+            return 1;
+        }
+    } else {
+        file = stdin;
+    }
+
+    // Read the PGM or PPM header.
+    if (getc(file) != 'P') {
+        fprintf(stderr, "%s: not a PGM or PPM image\n", progname);
+        return 1;
+    }
+    format = getc(file);
+    if (format != '2' && format != '3' && format != '5' && format != '6') {
+        fprintf(stderr, "%s: not a PGM or PPM image\n", progname);
+        return 1;
+    }
+    plain = (format == '2' || format == '3');
+    color = (format == '3' || format == '6');
+    width = readNumber(file);
+    height = readNumber(file);
+    maxval = readNumber(file);
+    if (width <= 0 || height <= 0 || width > MAX_SIZE || height > MAX_SIZE) {
+        fprintf(stderr, "%s: image must be between 1x1 and %dx%d\n",
+                progname, MAX_SIZE, MAX_SIZE);
+        return 1;
+    }
+    if (maxval <= 0 || maxval > 65535) {
+        fprintf(stderr, "%s: invalid maximum sample value\n", progname);
+        return 1;
+    }
+    stride = (width + 7) / 8;
+
+    // Read the pixels and convert them into greyscale.
+    for (index = 0; index < width * height; ++index) {
+        if (color) {
+            r = readSample(file, plain, maxval);
+            g = readSample(file, plain, maxval);
+            b = readSample(file, plain, maxval);
+            if (b < 0)
+                break;
+            grey[index] = (unsigned char)((r * 77 + g * 150 + b * 29) >> 8);
+        } else {
+            g = readSample(file, plain, maxval);
+            if (g < 0)
+                break;
+            grey[index] = (unsigned char)g;
+        }
+        if (invert)
+            grey[index] ^= 0xFF;
+    }
+    if (index < width * height) {
+        fprintf(stderr, "%s: image is truncated\n", progname);
+        return 1;
+    }
+    if (file != stdin)
+        fclose(file);
+
+    // Dither the image one row at a time.
+    memset(image, 0, sizeof(image));
+    memset(errors, 0, sizeof(errors));
+    for (y = 0; y < height; ++y)
+        ditherRow(image + y * stride, grey + y * width, width, y, method, threshold);
+
+    // Dump the image.
+    size = stride * height;
+    if (pbm) {
+        printf("P4\n%d %d\n", width, height);
+        fwrite(image, 1, size, stdout);
+        return 0;
+    }
+    printf("// %d bytes\n", size + 2);
+    printf("static uint8_t const %s[] PROGMEM = {\n", name);
+    printf("    %d, %d,", width, height);
+    for (index = 0; index < size; ++index) {
+        if ((index % 12) == 0)
+            printf("\n    ");
+        else
+            printf(" ");
+        if (index != (size - 1))
+            printf("0x%02X,", image[index]);
+        else
+            printf("0x%02X", image[index]);
+    }
+    printf("\n};\n");
+    return 0;
+}
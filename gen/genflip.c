@@ -20,29 +20,21 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include <stdio.h>
+// Utility for generating the flipBits table in DMD.cpp.
+
+#include "gentable.h"
 
 int main(int argc, char *argv[])
 {
+    long table[256];
     int value;
-    printf("static const uint8_t flipBits[256] PROGMEM = {\n");
     for (value = 0; value < 256; ++value) {
-        int flipped =
+        table[value] =
             ((value & 0x01) << 7) | ((value & 0x02) << 5) |
             ((value & 0x04) << 3) | ((value & 0x08) << 1) |
             ((value & 0x10) >> 1) | ((value & 0x20) >> 3) |
             ((value & 0x40) >> 5) | ((value & 0x80) >> 7);
-        if ((value % 12) == 0)
-            printf("    ");
-        else
-            printf(" ");
-        if (value != 255)
-            printf("0x%02X,", flipped);
-        else
-            printf("0x%02X", flipped);
-        if ((value % 12) == 11)
-            printf("\n");
     }
-    printf("\n};\n");
+    genTable("static const uint8_t flipBits[256]", table, 256, "0x%02lX", 12, 0);
     return 0;
 }
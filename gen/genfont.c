@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Utility for compiling BDF bitmap fonts into the indexed font format
+// that is drawn by Bitmap::drawText().
+//
+// Usage: genfont name font.bdf [first last]
+//
+// The characters from "first" to "last" inclusive are included in the
+// output, which defaults to 32 to 126.  TrueType fonts can be converted
+// into BDF at a specific pixel size first with a tool such as otf2bdf.
+//
+// The output has the same header as the fonts from GLCDFontCreator2,
+// except that the size field is 0x0001, followed by the width table and
+// then a table of 16-bit little-endian glyph offsets from the start of
+// the font.  This lets Bitmap find the image for any character directly
+// rather than walking the width table.  The images use the same column
+// layout as GLCDFontCreator2: each byte is 8 vertical pixels of a column
+// with the least significant bit at the top, and for fonts taller than
+// 8 pixels the last band of bytes is aligned with the bottom row.
+
+#include "gentable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_CHARS   256
+#define MAX_WIDTH   64
+#define MAX_HEIGHT  64
+#define MAX_SIZE    65535
+
+// Glyph pixel rows are stored with the baseline at row BASELINE so that
+// glyphs can extend up to BASELINE rows above or below it.
+#define BASELINE    64
+#define MAX_ROWS    (BASELINE * 2)
+
+struct Glyph
+{
+    int present;
+    int width;
+    unsigned char pixels[MAX_ROWS][MAX_WIDTH];
+};
+
+static struct Glyph glyphs[MAX_CHARS];
+static long output[MAX_SIZE];
+static int outputSize = 0;
+
+static void emit(int value)
+{
+    if (outputSize >= MAX_SIZE) {
+        fprintf(stderr, "font is too large\n");
+        exit(1);
+    }
+    output[outputSize++] = value & 0xFF;
+}
+
+static int startsWith(const char *line, const char *keyword)
+{
+    size_t len = strlen(keyword);
+    return !strncmp(line, keyword, len) && (line[len] == ' ' ||
+            line[len] == '\n' || line[len] == '\r' || line[len] == '\0');
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *file;
+    char line[1024];
+    int first = 32, last = 126;
+    int ascent = -1, descent = -1, boxHeight = 0, boxY = 0;
+    int encoding = -1, bbw = 0, bbh = 0, bbx = 0, bby = 0, row = -1;
+    int height, heightBytes, maxWidth, ch, x, y, band;
+    char upperName[256];
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s name font.bdf [first last]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 5) {
+        first = atoi(argv[3]);
+        last = atoi(argv[4]);
+    }
+    if (first < 0 || last >= MAX_CHARS || first > last) {
+        fprintf(stderr, "invalid character range\n");
+        return 1;
+    }
+    if ((file = fopen(argv[2], "r")) == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    // Read the font properties and the glyph images into "glyphs".
+    while (fgets(line, sizeof(line), file)) {
+        if (startsWith(line, "FONTBOUNDINGBOX")) {
+            int w, x0;
+            sscanf(line + 15, "%d %d %d %d", &w, &boxHeight, &x0, &boxY);
+        } else if (startsWith(line, "FONT_ASCENT")) {
+            ascent = atoi(line + 11);
+        } else if (startsWith(line, "FONT_DESCENT")) {
+            descent = atoi(line + 12);
+        } else if (startsWith(line, "ENCODING")) {
+            encoding = atoi(line + 8);
+        } else if (startsWith(line, "BBX")) {
+            sscanf(line + 3, "%d %d %d %d", &bbw, &bbh, &bbx, &bby);
+        } else if (startsWith(line, "BITMAP")) {
+            row = 0;
+            if (encoding >= first && encoding <= last) {
+                if (bbx < 0)
+                    bbx = 0;
+                if ((bbx + bbw) > MAX_WIDTH || bbh > MAX_HEIGHT) {
+                    fprintf(stderr, "glyph %d is too large\n", encoding);
+                    return 1;
+                }
+                glyphs[encoding].present = 1;
+                glyphs[encoding].width = bbx + bbw;
+            }
+        } else if (startsWith(line, "ENDCHAR")) {
+            row = -1;
+            encoding = -1;
+        } else if (row >= 0 && encoding >= first && encoding <= last) {
+            // Hexadecimal row of the glyph image, most significant bit first.
+            // Rows are stored upwards from the baseline for now.
+            int bit = 0;
+            char *p;
+            for (p = line; isxdigit((unsigned char)*p); ++p) {
+                int nibble = isdigit((unsigned char)*p) ? (*p - '0')
+                                                        : (toupper(*p) - 'A' + 10);
+                int b;
+                int stored = BASELINE + bby + bbh - 1 - row;
+                for (b = 3; b >= 0; --b, ++bit) {
+                    if (bit < bbw && (nibble & (1 << b)) &&
+                            stored >= 0 && stored < MAX_ROWS)
+                        glyphs[encoding].pixels[stored][bbx + bit] = 1;
+                }
+            }
+            ++row;
+        }
+    }
+    fclose(file);
+    if (ascent < 0 || descent < 0) {
+        ascent = boxHeight + boxY;
+        descent = -boxY;
+    }
+    height = ascent + descent;
+    if (height <= 0 || height > MAX_HEIGHT) {
+        fprintf(stderr, "invalid font height %d\n", height);
+        return 1;
+    }
+    heightBytes = (height + 7) / 8;
+
+    // Header, width table, and offset table.
+    maxWidth = 0;
+    for (ch = first; ch <= last; ++ch) {
+        if (glyphs[ch].width > maxWidth)
+            maxWidth = glyphs[ch].width;
+    }
+    emit(0x00);
+    emit(0x01);
+    emit(maxWidth);
+    emit(height);
+    emit(first);
+    emit(last - first + 1);
+    for (ch = first; ch <= last; ++ch)
+        emit(glyphs[ch].width);
+    {
+        int offset = outputSize + (last - first + 1) * 2;
+        for (ch = first; ch <= last; ++ch) {
+            emit(offset);
+            emit(offset >> 8);
+            offset += glyphs[ch].width * heightBytes;
+        }
+        if (offset > MAX_SIZE) {
+            fprintf(stderr, "font is too large\n");
+            return 1;
+        }
+    }
+
+    // Glyph images.  Convert the stored pixel rows into rows from the
+    // top of the character cell as we go.
+    for (ch = first; ch <= last; ++ch) {
+        for (band = 0; band < heightBytes; ++band) {
+            int top = band * 8;
+            if (heightBytes > 1 && band == (heightBytes - 1))
+                top = height - 8;
+            for (x = 0; x < glyphs[ch].width; ++x) {
+                int value = 0;
+                for (y = 0; y < 8; ++y) {
+                    int cellRow = top + y;
+                    int stored = BASELINE + ascent - 1 - cellRow;
+                    if (cellRow >= height || stored < 0 || stored >= MAX_ROWS)
+                        continue;
+                    if (glyphs[ch].pixels[stored][x])
+                        value |= (1 << y);
+                }
+                emit(value);
+            }
+        }
+    }
+
+    // Print the font as a header file.
+    for (x = 0; argv[1][x] != '\0' && x < (int)sizeof(upperName) - 1; ++x)
+        upperName[x] = toupper((unsigned char)argv[1][x]);
+    upperName[x] = '\0';
+    printf("// Font generated by genfont.c from %s\n\n", argv[2]);
+    printf("#include <inttypes.h>\n");
+    printf("#include <avr/pgmspace.h>\n\n");
+    printf("#ifndef %s_H\n", upperName);
+    printf("#define %s_H\n\n", upperName);
+    printf("#define %s_WIDTH %d\n", upperName, maxWidth);
+    printf("#define %s_HEIGHT %d\n\n", upperName, height);
+    snprintf(line, sizeof(line), "static uint8_t const %s[]", argv[1]);
+    genTable(line, output, outputSize, "0x%02lX", 12, 0);
+    printf("\n#endif\n");
+    return 0;
+}
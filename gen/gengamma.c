@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Utility for generating the gamma correction table in BlinkLED.cpp.
+//
+// Usage: gengamma [gamma]
+
+#include "gentable.h"
+#include <stdlib.h>
+#include <math.h>
+
+int main(int argc, char *argv[])
+{
+    long table[256];
+    double gamma = 2.2;
+    int value;
+    if (argc > 1)
+        gamma = atof(argv[1]);
+    for (value = 0; value < 256; ++value)
+        table[value] = (long)floor(pow(value / 255.0, gamma) * 255.0 + 0.5);
+    printf("// Gamma correction table for a gamma of %g.  Table generated by gengamma.c\n", gamma);
+    genTable("static uint8_t const gammaTable[256]", table, 256, "%3ld", 16, 0);
+    return 0;
+}
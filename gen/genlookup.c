@@ -22,7 +22,7 @@
 
 // Utility for generating the button mapping table in LCD.cpp.
 
-#include <stdio.h>
+#include "gentable.h"
 
 #define LCD_BUTTON_NONE         0
 #define LCD_BUTTON_LEFT         1
@@ -41,6 +41,7 @@
 int main(int argc, char *argv[])
 {
     char rawTest[1024];
+    long table[32];
     int value, value2, value3, bits;
     char button;
 
@@ -79,7 +80,6 @@ int main(int argc, char *argv[])
 
     // Dump the button mapping table for the selected bit count.
     bits = 5;
-    printf("static uint8_t const buttonMappings[] PROGMEM = {\n");
     for (value2 = 0; value2 < (1 << bits); ++value2) {
         value = value2 << (10 - bits);
         value3 = value + (1 << (10 - bits)) - 1;
@@ -88,19 +88,9 @@ int main(int argc, char *argv[])
             button = rawTest[value];
             ++value;
         }
-        if ((value2 & 0x0F) != 0)
-            printf(", ");
-        else
-            printf("    ");
-        printf("%d", button);
-        if ((value2 & 0x0F) == 0x0F) {
-            if (value2 < ((1 << bits - 1)))
-                printf(",\n");
-            else
-                printf("\n");
-        }
+        table[value2] = button;
     }
-    printf("};\n");
+    genTable("static uint8_t const buttonMappings[]", table, 1 << bits, "%ld", 16, 0);
     printf("#define mapButton(value) (pgm_read_byte(&(buttonMappings[(value) >> %d])))\n", 10 - bits);
 
     return 0;
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Utility for converting PBM images into the run-length encoded format
+// that is drawn by Bitmap::drawRLEBitmap().
+//
+// Usage: genrle name [image.pbm]
+//
+// Both the plain (P1) and raw (P4) PBM formats are supported.  Black
+// pixels in the image are drawn with the color passed to drawRLEBitmap().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_SIZE    255
+
+static unsigned char image[MAX_SIZE * ((MAX_SIZE + 7) / 8)];
+static unsigned char packed[MAX_SIZE * MAX_SIZE];
+
+static int readNumber(FILE *file)
+{
+    int ch = getc(file);
+    int value = 0;
+    for (;;) {
+        while (ch != EOF && isspace(ch))
+            ch = getc(file);
+        if (ch != '#')
+            break;
+        while (ch != EOF && ch != '\n')
+            ch = getc(file);
+    }
+    if (ch == EOF || !isdigit(ch))
+        return -1;
+    while (ch != EOF && isdigit(ch)) {
+        value = value * 10 + ch - '0';
+        ch = getc(file);
+    }
+    return value;
+}
+
+static int readPlainBit(FILE *file)
+{
+    int ch;
+    do {
+        ch = getc(file);
+    } while (ch != EOF && ch != '0' && ch != '1');
+    return ch == '1';
+}
+
+// Encodes the pixels of the image as alternating runs of 0 and 1 pixels,
+// one 4-bit run length per nibble, and returns the number of bytes.
+static int packRuns(unsigned char *out, int width, int height, int stride)
+{
+    int nibbles = 0;
+    int value = 0;
+    int run = 0;
+    int x, y, pixel;
+    for (y = 0; y <= height; ++y) {
+        for (x = 0; x < width; ++x) {
+            if (y < height)
+                pixel = (image[y * stride + x / 8] & (0x80 >> (x % 8))) != 0;
+            else
+                pixel = !value;     // Flush the final run.
+            if (pixel == value) {
+                ++run;
+                continue;
+            }
+            while (run >= 15) {
+                out[nibbles / 2] |= (nibbles & 1) ? 15 : 0xF0;
+                ++nibbles;
+                run -= 15;
+            }
+            out[nibbles / 2] |= (nibbles & 1) ? run : (run << 4);
+            ++nibbles;
+            value = pixel;
+            run = 1;
+            if (y == height)
+                break;
+        }
+    }
+    return (nibbles + 1) / 2;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *file;
+    int width, height, stride, raw;
+    int x, y, size, index;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s name [image.pbm]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        file = fopen(argv[2], "rb");
+        if (!file) {
+            perror(argv[2]);
+            return 1;
+        }
+    } else {
+        file = stdin;
+    }
+
+    // Read the PBM header.
+    if (getc(file) != 'P') {
+        fprintf(stderr, "%s: not a PBM image\n", argv[0]);
+        return 1;
+    }
+    raw = getc(file);
+    if (raw != '1' && raw != '4') {
+        fprintf(stderr, "%s: not a PBM image\n", argv[0]);
+        return 1;
+    }
+    raw = (raw == '4');
+    width = readNumber(file);
+    height = readNumber(file);
+    if (width <= 0 || height <= 0 || width > MAX_SIZE || height > MAX_SIZE) {
+        fprintf(stderr, "%s: image must be between 1x1 and %dx%d\n",
+                argv[0], MAX_SIZE, MAX_SIZE);
+        return 1;
+    }
+    stride = (width + 7) / 8;
+
+    // Read the pixels, which use the same byte-aligned line layout as
+    // Bitmap::drawBitmap() in the raw format.
+    if (raw) {
+        if (fread(image, stride, height, file) != (size_t)height) {
+            fprintf(stderr, "%s: image is truncated\n", argv[0]);
+            return 1;
+        }
+        for (y = 0; y < height; ++y) {
+            if (width % 8)
+                image[y * stride + stride - 1] &= 0xFF << (8 - width % 8);
+        }
+    } else {
+        memset(image, 0, sizeof(image));
+        for (y = 0; y < height; ++y) {
+            for (x = 0; x < width; ++x) {
+                if (readPlainBit(file))
+                    image[y * stride + x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+    }
+    if (file != stdin)
+        fclose(file);
+
+    // Compress the image and dump it.
+    size = packRuns(packed, width, height, stride);
+    if (size > stride * height) {
+        fprintf(stderr, "%s: warning: image is larger when compressed; "
+                "use drawBitmap() instead\n", argv[0]);
+    }
+    printf("// %d bytes, %d bytes uncompressed\n", size + 2, stride * height + 2);
+    printf("static uint8_t const %s[] PROGMEM = {\n", argv[1]);
+    printf("    %d, %d,", width, height);
+    for (index = 0; index < size; ++index) {
+        if ((index % 12) == 0)
+            printf("\n    ");
+        else
+            printf(" ");
+        if (index != (size - 1))
+            printf("0x%02X,", packed[index]);
+        else
+            printf("0x%02X", packed[index]);
+    }
+    printf("\n};\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Utility for generating the AES S-box tables in AESCommon.cpp.
+
+#include "gentable.h"
+
+// Multiplies two elements of GF(2^8) modulo the AES polynomial.
+static int gmul(int a, int b)
+{
+    int result = 0;
+    while (b) {
+        if (b & 1)
+            result ^= a;
+        a <<= 1;
+        if (a & 0x100)
+            a ^= 0x11B;
+        b >>= 1;
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    long sbox[256];
+    long inverse[256];
+    int value, inv, bit;
+    for (value = 0; value < 256; ++value) {
+        // Find the multiplicative inverse, with 0 mapping to 0.
+        inv = 0;
+        if (value) {
+            for (inv = 1; inv < 256; ++inv) {
+                if (gmul(value, inv) == 1)
+                    break;
+            }
+        }
+
+        // Apply the affine transformation.
+        int result = 0x63;
+        for (bit = 0; bit < 5; ++bit)
+            result ^= ((inv << bit) | (inv >> (8 - bit))) & 0xFF;
+        sbox[value] = result;
+        inverse[result] = value;
+    }
+    printf("// AES S-box (http://en.wikipedia.org/wiki/Rijndael_S-box).\n// Table generated by gensbox.c\n");
+    genTable("static uint8_t const sbox[256]", sbox, 256, "0x%02lX", 8, 16);
+    printf("\n// AES inverse S-box (http://en.wikipedia.org/wiki/Rijndael_S-box).\n// Table generated by gensbox.c\n");
+    genTable("static uint8_t const sbox_inverse[256]", inverse, 256, "0x%02lX", 8, 16);
+    return 0;
+}
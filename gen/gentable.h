@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Common support for the table generators in this directory.
+//
+// Each generator is a stand-alone host program that computes a lookup
+// table and prints it as a PROGMEM array, ready to be pasted over the
+// previous version of the table in the library source.  Because the
+// Arduino IDE has no pre-build step, the generated tables are checked in
+// and the generators are run by hand whenever the tables need to change:
+//
+//     cc -o gensbox gensbox.c -lm && ./gensbox
+//
+// Running a generator without changes and diffing the output against
+// the library source is a quick way to check that a table is correct.
+
+#ifndef GENTABLE_H
+#define GENTABLE_H
+
+#include <stdio.h>
+
+// Prints "count" values as a PROGMEM array with the declaration "decl".
+// Each value is printed with "format" and "perLine" values are printed
+// on each line.  If "commentEvery" is non-zero, then lines that start
+// on a multiple of "commentEvery" are followed by a comment that gives
+// the index of the first value on the line in hexadecimal.
+static void genTable(const char *decl, const long *values, int count,
+                     const char *format, int perLine, int commentEvery)
+{
+    int index;
+    printf("%s PROGMEM = {\n", decl);
+    for (index = 0; index < count; ++index) {
+        int column = index % perLine;
+        if (column == 0)
+            printf("    ");
+        else
+            printf(" ");
+        printf(format, values[index]);
+        if (index != (count - 1))
+            printf(",");
+        if (column == (perLine - 1) || index == (count - 1)) {
+            int start = index - column;
+            if (commentEvery && (start % commentEvery) == 0)
+                printf("     // 0x%02X", start);
+            if (index != (count - 1))
+                printf("\n");
+        }
+    }
+    printf("\n};\n");
+}
+
+#endif
@@ -21,12 +21,17 @@
  */
 
 #include "BlinkLED.h"
+#include <avr/pgmspace.h>
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
 #include <WProgram.h>
 #endif
 
+// Number of brightness updates during a fade when the LED is being
+// dispatched by a LoopScheduler.
+#define BLINK_FADE_STEPS    64
+
 /**
  * \class BlinkLED BlinkLED.h <BlinkLED.h>
  * \brief Blink a LED on a digital output pin.
@@ -52,6 +57,25 @@
  * setState().  The blink rate can be modified with setBlinkRate().
  * And the blink cycle can be suspended and restarted with pause()
  * and resume().
+ *
+ * If the LED is connected to a PWM-capable output, then setFadeTime()
+ * can be used to fade the LED in and out rather than switching it
+ * abruptly.  The brightness is ramped with analogWrite() through a
+ * gamma-corrected lookup table, so the hardware PWM unit does the work
+ * in between updates.  The following example makes the LED "breathe"
+ * once every 4 seconds:
+ *
+ * \code
+ * BlinkLED breathe(9, 2000, 2000);
+ *
+ * void setup() {
+ *     breathe.setFadeTime(2000);
+ * }
+ * \endcode
+ *
+ * Instead of calling loop() from the application's main loop, the LED
+ * can be added to a LoopScheduler, which will only dispatch the LED
+ * when it next needs to change state.
  */
 
 /**
@@ -67,6 +91,8 @@ BlinkLED::BlinkLED(uint8_t pin, unsigned long onTime, unsigned long offTime, boo
     , _paused(false)
     , _onTime(onTime)
     , _offTime(offTime)
+    , _fadeTime(0)
+    , _level(initialState ? 255 : 0)
 {
     pinMode(pin, OUTPUT);
     digitalWrite(pin, initialState ? HIGH : LOW);
@@ -83,17 +109,19 @@ void BlinkLED::loop()
     unsigned long currentTime = millis();
     if (_state) {
         if ((currentTime - _lastChange) >= _onTime) {
-            digitalWrite(_pin, LOW);
+            write(false);
             _lastChange += _onTime;
             _state = false;
         }
     } else {
         if ((currentTime - _lastChange) >= _offTime) {
-            digitalWrite(_pin, HIGH);
+            write(true);
             _lastChange += _offTime;
             _state = true;
         }
     }
+    if (_fadeTime)
+        fade(currentTime);
 }
 
 /**
@@ -123,6 +151,7 @@ void BlinkLED::setBlinkRate(unsigned long onTime, unsigned long offTime)
 {
     _onTime = onTime;
     _offTime = offTime;
+    reschedule();
 }
 
 /**
@@ -145,9 +174,10 @@ void BlinkLED::setBlinkRate(unsigned long onTime, unsigned long offTime)
 void BlinkLED::setState(bool state)
 {
     if (_state != state) {
-        digitalWrite(_pin, state ? HIGH : LOW);
+        write(state);
         _state = state;
         _lastChange = millis();
+        reschedule();
     }
 }
 
@@ -174,17 +204,18 @@ void BlinkLED::resume()
         unsigned long currentTime = millis();
         if (_state) {
             if ((currentTime - _lastChange) >= _onTime) {
-                digitalWrite(_pin, LOW);
+                write(false);
                 _lastChange = currentTime;
                 _state = false;
             }
         } else {
             if ((currentTime - _lastChange) >= _offTime) {
-                digitalWrite(_pin, HIGH);
+                write(true);
                 _lastChange = currentTime;
                 _state = true;
             }
         }
+        reschedule();
     }
 }
 
@@ -194,3 +225,139 @@ void BlinkLED::resume()
  *
  * \sa pause(), resume()
  */
+
+/**
+ * \fn unsigned long BlinkLED::fadeTime() const
+ * \brief Returns the number of milliseconds that the LED takes to fade
+ * between on and off, or zero if fading is disabled.
+ *
+ * \sa setFadeTime()
+ */
+
+/**
+ * \brief Sets the number of milliseconds that the LED takes to fade
+ * between on and off to \a fadeTime.
+ *
+ * The fade starts at each change of state() and is complete after
+ * \a fadeTime milliseconds, or at the next change of state if that
+ * comes sooner.  Setting \a fadeTime to the same value as onTime()
+ * and offTime() produces a continuous "breathing" effect.
+ *
+ * If \a fadeTime is zero, then fading is disabled and the LED is switched
+ * with digitalWrite().  Otherwise the LED must be connected to an
+ * output that supports analogWrite().
+ *
+ * \sa fadeTime(), gamma()
+ */
+void BlinkLED::setFadeTime(unsigned long fadeTime)
+{
+    _fadeTime = fadeTime;
+    if (!fadeTime)
+        digitalWrite(_pin, _state ? HIGH : LOW);
+    reschedule();
+}
+
+// Gamma correction table for a gamma of 2.2.  Table generated by gengamma.c
+static uint8_t const gammaTable[256] PROGMEM = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+/**
+ * \brief Converts a perceived \a brightness between 0 and 255 into a
+ * gamma-corrected PWM value for analogWrite().
+ *
+ * LED's look much brighter at low PWM duty cycles than a linear scale
+ * would suggest.  This function uses a lookup table in program memory
+ * to map \a brightness so that fades appear smooth to the eye.
+ *
+ * \sa setFadeTime(), ChaseLEDs::setTrail()
+ */
+uint8_t BlinkLED::gamma(uint8_t brightness)
+{
+    return pgm_read_byte(&(gammaTable[brightness]));
+}
+
+/**
+ * \brief Dispatches the blink loop for this LED from a LoopScheduler.
+ */
+void BlinkLED::dispatch()
+{
+    loop();
+    reschedule();
+}
+
+/**
+ * \internal
+ * \brief Writes the new \a state to the output pin, unless the LED is
+ * fading in which case fade() will update the pin.
+ */
+void BlinkLED::write(bool state)
+{
+    if (!_fadeTime)
+        digitalWrite(_pin, state ? HIGH : LOW);
+}
+
+/**
+ * \internal
+ * \brief Updates the brightness of a fading LED at \a currentTime.
+ */
+void BlinkLED::fade(unsigned long currentTime)
+{
+    unsigned long elapsed = currentTime - _lastChange;
+    uint8_t brightness;
+    if (elapsed >= _fadeTime)
+        brightness = 255;
+    else
+        brightness = (uint8_t)((elapsed * 255) / _fadeTime);
+    if (!_state)
+        brightness = 255 - brightness;
+    uint8_t level = gamma(brightness);
+    if (level != _level) {
+        analogWrite(_pin, level);
+        _level = level;
+    }
+}
+
+/**
+ * \internal
+ * \brief Sets the scheduler deadline for the next change of state,
+ * or for the next step of the fade if the LED is fading.
+ *
+ * Paused LED's are not scheduled until resume() is called.
+ */
+void BlinkLED::reschedule()
+{
+    if (!scheduler())
+        return;
+    if (_paused) {
+        unschedule();
+        return;
+    }
+    unsigned long next = _lastChange + (_state ? _onTime : _offTime);
+    if (_fadeTime) {
+        unsigned long now = millis();
+        if ((now - _lastChange) < _fadeTime) {
+            unsigned long step = _fadeTime / BLINK_FADE_STEPS;
+            if (!step)
+                step = 1;
+            if (((long)(now + step - next)) < 0)
+                next = now + step;
+        }
+    }
+    scheduleAt(next);
+}
@@ -24,8 +24,9 @@
 #define BlinkLED_h
 
 #include <inttypes.h>
+#include "LoopScheduler.h"
 
-class BlinkLED
+class BlinkLED : public ScheduledTask
 {
 public:
     BlinkLED(uint8_t pin, unsigned long onTime, unsigned long offTime, bool initialState = false);
@@ -43,6 +44,14 @@ public:
     void resume();
     bool isPaused() const { return _paused; }
 
+    unsigned long fadeTime() const { return _fadeTime; }
+    void setFadeTime(unsigned long fadeTime);
+
+    static uint8_t gamma(uint8_t brightness);
+
+protected:
+    void dispatch();
+
 private:
     uint8_t _pin;
     bool _state;
@@ -50,6 +59,12 @@ private:
     unsigned long _onTime;
     unsigned long _offTime;
     unsigned long _lastChange;
+    unsigned long _fadeTime;
+    uint8_t _level;
+
+    void write(bool state);
+    void fade(unsigned long currentTime);
+    void reschedule();
 };
 
 #endif
@@ -108,6 +108,77 @@
  * <tr><td>10</td><td>90</td></tr>
  * <tr><td>n</td><td>n * (n - 1)</td></tr>
  * </table>
+ *
+ * Instead of calling loop() from the application's main loop, the
+ * array can be added to a LoopScheduler.  The scheduler works in
+ * milliseconds, so holdTime() is rounded up to the next millisecond
+ * when the array is being refreshed this way.  Large arrays will
+ * flicker less with enableTimer2().
+ *
+ * \section charlieplex_timer Timer-driven refresh
+ *
+ * The timing of loop() depends upon how often the application calls it,
+ * which can cause visible flicker when the application is busy.  On AVR
+ * boards, enableTimer2() instead drives the refresh from Timer2 compare
+ * match interrupts with
+ * <a href="http://www.batsocks.co.uk/readme/art_bcm_1.htm">bit angle
+ * modulation</a>, which gives each LED 256 brightness levels with steady
+ * timing.  The application must provide an interrupt service routine
+ * that calls handleTimer():
+ *
+ * \code
+ * Charlieplex charlie(pins, sizeof(pins));
+ *
+ * ISR(TIMER2_COMPA_vect)
+ * {
+ *     charlie.handleTimer();
+ * }
+ *
+ * void setup() {
+ *     charlie.enableTimer2();
+ *     charlie.setPwmLed(0, 32);
+ *     charlie.setPwmLed(1, 255);
+ * }
+ * \endcode
+ *
+ * Each LED is visited in turn and held for 255 time units of 8
+ * microseconds, split into 8 slots of 1, 2, 4, ..., 128 units that light
+ * the LED if the corresponding bit of its pwmLed() value is set.  Unlike
+ * loop(), every LED gets the same share of time whether it is lit or not,
+ * so an LED's brightness does not depend upon how many other LED's are lit.
+ * The refresh rate is about 490 / count() Hz, so for arrays of more than
+ * 6 LED's it may be better to pass a smaller number of brightness bits
+ * to enableTimer2().
+ *
+ * The pin direction and output masks for each LED are precomputed so that
+ * the interrupt handler only needs to write two port registers.  This
+ * requires that all of the pins are on the same AVR port; for example,
+ * D8 to D13 on the Arduino Uno.  Timer2 cannot be used for anything else,
+ * such as DMD::enableTimer2(), while the timer-driven refresh is enabled.
+ */
+
+/**
+ * \class StaticCharlieplex Charlieplex.h <Charlieplex.h>
+ * \brief Charlieplexed LED array whose state is allocated statically
+ * at compile time.
+ *
+ * Charlieplex allocates its pin tables and LED values from the heap
+ * when it is constructed.  StaticCharlieplex instead stores them within
+ * the object itself, with the number of pins given by the \a NumPins
+ * template parameter, so that the memory usage is known at link time:
+ *
+ * \code
+ * byte pins[3] = {9, 10, 11};
+ * StaticCharlieplex<3> charlie(pins);
+ * \endcode
+ *
+ * \sa Charlieplex
+ */
+
+/**
+ * \fn StaticCharlieplex::StaticCharlieplex(const uint8_t *pins)
+ * \brief Constructs a new charlieplexed array where the output pins
+ * are specified by the \a NumPins entries in \a pins.
  */
 
 /**
@@ -123,27 +194,114 @@ Charlieplex::Charlieplex(const uint8_t *pins, uint8_t numPins)
     , _lastTime(micros())
     , _currentIndex(-1)
     , _pwmPhase(0xC0)
+    , _ddr(0)
+    , _port(0)
+    , _ddrMasks(0)
+    , _portMasks(0)
+    , _allMask(0)
+    , _bamBits(0)
+    , _bamBit(0)
+    , _bamLed(0)
+    , _analog(false)
+    , _staticData(false)
+{
+    _pinInfo = (PinInfo *)malloc(numPins * sizeof(PinInfo));
+    init(pins, numPins, 0);
+}
+
+/**
+ * \brief Constructs a new charlieplexed array that uses the caller's
+ * \a pinInfo and \a data buffers instead of allocating memory from
+ * the heap.
+ *
+ * The \a pinInfo array must have \a numPins entries and \a data must
+ * contain CHARLIEPLEX_DATA_SIZE(\a numPins) bytes.  This constructor is
+ * used by StaticCharlieplex.
+ */
+Charlieplex::Charlieplex(const uint8_t *pins, uint8_t numPins, PinInfo *pinInfo, uint8_t *data)
+    : _count(((int)numPins) * (numPins - 1))
+    , _lastTime(micros())
+    , _currentIndex(-1)
+    , _pwmPhase(0xC0)
+    , _ddr(0)
+    , _port(0)
+    , _ddrMasks(0)
+    , _portMasks(0)
+    , _allMask(0)
+    , _bamBits(0)
+    , _bamBit(0)
+    , _bamLed(0)
+    , _analog(false)
+    , _staticData(true)
+{
+    _pinInfo = pinInfo;
+    init(pins, numPins, data);
+}
+
+// Initializes the pin tables and LED values, using the memory in "data"
+// if it is not NULL or allocating it from the heap otherwise.
+void Charlieplex::init(const uint8_t *pins, uint8_t numPins, uint8_t *data)
 {
     // Determine the best hold time for 50 Hz refresh when all LED's
     // are lit.  Divide it again by 4 (to get 200 Hz) to manage the
     // simulated PWM in refresh().
     _holdTime = 20000 / _count / 4;
 
-    // Allocate the pin arrays and populate them.  Doing this now makes
-    // refresh() more efficient later, at the expense of some memory.
-    _pins1 = (uint8_t *)malloc(_count);
-    _pins2 = (uint8_t *)malloc(_count);
+    // Look up the direction and output registers for each pin.
+    uint8_t port = digitalPinToPort(pins[0]);
+    bool samePort = true;
+    for (uint8_t pin = 0; pin < numPins; ++pin) {
+        uint8_t pinPort = digitalPinToPort(pins[pin]);
+        _pinInfo[pin].ddr = portModeRegister(pinPort);
+        _pinInfo[pin].port = portOutputRegister(pinPort);
+        _pinInfo[pin].mask = digitalPinToBitMask(pins[pin]);
+        _pinInfo[pin].pin = pins[pin];
+        if (pinPort != port)
+            samePort = false;
+    }
+
+    // Allocate the pin arrays and populate them with indexes into the
+    // pin table.  Doing this now makes refresh() more efficient later,
+    // at the expense of some memory.
+    if (data) {
+        _pins1 = data + _count;
+        _pins2 = data + _count * 2;
+    } else {
+        _pins1 = (uint8_t *)malloc(_count);
+        _pins2 = (uint8_t *)malloc(_count);
+    }
     int n = 0;
     for (uint8_t pass = 1; pass < numPins; ++pass) {
         for (uint8_t pin = 0; pin < (numPins - pass); ++pin) {
-            _pins1[n] = _pins2[n + 1] = pins[pin];
-            _pins2[n] = _pins1[n + 1] = pins[pin + pass];
+            _pins1[n] = _pins2[n + 1] = pin;
+            _pins2[n] = _pins1[n + 1] = pin + pass;
             n += 2;
         }
     }
 
+    // If all pins are on the same port, then precompute the DDR and PORT
+    // masks for each LED so that it can be switched with two writes.
+    if (samePort) {
+        _ddr = _pinInfo[0].ddr;
+        _port = _pinInfo[0].port;
+        if (data) {
+            _ddrMasks = data + _count * 3;
+            _portMasks = data + _count * 4;
+        } else {
+            _ddrMasks = (uint8_t *)malloc(_count);
+            _portMasks = (uint8_t *)malloc(_count);
+        }
+        for (int index = 0; index < _count; ++index) {
+            uint8_t anode = _pinInfo[_pins1[index]].mask;
+            uint8_t cathode = _pinInfo[_pins2[index]].mask;
+            _ddrMasks[index] = anode | cathode;
+            _portMasks[index] = anode;
+            _allMask |= anode | cathode;
+        }
+    }
+
     // Allocate space for the LED value array and zero it.
-    _values = (uint8_t *)malloc(_count);
+    _values = data ? data : (uint8_t *)malloc(_count);
     memset(_values, 0, _count);
 
     // Start with all pins configured as floating inputs (all LED's off).
@@ -158,9 +316,15 @@ Charlieplex::Charlieplex(const uint8_t *pins, uint8_t numPins)
  */
 Charlieplex::~Charlieplex()
 {
-    free(_pins1);
-    free(_pins2);
-    free(_values);
+    disableTimer2();
+    if (!_staticData) {
+        free(_ddrMasks);
+        free(_portMasks);
+        free(_pinInfo);
+        free(_pins1);
+        free(_pins2);
+        free(_values);
+    }
 }
 
 /**
@@ -270,12 +434,15 @@ Charlieplex::~Charlieplex()
  * a single pass will be count() * holdTime() microseconds.
  *
  * If the application is using timer interrupts to drive the multiplexing
- * process, then use refresh() instead of loop().
+ * process, then use refresh() instead of loop().  This function does
+ * nothing if enableTimer2() is in use.
  *
  * \sa led(), pwmLed(), holdTime(), refresh()
  */
 void Charlieplex::loop()
 {
+    if (_bamBits)
+        return;
     unsigned long us = micros();
     if ((us - _lastTime) >= _holdTime) {
         _lastTime = us;
@@ -283,6 +450,20 @@ void Charlieplex::loop()
     }
 }
 
+/**
+ * \brief Dispatches the multiplexing scan from a LoopScheduler.
+ *
+ * The scan is paused while enableTimer2() is in use.
+ */
+void Charlieplex::dispatch()
+{
+    if (_bamBits)
+        return;
+    refresh();
+    unsigned long ms = (_holdTime + 999) / 1000;
+    scheduleAt(millis() + (ms ? ms : 1));
+}
+
 /**
  * \brief Refreshes the charlieplexed array by advancing to the next LED
  * that needs to be lit.
@@ -291,6 +472,11 @@ void Charlieplex::loop()
  * routine to advance the multiplexing state without the main application
  * having to explicitly call loop().
  *
+ * The pins are switched by writing directly to the port registers that
+ * were looked up by the constructor rather than with pinMode() and
+ * digitalWrite().  When all of the pins are on the same port, each LED
+ * is switched with a single masked write to the DDR and PORT registers.
+ *
  * \sa loop()
  */
 void Charlieplex::refresh()
@@ -306,45 +492,211 @@ void Charlieplex::refresh()
     }
     if (limit < 0) {
         // No LED's are lit.  Turn off the previous LED and exit.
-        if (prevIndex != -1) {
-            digitalWrite(_pins1[prevIndex], LOW);
-            digitalWrite(_pins2[prevIndex], LOW);
-            pinMode(_pins1[prevIndex], INPUT);
-            pinMode(_pins2[prevIndex], INPUT);
-        }
+        if (prevIndex != -1)
+            ledOff(prevIndex);
         _currentIndex = -1;
         return;
     }
 
     // Light the current LED.
     uint8_t value = _values[_currentIndex];
-    uint8_t pin1 = _pins1[_currentIndex];
-    uint8_t pin2 = _pins2[_currentIndex];
     _pwmPhase += 0x40;
     if (prevIndex != _currentIndex) {
         // Turn off the previous LED.
-        if (prevIndex != -1) {
-            digitalWrite(_pins1[prevIndex], LOW);
-            digitalWrite(_pins2[prevIndex], LOW);
-            pinMode(_pins1[prevIndex], INPUT);
-            pinMode(_pins2[prevIndex], INPUT);
-        }
+        if (prevIndex != -1)
+            ledOff(prevIndex);
 
         // We simulate PWM using a phase counter because analogWrite()
         // combined with holdTime() causes too much flickering if more
         // than one LED is lit.  This reduces the PWM resolution to 1 in 4.
-        pinMode(pin1, OUTPUT);
-        pinMode(pin2, OUTPUT);
-        if (value > _pwmPhase)
-            digitalWrite(pin1, HIGH);
-        else
-            digitalWrite(pin1, LOW);
+        ledOn(_currentIndex, value > _pwmPhase);
     } else {
         // Same LED as previous.  Since there is only a single LED
         // that is lit, we can use analogWrite() to set the PWM state.
-        if (value == 255)
-            digitalWrite(pin1, HIGH);
-        else
+        uint8_t pin1 = _pinInfo[_pins1[_currentIndex]].pin;
+        if (value == 255) {
+            if (_analog) {
+                digitalWrite(pin1, HIGH);
+                _analog = false;
+            } else {
+                ledOn(_currentIndex, true);
+            }
+        } else {
             analogWrite(pin1, value);
+            _analog = true;
+        }
+    }
+}
+
+/**
+ * \internal
+ * \brief Turns off the LED at \a index by floating its pins.
+ */
+void Charlieplex::ledOff(int index)
+{
+    if (_analog) {
+        // Disconnect the PWM timer from the anode.
+        digitalWrite(_pinInfo[_pins1[index]].pin, LOW);
+        _analog = false;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    if (_ddrMasks) {
+        uint8_t mask = _ddrMasks[index];
+        *_ddr &= ~mask;
+        *_port &= ~mask;
+    } else {
+        const PinInfo *anode = &(_pinInfo[_pins1[index]]);
+        const PinInfo *cathode = &(_pinInfo[_pins2[index]]);
+        *(anode->ddr) &= ~(anode->mask);
+        *(anode->port) &= ~(anode->mask);
+        *(cathode->ddr) &= ~(cathode->mask);
+        *(cathode->port) &= ~(cathode->mask);
+    }
+    SREG = sreg;
+}
+
+/**
+ * \internal
+ * \brief Drives the pins for the LED at \a index, with the anode
+ * set \a high or low.
+ */
+void Charlieplex::ledOn(int index, bool high)
+{
+    uint8_t sreg = SREG;
+    cli();
+    if (_ddrMasks) {
+        *_ddr |= _ddrMasks[index];
+        if (high)
+            *_port |= _portMasks[index];
+        else
+            *_port &= ~_portMasks[index];
+    } else {
+        const PinInfo *anode = &(_pinInfo[_pins1[index]]);
+        const PinInfo *cathode = &(_pinInfo[_pins2[index]]);
+        *(anode->ddr) |= anode->mask;
+        *(cathode->ddr) |= cathode->mask;
+        if (high)
+            *(anode->port) |= anode->mask;
+        else
+            *(anode->port) &= ~(anode->mask);
+    }
+    SREG = sreg;
+}
+
+// Length of the shortest bit angle modulation slot, in Timer2 ticks.
+// At 16 MHz with a prescaler of 64, this is 8 microseconds.
+#define CHARLIEPLEX_BAM_UNIT    2
+
+/**
+ * \brief Enables timer-driven refresh of the array with bit angle
+ * modulation on Timer2.
+ *
+ * \param bits The number of brightness bits to display, between 1 and 8.
+ * The top \a bits bits of each pwmLed() value are displayed.  Fewer bits
+ * give a faster refresh rate at the expense of brightness resolution.
+ *
+ * \return Returns false if the pins are not all on the same AVR port,
+ * in which case loop() or refresh() must be used instead.
+ *
+ * The application must provide an interrupt service routine for
+ * <tt>TIMER2_COMPA_vect</tt> that calls handleTimer().
+ *
+ * \sa disableTimer2(), handleTimer(), \ref charlieplex_timer "Timer-driven refresh"
+ */
+bool Charlieplex::enableTimer2(uint8_t bits)
+{
+    if (bits < 1)
+        bits = 1;
+    else if (bits > 8)
+        bits = 8;
+
+    // All pins must be on the same port so that each LED can be
+    // switched with a single write to the DDR and PORT registers.
+    if (!_ddrMasks)
+        return false;
+
+    // Turn off the multiplexing scan that loop() was doing.
+    disableTimer2();
+    if (_currentIndex != -1) {
+        ledOff(_currentIndex);
+        _currentIndex = -1;
+    }
+    _bamBits = bits;
+    _bamBit = 0;
+    _bamLed = 0;
+
+    // CTC mode on OCR2A with a prescaler of 64.
+    uint8_t sreg = SREG;
+    cli();
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(CS22);
+    TCNT2 = 0;
+    OCR2A = CHARLIEPLEX_BAM_UNIT - 1;
+    TIFR2 = _BV(OCF2A);
+    TIMSK2 = _BV(OCIE2A);
+    SREG = sreg;
+    return true;
+}
+
+/**
+ * \brief Disables timer-driven refresh of the array and turns off all LED's.
+ *
+ * After this function is called, loop() or refresh() must be used to
+ * refresh the array.
+ *
+ * \sa enableTimer2()
+ */
+void Charlieplex::disableTimer2()
+{
+    if (!_bamBits)
+        return;
+    uint8_t sreg = SREG;
+    cli();
+    TIMSK2 &= ~_BV(OCIE2A);
+    *_ddr &= ~_allMask;
+    *_port &= ~_allMask;
+    _bamBits = 0;
+    SREG = sreg;
+
+    // Resume the multiplexing scan if the array is being scheduled.
+    if (scheduler())
+        scheduleAt(millis());
+}
+
+/**
+ * \brief Handles a Timer2 compare match interrupt for the timer-driven
+ * refresh; must be called from the <tt>TIMER2_COMPA_vect</tt> interrupt
+ * handler.
+ *
+ * \sa enableTimer2()
+ */
+void Charlieplex::handleTimer()
+{
+    if (!_bamBits)
+        return;
+
+    // Set the length of the slot that is starting.  Slots run from the
+    // least significant displayed bit of each LED up to bit 7.
+    uint8_t bit = _bamBit + (8 - _bamBits);
+    OCR2A = (CHARLIEPLEX_BAM_UNIT << _bamBit) - 1;
+
+    // Configure the pins for the LED if the bit is set, or all off.
+    uint8_t led = _bamLed;
+    if (_values[led] & (1 << bit)) {
+        *_port &= ~_allMask;
+        *_ddr = (*_ddr & ~_allMask) | _ddrMasks[led];
+        *_port |= _portMasks[led];
+    } else {
+        *_ddr &= ~_allMask;
+        *_port &= ~_allMask;
+    }
+
+    // Advance to the next slot.
+    if (++_bamBit >= _bamBits) {
+        _bamBit = 0;
+        if (++led >= _count)
+            led = 0;
+        _bamLed = led;
     }
 }
@@ -24,8 +24,12 @@
 #define Charlieplex_h
 
 #include <inttypes.h>
+#include "LoopScheduler.h"
 
-class Charlieplex
+// Number of bytes of LED state that StaticCharlieplex needs for numPins.
+#define CHARLIEPLEX_DATA_SIZE(numPins)  ((numPins) * ((numPins) - 1) * 5)
+
+class Charlieplex : public ScheduledTask
 {
 public:
     Charlieplex(const uint8_t *pins, uint8_t numPins);
@@ -45,8 +49,26 @@ public:
     void loop();
     void refresh();
 
+    bool enableTimer2(uint8_t bits = 8);
+    void disableTimer2();
+    void handleTimer();
+
+protected:
+    struct PinInfo
+    {
+        volatile uint8_t *ddr;
+        volatile uint8_t *port;
+        uint8_t mask;
+        uint8_t pin;
+    };
+
+    Charlieplex(const uint8_t *pins, uint8_t numPins, PinInfo *pinInfo, uint8_t *data);
+
+    void dispatch();
+
 private:
     int _count;
+    PinInfo *_pinInfo;
     uint8_t *_pins1;
     uint8_t *_pins2;
     uint8_t *_values;
@@ -54,6 +76,32 @@ private:
     unsigned long _lastTime;
     int _currentIndex;
     uint8_t _pwmPhase;
+    volatile uint8_t *_ddr;
+    volatile uint8_t *_port;
+    uint8_t *_ddrMasks;
+    uint8_t *_portMasks;
+    uint8_t _allMask;
+    uint8_t _bamBits;
+    uint8_t _bamBit;
+    uint8_t _bamLed;
+    bool _analog;
+    bool _staticData;
+
+    void init(const uint8_t *pins, uint8_t numPins, uint8_t *data);
+    void ledOff(int index);
+    void ledOn(int index, bool high);
+};
+
+template <uint8_t NumPins>
+class StaticCharlieplex : public Charlieplex
+{
+public:
+    explicit StaticCharlieplex(const uint8_t *pins)
+        : Charlieplex(pins, NumPins, pinInfo, data) {}
+
+private:
+    PinInfo pinInfo[NumPins];
+    uint8_t data[CHARLIEPLEX_DATA_SIZE(NumPins)];
 };
 
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include "ChaseLEDs.h"
+#include "BlinkLED.h"
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
@@ -53,6 +54,22 @@
  *
  * See the \ref blink_cylon "Cylon" example for more information on
  * how to use the ChaseLEDs class in a practical application.
+ *
+ * The chaser can also leave a fading trail behind the lit LED on
+ * PWM-capable outputs with setTrail(), without needing a subclass:
+ *
+ * \code
+ * uint8_t pins[] = {3, 5, 6, 9, 10, 11, 10, 9, 6, 5};
+ * ChaseLEDs chaser(pins, sizeof(pins), 100);
+ *
+ * void setup() {
+ *     chaser.setTrail(2);
+ * }
+ * \endcode
+ *
+ * Instead of calling loop() from the application's main loop, the chaser
+ * can be added to a LoopScheduler, which will only dispatch it when it is
+ * time to advance to the next LED.
  */
 
 /**
@@ -74,6 +91,7 @@ ChaseLEDs::ChaseLEDs(const uint8_t *pins, int num, unsigned long advanceTime)
     , _currentIndex(-1)
     , _advanceTime(advanceTime)
     , _lastChange(millis())
+    , _trail(0)
 {
     for (uint8_t index = 0; index < _numPins; ++index) {
         pinMode(_pins[index], OUTPUT);
@@ -114,6 +132,9 @@ void ChaseLEDs::loop()
  * \brief Sets the number of milliseconds to advance between LED's to
  * \a advanceTime.
  *
+ * If the chaser has been added to a LoopScheduler, then the deadline
+ * for the next advance is adjusted for the new \a advanceTime.
+ *
  * \sa advanceTime(), advance()
  */
 
@@ -128,17 +149,59 @@ void ChaseLEDs::loop()
  * digitalWrite(nextPin, HIGH);
  * \endcode
  *
+ * If trail() is non-zero, then the default implementation instead dims
+ * the trail() pins before \a nextPin with analogWrite() to produce a
+ * fading trail, and turns off the pin after the end of the trail.
+ *
  * This method may be overridden in subclasses to provide special effects.
  * See the documentation for previousPin() for some example effects.
  *
- * \sa previousPin()
+ * \sa previousPin(), setTrail()
  */
 void ChaseLEDs::advance(uint8_t prevPin, uint8_t nextPin)
 {
-    digitalWrite(prevPin, LOW);
+    if (!_trail) {
+        digitalWrite(prevPin, LOW);
+        digitalWrite(nextPin, HIGH);
+        return;
+    }
+
+    // Work from the end of the trail towards the head so that pins which
+    // appear more than once in an oscillating sequence end up with the
+    // brightest value.
+    unsigned int steps = _trail + 1;
+    digitalWrite(previousPin(steps), LOW);
+    for (uint8_t n = _trail; n > 0; --n) {
+        uint8_t brightness = (uint8_t)((255U * (steps - n)) / steps);
+        analogWrite(previousPin(n), BlinkLED::gamma(brightness));
+    }
     digitalWrite(nextPin, HIGH);
 }
 
+/**
+ * \fn uint8_t ChaseLEDs::trail() const
+ * \brief Returns the number of dimmed LED's that follow the lit LED,
+ * or zero if there is no trail.
+ *
+ * \sa setTrail()
+ */
+
+/**
+ * \fn void ChaseLEDs::setTrail(uint8_t length)
+ * \brief Sets the number of dimmed LED's that follow the lit LED to
+ * \a length.
+ *
+ * The brightness of the trail falls off evenly towards its end, and is
+ * gamma-corrected with BlinkLED::gamma() so that the steps look even.
+ * The pins in the trail must support analogWrite().  The default
+ * is zero, which disables the trail.
+ *
+ * The trail is drawn by the default implementation of advance(), so it
+ * has no effect on subclasses that override advance().
+ *
+ * \sa trail(), advance()
+ */
+
 /**
  * \fn uint8_t ChaseLEDs::previousPin(int n) const
  * \brief Returns the pin that is \a n steps back in the sequence.
@@ -180,3 +243,23 @@ void ChaseLEDs::advance(uint8_t prevPin, uint8_t nextPin)
  *
  * \sa advance()
  */
+
+/**
+ * \brief Dispatches the control loop for this LED chaser from a
+ * LoopScheduler.
+ */
+void ChaseLEDs::dispatch()
+{
+    loop();
+    reschedule();
+}
+
+/**
+ * \internal
+ * \brief Sets the scheduler deadline for the next advance.
+ */
+void ChaseLEDs::reschedule()
+{
+    if (scheduler() && _currentIndex >= 0)
+        scheduleAt(_lastChange + _advanceTime);
+}
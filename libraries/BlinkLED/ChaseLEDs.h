@@ -24,8 +24,9 @@
 #define ChaseLEDs_h
 
 #include <inttypes.h>
+#include "LoopScheduler.h"
 
-class ChaseLEDs
+class ChaseLEDs : public ScheduledTask
 {
 public:
     ChaseLEDs(const uint8_t *pins, int num, unsigned long advanceTime);
@@ -33,12 +34,16 @@ public:
     void loop();
 
     unsigned long advanceTime() const { return _advanceTime; }
-    void setAdvanceTime(unsigned long advanceTime) { _advanceTime = advanceTime; }
+    void setAdvanceTime(unsigned long advanceTime) { _advanceTime = advanceTime; reschedule(); }
+
+    uint8_t trail() const { return _trail; }
+    void setTrail(uint8_t length) { _trail = length; }
 
 protected:
     virtual void advance(uint8_t prevPin, uint8_t nextPin);
     uint8_t previousPin(int n) const
         { return _pins[(_currentIndex + _numPins - n) % _numPins]; }
+    void dispatch();
 
 private:
     const uint8_t *_pins;
@@ -46,6 +51,9 @@ private:
     int _currentIndex;
     unsigned long _advanceTime;
     unsigned long _lastChange;
+    uint8_t _trail;
+
+    void reschedule();
 };
 
 #endif
@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LEDStrip.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \class LEDStrip LEDStrip.h <LEDStrip.h>
+ * \brief Drives a strip of WS2812 addressable LED's.
+ *
+ * WS2812 LED's (also sold as "NeoPixels") are chained along a single
+ * data line, and each LED takes a 24-bit color value in green, red,
+ * blue order.  This class keeps a framebuffer of 3 bytes per LED in that
+ * order and sends it to the strip with update():
+ *
+ * \code
+ * #include <LEDStrip.h>
+ *
+ * LEDStrip strip(6, 30, 50);
+ *
+ * void setup() {
+ *     strip.setPixel(0, 255, 0, 0);
+ *     strip.setPixel(1, 64, 0, 0);
+ *     strip.setPixel(2, 16, 0, 0);
+ * }
+ *
+ * void loop() {
+ *     strip.loop();
+ * }
+ * \endcode
+ *
+ * Like ChaseLEDs, loop() calls advance() every advanceTime() milliseconds.
+ * The default implementation of advance() rotates the framebuffer along
+ * the strip by one LED, which turns the example above into a red chase
+ * with a fading tail; subclasses can override advance() to draw other
+ * effects.  loop() also sends the framebuffer to the strip whenever it
+ * has been changed with setPixel() or clear().  An advanceTime() of
+ * zero disables advance().
+ *
+ * On AVR boards running at 16 MHz the bits are sent by a cycle-counted
+ * assembly routine with interrupts disabled for about 30 microseconds
+ * per LED.  Other AVR clock speeds are not supported and update() will
+ * return false.  On ESP32 boards the bits are generated by the RMT
+ * peripheral, which converts the framebuffer to pulses from its own
+ * interrupt handler as the strip is sent.  update() returns immediately
+ * and the sketch's interrupts keep running, so classes like IRreceiver
+ * are not affected.  The framebuffer should not be modified while
+ * isBusy() is true or the strip may show a mixture of the old and
+ * new frames.
+ *
+ * \sa ChaseLEDs
+ */
+
+// Minimum time that the data line must be held low between frames,
+// in microseconds.  Newer WS2812 parts need more than the original 50.
+#define LED_STRIP_LATCH_TIME    300
+
+// Time taken to send the data for a single LED, in microseconds.
+#define LED_STRIP_LED_TIME      30
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+// RMT ticks at 40 MHz (25 nanoseconds) for the WS2812 bit timings.
+#define LED_STRIP_T0H   16      // 0.4us
+#define LED_STRIP_T0L   34      // 0.85us
+#define LED_STRIP_T1H   32      // 0.8us
+#define LED_STRIP_T1L   18      // 0.45us
+
+// Converts framebuffer bytes into RMT items as the strip is being sent.
+static void IRAM_ATTR ledStripTranslate
+    (const void *src, rmt_item32_t *dest, size_t src_size,
+     size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    if (!src || !dest) {
+        *translated_size = 0;
+        *item_num = 0;
+        return;
+    }
+    rmt_item32_t bit0, bit1;
+    bit0.level0 = 1;
+    bit0.duration0 = LED_STRIP_T0H;
+    bit0.level1 = 0;
+    bit0.duration1 = LED_STRIP_T0L;
+    bit1.level0 = 1;
+    bit1.duration0 = LED_STRIP_T1H;
+    bit1.level1 = 0;
+    bit1.duration1 = LED_STRIP_T1L;
+    const uint8_t *psrc = (const uint8_t *)src;
+    size_t size = 0;
+    size_t num = 0;
+    while (size < src_size && (num + 8) <= wanted_num) {
+        uint8_t value = *psrc++;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            dest->val = (value & 0x80) ? bit1.val : bit0.val;
+            value <<= 1;
+            ++dest;
+        }
+        num += 8;
+        ++size;
+    }
+    *translated_size = size;
+    *item_num = num;
+}
+
+/**
+ * \brief Initializes a strip of \a numLEDs LED's on \a pin, using RMT
+ * \a channel.
+ *
+ * The default is RMT channel 1 so as not to clash with the default
+ * channel of IRtransmitter.  If \a advanceTime is non-zero, then advance()
+ * will be called every \a advanceTime milliseconds by loop().
+ */
+LEDStrip::LEDStrip(uint8_t pin, int numLEDs, unsigned long advanceTime,
+                   rmt_channel_t channel)
+#else
+/**
+ * \brief Initializes a strip of \a numLEDs LED's on \a pin.
+ *
+ * If \a advanceTime is non-zero, then advance() will be called every
+ * \a advanceTime milliseconds by loop().
+ */
+LEDStrip::LEDStrip(uint8_t pin, int numLEDs, unsigned long advanceTime)
+#endif
+    : _count(numLEDs)
+    , _dirty(true)
+    , _advanceTime(advanceTime)
+    , _lastChange(millis())
+    , _lastUpdate(micros())
+{
+    // Allocate one extra byte because the AVR transmit routine fetches
+    // the byte after the end of the framebuffer.
+    _data = (uint8_t *)malloc(numLEDs * 3 + 1);
+    memset(_data, 0, numLEDs * 3 + 1);
+
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, channel);
+    config.clk_div = 2;     // 25 nanoseconds per tick.
+    rmt_config(&config);
+    rmt_driver_install(channel, 0, 0);
+    rmt_translator_init(channel, ledStripTranslate);
+    _channel = channel;
+#else
+    _port = portOutputRegister(digitalPinToPort(pin));
+    _mask = digitalPinToBitMask(pin);
+#endif
+}
+
+/**
+ * \brief Destroys this LED strip.
+ */
+LEDStrip::~LEDStrip()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    rmt_wait_tx_done(_channel, portMAX_DELAY);
+    rmt_driver_uninstall(_channel);
+#endif
+    free(_data);
+}
+
+/**
+ * \fn int LEDStrip::count() const
+ * \brief Returns the number of LED's in the strip.
+ */
+
+/**
+ * \brief Returns the color of the LED at \a index as a 0xRRGGBB value.
+ *
+ * \sa setPixel()
+ */
+uint32_t LEDStrip::pixel(int index) const
+{
+    const uint8_t *ptr = _data + index * 3;
+    return (((uint32_t)(ptr[1])) << 16) | (((uint32_t)(ptr[0])) << 8) | ptr[2];
+}
+
+/**
+ * \brief Sets the LED at \a index to the color given by \a red, \a green,
+ * and \a blue.
+ *
+ * The change will be sent to the strip by the next call to loop() or
+ * update().
+ *
+ * \sa pixel(), clear()
+ */
+void LEDStrip::setPixel(int index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint8_t *ptr = _data + index * 3;
+    ptr[0] = green;
+    ptr[1] = red;
+    ptr[2] = blue;
+    markDirty();
+}
+
+/**
+ * \fn void LEDStrip::setPixel(int index, uint32_t rgb)
+ * \brief Sets the LED at \a index to the 0xRRGGBB color value \a rgb.
+ *
+ * \sa pixel()
+ */
+
+/**
+ * \brief Turns off all LED's in the strip.
+ *
+ * \sa setPixel()
+ */
+void LEDStrip::clear()
+{
+    memset(_data, 0, _count * 3);
+    markDirty();
+}
+
+/**
+ * \fn uint8_t *LEDStrip::data()
+ * \brief Returns a pointer to the framebuffer, which contains count() * 3
+ * bytes in green, red, blue order.
+ *
+ * Call markDirty() after modifying the framebuffer directly.
+ */
+
+/**
+ * \brief Marks the framebuffer as changed so that the next call to loop()
+ * will send it to the strip.
+ *
+ * \sa data()
+ */
+void LEDStrip::markDirty()
+{
+    if (!_dirty) {
+        _dirty = true;
+        if (scheduler())
+            scheduleAt(millis());
+    }
+}
+
+/**
+ * \brief Returns true if the strip is still being sent in the background
+ * by the last update().
+ *
+ * This is only possible on ESP32 boards; on AVR boards update() sends
+ * the strip before returning.
+ */
+bool LEDStrip::isBusy() const
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    return rmt_wait_tx_done(_channel, 0) != ESP_OK;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Sends the framebuffer to the strip.
+ *
+ * Returns false if the strip could not be sent right now because the
+ * previous frame is still being sent or latched; loop() will try again
+ * on its next call.  Also returns false on AVR boards that are not
+ * running at 16 MHz.
+ *
+ * \sa loop(), isBusy()
+ */
+bool LEDStrip::update()
+{
+    if (isBusy() || ((long)(micros() - _lastUpdate)) < LED_STRIP_LATCH_TIME)
+        return false;
+#if defined(ARDUINO_ARCH_ESP32)
+    rmt_write_sample(_channel, _data, _count * 3, false);
+    _lastUpdate = micros() + ((unsigned long)_count) * LED_STRIP_LED_TIME;
+#elif defined(__AVR__) && F_CPU == 16000000L
+    // Each bit takes 20 cycles (1.25us).  The line is driven high at the
+    // start of the bit, low again after 7 cycles for a 0 bit, and low
+    // after 15 cycles for a 1 bit.  The next byte is loaded during the
+    // low time of the last bit of the previous byte.
+    volatile uint8_t *port = _port;
+    const uint8_t *ptr = _data;
+    uint16_t bytes = _count * 3;
+    uint8_t value = *ptr++;
+    uint8_t bit = 8;
+    if (bytes) {
+        uint8_t sreg = SREG;
+        cli();
+        uint8_t hi = *port | _mask;
+        uint8_t lo = *port & ~_mask;
+        uint8_t next = lo;
+        __asm__ __volatile__ (
+            "1:"                        "\n\t"  // T = 0
+            "st   %a[port], %[hi]"      "\n\t"  // 2: line high
+            "sbrc %[value], 7"          "\n\t"  // 3 or 4
+            "mov  %[next], %[hi]"       "\n\t"  // 4: 1 bit stays high
+            "dec  %[bit]"               "\n\t"  // 5
+            "st   %a[port], %[next]"    "\n\t"  // 7: 0 bit goes low
+            "mov  %[next], %[lo]"       "\n\t"  // 8
+            "breq 2f"                   "\n\t"  // 9 or 10
+            "rol  %[value]"             "\n\t"  // 10
+            "rjmp .+0"                  "\n\t"  // 12
+            "nop"                       "\n\t"  // 13
+            "st   %a[port], %[lo]"      "\n\t"  // 15: 1 bit goes low
+            "nop"                       "\n\t"  // 16
+            "rjmp .+0"                  "\n\t"  // 18
+            "rjmp 1b"                   "\n\t"  // 20
+            "2:"                        "\n\t"  // T = 10
+            "ldi  %[bit], 8"            "\n\t"  // 11
+            "ld   %[value], %a[ptr]+"   "\n\t"  // 13
+            "st   %a[port], %[lo]"      "\n\t"  // 15: 1 bit goes low
+            "nop"                       "\n\t"  // 16
+            "sbiw %[bytes], 1"          "\n\t"  // 18
+            "brne 1b"                   "\n"    // 20
+            : [value] "+r" (value), [bit] "+d" (bit), [next] "+r" (next),
+              [bytes] "+w" (bytes), [ptr] "+e" (ptr)
+            : [port] "e" (port), [hi] "r" (hi), [lo] "r" (lo)
+        );
+        SREG = sreg;
+    }
+    _lastUpdate = micros();
+#else
+    return false;
+#endif
+    _dirty = false;
+    return true;
+}
+
+/**
+ * \brief Performs a single iteration of the control loop for this strip.
+ *
+ * Calls advance() if advanceTime() has elapsed, and then sends the
+ * framebuffer to the strip if it has changed.
+ *
+ * \sa advance(), update()
+ */
+void LEDStrip::loop()
+{
+    if (_advanceTime && (millis() - _lastChange) >= _advanceTime) {
+        _lastChange += _advanceTime;
+        advance();
+        _dirty = true;
+    }
+    if (_dirty)
+        update();
+}
+
+/**
+ * \fn unsigned long LEDStrip::advanceTime() const
+ * \brief Returns the number of milliseconds between calls to advance(),
+ * or zero if advance() is disabled.
+ *
+ * \sa setAdvanceTime(), advance()
+ */
+
+/**
+ * \brief Sets the number of milliseconds between calls to advance()
+ * to \a advanceTime, or zero to disable advance().
+ *
+ * \sa advanceTime(), advance()
+ */
+void LEDStrip::setAdvanceTime(unsigned long advanceTime)
+{
+    if (!_advanceTime)
+        _lastChange = millis();
+    _advanceTime = advanceTime;
+    reschedule();
+}
+
+/**
+ * \brief Advances the animation on the strip by one step.
+ *
+ * The default implementation rotates the framebuffer along the strip by
+ * one LED, with the last LED moving to the start of the strip.  This
+ * method may be overridden in subclasses to provide other effects by
+ * modifying the framebuffer; there is no need to call markDirty().
+ *
+ * \sa advanceTime()
+ */
+void LEDStrip::advance()
+{
+    if (_count < 2)
+        return;
+    uint8_t *last = _data + (_count - 1) * 3;
+    uint8_t green = last[0];
+    uint8_t red = last[1];
+    uint8_t blue = last[2];
+    memmove(_data + 3, _data, (_count - 1) * 3);
+    _data[0] = green;
+    _data[1] = red;
+    _data[2] = blue;
+}
+
+/**
+ * \brief Dispatches the control loop for this strip from a LoopScheduler.
+ */
+void LEDStrip::dispatch()
+{
+    loop();
+    reschedule();
+}
+
+/**
+ * \internal
+ * \brief Sets the scheduler deadline for the next advance(), or to retry
+ * an update() that could not be sent.
+ */
+void LEDStrip::reschedule()
+{
+    if (!scheduler())
+        return;
+    if (_dirty)
+        scheduleAt(millis() + 1);
+    else if (_advanceTime)
+        scheduleAt(_lastChange + _advanceTime);
+    else
+        unschedule();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LEDStrip_h
+#define LEDStrip_h
+
+#include <inttypes.h>
+#include "LoopScheduler.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/rmt.h>
+#endif
+
+class LEDStrip : public ScheduledTask
+{
+public:
+#if defined(ARDUINO_ARCH_ESP32)
+    LEDStrip(uint8_t pin, int numLEDs, unsigned long advanceTime = 0,
+             rmt_channel_t channel = RMT_CHANNEL_1);
+#else
+    LEDStrip(uint8_t pin, int numLEDs, unsigned long advanceTime = 0);
+#endif
+    ~LEDStrip();
+
+    int count() const { return _count; }
+
+    uint32_t pixel(int index) const;
+    void setPixel(int index, uint8_t red, uint8_t green, uint8_t blue);
+    void setPixel(int index, uint32_t rgb)
+        { setPixel(index, (uint8_t)(rgb >> 16), (uint8_t)(rgb >> 8), (uint8_t)rgb); }
+    void clear();
+
+    uint8_t *data() { return _data; }
+    void markDirty();
+
+    bool isBusy() const;
+    bool update();
+
+    void loop();
+
+    unsigned long advanceTime() const { return _advanceTime; }
+    void setAdvanceTime(unsigned long advanceTime);
+
+protected:
+    virtual void advance();
+    void dispatch();
+
+private:
+    uint8_t *_data;
+    int _count;
+    bool _dirty;
+    unsigned long _advanceTime;
+    unsigned long _lastChange;
+    unsigned long _lastUpdate;
+#if defined(ARDUINO_ARCH_ESP32)
+    rmt_channel_t _channel;
+#else
+    volatile uint8_t *_port;
+    uint8_t _mask;
+#endif
+
+    void reschedule();
+};
+
+#endif
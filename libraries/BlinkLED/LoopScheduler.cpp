@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LoopScheduler.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <stdlib.h>
+
+/**
+ * \class LoopScheduler LoopScheduler.h <LoopScheduler.h>
+ * \brief Dispatches the periodic work of several objects from a single
+ * deadline queue.
+ *
+ * Classes like BlinkLED, ChaseLEDs, and Charlieplex normally have a
+ * loop() method that must be called from the application's main loop.
+ * Each call reads the clock to decide whether anything needs to be done,
+ * which wastes time when nothing is due.  LoopScheduler instead keeps the
+ * objects in a min-heap ordered by their next deadline, so that each call
+ * to loop() only looks at the head of the heap and only dispatches the
+ * objects that are due:
+ *
+ * \code
+ * #include <BlinkLED.h>
+ * #include <LoopScheduler.h>
+ *
+ * BlinkLED statusBlink(13, 70, 930);
+ * BlinkLED errorBlink(12, 250, 250);
+ * LoopScheduler scheduler;
+ *
+ * void setup() {
+ *     scheduler.add(statusBlink);
+ *     scheduler.add(errorBlink);
+ * }
+ *
+ * void loop() {
+ *     scheduler.loop();
+ * }
+ * \endcode
+ *
+ * Objects that are added to a scheduler should not also have their own
+ * loop() method called by the application.
+ *
+ * The timeUntilNext() function reports how long it will be until the
+ * next object needs attention, which the application can use to put the
+ * CPU to sleep in between with sleepUpTo() from the PowerSave library.
+ *
+ * All deadlines are expressed in milliseconds as returned by millis().
+ *
+ * \sa ScheduledTask
+ */
+
+/**
+ * \class ScheduledTask LoopScheduler.h <LoopScheduler.h>
+ * \brief Base class for objects that can be dispatched by a LoopScheduler.
+ *
+ * Subclasses implement dispatch() to perform their periodic work and
+ * call scheduleAt() with the millis() value at which they next need to
+ * be dispatched.  A task that has nothing to do can call unschedule()
+ * or simply not reschedule itself; it will stay attached to the scheduler
+ * but will not be dispatched until scheduleAt() is called again.
+ *
+ * The methods of this class are inline and only reach the scheduler
+ * through a function pointer, so classes that derive from ScheduledTask
+ * do not cause LoopScheduler to be linked into sketches that do not use it.
+ *
+ * \sa LoopScheduler
+ */
+
+/**
+ * \fn LoopScheduler *ScheduledTask::scheduler() const
+ * \brief Returns the scheduler that this task has been added to, or NULL
+ * if the task has not been added to a scheduler.
+ *
+ * \sa LoopScheduler::add()
+ */
+
+/**
+ * \fn bool ScheduledTask::isScheduled() const
+ * \brief Returns true if this task currently has a deadline.
+ *
+ * \sa deadline(), scheduleAt()
+ */
+
+/**
+ * \fn unsigned long ScheduledTask::deadline() const
+ * \brief Returns the millis() value at which this task will next be
+ * dispatched if isScheduled() is true.
+ *
+ * \sa isScheduled(), scheduleAt()
+ */
+
+/**
+ * \fn void ScheduledTask::dispatch()
+ * \brief Performs the periodic work for this task after its deadline
+ * has been reached.
+ *
+ * The task is no longer scheduled when this is called.  The implementation
+ * should call scheduleAt() to set the next deadline if there is more
+ * work to be done later.
+ *
+ * \sa scheduleAt()
+ */
+
+/**
+ * \fn void ScheduledTask::scheduleAt(unsigned long deadline)
+ * \brief Schedules this task to be dispatched when millis() reaches
+ * \a deadline, replacing any previous deadline.
+ *
+ * \sa unschedule(), dispatch()
+ */
+
+/**
+ * \fn void ScheduledTask::unschedule()
+ * \brief Cancels the current deadline for this task, if any.
+ *
+ * \sa scheduleAt()
+ */
+
+/**
+ * \brief Constructs a new scheduler that can manage up to \a maxTasks
+ * tasks at once.
+ */
+LoopScheduler::LoopScheduler(uint8_t maxTasks)
+    : _tasks((ScheduledTask **)malloc(maxTasks * sizeof(ScheduledTask *)))
+    , _maxTasks(maxTasks)
+    , _count(0)
+    , _size(0)
+{
+}
+
+/**
+ * \brief Destroys this scheduler after detaching all of its tasks.
+ */
+LoopScheduler::~LoopScheduler()
+{
+    for (uint8_t index = 0; index < _count; ++index) {
+        ScheduledTask *task = _tasks[index];
+        task->_scheduler = 0;
+        task->_changed = 0;
+    }
+    free(_tasks);
+}
+
+/**
+ * \brief Adds \a task to this scheduler.
+ *
+ * The task will be dispatched the next time loop() is called, after which
+ * it will set its own deadlines.  Returns false if the scheduler is full
+ * or \a task has already been added to a scheduler.
+ *
+ * \sa remove()
+ */
+bool LoopScheduler::add(ScheduledTask &task)
+{
+    if (task._scheduler || _count >= _maxTasks)
+        return false;
+    task._scheduler = this;
+    task._changed = changed;
+    task._index = _count;
+    task._state = ScheduledTask::Idle;
+    _tasks[_count++] = &task;
+    task.scheduleAt(millis());
+    return true;
+}
+
+/**
+ * \brief Removes \a task from this scheduler.
+ *
+ * \sa add()
+ */
+void LoopScheduler::remove(ScheduledTask &task)
+{
+    if (task._scheduler != this)
+        return;
+    task._state = ScheduledTask::Detach;
+    changed(&task);
+}
+
+/**
+ * \fn uint8_t LoopScheduler::count() const
+ * \brief Returns the number of tasks that have been added to this scheduler.
+ */
+
+/**
+ * \brief Dispatches all tasks whose deadlines have been reached.
+ *
+ * This function should be called from the application's main loop.
+ * Each task is dispatched at most once per call to loop(), even if it
+ * sets a new deadline that has already expired.
+ *
+ * \sa timeUntilNext()
+ */
+void LoopScheduler::loop()
+{
+    unsigned long now = millis();
+    uint8_t limit = _count;
+    while (_size && limit-- > 0) {
+        ScheduledTask *task = _tasks[0];
+        if (((long)(now - task->_deadline)) < 0)
+            break;
+        task->_state = ScheduledTask::Idle;
+        removeFromHeap(task);
+        task->dispatch();
+    }
+}
+
+/**
+ * \var LoopScheduler::NoDeadline
+ * \brief Value that is returned by timeUntilNext() when no task is
+ * currently scheduled.
+ */
+
+/**
+ * \brief Returns the number of milliseconds until the next task deadline.
+ *
+ * Returns zero if a task is already due, or NoDeadline if no tasks are
+ * currently scheduled.
+ *
+ * \sa loop()
+ */
+unsigned long LoopScheduler::timeUntilNext() const
+{
+    if (!_size)
+        return NoDeadline;
+    long diff = (long)(_tasks[0]->_deadline - millis());
+    if (diff <= 0)
+        return 0;
+    return (unsigned long)diff;
+}
+
+/**
+ * \internal
+ * \brief Updates the position of \a task after its state has changed.
+ *
+ * The first _size entries of _tasks are the heap of scheduled tasks,
+ * and the remaining entries up to _count are the idle tasks.
+ */
+void LoopScheduler::changed(ScheduledTask *task)
+{
+    LoopScheduler *scheduler = task->_scheduler;
+    if (task->_index < scheduler->_size)
+        scheduler->removeFromHeap(task);
+    if (task->_state == ScheduledTask::Scheduled) {
+        scheduler->insertIntoHeap(task);
+    } else if (task->_state == ScheduledTask::Detach) {
+        scheduler->swap(task->_index, scheduler->_count - 1);
+        --(scheduler->_count);
+        task->_scheduler = 0;
+        task->_changed = 0;
+        task->_state = ScheduledTask::Idle;
+    }
+}
+
+/**
+ * \internal
+ * \brief Moves \a task from the heap to the start of the idle tasks.
+ */
+void LoopScheduler::removeFromHeap(ScheduledTask *task)
+{
+    uint8_t index = task->_index;
+    uint8_t last = --_size;
+    if (index != last) {
+        swap(index, last);
+        siftUp(index);
+        siftDown(index);
+    }
+}
+
+/**
+ * \internal
+ * \brief Moves \a task from the idle tasks into the heap.
+ */
+void LoopScheduler::insertIntoHeap(ScheduledTask *task)
+{
+    uint8_t index = _size++;
+    swap(task->_index, index);
+    siftUp(index);
+}
+
+/**
+ * \internal
+ * \brief Swaps the tasks at \a index1 and \a index2.
+ */
+void LoopScheduler::swap(uint8_t index1, uint8_t index2)
+{
+    ScheduledTask *task1 = _tasks[index1];
+    ScheduledTask *task2 = _tasks[index2];
+    _tasks[index1] = task2;
+    _tasks[index2] = task1;
+    task2->_index = index1;
+    task1->_index = index2;
+}
+
+/**
+ * \internal
+ * \brief Returns true if the task at \a index1 is due before the task
+ * at \a index2.
+ */
+bool LoopScheduler::before(uint8_t index1, uint8_t index2) const
+{
+    return ((long)(_tasks[index1]->_deadline - _tasks[index2]->_deadline)) < 0;
+}
+
+/**
+ * \internal
+ * \brief Moves the task at \a index up the heap until its parent is due
+ * no later than it is.
+ */
+void LoopScheduler::siftUp(uint8_t index)
+{
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!before(index, parent))
+            break;
+        swap(index, parent);
+        index = parent;
+    }
+}
+
+/**
+ * \internal
+ * \brief Moves the task at \a index down the heap until its children
+ * are due no earlier than it is.
+ */
+void LoopScheduler::siftDown(uint8_t index)
+{
+    for (;;) {
+        unsigned int child = index * 2 + 1;
+        if (child >= _size)
+            break;
+        if ((child + 1) < _size && before(child + 1, child))
+            ++child;
+        if (!before(child, index))
+            break;
+        swap(index, child);
+        index = child;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LoopScheduler_h
+#define LoopScheduler_h
+
+#include <inttypes.h>
+
+class LoopScheduler;
+
+class ScheduledTask
+{
+public:
+    ScheduledTask()
+        : _scheduler(0), _changed(0), _deadline(0), _index(0), _state(Idle) {}
+    virtual ~ScheduledTask()
+    {
+        if (_changed) {
+            _state = Detach;
+            (*_changed)(this);
+        }
+    }
+
+    LoopScheduler *scheduler() const { return _scheduler; }
+    bool isScheduled() const { return _state == Scheduled; }
+    unsigned long deadline() const { return _deadline; }
+
+protected:
+    virtual void dispatch() = 0;
+
+    void scheduleAt(unsigned long deadline)
+    {
+        _deadline = deadline;
+        _state = Scheduled;
+        if (_changed)
+            (*_changed)(this);
+    }
+    void unschedule()
+    {
+        if (_state == Scheduled) {
+            _state = Idle;
+            if (_changed)
+                (*_changed)(this);
+        }
+    }
+
+private:
+    LoopScheduler *_scheduler;
+    void (*_changed)(ScheduledTask *task);
+    unsigned long _deadline;
+    uint8_t _index;
+    uint8_t _state;
+
+    enum { Idle, Scheduled, Detach };
+
+    friend class LoopScheduler;
+};
+
+class LoopScheduler
+{
+public:
+    explicit LoopScheduler(uint8_t maxTasks = 8);
+    ~LoopScheduler();
+
+    bool add(ScheduledTask &task);
+    void remove(ScheduledTask &task);
+
+    uint8_t count() const { return _count; }
+
+    void loop();
+
+    static const unsigned long NoDeadline = 0xFFFFFFFFUL;
+
+    unsigned long timeUntilNext() const;
+
+private:
+    ScheduledTask **_tasks;
+    uint8_t _maxTasks;
+    uint8_t _count;
+    uint8_t _size;
+
+    static void changed(ScheduledTask *task);
+
+    void removeFromHeap(ScheduledTask *task);
+    void insertIntoHeap(ScheduledTask *task);
+    void swap(uint8_t index1, uint8_t index2);
+    bool before(uint8_t index1, uint8_t index2) const;
+    void siftUp(uint8_t index);
+    void siftDown(uint8_t index);
+};
+
+#endif
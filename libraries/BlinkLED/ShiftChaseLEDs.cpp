@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ShiftChaseLEDs.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \class ShiftChaseLEDs ShiftChaseLEDs.h <ShiftChaseLEDs.h>
+ * \brief Chase LED's that are connected to a chain of 74HC595 shift
+ * registers.
+ *
+ * ChaseLEDs needs one output pin for each LED, which limits the length
+ * of the chase.  This class instead drives a chain of 74HC595 shift
+ * registers from the hardware SPI port and a single latch pin, with
+ * 8 LED's on each register.  The state of the LED's is kept as a
+ * packed bit array and the whole chain is shifted out in one SPI burst
+ * by update(), so long chains can be updated thousands of times a second.
+ *
+ * The shift registers should be wired as follows:
+ *
+ * \li MOSI (D11 on an Arduino Uno) to DS of the first register in the chain.
+ * \li SCK (D13 on an Arduino Uno) to SH_CP of all registers.
+ * \li The latch pin to ST_CP of all registers.
+ * \li Q7' of each register to DS of the next register in the chain.
+ * \li OE of all registers to GND and MR of all registers to VCC.
+ *
+ * LED 0 is on output Q0 of the first register, LED 7 is on Q7 of the
+ * first register, LED 8 is on Q0 of the second register, and so on.
+ * The following example chases 64 LED's on 8 shift registers,
+ * latched from D10:
+ *
+ * \code
+ * #include <ShiftChaseLEDs.h>
+ *
+ * ShiftChaseLEDs chaser(10, 64, 20);
+ *
+ * void loop() {
+ *     chaser.loop();
+ * }
+ * \endcode
+ *
+ * The LED's can also be set directly with setLed() and then sent to
+ * the chain with update(), without using the chase.  Subclasses can
+ * override advance() to produce other effects in the same way as for
+ * ChaseLEDs.
+ *
+ * On AVR platforms this class takes over the SPI port in master mode,
+ * so it cannot be used at the same time as DMD.  On other platforms
+ * the bits are shifted out on the MOSI and SCK pins with shiftOut().
+ *
+ * \sa ChaseLEDs
+ */
+
+/**
+ * \brief Initializes a chain of shift registers for \a numLEDs LED's
+ * that are latched with \a latchPin.
+ *
+ * Each LED is lit for \a advanceTime milliseconds before advancing
+ * to the next LED.  All LED's are initially off, and the first LED
+ * will be lit when the program first calls loop().
+ */
+ShiftChaseLEDs::ShiftChaseLEDs(uint8_t latchPin, int numLEDs, unsigned long advanceTime)
+    : _count(numLEDs)
+    , _bytes((numLEDs + 7) / 8)
+    , _currentIndex(-1)
+    , _advanceTime(advanceTime)
+    , _lastChange(millis())
+{
+    _bits = (uint8_t *)malloc(_bytes);
+    memset(_bits, 0, _bytes);
+
+    // Look up the port register for the latch pin so that update()
+    // can latch the data without going through digitalWrite().
+    pinMode(latchPin, OUTPUT);
+    digitalWrite(latchPin, LOW);
+    _latchPort = portOutputRegister(digitalPinToPort(latchPin));
+    _latchMask = digitalPinToBitMask(latchPin);
+
+    pinMode(SCK, OUTPUT);
+    pinMode(MOSI, OUTPUT);
+    digitalWrite(SCK, LOW);
+    digitalWrite(MOSI, LOW);
+#if defined(__AVR__)
+    // Initialize SPI to MSB-first, mode 0, clock divider = 2.  SS must be
+    // an output or the SPI port may drop out of master mode.
+    pinMode(SS, OUTPUT);
+    SPCR |= _BV(MSTR);
+    SPCR |= _BV(SPE);
+    SPCR &= ~(_BV(DORD));   // MSB-first
+    SPCR &= ~0x0C;          // Mode 0
+    SPCR &= ~0x03;          // Clock divider rate 2
+    SPSR |= 0x01;           // MSB of clock divider rate
+#endif
+
+    update();
+}
+
+/**
+ * \brief Destroys this LED chaser.
+ */
+ShiftChaseLEDs::~ShiftChaseLEDs()
+{
+    free(_bits);
+}
+
+/**
+ * \fn int ShiftChaseLEDs::count() const
+ * \brief Returns the number of LED's in the chain.
+ */
+
+/**
+ * \fn bool ShiftChaseLEDs::led(int index) const
+ * \brief Returns true if the LED at \a index is on; false otherwise.
+ *
+ * \sa setLed()
+ */
+
+/**
+ * \brief Sets the LED at \a index to \a value, where true is on.
+ *
+ * The change will not be visible until the next call to update().
+ *
+ * \sa led(), clear(), update()
+ */
+void ShiftChaseLEDs::setLed(int index, bool value)
+{
+    uint8_t mask = 1 << (index & 7);
+    if (value)
+        _bits[index >> 3] |= mask;
+    else
+        _bits[index >> 3] &= ~mask;
+}
+
+/**
+ * \brief Turns off all LED's.
+ *
+ * The change will not be visible until the next call to update().
+ *
+ * \sa setLed(), update()
+ */
+void ShiftChaseLEDs::clear()
+{
+    memset(_bits, 0, _bytes);
+}
+
+/**
+ * \brief Shifts the current LED states out to the chain of registers
+ * and latches them onto the outputs.
+ *
+ * The byte for the last register in the chain is sent first so that
+ * it is shifted all the way along the chain.
+ *
+ * \sa setLed()
+ */
+void ShiftChaseLEDs::update()
+{
+    const uint8_t *data = _bits + _bytes;
+#if defined(__AVR__)
+    int bytes = _bytes;
+    if (bytes > 0) {
+        // Fetch the next byte while the previous byte is being sent.
+        SPDR = *(--data);
+        while (--bytes > 0) {
+            uint8_t value = *(--data);
+            while (!(SPSR & _BV(SPIF)))
+                ;   // Wait for the previous transfer to complete.
+            SPDR = value;
+        }
+        while (!(SPSR & _BV(SPIF)))
+            ;   // Wait for the last transfer to complete.
+    }
+#else
+    for (int bytes = _bytes; bytes > 0; --bytes)
+        shiftOut(MOSI, SCK, MSBFIRST, *(--data));
+#endif
+    *_latchPort |= _latchMask;
+    *_latchPort &= ~_latchMask;
+}
+
+/**
+ * \brief Performs a single iteration of the control loop for this
+ * LED chaser.
+ *
+ * When it is time to advance, this calls advance() and then update().
+ */
+void ShiftChaseLEDs::loop()
+{
+    if (_count <= 0)
+        return;
+    if (_currentIndex >= 0) {
+        if ((millis() - _lastChange) >= _advanceTime) {
+            // Advance to the next LED in sequence.
+            _currentIndex = (_currentIndex + 1) % _count;
+            _lastChange += _advanceTime;
+            advance(previousIndex(1), _currentIndex);
+            update();
+        }
+    } else {
+        // First time - light the first LED.
+        _currentIndex = 0;
+        _lastChange = millis();
+        advance(previousIndex(1), _currentIndex);
+        update();
+    }
+}
+
+/**
+ * \fn unsigned long ShiftChaseLEDs::advanceTime() const
+ * \brief Returns the number of milliseconds that each LED will be
+ * lit in the chase sequence.
+ *
+ * \sa setAdvanceTime(), advance()
+ */
+
+/**
+ * \fn void ShiftChaseLEDs::setAdvanceTime(unsigned long advanceTime)
+ * \brief Sets the number of milliseconds to advance between LED's to
+ * \a advanceTime.
+ *
+ * \sa advanceTime(), advance()
+ */
+
+/**
+ * \brief Advances to the next LED in sequence, turning off \a prevIndex,
+ * and turning on \a nextIndex.
+ *
+ * The default implementation is equivalent to the following code:
+ *
+ * \code
+ * setLed(prevIndex, false);
+ * setLed(nextIndex, true);
+ * \endcode
+ *
+ * This method may be overridden in subclasses to provide special effects.
+ * The LED's are sent to the chain with update() after this returns.
+ *
+ * \sa previousIndex()
+ */
+void ShiftChaseLEDs::advance(int prevIndex, int nextIndex)
+{
+    setLed(prevIndex, false);
+    setLed(nextIndex, true);
+}
+
+/**
+ * \fn int ShiftChaseLEDs::previousIndex(int n) const
+ * \brief Returns the index of the LED that is \a n steps back in the
+ * sequence.
+ *
+ * If \a n is zero, then the current LED is returned; if \a n is 1,
+ * then the previous LED is returned; and so on.
+ *
+ * \sa advance()
+ */
+
+/**
+ * \brief Dispatches the control loop for this LED chaser from a
+ * LoopScheduler.
+ */
+void ShiftChaseLEDs::dispatch()
+{
+    loop();
+    reschedule();
+}
+
+/**
+ * \internal
+ * \brief Sets the scheduler deadline for the next advance.
+ */
+void ShiftChaseLEDs::reschedule()
+{
+    if (scheduler() && _currentIndex >= 0)
+        scheduleAt(_lastChange + _advanceTime);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ShiftChaseLEDs_h
+#define ShiftChaseLEDs_h
+
+#include <inttypes.h>
+#include "LoopScheduler.h"
+
+class ShiftChaseLEDs : public ScheduledTask
+{
+public:
+    ShiftChaseLEDs(uint8_t latchPin, int numLEDs, unsigned long advanceTime);
+    ~ShiftChaseLEDs();
+
+    int count() const { return _count; }
+
+    bool led(int index) const
+        { return (_bits[index >> 3] & (1 << (index & 7))) != 0; }
+    void setLed(int index, bool value);
+    void clear();
+
+    void update();
+
+    void loop();
+
+    unsigned long advanceTime() const { return _advanceTime; }
+    void setAdvanceTime(unsigned long advanceTime)
+        { _advanceTime = advanceTime; reschedule(); }
+
+protected:
+    virtual void advance(int prevIndex, int nextIndex);
+    int previousIndex(int n) const
+        { return (_currentIndex + _count - (n % _count)) % _count; }
+    void dispatch();
+
+private:
+    uint8_t *_bits;
+    int _count;
+    int _bytes;
+    int _currentIndex;
+    unsigned long _advanceTime;
+    unsigned long _lastChange;
+    volatile uint8_t *_latchPort;
+    uint8_t _latchMask;
+
+    void reschedule();
+};
+
+#endif
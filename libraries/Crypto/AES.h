@@ -24,17 +24,62 @@
 #define CRYPTO_AES_h
 
 #include "BlockCipher.h"
+#include "CryptoConfig.h"
+
+// Use the 32-bit column-oriented implementation of the rounds on
+// platforms other than AVR, which are assumed to have 32-bit registers.
+#if !defined(CRYPTO_AES_WORD)
+#if defined(__AVR__)
+#define CRYPTO_AES_WORD 0
+#else
+#define CRYPTO_AES_WORD 1
+#endif
+#endif
+
+// Use the AES instructions on x86 and ARMv8 processors, or the AES
+// peripheral on ESP32, when they are available.  Set to 0 to always
+// use the portable code.
+#if !defined(CRYPTO_AES_HW)
+#define CRYPTO_AES_HW 1
+#endif
+
+// Decrypt with the "equivalent inverse cipher" and a 1K table that combines
+// InvSubBytes with InvMixColumns.  This needs an extra copy of the middle
+// round keys, so AVR only uses it when the speed profile is selected.
+#if !defined(CRYPTO_AES_INVERSE_TABLE)
+#if defined(__AVR__) && !CRYPTO_OPTIMIZE_SPEED
+#define CRYPTO_AES_INVERSE_TABLE 0
+#else
+#define CRYPTO_AES_INVERSE_TABLE 1
+#endif
+#endif
+
+class AESSmall128;
+class AESSmall256;
 
 class AESCommon : public BlockCipher
 {
 public:
     virtual ~AESCommon();
 
+    enum Implementation
+    {
+        Byte,
+        Word,
+        Hardware
+    };
+
+    static Implementation implementation();
+    static bool setImplementation(Implementation impl);
+
     size_t blockSize() const;
 
     void encryptBlock(uint8_t *output, const uint8_t *input);
     void decryptBlock(uint8_t *output, const uint8_t *input);
 
+    void encryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks);
+    void decryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks);
+
     void clear();
 
 protected:
@@ -43,14 +88,40 @@ protected:
     /** @cond */
     uint8_t rounds;
     uint8_t *schedule;
+#if CRYPTO_AES_INVERSE_TABLE
+    uint8_t *inverseSchedule;
+    bool inverseReady;
+
+    void expandInverseSchedule();
+#endif
 
-    void keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t iteration);
-    void applySbox(uint8_t *output, const uint8_t *input);
+    static void subBytesAndShiftRows(uint8_t *output, const uint8_t *input);
+    static void inverseShiftRowsAndSubBytes(uint8_t *output, const uint8_t *input);
+    static void mixColumn(uint8_t *output, uint8_t *input);
+    static void inverseMixColumn(uint8_t *output, const uint8_t *input);
+
+    static void keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t iteration);
+    static void applySbox(uint8_t *output, const uint8_t *input);
+
+    static void encryptBlockBytes(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input,
+                                  uint8_t *state1, uint8_t *state2);
+    static void decryptBlockBytes(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input,
+                                  uint8_t *state1, uint8_t *state2);
+#if CRYPTO_AES_INVERSE_TABLE
+    void decryptBlockTable(uint8_t *output, const uint8_t *input);
+#endif
+
+    friend class AESSmall128;
+    friend class AESSmall256;
     /** @endcond */
 
+#if !CRYPTO_AES_WORD
 private:
     uint8_t state1[16];
     uint8_t state2[16];
+#endif
 };
 
 class AES128 : public AESCommon
@@ -65,6 +136,9 @@ public:
 
 private:
     uint8_t sched[176];
+#if CRYPTO_AES_INVERSE_TABLE
+    uint8_t isched[144];
+#endif
 };
 
 class AES192 : public AESCommon
@@ -79,6 +153,9 @@ public:
 
 private:
     uint8_t sched[208];
+#if CRYPTO_AES_INVERSE_TABLE
+    uint8_t isched[176];
+#endif
 };
 
 class AES256 : public AESCommon
@@ -93,6 +170,52 @@ public:
 
 private:
     uint8_t sched[240];
+#if CRYPTO_AES_INVERSE_TABLE
+    uint8_t isched[208];
+#endif
+};
+
+class AESSmall128 : public BlockCipher
+{
+public:
+    AESSmall128();
+    virtual ~AESSmall128();
+
+    size_t blockSize() const;
+    size_t keySize() const;
+
+    bool setKey(const uint8_t *key, size_t len);
+
+    void encryptBlock(uint8_t *output, const uint8_t *input);
+    void decryptBlock(uint8_t *output, const uint8_t *input);
+
+    void clear();
+
+private:
+    uint8_t k[16];
+};
+
+class AESSmall256 : public BlockCipher
+{
+public:
+    AESSmall256();
+    virtual ~AESSmall256();
+
+    size_t blockSize() const;
+    size_t keySize() const;
+
+    bool setKey(const uint8_t *key, size_t len);
+
+    void encryptBlock(uint8_t *output, const uint8_t *input);
+    void decryptBlock(uint8_t *output, const uint8_t *input);
+
+    void clear();
+
+private:
+    uint8_t k[32];
+
+    static void nextKey(uint8_t *schedule, uint8_t iteration);
+    static void previousKey(uint8_t *schedule, uint8_t iteration);
 };
 
 #endif
@@ -41,11 +41,17 @@ AES128::AES128()
 {
     rounds = 10;
     schedule = sched;
+#if CRYPTO_AES_INVERSE_TABLE
+    inverseSchedule = isched;
+#endif
 }
 
 AES128::~AES128()
 {
     clean(sched);
+#if CRYPTO_AES_INVERSE_TABLE
+    clean(isched);
+#endif
 }
 
 /**
@@ -62,6 +68,11 @@ bool AES128::setKey(const uint8_t *key, size_t len)
     if (len != 16)
         return false;
 
+#if CRYPTO_AES_INVERSE_TABLE
+    // The decryption schedule is expanded again on the next decryptBlock().
+    inverseReady = false;
+#endif
+
     // Copy the key itself into the first 16 bytes of the schedule.
     uint8_t *schedule = sched;
     memcpy(schedule, key, 16);
@@ -41,11 +41,17 @@ AES192::AES192()
 {
     rounds = 12;
     schedule = sched;
+#if CRYPTO_AES_INVERSE_TABLE
+    inverseSchedule = isched;
+#endif
 }
 
 AES192::~AES192()
 {
     clean(sched);
+#if CRYPTO_AES_INVERSE_TABLE
+    clean(isched);
+#endif
 }
 
 /**
@@ -62,6 +68,11 @@ bool AES192::setKey(const uint8_t *key, size_t len)
     if (len != 24)
         return false;
 
+#if CRYPTO_AES_INVERSE_TABLE
+    // The decryption schedule is expanded again on the next decryptBlock().
+    inverseReady = false;
+#endif
+
     // Copy the key itself into the first 24 bytes of the schedule.
     uint8_t *schedule = sched;
     memcpy(schedule, key, 24);
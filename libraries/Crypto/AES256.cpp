@@ -41,11 +41,17 @@ AES256::AES256()
 {
     rounds = 14;
     schedule = sched;
+#if CRYPTO_AES_INVERSE_TABLE
+    inverseSchedule = isched;
+#endif
 }
 
 AES256::~AES256()
 {
     clean(sched);
+#if CRYPTO_AES_INVERSE_TABLE
+    clean(isched);
+#endif
 }
 
 /**
@@ -62,6 +68,11 @@ bool AES256::setKey(const uint8_t *key, size_t len)
     if (len != 32)
         return false;
 
+#if CRYPTO_AES_INVERSE_TABLE
+    // The decryption schedule is expanded again on the next decryptBlock().
+    inverseReady = false;
+#endif
+
     // Copy the key itself into the first 32 bytes of the schedule.
     uint8_t *schedule = sched;
     memcpy(schedule, key, 32);
@@ -23,6 +23,25 @@
 #include "AES.h"
 #include "Crypto.h"
 #include "utility/ProgMemUtil.h"
+#include "utility/EndianUtil.h"
+#include "utility/CpuFeatureUtil.h"
+#include <string.h>
+
+#if CRYPTO_AES_HW && CRYPTO_X86_AES_NI
+#include <wmmintrin.h>
+#define AES_HW_X86 1
+#elif CRYPTO_AES_HW && CRYPTO_ARM_AES_EXT
+#include <arm_neon.h>
+#define AES_HW_ARM 1
+#elif CRYPTO_AES_HW && defined(ESP32) && defined(__has_include)
+#if __has_include("aes/esp_aes.h")
+#include "aes/esp_aes.h"
+#define AES_HW_ESP32 1
+#elif __has_include("hwcrypto/aes.h")
+#include "hwcrypto/aes.h"
+#define AES_HW_ESP32 1
+#endif
+#endif
 
 /**
  * \class AESCommon AES.h <AES.h>
@@ -38,6 +57,26 @@
  * and decryption operations.  Unless AES compatibility is required,
  * it is recommended that the ChaCha stream cipher be used instead.
  *
+ * On platforms other than AVR, the rounds operate on 32-bit columns,
+ * with ShiftRows, MixColumns, and AddRoundKey performed on whole words.
+ * The S-box is still a 256-byte table lookup, so the note above applies
+ * equally to both implementations.  Large "T-tables" are not used as they
+ * would make the cache behaviour worse.  Define CRYPTO_AES_WORD to 0 to
+ * use the byte-oriented implementation on all platforms.
+ *
+ * On x86 processors with AES-NI, and on ARMv8 processors when the crypto
+ * extensions are enabled at compile time, the rounds are performed with
+ * the processor's AES instructions instead.  These do not use table
+ * lookups and so do not have the cache timing issue described above.
+ * The x86 support is detected at runtime.  On ESP32, the blocks are
+ * passed to the on-chip AES peripheral.  The key schedule that is
+ * created by setKey() is the same in all cases.  Define CRYPTO_AES_HW
+ * to 0 to always use the portable implementation.
+ *
+ * The implementation can also be changed at runtime with
+ * setImplementation(), so that the TestAES example can check and
+ * benchmark all of them in a single run.
+ *
  * Reference: http://en.wikipedia.org/wiki/Advanced_Encryption_Standard
  *
  * \sa ChaCha, AES128, AES192, AES256
@@ -45,7 +84,8 @@
 
 /** @cond */
 
-// AES S-box (http://en.wikipedia.org/wiki/Rijndael_S-box)
+// AES S-box (http://en.wikipedia.org/wiki/Rijndael_S-box).
+// Table generated by gensbox.c
 static uint8_t const sbox[256] PROGMEM = {
     0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,     // 0x00
     0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
@@ -81,7 +121,8 @@ static uint8_t const sbox[256] PROGMEM = {
     0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
 };
 
-// AES inverse S-box (http://en.wikipedia.org/wiki/Rijndael_S-box)
+// AES inverse S-box (http://en.wikipedia.org/wiki/Rijndael_S-box).
+// Table generated by gensbox.c
 static uint8_t const sbox_inverse[256] PROGMEM = {
     0x52, 0x09, 0x6A, 0xD5, 0x30, 0x36, 0xA5, 0x38,     // 0x00
     0xBF, 0x40, 0xA3, 0x9E, 0x81, 0xF3, 0xD7, 0xFB,
@@ -117,6 +158,81 @@ static uint8_t const sbox_inverse[256] PROGMEM = {
     0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
 };
 
+#if CRYPTO_AES_INVERSE_TABLE
+
+// InvSubBytes combined with InvMixColumns for a byte in row 0 of a column:
+// the bytes of each entry are 14, 9, 13, and 11 times sbox_inverse[x],
+// starting with the low byte.  Rows 1, 2, and 3 use the same entry
+// rotated left by 8, 16, or 24 bits.
+static uint32_t const inverse_table[256] PROGMEM = {
+    0x50A7F451, 0x5365417E, 0xC3A4171A, 0x965E273A,     // 0x00
+    0xCB6BAB3B, 0xF1459D1F, 0xAB58FAAC, 0x9303E34B,
+    0x55FA3020, 0xF66D76AD, 0x9176CC88, 0x254C02F5,
+    0xFCD7E54F, 0xD7CB2AC5, 0x80443526, 0x8FA362B5,
+    0x495AB1DE, 0x671BBA25, 0x980EEA45, 0xE1C0FE5D,     // 0x10
+    0x02752FC3, 0x12F04C81, 0xA397468D, 0xC6F9D36B,
+    0xE75F8F03, 0x959C9215, 0xEB7A6DBF, 0xDA595295,
+    0x2D83BED4, 0xD3217458, 0x2969E049, 0x44C8C98E,
+    0x6A89C275, 0x78798EF4, 0x6B3E5899, 0xDD71B927,     // 0x20
+    0xB64FE1BE, 0x17AD88F0, 0x66AC20C9, 0xB43ACE7D,
+    0x184ADF63, 0x82311AE5, 0x60335197, 0x457F5362,
+    0xE07764B1, 0x84AE6BBB, 0x1CA081FE, 0x942B08F9,
+    0x58684870, 0x19FD458F, 0x876CDE94, 0xB7F87B52,     // 0x30
+    0x23D373AB, 0xE2024B72, 0x578F1FE3, 0x2AAB5566,
+    0x0728EBB2, 0x03C2B52F, 0x9A7BC586, 0xA50837D3,
+    0xF2872830, 0xB2A5BF23, 0xBA6A0302, 0x5C8216ED,
+    0x2B1CCF8A, 0x92B479A7, 0xF0F207F3, 0xA1E2694E,     // 0x40
+    0xCDF4DA65, 0xD5BE0506, 0x1F6234D1, 0x8AFEA6C4,
+    0x9D532E34, 0xA055F3A2, 0x32E18A05, 0x75EBF6A4,
+    0x39EC830B, 0xAAEF6040, 0x069F715E, 0x51106EBD,
+    0xF98A213E, 0x3D06DD96, 0xAE053EDD, 0x46BDE64D,     // 0x50
+    0xB58D5491, 0x055DC471, 0x6FD40604, 0xFF155060,
+    0x24FB9819, 0x97E9BDD6, 0xCC434089, 0x779ED967,
+    0xBD42E8B0, 0x888B8907, 0x385B19E7, 0xDBEEC879,
+    0x470A7CA1, 0xE90F427C, 0xC91E84F8, 0x00000000,     // 0x60
+    0x83868009, 0x48ED2B32, 0xAC70111E, 0x4E725A6C,
+    0xFBFF0EFD, 0x5638850F, 0x1ED5AE3D, 0x27392D36,
+    0x64D90F0A, 0x21A65C68, 0xD1545B9B, 0x3A2E3624,
+    0xB1670A0C, 0x0FE75793, 0xD296EEB4, 0x9E919B1B,     // 0x70
+    0x4FC5C080, 0xA220DC61, 0x694B775A, 0x161A121C,
+    0x0ABA93E2, 0xE52AA0C0, 0x43E0223C, 0x1D171B12,
+    0x0B0D090E, 0xADC78BF2, 0xB9A8B62D, 0xC8A91E14,
+    0x8519F157, 0x4C0775AF, 0xBBDD99EE, 0xFD607FA3,     // 0x80
+    0x9F2601F7, 0xBCF5725C, 0xC53B6644, 0x347EFB5B,
+    0x7629438B, 0xDCC623CB, 0x68FCEDB6, 0x63F1E4B8,
+    0xCADC31D7, 0x10856342, 0x40229713, 0x2011C684,
+    0x7D244A85, 0xF83DBBD2, 0x1132F9AE, 0x6DA129C7,     // 0x90
+    0x4B2F9E1D, 0xF330B2DC, 0xEC52860D, 0xD0E3C177,
+    0x6C16B32B, 0x99B970A9, 0xFA489411, 0x2264E947,
+    0xC48CFCA8, 0x1A3FF0A0, 0xD82C7D56, 0xEF903322,
+    0xC74E4987, 0xC1D138D9, 0xFEA2CA8C, 0x360BD498,     // 0xA0
+    0xCF81F5A6, 0x28DE7AA5, 0x268EB7DA, 0xA4BFAD3F,
+    0xE49D3A2C, 0x0D927850, 0x9BCC5F6A, 0x62467E54,
+    0xC2138DF6, 0xE8B8D890, 0x5EF7392E, 0xF5AFC382,
+    0xBE805D9F, 0x7C93D069, 0xA92DD56F, 0xB31225CF,     // 0xB0
+    0x3B99ACC8, 0xA77D1810, 0x6E639CE8, 0x7BBB3BDB,
+    0x097826CD, 0xF418596E, 0x01B79AEC, 0xA89A4F83,
+    0x656E95E6, 0x7EE6FFAA, 0x08CFBC21, 0xE6E815EF,
+    0xD99BE7BA, 0xCE366F4A, 0xD4099FEA, 0xD67CB029,     // 0xC0
+    0xAFB2A431, 0x31233F2A, 0x3094A5C6, 0xC066A235,
+    0x37BC4E74, 0xA6CA82FC, 0xB0D090E0, 0x15D8A733,
+    0x4A9804F1, 0xF7DAEC41, 0x0E50CD7F, 0x2FF69117,
+    0x8DD64D76, 0x4DB0EF43, 0x544DAACC, 0xDF0496E4,     // 0xD0
+    0xE3B5D19E, 0x1B886A4C, 0xB81F2CC1, 0x7F516546,
+    0x04EA5E9D, 0x5D358C01, 0x737487FA, 0x2E410BFB,
+    0x5A1D67B3, 0x52D2DB92, 0x335610E9, 0x1347D66D,
+    0x8C61D79A, 0x7A0CA137, 0x8E14F859, 0x893C13EB,     // 0xE0
+    0xEE27A9CE, 0x35C961B7, 0xEDE51CE1, 0x3CB1477A,
+    0x59DFD29C, 0x3F73F255, 0x79CE1418, 0xBF37C773,
+    0xEACDF753, 0x5BAAFD5F, 0x146F3DDF, 0x86DB4478,
+    0x81F3AFCA, 0x3EC468B9, 0x2C342438, 0x5F40A3C2,     // 0xF0
+    0x72C31D16, 0x0C25E2BC, 0x8B493C28, 0x41950DFF,
+    0x7101A839, 0xDEB30C08, 0x9CE4B4D8, 0x90C15664,
+    0x6184CB7B, 0x70B632D5, 0x745C6C48, 0x4257B8D0
+};
+
+#endif
+
 /** @endcond */
 
 /**
@@ -124,6 +240,9 @@ static uint8_t const sbox_inverse[256] PROGMEM = {
  */
 AESCommon::AESCommon()
     : rounds(0), schedule(0)
+#if CRYPTO_AES_INVERSE_TABLE
+    , inverseSchedule(0), inverseReady(false)
+#endif
 {
 }
 
@@ -133,8 +252,10 @@ AESCommon::AESCommon()
  */
 AESCommon::~AESCommon()
 {
+#if !CRYPTO_AES_WORD
     clean(state1);
     clean(state2);
+#endif
 }
 
 /**
@@ -146,6 +267,747 @@ size_t AESCommon::blockSize() const
     return 16;
 }
 
+#if defined(AES_HW_X86)
+
+/**
+ * \brief Encrypts a single block using the x86 AES-NI instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output ciphertext block.
+ * \param input The input plaintext block.
+ */
+__attribute__((target("aes,sse2")))
+static void encryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                           uint8_t *output, const uint8_t *input)
+{
+    const __m128i *roundKey = (const __m128i *)schedule;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)input),
+                              _mm_loadu_si128(roundKey));
+    for (uint8_t round = 1; round < rounds; ++round)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(roundKey + round));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(roundKey + rounds));
+    _mm_storeu_si128((__m128i *)output, s);
+}
+
+/**
+ * \brief Decrypts a single block using the x86 AES-NI instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output plaintext block.
+ * \param input The input ciphertext block.
+ *
+ * The middle round keys are put through InvMixColumns as they are
+ * loaded to get the "equivalent inverse cipher" form that AESDEC needs.
+ * This avoids storing a second copy of the key schedule.
+ */
+__attribute__((target("aes,sse2")))
+static void decryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                           uint8_t *output, const uint8_t *input)
+{
+    const __m128i *roundKey = (const __m128i *)schedule;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)input),
+                              _mm_loadu_si128(roundKey + rounds));
+    for (uint8_t round = rounds - 1; round > 0; --round) {
+        s = _mm_aesdec_si128
+            (s, _mm_aesimc_si128(_mm_loadu_si128(roundKey + round)));
+    }
+    s = _mm_aesdeclast_si128(s, _mm_loadu_si128(roundKey));
+    _mm_storeu_si128((__m128i *)output, s);
+}
+
+/**
+ * \brief Encrypts multiple blocks using the x86 AES-NI instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output ciphertext blocks.
+ * \param input The input plaintext blocks.
+ * \param nblocks The number of blocks to encrypt.
+ *
+ * Four blocks are encrypted at a time so that the latency of each AESENC
+ * instruction is hidden behind the instructions for the other blocks.
+ */
+__attribute__((target("aes,sse2")))
+static void encryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                            uint8_t *output, const uint8_t *input,
+                            size_t nblocks)
+{
+    const __m128i *roundKey = (const __m128i *)schedule;
+    __m128i s0, s1, s2, s3, k;
+    while (nblocks >= 4) {
+        k = _mm_loadu_si128(roundKey);
+        s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)input), k);
+        s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 16)), k);
+        s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 32)), k);
+        s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 48)), k);
+        for (uint8_t round = 1; round < rounds; ++round) {
+            k = _mm_loadu_si128(roundKey + round);
+            s0 = _mm_aesenc_si128(s0, k);
+            s1 = _mm_aesenc_si128(s1, k);
+            s2 = _mm_aesenc_si128(s2, k);
+            s3 = _mm_aesenc_si128(s3, k);
+        }
+        k = _mm_loadu_si128(roundKey + rounds);
+        _mm_storeu_si128((__m128i *)output, _mm_aesenclast_si128(s0, k));
+        _mm_storeu_si128((__m128i *)(output + 16), _mm_aesenclast_si128(s1, k));
+        _mm_storeu_si128((__m128i *)(output + 32), _mm_aesenclast_si128(s2, k));
+        _mm_storeu_si128((__m128i *)(output + 48), _mm_aesenclast_si128(s3, k));
+        output += 64;
+        input += 64;
+        nblocks -= 4;
+    }
+    while (nblocks > 0) {
+        encryptBlockHW(schedule, rounds, output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+/**
+ * \brief Decrypts multiple blocks using the x86 AES-NI instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output plaintext blocks.
+ * \param input The input ciphertext blocks.
+ * \param nblocks The number of blocks to decrypt.
+ *
+ * Four blocks are decrypted at a time, which also means that each
+ * InvMixColumns transformation of a round key is shared by four blocks.
+ */
+__attribute__((target("aes,sse2")))
+static void decryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                            uint8_t *output, const uint8_t *input,
+                            size_t nblocks)
+{
+    const __m128i *roundKey = (const __m128i *)schedule;
+    __m128i s0, s1, s2, s3, k;
+    while (nblocks >= 4) {
+        k = _mm_loadu_si128(roundKey + rounds);
+        s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)input), k);
+        s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 16)), k);
+        s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 32)), k);
+        s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(input + 48)), k);
+        for (uint8_t round = rounds - 1; round > 0; --round) {
+            k = _mm_aesimc_si128(_mm_loadu_si128(roundKey + round));
+            s0 = _mm_aesdec_si128(s0, k);
+            s1 = _mm_aesdec_si128(s1, k);
+            s2 = _mm_aesdec_si128(s2, k);
+            s3 = _mm_aesdec_si128(s3, k);
+        }
+        k = _mm_loadu_si128(roundKey);
+        _mm_storeu_si128((__m128i *)output, _mm_aesdeclast_si128(s0, k));
+        _mm_storeu_si128((__m128i *)(output + 16), _mm_aesdeclast_si128(s1, k));
+        _mm_storeu_si128((__m128i *)(output + 32), _mm_aesdeclast_si128(s2, k));
+        _mm_storeu_si128((__m128i *)(output + 48), _mm_aesdeclast_si128(s3, k));
+        output += 64;
+        input += 64;
+        nblocks -= 4;
+    }
+    while (nblocks > 0) {
+        decryptBlockHW(schedule, rounds, output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+#elif defined(AES_HW_ARM)
+
+/**
+ * \brief Encrypts a single block using the ARMv8 AES instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output ciphertext block.
+ * \param input The input plaintext block.
+ *
+ * AESE performs AddRoundKey before SubBytes and ShiftRows, so the round
+ * key sequence is offset by one compared with the x86 instructions.
+ */
+static void encryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                           uint8_t *output, const uint8_t *input)
+{
+    uint8x16_t s = vld1q_u8(input);
+    for (uint8_t round = 0; round < (rounds - 1); ++round)
+        s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(schedule + round * 16)));
+    s = vaeseq_u8(s, vld1q_u8(schedule + (rounds - 1) * 16));
+    s = veorq_u8(s, vld1q_u8(schedule + rounds * 16));
+    vst1q_u8(output, s);
+}
+
+/**
+ * \brief Decrypts a single block using the ARMv8 AES instructions.
+ *
+ * \param schedule The expanded key schedule.
+ * \param rounds The number of rounds for the key size.
+ * \param output The output plaintext block.
+ * \param input The input ciphertext block.
+ */
+static void decryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                           uint8_t *output, const uint8_t *input)
+{
+    uint8x16_t s = vld1q_u8(input);
+    s = vaesimcq_u8(vaesdq_u8(s, vld1q_u8(schedule + rounds * 16)));
+    for (uint8_t round = rounds - 1; round > 1; --round) {
+        s = vaesimcq_u8(vaesdq_u8
+            (s, vaesimcq_u8(vld1q_u8(schedule + round * 16))));
+    }
+    s = vaesdq_u8(s, vaesimcq_u8(vld1q_u8(schedule + 16)));
+    s = veorq_u8(s, vld1q_u8(schedule));
+    vst1q_u8(output, s);
+}
+
+static void encryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                            uint8_t *output, const uint8_t *input,
+                            size_t nblocks)
+{
+    while (nblocks > 0) {
+        encryptBlockHW(schedule, rounds, output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+static void decryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                            uint8_t *output, const uint8_t *input,
+                            size_t nblocks)
+{
+    while (nblocks > 0) {
+        decryptBlockHW(schedule, rounds, output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+#elif defined(AES_HW_ESP32)
+
+// The first 16, 24, or 32 bytes of the key schedule are the original key,
+// which is what the peripheral driver needs.  The driver loads the key
+// into the peripheral itself on each call.
+static void cryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                          uint8_t *output, const uint8_t *input,
+                          size_t nblocks, int mode)
+{
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, schedule, (rounds - 6) * 32);
+    while (nblocks > 0) {
+        esp_aes_crypt_ecb(&ctx, mode, input, output);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+    esp_aes_free(&ctx);
+}
+
+static inline void encryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input)
+{
+    cryptBlocksHW(schedule, rounds, output, input, 1, ESP_AES_ENCRYPT);
+}
+
+static inline void decryptBlockHW(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input)
+{
+    cryptBlocksHW(schedule, rounds, output, input, 1, ESP_AES_DECRYPT);
+}
+
+static inline void encryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                                   uint8_t *output, const uint8_t *input,
+                                   size_t nblocks)
+{
+    cryptBlocksHW(schedule, rounds, output, input, nblocks, ESP_AES_ENCRYPT);
+}
+
+static inline void decryptBlocksHW(const uint8_t *schedule, uint8_t rounds,
+                                   uint8_t *output, const uint8_t *input,
+                                   size_t nblocks)
+{
+    cryptBlocksHW(schedule, rounds, output, input, nblocks, ESP_AES_DECRYPT);
+}
+
+static inline bool cpuHasAesExt()
+{
+    return true;
+}
+
+#endif
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM) || defined(AES_HW_ESP32)
+#define AES_HW 1
+#endif
+
+// Implementation that was selected with AESCommon::setImplementation().
+#if defined(AES_HW)
+static uint8_t selected = AESCommon::Hardware;
+#elif CRYPTO_AES_WORD
+static uint8_t selected = AESCommon::Word;
+#else
+static uint8_t selected = AESCommon::Byte;
+#endif
+
+#if defined(AES_HW)
+static inline bool useHardware()
+{
+    return selected == AESCommon::Hardware && cpuHasAesExt();
+}
+#endif
+
+#if CRYPTO_AES_WORD || CRYPTO_AES_INVERSE_TABLE
+
+// Load and store columns and round keys.  Byte 0 of a column is in
+// the low 8 bits of the word.
+static inline uint32_t loadColumn(const uint8_t *data)
+{
+    uint32_t x;
+    memcpy(&x, data, 4);
+    return le32toh(x);
+}
+static inline void storeColumn(uint8_t *data, uint32_t x)
+{
+    x = htole32(x);
+    memcpy(data, &x, 4);
+}
+
+// Apply an S-box to the four bytes of a column after selecting them
+// from the columns a, b, c, and d according to ShiftRows.
+#define SBOX4(table, a, b, c, d) \
+    (((uint32_t)pgm_read_byte((table) + ((a) & 0xFF))) | \
+     (((uint32_t)pgm_read_byte((table) + (((b) >> 8) & 0xFF))) << 8) | \
+     (((uint32_t)pgm_read_byte((table) + (((c) >> 16) & 0xFF))) << 16) | \
+     (((uint32_t)pgm_read_byte((table) + ((d) >> 24))) << 24))
+
+#endif
+
+#if CRYPTO_AES_WORD
+
+// Multiply each of the four bytes in a word by 2 in the Galois field.
+#define gmul2w(x)   ((((x) & 0x7F7F7F7FU) << 1) ^ ((((x) >> 7) & 0x01010101U) * 0x1B))
+
+// Rotate a column word right by 8 or 16 bits.
+#define rotr8(x)    (((x) >> 8) | ((x) << 24))
+#define rotr16(x)   (((x) >> 16) | ((x) << 16))
+
+// MixColumns on a single column word: the result for each byte is
+// 2 * (a ^ b) ^ b ^ c ^ d where a is the byte and b, c, d follow it.
+static inline uint32_t mixColumnWord(uint32_t x)
+{
+    uint32_t t = x ^ rotr8(x);
+    return gmul2w(t) ^ x ^ t ^ rotr16(t);
+}
+
+// InvMixColumns is MixColumns after adding 4 * (a ^ c) to a and c,
+// and 4 * (b ^ d) to b and d.
+static inline uint32_t inverseMixColumnWord(uint32_t x)
+{
+    uint32_t t = x ^ rotr16(x);
+    t = gmul2w(t);
+    t = gmul2w(t);
+    return mixColumnWord(x ^ t);
+}
+
+// Encrypts a block with the 32-bit column-oriented rounds.
+static inline void encryptBlockWord(const uint8_t *schedule, uint8_t rounds,
+                                    uint8_t *output, const uint8_t *input)
+{
+    const uint8_t *roundKey = schedule;
+    uint32_t s0, s1, s2, s3;
+    uint32_t t0, t1, t2, t3;
+    uint8_t round;
+
+    // Load the input and XOR with the first round key.
+    s0 = loadColumn(input)      ^ loadColumn(roundKey);
+    s1 = loadColumn(input + 4)  ^ loadColumn(roundKey + 4);
+    s2 = loadColumn(input + 8)  ^ loadColumn(roundKey + 8);
+    s3 = loadColumn(input + 12) ^ loadColumn(roundKey + 12);
+    roundKey += 16;
+
+    // Perform all rounds except the last.
+    for (round = rounds; round > 1; --round) {
+        t0 = SBOX4(sbox, s0, s1, s2, s3);
+        t1 = SBOX4(sbox, s1, s2, s3, s0);
+        t2 = SBOX4(sbox, s2, s3, s0, s1);
+        t3 = SBOX4(sbox, s3, s0, s1, s2);
+        s0 = mixColumnWord(t0) ^ loadColumn(roundKey);
+        s1 = mixColumnWord(t1) ^ loadColumn(roundKey + 4);
+        s2 = mixColumnWord(t2) ^ loadColumn(roundKey + 8);
+        s3 = mixColumnWord(t3) ^ loadColumn(roundKey + 12);
+        roundKey += 16;
+    }
+
+    // Perform the final round.
+    t0 = SBOX4(sbox, s0, s1, s2, s3);
+    t1 = SBOX4(sbox, s1, s2, s3, s0);
+    t2 = SBOX4(sbox, s2, s3, s0, s1);
+    t3 = SBOX4(sbox, s3, s0, s1, s2);
+    storeColumn(output,      t0 ^ loadColumn(roundKey));
+    storeColumn(output + 4,  t1 ^ loadColumn(roundKey + 4));
+    storeColumn(output + 8,  t2 ^ loadColumn(roundKey + 8));
+    storeColumn(output + 12, t3 ^ loadColumn(roundKey + 12));
+}
+
+#if !CRYPTO_AES_INVERSE_TABLE
+
+// Decrypts a block with the 32-bit column-oriented rounds.
+static inline void decryptBlockWord(const uint8_t *schedule, uint8_t rounds,
+                                    uint8_t *output, const uint8_t *input)
+{
+    const uint8_t *roundKey = schedule + rounds * 16;
+    uint32_t s0, s1, s2, s3;
+    uint32_t t0, t1, t2, t3;
+    uint8_t round;
+
+    // Load the input and reverse the final round.
+    t0 = loadColumn(input)      ^ loadColumn(roundKey);
+    t1 = loadColumn(input + 4)  ^ loadColumn(roundKey + 4);
+    t2 = loadColumn(input + 8)  ^ loadColumn(roundKey + 8);
+    t3 = loadColumn(input + 12) ^ loadColumn(roundKey + 12);
+    s0 = SBOX4(sbox_inverse, t0, t3, t2, t1);
+    s1 = SBOX4(sbox_inverse, t1, t0, t3, t2);
+    s2 = SBOX4(sbox_inverse, t2, t1, t0, t3);
+    s3 = SBOX4(sbox_inverse, t3, t2, t1, t0);
+
+    // Perform all other rounds in reverse.
+    for (round = rounds; round > 1; --round) {
+        roundKey -= 16;
+        t0 = inverseMixColumnWord(s0 ^ loadColumn(roundKey));
+        t1 = inverseMixColumnWord(s1 ^ loadColumn(roundKey + 4));
+        t2 = inverseMixColumnWord(s2 ^ loadColumn(roundKey + 8));
+        t3 = inverseMixColumnWord(s3 ^ loadColumn(roundKey + 12));
+        s0 = SBOX4(sbox_inverse, t0, t3, t2, t1);
+        s1 = SBOX4(sbox_inverse, t1, t0, t3, t2);
+        s2 = SBOX4(sbox_inverse, t2, t1, t0, t3);
+        s3 = SBOX4(sbox_inverse, t3, t2, t1, t0);
+    }
+
+    // Reverse the initial round and create the output words.
+    roundKey -= 16;
+    storeColumn(output,      s0 ^ loadColumn(roundKey));
+    storeColumn(output + 4,  s1 ^ loadColumn(roundKey + 4));
+    storeColumn(output + 8,  s2 ^ loadColumn(roundKey + 8));
+    storeColumn(output + 12, s3 ^ loadColumn(roundKey + 12));
+}
+
+#endif // !CRYPTO_AES_INVERSE_TABLE
+
+#endif // CRYPTO_AES_WORD
+
+// Encrypts a block with the byte-oriented rounds, using state1 and state2
+// as temporary buffers of 16 bytes each.
+void AESCommon::encryptBlockBytes(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input,
+                                  uint8_t *state1, uint8_t *state2)
+{
+    const uint8_t *roundKey = schedule;
+    uint8_t posn;
+    uint8_t round;
+
+    // Copy the input into the state and XOR with the first round key.
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ roundKey[posn];
+    roundKey += 16;
+
+    // Perform all rounds except the last.
+    for (round = rounds; round > 1; --round) {
+        subBytesAndShiftRows(state2, state1);
+        mixColumn(state1,      state2);
+        mixColumn(state1 + 4,  state2 + 4);
+        mixColumn(state1 + 8,  state2 + 8);
+        mixColumn(state1 + 12, state2 + 12);
+        for (posn = 0; posn < 16; ++posn)
+            state1[posn] ^= roundKey[posn];
+        roundKey += 16;
+    }
+
+    // Perform the final round.
+    subBytesAndShiftRows(state2, state1);
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ roundKey[posn];
+}
+
+#if CRYPTO_AES_WORD || !CRYPTO_AES_INVERSE_TABLE
+
+// Decrypts a block with the byte-oriented rounds, using state1 and state2
+// as temporary buffers of 16 bytes each.
+void AESCommon::decryptBlockBytes(const uint8_t *schedule, uint8_t rounds,
+                                  uint8_t *output, const uint8_t *input,
+                                  uint8_t *state1, uint8_t *state2)
+{
+    const uint8_t *roundKey = schedule + rounds * 16;
+    uint8_t round;
+    uint8_t posn;
+
+    // Copy the input into the state and reverse the final round.
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ roundKey[posn];
+    inverseShiftRowsAndSubBytes(state2, state1);
+
+    // Perform all other rounds in reverse.
+    for (round = rounds; round > 1; --round) {
+        roundKey -= 16;
+        for (posn = 0; posn < 16; ++posn)
+            state2[posn] ^= roundKey[posn];
+        inverseMixColumn(state1,      state2);
+        inverseMixColumn(state1 + 4,  state2 + 4);
+        inverseMixColumn(state1 + 8,  state2 + 8);
+        inverseMixColumn(state1 + 12, state2 + 12);
+        inverseShiftRowsAndSubBytes(state2, state1);
+    }
+
+    // Reverse the initial round and create the output words.
+    roundKey -= 16;
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ roundKey[posn];
+}
+
+#endif // CRYPTO_AES_WORD || !CRYPTO_AES_INVERSE_TABLE
+
+#if CRYPTO_AES_INVERSE_TABLE
+
+// Look up the combined InvSubBytes and InvMixColumns of the bytes of the
+// columns a, b, c, and d that InvShiftRows moves into a single column.
+#define rotl8i(x)   (((x) << 8) | ((x) >> 24))
+#define rotl16i(x)  (((x) << 16) | ((x) >> 16))
+#define rotl24i(x)  (((x) << 24) | ((x) >> 8))
+static inline uint32_t inverseRound(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t x0 = pgm_read_dword(inverse_table + (a & 0xFF));
+    uint32_t x1 = pgm_read_dword(inverse_table + ((b >> 8) & 0xFF));
+    uint32_t x2 = pgm_read_dword(inverse_table + ((c >> 16) & 0xFF));
+    uint32_t x3 = pgm_read_dword(inverse_table + (d >> 24));
+    return x0 ^ rotl8i(x1) ^ rotl16i(x2) ^ rotl24i(x3);
+}
+
+// Decrypts a block with the equivalent inverse cipher.
+void AESCommon::decryptBlockTable(uint8_t *output, const uint8_t *input)
+{
+    // Apply InvMixColumns to the middle round keys the first time
+    // that we decrypt with a new key.
+    if (!inverseReady)
+        expandInverseSchedule();
+
+    const uint8_t *roundKey = schedule + rounds * 16;
+    const uint8_t *inverseKey = inverseSchedule;
+    uint32_t s0, s1, s2, s3;
+    uint32_t t0, t1, t2, t3;
+    uint8_t round;
+
+    // Load the input and XOR with the last round key.
+    s0 = loadColumn(input)      ^ loadColumn(roundKey);
+    s1 = loadColumn(input + 4)  ^ loadColumn(roundKey + 4);
+    s2 = loadColumn(input + 8)  ^ loadColumn(roundKey + 8);
+    s3 = loadColumn(input + 12) ^ loadColumn(roundKey + 12);
+
+    // Perform all rounds except the last with the equivalent inverse
+    // cipher, which has the same structure as the encryption rounds.
+    for (round = rounds; round > 1; --round) {
+        t0 = inverseRound(s0, s3, s2, s1) ^ loadColumn(inverseKey);
+        t1 = inverseRound(s1, s0, s3, s2) ^ loadColumn(inverseKey + 4);
+        t2 = inverseRound(s2, s1, s0, s3) ^ loadColumn(inverseKey + 8);
+        t3 = inverseRound(s3, s2, s1, s0) ^ loadColumn(inverseKey + 12);
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+        inverseKey += 16;
+    }
+
+    // Perform the final round, which has no InvMixColumns step.
+    roundKey = schedule;
+    storeColumn(output,      SBOX4(sbox_inverse, s0, s3, s2, s1) ^ loadColumn(roundKey));
+    storeColumn(output + 4,  SBOX4(sbox_inverse, s1, s0, s3, s2) ^ loadColumn(roundKey + 4));
+    storeColumn(output + 8,  SBOX4(sbox_inverse, s2, s1, s0, s3) ^ loadColumn(roundKey + 8));
+    storeColumn(output + 12, SBOX4(sbox_inverse, s3, s2, s1, s0) ^ loadColumn(roundKey + 12));
+}
+
+#endif // CRYPTO_AES_INVERSE_TABLE
+
+void AESCommon::encryptBlock(uint8_t *output, const uint8_t *input)
+{
+#if defined(AES_HW)
+    if (useHardware()) {
+        encryptBlockHW(schedule, rounds, output, input);
+        return;
+    }
+#endif
+#if CRYPTO_AES_WORD
+    if (selected != Byte) {
+        encryptBlockWord(schedule, rounds, output, input);
+        return;
+    }
+    uint8_t state1[16];
+    uint8_t state2[16];
+    encryptBlockBytes(schedule, rounds, output, input, state1, state2);
+    clean(state1);
+    clean(state2);
+#else
+    encryptBlockBytes(schedule, rounds, output, input, state1, state2);
+#endif
+}
+
+void AESCommon::decryptBlock(uint8_t *output, const uint8_t *input)
+{
+#if defined(AES_HW)
+    if (useHardware()) {
+        decryptBlockHW(schedule, rounds, output, input);
+        return;
+    }
+#endif
+#if CRYPTO_AES_WORD
+    if (selected == Byte) {
+        uint8_t state1[16];
+        uint8_t state2[16];
+        decryptBlockBytes(schedule, rounds, output, input, state1, state2);
+        clean(state1);
+        clean(state2);
+        return;
+    }
+#endif
+#if CRYPTO_AES_INVERSE_TABLE
+    decryptBlockTable(output, input);
+#elif CRYPTO_AES_WORD
+    decryptBlockWord(schedule, rounds, output, input);
+#else
+    decryptBlockBytes(schedule, rounds, output, input, state1, state2);
+#endif
+}
+
+void AESCommon::encryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks)
+{
+#if defined(AES_HW)
+    if (useHardware()) {
+        encryptBlocksHW(schedule, rounds, output, input, nblocks);
+        return;
+    }
+#endif
+
+    // Call encryptBlock() directly rather than through the vtable so that
+    // the compiler can inline the rounds into the loop.
+    while (nblocks > 0) {
+        AESCommon::encryptBlock(output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+void AESCommon::decryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks)
+{
+#if defined(AES_HW)
+    if (useHardware()) {
+        decryptBlocksHW(schedule, rounds, output, input, nblocks);
+        return;
+    }
+#endif
+
+    while (nblocks > 0) {
+        AESCommon::decryptBlock(output, input);
+        output += 16;
+        input += 16;
+        --nblocks;
+    }
+}
+
+/**
+ * \enum AESCommon::Implementation
+ * \brief Implementation of the AES rounds that is used by AES128, AES192,
+ * and AES256.
+ *
+ * \sa implementation(), setImplementation()
+ */
+
+/**
+ * \var AESCommon::Byte
+ * \brief Byte-oriented rounds, which are the default on AVR.
+ */
+
+/**
+ * \var AESCommon::Word
+ * \brief 32-bit column-oriented rounds, which are the default on other
+ * platforms.  Decryption uses the equivalent inverse cipher when
+ * CRYPTO_AES_INVERSE_TABLE is enabled.
+ */
+
+/**
+ * \var AESCommon::Hardware
+ * \brief AES instructions or the on-chip AES peripheral, which are the
+ * default when they are available.
+ */
+
+/**
+ * \brief Returns the implementation of the AES rounds that is in use.
+ *
+ * \sa setImplementation()
+ */
+AESCommon::Implementation AESCommon::implementation()
+{
+#if defined(AES_HW)
+    if (selected == Hardware && !cpuHasAesExt())
+        return CRYPTO_AES_WORD ? Word : Byte;
+#endif
+    return (Implementation)selected;
+}
+
+/**
+ * \brief Selects the implementation of the AES rounds to use.
+ *
+ * \param impl The implementation to use.
+ * \return Returns false if \a impl is not available on this platform,
+ * in which case the previous implementation remains selected.
+ *
+ * The selection applies to all AES128, AES192, and AES256 objects.  It is
+ * intended for comparing the implementations in tests and benchmarks;
+ * normal applications should leave it at the default.  Byte is always
+ * available.  Word is available unless CRYPTO_AES_WORD is 0, and Hardware
+ * is available if the processor has AES support and CRYPTO_AES_HW is not 0.
+ *
+ * \sa implementation()
+ */
+bool AESCommon::setImplementation(Implementation impl)
+{
+    switch (impl) {
+    case Byte:
+        break;
+    case Word:
+        if (!CRYPTO_AES_WORD)
+            return false;
+        break;
+    case Hardware:
+#if defined(AES_HW)
+        if (!cpuHasAesExt())
+            return false;
+        break;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+    selected = impl;
+    return true;
+}
+
+void AESCommon::clear()
+{
+    clean(schedule, (rounds + 1) * 16);
+#if CRYPTO_AES_INVERSE_TABLE
+    clean(inverseSchedule, (rounds - 1) * 16);
+    inverseReady = false;
+#endif
+#if !CRYPTO_AES_WORD
+    clean(state1);
+    clean(state2);
+#endif
+}
+
+/** @cond */
+
 // Constants to correct Galois multiplication for the high bits
 // that are shifted out when multiplying by powers of two.
 static uint8_t const K[8] = {
@@ -181,7 +1043,7 @@ static uint8_t const K[8] = {
 #define OUT(col, row)   output[(col) * 4 + (row)]
 #define IN(col, row)    input[(col) * 4 + (row)]
 
-static void subBytesAndShiftRows(uint8_t *output, const uint8_t *input)
+void AESCommon::subBytesAndShiftRows(uint8_t *output, const uint8_t *input)
 {
     OUT(0, 0) = pgm_read_byte(sbox + IN(0, 0));
     OUT(0, 1) = pgm_read_byte(sbox + IN(1, 1));
@@ -201,7 +1063,7 @@ static void subBytesAndShiftRows(uint8_t *output, const uint8_t *input)
     OUT(3, 3) = pgm_read_byte(sbox + IN(2, 3));
 }
 
-static void inverseShiftRowsAndSubBytes(uint8_t *output, const uint8_t *input)
+void AESCommon::inverseShiftRowsAndSubBytes(uint8_t *output, const uint8_t *input)
 {
     OUT(0, 0) = pgm_read_byte(sbox_inverse + IN(0, 0));
     OUT(0, 1) = pgm_read_byte(sbox_inverse + IN(3, 1));
@@ -221,7 +1083,7 @@ static void inverseShiftRowsAndSubBytes(uint8_t *output, const uint8_t *input)
     OUT(3, 3) = pgm_read_byte(sbox_inverse + IN(0, 3));
 }
 
-static void mixColumn(uint8_t *output, uint8_t *input)
+void AESCommon::mixColumn(uint8_t *output, uint8_t *input)
 {
     uint16_t t; // Needed by the gmul2 macro.
     uint8_t a = input[0];
@@ -238,7 +1100,7 @@ static void mixColumn(uint8_t *output, uint8_t *input)
     output[3] = a2 ^ a ^ b ^ c ^ d2;
 }
 
-static void inverseMixColumn(uint8_t *output, const uint8_t *input)
+void AESCommon::inverseMixColumn(uint8_t *output, const uint8_t *input)
 {
     uint16_t t; // Needed by the gmul2, gmul4, and gmul8 macros.
     uint8_t a = input[0];
@@ -262,74 +1124,6 @@ static void inverseMixColumn(uint8_t *output, const uint8_t *input)
     output[2] = a8 ^ a4 ^ a ^ b8 ^ b ^ c8 ^ c4 ^ c2 ^ d8 ^ d2 ^ d;
     output[3] = a8 ^ a2 ^ a ^ b8 ^ b4 ^ b ^ c8 ^ c ^ d8 ^ d4 ^ d2;
 }
-
-void AESCommon::encryptBlock(uint8_t *output, const uint8_t *input)
-{
-    const uint8_t *roundKey = schedule;
-    uint8_t posn;
-    uint8_t round;
-
-    // Copy the input into the state and XOR with the first round key.
-    for (posn = 0; posn < 16; ++posn)
-        state1[posn] = input[posn] ^ roundKey[posn];
-    roundKey += 16;
-
-    // Perform all rounds except the last.
-    for (round = rounds; round > 1; --round) {
-        subBytesAndShiftRows(state2, state1);
-        mixColumn(state1,      state2);
-        mixColumn(state1 + 4,  state2 + 4);
-        mixColumn(state1 + 8,  state2 + 8);
-        mixColumn(state1 + 12, state2 + 12);
-        for (posn = 0; posn < 16; ++posn)
-            state1[posn] ^= roundKey[posn];
-        roundKey += 16;
-    }
-
-    // Perform the final round.
-    subBytesAndShiftRows(state2, state1);
-    for (posn = 0; posn < 16; ++posn)
-        output[posn] = state2[posn] ^ roundKey[posn];
-}
-
-void AESCommon::decryptBlock(uint8_t *output, const uint8_t *input)
-{
-    const uint8_t *roundKey = schedule + rounds * 16;
-    uint8_t round;
-    uint8_t posn;
-
-    // Copy the input into the state and reverse the final round.
-    for (posn = 0; posn < 16; ++posn)
-        state1[posn] = input[posn] ^ roundKey[posn];
-    inverseShiftRowsAndSubBytes(state2, state1);
-
-    // Perform all other rounds in reverse.
-    for (round = rounds; round > 1; --round) {
-        roundKey -= 16;
-        for (posn = 0; posn < 16; ++posn)
-            state2[posn] ^= roundKey[posn];
-        inverseMixColumn(state1,      state2);
-        inverseMixColumn(state1 + 4,  state2 + 4);
-        inverseMixColumn(state1 + 8,  state2 + 8);
-        inverseMixColumn(state1 + 12, state2 + 12);
-        inverseShiftRowsAndSubBytes(state2, state1);
-    }
-
-    // Reverse the initial round and create the output words.
-    roundKey -= 16;
-    for (posn = 0; posn < 16; ++posn)
-        output[posn] = state2[posn] ^ roundKey[posn];
-}
-
-void AESCommon::clear()
-{
-    clean(schedule, (rounds + 1) * 16);
-    clean(state1);
-    clean(state2);
-}
-
-/** @cond */
-
 void AESCommon::keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t iteration)
 {
     // Rcon(i), 2^i in the Rijndael finite field, for i = 0..10.
@@ -344,6 +1138,27 @@ void AESCommon::keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t i
     output[3] = pgm_read_byte(sbox + input[0]);
 }
 
+#if CRYPTO_AES_INVERSE_TABLE
+
+// Expands the decryption schedule for the equivalent inverse cipher by
+// applying InvMixColumns to the middle round keys, in reverse order.
+void AESCommon::expandInverseSchedule()
+{
+    uint8_t *output = inverseSchedule;
+    const uint8_t *roundKey = schedule + (rounds - 1) * 16;
+    for (uint8_t round = rounds - 1; round > 0; --round) {
+        inverseMixColumn(output,      roundKey);
+        inverseMixColumn(output + 4,  roundKey + 4);
+        inverseMixColumn(output + 8,  roundKey + 8);
+        inverseMixColumn(output + 12, roundKey + 12);
+        output += 16;
+        roundKey -= 16;
+    }
+    inverseReady = true;
+}
+
+#endif
+
 void AESCommon::applySbox(uint8_t *output, const uint8_t *input)
 {
     output[0] = pgm_read_byte(sbox + input[0]);
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "AES.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class AESSmall128 AES.h <AES.h>
+ * \brief AES block cipher with 128-bit keys and a small memory footprint.
+ *
+ * AES128 stores the full 176-byte expanded key schedule in the object.
+ * This class stores only the 16-byte key and expands the round keys
+ * on the fly, one at a time, as each block is encrypted or decrypted.
+ * The expansion and the rounds use temporary storage on the stack,
+ * so the object itself is much smaller at the cost of extra cycles
+ * on every block.  This is useful when several cipher objects must
+ * be kept in memory at once on devices with very little RAM.
+ *
+ * Decryption needs the round keys in reverse order, so it first expands
+ * forward to the last round key and then runs the key schedule backwards.
+ * Encryption is therefore cheaper than decryption with this class.
+ * Modes like CTR, CFB, OFB, and GCM only need encryption.
+ *
+ * The ciphertext is identical to that produced by AES128.
+ *
+ * \sa AES128, AESSmall256
+ */
+
+/**
+ * \brief Constructs an AES 128-bit block cipher with no initial key.
+ *
+ * This constructor must be followed by a call to setKey() before the
+ * block cipher can be used for encryption or decryption.
+ */
+AESSmall128::AESSmall128()
+{
+}
+
+AESSmall128::~AESSmall128()
+{
+    clean(k);
+}
+
+/**
+ * \brief Size of an AES block in bytes.
+ * \return Always returns 16.
+ */
+size_t AESSmall128::blockSize() const
+{
+    return 16;
+}
+
+/**
+ * \brief Size of a 128-bit AES key in bytes.
+ * \return Always returns 16.
+ */
+size_t AESSmall128::keySize() const
+{
+    return 16;
+}
+
+bool AESSmall128::setKey(const uint8_t *key, size_t len)
+{
+    if (len != 16)
+        return false;
+    memcpy(k, key, 16);
+    return true;
+}
+
+void AESSmall128::encryptBlock(uint8_t *output, const uint8_t *input)
+{
+    uint8_t schedule[16];
+    uint8_t state1[16];
+    uint8_t state2[16];
+    uint8_t temp[4];
+    uint8_t round;
+    uint8_t posn;
+
+    // Copy the input into the state and XOR with the first round key.
+    memcpy(schedule, k, 16);
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ schedule[posn];
+
+    for (round = 1; ; ++round) {
+        // Expand the key schedule to the round key for this round.
+        AESCommon::keyScheduleCore(temp, schedule + 12, round);
+        for (posn = 0; posn < 4; ++posn)
+            schedule[posn] ^= temp[posn];
+        for (posn = 4; posn < 16; ++posn)
+            schedule[posn] ^= schedule[posn - 4];
+
+        // The final round omits MixColumns.
+        AESCommon::subBytesAndShiftRows(state2, state1);
+        if (round == 10)
+            break;
+        AESCommon::mixColumn(state1,      state2);
+        AESCommon::mixColumn(state1 + 4,  state2 + 4);
+        AESCommon::mixColumn(state1 + 8,  state2 + 8);
+        AESCommon::mixColumn(state1 + 12, state2 + 12);
+        for (posn = 0; posn < 16; ++posn)
+            state1[posn] ^= schedule[posn];
+    }
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ schedule[posn];
+
+    clean(schedule);
+    clean(state1);
+    clean(state2);
+    clean(temp);
+}
+
+void AESSmall128::decryptBlock(uint8_t *output, const uint8_t *input)
+{
+    uint8_t schedule[16];
+    uint8_t state1[16];
+    uint8_t state2[16];
+    uint8_t temp[4];
+    uint8_t round;
+    uint8_t posn;
+
+    // Expand the key schedule forward to the last round key.
+    memcpy(schedule, k, 16);
+    for (round = 1; round <= 10; ++round) {
+        AESCommon::keyScheduleCore(temp, schedule + 12, round);
+        for (posn = 0; posn < 4; ++posn)
+            schedule[posn] ^= temp[posn];
+        for (posn = 4; posn < 16; ++posn)
+            schedule[posn] ^= schedule[posn - 4];
+    }
+
+    // Copy the input into the state and reverse the final round.
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ schedule[posn];
+    AESCommon::inverseShiftRowsAndSubBytes(state2, state1);
+
+    // Perform all other rounds in reverse, running the key schedule
+    // backwards to recover the round key for each.
+    for (round = 10; round > 1; --round) {
+        for (posn = 15; posn >= 4; --posn)
+            schedule[posn] ^= schedule[posn - 4];
+        AESCommon::keyScheduleCore(temp, schedule + 12, round);
+        for (posn = 0; posn < 4; ++posn)
+            schedule[posn] ^= temp[posn];
+
+        for (posn = 0; posn < 16; ++posn)
+            state2[posn] ^= schedule[posn];
+        AESCommon::inverseMixColumn(state1,      state2);
+        AESCommon::inverseMixColumn(state1 + 4,  state2 + 4);
+        AESCommon::inverseMixColumn(state1 + 8,  state2 + 8);
+        AESCommon::inverseMixColumn(state1 + 12, state2 + 12);
+        AESCommon::inverseShiftRowsAndSubBytes(state2, state1);
+    }
+
+    // The first round key is the original key.
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ k[posn];
+
+    clean(schedule);
+    clean(state1);
+    clean(state2);
+    clean(temp);
+}
+
+void AESSmall128::clear()
+{
+    clean(k);
+}
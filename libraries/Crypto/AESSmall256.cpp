@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "AES.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class AESSmall256 AES.h <AES.h>
+ * \brief AES block cipher with 256-bit keys and a small memory footprint.
+ *
+ * AES256 stores the full 240-byte expanded key schedule in the object.
+ * This class stores only the 32-byte key and expands the round keys
+ * on the fly as each block is encrypted or decrypted, trading extra
+ * cycles on every block for a much smaller object.
+ *
+ * Decryption first expands forward to the last round keys and then runs
+ * the key schedule backwards, so it is slower than encryption.  Modes like
+ * CTR, CFB, OFB, and GCM only need encryption.
+ *
+ * The ciphertext is identical to that produced by AES256.
+ *
+ * \sa AES256, AESSmall128
+ */
+
+/**
+ * \brief Constructs an AES 256-bit block cipher with no initial key.
+ *
+ * This constructor must be followed by a call to setKey() before the
+ * block cipher can be used for encryption or decryption.
+ */
+AESSmall256::AESSmall256()
+{
+}
+
+AESSmall256::~AESSmall256()
+{
+    clean(k);
+}
+
+/**
+ * \brief Size of an AES block in bytes.
+ * \return Always returns 16.
+ */
+size_t AESSmall256::blockSize() const
+{
+    return 16;
+}
+
+/**
+ * \brief Size of a 256-bit AES key in bytes.
+ * \return Always returns 32.
+ */
+size_t AESSmall256::keySize() const
+{
+    return 32;
+}
+
+bool AESSmall256::setKey(const uint8_t *key, size_t len)
+{
+    if (len != 32)
+        return false;
+    memcpy(k, key, 32);
+    return true;
+}
+
+void AESSmall256::encryptBlock(uint8_t *output, const uint8_t *input)
+{
+    uint8_t schedule[32];
+    uint8_t state1[16];
+    uint8_t state2[16];
+    const uint8_t *roundKey;
+    uint8_t round;
+    uint8_t posn;
+
+    // Copy the input into the state and XOR with the first round key.
+    memcpy(schedule, k, 32);
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ schedule[posn];
+
+    // Each step of the key schedule produces the next two round keys.
+    for (round = 1; ; ++round) {
+        if ((round & 1) == 0)
+            nextKey(schedule, round / 2);
+        roundKey = schedule + (round & 1) * 16;
+
+        // The final round omits MixColumns.
+        AESCommon::subBytesAndShiftRows(state2, state1);
+        if (round == 14)
+            break;
+        AESCommon::mixColumn(state1,      state2);
+        AESCommon::mixColumn(state1 + 4,  state2 + 4);
+        AESCommon::mixColumn(state1 + 8,  state2 + 8);
+        AESCommon::mixColumn(state1 + 12, state2 + 12);
+        for (posn = 0; posn < 16; ++posn)
+            state1[posn] ^= roundKey[posn];
+    }
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ roundKey[posn];
+
+    clean(schedule);
+    clean(state1);
+    clean(state2);
+}
+
+void AESSmall256::decryptBlock(uint8_t *output, const uint8_t *input)
+{
+    uint8_t schedule[32];
+    uint8_t state1[16];
+    uint8_t state2[16];
+    const uint8_t *roundKey;
+    uint8_t round;
+    uint8_t posn;
+
+    // Expand the key schedule forward to the last round key.
+    memcpy(schedule, k, 32);
+    for (round = 1; round <= 7; ++round)
+        nextKey(schedule, round);
+
+    // Copy the input into the state and reverse the final round.
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ schedule[posn];
+    AESCommon::inverseShiftRowsAndSubBytes(state2, state1);
+
+    // Perform all other rounds in reverse, running the key schedule
+    // backwards to recover the round keys two at a time.
+    for (round = 13; round > 0; --round) {
+        if (round & 1)
+            previousKey(schedule, (round + 1) / 2);
+        roundKey = schedule + (round & 1) * 16;
+        for (posn = 0; posn < 16; ++posn)
+            state2[posn] ^= roundKey[posn];
+        AESCommon::inverseMixColumn(state1,      state2);
+        AESCommon::inverseMixColumn(state1 + 4,  state2 + 4);
+        AESCommon::inverseMixColumn(state1 + 8,  state2 + 8);
+        AESCommon::inverseMixColumn(state1 + 12, state2 + 12);
+        AESCommon::inverseShiftRowsAndSubBytes(state2, state1);
+    }
+
+    // The first round key is the first half of the original key.
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state2[posn] ^ k[posn];
+
+    clean(schedule);
+    clean(state1);
+    clean(state2);
+}
+
+void AESSmall256::clear()
+{
+    clean(k);
+}
+
+/**
+ * \brief Advances a 32-byte window of the key schedule to the next
+ * two round keys.
+ *
+ * \param schedule The current two round keys, replaced with the next two.
+ * \param iteration The iteration number for the key schedule core.
+ */
+void AESSmall256::nextKey(uint8_t *schedule, uint8_t iteration)
+{
+    uint8_t temp[4];
+    uint8_t posn;
+    AESCommon::keyScheduleCore(temp, schedule + 28, iteration);
+    for (posn = 0; posn < 4; ++posn)
+        schedule[posn] ^= temp[posn];
+    for (posn = 4; posn < 16; ++posn)
+        schedule[posn] ^= schedule[posn - 4];
+    AESCommon::applySbox(temp, schedule + 12);
+    for (posn = 16; posn < 20; ++posn)
+        schedule[posn] ^= temp[posn - 16];
+    for (posn = 20; posn < 32; ++posn)
+        schedule[posn] ^= schedule[posn - 4];
+    clean(temp);
+}
+
+/**
+ * \brief Steps a 32-byte window of the key schedule back to the
+ * previous two round keys.
+ *
+ * \param schedule The current two round keys, replaced with the previous two.
+ * \param iteration The iteration number that was passed to nextKey()
+ * to produce the current round keys.
+ */
+void AESSmall256::previousKey(uint8_t *schedule, uint8_t iteration)
+{
+    uint8_t temp[4];
+    uint8_t posn;
+    for (posn = 31; posn >= 20; --posn)
+        schedule[posn] ^= schedule[posn - 4];
+    AESCommon::applySbox(temp, schedule + 12);
+    for (posn = 16; posn < 20; ++posn)
+        schedule[posn] ^= temp[posn - 16];
+    for (posn = 15; posn >= 4; --posn)
+        schedule[posn] ^= schedule[posn - 4];
+    AESCommon::keyScheduleCore(temp, schedule + 28, iteration);
+    for (posn = 0; posn < 4; ++posn)
+        schedule[posn] ^= temp[posn];
+    clean(temp);
+}
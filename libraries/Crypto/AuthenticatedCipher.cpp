@@ -21,6 +21,7 @@
  */
 
 #include "AuthenticatedCipher.h"
+#include "Crypto.h"
 
 /**
  * \class AuthenticatedCipher AuthenticatedCipher.h <AuthenticatedCipher.h>
@@ -93,6 +94,28 @@ AuthenticatedCipher::~AuthenticatedCipher()
  * single block for authentication purposes.
  */
 
+/**
+ * \brief Adds a list of buffer segments as extra data that will be
+ * authenticated but not encrypted.
+ *
+ * \param segments Points to the segments to be authenticated.
+ * \param count The number of segments in the list.
+ *
+ * This is equivalent to calling addAuthData() on each segment in turn.
+ * The same restrictions apply: this function must be called before the
+ * first call to encrypt(), decrypt(), encryptv(), or decryptv().
+ *
+ * \sa addAuthData(), encryptv()
+ */
+void AuthenticatedCipher::addAuthDatav(const CipherSegment *segments, size_t count)
+{
+    while (count > 0) {
+        addAuthData(segments->data, segments->len);
+        ++segments;
+        --count;
+    }
+}
+
 /**
  * \fn void AuthenticatedCipher::computeTag(void *tag, size_t len)
  * \brief Finalizes the encryption process and computes the authentication tag.
@@ -128,3 +151,78 @@ AuthenticatedCipher::~AuthenticatedCipher()
  *
  * \sa computeTag()
  */
+
+/**
+ * \brief Encrypts and authenticates a complete packet in one call.
+ *
+ * \param output The output buffer for the ciphertext, which may be the
+ * same as \a input.  Must be at least \a len bytes in size.
+ * \param tag The buffer to write the authentication tag to, which must
+ * be tagSize() bytes in size.
+ * \param key The key to use, which must be keySize() bytes in size.
+ * \param nonce The nonce to use.
+ * \param nonceLen The length of the nonce in bytes.
+ * \param ad Extra data to be authenticated but not encrypted.
+ * \param adLen The number of bytes of extra data in \a ad.
+ * \param input The plaintext to be encrypted.
+ * \param len The number of bytes of plaintext to encrypt.
+ * \return Returns false if the key or nonce length is not supported.
+ *
+ * This is equivalent to calling setKey(), setIV(), addAuthData(),
+ * encrypt(), and computeTag() in sequence.  Use the incremental functions
+ * instead when the packet is not available all at once.
+ *
+ * \sa open()
+ */
+bool AuthenticatedCipher::seal(uint8_t *output, uint8_t *tag,
+                               const uint8_t *key,
+                               const uint8_t *nonce, size_t nonceLen,
+                               const void *ad, size_t adLen,
+                               const uint8_t *input, size_t len)
+{
+    if (!setKey(key, keySize()) || !setIV(nonce, nonceLen))
+        return false;
+    addAuthData(ad, adLen);
+    encrypt(output, input, len);
+    computeTag(tag, tagSize());
+    return true;
+}
+
+/**
+ * \brief Decrypts and verifies a complete packet in one call.
+ *
+ * \param output The output buffer for the plaintext, which may be the
+ * same as \a input.  Must be at least \a len bytes in size.
+ * \param tag The authentication tag to check, which must be tagSize()
+ * bytes in size.
+ * \param key The key to use, which must be keySize() bytes in size.
+ * \param nonce The nonce to use.
+ * \param nonceLen The length of the nonce in bytes.
+ * \param ad Extra data to be authenticated but not decrypted.
+ * \param adLen The number of bytes of extra data in \a ad.
+ * \param input The ciphertext to be decrypted.
+ * \param len The number of bytes of ciphertext to decrypt.
+ * \return Returns true if the tag is valid; false if the tag is invalid
+ * or the key or nonce length is not supported.
+ *
+ * If the tag is invalid, then the \a output buffer will be cleared so
+ * that the caller cannot accidentally use forged plaintext.
+ *
+ * \sa seal()
+ */
+bool AuthenticatedCipher::open(uint8_t *output, const uint8_t *tag,
+                               const uint8_t *key,
+                               const uint8_t *nonce, size_t nonceLen,
+                               const void *ad, size_t adLen,
+                               const uint8_t *input, size_t len)
+{
+    if (!setKey(key, keySize()) || !setIV(nonce, nonceLen))
+        return false;
+    addAuthData(ad, adLen);
+    decrypt(output, input, len);
+    if (!checkTag(tag, tagSize())) {
+        clean(output, len);
+        return false;
+    }
+    return true;
+}
@@ -34,9 +34,19 @@ public:
     virtual size_t tagSize() const = 0;
 
     virtual void addAuthData(const void *data, size_t len) = 0;
+    virtual void addAuthDatav(const CipherSegment *segments, size_t count);
 
     virtual void computeTag(void *tag, size_t len) = 0;
     virtual bool checkTag(const void *tag, size_t len) = 0;
+
+    virtual bool seal(uint8_t *output, uint8_t *tag, const uint8_t *key,
+                      const uint8_t *nonce, size_t nonceLen,
+                      const void *ad, size_t adLen,
+                      const uint8_t *input, size_t len);
+    virtual bool open(uint8_t *output, const uint8_t *tag, const uint8_t *key,
+                      const uint8_t *nonce, size_t nonceLen,
+                      const void *ad, size_t adLen,
+                      const uint8_t *input, size_t len);
 };
 
 #endif
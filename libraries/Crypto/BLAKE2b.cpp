@@ -91,6 +91,7 @@ void BLAKE2b::reset()
     state.chunkSize = 0;
     state.lengthLow = 0;
     state.lengthHigh = 0;
+    state.lastNode = 0;
 }
 
 /**
@@ -113,6 +114,66 @@ void BLAKE2b::reset(uint8_t outputLength)
     state.chunkSize = 0;
     state.lengthLow = 0;
     state.lengthHigh = 0;
+    state.lastNode = 0;
+}
+
+/**
+ * \brief Resets the hash ready for a new keyed hashing process.
+ *
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes, between 0 and 64.
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 64.
+ *
+ * This uses the native keyed mode of BLAKE2b to turn the hash into a MAC.
+ * The key is hashed as an extra block at the start of the input, which
+ * is cheaper than the two extra blocks and the second pass that are
+ * needed when BLAKE2b is used with resetHMAC() and finalizeHMAC().
+ *
+ * If \a keyLen is zero, then this function is equivalent to
+ * reset(outputLength).  Keys longer than 64 bytes are truncated.
+ *
+ * \sa resetTree()
+ */
+void BLAKE2b::reset(const void *key, size_t keyLen, uint8_t outputLength)
+{
+    init(0x01010000 ^ outputLength, 0, 0, key, keyLen, false);
+}
+
+/**
+ * \brief Resets the hash ready for hashing a node in a tree hashing mode.
+ *
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 64.
+ * \param fanout The fanout of the tree, between 0 and 255; 0 means unlimited.
+ * \param depth The maximum depth of the tree, between 1 and 255;
+ * 255 means unlimited.
+ * \param leafLength The maximum number of bytes in each leaf, or zero
+ * for unlimited.
+ * \param nodeOffset Offset of the node in its level of the tree.
+ * \param nodeDepth The depth of the node in the tree; 0 for leaves.
+ * \param innerLength The length of the inner hash values in bytes.
+ * \param lastNode Set to true if this is the last node in its level.
+ * \param key Points to the key, or NULL for no key.
+ * \param keyLen The length of the key in bytes, between 0 and 64.
+ *
+ * The parameters correspond to the fields of the BLAKE2 parameter block,
+ * with the salt and personalization fields set to zero.  The caller is
+ * responsible for splitting the input up into leaves and combining the
+ * leaf hashes into the parent nodes of the tree.
+ *
+ * \sa reset()
+ */
+void BLAKE2b::resetTree(uint8_t outputLength, uint8_t fanout, uint8_t depth,
+                        uint32_t leafLength, uint64_t nodeOffset,
+                        uint8_t nodeDepth, uint8_t innerLength, bool lastNode,
+                        const void *key, size_t keyLen)
+{
+    init(outputLength | (((uint64_t)fanout) << 16) |
+             (((uint64_t)depth) << 24) | (((uint64_t)leafLength) << 32),
+         nodeOffset,
+         nodeDepth | (((uint64_t)innerLength) << 8),
+         key, keyLen, lastNode);
 }
 
 void BLAKE2b::update(const void *data, size_t len)
@@ -162,11 +223,18 @@ void BLAKE2b::clear()
     reset();
 }
 
+void BLAKE2b::copyState(const Hash &other)
+{
+    state = static_cast<const BLAKE2b &>(other).state;
+}
+
 void BLAKE2b::resetHMAC(const void *key, size_t keyLen)
 {
+    // Leave the inner padding block in the buffer until we know whether
+    // it is the last chunk, which it will be if the message is empty.
     formatHMACKey(state.m, key, keyLen, 0x36);
     state.lengthLow += 128;
-    processChunk(0);
+    state.chunkSize = 128;
 }
 
 void BLAKE2b::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen)
@@ -232,7 +300,7 @@ void BLAKE2b::processChunk(uint64_t f0)
     state.v[12] = BLAKE2b_IV4 ^ state.lengthLow;
     state.v[13] = BLAKE2b_IV5 ^ state.lengthHigh;
     state.v[14] = BLAKE2b_IV6 ^ f0;
-    state.v[15] = BLAKE2b_IV7;
+    state.v[15] = BLAKE2b_IV7 ^ (f0 & state.lastNode);
 
     // Perform the 12 BLAKE2b rounds.
     for (index = 0; index < 12; ++index) {
@@ -253,3 +321,42 @@ void BLAKE2b::processChunk(uint64_t f0)
     for (index = 0; index < 8; ++index)
         state.h[index] ^= (state.v[index] ^ state.v[index + 8]);
 }
+
+/**
+ * \brief Initializes the hash state from the first three words of the
+ * parameter block and an optional key.
+ *
+ * \param p0 Word 0 of the parameter block, without the key length.
+ * \param p1 Word 1 of the parameter block.
+ * \param p2 Word 2 of the parameter block.
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes.
+ * \param lastNode Set to true to set the last node flag on the final block.
+ */
+void BLAKE2b::init(uint64_t p0, uint64_t p1, uint64_t p2,
+                   const void *key, size_t keyLen, bool lastNode)
+{
+    if (keyLen > 64)
+        keyLen = 64;
+    state.h[0] = BLAKE2b_IV0 ^ p0 ^ (((uint64_t)keyLen) << 8);
+    state.h[1] = BLAKE2b_IV1 ^ p1;
+    state.h[2] = BLAKE2b_IV2 ^ p2;
+    state.h[3] = BLAKE2b_IV3;
+    state.h[4] = BLAKE2b_IV4;
+    state.h[5] = BLAKE2b_IV5;
+    state.h[6] = BLAKE2b_IV6;
+    state.h[7] = BLAKE2b_IV7;
+    state.lengthHigh = 0;
+    state.lastNode = lastNode ? 0xFFFFFFFFFFFFFFFFULL : 0;
+    if (keyLen > 0) {
+        // The key is padded to a full block and becomes the first chunk.
+        // We leave it in the buffer until we know if it is the last chunk.
+        memcpy(state.m, key, keyLen);
+        memset(((uint8_t *)state.m) + keyLen, 0, 128 - keyLen);
+        state.chunkSize = 128;
+        state.lengthLow = 128;
+    } else {
+        state.chunkSize = 0;
+        state.lengthLow = 0;
+    }
+}
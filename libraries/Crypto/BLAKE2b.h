@@ -36,25 +36,37 @@ public:
 
     void reset();
     void reset(uint8_t outputLength);
+    void reset(const void *key, size_t keyLen, uint8_t outputLength = 64);
+    void resetTree(uint8_t outputLength, uint8_t fanout, uint8_t depth,
+                   uint32_t leafLength, uint64_t nodeOffset,
+                   uint8_t nodeDepth, uint8_t innerLength, bool lastNode,
+                   const void *key = 0, size_t keyLen = 0);
     void update(const void *data, size_t len);
     void finalize(void *hash, size_t len);
 
     void clear();
 
+    void copyState(const Hash &other);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
 private:
+    friend class BLAKE2bp;
+
     struct {
         uint64_t h[8];
         uint64_t m[16];
         uint64_t v[16];
         uint64_t lengthLow;
         uint64_t lengthHigh;
+        uint64_t lastNode;
         uint8_t chunkSize;
     } state;
 
     void processChunk(uint64_t f0);
+    void init(uint64_t p0, uint64_t p1, uint64_t p2,
+              const void *key, size_t keyLen, bool lastNode);
 };
 
 #endif
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BLAKE2bp.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class BLAKE2bp BLAKE2bp.h <BLAKE2bp.h>
+ * \brief BLAKE2bp parallel tree hash algorithm.
+ *
+ * BLAKE2bp splits the input into 128-byte blocks and distributes them in
+ * turn across 4 BLAKE2b leaf hashes.  The leaf hashes are then combined
+ * with a root BLAKE2b hash to produce a 512-bit hash output.  The result
+ * is different from a plain BLAKE2b hash of the same data.
+ *
+ * The leaves are independent of each other, which allows optimized
+ * implementations on other platforms to hash them in parallel.  This
+ * implementation runs the leaves in turn on the calling core, reusing the
+ * BLAKE2b compression function.  It is mainly useful for verifying
+ * data that was hashed with BLAKE2bp elsewhere.
+ *
+ * The state for this class is 4 BLAKE2b objects, which makes it
+ * quite large for use on AVR platforms.
+ *
+ * Reference: https://blake2.net/
+ *
+ * \sa BLAKE2b
+ */
+
+/**
+ * \brief Constructs a BLAKE2bp hash object.
+ */
+BLAKE2bp::BLAKE2bp()
+{
+    reset();
+}
+
+/**
+ * \brief Destroys this BLAKE2bp hash object after clearing
+ * sensitive information.
+ */
+BLAKE2bp::~BLAKE2bp()
+{
+    clean(state);
+}
+
+size_t BLAKE2bp::hashSize() const
+{
+    return 64;
+}
+
+size_t BLAKE2bp::blockSize() const
+{
+    return 128;
+}
+
+void BLAKE2bp::reset()
+{
+    reset(0, 0, 64);
+}
+
+/**
+ * \brief Resets the hash ready for a new hashing process with a specified
+ * output length.
+ *
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 64.
+ */
+void BLAKE2bp::reset(uint8_t outputLength)
+{
+    reset(0, 0, outputLength);
+}
+
+/**
+ * \brief Resets the hash ready for a new keyed hashing process.
+ *
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes, between 0 and 64.
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 64.
+ *
+ * The key is hashed into every leaf, as in BLAKE2b::reset(key, keyLen).
+ * Keys longer than 64 bytes are truncated.
+ */
+void BLAKE2bp::reset(const void *key, size_t keyLen, uint8_t outputLength)
+{
+    if (keyLen > 64)
+        keyLen = 64;
+    for (uint8_t index = 0; index < 4; ++index) {
+        leaves[index].resetTree(outputLength, 4, 2, 0, index, 0, 64,
+                                index == (4 - 1), key, keyLen);
+    }
+    state.posn = 0;
+    state.outputLength = outputLength;
+    state.keyLen = (uint8_t)keyLen;
+}
+
+void BLAKE2bp::update(const void *data, size_t len)
+{
+    // Each group of 4 consecutive blocks is spread across the leaves.
+    const uint8_t *d = (const uint8_t *)data;
+    while (len > 0) {
+        size_t size = 128 - (state.posn % 128);
+        if (size > len)
+            size = len;
+        leaves[state.posn / 128].update(d, size);
+        state.posn = (state.posn + size) % (4 * 128);
+        len -= size;
+        d += size;
+    }
+}
+
+void BLAKE2bp::finalize(void *hash, size_t len)
+{
+    uint8_t temp[64];
+
+    // Finalize the first leaf and then reuse its object for the root node.
+    // The root has fanout 4, depth 2, node depth 1, and inner length 64.
+    // The key length is recorded in the root but the key is not hashed.
+    leaves[0].finalize(temp, sizeof(temp));
+    leaves[0].init(0x02040000 ^ (((uint64_t)state.keyLen) << 8) ^
+                       state.outputLength,
+                   0, 0x4001, 0, 0, true);
+    leaves[0].update(temp, sizeof(temp));
+
+    // Finalize the remaining leaves and feed them into the root node.
+    for (uint8_t index = 1; index < 4; ++index) {
+        leaves[index].finalize(temp, sizeof(temp));
+        leaves[0].update(temp, sizeof(temp));
+    }
+
+    // Produce the final hash value from the root node.
+    leaves[0].finalize(hash, len);
+    clean(temp);
+}
+
+void BLAKE2bp::clear()
+{
+    for (uint8_t index = 0; index < 4; ++index)
+        leaves[index].clear();
+    clean(state);
+    reset();
+}
+
+void BLAKE2bp::copyState(const Hash &other)
+{
+    const BLAKE2bp &from = static_cast<const BLAKE2bp &>(other);
+    for (uint8_t index = 0; index < 4; ++index)
+        leaves[index].copyState(from.leaves[index]);
+    state = from.state;
+}
+
+void BLAKE2bp::resetHMAC(const void *key, size_t keyLen)
+{
+    uint8_t block[128];
+    formatHMACKey(block, key, keyLen, 0x36);
+    update(block, sizeof(block));
+    clean(block);
+}
+
+void BLAKE2bp::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen)
+{
+    uint8_t block[128];
+    uint8_t temp[64];
+    finalize(temp, sizeof(temp));
+    formatHMACKey(block, key, keyLen, 0x5C);
+    update(block, sizeof(block));
+    update(temp, sizeof(temp));
+    finalize(hash, hashLen);
+    clean(block);
+    clean(temp);
+}
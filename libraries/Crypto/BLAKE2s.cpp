@@ -22,6 +22,7 @@
 
 #include "BLAKE2s.h"
 #include "Crypto.h"
+#include "CryptoConfig.h"
 #include "utility/EndianUtil.h"
 #include "utility/RotateUtil.h"
 #include "utility/ProgMemUtil.h"
@@ -90,6 +91,7 @@ void BLAKE2s::reset()
     state.h[7] = BLAKE2s_IV7;
     state.chunkSize = 0;
     state.length = 0;
+    state.lastNode = 0;
 }
 
 /**
@@ -111,6 +113,69 @@ void BLAKE2s::reset(uint8_t outputLength)
     state.h[7] = BLAKE2s_IV7;
     state.chunkSize = 0;
     state.length = 0;
+    state.lastNode = 0;
+}
+
+/**
+ * \brief Resets the hash ready for a new keyed hashing process.
+ *
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes, between 0 and 32.
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 32.
+ *
+ * This uses the native keyed mode of BLAKE2s to turn the hash into a MAC.
+ * The key is hashed as an extra block at the start of the input, which
+ * is cheaper than the two extra blocks and the second pass that are
+ * needed when BLAKE2s is used with resetHMAC() and finalizeHMAC().
+ *
+ * If \a keyLen is zero, then this function is equivalent to
+ * reset(outputLength).  Keys longer than 32 bytes are truncated.
+ *
+ * \sa resetTree()
+ */
+void BLAKE2s::reset(const void *key, size_t keyLen, uint8_t outputLength)
+{
+    init(0x01010000 ^ outputLength, 0, 0, 0, key, keyLen, false);
+}
+
+/**
+ * \brief Resets the hash ready for hashing a node in a tree hashing mode.
+ *
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 32.
+ * \param fanout The fanout of the tree, between 0 and 255; 0 means unlimited.
+ * \param depth The maximum depth of the tree, between 1 and 255;
+ * 255 means unlimited.
+ * \param leafLength The maximum number of bytes in each leaf, or zero
+ * for unlimited.
+ * \param nodeOffset Offset of the node in its level of the tree,
+ * up to 48 bits in size.
+ * \param nodeDepth The depth of the node in the tree; 0 for leaves.
+ * \param innerLength The length of the inner hash values in bytes.
+ * \param lastNode Set to true if this is the last node in its level.
+ * \param key Points to the key, or NULL for no key.
+ * \param keyLen The length of the key in bytes, between 0 and 32.
+ *
+ * The parameters correspond to the fields of the BLAKE2 parameter block,
+ * with the salt and personalization fields set to zero.  The caller is
+ * responsible for splitting the input up into leaves and combining the
+ * leaf hashes into the parent nodes of the tree.
+ *
+ * \sa reset()
+ */
+void BLAKE2s::resetTree(uint8_t outputLength, uint8_t fanout, uint8_t depth,
+                        uint32_t leafLength, uint64_t nodeOffset,
+                        uint8_t nodeDepth, uint8_t innerLength, bool lastNode,
+                        const void *key, size_t keyLen)
+{
+    init(outputLength | (((uint32_t)fanout) << 16) |
+             (((uint32_t)depth) << 24),
+         leafLength, (uint32_t)nodeOffset,
+         ((uint32_t)(nodeOffset >> 32) & 0xFFFF) |
+             (((uint32_t)nodeDepth) << 16) |
+             (((uint32_t)innerLength) << 24),
+         key, keyLen, lastNode);
 }
 
 void BLAKE2s::update(const void *data, size_t len)
@@ -157,11 +222,18 @@ void BLAKE2s::clear()
     reset();
 }
 
+void BLAKE2s::copyState(const Hash &other)
+{
+    state = static_cast<const BLAKE2s &>(other).state;
+}
+
 void BLAKE2s::resetHMAC(const void *key, size_t keyLen)
 {
+    // Leave the inner padding block in the buffer until we know whether
+    // it is the last chunk, which it will be if the message is empty.
     formatHMACKey(state.m, key, keyLen, 0x36);
     state.length += 64;
-    processChunk(0);
+    state.chunkSize = 64;
 }
 
 void BLAKE2s::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen)
@@ -206,6 +278,40 @@ static const uint8_t sigma[10][16] PROGMEM = {
         (c) = _c; \
     } while (0)
 
+#if CRYPTO_BLAKE2S_UNROLL
+
+// Perform a BLAKE2s quarter round operation with the message words inline.
+#define quarterRoundUnrolled(a, b, c, d, x, y)    \
+    do { \
+        uint32_t _b = (b); \
+        uint32_t _a = (a) + _b + state.m[(x)]; \
+        uint32_t _d = rightRotate16((d) ^ _a); \
+        uint32_t _c = (c) + _d; \
+        _b = rightRotate12(_b ^ _c); \
+        _a += _b + state.m[(y)]; \
+        (d) = _d = rightRotate8(_d ^ _a); \
+        _c += _d; \
+        (a) = _a; \
+        (b) = rightRotate7(_b ^ _c); \
+        (c) = _c; \
+    } while (0)
+
+// Perform a full BLAKE2s round given the message permutation for the round.
+#define roundUnrolled(s0, s1, s2, s3, s4, s5, s6, s7, \
+                      s8, s9, s10, s11, s12, s13, s14, s15) \
+    do { \
+        quarterRoundUnrolled(state.v[0], state.v[4], state.v[8],  state.v[12], s0, s1); \
+        quarterRoundUnrolled(state.v[1], state.v[5], state.v[9],  state.v[13], s2, s3); \
+        quarterRoundUnrolled(state.v[2], state.v[6], state.v[10], state.v[14], s4, s5); \
+        quarterRoundUnrolled(state.v[3], state.v[7], state.v[11], state.v[15], s6, s7); \
+        quarterRoundUnrolled(state.v[0], state.v[5], state.v[10], state.v[15], s8, s9); \
+        quarterRoundUnrolled(state.v[1], state.v[6], state.v[11], state.v[12], s10, s11); \
+        quarterRoundUnrolled(state.v[2], state.v[7], state.v[8],  state.v[13], s12, s13); \
+        quarterRoundUnrolled(state.v[3], state.v[4], state.v[9],  state.v[14], s14, s15); \
+    } while (0)
+
+#endif
+
 void BLAKE2s::processChunk(uint32_t f0)
 {
     uint8_t index;
@@ -225,8 +331,21 @@ void BLAKE2s::processChunk(uint32_t f0)
     state.v[12] = BLAKE2s_IV4 ^ (uint32_t)(state.length);
     state.v[13] = BLAKE2s_IV5 ^ (uint32_t)(state.length >> 32);
     state.v[14] = BLAKE2s_IV6 ^ f0;
-    state.v[15] = BLAKE2s_IV7;
+    state.v[15] = BLAKE2s_IV7 ^ (f0 & state.lastNode);
 
+#if CRYPTO_BLAKE2S_UNROLL
+    // Perform the 10 BLAKE2s rounds.
+    roundUnrolled(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    roundUnrolled(14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3);
+    roundUnrolled(11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4);
+    roundUnrolled(7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8);
+    roundUnrolled(9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13);
+    roundUnrolled(2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9);
+    roundUnrolled(12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11);
+    roundUnrolled(13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10);
+    roundUnrolled(6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5);
+    roundUnrolled(10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0);
+#else
     // Perform the 10 BLAKE2s rounds.
     for (index = 0; index < 10; ++index) {
         // Column round.
@@ -241,8 +360,48 @@ void BLAKE2s::processChunk(uint32_t f0)
         quarterRound(state.v[2], state.v[7], state.v[8],  state.v[13], 6);
         quarterRound(state.v[3], state.v[4], state.v[9],  state.v[14], 7);
     }
+#endif
 
     // Combine the new and old hash values.
     for (index = 0; index < 8; ++index)
         state.h[index] ^= (state.v[index] ^ state.v[index + 8]);
 }
+
+/**
+ * \brief Initializes the hash state from the first four words of the
+ * parameter block and an optional key.
+ *
+ * \param p0 Word 0 of the parameter block, without the key length.
+ * \param p1 Word 1 of the parameter block.
+ * \param p2 Word 2 of the parameter block.
+ * \param p3 Word 3 of the parameter block.
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes.
+ * \param lastNode Set to true to set the last node flag on the final block.
+ */
+void BLAKE2s::init(uint32_t p0, uint32_t p1, uint32_t p2, uint32_t p3,
+                   const void *key, size_t keyLen, bool lastNode)
+{
+    if (keyLen > 32)
+        keyLen = 32;
+    state.h[0] = BLAKE2s_IV0 ^ p0 ^ (((uint32_t)keyLen) << 8);
+    state.h[1] = BLAKE2s_IV1 ^ p1;
+    state.h[2] = BLAKE2s_IV2 ^ p2;
+    state.h[3] = BLAKE2s_IV3 ^ p3;
+    state.h[4] = BLAKE2s_IV4;
+    state.h[5] = BLAKE2s_IV5;
+    state.h[6] = BLAKE2s_IV6;
+    state.h[7] = BLAKE2s_IV7;
+    state.lastNode = lastNode ? 0xFFFFFFFF : 0;
+    if (keyLen > 0) {
+        // The key is padded to a full block and becomes the first chunk.
+        // We leave it in the buffer until we know if it is the last chunk.
+        memcpy(state.m, key, keyLen);
+        memset(((uint8_t *)state.m) + keyLen, 0, 64 - keyLen);
+        state.chunkSize = 64;
+        state.length = 64;
+    } else {
+        state.chunkSize = 0;
+        state.length = 0;
+    }
+}
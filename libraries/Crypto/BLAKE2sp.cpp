@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BLAKE2sp.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class BLAKE2sp BLAKE2sp.h <BLAKE2sp.h>
+ * \brief BLAKE2sp parallel tree hash algorithm.
+ *
+ * BLAKE2sp splits the input into 64-byte blocks and distributes them in
+ * turn across 8 BLAKE2s leaf hashes.  The leaf hashes are then combined
+ * with a root BLAKE2s hash to produce a 256-bit hash output.  The result
+ * is different from a plain BLAKE2s hash of the same data.
+ *
+ * The leaves are independent of each other, which allows optimized
+ * implementations on other platforms to hash them in parallel.  This
+ * implementation runs the leaves in turn on the calling core, reusing the
+ * BLAKE2s compression function.  It is mainly useful for verifying
+ * data that was hashed with BLAKE2sp elsewhere.
+ *
+ * The state for this class is 8 BLAKE2s objects, which makes it
+ * quite large for use on AVR platforms.
+ *
+ * Reference: https://blake2.net/
+ *
+ * \sa BLAKE2s
+ */
+
+/**
+ * \brief Constructs a BLAKE2sp hash object.
+ */
+BLAKE2sp::BLAKE2sp()
+{
+    reset();
+}
+
+/**
+ * \brief Destroys this BLAKE2sp hash object after clearing
+ * sensitive information.
+ */
+BLAKE2sp::~BLAKE2sp()
+{
+    clean(state);
+}
+
+size_t BLAKE2sp::hashSize() const
+{
+    return 32;
+}
+
+size_t BLAKE2sp::blockSize() const
+{
+    return 64;
+}
+
+void BLAKE2sp::reset()
+{
+    reset(0, 0, 32);
+}
+
+/**
+ * \brief Resets the hash ready for a new hashing process with a specified
+ * output length.
+ *
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 32.
+ */
+void BLAKE2sp::reset(uint8_t outputLength)
+{
+    reset(0, 0, outputLength);
+}
+
+/**
+ * \brief Resets the hash ready for a new keyed hashing process.
+ *
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes, between 0 and 32.
+ * \param outputLength The output length to use for the final hash in bytes,
+ * between 1 and 32.
+ *
+ * The key is hashed into every leaf, as in BLAKE2s::reset(key, keyLen).
+ * Keys longer than 32 bytes are truncated.
+ */
+void BLAKE2sp::reset(const void *key, size_t keyLen, uint8_t outputLength)
+{
+    if (keyLen > 32)
+        keyLen = 32;
+    for (uint8_t index = 0; index < 8; ++index) {
+        leaves[index].resetTree(outputLength, 8, 2, 0, index, 0, 32,
+                                index == (8 - 1), key, keyLen);
+    }
+    state.posn = 0;
+    state.outputLength = outputLength;
+    state.keyLen = (uint8_t)keyLen;
+}
+
+void BLAKE2sp::update(const void *data, size_t len)
+{
+    // Each group of 8 consecutive blocks is spread across the leaves.
+    const uint8_t *d = (const uint8_t *)data;
+    while (len > 0) {
+        size_t size = 64 - (state.posn % 64);
+        if (size > len)
+            size = len;
+        leaves[state.posn / 64].update(d, size);
+        state.posn = (state.posn + size) % (8 * 64);
+        len -= size;
+        d += size;
+    }
+}
+
+void BLAKE2sp::finalize(void *hash, size_t len)
+{
+    uint8_t temp[32];
+
+    // Finalize the first leaf and then reuse its object for the root node.
+    // The root has fanout 8, depth 2, node depth 1, and inner length 32.
+    // The key length is recorded in the root but the key is not hashed.
+    leaves[0].finalize(temp, sizeof(temp));
+    leaves[0].init(0x02080000 ^ (((uint32_t)state.keyLen) << 8) ^
+                       state.outputLength,
+                   0, 0, 0x20010000, 0, 0, true);
+    leaves[0].update(temp, sizeof(temp));
+
+    // Finalize the remaining leaves and feed them into the root node.
+    for (uint8_t index = 1; index < 8; ++index) {
+        leaves[index].finalize(temp, sizeof(temp));
+        leaves[0].update(temp, sizeof(temp));
+    }
+
+    // Produce the final hash value from the root node.
+    leaves[0].finalize(hash, len);
+    clean(temp);
+}
+
+void BLAKE2sp::clear()
+{
+    for (uint8_t index = 0; index < 8; ++index)
+        leaves[index].clear();
+    clean(state);
+    reset();
+}
+
+void BLAKE2sp::copyState(const Hash &other)
+{
+    const BLAKE2sp &from = static_cast<const BLAKE2sp &>(other);
+    for (uint8_t index = 0; index < 8; ++index)
+        leaves[index].copyState(from.leaves[index]);
+    state = from.state;
+}
+
+void BLAKE2sp::resetHMAC(const void *key, size_t keyLen)
+{
+    uint8_t block[64];
+    formatHMACKey(block, key, keyLen, 0x36);
+    update(block, sizeof(block));
+    clean(block);
+}
+
+void BLAKE2sp::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen)
+{
+    uint8_t block[64];
+    uint8_t temp[32];
+    finalize(temp, sizeof(temp));
+    formatHMACKey(block, key, keyLen, 0x5C);
+    update(block, sizeof(block));
+    update(temp, sizeof(temp));
+    finalize(hash, hashLen);
+    clean(block);
+    clean(temp);
+}
@@ -21,6 +21,8 @@
  */
 
 #include "BigNumberUtil.h"
+#include "Crypto.h"
+#include "utility/ConstantTimeUtil.h"
 #include "utility/EndianUtil.h"
 #include "utility/LimbUtil.h"
 #include <string.h>
@@ -30,8 +32,9 @@
  * \brief Utilities to assist with implementing big number arithmetic.
  *
  * Big numbers are represented as arrays of limb_t words, which may be
- * 8 bits, 16 bits, or 32 bits in size depending upon how the library
- * was configured.  For AVR, 16 bit limbs usually give the best performance.
+ * 8 bits, 16 bits, 32 bits, or 64 bits in size depending upon how the
+ * library was configured.  For AVR, 16 bit limbs usually give the best
+ * performance.  64 bit limbs are used on hosts with 128-bit products.
  *
  * Limb arrays are ordered from the least significant word to the most
  * significant.
@@ -113,6 +116,29 @@ void BigNumberUtil::unpackLE(limb_t *limbs, size_t count,
         *limbs++ = 0;
         --count;
     }
+#elif BIGNUMBER_LIMB_64BIT
+    while (count > 0 && len >= 8) {
+        limb_t word = 0;
+        for (uint8_t i = 8; i > 0; --i)
+            word = (word << 8) | bytes[i - 1];
+        *limbs++ = word;
+        bytes += 8;
+        --count;
+        len -= 8;
+    }
+    if (count > 0 && len > 0) {
+        limb_t word = 0;
+        while (len > 0) {
+            --len;
+            word = (word << 8) | bytes[len];
+        }
+        *limbs++ = word;
+        --count;
+    }
+    while (count > 0) {
+        *limbs++ = 0;
+        --count;
+    }
 #endif
 }
 
@@ -186,6 +212,26 @@ void BigNumberUtil::unpackBE(limb_t *limbs, size_t count,
         }
     }
     memset(limbs, 0, count * sizeof(limb_t));
+#elif BIGNUMBER_LIMB_64BIT
+    bytes += len;
+    while (count > 0 && len >= 8) {
+        --count;
+        bytes -= 8;
+        len -= 8;
+        limb_t word = 0;
+        for (uint8_t i = 0; i < 8; ++i)
+            word = (word << 8) | bytes[i];
+        *limbs++ = word;
+    }
+    if (count > 0 && len > 0) {
+        --count;
+        bytes -= len;
+        limb_t word = 0;
+        for (uint8_t i = 0; i < len; ++i)
+            word = (word << 8) | bytes[i];
+        *limbs++ = word;
+    }
+    memset(limbs, 0, count * sizeof(limb_t));
 #endif
 }
 
@@ -272,6 +318,27 @@ void BigNumberUtil::packLE(uint8_t *bytes, size_t len,
         }
     }
     memset(bytes, 0, len);
+#elif BIGNUMBER_LIMB_64BIT
+    limb_t word;
+    while (count > 0 && len >= 8) {
+        word = *limbs++;
+        for (uint8_t i = 0; i < 8; ++i) {
+            bytes[i] = (uint8_t)word;
+            word >>= 8;
+        }
+        --count;
+        len -= 8;
+        bytes += 8;
+    }
+    if (count > 0) {
+        word = *limbs;
+        while (len > 0) {
+            *bytes++ = (uint8_t)word;
+            word >>= 8;
+            --len;
+        }
+    }
+    memset(bytes, 0, len);
 #endif
 }
 
@@ -362,6 +429,31 @@ void BigNumberUtil::packBE(uint8_t *bytes, size_t len,
         *bytes++ = (uint8_t)(word >> 8);
         *bytes++ = (uint8_t)word;
     }
+#elif BIGNUMBER_LIMB_64BIT
+    size_t countBytes = count * sizeof(limb_t);
+    limb_t word;
+    uint8_t i;
+    if (len >= countBytes) {
+        size_t size = len - countBytes;
+        memset(bytes, 0, size);
+        len -= size;
+        bytes += size;
+        limbs += count;
+    } else {
+        count = len / sizeof(limb_t);
+        limbs += count;
+        if ((len & 7) != 0) {
+            word = *limbs;
+            for (i = (uint8_t)(len & 7); i > 0; --i)
+                *bytes++ = (uint8_t)(word >> ((i - 1) * 8));
+        }
+    }
+    while (count > 0) {
+        --count;
+        word = *(--limbs);
+        for (i = 8; i > 0; --i)
+            *bytes++ = (uint8_t)(word >> ((i - 1) * 8));
+    }
 #endif
 }
 
@@ -417,6 +509,174 @@ limb_t BigNumberUtil::sub(limb_t *result, const limb_t *x,
     return ((limb_t)(borrow >> LIMB_BITS)) & 0x01;
 }
 
+#if BIGNUMBER_KARATSUBA_THRESHOLD
+
+// Operand size in limbs where Karatsuba's method takes over and the
+// amount of scratch space to reserve for intermediate values.
+#define KARATSUBA_LIMBS     BIGNUMBER_KARATSUBA_THRESHOLD
+#define KARATSUBA_SCRATCH   (5 * BIGNUMBER_KARATSUBA_MAX_BITS / LIMB_BITS)
+
+// Determine if the result of a multiplication overlaps with the x operand.
+// Some callers rely upon the schoolbook method tolerating this case.
+static inline bool overlaps(const limb_t *result, size_t rcount,
+                            const limb_t *x, size_t xcount)
+{
+    return (result + rcount) > x && (x + xcount) > result;
+}
+
+// Adds the low and high halves of a split operand, where the high half
+// may be one limb shorter or longer than the low half.  The result has
+// one more limb than the longer of the two halves.
+static void addHalves(limb_t *result, const limb_t *lo, size_t locount,
+                      const limb_t *hi, size_t hicount, bool progmem)
+{
+    size_t count = (locount < hicount) ? locount : hicount;
+    size_t i;
+    dlimb_t carry = 0;
+    if (progmem) {
+        for (i = 0; i < count; ++i) {
+            carry += pgm_read_limb(&(lo[i]));
+            carry += pgm_read_limb(&(hi[i]));
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        for (; i < locount; ++i) {
+            carry += pgm_read_limb(&(lo[i]));
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        for (; i < hicount; ++i) {
+            carry += pgm_read_limb(&(hi[i]));
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+    } else {
+        for (i = 0; i < count; ++i) {
+            carry += lo[i];
+            carry += hi[i];
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        for (; i < locount; ++i) {
+            carry += lo[i];
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        for (; i < hicount; ++i) {
+            carry += hi[i];
+            result[i] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+    }
+    result[i] = (limb_t)carry;
+}
+
+// Subtracts y from x in place where y is no longer than x.
+static void subInPlace(limb_t *x, size_t xcount, const limb_t *y, size_t ycount)
+{
+    dlimb_t borrow = 0;
+    size_t i;
+    for (i = 0; i < ycount; ++i) {
+        borrow = ((dlimb_t)(x[i])) - y[i] - ((borrow >> LIMB_BITS) & 0x01);
+        x[i] = (limb_t)borrow;
+    }
+    for (; i < xcount; ++i) {
+        borrow = ((dlimb_t)(x[i])) - ((borrow >> LIMB_BITS) & 0x01);
+        x[i] = (limb_t)borrow;
+    }
+}
+
+// Adds y to x in place.  Limbs of y beyond the end of x must be zero.
+static void addInPlace(limb_t *x, size_t xcount, const limb_t *y, size_t ycount)
+{
+    dlimb_t carry = 0;
+    size_t i;
+    if (ycount > xcount)
+        ycount = xcount;
+    for (i = 0; i < ycount; ++i) {
+        carry += x[i];
+        carry += y[i];
+        x[i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+    }
+    for (; i < xcount; ++i) {
+        carry += x[i];
+        x[i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+    }
+}
+
+/**
+ * \brief Multiplies two big numbers with Karatsuba's method.
+ *
+ * \param result The result of the multiplication.  The array must be
+ * \a xcount + \a ycount limbs in size.
+ * \param x Points to the first value to multiply.
+ * \param xcount The number of limbs in \a x.
+ * \param y Points to the second value to multiply.
+ * \param ycount The number of limbs in \a y.
+ * \param yprogmem Set to true if \a y points into program memory.
+ * \param scratch Scratch space for intermediate values.
+ * \param scratchSize The number of limbs in \a scratch.
+ *
+ * \return The number of limbs of \a scratch that were used.
+ *
+ * The operands are split at m limbs into x = x1 * B^m + x0 and
+ * y = y1 * B^m + y0.  Then x * y = z2 * B^(2m) + z1 * B^m + z0 where
+ * z0 = x0 * y0, z2 = x1 * y1, and z1 = (x0 + x1) * (y0 + y1) - z0 - z2.
+ * This needs three half-size multiplications instead of four.  The
+ * recursion falls back to the schoolbook method once the operands drop
+ * below the threshold or the scratch space runs out.
+ *
+ * The sequence of operations depends only upon the operand sizes,
+ * not their values.
+ */
+size_t BigNumberUtil::mulKaratsuba(limb_t *result, const limb_t *x, size_t xcount,
+                                   const limb_t *y, size_t ycount, bool yprogmem,
+                                   limb_t *scratch, size_t scratchSize)
+{
+    size_t m = (((xcount < ycount) ? xcount : ycount) + 1) / 2;
+    size_t sxcount = ((m > (xcount - m)) ? m : (xcount - m)) + 1;
+    size_t sycount = ((m > (ycount - m)) ? m : (ycount - m)) + 1;
+    size_t pcount = sxcount + sycount;
+    size_t rcount = xcount + ycount;
+    if (xcount < KARATSUBA_LIMBS || ycount < KARATSUBA_LIMBS ||
+            (2 * pcount) > scratchSize) {
+        if (yprogmem)
+            mulBasic_P(result, x, xcount, y, ycount);
+        else
+            mulBasic(result, x, xcount, y, ycount);
+        return 0;
+    }
+
+    // z0 and z2 go directly into the low and high parts of the result.
+    size_t used, used2;
+    used = mulKaratsuba(result, x, m, y, m, yprogmem, scratch, scratchSize);
+    used2 = mulKaratsuba(result + 2 * m, x + m, xcount - m, y + m, ycount - m,
+                         yprogmem, scratch, scratchSize);
+    if (used2 > used)
+        used = used2;
+
+    // Compute z1 = (x0 + x1) * (y0 + y1) - z0 - z2 in the scratch space.
+    limb_t *sx = scratch;
+    limb_t *sy = sx + sxcount;
+    limb_t *prod = sy + sycount;
+    addHalves(sx, x, m, x + m, xcount - m, false);
+    addHalves(sy, y, m, y + m, ycount - m, yprogmem);
+    used2 = 2 * pcount + mulKaratsuba(prod, sx, sxcount, sy, sycount, false,
+                                      prod + pcount, scratchSize - 2 * pcount);
+    if (used2 > used)
+        used = used2;
+    subInPlace(prod, pcount, result, 2 * m);
+    subInPlace(prod, pcount, result + 2 * m, rcount - 2 * m);
+
+    // Add z1 * B^m to the result.
+    addInPlace(result + m, rcount - m, prod, pcount);
+    return used;
+}
+
+#endif // BIGNUMBER_KARATSUBA_THRESHOLD
+
 /**
  * \brief Multiplies two big numbers.
  *
@@ -427,10 +687,42 @@ limb_t BigNumberUtil::sub(limb_t *result, const limb_t *x,
  * \param y Points to the second value to multiply.
  * \param ycount The number of limbs in \a y.
  *
+ * If both operands are at least BIGNUMBER_KARATSUBA_THRESHOLD limbs in
+ * size and \a result does not overlap with \a x, then Karatsuba's method
+ * is used to perform the multiplication.
+ *
  * \sa mul_P()
  */
 void BigNumberUtil::mul(limb_t *result, const limb_t *x, size_t xcount,
                         const limb_t *y, size_t ycount)
+{
+#if BIGNUMBER_KARATSUBA_THRESHOLD
+    if (xcount >= KARATSUBA_LIMBS && ycount >= KARATSUBA_LIMBS &&
+            !overlaps(result, xcount + ycount, x, xcount)) {
+        limb_t scratch[KARATSUBA_SCRATCH];
+        size_t used = mulKaratsuba(result, x, xcount, y, ycount, false,
+                                   scratch, KARATSUBA_SCRATCH);
+        clean(scratch, used * sizeof(limb_t));
+        return;
+    }
+#endif
+    mulBasic(result, x, xcount, y, ycount);
+}
+
+/**
+ * \brief Multiplies two big numbers with the schoolbook method.
+ *
+ * \param result The result of the multiplication.  The array must be
+ * \a xcount + \a ycount limbs in size.
+ * \param x Points to the first value to multiply.
+ * \param xcount The number of limbs in \a x.
+ * \param y Points to the second value to multiply.
+ * \param ycount The number of limbs in \a y.
+ *
+ * \sa mul()
+ */
+void BigNumberUtil::mulBasic(limb_t *result, const limb_t *x, size_t xcount,
+                             const limb_t *y, size_t ycount)
 {
     size_t i, j;
     dlimb_t carry;
@@ -485,8 +777,7 @@ void BigNumberUtil::reduceQuick(limb_t *result, const limb_t *x,
                                 const limb_t *y, size_t size)
 {
     // Subtract "y" from "x" and turn the borrow into an AND mask.
-    limb_t mask = sub(result, x, y, size);
-    mask = (~mask) + 1;
+    limb_t mask = ctMask(sub(result, x, y, size));
 
     // Add "y" back to the result if the mask is non-zero.
     dlimb_t carry = 0;
@@ -561,10 +852,44 @@ limb_t BigNumberUtil::sub_P(limb_t *result, const limb_t *x,
  * into program memory.
  * \param ycount The number of limbs in \a y.
  *
+ * If both operands are at least BIGNUMBER_KARATSUBA_THRESHOLD limbs in
+ * size and \a result does not overlap with \a x, then Karatsuba's method
+ * is used to perform the multiplication.
+ *
  * \sa mul()
  */
 void BigNumberUtil::mul_P(limb_t *result, const limb_t *x, size_t xcount,
                           const limb_t *y, size_t ycount)
+{
+#if BIGNUMBER_KARATSUBA_THRESHOLD
+    if (xcount >= KARATSUBA_LIMBS && ycount >= KARATSUBA_LIMBS &&
+            !overlaps(result, xcount + ycount, x, xcount)) {
+        limb_t scratch[KARATSUBA_SCRATCH];
+        size_t used = mulKaratsuba(result, x, xcount, y, ycount, true,
+                                   scratch, KARATSUBA_SCRATCH);
+        clean(scratch, used * sizeof(limb_t));
+        return;
+    }
+#endif
+    mulBasic_P(result, x, xcount, y, ycount);
+}
+
+/**
+ * \brief Multiplies two big numbers with the schoolbook method where
+ * one is in program memory.
+ *
+ * \param result The result of the multiplication.  The array must be
+ * \a xcount + \a ycount limbs in size.
+ * \param x Points to the first value to multiply.
+ * \param xcount The number of limbs in \a x.
+ * \param y Points to the second value to multiply.  This must point
+ * into program memory.
+ * \param ycount The number of limbs in \a y.
+ *
+ * \sa mul_P()
+ */
+void BigNumberUtil::mulBasic_P(limb_t *result, const limb_t *x, size_t xcount,
+                               const limb_t *y, size_t ycount)
 {
     size_t i, j;
     dlimb_t carry;
@@ -621,8 +946,7 @@ void BigNumberUtil::reduceQuick_P(limb_t *result, const limb_t *x,
                                   const limb_t *y, size_t size)
 {
     // Subtract "y" from "x" and turn the borrow into an AND mask.
-    limb_t mask = sub_P(result, x, y, size);
-    mask = (~mask) + 1;
+    limb_t mask = ctMask(sub_P(result, x, y, size));
 
     // Add "y" back to the result if the mask is non-zero.
     dlimb_t carry = 0;
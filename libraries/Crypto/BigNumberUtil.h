@@ -28,9 +28,27 @@
 
 // Define exactly one of these to 1 to set the size of the basic limb type.
 // 16-bit limbs seem to give the best performance on 8-bit AVR micros.
-#define BIGNUMBER_LIMB_8BIT  0
+// 64-bit limbs are used on 64-bit hosts that support 128-bit products.
+#if !defined(BIGNUMBER_LIMB_8BIT) && !defined(BIGNUMBER_LIMB_16BIT) && \
+    !defined(BIGNUMBER_LIMB_32BIT) && !defined(BIGNUMBER_LIMB_64BIT)
+#if defined(__SIZEOF_INT128__) && !defined(__AVR__)
+#define BIGNUMBER_LIMB_64BIT 1
+#else
 #define BIGNUMBER_LIMB_16BIT 1
+#endif
+#endif
+#if !defined(BIGNUMBER_LIMB_8BIT)
+#define BIGNUMBER_LIMB_8BIT  0
+#endif
+#if !defined(BIGNUMBER_LIMB_16BIT)
+#define BIGNUMBER_LIMB_16BIT 0
+#endif
+#if !defined(BIGNUMBER_LIMB_32BIT)
 #define BIGNUMBER_LIMB_32BIT 0
+#endif
+#if !defined(BIGNUMBER_LIMB_64BIT)
+#define BIGNUMBER_LIMB_64BIT 0
+#endif
 
 // Define the limb types to use on this platform.
 #if BIGNUMBER_LIMB_8BIT
@@ -45,8 +63,31 @@ typedef uint32_t dlimb_t;
 typedef uint32_t limb_t;
 typedef int32_t slimb_t;
 typedef uint64_t dlimb_t;
+#elif BIGNUMBER_LIMB_64BIT
+typedef uint64_t limb_t;
+typedef int64_t slimb_t;
+typedef unsigned __int128 dlimb_t;
 #else
-#error "limb_t must be 8, 16, or 32 bits in size"
+#error "limb_t must be 8, 16, 32, or 64 bits in size"
+#endif
+
+// Multiply operands of at least this many limbs with Karatsuba's method in
+// BigNumberUtil::mul() and mul_P() instead of the schoolbook method.  Set
+// to 0 to always use the schoolbook method, which is the default on AVR.
+// With 64-bit limbs the default is above BIGNUMBER_KARATSUBA_MAX_BITS
+// because the schoolbook method is faster for all supported sizes.
+#if !defined(BIGNUMBER_KARATSUBA_THRESHOLD)
+#if defined(__AVR__)
+#define BIGNUMBER_KARATSUBA_THRESHOLD 0
+#else
+#define BIGNUMBER_KARATSUBA_THRESHOLD 48
+#endif
+#endif
+
+// Largest operand size in bits that Karatsuba's method is used for.
+// The scratch space on the stack is about 5 times this size.
+#if !defined(BIGNUMBER_KARATSUBA_MAX_BITS)
+#define BIGNUMBER_KARATSUBA_MAX_BITS 2048
 #endif
 
 class BigNumberUtil
@@ -83,6 +124,16 @@ private:
     // Constructor and destructor are private - cannot instantiate this class.
     BigNumberUtil() {}
     ~BigNumberUtil() {}
+
+    static void mulBasic(limb_t *result, const limb_t *x, size_t xcount,
+                         const limb_t *y, size_t ycount);
+    static void mulBasic_P(limb_t *result, const limb_t *x, size_t xcount,
+                           const limb_t *y, size_t ycount);
+#if BIGNUMBER_KARATSUBA_THRESHOLD
+    static size_t mulKaratsuba(limb_t *result, const limb_t *x, size_t xcount,
+                               const limb_t *y, size_t ycount, bool yprogmem,
+                               limb_t *scratch, size_t scratchSize);
+#endif
 };
 
 #endif
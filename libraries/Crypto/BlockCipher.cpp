@@ -112,6 +112,62 @@ BlockCipher::~BlockCipher()
  * \sa encryptBlock(), blockSize()
  */
 
+/**
+ * \brief Encrypts multiple consecutive blocks using this cipher.
+ *
+ * \param output The output buffer to put the ciphertext into.
+ * Must be at least \a nblocks * blockSize() bytes in length.
+ * \param input The input buffer to read the plaintext from which is
+ * allowed to be the same as \a output.  Must be at least
+ * \a nblocks * blockSize() bytes in length.
+ * \param nblocks The number of blocks to encrypt.
+ *
+ * The default implementation calls encryptBlock() for each block in turn.
+ * Subclasses can override this to avoid the cost of a virtual function
+ * call per block and to keep the key schedule close at hand across blocks.
+ * Modes such as CTR and GCM use this to generate several keystream blocks
+ * at once.
+ *
+ * \sa encryptBlock(), decryptBlocks()
+ */
+void BlockCipher::encryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks)
+{
+    size_t size = blockSize();
+    while (nblocks > 0) {
+        encryptBlock(output, input);
+        output += size;
+        input += size;
+        --nblocks;
+    }
+}
+
+/**
+ * \brief Decrypts multiple consecutive blocks using this cipher.
+ *
+ * \param output The output buffer to put the plaintext into.
+ * Must be at least \a nblocks * blockSize() bytes in length.
+ * \param input The input buffer to read the ciphertext from which is
+ * allowed to be the same as \a output.  Must be at least
+ * \a nblocks * blockSize() bytes in length.
+ * \param nblocks The number of blocks to decrypt.
+ *
+ * The default implementation calls decryptBlock() for each block in turn.
+ * Modes such as CBC, whose decryption does not depend on the previous
+ * block's output, use this to decrypt several blocks at once.
+ *
+ * \sa decryptBlock(), encryptBlocks()
+ */
+void BlockCipher::decryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks)
+{
+    size_t size = blockSize();
+    while (nblocks > 0) {
+        decryptBlock(output, input);
+        output += size;
+        input += size;
+        --nblocks;
+    }
+}
+
 /**
  * \fn void BlockCipher::clear()
  * \brief Clears all security-sensitive state from this block cipher.
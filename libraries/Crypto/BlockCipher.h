@@ -26,6 +26,17 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+// Maximum number of blocks that the cipher modes pass to a single call of
+// BlockCipher::encryptBlocks() or decryptBlocks().  Each block in a batch
+// costs 16 bytes of stack in the mode, so AVR does one block at a time.
+#if !defined(CRYPTO_BATCH_BLOCKS)
+#if defined(__AVR__)
+#define CRYPTO_BATCH_BLOCKS 1
+#else
+#define CRYPTO_BATCH_BLOCKS 4
+#endif
+#endif
+
 class BlockCipher
 {
 public:
@@ -40,6 +51,9 @@ public:
     virtual void encryptBlock(uint8_t *output, const uint8_t *input) = 0;
     virtual void decryptBlock(uint8_t *output, const uint8_t *input) = 0;
 
+    virtual void encryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks);
+    virtual void decryptBlocks(uint8_t *output, const uint8_t *input, size_t nblocks);
+
     virtual void clear() = 0;
 };
 
@@ -22,6 +22,7 @@
 
 #include "CBC.h"
 #include "Crypto.h"
+#include "utility/XorUtil.h"
 #include <string.h>
 
 /**
@@ -85,31 +86,65 @@ bool CBCCommon::setIV(const uint8_t *iv, size_t len)
 
 void CBCCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
-    uint8_t posn;
     while (len >= 16) {
-        for (posn = 0; posn < 16; ++posn)
-            iv[posn] ^= *input++;
+        xorBytesInPlace(iv, input, 16);
         blockCipher->encryptBlock(iv, iv);
-        for (posn = 0; posn < 16; ++posn)
-            *output++ = iv[posn];
+        memcpy(output, iv, 16);
+        input += 16;
+        output += 16;
         len -= 16;
     }
 }
 
 void CBCCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
-    uint8_t posn;
+#if CRYPTO_BATCH_BLOCKS > 1
+    if (len >= 32) {
+        // Unlike encryption, the block cipher step of CBC decryption does
+        // not depend upon the previous output, so decrypt several blocks
+        // at once and then XOR each with the ciphertext block before it.
+        // The chaining values are copied out first in case the
+        // decryption is being done in place.
+        uint8_t chain[CRYPTO_BATCH_BLOCKS * 16];
+        do {
+            size_t nblocks = len / 16;
+            if (nblocks > CRYPTO_BATCH_BLOCKS)
+                nblocks = CRYPTO_BATCH_BLOCKS;
+            size_t size = nblocks * 16;
+            memcpy(chain, iv, 16);
+            memcpy(chain + 16, input, size - 16);
+            memcpy(iv, input + size - 16, 16);
+            blockCipher->decryptBlocks(output, input, nblocks);
+            xorBytesInPlace(output, chain, size);
+            output += size;
+            input += size;
+            len -= size;
+        } while (len >= 16);
+        clean(chain);
+        return;
+    }
+#endif
     while (len >= 16) {
         blockCipher->decryptBlock(temp, input);
-        for (posn = 0; posn < 16; ++posn) {
-            uint8_t in = *input++;
-            *output++ = temp[posn] ^ iv[posn];
-            iv[posn] = in;
-        }
+        xorBytesInPlace(temp, iv, 16);
+        memcpy(iv, input, 16);
+        memcpy(output, temp, 16);
+        input += 16;
+        output += 16;
         len -= 16;
     }
 }
 
+void CBCCommon::encryptv(const CipherSegment *segments, size_t count)
+{
+    processv(segments, count, true);
+}
+
+void CBCCommon::decryptv(const CipherSegment *segments, size_t count)
+{
+    processv(segments, count, false);
+}
+
 void CBCCommon::clear()
 {
     blockCipher->clear();
@@ -118,6 +153,74 @@ void CBCCommon::clear()
     posn = 16;
 }
 
+/**
+ * \brief Encrypts or decrypts a list of segments in place.
+ *
+ * \param segments Points to the segments to process.
+ * \param count The number of segments in the list.
+ * \param enc Set to true to encrypt or false to decrypt.
+ *
+ * Whole blocks within a segment are processed directly.  A block that
+ * straddles a segment boundary is gathered into a temporary buffer,
+ * processed, and then scattered back.  As with encrypt(), any trailing
+ * bytes that do not make up a whole block are left unchanged.
+ */
+void CBCCommon::processv(const CipherSegment *segments, size_t count, bool enc)
+{
+    uint8_t block[16];
+    size_t seg = 0;
+    size_t offset = 0;
+    while (seg < count) {
+        size_t avail = segments[seg].len - offset;
+        uint8_t *ptr = segments[seg].data + offset;
+        if (avail >= 16) {
+            // Process all whole blocks in this segment directly.
+            avail &= ~((size_t)15);
+            if (enc)
+                encrypt(ptr, ptr, avail);
+            else
+                decrypt(ptr, ptr, avail);
+            offset += avail;
+            continue;
+        } else if (!avail) {
+            ++seg;
+            offset = 0;
+            continue;
+        }
+
+        // The next block straddles a segment boundary, so gather it.
+        size_t s = seg;
+        size_t o = offset;
+        uint8_t n = 0;
+        while (n < 16 && s < count) {
+            if (o < segments[s].len) {
+                block[n++] = segments[s].data[o++];
+            } else {
+                ++s;
+                o = 0;
+            }
+        }
+        if (n < 16)
+            break;
+        if (enc)
+            encrypt(block, block, 16);
+        else
+            decrypt(block, block, 16);
+
+        // Scatter the processed block back into the segments.
+        n = 0;
+        while (n < 16) {
+            if (offset < segments[seg].len) {
+                segments[seg].data[offset++] = block[n++];
+            } else {
+                ++seg;
+                offset = 0;
+            }
+        }
+    }
+    clean(block);
+}
+
 /**
  * \fn void CBCCommon::setBlockCipher(BlockCipher *cipher)
  * \brief Sets the block cipher to use for this CBC object.
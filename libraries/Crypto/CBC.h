@@ -40,6 +40,9 @@ public:
     void encrypt(uint8_t *output, const uint8_t *input, size_t len);
     void decrypt(uint8_t *output, const uint8_t *input, size_t len);
 
+    void encryptv(const CipherSegment *segments, size_t count);
+    void decryptv(const CipherSegment *segments, size_t count);
+
     void clear();
 
 protected:
@@ -51,6 +54,8 @@ private:
     uint8_t iv[16];
     uint8_t temp[16];
     uint8_t posn;
+
+    void processv(const CipherSegment *segments, size_t count, bool enc);
 };
 
 template <typename T>
@@ -22,6 +22,7 @@
 
 #include "CFB.h"
 #include "Crypto.h"
+#include "utility/XorUtil.h"
 #include <string.h>
 
 /**
@@ -101,11 +102,10 @@ void CFBCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
         if (size > len)
             size = len;
         len -= size;
-        while (size > 0) {
-            iv[posn] ^= *input++;
-            *output++ = iv[posn++];
-            --size;
-        }
+        xorBytesFeedback(output, iv + posn, input, size);
+        output += size;
+        input += size;
+        posn += size;
     }
 }
 
@@ -116,6 +116,31 @@ void CFBCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
         // If we have exhausted the current keystream block, then encrypt
         // the IV/ciphertext to get another keystream block.
         if (posn >= 16) {
+#if CRYPTO_BATCH_BLOCKS > 1
+            if (len >= 32) {
+                // The keystream for each block is the encryption of the
+                // previous ciphertext block, all of which we already have.
+                // Encrypt several of them at once and XOR the results
+                // with the ciphertext to get the plaintext.
+                uint8_t stream[CRYPTO_BATCH_BLOCKS * 16];
+                do {
+                    size_t nblocks = len / 16;
+                    if (nblocks > CRYPTO_BATCH_BLOCKS)
+                        nblocks = CRYPTO_BATCH_BLOCKS;
+                    size_t bytes = nblocks * 16;
+                    memcpy(stream, iv, 16);
+                    memcpy(stream + 16, input, bytes - 16);
+                    memcpy(iv, input + bytes - 16, 16);
+                    blockCipher->encryptBlocks(stream, stream, nblocks);
+                    xorBytes(output, input, stream, bytes);
+                    output += bytes;
+                    input += bytes;
+                    len -= bytes;
+                } while (len >= 16);
+                clean(stream);
+                continue;
+            }
+#endif
             blockCipher->encryptBlock(iv, iv);
             posn = 0;
         }
@@ -128,12 +153,10 @@ void CFBCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
         if (size > len)
             size = len;
         len -= size;
-        while (size > 0) {
-            uint8_t in = *input++;
-            *output++ = iv[posn] ^ in;
-            iv[posn++] = in;
-            --size;
-        }
+        xorBytesChain(output, iv + posn, input, size);
+        output += size;
+        input += size;
+        posn += size;
     }
 }
 
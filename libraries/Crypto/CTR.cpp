@@ -22,6 +22,8 @@
 
 #include "CTR.h"
 #include "Crypto.h"
+#include "CryptoWorker.h"
+#include "utility/XorUtil.h"
 #include <string.h>
 
 /**
@@ -43,6 +45,11 @@ CTRCommon::CTRCommon()
     : blockCipher(0)
     , posn(16)
     , counterStart(0)
+    , ahead(0)
+    , aheadBlocks(0)
+    , aheadFirst(0)
+    , aheadCount(0)
+    , worker(0)
 {
 }
 
@@ -88,6 +95,7 @@ bool CTRCommon::setCounterSize(size_t size)
     if (size < 1 || size > 16)
         return false;
     counterStart = 16 - size;
+    discardLookAhead();
     return true;
 }
 
@@ -98,6 +106,7 @@ bool CTRCommon::setKey(const uint8_t *key, size_t len)
         return false;
 
     // Set the key on the underlying block cipher.
+    discardLookAhead();
     return blockCipher->setKey(key, len);
 }
 
@@ -122,38 +131,173 @@ bool CTRCommon::setIV(const uint8_t *iv, size_t len)
         return false;
     memcpy(counter, iv, len);
     posn = 16;
+    discardLookAhead();
     return true;
 }
 
+// Minimum number of bytes to encrypt before the work is split between
+// the cores of a CryptoWorker.
+#define CTR_WORKER_MIN_BYTES 1024
+
+/**
+ * \brief Increments the counter block.
+ *
+ * \param counter The counter block to increment.
+ * \param counterStart The first byte in the counter region.
+ *
+ * To avoid revealing any timing information about the starting value,
+ * we iterate through the entire counter region even if we could stop
+ * earlier because a byte is non-zero.
+ */
+static inline void increment(uint8_t counter[16], uint8_t counterStart)
+{
+    uint16_t temp = 1;
+    uint8_t index = 16;
+    while (index > counterStart) {
+        --index;
+        temp += counter[index];
+        counter[index] = (uint8_t)temp;
+        temp >>= 8;
+    }
+}
+
+/**
+ * \brief Adds a block count to the counter block.
+ *
+ * \param counter The counter block to add to.
+ * \param counterStart The first byte in the counter region.
+ * \param n The number of blocks to add.
+ */
+static void addCounter(uint8_t counter[16], uint8_t counterStart, size_t n)
+{
+    uint8_t index = 16;
+    while (index > counterStart) {
+        --index;
+        n += counter[index];
+        counter[index] = (uint8_t)n;
+        n >>= 8;
+    }
+}
+
+/**
+ * \brief Encrypts whole blocks in batches of CRYPTO_BATCH_BLOCKS.
+ *
+ * \param cipher The block cipher to use to generate the keystream.
+ * \param counter The counter block, which is incremented once per block.
+ * \param counterStart The first byte in the counter region.
+ * \param output The output buffer.
+ * \param input The input buffer.
+ * \param nblocks The number of whole blocks to encrypt.
+ *
+ * The keystream is XOR'ed straight into the output.
+ */
+static void encryptBlocks(BlockCipher *cipher, uint8_t counter[16],
+                          uint8_t counterStart, uint8_t *output,
+                          const uint8_t *input, size_t nblocks)
+{
+    uint8_t stream[CRYPTO_BATCH_BLOCKS * 16];
+    while (nblocks > 0) {
+        size_t batch = nblocks;
+        if (batch > CRYPTO_BATCH_BLOCKS)
+            batch = CRYPTO_BATCH_BLOCKS;
+        for (size_t index = 0; index < batch; ++index) {
+            memcpy(stream + index * 16, counter, 16);
+            increment(counter, counterStart);
+        }
+        cipher->encryptBlocks(stream, stream, batch);
+        size_t size = batch * 16;
+        xorBytes(output, input, stream, size);
+        output += size;
+        input += size;
+        nblocks -= batch;
+    }
+    clean(stream);
+}
+
+// Range of blocks to be encrypted by a CryptoWorker job.
+struct CTRJob
+{
+    BlockCipher *cipher;
+    uint8_t counter[16];
+    uint8_t counterStart;
+    uint8_t *output;
+    const uint8_t *input;
+    size_t nblocks;
+};
+
+static void encryptJob(void *arg)
+{
+    CTRJob *job = (CTRJob *)arg;
+    encryptBlocks(job->cipher, job->counter, job->counterStart,
+                  job->output, job->input, job->nblocks);
+}
+
 void CTRCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
     while (len > 0) {
-        if (posn >= 16) {
+        if (posn >= 16 && aheadCount > 0) {
+            // Take the next block of keystream from the look-ahead buffer.
+            uint8_t *block = ahead + aheadFirst * 16;
+            memcpy(state, block, 16);
+            clean(block, 16);
+            if (++aheadFirst >= aheadBlocks)
+                aheadFirst = 0;
+            --aheadCount;
+            posn = 0;
+        } else if (posn >= 16) {
+            if (worker && len >= CTR_WORKER_MIN_BYTES) {
+                // Split the remaining whole blocks in half and let the
+                // worker encrypt both halves at the same time.
+                size_t nblocks = len / 16;
+                CTRJob jobs[2];
+                void *args[2] = {&jobs[0], &jobs[1]};
+                jobs[0].cipher = blockCipher;
+                memcpy(jobs[0].counter, counter, 16);
+                jobs[0].counterStart = counterStart;
+                jobs[0].output = output;
+                jobs[0].input = input;
+                jobs[0].nblocks = nblocks / 2;
+                jobs[1] = jobs[0];
+                addCounter(jobs[1].counter, counterStart, jobs[0].nblocks);
+                jobs[1].output += jobs[0].nblocks * 16;
+                jobs[1].input += jobs[0].nblocks * 16;
+                jobs[1].nblocks = nblocks - jobs[0].nblocks;
+                worker->run(encryptJob, args, 2);
+                memcpy(counter, jobs[1].counter, 16);
+                clean(jobs);
+                size_t size = nblocks * 16;
+                output += size;
+                input += size;
+                len -= size;
+                continue;
+            }
+#if CRYPTO_BATCH_BLOCKS > 1
+            if (len >= 32) {
+                // Encrypt all remaining whole blocks in batches.
+                size_t nblocks = len / 16;
+                encryptBlocks(blockCipher, counter, counterStart,
+                              output, input, nblocks);
+                size_t size = nblocks * 16;
+                output += size;
+                input += size;
+                len -= size;
+                continue;
+            }
+#endif
+
             // Generate a new encrypted counter block.
             blockCipher->encryptBlock(state, counter);
             posn = 0;
-
-            // Increment the counter, taking care not to reveal
-            // any timing information about the starting value.
-            // We iterate through the entire counter region even
-            // if we could stop earlier because a byte is non-zero.
-            uint16_t temp = 1;
-            uint8_t index = 16;
-            while (index > counterStart) {
-                --index;
-                temp += counter[index];
-                counter[index] = (uint8_t)temp;
-                temp >>= 8;
-            }
+            increment(counter, counterStart);
         }
         uint8_t templen = 16 - posn;
         if (templen > len)
             templen = len;
         len -= templen;
-        while (templen > 0) {
-            *output++ = *input++ ^ state[posn++];
-            --templen;
-        }
+        xorBytes(output, input, state + posn, templen);
+        output += templen;
+        input += templen;
+        posn += templen;
     }
 }
 
@@ -168,8 +312,127 @@ void CTRCommon::clear()
     clean(counter);
     clean(state);
     posn = 16;
+    discardLookAhead();
+}
+
+/**
+ * \brief Sets a buffer to hold keystream that is generated ahead of time.
+ *
+ * \param buffer The buffer to use, or NULL to disable look-ahead.
+ * \param size The size of the buffer in bytes.  This is rounded down to
+ * a multiple of 16 bytes, the size of a keystream block.
+ *
+ * The buffer is filled by precompute(), which would normally be called
+ * from loop() or a timer when the application is otherwise idle.
+ * Later calls to encrypt() and decrypt() XOR the input with the buffered
+ * keystream and only run the block cipher once the buffer is empty.
+ * This takes the block cipher off the critical path for packets that
+ * are encrypted at time-critical moments.  The output is identical
+ * to that produced without a look-ahead buffer.
+ *
+ * The buffer is owned by the caller and must stay valid until this
+ * object is destroyed or look-ahead is disabled.  It holds keystream,
+ * so the caller should not examine it or share it with other objects.
+ * Any keystream that is already in the buffer is discarded by this
+ * function and by setKey(), setIV(), setCounterSize(), and clear().
+ *
+ * \note precompute() must not be called from an interrupt handler
+ * while encrypt() or decrypt() is running, or vice versa.
+ *
+ * \sa precompute(), available()
+ */
+void CTRCommon::setLookAhead(uint8_t *buffer, size_t size)
+{
+    discardLookAhead();
+    ahead = buffer;
+    aheadBlocks = buffer ? (size / 16) : 0;
+}
+
+/**
+ * \brief Generates keystream blocks into the look-ahead buffer.
+ *
+ * \param maxBlocks The maximum number of blocks to generate, which can
+ * be used to limit how long this function runs for.  The default is
+ * to fill the buffer.
+ * \return The number of blocks that were generated, which will be zero
+ * if the buffer is already full or there is no look-ahead buffer.
+ *
+ * The key and IV must be set before this function is called.
+ *
+ * \sa setLookAhead(), available()
+ */
+size_t CTRCommon::precompute(size_t maxBlocks)
+{
+    size_t total = 0;
+    while (aheadCount < aheadBlocks && total < maxBlocks) {
+        // Generate as many blocks as will fit before the end of the
+        // buffer wraps around, so that they can be encrypted in one call.
+        size_t next = aheadFirst + aheadCount;
+        if (next >= aheadBlocks)
+            next -= aheadBlocks;
+        size_t nblocks = aheadBlocks - aheadCount;
+        if (nblocks > (aheadBlocks - next))
+            nblocks = aheadBlocks - next;
+        if (nblocks > (maxBlocks - total))
+            nblocks = maxBlocks - total;
+        uint8_t *block = ahead + next * 16;
+        for (size_t index = 0; index < nblocks; ++index) {
+            memcpy(block + index * 16, counter, 16);
+            increment(counter, counterStart);
+        }
+        blockCipher->encryptBlocks(block, block, nblocks);
+        aheadCount += nblocks;
+        total += nblocks;
+    }
+    return total;
 }
 
+/**
+ * \brief Returns the number of bytes of keystream that are ready to use
+ * without running the block cipher.
+ *
+ * This includes the rest of the current keystream block and the
+ * contents of the look-ahead buffer.
+ *
+ * \sa precompute()
+ */
+size_t CTRCommon::available() const
+{
+    return (16 - posn) + aheadCount * 16;
+}
+
+/**
+ * \brief Discards the contents of the look-ahead buffer.
+ */
+void CTRCommon::discardLookAhead()
+{
+    if (ahead)
+        clean(ahead, aheadBlocks * 16);
+    aheadFirst = 0;
+    aheadCount = 0;
+}
+
+/**
+ * \fn void CTRCommon::setWorker(CryptoWorker *worker)
+ * \brief Sets a worker to share the encryption of long inputs between
+ * the cores of the processor.
+ *
+ * \param worker The worker to use, or NULL to encrypt on the calling
+ * task only.
+ *
+ * When encrypt() or decrypt() is asked to process at least 1024 bytes,
+ * the whole blocks are split into two halves with their own counters
+ * and are handed to CryptoWorker::run().  The output is identical to
+ * that produced without a worker.
+ *
+ * The block cipher must allow two encryptions with the same key to run
+ * at once.  This is true of the AES classes on 32-bit platforms.  On
+ * ESP32 the AES peripheral is shared between the cores, so this is of
+ * most benefit when CRYPTO_AES_HW is disabled or with other ciphers.
+ *
+ * \sa CryptoWorker
+ */
+
 /**
  * \fn void CTRCommon::setBlockCipher(BlockCipher *cipher)
  * \brief Sets the block cipher to use for this CTR object.
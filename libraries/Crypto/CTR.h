@@ -26,6 +26,8 @@
 #include "Cipher.h"
 #include "BlockCipher.h"
 
+class CryptoWorker;
+
 class CTRCommon : public Cipher
 {
 public:
@@ -44,6 +46,12 @@ public:
 
     void clear();
 
+    void setLookAhead(uint8_t *buffer, size_t size);
+    size_t precompute(size_t maxBlocks = (size_t)-1);
+    size_t available() const;
+
+    void setWorker(CryptoWorker *worker) { this->worker = worker; }
+
 protected:
     CTRCommon();
     void setBlockCipher(BlockCipher *cipher) { blockCipher = cipher; }
@@ -54,6 +62,13 @@ private:
     uint8_t state[16];
     uint8_t posn;
     uint8_t counterStart;
+    uint8_t *ahead;
+    size_t aheadBlocks;
+    size_t aheadFirst;
+    size_t aheadCount;
+    CryptoWorker *worker;
+
+    void discardLookAhead();
 };
 
 template <typename T>
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CTRMode.h"
+
+/**
+ * \class CTRMode CTRMode.h <CTRMode.h>
+ * \brief Counter (CTR) mode for 128-bit block ciphers with static dispatch.
+ *
+ * This class produces the same output as CTR<T> but calls the block cipher
+ * T directly rather than through the BlockCipher virtual interface.  The
+ * compiler can inline the block cipher into encrypt() and decrypt(), and
+ * unused virtual methods can be discarded by the linker.
+ *
+ * \code
+ * CTRMode<AES128> ctr;
+ * ctr.setKey(key, 16);
+ * ctr.setIV(iv, 16);
+ * ctr.encrypt(output, input, len);
+ * \endcode
+ *
+ * CTRMode is not a subclass of Cipher.  Use CTR<T> instead when the cipher
+ * object needs to be passed to code that takes a Cipher pointer, or when
+ * look-ahead keystream generation is required.
+ *
+ * The template parameter T must be a concrete block cipher class with a
+ * block size of 16 bytes, such as AES128 or AES256.
+ *
+ * \sa CTR
+ */
+
+/**
+ * \fn CTRMode::CTRMode()
+ * \brief Constructs a new CTRMode object for the 128-bit block cipher T.
+ */
+
+/**
+ * \fn CTRMode::~CTRMode()
+ * \brief Destroys this CTRMode object after clearing the counter state.
+ */
+
+/**
+ * \fn size_t CTRMode::keySize() const
+ * \brief Returns the default key size for the block cipher T.
+ */
+
+/**
+ * \fn size_t CTRMode::ivSize() const
+ * \brief Returns the size of the initial counter value, which is always 16.
+ */
+
+/**
+ * \fn bool CTRMode::setCounterSize(size_t size)
+ * \brief Sets the counter size for the IV.
+ *
+ * \param size The number of bytes on the end of the counter block
+ * that are relevant when incrementing, between 1 and 16.
+ * \return Returns false if the \a size value is not between 1 and 16.
+ *
+ * \sa CTRCommon::setCounterSize()
+ */
+
+/**
+ * \fn bool CTRMode::setKey(const uint8_t *key, size_t len)
+ * \brief Sets the key to use for the block cipher.
+ *
+ * \param key Points to the key.
+ * \param len Length of the key in bytes.
+ * \return Returns false if the key length is not supported by T,
+ * or T does not have a 16 byte block size.
+ */
+
+/**
+ * \fn bool CTRMode::setIV(const uint8_t *iv, size_t len)
+ * \brief Sets the initial counter value.
+ *
+ * \param iv The initial counter value which must contain exactly 16 bytes.
+ * \param len The length of the counter value, which must be 16.
+ * \return Returns false if \a len is not exactly 16.
+ */
+
+/**
+ * \fn void CTRMode::encrypt(uint8_t *output, const uint8_t *input, size_t len)
+ * \brief Encrypts an input buffer and writes the ciphertext to an
+ * output buffer.
+ *
+ * \param output The output buffer to write to, which may be the same
+ * buffer as \a input.
+ * \param input The input buffer to read from.
+ * \param len The number of bytes to encrypt.
+ *
+ * \sa decrypt()
+ */
+
+/**
+ * \fn void CTRMode::decrypt(uint8_t *output, const uint8_t *input, size_t len)
+ * \brief Decrypts an input buffer and writes the plaintext to an
+ * output buffer.  This is identical to encrypt().
+ */
+
+/**
+ * \fn void CTRMode::clear()
+ * \brief Clears all security-sensitive state from this object.
+ */
+
+/**
+ * \fn T &CTRMode::blockCipher()
+ * \brief Returns a reference to the underlying block cipher object.
+ */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CTRMODE_h
+#define CRYPTO_CTRMODE_h
+
+#include "BlockCipher.h"
+#include "Crypto.h"
+#include "utility/XorUtil.h"
+#include <string.h>
+
+template <typename T>
+class CTRMode
+{
+public:
+    CTRMode() : posn(16), counterStart(0) {}
+    ~CTRMode() { clean(counter); clean(state); }
+
+    size_t keySize() const { return cipher.T::keySize(); }
+    size_t ivSize() const { return 16; }
+
+    bool setCounterSize(size_t size)
+    {
+        if (size < 1 || size > 16)
+            return false;
+        counterStart = 16 - size;
+        return true;
+    }
+
+    bool setKey(const uint8_t *key, size_t len)
+    {
+        if (cipher.T::blockSize() != 16)
+            return false;
+        return cipher.T::setKey(key, len);
+    }
+
+    bool setIV(const uint8_t *iv, size_t len)
+    {
+        if (len != 16)
+            return false;
+        memcpy(counter, iv, len);
+        posn = 16;
+        return true;
+    }
+
+    void encrypt(uint8_t *output, const uint8_t *input, size_t len)
+    {
+        while (len > 0) {
+            if (posn >= 16) {
+#if CRYPTO_BATCH_BLOCKS > 1
+                if (len >= 32) {
+                    uint8_t stream[CRYPTO_BATCH_BLOCKS * 16];
+                    do {
+                        size_t nblocks = len / 16;
+                        if (nblocks > CRYPTO_BATCH_BLOCKS)
+                            nblocks = CRYPTO_BATCH_BLOCKS;
+                        for (size_t index = 0; index < nblocks; ++index) {
+                            memcpy(stream + index * 16, counter, 16);
+                            increment();
+                        }
+                        cipher.T::encryptBlocks(stream, stream, nblocks);
+                        size_t size = nblocks * 16;
+                        xorBytes(output, input, stream, size);
+                        output += size;
+                        input += size;
+                        len -= size;
+                    } while (len >= 16);
+                    clean(stream);
+                    continue;
+                }
+#endif
+                cipher.T::encryptBlock(state, counter);
+                posn = 0;
+                increment();
+            }
+            uint8_t templen = 16 - posn;
+            if (templen > len)
+                templen = len;
+            len -= templen;
+            xorBytes(output, input, state + posn, templen);
+            output += templen;
+            input += templen;
+            posn += templen;
+        }
+    }
+
+    void decrypt(uint8_t *output, const uint8_t *input, size_t len)
+    {
+        encrypt(output, input, len);
+    }
+
+    void clear()
+    {
+        cipher.T::clear();
+        clean(counter);
+        clean(state);
+        posn = 16;
+    }
+
+    T &blockCipher() { return cipher; }
+
+private:
+    T cipher;
+    uint8_t counter[16];
+    uint8_t state[16];
+    uint8_t posn;
+    uint8_t counterStart;
+
+    void increment()
+    {
+        // Iterate over the whole counter region to avoid revealing
+        // timing information about the starting value.
+        uint16_t temp = 1;
+        uint8_t index = 16;
+        while (index > counterStart) {
+            --index;
+            temp += counter[index];
+            counter[index] = (uint8_t)temp;
+            temp >>= 8;
+        }
+    }
+
+    // Disable copy constructor and operator=().
+    CTRMode(const CTRMode<T> &) {}
+    CTRMode &operator=(const CTRMode<T> &) { return *this; }
+};
+
+#endif
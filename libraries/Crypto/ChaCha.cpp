@@ -22,11 +22,35 @@
 
 #include "ChaCha.h"
 #include "Crypto.h"
+#include "CryptoConfig.h"
 #include "utility/RotateUtil.h"
 #include "utility/EndianUtil.h"
 #include "utility/ProgMemUtil.h"
+#include "utility/XorUtil.h"
 #include <string.h>
 
+// Use SSE2 vector instructions for the two block hash core on x86 platforms.
+#if !defined(CRYPTO_CHACHA_SSE2)
+#if defined(__SSE2__)
+#define CRYPTO_CHACHA_SSE2 1
+#else
+#define CRYPTO_CHACHA_SSE2 0
+#endif
+#endif
+#if CRYPTO_CHACHA_SSE2
+#include <emmintrin.h>
+#endif
+
+// Use hand-written assembly for the quarter round on AVR.  GCC moves
+// and shifts each byte of the 32-bit words more than it needs to.
+#if !defined(CRYPTO_CHACHA_ASM_AVR)
+#if defined(__AVR__)
+#define CRYPTO_CHACHA_ASM_AVR 1
+#else
+#define CRYPTO_CHACHA_ASM_AVR 0
+#endif
+#endif
+
 /**
  * \class ChaCha ChaCha.h <ChaCha.h>
  * \brief ChaCha stream cipher.
@@ -84,10 +108,11 @@ size_t ChaCha::ivSize() const
  * \sa numRounds()
  */
 
+static const char tag128[] PROGMEM = "expand 16-byte k";
+static const char tag256[] PROGMEM = "expand 32-byte k";
+
 bool ChaCha::setKey(const uint8_t *key, size_t len)
 {
-    static const char tag128[] PROGMEM = "expand 16-byte k";
-    static const char tag256[] PROGMEM = "expand 32-byte k";
     if (len <= 16) {
         memcpy_P(block, tag128, 16);
         memcpy(block + 16, key, len);
@@ -155,35 +180,86 @@ bool ChaCha::setCounter(const uint8_t *counter, size_t len)
     }
 }
 
+// Generate two keystream blocks at a time with hashCore2() when there
+// is enough data.  AVR doesn't have the registers to benefit from this
+// and it would cost an extra 128 bytes of stack.
+#if defined(__AVR__)
+#define CHACHA_MULTI_BLOCK 0
+#else
+#define CHACHA_MULTI_BLOCK 1
+#endif
+
+/**
+ * \brief Adds a value to the 64-bit block counter in bytes 48 to 55.
+ *
+ * \param block The ChaCha input block.
+ * \param value The value to add to the counter.
+ *
+ * We iterate through the entire counter even if we could stop earlier
+ * because a byte is non-zero so as not to reveal any timing information
+ * about the starting value.
+ */
+static inline void addToCounter(uint8_t *block, uint8_t value)
+{
+    uint16_t temp = value;
+    uint8_t index = 48;
+    while (index < 56) {
+        temp += block[index];
+        block[index] = (uint8_t)temp;
+        temp >>= 8;
+        ++index;
+    }
+}
+
 void ChaCha::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
     while (len > 0) {
         if (posn >= 64) {
+#if CHACHA_MULTI_BLOCK
+            if (len >= 128) {
+                // Process pairs of blocks directly, without going via
+                // the "stream" buffer.
+                uint32_t blocks[32];
+                do {
+                    hashCore2(blocks, (const uint32_t *)block, rounds);
+                    addToCounter(block, 2);
+                    xorBytes(output, input, (const uint8_t *)blocks, 128);
+                    output += 128;
+                    input += 128;
+                    len -= 128;
+                } while (len >= 128);
+                clean(blocks);
+                continue;
+            }
+#endif
+
             // Generate a new encrypted counter block.
             hashCore((uint32_t *)stream, (const uint32_t *)block, rounds);
             posn = 0;
 
-            // Increment the counter, taking care not to reveal
-            // any timing information about the starting value.
-            // We iterate through the entire counter region even
-            // if we could stop earlier because a byte is non-zero.
-            uint16_t temp = 1;
-            uint8_t index = 48;
-            while (index < 56) {
-                temp += block[index];
-                block[index] = (uint8_t)temp;
-                temp >>= 8;
-                ++index;
+            // Increment the counter.
+            addToCounter(block, 1);
+
+#if CHACHA_MULTI_BLOCK
+            if (len >= 64) {
+                // Use the whole block at once.
+                xorBytes(output, input, stream, 64);
+                posn = 64;
+                output += 64;
+                input += 64;
+                len -= 64;
+                continue;
             }
+#endif
         }
         uint8_t templen = 64 - posn;
         if (templen > len)
             templen = len;
         len -= templen;
-        while (templen > 0) {
-            *output++ = *input++ ^ stream[posn++];
-            --templen;
-        }
+        xorBytes(output, input, stream + posn, templen);
+        output += templen;
+        input += templen;
+        posn += templen;
     }
 }
 
@@ -222,6 +298,109 @@ void ChaCha::clear()
     posn = 64;
 }
 
+#if CRYPTO_CHACHA_ASM_AVR
+
+/**
+ * \brief Performs a ChaCha quarter round operation in AVR assembly.
+ *
+ * Rotations by multiples of 8 bits are done by moving bytes around.
+ * The others are a byte rotation followed by 1-bit shifts.
+ */
+static inline void quarterRoundAVR(uint32_t &a, uint32_t &b,
+                                   uint32_t &c, uint32_t &d)
+{
+    __asm__ (
+        // a += b; d ^= a; d <<<= 16;
+        "add %A0,%A1\n"
+        "adc %B0,%B1\n"
+        "adc %C0,%C1\n"
+        "adc %D0,%D1\n"
+        "eor %A3,%A0\n"
+        "eor %B3,%B0\n"
+        "eor %C3,%C0\n"
+        "eor %D3,%D0\n"
+        "mov __tmp_reg__,%A3\n"
+        "mov %A3,%C3\n"
+        "mov %C3,__tmp_reg__\n"
+        "mov __tmp_reg__,%B3\n"
+        "mov %B3,%D3\n"
+        "mov %D3,__tmp_reg__\n"
+        // c += d; b ^= c; b <<<= 12;
+        "add %A2,%A3\n"
+        "adc %B2,%B3\n"
+        "adc %C2,%C3\n"
+        "adc %D2,%D3\n"
+        "eor %A1,%A2\n"
+        "eor %B1,%B2\n"
+        "eor %C1,%C2\n"
+        "eor %D1,%D2\n"
+        "mov __tmp_reg__,%D1\n"
+        "mov %D1,%C1\n"
+        "mov %C1,%B1\n"
+        "mov %B1,%A1\n"
+        "mov %A1,__tmp_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        // a += b; d ^= a; d <<<= 8;
+        "add %A0,%A1\n"
+        "adc %B0,%B1\n"
+        "adc %C0,%C1\n"
+        "adc %D0,%D1\n"
+        "eor %A3,%A0\n"
+        "eor %B3,%B0\n"
+        "eor %C3,%C0\n"
+        "eor %D3,%D0\n"
+        "mov __tmp_reg__,%D3\n"
+        "mov %D3,%C3\n"
+        "mov %C3,%B3\n"
+        "mov %B3,%A3\n"
+        "mov %A3,__tmp_reg__\n"
+        // c += d; b ^= c; b <<<= 7;
+        "add %A2,%A3\n"
+        "adc %B2,%B3\n"
+        "adc %C2,%C3\n"
+        "adc %D2,%D3\n"
+        "eor %A1,%A2\n"
+        "eor %B1,%B2\n"
+        "eor %C1,%C2\n"
+        "eor %D1,%D2\n"
+        "mov __tmp_reg__,%D1\n"
+        "mov %D1,%C1\n"
+        "mov %C1,%B1\n"
+        "mov %B1,%A1\n"
+        "mov %A1,__tmp_reg__\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        : "+r"(a), "+r"(b), "+r"(c), "+r"(d)
+    );
+}
+
+#define quarterRound(a, b, c, d) quarterRoundAVR((a), (b), (c), (d))
+
+#else
+
 // Perform a ChaCha quarter round operation.
 #define quarterRound(a, b, c, d)    \
     do { \
@@ -238,6 +417,51 @@ void ChaCha::clear()
         (c) = _c; \
     } while (0)
 
+#endif
+
+#if CRYPTO_CHACHA_SSE2
+
+// The SSE2 implementation of hashCore2() holds each row of the 4x4 state
+// in a vector register so that the four quarter rounds of a column or
+// diagonal round run in parallel.  The rows are rotated between the column
+// and diagonal rounds to line the diagonals up with the columns.  Two
+// blocks are interleaved to hide the latency of the shuffles.  This is
+// not used for hashCore() because a single block is slower than the
+// scalar code, which can use the native rotate instruction.
+
+#define vrotate(x, n) \
+    (_mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n))))
+#define vrotate16(x) \
+    (_mm_shufflehi_epi16(_mm_shufflelo_epi16((x), 0xB1), 0xB1))
+
+#define vquarterRound(a, b, c, d) \
+    do { \
+        (a) = _mm_add_epi32((a), (b)); \
+        (d) = vrotate16(_mm_xor_si128((d), (a))); \
+        (c) = _mm_add_epi32((c), (d)); \
+        (b) = vrotate(_mm_xor_si128((b), (c)), 12); \
+        (a) = _mm_add_epi32((a), (b)); \
+        (d) = vrotate(_mm_xor_si128((d), (a)), 8); \
+        (c) = _mm_add_epi32((c), (d)); \
+        (b) = vrotate(_mm_xor_si128((b), (c)), 7); \
+    } while (0)
+
+#define vdiagonalize(b, c, d) \
+    do { \
+        (b) = _mm_shuffle_epi32((b), 0x39); \
+        (c) = _mm_shuffle_epi32((c), 0x4E); \
+        (d) = _mm_shuffle_epi32((d), 0x93); \
+    } while (0)
+
+#define vundiagonalize(b, c, d) \
+    do { \
+        (b) = _mm_shuffle_epi32((b), 0x93); \
+        (c) = _mm_shuffle_epi32((c), 0x4E); \
+        (d) = _mm_shuffle_epi32((d), 0x39); \
+    } while (0)
+
+#endif // CRYPTO_CHACHA_SSE2
+
 /**
  * \brief Executes the ChaCha hash core on an input memory block.
  *
@@ -252,6 +476,65 @@ void ChaCha::clear()
  */
 void ChaCha::hashCore(uint32_t *output, const uint32_t *input, uint8_t rounds)
 {
+#if CRYPTO_CHACHA_UNROLL
+    // Keep the state in local variables so that the compiler can hold
+    // as much of it as possible in registers across the rounds.
+    uint32_t x0  = le32toh(input[0]);
+    uint32_t x1  = le32toh(input[1]);
+    uint32_t x2  = le32toh(input[2]);
+    uint32_t x3  = le32toh(input[3]);
+    uint32_t x4  = le32toh(input[4]);
+    uint32_t x5  = le32toh(input[5]);
+    uint32_t x6  = le32toh(input[6]);
+    uint32_t x7  = le32toh(input[7]);
+    uint32_t x8  = le32toh(input[8]);
+    uint32_t x9  = le32toh(input[9]);
+    uint32_t x10 = le32toh(input[10]);
+    uint32_t x11 = le32toh(input[11]);
+    uint32_t x12 = le32toh(input[12]);
+    uint32_t x13 = le32toh(input[13]);
+    uint32_t x14 = le32toh(input[14]);
+    uint32_t x15 = le32toh(input[15]);
+
+    // Perform the ChaCha rounds, four at a time where possible.
+    #define doubleRound() \
+        do { \
+            quarterRound(x0, x4, x8,  x12); \
+            quarterRound(x1, x5, x9,  x13); \
+            quarterRound(x2, x6, x10, x14); \
+            quarterRound(x3, x7, x11, x15); \
+            quarterRound(x0, x5, x10, x15); \
+            quarterRound(x1, x6, x11, x12); \
+            quarterRound(x2, x7, x8,  x13); \
+            quarterRound(x3, x4, x9,  x14); \
+        } while (0)
+    for (; rounds >= 4; rounds -= 4) {
+        doubleRound();
+        doubleRound();
+    }
+    if (rounds >= 2)
+        doubleRound();
+    #undef doubleRound
+
+    // Add the original input to the final output, convert back to
+    // little-endian, and return the result.
+    output[0]  = htole32(x0  + le32toh(input[0]));
+    output[1]  = htole32(x1  + le32toh(input[1]));
+    output[2]  = htole32(x2  + le32toh(input[2]));
+    output[3]  = htole32(x3  + le32toh(input[3]));
+    output[4]  = htole32(x4  + le32toh(input[4]));
+    output[5]  = htole32(x5  + le32toh(input[5]));
+    output[6]  = htole32(x6  + le32toh(input[6]));
+    output[7]  = htole32(x7  + le32toh(input[7]));
+    output[8]  = htole32(x8  + le32toh(input[8]));
+    output[9]  = htole32(x9  + le32toh(input[9]));
+    output[10] = htole32(x10 + le32toh(input[10]));
+    output[11] = htole32(x11 + le32toh(input[11]));
+    output[12] = htole32(x12 + le32toh(input[12]));
+    output[13] = htole32(x13 + le32toh(input[13]));
+    output[14] = htole32(x14 + le32toh(input[14]));
+    output[15] = htole32(x15 + le32toh(input[15]));
+#else
     uint8_t posn;
 
     // Copy the input buffer to the output prior to the first round
@@ -278,4 +561,156 @@ void ChaCha::hashCore(uint32_t *output, const uint32_t *input, uint8_t rounds)
     // little-endian, and return the result.
     for (posn = 0; posn < 16; ++posn)
         output[posn] = htole32(output[posn] + le32toh(input[posn]));
+#endif
+}
+
+/**
+ * \brief Derives a subkey from a key and a 128-bit nonce with HChaCha.
+ *
+ * \param output The 32-byte output subkey.
+ * \param key The 32-byte input key.
+ * \param nonce The 16-byte nonce.
+ * \param rounds Number of ChaCha rounds to perform; usually 20.
+ *
+ * HChaCha runs the ChaCha rounds over the constants, key, and nonce, and
+ * outputs words 0-3 and 12-15 of the result without the final addition
+ * of the input.  It is used by XChaCha to extend the nonce to 192 bits.
+ * This works by calling hashCore() and subtracting the input back out
+ * of the output words that we need, so it gets the same optimizations.
+ *
+ * Reference: https://tools.ietf.org/html/draft-irtf-cfrg-xchacha-03
+ *
+ * \sa hashCore()
+ */
+void ChaCha::hchacha(uint8_t *output, const uint8_t *key,
+                     const uint8_t *nonce, uint8_t rounds)
+{
+    uint32_t input[16];
+    uint32_t result[16];
+    uint8_t posn;
+    memcpy_P(input, tag256, 16);
+    memcpy(input + 4, key, 32);
+    memcpy(input + 12, nonce, 16);
+    hashCore(result, input, rounds);
+    for (posn = 0; posn < 4; ++posn) {
+        result[posn] = htole32(le32toh(result[posn]) - le32toh(input[posn]));
+        result[posn + 12] = htole32(le32toh(result[posn + 12]) -
+                                    le32toh(input[posn + 12]));
+    }
+    memcpy(output, result, 16);
+    memcpy(output + 16, result + 12, 16);
+    clean(input);
+    clean(result);
+}
+
+/**
+ * \brief Executes the ChaCha hash core on two consecutive counter blocks.
+ *
+ * \param output Output memory block, must be at least 32 words in length
+ * and must not overlap with \a input.
+ * \param input Input memory block, must be at least 16 words in length.
+ * \param rounds Number of ChaCha rounds to perform; usually 8, 12, or 20.
+ *
+ * The first 16 words of \a output are set to the same value as for
+ * hashCore().  The next 16 words are set to the output for \a input with
+ * the 64-bit counter in words 12 and 13 incremented by 1.  The rounds for
+ * the two blocks are interleaved so that processors with enough registers
+ * can execute them in parallel.
+ *
+ * \sa hashCore()
+ */
+void ChaCha::hashCore2(uint32_t *output, const uint32_t *input, uint8_t rounds)
+{
+#if CRYPTO_CHACHA_SSE2
+    // x86 is little-endian so no byte swapping is required.
+    const __m128i *in = (const __m128i *)input;
+    __m128i *out = (__m128i *)output;
+    __m128i a1 = _mm_loadu_si128(in);
+    __m128i b1 = _mm_loadu_si128(in + 1);
+    __m128i c1 = _mm_loadu_si128(in + 2);
+    __m128i d1 = _mm_loadu_si128(in + 3);
+
+    // Add 1 to the 64-bit counter in the low half of the last row.
+    // The carry out of word 12 is detected by comparing the sum against
+    // 0 after the addition and is then added to word 13.
+    __m128i one = _mm_set_epi32(0, 0, 0, 1);
+    __m128i d2 = _mm_add_epi32(d1, one);
+    __m128i carry = _mm_and_si128(_mm_cmpeq_epi32(d2, _mm_setzero_si128()), one);
+    d2 = _mm_add_epi32(d2, _mm_slli_si128(carry, 4));
+    __m128i a2 = a1;
+    __m128i b2 = b1;
+    __m128i c2 = c1;
+    __m128i d2in = d2;
+
+    for (; rounds >= 2; rounds -= 2) {
+        vquarterRound(a1, b1, c1, d1);
+        vquarterRound(a2, b2, c2, d2);
+        vdiagonalize(b1, c1, d1);
+        vdiagonalize(b2, c2, d2);
+        vquarterRound(a1, b1, c1, d1);
+        vquarterRound(a2, b2, c2, d2);
+        vundiagonalize(b1, c1, d1);
+        vundiagonalize(b2, c2, d2);
+    }
+
+    __m128i a = _mm_loadu_si128(in);
+    __m128i b = _mm_loadu_si128(in + 1);
+    __m128i c = _mm_loadu_si128(in + 2);
+    _mm_storeu_si128(out,     _mm_add_epi32(a1, a));
+    _mm_storeu_si128(out + 1, _mm_add_epi32(b1, b));
+    _mm_storeu_si128(out + 2, _mm_add_epi32(c1, c));
+    _mm_storeu_si128(out + 3, _mm_add_epi32(d1, _mm_loadu_si128(in + 3)));
+    _mm_storeu_si128(out + 4, _mm_add_epi32(a2, a));
+    _mm_storeu_si128(out + 5, _mm_add_epi32(b2, b));
+    _mm_storeu_si128(out + 6, _mm_add_epi32(c2, c));
+    _mm_storeu_si128(out + 7, _mm_add_epi32(d2, d2in));
+#else
+    uint32_t *x = output;
+    uint32_t *y = output + 16;
+    uint8_t posn;
+
+    // Copy the input buffer to both outputs prior to the first round
+    // and convert from little-endian to host byte order.  Then form
+    // the counter for the second block.
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = y[posn] = le32toh(input[posn]);
+    uint64_t counter = ((((uint64_t)(x[13])) << 32) | x[12]) + 1;
+    y[12] = (uint32_t)counter;
+    y[13] = (uint32_t)(counter >> 32);
+
+    // Perform the ChaCha rounds in sets of two.
+    for (; rounds >= 2; rounds -= 2) {
+        // Column round.
+        quarterRound(x[0], x[4], x[8],  x[12]);
+        quarterRound(y[0], y[4], y[8],  y[12]);
+        quarterRound(x[1], x[5], x[9],  x[13]);
+        quarterRound(y[1], y[5], y[9],  y[13]);
+        quarterRound(x[2], x[6], x[10], x[14]);
+        quarterRound(y[2], y[6], y[10], y[14]);
+        quarterRound(x[3], x[7], x[11], x[15]);
+        quarterRound(y[3], y[7], y[11], y[15]);
+
+        // Diagonal round.
+        quarterRound(x[0], x[5], x[10], x[15]);
+        quarterRound(y[0], y[5], y[10], y[15]);
+        quarterRound(x[1], x[6], x[11], x[12]);
+        quarterRound(y[1], y[6], y[11], y[12]);
+        quarterRound(x[2], x[7], x[8],  x[13]);
+        quarterRound(y[2], y[7], y[8],  y[13]);
+        quarterRound(x[3], x[4], x[9],  x[14]);
+        quarterRound(y[3], y[4], y[9],  y[14]);
+    }
+
+    // Add the original input to the final outputs, convert back
+    // to little-endian, and return the result.
+    for (posn = 0; posn < 16; ++posn) {
+        uint32_t in = le32toh(input[posn]);
+        x[posn] = htole32(x[posn] + in);
+        if (posn == 12)
+            in = (uint32_t)counter;
+        else if (posn == 13)
+            in = (uint32_t)(counter >> 32);
+        y[posn] = htole32(y[posn] + in);
+    }
+#endif
 }
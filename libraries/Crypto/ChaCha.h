@@ -49,6 +49,9 @@ public:
     void clear();
 
     static void hashCore(uint32_t *output, const uint32_t *input, uint8_t rounds);
+    static void hashCore2(uint32_t *output, const uint32_t *input, uint8_t rounds);
+    static void hchacha(uint8_t *output, const uint8_t *key,
+                        const uint8_t *nonce, uint8_t rounds = 20);
 
 private:
     uint8_t block[64];
@@ -99,6 +99,7 @@ bool ChaChaPoly::setIV(const uint8_t *iv, size_t len)
     state.dataSize = 0;
     state.dataStarted = false;
     state.ivSize = len;
+    return true;
 }
 
 void ChaChaPoly::encrypt(uint8_t *output, const uint8_t *input, size_t len)
@@ -107,9 +108,19 @@ void ChaChaPoly::encrypt(uint8_t *output, const uint8_t *input, size_t len)
         poly1305.pad();
         state.dataStarted = true;
     }
-    chacha.encrypt(output, input, len);
-    poly1305.update(output, len);
-    state.dataSize += len;
+    // Authenticate each keystream block's worth of ciphertext as soon as
+    // it has been produced, while it is still in the cache.
+    while (len > 0) {
+        size_t size = 64 - (uint8_t)(state.dataSize % 64);
+        if (size > len)
+            size = len;
+        chacha.encrypt(output, input, size);
+        poly1305.update(output, size);
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
+    }
 }
 
 void ChaChaPoly::decrypt(uint8_t *output, const uint8_t *input, size_t len)
@@ -118,9 +129,17 @@ void ChaChaPoly::decrypt(uint8_t *output, const uint8_t *input, size_t len)
         poly1305.pad();
         state.dataStarted = true;
     }
-    poly1305.update(input, len);
-    chacha.encrypt(output, input, len); // encrypt() is the same as decrypt()
-    state.dataSize += len;
+    while (len > 0) {
+        size_t size = 64 - (uint8_t)(state.dataSize % 64);
+        if (size > len)
+            size = len;
+        poly1305.update(input, size);
+        chacha.encrypt(output, input, size); // encrypt() is the same as decrypt()
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
+    }
 }
 
 void ChaChaPoly::addAuthData(const void *data, size_t len)
@@ -167,3 +186,107 @@ void ChaChaPoly::clear()
     clean(state);
     state.ivSize = 8;
 }
+
+/**
+ * \class XChaChaPoly ChaChaPoly.h <ChaChaPoly.h>
+ * \brief Authenticated cipher based on XChaCha20 and Poly1305
+ *
+ * XChaChaPoly is the same as ChaChaPoly with a 96-bit nonce except that
+ * it accepts a 192-bit nonce.  The first 128 bits of the nonce and the
+ * key are hashed with HChaCha20 to derive a per-message subkey, which is
+ * then used with the last 64 bits of the nonce for ChaChaPoly.
+ *
+ * The nonce is large enough that it is safe to generate it randomly for
+ * every message, which avoids the need to store a nonce counter in
+ * non-volatile memory.  The key must be 256 bits and the tag is 128 bits.
+ *
+ * \code
+ * XChaChaPoly cipher;
+ * uint8_t nonce[24];
+ * RNG.rand(nonce, sizeof(nonce));
+ * cipher.seal(ciphertext, tag, key, nonce, sizeof(nonce),
+ *             adata, sizeof(adata), plaintext, sizeof(plaintext));
+ * \endcode
+ *
+ * Reference: https://tools.ietf.org/html/draft-irtf-cfrg-xchacha-03
+ *
+ * \sa ChaChaPoly, ChaCha::hchacha()
+ */
+
+/**
+ * \brief Constructs a new XChaChaPoly authenticated cipher.
+ */
+XChaChaPoly::XChaChaPoly()
+{
+    memset(key, 0, sizeof(key));
+}
+
+/**
+ * \brief Destroys this XChaChaPoly authenticated cipher.
+ */
+XChaChaPoly::~XChaChaPoly()
+{
+    clean(key);
+}
+
+/**
+ * \brief Returns the size of the XChaChaPoly nonce, which is 24 bytes.
+ */
+size_t XChaChaPoly::ivSize() const
+{
+    return 24;
+}
+
+/**
+ * \brief Sets the 256-bit key for XChaChaPoly.
+ *
+ * \param key Points to the key.
+ * \param len Length of the key in bytes, which must be 32.
+ * \return Returns false if \a len is not 32.
+ *
+ * The key is retained until setIV() is called, because the subkey that
+ * is used to encrypt the data depends upon the nonce.
+ */
+bool XChaChaPoly::setKey(const uint8_t *key, size_t len)
+{
+    if (len != 32)
+        return false;
+    memcpy(this->key, key, 32);
+    return true;
+}
+
+/**
+ * \brief Sets the 192-bit nonce for XChaChaPoly.
+ *
+ * \param iv Points to the nonce.
+ * \param len Length of the nonce in bytes, which must be 24.
+ * \return Returns false if \a len is not 24.
+ *
+ * This must be called after setKey() and before any data is processed.
+ */
+bool XChaChaPoly::setIV(const uint8_t *iv, size_t len)
+{
+    if (len != 24)
+        return false;
+
+    // Derive the subkey from the first 16 bytes of the nonce and use
+    // the last 8 bytes, with four leading zeroes, as the ChaChaPoly nonce.
+    uint8_t subkey[32];
+    uint8_t nonce[12];
+    ChaCha::hchacha(subkey, key, iv);
+    memset(nonce, 0, 4);
+    memcpy(nonce + 4, iv + 16, 8);
+    ChaChaPoly::setKey(subkey, 32);
+    bool ok = ChaChaPoly::setIV(nonce, 12);
+    clean(subkey);
+    return ok;
+}
+
+/**
+ * \brief Clears the key and all other sensitive state from this cipher.
+ */
+void XChaChaPoly::clear()
+{
+    ChaChaPoly::clear();
+    clean(key);
+}
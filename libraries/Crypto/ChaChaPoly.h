@@ -62,4 +62,21 @@ private:
     } state;
 };
 
+class XChaChaPoly : public ChaChaPoly
+{
+public:
+    XChaChaPoly();
+    virtual ~XChaChaPoly();
+
+    size_t ivSize() const;
+
+    bool setKey(const uint8_t *key, size_t len);
+    bool setIV(const uint8_t *iv, size_t len);
+
+    void clear();
+
+private:
+    uint8_t key[32];
+};
+
 #endif
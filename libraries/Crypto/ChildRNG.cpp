@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ChildRNG.h"
+#include "RNG.h"
+#include "ChaCha.h"
+#include "Crypto.h"
+#include "utility/ProgMemUtil.h"
+#include <Arduino.h>
+#include <string.h>
+
+/**
+ * \class ChildRNG ChildRNG.h <ChildRNG.h>
+ * \brief Random number generator for a single task that is seeded from
+ * the global random number pool.
+ *
+ * The global \link RNGClass RNG\endlink object has a single state that
+ * is updated by every call to rand().  On a multi-core processor or an RTOS,
+ * two tasks that call RNG.rand() at the same time would corrupt that state,
+ * and putting a lock around it makes the tasks wait for each other.
+ *
+ * A ChildRNG gives each task its own ChaCha20 generator instead.  The
+ * child's rand() only touches the child's own state, so it needs no
+ * locking.  The child is seeded from the global pool by begin(), and then
+ * asks for a fresh seed after every 1024 bytes of output, which is set by
+ * CRYPTO_CHILD_RNG_RESEED_BYTES.  The global pool hands over the new seed
+ * from RNG.loop() on the main task through a one-slot mailbox.  The child
+ * mixes it into its key on the next call to rand():
+ *
+ * \code
+ * ChildRNG workerRNG;
+ *
+ * void setup() {
+ *     RNG.begin("MyApp 1.0", 500);
+ *     RNG.addNoiseSource(noise);
+ *     ...
+ *     workerRNG.begin();
+ *     xTaskCreatePinnedToCore(workerTask, "worker", 4096, 0, 1, 0, 0);
+ * }
+ *
+ * void loop() {
+ *     // Also passes fresh seeds to workerRNG when it asks for them.
+ *     RNG.loop();
+ * }
+ *
+ * void workerTask(void *) {
+ *     for (;;) {
+ *         uint8_t nonce[12];
+ *         workerRNG.rand(nonce, sizeof(nonce));
+ *         ...
+ *     }
+ * }
+ * \endcode
+ *
+ * The child rekeys after every request in the same way as RNGClass, so
+ * capturing its state later does not reveal previous outputs.  The child
+ * is only as unpredictable as the global pool was when it was last
+ * seeded.  It should not be seeded before the application has stirred
+ * in enough noise for RNG.available() to report that the pool is full.
+ *
+ * \note Each ChildRNG must only be used by one task at a time.  begin(),
+ * clear(), and reseed() must be called from the task that owns the
+ * global RNG, which is usually the one that calls RNG.loop().
+ *
+ * \sa RNGClass
+ */
+
+// Number of ChaCha hash rounds to use for random number generation.
+#define CHILD_RNG_ROUNDS        20
+
+// Force a rekey after this many blocks of random data.
+#define CHILD_RNG_REKEY_BLOCKS  16
+
+// Number of bytes of buffered keystream that are left over after refill().
+#define CHILD_RNG_BUFFER_SIZE   16
+
+// States of the mailbox that passes new seeds from the global pool.
+#define CHILD_SEED_IDLE         0   // Child has enough seed for now.
+#define CHILD_SEED_WANTED       1   // Child has asked for a new seed.
+#define CHILD_SEED_READY        2   // Global pool has provided the seed.
+
+/** @cond */
+
+// Tag for 256-bit ChaCha20 keys.  This will always appear in the
+// first 16 bytes of the block.  The remaining 48 bytes are the seed.
+static const char tagChildRNG[16] PROGMEM = {
+    'e', 'x', 'p', 'a', 'n', 'd', ' ', '3',
+    '2', '-', 'b', 'y', 't', 'e', ' ', 'k'
+};
+
+/** @endcond */
+
+/**
+ * \brief Constructs a new child random number generator.
+ *
+ * This constructor must be followed by a call to begin() to seed the
+ * generator from the global random number pool.
+ */
+ChildRNG::ChildRNG()
+    : generated(0)
+    , buffered(0)
+    , seedState(CHILD_SEED_IDLE)
+    , next(0)
+{
+}
+
+/**
+ * \brief Destroys this child random number generator.
+ */
+ChildRNG::~ChildRNG()
+{
+    clear();
+}
+
+/**
+ * \brief Seeds this generator from the global random number pool.
+ *
+ * The generator is also registered with the global pool so that
+ * RNG.loop() will hand over new seeds when they are needed.
+ *
+ * \sa clear(), reseed()
+ */
+void ChildRNG::begin()
+{
+    memcpy_P(block, tagChildRNG, sizeof(tagChildRNG));
+    RNG.rand((uint8_t *)(block + 4), 48);
+    clean(stream);
+    clean(seed);
+    generated = 0;
+    buffered = 0;
+    __atomic_store_n(&seedState, CHILD_SEED_IDLE, __ATOMIC_RELEASE);
+    RNG.addChild(this);
+}
+
+/**
+ * \brief Generates random bytes into a caller-supplied buffer.
+ *
+ * \param data Points to the buffer to fill with random bytes.
+ * \param len Number of bytes to generate.
+ *
+ * Requests of up to 16 bytes, such as nonces, are served from keystream
+ * that was left over from the previous rekey.
+ *
+ * \sa RNGClass::rand()
+ */
+void ChildRNG::rand(uint8_t *data, size_t len)
+{
+    // Mix in the new seed if the global pool has handed one over.
+    if (__atomic_load_n(&seedState, __ATOMIC_ACQUIRE) == CHILD_SEED_READY)
+        applySeed();
+
+    // Ask for a new seed once enough output has been generated.
+    generated += len;
+    if (generated >= CRYPTO_CHILD_RNG_RESEED_BYTES &&
+            __atomic_load_n(&seedState, __ATOMIC_RELAXED) == CHILD_SEED_IDLE)
+        __atomic_store_n(&seedState, CHILD_SEED_WANTED, __ATOMIC_RELEASE);
+
+    // Serve small requests from the buffered keystream, refilling
+    // the buffer and rekeying in a single step when it runs dry.
+    if (len <= CHILD_RNG_BUFFER_SIZE) {
+        if (len > buffered)
+            refill();
+        uint8_t *buf = ((uint8_t *)stream) + sizeof(stream) - buffered;
+        memcpy(data, buf, len);
+        clean(buf, len);
+        buffered -= len;
+        return;
+    }
+
+    // Generate the random data.
+    uint8_t count = 0;
+    while (len > 0) {
+        // Force a rekey if we have generated too many blocks in this request.
+        if (count >= CHILD_RNG_REKEY_BLOCKS) {
+            rekey();
+            count = 1;
+        } else {
+            ++count;
+        }
+
+        // Increment the low counter word and generate a new keystream block.
+        ++(block[12]);
+        ChaCha::hashCore(stream, block, CHILD_RNG_ROUNDS);
+
+        // Copy the data to the return buffer.
+        if (len < 64) {
+            memcpy(data, stream, len);
+            break;
+        } else {
+            memcpy(data, stream, 64);
+            data += 64;
+            len -= 64;
+        }
+    }
+
+    // Force a rekey after every request.
+    rekey();
+}
+
+/**
+ * \brief Passes a new seed from the global random number pool to this
+ * generator if it has asked for one.
+ *
+ * \return Returns true if a new seed was passed over; or false if the
+ * generator did not need one yet.
+ *
+ * RNG.loop() calls this for every child that has been seeded with begin(),
+ * so applications do not normally need to call it themselves.
+ */
+bool ChildRNG::reseed()
+{
+    if (__atomic_load_n(&seedState, __ATOMIC_ACQUIRE) != CHILD_SEED_WANTED)
+        return false;
+    RNG.rand(seed, sizeof(seed));
+    __atomic_store_n(&seedState, CHILD_SEED_READY, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * \brief Clears the state of this generator and stops the global pool
+ * from reseeding it.
+ *
+ * After this function is called, begin() must be called again before
+ * the generator can be used.
+ */
+void ChildRNG::clear()
+{
+    RNG.removeChild(this);
+    clean(block);
+    clean(stream);
+    clean(seed);
+    generated = 0;
+    buffered = 0;
+    seedState = CHILD_SEED_IDLE;
+}
+
+/**
+ * \brief Rekeys the generator from its own keystream.
+ */
+void ChildRNG::rekey()
+{
+    ++(block[12]);
+    ChaCha::hashCore(stream, block, CHILD_RNG_ROUNDS);
+    memcpy(block + 4, stream, 48);
+    clean(stream);
+    buffered = 0;
+    block[13] ^= micros();
+}
+
+/**
+ * \brief Rekeys the generator and keeps the rest of the keystream block
+ * for small requests.
+ */
+void ChildRNG::refill()
+{
+    ++(block[12]);
+    ChaCha::hashCore(stream, block, CHILD_RNG_ROUNDS);
+    memcpy(block + 4, stream, 48);
+    clean(stream, 48);
+    buffered = CHILD_RNG_BUFFER_SIZE;
+    block[13] ^= micros();
+}
+
+/**
+ * \brief Mixes the seed from the global pool into the key.
+ */
+void ChildRNG::applySeed()
+{
+    uint8_t *key = (uint8_t *)(block + 4);
+    for (uint8_t posn = 0; posn < sizeof(seed); ++posn)
+        key[posn] ^= seed[posn];
+    clean(seed);
+    clean(stream);
+    buffered = 0;
+    generated = 0;
+    __atomic_store_n(&seedState, CHILD_SEED_IDLE, __ATOMIC_RELEASE);
+}
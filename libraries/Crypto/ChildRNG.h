@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CHILDRNG_h
+#define CRYPTO_CHILDRNG_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Number of bytes that a child generator produces before it asks the
+// global random number pool for a fresh seed.
+#if !defined(CRYPTO_CHILD_RNG_RESEED_BYTES)
+#define CRYPTO_CHILD_RNG_RESEED_BYTES 1024
+#endif
+
+class RNGClass;
+
+class ChildRNG
+{
+public:
+    ChildRNG();
+    ~ChildRNG();
+
+    void begin();
+
+    void rand(uint8_t *data, size_t len);
+
+    bool reseed();
+    bool reseedPending() const;
+
+    void clear();
+
+private:
+    uint32_t block[16];
+    uint32_t stream[16];
+    uint8_t seed[48];
+    size_t generated;
+    uint8_t buffered;
+    volatile uint8_t seedState;
+    ChildRNG *next;
+
+    void rekey();
+    void refill();
+    void applySeed();
+
+    // Disable copy constructor and operator=().
+    ChildRNG(const ChildRNG &) {}
+    ChildRNG &operator=(const ChildRNG &) { return *this; }
+
+    friend class RNGClass;
+};
+
+#endif
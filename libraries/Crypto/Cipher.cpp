@@ -144,6 +144,71 @@ Cipher::~Cipher()
  * \sa encrypt()
  */
 
+/**
+ * \struct CipherSegment Cipher.h <Cipher.h>
+ * \brief Describes one segment of a scatter/gather buffer list.
+ *
+ * \sa Cipher::encryptv(), Cipher::decryptv(),
+ * AuthenticatedCipher::addAuthDatav()
+ */
+
+/**
+ * \var CipherSegment::data
+ * \brief Points to the bytes in this segment.
+ */
+
+/**
+ * \var CipherSegment::len
+ * \brief Number of bytes in this segment.
+ */
+
+/**
+ * \brief Encrypts a list of buffer segments in place.
+ *
+ * \param segments Points to the segments to encrypt.
+ * \param count The number of segments in the list.
+ *
+ * The segments are encrypted in order as though they were a single
+ * contiguous buffer, without copying the data into a staging buffer.
+ * Segment boundaries do not need to fall on block boundaries.
+ *
+ * The default implementation calls encrypt() on each segment in turn,
+ * which is correct for stream ciphers and for modes that buffer partial
+ * blocks between calls.  Subclasses that can only process whole blocks
+ * override this to handle blocks that straddle segments.
+ *
+ * \sa decryptv(), encrypt()
+ */
+void Cipher::encryptv(const CipherSegment *segments, size_t count)
+{
+    while (count > 0) {
+        encrypt(segments->data, segments->data, segments->len);
+        ++segments;
+        --count;
+    }
+}
+
+/**
+ * \brief Decrypts a list of buffer segments in place.
+ *
+ * \param segments Points to the segments to decrypt.
+ * \param count The number of segments in the list.
+ *
+ * The segments are decrypted in order as though they were a single
+ * contiguous buffer, without copying the data into a staging buffer.
+ * Segment boundaries do not need to fall on block boundaries.
+ *
+ * \sa encryptv(), decrypt()
+ */
+void Cipher::decryptv(const CipherSegment *segments, size_t count)
+{
+    while (count > 0) {
+        decrypt(segments->data, segments->data, segments->len);
+        ++segments;
+        --count;
+    }
+}
+
 /**
  * \fn void Cipher::clear()
  * \brief Clears all security-sensitive state from this cipher.
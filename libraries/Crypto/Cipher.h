@@ -26,6 +26,12 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+struct CipherSegment
+{
+    uint8_t *data;
+    size_t len;
+};
+
 class Cipher
 {
 public:
@@ -41,6 +47,9 @@ public:
     virtual void encrypt(uint8_t *output, const uint8_t *input, size_t len) = 0;
     virtual void decrypt(uint8_t *output, const uint8_t *input, size_t len) = 0;
 
+    virtual void encryptv(const CipherSegment *segments, size_t count);
+    virtual void decryptv(const CipherSegment *segments, size_t count);
+
     virtual void clear() = 0;
 };
 
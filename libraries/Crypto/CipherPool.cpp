@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CipherPool.h"
+
+/**
+ * \class CipherPoolCommon CipherPool.h <CipherPool.h>
+ * \brief Concrete base class to assist with implementing CipherPool.
+ *
+ * Refer to the CipherPool class for usage information.
+ *
+ * \sa CipherPool
+ */
+
+/**
+ * \brief Constructs a new cipher pool.
+ *
+ * This constructor should be followed by a call to setEntries() to
+ * supply the table of pre-allocated ciphers.
+ */
+CipherPoolCommon::CipherPoolCommon()
+    : entries(0)
+    , count(0)
+    , clock(0)
+{
+}
+
+/**
+ * \brief Destroys this cipher pool.
+ *
+ * The keys are destroyed by the destructors of the ciphers themselves.
+ */
+CipherPoolCommon::~CipherPoolCommon()
+{
+}
+
+/**
+ * \fn size_t CipherPoolCommon::size() const
+ * \brief Returns the number of session contexts that the pool can hold.
+ */
+
+/**
+ * \brief Finds the cipher for a session that is already in the pool.
+ *
+ * \param sessionId The identifier for the session.
+ *
+ * \return A pointer to the cipher, or NULL if \a sessionId is not in
+ * the pool.  The cipher has already been keyed but the caller must
+ * still call setIV() to start a new packet.
+ *
+ * The session is marked as the most recently used.
+ *
+ * \sa insert(), acquire()
+ */
+AuthenticatedCipher *CipherPoolCommon::find(uint32_t sessionId)
+{
+    Entry *entry = lookup(sessionId);
+    if (!entry)
+        return 0;
+    entry->lastUsed = ++clock;
+    return entry->cipher;
+}
+
+/**
+ * \brief Inserts a new session into the pool and sets its key.
+ *
+ * \param sessionId The identifier for the session.
+ * \param key Points to the key for the session.
+ * \param len The length of the key in bytes.
+ *
+ * \return A pointer to the keyed cipher, or NULL if the key is not
+ * supported by the cipher.
+ *
+ * If \a sessionId is already in the pool, then its cipher is re-keyed.
+ * Otherwise an unused entry is taken, or the least recently used session
+ * is evicted from the pool and its cipher is cleared.
+ *
+ * \sa find(), acquire()
+ */
+AuthenticatedCipher *CipherPoolCommon::insert
+    (uint32_t sessionId, const uint8_t *key, size_t len)
+{
+    Entry *entry = lookup(sessionId);
+    if (!entry) {
+        // Look for an unused entry or the least recently used session.
+        // Ages are measured relative to the clock so that the comparison
+        // still works when the clock wraps around.
+        uint32_t oldest = 0;
+        for (size_t index = 0; index < count; ++index) {
+            Entry *e = &(entries[index]);
+            if (!e->inUse) {
+                entry = e;
+                break;
+            }
+            uint32_t age = clock - e->lastUsed;
+            if (!entry || age > oldest) {
+                entry = e;
+                oldest = age;
+            }
+        }
+        if (!entry)
+            return 0;
+        entry->cipher->clear();
+        entry->sessionId = sessionId;
+    }
+    entry->lastUsed = ++clock;
+    if (!entry->cipher->setKey(key, len)) {
+        entry->cipher->clear();
+        entry->inUse = false;
+        return 0;
+    }
+    entry->inUse = true;
+    return entry->cipher;
+}
+
+/**
+ * \brief Finds the cipher for a session or inserts it with a key.
+ *
+ * \param sessionId The identifier for the session.
+ * \param key Points to the key for the session.
+ * \param len The length of the key in bytes.
+ *
+ * \return A pointer to the keyed cipher, or NULL if the key is not
+ * supported by the cipher.
+ *
+ * This is equivalent to calling find() and then insert() if the session
+ * was not found.  The \a key is only used when the session is inserted,
+ * so the caller must use remove() or insert() if a session's key changes.
+ *
+ * \sa find(), insert()
+ */
+AuthenticatedCipher *CipherPoolCommon::acquire
+    (uint32_t sessionId, const uint8_t *key, size_t len)
+{
+    AuthenticatedCipher *cipher = find(sessionId);
+    if (!cipher)
+        cipher = insert(sessionId, key, len);
+    return cipher;
+}
+
+/**
+ * \brief Removes a session from the pool and clears its key.
+ *
+ * \param sessionId The identifier for the session.
+ *
+ * \sa insert(), clear()
+ */
+void CipherPoolCommon::remove(uint32_t sessionId)
+{
+    Entry *entry = lookup(sessionId);
+    if (entry) {
+        entry->cipher->clear();
+        entry->inUse = false;
+    }
+}
+
+/**
+ * \brief Removes all sessions from the pool and clears their keys.
+ *
+ * \sa remove()
+ */
+void CipherPoolCommon::clear()
+{
+    for (size_t index = 0; index < count; ++index) {
+        if (entries[index].inUse) {
+            entries[index].cipher->clear();
+            entries[index].inUse = false;
+        }
+    }
+    clock = 0;
+}
+
+/**
+ * \brief Sets the table of entries for this pool.
+ *
+ * \param entries Points to the table, whose \a cipher fields must point
+ * to the pre-allocated ciphers and whose \a inUse fields must be false.
+ * \param count The number of entries in the table.
+ */
+void CipherPoolCommon::setEntries(Entry *entries, size_t count)
+{
+    this->entries = entries;
+    this->count = count;
+}
+
+/**
+ * \internal
+ * \brief Looks up the entry for a session.
+ *
+ * \param sessionId The identifier for the session.
+ *
+ * \return The entry, or NULL if \a sessionId is not in the pool.
+ */
+CipherPoolCommon::Entry *CipherPoolCommon::lookup(uint32_t sessionId)
+{
+    for (size_t index = 0; index < count; ++index) {
+        Entry *entry = &(entries[index]);
+        if (entry->inUse && entry->sessionId == sessionId)
+            return entry;
+    }
+    return 0;
+}
+
+/**
+ * \class CipherPool CipherPool.h <CipherPool.h>
+ * \brief Fixed-size pool of pre-keyed authenticated ciphers.
+ *
+ * Applications that handle packets for many sessions can spend more time
+ * in setKey() than in encrypting the packet itself.  For example, GCM
+ * expands the AES key schedule and derives the GHASH key on every call.
+ * CipherPool keeps up to N keyed instances of the authenticated cipher T,
+ * indexed by a 32-bit session identifier, so that each packet only needs
+ * a call to setIV():
+ *
+ * \code
+ * CipherPool<GCM<AES256>, 16> pool;
+ *
+ * AuthenticatedCipher *cipher = pool.acquire(sessionId, sessionKey, 32);
+ * if (cipher) {
+ *     cipher->setIV(nonce, 12);
+ *     cipher->addAuthData(header, headerLen);
+ *     cipher->decrypt(payload, payload, payloadLen);
+ *     if (!cipher->checkTag(tag, 16)) {
+ *         // The packet is invalid.
+ *         ...
+ *     }
+ * }
+ * \endcode
+ *
+ * When the pool is full, the least recently used session is evicted and
+ * its key is cleared.  The memory used by the pool is fixed at N times the
+ * size of T, plus 12 to 16 bytes per entry for the session table.  Lookups
+ * scan the table, which is cheap compared with setKey() for pools with up
+ * to a few hundred entries.
+ *
+ * The template parameter T must be a concrete subclass of
+ * AuthenticatedCipher with a default constructor, such as ChaChaPoly,
+ * GCM<AES128>, or GCM<AES256>.
+ */
+
+/**
+ * \fn CipherPool::CipherPool()
+ * \brief Constructs a new pool with N unused entries.
+ */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CIPHERPOOL_h
+#define CRYPTO_CIPHERPOOL_h
+
+#include "AuthenticatedCipher.h"
+
+class CipherPoolCommon
+{
+public:
+    virtual ~CipherPoolCommon();
+
+    size_t size() const { return count; }
+
+    AuthenticatedCipher *find(uint32_t sessionId);
+    AuthenticatedCipher *insert(uint32_t sessionId, const uint8_t *key, size_t len);
+    AuthenticatedCipher *acquire(uint32_t sessionId, const uint8_t *key, size_t len);
+    void remove(uint32_t sessionId);
+
+    void clear();
+
+protected:
+    struct Entry
+    {
+        AuthenticatedCipher *cipher;
+        uint32_t sessionId;
+        uint32_t lastUsed;
+        bool inUse;
+    };
+
+    CipherPoolCommon();
+    void setEntries(Entry *entries, size_t count);
+
+private:
+    Entry *entries;
+    size_t count;
+    uint32_t clock;
+
+    Entry *lookup(uint32_t sessionId);
+};
+
+template <typename T, size_t N>
+class CipherPool : public CipherPoolCommon
+{
+public:
+    CipherPool()
+    {
+        for (size_t index = 0; index < N; ++index) {
+            slots[index].cipher = &ciphers[index];
+            slots[index].inUse = false;
+        }
+        setEntries(slots, N);
+    }
+
+private:
+    T ciphers[N];
+    Entry slots[N];
+};
+
+#endif
@@ -21,6 +21,8 @@
  */
 
 #include "Crypto.h"
+#include "utility/ConstantTimeUtil.h"
+#include <string.h>
 
 /**
  * \brief Cleans a block of bytes.
@@ -33,6 +35,13 @@
  */
 void clean(void *dest, size_t size)
 {
+#if defined(__GNUC__)
+    // Clear the memory a word at a time with memset() and then tell the
+    // compiler that the empty assembly statement may read the memory.
+    // Otherwise the compiler might optimise the clear away as a dead store.
+    memset(dest, 0, size);
+    __asm__ __volatile__ ("" : : "r"(dest) : "memory");
+#else
     // Force the use of volatile so that we actually clear the memory.
     // Otherwise the compiler might optimise the entire contents of this
     // function away, which will not be secure.
@@ -41,6 +50,7 @@ void clean(void *dest, size_t size)
         *d++ = 0;
         --size;
     }
+#endif
 }
 
 /**
@@ -75,5 +85,5 @@ bool secure_compare(const void *data1, const void *data2, size_t len)
         result |= (*d1++ ^ *d2++);
         --len;
     }
-    return (bool)((((uint16_t)0x0100) - result) >> 8);
+    return (bool)(~ctMask(result) & 1);
 }
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CONFIG_h
+#define CRYPTO_CONFIG_h
+
+// Build profile for the library.  CRYPTO_OPTIMIZE_SIZE, the default,
+// keeps the compact looped implementations.  Define CRYPTO_OPTIMIZE_SPEED
+// to 1 to select unrolled implementations and larger tables instead,
+// which costs several kilobytes of flash over the whole library.
+#if !defined(CRYPTO_OPTIMIZE_SPEED)
+#if defined(CRYPTO_OPTIMIZE_SIZE) && !CRYPTO_OPTIMIZE_SIZE
+#define CRYPTO_OPTIMIZE_SPEED 1
+#else
+#define CRYPTO_OPTIMIZE_SPEED 0
+#endif
+#endif
+#if !defined(CRYPTO_OPTIMIZE_SIZE)
+#define CRYPTO_OPTIMIZE_SIZE (!CRYPTO_OPTIMIZE_SPEED)
+#endif
+#if CRYPTO_OPTIMIZE_SPEED && CRYPTO_OPTIMIZE_SIZE
+#error "CRYPTO_OPTIMIZE_SPEED and CRYPTO_OPTIMIZE_SIZE are mutually exclusive"
+#endif
+
+// Individual primitives can be switched over independently of the
+// profile by defining the corresponding option to 0 or 1.
+
+// Fully unrolled SHA256 compression with the round constants inline.
+#if !defined(CRYPTO_SHA256_UNROLL)
+#define CRYPTO_SHA256_UNROLL CRYPTO_OPTIMIZE_SPEED
+#endif
+
+// Fully unrolled BLAKE2s compression with the message schedule inline.
+#if !defined(CRYPTO_BLAKE2S_UNROLL)
+#define CRYPTO_BLAKE2S_UNROLL CRYPTO_OPTIMIZE_SPEED
+#endif
+
+// ChaCha hash core that keeps the state in local variables and runs
+// four rounds per loop iteration.
+#if !defined(CRYPTO_CHACHA_UNROLL)
+#define CRYPTO_CHACHA_UNROLL CRYPTO_OPTIMIZE_SPEED
+#endif
+
+// Unrolled theta and chi steps in the compact Keccak-p permutation.
+// The 32-bit and 64-bit permutations are always unrolled.
+#if !defined(CRYPTO_KECCAK_UNROLL)
+#define CRYPTO_KECCAK_UNROLL CRYPTO_OPTIMIZE_SPEED
+#endif
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CryptoWorker.h"
+#if CRYPTO_WORKER_TASKS
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+/**
+ * \class CryptoWorker CryptoWorker.h <CryptoWorker.h>
+ * \brief Spreads independent cryptographic jobs across the cores of
+ * the processor.
+ *
+ * Most of the library runs entirely on the core that calls it.  On dual-core
+ * ESP32 processors, a CryptoWorker starts a helper task on the other core
+ * with begin().  Each call to run() then hands out a list of independent
+ * jobs to both the calling task and the helper until the list is empty.
+ * The jobs are claimed one at a time from a shared atomic counter, so a core
+ * that finishes early simply takes the next job without any locking.
+ *
+ * On other platforms, or if begin() has not been called, run() performs
+ * the jobs one after the other on the calling task.  The results are
+ * the same either way, so code that uses CryptoWorker does not need to
+ * be specific to ESP32.
+ *
+ * Ed25519::verifyBatch() and CTRCommon::setWorker() use a CryptoWorker to
+ * verify batches of signatures and to generate CTR keystream in parallel.
+ * Applications can also submit their own jobs.  The following example
+ * hashes several independent messages, with each job hashing one message:
+ *
+ * \code
+ * struct HashJob
+ * {
+ *     SHA256 hash;
+ *     const void *data;
+ *     size_t len;
+ *     uint8_t result[32];
+ * };
+ *
+ * static void hashJob(void *arg)
+ * {
+ *     HashJob *job = (HashJob *)arg;
+ *     job->hash.reset();
+ *     job->hash.update(job->data, job->len);
+ *     job->hash.finalize(job->result, 32);
+ * }
+ *
+ * CryptoWorker worker;
+ * HashJob jobs[4];
+ * void *args[4] = {&jobs[0], &jobs[1], &jobs[2], &jobs[3]};
+ *
+ * worker.begin();
+ * ...
+ * worker.run(hashJob, args, 4);
+ * \endcode
+ *
+ * The jobs in a single call to run() must not share any objects that
+ * they modify.  Each job runs to completion on one core and run() does
+ * not return until all of them have finished.
+ *
+ * The helper task's stack size is set by CRYPTO_WORKER_STACK_SIZE, which
+ * defaults to 16384 bytes.  The work is only worth distributing if each
+ * job takes much longer than waking the helper task, which is around
+ * ten microseconds.  Hashing a few kilobytes or verifying a signature
+ * is enough.
+ *
+ * \note run() uses the FreeRTOS task notification of the calling task to
+ * wait for the helper, so it must be called from a task and not from an
+ * interrupt handler.  Only one task should use a CryptoWorker at a time.
+ */
+
+/**
+ * \typedef CryptoWorker::JobFunc
+ * \brief Function that performs a single job for run().
+ *
+ * The argument is one of the elements of the \a args array that was
+ * passed to run().
+ */
+
+/**
+ * \brief Constructs a new worker with no helper task.
+ *
+ * \sa begin()
+ */
+CryptoWorker::CryptoWorker()
+    : helper(0)
+    , caller(0)
+    , jobFunc(0)
+    , jobArgs(0)
+    , jobCount(0)
+    , nextJob(0)
+    , stopping(false)
+{
+}
+
+/**
+ * \brief Destroys this worker, after stopping the helper task.
+ */
+CryptoWorker::~CryptoWorker()
+{
+    end();
+}
+
+/**
+ * \brief Starts the helper task on the other core.
+ *
+ * \param priority The FreeRTOS priority for the helper task.
+ * \return Returns true if the helper task is running; or false if the
+ * platform has a single core or the task could not be created.  The
+ * worker can still be used when false is returned.
+ *
+ * \sa end(), isParallel()
+ */
+bool CryptoWorker::begin(unsigned priority)
+{
+#if CRYPTO_WORKER_TASKS
+    if (helper)
+        return true;
+    if (portNUM_PROCESSORS < 2)
+        return false;
+    TaskHandle_t handle = 0;
+    BaseType_t core = (xPortGetCoreID() == 0) ? 1 : 0;
+    if (xTaskCreatePinnedToCore(helperMain, "crypto",
+                                CRYPTO_WORKER_STACK_SIZE, this,
+                                priority, &handle, core) != pdPASS)
+        return false;
+    helper = handle;
+    return true;
+#else
+    (void)priority;
+    return false;
+#endif
+}
+
+/**
+ * \brief Stops the helper task.
+ *
+ * Later calls to run() will perform the jobs on the calling task only.
+ *
+ * \sa begin()
+ */
+void CryptoWorker::end()
+{
+#if CRYPTO_WORKER_TASKS
+    if (!helper)
+        return;
+    stopping = true;
+    caller = xTaskGetCurrentTaskHandle();
+    xTaskNotifyGive((TaskHandle_t)helper);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    helper = 0;
+    stopping = false;
+#endif
+}
+
+/**
+ * \fn bool CryptoWorker::isParallel() const
+ * \brief Returns true if run() spreads its jobs over two cores.
+ */
+
+/**
+ * \brief Runs a list of independent jobs and waits for them to finish.
+ *
+ * \param func The function that performs each job.
+ * \param args Array of \a count arguments to pass to \a func, one per job.
+ * \param count The number of jobs to run.
+ *
+ * The jobs may run in any order and on either core.
+ */
+void CryptoWorker::run(JobFunc func, void *const *args, size_t count)
+{
+    jobFunc = func;
+    jobArgs = args;
+    jobCount = count;
+    nextJob = 0;
+#if CRYPTO_WORKER_TASKS
+    if (helper && count > 1) {
+        // Wake up the helper and then take our own share of the jobs.
+        caller = xTaskGetCurrentTaskHandle();
+        xTaskNotifyGive((TaskHandle_t)helper);
+        runJobs();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        return;
+    }
+#endif
+    runJobs();
+}
+
+/**
+ * \internal
+ * \brief Claims and runs jobs until there are none left.
+ */
+void CryptoWorker::runJobs()
+{
+    size_t index;
+    while ((index = __atomic_fetch_add(&nextJob, 1, __ATOMIC_RELAXED))
+                < jobCount) {
+        (*jobFunc)(jobArgs[index]);
+    }
+}
+
+/**
+ * \internal
+ * \brief Main function for the helper task.
+ *
+ * \param param Points to the CryptoWorker object.
+ */
+void CryptoWorker::helperMain(void *param)
+{
+#if CRYPTO_WORKER_TASKS
+    CryptoWorker *worker = (CryptoWorker *)param;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        TaskHandle_t caller = (TaskHandle_t)(worker->caller);
+        if (worker->stopping) {
+            xTaskNotifyGive(caller);
+            vTaskDelete(0);
+            return;
+        }
+        worker->runJobs();
+        xTaskNotifyGive(caller);
+    }
+#else
+    (void)param;
+#endif
+}
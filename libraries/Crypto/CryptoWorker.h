@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CRYPTOWORKER_h
+#define CRYPTO_CRYPTOWORKER_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Run jobs on a helper task on the second core of ESP32 processors.
+// Other platforms run the jobs one after the other on the calling task.
+#if !defined(CRYPTO_WORKER_TASKS)
+#if defined(ESP32)
+#define CRYPTO_WORKER_TASKS 1
+#else
+#define CRYPTO_WORKER_TASKS 0
+#endif
+#endif
+
+// Stack size in bytes for the helper task.  Ed25519 batch verification
+// needs up to 14K with the default batch size; see Ed25519.h.
+#if !defined(CRYPTO_WORKER_STACK_SIZE)
+#define CRYPTO_WORKER_STACK_SIZE 16384
+#endif
+
+class CryptoWorker
+{
+public:
+    typedef void (*JobFunc)(void *arg);
+
+    CryptoWorker();
+    ~CryptoWorker();
+
+    bool begin(unsigned priority = 1);
+    void end();
+
+    bool isParallel() const { return helper != 0; }
+
+    void run(JobFunc func, void *const *args, size_t count);
+
+private:
+    void *helper;
+    void *caller;
+    JobFunc jobFunc;
+    void *const *jobArgs;
+    size_t jobCount;
+    volatile size_t nextJob;
+    volatile bool stopping;
+
+    void runJobs();
+    static void helperMain(void *param);
+
+    // Disable copy constructor and operator=().
+    CryptoWorker(const CryptoWorker &) {}
+    CryptoWorker &operator=(const CryptoWorker &) { return *this; }
+};
+
+#endif
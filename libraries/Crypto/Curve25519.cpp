@@ -21,9 +21,11 @@
  */
 
 #include "Curve25519.h"
+#include "Ed25519.h"
 #include "Crypto.h"
 #include "RNG.h"
 #include "utility/LimbUtil.h"
+#include "utility/ConstantTimeUtil.h"
 #include <string.h>
 
 /**
@@ -248,10 +250,14 @@ void Curve25519::dh1(uint8_t k[32], uint8_t f[32])
         f[31] = (f[31] & 0x7F) | 0x40;
 
         // Evaluate the curve function: k = Curve25519::eval(f, 9).
+#if CRYPTO_CURVE25519_FIXED_BASE && CRYPTO_ED25519_COMB
+        evalBase(k, f);
+#else
         // We pass NULL to eval() to indicate the value 9.  There is no
         // need to check the return value from eval() because we know
         // that 9 is a valid field element.
         eval(k, f, 0);
+#endif
 
         // If "k" is weak for contributory behaviour then reject it,
         // generate another "f" value, and try again.  This case is
@@ -345,6 +351,49 @@ uint8_t Curve25519::isWeakPoint(const uint8_t k[32])
     return result;
 }
 
+#if CRYPTO_CURVE25519_FIXED_BASE
+
+/**
+ * \brief Evaluates the curve function on the base point 9.
+ *
+ * \param result The result of evaluating the curve function.
+ * \param s The S parameter to the curve function.
+ *
+ * The result is the same as eval(result, s, 0) but the work is done on
+ * the birationally equivalent twisted Edwards curve from Ed25519, where
+ * the fixed-base comb table replaces the 255 steps of the Montgomery
+ * ladder with 64 doublings and 64 additions.  The Edwards point (x, y)
+ * maps back to u = (1 + y) / (1 - y) on the Montgomery curve.
+ *
+ * \sa eval(), dh1()
+ */
+void Curve25519::evalBase(uint8_t result[32], const uint8_t s[32])
+{
+    Ed25519::Point P;
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+
+    // P = [s]B on the Edwards curve.  Only the bottom 255 bits of "s"
+    // are used, which matches the treatment of "s" in eval().
+    BigNumberUtil::unpackLE(A, NUM_LIMBS_256BIT, s, 32);
+    Ed25519::mul(P, A);
+
+    // u = (Z + Y) / (Z - Y) in projective coordinates.  The identity maps
+    // to zero because recip(0) is zero, the same as the ladder's result.
+    sub(A, P.z, P.y);
+    recip(B, A);
+    add(A, P.z, P.y);
+    mul(A, A, B);
+    BigNumberUtil::packLE(result, 32, A, NUM_LIMBS_256BIT);
+
+    // Clean up and exit.
+    clean(P);
+    clean(A);
+    clean(B);
+}
+
+#endif
+
 /**
  * \brief Reduces a number modulo 2^255 - 19.
  *
@@ -408,6 +457,36 @@ void Curve25519::reduce(limb_t *result, limb_t *x, uint8_t size)
     // value of the form "answer + j * (2^255 - 19)".
     carry = ((dlimb_t)(x[NUM_LIMBS_256BIT - 1] >> (LIMB_BITS - 1))) * 19U;
     x[NUM_LIMBS_256BIT - 1] &= ((((limb_t)1) << (LIMB_BITS - 1)) - 1);
+#if CRYPTO_CURVE25519_ASM_AVR
+    if (size == NUM_LIMBS_256BIT) {
+        // Process a byte at a time.  The carry between bytes is at
+        // most 39 so it always fits in a single register.
+        uint8_t c = (uint8_t)carry;
+        limb_t *xx = x;
+        __asm__ __volatile__ (
+            "ldi r20,38\n"
+            "clr r21\n"
+            "ldi r22,32\n"
+            "1:\n"
+            "ldd r23,Z+32\n"
+            "mul r23,r20\n"
+            "ld r23,Z\n"
+            "add r0,r23\n"
+            "adc r1,r21\n"
+            "add r0,%[c]\n"
+            "adc r1,r21\n"
+            "st Z+,r0\n"
+            "mov %[c],r1\n"
+            "dec r22\n"
+            "brne 1b\n"
+            "clr r1\n"
+            : [c] "+r" (c), "+z" (xx)
+            :
+            : "r0", "r1", "r20", "r21", "r22", "r23", "memory"
+        );
+        carry = c;
+    } else
+#endif
     for (posn = 0; posn < size; ++posn) {
         carry += ((dlimb_t)(x[posn + NUM_LIMBS_256BIT])) * 38U;
         carry += x[posn];
@@ -532,6 +611,91 @@ limb_t Curve25519::reduceQuick(limb_t *x)
  */
 void Curve25519::mulNoReduce(limb_t *result, const limb_t *x, const limb_t *y)
 {
+#if CRYPTO_CURVE25519_ASM_AVR
+    // The limbs are stored little-endian so the AVR code can treat the
+    // values as arrays of bytes no matter what size limb_t is.  The bytes
+    // of x are processed 4 at a time in r2-r5.  Each byte of y is multiplied
+    // by those 4 bytes and then added to the 4-byte carry window in r6-r9
+    // and the byte of "result" that was produced by the previous row.
+    const limb_t *xx = x;
+    __asm__ __volatile__ (
+        // Clear the bottom half of the result.
+        "clr r17\n"
+        "ldi r18,32\n"
+        "0:\n"
+        "st X+,r17\n"
+        "dec r18\n"
+        "brne 0b\n"
+        "sbiw r26,32\n"
+
+        // Outer loop over the bytes of x, 4 at a time.
+        "ldi r19,8\n"
+        "2:\n"
+        "movw r30,%[x]\n"
+        "ld r2,Z+\n"
+        "ld r3,Z+\n"
+        "ld r4,Z+\n"
+        "ld r5,Z+\n"
+        "movw %[x],r30\n"
+        "movw r30,%[y]\n"
+        "clr r6\n"
+        "clr r7\n"
+        "clr r8\n"
+        "clr r9\n"
+
+        // Inner loop over the bytes of y.
+        "ldi r18,32\n"
+        "1:\n"
+        "ld r11,Z+\n"
+        "ld r16,X\n"
+        "mul r2,r11\n"
+        "movw r12,r0\n"
+        "mul r4,r11\n"
+        "movw r14,r0\n"
+        "clr r10\n"
+        "add r6,r12\n"
+        "adc r7,r13\n"
+        "adc r8,r14\n"
+        "adc r9,r15\n"
+        "adc r10,r17\n"
+        "mul r3,r11\n"
+        "add r7,r0\n"
+        "adc r8,r1\n"
+        "adc r9,r17\n"
+        "adc r10,r17\n"
+        "mul r5,r11\n"
+        "add r9,r0\n"
+        "adc r10,r1\n"
+        "add r6,r16\n"
+        "adc r7,r17\n"
+        "adc r8,r17\n"
+        "adc r9,r17\n"
+        "adc r10,r17\n"
+        "st X+,r6\n"
+        "mov r6,r7\n"
+        "mov r7,r8\n"
+        "mov r8,r9\n"
+        "mov r9,r10\n"
+        "dec r18\n"
+        "brne 1b\n"
+
+        // Store the carry window into the next 4 bytes of the result
+        // and then back up to the start of the next row.
+        "st X+,r6\n"
+        "st X+,r7\n"
+        "st X+,r8\n"
+        "st X+,r9\n"
+        "sbiw r26,32\n"
+        "dec r19\n"
+        "brne 2b\n"
+        "clr r1\n"
+        : [x] "+r" (xx), "+x" (result)
+        : [y] "r" (y)
+        : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9",
+          "r10", "r11", "r12", "r13", "r14", "r15", "r16", "r17", "r18",
+          "r19", "r30", "r31", "memory"
+    );
+#else
     uint8_t i, j;
     dlimb_t carry;
     limb_t word;
@@ -564,6 +728,7 @@ void Curve25519::mulNoReduce(limb_t *result, const limb_t *x, const limb_t *y)
         }
         *rr = (limb_t)carry;
     }
+#endif
 }
 
 /**
@@ -584,6 +749,86 @@ void Curve25519::mul(limb_t *result, const limb_t *x, const limb_t *y)
     strict_clean(temp);
 }
 
+/**
+ * \brief Squares a value and then reduces it modulo 2^255 - 19.
+ *
+ * \param result The result, which must be NUM_LIMBS_256BIT limbs in size
+ * and can be the same array as \a x.
+ * \param x The value to square, which must be NUM_LIMBS_256BIT limbs in size.
+ *
+ * Each cross product x[i] * x[j] for i != j appears twice in the square
+ * so it is computed once and then the sum of cross products is doubled.
+ * This needs about half of the limb multiplications that mul() needs.
+ *
+ * \sa squareN(), mul()
+ */
+void Curve25519::square(limb_t *result, const limb_t *x)
+{
+#if CRYPTO_CURVE25519_ASM_AVR
+    // The assembly version of mulNoReduce() is faster than squaring in C.
+    mul(result, x, x);
+#else
+    limb_t temp[NUM_LIMBS_512BIT];
+    uint8_t i, j;
+    dlimb_t carry;
+    limb_t word;
+
+    // Sum the cross products x[i] * x[j] for i < j.
+    memset(temp, 0, sizeof(temp));
+    for (i = 0; i < (NUM_LIMBS_256BIT - 1); ++i) {
+        word = x[i];
+        carry = 0;
+        for (j = i + 1; j < NUM_LIMBS_256BIT; ++j) {
+            carry += ((dlimb_t)(x[j])) * word;
+            carry += temp[i + j];
+            temp[i + j] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        temp[i + NUM_LIMBS_256BIT] = (limb_t)carry;
+    }
+
+    // Double the cross products and add the squares x[i] * x[i].
+    // The doubling is done a limb pair at a time as we go.
+    carry = 0;
+    word = 0;
+    for (i = 0; i < NUM_LIMBS_256BIT; ++i) {
+        limb_t lo = temp[2 * i];
+        limb_t hi = temp[2 * i + 1];
+        carry += ((dlimb_t)(x[i])) * x[i];
+        carry += (limb_t)((lo << 1) | word);
+        temp[2 * i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+        carry += (limb_t)((hi << 1) | (lo >> (LIMB_BITS - 1)));
+        temp[2 * i + 1] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+        word = hi >> (LIMB_BITS - 1);
+    }
+
+    // Reduce the result.
+    reduce(result, temp, NUM_LIMBS_256BIT);
+    strict_clean(temp);
+#endif
+}
+
+/**
+ * \brief Squares a value \a n times and then reduces it modulo 2^255 - 19.
+ *
+ * \param result The result, which must be NUM_LIMBS_256BIT limbs in size
+ * and can be the same array as \a x.
+ * \param x The value to square, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param n The number of times to square \a x, which must be at least 1.
+ *
+ * The result is x^(2^n) modulo 2^255 - 19.
+ *
+ * \sa square()
+ */
+void Curve25519::squareN(limb_t *result, const limb_t *x, uint8_t n)
+{
+    square(result, x);
+    while (--n > 0)
+        square(result, result);
+}
+
 /**
  * \fn void Curve25519::square(limb_t *result, const limb_t *x)
  * \brief Squares a value and then reduces it modulo 2^255 - 19.
@@ -612,8 +857,10 @@ void Curve25519::mulA24(limb_t *result, const limb_t *x)
     static limb_t const a24[2] PROGMEM = {0xDB41, 0x0001};
 #elif BIGNUMBER_LIMB_32BIT
     static limb_t const a24[1] PROGMEM = {0x0001DB41};
+#elif BIGNUMBER_LIMB_64BIT
+    static limb_t const a24[1] PROGMEM = {0x000000000001DB41};
 #else
-    #error "limb_t must be 8, 16, or 32 bits in size"
+    #error "limb_t must be 8, 16, 32, or 64 bits in size"
 #endif
     #define NUM_A24_LIMBS   (sizeof(a24) / sizeof(limb_t))
 
@@ -786,22 +1033,9 @@ void Curve25519::sub(limb_t *result, const limb_t *x, const limb_t *y)
  */
 void Curve25519::cswap(limb_t select, limb_t *x, limb_t *y)
 {
-    uint8_t posn;
-    limb_t dummy;
-    limb_t sel;
-
-    // Turn "select" into an all-zeroes or all-ones mask.  We don't care
-    // which bit or bits is set in the original "select" value.
-    sel = (limb_t)(((((dlimb_t)1) << LIMB_BITS) - select) >> LIMB_BITS);
-    --sel;
-
     // Swap the two values based on "select".  Algorithm from:
     // https://tools.ietf.org/html/draft-irtf-cfrg-curves-02
-    for (posn = 0; posn < NUM_LIMBS_256BIT; ++posn) {
-        dummy = sel & (x[posn] ^ y[posn]);
-        x[posn] ^= dummy;
-        y[posn] ^= dummy;
-    }
+    ctSwap(select, x, y, NUM_LIMBS_256BIT);
 }
 
 /**
@@ -818,20 +1052,8 @@ void Curve25519::cswap(limb_t select, limb_t *x, limb_t *y)
  */
 void Curve25519::cmove(limb_t select, limb_t *x, const limb_t *y)
 {
-    uint8_t posn;
-    limb_t dummy;
-    limb_t sel;
-
-    // Turn "select" into an all-zeroes or all-ones mask.  We don't care
-    // which bit or bits is set in the original "select" value.
-    sel = (limb_t)(((((dlimb_t)1) << LIMB_BITS) - select) >> LIMB_BITS);
-    --sel;
-
     // Move y into x based on "select".  Similar to conditional swap above.
-    for (posn = 0; posn < NUM_LIMBS_256BIT; ++posn) {
-        dummy = sel & (x[posn] ^ y[posn]);
-        x[posn] ^= dummy;
-    }
+    ctMove(select, x, y, NUM_LIMBS_256BIT);
 }
 
 /**
@@ -858,13 +1080,10 @@ void Curve25519::pow250(limb_t *result, const limb_t *x)
     // Build a pattern of 250 bits in length of repeated copies of 0000000001.
     #define RECIP_GROUP_SIZE 10
     #define RECIP_GROUP_BITS 250    // Must be a multiple of RECIP_GROUP_SIZE.
-    square(t1, x);
-    for (j = 0; j < (RECIP_GROUP_SIZE - 1); ++j)
-        square(t1, t1);
+    squareN(t1, x, RECIP_GROUP_SIZE);
     mul(result, t1, x);
     for (i = 0; i < ((RECIP_GROUP_BITS / RECIP_GROUP_SIZE) - 2); ++i) {
-        for (j = 0; j < RECIP_GROUP_SIZE; ++j)
-            square(t1, t1);
+        squareN(t1, t1, RECIP_GROUP_SIZE);
         mul(result, result, t1);
     }
 
@@ -897,11 +1116,9 @@ void Curve25519::recip(limb_t *result, const limb_t *x)
     pow250(result, x);
 
     // Deal with the 5 lowest bits of (p - 2), 01011, from highest to lowest.
-    square(result, result);
-    square(result, result);
+    squareN(result, result, 2);
     mul(result, result, x);
-    square(result, result);
-    square(result, result);
+    squareN(result, result, 2);
     mul(result, result, x);
     square(result, result);
     mul(result, result, x);
@@ -926,8 +1143,8 @@ bool Curve25519::sqrt(limb_t *result, const limb_t *x)
 {
     // sqrt(-1) mod (2^255 - 19).
     static limb_t const numSqrtM1[NUM_LIMBS_256BIT] PROGMEM = {
-        LIMB(0x4A0EA0B0), LIMB(0xC4EE1B27), LIMB(0xAD2FE478), LIMB(0x2F431806),
-        LIMB(0x3DFBD7A7), LIMB(0x2B4D0099), LIMB(0x4FC1DF0B), LIMB(0x2B832480)
+        LIMB_PAIR(0x4A0EA0B0, 0xC4EE1B27), LIMB_PAIR(0xAD2FE478, 0x2F431806),
+        LIMB_PAIR(0x3DFBD7A7, 0x2B4D0099), LIMB_PAIR(0x4FC1DF0B, 0x2B832480)
     };
     limb_t y[NUM_LIMBS_256BIT];
 
@@ -25,6 +25,23 @@
 
 #include "BigNumberUtil.h"
 
+// Compute the public value in dh1() by multiplying the base point with
+// the fixed-base comb table from Ed25519 and then mapping the result back
+// to Montgomery form.  This is only used if CRYPTO_ED25519_COMB is enabled.
+#if !defined(CRYPTO_CURVE25519_FIXED_BASE)
+#define CRYPTO_CURVE25519_FIXED_BASE 1
+#endif
+
+// Use hand-written assembly code for multiplication and reduction
+// modulo 2^255 - 19 on AVR platforms.
+#if !defined(CRYPTO_CURVE25519_ASM_AVR)
+#if defined(__AVR__)
+#define CRYPTO_CURVE25519_ASM_AVR 1
+#else
+#define CRYPTO_CURVE25519_ASM_AVR 0
+#endif
+#endif
+
 class Ed25519;
 
 class Curve25519
@@ -42,16 +59,18 @@ private:
 #endif
     static uint8_t isWeakPoint(const uint8_t k[32]);
 
+#if CRYPTO_CURVE25519_FIXED_BASE
+    static void evalBase(uint8_t result[32], const uint8_t s[32]);
+#endif
+
     static void reduce(limb_t *result, limb_t *x, uint8_t size);
     static limb_t reduceQuick(limb_t *x);
 
     static void mulNoReduce(limb_t *result, const limb_t *x, const limb_t *y);
 
     static void mul(limb_t *result, const limb_t *x, const limb_t *y);
-    static void square(limb_t *result, const limb_t *x)
-    {
-        mul(result, x, x);
-    }
+    static void square(limb_t *result, const limb_t *x);
+    static void squareN(limb_t *result, const limb_t *x, uint8_t n);
 
     static void mulA24(limb_t *result, const limb_t *x);
 
@@ -24,6 +24,7 @@
 #include "Curve25519.h"
 #include "Crypto.h"
 #include "RNG.h"
+#include "CryptoWorker.h"
 #include "utility/LimbUtil.h"
 #include <string.h>
 
@@ -55,6 +56,9 @@
  * Ed25519::sign(signature, privateKey, publicKey, message, N);
  * \endcode
  *
+ * A device that signs many messages with the same key can expand it once
+ * into a PrivateKey object, which saves a SHA512 hash on every signature.
+ *
  * And then to verify the signature:
  *
  * \code
@@ -64,10 +68,35 @@
  * }
  * \endcode
  *
+ * A gateway that verifies many signatures from the same devices can
+ * decode each public key once into a PublicKey object and pass that to
+ * verify() instead of the 32-byte encoded form.  This skips the square
+ * root that is otherwise needed to decompress the key on every call.
+ * A PrecomputedPublicKey also keeps a table of multiples of the key,
+ * which makes the rest of verify() about 10% faster again:
+ *
+ * \code
+ * Ed25519::PrecomputedPublicKey key;
+ * if (!key.setKey(publicKey)) {
+ *     // The public key is not a valid curve point.
+ *     ...
+ * }
+ * if (!Ed25519::verify(signature, key, message, N)) {
+ *     // The signature is invalid.
+ *     ...
+ * }
+ * \endcode
+ *
  * \note The public functions in this class need a substantial amount of
  * stack space to store intermediate results while the curve function is
  * being evaluated.  About 1.5k of free stack space is recommended for safety.
  *
+ * Multiplication by the base point in sign(), verify(), and derivePublicKey()
+ * uses a 1536 byte table of precomputed points in program memory, which
+ * makes those steps about three times faster.  Define CRYPTO_ED25519_COMB
+ * to 0 to use the generic double-and-add ladder instead if program memory
+ * is in short supply.
+ *
  * References: https://tools.ietf.org/id/draft-josefsson-eddsa-ed25519-02.txt
  *
  * \sa Curve25519
@@ -77,38 +106,220 @@
 
 // 37095705934669439343138083508754565189542113879843219016388785533085940283555
 static limb_t const numD[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x135978A3), LIMB(0x75EB4DCA), LIMB(0x4141D8AB), LIMB(0x00700A4D),
-    LIMB(0x7779E898), LIMB(0x8CC74079), LIMB(0x2B6FFE73), LIMB(0x52036CEE)
+    LIMB_PAIR(0x135978A3, 0x75EB4DCA), LIMB_PAIR(0x4141D8AB, 0x00700A4D),
+    LIMB_PAIR(0x7779E898, 0x8CC74079), LIMB_PAIR(0x2B6FFE73, 0x52036CEE)
 };
 
 // d * 2
 static limb_t const numDx2[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x26B2F159), LIMB(0xEBD69B94), LIMB(0x8283B156), LIMB(0x00E0149A),
-    LIMB(0xEEF3D130), LIMB(0x198E80F2), LIMB(0x56DFFCE7), LIMB(0x2406D9DC)
+    LIMB_PAIR(0x26B2F159, 0xEBD69B94), LIMB_PAIR(0x8283B156, 0x00E0149A),
+    LIMB_PAIR(0xEEF3D130, 0x198E80F2), LIMB_PAIR(0x56DFFCE7, 0x2406D9DC)
 };
 
 // Extended homogenous co-ordinates for the base point.
 static limb_t const numBx[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x8F25D51A), LIMB(0xC9562D60), LIMB(0x9525A7B2), LIMB(0x692CC760),
-    LIMB(0xFDD6DC5C), LIMB(0xC0A4E231), LIMB(0xCD6E53FE), LIMB(0x216936D3)
+    LIMB_PAIR(0x8F25D51A, 0xC9562D60), LIMB_PAIR(0x9525A7B2, 0x692CC760),
+    LIMB_PAIR(0xFDD6DC5C, 0xC0A4E231), LIMB_PAIR(0xCD6E53FE, 0x216936D3)
 };
 static limb_t const numBy[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x66666658), LIMB(0x66666666), LIMB(0x66666666), LIMB(0x66666666),
-    LIMB(0x66666666), LIMB(0x66666666), LIMB(0x66666666), LIMB(0x66666666)
+    LIMB_PAIR(0x66666658, 0x66666666), LIMB_PAIR(0x66666666, 0x66666666),
+    LIMB_PAIR(0x66666666, 0x66666666), LIMB_PAIR(0x66666666, 0x66666666)
 };
 static limb_t const numBz[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x00000001), LIMB(0x00000000), LIMB(0x00000000), LIMB(0x00000000),
-    LIMB(0x00000000), LIMB(0x00000000), LIMB(0x00000000), LIMB(0x00000000)
+    LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+    LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)
 };
 static limb_t const numBt[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0xA5B7DDA3), LIMB(0x6DDE8AB3), LIMB(0x775152F5), LIMB(0x20F09F80),
-    LIMB(0x64ABE37D), LIMB(0x66EA4E8E), LIMB(0xD78B7665), LIMB(0x67875F0F)
+    LIMB_PAIR(0xA5B7DDA3, 0x6DDE8AB3), LIMB_PAIR(0x775152F5, 0x20F09F80),
+    LIMB_PAIR(0x64ABE37D, 0x66EA4E8E), LIMB_PAIR(0xD78B7665, 0x67875F0F)
+};
+
+#if CRYPTO_ED25519_COMB
+
+// Comb table for multiplying by the base point B with 4 teeth spaced 64
+// bits apart.  Entry j is the sum of (2^(64 * k)) * B for every bit k that
+// is set in j.  The points are stored as (y + x, y - x, 2 * d * x * y) with
+// an implicit z of 1 so they can be added to a point in extended
+// homogeneous coordinates with one less multiplication.  Entry 0 is the
+// identity (1, 1, 0), which the addition formula also handles correctly.
+static limb_t const numBComb[16][3][NUM_LIMBS_256BIT] PROGMEM = {
+    {{LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)}},
+    {{LIMB_PAIR(0xF58C3B85, 0x2FBC93C6), LIMB_PAIR(0xFB8C0E19, 0xCF932DC6),
+      LIMB_PAIR(0x643D42C2, 0x270B4898), LIMB_PAIR(0x33D4BA65, 0x07CF9D3A)},
+     {LIMB_PAIR(0xD740913E, 0x9D103905), LIMB_PAIR(0xD140BEB3, 0xFD399F05),
+      LIMB_PAIR(0x688F8A09, 0xA5C18434), LIMB_PAIR(0x98F81267, 0x44FD2F92)},
+     {LIMB_PAIR(0x877AAA68, 0xABC91205), LIMB_PAIR(0xCCAAC49E, 0x26D9E823),
+      LIMB_PAIR(0xDD43598C, 0x5A1B7DCB), LIMB_PAIR(0x9F0C65A8, 0x6F117B68)}},
+    {{LIMB_PAIR(0x77D1F515, 0xCD2A65E7), LIMB_PAIR(0x8FAA60F1, 0x54899187),
+      LIMB_PAIR(0xDABC06E5, 0xB1B73BBC), LIMB_PAIR(0xA97CC9FB, 0x654878CB)},
+     {LIMB_PAIR(0x8DF6B0FE, 0x51138EC7), LIMB_PAIR(0xE575F51B, 0x5397DA89),
+      LIMB_PAIR(0x717AF1B9, 0x09207A1D), LIMB_PAIR(0x2B20D650, 0x2102FDBA)},
+     {LIMB_PAIR(0x055CE6A1, 0x969EE405), LIMB_PAIR(0x1251AD29, 0x36BCA768),
+      LIMB_PAIR(0xAA7DA415, 0x3A1AF517), LIMB_PAIR(0x29ECB2BA, 0x0AD725DB)}},
+    {{LIMB_PAIR(0x601E59E8, 0x0055C585), LIMB_PAIR(0x66480E60, 0x8793342B),
+      LIMB_PAIR(0xFE45E44C, 0x3E14AAD0), LIMB_PAIR(0x4813CF2B, 0x26EAD8E6)},
+     {LIMB_PAIR(0x9C8462A4, 0xCB75B8B6), LIMB_PAIR(0x67D31CD7, 0x2DD86FC5),
+      LIMB_PAIR(0x881342F6, 0xCD1972EC), LIMB_PAIR(0x0FC12F2F, 0x0975B597)},
+     {LIMB_PAIR(0xDA5BA743, 0x63CF2303), LIMB_PAIR(0x52F1BA6E, 0x04BF9D81),
+      LIMB_PAIR(0xAA7367DA, 0x333790D0), LIMB_PAIR(0x9DF6C5EA, 0x53467047)}},
+    {{LIMB_PAIR(0xACAD8EA2, 0x583B04BF), LIMB_PAIR(0x148BE884, 0x29B743E8),
+      LIMB_PAIR(0x0810C5DB, 0x2B1E583B), LIMB_PAIR(0x8EB3BBAA, 0x2B5449E5)},
+     {LIMB_PAIR(0xEB3DBE47, 0x5F3A7562), LIMB_PAIR(0x8EBDA0B8, 0xF7EA3854),
+      LIMB_PAIR(0x45747299, 0x00C3E531), LIMB_PAIR(0x1627D551, 0x1304E9E7)},
+     {LIMB_PAIR(0x6ADC9CFE, 0x789814D2), LIMB_PAIR(0x8B48DD0B, 0x3C1BAB3F),
+      LIMB_PAIR(0xF979C60A, 0xDA0FE1FF), LIMB_PAIR(0x7C2DD693, 0x4468DE2D)}},
+    {{LIMB_PAIR(0xE3BC6748, 0x2118278D), LIMB_PAIR(0xD0B20EF7, 0xE71FFD60),
+      LIMB_PAIR(0xC67BB198, 0xF551BE51), LIMB_PAIR(0xD0543D4D, 0x26A13664)},
+     {LIMB_PAIR(0x13A339EE, 0x29522D3B), LIMB_PAIR(0x6CD89529, 0x85522550),
+      LIMB_PAIR(0xACF4F0F1, 0xDFEA3AD4), LIMB_PAIR(0x7942742E, 0x49D76BBA)},
+     {LIMB_PAIR(0x8D56E61D, 0x14FA4233), LIMB_PAIR(0xC351299A, 0x191D3946),
+      LIMB_PAIR(0xA7ADB185, 0x247D576D), LIMB_PAIR(0xA8FCEDC2, 0x4E1FAFE3)}},
+    {{LIMB_PAIR(0x236A044C, 0x15E7053D), LIMB_PAIR(0x3B8D87E3, 0x3CDDBCB1),
+      LIMB_PAIR(0xD321A828, 0x519960D2), LIMB_PAIR(0x0FC5BBA4, 0x4E559A0F)},
+     {LIMB_PAIR(0x9C12701C, 0xFE00E876), LIMB_PAIR(0x039C3B5F, 0x95DCDC0A),
+      LIMB_PAIR(0x0C02EB1B, 0xC169454B), LIMB_PAIR(0x5F87530C, 0x727021D3)},
+     {LIMB_PAIR(0x27DF241E, 0xA5710407), LIMB_PAIR(0xB2900D36, 0xDF45EFAA),
+      LIMB_PAIR(0x60A69ADE, 0xFE6EDB5C), LIMB_PAIR(0x07BBC01D, 0x64FCB730)}},
+    {{LIMB_PAIR(0x6FD390CA, 0x38EF58CC), LIMB_PAIR(0x171A98FC, 0xEF786575),
+      LIMB_PAIR(0xC442D65F, 0x8850B78F), LIMB_PAIR(0x6FD086EF, 0x6F34C66D)},
+     {LIMB_PAIR(0x3898DC04, 0x93F3CBB4), LIMB_PAIR(0x4307B727, 0x0791FFB2),
+      LIMB_PAIR(0xCE34981D, 0xD7BD8096), LIMB_PAIR(0x8B849F6D, 0x0B598B8E)},
+     {LIMB_PAIR(0x0CC2F689, 0x11CFC18A), LIMB_PAIR(0xB529CE2A, 0x81114607),
+      LIMB_PAIR(0xC00B5940, 0x0A9BC046), LIMB_PAIR(0xB1AC66C8, 0x412128B0)}},
+    {{LIMB_PAIR(0xC80C1AC0, 0xA66DCC9D), LIMB_PAIR(0x1B38A436, 0x97A05CF4),
+      LIMB_PAIR(0x95DBD7C6, 0xA7EBF3BE), LIMB_PAIR(0x8D7E7DAB, 0x7DA0B8F6)},
+     {LIMB_PAIR(0x385675A6, 0xEF782014), LIMB_PAIR(0xAAFDA9E8, 0xA2649F30),
+      LIMB_PAIR(0x5CDFA8CB, 0x4CD1EB50), LIMB_PAIR(0x1D4DC0B3, 0x46115ABA)},
+     {LIMB_PAIR(0xC3B5DA76, 0xD40F1953), LIMB_PAIR(0x21119E9B, 0x1DAC6F73),
+      LIMB_PAIR(0xFEB25960, 0x03CC6021), LIMB_PAIR(0x83674B4B, 0x5A5F887E)}},
+    {{LIMB_PAIR(0x0CA2C1F4, 0x0A8D6018), LIMB_PAIR(0xCC68DF40, 0x815EB0DB),
+      LIMB_PAIR(0xB82F4E99, 0xD7E67A47), LIMB_PAIR(0x607F15C0, 0x45A02890)},
+     {LIMB_PAIR(0xFD41F184, 0xFEF366D1), LIMB_PAIR(0x01CFE11E, 0x8B694A11),
+      LIMB_PAIR(0x0150A74D, 0x4B39E15E), LIMB_PAIR(0x6AD351BA, 0x4013F03D)},
+     {LIMB_PAIR(0x6EE065CC, 0xBD0282DC), LIMB_PAIR(0x224AE646, 0x36B994FD),
+      LIMB_PAIR(0xFEBCE874, 0x534E9AD8), LIMB_PAIR(0xD9F06E4F, 0x482255C1)}},
+    {{LIMB_PAIR(0x71CEF800, 0x3C03EACF), LIMB_PAIR(0xCA8AFEBB, 0x90367544),
+      LIMB_PAIR(0x6A29C477, 0x383FEA28), LIMB_PAIR(0xBC655462, 0x4E8593B0)},
+     {LIMB_PAIR(0xA3E5638C, 0x12DE114A), LIMB_PAIR(0x29C4F20D, 0xBA2A4AA9),
+      LIMB_PAIR(0x7B8B13A3, 0x56B0D29D), LIMB_PAIR(0x7B9B7944, 0x6BB91A49)},
+     {LIMB_PAIR(0xC5E7D206, 0x2A49E646), LIMB_PAIR(0x9263C445, 0xB13EF9CD),
+      LIMB_PAIR(0xEDAB529E, 0x50AB6CE8), LIMB_PAIR(0xB0EBE39B, 0x20CF7D79)}},
+    {{LIMB_PAIR(0x8AE75C48, 0xCBD28F4E), LIMB_PAIR(0x44000B60, 0x3CDE0291),
+      LIMB_PAIR(0x98BC2170, 0x373BB9C8), LIMB_PAIR(0x9F570886, 0x7C118853)},
+     {LIMB_PAIR(0xF0FE7DCA, 0x7DB4939D), LIMB_PAIR(0xCBA951CE, 0xF50EB90F),
+      LIMB_PAIR(0x357E1D1D, 0x098BE61C), LIMB_PAIR(0x8899469D, 0x02356237)},
+     {LIMB_PAIR(0xE15A4C03, 0x20F6EFFA), LIMB_PAIR(0x3C778E05, 0x2F470A94),
+      LIMB_PAIR(0xFC99DE67, 0x79F50A03), LIMB_PAIR(0xD1061483, 0x38D20188)}},
+    {{LIMB_PAIR(0x0E6315DF, 0x23E811AD), LIMB_PAIR(0xE2AEB290, 0x0B650D05),
+      LIMB_PAIR(0xA75D586C, 0xB7BA0F59), LIMB_PAIR(0x5E1F4DEE, 0x043EEDD4)},
+     {LIMB_PAIR(0xC7073217, 0xF6C147F2), LIMB_PAIR(0xF3AFD20C, 0xC651B919),
+      LIMB_PAIR(0x7041F802, 0x258FDBFD), LIMB_PAIR(0x4F45073E, 0x173C4FA9)},
+     {LIMB_PAIR(0x928DF9C4, 0x3D71EA60), LIMB_PAIR(0x3373562D, 0x5B7E7806),
+      LIMB_PAIR(0xA29552B2, 0xD9B0514C), LIMB_PAIR(0x993CC472, 0x1E2A7024)}},
+    {{LIMB_PAIR(0xD45C811F, 0x601A0FBC), LIMB_PAIR(0x92EC0803, 0x24B7BC7D),
+      LIMB_PAIR(0x17D2407F, 0xA0CAE62B), LIMB_PAIR(0x06225B26, 0x5FCB43EE)},
+     {LIMB_PAIR(0x3509FBA4, 0x310509B9), LIMB_PAIR(0x05631B75, 0x0D8DB376),
+      LIMB_PAIR(0x52401C87, 0x97DECCBA), LIMB_PAIR(0x11B2E773, 0x044649F4)},
+     {LIMB_PAIR(0x9598215F, 0x0C0D24AD), LIMB_PAIR(0xCC36628C, 0x1B7F9026),
+      LIMB_PAIR(0x7016DCEA, 0x338E2F55), LIMB_PAIR(0x5CC0E58F, 0x0C8A1BFA)}},
+    {{LIMB_PAIR(0x681D104C, 0x8DE703B5), LIMB_PAIR(0x1263CB45, 0x3D2F7A59),
+      LIMB_PAIR(0x1CE56C63, 0xAE710C17), LIMB_PAIR(0xFCC3E6CA, 0x6B857C7E)},
+     {LIMB_PAIR(0x8B2801C0, 0x79D256B4), LIMB_PAIR(0x3C400FC4, 0x7E9FBEAC),
+      LIMB_PAIR(0x4733BA41, 0xA751AB1D), LIMB_PAIR(0xDD418ACA, 0x09DE2BF5)},
+     {LIMB_PAIR(0xEFF0687F, 0x3BF10FF3), LIMB_PAIR(0xF1E37BA2, 0x5EBAEA34),
+      LIMB_PAIR(0x1D66034D, 0xE49E6126), LIMB_PAIR(0xC3B242CA, 0x5B466E2A)}},
+    {{LIMB_PAIR(0x47FBB842, 0x137EEB67), LIMB_PAIR(0x60811A8B, 0x79DF5C75),
+      LIMB_PAIR(0x71F8C89A, 0x5A2BA76F), LIMB_PAIR(0x3BC8FFC2, 0x09952A56)},
+     {LIMB_PAIR(0xDC7EF83C, 0xA2A8CB4B), LIMB_PAIR(0x5F93C226, 0x96B5C6FA),
+      LIMB_PAIR(0x0664E3A5, 0xD4EBEB1B), LIMB_PAIR(0xE5C6CF2F, 0x409B4ADC)},
+     {LIMB_PAIR(0x834350C4, 0x44D53DB9), LIMB_PAIR(0xA5F505B4, 0x89299305),
+      LIMB_PAIR(0x5949FF2F, 0xFB22FAA2), LIMB_PAIR(0x04657D64, 0x69B968A7)}}
+};
+
+#endif // CRYPTO_ED25519_COMB
+
+#if CRYPTO_ED25519_STRAUSS
+
+// Odd multiples B, 3B, 5B, ..., 15B of the base point in the cached form
+// (Y + X, Y - X, Z, 2 * d * T) that is used by addCached().
+static limb_t const numBOdd[8][4][NUM_LIMBS_256BIT] PROGMEM = {
+    {{LIMB_PAIR(0xF58C3B85, 0x2FBC93C6), LIMB_PAIR(0xFB8C0E19, 0xCF932DC6),
+      LIMB_PAIR(0x643D42C2, 0x270B4898), LIMB_PAIR(0x33D4BA65, 0x07CF9D3A)},
+     {LIMB_PAIR(0xD740913E, 0x9D103905), LIMB_PAIR(0xD140BEB3, 0xFD399F05),
+      LIMB_PAIR(0x688F8A09, 0xA5C18434), LIMB_PAIR(0x98F81267, 0x44FD2F92)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x877AAA68, 0xABC91205), LIMB_PAIR(0xCCAAC49E, 0x26D9E823),
+      LIMB_PAIR(0xDD43598C, 0x5A1B7DCB), LIMB_PAIR(0x9F0C65A8, 0x6F117B68)}},
+    {{LIMB_PAIR(0x4CEE9730, 0xAF25B0A8), LIMB_PAIR(0xE8864B8A, 0x025A8430),
+      LIMB_PAIR(0x9F016732, 0xC11B5002), LIMB_PAIR(0x9A80F8F4, 0x7A164E1B)},
+     {LIMB_PAIR(0xA4FCD265, 0x56611FE8), LIMB_PAIR(0xE5C1BA7D, 0x3BD353FD),
+      LIMB_PAIR(0x214BD6BD, 0x8131F31A), LIMB_PAIR(0x555BDA62, 0x2AB91587)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x0DD0D889, 0x14AE933F), LIMB_PAIR(0x1C35DA62, 0x58942322),
+      LIMB_PAIR(0x8CF2DB4C, 0xD170E545), LIMB_PAIR(0x12B9B4C6, 0x5A2826AF)}},
+    {{LIMB_PAIR(0x08A5BB33, 0xA212BC44), LIMB_PAIR(0xC75EED02, 0x8D5048C3),
+      LIMB_PAIR(0x5ABFEC44, 0xDD1BEB0C), LIMB_PAIR(0x46E206EB, 0x2945CCF1)},
+     {LIMB_PAIR(0xA447D6BA, 0x7F9182C3), LIMB_PAIR(0x4B2729B7, 0xD50014D1),
+      LIMB_PAIR(0xB864A087, 0xE33CF11C), LIMB_PAIR(0xEB1B55F3, 0x154A7E73)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x812A8285, 0xBCBBDBF1), LIMB_PAIR(0xD0BDD1FC, 0x270E0807),
+      LIMB_PAIR(0x1BBDA72D, 0xB41B670B), LIMB_PAIR(0x6B3BB69A, 0x43AABE69)}},
+    {{LIMB_PAIR(0x944EA3BF, 0x6B1A5CD0), LIMB_PAIR(0xB39DC0D2, 0x7470353A),
+      LIMB_PAIR(0x28542E49, 0x71B25282), LIMB_PAIR(0x283C927E, 0x461BEA69)},
+     {LIMB_PAIR(0xAA3221B1, 0xBA6F2C9A), LIMB_PAIR(0x3BBA23A7, 0x6CA02153),
+      LIMB_PAIR(0x92192C3A, 0x9DEA764F), LIMB_PAIR(0x2E5317E0, 0x1D6EDD5D)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x01B8B3A2, 0xF1836DC8), LIMB_PAIR(0x053EA49A, 0xB3035F47),
+      LIMB_PAIR(0x5877ADF3, 0x529C41BA), LIMB_PAIR(0x6A0F90A7, 0x7A9FBB1C)}},
+    {{LIMB_PAIR(0xA6A8632F, 0x9B2E678A), LIMB_PAIR(0x51BC46C5, 0xA6509E6F),
+      LIMB_PAIR(0xC686F5B5, 0xCEB233C9), LIMB_PAIR(0x8ADD7F59, 0x34B9ED33)},
+     {LIMB_PAIR(0x039D8064, 0xF36E217E), LIMB_PAIR(0xF520419B, 0x98A081B6),
+      LIMB_PAIR(0xE75EB044, 0x96CBC608), LIMB_PAIR(0xFADC9C8F, 0x49C05A51)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x9045AF1B, 0x06B4E8BF), LIMB_PAIR(0xA719D22F, 0xE2FF83E8),
+      LIMB_PAIR(0x93D4CF16, 0xAAF6FC29), LIMB_PAIR(0x1B008B06, 0x73C17202)}},
+    {{LIMB_PAIR(0x8A802ADE, 0x2FBF0084), LIMB_PAIR(0x02302E27, 0xE5D9FECF),
+      LIMB_PAIR(0x17703406, 0x113E8471), LIMB_PAIR(0x546D8FAF, 0x4275AAE2)},
+     {LIMB_PAIR(0x49864348, 0x315F5B02), LIMB_PAIR(0x77088381, 0x3ED6B369),
+      LIMB_PAIR(0x6A8DEB95, 0xA3A07555), LIMB_PAIR(0x29D5C77F, 0x18AB5980)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0xFD6089E9, 0xD82B2CC5), LIMB_PAIR(0x3282E4A4, 0x031EB4A1),
+      LIMB_PAIR(0xB51A8622, 0x44311199), LIMB_PAIR(0xB53DF948, 0x3DC65522)}},
+    {{LIMB_PAIR(0xA2007F6D, 0xBF70C222), LIMB_PAIR(0xB5BCDEDB, 0xBF84B39A),
+      LIMB_PAIR(0xFB07BA07, 0x537A0E12), LIMB_PAIR(0xC346F241, 0x234FD7EE)},
+     {LIMB_PAIR(0x327FBF93, 0x506F013B), LIMB_PAIR(0x9B776F6B, 0xAEFCEBC9),
+      LIMB_PAIR(0xAAAD5968, 0x9D12B232), LIMB_PAIR(0x176024A7, 0x0267882D)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x732EA378, 0x5360A119), LIMB_PAIR(0xDF8DD471, 0x2437E6B1),
+      LIMB_PAIR(0x91A7E533, 0xA2EF37F8), LIMB_PAIR(0xAA097863, 0x497BA6FD)}},
+    {{LIMB_PAIR(0x13CFEAA0, 0x24CECC03), LIMB_PAIR(0x189C246D, 0x8648C28D),
+      LIMB_PAIR(0xC1F2D4D0, 0x2DBDBDFA), LIMB_PAIR(0xF12DE72B, 0x61E22917)},
+     {LIMB_PAIR(0x468CCF0B, 0x040BCD86), LIMB_PAIR(0x2A9910D6, 0xD3829BA4),
+      LIMB_PAIR(0x07B25192, 0x75083008), LIMB_PAIR(0x18D05EBF, 0x43B5CD42)},
+     {LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000),
+      LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000)},
+     {LIMB_PAIR(0x9BD0B516, 0x5D9A762F), LIMB_PAIR(0x373FDEEE, 0xEB38AF4E),
+      LIMB_PAIR(0x93D64270, 0x032E5A7D), LIMB_PAIR(0x0AE4D842, 0x511D6121)}}
 };
 
+#endif // CRYPTO_ED25519_STRAUSS
+
 // 2^252 + 27742317777372353535851937790883648493
 static limb_t const numQ[NUM_LIMBS_256BIT] PROGMEM = {
-    LIMB(0x5CF5D3ED), LIMB(0x5812631A), LIMB(0xA2F79CD6), LIMB(0x14DEF9DE),
-    LIMB(0x00000000), LIMB(0x00000000), LIMB(0x00000000), LIMB(0x10000000)
+    LIMB_PAIR(0x5CF5D3ED, 0x5812631A), LIMB_PAIR(0xA2F79CD6, 0x14DEF9DE),
+    LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x10000000)
 };
 
 /** @endcond */
@@ -127,20 +338,216 @@ static limb_t const numQ[NUM_LIMBS_256BIT] PROGMEM = {
 void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
                    const uint8_t publicKey[32], const void *message, size_t len)
 {
-    SHA512 hash;
+    Workspace workspace;
+    sign(signature, privateKey, publicKey, message, len, workspace);
+}
+
+/**
+ * \brief Signs a message using an expanded Ed25519 private key.
+ *
+ * \param signature The signature value.
+ * \param privateKey The expanded private key to use to sign the message.
+ * \param message Points to the message to be signed.
+ * \param len The length of the \a message to be signed.
+ *
+ * This is faster than the other form of sign() because the private key
+ * does not need to be hashed again to derive the signing scalar.
+ *
+ * \sa PrivateKey::setKey(), verify()
+ */
+void Ed25519::sign(uint8_t signature[64], const PrivateKey &privateKey,
+                   const void *message, size_t len)
+{
+    Workspace workspace;
+    sign(signature, privateKey, message, len, workspace);
+}
+
+/**
+ * \brief Signs a message using a caller-supplied workspace.
+ *
+ * \param signature The signature value.
+ * \param privateKey The private key to use to sign the message.
+ * \param publicKey The public key corresponding to \a privateKey.
+ * \param message Points to the message to be signed.
+ * \param len The length of the \a message to be signed.
+ * \param workspace Scratch memory to use for the hashing steps and the
+ * intermediate values.
+ *
+ * The other forms of sign() and verify() place a Workspace on the stack
+ * for every call.  Passing a long-lived \a workspace instead, such as a
+ * global that is shared by all signing and verification operations,
+ * takes that memory off the stack so that the peak stack usage is lower
+ * and easier to predict.
+ *
+ * \sa Workspace, verify()
+ */
+void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
+                   const uint8_t publicKey[32], const void *message,
+                   size_t len, Workspace &workspace)
+{
+    signInternal(signature, privateKey, publicKey, workspace.hash,
+                 workspace.scratch, message, len, false, 0, 0);
+}
+
+/**
+ * \brief Signs a message using an expanded private key and a
+ * caller-supplied workspace.
+ *
+ * \param signature The signature value.
+ * \param privateKey The expanded private key to use to sign the message.
+ * \param message Points to the message to be signed.
+ * \param len The length of the \a message to be signed.
+ * \param workspace Scratch memory to use for the hashing steps and the
+ * intermediate values.
+ *
+ * \sa Workspace, PrivateKey::setKey()
+ */
+void Ed25519::sign(uint8_t signature[64], const PrivateKey &privateKey,
+                   const void *message, size_t len, Workspace &workspace)
+{
+    signExpanded(signature, privateKey.a, privateKey.prefix, privateKey.pub,
+                 workspace.hash, workspace.scratch, message, len,
+                 false, 0, 0);
+}
+
+/**
+ * \brief Signs a pre-hashed message using Ed25519ph.
+ *
+ * \param signature The signature value.
+ * \param privateKey The private key to use to sign the message.
+ * \param publicKey The public key corresponding to \a privateKey.
+ * \param hash SHA512 object that the message has been fed into with
+ * SHA512::update().  The object is finalized and then reused for the
+ * rest of the signing process, so its state is destroyed on return.
+ * \param context Points to the context string, or NULL for none.
+ * \param contextLen The length of the \a context string, which must
+ * not be more than 255 bytes.
+ *
+ * This implements the Ed25519ph variant from RFC 8032.  The message
+ * is passed over only once, so it can be signed as it arrives in pieces
+ * without holding all of it in memory:
+ *
+ * \code
+ * SHA512 hash;
+ * hash.reset();
+ * while (...) {
+ *     hash.update(chunk, chunkLen);
+ * }
+ * Ed25519::signPrehash(signature, privateKey, publicKey, hash);
+ * \endcode
+ *
+ * Ed25519ph signatures are not compatible with those created by sign(),
+ * even for the same message.
+ *
+ * \sa verifyPrehash(), sign()
+ */
+void Ed25519::signPrehash(uint8_t signature[64], const uint8_t privateKey[32],
+                          const uint8_t publicKey[32], SHA512 &hash,
+                          const void *context, size_t contextLen)
+{
+    uint8_t ph[64];
+    Scratch scratch;
+    hash.finalize(ph, sizeof(ph));
+    signInternal(signature, privateKey, publicKey, hash, scratch, ph,
+                 sizeof(ph), true, context, contextLen);
+    clean(ph);
+}
+
+/**
+ * \brief Signs a pre-hashed message using Ed25519ph and an expanded
+ * private key.
+ *
+ * \param signature The signature value.
+ * \param privateKey The expanded private key to use to sign the message.
+ * \param hash SHA512 object that the message has been fed into with
+ * SHA512::update().  The object is finalized and then reused for the
+ * rest of the signing process, so its state is destroyed on return.
+ * \param context Points to the context string, or NULL for none.
+ * \param contextLen The length of the \a context string, which must
+ * not be more than 255 bytes.
+ *
+ * \sa verifyPrehash(), PrivateKey::setKey()
+ */
+void Ed25519::signPrehash(uint8_t signature[64], const PrivateKey &privateKey,
+                          SHA512 &hash, const void *context,
+                          size_t contextLen)
+{
+    uint8_t ph[64];
+    Scratch scratch;
+    hash.finalize(ph, sizeof(ph));
+    signExpanded(signature, privateKey.a, privateKey.prefix, privateKey.pub,
+                 hash, scratch, ph, sizeof(ph), true, context, contextLen);
+    clean(ph);
+}
+
+/**
+ * \brief Signs a message, optionally with the Ed25519ph domain prefix.
+ *
+ * \param signature The signature value.
+ * \param privateKey The private key to use to sign the message.
+ * \param publicKey The public key corresponding to \a privateKey.
+ * \param hash SHA512 object to use for the hashing steps.
+ * \param scratch Scratch memory for the intermediate values.
+ * \param message Points to the message (or pre-hash) to be signed.
+ * \param len The length of the \a message to be signed.
+ * \param prehash Set to true if the RFC 8032 dom2() prefix should be
+ * added to the hashes for Ed25519ph.
+ * \param context Points to the context string for dom2().
+ * \param contextLen The length of the \a context string.
+ */
+void Ed25519::signInternal(uint8_t signature[64], const uint8_t privateKey[32],
+                           const uint8_t publicKey[32], SHA512 &hash,
+                           Scratch &scratch, const void *message, size_t len,
+                           bool prehash, const void *context,
+                           size_t contextLen)
+{
     uint8_t *buf = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
-    limb_t a[NUM_LIMBS_256BIT];
-    limb_t r[NUM_LIMBS_256BIT];
-    limb_t k[NUM_LIMBS_256BIT];
-    limb_t t[NUM_LIMBS_512BIT + 1];
-    Point rB;
 
-    // Derive the secret scalar a and the message prefix from the private key.
-    deriveKeys(&hash, a, privateKey);
+    // Derive the secret scalar a and the message prefix from the private
+    // key.  The prefix is left in the second half of the hash buffer.
+    deriveKeys(&hash, scratch.sign.a, privateKey);
+
+    // Sign the message with the expanded key.
+    signExpanded(signature, scratch.sign.a, buf + 32, publicKey, hash,
+                 scratch, message, len, prehash, context, contextLen);
+}
+
+/**
+ * \brief Signs a message using an expanded private key.
+ *
+ * \param signature The signature value.
+ * \param a The secret scalar, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param prefix The 32-byte message prefix, which may point into the
+ * buffer within \a hash.
+ * \param publicKey The public key corresponding to \a a.
+ * \param hash SHA512 object to use for the hashing steps.
+ * \param scratch Scratch memory for the intermediate values.  The \a a
+ * value may point into \a scratch.
+ * \param message Points to the message (or pre-hash) to be signed.
+ * \param len The length of the \a message to be signed.
+ * \param prehash Set to true if the RFC 8032 dom2() prefix should be
+ * added to the hashes for Ed25519ph.
+ * \param context Points to the context string for dom2().
+ * \param contextLen The length of the \a context string.
+ */
+void Ed25519::signExpanded(uint8_t signature[64], const limb_t *a,
+                           const uint8_t *prefix, const uint8_t publicKey[32],
+                           SHA512 &hash, Scratch &scratch,
+                           const void *message, size_t len, bool prehash,
+                           const void *context, size_t contextLen)
+{
+    uint8_t *buf = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
+    limb_t *r = scratch.sign.r;
+    limb_t *k = scratch.sign.k;
+    limb_t *t = scratch.sign.t;
+    Point &rB = scratch.sign.rB;
 
-    // Hash the prefix and the message to derive r.
+    // Hash the prefix and the message to derive r.  The prefix is moved
+    // into k first because adding the domain overwrites the hash buffer.
+    memcpy(k, prefix, 32);
     hash.reset();
-    hash.update(buf + 32, 32);
+    addDomain(&hash, prehash, context, contextLen);
+    hash.update(k, 32);
     hash.update(message, len);
     hash.finalize(buf, 0);
     reduceQFromBuffer(r, buf, t);
@@ -151,6 +558,7 @@ void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
 
     // Hash R, A, and the message to get k.
     hash.reset();
+    addDomain(&hash, prehash, context, contextLen);
     hash.update(signature, 32); // R
     hash.update(publicKey, 32); // A
     hash.update(message, len);
@@ -166,11 +574,7 @@ void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
     BigNumberUtil::packLE(signature + 32, 32, t, NUM_LIMBS_256BIT);
 
     // Clean up.
-    clean(a);
-    clean(r);
-    clean(k);
-    clean(t);
-    clean(rB);
+    clean(scratch.sign);
 }
 
 /**
@@ -189,23 +593,208 @@ void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
 bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
                      const void *message, size_t len)
 {
-    SHA512 hash;
-    Point A;
-    Point R;
-    Point sB;
-    Point kA;
+    Workspace workspace;
+    return verify(signature, publicKey, message, len, workspace);
+}
+
+/**
+ * \brief Verifies a signature using a pre-decoded Ed25519 public key.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The decoded public key to use to verify the signature.
+ * \param message The message whose signature is to be verified.
+ * \param len The length of the \a message to be verified.
+ *
+ * \return Returns true if the \a signature is valid for \a message;
+ * or false if the \a signature is not valid or \a publicKey has not
+ * been set to a valid key.
+ *
+ * This is faster than the other form of verify() when several signatures
+ * are checked against the same key.  If \a publicKey is a
+ * PrecomputedPublicKey, then its table of multiples is used as well.
+ *
+ * \sa PublicKey::setKey()
+ */
+bool Ed25519::verify(const uint8_t signature[64], const PublicKey &publicKey,
+                     const void *message, size_t len)
+{
+    Workspace workspace;
+    return verify(signature, publicKey, message, len, workspace);
+}
+
+/**
+ * \brief Verifies a signature using a caller-supplied workspace.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The public key to use to verify the signature.
+ * \param message The message whose signature is to be verified.
+ * \param len The length of the \a message to be verified.
+ * \param workspace Scratch memory to use for the hashing steps and the
+ * intermediate values.
+ *
+ * \return Returns true if the \a signature is valid for \a message;
+ * or false if the \a signature is not valid.
+ *
+ * \sa Workspace, sign()
+ */
+bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
+                     const void *message, size_t len, Workspace &workspace)
+{
+    return verifyInternal(signature, publicKey, 0, workspace.hash,
+                          workspace.scratch, message, len, false, 0, 0);
+}
+
+/**
+ * \brief Verifies a signature using a pre-decoded public key and a
+ * caller-supplied workspace.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The decoded public key to use to verify the signature.
+ * \param message The message whose signature is to be verified.
+ * \param len The length of the \a message to be verified.
+ * \param workspace Scratch memory to use for the hashing steps and the
+ * intermediate values.
+ *
+ * \return Returns true if the \a signature is valid for \a message;
+ * or false if the \a signature is not valid or \a publicKey has not
+ * been set to a valid key.
+ *
+ * \sa Workspace, PublicKey::setKey()
+ */
+bool Ed25519::verify(const uint8_t signature[64], const PublicKey &publicKey,
+                     const void *message, size_t len, Workspace &workspace)
+{
+    return verifyInternal(signature, publicKey.encoded, &publicKey,
+                          workspace.hash, workspace.scratch, message, len,
+                          false, 0, 0);
+}
+
+/**
+ * \brief Verifies an Ed25519ph signature over a pre-hashed message.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The public key to use to verify the signature.
+ * \param hash SHA512 object that the message has been fed into with
+ * SHA512::update().  The object is finalized and then reused for the
+ * rest of the verification process, so its state is destroyed on return.
+ * \param context Points to the context string, or NULL for none.
+ * \param contextLen The length of the \a context string, which must
+ * not be more than 255 bytes.
+ *
+ * \return Returns true if the \a signature is valid for the message;
+ * or false if the \a signature is not valid.
+ *
+ * \sa signPrehash(), verify()
+ */
+bool Ed25519::verifyPrehash(const uint8_t signature[64],
+                            const uint8_t publicKey[32], SHA512 &hash,
+                            const void *context, size_t contextLen)
+{
+    uint8_t ph[64];
+    Scratch scratch;
+    hash.finalize(ph, sizeof(ph));
+    bool result = verifyInternal(signature, publicKey, 0, hash, scratch, ph,
+                                 sizeof(ph), true, context, contextLen);
+    clean(ph);
+    return result;
+}
+
+/**
+ * \brief Verifies an Ed25519ph signature using a pre-decoded public key.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The decoded public key to use to verify the signature.
+ * \param hash SHA512 object that the message has been fed into with
+ * SHA512::update().  The object is finalized and then reused for the
+ * rest of the verification process, so its state is destroyed on return.
+ * \param context Points to the context string, or NULL for none.
+ * \param contextLen The length of the \a context string, which must
+ * not be more than 255 bytes.
+ *
+ * \return Returns true if the \a signature is valid for the message;
+ * or false if the \a signature is not valid or \a publicKey has not
+ * been set to a valid key.
+ *
+ * \sa signPrehash(), PublicKey::setKey()
+ */
+bool Ed25519::verifyPrehash(const uint8_t signature[64],
+                            const PublicKey &publicKey, SHA512 &hash,
+                            const void *context, size_t contextLen)
+{
+    uint8_t ph[64];
+    Scratch scratch;
+    hash.finalize(ph, sizeof(ph));
+    bool result = verifyInternal(signature, publicKey.encoded, &publicKey,
+                                 hash, scratch, ph, sizeof(ph), true,
+                                 context, contextLen);
+    clean(ph);
+    return result;
+}
+
+/**
+ * \brief Verifies a signature, optionally with the Ed25519ph domain prefix.
+ *
+ * \param signature The signature value to be verified.
+ * \param publicKey The public key to use to verify the signature.
+ * \param key The pre-decoded form of \a publicKey, or NULL if the
+ * public key needs to be decoded.
+ * \param hash SHA512 object to use for the hashing steps.
+ * \param scratch Scratch memory for the intermediate values.
+ * \param message The message (or pre-hash) whose signature is to be verified.
+ * \param len The length of the \a message to be verified.
+ * \param prehash Set to true if the RFC 8032 dom2() prefix should be
+ * added to the hash for Ed25519ph.
+ * \param context Points to the context string for dom2().
+ * \param contextLen The length of the \a context string.
+ *
+ * \return Returns true if the \a signature is valid.
+ */
+bool Ed25519::verifyInternal(const uint8_t signature[64],
+                             const uint8_t publicKey[32],
+                             const PublicKey *key, SHA512 &hash,
+                             Scratch &scratch, const void *message,
+                             size_t len, bool prehash,
+                             const void *context, size_t contextLen)
+{
+    Point &A = scratch.verify.A;
+    Point &R = scratch.verify.R;
+    Point &sB = scratch.verify.sB;
+    Point &kA = scratch.verify.kA;
     uint8_t *k = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
     bool result = false;
+    bool haveA;
 
-    // Decode the public key and the R component of the signature.
-    if (decodePoint(A, publicKey) && decodePoint(R, signature)) {
+    // Decode the public key, unless we were given it already decoded.
+    if (key) {
+        memcpy(&A, &key->A, sizeof(Point));
+        haveA = key->valid;
+    } else {
+        haveA = decodePoint(A, publicKey);
+    }
+
+    // Decode the R component of the signature.
+    if (haveA && decodePoint(R, signature)) {
         // Reconstruct the k value from the signing step.
         hash.reset();
+        addDomain(&hash, prehash, context, contextLen);
         hash.update(signature, 32);
         hash.update(publicKey, 32);
         hash.update(message, len);
         hash.finalize(k, 0);
 
+#if CRYPTO_ED25519_STRAUSS
+        // Calculate s * B - k * A with shared doublings.  The k value
+        // is stored temporarily in kA.t and the s value in kA.z.
+        reduceQFromBuffer(kA.t, k, kA.x);
+        BigNumberUtil::unpackLE(kA.z, NUM_LIMBS_256BIT, signature + 32, 32);
+        if (key && key->table)
+            doubleMul(sB, kA.z, kA.t, key->table, 31);
+        else
+            doubleMul(sB, kA.z, kA.t, A);
+
+        // Compare s * B - k * A and R for equality.
+        result = equal(sB, R);
+#else
         // Calculate s * B.  The s value is stored temporarily in kA.t.
         BigNumberUtil::unpackLE(kA.t, NUM_LIMBS_256BIT, signature + 32, 32);
         mul(sB, kA.t, false);
@@ -218,16 +807,158 @@ bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
 
         // Compare s * B and R + k * A for equality.
         result = equal(sB, R);
+#endif
     }
 
     // Clean up and exit.
-    clean(A);
-    clean(R);
-    clean(sB);
-    clean(kA);
+    clean(scratch.verify);
     return result;
 }
 
+/**
+ * \brief Verifies a batch of signatures.
+ *
+ * \param signatures Array of pointers to the 64-byte signatures to verify.
+ * \param publicKeys Array of pointers to the 32-byte public keys to use.
+ * \param messages Array of pointers to the messages that were signed.
+ * \param lens Array of message lengths.
+ * \param count Number of signatures in the batch.
+ *
+ * \return Returns true if every signature is valid; or false if at least
+ * one of the signatures is invalid.  If false is returned, the caller can
+ * use verify() to work out which signatures are bad.
+ *
+ * The signatures are split into groups of CRYPTO_ED25519_BATCH_SIZE.
+ * Each group is checked with a single multi-scalar multiplication of a
+ * random linear combination of the verification equations:
+ *
+ * \f[(\sum z_i s_i) B - \sum z_i R_i - \sum (z_i k_i) A_i = 0\f]
+ *
+ * This is several times faster than calling verify() for each signature.
+ * The 128-bit multipliers z<sub>i</sub> are derived by hashing all of the
+ * signatures in the group so that a signer cannot predict them and no
+ * random number source is needed.
+ *
+ * A signature whose verification equation differs from zero only by a
+ * point of small order may be accepted by the batch with low probability
+ * even though verify() would reject it.  Honestly generated signatures
+ * never have this property.
+ *
+ * The tables for each group are kept on the stack, which takes about
+ * 1250 + (576 + 256 * CRYPTO_ED25519_BATCH_WINDOW) *
+ * CRYPTO_ED25519_BATCH_SIZE bytes.  The defaults are chosen to fit the
+ * stack of the main loop on each platform.
+ *
+ * \sa verify()
+ */
+bool Ed25519::verifyBatch(const uint8_t *signatures[],
+                          const uint8_t *publicKeys[],
+                          const void *messages[], const size_t lens[],
+                          size_t count)
+{
+#if CRYPTO_ED25519_STRAUSS && CRYPTO_ED25519_BATCH_SIZE > 1
+    while (count > 1) {
+        size_t size = count;
+        if (size > CRYPTO_ED25519_BATCH_SIZE)
+            size = CRYPTO_ED25519_BATCH_SIZE;
+        if (!verifyBatchChunk(signatures, publicKeys, messages, lens, size))
+            return false;
+        signatures += size;
+        publicKeys += size;
+        messages += size;
+        lens += size;
+        count -= size;
+    }
+#endif
+    while (count > 0) {
+        if (!verify(*signatures++, *publicKeys++, *messages++, *lens++))
+            return false;
+        --count;
+    }
+    return true;
+}
+
+// Maximum number of batches to hand to a CryptoWorker at once.
+#define ED25519_WORKER_JOBS 4
+
+/**
+ * \brief Verifies a batch of signatures using all cores of the processor.
+ *
+ * \param signatures Array of pointers to the 64-byte signatures to verify.
+ * \param publicKeys Array of pointers to the 32-byte public keys to use.
+ * \param messages Array of pointers to the messages that were signed.
+ * \param lens Array of message lengths.
+ * \param count Number of signatures in the batch.
+ * \param worker The worker to use to spread the groups of signatures
+ * across the cores.
+ *
+ * \return Returns true if every signature is valid; or false if at least
+ * one of the signatures is invalid.
+ *
+ * This works the same as the other form of verifyBatch(), except that the
+ * groups of CRYPTO_ED25519_BATCH_SIZE signatures are verified in parallel
+ * by \a worker.  If batching is disabled, then each signature is a
+ * separate job for \a worker instead.
+ *
+ * CryptoWorker::run() also executes some of the jobs on the calling task,
+ * so the calling task needs as much stack as the other form of
+ * verifyBatch(), on top of the helper task's stack.
+ *
+ * \sa CryptoWorker
+ */
+bool Ed25519::verifyBatch(const uint8_t *signatures[],
+                          const uint8_t *publicKeys[],
+                          const void *messages[], const size_t lens[],
+                          size_t count, CryptoWorker &worker)
+{
+#if CRYPTO_ED25519_STRAUSS && CRYPTO_ED25519_BATCH_SIZE > 1
+    const size_t maxSize = CRYPTO_ED25519_BATCH_SIZE;
+#else
+    const size_t maxSize = 1;
+#endif
+    BatchJob jobs[ED25519_WORKER_JOBS];
+    void *args[ED25519_WORKER_JOBS];
+    while (count > 0) {
+        size_t njobs = 0;
+        while (count > 0 && njobs < ED25519_WORKER_JOBS) {
+            size_t size = count;
+            if (size > maxSize)
+                size = maxSize;
+            BatchJob *job = &jobs[njobs];
+            job->signatures = signatures;
+            job->publicKeys = publicKeys;
+            job->messages = messages;
+            job->lens = lens;
+            job->count = size;
+            job->result = false;
+            args[njobs++] = job;
+            signatures += size;
+            publicKeys += size;
+            messages += size;
+            lens += size;
+            count -= size;
+        }
+        worker.run(verifyBatchJob, args, njobs);
+        for (size_t index = 0; index < njobs; ++index) {
+            if (!jobs[index].result)
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Verifies a group of signatures as a job for CryptoWorker.
+ *
+ * \param arg Points to the BatchJob describing the group.
+ */
+void Ed25519::verifyBatchJob(void *arg)
+{
+    BatchJob *job = (BatchJob *)arg;
+    job->result = verifyBatch(job->signatures, job->publicKeys,
+                              job->messages, job->lens, job->count);
+}
+
 /**
  * \brief Generates a private key for Ed25519 signing operations.
  *
@@ -251,7 +982,7 @@ void Ed25519::generatePrivateKey(uint8_t privateKey[32])
  * \param publicKey The public key.
  * \param privateKey The private key.
  *
- * \sa generatePrivateKey()
+ * \sa generatePrivateKey(), derivePublicKeys()
  */
 void Ed25519::derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32])
 {
@@ -272,6 +1003,79 @@ void Ed25519::derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32
     clean(ptA);
 }
 
+/**
+ * \brief Derives the public keys for an array of private keys.
+ *
+ * \param publicKeys The public keys, which must be 32 * \a count bytes
+ * in size.  Key i is written to bytes 32 * i to 32 * i + 31.
+ * \param privateKeys The private keys, which must be 32 * \a count bytes
+ * in size and laid out in the same way as \a publicKeys.
+ * \param count The number of keys to derive.
+ *
+ * The results are the same as calling derivePublicKey() for each key,
+ * but the keys are encoded in groups of \c CRYPTO_ED25519_DERIVE_BATCH
+ * that share a single field inversion.  This is useful when provisioning
+ * many keys at once, or when generating tables of public keys.
+ *
+ * \sa derivePublicKey()
+ */
+void Ed25519::derivePublicKeys(uint8_t *publicKeys, const uint8_t *privateKeys,
+                               size_t count)
+{
+    SHA512 hash;
+    limb_t a[NUM_LIMBS_256BIT];
+    Point points[CRYPTO_ED25519_DERIVE_BATCH];
+
+    while (count > 0) {
+        size_t n = count;
+        if (n > CRYPTO_ED25519_DERIVE_BATCH)
+            n = CRYPTO_ED25519_DERIVE_BATCH;
+
+        // Compute the points A = aB for each private key in the group.
+        for (size_t i = 0; i < n; ++i) {
+            deriveKeys(&hash, a, privateKeys + i * 32);
+            mul(points[i], a);
+        }
+
+        // Encode all of the points with a single inversion.
+        encodePoints(publicKeys, points, n);
+        publicKeys += n * 32;
+        privateKeys += n * 32;
+        count -= n;
+    }
+
+    // Clean up and exit.
+    clean(a);
+    clean(points);
+}
+
+/**
+ * \brief Adds the RFC 8032 dom2() prefix to a hash for Ed25519ph.
+ *
+ * \param hash The hash object to update.
+ * \param prehash Set to true to add the prefix; false for plain Ed25519,
+ * which has no prefix.
+ * \param context Points to the context string.
+ * \param contextLen The length of the \a context string, which is
+ * truncated to 255 bytes if it is longer.
+ */
+void Ed25519::addDomain(SHA512 *hash, bool prehash, const void *context,
+                        size_t contextLen)
+{
+    static char const dom2Prefix[] PROGMEM =
+        "SigEd25519 no Ed25519 collisions";
+    uint8_t buf[34];
+    if (!prehash)
+        return;
+    if (contextLen > 255)
+        contextLen = 255;
+    memcpy_P(buf, dom2Prefix, 32);
+    buf[32] = 1;
+    buf[33] = (uint8_t)contextLen;
+    hash->update(buf, sizeof(buf));
+    hash->update(context, contextLen);
+}
+
 /**
  * \brief Reduces a number modulo q that was specified in a 512 bit buffer.
  *
@@ -317,8 +1121,8 @@ void Ed25519::reduceQ(limb_t *result, limb_t *r)
     // precision in m, r is at most two subtractions of q away from the
     // final result.
     static limb_t const numM[NUM_LIMBS_256BIT + 1] PROGMEM = {
-        LIMB(0x0A2C131B), LIMB(0xED9CE5A3), LIMB(0x086329A7), LIMB(0x2106215D),
-        LIMB(0xFFFFFFEB), LIMB(0xFFFFFFFF), LIMB(0xFFFFFFFF), LIMB(0xFFFFFFFF),
+        LIMB_PAIR(0x0A2C131B, 0xED9CE5A3), LIMB_PAIR(0x086329A7, 0x2106215D),
+        LIMB_PAIR(0xFFFFFFEB, 0xFFFFFFFF), LIMB_PAIR(0xFFFFFFFF, 0xFFFFFFFF),
         0x0F
     };
     limb_t temp[NUM_LIMBS_512BIT + NUM_LIMBS_256BIT + 1];
@@ -454,17 +1258,111 @@ void Ed25519::mul(Point &result, const limb_t *s, Point &p, bool constTime)
  */
 void Ed25519::mul(Point &result, const limb_t *s, bool constTime)
 {
-    Point P;
-    memcpy_P(P.x, numBx, sizeof(P.x));
-    memcpy_P(P.y, numBy, sizeof(P.y));
-    memcpy_P(P.z, numBz, sizeof(P.z));
-    memcpy_P(P.t, numBt, sizeof(P.t));
-    mul(result, s, P, constTime);
-    clean(P);
-}
-
-/**
- * \brief Adds two curve points.
+#if CRYPTO_ED25519_COMB
+    // The bits of s are split into 4 rows of 64 bits and then processed a
+    // column at a time from the most significant end.  Each column selects
+    // one of the 16 comb table entries to add after doubling the result.
+    // This needs 64 doublings and 64 additions instead of the 255 of each
+    // for the generic double-and-add ladder in mul(result, s, p).
+    limb_t entry[3][NUM_LIMBS_256BIT];
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+    limb_t C[NUM_LIMBS_256BIT];
+    limb_t D[NUM_LIMBS_256BIT];
+    uint8_t column, posn, index, j;
+
+    // Initialize the result to (0, 1, 1, 0).
+    memset(&result, 0, sizeof(Point));
+    result.y[0] = 1;
+    result.z[0] = 1;
+
+    for (column = 64; column > 0; ) {
+        --column;
+
+        // Double the result.
+        Curve25519::sub(A, result.y, result.x);
+        Curve25519::square(A, A);
+        Curve25519::add(B, result.y, result.x);
+        Curve25519::square(B, B);
+        Curve25519::square(C, result.t);
+        Curve25519::mul_P(C, C, numDx2);
+        Curve25519::square(D, result.z);
+        Curve25519::add(D, D, D);
+        Curve25519::sub(result.t, B, A);        // E = B - A
+        Curve25519::sub(result.z, D, C);        // F = D - C
+        Curve25519::add(D, D, C);               // G = D + C
+        Curve25519::add(B, B, A);               // H = B + A
+        Curve25519::mul(result.x, result.t, result.z);  // E * F
+        Curve25519::mul(result.y, D, B);                // G * H
+        Curve25519::mul(result.z, result.z, D);         // F * G
+        Curve25519::mul(result.t, result.t, B);         // E * H
+
+        // Extract the bits of this column to form the table index.
+        // Only the bottom 255 bits of s are used, the same as the
+        // generic ladder in mul(result, s, p).
+        index = 0;
+        for (j = 0; j < 4; ++j) {
+            posn = column + j * 64;
+            if (posn == 255)
+                continue;
+            index |= ((s[posn / LIMB_BITS] >> (posn % LIMB_BITS)) & 1) << j;
+        }
+
+        // Fetch the table entry.  In constant-time mode every entry is
+        // read and the one we want is selected with cmove() to avoid
+        // leaking the index through memory access patterns.
+        if (constTime) {
+            memset(entry, 0, sizeof(entry));
+            for (j = 0; j < 16; ++j) {
+                limb_t select =
+                    (limb_t)(((uint16_t)(((uint16_t)(index ^ j)) - 1)) >> 8);
+                memcpy_P(A, numBComb[j][0], sizeof(A));
+                Curve25519::cmove(select, entry[0], A);
+                memcpy_P(A, numBComb[j][1], sizeof(A));
+                Curve25519::cmove(select, entry[1], A);
+                memcpy_P(A, numBComb[j][2], sizeof(A));
+                Curve25519::cmove(select, entry[2], A);
+            }
+        } else {
+            memcpy_P(entry, numBComb[index], sizeof(entry));
+        }
+
+        // Add the table entry to the result.
+        Curve25519::sub(A, result.y, result.x);
+        Curve25519::mul(A, A, entry[1]);
+        Curve25519::add(B, result.y, result.x);
+        Curve25519::mul(B, B, entry[0]);
+        Curve25519::mul(C, result.t, entry[2]);
+        Curve25519::add(D, result.z, result.z);
+        Curve25519::sub(result.t, B, A);        // E = B - A
+        Curve25519::sub(result.z, D, C);        // F = D - C
+        Curve25519::add(D, D, C);               // G = D + C
+        Curve25519::add(B, B, A);               // H = B + A
+        Curve25519::mul(result.x, result.t, result.z);  // E * F
+        Curve25519::mul(result.y, D, B);                // G * H
+        Curve25519::mul(result.z, result.z, D);         // F * G
+        Curve25519::mul(result.t, result.t, B);         // E * H
+    }
+
+    // Clean up.
+    clean(entry);
+    clean(A);
+    clean(B);
+    clean(C);
+    clean(D);
+#else
+    Point P;
+    memcpy_P(P.x, numBx, sizeof(P.x));
+    memcpy_P(P.y, numBy, sizeof(P.y));
+    memcpy_P(P.z, numBz, sizeof(P.z));
+    memcpy_P(P.t, numBt, sizeof(P.t));
+    mul(result, s, P, constTime);
+    clean(P);
+#endif
+}
+
+/**
+ * \brief Adds two curve points.
  *
  * \param p The first point and the result.
  * \param q The second point.
@@ -501,6 +1399,395 @@ void Ed25519::add(Point &p, const Point &q)
     clean(D);
 }
 
+#if CRYPTO_ED25519_STRAUSS
+
+/**
+ * \brief Converts a scalar into signed sliding window digits.
+ *
+ * \param r The 256 digits that result, from lowest to highest.  Every
+ * non-zero digit is odd.
+ * \param s The scalar value, which must be NUM_LIMBS_256BIT limbs in size.
+ * Only the bottom 255 bits are used.
+ * \param limit The largest digit magnitude to produce; 15, 7, or 3.
+ *
+ * Algorithm from the "ref10" implementation of Ed25519 in SUPERCOP.
+ */
+static void slide(int8_t *r, const limb_t *s, int limit)
+{
+    int i, b, k;
+
+    for (i = 0; i < 255; ++i)
+        r[i] = (s[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1;
+    r[255] = 0;
+
+    for (i = 0; i < 256; ++i) {
+        if (!r[i])
+            continue;
+        for (b = 1; b <= 6 && (i + b) < 256; ++b) {
+            if (!r[i + b])
+                continue;
+            if ((r[i] + (r[i + b] << b)) <= limit) {
+                r[i] += r[i + b] << b;
+                r[i + b] = 0;
+            } else if ((r[i] - (r[i + b] << b)) >= -limit) {
+                r[i] -= r[i + b] << b;
+                for (k = i + b; k < 256; ++k) {
+                    if (!r[k]) {
+                        r[k] = 1;
+                        break;
+                    }
+                    r[k] = 0;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Computes s * B - k * p for the base point B.
+ *
+ * \param result The result of the computation.
+ * \param s The first scalar, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param k The second scalar, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param p The point to multiply by \a k.
+ *
+ * Both scalars are converted into sliding window form and processed
+ * together from the highest digit down so that the two multiplications
+ * share a single set of doublings.  This is not constant-time and must
+ * only be used with public values such as in verify().
+ */
+void Ed25519::doubleMul(Point &result, const limb_t *s, const limb_t *k,
+                        const Point &p)
+{
+    CachedPoint table[8];
+    oddMultiples(table, p, 8);
+    doubleMul(result, s, k, table, 15);
+    clean(table);
+}
+
+/**
+ * \brief Computes s * B - k * p using a table of multiples of p.
+ *
+ * \param result The result of the computation.
+ * \param s The first scalar, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param k The second scalar, which must be NUM_LIMBS_256BIT limbs in size.
+ * \param table The odd multiples p, 3p, 5p, ..., limit * p in cached form.
+ * \param limit The largest multiple of p in \a table; 15 or 31.
+ */
+void Ed25519::doubleMul(Point &result, const limb_t *s, const limb_t *k,
+                        const CachedPoint *table, int limit)
+{
+    CachedPoint cached;
+    int8_t sdigits[256];
+    int8_t kdigits[256];
+    int i;
+
+    // Convert the scalars into sliding window form and find the
+    // highest non-zero digit.
+    slide(sdigits, s, 15);
+    slide(kdigits, k, limit);
+    for (i = 255; i >= 0; --i) {
+        if (sdigits[i] || kdigits[i])
+            break;
+    }
+
+    // Initialize the result to (0, 1, 1, 0).
+    memset(&result, 0, sizeof(Point));
+    result.y[0] = 1;
+    result.z[0] = 1;
+
+    // Double and add the multiples for both scalars.
+    for (; i >= 0; --i) {
+        dbl(result);
+        if (sdigits[i] > 0) {
+            memcpy_P(&cached, numBOdd[sdigits[i] / 2], sizeof(cached));
+            addCached(result, cached, false);
+        } else if (sdigits[i] < 0) {
+            memcpy_P(&cached, numBOdd[(-sdigits[i]) / 2], sizeof(cached));
+            addCached(result, cached, true);
+        }
+        if (kdigits[i] > 0)
+            addCached(result, table[kdigits[i] / 2], true);
+        else if (kdigits[i] < 0)
+            addCached(result, table[(-kdigits[i]) / 2], false);
+    }
+
+    // Clean up.
+    clean(cached);
+}
+
+/**
+ * \brief Builds a table of odd multiples of a point in cached form.
+ *
+ * \param table The table of p, 3p, 5p, ... that results.
+ * \param p The point to multiply.
+ * \param count The number of entries in \a table.
+ */
+void Ed25519::oddMultiples(CachedPoint *table, const Point &p, uint8_t count)
+{
+    CachedPoint cached;
+    Point q;
+    uint8_t i;
+
+    memcpy(&q, &p, sizeof(Point));
+    dbl(q);
+    toCached(cached, q);
+    memcpy(&q, &p, sizeof(Point));
+    toCached(table[0], q);
+    for (i = 1; i < count; ++i) {
+        addCached(q, cached, false);
+        toCached(table[i], q);
+    }
+
+    clean(cached);
+    clean(q);
+}
+
+/**
+ * \brief Doubles a curve point.
+ *
+ * \param p The point to double, which is also the result.
+ */
+void Ed25519::dbl(Point &p)
+{
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+    limb_t C[NUM_LIMBS_256BIT];
+    limb_t D[NUM_LIMBS_256BIT];
+
+    Curve25519::sub(A, p.y, p.x);
+    Curve25519::square(A, A);
+    Curve25519::add(B, p.y, p.x);
+    Curve25519::square(B, B);
+    Curve25519::square(C, p.t);
+    Curve25519::mul_P(C, C, numDx2);
+    Curve25519::square(D, p.z);
+    Curve25519::add(D, D, D);
+    Curve25519::sub(p.t, B, A);             // E = B - A
+    Curve25519::sub(p.z, D, C);             // F = D - C
+    Curve25519::add(D, D, C);               // G = D + C
+    Curve25519::add(B, B, A);               // H = B + A
+    Curve25519::mul(p.x, p.t, p.z);         // p.x = E * F
+    Curve25519::mul(p.y, D, B);             // p.y = G * H
+    Curve25519::mul(p.z, p.z, D);           // p.z = F * G
+    Curve25519::mul(p.t, p.t, B);           // p.t = E * H
+
+    clean(A);
+    clean(B);
+    clean(C);
+    clean(D);
+}
+
+/**
+ * \brief Converts a curve point into cached form for addCached().
+ *
+ * \param result The cached form of the point.
+ * \param p The point to convert.
+ */
+void Ed25519::toCached(CachedPoint &result, const Point &p)
+{
+    Curve25519::add(result.ypx, p.y, p.x);
+    Curve25519::sub(result.ymx, p.y, p.x);
+    memcpy(result.z, p.z, sizeof(result.z));
+    Curve25519::mul_P(result.t2d, p.t, numDx2);
+}
+
+/**
+ * \brief Adds or subtracts a curve point in cached form.
+ *
+ * \param p The first point and the result.
+ * \param q The second point in cached form.
+ * \param negate Set to true to subtract \a q from \a p instead of adding.
+ *
+ * Negating a point swaps Y + X with Y - X and negates T, which is
+ * folded into the choice of which terms to combine.
+ */
+void Ed25519::addCached(Point &p, const CachedPoint &q, bool negate)
+{
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+    limb_t C[NUM_LIMBS_256BIT];
+    limb_t D[NUM_LIMBS_256BIT];
+
+    Curve25519::sub(A, p.y, p.x);
+    Curve25519::mul(A, A, negate ? q.ypx : q.ymx);
+    Curve25519::add(B, p.y, p.x);
+    Curve25519::mul(B, B, negate ? q.ymx : q.ypx);
+    Curve25519::mul(C, p.t, q.t2d);
+    Curve25519::mul(D, p.z, q.z);
+    Curve25519::add(D, D, D);
+    Curve25519::sub(p.t, B, A);             // E = B - A
+    if (negate) {
+        Curve25519::add(p.z, D, C);         // F = D + C
+        Curve25519::sub(D, D, C);           // G = D - C
+    } else {
+        Curve25519::sub(p.z, D, C);         // F = D - C
+        Curve25519::add(D, D, C);           // G = D + C
+    }
+    Curve25519::add(B, B, A);               // H = B + A
+    Curve25519::mul(p.x, p.t, p.z);         // p.x = E * F
+    Curve25519::mul(p.y, D, B);             // p.y = G * H
+    Curve25519::mul(p.z, p.z, D);           // p.z = F * G
+    Curve25519::mul(p.t, p.t, B);           // p.t = E * H
+
+    clean(A);
+    clean(B);
+    clean(C);
+    clean(D);
+}
+
+#if CRYPTO_ED25519_BATCH_SIZE > 1
+
+/**
+ * \brief Verifies a group of signatures with a single multi-scalar
+ * multiplication.
+ *
+ * \param signatures Array of pointers to the 64-byte signatures to verify.
+ * \param publicKeys Array of pointers to the 32-byte public keys to use.
+ * \param messages Array of pointers to the messages that were signed.
+ * \param lens Array of message lengths.
+ * \param count Number of signatures, between 2 and CRYPTO_ED25519_BATCH_SIZE.
+ *
+ * \return Returns true if all signatures are valid.
+ *
+ * \sa verifyBatch()
+ */
+bool Ed25519::verifyBatchChunk(const uint8_t *signatures[],
+                               const uint8_t *publicKeys[],
+                               const void *messages[], const size_t lens[],
+                               size_t count)
+{
+    // Tables of P, 3P, 5P, ... for every A and R point.  The scalars
+    // are z * k for the A points and z for the R points.
+    CachedPoint tables[CRYPTO_ED25519_BATCH_SIZE * 2][CRYPTO_ED25519_BATCH_WINDOW];
+    limb_t scalars[CRYPTO_ED25519_BATCH_SIZE * 2][NUM_LIMBS_256BIT];
+    int8_t digits[CRYPTO_ED25519_BATCH_SIZE * 2 + 1][256];
+    limb_t sum[NUM_LIMBS_256BIT];
+    limb_t temp[NUM_LIMBS_512BIT + 1];
+    uint8_t seed[64];
+    uint8_t buf[64];
+    SHA512 hash;
+    CachedPoint cached;
+    Point P;
+    Point Q;
+    size_t i, j;
+    int posn;
+    bool result = false;
+
+    // Decode the points, build the tables of multiples, and compute k for
+    // each signature.
+    for (i = 0; i < count; ++i) {
+        for (j = 0; j < 2; ++j) {
+            CachedPoint *table = tables[i * 2 + j];
+            if (!decodePoint(P, j ? signatures[i] : publicKeys[i]))
+                goto cleanup;
+            toCached(table[0], P);
+            memcpy(&Q, &P, sizeof(Point));
+            dbl(Q);
+            toCached(cached, Q);
+            for (posn = 1; posn < CRYPTO_ED25519_BATCH_WINDOW; ++posn) {
+                addCached(P, cached, false);
+                toCached(table[posn], P);
+            }
+        }
+        hash.reset();
+        hash.update(signatures[i], 32);
+        hash.update(publicKeys[i], 32);
+        hash.update(messages[i], lens[i]);
+        hash.finalize(buf, sizeof(buf));
+        reduceQFromBuffer(scalars[i * 2], buf, temp);
+    }
+
+    // Hash the signatures and k values to get the seed for the random
+    // multipliers.
+    hash.reset();
+    for (i = 0; i < count; ++i) {
+        BigNumberUtil::packLE(buf, 32, scalars[i * 2], NUM_LIMBS_256BIT);
+        hash.update(signatures[i], 64);
+        hash.update(buf, 32);
+    }
+    hash.finalize(seed, sizeof(seed));
+
+    // Derive the multipliers z and compute the scalars z * k for the A
+    // points and the sum of z * s for the base point.
+    memset(sum, 0, sizeof(sum));
+    for (i = 0; i < count; ++i) {
+        buf[0] = (uint8_t)i;
+        buf[1] = (uint8_t)(i >> 8);
+        hash.reset();
+        hash.update(seed, sizeof(seed));
+        hash.update(buf, 2);
+        hash.finalize(buf, sizeof(buf));
+        BigNumberUtil::unpackLE(scalars[i * 2 + 1], NUM_LIMBS_256BIT, buf, 16);
+
+        // z * k mod q.
+        Curve25519::mulNoReduce(temp, scalars[i * 2 + 1], scalars[i * 2]);
+        temp[NUM_LIMBS_512BIT] = 0;
+        reduceQ(scalars[i * 2], temp);
+
+        // sum += z * s mod q.  Only the bottom 255 bits of s are used,
+        // the same as verify().
+        BigNumberUtil::unpackLE(P.x, NUM_LIMBS_256BIT, signatures[i] + 32, 32);
+        P.x[NUM_LIMBS_256BIT - 1] &= ~(((limb_t)1) << (LIMB_BITS - 1));
+        Curve25519::mulNoReduce(temp, scalars[i * 2 + 1], P.x);
+        temp[NUM_LIMBS_512BIT] = 0;
+        reduceQ(P.x, temp);
+        BigNumberUtil::add(sum, sum, P.x, NUM_LIMBS_256BIT);
+        BigNumberUtil::reduceQuick_P(sum, sum, numQ, NUM_LIMBS_256BIT);
+    }
+
+    // Convert the scalars into sliding window form.
+    slide(digits[0], sum, 15);
+    for (i = 0; i < count * 2; ++i)
+        slide(digits[i + 1], scalars[i], CRYPTO_ED25519_BATCH_WINDOW * 2 - 1);
+
+    // Evaluate sum * B - sum(z * k * A) - sum(z * R) with shared doublings.
+    memset(&P, 0, sizeof(Point));
+    P.y[0] = 1;
+    P.z[0] = 1;
+    for (posn = 255; posn >= 0; --posn) {
+        dbl(P);
+        int8_t digit = digits[0][posn];
+        if (digit > 0) {
+            memcpy_P(&cached, numBOdd[digit / 2], sizeof(cached));
+            addCached(P, cached, false);
+        } else if (digit < 0) {
+            memcpy_P(&cached, numBOdd[(-digit) / 2], sizeof(cached));
+            addCached(P, cached, true);
+        }
+        for (i = 0; i < count * 2; ++i) {
+            digit = digits[i + 1][posn];
+            if (digit > 0)
+                addCached(P, tables[i][digit / 2], true);
+            else if (digit < 0)
+                addCached(P, tables[i][(-digit) / 2], false);
+        }
+    }
+
+    // The result should be the identity point (0, 1, 1, 0).
+    memset(&Q, 0, sizeof(Point));
+    Q.y[0] = 1;
+    Q.z[0] = 1;
+    result = equal(P, Q);
+
+cleanup:
+    clean(tables);
+    clean(scalars);
+    clean(digits);
+    clean(temp);
+    clean(buf);
+    clean(cached);
+    clean(P);
+    clean(Q);
+    return result;
+}
+
+#endif // CRYPTO_ED25519_BATCH_SIZE > 1
+
+#endif // CRYPTO_ED25519_STRAUSS
+
 /**
  * \brief Determine if two curve points are equal.
  *
@@ -535,7 +1822,7 @@ bool Ed25519::equal(const Point &p, const Point &q)
  * \param point The curve point to encode.  This value will be modified
  * the function and effectively destroyed.
  *
- * \sa decodePoint()
+ * \sa encodePoints(), decodePoint()
  */
 void Ed25519::encodePoint(uint8_t *buf, Point &point)
 {
@@ -555,6 +1842,64 @@ void Ed25519::encodePoint(uint8_t *buf, Point &point)
     BigNumberUtil::packLE(buf, 32, point.y, NUM_LIMBS_256BIT);
 }
 
+/**
+ * \brief Encodes an array of curve points into 32-byte buffers.
+ *
+ * \param bufs The buffer to encode into, which must be 32 * \a n bytes
+ * in size.  Point i is encoded into bytes 32 * i to 32 * i + 31.
+ * \param points The curve points to encode.  These values will be modified
+ * by the function and effectively destroyed.
+ * \param n The number of points to encode, which must be at least 1.
+ *
+ * Montgomery's simultaneous inversion trick is used to convert all of the
+ * points into plain (x, y) coordinates with a single call to recip() and
+ * 3 * (n - 1) extra multiplications, instead of n calls to recip().
+ *
+ * \sa encodePoint()
+ */
+void Ed25519::encodePoints(uint8_t *bufs, Point *points, size_t n)
+{
+    limb_t inv[NUM_LIMBS_256BIT];
+    limb_t zinv[NUM_LIMBS_256BIT];
+    size_t i;
+
+    // We don't need the t coordinates, so use them to store the running
+    // products of the z coordinates: t[i] = z[0] * z[1] * ... * z[i].
+    memcpy(points[0].t, points[0].z, sizeof(points[0].t));
+    for (i = 1; i < n; ++i)
+        Curve25519::mul(points[i].t, points[i - 1].t, points[i].z);
+
+    // Invert the product of all z coordinates and then work backwards
+    // to peel off the inverse of each z coordinate in turn:
+    //      zinv[i] = inv * t[i - 1]
+    //      inv = inv * z[i]
+    Curve25519::recip(inv, points[n - 1].t);
+    i = n;
+    while (i > 0) {
+        Point &point = points[--i];
+        if (i > 0) {
+            Curve25519::mul(zinv, inv, points[i - 1].t);
+            Curve25519::mul(inv, inv, point.z);
+        } else {
+            memcpy(zinv, inv, sizeof(zinv));
+        }
+
+        // Convert the homogeneous coordinates into plain (x, y) coordinates.
+        Curve25519::mul(point.x, point.x, zinv);
+        Curve25519::mul(point.y, point.y, zinv);
+
+        // Copy the lowest bit of x to the highest bit of y.
+        point.y[NUM_LIMBS_256BIT - 1] |= (point.x[0] << (LIMB_BITS - 1));
+
+        // Convert y into little-endian in the return buffer.
+        BigNumberUtil::packLE(bufs + i * 32, 32, point.y, NUM_LIMBS_256BIT);
+    }
+
+    // Clean up.
+    clean(inv);
+    clean(zinv);
+}
+
 /**
  * \brief Decodes a curve point from a 32-byte buffer.
  *
@@ -641,3 +1986,271 @@ void Ed25519::deriveKeys(SHA512 *hash, limb_t *a, const uint8_t privateKey[32])
     // Unpack the first half of the hash value into "a".
     BigNumberUtil::unpackLE(a, NUM_LIMBS_256BIT, buf, 32);
 }
+
+/**
+ * \class Ed25519::PrivateKey Ed25519.h <Ed25519.h>
+ * \brief Ed25519 private key that has been expanded for repeated signing.
+ *
+ * Every call to the other forms of Ed25519::sign() hashes the 32-byte
+ * private key with SHA512 to derive the secret scalar and the message
+ * prefix.  This class performs that step once in setKey(), along with
+ * deriving the public key, so that each signing operation can skip it:
+ *
+ * \code
+ * Ed25519::PrivateKey key;
+ * key.setKey(privateKey);
+ * Ed25519::sign(signature, key, message, N);
+ * \endcode
+ *
+ * The object holds secret key material, so it should be cleared with
+ * clear() or destroyed when it is no longer required.
+ */
+
+/**
+ * \brief Constructs an empty private key.
+ *
+ * \sa setKey()
+ */
+Ed25519::PrivateKey::PrivateKey()
+{
+    clean(a);
+    clean(prefix);
+    clean(pub);
+}
+
+/**
+ * \brief Destroys this private key after clearing the key material.
+ */
+Ed25519::PrivateKey::~PrivateKey()
+{
+    clean(a);
+    clean(prefix);
+}
+
+/**
+ * \brief Expands a 32-byte private key and derives its public key.
+ *
+ * \param privateKey The 32-byte private key.
+ *
+ * \sa publicKey(), Ed25519::derivePublicKey()
+ */
+void Ed25519::PrivateKey::setKey(const uint8_t privateKey[32])
+{
+    SHA512 hash;
+    uint8_t *buf = (uint8_t *)(hash.state.w);
+    Point ptA;
+
+    // Derive the secret scalar a and the message prefix.
+    deriveKeys(&hash, a, privateKey);
+    memcpy(prefix, buf + 32, 32);
+
+    // Compute the point A = aB and encode it as the public key.
+    mul(ptA, a);
+    encodePoint(pub, ptA);
+    clean(ptA);
+}
+
+/**
+ * \fn const uint8_t *Ed25519::PrivateKey::publicKey() const
+ * \brief Returns a pointer to the 32-byte public key that was derived
+ * from the private key.
+ */
+
+/**
+ * \brief Clears the private key.
+ */
+void Ed25519::PrivateKey::clear()
+{
+    clean(a);
+    clean(prefix);
+    clean(pub);
+}
+
+/**
+ * \class Ed25519::PublicKey Ed25519.h <Ed25519.h>
+ * \brief Ed25519 public key that has been decoded for repeated verification.
+ *
+ * Decoding a 32-byte public key into a curve point needs a modular square
+ * root, which is a significant part of the cost of Ed25519::verify().
+ * This class performs the decoding once in setKey() so that the result
+ * can be passed to Ed25519::verify() many times.
+ *
+ * \sa Ed25519::PrecomputedPublicKey
+ */
+
+/**
+ * \brief Constructs an empty public key.
+ *
+ * \sa setKey()
+ */
+Ed25519::PublicKey::PublicKey()
+    : valid(false)
+#if CRYPTO_ED25519_STRAUSS
+    , table(0)
+#endif
+{
+}
+
+/**
+ * \brief Destroys this public key.
+ */
+Ed25519::PublicKey::~PublicKey()
+{
+    clean(A);
+}
+
+/**
+ * \brief Decodes and sets the public key.
+ *
+ * \param publicKey The 32-byte encoded public key.
+ *
+ * \return Returns true if the key was set; or false if \a publicKey is
+ * not a valid curve point.  Verification with an invalid key always fails.
+ */
+bool Ed25519::PublicKey::setKey(const uint8_t publicKey[32])
+{
+    memcpy(encoded, publicKey, 32);
+    valid = decodePoint(A, publicKey);
+#if CRYPTO_ED25519_STRAUSS
+    table = 0;
+#endif
+    return valid;
+}
+
+/**
+ * \fn bool Ed25519::PublicKey::isValid() const
+ * \brief Returns true if a valid public key has been set with setKey().
+ */
+
+/**
+ * \fn const uint8_t *Ed25519::PublicKey::key() const
+ * \brief Returns a pointer to the 32-byte encoded form of the public key.
+ */
+
+/**
+ * \brief Clears the public key.
+ */
+void Ed25519::PublicKey::clear()
+{
+    clean(A);
+    clean(encoded);
+    valid = false;
+}
+
+/**
+ * \class Ed25519::PrecomputedPublicKey Ed25519.h <Ed25519.h>
+ * \brief Ed25519 public key with a table of precomputed multiples.
+ *
+ * In addition to decoding the key, setKey() computes the odd multiples
+ * A, 3A, ..., 31A of the key A.  Ed25519::verify() then uses a wider
+ * window for the multiplication by A without rebuilding its table on
+ * every call.  The table occupies 2k of RAM on 32-bit platforms.
+ *
+ * The table is only used when CRYPTO_ED25519_STRAUSS is enabled.
+ * Otherwise this class behaves the same as Ed25519::PublicKey.
+ */
+
+/**
+ * \brief Constructs an empty public key.
+ */
+Ed25519::PrecomputedPublicKey::PrecomputedPublicKey()
+{
+}
+
+/**
+ * \brief Destroys this public key.
+ */
+Ed25519::PrecomputedPublicKey::~PrecomputedPublicKey()
+{
+#if CRYPTO_ED25519_STRAUSS
+    clean(window);
+#endif
+}
+
+/**
+ * \brief Decodes and sets the public key, and builds the table of multiples.
+ *
+ * \param publicKey The 32-byte encoded public key.
+ *
+ * \return Returns true if the key was set; or false if \a publicKey is
+ * not a valid curve point.
+ */
+bool Ed25519::PrecomputedPublicKey::setKey(const uint8_t publicKey[32])
+{
+    if (!PublicKey::setKey(publicKey)) {
+        clear();
+        return false;
+    }
+#if CRYPTO_ED25519_STRAUSS
+    oddMultiples(window, A, 16);
+    table = window;
+#endif
+    return true;
+}
+
+/**
+ * \brief Clears the public key and the table of multiples.
+ */
+void Ed25519::PrecomputedPublicKey::clear()
+{
+    PublicKey::clear();
+#if CRYPTO_ED25519_STRAUSS
+    clean(window);
+    table = 0;
+#endif
+}
+
+/**
+ * \class Ed25519::Workspace Ed25519.h <Ed25519.h>
+ * \brief Scratch memory for Ed25519 signing and verification.
+ *
+ * Ed25519::sign() and Ed25519::verify() need a SHA512 object and several
+ * curve points for their intermediate values, which adds up to about
+ * 730 bytes.  Normally these are allocated on the stack for each call.
+ * Applications that are short on stack space can instead allocate a
+ * Workspace once, for example as a global variable, and pass it to the
+ * forms of sign() and verify() that accept one:
+ *
+ * \code
+ * static Ed25519::Workspace workspace;
+ *
+ * Ed25519::sign(signature, privateKey, publicKey, message, len, workspace);
+ * ...
+ * if (Ed25519::verify(signature, publicKey, message, len, workspace)) {
+ *     ...
+ * }
+ * \endcode
+ *
+ * The intermediate values for signing and verification share the same
+ * memory, so a single Workspace costs no more than the larger of the two.
+ * The workspace is cleaned at the end of each operation.  It must not be
+ * used by two operations at the same time, such as from the main loop
+ * and an interrupt handler.
+ *
+ * The curve arithmetic underneath sign() and verify() still uses some
+ * stack of its own, which does not depend upon the message length.
+ */
+
+/**
+ * \brief Constructs a new Ed25519 workspace.
+ */
+Ed25519::Workspace::Workspace()
+{
+}
+
+/**
+ * \brief Destroys this Ed25519 workspace.
+ */
+Ed25519::Workspace::~Workspace()
+{
+    clean(scratch);
+}
+
+/**
+ * \brief Clears all sensitive data from this workspace.
+ */
+void Ed25519::Workspace::clear()
+{
+    hash.clear();
+    clean(scratch);
+}
@@ -26,17 +26,115 @@
 #include "BigNumberUtil.h"
 #include "SHA512.h"
 
+class CryptoWorker;
+
+// Use a precomputed comb table of multiples of the base point to speed
+// up signing and public key derivation.  The table occupies 1536 bytes
+// of program memory.
+#if !defined(CRYPTO_ED25519_COMB)
+#define CRYPTO_ED25519_COMB 1
+#endif
+
+// Use a joint Strauss-Shamir multiplication of [s]B and [k]A in verify().
+// This needs about 2k of stack space so it is disabled on AVR.
+#if !defined(CRYPTO_ED25519_STRAUSS)
+#if defined(__AVR__)
+#define CRYPTO_ED25519_STRAUSS 0
+#else
+#define CRYPTO_ED25519_STRAUSS 1
+#endif
+#endif
+
+// Number of signatures to combine into each multi-scalar multiplication
+// in verifyBatch(), and the number of odd multiples P, 3P, 5P, ... of each
+// point to precompute for it.  verifyBatch() needs about 1250 bytes of
+// stack plus 576 + 256 * WINDOW bytes per signature in the batch:
+// 3.4K on ESP8266 (2 x 2), 5.6K on ESP32 (4 x 2), and 14K elsewhere (8 x 4).
+// Set the batch size to 0 to verify the signatures one at a time instead.
+#if !defined(CRYPTO_ED25519_BATCH_SIZE)
+#if !CRYPTO_ED25519_STRAUSS
+#define CRYPTO_ED25519_BATCH_SIZE 0
+#elif defined(ESP8266)
+#define CRYPTO_ED25519_BATCH_SIZE 2
+#elif defined(ESP32)
+#define CRYPTO_ED25519_BATCH_SIZE 4
+#else
+#define CRYPTO_ED25519_BATCH_SIZE 8
+#endif
+#endif
+#if !defined(CRYPTO_ED25519_BATCH_WINDOW)
+#if defined(ESP8266) || defined(ESP32)
+#define CRYPTO_ED25519_BATCH_WINDOW 2
+#else
+#define CRYPTO_ED25519_BATCH_WINDOW 4
+#endif
+#endif
+
+// Number of public keys that derivePublicKeys() converts into affine
+// coordinates with a single field inversion.  Each key in the group
+// needs 128 bytes of stack space.
+#if !defined(CRYPTO_ED25519_DERIVE_BATCH)
+#if defined(__AVR__)
+#define CRYPTO_ED25519_DERIVE_BATCH 2
+#else
+#define CRYPTO_ED25519_DERIVE_BATCH 8
+#endif
+#endif
+
 class Ed25519
 {
 public:
+    class PrivateKey;
+    class PublicKey;
+    class PrecomputedPublicKey;
+    class Workspace;
+
     static void sign(uint8_t signature[64], const uint8_t privateKey[32],
                      const uint8_t publicKey[32], const void *message,
                      size_t len);
+    static void sign(uint8_t signature[64], const PrivateKey &privateKey,
+                     const void *message, size_t len);
     static bool verify(const uint8_t signature[64], const uint8_t publicKey[32],
                        const void *message, size_t len);
+    static bool verify(const uint8_t signature[64], const PublicKey &publicKey,
+                       const void *message, size_t len);
+
+    static void sign(uint8_t signature[64], const uint8_t privateKey[32],
+                     const uint8_t publicKey[32], const void *message,
+                     size_t len, Workspace &workspace);
+    static void sign(uint8_t signature[64], const PrivateKey &privateKey,
+                     const void *message, size_t len, Workspace &workspace);
+    static bool verify(const uint8_t signature[64], const uint8_t publicKey[32],
+                       const void *message, size_t len, Workspace &workspace);
+    static bool verify(const uint8_t signature[64], const PublicKey &publicKey,
+                       const void *message, size_t len, Workspace &workspace);
+
+    static void signPrehash(uint8_t signature[64], const uint8_t privateKey[32],
+                            const uint8_t publicKey[32], SHA512 &hash,
+                            const void *context = 0, size_t contextLen = 0);
+    static void signPrehash(uint8_t signature[64], const PrivateKey &privateKey,
+                            SHA512 &hash, const void *context = 0,
+                            size_t contextLen = 0);
+    static bool verifyPrehash(const uint8_t signature[64],
+                              const uint8_t publicKey[32], SHA512 &hash,
+                              const void *context = 0, size_t contextLen = 0);
+    static bool verifyPrehash(const uint8_t signature[64],
+                              const PublicKey &publicKey, SHA512 &hash,
+                              const void *context = 0, size_t contextLen = 0);
+
+    static bool verifyBatch(const uint8_t *signatures[],
+                            const uint8_t *publicKeys[],
+                            const void *messages[], const size_t lens[],
+                            size_t count);
+    static bool verifyBatch(const uint8_t *signatures[],
+                            const uint8_t *publicKeys[],
+                            const void *messages[], const size_t lens[],
+                            size_t count, CryptoWorker &worker);
 
     static void generatePrivateKey(uint8_t privateKey[32]);
     static void derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32]);
+    static void derivePublicKeys(uint8_t *publicKeys, const uint8_t *privateKeys,
+                                 size_t count);
 
 private:
     // Constructor and destructor are private - cannot instantiate this class.
@@ -52,6 +150,57 @@ private:
         limb_t t[32 / sizeof(limb_t)];
     };
 
+#if CRYPTO_ED25519_STRAUSS
+    // Curve point in cached form for repeated additions.
+    struct CachedPoint
+    {
+        limb_t ypx[32 / sizeof(limb_t)];    // Y + X
+        limb_t ymx[32 / sizeof(limb_t)];    // Y - X
+        limb_t z[32 / sizeof(limb_t)];      // Z
+        limb_t t2d[32 / sizeof(limb_t)];    // 2 * d * T
+    };
+#endif
+
+    // Temporary values for signing and verification.  Only one of the
+    // two is live at a time so they share the same memory.
+    union Scratch
+    {
+        struct
+        {
+            limb_t a[32 / sizeof(limb_t)];
+            limb_t r[32 / sizeof(limb_t)];
+            limb_t k[32 / sizeof(limb_t)];
+            limb_t t[64 / sizeof(limb_t) + 1];
+            Point rB;
+        } sign;
+        struct
+        {
+            Point A;
+            Point R;
+            Point sB;
+            Point kA;
+        } verify;
+    };
+
+    static void signInternal(uint8_t signature[64], const uint8_t privateKey[32],
+                             const uint8_t publicKey[32], SHA512 &hash,
+                             Scratch &scratch, const void *message, size_t len,
+                             bool prehash, const void *context,
+                             size_t contextLen);
+    static void signExpanded(uint8_t signature[64], const limb_t *a,
+                             const uint8_t *prefix, const uint8_t publicKey[32],
+                             SHA512 &hash, Scratch &scratch,
+                             const void *message, size_t len, bool prehash,
+                             const void *context, size_t contextLen);
+    static bool verifyInternal(const uint8_t signature[64],
+                               const uint8_t publicKey[32],
+                               const PublicKey *key, SHA512 &hash,
+                               Scratch &scratch, const void *message,
+                               size_t len, bool prehash,
+                               const void *context, size_t contextLen);
+    static void addDomain(SHA512 *hash, bool prehash, const void *context,
+                          size_t contextLen);
+
     static void reduceQFromBuffer(limb_t *result, const uint8_t buf[64], limb_t *temp);
     static void reduceQ(limb_t *result, limb_t *r);
 
@@ -62,10 +211,134 @@ private:
 
     static bool equal(const Point &p, const Point &q);
 
+#if CRYPTO_ED25519_STRAUSS
+    static void doubleMul(Point &result, const limb_t *s, const limb_t *k, const Point &p);
+    static void doubleMul(Point &result, const limb_t *s, const limb_t *k,
+                          const CachedPoint *table, int limit);
+    static void oddMultiples(CachedPoint *table, const Point &p, uint8_t count);
+    static void dbl(Point &p);
+    static void toCached(CachedPoint &result, const Point &p);
+    static void addCached(Point &p, const CachedPoint &q, bool negate);
+#endif
+    // Group of signatures to be verified by a CryptoWorker job.
+    struct BatchJob
+    {
+        const uint8_t **signatures;
+        const uint8_t **publicKeys;
+        const void **messages;
+        const size_t *lens;
+        size_t count;
+        bool result;
+    };
+
+    static void verifyBatchJob(void *arg);
+#if CRYPTO_ED25519_STRAUSS && CRYPTO_ED25519_BATCH_SIZE > 1
+    static bool verifyBatchChunk(const uint8_t *signatures[],
+                                 const uint8_t *publicKeys[],
+                                 const void *messages[], const size_t lens[],
+                                 size_t count);
+#endif
+
     static void encodePoint(uint8_t *buf, Point &point);
+    static void encodePoints(uint8_t *bufs, Point *points, size_t n);
     static bool decodePoint(Point &point, const uint8_t *buf);
 
     static void deriveKeys(SHA512 *hash, limb_t *a, const uint8_t privateKey[32]);
+
+    friend class Curve25519;
+
+public:
+    class PrivateKey
+    {
+    public:
+        PrivateKey();
+        ~PrivateKey();
+
+        void setKey(const uint8_t privateKey[32]);
+
+        const uint8_t *publicKey() const { return pub; }
+
+        void clear();
+
+    private:
+        limb_t a[32 / sizeof(limb_t)];
+        uint8_t prefix[32];
+        uint8_t pub[32];
+
+        // Disable copy constructor and operator=().
+        PrivateKey(const PrivateKey &) {}
+        PrivateKey &operator=(const PrivateKey &) { return *this; }
+
+        friend class Ed25519;
+    };
+
+    class PublicKey
+    {
+    public:
+        PublicKey();
+        ~PublicKey();
+
+        bool setKey(const uint8_t publicKey[32]);
+
+        bool isValid() const { return valid; }
+        const uint8_t *key() const { return encoded; }
+
+        void clear();
+
+    private:
+        Point A;
+        uint8_t encoded[32];
+        bool valid;
+#if CRYPTO_ED25519_STRAUSS
+        CachedPoint *table;
+#endif
+
+        // Disable copy constructor and operator=().
+        PublicKey(const PublicKey &) {}
+        PublicKey &operator=(const PublicKey &) { return *this; }
+
+        friend class Ed25519;
+        friend class PrecomputedPublicKey;
+    };
+
+    class PrecomputedPublicKey : public PublicKey
+    {
+    public:
+        PrecomputedPublicKey();
+        ~PrecomputedPublicKey();
+
+        bool setKey(const uint8_t publicKey[32]);
+
+        void clear();
+
+    private:
+#if CRYPTO_ED25519_STRAUSS
+        CachedPoint window[16];
+#endif
+
+        // Disable copy constructor and operator=().
+        PrecomputedPublicKey(const PrecomputedPublicKey &) : PublicKey() {}
+        PrecomputedPublicKey &operator=(const PrecomputedPublicKey &) { return *this; }
+    };
+
+    class Workspace
+    {
+    public:
+        Workspace();
+        ~Workspace();
+
+        void clear();
+
+    private:
+        SHA512 hash;
+        Scratch scratch;
+
+        // Disable copy constructor and operator=().
+        Workspace(const Workspace &) {}
+        Workspace &operator=(const Workspace &) { return *this; }
+
+        friend class Ed25519;
+    };
 };
 
 #endif
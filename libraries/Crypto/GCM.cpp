@@ -65,13 +65,13 @@ size_t GCMCommon::keySize() const
 
 size_t GCMCommon::ivSize() const
 {
-    return 16;
+    // The GCM specification recommends an IV size of 96 bits.
+    return 12;
 }
 
 size_t GCMCommon::tagSize() const
 {
-    // The GCM specification recommends an IV size of 96 bits.
-    return 12;
+    return 16;
 }
 
 bool GCMCommon::setKey(const uint8_t *key, size_t len)
@@ -90,8 +90,9 @@ bool GCMCommon::setKey(const uint8_t *key, size_t len)
 bool GCMCommon::setIV(const uint8_t *iv, size_t len)
 {
     // Note: We assume that setKey() has already been called to
-    // set the hashing key in the "ghash" object and that the
-    // hashing key itself is still stored in "state.nonce".
+    // set the hashing key in the "ghash" object.  Restart the hash
+    // for the new IV so that the key can be reused for many messages.
+    ghash.reset();
 
     // Format the counter block from the IV.
     if (len == 12) {
@@ -109,7 +110,7 @@ bool GCMCommon::setIV(const uint8_t *iv, size_t len)
         ghash.update(sizes, sizeof(sizes));
         clean(sizes);
         ghash.finalize(state.counter, 16);
-        ghash.reset(state.nonce);
+        ghash.reset();
     }
 
     // Reset the GCM object ready to process auth or payload data.
@@ -122,6 +123,7 @@ bool GCMCommon::setIV(const uint8_t *iv, size_t len)
     // This value will be XOR'ed with the final authentication hash
     // value in computeTag().
     blockCipher->encryptBlock(state.nonce, state.counter);
+    return true;
 }
 
 /**
@@ -150,33 +152,19 @@ void GCMCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
         state.dataStarted = true;
     }
 
-    // Encrypt the plaintext using the block cipher in counter mode.
-    uint8_t *out = output;
-    size_t size = len;
-    while (size > 0) {
-        // Create a new keystream block if necessary.
-        if (state.posn >= 16) {
-            increment(state.counter);
-            blockCipher->encryptBlock(state.stream, state.counter);
-            state.posn = 0;
-        }
-
-        // Encrypt as many bytes as we can using the keystream block.
-        uint8_t temp = 16 - state.posn;
-        if (temp > size)
-            temp = size;
-        uint8_t *stream = state.stream + state.posn;
-        state.posn += temp;
-        size -= temp;
-        while (temp > 0) {
-            *out++ = *input++ ^ *stream++;
-            --temp;
-        }
+    // Encrypt the plaintext and then feed the ciphertext into the hash,
+    // one chunk at a time so that the ciphertext is still in the cache.
+    while (len > 0) {
+        size_t size = 64 - (uint8_t)(state.dataSize % 64);
+        if (size > len)
+            size = len;
+        encryptCTR(output, input, size);
+        ghash.update(output, size);
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
     }
-
-    // Feed the ciphertext into the hash.
-    ghash.update(output, len);
-    state.dataSize += len;
 }
 
 void GCMCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
@@ -187,30 +175,18 @@ void GCMCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
         state.dataStarted = true;
     }
 
-    // Feed the ciphertext into the hash before we decrypt it.
-    ghash.update(input, len);
-    state.dataSize += len;
-
-    // Decrypt the plaintext using the block cipher in counter mode.
+    // Feed each chunk of ciphertext into the hash before we decrypt it
+    // using the block cipher in counter mode.
     while (len > 0) {
-        // Create a new keystream block if necessary.
-        if (state.posn >= 16) {
-            increment(state.counter);
-            blockCipher->encryptBlock(state.stream, state.counter);
-            state.posn = 0;
-        }
-
-        // Decrypt as many bytes as we can using the keystream block.
-        uint8_t temp = 16 - state.posn;
-        if (temp > len)
-            temp = len;
-        uint8_t *stream = state.stream + state.posn;
-        state.posn += temp;
-        len -= temp;
-        while (temp > 0) {
-            *output++ = *input++ ^ *stream++;
-            --temp;
-        }
+        size_t size = 64 - (uint8_t)(state.dataSize % 64);
+        if (size > len)
+            size = len;
+        ghash.update(input, size);
+        encryptCTR(output, input, size);
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
     }
 }
 
@@ -261,6 +237,63 @@ void GCMCommon::clear()
     state.posn = 16;
 }
 
+/**
+ * \brief Encrypts or decrypts data using the block cipher in counter mode.
+ *
+ * \param output The output buffer to write to.
+ * \param input The input buffer to read from, which may be the same
+ * as \a output.
+ * \param len The number of bytes to process.
+ */
+void GCMCommon::encryptCTR(uint8_t *output, const uint8_t *input, size_t len)
+{
+    while (len > 0) {
+        // Create a new keystream block if necessary.
+        if (state.posn >= 16) {
+#if CRYPTO_BATCH_BLOCKS > 1
+            if (len >= 32) {
+                // Encrypt all remaining whole blocks in batches,
+                // XOR'ing the keystream straight into the output.
+                uint8_t stream[CRYPTO_BATCH_BLOCKS * 16];
+                do {
+                    size_t nblocks = len / 16;
+                    if (nblocks > CRYPTO_BATCH_BLOCKS)
+                        nblocks = CRYPTO_BATCH_BLOCKS;
+                    for (size_t index = 0; index < nblocks; ++index) {
+                        increment(state.counter);
+                        memcpy(stream + index * 16, state.counter, 16);
+                    }
+                    blockCipher->encryptBlocks(stream, stream, nblocks);
+                    size_t size = nblocks * 16;
+                    for (size_t index = 0; index < size; ++index)
+                        output[index] = input[index] ^ stream[index];
+                    output += size;
+                    input += size;
+                    len -= size;
+                } while (len >= 16);
+                clean(stream);
+                continue;
+            }
+#endif
+            increment(state.counter);
+            blockCipher->encryptBlock(state.stream, state.counter);
+            state.posn = 0;
+        }
+
+        // Process as many bytes as we can using the keystream block.
+        uint8_t temp = 16 - state.posn;
+        if (temp > len)
+            temp = len;
+        uint8_t *stream = state.stream + state.posn;
+        state.posn += temp;
+        len -= temp;
+        while (temp > 0) {
+            *output++ = *input++ ^ *stream++;
+            --temp;
+        }
+    }
+}
+
 /**
  * \fn void GCMCommon::setBlockCipher(BlockCipher *cipher)
  * \brief Sets the block cipher to use for this GCM object.
@@ -65,6 +65,8 @@ private:
         bool dataStarted;
         uint8_t posn;
     } state;
+
+    void encryptCTR(uint8_t *output, const uint8_t *input, size_t len);
 };
 
 template <typename T>
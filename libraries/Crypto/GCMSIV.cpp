@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "GCMSIV.h"
+#include "Crypto.h"
+#include "utility/EndianUtil.h"
+#include <string.h>
+
+/**
+ * \class GCMSIVCommon GCMSIV.h <GCMSIV.h>
+ * \brief Concrete base class to assist with implementing AES-GCM-SIV
+ * for 128-bit block ciphers.
+ *
+ * Reference: <a href="https://tools.ietf.org/html/rfc8452">RFC 8452</a>
+ *
+ * \sa GCMSIV
+ */
+
+/**
+ * \brief Constructs a new cipher in GCM-SIV mode.
+ *
+ * This constructor must be followed by a call to setBlockCipher().
+ */
+GCMSIVCommon::GCMSIVCommon()
+    : blockCipher(0)
+{
+    state.keyLen = 0;
+    state.authSize = 0;
+    state.dataSize = 0;
+    state.dataStarted = false;
+    state.failed = true;
+}
+
+/**
+ * \brief Destroys this cipher object after clearing sensitive information.
+ */
+GCMSIVCommon::~GCMSIVCommon()
+{
+    clean(state);
+}
+
+size_t GCMSIVCommon::keySize() const
+{
+    return blockCipher->keySize();
+}
+
+size_t GCMSIVCommon::ivSize() const
+{
+    return 12;
+}
+
+size_t GCMSIVCommon::tagSize() const
+{
+    return 16;
+}
+
+bool GCMSIVCommon::setKey(const uint8_t *key, size_t len)
+{
+    // RFC 8452 only defines GCM-SIV for 128-bit and 256-bit keys.
+    if (blockCipher->blockSize() != 16 || len != blockCipher->keySize() ||
+            (len != 16 && len != 32))
+        return false;
+
+    // Save the key-generating key.  The block cipher is keyed with the
+    // per-nonce message encryption key by setIV().
+    memcpy(state.key, key, len);
+    state.keyLen = (uint8_t)len;
+    state.failed = true;
+    return true;
+}
+
+bool GCMSIVCommon::setIV(const uint8_t *iv, size_t len)
+{
+    if (len != 12 || !state.keyLen)
+        return false;
+    memcpy(state.nonce, iv, 12);
+
+    // Derive the message authentication and encryption keys by
+    // encrypting "counter || nonce" and keeping the first 8 bytes of each.
+    uint8_t block[16];
+    uint8_t keys[48];
+    uint8_t count = (state.keyLen == 16) ? 4 : 6;
+    blockCipher->setKey(state.key, state.keyLen);
+    memcpy(block + 4, iv, 12);
+    for (uint8_t index = 0; index < count; ++index) {
+        block[0] = index;
+        block[1] = 0;
+        block[2] = 0;
+        block[3] = 0;
+        blockCipher->encryptBlock(block, block);
+        memcpy(keys + index * 8, block, 8);
+        memcpy(block + 4, iv, 12);
+    }
+    polyval.reset(keys);
+    blockCipher->setKey(keys + 16, state.keyLen);
+    clean(block);
+    clean(keys);
+
+    // Reset the object ready to process auth or payload data.
+    state.authSize = 0;
+    state.dataSize = 0;
+    state.dataStarted = false;
+    state.failed = false;
+    return true;
+}
+
+/**
+ * \brief Encrypts the entire plaintext in a single call.
+ *
+ * \param output The output buffer to write the ciphertext to, which
+ * may be the same as \a input.
+ * \param input The plaintext to be encrypted.
+ * \param len The number of bytes of plaintext.
+ *
+ * GCM-SIV derives the counter for the encryption from a hash of the
+ * whole plaintext, so unlike other ciphers this function can only be
+ * called once after setIV().  All associated data must be added before
+ * it is called.  If the function is called a second time, the output
+ * is cleared and the object must be reset with setIV().
+ *
+ * \sa computeTag()
+ */
+void GCMSIVCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
+{
+    if (state.dataStarted || state.failed) {
+        clean(output, len);
+        state.failed = true;
+        return;
+    }
+
+    // Authenticate the plaintext and compute the tag, then encrypt.
+    polyval.pad();
+    polyval.update(input, len);
+    state.dataSize = len;
+    finishTag();
+    encryptCTR(output, input, len);
+}
+
+/**
+ * \brief Decryption is not supported through this function.
+ *
+ * \param output The output buffer, which is cleared.
+ * \param input The ciphertext, which is ignored.
+ * \param len The number of bytes of ciphertext.
+ *
+ * GCM-SIV needs the tag before decryption can begin, so use open()
+ * to decrypt and verify a packet instead.  After a call to this
+ * function, checkTag() will always fail.
+ *
+ * \sa open()
+ */
+void GCMSIVCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
+{
+    (void)input;
+    clean(output, len);
+    state.failed = true;
+}
+
+void GCMSIVCommon::addAuthData(const void *data, size_t len)
+{
+    if (!state.dataStarted) {
+        polyval.update(data, len);
+        state.authSize += len;
+    }
+}
+
+void GCMSIVCommon::computeTag(void *tag, size_t len)
+{
+    // If there was no call to encrypt(), then the plaintext is empty.
+    if (!state.dataStarted) {
+        finishTag();
+    }
+    if (len > 16)
+        len = 16;
+    memcpy(tag, state.tag, len);
+}
+
+bool GCMSIVCommon::checkTag(const void *tag, size_t len)
+{
+    // Can never match if the expected tag length is too long.
+    if (len > 16 || state.failed)
+        return false;
+    if (!state.dataStarted) {
+        finishTag();
+    }
+    return secure_compare(state.tag, tag, len);
+}
+
+/**
+ * \brief Decrypts and verifies a complete packet in one call.
+ *
+ * \param output The output buffer for the plaintext, which may be the
+ * same as \a input.  Must be at least \a len bytes in size.
+ * \param tag The 16-byte authentication tag to check.
+ * \param key The key to use, which must be keySize() bytes in size.
+ * \param nonce The nonce to use.
+ * \param nonceLen The length of the nonce, which must be 12.
+ * \param ad Extra data to be authenticated but not decrypted.
+ * \param adLen The number of bytes of extra data in \a ad.
+ * \param input The ciphertext to be decrypted.
+ * \param len The number of bytes of ciphertext to decrypt.
+ * \return Returns true if the tag is valid; false if the tag is invalid
+ * or the key or nonce length is not supported.
+ *
+ * The ciphertext is decrypted with the counter derived from \a tag
+ * and then the plaintext is authenticated.  If the tag is invalid,
+ * then the \a output buffer will be cleared.
+ */
+bool GCMSIVCommon::open(uint8_t *output, const uint8_t *tag,
+                        const uint8_t *key,
+                        const uint8_t *nonce, size_t nonceLen,
+                        const void *ad, size_t adLen,
+                        const uint8_t *input, size_t len)
+{
+    if (!setKey(key, keySize()) || !setIV(nonce, nonceLen))
+        return false;
+    addAuthData(ad, adLen);
+
+    // Decrypt with the received tag as the initial counter block.
+    memcpy(state.tag, tag, 16);
+    encryptCTR(output, input, len);
+
+    // Authenticate the plaintext and check the tag we computed.
+    uint8_t expected[16];
+    polyval.pad();
+    polyval.update(output, len);
+    state.dataSize = len;
+    memcpy(expected, tag, 16);
+    finishTag();
+    bool ok = secure_compare(state.tag, expected, 16);
+    clean(expected);
+    state.failed = true;
+    if (!ok) {
+        clean(output, len);
+        return false;
+    }
+    return true;
+}
+
+void GCMSIVCommon::clear()
+{
+    blockCipher->clear();
+    polyval.clear();
+    clean(state);
+    state.failed = true;
+}
+
+/**
+ * \brief Finishes the POLYVAL hash and encrypts it to produce the tag.
+ *
+ * The associated data and plaintext must already have been added to
+ * the hash.
+ */
+void GCMSIVCommon::finishTag()
+{
+    polyval.pad();
+    uint64_t sizes[2] = {
+        htole64(state.authSize * 8),
+        htole64(state.dataSize * 8)
+    };
+    polyval.update(sizes, sizeof(sizes));
+    clean(sizes);
+    polyval.finalize(state.tag, 16);
+    for (uint8_t posn = 0; posn < 12; ++posn)
+        state.tag[posn] ^= state.nonce[posn];
+    state.tag[15] &= 0x7F;
+    blockCipher->encryptBlock(state.tag, state.tag);
+    state.dataStarted = true;
+}
+
+/**
+ * \brief Encrypts or decrypts data using the block cipher in counter mode.
+ *
+ * \param output The output buffer to write to.
+ * \param input The input buffer to read from, which may be the same
+ * as \a output.
+ * \param len The number of bytes to process.
+ *
+ * The initial counter block is the tag with the top bit set.  The first
+ * 32 bits of the counter block are incremented as a little endian value.
+ */
+void GCMSIVCommon::encryptCTR(uint8_t *output, const uint8_t *input, size_t len)
+{
+    uint8_t stream[CRYPTO_BATCH_BLOCKS * 16];
+    uint8_t counter[16];
+    memcpy(counter, state.tag, 16);
+    counter[15] |= 0x80;
+    uint32_t count = ((uint32_t)counter[0]) |
+                     (((uint32_t)counter[1]) << 8) |
+                     (((uint32_t)counter[2]) << 16) |
+                     (((uint32_t)counter[3]) << 24);
+    while (len > 0) {
+        size_t nblocks = (len + 15) / 16;
+        if (nblocks > CRYPTO_BATCH_BLOCKS)
+            nblocks = CRYPTO_BATCH_BLOCKS;
+        for (size_t index = 0; index < nblocks; ++index) {
+            uint8_t *block = stream + index * 16;
+            block[0] = (uint8_t)count;
+            block[1] = (uint8_t)(count >> 8);
+            block[2] = (uint8_t)(count >> 16);
+            block[3] = (uint8_t)(count >> 24);
+            memcpy(block + 4, counter + 4, 12);
+            ++count;
+        }
+        blockCipher->encryptBlocks(stream, stream, nblocks);
+        size_t size = nblocks * 16;
+        if (size > len)
+            size = len;
+        for (size_t index = 0; index < size; ++index)
+            output[index] = input[index] ^ stream[index];
+        output += size;
+        input += size;
+        len -= size;
+    }
+    clean(stream);
+    clean(counter);
+}
+
+/**
+ * \fn void GCMSIVCommon::setBlockCipher(BlockCipher *cipher)
+ * \brief Sets the block cipher to use for this GCM-SIV object.
+ *
+ * \param cipher The block cipher to use to implement GCM-SIV mode.
+ * This object must have a block size of 128 bits (16 bytes) and a
+ * key size of 128 or 256 bits.
+ */
+
+/**
+ * \class GCMSIV GCMSIV.h <GCMSIV.h>
+ * \brief Implementation of AES-GCM-SIV, the nonce misuse-resistant
+ * version of the Galois Counter Mode.
+ *
+ * GCM-SIV converts a block cipher into an authenticated cipher in the
+ * same way as GCM, but the counter for the encryption is derived from
+ * a POLYVAL hash of the associated data and plaintext.  Accidentally
+ * reusing a nonce with the same key only reveals whether two messages
+ * were identical, rather than the catastrophic loss of security with GCM.
+ * A fresh pair of message keys is derived from the key and nonce for
+ * every message.
+ *
+ * The template parameter T must be a concrete subclass of BlockCipher with
+ * a 128-bit block size and a 128-bit or 256-bit key: AES128, AES256,
+ * AESSmall128, or AESSmall256.  The nonce is 96 bits (12 bytes) and the
+ * tag is 128 bits (16 bytes).  The multi-block path of the block cipher
+ * is used for the encryption, and the hashing reuses GHASH.
+ *
+ * Because the whole plaintext must be hashed before any of it can be
+ * encrypted, the usual incremental interface is restricted: encrypt() may
+ * only be called once per nonce, and decryption must be done with open().
+ * The simplest usage is via seal() and open():
+ *
+ * \code
+ * GCMSIV<AES256> siv;
+ * siv.seal(ciphertext, tag, key, nonce, 12, adata, sizeof(adata),
+ *          plaintext, sizeof(plaintext));
+ * ...
+ * if (!siv.open(plaintext, tag, key, nonce, 12, adata, sizeof(adata),
+ *               ciphertext, sizeof(ciphertext))) {
+ *     // The data was invalid - do not use it.
+ *     ...
+ * }
+ * \endcode
+ *
+ * Reference: <a href="https://tools.ietf.org/html/rfc8452">RFC 8452</a>
+ *
+ * \sa GCMSIVCommon, GCM, POLYVAL
+ */
+
+/**
+ * \fn GCMSIV::GCMSIV()
+ * \brief Constructs a new GCM-SIV object for the block cipher T.
+ */
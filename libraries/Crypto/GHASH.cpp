@@ -22,6 +22,7 @@
 
 #include "GHASH.h"
 #include "Crypto.h"
+#include "utility/ConstantTimeUtil.h"
 #include "utility/EndianUtil.h"
 #include <string.h>
 
@@ -35,6 +36,14 @@
  * hashing primitive that is used by both GCM and GMAC.  GMAC can be
  * simulated using GCM and an empty plaintext/ciphertext.
  *
+ * On platforms other than AVR, reset() expands the authentication key
+ * into a table of the multiples H * x^0 to H * x^7 and processes the
+ * input a byte at a time.  The table is accessed with masks rather than
+ * data-dependent indexes so the implementation remains resistant to
+ * cache timing attacks.  The table adds 112 bytes to the state size.
+ * Define CRYPTO_GHASH_TABLE to 0 to use the smaller bit by bit
+ * implementation on all platforms.
+ *
  * References: <a href="http://csrc.nist.gov/publications/nistpubs/800-38D/SP-800-38D.pdf">NIST SP 800-38D</a>,
  * http://en.wikipedia.org/wiki/Galois/Counter_Mode
  *
@@ -66,6 +75,35 @@ GHASH::~GHASH()
  */
 void GHASH::reset(const void *key)
 {
+#if CRYPTO_GHASH_TABLE
+    // Copy the key into H[0] and convert from big endian to host order.
+    uint32_t V0, V1, V2, V3, mask;
+    memcpy(state.H[0], key, 16);
+#if defined(CRYPTO_LITTLE_ENDIAN)
+    state.H[0][0] = V0 = be32toh(state.H[0][0]);
+    state.H[0][1] = V1 = be32toh(state.H[0][1]);
+    state.H[0][2] = V2 = be32toh(state.H[0][2]);
+    state.H[0][3] = V3 = be32toh(state.H[0][3]);
+#else
+    V0 = state.H[0][0];
+    V1 = state.H[0][1];
+    V2 = state.H[0][2];
+    V3 = state.H[0][3];
+#endif
+
+    // Precompute H * x^i for i = 1..7 by repeatedly rotating right by 1 bit.
+    for (uint8_t i = 1; i < 8; ++i) {
+        mask = ctMask(V3 & 0x01) & 0xE1000000;
+        V3 = (V3 >> 1) | (V2 << 31);
+        V2 = (V2 >> 1) | (V1 << 31);
+        V1 = (V1 >> 1) | (V0 << 31);
+        V0 = (V0 >> 1) ^ mask;
+        state.H[i][0] = V0;
+        state.H[i][1] = V1;
+        state.H[i][2] = V2;
+        state.H[i][3] = V3;
+    }
+#else
     // Copy the key into H and convert from big endian to host order.
     memcpy(state.H, key, 16);
 #if defined(CRYPTO_LITTLE_ENDIAN)
@@ -73,9 +111,24 @@ void GHASH::reset(const void *key)
     state.H[1] = be32toh(state.H[1]);
     state.H[2] = be32toh(state.H[2]);
     state.H[3] = be32toh(state.H[3]);
+#endif
 #endif
 
     // Reset the hash.
+    reset();
+}
+
+/**
+ * \brief Resets the GHASH message authenticator for a new message
+ * with the same authentication key as before.
+ *
+ * This is cheaper than reset(const void *) because the key does not
+ * need to be expanded again.
+ *
+ * \sa update(), finalize()
+ */
+void GHASH::reset()
+{
     memset(state.Y, 0, sizeof(state.Y));
     state.posn = 0;
 }
@@ -161,6 +214,52 @@ void GHASH::clear()
     clean(state);
 }
 
+#if CRYPTO_GHASH_TABLE
+
+void GHASH::processChunk()
+{
+    uint32_t Z0 = 0;            // Z = 0
+    uint32_t Z1 = 0;
+    uint32_t Z2 = 0;
+    uint32_t Z3 = 0;
+    uint32_t mask, r;
+
+    // Evaluate the product using Horner's rule over the bytes of Y,
+    // starting at the end: Z = Z * x^8 + Y[posn] * H.  Y[posn] * H is
+    // the sum of H * x^i for the set bits, which we get from the table
+    // using masks so that there are no data-dependent memory accesses.
+    for (uint8_t posn = 16; posn > 0; ) {
+        --posn;
+
+        // Multiply Z by x^8.  The 8 bits that are shifted out are
+        // reduced by XOR'ing shifted copies of 0xE1000000 >> 7 back in.
+        r = Z3 & 0xFF;
+        Z3 = (Z3 >> 8) | (Z2 << 24);
+        Z2 = (Z2 >> 8) | (Z1 << 24);
+        Z1 = (Z1 >> 8) | (Z0 << 24);
+        Z0 = (Z0 >> 8) ^ (r << 17) ^ (r << 22) ^ (r << 23) ^ (r << 24);
+
+        // Add the multiples of H for the set bits, starting at the top.
+        uint8_t value = ((const uint8_t *)state.Y)[posn];
+        const uint32_t *V = state.H[0];
+        for (uint8_t bit = 0; bit < 8; ++bit, value <<= 1, V += 4) {
+            mask = ctMask((uint32_t)(value >> 7));
+            Z0 ^= (V[0] & mask);
+            Z1 ^= (V[1] & mask);
+            Z2 ^= (V[2] & mask);
+            Z3 ^= (V[3] & mask);
+        }
+    }
+
+    // We have finished the block so copy Z into Y and byte-swap.
+    state.Y[0] = htobe32(Z0);
+    state.Y[1] = htobe32(Z1);
+    state.Y[2] = htobe32(Z2);
+    state.Y[3] = htobe32(Z3);
+}
+
+#else // !CRYPTO_GHASH_TABLE
+
 void GHASH::processChunk()
 {
     uint32_t Z0 = 0;            // Z = 0
@@ -179,7 +278,7 @@ void GHASH::processChunk()
         uint8_t value = ((const uint8_t *)state.Y)[posn];
         for (uint8_t bit = 0; bit < 8; ++bit, value <<= 1) {
             // Extract the high bit of "value" and turn it into a mask.
-            uint32_t mask = (~((uint32_t)(value >> 7))) + 1;
+            uint32_t mask = ctMask((uint32_t)(value >> 7));
 
             // XOR V with Z if the bit is 1.
             Z0 ^= (V0 & mask);
@@ -188,7 +287,7 @@ void GHASH::processChunk()
             Z3 ^= (V3 & mask);
 
             // Rotate V right by 1 bit.
-            mask = ((~(V3 & 0x01)) + 1) & 0xE1000000;
+            mask = ctMask(V3 & 0x01) & 0xE1000000;
             V3 = (V3 >> 1) | (V2 << 31);
             V2 = (V2 >> 1) | (V1 << 31);
             V1 = (V1 >> 1) | (V0 << 31);
@@ -202,3 +301,5 @@ void GHASH::processChunk()
     state.Y[2] = htobe32(Z2);
     state.Y[3] = htobe32(Z3);
 }
+
+#endif // !CRYPTO_GHASH_TABLE
@@ -25,6 +25,18 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include "CryptoConfig.h"
+
+// Use the table of precomputed multiples of H on platforms that have
+// the RAM to spare.  AVR keeps the original bit by bit implementation
+// unless the speed profile is selected.
+#if !defined(CRYPTO_GHASH_TABLE)
+#if defined(__AVR__) && !CRYPTO_OPTIMIZE_SPEED
+#define CRYPTO_GHASH_TABLE 0
+#else
+#define CRYPTO_GHASH_TABLE 1
+#endif
+#endif
 
 class GHASH
 {
@@ -33,6 +45,7 @@ public:
     ~GHASH();
 
     void reset(const void *key);
+    void reset();
     void update(const void *data, size_t len);
     void finalize(void *token, size_t len);
 
@@ -42,7 +55,11 @@ public:
 
 private:
     struct {
+#if CRYPTO_GHASH_TABLE
+        uint32_t H[8][4];
+#else
         uint32_t H[4];
+#endif
         uint32_t Y[4];
         uint8_t posn;
     } state;
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "HKDF.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class HKDFCommon HKDF.h <HKDF.h>
+ * \brief Common base class for HKDF key derivation objects.
+ *
+ * HKDF, from <a href="https://tools.ietf.org/html/rfc5869">RFC 5869</a>,
+ * derives keying material in two steps.  setKey() performs the Extract
+ * step, turning the input key and an optional salt into a pseudorandom
+ * key (PRK).  expand() then generates as much output as required from
+ * the PRK and an optional "info" string that binds the output to its
+ * purpose:
+ *
+ * \code
+ * HKDF<SHA256> hkdf;
+ * hkdf.setKey(sharedSecret, sizeof(sharedSecret), salt, sizeof(salt));
+ * hkdf.expand(txKey, sizeof(txKey), "client key", 10);
+ * hkdf.reset();
+ * hkdf.expand(rxKey, sizeof(rxKey), "server key", 10);
+ * \endcode
+ *
+ * The PRK is kept as a keyed HMAC object, so the padded key blocks are
+ * hashed only once in setKey() rather than once for every block of
+ * output.  Successive calls to expand() continue the same output stream,
+ * so the output can be consumed in pieces of any size.  Call reset() to
+ * start a new output stream from the same PRK, usually with a different
+ * "info" string.
+ *
+ * For one-off derivations, the hkdf() function performs both steps.
+ *
+ * \sa HKDF, HMAC
+ */
+
+/**
+ * \class HKDF HKDF.h <HKDF.h>
+ * \brief HKDF key derivation based on the hash algorithm \a T.
+ *
+ * \sa HKDFCommon
+ */
+
+/**
+ * \fn void hkdf(void *out, size_t outLen, const void *key, size_t keyLen, const void *salt, size_t saltLen, const void *info, size_t infoLen)
+ * \brief All-in-one HKDF key derivation using the hash algorithm \a T.
+ *
+ * \param out Points to the buffer to receive the output.
+ * \param outLen The number of bytes of output required, up to 255 times
+ * the hash size of \a T.
+ * \param key Points to the input keying material.
+ * \param keyLen The length of the input keying material in bytes.
+ * \param salt Points to the salt, or NULL if there is no salt.
+ * \param saltLen The length of the salt in bytes.
+ * \param info Points to the "info" string, or NULL if there is none.
+ * \param infoLen The length of the "info" string in bytes.
+ *
+ * \sa HKDFCommon
+ */
+
+/**
+ * \brief Constructs a new HKDF object.
+ *
+ * The subclass must call setHMAC() to supply the HMAC object.
+ */
+HKDFCommon::HKDFCommon()
+    : hmac(0)
+    , counter(0)
+    , posn(0)
+{
+}
+
+/**
+ * \brief Destroys this HKDF object after clearing sensitive information.
+ */
+HKDFCommon::~HKDFCommon()
+{
+    clean(block);
+}
+
+/**
+ * \brief Size of the output blocks from the underlying hash algorithm,
+ * in bytes.
+ */
+size_t HKDFCommon::hashSize() const
+{
+    return hmac->hashSize();
+}
+
+/**
+ * \brief Sets the input keying material and salt (HKDF-Extract).
+ *
+ * \param key Points to the input keying material.
+ * \param keyLen The length of the input keying material in bytes.
+ * \param salt Points to the salt, or NULL if there is no salt.
+ * \param saltLen The length of the salt in bytes.
+ *
+ * This function also resets the output stream, as with reset().
+ *
+ * \sa expand(), clear()
+ */
+void HKDFCommon::setKey(const void *key, size_t keyLen,
+                        const void *salt, size_t saltLen)
+{
+    // An empty salt is the same as a string of zeroes of the hash size,
+    // because HMAC pads short keys with zeroes anyway.
+    size_t size = hmac->hashSize();
+    hmac->setKey(salt, saltLen);
+    hmac->update(key, keyLen);
+    hmac->finalize(block, size);
+
+    // Key the HMAC object with the PRK for the Expand step.
+    hmac->setKey(block, size);
+    clean(block);
+    reset();
+}
+
+/**
+ * \brief Restarts the output stream from the start of HKDF-Expand.
+ *
+ * The next call to expand() will return the first bytes of output for
+ * the pseudorandom key that was set by setKey().
+ *
+ * \sa expand(), setKey()
+ */
+void HKDFCommon::reset()
+{
+    counter = 0;
+    posn = (uint8_t)(hmac->hashSize());
+}
+
+/**
+ * \brief Generates more output from the pseudorandom key (HKDF-Expand).
+ *
+ * \param out Points to the buffer to receive the output.
+ * \param len The number of bytes of output to generate.
+ * \param info Points to the "info" string, or NULL if there is none.
+ * \param infoLen The length of the "info" string in bytes.
+ *
+ * \return Returns false if the output would go past the limit of
+ * 255 times hashSize() bytes since the last reset(), in which case
+ * nothing is written to \a out.
+ *
+ * The output continues on from the previous call, so the bytes are the
+ * same as if they had been requested in a single call.  The \a info
+ * string must therefore be the same for every call until the next reset().
+ *
+ * \sa reset(), setKey()
+ */
+bool HKDFCommon::expand(void *out, size_t len, const void *info, size_t infoLen)
+{
+    size_t size = hmac->hashSize();
+    size_t avail = (255 - counter) * size + (size - posn);
+    uint8_t *d = (uint8_t *)out;
+    if (len > avail)
+        return false;
+    while (len > 0) {
+        if (posn >= size) {
+            // T(N) = HMAC(PRK, T(N - 1) | info | N), with T(0) empty.
+            hmac->reset();
+            if (counter)
+                hmac->update(block, size);
+            hmac->update(info, infoLen);
+            ++counter;
+            hmac->update(&counter, 1);
+            hmac->finalize(block, size);
+            posn = 0;
+        }
+        size_t temp = size - posn;
+        if (temp > len)
+            temp = len;
+        memcpy(d, block + posn, temp);
+        posn += temp;
+        d += temp;
+        len -= temp;
+    }
+    return true;
+}
+
+/**
+ * \brief Clears the pseudorandom key and all other sensitive information
+ * from this object.
+ */
+void HKDFCommon::clear()
+{
+    hmac->clear();
+    clean(block);
+    reset();
+}
+
+/**
+ * \fn void HKDFCommon::setHMAC(HMACCommon *hmac)
+ * \brief Sets the HMAC object to use for this HKDF.
+ *
+ * \param hmac The HMAC object, keyed with the pseudorandom key after
+ * setKey() is called.
+ */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "HMAC.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class HMACCommon HMAC.h <HMAC.h>
+ * \brief Common base class for HMAC objects with a cached key.
+ *
+ * Hash::resetHMAC() and Hash::finalizeHMAC() format the key and hash
+ * the padded key block every time a MAC is computed, which costs two
+ * extra compression function calls per message.  For a fixed key, the
+ * HMAC class hashes the inner and outer key blocks once in setKey() and
+ * then restores the saved states at the start of each message:
+ *
+ * \code
+ * HMAC<SHA256> hmac;
+ * hmac.setKey(key, sizeof(key));
+ * for (...) {
+ *     hmac.reset();
+ *     hmac.update(packet, packetLen);
+ *     hmac.finalize(mac, sizeof(mac));
+ * }
+ * \endcode
+ *
+ * The result is identical to computing the MAC with resetHMAC() and
+ * finalizeHMAC() on the underlying hash algorithm.  The HMAC object holds
+ * three copies of the hash state, so it uses three times the memory of
+ * the hash object itself.
+ *
+ * \sa Hash::resetHMAC()
+ */
+
+/**
+ * \class HMAC HMAC.h <HMAC.h>
+ * \brief HMAC with a cached key for the hash algorithm \a T.
+ *
+ * \sa HMACCommon
+ */
+
+// Largest block size of any of the hash algorithms (SHA3_256).
+#define HMAC_MAX_BLOCK_SIZE 136
+
+// Largest hash size of any of the hash algorithms.
+#define HMAC_MAX_HASH_SIZE 64
+
+/**
+ * \brief Constructs a new HMAC object.
+ *
+ * The subclass must call setHashes() to supply the hash objects.
+ */
+HMACCommon::HMACCommon()
+    : work(0)
+    , inner(0)
+    , outer(0)
+{
+}
+
+/**
+ * \brief Destroys this HMAC object after clearing sensitive information.
+ */
+HMACCommon::~HMACCommon()
+{
+}
+
+/**
+ * \brief Size of the MAC that is computed by this object, in bytes.
+ */
+size_t HMACCommon::hashSize() const
+{
+    return work->hashSize();
+}
+
+/**
+ * \brief Sets the key to use for computing MAC's.
+ *
+ * \param key Points to the key.
+ * \param len The length of the key in bytes, which may be any size.
+ *
+ * This function hashes the inner and outer padded key blocks and saves
+ * the resulting states for use by reset() and finalize().  It then calls
+ * reset() to start a new MAC computation.
+ *
+ * \sa reset(), clear()
+ */
+void HMACCommon::setKey(const void *key, size_t len)
+{
+    uint8_t block[HMAC_MAX_BLOCK_SIZE];
+    size_t size = work->blockSize();
+
+    // Pad the key to a full block, hashing it first if it is too long.
+    if (len > size) {
+        work->reset();
+        work->update(key, len);
+        len = work->hashSize();
+        work->finalize(block, len);
+    } else {
+        memcpy(block, key, len);
+    }
+    memset(block + len, 0, size - len);
+
+    // Hash the inner key block.  The outer key block is hashed the same
+    // way by folding the difference between the two pads into the key.
+    inner->resetHMAC(block, size);
+    for (len = 0; len < size; ++len)
+        block[len] ^= (0x36 ^ 0x5C);
+    outer->resetHMAC(block, size);
+    clean(block);
+    reset();
+}
+
+/**
+ * \brief Resets this object to start a new MAC computation with the
+ * key that was supplied to setKey().
+ *
+ * \sa update(), finalize()
+ */
+void HMACCommon::reset()
+{
+    restore(false);
+}
+
+/**
+ * \brief Updates the MAC with more data.
+ *
+ * \param data Data to be hashed.
+ * \param len Number of bytes of data to be hashed.
+ *
+ * \sa reset(), finalize()
+ */
+void HMACCommon::update(const void *data, size_t len)
+{
+    work->update(data, len);
+}
+
+/**
+ * \brief Finalizes the MAC computation and returns the MAC.
+ *
+ * \param mac The buffer to return the MAC value in.
+ * \param len The length of the \a mac buffer, normally hashSize().
+ *
+ * If \a len is less than hashSize(), then the MAC will be truncated to
+ * the first \a len bytes.  Call reset() to compute another MAC with the
+ * same key.
+ *
+ * \sa reset(), update()
+ */
+void HMACCommon::finalize(void *mac, size_t len)
+{
+    uint8_t temp[HMAC_MAX_HASH_SIZE];
+    size_t size = work->hashSize();
+    work->finalize(temp, size);
+    restore(true);
+    work->update(temp, size);
+    work->finalize(mac, len);
+    clean(temp);
+}
+
+/**
+ * \brief Clears the key and all other sensitive information from
+ * this object.
+ */
+void HMACCommon::clear()
+{
+    work->clear();
+    inner->clear();
+    outer->clear();
+}
+
+/**
+ * \fn void HMACCommon::setHashes(Hash *work, Hash *inner, Hash *outer)
+ * \brief Sets the hash objects to use for this HMAC.
+ *
+ * \param work The working hash object for the current message.
+ * \param inner The hash object that holds the saved inner state.
+ * \param outer The hash object that holds the saved outer state.
+ */
+
+/**
+ * \fn void HMACCommon::restore(bool outerState)
+ * \brief Copies a saved hash state into the working hash object.
+ *
+ * \param outerState Set to true to restore the outer state, or false
+ * to restore the inner state.
+ */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_HMAC_h
+#define CRYPTO_HMAC_h
+
+#include "Hash.h"
+
+class HMACCommon
+{
+public:
+    virtual ~HMACCommon();
+
+    size_t hashSize() const;
+
+    void setKey(const void *key, size_t len);
+
+    void reset();
+    void update(const void *data, size_t len);
+    void finalize(void *mac, size_t len);
+
+    void clear();
+
+protected:
+    HMACCommon();
+    void setHashes(Hash *work, Hash *inner, Hash *outer)
+    {
+        this->work = work;
+        this->inner = inner;
+        this->outer = outer;
+    }
+
+    virtual void restore(bool outerState) = 0;
+
+private:
+    Hash *work;
+    Hash *inner;
+    Hash *outer;
+};
+
+template <typename T>
+class HMAC : public HMACCommon
+{
+public:
+    HMAC() { setHashes(&w, &i, &o); }
+
+protected:
+    void restore(bool outerState) { w = outerState ? o : i; }
+
+private:
+    T w;
+    T i;
+    T o;
+};
+
+#endif
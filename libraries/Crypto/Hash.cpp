@@ -108,6 +108,24 @@ Hash::~Hash()
  * \sa reset()
  */
 
+/**
+ * \fn void Hash::copyState(const Hash &other)
+ * \brief Copies the in-progress state of another hash object into
+ * this one.
+ *
+ * \param other The hash object to copy, which must be an instance of
+ * the same class as this object.
+ *
+ * After the copy, both objects can continue to be updated and finalized
+ * independently.  This is useful when many messages share a common
+ * prefix, such as forking a protocol transcript hash, because the
+ * prefix only needs to be hashed once.
+ *
+ * The behaviour is undefined if \a other is a different hash algorithm.
+ *
+ * \sa reset()
+ */
+
 /**
  * \fn void Hash::resetHMAC(const void *key, size_t keyLen)
  * \brief Resets the hash ready for a new HMAC hashing process.
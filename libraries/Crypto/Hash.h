@@ -41,6 +41,8 @@ public:
 
     virtual void clear() = 0;
 
+    virtual void copyState(const Hash &other) = 0;
+
     virtual void resetHMAC(const void *key, size_t keyLen) = 0;
     virtual void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen) = 0;
 
@@ -22,11 +22,18 @@
 
 #include "KeccakCore.h"
 #include "Crypto.h"
+#include "CryptoConfig.h"
 #include "utility/EndianUtil.h"
 #include "utility/RotateUtil.h"
 #include "utility/ProgMemUtil.h"
+#include "utility/CpuFeatureUtil.h"
 #include <string.h>
 
+#if CRYPTO_KECCAK_AVX512 && CRYPTO_X86_AVX512
+#include <immintrin.h>
+#define KECCAKP_AVX512 1
+#endif
+
 /**
  * \class KeccakCore KeccakCore.h <KeccakCore.h>
  * \brief Keccak core sponge function.
@@ -34,6 +41,13 @@
  * KeccakCore provides the core sponge function for different capacities.
  * It is used to implement Hash algorithms such as SHA3.
  *
+ * On x86 processors with AVX-512, the permutation keeps each row of the
+ * state in a vector register.  The support is detected at runtime.
+ * Define CRYPTO_KECCAK_AVX512 to 0 to always use the portable
+ * implementation that is selected by KECCAKP_IMPL.  The implementation
+ * can also be changed at runtime with setImplementation(), so that tests
+ * and benchmarks can compare them in a single run.
+ *
  * References: http://en.wikipedia.org/wiki/SHA-3
  *
  * \sa SHA3
@@ -282,21 +296,525 @@ void KeccakCore::setHMACKey(const void *key, size_t len, uint8_t pad, size_t has
     update(state.B, size);
 }
 
+// Round constants for the iota step mapping.
+static uint64_t const RC[24] PROGMEM = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL,
+    0x8000000080008000ULL, 0x000000000000808BULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008AULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800AULL, 0x800000008000000AULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+// Implementation that was selected with KeccakCore::setImplementation().
+#if defined(KECCAKP_AVX512)
+static uint8_t selected = KeccakCore::Vector;
+#else
+static uint8_t selected = KeccakCore::Portable;
+#endif
+
+#if defined(KECCAKP_AVX512)
+
+// Builds a vector of lane indices or rotation counts for the five lanes
+// in a row.  The upper three elements of each vector are unused.
+#define KECCAKP_IDX(a, b, c, d, e) _mm512_setr_epi64(a, b, c, d, e, 0, 0, 0)
+
+// Selects row Y of the pi step from the quad "q", which holds lanes 0-3
+// of the row starting at element "o", and lane "l" of "r4" as lane 4.
+// PI1 and PI2 select the same row rotated by one and two lanes for chi.
+#define KECCAKP_PI(o, l) KECCAKP_IDX(o, o + 1, o + 2, o + 3, 8 + (l))
+#define KECCAKP_PI1(o, l) KECCAKP_IDX(o + 1, o + 2, o + 3, 8 + (l), o)
+#define KECCAKP_PI2(o, l) KECCAKP_IDX(o + 2, o + 3, 8 + (l), o, o + 1)
+
+// Performs the pi and chi steps for one row of the new state.
+#define KECCAKP_CHI_AVX512(q, o, l) \
+    _mm512_ternarylogic_epi64( \
+        _mm512_permutex2var_epi64((q), KECCAKP_PI(o, l), r4), \
+        _mm512_permutex2var_epi64((q), KECCAKP_PI1(o, l), r4), \
+        _mm512_permutex2var_epi64((q), KECCAKP_PI2(o, l), r4), 0xD2)
+
+/**
+ * \brief Transform the state with the KECCAK-p sponge function with b = 1600
+ * using AVX-512 instructions.
+ *
+ * \param A The state to transform.
+ *
+ * Each row of the state is held in the low five elements of a ZMM register.
+ * Theta and chi use three-input logic operations, rho uses the variable
+ * rotate instruction, and the lanes are moved around for pi with
+ * two-register permutations.  Lane j of row Y after pi comes from row j
+ * of the input, so the rows are merged in pairs and then in quads before
+ * the final permutations also generate the rotated rows that chi needs.
+ */
+__attribute__((target("avx512f")))
+static void keccakpAVX512(uint64_t A[5][5])
+{
+    const __mmask8 mask = 0x1F;
+    __m512i r0 = _mm512_maskz_loadu_epi64(mask, A[0]);
+    __m512i r1 = _mm512_maskz_loadu_epi64(mask, A[1]);
+    __m512i r2 = _mm512_maskz_loadu_epi64(mask, A[2]);
+    __m512i r3 = _mm512_maskz_loadu_epi64(mask, A[3]);
+    __m512i r4 = _mm512_maskz_loadu_epi64(mask, A[4]);
+    __m512i c, d, p01, p23, q01, q23, q4;
+    for (uint8_t round = 0; round < 24; ++round) {
+        // Step mapping theta.  D[x] = C[x - 1] ^ (C[x + 1] <<< 1).
+        c = _mm512_ternarylogic_epi64(r0, r1, r2, 0x96);
+        c = _mm512_ternarylogic_epi64(c, r3, r4, 0x96);
+        d = _mm512_maskz_permutexvar_epi64(mask, KECCAKP_IDX(1, 2, 3, 4, 0), c);
+        d = _mm512_xor_si512
+            (_mm512_maskz_permutexvar_epi64(mask, KECCAKP_IDX(4, 0, 1, 2, 3), c),
+             _mm512_maskz_rol_epi64(mask, d, 1));
+
+        // Step mapping rho.
+        r0 = _mm512_maskz_rolv_epi64
+            (mask, _mm512_xor_si512(r0, d), KECCAKP_IDX(0, 1, 62, 28, 27));
+        r1 = _mm512_maskz_rolv_epi64
+            (mask, _mm512_xor_si512(r1, d), KECCAKP_IDX(36, 44, 6, 55, 20));
+        r2 = _mm512_maskz_rolv_epi64
+            (mask, _mm512_xor_si512(r2, d), KECCAKP_IDX(3, 10, 43, 25, 39));
+        r3 = _mm512_maskz_rolv_epi64
+            (mask, _mm512_xor_si512(r3, d), KECCAKP_IDX(41, 45, 15, 21, 8));
+        r4 = _mm512_maskz_rolv_epi64
+            (mask, _mm512_xor_si512(r4, d), KECCAKP_IDX(18, 2, 61, 56, 14));
+
+        // Step mapping pi.  Row Y, lane j of the output is row j, lane
+        // (j + 3 * Y) % 5 of the input.  Gather lanes 0 and 1 of output
+        // rows 0-3 from rows 0 and 1, and lanes 2 and 3 from rows 2 and 3.
+        p01 = _mm512_permutex2var_epi64
+            (r0, _mm512_setr_epi64(0, 9, 3, 12, 1, 10, 4, 8), r1);
+        p23 = _mm512_permutex2var_epi64
+            (r2, _mm512_setr_epi64(2, 11, 0, 9, 3, 12, 1, 10), r3);
+        q01 = _mm512_permutex2var_epi64
+            (p01, _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), p23);
+        q23 = _mm512_permutex2var_epi64
+            (p01, _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15), p23);
+
+        // Then lanes 0-3 of output row 4.
+        p01 = _mm512_permutex2var_epi64(r0, KECCAKP_IDX(2, 11, 0, 0, 0), r1);
+        p23 = _mm512_permutex2var_epi64(r2, KECCAKP_IDX(4, 8, 0, 0, 0), r3);
+        q4 = _mm512_permutex2var_epi64
+            (p01, _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), p23);
+
+        // Step mapping chi, with lane 4 of each row inserted from row 4.
+        r0 = KECCAKP_CHI_AVX512(q01, 0, 4);
+        r1 = KECCAKP_CHI_AVX512(q01, 4, 2);
+        r2 = KECCAKP_CHI_AVX512(q23, 0, 0);
+        r3 = KECCAKP_CHI_AVX512(q23, 4, 3);
+        r4 = KECCAKP_CHI_AVX512(q4, 0, 1);
+
+        // Step mapping iota.
+        r0 = _mm512_xor_si512
+            (r0, _mm512_maskz_set1_epi64(1, pgm_read_qword(RC + round)));
+    }
+    _mm512_mask_storeu_epi64(A[0], mask, r0);
+    _mm512_mask_storeu_epi64(A[1], mask, r1);
+    _mm512_mask_storeu_epi64(A[2], mask, r2);
+    _mm512_mask_storeu_epi64(A[3], mask, r3);
+    _mm512_mask_storeu_epi64(A[4], mask, r4);
+}
+
+#endif // KECCAKP_AVX512
+
+#if KECCAKP_IMPL == 1
+
+// Fully unrolled 64-bit round.  The lanes are named after their row
+// (b, g, k, m, s) and column (a, e, i, o, u) as in the Keccak team's
+// reference code.  The "lane complementing" transform keeps the lanes
+// Abe, Abi, Ago, Aki, Ami, and Asa inverted between rounds, which
+// replaces most of the NOT operations in chi with OR operations.
+#define KECCAKP_ROUND(A, E, rc) \
+    do { \
+        Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+        Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+        Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+        Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+        Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+        Da = Cu ^ leftRotate1_64(Ce); \
+        De = Ca ^ leftRotate1_64(Ci); \
+        Di = Ce ^ leftRotate1_64(Co); \
+        Do = Ci ^ leftRotate1_64(Cu); \
+        Du = Co ^ leftRotate1_64(Ca); \
+        Ba = A##ba ^ Da; \
+        Be = leftRotate_64(A##ge ^ De, 44); \
+        Bi = leftRotate_64(A##ki ^ Di, 43); \
+        Bo = leftRotate_64(A##mo ^ Do, 21); \
+        Bu = leftRotate_64(A##su ^ Du, 14); \
+        E##ba = Ba ^ (Be | Bi) ^ (rc); \
+        E##be = Be ^ ((~Bi) | Bo); \
+        E##bi = Bi ^ (Bo & Bu); \
+        E##bo = Bo ^ (Bu | Ba); \
+        E##bu = Bu ^ (Ba & Be); \
+        Ba = leftRotate_64(A##bo ^ Do, 28); \
+        Be = leftRotate_64(A##gu ^ Du, 20); \
+        Bi = leftRotate_64(A##ka ^ Da, 3); \
+        Bo = leftRotate_64(A##me ^ De, 45); \
+        Bu = leftRotate_64(A##si ^ Di, 61); \
+        E##ga = Ba ^ (Be | Bi); \
+        E##ge = Be ^ (Bi & Bo); \
+        E##gi = Bi ^ (Bo | (~Bu)); \
+        E##go = Bo ^ (Bu | Ba); \
+        E##gu = Bu ^ (Ba & Be); \
+        Ba = leftRotate_64(A##be ^ De, 1); \
+        Be = leftRotate_64(A##gi ^ Di, 6); \
+        Bi = leftRotate_64(A##ko ^ Do, 25); \
+        Bo = leftRotate_64(A##mu ^ Du, 8); \
+        Bu = leftRotate_64(A##sa ^ Da, 18); \
+        E##ka = Ba ^ (Be | Bi); \
+        E##ke = Be ^ (Bi & Bo); \
+        E##ki = Bi ^ ((~Bo) & Bu); \
+        E##ko = (~Bo) ^ (Bu | Ba); \
+        E##ku = Bu ^ (Ba & Be); \
+        Ba = leftRotate_64(A##bu ^ Du, 27); \
+        Be = leftRotate_64(A##ga ^ Da, 36); \
+        Bi = leftRotate_64(A##ke ^ De, 10); \
+        Bo = leftRotate_64(A##mi ^ Di, 15); \
+        Bu = leftRotate_64(A##so ^ Do, 56); \
+        E##ma = Ba ^ (Be & Bi); \
+        E##me = Be ^ (Bi | Bo); \
+        E##mi = Bi ^ ((~Bo) | Bu); \
+        E##mo = (~Bo) ^ (Bu & Ba); \
+        E##mu = Bu ^ (Ba | Be); \
+        Ba = leftRotate_64(A##bi ^ Di, 62); \
+        Be = leftRotate_64(A##go ^ Do, 55); \
+        Bi = leftRotate_64(A##ku ^ Du, 39); \
+        Bo = leftRotate_64(A##ma ^ Da, 41); \
+        Bu = leftRotate_64(A##se ^ De, 2); \
+        E##sa = Ba ^ ((~Be) & Bi); \
+        E##se = (~Be) ^ (Bi | Bo); \
+        E##si = Bi ^ (Bo & Bu); \
+        E##so = Bo ^ (Bu | Ba); \
+        E##su = Bu ^ (Ba & Be); \
+    } while (0)
+
+/**
+ * \brief Transform the state with the KECCAK-p sponge function with b = 1600.
+ *
+ * This version unrolls each round and keeps the state in local variables,
+ * which suits 64-bit processors with many registers.
+ */
+void KeccakCore::keccakp()
+{
+    uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki;
+    uint64_t Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+    uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki;
+    uint64_t Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+    uint64_t Ba, Be, Bi, Bo, Bu;
+    uint64_t Ca, Ce, Ci, Co, Cu;
+    uint64_t Da, De, Di, Do, Du;
+
+#if defined(KECCAKP_AVX512)
+    if (selected == Vector && cpuHasAvx512f()) {
+        keccakpAVX512(state.A);
+        return;
+    }
+#endif
+
+    // Load the state and apply the lane complementing transform.
+    Aba = state.A[0][0];
+    Abe = ~state.A[0][1];
+    Abi = ~state.A[0][2];
+    Abo = state.A[0][3];
+    Abu = state.A[0][4];
+    Aga = state.A[1][0];
+    Age = state.A[1][1];
+    Agi = state.A[1][2];
+    Ago = ~state.A[1][3];
+    Agu = state.A[1][4];
+    Aka = state.A[2][0];
+    Ake = state.A[2][1];
+    Aki = ~state.A[2][2];
+    Ako = state.A[2][3];
+    Aku = state.A[2][4];
+    Ama = state.A[3][0];
+    Ame = state.A[3][1];
+    Ami = ~state.A[3][2];
+    Amo = state.A[3][3];
+    Amu = state.A[3][4];
+    Asa = ~state.A[4][0];
+    Ase = state.A[4][1];
+    Asi = state.A[4][2];
+    Aso = state.A[4][3];
+    Asu = state.A[4][4];
+
+    // Perform the 24 rounds two at a time, swapping between A and E.
+    for (uint8_t round = 0; round < 24; round += 2) {
+        KECCAKP_ROUND(A, E, pgm_read_qword(RC + round));
+        KECCAKP_ROUND(E, A, pgm_read_qword(RC + round + 1));
+    }
+
+    // Undo the lane complementing transform and store the state.
+    state.A[0][0] = Aba;
+    state.A[0][1] = ~Abe;
+    state.A[0][2] = ~Abi;
+    state.A[0][3] = Abo;
+    state.A[0][4] = Abu;
+    state.A[1][0] = Aga;
+    state.A[1][1] = Age;
+    state.A[1][2] = Agi;
+    state.A[1][3] = ~Ago;
+    state.A[1][4] = Agu;
+    state.A[2][0] = Aka;
+    state.A[2][1] = Ake;
+    state.A[2][2] = ~Aki;
+    state.A[2][3] = Ako;
+    state.A[2][4] = Aku;
+    state.A[3][0] = Ama;
+    state.A[3][1] = Ame;
+    state.A[3][2] = ~Ami;
+    state.A[3][3] = Amo;
+    state.A[3][4] = Amu;
+    state.A[4][0] = ~Asa;
+    state.A[4][1] = Ase;
+    state.A[4][2] = Asi;
+    state.A[4][3] = Aso;
+    state.A[4][4] = Asu;
+}
+
+#elif KECCAKP_IMPL == 2
+
+// Round constants for the iota step mapping in bit-interleaved form,
+// with the even bits of each constant followed by the odd bits.
+static uint32_t const RCinterleaved[48] PROGMEM = {
+    0x00000001, 0x00000000, 0x00000000, 0x00000089,
+    0x00000000, 0x8000008B, 0x00000000, 0x80008080,
+    0x00000001, 0x0000008B, 0x00000001, 0x00008000,
+    0x00000001, 0x80008088, 0x00000001, 0x80000082,
+    0x00000000, 0x0000000B, 0x00000000, 0x0000000A,
+    0x00000001, 0x00008082, 0x00000000, 0x00008003,
+    0x00000001, 0x0000808B, 0x00000001, 0x8000000B,
+    0x00000001, 0x8000008A, 0x00000001, 0x80000081,
+    0x00000000, 0x80000081, 0x00000000, 0x80000008,
+    0x00000000, 0x00000083, 0x00000000, 0x80008003,
+    0x00000001, 0x80008088, 0x00000000, 0x80000088,
+    0x00000001, 0x00008000, 0x00000000, 0x80008082
+};
+
+// Splits a 64-bit lane into its even and odd bits.
+static inline void keccakInterleave(uint32_t &even, uint32_t &odd, uint64_t x)
+{
+    uint32_t lo = (uint32_t)x;
+    uint32_t hi = (uint32_t)(x >> 32);
+    uint32_t t;
+    #define keccakUnshuffle(x) \
+        do { \
+            t = ((x) ^ ((x) >> 1)) & 0x22222222; (x) ^= t ^ (t << 1); \
+            t = ((x) ^ ((x) >> 2)) & 0x0C0C0C0C; (x) ^= t ^ (t << 2); \
+            t = ((x) ^ ((x) >> 4)) & 0x00F000F0; (x) ^= t ^ (t << 4); \
+            t = ((x) ^ ((x) >> 8)) & 0x0000FF00; (x) ^= t ^ (t << 8); \
+        } while (0)
+    keccakUnshuffle(lo);
+    keccakUnshuffle(hi);
+    even = (lo & 0x0000FFFF) | (hi << 16);
+    odd  = (lo >> 16) | (hi & 0xFFFF0000);
+}
+
+// Combines the even and odd bits of a lane back into a 64-bit value.
+static inline uint64_t keccakDeinterleave(uint32_t even, uint32_t odd)
+{
+    uint32_t lo = (even & 0x0000FFFF) | (odd << 16);
+    uint32_t hi = (even >> 16) | (odd & 0xFFFF0000);
+    uint32_t t;
+    #define keccakShuffle(x) \
+        do { \
+            t = ((x) ^ ((x) >> 8)) & 0x0000FF00; (x) ^= t ^ (t << 8); \
+            t = ((x) ^ ((x) >> 4)) & 0x00F000F0; (x) ^= t ^ (t << 4); \
+            t = ((x) ^ ((x) >> 2)) & 0x0C0C0C0C; (x) ^= t ^ (t << 2); \
+            t = ((x) ^ ((x) >> 1)) & 0x22222222; (x) ^= t ^ (t << 1); \
+        } while (0)
+    keccakShuffle(lo);
+    keccakShuffle(hi);
+    return ((uint64_t)lo) | (((uint64_t)hi) << 32);
+}
+
+/**
+ * \brief Transform the state with the KECCAK-p sponge function with b = 1600.
+ *
+ * This version uses the bit-interleaving technique, which splits each
+ * 64-bit lane into two 32-bit words holding the even and odd bits.
+ * Every 64-bit rotation then becomes two 32-bit rotations, which suits
+ * 32-bit processors such as ARM Cortex-M.  Lane a[2 * i] holds the even
+ * bits of lane i and a[2 * i + 1] holds the odd bits.
+ */
+void KeccakCore::keccakp()
+{
+    uint32_t a[50];
+    uint32_t b[50];
+    uint32_t c[10];
+    uint32_t De, Do;
+    uint8_t index, index2;
+
+#if defined(KECCAKP_AVX512)
+    if (selected == Vector && cpuHasAvx512f()) {
+        keccakpAVX512(state.A);
+        return;
+    }
+#endif
+
+    // Convert the state into bit-interleaved form.
+    for (index = 0; index < 25; ++index)
+        keccakInterleave(a[2 * index], a[2 * index + 1], (&(state.A[0][0]))[index]);
+
+    for (uint8_t round = 0; round < 24; ++round) {
+        // Step mapping theta.  A rotation by 1 swaps the even and odd
+        // words and rotates the new even word by 1.
+        for (index = 0; index < 10; ++index)
+            c[index] = a[index] ^ a[index + 10] ^ a[index + 20] ^
+                       a[index + 30] ^ a[index + 40];
+        for (index = 0; index < 5; ++index) {
+            uint8_t prev = 2 * ((index + 4) % 5);
+            uint8_t next = 2 * ((index + 1) % 5);
+            De = c[prev] ^ leftRotate(c[next + 1], 1);
+            Do = c[prev + 1] ^ c[next];
+            for (index2 = 2 * index; index2 < 50; index2 += 10) {
+                a[index2] ^= De;
+                a[index2 + 1] ^= Do;
+            }
+        }
+
+        // Step mapping rho and pi combined into a single step.  An even
+        // rotation by 2n rotates both words by n.  An odd rotation by
+        // 2n + 1 swaps the words and rotates them by n + 1 and n.
+        b[0] = a[0];
+        b[1] = a[1];
+        b[10] = leftRotate(a[6], 14);
+        b[11] = leftRotate(a[7], 14);
+        b[20] = leftRotate(a[3], 1);
+        b[21] = a[2];
+        b[30] = leftRotate(a[9], 14);
+        b[31] = leftRotate(a[8], 13);
+        b[40] = leftRotate(a[4], 31);
+        b[41] = leftRotate(a[5], 31);
+        b[2] = leftRotate(a[12], 22);
+        b[3] = leftRotate(a[13], 22);
+        b[12] = leftRotate(a[18], 10);
+        b[13] = leftRotate(a[19], 10);
+        b[22] = leftRotate(a[14], 3);
+        b[23] = leftRotate(a[15], 3);
+        b[32] = leftRotate(a[10], 18);
+        b[33] = leftRotate(a[11], 18);
+        b[42] = leftRotate(a[17], 28);
+        b[43] = leftRotate(a[16], 27);
+        b[4] = leftRotate(a[25], 22);
+        b[5] = leftRotate(a[24], 21);
+        b[14] = leftRotate(a[21], 2);
+        b[15] = leftRotate(a[20], 1);
+        b[24] = leftRotate(a[27], 13);
+        b[25] = leftRotate(a[26], 12);
+        b[34] = leftRotate(a[22], 5);
+        b[35] = leftRotate(a[23], 5);
+        b[44] = leftRotate(a[29], 20);
+        b[45] = leftRotate(a[28], 19);
+        b[6] = leftRotate(a[37], 11);
+        b[7] = leftRotate(a[36], 10);
+        b[16] = leftRotate(a[33], 23);
+        b[17] = leftRotate(a[32], 22);
+        b[26] = leftRotate(a[38], 4);
+        b[27] = leftRotate(a[39], 4);
+        b[36] = leftRotate(a[35], 8);
+        b[37] = leftRotate(a[34], 7);
+        b[46] = leftRotate(a[31], 21);
+        b[47] = leftRotate(a[30], 20);
+        b[8] = leftRotate(a[48], 7);
+        b[9] = leftRotate(a[49], 7);
+        b[18] = leftRotate(a[45], 31);
+        b[19] = leftRotate(a[44], 30);
+        b[28] = leftRotate(a[40], 9);
+        b[29] = leftRotate(a[41], 9);
+        b[38] = leftRotate(a[46], 28);
+        b[39] = leftRotate(a[47], 28);
+        b[48] = leftRotate(a[42], 1);
+        b[49] = leftRotate(a[43], 1);
+
+        // Step mapping chi.  Combine each lane with two other lanes in its row.
+        for (index = 0; index < 50; index += 10) {
+            for (index2 = 0; index2 < 10; ++index2) {
+                a[index + index2] =
+                    b[index + index2] ^
+                    ((~b[index + (index2 + 2) % 10]) & b[index + (index2 + 4) % 10]);
+            }
+        }
+
+        // Step mapping iota.  XOR a[0] and a[1] with the round constant.
+        a[0] ^= pgm_read_dword(RCinterleaved + 2 * round);
+        a[1] ^= pgm_read_dword(RCinterleaved + 2 * round + 1);
+    }
+
+    // Convert the state back into the standard form.
+    for (index = 0; index < 25; ++index)
+        (&(state.A[0][0]))[index] = keccakDeinterleave(a[2 * index], a[2 * index + 1]);
+    clean(a);
+    clean(b);
+    clean(c);
+}
+
+#else // KECCAKP_IMPL == 0
+
+#if CRYPTO_KECCAK_UNROLL
+
+// Applies the theta column parity "D" to column x, given the
+// neighbouring columns prev = (x + 4) % 5 and next = (x + 1) % 5.
+#define keccakTheta(x, prev, next) \
+    do { \
+        D = state.B[0][(prev)] ^ leftRotate1_64(state.B[0][(next)]); \
+        state.A[0][(x)] ^= D; \
+        state.A[1][(x)] ^= D; \
+        state.A[2][(x)] ^= D; \
+        state.A[3][(x)] ^= D; \
+        state.A[4][(x)] ^= D; \
+    } while (0)
+
+// Applies the chi step mapping to row y.
+#define keccakChi(y) \
+    do { \
+        state.A[(y)][0] = state.B[(y)][0] ^ ((~state.B[(y)][1]) & state.B[(y)][2]); \
+        state.A[(y)][1] = state.B[(y)][1] ^ ((~state.B[(y)][2]) & state.B[(y)][3]); \
+        state.A[(y)][2] = state.B[(y)][2] ^ ((~state.B[(y)][3]) & state.B[(y)][4]); \
+        state.A[(y)][3] = state.B[(y)][3] ^ ((~state.B[(y)][4]) & state.B[(y)][0]); \
+        state.A[(y)][4] = state.B[(y)][4] ^ ((~state.B[(y)][0]) & state.B[(y)][1]); \
+    } while (0)
+
+#endif
+
 /**
  * \brief Transform the state with the KECCAK-p sponge function with b = 1600.
  */
 void KeccakCore::keccakp()
 {
+#if CRYPTO_KECCAK_UNROLL
+    uint64_t D;
+    uint8_t index;
+#else
     static const uint8_t addMod5Table[9] PROGMEM = {
         0, 1, 2, 3, 4, 0, 1, 2, 3
     };
     #define addMod5(x, y) (pgm_read_byte(&(addMod5Table[(x) + (y)])))
     uint64_t D;
     uint8_t index, index2;
+#endif
+#if defined(KECCAKP_AVX512)
+    if (selected == Vector && cpuHasAvx512f()) {
+        keccakpAVX512(state.A);
+        return;
+    }
+#endif
     for (uint8_t round = 0; round < 24; ++round) {
         // Step mapping theta.  The specification mentions two temporary
         // arrays of size 5 called C and D.  To save a bit of memory,
         // we use the first row of B to store C and compute D on the fly.
+#if CRYPTO_KECCAK_UNROLL
+        for (index = 0; index < 5; ++index) {
+            state.B[0][index] = state.A[0][index] ^ state.A[1][index] ^
+                                state.A[2][index] ^ state.A[3][index] ^
+                                state.A[4][index];
+        }
+        keccakTheta(0, 4, 1);
+        keccakTheta(1, 0, 2);
+        keccakTheta(2, 1, 3);
+        keccakTheta(3, 2, 4);
+        keccakTheta(4, 3, 0);
+#else
         for (index = 0; index < 5; ++index) {
             state.B[0][index] = state.A[0][index] ^ state.A[1][index] ^
                                 state.A[2][index] ^ state.A[3][index] ^
@@ -308,6 +826,7 @@ void KeccakCore::keccakp()
             for (index2 = 0; index2 < 5; ++index2)
                 state.A[index2][index] ^= D;
         }
+#endif
 
         // Step mapping rho and pi combined into a single step.
         // Rotate all lanes by a specific offset and rearrange.
@@ -338,6 +857,13 @@ void KeccakCore::keccakp()
         state.B[4][4] = leftRotate2_64 (state.A[4][1]);
 
         // Step mapping chi.  Combine each lane with two other lanes in its row.
+#if CRYPTO_KECCAK_UNROLL
+        keccakChi(0);
+        keccakChi(1);
+        keccakChi(2);
+        keccakChi(3);
+        keccakChi(4);
+#else
         for (index = 0; index < 5; ++index) {
             for (index2 = 0; index2 < 5; ++index2) {
                 state.A[index2][index] =
@@ -346,18 +872,78 @@ void KeccakCore::keccakp()
                      state.B[index2][addMod5(index, 2)]);
             }
         }
+#endif
 
         // Step mapping iota.  XOR A[0][0] with the round constant.
-        static uint64_t const RC[24] PROGMEM = {
-            0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL,
-            0x8000000080008000ULL, 0x000000000000808BULL, 0x0000000080000001ULL,
-            0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008AULL,
-            0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
-            0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL,
-            0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
-            0x000000000000800AULL, 0x800000008000000AULL, 0x8000000080008081ULL,
-            0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
-        };
         state.A[0][0] ^= pgm_read_qword(RC + round);
     }
 }
+
+#endif // KECCAKP_IMPL
+
+/**
+ * \enum KeccakCore::Implementation
+ * \brief Implementation of the Keccak-p[1600] permutation.
+ *
+ * \sa implementation(), setImplementation()
+ */
+
+/**
+ * \var KeccakCore::Portable
+ * \brief Portable C++ code that is selected by KECCAKP_IMPL.
+ */
+
+/**
+ * \var KeccakCore::Vector
+ * \brief AVX-512 instructions on x86, which are the default when they
+ * are available.
+ */
+
+/**
+ * \brief Returns the implementation of the permutation that is in use.
+ *
+ * \sa setImplementation()
+ */
+KeccakCore::Implementation KeccakCore::implementation()
+{
+#if defined(KECCAKP_AVX512)
+    if (selected == Vector && !cpuHasAvx512f())
+        return Portable;
+#endif
+    return (Implementation)selected;
+}
+
+/**
+ * \brief Selects the implementation of the permutation to use.
+ *
+ * \param impl The implementation to use.
+ * \return Returns false if \a impl is not available on this platform,
+ * in which case the previous implementation remains selected.
+ *
+ * The selection applies to all KeccakCore objects, and so to SHA3, SHAKE,
+ * and KMAC.  It is intended for comparing the implementations in tests and
+ * benchmarks; normal applications should leave it at the default.
+ * Portable is always available and Vector is available if the processor
+ * has AVX-512 and CRYPTO_KECCAK_AVX512 is not 0.
+ *
+ * \sa implementation()
+ */
+bool KeccakCore::setImplementation(Implementation impl)
+{
+    switch (impl) {
+    case Portable:
+        break;
+    case Vector:
+#if defined(KECCAKP_AVX512)
+        if (!cpuHasAvx512f())
+            return false;
+        break;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+    selected = impl;
+    return true;
+}
@@ -26,12 +26,41 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+// Selects the implementation of the Keccak-p[1600] permutation:
+// 0 for the compact loop-based version that suits 8-bit AVR,
+// 1 for an unrolled 64-bit version with lane complementing, or
+// 2 for a bit-interleaved 32-bit version that suits ARM Cortex-M.
+#if !defined(KECCAKP_IMPL)
+#if defined(__AVR__)
+#define KECCAKP_IMPL 0
+#elif defined(__LP64__) || defined(_WIN64)
+#define KECCAKP_IMPL 1
+#else
+#define KECCAKP_IMPL 2
+#endif
+#endif
+
+// Use AVX-512 instructions for the permutation on x86 processors that
+// support them.  Set to 0 to always use the KECCAKP_IMPL code.
+#if !defined(CRYPTO_KECCAK_AVX512)
+#define CRYPTO_KECCAK_AVX512 1
+#endif
+
 class KeccakCore
 {
 public:
     KeccakCore();
     ~KeccakCore();
 
+    enum Implementation
+    {
+        Portable,
+        Vector
+    };
+
+    static Implementation implementation();
+    static bool setImplementation(Implementation impl);
+
     size_t capacity() const;
     void setCapacity(size_t capacity);
 
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "KeccakCoreX4.h"
+#include "Crypto.h"
+#include "utility/EndianUtil.h"
+#include "utility/ProgMemUtil.h"
+#include "utility/CpuFeatureUtil.h"
+#include <string.h>
+
+/**
+ * \class KeccakCoreX4 KeccakCoreX4.h <KeccakCoreX4.h>
+ * \brief Four Keccak sponge functions that are permuted in lockstep.
+ *
+ * This class holds four independent Keccak-f[1600] states, called "lanes",
+ * that share a single capacity.  The states are stored transposed so that
+ * permute() can transform all four at once in SIMD registers.  On x86
+ * processors that support AVX2, each 64-bit word of all four states fits
+ * in a single 256-bit register.  Other platforms use the compiler's generic
+ * vector support, which is lowered to SSE2, NEON, or scalar code.
+ *
+ * Unlike KeccakCore, this class does not buffer partial blocks.  The caller
+ * absorbs whole blocks into each lane, pads the final block, and then calls
+ * permute() once for all lanes.  SHA3_256x4 builds a multi-message hashing
+ * engine on top of this class.
+ *
+ * This class is intended for 32-bit and 64-bit platforms.  On AVR,
+ * KeccakCore will be faster and use less memory.
+ *
+ * \sa KeccakCore, SHA3_256x4
+ */
+
+/**
+ * \brief Constructs four new Keccak sponge functions.
+ *
+ * As with KeccakCore, the constructor should be followed by a call to
+ * setCapacity() to select the capacity of interest.
+ */
+KeccakCoreX4::KeccakCoreX4()
+    : _blockSize(8)
+{
+    memset(A, 0, sizeof(A));
+}
+
+/**
+ * \brief Destroys these Keccak sponge functions after clearing all
+ * sensitive information.
+ */
+KeccakCoreX4::~KeccakCoreX4()
+{
+    clean(A);
+}
+
+/**
+ * \brief Returns the capacity of the sponge functions in bits.
+ *
+ * \sa setCapacity(), blockSize()
+ */
+size_t KeccakCoreX4::capacity() const
+{
+    return 1600 - ((size_t)_blockSize) * 8;
+}
+
+/**
+ * \brief Sets the capacity of the Keccak sponge functions in bits.
+ *
+ * \param capacity The capacity of the Keccak sponge functions in bits which
+ * should be a multiple of 64 and between 64 and 1536.
+ *
+ * All lanes are reset.
+ *
+ * \sa capacity(), blockSize()
+ */
+void KeccakCoreX4::setCapacity(size_t capacity)
+{
+    _blockSize = (1600 - capacity) / 8;
+    reset();
+}
+
+/**
+ * \fn size_t KeccakCoreX4::blockSize() const
+ * \brief Returns the input block size for the sponge functions in bytes.
+ *
+ * The block size is (1600 - capacity()) / 8.
+ *
+ * \sa capacity()
+ */
+
+/**
+ * \brief Resets all lanes ready for new sessions.
+ *
+ * \sa resetLane()
+ */
+void KeccakCoreX4::reset()
+{
+    memset(A, 0, sizeof(A));
+}
+
+/**
+ * \brief Resets a single lane ready for a new session.
+ *
+ * \param lane The index of the lane to reset, between 0 and 3.
+ *
+ * \sa reset()
+ */
+void KeccakCoreX4::resetLane(uint8_t lane)
+{
+    for (uint8_t index = 0; index < 25; ++index)
+        A[index][lane] = 0;
+}
+
+/**
+ * \brief Absorbs input data into the start of a lane's current block.
+ *
+ * \param lane The index of the lane, between 0 and 3.
+ * \param data The input data to absorb.
+ * \param size The size of the input data, which must be less than or
+ * equal to blockSize().
+ *
+ * The data is XOR'ed with the lane state but permute() is not called.
+ *
+ * \sa pad(), permute()
+ */
+void KeccakCoreX4::absorb(uint8_t lane, const void *data, size_t size)
+{
+    const uint8_t *d = (const uint8_t *)data;
+    uint8_t index = 0;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, d, sizeof(word));
+        A[index++][lane] ^= le64toh(word);
+        d += 8;
+        size -= 8;
+    }
+    for (uint8_t posn = 0; posn < size; ++posn)
+        A[index][lane] ^= ((uint64_t)(d[posn])) << (posn * 8);
+}
+
+/**
+ * \brief Pads the current block of a lane.
+ *
+ * \param lane The index of the lane, between 0 and 3.
+ * \param posn The number of bytes of data in the final block, which must
+ * be less than blockSize().
+ * \param tag The tag byte for the padding, as for KeccakCore::pad().
+ *
+ * Unlike KeccakCore::pad(), permute() is not called.
+ *
+ * \sa absorb(), permute()
+ */
+void KeccakCoreX4::pad(uint8_t lane, size_t posn, uint8_t tag)
+{
+    A[posn / 8][lane] ^= ((uint64_t)tag) << ((posn % 8) * 8);
+    A[(_blockSize - 1) / 8][lane] ^= 0x8000000000000000ULL;
+}
+
+/**
+ * \brief Extracts data from the start of a lane's current state.
+ *
+ * \param lane The index of the lane, between 0 and 3.
+ * \param data The data buffer to fill with extracted data.
+ * \param size The number of bytes to extract, which must be less than
+ * or equal to blockSize().
+ *
+ * \sa permute()
+ */
+void KeccakCoreX4::extract(uint8_t lane, void *data, size_t size)
+{
+    uint8_t *d = (uint8_t *)data;
+    uint8_t index = 0;
+    while (size >= 8) {
+        uint64_t word = htole64(A[index++][lane]);
+        memcpy(d, &word, sizeof(word));
+        d += 8;
+        size -= 8;
+    }
+    for (uint8_t posn = 0; posn < size; ++posn)
+        d[posn] = (uint8_t)(A[index][lane] >> (posn * 8));
+}
+
+/**
+ * \brief Clears all sensitive data from this object.
+ */
+void KeccakCoreX4::clear()
+{
+    clean(A);
+}
+
+// One 64-bit word from each of the four lanes.
+typedef uint64_t KeccakLanes __attribute__((vector_size(32)));
+
+// Round constants for the iota step mapping.
+static uint64_t const RCx4[24] PROGMEM = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL,
+    0x8000000080008000ULL, 0x000000000000808BULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008AULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800AULL, 0x800000008000000AULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+#define KECCAKX4_ROL(x, bits) (((x) << (bits)) | ((x) >> (64 - (bits))))
+
+// Fully unrolled round on all four lanes.  The words are named after
+// their row (b, g, k, m, s) and column (a, e, i, o, u) as in the Keccak
+// team's reference code.
+#define KECCAKX4_ROUND(A, E, rc) \
+    do { \
+        Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+        Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+        Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+        Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+        Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+        Da = Cu ^ KECCAKX4_ROL(Ce, 1); \
+        De = Ca ^ KECCAKX4_ROL(Ci, 1); \
+        Di = Ce ^ KECCAKX4_ROL(Co, 1); \
+        Do = Ci ^ KECCAKX4_ROL(Cu, 1); \
+        Du = Co ^ KECCAKX4_ROL(Ca, 1); \
+        Ba = A##ba ^ Da; \
+        Be = KECCAKX4_ROL(A##ge ^ De, 44); \
+        Bi = KECCAKX4_ROL(A##ki ^ Di, 43); \
+        Bo = KECCAKX4_ROL(A##mo ^ Do, 21); \
+        Bu = KECCAKX4_ROL(A##su ^ Du, 14); \
+        E##ba = Ba ^ ((~Be) & Bi) ^ (rc); \
+        E##be = Be ^ ((~Bi) & Bo); \
+        E##bi = Bi ^ ((~Bo) & Bu); \
+        E##bo = Bo ^ ((~Bu) & Ba); \
+        E##bu = Bu ^ ((~Ba) & Be); \
+        Ba = KECCAKX4_ROL(A##bo ^ Do, 28); \
+        Be = KECCAKX4_ROL(A##gu ^ Du, 20); \
+        Bi = KECCAKX4_ROL(A##ka ^ Da, 3); \
+        Bo = KECCAKX4_ROL(A##me ^ De, 45); \
+        Bu = KECCAKX4_ROL(A##si ^ Di, 61); \
+        E##ga = Ba ^ ((~Be) & Bi); \
+        E##ge = Be ^ ((~Bi) & Bo); \
+        E##gi = Bi ^ ((~Bo) & Bu); \
+        E##go = Bo ^ ((~Bu) & Ba); \
+        E##gu = Bu ^ ((~Ba) & Be); \
+        Ba = KECCAKX4_ROL(A##be ^ De, 1); \
+        Be = KECCAKX4_ROL(A##gi ^ Di, 6); \
+        Bi = KECCAKX4_ROL(A##ko ^ Do, 25); \
+        Bo = KECCAKX4_ROL(A##mu ^ Du, 8); \
+        Bu = KECCAKX4_ROL(A##sa ^ Da, 18); \
+        E##ka = Ba ^ ((~Be) & Bi); \
+        E##ke = Be ^ ((~Bi) & Bo); \
+        E##ki = Bi ^ ((~Bo) & Bu); \
+        E##ko = Bo ^ ((~Bu) & Ba); \
+        E##ku = Bu ^ ((~Ba) & Be); \
+        Ba = KECCAKX4_ROL(A##bu ^ Du, 27); \
+        Be = KECCAKX4_ROL(A##ga ^ Da, 36); \
+        Bi = KECCAKX4_ROL(A##ke ^ De, 10); \
+        Bo = KECCAKX4_ROL(A##mi ^ Di, 15); \
+        Bu = KECCAKX4_ROL(A##so ^ Do, 56); \
+        E##ma = Ba ^ ((~Be) & Bi); \
+        E##me = Be ^ ((~Bi) & Bo); \
+        E##mi = Bi ^ ((~Bo) & Bu); \
+        E##mo = Bo ^ ((~Bu) & Ba); \
+        E##mu = Bu ^ ((~Ba) & Be); \
+        Ba = KECCAKX4_ROL(A##bi ^ Di, 62); \
+        Be = KECCAKX4_ROL(A##go ^ Do, 55); \
+        Bi = KECCAKX4_ROL(A##ku ^ Du, 39); \
+        Bo = KECCAKX4_ROL(A##ma ^ Da, 41); \
+        Bu = KECCAKX4_ROL(A##se ^ De, 2); \
+        E##sa = Ba ^ ((~Be) & Bi); \
+        E##se = Be ^ ((~Bi) & Bo); \
+        E##si = Bi ^ ((~Bo) & Bu); \
+        E##so = Bo ^ ((~Bu) & Ba); \
+        E##su = Bu ^ ((~Ba) & Be); \
+    } while (0)
+
+// Transforms the four transposed states with 24 rounds of Keccak-f[1600].
+// This is inlined into the generic and AVX2 versions of the permutation.
+static inline __attribute__((always_inline)) void keccakX4Rounds(uint64_t state[25][4])
+{
+    KeccakLanes Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake;
+    KeccakLanes Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+    KeccakLanes Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke;
+    KeccakLanes Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+    KeccakLanes Ba, Be, Bi, Bo, Bu;
+    KeccakLanes Ca, Ce, Ci, Co, Cu;
+    KeccakLanes Da, De, Di, Do, Du;
+
+    memcpy(&Aba, state[0], sizeof(KeccakLanes));
+    memcpy(&Abe, state[1], sizeof(KeccakLanes));
+    memcpy(&Abi, state[2], sizeof(KeccakLanes));
+    memcpy(&Abo, state[3], sizeof(KeccakLanes));
+    memcpy(&Abu, state[4], sizeof(KeccakLanes));
+    memcpy(&Aga, state[5], sizeof(KeccakLanes));
+    memcpy(&Age, state[6], sizeof(KeccakLanes));
+    memcpy(&Agi, state[7], sizeof(KeccakLanes));
+    memcpy(&Ago, state[8], sizeof(KeccakLanes));
+    memcpy(&Agu, state[9], sizeof(KeccakLanes));
+    memcpy(&Aka, state[10], sizeof(KeccakLanes));
+    memcpy(&Ake, state[11], sizeof(KeccakLanes));
+    memcpy(&Aki, state[12], sizeof(KeccakLanes));
+    memcpy(&Ako, state[13], sizeof(KeccakLanes));
+    memcpy(&Aku, state[14], sizeof(KeccakLanes));
+    memcpy(&Ama, state[15], sizeof(KeccakLanes));
+    memcpy(&Ame, state[16], sizeof(KeccakLanes));
+    memcpy(&Ami, state[17], sizeof(KeccakLanes));
+    memcpy(&Amo, state[18], sizeof(KeccakLanes));
+    memcpy(&Amu, state[19], sizeof(KeccakLanes));
+    memcpy(&Asa, state[20], sizeof(KeccakLanes));
+    memcpy(&Ase, state[21], sizeof(KeccakLanes));
+    memcpy(&Asi, state[22], sizeof(KeccakLanes));
+    memcpy(&Aso, state[23], sizeof(KeccakLanes));
+    memcpy(&Asu, state[24], sizeof(KeccakLanes));
+
+    for (uint8_t round = 0; round < 24; round += 2) {
+        KECCAKX4_ROUND(A, E, pgm_read_qword(RCx4 + round));
+        KECCAKX4_ROUND(E, A, pgm_read_qword(RCx4 + round + 1));
+    }
+
+    memcpy(state[0], &Aba, sizeof(KeccakLanes));
+    memcpy(state[1], &Abe, sizeof(KeccakLanes));
+    memcpy(state[2], &Abi, sizeof(KeccakLanes));
+    memcpy(state[3], &Abo, sizeof(KeccakLanes));
+    memcpy(state[4], &Abu, sizeof(KeccakLanes));
+    memcpy(state[5], &Aga, sizeof(KeccakLanes));
+    memcpy(state[6], &Age, sizeof(KeccakLanes));
+    memcpy(state[7], &Agi, sizeof(KeccakLanes));
+    memcpy(state[8], &Ago, sizeof(KeccakLanes));
+    memcpy(state[9], &Agu, sizeof(KeccakLanes));
+    memcpy(state[10], &Aka, sizeof(KeccakLanes));
+    memcpy(state[11], &Ake, sizeof(KeccakLanes));
+    memcpy(state[12], &Aki, sizeof(KeccakLanes));
+    memcpy(state[13], &Ako, sizeof(KeccakLanes));
+    memcpy(state[14], &Aku, sizeof(KeccakLanes));
+    memcpy(state[15], &Ama, sizeof(KeccakLanes));
+    memcpy(state[16], &Ame, sizeof(KeccakLanes));
+    memcpy(state[17], &Ami, sizeof(KeccakLanes));
+    memcpy(state[18], &Amo, sizeof(KeccakLanes));
+    memcpy(state[19], &Amu, sizeof(KeccakLanes));
+    memcpy(state[20], &Asa, sizeof(KeccakLanes));
+    memcpy(state[21], &Ase, sizeof(KeccakLanes));
+    memcpy(state[22], &Asi, sizeof(KeccakLanes));
+    memcpy(state[23], &Aso, sizeof(KeccakLanes));
+    memcpy(state[24], &Asu, sizeof(KeccakLanes));
+}
+
+static void keccakX4Generic(uint64_t state[25][4])
+{
+    keccakX4Rounds(state);
+}
+
+#if CRYPTO_X86_AVX2
+
+__attribute__((target("avx2")))
+static void keccakX4AVX2(uint64_t state[25][4])
+{
+    keccakX4Rounds(state);
+}
+
+#endif
+
+/**
+ * \brief Transforms all four lanes with the Keccak-f[1600] permutation.
+ */
+void KeccakCoreX4::permute()
+{
+#if CRYPTO_X86_AVX2
+    if (cpuHasAvx2()) {
+        keccakX4AVX2(A);
+        return;
+    }
+#endif
+    keccakX4Generic(A);
+}
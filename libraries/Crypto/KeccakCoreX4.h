@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_KECCAKCOREX4_H
+#define CRYPTO_KECCAKCOREX4_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class KeccakCoreX4
+{
+public:
+    KeccakCoreX4();
+    ~KeccakCoreX4();
+
+    size_t capacity() const;
+    void setCapacity(size_t capacity);
+
+    size_t blockSize() const { return _blockSize; }
+
+    void reset();
+    void resetLane(uint8_t lane);
+
+    void absorb(uint8_t lane, const void *data, size_t size);
+    void pad(uint8_t lane, size_t posn, uint8_t tag);
+    void extract(uint8_t lane, void *data, size_t size);
+
+    void permute();
+
+    void clear();
+
+private:
+    uint64_t A[25][4];
+    uint8_t _blockSize;
+};
+
+#endif
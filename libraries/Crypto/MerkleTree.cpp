@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "MerkleTree.h"
+#include "SHA256Multi.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class MerkleTree MerkleTree.h <MerkleTree.h>
+ * \brief Merkle hash tree over a sequence of data chunks.
+ *
+ * A Merkle tree hashes each chunk of a large asset, such as a firmware
+ * image or a log in an external EEPROM, into a "leaf" and then hashes
+ * pairs of nodes together until there is a single root hash.  Changing
+ * one chunk only requires the nodes on the path from its leaf to the root
+ * to be recomputed, and a single chunk can be checked against a trusted
+ * root with a proof of O(log n) sibling hashes rather than by rehashing
+ * the whole asset:
+ *
+ * \code
+ * SHA256 sha256;
+ * uint8_t nodes[...];  // MerkleTree::storageSize(32, NUM_CHUNKS) bytes
+ * MerkleTree tree(sha256, nodes, sizeof(nodes));
+ * tree.setLeafCount(NUM_CHUNKS);
+ * for (size_t index = 0; index < NUM_CHUNKS; ++index)
+ *     tree.setLeaf(index, chunk[index], CHUNK_SIZE);
+ * size_t len = tree.proof(5, proof, sizeof(proof));
+ * ...
+ * if (MerkleTree::verify(sha256, root, NUM_CHUNKS, 5, chunk5, CHUNK_SIZE, proof, len))
+ *     useChunk(chunk5);
+ * \endcode
+ *
+ * The tree has the same shape and hashes as the Merkle tree of
+ * <a href="https://tools.ietf.org/html/rfc6962">RFC 6962</a>: a leaf
+ * is Hash(0x00 || chunk) and an interior node is Hash(0x01 || left ||
+ * right).  The domain separation bytes prevent an interior node from
+ * being passed off as a leaf.  When a level has an odd number of nodes,
+ * the last node is promoted to the next level unchanged.  RFC 6962 uses
+ * SHA256, but any Hash algorithm can be used, such as BLAKE2s.
+ *
+ * The caller supplies the storage for the nodes, which holds all of the
+ * leaves and interior nodes so that they never have to be recomputed.
+ * storageSize() returns the number of bytes required, which is a little
+ * under twice the hash size times the number of leaves.
+ *
+ * When many leaves change at once, setLeaves() hashes the leaves first
+ * and then recomputes each affected interior node once.  If the tree uses
+ * SHA256, then setEngine() can be used to supply a SHA256x4 or SHA256x8
+ * engine to hash the nodes of each level several at a time.
+ *
+ * \sa SHA256MultiCommon
+ */
+
+// Largest hash size of any of the hash algorithms.
+#define MERKLE_MAX_HASH_SIZE 64
+
+// Domain separation bytes from RFC 6962.
+#define MERKLE_LEAF_PREFIX  0x00
+#define MERKLE_NODE_PREFIX  0x01
+
+// Number of nodes in the level above a level with "width" nodes.
+#define MERKLE_PARENTS(width) (((width) >> 1) + ((width) & 1))
+
+/**
+ * \brief Constructs a new Merkle tree.
+ *
+ * \param hash The hash algorithm to use for the leaves and nodes.
+ * \param nodes Points to the storage for the nodes of the tree.
+ * \param size The size of the storage in bytes.
+ *
+ * The tree is empty until setLeafCount() is called.  The \a hash object
+ * is used as a work area by the tree and must not be used for anything
+ * else while the tree is being updated.
+ *
+ * \sa storageSize(), setLeafCount()
+ */
+MerkleTree::MerkleTree(Hash &hash, void *nodes, size_t size)
+    : hash(&hash)
+    , engine(0)
+    , nodes((uint8_t *)nodes)
+    , size(size)
+    , leaves(0)
+    , _hashSize(hash.hashSize())
+{
+}
+
+/**
+ * \brief Destroys this Merkle tree.
+ *
+ * The node storage belongs to the caller and is not cleared.  Call clear()
+ * first if the hashes could reveal something about the data.
+ */
+MerkleTree::~MerkleTree()
+{
+}
+
+/**
+ * \brief Returns the number of bytes of node storage that are required
+ * for a tree.
+ *
+ * \param hashSize The size of the hash algorithm's output in bytes.
+ * \param leafCount The number of leaves in the tree.
+ *
+ * \return The number of bytes of storage for the leaves and all levels
+ * of interior nodes.
+ */
+size_t MerkleTree::storageSize(size_t hashSize, size_t leafCount)
+{
+    size_t total = 0;
+    size_t width = leafCount;
+    while (width > 1) {
+        total += width;
+        width = MERKLE_PARENTS(width);
+    }
+    return (total + width) * hashSize;
+}
+
+/**
+ * \fn size_t MerkleTree::hashSize() const
+ * \brief Returns the size of the leaf, node, and root hashes in bytes.
+ */
+
+/**
+ * \brief Sets the number of leaves in the tree.
+ *
+ * \param count The number of leaves, which must be at least 1.
+ *
+ * \return Returns false if \a count is zero or the node storage is too
+ * small, in which case the tree is left empty.
+ *
+ * All of the leaves are set to the hash of an empty chunk and the
+ * interior nodes are computed.
+ *
+ * \sa setLeaf(), setLeaves()
+ */
+bool MerkleTree::setLeafCount(size_t count)
+{
+    leaves = 0;
+    if (!count || storageSize(_hashSize, count) > size)
+        return false;
+    leaves = count;
+    hashLeaf(nodes, 0, 0);
+    for (size_t index = 1; index < count; ++index)
+        memcpy(nodes + index * _hashSize, nodes, _hashSize);
+    update(0, count - 1);
+    return true;
+}
+
+/**
+ * \fn size_t MerkleTree::leafCount() const
+ * \brief Returns the number of leaves in the tree, or zero if the tree
+ * is empty.
+ */
+
+/**
+ * \fn void MerkleTree::setEngine(SHA256MultiCommon *engine)
+ * \brief Sets a multi-lane SHA-256 engine for hashing several leaves or
+ * nodes at once.
+ *
+ * \param engine The engine to use, or NULL to hash one node at a time
+ * with the tree's hash object.
+ *
+ * The engine must only be used when the tree's hash algorithm is SHA256.
+ * It must not have any other jobs outstanding while the tree is being
+ * updated.  Levels where only one node needs to be recomputed, such as
+ * all of the levels after setLeaf(), are hashed with the tree's hash
+ * object instead.
+ */
+
+/**
+ * \brief Sets the contents of a leaf and updates the path to the root.
+ *
+ * \param index The index of the leaf, starting at 0.
+ * \param data Points to the chunk of data for the leaf.
+ * \param len The length of the chunk in bytes.
+ *
+ * This hashes the chunk and the O(log n) nodes that depend upon it.
+ * Nothing happens if \a index is out of range.
+ *
+ * \sa setLeaves(), root()
+ */
+void MerkleTree::setLeaf(size_t index, const void *data, size_t len)
+{
+    if (index >= leaves)
+        return;
+    hashLeaf(nodes + index * _hashSize, data, len);
+    update(index, index);
+}
+
+/**
+ * \brief Sets the contents of a range of leaves and updates the rest of
+ * the tree.
+ *
+ * \param first The index of the first leaf to set.
+ * \param count The number of leaves to set.
+ * \param data Array of \a count pointers to the chunks of data.
+ * \param lens Array of \a count chunk lengths in bytes.
+ *
+ * The leaves are hashed first and then each interior node that depends
+ * upon them is recomputed once, which is cheaper than calling setLeaf()
+ * for each leaf in turn.  The range is truncated if it goes past the
+ * end of the tree.
+ *
+ * \sa setLeaf(), setEngine()
+ */
+void MerkleTree::setLeaves(size_t first, size_t count,
+                           const void * const data[], const size_t lens[])
+{
+    if (first >= leaves)
+        return;
+    if (count > (leaves - first))
+        count = leaves - first;
+    if (!count)
+        return;
+    hashLeaves(first, count, data, lens);
+    update(first, first + count - 1);
+}
+
+/**
+ * \brief Returns the hash of a leaf.
+ *
+ * \param index The index of the leaf, starting at 0.
+ *
+ * \return A pointer to hashSize() bytes within the node storage, or NULL
+ * if \a index is out of range.
+ */
+const uint8_t *MerkleTree::leafHash(size_t index) const
+{
+    if (index >= leaves)
+        return 0;
+    return nodes + index * _hashSize;
+}
+
+/**
+ * \brief Returns the root hash of the tree.
+ *
+ * \return A pointer to hashSize() bytes within the node storage, or NULL
+ * if the tree is empty.
+ */
+const uint8_t *MerkleTree::root() const
+{
+    if (!leaves)
+        return 0;
+    return nodes + storageSize(_hashSize, leaves) - _hashSize;
+}
+
+/**
+ * \brief Returns the size of the proof for a leaf.
+ *
+ * \param index The index of the leaf, starting at 0.
+ *
+ * \return The number of bytes that proof() will write for \a index,
+ * which is at most hashSize() times the height of the tree.  Returns
+ * zero if \a index is out of range or the tree has a single leaf.
+ */
+size_t MerkleTree::proofSize(size_t index) const
+{
+    size_t len = 0;
+    if (index >= leaves)
+        return 0;
+    for (size_t width = leaves; width > 1; width = MERKLE_PARENTS(width)) {
+        if ((index ^ 1) < width)
+            len += _hashSize;
+        index >>= 1;
+    }
+    return len;
+}
+
+/**
+ * \brief Generates the proof that a leaf is part of the tree.
+ *
+ * \param index The index of the leaf, starting at 0.
+ * \param proof The buffer to write the proof to.
+ * \param len The size of the \a proof buffer in bytes.
+ *
+ * \return The number of bytes in the proof, or zero if \a index is out
+ * of range or \a len is too small.
+ *
+ * The proof consists of the hashes of the siblings of the nodes on the
+ * path from the leaf to the root, starting at the leaf.
+ *
+ * \sa verify(), proofSize()
+ */
+size_t MerkleTree::proof(size_t index, uint8_t *proof, size_t len) const
+{
+    size_t posn = 0;
+    if (index >= leaves || len < proofSize(index))
+        return 0;
+    const uint8_t *level = nodes;
+    for (size_t width = leaves; width > 1; width = MERKLE_PARENTS(width)) {
+        size_t sibling = index ^ 1;
+        if (sibling < width) {
+            memcpy(proof + posn, level + sibling * _hashSize, _hashSize);
+            posn += _hashSize;
+        }
+        level += width * _hashSize;
+        index >>= 1;
+    }
+    return posn;
+}
+
+/**
+ * \brief Verifies that a chunk of data is part of a tree.
+ *
+ * \param hash The hash algorithm that the tree was built with.
+ * \param root The trusted root hash of the tree.
+ * \param leafCount The number of leaves in the tree.
+ * \param index The index of the leaf for the chunk.
+ * \param data Points to the chunk of data to be verified.
+ * \param len The length of the chunk in bytes.
+ * \param proof Points to the proof from proof().
+ * \param proofLen The length of the proof in bytes.
+ *
+ * \return Returns true if \a data is the chunk at \a index in the tree
+ * with \a root; false otherwise.
+ *
+ * This function doesn't need the rest of the tree, so it can be used by
+ * a device that only has the root hash and receives chunks and proofs
+ * from somewhere else.  It hashes the chunk and one node per level.
+ *
+ * \sa proof()
+ */
+bool MerkleTree::verify(Hash &hash, const uint8_t *root, size_t leafCount,
+                        size_t index, const void *data, size_t len,
+                        const uint8_t *proof, size_t proofLen)
+{
+    uint8_t node[MERKLE_MAX_HASH_SIZE];
+    uint8_t prefix = MERKLE_LEAF_PREFIX;
+    size_t hashSize = hash.hashSize();
+    size_t posn = 0;
+    if (index >= leafCount)
+        return false;
+
+    // Hash the leaf and then combine it with the siblings up to the root.
+    hash.reset();
+    hash.update(&prefix, 1);
+    hash.update(data, len);
+    hash.finalize(node, hashSize);
+    prefix = MERKLE_NODE_PREFIX;
+    for (size_t width = leafCount; width > 1; width = MERKLE_PARENTS(width)) {
+        if ((index ^ 1) < width) {
+            if ((proofLen - posn) < hashSize)
+                return false;
+            hash.reset();
+            hash.update(&prefix, 1);
+            if (index & 1) {
+                hash.update(proof + posn, hashSize);
+                hash.update(node, hashSize);
+            } else {
+                hash.update(node, hashSize);
+                hash.update(proof + posn, hashSize);
+            }
+            hash.finalize(node, hashSize);
+            posn += hashSize;
+        }
+        index >>= 1;
+    }
+    return posn == proofLen && secure_compare(node, root, hashSize);
+}
+
+/**
+ * \brief Clears the node storage and makes the tree empty.
+ */
+void MerkleTree::clear()
+{
+    if (leaves)
+        clean(nodes, storageSize(_hashSize, leaves));
+    leaves = 0;
+}
+
+/**
+ * \internal
+ * \brief Collects the nodes of a level into jobs for a multi-lane engine.
+ */
+class MerkleBatch
+{
+public:
+    explicit MerkleBatch(SHA256MultiCommon *engine);
+    ~MerkleBatch() { clean(jobs); }
+
+    void add(uint8_t *out, uint8_t prefix, const void *data, size_t len);
+    void flush();
+
+private:
+    SHA256MultiCommon *engine;
+    SHA256Job jobs[8];
+    uint8_t *outputs[8];
+    uint8_t freeSlots[8];
+    uint8_t numFree;
+
+    void finish(SHA256Job *job);
+};
+
+MerkleBatch::MerkleBatch(SHA256MultiCommon *engine)
+    : engine(engine)
+    , numFree(8)
+{
+    for (uint8_t index = 0; index < 8; ++index)
+        freeSlots[index] = index;
+}
+
+void MerkleBatch::add(uint8_t *out, uint8_t prefix, const void *data, size_t len)
+{
+    if (!numFree)
+        finish(engine->flush());
+    uint8_t slot = freeSlots[--numFree];
+    SHA256Job *job = &jobs[slot];
+    job->data = data;
+    job->len = len;
+    job->key = 0;
+    job->keyLen = 0;
+    outputs[slot] = out;
+    finish(engine->submit(job, prefix));
+}
+
+void MerkleBatch::flush()
+{
+    SHA256Job *job;
+    while ((job = engine->flush()) != 0)
+        finish(job);
+}
+
+void MerkleBatch::finish(SHA256Job *job)
+{
+    if (job) {
+        uint8_t slot = (uint8_t)(job - jobs);
+        memcpy(outputs[slot], job->hash, sizeof(job->hash));
+        freeSlots[numFree++] = slot;
+    }
+}
+
+/**
+ * \internal
+ * \brief Hashes a chunk of data as a leaf.
+ *
+ * \param out The buffer for the leaf hash.
+ * \param data Points to the chunk of data.
+ * \param len The length of the chunk in bytes.
+ */
+void MerkleTree::hashLeaf(uint8_t *out, const void *data, size_t len)
+{
+    uint8_t prefix = MERKLE_LEAF_PREFIX;
+    hash->reset();
+    hash->update(&prefix, 1);
+    hash->update(data, len);
+    hash->finalize(out, _hashSize);
+}
+
+/**
+ * \internal
+ * \brief Hashes a range of leaves, using the engine if there is one.
+ *
+ * \param first The index of the first leaf.
+ * \param count The number of leaves.
+ * \param data Array of \a count pointers to the chunks of data.
+ * \param lens Array of \a count chunk lengths in bytes.
+ */
+void MerkleTree::hashLeaves(size_t first, size_t count,
+                            const void * const data[], const size_t lens[])
+{
+    uint8_t *out = nodes + first * _hashSize;
+    if (engine && count > 1) {
+        MerkleBatch batch(engine);
+        for (size_t index = 0; index < count; ++index, out += _hashSize)
+            batch.add(out, MERKLE_LEAF_PREFIX, data[index], lens[index]);
+        batch.flush();
+    } else {
+        for (size_t index = 0; index < count; ++index, out += _hashSize)
+            hashLeaf(out, data[index], lens[index]);
+    }
+}
+
+/**
+ * \internal
+ * \brief Recomputes the interior nodes that depend upon a range of leaves.
+ *
+ * \param first The index of the first leaf that changed.
+ * \param last The index of the last leaf that changed.
+ */
+void MerkleTree::update(size_t first, size_t last)
+{
+    uint8_t *level = nodes;
+    for (size_t width = leaves; width > 1; width = MERKLE_PARENTS(width)) {
+        hashParents(level, width, first, last);
+        level += width * _hashSize;
+        first >>= 1;
+        last >>= 1;
+    }
+}
+
+/**
+ * \internal
+ * \brief Recomputes the parents of a range of nodes in one level.
+ *
+ * \param level Points to the first node in the level.
+ * \param width The number of nodes in the level.
+ * \param first The index of the first node that changed.
+ * \param last The index of the last node that changed.
+ *
+ * The parents are stored just after the end of the level.  The two
+ * children of a parent are adjacent, so they are hashed in place.  The
+ * engine is only worth using if there is more than one parent to hash.
+ */
+void MerkleTree::hashParents(uint8_t *level, size_t width, size_t first,
+                             size_t last)
+{
+    uint8_t *parents = level + width * _hashSize;
+    size_t pair = 2 * _hashSize;
+    size_t index = first >> 1;
+    uint8_t prefix = MERKLE_NODE_PREFIX;
+    if (engine && index < (last >> 1)) {
+        MerkleBatch batch(engine);
+        for (; index <= (last >> 1); ++index) {
+            uint8_t *child = level + index * pair;
+            uint8_t *out = parents + index * _hashSize;
+            if ((index * 2 + 1) < width)
+                batch.add(out, prefix, child, pair);
+            else
+                memcpy(out, child, _hashSize);
+        }
+        batch.flush();
+    } else {
+        for (; index <= (last >> 1); ++index) {
+            uint8_t *child = level + index * pair;
+            uint8_t *out = parents + index * _hashSize;
+            if ((index * 2 + 1) < width) {
+                hash->reset();
+                hash->update(&prefix, 1);
+                hash->update(child, pair);
+                hash->finalize(out, _hashSize);
+            } else {
+                memcpy(out, child, _hashSize);
+            }
+        }
+    }
+}
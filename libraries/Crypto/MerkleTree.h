@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_MERKLETREE_h
+#define CRYPTO_MERKLETREE_h
+
+#include "Hash.h"
+
+class SHA256MultiCommon;
+
+class MerkleTree
+{
+public:
+    MerkleTree(Hash &hash, void *nodes, size_t size);
+    ~MerkleTree();
+
+    static size_t storageSize(size_t hashSize, size_t leafCount);
+
+    size_t hashSize() const { return _hashSize; }
+
+    bool setLeafCount(size_t count);
+    size_t leafCount() const { return leaves; }
+
+    void setEngine(SHA256MultiCommon *engine) { this->engine = engine; }
+
+    void setLeaf(size_t index, const void *data, size_t len);
+    void setLeaves(size_t first, size_t count, const void * const data[],
+                   const size_t lens[]);
+
+    const uint8_t *leafHash(size_t index) const;
+    const uint8_t *root() const;
+
+    size_t proofSize(size_t index) const;
+    size_t proof(size_t index, uint8_t *proof, size_t len) const;
+    static bool verify(Hash &hash, const uint8_t *root, size_t leafCount,
+                       size_t index, const void *data, size_t len,
+                       const uint8_t *proof, size_t proofLen);
+
+    void clear();
+
+private:
+    Hash *hash;
+    SHA256MultiCommon *engine;
+    uint8_t *nodes;
+    size_t size;
+    size_t leaves;
+    size_t _hashSize;
+
+    void hashLeaf(uint8_t *out, const void *data, size_t len);
+    void hashLeaves(size_t first, size_t count, const void * const data[],
+                    const size_t lens[]);
+    void update(size_t first, size_t last);
+    void hashParents(uint8_t *level, size_t width, size_t first,
+                     size_t last);
+
+    // Disable copy constructor and operator=().
+    MerkleTree(const MerkleTree &) {}
+    MerkleTree &operator=(const MerkleTree &) { return *this; }
+};
+
+#endif
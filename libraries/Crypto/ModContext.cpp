@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ModContext.h"
+#include "Crypto.h"
+#include "utility/LimbUtil.h"
+#include "utility/ConstantTimeUtil.h"
+#include <string.h>
+
+/**
+ * \class ModContext ModContext.h <ModContext.h>
+ * \brief Montgomery arithmetic modulo an arbitrary odd modulus.
+ *
+ * ModContext precomputes the constants that are needed to perform
+ * Montgomery multiplication modulo \em n, where \em n is any odd number
+ * of up to MODCONTEXT_MAX_BITS bits.  Once the modulus has been set with
+ * setModulus(), the same context can be used for any number of modular
+ * multiplications and exponentiations, which is useful for algorithms
+ * like RSA, Diffie-Hellman over prime fields, and field arithmetic for
+ * elliptic curves that do not have a specialized reduction routine.
+ *
+ * All values are limb arrays of size() words, ordered from the least
+ * significant word to the most significant as with BigNumberUtil.
+ * The modMul() and modSquare() functions operate on values in Montgomery
+ * form; use toMont() and fromMont() to convert to and from the regular
+ * representation.  modExp() takes and returns regular values.
+ *
+ * \code
+ * ModContext ctx;
+ * ctx.setModulus(n, NUM_LIMBS);
+ * ctx.modExp(c, m, e, NUM_LIMBS);     // c = m^e mod n
+ * \endcode
+ *
+ * The execution time of the arithmetic operations depends upon the
+ * size of the modulus and the exponent but not upon their values or the
+ * values of the other operands.
+ *
+ * \sa BigNumberUtil
+ */
+
+/**
+ * \brief Constructs a new modular arithmetic context with no modulus set.
+ *
+ * \sa setModulus()
+ */
+ModContext::ModContext()
+    : ninv(0)
+    , count(0)
+{
+}
+
+/**
+ * \brief Destroys this modular arithmetic context.
+ */
+ModContext::~ModContext()
+{
+    clean(n);
+    clean(rr);
+}
+
+/**
+ * \brief Sets the modulus for this context and precomputes the
+ * Montgomery constants.
+ *
+ * \param modulus Points to the modulus, which must be odd and greater than 1.
+ * \param count The number of limbs in \a modulus.
+ * \return Returns false if the modulus is even, is 1, or is larger than
+ * MODCONTEXT_MAX_BITS; true otherwise.
+ *
+ * The running time of this function depends upon the value of the
+ * modulus, which is normally a public value.
+ *
+ * \sa size()
+ */
+bool ModContext::setModulus(const limb_t *modulus, size_t count)
+{
+    limb_t t[MODCONTEXT_MAX_LIMBS];
+    limb_t inv;
+    size_t bits;
+
+    // Validate the modulus.
+    if (count == 0 || count > MODCONTEXT_MAX_LIMBS || !(modulus[0] & 1))
+        return false;
+    if (count == 1 && modulus[0] == 1)
+        return false;
+    memcpy(n, modulus, count * sizeof(limb_t));
+    this->count = count;
+
+    // Compute -(n^-1) mod 2^LIMB_BITS using Newton's method.  The initial
+    // value is correct to 3 bits and each step doubles the number of bits.
+    inv = n[0];
+    for (bits = 3; bits < LIMB_BITS; bits *= 2)
+        inv *= (limb_t)(2 - n[0] * inv);
+    ninv = (limb_t)(0 - inv);
+
+    // Compute R^2 mod n where R = 2^(count * LIMB_BITS) by starting
+    // at 1 and repeatedly doubling modulo n.
+    memset(rr, 0, count * sizeof(limb_t));
+    rr[0] = 1;
+    for (bits = 0; bits < 2 * count * LIMB_BITS; ++bits) {
+        limb_t carry = BigNumberUtil::add(rr, rr, rr, count);
+        limb_t borrow = BigNumberUtil::sub(t, rr, n, count);
+        if (carry || !borrow)
+            memcpy(rr, t, count * sizeof(limb_t));
+    }
+    clean(t);
+    return true;
+}
+
+/**
+ * \fn size_t ModContext::size() const
+ * \brief Returns the number of limbs in the modulus, or zero if the
+ * modulus has not been set yet.
+ *
+ * All values that are passed to or returned from the other functions
+ * in this class are limb arrays of this size.
+ */
+
+/**
+ * \brief Conditionally swaps two values if a selection value is non-zero.
+ *
+ * \param select Non-zero to swap \a x and \a y, zero to leave them unchanged.
+ * \param x The first value to conditionally swap.
+ * \param y The second value to conditionally swap.
+ * \param size The number of limbs in \a x and \a y.
+ */
+static void cswap(limb_t select, limb_t *x, limb_t *y, size_t size)
+{
+    ctSwap(select, x, y, size);
+}
+
+/**
+ * \brief Converts a value into Montgomery form.
+ *
+ * \param result The result, x * R mod n.
+ * \param x The value to convert, which may be any value of size() limbs.
+ *
+ * The \a result and \a x arrays may overlap.
+ *
+ * \sa fromMont()
+ */
+void ModContext::toMont(limb_t *result, const limb_t *x) const
+{
+    modMul(result, x, rr);
+}
+
+/**
+ * \brief Converts a value out of Montgomery form.
+ *
+ * \param result The result, x * R^-1 mod n.
+ * \param x The value to convert, which may be any value of size() limbs.
+ *
+ * The \a result and \a x arrays may overlap.
+ *
+ * \sa toMont()
+ */
+void ModContext::fromMont(limb_t *result, const limb_t *x) const
+{
+    limb_t one[MODCONTEXT_MAX_LIMBS];
+    memset(one, 0, count * sizeof(limb_t));
+    one[0] = 1;
+    modMul(result, x, one);
+}
+
+/**
+ * \brief Multiplies two values in Montgomery form.
+ *
+ * \param result The result, x * y * R^-1 mod n.
+ * \param x The first value to multiply, which must be less than R.
+ * \param y The second value to multiply, which must be less than n.
+ *
+ * The \a result array may overlap with \a x or \a y.  If both \a x and
+ * \a y are in Montgomery form, then so is the result.
+ *
+ * \sa modSquare(), toMont()
+ */
+void ModContext::modMul(limb_t *result, const limb_t *x, const limb_t *y) const
+{
+    limb_t t[MODCONTEXT_MAX_LIMBS + 2];
+    dlimb_t carry;
+    limb_t word, m;
+    limb_t borrow;
+    size_t i, j;
+
+    // Interleave the multiplication and reduction steps (this is the
+    // "CIOS" method) so that the temporary value is only count + 2 limbs.
+    memset(t, 0, (count + 2) * sizeof(limb_t));
+    for (i = 0; i < count; ++i) {
+        // t += x * y[i]
+        word = y[i];
+        carry = 0;
+        for (j = 0; j < count; ++j) {
+            carry += ((dlimb_t)(x[j])) * word + t[j];
+            t[j] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        carry += t[count];
+        t[count] = (limb_t)carry;
+        t[count + 1] = (limb_t)(carry >> LIMB_BITS);
+
+        // t = (t + m * n) / 2^LIMB_BITS where m is chosen so that
+        // the lowest limb of t + m * n is zero.
+        m = (limb_t)(t[0] * ninv);
+        carry = ((dlimb_t)m) * n[0] + t[0];
+        carry >>= LIMB_BITS;
+        for (j = 1; j < count; ++j) {
+            carry += ((dlimb_t)m) * n[j] + t[j];
+            t[j - 1] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        carry += t[count];
+        t[count - 1] = (limb_t)carry;
+        t[count] = t[count + 1] + (limb_t)(carry >> LIMB_BITS);
+    }
+
+    // The value in t is less than 2 * n, so subtract n once if t >= n.
+    // The subtraction is always performed to keep the timing constant.
+    borrow = BigNumberUtil::sub(result, t, n, count);
+    cswap(borrow & ~t[count] & 1, result, t, count);
+    clean(t, (count + 2) * sizeof(limb_t));
+}
+
+/**
+ * \brief Squares a value in Montgomery form.
+ *
+ * \param result The result, x * x * R^-1 mod n.
+ * \param x The value to square, which must be less than n.
+ *
+ * The \a result array may overlap with \a x.
+ *
+ * \sa modMul()
+ */
+void ModContext::modSquare(limb_t *result, const limb_t *x) const
+{
+    modMul(result, x, x);
+}
+
+/**
+ * \brief Raises a value to a power modulo n.
+ *
+ * \param result The result, x^e mod n, in regular form.
+ * \param x The value to raise to a power in regular form, which may be
+ * any value of size() limbs.
+ * \param e Points to the exponent.
+ * \param ecount The number of limbs in \a e.
+ *
+ * This function uses a Montgomery ladder so that the same sequence of
+ * operations is performed for every exponent of \a ecount limbs.
+ * The \a result array may overlap with \a x but not with \a e.
+ */
+void ModContext::modExp(limb_t *result, const limb_t *x,
+                        const limb_t *e, size_t ecount) const
+{
+    limb_t r0[MODCONTEXT_MAX_LIMBS];
+    limb_t r1[MODCONTEXT_MAX_LIMBS];
+    limb_t swap = 0;
+    limb_t bit;
+    size_t i;
+
+    // Start the ladder with r0 = 1 and r1 = x in Montgomery form.
+    fromMont(r0, rr);
+    toMont(r1, x);
+
+    // Process the exponent bits from the most significant down.
+    // The invariant at each step is r1 = r0 * x.
+    i = ecount * LIMB_BITS;
+    while (i > 0) {
+        --i;
+        bit = (e[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1;
+        swap ^= bit;
+        cswap(swap, r0, r1, count);
+        swap = bit;
+        modMul(r1, r0, r1);
+        modSquare(r0, r0);
+    }
+    cswap(swap, r0, r1, count);
+
+    // Convert the result back into regular form.
+    fromMont(result, r0);
+    clean(r0, count * sizeof(limb_t));
+    clean(r1, count * sizeof(limb_t));
+}
+
+/**
+ * \brief Clears the modulus and all precomputed values from this context.
+ *
+ * \sa setModulus()
+ */
+void ModContext::clear()
+{
+    clean(n);
+    clean(rr);
+    ninv = 0;
+    count = 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_MODCONTEXT_h
+#define CRYPTO_MODCONTEXT_h
+
+#include "BigNumberUtil.h"
+#include <stddef.h>
+
+// Largest modulus in bits that a ModContext can hold.  Each context
+// stores two values of this size and modExp() needs three more on the stack.
+#if !defined(MODCONTEXT_MAX_BITS)
+#if defined(__AVR__)
+#define MODCONTEXT_MAX_BITS 512
+#else
+#define MODCONTEXT_MAX_BITS 4096
+#endif
+#endif
+#define MODCONTEXT_MAX_LIMBS \
+    ((MODCONTEXT_MAX_BITS + 8 * sizeof(limb_t) - 1) / (8 * sizeof(limb_t)))
+
+class ModContext
+{
+public:
+    ModContext();
+    ~ModContext();
+
+    bool setModulus(const limb_t *modulus, size_t count);
+    size_t size() const { return count; }
+
+    void toMont(limb_t *result, const limb_t *x) const;
+    void fromMont(limb_t *result, const limb_t *x) const;
+
+    void modMul(limb_t *result, const limb_t *x, const limb_t *y) const;
+    void modSquare(limb_t *result, const limb_t *x) const;
+    void modExp(limb_t *result, const limb_t *x,
+                const limb_t *e, size_t ecount) const;
+
+    void clear();
+
+private:
+    limb_t n[MODCONTEXT_MAX_LIMBS];
+    limb_t rr[MODCONTEXT_MAX_LIMBS];
+    limb_t ninv;
+    size_t count;
+};
+
+#endif
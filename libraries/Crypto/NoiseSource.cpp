@@ -27,14 +27,31 @@
  * \class NoiseSource NoiseSource.h <NoiseSource.h>
  * \brief Abstract base class for random noise sources.
  *
+ * Noise sources keep counters of the number of raw samples they have
+ * taken, the number of bits of entropy they have credited to the pool,
+ * and the number of times that their raw samples have failed the
+ * continuous health tests.  Applications can use these to measure the
+ * throughput of a source and to detect when it degrades.
+ *
  * \sa \link RNGClass RNG\endlink, TransistorNoiseSource
  */
 
+// Number of samples in each window of the adaptive proportion test.
+#define NOISE_APT_WINDOW    1024
+
 /**
  * \brief Constructs a new random noise source.
+ *
+ * The health test cutoffs default to those for one-bit raw samples with
+ * a min-entropy of 0.5 bits per sample.
+ *
+ * \sa setHealthCutoffs()
  */
 NoiseSource::NoiseSource()
+    : rctCutoff(41)
+    , aptCutoff(793)
 {
+    resetCounters();
 }
 
 /**
@@ -97,6 +114,58 @@ void NoiseSource::added()
     // Nothing to do here.
 }
 
+/**
+ * \fn unsigned long NoiseSource::sampleCount() const
+ * \brief Returns the number of raw samples that have been passed to
+ * healthTest() since the last call to resetCounters().
+ *
+ * \sa creditedBits()
+ */
+
+/**
+ * \fn unsigned long NoiseSource::creditedBits() const
+ * \brief Returns the number of bits of entropy that have been credited to
+ * the global random number pool since the last call to resetCounters().
+ *
+ * Dividing this by the elapsed time gives the rate at which the noise
+ * source is contributing entropy.
+ *
+ * \sa sampleCount()
+ */
+
+/**
+ * \fn unsigned int NoiseSource::repetitionFailures() const
+ * \brief Returns the number of times that the raw samples have failed
+ * the repetition count test since the last call to resetCounters().
+ *
+ * \sa proportionFailures(), healthTest()
+ */
+
+/**
+ * \fn unsigned int NoiseSource::proportionFailures() const
+ * \brief Returns the number of times that the raw samples have failed
+ * the adaptive proportion test since the last call to resetCounters().
+ *
+ * \sa repetitionFailures(), healthTest()
+ */
+
+/**
+ * \brief Resets the sample, entropy, and health test failure counters,
+ * and restarts the health tests.
+ */
+void NoiseSource::resetCounters()
+{
+    samples = 0;
+    credited = 0;
+    rctFailures = 0;
+    aptFailures = 0;
+    rctCount = 0;
+    aptCount = 0;
+    aptPosn = 0;
+    rctSample = 0;
+    aptSample = 0;
+}
+
 /**
  * \brief Called from subclasses to output noise to the global random
  * number pool.
@@ -116,5 +185,76 @@ void NoiseSource::added()
  */
 void NoiseSource::output(const uint8_t *data, size_t len, unsigned int credit)
 {
+    credited += credit;
     RNG.stir(data, len, credit);
 }
+
+/**
+ * \brief Runs the continuous health tests on a raw sample.
+ *
+ * \param sample The raw sample from the noise source.
+ * \return Returns false if the sample caused a health test to fail.
+ *
+ * Subclasses should call this for every raw sample, before debiasing,
+ * and discard the data that they have collected so far if it fails.
+ * The tests are the repetition count test and the adaptive proportion
+ * test from NIST SP 800-90B, section 4.4.  The repetition count test
+ * fails if the same sample is seen too many times in a row.  The adaptive
+ * proportion test fails if the first sample in a window of 1024 samples
+ * occurs too many times within that window.
+ *
+ * \sa setHealthCutoffs(), repetitionFailures(), proportionFailures()
+ */
+bool NoiseSource::healthTest(uint8_t sample)
+{
+    bool ok = true;
+    ++samples;
+
+    // Repetition count test.
+    if (rctCount && sample == rctSample) {
+        if (++rctCount >= rctCutoff) {
+            ++rctFailures;
+            rctCount = 1;
+            ok = false;
+        }
+    } else {
+        rctSample = sample;
+        rctCount = 1;
+    }
+
+    // Adaptive proportion test.
+    if (!aptPosn) {
+        aptSample = sample;
+        aptCount = 1;
+    } else if (sample == aptSample) {
+        if (++aptCount == aptCutoff) {
+            ++aptFailures;
+            ok = false;
+        }
+    }
+    if (++aptPosn >= NOISE_APT_WINDOW)
+        aptPosn = 0;
+    return ok;
+}
+
+/**
+ * \brief Sets the cutoff values for the continuous health tests.
+ *
+ * \param repetition The number of identical samples in a row that will
+ * cause the repetition count test to fail.
+ * \param proportion The number of times that the first sample in a
+ * window of 1024 samples must occur within the window to cause the
+ * adaptive proportion test to fail.
+ *
+ * The cutoffs depend upon the min-entropy H that is claimed for each raw
+ * sample.  For a false positive rate of 2^-20, the repetition cutoff is
+ * 1 + ceil(20 / H).  For one-bit samples, the proportion cutoff is 589,
+ * 793, 915, or 979 for H of 1, 0.5, 0.25, and 0.125 respectively.
+ *
+ * \sa healthTest()
+ */
+void NoiseSource::setHealthCutoffs(uint16_t repetition, uint16_t proportion)
+{
+    rctCutoff = repetition;
+    aptCutoff = proportion;
+}
@@ -37,8 +37,30 @@ public:
 
     virtual void added();
 
+    unsigned long sampleCount() const { return samples; }
+    unsigned long creditedBits() const { return credited; }
+    unsigned int repetitionFailures() const { return rctFailures; }
+    unsigned int proportionFailures() const { return aptFailures; }
+    void resetCounters();
+
 protected:
     virtual void output(const uint8_t *data, size_t len, unsigned int credit);
+
+    bool healthTest(uint8_t sample);
+    void setHealthCutoffs(uint16_t repetition, uint16_t proportion);
+
+private:
+    unsigned long samples;
+    unsigned long credited;
+    uint16_t rctFailures;
+    uint16_t aptFailures;
+    uint16_t rctCutoff;
+    uint16_t rctCount;
+    uint16_t aptCutoff;
+    uint16_t aptCount;
+    uint16_t aptPosn;
+    uint8_t rctSample;
+    uint8_t aptSample;
 };
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "OFB.h"
 #include "Crypto.h"
+#include "utility/XorUtil.h"
 #include <string.h>
 
 /**
@@ -98,10 +99,10 @@ void OFBCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
         if (size > len)
             size = len;
         len -= size;
-        while (size > 0) {
-            *output++ = *input++ ^ iv[posn++];
-            --size;
-        }
+        xorBytes(output, input, iv + posn, size);
+        output += size;
+        input += size;
+        posn += size;
     }
 }
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "POLYVAL.h"
+#include "Crypto.h"
+#include "utility/ConstantTimeUtil.h"
+#include <string.h>
+
+/**
+ * \class POLYVAL POLYVAL.h <POLYVAL.h>
+ * \brief Implementation of the POLYVAL message authenticator.
+ *
+ * POLYVAL is the universal hash function that is used by AES-GCM-SIV.
+ * It is the same construction as GHASH, but with the order of the bits
+ * reversed.  This class computes POLYVAL with the GHASH class, using the
+ * identity from Appendix A of RFC 8452:
+ *
+ * POLYVAL(H, X_1, ..., X_n) = ByteReverse(GHASH(mulX_GHASH(ByteReverse(H)),
+ * ByteReverse(X_1), ..., ByteReverse(X_n)))
+ *
+ * GHASH's faster table-driven implementation is therefore also used for
+ * POLYVAL on platforms that have it.
+ *
+ * Reference: <a href="https://tools.ietf.org/html/rfc8452">RFC 8452</a>
+ *
+ * \sa GHASH, GCMSIV
+ */
+
+/**
+ * \brief Constructs a new POLYVAL message authenticator.
+ */
+POLYVAL::POLYVAL()
+    : posn(0)
+{
+}
+
+/**
+ * \brief Destroys this POLYVAL message authenticator.
+ */
+POLYVAL::~POLYVAL()
+{
+    clean(block);
+}
+
+/**
+ * \brief Reverses the order of the bytes in a 16-byte block.
+ *
+ * \param output The output block.
+ * \param input The input block, which must not overlap with \a output.
+ */
+static inline void reverseBlock(uint8_t *output, const uint8_t *input)
+{
+    for (uint8_t index = 0; index < 16; ++index)
+        output[index] = input[15 - index];
+}
+
+/**
+ * \brief Resets the POLYVAL message authenticator for a new session.
+ *
+ * \param key Points to the 16 byte authentication key.
+ *
+ * \sa update(), finalize()
+ */
+void POLYVAL::reset(const void *key)
+{
+    // Reverse the key and then multiply it by x in the GHASH field,
+    // which is a right shift of the big endian value with reduction.
+    uint8_t H[16];
+    reverseBlock(H, (const uint8_t *)key);
+    uint8_t mask = ctMask((uint8_t)(H[15] & 0x01)) & 0xE1;
+    for (uint8_t index = 15; index > 0; --index)
+        H[index] = (H[index] >> 1) | (H[index - 1] << 7);
+    H[0] = (H[0] >> 1) ^ mask;
+    ghash.reset(H);
+    clean(H);
+    posn = 0;
+}
+
+/**
+ * \brief Updates the message authenticator with more data.
+ *
+ * \param data Data to be hashed.
+ * \param len Number of bytes of data to be hashed.
+ *
+ * If finalize() has already been called, then the behavior of update() will
+ * be undefined.  Call reset() first to start a new authentication process.
+ *
+ * \sa pad(), reset(), finalize()
+ */
+void POLYVAL::update(const void *data, size_t len)
+{
+    const uint8_t *d = (const uint8_t *)data;
+    if (posn == 0) {
+        // Reverse whole blocks straight from the input.
+        while (len >= 16) {
+            reverseBlock(block, d);
+            ghash.update(block, 16);
+            d += 16;
+            len -= 16;
+        }
+    }
+    while (len > 0) {
+        uint8_t size = 16 - posn;
+        if (size > len)
+            size = len;
+        memcpy(block + posn, d, size);
+        posn += size;
+        len -= size;
+        d += size;
+        if (posn == 16)
+            processChunk();
+    }
+}
+
+/**
+ * \brief Finalizes the authentication process and returns the token.
+ *
+ * \param token The buffer to return the token value in.
+ * \param len The length of the \a token buffer between 0 and 16.
+ *
+ * If \a len is less than 16, then the token value will be truncated to
+ * the first \a len bytes.  If \a len is greater than 16, then the remaining
+ * bytes will left unchanged.
+ *
+ * If finalize() is called again, then the returned \a token value is
+ * undefined.  Call reset() first to start a new authentication process.
+ *
+ * \sa reset(), update()
+ */
+void POLYVAL::finalize(void *token, size_t len)
+{
+    uint8_t temp[16];
+    pad();
+    ghash.finalize(temp, 16);
+    reverseBlock(block, temp);
+    if (len > 16)
+        len = 16;
+    memcpy(token, block, len);
+    clean(temp);
+}
+
+/**
+ * \brief Pads the input stream with zero bytes to a multiple of 16.
+ *
+ * \sa update()
+ */
+void POLYVAL::pad()
+{
+    if (posn != 0) {
+        memset(block + posn, 0, 16 - posn);
+        processChunk();
+    }
+}
+
+/**
+ * \brief Clears the authenticator's state, removing all sensitive data.
+ */
+void POLYVAL::clear()
+{
+    ghash.clear();
+    clean(block);
+    posn = 0;
+}
+
+/**
+ * \brief Passes the buffered block to GHASH in reversed byte order.
+ */
+void POLYVAL::processChunk()
+{
+    uint8_t temp[16];
+    reverseBlock(temp, block);
+    ghash.update(temp, 16);
+    clean(temp);
+    posn = 0;
+}
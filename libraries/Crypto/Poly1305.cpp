@@ -22,6 +22,7 @@
 
 #include "Poly1305.h"
 #include "Crypto.h"
+#include "utility/ConstantTimeUtil.h"
 #include "utility/EndianUtil.h"
 #include "utility/LimbUtil.h"
 #include <string.h>
@@ -55,10 +56,284 @@
  * caller to encrypt the nonce which gives the caller more flexibility as
  * to how to derive and/or encrypt the nonce.
  *
+ * On 32-bit and 64-bit platforms the accumulator is stored in unsaturated
+ * radix-2<sup>26</sup> or radix-2<sup>44</sup> limbs and r<sup>2</sup> is
+ * precomputed by reset() so that update() can absorb two chunks per
+ * carry chain.  AVR platforms use the generic limb_t implementation.
+ * The choice can be overridden by defining CRYPTO_POLY1305_UNSATURATED
+ * to 0 or 1.
+ *
  * References: http://en.wikipedia.org/wiki/Poly1305-AES,
  * http://cr.yp.to/mac.html
  */
 
+#if CRYPTO_POLY1305_UNSATURATED
+
+// The unsaturated implementations keep the limbs smaller than the word
+// size so that the products of two blocks can be summed before carrying.
+// The (2^130 - 5) reduction is folded into the multiplication by scaling
+// the limbs of r that wrap around past 2^130 by 5.  Multiplying by r^2
+// and r together lets two blocks be absorbed per carry chain:
+//
+//      h = ((h + m1) * r^2 + m2 * r) mod (2^130 - 5)
+
+#if CRYPTO_POLY1305_RADIX44
+
+typedef unsigned __int128 poly1305_wide_t;
+
+#define POLY1305_MASK44     0xFFFFFFFFFFFULL
+#define POLY1305_MASK42     0x3FFFFFFFFFFULL
+
+// Unpacks a 16-byte chunk into three radix-2^44 limbs, with "hibit" added
+// at bit position 2^128.
+static inline void unpackChunk(uint64_t m[3], const uint8_t *chunk,
+                               uint64_t hibit)
+{
+    uint64_t t0, t1;
+    memcpy(&t0, chunk, 8);
+    memcpy(&t1, chunk + 8, 8);
+    t0 = le64toh(t0);
+    t1 = le64toh(t1);
+    m[0] = t0 & POLY1305_MASK44;
+    m[1] = ((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44;
+    m[2] = (t1 >> 24) | (hibit << 40);
+}
+
+// Accumulates a * r into d.  Limbs of "a" are at most 45 bits and limbs
+// of "r" are at most 45 bits, so each product is less than 2^95 and the
+// sum of the products for two blocks is less than 2^98.
+static inline void mulAdd(poly1305_wide_t d[3], const uint64_t a[3],
+                          const uint64_t r[3])
+{
+    // Terms that land at 2^132 and above wrap around with a factor of
+    // 4 * 5 = 20 because the top limb is only 42 bits in size.
+    uint64_t s1 = r[1] * 20;
+    uint64_t s2 = r[2] * 20;
+    d[0] += ((poly1305_wide_t)a[0]) * r[0] +
+            ((poly1305_wide_t)a[1]) * s2 +
+            ((poly1305_wide_t)a[2]) * s1;
+    d[1] += ((poly1305_wide_t)a[0]) * r[1] +
+            ((poly1305_wide_t)a[1]) * r[0] +
+            ((poly1305_wide_t)a[2]) * s2;
+    d[2] += ((poly1305_wide_t)a[0]) * r[2] +
+            ((poly1305_wide_t)a[1]) * r[1] +
+            ((poly1305_wide_t)a[2]) * r[0];
+}
+
+// Carries the products in d down into h.  The result is partially reduced;
+// h[1] may be slightly larger than 44 bits.
+static inline void carryReduce(uint64_t h[3], poly1305_wide_t d[3])
+{
+    uint64_t c;
+    c = (uint64_t)(d[0] >> 44);
+    h[0] = ((uint64_t)d[0]) & POLY1305_MASK44;
+    d[1] += c;
+    c = (uint64_t)(d[1] >> 44);
+    h[1] = ((uint64_t)d[1]) & POLY1305_MASK44;
+    d[2] += c;
+    c = (uint64_t)(d[2] >> 42);
+    h[2] = ((uint64_t)d[2]) & POLY1305_MASK42;
+    h[0] += c * 5;
+    c = h[0] >> 44;
+    h[0] &= POLY1305_MASK44;
+    h[1] += c;
+}
+
+// Fully reduces h, adds the nonce, and writes the 16-byte result to "out".
+static void reduceFinal(uint8_t *out, uint64_t h[3], const uint8_t *nonce)
+{
+    uint64_t c, g0, g1, g2, mask, nmask, n0, n1;
+
+    // Propagate the remaining carries.  h is now less than 2^130 plus
+    // a small amount so at most one subtraction of (2^130 - 5) is needed.
+    c = h[1] >> 44;
+    h[1] &= POLY1305_MASK44;
+    h[2] += c;
+    c = h[2] >> 42;
+    h[2] &= POLY1305_MASK42;
+    h[0] += c * 5;
+    c = h[0] >> 44;
+    h[0] &= POLY1305_MASK44;
+    h[1] += c;
+
+    // Compute g = h + 5 - 2^130 and select g if there was no borrow.
+    g0 = h[0] + 5;
+    c = g0 >> 44;
+    g0 &= POLY1305_MASK44;
+    g1 = h[1] + c;
+    c = g1 >> 44;
+    g1 &= POLY1305_MASK44;
+    g2 = h[2] + c - (((uint64_t)1) << 42);
+    mask = ctMask((g2 >> 63) ^ 1);
+    nmask = ~mask;
+    h[0] = (h[0] & nmask) | (g0 & mask);
+    h[1] = (h[1] & nmask) | (g1 & mask);
+    h[2] = (h[2] & nmask) | (g2 & mask);
+
+    // Convert back into 128 bits and add the nonce.
+    memcpy(&n0, nonce, 8);
+    memcpy(&n1, nonce + 8, 8);
+    g0 = h[0] | (h[1] << 44);
+    g1 = (h[1] >> 20) | (h[2] << 24);
+    g0 += le64toh(n0);
+    c = (g0 < le64toh(n0));
+    g1 += le64toh(n1) + c;
+    g0 = htole64(g0);
+    g1 = htole64(g1);
+    memcpy(out, &g0, 8);
+    memcpy(out + 8, &g1, 8);
+}
+
+#else // !CRYPTO_POLY1305_RADIX44
+
+#define POLY1305_MASK26     0x3FFFFFFUL
+
+// Unpacks a 16-byte chunk into five radix-2^26 limbs, with "hibit" added
+// at bit position 2^128.
+static inline void unpackChunk(uint32_t m[5], const uint8_t *chunk,
+                               uint32_t hibit)
+{
+    uint32_t t0, t1, t2, t3;
+    memcpy(&t0, chunk, 4);
+    memcpy(&t1, chunk + 4, 4);
+    memcpy(&t2, chunk + 8, 4);
+    memcpy(&t3, chunk + 12, 4);
+    t0 = le32toh(t0);
+    t1 = le32toh(t1);
+    t2 = le32toh(t2);
+    t3 = le32toh(t3);
+    m[0] = t0 & POLY1305_MASK26;
+    m[1] = ((t0 >> 26) | (t1 << 6)) & POLY1305_MASK26;
+    m[2] = ((t1 >> 20) | (t2 << 12)) & POLY1305_MASK26;
+    m[3] = ((t2 >> 14) | (t3 << 18)) & POLY1305_MASK26;
+    m[4] = (t3 >> 8) | (hibit << 24);
+}
+
+// Accumulates a * r into d.  Limbs of "a" are at most 27 bits and the
+// scaled limbs of "r" are at most 29 bits, so each product is less than
+// 2^56 and the sum of the products for two blocks is less than 2^60.
+static inline void mulAdd(uint64_t d[5], const uint32_t a[5],
+                          const uint32_t r[5])
+{
+    uint32_t s1 = r[1] * 5;
+    uint32_t s2 = r[2] * 5;
+    uint32_t s3 = r[3] * 5;
+    uint32_t s4 = r[4] * 5;
+    d[0] += ((uint64_t)a[0]) * r[0] + ((uint64_t)a[1]) * s4 +
+            ((uint64_t)a[2]) * s3 + ((uint64_t)a[3]) * s2 +
+            ((uint64_t)a[4]) * s1;
+    d[1] += ((uint64_t)a[0]) * r[1] + ((uint64_t)a[1]) * r[0] +
+            ((uint64_t)a[2]) * s4 + ((uint64_t)a[3]) * s3 +
+            ((uint64_t)a[4]) * s2;
+    d[2] += ((uint64_t)a[0]) * r[2] + ((uint64_t)a[1]) * r[1] +
+            ((uint64_t)a[2]) * r[0] + ((uint64_t)a[3]) * s4 +
+            ((uint64_t)a[4]) * s3;
+    d[3] += ((uint64_t)a[0]) * r[3] + ((uint64_t)a[1]) * r[2] +
+            ((uint64_t)a[2]) * r[1] + ((uint64_t)a[3]) * r[0] +
+            ((uint64_t)a[4]) * s4;
+    d[4] += ((uint64_t)a[0]) * r[4] + ((uint64_t)a[1]) * r[3] +
+            ((uint64_t)a[2]) * r[2] + ((uint64_t)a[3]) * r[1] +
+            ((uint64_t)a[4]) * r[0];
+}
+
+// Carries the products in d down into h.  The result is partially reduced;
+// h[1] may be slightly larger than 26 bits.
+static inline void carryReduce(uint32_t h[5], uint64_t d[5])
+{
+    uint64_t c;
+    c = d[0] >> 26;
+    h[0] = ((uint32_t)d[0]) & POLY1305_MASK26;
+    d[1] += c;
+    c = d[1] >> 26;
+    h[1] = ((uint32_t)d[1]) & POLY1305_MASK26;
+    d[2] += c;
+    c = d[2] >> 26;
+    h[2] = ((uint32_t)d[2]) & POLY1305_MASK26;
+    d[3] += c;
+    c = d[3] >> 26;
+    h[3] = ((uint32_t)d[3]) & POLY1305_MASK26;
+    d[4] += c;
+    c = d[4] >> 26;
+    h[4] = ((uint32_t)d[4]) & POLY1305_MASK26;
+
+    // The final carry can be more than 32 bits once multiplied by 5
+    // when two blocks were absorbed, so wrap it around in 64 bits.
+    c = h[0] + c * 5;
+    h[0] = ((uint32_t)c) & POLY1305_MASK26;
+    h[1] += (uint32_t)(c >> 26);
+}
+
+// Fully reduces h, adds the nonce, and writes the 16-byte result to "out".
+static void reduceFinal(uint8_t *out, uint32_t h[5], const uint8_t *nonce)
+{
+    uint32_t c, g0, g1, g2, g3, g4, mask, nmask;
+    uint32_t n[4];
+    uint64_t carry;
+    uint8_t i;
+
+    // Propagate the remaining carries.  h is now less than 2^130 plus
+    // a small amount so at most one subtraction of (2^130 - 5) is needed.
+    c = h[1] >> 26;
+    h[1] &= POLY1305_MASK26;
+    h[2] += c;
+    c = h[2] >> 26;
+    h[2] &= POLY1305_MASK26;
+    h[3] += c;
+    c = h[3] >> 26;
+    h[3] &= POLY1305_MASK26;
+    h[4] += c;
+    c = h[4] >> 26;
+    h[4] &= POLY1305_MASK26;
+    h[0] += c * 5;
+    c = h[0] >> 26;
+    h[0] &= POLY1305_MASK26;
+    h[1] += c;
+
+    // Compute g = h + 5 - 2^130 and select g if there was no borrow.
+    g0 = h[0] + 5;
+    c = g0 >> 26;
+    g0 &= POLY1305_MASK26;
+    g1 = h[1] + c;
+    c = g1 >> 26;
+    g1 &= POLY1305_MASK26;
+    g2 = h[2] + c;
+    c = g2 >> 26;
+    g2 &= POLY1305_MASK26;
+    g3 = h[3] + c;
+    c = g3 >> 26;
+    g3 &= POLY1305_MASK26;
+    g4 = h[4] + c - (((uint32_t)1) << 26);
+    mask = ctMask((g4 >> 31) ^ 1);
+    nmask = ~mask;
+    h[0] = (h[0] & nmask) | (g0 & mask);
+    h[1] = (h[1] & nmask) | (g1 & mask);
+    h[2] = (h[2] & nmask) | (g2 & mask);
+    h[3] = (h[3] & nmask) | (g3 & mask);
+    h[4] = (h[4] & nmask) | (g4 & mask);
+
+    // Convert back into 128 bits and add the nonce.
+    g0 = h[0] | (h[1] << 26);
+    g1 = (h[1] >> 6) | (h[2] << 20);
+    g2 = (h[2] >> 12) | (h[3] << 14);
+    g3 = (h[3] >> 18) | (h[4] << 8);
+    memcpy(n, nonce, 16);
+    carry = ((uint64_t)g0) + le32toh(n[0]);
+    n[0] = htole32((uint32_t)carry);
+    carry = (carry >> 32) + g1 + le32toh(n[1]);
+    n[1] = htole32((uint32_t)carry);
+    carry = (carry >> 32) + g2 + le32toh(n[2]);
+    n[2] = htole32((uint32_t)carry);
+    carry = (carry >> 32) + g3 + le32toh(n[3]);
+    n[3] = htole32((uint32_t)carry);
+    memcpy(out, n, 16);
+    for (i = 0; i < 4; ++i)
+        n[i] = 0;
+}
+
+#endif // !CRYPTO_POLY1305_RADIX44
+
+#else // !CRYPTO_POLY1305_UNSATURATED
+
 // Limb array with enough space for 130 bits.
 #define NUM_LIMBS_130BIT    (NUM_LIMBS_128BIT + 1)
 
@@ -72,6 +347,9 @@
 #elif BIGNUMBER_LIMB_32BIT
 #define lelimbtoh(x)        (le32toh((x)))
 #define htolelimb(x)        (htole32((x)))
+#elif BIGNUMBER_LIMB_64BIT
+#define lelimbtoh(x)        (le64toh((x)))
+#define htolelimb(x)        (htole64((x)))
 #endif
 #if defined(CRYPTO_LITTLE_ENDIAN)
 #define littleToHost(r,size)    do { ; } while (0)
@@ -83,6 +361,8 @@
     } while (0)
 #endif
 
+#endif // !CRYPTO_POLY1305_UNSATURATED
+
 /**
  * \brief Constructs a new Poly1305 message authenticator.
  */
@@ -110,7 +390,11 @@ Poly1305::~Poly1305()
 void Poly1305::reset(const void *key)
 {
     // Copy the key into place and clear the bits we don't need.
+#if CRYPTO_POLY1305_UNSATURATED
+    uint8_t *r = state.c;
+#else
     uint8_t *r = (uint8_t *)state.r;
+#endif
     memcpy(r, key, 16);
     r[3] &= 0x0F;
     r[4] &= 0xFC;
@@ -120,8 +404,24 @@ void Poly1305::reset(const void *key)
     r[12] &= 0xFC;
     r[15] &= 0x0F;
 
+#if CRYPTO_POLY1305_UNSATURATED
+    // Split r into limbs and precompute r^2 for processing two blocks
+    // at a time.
+    unpackChunk(state.r, r, 0);
+#if CRYPTO_POLY1305_RADIX44
+    poly1305_wide_t d[POLY1305_NUM_LIMBS];
+#else
+    uint64_t d[POLY1305_NUM_LIMBS];
+#endif
+    memset(d, 0, sizeof(d));
+    mulAdd(d, state.r, state.r);
+    carryReduce(state.r2, d);
+    clean(d);
+    memset(state.c, 0, sizeof(state.c));
+#else
     // Convert into little-endian if necessary.
     littleToHost(state.r, NUM_LIMBS_128BIT);
+#endif
 
     // Reset the hashing process.
     state.chunkSize = 0;
@@ -141,8 +441,37 @@ void Poly1305::reset(const void *key)
  */
 void Poly1305::update(const void *data, size_t len)
 {
-    // Break the input up into 128-bit chunks and process each in turn.
     const uint8_t *d = (const uint8_t *)data;
+#if CRYPTO_POLY1305_UNSATURATED
+    // Complete the chunk that is left over from last time.
+    if (state.chunkSize != 0) {
+        uint8_t size = 16 - state.chunkSize;
+        if (size > len)
+            size = len;
+        memcpy(state.c + state.chunkSize, d, size);
+        state.chunkSize += size;
+        len -= size;
+        d += size;
+        if (state.chunkSize < 16)
+            return;
+        processChunk(state.c, 1);
+        state.chunkSize = 0;
+    }
+
+    // Process full chunks directly from the caller's buffer.
+    if (len >= 16) {
+        processChunks(d, len / 16);
+        d += len & ~((size_t)15);
+        len &= 15;
+    }
+
+    // Save the remaining bytes for next time.
+    if (len > 0) {
+        memcpy(state.c, d, len);
+        state.chunkSize = len;
+    }
+#else
+    // Break the input up into 128-bit chunks and process each in turn.
     while (len > 0) {
         uint8_t size = 16 - state.chunkSize;
         if (size > len)
@@ -158,6 +487,7 @@ void Poly1305::update(const void *data, size_t len)
             state.chunkSize = 0;
         }
     }
+#endif
 }
 
 /**
@@ -178,6 +508,20 @@ void Poly1305::update(const void *data, size_t len)
  */
 void Poly1305::finalize(const void *nonce, void *token, size_t len)
 {
+#if CRYPTO_POLY1305_UNSATURATED
+    // Pad and flush the final chunk.
+    if (state.chunkSize > 0) {
+        state.c[state.chunkSize] = 1;
+        memset(state.c + state.chunkSize + 1, 0, 16 - state.chunkSize - 1);
+        processChunk(state.c, 0);
+    }
+
+    // Reduce h and add the encrypted nonce to get the final hash.
+    reduceFinal(state.c, state.h, (const uint8_t *)nonce);
+    if (len > 16)
+        len = 16;
+    memcpy(token, state.c, len);
+#else
     dlimb_t carry;
     uint8_t i;
 
@@ -221,7 +565,7 @@ void Poly1305::finalize(const void *nonce, void *token, size_t len)
     // of the result because we are about to drop it in the next step.
     // We have to do it this way to avoid giving away any information
     // about the value of h in the instruction timing.
-    limb_t mask = (~((state.t[NUM_LIMBS_128BIT] >> 2) & 1)) + 1;
+    limb_t mask = ctMask((limb_t)((state.t[NUM_LIMBS_128BIT] >> 2) & 1));
     limb_t nmask = ~mask;
     for (i = 0; i < NUM_LIMBS_128BIT; ++i) {
         state.h[i] = (state.h[i] & nmask) | (state.t[i] & mask);
@@ -240,6 +584,7 @@ void Poly1305::finalize(const void *nonce, void *token, size_t len)
     if (len > 16)
         len = 16;
     memcpy(token, state.h, len);
+#endif
 }
 
 /**
@@ -250,10 +595,15 @@ void Poly1305::finalize(const void *nonce, void *token, size_t len)
 void Poly1305::pad()
 {
     if (state.chunkSize != 0) {
+#if CRYPTO_POLY1305_UNSATURATED
+        memset(state.c + state.chunkSize, 0, 16 - state.chunkSize);
+        processChunk(state.c, 1);
+#else
         memset(((uint8_t *)state.c) + state.chunkSize, 0, 16 - state.chunkSize);
         littleToHost(state.c, NUM_LIMBS_128BIT);
         state.c[NUM_LIMBS_128BIT] = 1;
         processChunk();
+#endif
         state.chunkSize = 0;
     }
 }
@@ -266,6 +616,73 @@ void Poly1305::clear()
     clean(state);
 }
 
+#if CRYPTO_POLY1305_UNSATURATED
+
+/**
+ * \brief Processes a single 128-bit chunk of input data.
+ *
+ * \param chunk Points to the 16 bytes of the chunk.
+ * \param hibit The bit to add at position 2<sup>128</sup>; 1 for a full
+ * chunk or 0 for the final padded chunk.
+ */
+void Poly1305::processChunk(const uint8_t *chunk, plimb_t hibit)
+{
+    // Compute h = ((h + c) * r) mod (2^130 - 5).
+    plimb_t m[POLY1305_NUM_LIMBS];
+#if CRYPTO_POLY1305_RADIX44
+    poly1305_wide_t d[POLY1305_NUM_LIMBS];
+#else
+    uint64_t d[POLY1305_NUM_LIMBS];
+#endif
+    uint8_t i;
+    unpackChunk(m, chunk, hibit);
+    for (i = 0; i < POLY1305_NUM_LIMBS; ++i) {
+        m[i] += state.h[i];
+        d[i] = 0;
+    }
+    mulAdd(d, m, state.r);
+    carryReduce(state.h, d);
+}
+
+/**
+ * \brief Processes several full 128-bit chunks of input data.
+ *
+ * \param chunks Points to the chunk data, which does not need to be aligned.
+ * \param count Number of 16-byte chunks to process.
+ *
+ * Chunks are absorbed two at a time by computing
+ * h = ((h + c1) * r<sup>2</sup> + c2 * r) mod (2<sup>130</sup> - 5),
+ * which needs only one carry chain for every pair of chunks.
+ */
+void Poly1305::processChunks(const uint8_t *chunks, size_t count)
+{
+    plimb_t m1[POLY1305_NUM_LIMBS];
+    plimb_t m2[POLY1305_NUM_LIMBS];
+#if CRYPTO_POLY1305_RADIX44
+    poly1305_wide_t d[POLY1305_NUM_LIMBS];
+#else
+    uint64_t d[POLY1305_NUM_LIMBS];
+#endif
+    uint8_t i;
+    while (count >= 2) {
+        unpackChunk(m1, chunks, 1);
+        unpackChunk(m2, chunks + 16, 1);
+        for (i = 0; i < POLY1305_NUM_LIMBS; ++i) {
+            m1[i] += state.h[i];
+            d[i] = 0;
+        }
+        mulAdd(d, m1, state.r2);
+        mulAdd(d, m2, state.r);
+        carryReduce(state.h, d);
+        chunks += 32;
+        count -= 2;
+    }
+    if (count)
+        processChunk(chunks, 1);
+}
+
+#else // !CRYPTO_POLY1305_UNSATURATED
+
 /**
  * \brief Processes a single 128-bit chunk of input data.
  */
@@ -276,7 +693,7 @@ void Poly1305::processChunk()
     // Start with h += c.  We assume that h is less than (2^130 - 5) * 6
     // and that c is less than 2^129, so the result will be less than 2^133.
     dlimb_t carry = 0;
-    uint8_t i, j;
+    uint8_t i;
     for (i = 0; i < NUM_LIMBS_130BIT; ++i) {
         carry += state.h[i];
         carry += state.c[i];
@@ -288,8 +705,196 @@ void Poly1305::processChunk()
     // top 4 bits were AND-ed off by reset().  That makes h * r less
     // than 2^257.  Which is less than the (2^130 - 6)^2 we want for
     // the modulo reduction step that follows.
+    limb_t word;
+#if CRYPTO_POLY1305_ASM_AVR
+    // Multiply a byte of h at a time with the 8x8 hardware multiplier,
+    // with the loop over the 16 bytes of r unrolled.  Y points at the
+    // current row of t, so it is saved and restored around the code.
+    const limb_t *hptr = state.h;
+    __asm__ __volatile__ (
+        "push r28\n"
+        "push r29\n"
+        "movw r28,%[t]\n"
+        "clr r23\n"
+        "std Y+0,r23\n"
+        "std Y+1,r23\n"
+        "std Y+2,r23\n"
+        "std Y+3,r23\n"
+        "std Y+4,r23\n"
+        "std Y+5,r23\n"
+        "std Y+6,r23\n"
+        "std Y+7,r23\n"
+        "std Y+8,r23\n"
+        "std Y+9,r23\n"
+        "std Y+10,r23\n"
+        "std Y+11,r23\n"
+        "std Y+12,r23\n"
+        "std Y+13,r23\n"
+        "std Y+14,r23\n"
+        "std Y+15,r23\n"
+        "ldi r21,%[hsize]\n"
+        "1:\n"
+        "ld r19,X+\n"
+        "clr r20\n"
+        "ldd r18,Z+0\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+0\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+0,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+1\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+1\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+1,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+2\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+2\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+2,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+3\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+3\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+3,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+4\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+4\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+4,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+5\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+5\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+5,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+6\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+6\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+6,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+7\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+7\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+7,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+8\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+8\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+8,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+9\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+9\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+9,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+10\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+10\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+10,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+11\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+11\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+11,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+12\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+12\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+12,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+13\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+13\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+13,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+14\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+14\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+14,r0\n"
+        "mov r20,r1\n"
+        "ldd r18,Z+15\n"
+        "mul r18,r19\n"
+        "ldd r22,Y+15\n"
+        "add r0,r22\n"
+        "adc r1,r23\n"
+        "add r0,r20\n"
+        "adc r1,r23\n"
+        "std Y+15,r0\n"
+        "mov r20,r1\n"
+        "std Y+16,r20\n"
+        "adiw r28,1\n"
+        "dec r21\n"
+        "brne 1b\n"
+        "pop r29\n"
+        "pop r28\n"
+        "clr r1\n"
+        : "+x"(hptr)
+        : "z"(state.r), [t] "r"(state.t), [hsize] "n"(sizeof(state.h))
+        : "r0", "r1", "r18", "r19", "r20", "r21", "r22", "r23", "memory"
+    );
+#else
+    uint8_t j;
     carry = 0;
-    limb_t word = state.r[0];
+    word = state.r[0];
     for (i = 0; i < NUM_LIMBS_130BIT; ++i) {
         carry += ((dlimb_t)(state.h[i])) * word;
         state.t[i] = (limb_t)carry;
@@ -307,6 +912,7 @@ void Poly1305::processChunk()
         }
         state.t[i + NUM_LIMBS_130BIT] = (limb_t)carry;
     }
+#endif
 
     // Reduce h * r modulo (2^130 - 5) by multiplying the high 130 bits by 5
     // and adding them to the low 130 bits.  See the explaination in the
@@ -337,3 +943,5 @@ void Poly1305::processChunk()
     // Leave it as-is for now with h less than (2^130 - 5) * 6.  It is
     // still within a range where the next h * r step will not overflow.
 }
+
+#endif // !CRYPTO_POLY1305_UNSATURATED
@@ -26,6 +26,41 @@
 #include "BigNumberUtil.h"
 #include <stddef.h>
 
+// Use unsaturated limbs on 32-bit and 64-bit platforms, which lets the
+// carries be deferred and two blocks to be folded in at a time.  AVR keeps
+// the original implementation that is based on 16-bit limb_t values.
+#if !defined(CRYPTO_POLY1305_UNSATURATED)
+#if defined(__AVR__)
+#define CRYPTO_POLY1305_UNSATURATED 0
+#else
+#define CRYPTO_POLY1305_UNSATURATED 1
+#endif
+#endif
+
+// Use hand-written assembly for the h * r multiplication on AVR.
+#if !defined(CRYPTO_POLY1305_ASM_AVR)
+#if defined(__AVR__) && !CRYPTO_POLY1305_UNSATURATED
+#define CRYPTO_POLY1305_ASM_AVR 1
+#else
+#define CRYPTO_POLY1305_ASM_AVR 0
+#endif
+#endif
+
+// Use radix-2^44 limbs if the compiler has a 128-bit product type,
+// or radix-2^26 limbs otherwise.
+#if !defined(CRYPTO_POLY1305_RADIX44)
+#if CRYPTO_POLY1305_UNSATURATED && defined(__SIZEOF_INT128__)
+#define CRYPTO_POLY1305_RADIX44 1
+#else
+#define CRYPTO_POLY1305_RADIX44 0
+#endif
+#endif
+#if CRYPTO_POLY1305_RADIX44
+#define POLY1305_NUM_LIMBS 3
+#else
+#define POLY1305_NUM_LIMBS 5
+#endif
+
 class Poly1305
 {
 public:
@@ -41,6 +76,23 @@ public:
     void clear();
 
 private:
+#if CRYPTO_POLY1305_UNSATURATED
+#if CRYPTO_POLY1305_RADIX44
+    typedef uint64_t plimb_t;
+#else
+    typedef uint32_t plimb_t;
+#endif
+    struct {
+        plimb_t h[POLY1305_NUM_LIMBS];
+        plimb_t r[POLY1305_NUM_LIMBS];
+        plimb_t r2[POLY1305_NUM_LIMBS];
+        uint8_t c[16];
+        uint8_t chunkSize;
+    } state;
+
+    void processChunk(const uint8_t *chunk, plimb_t hibit);
+    void processChunks(const uint8_t *chunks, size_t count);
+#else
     struct {
         limb_t h[(16 / sizeof(limb_t)) + 1];
         limb_t c[(16 / sizeof(limb_t)) + 1];
@@ -50,6 +102,7 @@ private:
     } state;
 
     void processChunk();
+#endif
 };
 
 #endif
@@ -22,11 +22,11 @@
 
 #include "RNG.h"
 #include "NoiseSource.h"
+#include "ChildRNG.h"
 #include "ChaCha.h"
 #include "Crypto.h"
 #include "utility/ProgMemUtil.h"
 #include <Arduino.h>
-#include <avr/eeprom.h>
 #include <string.h>
 
 /**
@@ -91,6 +91,24 @@
  * }
  * \endcode
  *
+ * Noise sources that collect their samples in an interrupt handler can
+ * pass the raw samples to queueNoise() instead of stirring them in
+ * directly.  The samples are held in a small lock-free queue and mixed
+ * into the pool later by loop(), which keeps the hashing out of the
+ * interrupt handler:
+ *
+ * \code
+ * ISR(TIMER1_CAPT_vect) {
+ *     // Credit 1 bit of entropy for each sample.
+ *     RNG.queueNoise((uint8_t)ICR1, 1);
+ * }
+ *
+ * void loop() {
+ *     // Spend no more than 500 microseconds mixing in queued samples.
+ *     RNG.loop(500);
+ * }
+ * \endcode
+ *
  * The loop() function will automatically save the random number seed on a
  * regular basis.  By default the seed is saved every hour but this can be
  * changed using setAutoSaveTime().
@@ -101,6 +119,11 @@
  * For example, an EEPROM rated for 100k erase/write cycles will last about
  * 69 days saving once a minute or 11 years saving once an hour.
  *
+ * Tasks on other cores that need random numbers of their own should use
+ * a ChildRNG rather than calling rand() on the global object, which is
+ * not safe to call from more than one task at a time.  The loop()
+ * function passes new seeds to the child generators when they ask.
+ *
  * The application can still elect to call save() at any time if wants.
  * For example, if the application can detect power loss or shutdown
  * conditions programmatically, then it may make sense to force a save()
@@ -121,6 +144,12 @@ RNGClass RNG;
  * \brief Size of a saved random number seed in EEPROM space.
  */
 
+/**
+ * \var RNGClass::SEED_SLOT_SIZE
+ * \brief Size of each seed slot in EEPROM space when begin() is given
+ * more than one slot; the extra byte holds the sequence number.
+ */
+
 // Number of ChaCha hash rounds to use for random number generation.
 #define RNG_ROUNDS          20
 
@@ -130,6 +159,22 @@ RNGClass RNG;
 // Maximum entropy credit that can be contained in the pool.
 #define RNG_MAX_CREDITS     384
 
+// Number of bytes of buffered keystream that are left over after refill().
+#define RNG_BUFFER_SIZE     (64 * CRYPTO_RNG_BUFFER_BLOCKS - 48)
+
+#if CRYPTO_RNG_BUFFER_BLOCKS > 1 && (CRYPTO_RNG_BUFFER_BLOCKS % 2) != 0
+#error "CRYPTO_RNG_BUFFER_BLOCKS must be 1 or an even number"
+#endif
+
+#if (CRYPTO_RNG_QUEUE_SIZE & (CRYPTO_RNG_QUEUE_SIZE - 1)) != 0 || \
+        CRYPTO_RNG_QUEUE_SIZE > 128
+#error "CRYPTO_RNG_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+#define RNG_QUEUE_MASK      (CRYPTO_RNG_QUEUE_SIZE - 1)
+
+// Step in the incremental save process that writes the commit marker.
+#define RNG_SAVE_COMMIT     51
+
 /** @cond */
 
 // Tag for 256-bit ChaCha20 keys.  This will always appear in the
@@ -165,12 +210,20 @@ static const uint8_t initRNG[48] PROGMEM = {
  * \sa begin()
  */
 RNGClass::RNGClass()
-    : address(0)
+    : storage(&eeprom)
     , credits(0)
     , firstSave(1)
     , timer(0)
     , timeout(3600000UL)    // 1 hour in milliseconds
+    , children(0)
     , count(0)
+    , buffered(0)
+    , queueHead(0)
+    , queueTail(0)
+    , slots(1)
+    , saveSlot(0)
+    , saveSeq(0)
+    , savePosn(0)
 {
 }
 
@@ -181,6 +234,7 @@ RNGClass::~RNGClass()
 {
     clean(block);
     clean(stream);
+    clean(seed);
 }
 
 /**
@@ -192,27 +246,82 @@ RNGClass::~RNGClass()
  * generate the same sequence of values upon first boot.
  * \param eepromAddress The EEPROM address to load the previously saved
  * seed from and to save new seeds when save() is called.  There must be
- * at least SEED_SIZE (49) bytes of EEPROM space available at the address.
+ * at least SEED_SIZE (49) bytes of EEPROM space available at the address,
+ * or \a slots * SEED_SLOT_SIZE (50) bytes if \a slots is greater than 1.
+ * \param slots The number of seed slots to rotate through when saving,
+ * between 1 and 127.  The default of 1 keeps the original single-seed
+ * layout.
+ *
+ * When there are several slots, each save goes to the next slot in turn
+ * along with a sequence number, which spreads the EEPROM wear across all
+ * of the slots.  This function loads the seed from the newest valid slot.
  *
  * This function should be followed by calls to addNoiseSource() to
  * register the application's noise sources.
  *
  * \sa addNoiseSource(), stir(), save()
  */
-void RNGClass::begin(const char *tag, int eepromAddress)
+void RNGClass::begin(const char *tag, int eepromAddress, uint8_t slots)
 {
-    // Save the EEPROM address for use by save().
-    address = eepromAddress;
+    eeprom.setAddress(eepromAddress);
+    begin(tag, eeprom, slots);
+}
+
+/**
+ * \brief Initializes the random number generator with a specific type
+ * of seed storage.
+ *
+ * \param tag A string that is stirred into the random pool at startup.
+ * \param storage The storage to load the previously saved seed from and
+ * to save new seeds to.  The object must remain valid for as long as the
+ * random number generator is in use.
+ * \param slots The number of seed slots to rotate through when saving.
+ *
+ * This is the same as the EEPROM version of begin() except that the seed
+ * is kept in \a storage, which may be an external I2C EEPROM, the
+ * battery-backed memory of a realtime clock, and so on.  Storage that
+ * does not wear out or that is much faster to write than the internal
+ * EEPROM allows setAutoSaveTime() to be set to a shorter interval.
+ *
+ * \sa SeedStorage
+ */
+void RNGClass::begin(const char *tag, SeedStorage &storage, uint8_t slots)
+{
+    // Save the storage and slot count for use by save().
+    this->storage = &storage;
+    if (slots < 1)
+        slots = 1;
+    else if (slots > 127)
+        slots = 127;
+    this->slots = slots;
+    savePosn = 0;
+
+    // Find the slot with the newest sequence number that has a complete
+    // seed.  Slots that were interrupted while being written are ignored.
+    int newest = -1;
+    uint8_t newestSeq = 0;
+    for (uint8_t slot = 0; slot < slots; ++slot) {
+        unsigned int base = slot * SEED_SLOT_SIZE;
+        if (storage.read(base) != 'S')
+            continue;
+        uint8_t seq = (slots > 1) ? storage.read(base + SEED_SIZE) : 0;
+        if (newest < 0 || ((int8_t)(seq - newestSeq)) > 0) {
+            newest = slot;
+            newestSeq = seq;
+        }
+    }
+    saveSlot = (newest < 0 || (newest + 1) >= slots) ? 0 : (newest + 1);
+    saveSeq = newestSeq + 1;
 
     // Initialize the ChaCha20 input block from the saved seed.
     memcpy_P(block, tagRNG, sizeof(tagRNG));
     memcpy_P(block + 4, initRNG, sizeof(initRNG));
-    if (eeprom_read_byte((const uint8_t *)address) == 'S') {
+    if (newest >= 0) {
         // We have a saved seed: XOR it with the initialization block.
-        for (int posn = 0; posn < 12; ++posn) {
-            block[posn + 4] ^=
-                eeprom_read_dword((const uint32_t *)(address + posn * 4 + 1));
-        }
+        uint8_t *output = ((uint8_t *)block) + 16;
+        unsigned int base = newest * SEED_SLOT_SIZE + 1;
+        for (uint8_t posn = 0; posn < 48; ++posn)
+            output[posn] ^= storage.read(base + posn);
     }
 
     // No entropy credits for the saved seed.
@@ -228,9 +337,10 @@ void RNGClass::begin(const char *tag, int eepromAddress)
     if (tag)
         stir((const uint8_t *)tag, strlen(tag));
 
-    // Re-save the seed to obliterate the previous value and to ensure
-    // that if the system is reset without a call to save() that we won't
-    // accidentally generate the same sequence of random data again.
+    // Re-save the seed to obliterate the previous value (or to supersede
+    // it when there are several slots) and to ensure that if the system is
+    // reset without a call to save() that we won't accidentally generate
+    // the same sequence of random data again.
     save();
 }
 
@@ -293,6 +403,12 @@ void RNGClass::setAutoSaveTime(uint16_t minutes)
  * generating important values, the available() function can be
  * polled to determine when sufficient entropy is available.
  *
+ * Small requests are served from a buffer of keystream that was
+ * generated the last time the generator was rekeyed.  The key is
+ * replaced as soon as the buffer is generated and each byte is erased
+ * from the buffer as it is returned, so capturing the state later will
+ * not reveal previous outputs.  The buffer is discarded by stir().
+ *
  * \sa available(), stir()
  */
 void RNGClass::rand(uint8_t *data, size_t len)
@@ -303,8 +419,41 @@ void RNGClass::rand(uint8_t *data, size_t len)
     else
         credits -= len * 8;
 
+    // Serve small requests from the buffered keystream, refilling
+    // the buffer and rekeying in a single step when it runs dry.
+    if (len <= RNG_BUFFER_SIZE) {
+        if (len > buffered)
+            refill();
+        uint8_t *buf = ((uint8_t *)stream) + sizeof(stream) - buffered;
+        memcpy(data, buf, len);
+        clean(buf, len);
+        buffered -= len;
+        return;
+    }
+
     // Generate the random data.
     uint8_t count = 0;
+#if !defined(__AVR__)
+    // Generate pairs of blocks directly with ChaCha::hashCore2()
+    // while there is enough data left to use them both.
+    if (len >= 128) {
+        uint32_t blocks[32];
+        do {
+            if (count >= (RNG_REKEY_BLOCKS - 1)) {
+                rekey();
+                count = 0;
+            }
+            count += 2;
+            ++(block[12]);
+            ChaCha::hashCore2(blocks, block, RNG_ROUNDS);
+            ++(block[12]);
+            memcpy(data, blocks, 128);
+            data += 128;
+            len -= 128;
+        } while (len >= 128);
+        clean(blocks);
+    }
+#endif
     while (len > 0) {
         // Force a rekey if we have generated too many blocks in this request.
         if (count >= RNG_REKEY_BLOCKS) {
@@ -444,10 +593,41 @@ void RNGClass::stir(const uint8_t *data, size_t len, unsigned int credit)
     // the first auto-save timeout occurs.
     if (firstSave && credits >= RNG_MAX_CREDITS) {
         firstSave = 0;
-        save();
+        startSave();
     }
 }
 
+/**
+ * \brief Queues a raw noise sample to be stirred into the random pool
+ * by the next call to loop().
+ *
+ * \param sample The raw noise sample.
+ * \param credit The number of bits of entropy to credit for the sample,
+ * which is clamped to 8 when the sample is mixed in.
+ * \return Returns false if the queue is full and the sample was dropped.
+ *
+ * This function is safe to call from an interrupt handler while the main
+ * program is running loop(), provided that there is only one producer at
+ * a time.  It does not disable interrupts and does no hashing; the queue
+ * holds up to CRYPTO_RNG_QUEUE_SIZE - 1 samples.
+ *
+ * On processors with several cores, the producer must run on the same
+ * core as loop() because the queue does not use memory barriers.
+ *
+ * \sa loop(), stir()
+ */
+bool RNGClass::queueNoise(uint8_t sample, uint8_t credit)
+{
+    uint8_t head = queueHead;
+    uint8_t next = (head + 1) & RNG_QUEUE_MASK;
+    if (next == queueTail)
+        return false;
+    queueData[head] = sample;
+    queueCredit[head] = credit;
+    queueHead = next;
+    return true;
+}
+
 /**
  * \brief Saves the random seed to EEPROM.
  *
@@ -472,25 +652,33 @@ void RNGClass::stir(const uint8_t *data, size_t len, unsigned int credit)
  * random state will be predictable from the seed.  For this reason it is
  * very important to stir() in new noise data at startup.
  *
+ * Each byte written to EEPROM can take several milliseconds, so the
+ * automatic saves that are triggered by loop() are written one byte per
+ * call to loop() instead.  Calling save() directly writes the whole seed
+ * before returning, finishing any automatic save that is in progress.
+ *
+ * If begin() was given more than one slot, then older seeds remain in
+ * their slots until they are overwritten by later saves.  Use destroy()
+ * to erase all of them.
+ *
  * \sa loop(), stir()
  */
 void RNGClass::save()
 {
-    // Generate random data from the current state and save
-    // that as the seed.  Then force a rekey.
-    ++(block[12]);
-    ChaCha::hashCore(stream, block, RNG_ROUNDS);
-    eeprom_write_block(stream, (void *)(address + 1), 48);
-    eeprom_update_byte((uint8_t *)address, 'S');
-    rekey();
-    timer = millis();
+    if (!savePosn)
+        startSave();
+    while (saveStep())
+        ;
 }
 
 /**
  * \brief Run periodic housekeeping tasks on the random number generator.
  *
  * This function must be called on a regular basis from the application's
- * main "loop()" function.
+ * main "loop()" function.  All samples that are waiting in the queue
+ * from queueNoise() are stirred into the pool.
+ *
+ * \sa loop(unsigned long)
  */
 void RNGClass::loop()
 {
@@ -498,9 +686,62 @@ void RNGClass::loop()
     for (uint8_t posn = 0; posn < count; ++posn)
         noiseSources[posn]->stir();
 
-    // Save the seed if the auto-save timer has expired.
-    if ((millis() - timer) >= timeout)
-        save();
+    // Mix in everything that the interrupt handlers have queued.
+    while (drainQueue())
+        ;
+
+    // Hand fresh seeds to the child generators that have asked for them.
+    reseedChildren();
+
+    // Write the next byte of a pending save, or start a new save
+    // if the auto-save timer has expired.
+    if (savePosn) {
+        if (storage->ready())
+            saveStep();
+    } else if ((millis() - timer) >= timeout) {
+        startSave();
+    }
+}
+
+/**
+ * \brief Run periodic housekeeping tasks on the random number generator
+ * within a time budget.
+ *
+ * \param budget The number of microseconds that may be spent mixing in
+ * samples from queueNoise().
+ *
+ * This is the same as loop() except that the queued samples are mixed in
+ * 48-byte slices until the queue is empty or \a budget has elapsed.
+ * At least one slice is mixed in on every call so that the queue always
+ * makes progress.  Samples that are left over are mixed in next time.
+ *
+ * \sa loop(), queueNoise()
+ */
+void RNGClass::loop(unsigned long budget)
+{
+    unsigned long start = micros();
+
+    // Stir in the entropy from all registered noise sources.
+    for (uint8_t posn = 0; posn < count; ++posn)
+        noiseSources[posn]->stir();
+
+    // Mix in queued samples until the queue is empty or we run out of time.
+    while (drainQueue()) {
+        if ((micros() - start) >= budget)
+            break;
+    }
+
+    // Hand fresh seeds to the child generators that have asked for them.
+    reseedChildren();
+
+    // Write the next byte of a pending save, or start a new save
+    // if the auto-save timer has expired.
+    if (savePosn) {
+        if (storage->ready())
+            saveStep();
+    } else if ((millis() - timer) >= timeout) {
+        startSave();
+    }
 }
 
 /**
@@ -526,8 +767,15 @@ void RNGClass::destroy()
 {
     clean(block);
     clean(stream);
-    for (int posn = 0; posn < SEED_SIZE; ++posn)
-        eeprom_write_byte((uint8_t *)(address + posn), 0xFF);
+    clean(seed);
+    savePosn = 0;
+    while (queueTail != queueHead) {
+        queueData[queueTail] = 0;
+        queueTail = (queueTail + 1) & RNG_QUEUE_MASK;
+    }
+    int size = (slots > 1) ? slots * SEED_SLOT_SIZE : SEED_SIZE;
+    for (int posn = 0; posn < size; ++posn)
+        storage->write(posn, 0xFF);
 }
 
 /**
@@ -543,6 +791,9 @@ void RNGClass::rekey()
     ChaCha::hashCore(stream, block, RNG_ROUNDS);
     memcpy(block + 4, stream, 48);
 
+    // The rest of the stream buffer is no longer valid keystream.
+    buffered = 0;
+
     // Permute the high word of the counter using the system microsecond
     // counter to introduce a little bit of non-stir randomness for each
     // request.  Note: If random data is requested on a predictable schedule
@@ -550,3 +801,152 @@ void RNGClass::rekey()
     // high quality entropy data on a regular basis using stir().
     block[13] ^= micros();
 }
+
+/**
+ * \brief Rekeys the random number generator and fills the buffer of
+ * keystream that is used to serve small requests.
+ *
+ * This generates several keystream blocks at once with the current key,
+ * replaces the key with the first 48 bytes immediately, and keeps the
+ * remaining bytes for later calls to rand().
+ */
+void RNGClass::refill()
+{
+#if CRYPTO_RNG_BUFFER_BLOCKS > 1
+    for (uint8_t posn = 0; posn < CRYPTO_RNG_BUFFER_BLOCKS; posn += 2) {
+        ++(block[12]);
+        ChaCha::hashCore2(stream + posn * 16, block, RNG_ROUNDS);
+        ++(block[12]);
+    }
+#else
+    ++(block[12]);
+    ChaCha::hashCore(stream, block, RNG_ROUNDS);
+#endif
+    memcpy(block + 4, stream, 48);
+    clean(stream, 48);
+    buffered = RNG_BUFFER_SIZE;
+    block[13] ^= micros();
+}
+
+/**
+ * \brief Stirs the next slice of samples from the interrupt queue into
+ * the random pool.
+ *
+ * \return Returns false if the queue was empty.
+ */
+bool RNGClass::drainQueue()
+{
+    uint8_t data[48];
+    uint8_t len = 0;
+    unsigned int credit = 0;
+    uint8_t tail = queueTail;
+    uint8_t head = queueHead;
+    if (tail == head)
+        return false;
+    while (tail != head && len < sizeof(data)) {
+        uint8_t bits = queueCredit[tail];
+        data[len++] = queueData[tail];
+        queueData[tail] = 0;
+        credit += (bits < 8) ? bits : 8;
+        tail = (tail + 1) & RNG_QUEUE_MASK;
+    }
+    queueTail = tail;
+    stir(data, len, credit);
+    clean(data);
+    return true;
+}
+
+/**
+ * \brief Generates a new seed and starts saving it to the next EEPROM slot.
+ *
+ * The seed is written by subsequent calls to saveStep().
+ */
+void RNGClass::startSave()
+{
+    // Generate random data from the current state and save
+    // that as the seed.  Then force a rekey.
+    ++(block[12]);
+    ChaCha::hashCore(stream, block, RNG_ROUNDS);
+    memcpy(seed, stream, 48);
+    rekey();
+    timer = millis();
+
+    // Restarting a save that was in progress keeps the same slot.
+    savePosn = 1;
+}
+
+/**
+ * \brief Writes the next byte of the seed that is being saved.
+ *
+ * \return Returns false once the save is complete.
+ *
+ * The slot's marker byte is invalidated first and the seed and sequence
+ * number are then written.  The marker is set again last, so a slot that
+ * was interrupted by a loss of power will not be loaded by begin().
+ */
+bool RNGClass::saveStep()
+{
+    unsigned int base = saveSlot * SEED_SLOT_SIZE;
+    if (!savePosn)
+        return false;
+    if (savePosn == 1) {
+        storage->write(base, 0xFF);
+    } else if (savePosn <= SEED_SIZE) {
+        storage->write(base + savePosn - 1, seed[savePosn - 2]);
+    } else if (savePosn < RNG_SAVE_COMMIT) {
+        if (slots > 1)
+            storage->write(base + SEED_SIZE, saveSeq);
+    } else {
+        storage->write(base, 'S');
+        clean(seed);
+        savePosn = 0;
+        if (++saveSlot >= slots)
+            saveSlot = 0;
+        ++saveSeq;
+        return false;
+    }
+    ++savePosn;
+    return true;
+}
+
+/**
+ * \brief Adds a child generator to the list that is reseeded by loop().
+ *
+ * \param child The child generator to add.
+ */
+void RNGClass::addChild(ChildRNG *child)
+{
+    for (ChildRNG *current = children; current; current = current->next) {
+        if (current == child)
+            return;
+    }
+    child->next = children;
+    children = child;
+}
+
+/**
+ * \brief Removes a child generator from the list that is reseeded by loop().
+ *
+ * \param child The child generator to remove.
+ */
+void RNGClass::removeChild(ChildRNG *child)
+{
+    ChildRNG **link = &children;
+    while (*link) {
+        if (*link == child) {
+            *link = child->next;
+            child->next = 0;
+            return;
+        }
+        link = &((*link)->next);
+    }
+}
+
+/**
+ * \brief Passes new seeds to the child generators that have asked for them.
+ */
+void RNGClass::reseedChildren()
+{
+    for (ChildRNG *child = children; child; child = child->next)
+        child->reseed();
+}
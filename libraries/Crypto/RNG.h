@@ -25,8 +25,43 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include "SeedStorage.h"
+
+// The STM32 device headers define RNG as the address of the on-chip
+// random number peripheral, which collides with the global RNG object.
+// Pull the headers in first so that the macro stays removed.
+#if defined(ARDUINO_ARCH_STM32)
+#include <Arduino.h>
+#if defined(RNG)
+#undef RNG
+#endif
+#endif
+
+// Number of ChaCha keystream blocks to generate at once when rekeying.
+// The first 48 bytes become the next key and the rest are buffered to
+// satisfy small rand() requests without running the hash core again.
+// Must be 1 or an even number.
+#if !defined(CRYPTO_RNG_BUFFER_BLOCKS)
+#if defined(__AVR__)
+#define CRYPTO_RNG_BUFFER_BLOCKS 1
+#else
+#define CRYPTO_RNG_BUFFER_BLOCKS 4
+#endif
+#endif
+
+// Number of raw noise samples that can be queued by interrupt handlers
+// with queueNoise() before loop() mixes them in.  Must be a power of two
+// no larger than 128.
+#if !defined(CRYPTO_RNG_QUEUE_SIZE)
+#if defined(__AVR__)
+#define CRYPTO_RNG_QUEUE_SIZE 32
+#else
+#define CRYPTO_RNG_QUEUE_SIZE 64
+#endif
+#endif
 
 class NoiseSource;
+class ChildRNG;
 
 class RNGClass
 {
@@ -34,7 +69,8 @@ public:
     RNGClass();
     ~RNGClass();
 
-    void begin(const char *tag, int eepromAddress);
+    void begin(const char *tag, int eepromAddress, uint8_t slots = 1);
+    void begin(const char *tag, SeedStorage &storage, uint8_t slots = 1);
     void addNoiseSource(NoiseSource &source);
 
     void setAutoSaveTime(uint16_t minutes);
@@ -44,26 +80,51 @@ public:
 
     void stir(const uint8_t *data, size_t len, unsigned int credit = 0);
 
+    bool queueNoise(uint8_t sample, uint8_t credit = 0);
+
     void save();
 
     void loop();
+    void loop(unsigned long budget);
 
     void destroy();
 
     static const int SEED_SIZE = 49;
+    static const int SEED_SLOT_SIZE = 50;
 
 private:
     uint32_t block[16];
-    uint32_t stream[16];
-    int address;
+    uint32_t stream[16 * CRYPTO_RNG_BUFFER_BLOCKS];
+    EEPROMSeedStorage eeprom;
+    SeedStorage *storage;
     uint16_t credits : 15;
     uint16_t firstSave : 1;
     unsigned long timer;
     unsigned long timeout;
     NoiseSource *noiseSources[4];
+    ChildRNG *children;
     uint8_t count;
+    uint16_t buffered;
+    uint8_t volatile queueData[CRYPTO_RNG_QUEUE_SIZE];
+    uint8_t volatile queueCredit[CRYPTO_RNG_QUEUE_SIZE];
+    uint8_t volatile queueHead;
+    uint8_t volatile queueTail;
+    uint8_t slots;
+    uint8_t saveSlot;
+    uint8_t saveSeq;
+    uint8_t savePosn;
+    uint8_t seed[48];
 
     void rekey();
+    void refill();
+    bool drainQueue();
+    void startSave();
+    bool saveStep();
+    void addChild(ChildRNG *child);
+    void removeChild(ChildRNG *child);
+    void reseedChildren();
+
+    friend class ChildRNG;
 };
 
 extern RNGClass RNG;
@@ -24,12 +24,27 @@
 #include "Crypto.h"
 #include "utility/RotateUtil.h"
 #include "utility/EndianUtil.h"
+#include "utility/CpuFeatureUtil.h"
 #include <string.h>
 
+#if CRYPTO_SHA1_HW && CRYPTO_X86_SHA_EXT
+#include <immintrin.h>
+#define SHA1_HW_X86 1
+#elif CRYPTO_SHA1_HW && CRYPTO_ARM_SHA_EXT
+#include <arm_neon.h>
+#define SHA1_HW_ARM 1
+#endif
+
 /**
  * \class SHA1 SHA1.h <SHA1.h>
  * \brief SHA-1 hash algorithm.
  *
+ * On x86 processors with the SHA extensions, and on ARMv8 processors
+ * when the crypto extensions are enabled at compile time, the compression
+ * function uses the hardware SHA instructions.  The x86 support is
+ * detected at runtime.  Define CRYPTO_SHA1_HW to 0 to always use the
+ * portable implementation.
+ *
  * Reference: http://en.wikipedia.org/wiki/SHA-1
  *
  * \sa SHA256, SHA512
@@ -131,6 +146,11 @@ void SHA1::clear()
     reset();
 }
 
+void SHA1::copyState(const Hash &other)
+{
+    state = static_cast<const SHA1 &>(other).state;
+}
+
 void SHA1::resetHMAC(const void *key, size_t keyLen)
 {
     formatHMACKey(state.w, key, keyLen, 0x36);
@@ -150,6 +170,144 @@ void SHA1::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashL
     clean(temp);
 }
 
+#if defined(SHA1_HW_X86)
+
+// Performs 4 rounds with the message words in "wa".  The "ecur" and
+// "enext" values alternate between holding the next "e" and the saved
+// "abcd".  The message schedule for later groups is expanded in stages.
+#define SHA1_ROUNDS_HW(g, func, ecur, enext, wa, wb, wc, wd) \
+    do { \
+        if ((g) == 0) \
+            ecur = _mm_add_epi32(ecur, wa); \
+        else \
+            ecur = _mm_sha1nexte_epu32(ecur, wa); \
+        enext = abcd; \
+        if ((g) >= 3 && (g) <= 18) \
+            wb = _mm_sha1msg2_epu32(wb, wa); \
+        abcd = _mm_sha1rnds4_epu32(abcd, ecur, func); \
+        if ((g) >= 1 && (g) <= 16) \
+            wd = _mm_sha1msg1_epu32(wd, wa); \
+        if ((g) >= 2 && (g) <= 17) \
+            wc = _mm_xor_si128(wc, wa); \
+    } while (0)
+
+/**
+ * \brief Processes a single 512-bit chunk using the x86 SHA extensions.
+ *
+ * \param h The hash state.
+ * \param data The 64 bytes of data in the chunk.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void processChunkHW(uint32_t *h, const uint8_t *data)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+                                        0x08090a0b0c0d0e0fULL);
+    __m128i abcd, save, esave, e0, e1;
+    __m128i w0, w1, w2, w3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0x1B);
+    e0 = esave = _mm_set_epi32((int)(h[4]), 0, 0, 0);
+    save = abcd;
+
+    // Load the message words and convert them into host byte order.
+    w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+    w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+    w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+    w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+
+    // Perform the 80 rounds, 4 at a time.
+    SHA1_ROUNDS_HW(0, 0, e0, e1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(1, 0, e1, e0, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(2, 0, e0, e1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(3, 0, e1, e0, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(4, 0, e0, e1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(5, 1, e1, e0, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(6, 1, e0, e1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(7, 1, e1, e0, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(8, 1, e0, e1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(9, 1, e1, e0, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(10, 2, e0, e1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(11, 2, e1, e0, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(12, 2, e0, e1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(13, 2, e1, e0, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(14, 2, e0, e1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(15, 3, e1, e0, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(16, 3, e0, e1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(17, 3, e1, e0, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(18, 3, e0, e1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(19, 3, e1, e0, w3, w0, w1, w2);
+
+    // Add the compressed chunk to the current hash value.
+    e0 = _mm_sha1nexte_epu32(e0, esave);
+    abcd = _mm_add_epi32(abcd, save);
+    _mm_storeu_si128((__m128i *)h, _mm_shuffle_epi32(abcd, 0x1B));
+    h[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#elif defined(SHA1_HW_ARM)
+
+// Performs 4 rounds with the message words in "wa" and then expands the
+// message schedule for the group of rounds that is 4 groups ahead.
+#define SHA1_ROUNDS_HW(g, func, kval, wa, wb, wc, wd) \
+    do { \
+        wk = vaddq_u32(wa, vdupq_n_u32(kval)); \
+        enext = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+        abcd = func(abcd, e, wk); \
+        e = enext; \
+        if ((g) < 16) \
+            wa = vsha1su1q_u32(vsha1su0q_u32(wa, wb, wc), wd); \
+    } while (0)
+
+/**
+ * \brief Processes a single 512-bit chunk using the ARMv8 crypto extensions.
+ *
+ * \param h The hash state.
+ * \param data The 64 bytes of data in the chunk.
+ */
+static void processChunkHW(uint32_t *h, const uint8_t *data)
+{
+    uint32x4_t abcd, save, wk;
+    uint32x4_t w0, w1, w2, w3;
+    uint32_t e, enext;
+
+    abcd = save = vld1q_u32(h);
+    e = h[4];
+
+    // Load the message words and convert them into host byte order.
+    w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+    w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+    w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+    w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+    // Perform the 80 rounds, 4 at a time.
+    SHA1_ROUNDS_HW(0, vsha1cq_u32, 0x5A827999, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(1, vsha1cq_u32, 0x5A827999, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(2, vsha1cq_u32, 0x5A827999, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(3, vsha1cq_u32, 0x5A827999, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(4, vsha1cq_u32, 0x5A827999, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(5, vsha1pq_u32, 0x6ED9EBA1, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(6, vsha1pq_u32, 0x6ED9EBA1, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(7, vsha1pq_u32, 0x6ED9EBA1, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(8, vsha1pq_u32, 0x6ED9EBA1, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(9, vsha1pq_u32, 0x6ED9EBA1, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(10, vsha1mq_u32, 0x8F1BBCDC, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(11, vsha1mq_u32, 0x8F1BBCDC, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(12, vsha1mq_u32, 0x8F1BBCDC, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(13, vsha1mq_u32, 0x8F1BBCDC, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(14, vsha1mq_u32, 0x8F1BBCDC, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(15, vsha1pq_u32, 0xCA62C1D6, w3, w0, w1, w2);
+    SHA1_ROUNDS_HW(16, vsha1pq_u32, 0xCA62C1D6, w0, w1, w2, w3);
+    SHA1_ROUNDS_HW(17, vsha1pq_u32, 0xCA62C1D6, w1, w2, w3, w0);
+    SHA1_ROUNDS_HW(18, vsha1pq_u32, 0xCA62C1D6, w2, w3, w0, w1);
+    SHA1_ROUNDS_HW(19, vsha1pq_u32, 0xCA62C1D6, w3, w0, w1, w2);
+
+    // Add the compressed chunk to the current hash value.
+    vst1q_u32(h, vaddq_u32(abcd, save));
+    h[4] += e;
+}
+
+#endif
+
 /**
  * \brief Processes a single 512-bit chunk with the core SHA-1 algorithm.
  *
@@ -159,6 +317,14 @@ void SHA1::processChunk()
 {
     uint8_t index;
 
+#if defined(SHA1_HW_X86) || defined(SHA1_HW_ARM)
+    // Use the SHA instructions if the processor has them.
+    if (cpuHasShaExt()) {
+        processChunkHW(state.h, (const uint8_t *)state.w);
+        return;
+    }
+#endif
+
     // Convert the first 16 words from big endian to host byte order.
     for (index = 0; index < 16; ++index)
         state.w[index] = be32toh(state.w[index]);
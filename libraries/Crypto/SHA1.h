@@ -25,6 +25,12 @@
 
 #include "Hash.h"
 
+// Use the SHA instructions on x86 and ARMv8 processors to process chunks
+// when they are available.  Set to 0 to always use the portable code.
+#if !defined(CRYPTO_SHA1_HW)
+#define CRYPTO_SHA1_HW 1
+#endif
+
 class SHA1 : public Hash
 {
 public:
@@ -40,6 +46,8 @@ public:
 
     void clear();
 
+    void copyState(const Hash &other);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
@@ -22,15 +22,52 @@
 
 #include "SHA256.h"
 #include "Crypto.h"
+#include "CryptoConfig.h"
 #include "utility/RotateUtil.h"
 #include "utility/EndianUtil.h"
 #include "utility/ProgMemUtil.h"
+#include "utility/CpuFeatureUtil.h"
 #include <string.h>
 
+#if CRYPTO_SHA256_HW && CRYPTO_X86_SHA_EXT
+#include <immintrin.h>
+#define SHA256_HW_X86 1
+#elif CRYPTO_SHA256_HW && CRYPTO_ARM_SHA_EXT
+#include <arm_neon.h>
+#define SHA256_HW_ARM 1
+#endif
+
+#if CRYPTO_SHA256_SSE2
+#include <emmintrin.h>
+#endif
+
+// Use hand-written assembly for the sigma functions on AVR, which fold
+// the byte rotations into the moves instead of shifting every byte.
+#if !defined(CRYPTO_SHA256_ASM_AVR)
+#if defined(__AVR__)
+#define CRYPTO_SHA256_ASM_AVR 1
+#else
+#define CRYPTO_SHA256_ASM_AVR 0
+#endif
+#endif
+
 /**
  * \class SHA256 SHA256.h <SHA256.h>
  * \brief SHA-256 hash algorithm.
  *
+ * On x86 processors with the SHA extensions, and on ARMv8 processors
+ * when the crypto extensions are enabled at compile time, the compression
+ * function uses the hardware SHA instructions.  The x86 support is
+ * detected at runtime.  Define CRYPTO_SHA256_HW to 0 to always use the
+ * portable implementation.
+ *
+ * On x86 processors without the SHA extensions, the message schedule is
+ * expanded four words at a time with SSE2 instructions while the rounds
+ * themselves remain scalar.  Define CRYPTO_SHA256_SSE2 to 0 to use the
+ * portable implementation on those processors instead.  The implementation
+ * can also be changed at runtime with setImplementation(), so that tests
+ * and benchmarks can compare all of them in a single run.
+ *
  * Reference: http://en.wikipedia.org/wiki/SHA-2
  *
  * \sa SHA512, SHA1, BLAKE2s
@@ -136,6 +173,11 @@ void SHA256::clear()
     reset();
 }
 
+void SHA256::copyState(const Hash &other)
+{
+    state = static_cast<const SHA256 &>(other).state;
+}
+
 void SHA256::resetHMAC(const void *key, size_t keyLen)
 {
     formatHMACKey(state.w, key, keyLen, 0x36);
@@ -155,6 +197,589 @@ void SHA256::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t has
     clean(temp);
 }
 
+// Round constants for SHA-256.
+static uint32_t const k[64] PROGMEM = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Implementation that was selected with SHA256::setImplementation().
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+static uint8_t selected = SHA256::Hardware;
+#elif CRYPTO_SHA256_SSE2
+static uint8_t selected = SHA256::Vector;
+#else
+static uint8_t selected = SHA256::Portable;
+#endif
+
+#if defined(SHA256_HW_X86)
+
+// Performs 4 rounds with the message words in "wa" and then expands the
+// message schedule for the group of rounds that is 4 groups ahead.
+#define SHA256_ROUNDS_HW(g, wa, wb, wc, wd) \
+    do { \
+        msg = _mm_add_epi32(wa, _mm_loadu_si128((const __m128i *)(k + (g) * 4))); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+        if ((g) < 12) { \
+            temp = _mm_sha256msg1_epu32(wa, wb); \
+            temp = _mm_add_epi32(temp, _mm_alignr_epi8(wd, wc, 4)); \
+            wa = _mm_sha256msg2_epu32(temp, wd); \
+        } \
+        msg = _mm_shuffle_epi32(msg, 0x0E); \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg); \
+    } while (0)
+
+/**
+ * \brief Processes a single 512-bit chunk using the x86 SHA extensions.
+ *
+ * \param h The hash state.
+ * \param data The 64 bytes of data in the chunk.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void processChunkHW(uint32_t *h, const uint8_t *data)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i state0, state1, save0, save1, temp, msg;
+    __m128i w0, w1, w2, w3;
+
+    // Rearrange the state into ABEF and CDGH order for the instructions.
+    temp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(h + 4)), 0x1B);
+    state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);
+    save0 = state0;
+    save1 = state1;
+
+    // Load the message words and convert them into host byte order.
+    w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+    w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+    w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+    w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+
+    // Perform the 64 rounds, 4 at a time.
+    SHA256_ROUNDS_HW(0, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(1, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(2, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(3, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(4, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(5, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(6, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(7, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(8, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(9, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(10, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(11, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(12, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(13, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(14, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(15, w3, w0, w1, w2);
+
+    // Add the compressed chunk to the hash and put it back in ABCDEFGH order.
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+    temp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i *)h, _mm_blend_epi16(temp, state1, 0xF0));
+    _mm_storeu_si128((__m128i *)(h + 4), _mm_alignr_epi8(state1, temp, 8));
+}
+
+#elif defined(SHA256_HW_ARM)
+
+// Performs 4 rounds with the message words in "wa" and then expands the
+// message schedule for the group of rounds that is 4 groups ahead.
+#define SHA256_ROUNDS_HW(g, wa, wb, wc, wd) \
+    do { \
+        wk = vaddq_u32(wa, vld1q_u32(k + (g) * 4)); \
+        if ((g) < 12) \
+            wa = vsha256su1q_u32(vsha256su0q_u32(wa, wb), wc, wd); \
+        temp = state0; \
+        state0 = vsha256hq_u32(state0, state1, wk); \
+        state1 = vsha256h2q_u32(state1, temp, wk); \
+    } while (0)
+
+/**
+ * \brief Processes a single 512-bit chunk using the ARMv8 crypto extensions.
+ *
+ * \param h The hash state.
+ * \param data The 64 bytes of data in the chunk.
+ */
+static void processChunkHW(uint32_t *h, const uint8_t *data)
+{
+    uint32x4_t state0, state1, save0, save1, temp, wk;
+    uint32x4_t w0, w1, w2, w3;
+
+    state0 = save0 = vld1q_u32(h);
+    state1 = save1 = vld1q_u32(h + 4);
+
+    // Load the message words and convert them into host byte order.
+    w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+    w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+    w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+    w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+    // Perform the 64 rounds, 4 at a time.
+    SHA256_ROUNDS_HW(0, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(1, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(2, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(3, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(4, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(5, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(6, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(7, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(8, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(9, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(10, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(11, w3, w0, w1, w2);
+    SHA256_ROUNDS_HW(12, w0, w1, w2, w3);
+    SHA256_ROUNDS_HW(13, w1, w2, w3, w0);
+    SHA256_ROUNDS_HW(14, w2, w3, w0, w1);
+    SHA256_ROUNDS_HW(15, w3, w0, w1, w2);
+
+    // Add the compressed chunk to the current hash value.
+    vst1q_u32(h, vaddq_u32(state0, save0));
+    vst1q_u32(h + 4, vaddq_u32(state1, save1));
+}
+
+#endif
+
+#if CRYPTO_SHA256_ASM_AVR
+
+// The sigma functions in AVR assembly.  Each computes the result in %0
+// with %1 as a temporary.
+
+static inline uint32_t bigSigma0(uint32_t x)
+{
+    uint32_t result, temp;
+    __asm__ (
+        "mov %A0,%A2\n"
+        "mov %B0,%B2\n"
+        "mov %C0,%C2\n"
+        "mov %D0,%D2\n"
+        "bst %A0,0\n"
+        "lsr %D0\n"
+        "ror %C0\n"
+        "ror %B0\n"
+        "ror %A0\n"
+        "bld %D0,7\n"
+        "bst %A0,0\n"
+        "lsr %D0\n"
+        "ror %C0\n"
+        "ror %B0\n"
+        "ror %A0\n"
+        "bld %D0,7\n"
+        "mov %A1,%C2\n"
+        "mov %B1,%D2\n"
+        "mov %C1,%A2\n"
+        "mov %D1,%B2\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        "mov %A1,%D2\n"
+        "mov %B1,%A2\n"
+        "mov %C1,%B2\n"
+        "mov %D1,%C2\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "lsl %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A1,__zero_reg__\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        : "=&r"(result), "=&r"(temp)
+        : "r"(x)
+    );
+    return result;
+}
+
+static inline uint32_t bigSigma1(uint32_t x)
+{
+    uint32_t result, temp;
+    __asm__ (
+        "mov %A0,%B2\n"
+        "mov %B0,%C2\n"
+        "mov %C0,%D2\n"
+        "mov %D0,%A2\n"
+        "lsl %A0\n"
+        "rol %B0\n"
+        "rol %C0\n"
+        "rol %D0\n"
+        "adc %A0,__zero_reg__\n"
+        "lsl %A0\n"
+        "rol %B0\n"
+        "rol %C0\n"
+        "rol %D0\n"
+        "adc %A0,__zero_reg__\n"
+        "mov %A1,%B2\n"
+        "mov %B1,%C2\n"
+        "mov %C1,%D2\n"
+        "mov %D1,%A2\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        "mov %A1,%D2\n"
+        "mov %B1,%A2\n"
+        "mov %C1,%B2\n"
+        "mov %D1,%C2\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        : "=&r"(result), "=&r"(temp)
+        : "r"(x)
+    );
+    return result;
+}
+
+static inline uint32_t smallSigma0(uint32_t x)
+{
+    uint32_t result, temp;
+    __asm__ (
+        "mov %A0,%B2\n"
+        "mov %B0,%C2\n"
+        "mov %C0,%D2\n"
+        "mov %D0,%A2\n"
+        "lsl %A0\n"
+        "rol %B0\n"
+        "rol %C0\n"
+        "rol %D0\n"
+        "adc %A0,__zero_reg__\n"
+        "mov %A1,%C2\n"
+        "mov %B1,%D2\n"
+        "mov %C1,%A2\n"
+        "mov %D1,%B2\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        "mov %A1,%A2\n"
+        "mov %B1,%B2\n"
+        "mov %C1,%C2\n"
+        "mov %D1,%D2\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        : "=&r"(result), "=&r"(temp)
+        : "r"(x)
+    );
+    return result;
+}
+
+static inline uint32_t smallSigma1(uint32_t x)
+{
+    uint32_t result, temp;
+    __asm__ (
+        "mov %A0,%C2\n"
+        "mov %B0,%D2\n"
+        "mov %C0,%A2\n"
+        "mov %D0,%B2\n"
+        "bst %A0,0\n"
+        "lsr %D0\n"
+        "ror %C0\n"
+        "ror %B0\n"
+        "ror %A0\n"
+        "bld %D0,7\n"
+        "mov %A1,%A0\n"
+        "mov %B1,%B0\n"
+        "mov %C1,%C0\n"
+        "mov %D1,%D0\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "bst %A1,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "bld %D1,7\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        "mov %A1,%B2\n"
+        "mov %B1,%C2\n"
+        "mov %C1,%D2\n"
+        "clr %D1\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "eor %A0,%A1\n"
+        "eor %B0,%B1\n"
+        "eor %C0,%C1\n"
+        "eor %D0,%D1\n"
+        : "=&r"(result), "=&r"(temp)
+        : "r"(x)
+    );
+    return result;
+}
+
+#else
+
+static inline uint32_t bigSigma0(uint32_t x)
+{
+    return rightRotate2(x) ^ rightRotate13(x) ^ rightRotate22(x);
+}
+
+static inline uint32_t bigSigma1(uint32_t x)
+{
+    return rightRotate6(x) ^ rightRotate11(x) ^ rightRotate25(x);
+}
+
+static inline uint32_t smallSigma0(uint32_t x)
+{
+    return rightRotate7(x) ^ rightRotate18(x) ^ (x >> 3);
+}
+
+static inline uint32_t smallSigma1(uint32_t x)
+{
+    return rightRotate17(x) ^ rightRotate19(x) ^ (x >> 10);
+}
+
+#endif
+
+#if CRYPTO_SHA256_SSE2
+
+// Right rotation of the four 32-bit words in a vector.
+#define SHA256_VROR(x, n) \
+    _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+
+// Converts four big endian words into host byte order.  SSE2 has no
+// byte shuffle, so swap the bytes in each 16-bit half and then the halves.
+static inline __m128i sha256LoadBE(const uint8_t *data)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)data);
+    x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+}
+
+static inline __m128i sha256VSigma0(__m128i x)
+{
+    return _mm_xor_si128(_mm_xor_si128(SHA256_VROR(x, 7), SHA256_VROR(x, 18)),
+                         _mm_srli_epi32(x, 3));
+}
+
+static inline __m128i sha256VSigma1(__m128i x)
+{
+    return _mm_xor_si128(_mm_xor_si128(SHA256_VROR(x, 17), SHA256_VROR(x, 19)),
+                         _mm_srli_epi32(x, 10));
+}
+
+// Expands the next four words of the message schedule from the previous
+// sixteen in w0..w3.  The last two new words depend on the first two,
+// so the small sigma1 term is added in two halves.
+static inline __m128i sha256Expand(__m128i w0, __m128i w1, __m128i w2, __m128i w3)
+{
+    __m128i w15 = _mm_or_si128(_mm_srli_si128(w0, 4), _mm_slli_si128(w1, 12));
+    __m128i w7 = _mm_or_si128(_mm_srli_si128(w2, 4), _mm_slli_si128(w3, 12));
+    __m128i x = _mm_add_epi32(_mm_add_epi32(w0, sha256VSigma0(w15)), w7);
+    x = _mm_add_epi32(x, sha256VSigma1(_mm_srli_si128(w3, 8)));
+    return _mm_add_epi32(x, sha256VSigma1(_mm_slli_si128(x, 8)));
+}
+
+// Performs a single scalar round with the sum of the message word and
+// round constant in wk[i].
+#define SHA256_ROUND_SSE2(a, b, c, d, e, f, g, h, i) \
+    do { \
+        temp1 = (h) + wk[(i)] + bigSigma1(e) + ((g) ^ ((e) & ((f) ^ (g)))); \
+        temp2 = bigSigma0(a) + (((a) & (b)) | ((c) & ((a) | (b)))); \
+        (d) += temp1; \
+        (h) = temp1 + temp2; \
+    } while (0)
+
+/**
+ * \brief Processes a single 512-bit chunk with the message schedule
+ * expanded by SSE2 instructions.
+ *
+ * \param h The hash state.
+ * \param data The 64 bytes of data in the chunk.
+ *
+ * The next 16 words of the schedule are expanded while the rounds for
+ * the current 16 are performed, so the vector and scalar units overlap.
+ */
+static void processChunkSSE2(uint32_t *h, const uint8_t *data)
+{
+    uint32_t wk[16] __attribute__((aligned(16)));
+    __m128i w0 = sha256LoadBE(data);
+    __m128i w1 = sha256LoadBE(data + 16);
+    __m128i w2 = sha256LoadBE(data + 32);
+    __m128i w3 = sha256LoadBE(data + 48);
+    uint32_t a = h[0];
+    uint32_t b = h[1];
+    uint32_t c = h[2];
+    uint32_t d = h[3];
+    uint32_t e = h[4];
+    uint32_t f = h[5];
+    uint32_t g = h[6];
+    uint32_t hh = h[7];
+    uint32_t temp1, temp2;
+    for (uint8_t round = 0; round < 64; round += 16) {
+        const __m128i *kp = (const __m128i *)(k + round);
+        _mm_store_si128((__m128i *)wk, _mm_add_epi32(w0, _mm_loadu_si128(kp)));
+        _mm_store_si128((__m128i *)(wk + 4), _mm_add_epi32(w1, _mm_loadu_si128(kp + 1)));
+        _mm_store_si128((__m128i *)(wk + 8), _mm_add_epi32(w2, _mm_loadu_si128(kp + 2)));
+        _mm_store_si128((__m128i *)(wk + 12), _mm_add_epi32(w3, _mm_loadu_si128(kp + 3)));
+        if (round < 48) {
+            w0 = sha256Expand(w0, w1, w2, w3);
+            w1 = sha256Expand(w1, w2, w3, w0);
+            w2 = sha256Expand(w2, w3, w0, w1);
+            w3 = sha256Expand(w3, w0, w1, w2);
+        }
+        SHA256_ROUND_SSE2(a, b, c, d, e, f, g, hh, 0);
+        SHA256_ROUND_SSE2(hh, a, b, c, d, e, f, g, 1);
+        SHA256_ROUND_SSE2(g, hh, a, b, c, d, e, f, 2);
+        SHA256_ROUND_SSE2(f, g, hh, a, b, c, d, e, 3);
+        SHA256_ROUND_SSE2(e, f, g, hh, a, b, c, d, 4);
+        SHA256_ROUND_SSE2(d, e, f, g, hh, a, b, c, 5);
+        SHA256_ROUND_SSE2(c, d, e, f, g, hh, a, b, 6);
+        SHA256_ROUND_SSE2(b, c, d, e, f, g, hh, a, 7);
+        SHA256_ROUND_SSE2(a, b, c, d, e, f, g, hh, 8);
+        SHA256_ROUND_SSE2(hh, a, b, c, d, e, f, g, 9);
+        SHA256_ROUND_SSE2(g, hh, a, b, c, d, e, f, 10);
+        SHA256_ROUND_SSE2(f, g, hh, a, b, c, d, e, 11);
+        SHA256_ROUND_SSE2(e, f, g, hh, a, b, c, d, 12);
+        SHA256_ROUND_SSE2(d, e, f, g, hh, a, b, c, 13);
+        SHA256_ROUND_SSE2(c, d, e, f, g, hh, a, b, 14);
+        SHA256_ROUND_SSE2(b, c, d, e, f, g, hh, a, 15);
+    }
+
+    // Add the compressed chunk to the current hash value.
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+
+    // Clean up the message words on the stack.
+    clean(wk, sizeof(wk));
+    w0 = w1 = w2 = w3 = _mm_setzero_si128();
+    a = b = c = d = e = f = g = hh = temp1 = temp2 = 0;
+}
+
+#endif // CRYPTO_SHA256_SSE2
+
+#if CRYPTO_SHA256_UNROLL
+
+// Performs a single SHA-256 round with the round constant K inline.
+// Rather than moving the working variables along after each round,
+// the caller rotates the names of the variables that it passes in.
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, w, K) \
+    do { \
+        temp1 = (h) + (K) + (w) + \
+                bigSigma1(e) + \
+                (((e) & (f)) ^ ((~(e)) & (g))); \
+        temp2 = bigSigma0(a) + \
+                (((a) & (b)) ^ ((a) & (c)) ^ ((b) & (c))); \
+        (d) += temp1; \
+        (h) = temp1 + temp2; \
+    } while (0)
+
+// Expands the message schedule in-place in the "w" array for round i.
+#define SHA256_EXPAND(i) \
+    (state.w[(i) & 0x0F] += \
+        state.w[((i) - 7) & 0x0F] + \
+        smallSigma0(state.w[((i) - 15) & 0x0F]) + \
+        smallSigma1(state.w[((i) - 2) & 0x0F]))
+
+#endif
+
 /**
  * \brief Processes a single 512-bit chunk with the core SHA-256 algorithm.
  *
@@ -162,25 +787,19 @@ void SHA256::finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t has
  */
 void SHA256::processChunk()
 {
-    // Round constants for SHA-256.
-    static uint32_t const k[64] PROGMEM = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+    // Use the SHA instructions if the processor has them.
+    if (selected == Hardware && cpuHasShaExt()) {
+        processChunkHW(state.h, (const uint8_t *)state.w);
+        return;
+    }
+#endif
+#if CRYPTO_SHA256_SSE2
+    if (selected != Portable) {
+        processChunkSSE2(state.h, (const uint8_t *)state.w);
+        return;
+    }
+#endif
 
     // Convert the first 16 words from big endian to host byte order.
     uint8_t index;
@@ -197,13 +816,81 @@ void SHA256::processChunk()
     uint32_t g = state.h[6];
     uint32_t h = state.h[7];
 
-    // Perform the first 16 rounds of the compression function main loop.
     uint32_t temp1, temp2;
+#if CRYPTO_SHA256_UNROLL
+    // Perform all 64 rounds with the message schedule expanded
+    // in-place in the "w" array as we go.
+    SHA256_ROUND(a, b, c, d, e, f, g, h, state.w[0], 0x428a2f98);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, state.w[1], 0x71374491);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, state.w[2], 0xb5c0fbcf);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, state.w[3], 0xe9b5dba5);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, state.w[4], 0x3956c25b);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, state.w[5], 0x59f111f1);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, state.w[6], 0x923f82a4);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, state.w[7], 0xab1c5ed5);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, state.w[8], 0xd807aa98);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, state.w[9], 0x12835b01);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, state.w[10], 0x243185be);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, state.w[11], 0x550c7dc3);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, state.w[12], 0x72be5d74);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, state.w[13], 0x80deb1fe);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, state.w[14], 0x9bdc06a7);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, state.w[15], 0xc19bf174);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(16), 0xe49b69c1);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(17), 0xefbe4786);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(18), 0x0fc19dc6);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(19), 0x240ca1cc);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(20), 0x2de92c6f);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(21), 0x4a7484aa);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(22), 0x5cb0a9dc);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(23), 0x76f988da);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(24), 0x983e5152);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(25), 0xa831c66d);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(26), 0xb00327c8);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(27), 0xbf597fc7);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(28), 0xc6e00bf3);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(29), 0xd5a79147);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(30), 0x06ca6351);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(31), 0x14292967);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(32), 0x27b70a85);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(33), 0x2e1b2138);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(34), 0x4d2c6dfc);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(35), 0x53380d13);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(36), 0x650a7354);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(37), 0x766a0abb);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(38), 0x81c2c92e);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(39), 0x92722c85);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(40), 0xa2bfe8a1);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(41), 0xa81a664b);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(42), 0xc24b8b70);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(43), 0xc76c51a3);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(44), 0xd192e819);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(45), 0xd6990624);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(46), 0xf40e3585);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(47), 0x106aa070);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(48), 0x19a4c116);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(49), 0x1e376c08);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(50), 0x2748774c);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(51), 0x34b0bcb5);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(52), 0x391c0cb3);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(53), 0x4ed8aa4a);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(54), 0x5b9cca4f);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(55), 0x682e6ff3);
+    SHA256_ROUND(a, b, c, d, e, f, g, h, SHA256_EXPAND(56), 0x748f82ee);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, SHA256_EXPAND(57), 0x78a5636f);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, SHA256_EXPAND(58), 0x84c87814);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, SHA256_EXPAND(59), 0x8cc70208);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, SHA256_EXPAND(60), 0x90befffa);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, SHA256_EXPAND(61), 0xa4506ceb);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, SHA256_EXPAND(62), 0xbef9a3f7);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, SHA256_EXPAND(63), 0xc67178f2);
+#else
+    // Perform the first 16 rounds of the compression function main loop.
     for (index = 0; index < 16; ++index) {
         temp1 = h + pgm_read_dword(k + index) + state.w[index] +
-                (rightRotate6(e) ^ rightRotate11(e) ^ rightRotate25(e)) +
+                bigSigma1(e) +
                 ((e & f) ^ ((~e) & g));
-        temp2 = (rightRotate2(a) ^ rightRotate13(a) ^ rightRotate22(a)) +
+        temp2 = bigSigma0(a) +
                 ((a & b) ^ (a & c) ^ (b & c));
         h = g;
         g = f;
@@ -224,14 +911,14 @@ void SHA256::processChunk()
         temp2 = state.w[(index - 2) & 0x0F];
         temp1 = state.w[index & 0x0F] =
             state.w[(index - 16) & 0x0F] + state.w[(index - 7) & 0x0F] +
-                (rightRotate7(temp1) ^ rightRotate18(temp1) ^ (temp1 >> 3)) +
-                (rightRotate17(temp2) ^ rightRotate19(temp2) ^ (temp2 >> 10));
+                smallSigma0(temp1) +
+                smallSigma1(temp2);
 
         // Perform the round.
         temp1 = h + pgm_read_dword(k + index) + temp1 +
-                (rightRotate6(e) ^ rightRotate11(e) ^ rightRotate25(e)) +
+                bigSigma1(e) +
                 ((e & f) ^ ((~e) & g));
-        temp2 = (rightRotate2(a) ^ rightRotate13(a) ^ rightRotate22(a)) +
+        temp2 = bigSigma0(a) +
                 ((a & b) ^ (a & c) ^ (b & c));
         h = g;
         g = f;
@@ -242,6 +929,7 @@ void SHA256::processChunk()
         b = a;
         a = temp1 + temp2;
     }
+#endif
 
     // Add the compressed chunk to the current hash value.
     state.h[0] += a;
@@ -256,3 +944,84 @@ void SHA256::processChunk()
     // Attempt to clean up the stack.
     a = b = c = d = e = f = g = h = temp1 = temp2 = 0;
 }
+
+/**
+ * \enum SHA256::Implementation
+ * \brief Implementation of the SHA-256 compression function.
+ *
+ * \sa implementation(), setImplementation()
+ */
+
+/**
+ * \var SHA256::Portable
+ * \brief Portable C++ code, which is the default on platforms without
+ * vector or SHA instructions.
+ */
+
+/**
+ * \var SHA256::Vector
+ * \brief Scalar rounds with the message schedule expanded by SSE2
+ * instructions, which is the default on x86 processors without the
+ * SHA extensions.
+ */
+
+/**
+ * \var SHA256::Hardware
+ * \brief SHA instructions on x86 and ARMv8, which are the default when
+ * they are available.
+ */
+
+/**
+ * \brief Returns the implementation of the compression function that is
+ * in use.
+ *
+ * \sa setImplementation()
+ */
+SHA256::Implementation SHA256::implementation()
+{
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+    if (selected == Hardware && !cpuHasShaExt())
+        return CRYPTO_SHA256_SSE2 ? Vector : Portable;
+#endif
+    return (Implementation)selected;
+}
+
+/**
+ * \brief Selects the implementation of the compression function to use.
+ *
+ * \param impl The implementation to use.
+ * \return Returns false if \a impl is not available on this platform,
+ * in which case the previous implementation remains selected.
+ *
+ * The selection applies to all SHA256 objects.  It is intended for
+ * comparing the implementations in tests and benchmarks; normal
+ * applications should leave it at the default.  Portable is always
+ * available.  Vector is available on x86 unless CRYPTO_SHA256_SSE2 is 0,
+ * and Hardware is available if the processor has SHA instructions and
+ * CRYPTO_SHA256_HW is not 0.
+ *
+ * \sa implementation()
+ */
+bool SHA256::setImplementation(Implementation impl)
+{
+    switch (impl) {
+    case Portable:
+        break;
+    case Vector:
+        if (!CRYPTO_SHA256_SSE2)
+            return false;
+        break;
+    case Hardware:
+#if defined(SHA256_HW_X86) || defined(SHA256_HW_ARM)
+        if (!cpuHasShaExt())
+            return false;
+        break;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+    selected = impl;
+    return true;
+}
@@ -25,12 +25,39 @@
 
 #include "Hash.h"
 
+// Use the SHA instructions on x86 and ARMv8 processors to process chunks
+// when they are available.  Set to 0 to always use the portable code.
+#if !defined(CRYPTO_SHA256_HW)
+#define CRYPTO_SHA256_HW 1
+#endif
+
+// Use SSE2 vector instructions to expand the message schedule on x86
+// processors that do not have the SHA extensions.  Set to 0 to use the
+// portable code on those processors instead.
+#if !defined(CRYPTO_SHA256_SSE2)
+#if defined(__SSE2__)
+#define CRYPTO_SHA256_SSE2 1
+#else
+#define CRYPTO_SHA256_SSE2 0
+#endif
+#endif
+
 class SHA256 : public Hash
 {
 public:
     SHA256();
     virtual ~SHA256();
 
+    enum Implementation
+    {
+        Portable,
+        Vector,
+        Hardware
+    };
+
+    static Implementation implementation();
+    static bool setImplementation(Implementation impl);
+
     size_t hashSize() const;
     size_t blockSize() const;
 
@@ -40,6 +67,8 @@ public:
 
     void clear();
 
+    void copyState(const Hash &other);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
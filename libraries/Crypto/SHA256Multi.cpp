@@ -0,0 +1,579 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SHA256Multi.h"
+#include "SHA256.h"
+#include "Crypto.h"
+#include "utility/RotateUtil.h"
+#include "utility/ProgMemUtil.h"
+#include <string.h>
+
+/**
+ * \class SHA256MultiCommon SHA256Multi.h <SHA256Multi.h>
+ * \brief Common base class for multi-lane SHA-256 engines.
+ *
+ * A single SHA-256 computation is a long serial dependency chain, so a
+ * processor spends much of its time waiting for the previous round.
+ * This class hashes several independent messages in lockstep, one per
+ * "lane", so that the operations for all lanes in a round can proceed in
+ * parallel in SIMD registers or in the processor's pipeline.  The lane
+ * state is stored transposed so that each step of a round is a simple
+ * loop across the lanes, which compilers can vectorize.
+ *
+ * Messages are described by SHA256Job structures and submitted with
+ * submit().  When all lanes are busy, submit() runs the lanes until one
+ * of the messages has been hashed and returns the finished job.  Call
+ * flush() at the end to retrieve the remaining jobs:
+ *
+ * \code
+ * SHA256x4 engine;
+ * SHA256Job jobs[NUM_PACKETS];
+ * SHA256Job *done;
+ * for (size_t index = 0; index < NUM_PACKETS; ++index) {
+ *     jobs[index].data = packets[index].data;
+ *     jobs[index].len = packets[index].len;
+ *     jobs[index].key = hmacKey;
+ *     jobs[index].keyLen = sizeof(hmacKey);
+ *     if ((done = engine.submit(&jobs[index])) != 0)
+ *         deliver(done);
+ * }
+ * while ((done = engine.flush()) != 0)
+ *     deliver(done);
+ * \endcode
+ *
+ * The engine works best when the messages are of similar length, because
+ * a lane that finishes early sits idle until a new job is submitted.
+ * Jobs may complete in a different order from the one they were
+ * submitted in.
+ *
+ * Use SHA256x4 or SHA256x8 to create an engine with a specific number
+ * of lanes.  The engines are intended for 32-bit and 64-bit platforms;
+ * on AVR the regular SHA256 class will be faster and use less memory.
+ * The speedup depends upon the compiler vectorizing the loops across the
+ * lanes (e.g. -O3 with gcc).  On x86-64 with SSE2, SHA256x8 is about
+ * twice as fast as SHA256 for short messages but SHA256x4 is no faster
+ * because the vector unit has no rotate instruction.
+ *
+ * \sa SHA256x4, SHA256x8, SHA256
+ */
+
+/**
+ * \class SHA256x4 SHA256Multi.h <SHA256Multi.h>
+ * \brief SHA-256 engine that hashes up to 4 messages in lockstep.
+ *
+ * \sa SHA256MultiCommon, SHA256x8
+ */
+
+/**
+ * \class SHA256x8 SHA256Multi.h <SHA256Multi.h>
+ * \brief SHA-256 engine that hashes up to 8 messages in lockstep.
+ *
+ * \sa SHA256MultiCommon, SHA256x4
+ */
+
+/**
+ * \struct SHA256Job SHA256Multi.h <SHA256Multi.h>
+ * \brief Describes a message to be hashed by a SHA256MultiCommon engine.
+ *
+ * The caller fills in \a data, \a len, \a key, and \a keyLen before the
+ * job is submitted.  The \a data and \a key buffers must remain valid
+ * until the job has been returned by SHA256MultiCommon::submit() or
+ * SHA256MultiCommon::flush().
+ */
+
+/**
+ * \var SHA256Job::data
+ * \brief Points to the message to be hashed.
+ */
+
+/**
+ * \var SHA256Job::len
+ * \brief Number of bytes in the message.
+ */
+
+/**
+ * \var SHA256Job::key
+ * \brief Points to the HMAC key, or NULL to compute a plain SHA-256 hash.
+ */
+
+/**
+ * \var SHA256Job::keyLen
+ * \brief Number of bytes in the HMAC key.
+ */
+
+/**
+ * \var SHA256Job::hash
+ * \brief Returns the SHA-256 hash or HMAC-SHA256 value when the job
+ * is finished.
+ */
+
+// Processing phases for each lane.
+#define PHASE_IDLE      0   // Lane is not in use.
+#define PHASE_PLAIN     1   // Computing a plain hash.
+#define PHASE_PREFIX    2   // Computing a plain hash with a prefix byte.
+#define PHASE_INNER     3   // Computing the inner hash of an HMAC.
+#define PHASE_OUTER     4   // Computing the outer hash of an HMAC.
+#define PHASE_DONE      5   // Job is finished but not returned yet.
+
+// Number of bytes that are hashed before the message in a phase.
+#define PHASE_HEADER(phase) \
+    ((phase) == PHASE_PLAIN ? 0 : (phase) == PHASE_PREFIX ? 1 : 64)
+
+/**
+ * \brief Constructs a new multi-lane SHA-256 engine.
+ *
+ * The subclass must call setLanes() to provide the lane storage.
+ */
+SHA256MultiCommon::SHA256MultiCommon()
+    : lane(0)
+    , h(0)
+    , w(0)
+    , count(0)
+{
+}
+
+/**
+ * \brief Destroys this multi-lane SHA-256 engine after clearing
+ * sensitive information.
+ */
+SHA256MultiCommon::~SHA256MultiCommon()
+{
+    clear();
+}
+
+/**
+ * \fn uint8_t SHA256MultiCommon::lanes() const
+ * \brief Returns the number of lanes in this engine.
+ */
+
+/**
+ * \brief Submits a new job to this engine.
+ *
+ * \param job The job to submit.
+ * \return Returns a finished job, or NULL if no job has finished yet.
+ *
+ * If there is a free lane after \a job has been placed, then this function
+ * returns immediately without hashing anything.  Otherwise, all lanes are
+ * run until at least one of them has finished and that job is returned.
+ * The returned job may not be the same as \a job.
+ *
+ * \sa flush()
+ */
+SHA256Job *SHA256MultiCommon::submit(SHA256Job *job)
+{
+    uint8_t index = freeLane();
+    if (index >= count)
+        return 0;   // Cannot happen unless the lanes were never set up.
+
+    // Format the HMAC key if necessary and start the first hash.
+    Lane &l = lane[index];
+    l.job = job;
+    if (job->key) {
+        if (job->keyLen <= 64) {
+            memcpy(l.key, job->key, job->keyLen);
+            memset(l.key + job->keyLen, 0, 64 - job->keyLen);
+        } else {
+            SHA256 hash;
+            hash.update(job->key, job->keyLen);
+            hash.finalize(l.key, 32);
+            memset(l.key + 32, 0, 32);
+        }
+        startLane(index, (const uint8_t *)(job->data), job->len, PHASE_INNER);
+    } else {
+        startLane(index, (const uint8_t *)(job->data), job->len, PHASE_PLAIN);
+    }
+    return runIfBusy();
+}
+
+/**
+ * \brief Submits a new job to this engine to hash a prefix byte followed
+ * by the job's message.
+ *
+ * \param job The job to submit.
+ * \param prefix The byte to hash before the message.
+ * \return Returns a finished job, or NULL if no job has finished yet.
+ *
+ * The hash is SHA-256(prefix || data), which saves copying the message
+ * to prepend a domain separation byte, as in Merkle trees.  The HMAC key
+ * fields of \a job are ignored.
+ *
+ * \sa submit(SHA256Job *), flush()
+ */
+SHA256Job *SHA256MultiCommon::submit(SHA256Job *job, uint8_t prefix)
+{
+    uint8_t index = freeLane();
+    if (index >= count)
+        return 0;
+    Lane &l = lane[index];
+    l.job = job;
+    l.key[0] = prefix;
+    startLane(index, (const uint8_t *)(job->data), job->len, PHASE_PREFIX);
+    return runIfBusy();
+}
+
+/**
+ * \brief Flushes a job from this engine.
+ *
+ * \return Returns a finished job, or NULL if there are no more jobs.
+ *
+ * This function runs the lanes that are still busy until at least one
+ * of them has finished and then returns that job.  It should be called
+ * repeatedly until it returns NULL to retrieve all outstanding jobs.
+ *
+ * \sa submit()
+ */
+SHA256Job *SHA256MultiCommon::flush()
+{
+    return run();
+}
+
+/**
+ * \brief Clears all security-sensitive state from this engine and
+ * abandons any jobs that are still in progress.
+ */
+void SHA256MultiCommon::clear()
+{
+    if (count) {
+        clean(lane, sizeof(Lane) * count);
+        clean(h, sizeof(uint32_t) * 8 * count);
+        clean(w, sizeof(uint32_t) * 16 * count);
+    }
+}
+
+/**
+ * \brief Sets the storage to use for the lanes in this engine.
+ *
+ * \param lanes Array of \a count lane descriptors.
+ * \param h Array of 8 * \a count words for the hash state.
+ * \param w Array of 16 * \a count words for the message schedule.
+ * \param count The number of lanes, which must be 4 or 8.
+ *
+ * This function is called by the subclass constructor.
+ */
+void SHA256MultiCommon::setLanes(Lane *lanes, uint32_t *h, uint32_t *w,
+                                 uint8_t count)
+{
+    this->lane = lanes;
+    this->h = h;
+    this->w = w;
+    this->count = count;
+    clear();
+}
+
+/**
+ * \brief Starts hashing a new message in a lane.
+ *
+ * \param index The index of the lane.
+ * \param data Points to the message data.
+ * \param len The number of bytes of message data.
+ * \param phase The processing phase to start.
+ */
+void SHA256MultiCommon::startLane(uint8_t index, const uint8_t *data,
+                                  size_t len, uint8_t phase)
+{
+    static uint32_t const iv[8] PROGMEM = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    Lane &l = lane[index];
+    size_t total = len + PHASE_HEADER(phase);
+    l.data = data;
+    l.len = len;
+    l.block = 0;
+    l.blocks = (total + 8) / 64 + 1;
+    l.phase = phase;
+    for (uint8_t posn = 0; posn < 8; ++posn)
+        h[posn * count + index] = pgm_read_dword(iv + posn);
+}
+
+/**
+ * \brief Loads 64 bytes into the message schedule for a lane.
+ *
+ * \param w Points to the first word for the lane in the message schedule.
+ * \param stride The number of lanes.
+ * \param src The 64 bytes to load, in big-endian order.
+ */
+static void loadWords(uint32_t *w, uint8_t stride, const uint8_t *src)
+{
+    for (uint8_t posn = 0; posn < 16; ++posn, src += 4, w += stride) {
+        *w = (((uint32_t)(src[0])) << 24) | (((uint32_t)(src[1])) << 16) |
+             (((uint32_t)(src[2])) << 8) | ((uint32_t)(src[3]));
+    }
+}
+
+/**
+ * \brief Loads the next block of a lane's message into the message schedule.
+ *
+ * \param index The index of the lane.
+ *
+ * Blocks that are entirely within the caller's message are loaded
+ * directly.  Otherwise the block is assembled from the HMAC key block
+ * or prefix byte, the message, the padding, and the bit length.
+ */
+void SHA256MultiCommon::loadBlock(uint8_t index)
+{
+    Lane &l = lane[index];
+    size_t pre = PHASE_HEADER(l.phase);
+    size_t posn = l.block * 64;
+    if (posn >= pre && (posn - pre + 64) <= l.len) {
+        loadWords(w + index, count, l.data + (posn - pre));
+        return;
+    }
+
+    uint8_t temp[64];
+    uint8_t i = 0;
+    memset(temp, 0, sizeof(temp));
+    if (posn < pre) {
+        // The HMAC key block or the prefix byte always starts the
+        // first block of the message.
+        if (l.phase == PHASE_PREFIX) {
+            temp[0] = l.key[0];
+            i = 1;
+        } else {
+            uint8_t pad = (l.phase == PHASE_OUTER) ? 0x5C : 0x36;
+            for (; i < 64; ++i)
+                temp[i] = l.key[i] ^ pad;
+        }
+    }
+    if (i < 64) {
+        // Copy the tail of the message and add the padding.
+        size_t offset = posn + i - pre;
+        if (offset <= l.len) {
+            size_t len = l.len - offset;
+            if (len > (size_t)(64 - i))
+                len = 64 - i;
+            memcpy(temp + i, l.data + offset, len);
+            if ((i + len) < 64)
+                temp[i + len] = 0x80;
+        }
+        if ((l.block + 1) == l.blocks) {
+            uint64_t bits = ((uint64_t)(pre + l.len)) << 3;
+            for (i = 0; i < 8; ++i)
+                temp[63 - i] = (uint8_t)(bits >> (i * 8));
+        }
+    }
+    loadWords(w + index, count, temp);
+    clean(temp);
+}
+
+/**
+ * \brief Finishes the current message in a lane.
+ *
+ * \param index The index of the lane.
+ *
+ * If the lane has just finished the inner hash of an HMAC, then the
+ * outer hash is started.  Otherwise the result is written to the job.
+ */
+void SHA256MultiCommon::finishLane(uint8_t index)
+{
+    Lane &l = lane[index];
+    uint8_t *out = (l.phase == PHASE_INNER) ? l.inner : l.job->hash;
+    for (uint8_t posn = 0; posn < 8; ++posn, out += 4) {
+        uint32_t value = h[posn * count + index];
+        out[0] = (uint8_t)(value >> 24);
+        out[1] = (uint8_t)(value >> 16);
+        out[2] = (uint8_t)(value >> 8);
+        out[3] = (uint8_t)value;
+    }
+    if (l.phase == PHASE_INNER)
+        startLane(index, l.inner, 32, PHASE_OUTER);
+    else
+        l.phase = PHASE_DONE;
+}
+
+// Round constants for SHA-256.
+static uint32_t const k[64] PROGMEM = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Expands word i of the message schedule for all lanes.
+#define SHA256_EXPAND(i) \
+    do { \
+        for (lane = 0; lane < N; ++lane) { \
+            uint32_t t1 = w[(((i) - 15) & 0x0F) * N + lane]; \
+            uint32_t t2 = w[(((i) - 2) & 0x0F) * N + lane]; \
+            w[((i) & 0x0F) * N + lane] += \
+                w[(((i) - 7) & 0x0F) * N + lane] + \
+                (rightRotate7(t1) ^ rightRotate18(t1) ^ (t1 >> 3)) + \
+                (rightRotate17(t2) ^ rightRotate19(t2) ^ (t2 >> 10)); \
+        } \
+    } while (0)
+
+// Performs round i for all lanes.  The working variables are rotated
+// by renaming the rows of "s" rather than by moving the values around.
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i) \
+    do { \
+        uint32_t kval = pgm_read_dword(k + (i)); \
+        for (lane = 0; lane < N; ++lane) { \
+            uint32_t ev = s[e][lane]; \
+            uint32_t av = s[a][lane]; \
+            uint32_t t1 = s[h][lane] + kval + w[((i) & 0x0F) * N + lane] + \
+                (rightRotate6(ev) ^ rightRotate11(ev) ^ rightRotate25(ev)) + \
+                ((ev & s[f][lane]) ^ ((~ev) & s[g][lane])); \
+            uint32_t t2 = \
+                (rightRotate2(av) ^ rightRotate13(av) ^ rightRotate22(av)) + \
+                ((av & s[b][lane]) ^ (av & s[c][lane]) ^ \
+                 (s[b][lane] & s[c][lane])); \
+            s[d][lane] += t1; \
+            s[h][lane] = t1 + t2; \
+        } \
+    } while (0)
+
+/**
+ * \brief Compresses one block for every lane.
+ *
+ * \param h The transposed hash state, 8 rows of N words.
+ * \param w The transposed message schedule, 16 rows of N words.
+ */
+template <uint8_t N>
+static void compressLanes(uint32_t *h, uint32_t *w)
+{
+    uint32_t s[8][N];
+    uint8_t index, lane;
+
+    memcpy(s, h, sizeof(s));
+    for (index = 0; index < 64; index += 8) {
+        if (index >= 16) {
+            SHA256_EXPAND(index);
+            SHA256_ROUND(0, 1, 2, 3, 4, 5, 6, 7, index);
+            SHA256_EXPAND(index + 1);
+            SHA256_ROUND(7, 0, 1, 2, 3, 4, 5, 6, index + 1);
+            SHA256_EXPAND(index + 2);
+            SHA256_ROUND(6, 7, 0, 1, 2, 3, 4, 5, index + 2);
+            SHA256_EXPAND(index + 3);
+            SHA256_ROUND(5, 6, 7, 0, 1, 2, 3, 4, index + 3);
+            SHA256_EXPAND(index + 4);
+            SHA256_ROUND(4, 5, 6, 7, 0, 1, 2, 3, index + 4);
+            SHA256_EXPAND(index + 5);
+            SHA256_ROUND(3, 4, 5, 6, 7, 0, 1, 2, index + 5);
+            SHA256_EXPAND(index + 6);
+            SHA256_ROUND(2, 3, 4, 5, 6, 7, 0, 1, index + 6);
+            SHA256_EXPAND(index + 7);
+            SHA256_ROUND(1, 2, 3, 4, 5, 6, 7, 0, index + 7);
+        } else {
+            SHA256_ROUND(0, 1, 2, 3, 4, 5, 6, 7, index);
+            SHA256_ROUND(7, 0, 1, 2, 3, 4, 5, 6, index + 1);
+            SHA256_ROUND(6, 7, 0, 1, 2, 3, 4, 5, index + 2);
+            SHA256_ROUND(5, 6, 7, 0, 1, 2, 3, 4, index + 3);
+            SHA256_ROUND(4, 5, 6, 7, 0, 1, 2, 3, index + 4);
+            SHA256_ROUND(3, 4, 5, 6, 7, 0, 1, 2, index + 5);
+            SHA256_ROUND(2, 3, 4, 5, 6, 7, 0, 1, index + 6);
+            SHA256_ROUND(1, 2, 3, 4, 5, 6, 7, 0, index + 7);
+        }
+    }
+    for (index = 0; index < 8; ++index) {
+        for (lane = 0; lane < N; ++lane)
+            h[index * N + lane] += s[index][lane];
+    }
+    clean(s);
+}
+
+/**
+ * \brief Finds a lane that is not in use.
+ *
+ * \return Returns the index of the lane, or lanes() if all are busy.
+ */
+uint8_t SHA256MultiCommon::freeLane() const
+{
+    uint8_t index;
+    for (index = 0; index < count; ++index) {
+        if (lane[index].phase == PHASE_IDLE)
+            break;
+    }
+    return index;
+}
+
+/**
+ * \brief Runs the lanes if they are all busy.
+ *
+ * \return Returns a finished job, or NULL if a lane is still free.
+ */
+SHA256Job *SHA256MultiCommon::runIfBusy()
+{
+    if (freeLane() < count)
+        return 0;
+    return run();
+}
+
+/**
+ * \brief Runs the busy lanes until at least one job has finished.
+ *
+ * \return Returns a finished job, or NULL if all lanes are idle.
+ */
+SHA256Job *SHA256MultiCommon::run()
+{
+    uint8_t index;
+    for (;;) {
+        // Return a finished job if there is one.
+        for (index = 0; index < count; ++index) {
+            Lane &l = lane[index];
+            if (l.phase == PHASE_DONE) {
+                SHA256Job *job = l.job;
+                clean(l.key);
+                clean(l.inner);
+                l.job = 0;
+                l.phase = PHASE_IDLE;
+                return job;
+            }
+        }
+
+        // Load the next block for all busy lanes.  Idle lanes compress
+        // whatever is left in their part of the schedule and are ignored.
+        bool busy = false;
+        for (index = 0; index < count; ++index) {
+            if (lane[index].phase != PHASE_IDLE) {
+                loadBlock(index);
+                busy = true;
+            }
+        }
+        if (!busy)
+            return 0;
+
+        // Compress the blocks for all lanes at once.
+        if (count == 8)
+            compressLanes<8>(h, w);
+        else
+            compressLanes<4>(h, w);
+
+        // Check for lanes that have reached the end of their message.
+        for (index = 0; index < count; ++index) {
+            Lane &l = lane[index];
+            if (l.phase != PHASE_IDLE && ++(l.block) == l.blocks)
+                finishLane(index);
+        }
+    }
+}
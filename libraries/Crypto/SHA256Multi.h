@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_SHA256MULTI_h
+#define CRYPTO_SHA256MULTI_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+struct SHA256Job
+{
+    const void *data;
+    size_t len;
+    const void *key;
+    size_t keyLen;
+    uint8_t hash[32];
+};
+
+class SHA256MultiCommon
+{
+public:
+    virtual ~SHA256MultiCommon();
+
+    uint8_t lanes() const { return count; }
+
+    SHA256Job *submit(SHA256Job *job);
+    SHA256Job *submit(SHA256Job *job, uint8_t prefix);
+    SHA256Job *flush();
+
+    void clear();
+
+protected:
+    struct Lane
+    {
+        SHA256Job *job;
+        const uint8_t *data;
+        size_t len;
+        size_t block;
+        size_t blocks;
+        uint8_t phase;
+        uint8_t key[64];
+        uint8_t inner[32];
+    };
+
+    SHA256MultiCommon();
+    void setLanes(Lane *lanes, uint32_t *h, uint32_t *w, uint8_t count);
+
+private:
+    Lane *lane;
+    uint32_t *h;
+    uint32_t *w;
+    uint8_t count;
+
+    void startLane(uint8_t index, const uint8_t *data, size_t len,
+                   uint8_t phase);
+    void loadBlock(uint8_t index);
+    void finishLane(uint8_t index);
+    uint8_t freeLane() const;
+    SHA256Job *runIfBusy();
+    SHA256Job *run();
+};
+
+class SHA256x4 : public SHA256MultiCommon
+{
+public:
+    SHA256x4() { setLanes(l, hv, wv, 4); }
+
+private:
+    Lane l[4];
+    uint32_t hv[8 * 4];
+    uint32_t wv[16 * 4];
+};
+
+class SHA256x8 : public SHA256MultiCommon
+{
+public:
+    SHA256x8() { setLanes(l, hv, wv, 8); }
+
+private:
+    Lane l[8];
+    uint32_t hv[8 * 8];
+    uint32_t wv[16 * 8];
+};
+
+#endif
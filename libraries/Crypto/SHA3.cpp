@@ -80,6 +80,11 @@ void SHA3_256::clear()
     core.clear();
 }
 
+void SHA3_256::copyState(const Hash &other)
+{
+    core = static_cast<const SHA3_256 &>(other).core;
+}
+
 void SHA3_256::resetHMAC(const void *key, size_t keyLen)
 {
     core.setHMACKey(key, keyLen, 0x36, 32);
@@ -152,6 +157,11 @@ void SHA3_512::clear()
     core.clear();
 }
 
+void SHA3_512::copyState(const Hash &other)
+{
+    core = static_cast<const SHA3_512 &>(other).core;
+}
+
 void SHA3_512::resetHMAC(const void *key, size_t keyLen)
 {
     core.setHMACKey(key, keyLen, 0x36, 64);
@@ -41,6 +41,8 @@ public:
 
     void clear();
 
+    void copyState(const Hash &other);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
@@ -63,6 +65,8 @@ public:
 
     void clear();
 
+    void copyState(const Hash &other);
+
     void resetHMAC(const void *key, size_t keyLen);
     void finalizeHMAC(const void *key, size_t keyLen, void *hash, size_t hashLen);
 
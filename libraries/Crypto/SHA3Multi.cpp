@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SHA3Multi.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class SHA3_256x4 SHA3Multi.h <SHA3Multi.h>
+ * \brief SHA3-256 engine that hashes up to 4 messages in lockstep.
+ *
+ * This class hashes four independent messages at once on top of
+ * KeccakCoreX4, which permutes the four sponge states together in SIMD
+ * registers.  It is intended for hashing large numbers of short messages,
+ * such as the leaves of a Merkle tree.
+ *
+ * Messages are described by SHA3Job structures and submitted with
+ * submit(), in the same way as for SHA256MultiCommon.  When all lanes are
+ * busy, submit() runs the lanes until one of the messages has been hashed
+ * and returns the finished job.  Call flush() at the end to retrieve the
+ * remaining jobs:
+ *
+ * \code
+ * SHA3_256x4 engine;
+ * SHA3Job jobs[NUM_LEAVES];
+ * SHA3Job *done;
+ * for (size_t index = 0; index < NUM_LEAVES; ++index) {
+ *     jobs[index].data = leaves[index].data;
+ *     jobs[index].len = leaves[index].len;
+ *     if ((done = engine.submit(&jobs[index])) != 0)
+ *         deliver(done);
+ * }
+ * while ((done = engine.flush()) != 0)
+ *     deliver(done);
+ * \endcode
+ *
+ * The engine works best when the messages are of similar length, because
+ * a lane that finishes early sits idle until a new job is submitted.
+ * Jobs may complete in a different order from the one they were
+ * submitted in.
+ *
+ * \sa SHA3_256, KeccakCoreX4, SHA256MultiCommon
+ */
+
+/**
+ * \struct SHA3Job SHA3Multi.h <SHA3Multi.h>
+ * \brief Describes a message to be hashed by a SHA3_256x4 engine.
+ *
+ * The caller fills in \a data and \a len before the job is submitted.
+ * The \a data buffer must remain valid until the job has been returned
+ * by SHA3_256x4::submit() or SHA3_256x4::flush().
+ */
+
+/**
+ * \var SHA3Job::data
+ * \brief Points to the message to be hashed.
+ */
+
+/**
+ * \var SHA3Job::len
+ * \brief Number of bytes in the message.
+ */
+
+/**
+ * \var SHA3Job::hash
+ * \brief Returns the SHA3-256 hash when the job is finished.
+ */
+
+// Processing phases for each lane.
+#define PHASE_IDLE      0   // Lane is not in use.
+#define PHASE_BUSY      1   // Computing a hash.
+#define PHASE_DONE      2   // Job is finished but not returned yet.
+
+/**
+ * \brief Constructs a new four-lane SHA3-256 engine.
+ */
+SHA3_256x4::SHA3_256x4()
+{
+    core.setCapacity(512);
+    memset(lane, 0, sizeof(lane));
+}
+
+/**
+ * \brief Destroys this engine after clearing sensitive information.
+ */
+SHA3_256x4::~SHA3_256x4()
+{
+    clean(lane);
+}
+
+/**
+ * \fn uint8_t SHA3_256x4::lanes() const
+ * \brief Returns the number of lanes in this engine, which is always 4.
+ */
+
+/**
+ * \brief Submits a new job to this engine.
+ *
+ * \param job The job to submit.
+ * \return Returns a finished job, or NULL if no job has finished yet.
+ *
+ * If there is a free lane after \a job has been placed, then this function
+ * returns immediately without hashing anything.  Otherwise, all lanes are
+ * run until at least one of them has finished and that job is returned.
+ * The returned job may not be the same as \a job.
+ *
+ * \sa flush()
+ */
+SHA3Job *SHA3_256x4::submit(SHA3Job *job)
+{
+    uint8_t index;
+    for (index = 0; index < 4; ++index) {
+        if (lane[index].phase == PHASE_IDLE)
+            break;
+    }
+    if (index >= 4)
+        return 0;   // Cannot happen unless the caller forgot a job.
+
+    // The final block always contains the padding, even if it is empty.
+    Lane &l = lane[index];
+    l.job = job;
+    l.block = 0;
+    l.blocks = job->len / core.blockSize() + 1;
+    l.phase = PHASE_BUSY;
+    core.resetLane(index);
+
+    // Run the lanes if they are all busy now.
+    for (index = 0; index < 4; ++index) {
+        if (lane[index].phase == PHASE_IDLE)
+            return 0;
+    }
+    return run();
+}
+
+/**
+ * \brief Flushes a job from this engine.
+ *
+ * \return Returns a finished job, or NULL if there are no more jobs.
+ *
+ * This function runs the lanes that are still busy until at least one
+ * of them has finished and then returns that job.  It should be called
+ * repeatedly until it returns NULL to retrieve all outstanding jobs.
+ *
+ * \sa submit()
+ */
+SHA3Job *SHA3_256x4::flush()
+{
+    return run();
+}
+
+/**
+ * \brief Clears all security-sensitive state from this engine and
+ * abandons any jobs that are still in progress.
+ */
+void SHA3_256x4::clear()
+{
+    core.clear();
+    clean(lane);
+}
+
+/**
+ * \brief Runs the busy lanes until at least one job has finished.
+ *
+ * \return Returns a finished job, or NULL if all lanes are idle.
+ */
+SHA3Job *SHA3_256x4::run()
+{
+    size_t rate = core.blockSize();
+    uint8_t index;
+    for (;;) {
+        // Return a finished job if there is one.
+        for (index = 0; index < 4; ++index) {
+            Lane &l = lane[index];
+            if (l.phase == PHASE_DONE) {
+                SHA3Job *job = l.job;
+                l.job = 0;
+                l.phase = PHASE_IDLE;
+                return job;
+            }
+        }
+
+        // Absorb the next block for all busy lanes.  Idle lanes are
+        // permuted along with the others and their results are ignored.
+        bool busy = false;
+        for (index = 0; index < 4; ++index) {
+            Lane &l = lane[index];
+            if (l.phase != PHASE_BUSY)
+                continue;
+            const uint8_t *data = (const uint8_t *)(l.job->data);
+            size_t posn = l.block * rate;
+            if ((l.block + 1) < l.blocks) {
+                core.absorb(index, data + posn, rate);
+            } else {
+                core.absorb(index, data + posn, l.job->len - posn);
+                core.pad(index, l.job->len - posn, 0x06);
+            }
+            busy = true;
+        }
+        if (!busy)
+            return 0;
+
+        // Permute the states for all lanes at once.
+        core.permute();
+
+        // Check for lanes that have reached the end of their message.
+        for (index = 0; index < 4; ++index) {
+            Lane &l = lane[index];
+            if (l.phase == PHASE_BUSY && ++(l.block) == l.blocks) {
+                core.extract(index, l.job->hash, 32);
+                l.phase = PHASE_DONE;
+            }
+        }
+    }
+}
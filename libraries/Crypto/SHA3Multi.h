@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_SHA3MULTI_h
+#define CRYPTO_SHA3MULTI_h
+
+#include "KeccakCoreX4.h"
+
+struct SHA3Job
+{
+    const void *data;
+    size_t len;
+    uint8_t hash[32];
+};
+
+class SHA3_256x4
+{
+public:
+    SHA3_256x4();
+    ~SHA3_256x4();
+
+    uint8_t lanes() const { return 4; }
+
+    SHA3Job *submit(SHA3Job *job);
+    SHA3Job *flush();
+
+    void clear();
+
+private:
+    struct Lane
+    {
+        SHA3Job *job;
+        size_t block;
+        size_t blocks;
+        uint8_t phase;
+    };
+
+    KeccakCoreX4 core;
+    Lane lane[4];
+
+    SHA3Job *run();
+};
+
+#endif
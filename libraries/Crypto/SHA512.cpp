@@ -139,6 +139,11 @@ void SHA512::clear()
     reset();
 }
 
+void SHA512::copyState(const Hash &other)
+{
+    state = static_cast<const SHA512 &>(other).state;
+}
+
 void SHA512::resetHMAC(const void *key, size_t keyLen)
 {
     formatHMACKey(state.w, key, keyLen, 0x36);
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SHAKE.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class SHAKE SHAKE.h <SHAKE.h>
+ * \brief Abstract base class for the SHAKE and cSHAKE extendable-output
+ * functions.
+ *
+ * An extendable-output function (XOF) is similar to a hash algorithm
+ * except that it can produce as much output as the caller needs.
+ * Input is supplied with update() and then output is produced with
+ * repeated calls to extract().  Once extract() has been called, the
+ * object must be reset before more input can be supplied.
+ *
+ * The reset(name, nameLen, custom, customLen) variant selects the
+ * customizable cSHAKE function from NIST SP 800-185, which produces
+ * independent output for each choice of customization string.
+ * This can be used to derive several keys from a single master key
+ * with one pass over the master key per derived key.
+ *
+ * Reference: http://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.202.pdf,
+ * http://nvlpubs.nist.gov/nistpubs/SpecialPublications/NIST.SP.800-185.pdf
+ *
+ * \sa SHAKE128, SHAKE256, KMAC, SHA3_256
+ */
+
+/**
+ * \brief Encodes a value with left_encode() from NIST SP 800-185.
+ *
+ * \param buf The buffer to write the encoding to, which must be at
+ * least 9 bytes in size.
+ * \param value The value to encode.
+ *
+ * \return The number of bytes that were written to \a buf.
+ */
+static uint8_t leftEncode(uint8_t *buf, uint64_t value)
+{
+    uint8_t len = 1;
+    while (len < 8 && (value >> (len * 8)) != 0)
+        ++len;
+    buf[0] = len;
+    for (uint8_t posn = 0; posn < len; ++posn)
+        buf[len - posn] = (uint8_t)(value >> (posn * 8));
+    return len + 1;
+}
+
+/**
+ * \brief Encodes a value with right_encode() from NIST SP 800-185.
+ *
+ * \param buf The buffer to write the encoding to, which must be at
+ * least 9 bytes in size.
+ * \param value The value to encode.
+ *
+ * \return The number of bytes that were written to \a buf.
+ */
+static uint8_t rightEncode(uint8_t *buf, uint64_t value)
+{
+    uint8_t len = leftEncode(buf, value) - 1;
+    memmove(buf, buf + 1, len);
+    buf[len] = len;
+    return len + 1;
+}
+
+/**
+ * \brief Absorbs encode_string(\a data) into a Keccak sponge.
+ *
+ * \return The number of bytes that were absorbed.
+ */
+static size_t absorbString(KeccakCore &core, const void *data, size_t len)
+{
+    uint8_t buf[9];
+    uint8_t size = leftEncode(buf, ((uint64_t)len) * 8);
+    core.update(buf, size);
+    core.update(data, len);
+    return size + len;
+}
+
+/**
+ * \brief Absorbs the header for bytepad(X, blockSize()).
+ *
+ * \return The number of bytes that were absorbed.
+ */
+static size_t absorbBytePadStart(KeccakCore &core)
+{
+    uint8_t buf[9];
+    uint8_t size = leftEncode(buf, core.blockSize());
+    core.update(buf, size);
+    return size;
+}
+
+/**
+ * \brief Absorbs the zero padding at the end of bytepad(X, blockSize()).
+ *
+ * \param count The number of bytes that were absorbed since the start of
+ * the bytepad() operation.
+ */
+static void absorbBytePadEnd(KeccakCore &core, size_t count)
+{
+    static uint8_t const zeroes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t len = count % core.blockSize();
+    if (len != 0)
+        len = core.blockSize() - len;
+    while (len > 0) {
+        size_t size = len;
+        if (size > sizeof(zeroes))
+            size = sizeof(zeroes);
+        core.update(zeroes, size);
+        len -= size;
+    }
+}
+
+/**
+ * \brief Absorbs the customization header for cSHAKE into a Keccak sponge.
+ */
+static void absorbCustom(KeccakCore &core, const void *name, size_t nameLen,
+                         const void *custom, size_t customLen)
+{
+    size_t count = absorbBytePadStart(core);
+    count += absorbString(core, name, nameLen);
+    count += absorbString(core, custom, customLen);
+    absorbBytePadEnd(core, count);
+}
+
+/**
+ * \brief Constructs a new SHAKE object.
+ *
+ * \param capacity The capacity of the Keccak sponge function in bits;
+ * 256 for SHAKE128 or 512 for SHAKE256.
+ */
+SHAKE::SHAKE(size_t capacity)
+    : tag(0x1F)
+    , finalized(false)
+{
+    core.setCapacity(capacity);
+}
+
+/**
+ * \brief Destroys this SHAKE object after clearing sensitive information.
+ */
+SHAKE::~SHAKE()
+{
+    // The destructor for the KeccakCore object will do most of the work.
+}
+
+/**
+ * \fn size_t SHAKE::blockSize() const
+ * \brief Returns the size of the internal block in bytes.
+ */
+
+/**
+ * \brief Resets the SHAKE object ready for a new session.
+ *
+ * \sa update(), extract()
+ */
+void SHAKE::reset()
+{
+    core.reset();
+    tag = 0x1F;
+    finalized = false;
+}
+
+/**
+ * \brief Resets the object ready for a new cSHAKE session.
+ *
+ * \param name Points to the function name string, which is reserved by
+ * NIST for functions such as KMAC.  Normally this is empty.
+ * \param nameLen The length of the function name in bytes.
+ * \param custom Points to the customization string.
+ * \param customLen The length of the customization string in bytes.
+ *
+ * If both \a nameLen and \a customLen are zero, then this is
+ * equivalent to reset(), as specified for cSHAKE.
+ *
+ * \sa update(), extract()
+ */
+void SHAKE::reset(const void *name, size_t nameLen,
+                  const void *custom, size_t customLen)
+{
+    if (!nameLen && !customLen) {
+        reset();
+        return;
+    }
+    core.reset();
+    absorbCustom(core, name, nameLen, custom, customLen);
+    tag = 0x04;
+    finalized = false;
+}
+
+/**
+ * \brief Updates the function with more input data.
+ *
+ * \param data Points to the input data.
+ * \param len The length of the input data in bytes.
+ *
+ * This function must not be called after extract() without first
+ * calling reset().
+ *
+ * \sa extract(), reset()
+ */
+void SHAKE::update(const void *data, size_t len)
+{
+    core.update(data, len);
+}
+
+/**
+ * \brief Extracts output data from the function.
+ *
+ * \param data The data buffer to fill with output.
+ * \param len The number of bytes of output that are required.
+ *
+ * This function can be called as many times as required to produce
+ * output of any length.  Multiple calls produce the same output
+ * as a single call for the total length.
+ *
+ * \sa update(), reset()
+ */
+void SHAKE::extract(void *data, size_t len)
+{
+    if (!finalized) {
+        core.pad(tag);
+        finalized = true;
+    }
+    core.extract(data, len);
+}
+
+/**
+ * \brief Clears all sensitive data from this object.
+ */
+void SHAKE::clear()
+{
+    core.clear();
+    reset();
+}
+
+/**
+ * \class SHAKE128 SHAKE.h <SHAKE.h>
+ * \brief SHAKE128 and cSHAKE128 extendable-output functions.
+ *
+ * \sa SHAKE256, KMAC128
+ */
+
+/**
+ * \fn SHAKE128::SHAKE128()
+ * \brief Constructs a new SHAKE128 object.
+ */
+
+/**
+ * \brief Destroys this SHAKE128 object after clearing sensitive information.
+ */
+SHAKE128::~SHAKE128()
+{
+}
+
+/**
+ * \class SHAKE256 SHAKE.h <SHAKE.h>
+ * \brief SHAKE256 and cSHAKE256 extendable-output functions.
+ *
+ * \sa SHAKE128, KMAC256
+ */
+
+/**
+ * \fn SHAKE256::SHAKE256()
+ * \brief Constructs a new SHAKE256 object.
+ */
+
+/**
+ * \brief Destroys this SHAKE256 object after clearing sensitive information.
+ */
+SHAKE256::~SHAKE256()
+{
+}
+
+/**
+ * \class KMAC SHAKE.h <SHAKE.h>
+ * \brief Abstract base class for the KMAC message authentication code.
+ *
+ * KMAC is a keyed message authentication code from NIST SP 800-185
+ * that is built on top of cSHAKE.  Unlike HMAC, the key is absorbed
+ * once at the start and the message is processed in a single pass.
+ *
+ * The output length is an input to the function, so MAC values of
+ * different lengths are unrelated.  If extract() is used instead of
+ * finalize(), then the KMACXOF variant is produced, which can generate
+ * any amount of output.  This makes KMAC suitable as a key derivation
+ * function, with the customization string identifying the derived key.
+ *
+ * Reference: http://nvlpubs.nist.gov/nistpubs/SpecialPublications/NIST.SP.800-185.pdf
+ *
+ * \sa KMAC128, KMAC256, SHAKE
+ */
+
+/**
+ * \brief Constructs a new KMAC object.
+ *
+ * \param capacity The capacity of the Keccak sponge function in bits;
+ * 256 for KMAC128 or 512 for KMAC256.
+ */
+KMAC::KMAC(size_t capacity)
+    : finalized(false)
+{
+    core.setCapacity(capacity);
+}
+
+/**
+ * \brief Destroys this KMAC object after clearing sensitive information.
+ */
+KMAC::~KMAC()
+{
+    // The destructor for the KeccakCore object will do most of the work.
+}
+
+/**
+ * \fn size_t KMAC::blockSize() const
+ * \brief Returns the size of the internal block in bytes.
+ */
+
+/**
+ * \brief Resets the KMAC object ready for a new session.
+ *
+ * \param key Points to the key.
+ * \param keyLen The length of the key in bytes.
+ * \param custom Points to the customization string, or NULL for none.
+ * \param customLen The length of the customization string in bytes.
+ *
+ * \sa update(), finalize(), extract()
+ */
+void KMAC::reset(const void *key, size_t keyLen,
+                 const void *custom, size_t customLen)
+{
+    core.reset();
+    absorbCustom(core, "KMAC", 4, custom, customLen);
+    size_t count = absorbBytePadStart(core);
+    count += absorbString(core, key, keyLen);
+    absorbBytePadEnd(core, count);
+    finalized = false;
+}
+
+/**
+ * \brief Updates the KMAC with more input data.
+ *
+ * \param data Points to the input data.
+ * \param len The length of the input data in bytes.
+ *
+ * \sa finalize(), extract(), reset()
+ */
+void KMAC::update(const void *data, size_t len)
+{
+    core.update(data, len);
+}
+
+/**
+ * \brief Finalizes the KMAC and returns the MAC value.
+ *
+ * \param mac The buffer to return the MAC value in.
+ * \param len The length of the MAC value in bytes.
+ *
+ * The object must be reset before it can be used for another MAC.
+ *
+ * \sa reset(), extract()
+ */
+void KMAC::finalize(void *mac, size_t len)
+{
+    uint8_t buf[9];
+    core.update(buf, rightEncode(buf, ((uint64_t)len) * 8));
+    core.pad(0x04);
+    core.extract(mac, len);
+    finalized = true;
+}
+
+/**
+ * \brief Extracts output data from the KMACXOF variant of the function.
+ *
+ * \param data The data buffer to fill with output.
+ * \param len The number of bytes of output that are required.
+ *
+ * This function can be called as many times as required to produce
+ * output of any length.  Multiple calls produce the same output
+ * as a single call for the total length.
+ *
+ * \sa update(), finalize()
+ */
+void KMAC::extract(void *data, size_t len)
+{
+    if (!finalized) {
+        uint8_t buf[9];
+        core.update(buf, rightEncode(buf, 0));
+        core.pad(0x04);
+        finalized = true;
+    }
+    core.extract(data, len);
+}
+
+/**
+ * \brief Clears all sensitive data from this object.
+ */
+void KMAC::clear()
+{
+    core.clear();
+    finalized = false;
+}
+
+/**
+ * \class KMAC128 SHAKE.h <SHAKE.h>
+ * \brief KMAC128 message authentication code.
+ *
+ * \sa KMAC256
+ */
+
+/**
+ * \fn KMAC128::KMAC128()
+ * \brief Constructs a new KMAC128 object.
+ */
+
+/**
+ * \brief Destroys this KMAC128 object after clearing sensitive information.
+ */
+KMAC128::~KMAC128()
+{
+}
+
+/**
+ * \class KMAC256 SHAKE.h <SHAKE.h>
+ * \brief KMAC256 message authentication code.
+ *
+ * \sa KMAC128
+ */
+
+/**
+ * \fn KMAC256::KMAC256()
+ * \brief Constructs a new KMAC256 object.
+ */
+
+/**
+ * \brief Destroys this KMAC256 object after clearing sensitive information.
+ */
+KMAC256::~KMAC256()
+{
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SeedStorage.h"
+#include <avr/eeprom.h>
+
+/**
+ * \class SeedStorage SeedStorage.h <SeedStorage.h>
+ * \brief Abstract base class for non-volatile storage of the random seed.
+ *
+ * \link RNGClass RNG\endlink saves a seed to non-volatile storage on a
+ * regular basis so that the entropy it has accumulated survives a loss of
+ * power.  By default the seed is saved to the internal EEPROM of the
+ * microcontroller with EEPROMSeedStorage.  Subclasses of this class can
+ * be passed to \link RNGClass::begin() RNG.begin()\endlink to save the
+ * seed somewhere else instead, for example an external I2C EEPROM or the
+ * battery-backed memory in a realtime clock chip.
+ *
+ * Offsets are relative to the start of the storage area.  The area must
+ * be at least \link RNGClass::SEED_SIZE RNGClass::SEED_SIZE\endlink bytes
+ * in size for a single seed slot.
+ *
+ * \sa \link RNGClass RNG\endlink, EEPROMSeedStorage
+ */
+
+/**
+ * \brief Constructs a new seed storage object.
+ */
+SeedStorage::SeedStorage()
+{
+}
+
+/**
+ * \brief Destroys this seed storage object.
+ */
+SeedStorage::~SeedStorage()
+{
+}
+
+/**
+ * \fn uint8_t SeedStorage::read(unsigned int offset)
+ * \brief Reads a byte from the seed storage area.
+ *
+ * \param offset The offset of the byte from the start of the area.
+ * \return The value of the byte.
+ *
+ * \sa write()
+ */
+
+/**
+ * \fn void SeedStorage::write(unsigned int offset, uint8_t value)
+ * \brief Writes a byte to the seed storage area.
+ *
+ * \param offset The offset of the byte from the start of the area.
+ * \param value The value to write.
+ *
+ * Implementations should avoid rewriting bytes that already have the
+ * requested value if the underlying storage wears out with use.
+ *
+ * \sa read(), ready()
+ */
+
+/**
+ * \brief Determine if the storage can accept another write without blocking.
+ *
+ * \return Returns true if write() will not block waiting for a previous
+ * write to complete.
+ *
+ * \link RNGClass::loop() RNG.loop()\endlink writes automatic saves one byte
+ * at a time and skips the write while this function returns false.
+ * The default implementation always returns true.
+ *
+ * \sa write()
+ */
+bool SeedStorage::ready()
+{
+    return true;
+}
+
+/**
+ * \class EEPROMSeedStorage SeedStorage.h <SeedStorage.h>
+ * \brief Stores the random seed in the microcontroller's internal EEPROM.
+ *
+ * This is the storage that \link RNGClass RNG\endlink uses when it is
+ * initialized with an EEPROM address.
+ *
+ * \sa SeedStorage
+ */
+
+/**
+ * \brief Constructs a new internal EEPROM seed storage object.
+ *
+ * \param address The EEPROM address of the start of the storage area.
+ */
+EEPROMSeedStorage::EEPROMSeedStorage(int address)
+    : _address(address)
+{
+}
+
+/**
+ * \brief Destroys this internal EEPROM seed storage object.
+ */
+EEPROMSeedStorage::~EEPROMSeedStorage()
+{
+}
+
+/**
+ * \fn int EEPROMSeedStorage::address() const
+ * \brief Returns the EEPROM address of the start of the storage area.
+ *
+ * \sa setAddress()
+ */
+
+/**
+ * \fn void EEPROMSeedStorage::setAddress(int address)
+ * \brief Sets the EEPROM address of the start of the storage area.
+ *
+ * \sa address()
+ */
+
+uint8_t EEPROMSeedStorage::read(unsigned int offset)
+{
+    return eeprom_read_byte((const uint8_t *)(_address + offset));
+}
+
+void EEPROMSeedStorage::write(unsigned int offset, uint8_t value)
+{
+    eeprom_update_byte((uint8_t *)(_address + offset), value);
+}
+
+bool EEPROMSeedStorage::ready()
+{
+#if defined(eeprom_is_ready)
+    return eeprom_is_ready();
+#else
+    return true;
+#endif
+}
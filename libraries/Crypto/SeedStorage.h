@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_SEEDSTORAGE_H
+#define CRYPTO_SEEDSTORAGE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class SeedStorage
+{
+public:
+    SeedStorage();
+    virtual ~SeedStorage();
+
+    virtual uint8_t read(unsigned int offset) = 0;
+    virtual void write(unsigned int offset, uint8_t value) = 0;
+
+    virtual bool ready();
+};
+
+class EEPROMSeedStorage : public SeedStorage
+{
+public:
+    explicit EEPROMSeedStorage(int address = 0);
+    virtual ~EEPROMSeedStorage();
+
+    int address() const { return _address; }
+    void setAddress(int address) { _address = address; }
+
+    uint8_t read(unsigned int offset);
+    void write(unsigned int offset, uint8_t value);
+
+    bool ready();
+
+private:
+    int _address;
+};
+
+#endif
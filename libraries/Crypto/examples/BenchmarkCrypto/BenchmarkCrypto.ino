@@ -0,0 +1,450 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs a common set of performance tests over every algorithm
+in the cryptography library.  Each hash, cipher, and authenticated cipher
+is measured at several message sizes, along with the key setup and
+finalization steps and the public key operations.
+
+The results are written to the serial port as comma-separated lines that
+can be captured and compared between releases:
+
+    algorithm,operation,bytes,us_per_op,cycles_per_op,cycles_per_byte
+
+The "bytes" field is 0 for operations that do not depend upon the size
+of the input.  The cycle counts are derived from F_CPU and are left empty
+if the clock speed is unknown or the figure does not apply.  Lines that
+start with "#" are comments and the run ends with "# end".
+*/
+
+#include <Crypto.h>
+#include <AES.h>
+#include <ChaCha.h>
+#include <CTR.h>
+#include <CBC.h>
+#include <CFB.h>
+#include <OFB.h>
+#include <GCM.h>
+#include <ChaChaPoly.h>
+#include <SHA1.h>
+#include <SHA256.h>
+#include <SHA512.h>
+#include <SHA3.h>
+#include <BLAKE2s.h>
+#include <BLAKE2b.h>
+#include <Poly1305.h>
+#include <GHASH.h>
+#include <Curve25519.h>
+#include <Ed25519.h>
+#include <string.h>
+
+// Minimum amount of time to spend on each measurement in microseconds.
+#define BENCH_MIN_TIME  200000UL
+
+// Size of the working buffer.  Longer messages are processed as a
+// sequence of buffer-sized pieces to keep the memory usage down on AVR.
+#define BENCH_BUFFER_SIZE 128
+
+// Message sizes to measure for the size-dependent operations.
+static size_t const messageSizes[] = {16, 64, 1024};
+#define NUM_MESSAGE_SIZES (sizeof(messageSizes) / sizeof(messageSizes[0]))
+
+uint8_t buffer[BENCH_BUFFER_SIZE];
+uint8_t tag[64];
+
+// Context for the operation that is currently being measured.
+Hash *benchHash;
+Cipher *benchCipher;
+AuthenticatedCipher *benchAuthCipher;
+BlockCipher *benchBlockCipher;
+Poly1305 *benchPoly1305;
+GHASH *benchGHASH;
+size_t benchSize;
+
+typedef void (*BenchFunc)(unsigned long count);
+
+// Runs an operation repeatedly, doubling the count each time, until the
+// minimum measurement time is reached.  Then the per-operation figures
+// are reported to the serial port.
+void bench(const char *algorithm, const char *operation, size_t size,
+           BenchFunc func)
+{
+    unsigned long count = 1;
+    unsigned long start;
+    unsigned long elapsed;
+
+    for (;;) {
+        start = micros();
+        (*func)(count);
+        elapsed = micros() - start;
+        if (elapsed >= BENCH_MIN_TIME || count >= 0x40000000UL)
+            break;
+        count *= 2;
+    }
+
+    double usPerOp = ((double)elapsed) / count;
+    Serial.print(algorithm);
+    Serial.print(',');
+    Serial.print(operation);
+    Serial.print(',');
+    Serial.print((unsigned long)size);
+    Serial.print(',');
+    Serial.print(usPerOp, 3);
+    Serial.print(',');
+#if defined(F_CPU)
+    double cyclesPerOp = usPerOp * (F_CPU / 1000000.0);
+    Serial.print(cyclesPerOp, 1);
+    Serial.print(',');
+    if (size)
+        Serial.print(cyclesPerOp / size, 2);
+#else
+    Serial.print(',');
+#endif
+    Serial.println();
+    Serial.flush();
+}
+
+// Feeds benchSize bytes of data to a processing function, one buffer at a time.
+#define FOR_EACH_PIECE(stmt) \
+    do { \
+        size_t remaining = benchSize; \
+        while (remaining > 0) { \
+            size_t len = remaining; \
+            if (len > sizeof(buffer)) \
+                len = sizeof(buffer); \
+            stmt; \
+            remaining -= len; \
+        } \
+    } while (0)
+
+void hashMessage(unsigned long count)
+{
+    while (count-- > 0) {
+        benchHash->reset();
+        FOR_EACH_PIECE(benchHash->update(buffer, len));
+        benchHash->finalize(tag, benchHash->hashSize());
+    }
+}
+
+void hashFinalize(unsigned long count)
+{
+    while (count-- > 0)
+        benchHash->finalize(tag, benchHash->hashSize());
+}
+
+void hashResetHMAC(unsigned long count)
+{
+    while (count-- > 0)
+        benchHash->resetHMAC(buffer, benchHash->hashSize());
+}
+
+void hashFinalizeHMAC(unsigned long count)
+{
+    while (count-- > 0) {
+        benchHash->finalizeHMAC(buffer, benchHash->hashSize(),
+                                tag, benchHash->hashSize());
+    }
+}
+
+void benchHashAlgorithm(const char *name, Hash *hash)
+{
+    benchHash = hash;
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "hash", benchSize, hashMessage);
+    }
+    hash->reset();
+    hash->update("abc", 3);
+    bench(name, "finalize", 0, hashFinalize);
+    bench(name, "resetHMAC", 0, hashResetHMAC);
+    hash->resetHMAC(buffer, hash->hashSize());
+    hash->update("abc", 3);
+    bench(name, "finalizeHMAC", 0, hashFinalizeHMAC);
+    hash->clear();
+}
+
+void cipherSetKey(unsigned long count)
+{
+    while (count-- > 0) {
+        benchCipher->setKey(buffer, benchCipher->keySize());
+        benchCipher->setIV(buffer, benchCipher->ivSize());
+    }
+}
+
+void cipherEncrypt(unsigned long count)
+{
+    while (count-- > 0)
+        FOR_EACH_PIECE(benchCipher->encrypt(buffer, buffer, len));
+}
+
+void cipherDecrypt(unsigned long count)
+{
+    while (count-- > 0)
+        FOR_EACH_PIECE(benchCipher->decrypt(buffer, buffer, len));
+}
+
+void benchCipherAlgorithm(const char *name, Cipher *cipher)
+{
+    benchCipher = cipher;
+    bench(name, "setKey", 0, cipherSetKey);
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "encrypt", benchSize, cipherEncrypt);
+    }
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "decrypt", benchSize, cipherDecrypt);
+    }
+    cipher->clear();
+}
+
+void authCipherAddAuthData(unsigned long count)
+{
+    while (count-- > 0)
+        FOR_EACH_PIECE(benchAuthCipher->addAuthData(buffer, len));
+}
+
+void authCipherSeal(unsigned long count)
+{
+    while (count-- > 0) {
+        benchAuthCipher->setIV(buffer, benchAuthCipher->ivSize());
+        FOR_EACH_PIECE(benchAuthCipher->encrypt(buffer, buffer, len));
+        benchAuthCipher->computeTag(tag, benchAuthCipher->tagSize());
+    }
+}
+
+void benchAuthCipherAlgorithm(const char *name, AuthenticatedCipher *cipher)
+{
+    benchCipherAlgorithm(name, cipher);
+    benchAuthCipher = cipher;
+    cipher->setKey(buffer, cipher->keySize());
+    cipher->setIV(buffer, cipher->ivSize());
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "addAuthData", benchSize, authCipherAddAuthData);
+    }
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "seal", benchSize, authCipherSeal);
+    }
+    cipher->clear();
+}
+
+void blockCipherSetKey(unsigned long count)
+{
+    while (count-- > 0)
+        benchBlockCipher->setKey(buffer, benchBlockCipher->keySize());
+}
+
+void blockCipherEncrypt(unsigned long count)
+{
+    while (count-- > 0) {
+        FOR_EACH_PIECE(benchBlockCipher->encryptBlocks
+                            (buffer, buffer, len / 16));
+    }
+}
+
+void blockCipherDecrypt(unsigned long count)
+{
+    while (count-- > 0) {
+        FOR_EACH_PIECE(
+            for (size_t posn = 0; posn < len; posn += 16)
+                benchBlockCipher->decryptBlock(buffer + posn, buffer + posn));
+    }
+}
+
+void benchBlockCipherAlgorithm(const char *name, BlockCipher *cipher)
+{
+    benchBlockCipher = cipher;
+    bench(name, "setKey", 0, blockCipherSetKey);
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "encrypt", benchSize, blockCipherEncrypt);
+    }
+    for (uint8_t index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench(name, "decrypt", benchSize, blockCipherDecrypt);
+    }
+    cipher->clear();
+}
+
+void poly1305SetKey(unsigned long count)
+{
+    while (count-- > 0)
+        benchPoly1305->reset(buffer);
+}
+
+void poly1305Message(unsigned long count)
+{
+    while (count-- > 0) {
+        benchPoly1305->reset(buffer);
+        FOR_EACH_PIECE(benchPoly1305->update(buffer, len));
+        benchPoly1305->finalize(buffer, tag, 16);
+    }
+}
+
+void poly1305Finalize(unsigned long count)
+{
+    while (count-- > 0)
+        benchPoly1305->finalize(buffer, tag, 16);
+}
+
+void ghashSetKey(unsigned long count)
+{
+    while (count-- > 0)
+        benchGHASH->reset(buffer);
+}
+
+void ghashMessage(unsigned long count)
+{
+    while (count-- > 0) {
+        benchGHASH->reset(buffer);
+        FOR_EACH_PIECE(benchGHASH->update(buffer, len));
+        benchGHASH->finalize(tag, 16);
+    }
+}
+
+void ghashFinalize(unsigned long count)
+{
+    while (count-- > 0)
+        benchGHASH->finalize(tag, 16);
+}
+
+void benchAuthenticators()
+{
+    Poly1305 poly1305;
+    GHASH ghash;
+    uint8_t index;
+
+    benchPoly1305 = &poly1305;
+    bench("Poly1305", "setKey", 0, poly1305SetKey);
+    for (index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench("Poly1305", "hash", benchSize, poly1305Message);
+    }
+    poly1305.reset(buffer);
+    bench("Poly1305", "finalize", 0, poly1305Finalize);
+
+    benchGHASH = &ghash;
+    bench("GHASH", "setKey", 0, ghashSetKey);
+    for (index = 0; index < NUM_MESSAGE_SIZES; ++index) {
+        benchSize = messageSizes[index];
+        bench("GHASH", "hash", benchSize, ghashMessage);
+    }
+    ghash.reset(buffer);
+    bench("GHASH", "finalize", 0, ghashFinalize);
+}
+
+// Keys and signatures for the public key tests.
+uint8_t privateKey[32];
+uint8_t publicKey[32];
+uint8_t signature[64];
+
+void curve25519Eval(unsigned long count)
+{
+    while (count-- > 0)
+        Curve25519::eval(publicKey, privateKey, 0);
+}
+
+void ed25519DerivePublicKey(unsigned long count)
+{
+    while (count-- > 0)
+        Ed25519::derivePublicKey(publicKey, privateKey);
+}
+
+void ed25519Sign(unsigned long count)
+{
+    while (count-- > 0)
+        Ed25519::sign(signature, privateKey, publicKey, buffer, benchSize);
+}
+
+void ed25519Verify(unsigned long count)
+{
+    while (count-- > 0)
+        Ed25519::verify(signature, publicKey, buffer, benchSize);
+}
+
+void benchPublicKey()
+{
+    for (uint8_t posn = 0; posn < 32; ++posn)
+        privateKey[posn] = (uint8_t)(posn * 7 + 1);
+    benchSize = 64;
+
+    bench("Curve25519", "eval", 0, curve25519Eval);
+    bench("Ed25519", "derivePublicKey", 0, ed25519DerivePublicKey);
+    bench("Ed25519", "sign", benchSize, ed25519Sign);
+    bench("Ed25519", "verify", benchSize, ed25519Verify);
+}
+
+// Each object is created in its own scope so that only one algorithm's
+// state occupies memory at any given time.
+#define BENCH_HASH(cls) \
+    do { cls obj; benchHashAlgorithm(#cls, &obj); } while (0)
+#define BENCH_CIPHER(name, cls) \
+    do { cls obj; benchCipherAlgorithm(name, &obj); } while (0)
+#define BENCH_AUTH_CIPHER(name, cls) \
+    do { cls obj; benchAuthCipherAlgorithm(name, &obj); } while (0)
+#define BENCH_BLOCK_CIPHER(cls) \
+    do { cls obj; benchBlockCipherAlgorithm(#cls, &obj); } while (0)
+
+void setup()
+{
+    Serial.begin(9600);
+
+    for (size_t posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    Serial.println();
+    Serial.println("# algorithm,operation,bytes,us_per_op,cycles_per_op,cycles_per_byte");
+
+    BENCH_BLOCK_CIPHER(AES128);
+    BENCH_BLOCK_CIPHER(AES192);
+    BENCH_BLOCK_CIPHER(AES256);
+
+    BENCH_CIPHER("ChaCha", ChaCha);
+    BENCH_CIPHER("CTR<AES128>", CTR<AES128>);
+    BENCH_CIPHER("CFB<AES128>", CFB<AES128>);
+    BENCH_CIPHER("CBC<AES128>", CBC<AES128>);
+    BENCH_CIPHER("OFB<AES128>", OFB<AES128>);
+
+    BENCH_AUTH_CIPHER("ChaChaPoly", ChaChaPoly);
+    BENCH_AUTH_CIPHER("GCM<AES128>", GCM<AES128>);
+    BENCH_AUTH_CIPHER("GCM<AES256>", GCM<AES256>);
+
+    BENCH_HASH(SHA1);
+    BENCH_HASH(SHA256);
+    BENCH_HASH(SHA512);
+    BENCH_HASH(SHA3_256);
+    BENCH_HASH(SHA3_512);
+    BENCH_HASH(BLAKE2s);
+    BENCH_HASH(BLAKE2b);
+
+    benchAuthenticators();
+    benchPublicKey();
+
+    Serial.println("# end");
+}
+
+void loop()
+{
+}
@@ -71,9 +71,22 @@ static TestVector const testVectorAES256 = {
 AES128 aes128;
 AES192 aes192;
 AES256 aes256;
+AESSmall128 aesSmall128;
+AESSmall256 aesSmall256;
 
 byte buffer[16];
 
+// Prints the name of an AES implementation.
+void printImplementation(AESCommon::Implementation impl)
+{
+    if (impl == AESCommon::Hardware)
+        Serial.print("hardware");
+    else if (impl == AESCommon::Word)
+        Serial.print("32-bit word");
+    else
+        Serial.print("8-bit byte");
+}
+
 void testCipher(BlockCipher *cipher, const struct TestVector *test)
 {
     Serial.print(test->name);
@@ -94,6 +107,16 @@ void testCipher(BlockCipher *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+// Prints the number of CPU cycles per byte if the clock speed is known.
+void printCyclesPerByte(unsigned long elapsed, double bytes)
+{
+#if defined(F_CPU)
+    Serial.print(", ");
+    Serial.print((elapsed * (F_CPU / 1000000.0)) / bytes);
+    Serial.print(" cycles per byte");
+#endif
+}
+
 void perfCipher(BlockCipher *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -122,7 +145,9 @@ void perfCipher(BlockCipher *cipher, const struct TestVector *test)
     Serial.print(elapsed / (5000.0 * 16.0));
     Serial.print("us per byte, ");
     Serial.print((16.0 * 5000.0 * 1000000.0) / elapsed);
-    Serial.println(" bytes per second");
+    Serial.print(" bytes per second");
+    printCyclesPerByte(elapsed, 16.0 * 5000.0);
+    Serial.println();
 
     Serial.print(test->name);
     Serial.print(" Decrypt ... ");
@@ -134,7 +159,9 @@ void perfCipher(BlockCipher *cipher, const struct TestVector *test)
     Serial.print(elapsed / (5000.0 * 16.0));
     Serial.print("us per byte, ");
     Serial.print((16.0 * 5000.0 * 1000000.0) / elapsed);
-    Serial.println(" bytes per second");
+    Serial.print(" bytes per second");
+    printCyclesPerByte(elapsed, 16.0 * 5000.0);
+    Serial.println();
 
     Serial.println();
 }
@@ -152,19 +179,49 @@ void setup()
     Serial.println(sizeof(AES192));
     Serial.print("AES256 ... ");
     Serial.println(sizeof(AES256));
+    Serial.print("AESSmall128 ... ");
+    Serial.println(sizeof(AESSmall128));
+    Serial.print("AESSmall256 ... ");
+    Serial.println(sizeof(AESSmall256));
     Serial.println();
 
-    Serial.println("Test Vectors:");
-    testCipher(&aes128, &testVectorAES128);
-    testCipher(&aes192, &testVectorAES192);
-    testCipher(&aes256, &testVectorAES256);
+    // Test and then benchmark every implementation that this platform
+    // supports, finishing with the default implementation.
+    AESCommon::Implementation defaultImpl = AESCommon::implementation();
+    for (int impl = AESCommon::Byte; impl <= AESCommon::Hardware; ++impl) {
+        if (!AESCommon::setImplementation((AESCommon::Implementation)impl))
+            continue;
+        Serial.print("Test Vectors (");
+        printImplementation((AESCommon::Implementation)impl);
+        Serial.println(" implementation):");
+        testCipher(&aes128, &testVectorAES128);
+        testCipher(&aes192, &testVectorAES192);
+        testCipher(&aes256, &testVectorAES256);
+        Serial.println();
+    }
+    AESCommon::setImplementation(defaultImpl);
+
+    Serial.println("Test Vectors (on-the-fly key schedule):");
+    testCipher(&aesSmall128, &testVectorAES128);
+    testCipher(&aesSmall256, &testVectorAES256);
 
     Serial.println();
 
-    Serial.println("Performance Tests:");
-    perfCipher(&aes128, &testVectorAES128);
-    perfCipher(&aes192, &testVectorAES192);
-    perfCipher(&aes256, &testVectorAES256);
+    for (int impl = AESCommon::Byte; impl <= AESCommon::Hardware; ++impl) {
+        if (!AESCommon::setImplementation((AESCommon::Implementation)impl))
+            continue;
+        Serial.print("Performance Tests (");
+        printImplementation((AESCommon::Implementation)impl);
+        Serial.println(" implementation):");
+        perfCipher(&aes128, &testVectorAES128);
+        perfCipher(&aes192, &testVectorAES192);
+        perfCipher(&aes256, &testVectorAES256);
+    }
+    AESCommon::setImplementation(defaultImpl);
+
+    Serial.println("Performance Tests (on-the-fly key schedule):");
+    perfCipher(&aesSmall128, &testVectorAES128);
+    perfCipher(&aesSmall256, &testVectorAES256);
 }
 
 void loop()
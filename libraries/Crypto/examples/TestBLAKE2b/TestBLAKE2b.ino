@@ -89,7 +89,146 @@ static TestHashVector const testVectorBLAKE2b_4 = {
      0x7d, 0x6b, 0xfa, 0xf9, 0x72, 0x6e, 0x5e, 0x52}
 };
 
+struct TestKeyedVector
+{
+    const char *name;
+    uint8_t keyLen;
+    uint8_t dataLen;
+    uint8_t outLen;
+    bool tree;
+    uint8_t fanout;
+    uint8_t depth;
+    uint32_t leafLength;
+    uint64_t nodeOffset;
+    uint8_t nodeDepth;
+    uint8_t innerLength;
+    bool lastNode;
+    uint8_t hash[HASH_SIZE];
+};
+
+// Keyed and tree mode test vectors generated with Python's hashlib.
+// The key and data are the byte sequences 0, 1, 2, ...
+static TestKeyedVector const testVectorBLAKE2bKeyed_1 = {
+    "Keyed BLAKE2b #1",
+    64, 0, 64,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x10, 0xeb, 0xb6, 0x77, 0x00, 0xb1, 0x86, 0x8e,
+     0xfb, 0x44, 0x17, 0x98, 0x7a, 0xcf, 0x46, 0x90,
+     0xae, 0x9d, 0x97, 0x2f, 0xb7, 0xa5, 0x90, 0xc2,
+     0xf0, 0x28, 0x71, 0x79, 0x9a, 0xaa, 0x47, 0x86,
+     0xb5, 0xe9, 0x96, 0xe8, 0xf0, 0xf4, 0xeb, 0x98,
+     0x1f, 0xc2, 0x14, 0xb0, 0x05, 0xf4, 0x2d, 0x2f,
+     0xf4, 0x23, 0x34, 0x99, 0x39, 0x16, 0x53, 0xdf,
+     0x7a, 0xef, 0xcb, 0xc1, 0x3f, 0xc5, 0x15, 0x68}
+};
+static TestKeyedVector const testVectorBLAKE2bKeyed_2 = {
+    "Keyed BLAKE2b #2",
+    64, 1, 64,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x96, 0x1f, 0x6d, 0xd1, 0xe4, 0xdd, 0x30, 0xf6,
+     0x39, 0x01, 0x69, 0x0c, 0x51, 0x2e, 0x78, 0xe4,
+     0xb4, 0x5e, 0x47, 0x42, 0xed, 0x19, 0x7c, 0x3c,
+     0x5e, 0x45, 0xc5, 0x49, 0xfd, 0x25, 0xf2, 0xe4,
+     0x18, 0x7b, 0x0b, 0xc9, 0xfe, 0x30, 0x49, 0x2b,
+     0x16, 0xb0, 0xd0, 0xbc, 0x4e, 0xf9, 0xb0, 0xf3,
+     0x4c, 0x70, 0x03, 0xfa, 0xc0, 0x9a, 0x5e, 0xf1,
+     0x53, 0x2e, 0x69, 0x43, 0x02, 0x34, 0xce, 0xbd}
+};
+static TestKeyedVector const testVectorBLAKE2bKeyed_3 = {
+    "Keyed BLAKE2b #3",
+    16, 128, 64,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x4a, 0xb5, 0x1d, 0x4f, 0xfb, 0x11, 0xea, 0xa8,
+     0xda, 0xb9, 0x52, 0x65, 0x96, 0xcd, 0x61, 0x92,
+     0xce, 0x84, 0xa8, 0x75, 0x58, 0xe2, 0xec, 0x40,
+     0xbd, 0x7a, 0x6d, 0x32, 0xd8, 0xe9, 0x87, 0x53,
+     0x02, 0x80, 0x1b, 0x38, 0x0c, 0x90, 0x2f, 0x7c,
+     0xf3, 0xb8, 0xda, 0xd7, 0xca, 0x41, 0x8e, 0x9c,
+     0xdd, 0x45, 0xb5, 0xb6, 0x23, 0xbd, 0x99, 0x22,
+     0x50, 0x7c, 0x6c, 0x97, 0x34, 0x34, 0x9f, 0x16}
+};
+static TestKeyedVector const testVectorBLAKE2bKeyed_4 = {
+    "Keyed BLAKE2b #4",
+    64, 100, 16,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x58, 0x94, 0x30, 0xa2, 0xee, 0x2c, 0x31, 0x3f,
+     0xde, 0x55, 0x88, 0xd4, 0x76, 0x2f, 0x24, 0xa5}
+};
+static TestKeyedVector const testVectorBLAKE2bKeyed_5 = {
+    "Tree BLAKE2b #1",
+    0, 100, 64,
+    true, 4, 2, 4096, 0x3, 0, 64, true,
+    {0xaa, 0xbb, 0x44, 0xba, 0x10, 0x06, 0xae, 0x2e,
+     0x56, 0x7e, 0xf4, 0x7f, 0x5f, 0xea, 0xc8, 0x4a,
+     0x77, 0x6f, 0xf0, 0xb1, 0xb8, 0xe5, 0x4c, 0x25,
+     0xae, 0x57, 0x9a, 0x92, 0x1e, 0x7c, 0xef, 0xf6,
+     0x55, 0x33, 0xc2, 0x22, 0x99, 0x58, 0xb1, 0xff,
+     0xf4, 0x28, 0xfa, 0xd1, 0xd4, 0x1b, 0x9b, 0x2b,
+     0x9b, 0x0d, 0xda, 0x01, 0xc7, 0x44, 0xc5, 0x59,
+     0x75, 0xa7, 0x77, 0x6c, 0x2b, 0x6b, 0x99, 0x4d}
+};
+static TestKeyedVector const testVectorBLAKE2bKeyed_6 = {
+    "Tree BLAKE2b #2",
+    8, 100, 64,
+    true, 2, 3, 0, 0x123456789aULL, 1, 64, false,
+    {0xae, 0xfe, 0xce, 0x2e, 0x27, 0x94, 0x71, 0x7c,
+     0xdc, 0x6b, 0xba, 0x2c, 0xb3, 0xdd, 0x57, 0xe7,
+     0x5e, 0x05, 0x77, 0x60, 0xce, 0xea, 0x48, 0xcc,
+     0xd6, 0x6d, 0x32, 0x89, 0x44, 0x35, 0x14, 0xf9,
+     0x0c, 0x21, 0x87, 0xeb, 0x01, 0xf0, 0xfc, 0x11,
+     0x3a, 0x3e, 0x8b, 0x7a, 0x38, 0xad, 0x54, 0xa7,
+     0x2f, 0xbd, 0x4d, 0x93, 0xd6, 0xa8, 0xe0, 0x96,
+     0x31, 0xd8, 0x89, 0xf5, 0x8c, 0xeb, 0x42, 0xdc}
+};
+
+struct TestHMACVector
+{
+    const char *name;
+    uint8_t keyLen;
+    uint8_t hash[HASH_SIZE];
+};
+
+// HMAC test vectors for an empty message, generated with Python's hmac
+// and hashlib.  The key is keyLen bytes of the value keyLen.
+static TestHMACVector const testVectorHMACBLAKE2b_1 = {
+    "HMAC-BLAKE2b #1",
+    0,
+    {0x19, 0x8c, 0xd2, 0x00, 0x6f, 0x66, 0xff, 0x83,
+     0xfb, 0xbd, 0x91, 0x3f, 0x78, 0xac, 0xa2, 0x25,
+     0x1c, 0xaf, 0x4f, 0x19, 0xfe, 0x94, 0x75, 0xaa,
+     0xde, 0x8c, 0xf2, 0x09, 0x1b, 0x99, 0xa6, 0x84,
+     0x66, 0x77, 0x51, 0x77, 0x42, 0x4f, 0x58, 0x28,
+     0x68, 0x86, 0xcb, 0xae, 0x82, 0x29, 0x64, 0x4c,
+     0xec, 0x74, 0x72, 0x37, 0xd4, 0xb7, 0x21, 0x73,
+     0x54, 0x85, 0xe1, 0x73, 0x72, 0xfd, 0xf5, 0x9c}
+};
+static TestHMACVector const testVectorHMACBLAKE2b_2 = {
+    "HMAC-BLAKE2b #2",
+    HASH_SIZE,
+    {0x1c, 0x25, 0x9d, 0xaf, 0x3c, 0x82, 0xc3, 0x6a,
+     0x4d, 0xab, 0x91, 0x5c, 0x66, 0x7f, 0x55, 0xa1,
+     0xf4, 0xa7, 0x36, 0xb2, 0xd4, 0x8c, 0x39, 0x13,
+     0x1e, 0x4e, 0xeb, 0x7b, 0x6f, 0x77, 0x9c, 0x73,
+     0x6b, 0x9c, 0x73, 0x83, 0x0a, 0x01, 0x07, 0x70,
+     0xf4, 0x73, 0xfa, 0x78, 0xa6, 0x0b, 0xb1, 0x21,
+     0x7a, 0x92, 0x38, 0x95, 0x3e, 0x82, 0xe4, 0x99,
+     0xf7, 0xf8, 0x9c, 0x22, 0x51, 0x99, 0xfc, 0xc3}
+};
+static TestHMACVector const testVectorHMACBLAKE2b_3 = {
+    "HMAC-BLAKE2b #3",
+    BLOCK_SIZE + 1,
+    {0xf5, 0x04, 0x75, 0x4c, 0x24, 0xd9, 0xad, 0xc6,
+     0x39, 0xcd, 0x86, 0x81, 0x20, 0xac, 0x44, 0x9c,
+     0x18, 0xb5, 0x9b, 0xbe, 0xa0, 0xdf, 0x84, 0xfe,
+     0x5c, 0xc3, 0x06, 0x54, 0x8a, 0xd7, 0xb4, 0x12,
+     0xa7, 0x1f, 0xeb, 0xf8, 0xca, 0x82, 0xa2, 0x1a,
+     0x28, 0x23, 0x64, 0xb2, 0xf0, 0x6f, 0x49, 0xad,
+     0x29, 0x96, 0x18, 0x4b, 0xce, 0x4a, 0x1b, 0x9d,
+     0xfd, 0xef, 0x07, 0xa0, 0xfe, 0xb5, 0x4d, 0x54}
+};
+
 BLAKE2b blake2b;
+BLAKE2b blake2bCopy;
 
 byte buffer[BLOCK_SIZE + 2];
 
@@ -137,6 +276,86 @@ void testHash(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = strlen(test->data);
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+bool testKeyed_N(BLAKE2b *hash, const struct TestKeyedVector *test, size_t inc)
+{
+    uint8_t key[64];
+    uint8_t value[HASH_SIZE];
+    size_t posn, len;
+
+    for (posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)posn;
+    for (posn = 0; posn < test->dataLen; ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    if (test->tree) {
+        hash->resetTree(test->outLen, test->fanout, test->depth,
+                        test->leafLength, test->nodeOffset, test->nodeDepth,
+                        test->innerLength, test->lastNode, key, test->keyLen);
+    } else {
+        hash->reset(key, test->keyLen, test->outLen);
+    }
+    for (posn = 0; posn < test->dataLen; posn += inc) {
+        len = test->dataLen - posn;
+        if (len > inc)
+            len = inc;
+        hash->update(buffer + posn, len);
+    }
+    memset(value, 0xAA, sizeof(value));
+    hash->finalize(value, test->outLen);
+    return memcmp(value, test->hash, test->outLen) == 0;
+}
+
+void testKeyed(BLAKE2b *hash, const struct TestKeyedVector *test)
+{
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    ok  = testKeyed_N(hash, test, test->dataLen ? test->dataLen : 1);
+    ok &= testKeyed_N(hash, test, 1);
+    ok &= testKeyed_N(hash, test, 7);
+    ok &= testKeyed_N(hash, test, BLOCK_SIZE - 1);
+    ok &= testKeyed_N(hash, test, BLOCK_SIZE);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -191,19 +410,21 @@ void hashKey(Hash *hash, const uint8_t *key, size_t keyLen, uint8_t pad)
     }
 }
 
-void testHMAC(Hash *hash, size_t keyLen)
+void testHMAC(Hash *hash, size_t keyLen, size_t dataLen)
 {
     uint8_t result[HASH_SIZE];
 
     Serial.print("HMAC-BLAKE2b keysize=");
     Serial.print(keyLen);
+    Serial.print(" datasize=");
+    Serial.print(dataLen);
     Serial.print(" ... ");
 
     // Construct the expected result with a simple HMAC implementation.
     memset(buffer, (uint8_t)keyLen, keyLen);
     hashKey(hash, buffer, keyLen, 0x36);
     memset(buffer, 0xBA, sizeof(buffer));
-    hash->update(buffer, sizeof(buffer));
+    hash->update(buffer, dataLen);
     hash->finalize(result, HASH_SIZE);
     memset(buffer, (uint8_t)keyLen, keyLen);
     hashKey(hash, buffer, keyLen, 0x5C);
@@ -213,7 +434,7 @@ void testHMAC(Hash *hash, size_t keyLen)
     // Now use the library to compute the HMAC.
     hash->resetHMAC(buffer, keyLen);
     memset(buffer, 0xBA, sizeof(buffer));
-    hash->update(buffer, sizeof(buffer));
+    hash->update(buffer, dataLen);
     memset(buffer, (uint8_t)keyLen, keyLen);
     hash->finalizeHMAC(buffer, keyLen, buffer, HASH_SIZE);
 
@@ -224,6 +445,21 @@ void testHMAC(Hash *hash, size_t keyLen)
         Serial.println("Failed");
 }
 
+void testHMAC(Hash *hash, const struct TestHMACVector *test)
+{
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    memset(buffer, test->keyLen, test->keyLen);
+    hash->resetHMAC(buffer, test->keyLen);
+    hash->finalizeHMAC(buffer, test->keyLen, buffer, HASH_SIZE);
+
+    if (!memcmp(buffer, test->hash, HASH_SIZE))
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfFinalize(Hash *hash)
 {
     unsigned long start;
@@ -246,6 +482,31 @@ void perfFinalize(Hash *hash)
     Serial.println(" ops per second");
 }
 
+void perfKeyed(BLAKE2b *hash)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print("Keyed 16-byte MAC ... ");
+
+    for (size_t posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    start = micros();
+    for (count = 0; count < 1000; ++count) {
+        hash->reset(buffer, 32, 16);
+        hash->update(buffer, 16);
+        hash->finalize(buffer, 16);
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / 1000.0);
+    Serial.print("us per op, ");
+    Serial.print((1000.0 * 1000000.0) / elapsed);
+    Serial.println(" ops per second");
+}
+
 void setup()
 {
     Serial.begin(9600);
@@ -261,18 +522,32 @@ void setup()
     testHash(&blake2b, &testVectorBLAKE2b_2);
     testHash(&blake2b, &testVectorBLAKE2b_3);
     testHash(&blake2b, &testVectorBLAKE2b_4);
-    testHMAC(&blake2b, (size_t)0);
-    testHMAC(&blake2b, 1);
-    testHMAC(&blake2b, HASH_SIZE);
-    testHMAC(&blake2b, BLOCK_SIZE);
-    testHMAC(&blake2b, BLOCK_SIZE + 1);
-    testHMAC(&blake2b, BLOCK_SIZE + 2);
+    testCopyState(&blake2b, &blake2bCopy, &testVectorBLAKE2b_2);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_1);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_2);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_3);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_4);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_5);
+    testKeyed(&blake2b, &testVectorBLAKE2bKeyed_6);
+    testHMAC(&blake2b, (size_t)0, sizeof(buffer));
+    testHMAC(&blake2b, 1, sizeof(buffer));
+    testHMAC(&blake2b, HASH_SIZE, sizeof(buffer));
+    testHMAC(&blake2b, (size_t)0, 0);
+    testHMAC(&blake2b, HASH_SIZE, 0);
+    testHMAC(&blake2b, BLOCK_SIZE + 1, 0);
+    testHMAC(&blake2b, &testVectorHMACBLAKE2b_1);
+    testHMAC(&blake2b, &testVectorHMACBLAKE2b_2);
+    testHMAC(&blake2b, &testVectorHMACBLAKE2b_3);
+    testHMAC(&blake2b, BLOCK_SIZE, sizeof(buffer));
+    testHMAC(&blake2b, BLOCK_SIZE + 1, sizeof(buffer));
+    testHMAC(&blake2b, BLOCK_SIZE + 2, sizeof(buffer));
 
     Serial.println();
 
     Serial.println("Performance Tests:");
     perfHash(&blake2b);
     perfFinalize(&blake2b);
+    perfKeyed(&blake2b);
 }
 
 void loop()
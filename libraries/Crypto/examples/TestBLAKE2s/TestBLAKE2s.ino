@@ -73,7 +73,114 @@ static TestHashVector const testVectorBLAKE2s_4 = {
      0x09, 0xdb, 0x21, 0xb6, 0x6d, 0x94, 0x1f, 0xc7}
 };
 
+struct TestKeyedVector
+{
+    const char *name;
+    uint8_t keyLen;
+    uint8_t dataLen;
+    uint8_t outLen;
+    bool tree;
+    uint8_t fanout;
+    uint8_t depth;
+    uint32_t leafLength;
+    uint64_t nodeOffset;
+    uint8_t nodeDepth;
+    uint8_t innerLength;
+    bool lastNode;
+    uint8_t hash[HASH_SIZE];
+};
+
+// Keyed and tree mode test vectors generated with Python's hashlib.
+// The key and data are the byte sequences 0, 1, 2, ...
+static TestKeyedVector const testVectorBLAKE2sKeyed_1 = {
+    "Keyed BLAKE2s #1",
+    32, 0, 32,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x48, 0xa8, 0x99, 0x7d, 0xa4, 0x07, 0x87, 0x6b,
+     0x3d, 0x79, 0xc0, 0xd9, 0x23, 0x25, 0xad, 0x3b,
+     0x89, 0xcb, 0xb7, 0x54, 0xd8, 0x6a, 0xb7, 0x1a,
+     0xee, 0x04, 0x7a, 0xd3, 0x45, 0xfd, 0x2c, 0x49}
+};
+static TestKeyedVector const testVectorBLAKE2sKeyed_2 = {
+    "Keyed BLAKE2s #2",
+    32, 1, 32,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x40, 0xd1, 0x5f, 0xee, 0x7c, 0x32, 0x88, 0x30,
+     0x16, 0x6a, 0xc3, 0xf9, 0x18, 0x65, 0x0f, 0x80,
+     0x7e, 0x7e, 0x01, 0xe1, 0x77, 0x25, 0x8c, 0xdc,
+     0x0a, 0x39, 0xb1, 0x1f, 0x59, 0x80, 0x66, 0xf1}
+};
+static TestKeyedVector const testVectorBLAKE2sKeyed_3 = {
+    "Keyed BLAKE2s #3",
+    16, 64, 32,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x02, 0xba, 0x5c, 0xe9, 0x3a, 0x26, 0xf3, 0x13,
+     0x12, 0xdd, 0x22, 0x26, 0xe4, 0x8e, 0x52, 0x2d,
+     0xf9, 0x56, 0x81, 0x7d, 0x30, 0xe7, 0x97, 0xfc,
+     0x3d, 0xd2, 0x32, 0xf6, 0xbf, 0xb5, 0xd6, 0xa2}
+};
+static TestKeyedVector const testVectorBLAKE2sKeyed_4 = {
+    "Keyed BLAKE2s #4",
+    32, 100, 16,
+    false, 0, 0, 0, 0x0, 0, 0, false,
+    {0x0b, 0x67, 0xd3, 0x3f, 0x8b, 0x85, 0x9c, 0x31,
+     0x57, 0xfb, 0xab, 0xd9, 0xe6, 0xe4, 0x7e, 0xd0}
+};
+static TestKeyedVector const testVectorBLAKE2sKeyed_5 = {
+    "Tree BLAKE2s #1",
+    0, 100, 32,
+    true, 4, 2, 4096, 0x3, 0, 32, true,
+    {0x3a, 0x01, 0x97, 0x9e, 0xcb, 0x75, 0x5d, 0x29,
+     0xf4, 0x51, 0xfd, 0x9d, 0x08, 0xcf, 0x09, 0xf1,
+     0x8a, 0xdd, 0x36, 0x2d, 0x03, 0xa9, 0xff, 0x30,
+     0x2a, 0x12, 0x13, 0xa6, 0x9f, 0xd7, 0xc7, 0x92}
+};
+static TestKeyedVector const testVectorBLAKE2sKeyed_6 = {
+    "Tree BLAKE2s #2",
+    8, 100, 32,
+    true, 2, 3, 0, 0x12345678ULL, 1, 32, false,
+    {0x52, 0x8a, 0x05, 0xd3, 0xf7, 0x04, 0xf2, 0x1c,
+     0xcd, 0x40, 0xcb, 0xaa, 0xc6, 0xd2, 0xd7, 0x89,
+     0x63, 0xe7, 0x19, 0xc7, 0x96, 0x13, 0xab, 0x23,
+     0x6f, 0x8f, 0xb6, 0x53, 0x38, 0xb5, 0xcd, 0x36}
+};
+
+struct TestHMACVector
+{
+    const char *name;
+    uint8_t keyLen;
+    uint8_t hash[HASH_SIZE];
+};
+
+// HMAC test vectors for an empty message, generated with Python's hmac
+// and hashlib.  The key is keyLen bytes of the value keyLen.
+static TestHMACVector const testVectorHMACBLAKE2s_1 = {
+    "HMAC-BLAKE2s #1",
+    0,
+    {0xea, 0xf4, 0xbb, 0x25, 0x93, 0x8f, 0x4d, 0x20,
+     0xe7, 0x26, 0x56, 0xbb, 0xbc, 0x7a, 0x9b, 0xf6,
+     0x3c, 0x0c, 0x18, 0x53, 0x73, 0x33, 0xc3, 0x5b,
+     0xdb, 0x67, 0xdb, 0x14, 0x02, 0x66, 0x1a, 0xcd}
+};
+static TestHMACVector const testVectorHMACBLAKE2s_2 = {
+    "HMAC-BLAKE2s #2",
+    HASH_SIZE,
+    {0xf1, 0x7d, 0xc3, 0x44, 0x36, 0x64, 0xe8, 0xc6,
+     0x37, 0xf3, 0x6d, 0x8c, 0xd2, 0xfc, 0xd4, 0x61,
+     0x2e, 0x0b, 0x42, 0xab, 0xc9, 0x8c, 0x89, 0x85,
+     0x34, 0xda, 0xf2, 0xdd, 0xc5, 0x69, 0x11, 0x1e}
+};
+static TestHMACVector const testVectorHMACBLAKE2s_3 = {
+    "HMAC-BLAKE2s #3",
+    BLOCK_SIZE + 1,
+    {0x18, 0xdb, 0x34, 0x47, 0x09, 0x8b, 0xd6, 0x67,
+     0xbd, 0x6d, 0x4a, 0x33, 0x19, 0x8b, 0x4f, 0x7c,
+     0xf9, 0x6f, 0x40, 0xfc, 0x36, 0xa4, 0xba, 0xc4,
+     0xea, 0xf9, 0x80, 0xeb, 0xa0, 0x53, 0x7f, 0x34}
+};
+
 BLAKE2s blake2s;
+BLAKE2s blake2sCopy;
 
 byte buffer[128];
 
@@ -121,6 +228,86 @@ void testHash(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = strlen(test->data);
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+bool testKeyed_N(BLAKE2s *hash, const struct TestKeyedVector *test, size_t inc)
+{
+    uint8_t key[32];
+    uint8_t value[HASH_SIZE];
+    size_t posn, len;
+
+    for (posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)posn;
+    for (posn = 0; posn < test->dataLen; ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    if (test->tree) {
+        hash->resetTree(test->outLen, test->fanout, test->depth,
+                        test->leafLength, test->nodeOffset, test->nodeDepth,
+                        test->innerLength, test->lastNode, key, test->keyLen);
+    } else {
+        hash->reset(key, test->keyLen, test->outLen);
+    }
+    for (posn = 0; posn < test->dataLen; posn += inc) {
+        len = test->dataLen - posn;
+        if (len > inc)
+            len = inc;
+        hash->update(buffer + posn, len);
+    }
+    memset(value, 0xAA, sizeof(value));
+    hash->finalize(value, test->outLen);
+    return memcmp(value, test->hash, test->outLen) == 0;
+}
+
+void testKeyed(BLAKE2s *hash, const struct TestKeyedVector *test)
+{
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    ok  = testKeyed_N(hash, test, test->dataLen ? test->dataLen : 1);
+    ok &= testKeyed_N(hash, test, 1);
+    ok &= testKeyed_N(hash, test, 7);
+    ok &= testKeyed_N(hash, test, BLOCK_SIZE - 1);
+    ok &= testKeyed_N(hash, test, BLOCK_SIZE);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -175,19 +362,21 @@ void hashKey(Hash *hash, const uint8_t *key, size_t keyLen, uint8_t pad)
     }
 }
 
-void testHMAC(Hash *hash, size_t keyLen)
+void testHMAC(Hash *hash, size_t keyLen, size_t dataLen)
 {
     uint8_t result[HASH_SIZE];
 
     Serial.print("HMAC-BLAKE2s keysize=");
     Serial.print(keyLen);
+    Serial.print(" datasize=");
+    Serial.print(dataLen);
     Serial.print(" ... ");
 
     // Construct the expected result with a simple HMAC implementation.
     memset(buffer, (uint8_t)keyLen, keyLen);
     hashKey(hash, buffer, keyLen, 0x36);
     memset(buffer, 0xBA, sizeof(buffer));
-    hash->update(buffer, sizeof(buffer));
+    hash->update(buffer, dataLen);
     hash->finalize(result, HASH_SIZE);
     memset(buffer, (uint8_t)keyLen, keyLen);
     hashKey(hash, buffer, keyLen, 0x5C);
@@ -197,7 +386,7 @@ void testHMAC(Hash *hash, size_t keyLen)
     // Now use the library to compute the HMAC.
     hash->resetHMAC(buffer, keyLen);
     memset(buffer, 0xBA, sizeof(buffer));
-    hash->update(buffer, sizeof(buffer));
+    hash->update(buffer, dataLen);
     memset(buffer, (uint8_t)keyLen, keyLen);
     hash->finalizeHMAC(buffer, keyLen, buffer, HASH_SIZE);
 
@@ -208,6 +397,21 @@ void testHMAC(Hash *hash, size_t keyLen)
         Serial.println("Failed");
 }
 
+void testHMAC(Hash *hash, const struct TestHMACVector *test)
+{
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    memset(buffer, test->keyLen, test->keyLen);
+    hash->resetHMAC(buffer, test->keyLen);
+    hash->finalizeHMAC(buffer, test->keyLen, buffer, HASH_SIZE);
+
+    if (!memcmp(buffer, test->hash, HASH_SIZE))
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfFinalize(Hash *hash)
 {
     unsigned long start;
@@ -268,6 +472,31 @@ void perfHMAC(Hash *hash)
     Serial.println(" ops per second");
 }
 
+void perfKeyed(BLAKE2s *hash)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print("Keyed 16-byte MAC ... ");
+
+    for (size_t posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    start = micros();
+    for (count = 0; count < 1000; ++count) {
+        hash->reset(buffer, 16, 16);
+        hash->update(buffer, 16);
+        hash->finalize(buffer, 16);
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / 1000.0);
+    Serial.print("us per op, ");
+    Serial.print((1000.0 * 1000000.0) / elapsed);
+    Serial.println(" ops per second");
+}
+
 void setup()
 {
     Serial.begin(9600);
@@ -283,18 +512,32 @@ void setup()
     testHash(&blake2s, &testVectorBLAKE2s_2);
     testHash(&blake2s, &testVectorBLAKE2s_3);
     testHash(&blake2s, &testVectorBLAKE2s_4);
-    testHMAC(&blake2s, (size_t)0);
-    testHMAC(&blake2s, 1);
-    testHMAC(&blake2s, HASH_SIZE);
-    testHMAC(&blake2s, BLOCK_SIZE);
-    testHMAC(&blake2s, BLOCK_SIZE + 1);
-    testHMAC(&blake2s, sizeof(buffer));
+    testCopyState(&blake2s, &blake2sCopy, &testVectorBLAKE2s_2);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_1);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_2);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_3);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_4);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_5);
+    testKeyed(&blake2s, &testVectorBLAKE2sKeyed_6);
+    testHMAC(&blake2s, (size_t)0, sizeof(buffer));
+    testHMAC(&blake2s, 1, sizeof(buffer));
+    testHMAC(&blake2s, HASH_SIZE, sizeof(buffer));
+    testHMAC(&blake2s, (size_t)0, 0);
+    testHMAC(&blake2s, HASH_SIZE, 0);
+    testHMAC(&blake2s, BLOCK_SIZE + 1, 0);
+    testHMAC(&blake2s, &testVectorHMACBLAKE2s_1);
+    testHMAC(&blake2s, &testVectorHMACBLAKE2s_2);
+    testHMAC(&blake2s, &testVectorHMACBLAKE2s_3);
+    testHMAC(&blake2s, BLOCK_SIZE, sizeof(buffer));
+    testHMAC(&blake2s, BLOCK_SIZE + 1, sizeof(buffer));
+    testHMAC(&blake2s, sizeof(buffer), sizeof(buffer));
 
     Serial.println();
 
     Serial.println("Performance Tests:");
     perfHash(&blake2s);
     perfFinalize(&blake2s);
+    perfKeyed(&blake2s);
     perfHMAC(&blake2s);
 }
 
@@ -57,7 +57,7 @@ void bytesFromString(uint8_t *x, size_t xsize, const char *str)
 {
     uint8_t ch;
     size_t posn;
-    memset(x, 0, sizeof(limb_t) * xsize);
+    memset(x, 0, xsize);
     while ((ch = pgm_read_byte((uint8_t *)str)) != '\0') {
         if (ch >= '0' && ch <= '9') {
             // Quick and simple method to multiply by 10 and add the new digit.
@@ -217,14 +217,7 @@ static void truncateNumber(limb_t *limbs, size_t bytes)
     while (posn > bytes) {
         --posn;
         posn2 = posn % sizeof(limb_t);
-        if (posn2 == 0)
-            mask = 0;
-        else if (posn2 == 1)
-            mask = 0x000000FF;
-        else if (posn2 == 2)
-            mask = 0x0000FFFF;
-        else
-            mask = 0x00FFFFFF;
+        mask = (((limb_t)1) << (posn2 * 8)) - 1;
         limbs[posn / sizeof(limb_t)] &= mask;
     }
 }
@@ -353,11 +346,112 @@ void testPackUnpack(void)
     }
 }
 
+#define MUL_MAX_LIMBS   (2048 / LIMB_BITS)
+#define MUL_CHUNK_LIMBS 2
+
+static limb_t mulX[MUL_MAX_LIMBS];
+static limb_t mulY[MUL_MAX_LIMBS];
+static limb_t mulResult[MUL_MAX_LIMBS * 2];
+static limb_t mulCheck[MUL_MAX_LIMBS * 2];
+static limb_t mulTemp[MUL_MAX_LIMBS + MUL_CHUNK_LIMBS];
+
+// Fill a big number with pseudorandom limbs.
+static void randomNumber(limb_t *x, size_t xcount)
+{
+    static uint32_t seed = 0x12345678;
+    uint8_t *bytes = (uint8_t *)x;
+    for (size_t posn = 0; posn < xcount * sizeof(limb_t); ++posn) {
+        seed = seed * 1103515245 + 12345;
+        bytes[posn] = (uint8_t)(seed >> 16);
+    }
+}
+
+// Test mul() against a long multiplication by small chunks of y,
+// which are below the Karatsuba threshold.
+void testMul(size_t xcount, size_t ycount)
+{
+    Serial.print("mul ");
+    Serial.print(xcount * LIMB_BITS);
+    Serial.print(" x ");
+    Serial.print(ycount * LIMB_BITS);
+    Serial.print(": ");
+    Serial.flush();
+
+    randomNumber(mulX, xcount);
+    randomNumber(mulY, ycount);
+    BigNumberUtil::mul(mulResult, mulX, xcount, mulY, ycount);
+
+    memset(mulCheck, 0, sizeof(mulCheck));
+    for (size_t posn = 0; posn < ycount; posn += MUL_CHUNK_LIMBS) {
+        size_t count = ycount - posn;
+        if (count > MUL_CHUNK_LIMBS)
+            count = MUL_CHUNK_LIMBS;
+        BigNumberUtil::mul(mulTemp, mulX, xcount, mulY + posn, count);
+        limb_t carry = BigNumberUtil::add
+            (mulCheck + posn, mulCheck + posn, mulTemp, xcount + count);
+        for (size_t index = posn + xcount + count;
+                carry && index < (xcount + ycount); ++index) {
+            carry = (++(mulCheck[index]) == 0);
+        }
+    }
+
+    if (memcmp(mulResult, mulCheck, (xcount + ycount) * sizeof(limb_t)) == 0)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+}
+
+// Measure the performance of mul() on square operands of various sizes.
+void perfMul(size_t bits)
+{
+    size_t count = bits / LIMB_BITS;
+    unsigned long start;
+    unsigned long elapsed;
+    int loops;
+
+    Serial.print("mul ");
+    Serial.print(bits);
+    Serial.print(" x ");
+    Serial.print(bits);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    randomNumber(mulX, count);
+    randomNumber(mulY, count);
+    loops = (int)(65536UL / (bits * bits / 64)) + 1;
+    start = micros();
+    for (int loop = 0; loop < loops; ++loop)
+        BigNumberUtil::mul(mulResult, mulX, count, mulY, count);
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (double)loops);
+    Serial.println("us per op");
+}
+
+void testMul()
+{
+    testMul(256 / LIMB_BITS, 256 / LIMB_BITS);
+    testMul(1024 / LIMB_BITS, 1024 / LIMB_BITS);
+    testMul(1024 / LIMB_BITS, 1024 / LIMB_BITS - 1);
+    testMul(2048 / LIMB_BITS, 1024 / LIMB_BITS + 3);
+    testMul(1536 / LIMB_BITS + 1, 1536 / LIMB_BITS + 1);
+    testMul(2048 / LIMB_BITS, 2048 / LIMB_BITS);
+
+    Serial.println();
+    Serial.println("Performance Tests:");
+    perfMul(256);
+    perfMul(512);
+    perfMul(1024);
+    perfMul(2048);
+}
+
 void setup()
 {
     Serial.begin(9600);
 
     testPackUnpack();
+    Serial.println();
+    testMul();
 }
 
 void loop()
@@ -114,6 +114,52 @@ bool testCipher_N(Cipher *cipher, const struct TestVector *test, size_t inc)
         cipher->decrypt(output + posn, test->ciphertext + posn, len);
     }
 
+    if (memcmp(output, test->plaintext, test->size) != 0)
+        return false;
+
+    // Decrypt again in place.
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+    memcpy(output, test->ciphertext, test->size);
+
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->decrypt(output + posn, output + posn, len);
+    }
+
+    if (memcmp(output, test->plaintext, test->size) != 0)
+        return false;
+
+    return true;
+}
+
+// Encrypts and decrypts in place with blocks that straddle segments.
+bool testCipherV(Cipher *cipher, const struct TestVector *test)
+{
+    static size_t const sizes[] = {5, 19, 1, 0, 23, 16};
+    byte output[MAX_CIPHERTEXT_SIZE];
+    CipherSegment segments[6];
+    size_t posn = 0;
+    uint8_t index;
+
+    for (index = 0; index < 6; ++index) {
+        segments[index].data = output + posn;
+        segments[index].len = sizes[index];
+        posn += sizes[index];
+    }
+
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+    memcpy(output, test->plaintext, test->size);
+    cipher->encryptv(segments, 6);
+    if (memcmp(output, test->ciphertext, test->size) != 0)
+        return false;
+
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+    cipher->decryptv(segments, 6);
     if (memcmp(output, test->plaintext, test->size) != 0)
         return false;
 
@@ -131,6 +177,8 @@ void testCipher(Cipher *cipher, const struct TestVector *test)
     ok  = testCipher_N(cipher, test, test->size);
     ok &= testCipher_N(cipher, test, 16);
     ok &= testCipher_N(cipher, test, 32);
+    ok &= testCipher_N(cipher, test, 48);
+    ok &= testCipherV(cipher, test);
 
     if (ok)
         Serial.println("Passed");
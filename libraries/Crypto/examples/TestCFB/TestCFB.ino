@@ -140,6 +140,21 @@ bool testCipher_N(Cipher *cipher, const struct TestVector *test, size_t inc)
         cipher->decrypt(output + posn, test->ciphertext + posn, len);
     }
 
+    if (memcmp(output, test->plaintext, test->size) != 0)
+        return false;
+
+    // Decrypt again in place.
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+    memcpy(output, test->ciphertext, test->size);
+
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->decrypt(output + posn, output + posn, len);
+    }
+
     if (memcmp(output, test->plaintext, test->size) != 0)
         return false;
 
@@ -160,6 +175,7 @@ void testCipher(Cipher *cipher, const struct TestVector *test)
     ok &= testCipher_N(cipher, test, 8);
     ok &= testCipher_N(cipher, test, 13);
     ok &= testCipher_N(cipher, test, 16);
+    ok &= testCipher_N(cipher, test, 48);
 
     if (ok)
         Serial.println("Passed");
@@ -27,6 +27,8 @@ This example runs tests on the CTR implementation to verify correct behaviour.
 #include <Crypto.h>
 #include <AES.h>
 #include <CTR.h>
+#include <CTRMode.h>
+#include <CryptoWorker.h>
 #include <string.h>
 
 #define MAX_PLAINTEXT_SIZE  36
@@ -91,8 +93,10 @@ static TestVector const testVectorAES128CTR3 = {
 };
 
 CTR<AES128> ctraes128;
+CTRMode<AES128> ctrmode128;
 
 byte buffer[128];
+byte lookAhead[48];
 
 bool testCipher_N(Cipher *cipher, const struct TestVector *test, size_t inc)
 {
@@ -162,6 +166,214 @@ void testCipher(Cipher *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+bool testLookAhead_N(CTRCommon *cipher, const struct TestVector *test, size_t inc)
+{
+    byte output[MAX_CIPHERTEXT_SIZE];
+    size_t posn, len;
+
+    cipher->clear();
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+
+    // Prime the look-ahead buffer with one block and then top it up
+    // by a single block between each call to encrypt().
+    if (cipher->precompute(1) != 1 || cipher->available() != 16)
+        return false;
+    memset(output, 0xBA, sizeof(output));
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->encrypt(output + posn, test->plaintext + posn, len);
+        cipher->precompute(1);
+    }
+    if (memcmp(output, test->ciphertext, test->size) != 0)
+        return false;
+
+    // Fill the buffer completely and then decrypt.
+    cipher->setIV(test->iv, cipher->ivSize());
+    if (cipher->precompute() != (sizeof(lookAhead) / 16))
+        return false;
+    if (cipher->precompute() != 0)
+        return false;
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->decrypt(output + posn, test->ciphertext + posn, len);
+    }
+    if (memcmp(output, test->plaintext, test->size) != 0)
+        return false;
+
+    return true;
+}
+
+void testLookAhead(CTRCommon *cipher, const struct TestVector *test)
+{
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" Look-Ahead ... ");
+
+    cipher->setLookAhead(lookAhead, sizeof(lookAhead));
+    ok  = testLookAhead_N(cipher, test, test->size);
+    ok &= testLookAhead_N(cipher, test, 1);
+    ok &= testLookAhead_N(cipher, test, 5);
+    ok &= testLookAhead_N(cipher, test, 13);
+    ok &= testLookAhead_N(cipher, test, 16);
+    cipher->setLookAhead(0, 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+bool testStatic_N(CTRMode<AES128> *cipher, const struct TestVector *test, size_t inc)
+{
+    byte output[MAX_CIPHERTEXT_SIZE];
+    size_t posn, len;
+
+    cipher->clear();
+    if (!cipher->setKey(test->key, cipher->keySize()))
+        return false;
+    if (!cipher->setIV(test->iv, cipher->ivSize()))
+        return false;
+    memset(output, 0xBA, sizeof(output));
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->encrypt(output + posn, test->plaintext + posn, len);
+    }
+    if (memcmp(output, test->ciphertext, test->size) != 0)
+        return false;
+
+    cipher->setIV(test->iv, cipher->ivSize());
+    for (posn = 0; posn < test->size; posn += inc) {
+        len = test->size - posn;
+        if (len > inc)
+            len = inc;
+        cipher->decrypt(output + posn, test->ciphertext + posn, len);
+    }
+    if (memcmp(output, test->plaintext, test->size) != 0)
+        return false;
+
+    return true;
+}
+
+void testStatic(CTRMode<AES128> *cipher, const struct TestVector *test)
+{
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" Static ... ");
+
+    ok  = testStatic_N(cipher, test, test->size);
+    ok &= testStatic_N(cipher, test, 1);
+    ok &= testStatic_N(cipher, test, 5);
+    ok &= testStatic_N(cipher, test, 13);
+    ok &= testStatic_N(cipher, test, 16);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+// Checks that CTRMode and CTR produce the same keystream over enough
+// blocks to use the batched path and to wrap a short counter.
+void testStaticWrap(const struct TestVector *test)
+{
+    static byte expected[sizeof(buffer)];
+    byte iv[16];
+    bool ok = true;
+    size_t size;
+
+    Serial.print("Static Counter Wrap ... ");
+
+    memcpy(iv, test->iv, 16);
+    iv[15] = 0xFD;
+    for (size = 1; size <= 16; size += 15) {
+        ctraes128.clear();
+        ctraes128.setKey(test->key, 16);
+        ctraes128.setIV(iv, 16);
+        ctraes128.setCounterSize(size);
+        memset(expected, 0, sizeof(expected));
+        ctraes128.encrypt(expected, expected, sizeof(expected));
+
+        ctrmode128.clear();
+        ctrmode128.setKey(test->key, 16);
+        ctrmode128.setIV(iv, 16);
+        ctrmode128.setCounterSize(size);
+        memset(buffer, 0, sizeof(buffer));
+        ctrmode128.encrypt(buffer, buffer, 7);
+        ctrmode128.encrypt(buffer + 7, buffer + 7, sizeof(buffer) - 7);
+        if (memcmp(buffer, expected, sizeof(buffer)) != 0)
+            ok = false;
+    }
+    ctraes128.setCounterSize(16);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+// Checks that splitting a long input between the cores with a worker
+// gives the same keystream as encrypting it on a single core.  The input
+// has to be at least 1024 bytes long, which is too big for AVR.
+#if !defined(__AVR__)
+static CryptoWorker worker;
+static byte longBuffer[1040];
+#endif
+
+void testWorker(const struct TestVector *test)
+{
+#if !defined(__AVR__)
+    byte iv[16];
+    bool ok = true;
+    size_t size;
+    size_t posn;
+
+    Serial.print("Worker ... ");
+
+    worker.begin();
+    memcpy(iv, test->iv, 16);
+    iv[15] = 0xF0;
+    for (size = 1; size <= 16; size += 15) {
+        ctraes128.clear();
+        ctraes128.setKey(test->key, 16);
+        ctraes128.setIV(iv, 16);
+        ctraes128.setCounterSize(size);
+        ctraes128.setWorker(&worker);
+        memset(longBuffer, 0, sizeof(longBuffer));
+        ctraes128.encrypt(longBuffer, longBuffer, 3);
+        ctraes128.encrypt(longBuffer + 3, longBuffer + 3,
+                          sizeof(longBuffer) - 3);
+        ctraes128.setWorker(0);
+
+        ctraes128.setIV(iv, 16);
+        for (posn = 0; posn < sizeof(longBuffer); posn += sizeof(buffer)) {
+            size_t len = sizeof(longBuffer) - posn;
+            if (len > sizeof(buffer))
+                len = sizeof(buffer);
+            memset(buffer, 0, len);
+            ctraes128.encrypt(buffer, buffer, len);
+            if (memcmp(buffer, longBuffer + posn, len) != 0)
+                ok = false;
+        }
+    }
+    ctraes128.setCounterSize(16);
+    worker.end();
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+#endif
+}
+
 void perfCipherEncrypt(const char *name, Cipher *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -208,6 +420,29 @@ void perfCipherDecrypt(const char *name, Cipher *cipher, const struct TestVector
     Serial.println(" bytes per second");
 }
 
+void perfStaticEncrypt(const char *name, CTRMode<AES128> *cipher, const struct TestVector *test)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, cipher->ivSize());
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        cipher->encrypt(buffer, buffer, sizeof(buffer));
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (sizeof(buffer) * 500.0));
+    Serial.print("us per byte, ");
+    Serial.print((sizeof(buffer) * 500.0 * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
 void setup()
 {
     Serial.begin(9600);
@@ -218,12 +453,21 @@ void setup()
     testCipher(&ctraes128, &testVectorAES128CTR1);
     testCipher(&ctraes128, &testVectorAES128CTR2);
     testCipher(&ctraes128, &testVectorAES128CTR3);
+    testLookAhead(&ctraes128, &testVectorAES128CTR1);
+    testLookAhead(&ctraes128, &testVectorAES128CTR2);
+    testLookAhead(&ctraes128, &testVectorAES128CTR3);
+    testStatic(&ctrmode128, &testVectorAES128CTR1);
+    testStatic(&ctrmode128, &testVectorAES128CTR2);
+    testStatic(&ctrmode128, &testVectorAES128CTR3);
+    testStaticWrap(&testVectorAES128CTR1);
+    testWorker(&testVectorAES128CTR1);
 
     Serial.println();
 
     Serial.println("Performance Tests:");
     perfCipherEncrypt("AES-128-CTR Encrypt", &ctraes128, &testVectorAES128CTR1);
     perfCipherDecrypt("AES-128-CTR Decrypt", &ctraes128, &testVectorAES128CTR1);
+    perfStaticEncrypt("AES-128-CTRMode Encrypt", &ctrmode128, &testVectorAES128CTR1);
 }
 
 void loop()
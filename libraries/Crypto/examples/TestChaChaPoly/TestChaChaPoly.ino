@@ -39,7 +39,7 @@ struct TestVector
     uint8_t plaintext[MAX_PLAINTEXT_LEN];
     uint8_t ciphertext[MAX_PLAINTEXT_LEN];
     uint8_t authdata[16];
-    uint8_t iv[16];
+    uint8_t iv[24];
     uint8_t tag[16];
     size_t authsize;
     size_t datasize;
@@ -180,9 +180,78 @@ static TestVector const testVectorChaChaPoly_2 PROGMEM = {
     .ivsize      = 8
 };
 
+// Test vector for XChaChaPoly from draft-irtf-cfrg-xchacha-03.txt
+static TestVector const testVectorXChaChaPoly_1 PROGMEM = {
+    .name        = "XChaChaPoly #1",
+    .key         = {0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+                    0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+                    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+                    0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f},
+    .plaintext   = {0x4c, 0x61, 0x64, 0x69, 0x65, 0x73, 0x20, 0x61,
+                    0x6e, 0x64, 0x20, 0x47, 0x65, 0x6e, 0x74, 0x6c,
+                    0x65, 0x6d, 0x65, 0x6e, 0x20, 0x6f, 0x66, 0x20,
+                    0x74, 0x68, 0x65, 0x20, 0x63, 0x6c, 0x61, 0x73,
+                    0x73, 0x20, 0x6f, 0x66, 0x20, 0x27, 0x39, 0x39,
+                    0x3a, 0x20, 0x49, 0x66, 0x20, 0x49, 0x20, 0x63,
+                    0x6f, 0x75, 0x6c, 0x64, 0x20, 0x6f, 0x66, 0x66,
+                    0x65, 0x72, 0x20, 0x79, 0x6f, 0x75, 0x20, 0x6f,
+                    0x6e, 0x6c, 0x79, 0x20, 0x6f, 0x6e, 0x65, 0x20,
+                    0x74, 0x69, 0x70, 0x20, 0x66, 0x6f, 0x72, 0x20,
+                    0x74, 0x68, 0x65, 0x20, 0x66, 0x75, 0x74, 0x75,
+                    0x72, 0x65, 0x2c, 0x20, 0x73, 0x75, 0x6e, 0x73,
+                    0x63, 0x72, 0x65, 0x65, 0x6e, 0x20, 0x77, 0x6f,
+                    0x75, 0x6c, 0x64, 0x20, 0x62, 0x65, 0x20, 0x69,
+                    0x74, 0x2e},
+    .ciphertext  = {0xbd, 0x6d, 0x17, 0x9d, 0x3e, 0x83, 0xd4, 0x3b,
+                    0x95, 0x76, 0x57, 0x94, 0x93, 0xc0, 0xe9, 0x39,
+                    0x57, 0x2a, 0x17, 0x00, 0x25, 0x2b, 0xfa, 0xcc,
+                    0xbe, 0xd2, 0x90, 0x2c, 0x21, 0x39, 0x6c, 0xbb,
+                    0x73, 0x1c, 0x7f, 0x1b, 0x0b, 0x4a, 0xa6, 0x44,
+                    0x0b, 0xf3, 0xa8, 0x2f, 0x4e, 0xda, 0x7e, 0x39,
+                    0xae, 0x64, 0xc6, 0x70, 0x8c, 0x54, 0xc2, 0x16,
+                    0xcb, 0x96, 0xb7, 0x2e, 0x12, 0x13, 0xb4, 0x52,
+                    0x2f, 0x8c, 0x9b, 0xa4, 0x0d, 0xb5, 0xd9, 0x45,
+                    0xb1, 0x1b, 0x69, 0xb9, 0x82, 0xc1, 0xbb, 0x9e,
+                    0x3f, 0x3f, 0xac, 0x2b, 0xc3, 0x69, 0x48, 0x8f,
+                    0x76, 0xb2, 0x38, 0x35, 0x65, 0xd3, 0xff, 0xf9,
+                    0x21, 0xf9, 0x66, 0x4c, 0x97, 0x63, 0x7d, 0xa9,
+                    0x76, 0x88, 0x12, 0xf6, 0x15, 0xc6, 0x8b, 0x13,
+                    0xb5, 0x2e},
+    .authdata    = {0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3,
+                    0xc4, 0xc5, 0xc6, 0xc7},
+    .iv          = {0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+                    0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+                    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57},
+    .tag         = {0xc0, 0x87, 0x59, 0x24, 0xc1, 0xc7, 0x98, 0x79,
+                    0x47, 0xde, 0xaf, 0xd8, 0x78, 0x0a, 0xcf, 0x49},
+    .authsize    = 12,
+    .datasize    = 114,
+    .tagsize     = 16,
+    .ivsize      = 24
+};
+
+// Test vector for HChaCha20 from draft-irtf-cfrg-xchacha-03.txt
+static uint8_t const hchachaKey[32] PROGMEM = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+static uint8_t const hchachaNonce[16] PROGMEM = {
+    0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a,
+    0x00, 0x00, 0x00, 0x00, 0x31, 0x41, 0x59, 0x27
+};
+static uint8_t const hchachaOutput[32] PROGMEM = {
+    0x82, 0x41, 0x3b, 0x42, 0x27, 0xb2, 0x7b, 0xfe,
+    0xd3, 0x0e, 0x42, 0x50, 0x8a, 0x87, 0x7d, 0x73,
+    0xa0, 0xf9, 0xe4, 0xd5, 0x8a, 0x74, 0xa8, 0x53,
+    0xc1, 0x2e, 0xc4, 0x13, 0x26, 0xd3, 0xec, 0xdc
+};
+
 TestVector testVector;
 
 ChaChaPoly chachapoly;
+XChaChaPoly xchachapoly;
 
 byte buffer[MAX_PLAINTEXT_LEN];
 
@@ -258,6 +327,109 @@ bool testCipher_N(ChaChaPoly *cipher, const struct TestVector *test, size_t inc)
     return true;
 }
 
+// Splits a buffer into a list of unevenly-sized segments.
+size_t makeSegments(CipherSegment *segments, uint8_t *data, size_t len)
+{
+    static uint8_t const sizes[] = {3, 13, 0, 7, 29};
+    size_t count = 0;
+    while (len > 0) {
+        size_t size = sizes[count % sizeof(sizes)];
+        if (size > len)
+            size = len;
+        segments[count].data = data;
+        segments[count].len = size;
+        data += size;
+        len -= size;
+        ++count;
+    }
+    return count;
+}
+
+// Encrypts and decrypts in place using scatter/gather segment lists.
+bool testCipherV(ChaChaPoly *cipher, const struct TestVector *test)
+{
+    CipherSegment adsegs[8];
+    CipherSegment segments[MAX_PLAINTEXT_LEN / 8 + 1];
+    uint8_t authdata[sizeof(test->authdata)];
+    size_t adcount, count;
+    uint8_t tag[16];
+
+    memcpy(authdata, test->authdata, test->authsize);
+    adcount = makeSegments(adsegs, authdata, test->authsize);
+    count = makeSegments(segments, buffer, test->datasize);
+
+    cipher->setKey(test->key, 32);
+    cipher->setIV(test->iv, test->ivsize);
+    cipher->addAuthDatav(adsegs, adcount);
+    memcpy(buffer, test->plaintext, test->datasize);
+    cipher->encryptv(segments, count);
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+    cipher->computeTag(tag, sizeof(tag));
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    cipher->setKey(test->key, 32);
+    cipher->setIV(test->iv, test->ivsize);
+    cipher->addAuthDatav(adsegs, adcount);
+    cipher->decryptv(segments, count);
+    if (memcmp(buffer, test->plaintext, test->datasize) != 0)
+        return false;
+    return cipher->checkTag(tag, sizeof(tag));
+}
+
+// Encrypts and decrypts using the one-shot seal() and open() functions.
+bool testSealOpen(ChaChaPoly *cipher, const struct TestVector *test)
+{
+    uint8_t tag[16];
+
+    if (!cipher->seal(buffer, tag, test->key, test->iv, test->ivsize,
+                      test->authdata, test->authsize,
+                      test->plaintext, test->datasize))
+        return false;
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    if (!cipher->open(buffer, tag, test->key, test->iv, test->ivsize,
+                      test->authdata, test->authsize,
+                      buffer, test->datasize))
+        return false;
+    if (memcmp(buffer, test->plaintext, test->datasize) != 0)
+        return false;
+
+    // A corrupted tag must be rejected and the plaintext destroyed.
+    tag[0] ^= 0x01;
+    if (cipher->open(buffer, tag, test->key, test->iv, test->ivsize,
+                     test->authdata, test->authsize,
+                     test->ciphertext, test->datasize))
+        return false;
+    for (size_t posn = 0; posn < test->datasize; ++posn) {
+        if (buffer[posn] != 0)
+            return false;
+    }
+    return true;
+}
+
+void testHChaCha()
+{
+    uint8_t key[32];
+    uint8_t nonce[16];
+    uint8_t output[32];
+
+    Serial.print("HChaCha20 ... ");
+
+    memcpy_P(key, hchachaKey, sizeof(key));
+    memcpy_P(nonce, hchachaNonce, sizeof(nonce));
+    ChaCha::hchacha(output, key, nonce);
+    memcpy_P(key, hchachaOutput, sizeof(key));
+    if (memcmp(output, key, sizeof(output)) == 0)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void testCipher(ChaChaPoly *cipher, const struct TestVector *test)
 {
     bool ok;
@@ -275,6 +447,8 @@ void testCipher(ChaChaPoly *cipher, const struct TestVector *test)
     ok &= testCipher_N(cipher, test, 8);
     ok &= testCipher_N(cipher, test, 13);
     ok &= testCipher_N(cipher, test, 16);
+    ok &= testCipherV(cipher, test);
+    ok &= testSealOpen(cipher, test);
 
     if (ok)
         Serial.println("Passed");
@@ -436,11 +610,14 @@ void setup()
     Serial.println("Test Vectors:");
     testCipher(&chachapoly, &testVectorChaChaPoly_1);
     testCipher(&chachapoly, &testVectorChaChaPoly_2);
+    testHChaCha();
+    testCipher(&xchachapoly, &testVectorXChaChaPoly_1);
 
     Serial.println();
 
     Serial.println("Performance Tests:");
     perfCipher(&chachapoly, &testVectorChaChaPoly_1);
+    perfCipher(&xchachapoly, &testVectorXChaChaPoly_1);
 }
 
 void loop()
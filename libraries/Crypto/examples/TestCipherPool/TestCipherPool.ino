@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the CipherPool class to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <AES.h>
+#include <GCM.h>
+#include <CipherPool.h>
+#include <string.h>
+
+static uint8_t const key1[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+static uint8_t const key2[16] = {
+    0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87,
+    0x78, 0x69, 0x5A, 0x4B, 0x3C, 0x2D, 0x1E, 0x0F
+};
+static uint8_t const iv[12] = {
+    0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD,
+    0xDE, 0xCA, 0xF8, 0x88
+};
+
+static CipherPool<GCM<AES128>, 2> pool;
+static GCM<AES128> reference;
+static uint8_t packet[64];
+static uint8_t expected[64];
+
+// Encrypts the packet and its tag into "output" with "cipher".
+void encryptPacket(uint8_t *output, AuthenticatedCipher *cipher)
+{
+    memset(packet, 0xA5, 48);
+    cipher->setIV(iv, sizeof(iv));
+    cipher->encrypt(output, packet, 48);
+    cipher->computeTag(output + 48, 16);
+}
+
+bool checkSession(uint32_t sessionId, const uint8_t *key)
+{
+    AuthenticatedCipher *cipher = pool.acquire(sessionId, key, 16);
+    if (!cipher)
+        return false;
+    reference.setKey(key, 16);
+    encryptPacket(expected, &reference);
+    encryptPacket(packet, cipher);
+    return memcmp(packet, expected, 64) == 0;
+}
+
+void testPool()
+{
+    bool ok;
+
+    Serial.print("Session keys ... ");
+    Serial.flush();
+    ok = checkSession(1, key1) && checkSession(2, key2) &&
+         checkSession(1, key1) && checkSession(2, key2);
+    Serial.println(ok ? "ok" : "failed");
+
+    Serial.print("Evict least recently used ... ");
+    Serial.flush();
+    AuthenticatedCipher *cipher1 = pool.find(1);
+    ok = cipher1 != 0;
+    if (!checkSession(3, key2))
+        ok = false;
+    if (pool.find(2) || pool.find(1) != cipher1 || !pool.find(3))
+        ok = false;
+    Serial.println(ok ? "ok" : "failed");
+
+    Serial.print("Remove session ... ");
+    Serial.flush();
+    pool.remove(1);
+    ok = !pool.find(1) && pool.find(3);
+    if (!checkSession(2, key1))
+        ok = false;
+    pool.clear();
+    if (pool.find(2) || pool.find(3))
+        ok = false;
+    Serial.println(ok ? "ok" : "failed");
+
+    Serial.print("Invalid key size ... ");
+    Serial.flush();
+    ok = !pool.insert(4, key1, 7) && !pool.find(4);
+    Serial.println(ok ? "ok" : "failed");
+}
+
+void perfPool()
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print("Packet with setKey() ... ");
+    Serial.flush();
+    start = micros();
+    for (count = 0; count < 200; ++count) {
+        reference.setKey((count & 1) ? key2 : key1, 16);
+        encryptPacket(expected, &reference);
+    }
+    elapsed = micros() - start;
+    Serial.print(elapsed / 200.0);
+    Serial.println("us per packet");
+
+    Serial.print("Packet with CipherPool ... ");
+    Serial.flush();
+    start = micros();
+    for (count = 0; count < 200; ++count) {
+        AuthenticatedCipher *cipher =
+            pool.acquire(count & 1, (count & 1) ? key2 : key1, 16);
+        encryptPacket(expected, cipher);
+    }
+    elapsed = micros() - start;
+    Serial.print(elapsed / 200.0);
+    Serial.println("us per packet");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Cases:");
+    testPool();
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfPool();
+}
+
+void loop()
+{
+}
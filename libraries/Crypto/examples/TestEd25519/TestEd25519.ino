@@ -26,6 +26,7 @@ This example runs tests on the Ed25519 algorithm.
 
 #include <Crypto.h>
 #include <Ed25519.h>
+#include <CryptoWorker.h>
 #include <RNG.h>
 #include <utility/ProgMemUtil.h>
 #include <string.h>
@@ -85,6 +86,29 @@ static TestVector const testVectorEd25519_2 PROGMEM = {
                    0xb0, 0x0d, 0x29, 0x16, 0x12, 0xbb, 0x0c, 0x00}
 };
 
+// Test vector for Ed25519ph from RFC 8032.  The message is "abc".
+static TestVector const testVectorEd25519ph PROGMEM = {
+    .name       = "Ed25519ph",
+    .privateKey = {0x83, 0x3f, 0xe6, 0x24, 0x09, 0x23, 0x7b, 0x9d,
+                   0x62, 0xec, 0x77, 0x58, 0x75, 0x20, 0x91, 0x1e,
+                   0x9a, 0x75, 0x9c, 0xec, 0x1d, 0x19, 0x75, 0x5b,
+                   0x7d, 0xa9, 0x01, 0xb9, 0x6d, 0xca, 0x3d, 0x42},
+    .publicKey  = {0xec, 0x17, 0x2b, 0x93, 0xad, 0x5e, 0x56, 0x3b,
+                   0xf4, 0x93, 0x2c, 0x70, 0xe1, 0x24, 0x50, 0x34,
+                   0xc3, 0x54, 0x67, 0xef, 0x2e, 0xfd, 0x4d, 0x64,
+                   0xeb, 0xf8, 0x19, 0x68, 0x34, 0x67, 0xe2, 0xbf},
+    .message    = {0x00, 0x00},
+    .len        = 0,
+    .signature  = {0x98, 0xa7, 0x02, 0x22, 0xf0, 0xb8, 0x12, 0x1a,
+                   0xa9, 0xd3, 0x0f, 0x81, 0x3d, 0x68, 0x3f, 0x80,
+                   0x9e, 0x46, 0x2b, 0x46, 0x9c, 0x7f, 0xf8, 0x76,
+                   0x39, 0x49, 0x9b, 0xb9, 0x4e, 0x6d, 0xae, 0x41,
+                   0x31, 0xf8, 0x50, 0x42, 0x46, 0x3c, 0x2a, 0x35,
+                   0x5a, 0x20, 0x03, 0xd0, 0x62, 0xad, 0xf5, 0xaa,
+                   0xa1, 0x0b, 0x8c, 0x61, 0xe6, 0x36, 0x06, 0x2a,
+                   0xaa, 0xd1, 0x1c, 0x2a, 0x26, 0x08, 0x34, 0x06}
+};
+
 static TestVector testVector;
 
 void printNumber(const char *name, const uint8_t *x, uint8_t len)
@@ -167,6 +191,319 @@ void testFixedVectors()
     testFixedVectors(&testVectorEd25519_2);
 }
 
+static TestVector batchVector1;
+static TestVector batchVector2;
+static CryptoWorker worker;
+
+void testBatch()
+{
+    const uint8_t *signatures[2];
+    const uint8_t *publicKeys[2];
+    const void *messages[2];
+    size_t lens[2];
+
+    memcpy_P(&batchVector1, &testVectorEd25519_1, sizeof(TestVector));
+    memcpy_P(&batchVector2, &testVectorEd25519_2, sizeof(TestVector));
+    signatures[0] = batchVector1.signature;
+    signatures[1] = batchVector2.signature;
+    publicKeys[0] = batchVector1.publicKey;
+    publicKeys[1] = batchVector2.publicKey;
+    messages[0] = batchVector1.message;
+    messages[1] = batchVector2.message;
+    lens[0] = batchVector1.len;
+    lens[1] = batchVector2.len;
+
+    Serial.print("Ed25519 batch verify ... ");
+    Serial.flush();
+    unsigned long start = micros();
+    bool result = Ed25519::verifyBatch(signatures, publicKeys, messages, lens, 2);
+    unsigned long elapsed = micros() - start;
+    if (result) {
+        Serial.print("ok");
+    } else {
+        Serial.print("failed");
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    Serial.print("Ed25519 batch verify with worker ... ");
+    Serial.flush();
+    worker.begin();
+    start = micros();
+    result = Ed25519::verifyBatch(signatures, publicKeys, messages, lens, 2,
+                                  worker);
+    elapsed = micros() - start;
+    if (result) {
+        Serial.print("ok");
+    } else {
+        Serial.print("failed");
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    Serial.print("Ed25519 batch verify with bad signature ... ");
+    Serial.flush();
+    batchVector2.signature[40] ^= 0x01;
+    if (!Ed25519::verifyBatch(signatures, publicKeys, messages, lens, 2) &&
+            !Ed25519::verifyBatch(signatures, publicKeys, messages, lens, 2,
+                                  worker))
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+    worker.end();
+}
+
+// Enough keys to fill one group of derivePublicKeys() and start another.
+#define DERIVE_COUNT (CRYPTO_ED25519_DERIVE_BATCH + 3)
+static uint8_t derivePrivate[DERIVE_COUNT * 32];
+static uint8_t derivePublic[DERIVE_COUNT * 32];
+static uint8_t deriveExpected[DERIVE_COUNT * 32];
+
+void testDeriveBatch()
+{
+    uint8_t publicKey[32];
+    unsigned long start;
+    unsigned long elapsed;
+    unsigned long single = 0;
+    bool ok = true;
+    size_t i;
+
+    Serial.print("Ed25519 derive public keys ... ");
+    Serial.flush();
+    memcpy_P(derivePrivate, testVectorEd25519_1.privateKey, 32);
+    memcpy_P(derivePrivate + 32, testVectorEd25519_2.privateKey, 32);
+    RNG.rand(derivePrivate + 64, sizeof(derivePrivate) - 64);
+    for (i = 0; i < DERIVE_COUNT; ++i) {
+        start = micros();
+        Ed25519::derivePublicKey(derivePublic + i * 32, derivePrivate + i * 32);
+        single += micros() - start;
+    }
+    memcpy(deriveExpected, derivePublic, sizeof(derivePublic));
+    start = micros();
+    Ed25519::derivePublicKeys(derivePublic, derivePrivate, DERIVE_COUNT);
+    elapsed = micros() - start;
+    for (i = 0; i < DERIVE_COUNT; ++i) {
+        if (memcmp(derivePublic + i * 32, deriveExpected + i * 32, 32) != 0) {
+            ok = false;
+            printNumber("actual  ", derivePublic + i * 32, 32);
+            printNumber("expected", deriveExpected + i * 32, 32);
+        }
+    }
+    if (ok) {
+        Serial.print("ok");
+    } else {
+        Serial.print("failed");
+    }
+    Serial.print(" (");
+    Serial.print(elapsed / DERIVE_COUNT);
+    Serial.print(" us per key, ");
+    Serial.print(single / DERIVE_COUNT);
+    Serial.println(" us one at a time)");
+
+    Serial.print("Ed25519 derive one public key ... ");
+    Serial.flush();
+    Ed25519::derivePublicKeys(publicKey, derivePrivate + 32, 1);
+    if (memcmp(publicKey, deriveExpected + 32, 32) == 0)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+}
+
+static Ed25519::PublicKey decodedKey;
+static Ed25519::PrecomputedPublicKey precomputedKey;
+
+void testPublicKey(const char *name, Ed25519::PublicKey &key)
+{
+    Serial.print("Ed25519 verify with ");
+    Serial.print(name);
+    Serial.print(" key ... ");
+    Serial.flush();
+    memcpy_P(&testVector, &testVectorEd25519_2, sizeof(TestVector));
+    bool ok = key.setKey(testVector.publicKey);
+    unsigned long start = micros();
+    if (!Ed25519::verify(testVector.signature, key, testVector.message,
+                         testVector.len))
+        ok = false;
+    unsigned long elapsed = micros() - start;
+    testVector.signature[40] ^= 0x01;
+    if (Ed25519::verify(testVector.signature, key, testVector.message,
+                        testVector.len))
+        ok = false;
+    if (ok)
+        Serial.print("ok");
+    else
+        Serial.print("failed");
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+}
+
+void testPublicKey()
+{
+    testPublicKey("decoded", decodedKey);
+    testPublicKey("precomputed", precomputedKey);
+
+    Serial.print("Ed25519 verify with invalid key ... ");
+    Serial.flush();
+    memcpy_P(&testVector, &testVectorEd25519_1, sizeof(TestVector));
+    testVector.publicKey[0] = 0x02; // y = 2 is not on the curve.
+    memset(testVector.publicKey + 1, 0, 31);
+    if (!precomputedKey.setKey(testVector.publicKey) &&
+            !precomputedKey.isValid() &&
+            !Ed25519::verify(testVector.signature, precomputedKey,
+                             testVector.message, testVector.len))
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+}
+
+static Ed25519::PrivateKey expandedKey;
+
+void testPrivateKey()
+{
+    uint8_t signature[64];
+
+    Serial.print("Ed25519 expand private key ... ");
+    Serial.flush();
+    memcpy_P(&testVector, &testVectorEd25519_2, sizeof(TestVector));
+    expandedKey.setKey(testVector.privateKey);
+    if (memcmp(expandedKey.publicKey(), testVector.publicKey, 32) == 0)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+
+    Serial.print("Ed25519 sign with expanded key ... ");
+    Serial.flush();
+    unsigned long start = micros();
+    Ed25519::sign(signature, expandedKey, testVector.message, testVector.len);
+    unsigned long elapsed = micros() - start;
+    if (memcmp(signature, testVector.signature, 64) == 0) {
+        Serial.print("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", signature, 64);
+        printNumber("expected", testVector.signature, 64);
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+}
+
+static Ed25519::Workspace workspace;
+
+void testWorkspace()
+{
+    uint8_t signature[64];
+    bool ok;
+
+    Serial.print("Ed25519 sign with workspace ... ");
+    Serial.flush();
+    memcpy_P(&testVector, &testVectorEd25519_2, sizeof(TestVector));
+    Ed25519::sign(signature, testVector.privateKey, testVector.publicKey,
+                  testVector.message, testVector.len, workspace);
+    ok = memcmp(signature, testVector.signature, 64) == 0;
+    Ed25519::sign(signature, expandedKey, testVector.message,
+                  testVector.len, workspace);
+    if (memcmp(signature, testVector.signature, 64) != 0)
+        ok = false;
+    if (ok) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", signature, 64);
+        printNumber("expected", testVector.signature, 64);
+    }
+
+    Serial.print("Ed25519 verify with workspace ... ");
+    Serial.flush();
+    ok = Ed25519::verify(testVector.signature, testVector.publicKey,
+                         testVector.message, testVector.len, workspace);
+    if (!Ed25519::verify(testVector.signature, decodedKey,
+                         testVector.message, testVector.len, workspace))
+        ok = false;
+    testVector.signature[5] ^= 0x20;
+    if (Ed25519::verify(testVector.signature, testVector.publicKey,
+                        testVector.message, testVector.len, workspace))
+        ok = false;
+    if (ok)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+    workspace.clear();
+}
+
+void testPrehash()
+{
+    static SHA512 hash;
+    static uint8_t signature[64];
+
+    memcpy_P(&testVector, &testVectorEd25519ph, sizeof(TestVector));
+
+    Serial.print(testVector.name);
+    Serial.print(" sign ... ");
+    Serial.flush();
+    hash.reset();
+    hash.update("a", 1);
+    hash.update("bc", 2);
+    unsigned long start = micros();
+    Ed25519::signPrehash(signature, testVector.privateKey,
+                         testVector.publicKey, hash);
+    unsigned long elapsed = micros() - start;
+    if (memcmp(signature, testVector.signature, 64) == 0) {
+        Serial.print("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", signature, 64);
+        printNumber("expected", testVector.signature, 64);
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    Serial.print(testVector.name);
+    Serial.print(" sign with expanded key ... ");
+    Serial.flush();
+    expandedKey.setKey(testVector.privateKey);
+    hash.reset();
+    hash.update("abc", 3);
+    Ed25519::signPrehash(signature, expandedKey, hash);
+    if (memcmp(signature, testVector.signature, 64) == 0)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+    expandedKey.clear();
+
+    Serial.print(testVector.name);
+    Serial.print(" verify ... ");
+    Serial.flush();
+    hash.reset();
+    hash.update("abc", 3);
+    start = micros();
+    bool verified = Ed25519::verifyPrehash(testVector.signature,
+                                           testVector.publicKey, hash);
+    elapsed = micros() - start;
+    if (verified) {
+        Serial.print("ok");
+    } else {
+        Serial.print("failed");
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    Serial.print(testVector.name);
+    Serial.print(" verify with context ... ");
+    hash.reset();
+    hash.update("abc", 3);
+    if (!Ed25519::verifyPrehash(testVector.signature, testVector.publicKey,
+                                hash, "foo", 3))
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+}
+
 /*
 void testDH()
 {
@@ -232,6 +569,18 @@ void setup()
     // Perform the tests.
     testFixedVectors();
     Serial.println();
+    testBatch();
+    Serial.println();
+    testDeriveBatch();
+    Serial.println();
+    testPublicKey();
+    Serial.println();
+    testPrivateKey();
+    Serial.println();
+    testWorkspace();
+    Serial.println();
+    testPrehash();
+    Serial.println();
     //testDH();
     //Serial.println();
 }
@@ -324,6 +324,91 @@ bool testCipher_N(AuthenticatedCipher *cipher, const struct TestVector *test, si
     return true;
 }
 
+// Splits a buffer into a list of unevenly-sized segments.
+size_t makeSegments(CipherSegment *segments, uint8_t *data, size_t len)
+{
+    static uint8_t const sizes[] = {3, 13, 0, 7, 29};
+    size_t count = 0;
+    while (len > 0) {
+        size_t size = sizes[count % sizeof(sizes)];
+        if (size > len)
+            size = len;
+        segments[count].data = data;
+        segments[count].len = size;
+        data += size;
+        len -= size;
+        ++count;
+    }
+    return count;
+}
+
+// Encrypts and decrypts in place using scatter/gather segment lists.
+bool testCipherV(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    CipherSegment adsegs[8];
+    CipherSegment segments[MAX_PLAINTEXT_LEN / 8 + 1];
+    uint8_t authdata[sizeof(test->authdata)];
+    size_t adcount, count;
+    uint8_t tag[16];
+
+    memcpy(authdata, test->authdata, test->authsize);
+    adcount = makeSegments(adsegs, authdata, test->authsize);
+    count = makeSegments(segments, buffer, test->datasize);
+
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, test->ivsize);
+    cipher->addAuthDatav(adsegs, adcount);
+    memcpy(buffer, test->plaintext, test->datasize);
+    cipher->encryptv(segments, count);
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+    cipher->computeTag(tag, sizeof(tag));
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    cipher->setKey(test->key, cipher->keySize());
+    cipher->setIV(test->iv, test->ivsize);
+    cipher->addAuthDatav(adsegs, adcount);
+    cipher->decryptv(segments, count);
+    if (memcmp(buffer, test->plaintext, test->datasize) != 0)
+        return false;
+    return cipher->checkTag(tag, sizeof(tag));
+}
+
+// Encrypts and decrypts using the one-shot seal() and open() functions.
+bool testSealOpen(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    uint8_t tag[16];
+
+    if (!cipher->seal(buffer, tag, test->key, test->iv, test->ivsize,
+                      test->authdata, test->authsize,
+                      test->plaintext, test->datasize))
+        return false;
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    if (!cipher->open(buffer, tag, test->key, test->iv, test->ivsize,
+                      test->authdata, test->authsize,
+                      buffer, test->datasize))
+        return false;
+    if (memcmp(buffer, test->plaintext, test->datasize) != 0)
+        return false;
+
+    // A corrupted tag must be rejected and the plaintext destroyed.
+    tag[0] ^= 0x01;
+    if (cipher->open(buffer, tag, test->key, test->iv, test->ivsize,
+                     test->authdata, test->authsize,
+                     test->ciphertext, test->datasize))
+        return false;
+    for (size_t posn = 0; posn < test->datasize; ++posn) {
+        if (buffer[posn] != 0)
+            return false;
+    }
+    return true;
+}
+
 void testCipher(AuthenticatedCipher *cipher, const struct TestVector *test)
 {
     bool ok;
@@ -341,6 +426,8 @@ void testCipher(AuthenticatedCipher *cipher, const struct TestVector *test)
     ok &= testCipher_N(cipher, test, 8);
     ok &= testCipher_N(cipher, test, 13);
     ok &= testCipher_N(cipher, test, 16);
+    ok &= testCipherV(cipher, test);
+    ok &= testSealOpen(cipher, test);
 
     if (ok)
         Serial.println("Passed");
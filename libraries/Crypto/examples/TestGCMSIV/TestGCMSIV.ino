@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the GCM-SIV implementation to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <AES.h>
+#include <GCMSIV.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#define MAX_PLAINTEXT_LEN 64
+
+struct TestVector
+{
+    const char *name;
+    uint8_t key[32];
+    uint8_t plaintext[MAX_PLAINTEXT_LEN];
+    uint8_t ciphertext[MAX_PLAINTEXT_LEN];
+    uint8_t authdata[20];
+    uint8_t iv[12];
+    uint8_t tag[16];
+    size_t authsize;
+    size_t datasize;
+};
+
+// Test vectors for AES-GCM-SIV.  The empty and 8-byte plaintext cases
+// for each key size are from Appendix C of RFC 8452.  The others use the
+// same key and nonce with longer inputs to cover multiple blocks.
+static TestVector const testVectorGCMSIV1 PROGMEM = {
+    .name        = "AES-128 GCM-SIV #1",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x00},
+    .ciphertext  = {0x00},
+    .authdata    = {0x00},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0xDC, 0x20, 0xE2, 0xD8, 0x3F, 0x25, 0x70, 0x5B,
+                    0xB4, 0x9E, 0x43, 0x9E, 0xCA, 0x56, 0xDE, 0x25},
+    .authsize    = 0,
+    .datasize    = 0
+};
+
+static TestVector const testVectorGCMSIV2 PROGMEM = {
+    .name        = "AES-128 GCM-SIV #2",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .ciphertext  = {0xB5, 0xD8, 0x39, 0x33, 0x0A, 0xC7, 0xB7, 0x86},
+    .authdata    = {0x00},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0x57, 0x87, 0x82, 0xFF, 0xF6, 0x01, 0x3B, 0x81,
+                    0x5B, 0x28, 0x7C, 0x22, 0x49, 0x3A, 0x36, 0x4C},
+    .authsize    = 0,
+    .datasize    = 8
+};
+
+static TestVector const testVectorGCMSIV3 PROGMEM = {
+    .name        = "AES-128 GCM-SIV #3",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .ciphertext  = {0x29, 0x6C, 0x78, 0x89, 0xFD, 0x99, 0xF4, 0x19,
+                    0x17, 0xF4, 0x46, 0x20},
+    .authdata    = {0x01},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0x08, 0x29, 0x9C, 0x51, 0x02, 0x74, 0x5A, 0xAA,
+                    0x3A, 0x0C, 0x46, 0x9F, 0xAD, 0x9E, 0x07, 0x5A},
+    .authsize    = 1,
+    .datasize    = 12
+};
+
+static TestVector const testVectorGCMSIV4 PROGMEM = {
+    .name        = "AES-128 GCM-SIV #4",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00},
+    .ciphertext  = {0x62, 0x90, 0xE4, 0x9E, 0x70, 0xBD, 0x77, 0x53,
+                    0xE7, 0x53, 0x91, 0x6D, 0xF7, 0x26, 0x69, 0x0F,
+                    0x41, 0x8B, 0xC4, 0x3C, 0xBC, 0xE4, 0xC5, 0xDB,
+                    0xE8, 0x02, 0xF3, 0xEB, 0x96, 0x82, 0x87, 0xAA,
+                    0x60, 0x97, 0x17, 0xA3, 0x28, 0x99, 0xA7, 0x61,
+                    0x0E, 0x85, 0x6D, 0x76, 0x31, 0xFD, 0x8A, 0x3D,
+                    0xF5, 0x58, 0x30, 0xFE, 0xD8, 0x82, 0x3C, 0x2A,
+                    0x53, 0xB9, 0x14, 0x86, 0xE2},
+    .authdata    = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0x4C, 0xCE, 0xFC, 0x45, 0x18, 0x61, 0x4E, 0xDC,
+                    0x99, 0x16, 0x41, 0xC8, 0x23, 0x0C, 0xD2, 0x0B},
+    .authsize    = 20,
+    .datasize    = 61
+};
+
+static TestVector const testVectorGCMSIV5 PROGMEM = {
+    .name        = "AES-256 GCM-SIV #1",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x00},
+    .ciphertext  = {0x00},
+    .authdata    = {0x00},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0x07, 0xF5, 0xF4, 0x16, 0x9B, 0xBF, 0x55, 0xA8,
+                    0x40, 0x0C, 0xD4, 0x7E, 0xA6, 0xFD, 0x40, 0x0F},
+    .authsize    = 0,
+    .datasize    = 0
+};
+
+static TestVector const testVectorGCMSIV6 PROGMEM = {
+    .name        = "AES-256 GCM-SIV #2",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .ciphertext  = {0x07, 0xDA, 0xD3, 0x64, 0xBF, 0xC2, 0xB9, 0xDA,
+                    0x89, 0x11, 0x6D, 0x7B, 0xEF, 0x6D, 0xAA, 0xAF,
+                    0x6F, 0x25, 0x55, 0x10, 0xAA, 0x65, 0x4F, 0x92,
+                    0x0A, 0xC8, 0x1B, 0x94, 0xE8, 0xBA, 0xD3, 0x65},
+    .authdata    = {0x01},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0xAE, 0xA1, 0xBA, 0xD1, 0x27, 0x02, 0xE1, 0x96,
+                    0x56, 0x04, 0x37, 0x4A, 0xAB, 0x96, 0xDB, 0xBC},
+    .authsize    = 1,
+    .datasize    = 32
+};
+
+static TestVector const testVectorGCMSIV7 PROGMEM = {
+    .name        = "AES-256 GCM-SIV #3",
+    .key         = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .plaintext   = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .ciphertext  = {0x1F, 0xE9, 0x8E, 0x31, 0x56, 0x80, 0x99, 0x11,
+                    0xAB, 0x63, 0x3B, 0x9F, 0x24, 0x14, 0xA8, 0x64,
+                    0x04, 0x1A, 0x81, 0x1F, 0xE4, 0xF4, 0xA2, 0x2C,
+                    0x70, 0x11, 0x99, 0xA8, 0x33, 0xF9, 0x64, 0x36,
+                    0xEF, 0x85, 0x7F, 0x76, 0x34, 0x9F, 0x4C, 0xA5,
+                    0xFE, 0xE3, 0xA1, 0xD9, 0x64, 0xDB, 0xFF, 0xAE,
+                    0x25, 0x4A, 0x80, 0xC3, 0x3B, 0x15, 0x5A, 0x73,
+                    0x94, 0x2F, 0xFC, 0x7B, 0x5E, 0x46, 0x6B, 0x8F},
+    .authdata    = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .iv          = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00},
+    .tag         = {0x01, 0x57, 0xB6, 0x3D, 0xD4, 0xB0, 0x4D, 0xBC,
+                    0xBF, 0x37, 0x92, 0xFA, 0x9B, 0x8B, 0x9E, 0x7B},
+    .authsize    = 12,
+    .datasize    = 64
+};
+
+TestVector testVector;
+
+GCMSIV<AES128> *gcmsivaes128 = 0;
+GCMSIV<AES256> *gcmsivaes256 = 0;
+
+byte buffer[128];
+
+// Encrypts using the incremental functions, adding the associated
+// data in chunks of "inc" bytes.
+bool testCipher_N(AuthenticatedCipher *cipher, const struct TestVector *test, size_t inc)
+{
+    size_t posn, len;
+    uint8_t tag[16];
+
+    cipher->clear();
+    if (!cipher->setKey(test->key, cipher->keySize()))
+        return false;
+    if (!cipher->setIV(test->iv, 12))
+        return false;
+
+    memset(buffer, 0xBA, sizeof(buffer));
+
+    for (posn = 0; posn < test->authsize; posn += inc) {
+        len = test->authsize - posn;
+        if (len > inc)
+            len = inc;
+        cipher->addAuthData(test->authdata + posn, len);
+    }
+
+    // GCM-SIV requires the whole plaintext in a single call.
+    if (test->datasize)
+        cipher->encrypt(buffer, test->plaintext, test->datasize);
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+
+    cipher->computeTag(tag, sizeof(tag));
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    // A second call to encrypt() is not allowed and clears the output.
+    if (test->datasize) {
+        cipher->encrypt(buffer, test->plaintext, test->datasize);
+        for (posn = 0; posn < test->datasize; ++posn) {
+            if (buffer[posn] != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Encrypts and decrypts using the one-shot seal() and open() functions.
+bool testSealOpen(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    uint8_t tag[16];
+
+    if (!cipher->seal(buffer, tag, test->key, test->iv, 12,
+                      test->authdata, test->authsize,
+                      test->plaintext, test->datasize))
+        return false;
+    if (memcmp(buffer, test->ciphertext, test->datasize) != 0)
+        return false;
+    if (memcmp(tag, test->tag, sizeof(tag)) != 0)
+        return false;
+
+    if (!cipher->open(buffer, tag, test->key, test->iv, 12,
+                      test->authdata, test->authsize,
+                      buffer, test->datasize))
+        return false;
+    if (memcmp(buffer, test->plaintext, test->datasize) != 0)
+        return false;
+
+    // A corrupted tag must be rejected and the plaintext destroyed.
+    tag[15] ^= 0x80;
+    if (cipher->open(buffer, tag, test->key, test->iv, 12,
+                     test->authdata, test->authsize,
+                     test->ciphertext, test->datasize))
+        return false;
+    for (size_t posn = 0; posn < test->datasize; ++posn) {
+        if (buffer[posn] != 0)
+            return false;
+    }
+
+    // So must corrupted associated data.
+    if (test->authsize) {
+        memcpy(buffer, test->authdata, test->authsize);
+        buffer[0] ^= 0x01;
+        if (cipher->open(buffer + 64, test->tag, test->key, test->iv, 12,
+                         buffer, test->authsize,
+                         test->ciphertext, test->datasize))
+            return false;
+    }
+    return true;
+}
+
+void testCipher(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    bool ok;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    ok  = testCipher_N(cipher, test, test->authsize ? test->authsize : 1);
+    ok &= testCipher_N(cipher, test, 1);
+    ok &= testCipher_N(cipher, test, 5);
+    ok &= testSealOpen(cipher, test);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfCipherSeal(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    uint8_t tag[16];
+    int count;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" Seal ... ");
+
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        cipher->seal(buffer, tag, test->key, test->iv, 12,
+                     0, 0, buffer, 128);
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (128.0 * 500.0));
+    Serial.print("us per byte, ");
+    Serial.print((128.0 * 500.0 * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void perfCipherOpen(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    uint8_t tag[16];
+    int count;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" Open ... ");
+
+    cipher->seal(buffer, tag, test->key, test->iv, 12, 0, 0, buffer, 128);
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        // The tag only matches on the first iteration, but the same
+        // amount of work is done on every iteration.
+        cipher->open(buffer, tag, test->key, test->iv, 12,
+                     0, 0, buffer, 128);
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (128.0 * 500.0));
+    Serial.print("us per byte, ");
+    Serial.print((128.0 * 500.0 * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void perfCipher(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    perfCipherSeal(cipher, test);
+    perfCipherOpen(cipher, test);
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("State Sizes:");
+    Serial.print("GCMSIV<AES128> ... ");
+    Serial.println(sizeof(*gcmsivaes128));
+    Serial.print("GCMSIV<AES256> ... ");
+    Serial.println(sizeof(*gcmsivaes256));
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    gcmsivaes128 = new GCMSIV<AES128>();
+    testCipher(gcmsivaes128, &testVectorGCMSIV1);
+    testCipher(gcmsivaes128, &testVectorGCMSIV2);
+    testCipher(gcmsivaes128, &testVectorGCMSIV3);
+    testCipher(gcmsivaes128, &testVectorGCMSIV4);
+    delete gcmsivaes128;
+    gcmsivaes256 = new GCMSIV<AES256>();
+    testCipher(gcmsivaes256, &testVectorGCMSIV5);
+    testCipher(gcmsivaes256, &testVectorGCMSIV6);
+    testCipher(gcmsivaes256, &testVectorGCMSIV7);
+    delete gcmsivaes256;
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    gcmsivaes128 = new GCMSIV<AES128>();
+    perfCipher(gcmsivaes128, &testVectorGCMSIV1);
+    delete gcmsivaes128;
+    gcmsivaes256 = new GCMSIV<AES256>();
+    perfCipher(gcmsivaes256, &testVectorGCMSIV5);
+    delete gcmsivaes256;
+}
+
+void loop()
+{
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the HKDF implementation to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <HKDF.h>
+#include <SHA256.h>
+#include <SHA512.h>
+#include <BLAKE2s.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#define MAX_FIELD_LEN   80
+#define MAX_OUTPUT_LEN  100
+#define PERF_KEYS       4
+#define PERF_LOOPS      200
+
+struct TestVector
+{
+    const char *name;
+    uint8_t key[MAX_FIELD_LEN];
+    uint8_t salt[MAX_FIELD_LEN];
+    uint8_t info[MAX_FIELD_LEN];
+    uint8_t out[MAX_OUTPUT_LEN];
+    size_t keyLen;
+    size_t saltLen;
+    size_t infoLen;
+    size_t outLen;
+};
+
+// Test vectors for HKDF-SHA256 from RFC 5869.
+static TestVector const testVectorHKDF_1 PROGMEM = {
+    .name        = "HKDF-SHA256 #1",
+    .key         = {0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b},
+    .salt        = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                    0x08, 0x09, 0x0a, 0x0b, 0x0c},
+    .info        = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                    0xf8, 0xf9},
+    .out         = {0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a,
+                    0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+                    0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c,
+                    0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
+                    0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18,
+                    0x58, 0x65},
+    .keyLen      = 22,
+    .saltLen     = 13,
+    .infoLen     = 10,
+    .outLen      = 42
+};
+
+static TestVector const testVectorHKDF_2 PROGMEM = {
+    .name        = "HKDF-SHA256 #2",
+    .key         = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+                    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+                    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+                    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+                    0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+                    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+                    0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+                    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+                    0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f},
+    .salt        = {0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+                    0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+                    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+                    0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+                    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+                    0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+                    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+                    0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+                    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+                    0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf},
+    .info        = {0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+                    0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+                    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+                    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+                    0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+                    0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+                    0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7,
+                    0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+                    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                    0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff},
+    .out         = {0xb1, 0x1e, 0x39, 0x8d, 0xc8, 0x03, 0x27, 0xa1,
+                    0xc8, 0xe7, 0xf7, 0x8c, 0x59, 0x6a, 0x49, 0x34,
+                    0x4f, 0x01, 0x2e, 0xda, 0x2d, 0x4e, 0xfa, 0xd8,
+                    0xa0, 0x50, 0xcc, 0x4c, 0x19, 0xaf, 0xa9, 0x7c,
+                    0x59, 0x04, 0x5a, 0x99, 0xca, 0xc7, 0x82, 0x72,
+                    0x71, 0xcb, 0x41, 0xc6, 0x5e, 0x59, 0x0e, 0x09,
+                    0xda, 0x32, 0x75, 0x60, 0x0c, 0x2f, 0x09, 0xb8,
+                    0x36, 0x77, 0x93, 0xa9, 0xac, 0xa3, 0xdb, 0x71,
+                    0xcc, 0x30, 0xc5, 0x81, 0x79, 0xec, 0x3e, 0x87,
+                    0xc1, 0x4c, 0x01, 0xd5, 0xc1, 0xf3, 0x43, 0x4f,
+                    0x1d, 0x87},
+    .keyLen      = 80,
+    .saltLen     = 80,
+    .infoLen     = 80,
+    .outLen      = 82
+};
+
+static TestVector const testVectorHKDF_3 PROGMEM = {
+    .name        = "HKDF-SHA256 #3",
+    .key         = {0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b},
+    .salt        = {0},
+    .info        = {0},
+    .out         = {0x8d, 0xa4, 0xe7, 0x75, 0xa5, 0x63, 0xc1, 0x8f,
+                    0x71, 0x5f, 0x80, 0x2a, 0x06, 0x3c, 0x5a, 0x31,
+                    0xb8, 0xa1, 0x1f, 0x5c, 0x5e, 0xe1, 0x87, 0x9e,
+                    0xc3, 0x45, 0x4e, 0x5f, 0x3c, 0x73, 0x8d, 0x2d,
+                    0x9d, 0x20, 0x13, 0x95, 0xfa, 0xa4, 0xb6, 0x1a,
+                    0x96, 0xc8},
+    .keyLen      = 22,
+    .saltLen     = 0,
+    .infoLen     = 0,
+    .outLen      = 42
+};
+
+TestVector testVector;
+
+HKDF<SHA256> hkdfSHA256;
+HKDF<SHA512> hkdfSHA512;
+HKDF<BLAKE2s> hkdfBLAKE2s;
+SHA256 sha256;
+SHA512 sha512;
+BLAKE2s blake2s;
+
+uint8_t buffer[MAX_OUTPUT_LEN];
+uint8_t expected[MAX_OUTPUT_LEN];
+
+// Simple implementation of HKDF using resetHMAC() and finalizeHMAC().
+void simpleHKDF(Hash *hash, uint8_t *out, size_t outLen,
+                const uint8_t *key, size_t keyLen,
+                const uint8_t *salt, size_t saltLen,
+                const uint8_t *info, size_t infoLen)
+{
+    uint8_t prk[64];
+    uint8_t block[64];
+    size_t size = hash->hashSize();
+    uint8_t counter = 1;
+    hash->resetHMAC(salt, saltLen);
+    hash->update(key, keyLen);
+    hash->finalizeHMAC(salt, saltLen, prk, size);
+    while (outLen > 0) {
+        hash->resetHMAC(prk, size);
+        if (counter != 1)
+            hash->update(block, size);
+        hash->update(info, infoLen);
+        hash->update(&counter, 1);
+        hash->finalizeHMAC(prk, size, block, size);
+        size_t len = outLen;
+        if (len > size)
+            len = size;
+        memcpy(out, block, len);
+        out += len;
+        outLen -= len;
+        ++counter;
+    }
+}
+
+bool expandInPieces(HKDFCommon *hkdf, size_t piece)
+{
+    hkdf->reset();
+    memset(buffer, 0xAA, sizeof(buffer));
+    for (size_t posn = 0; posn < testVector.outLen; posn += piece) {
+        size_t len = testVector.outLen - posn;
+        if (len > piece)
+            len = piece;
+        if (!hkdf->expand(buffer + posn, len, testVector.info, testVector.infoLen))
+            return false;
+    }
+    return !memcmp(buffer, testVector.out, testVector.outLen);
+}
+
+void testHKDF(const struct TestVector *test)
+{
+    bool ok = true;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+
+    Serial.print(testVector.name);
+    Serial.print(" ... ");
+
+    // Derive the output all at once and in pieces of various sizes.
+    hkdfSHA256.setKey(testVector.key, testVector.keyLen,
+                      testVector.salt, testVector.saltLen);
+    ok &= expandInPieces(&hkdfSHA256, testVector.outLen);
+    ok &= expandInPieces(&hkdfSHA256, 1);
+    ok &= expandInPieces(&hkdfSHA256, 7);
+    ok &= expandInPieces(&hkdfSHA256, 33);
+
+    // Try the all-in-one function.
+    memset(buffer, 0xAA, sizeof(buffer));
+    hkdf<SHA256>(buffer, testVector.outLen, testVector.key, testVector.keyLen,
+                 testVector.salt, testVector.saltLen,
+                 testVector.info, testVector.infoLen);
+    ok &= !memcmp(buffer, testVector.out, testVector.outLen);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testSimple(const char *name, HKDFCommon *hkdf, Hash *hash)
+{
+    static size_t const saltLens[] = {0, 16, 200};
+    uint8_t key[300];
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+
+    for (size_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)(posn * 7 + 3);
+    for (uint8_t index = 0; index < 3; ++index) {
+        size_t saltLen = saltLens[index];
+        simpleHKDF(hash, expected, sizeof(expected), key, 32,
+                   key + 32, saltLen, key + 100, 20);
+        memset(buffer, 0xAA, sizeof(buffer));
+        hkdf->setKey(key, 32, key + 32, saltLen);
+        hkdf->expand(buffer, 5, key + 100, 20);
+        hkdf->expand(buffer + 5, sizeof(buffer) - 5, key + 100, 20);
+        ok &= !memcmp(buffer, expected, sizeof(buffer));
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testLimit(HKDFCommon *hkdf)
+{
+    bool ok = true;
+
+    Serial.print("Output limit ... ");
+
+    // Only 255 blocks of output are allowed before reset().
+    hkdf->setKey("key", 3);
+    for (uint8_t count = 0; count < 255; ++count)
+        ok &= hkdf->expand(buffer, hkdf->hashSize());
+    ok &= !hkdf->expand(buffer, 1);
+    hkdf->reset();
+    ok &= hkdf->expand(buffer, 1);
+    ok &= !hkdf->expand(buffer, 255 * hkdf->hashSize());
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfHKDF(const char *name, HKDFCommon *hkdf, Hash *hash)
+{
+    unsigned long start;
+    unsigned long elapsedHash;
+    unsigned long elapsedHKDF;
+    uint8_t key[32];
+    uint8_t info[8];
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    memset(key, 0x55, sizeof(key));
+    memset(info, 0x66, sizeof(info));
+
+    // Derive several 32-byte session keys from the same shared secret.
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count) {
+        for (uint8_t index = 0; index < PERF_KEYS; ++index) {
+            info[0] = index;
+            simpleHKDF(hash, buffer, 32, key, sizeof(key),
+                       0, 0, info, sizeof(info));
+        }
+    }
+    elapsedHash = micros() - start;
+
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count) {
+        hkdf->setKey(key, sizeof(key));
+        for (uint8_t index = 0; index < PERF_KEYS; ++index) {
+            info[0] = index;
+            hkdf->reset();
+            hkdf->expand(buffer, 32, info, sizeof(info));
+        }
+    }
+    elapsedHKDF = micros() - start;
+
+    Serial.print(elapsedHash / (double)PERF_LOOPS);
+    Serial.print("us uncached, ");
+    Serial.print(elapsedHKDF / (double)PERF_LOOPS);
+    Serial.println("us cached");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testHKDF(&testVectorHKDF_1);
+    testHKDF(&testVectorHKDF_2);
+    testHKDF(&testVectorHKDF_3);
+    testSimple("HKDF-SHA256", &hkdfSHA256, &sha256);
+    testSimple("HKDF-SHA512", &hkdfSHA512, &sha512);
+    testSimple("HKDF-BLAKE2s", &hkdfBLAKE2s, &blake2s);
+    testLimit(&hkdfSHA256);
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfHKDF("HKDF-SHA256", &hkdfSHA256, &sha256);
+    perfHKDF("HKDF-SHA512", &hkdfSHA512, &sha512);
+    perfHKDF("HKDF-BLAKE2s", &hkdfBLAKE2s, &blake2s);
+}
+
+void loop()
+{
+}
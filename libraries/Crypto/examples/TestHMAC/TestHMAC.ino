@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the HMAC class by comparing its results with
+the resetHMAC() and finalizeHMAC() functions of the underlying hash.
+*/
+
+#include <Crypto.h>
+#include <HMAC.h>
+#include <SHA1.h>
+#include <SHA256.h>
+#include <SHA512.h>
+#include <SHA3.h>
+#include <BLAKE2s.h>
+#include <BLAKE2b.h>
+#include <string.h>
+
+#define MAX_KEY_SIZE    200
+#define MAX_DATA_SIZE   150
+#define PERF_DATA_SIZE  32
+#define PERF_LOOPS      1000
+
+uint8_t key[MAX_KEY_SIZE];
+uint8_t data[MAX_DATA_SIZE];
+uint8_t expected[64];
+uint8_t actual[64];
+
+bool testHMAC_N(HMACCommon *hmac, Hash *hash, size_t keyLen)
+{
+    static size_t const dataLens[] = {0, 32, 150};
+    hmac->setKey(key, keyLen);
+    for (uint8_t index = 0; index < 3; ++index) {
+        size_t len = dataLens[index];
+        hash->resetHMAC(key, keyLen);
+        hash->update(data, len);
+        hash->finalizeHMAC(key, keyLen, expected, hash->hashSize());
+
+        // Compute the MAC twice to check that reset() restores the key.
+        for (uint8_t count = 0; count < 2; ++count) {
+            memset(actual, 0xAA, sizeof(actual));
+            hmac->reset();
+            hmac->update(data, len);
+            hmac->finalize(actual, hmac->hashSize());
+            if (memcmp(actual, expected, hash->hashSize()) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+void testHMAC(const char *name, HMACCommon *hmac, Hash *hash)
+{
+    static size_t const keyLens[] = {0, 1, 20, 32, 64, 65, 128, 136, 200};
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    for (uint8_t index = 0; index < sizeof(keyLens) / sizeof(keyLens[0]); ++index)
+        ok &= testHMAC_N(hmac, hash, keyLens[index]);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfHMAC(const char *name, HMACCommon *hmac, Hash *hash)
+{
+    unsigned long start;
+    unsigned long elapsedHash;
+    unsigned long elapsedHMAC;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count) {
+        hash->resetHMAC(key, 32);
+        hash->update(data, PERF_DATA_SIZE);
+        hash->finalizeHMAC(key, 32, actual, hash->hashSize());
+    }
+    elapsedHash = micros() - start;
+
+    hmac->setKey(key, 32);
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count) {
+        hmac->reset();
+        hmac->update(data, PERF_DATA_SIZE);
+        hmac->finalize(actual, hmac->hashSize());
+    }
+    elapsedHMAC = micros() - start;
+
+    Serial.print(elapsedHash / (double)PERF_LOOPS);
+    Serial.print("us per op uncached, ");
+    Serial.print(elapsedHMAC / (double)PERF_LOOPS);
+    Serial.println("us per op cached");
+}
+
+HMAC<SHA1> hmacSHA1;
+HMAC<SHA256> hmacSHA256;
+HMAC<SHA512> hmacSHA512;
+HMAC<SHA3_256> hmacSHA3_256;
+HMAC<BLAKE2s> hmacBLAKE2s;
+HMAC<BLAKE2b> hmacBLAKE2b;
+SHA1 sha1;
+SHA256 sha256;
+SHA512 sha512;
+SHA3_256 sha3_256;
+BLAKE2s blake2s;
+BLAKE2b blake2b;
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    for (size_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)(posn * 11 + 1);
+    for (size_t posn = 0; posn < sizeof(data); ++posn)
+        data[posn] = (uint8_t)(posn * 3 + 7);
+
+    Serial.println("Test Vectors:");
+    testHMAC("HMAC-SHA1", &hmacSHA1, &sha1);
+    testHMAC("HMAC-SHA256", &hmacSHA256, &sha256);
+    testHMAC("HMAC-SHA512", &hmacSHA512, &sha512);
+    testHMAC("HMAC-SHA3-256", &hmacSHA3_256, &sha3_256);
+    testHMAC("HMAC-BLAKE2s", &hmacBLAKE2s, &blake2s);
+    testHMAC("HMAC-BLAKE2b", &hmacBLAKE2b, &blake2b);
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfHMAC("HMAC-SHA256", &hmacSHA256, &sha256);
+    perfHMAC("HMAC-SHA512", &hmacSHA512, &sha512);
+    perfHMAC("HMAC-BLAKE2s", &hmacBLAKE2s, &blake2s);
+}
+
+void loop()
+{
+}
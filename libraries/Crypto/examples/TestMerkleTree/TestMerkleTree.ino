@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the MerkleTree class to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <MerkleTree.h>
+#include <SHA256.h>
+#include <SHA256Multi.h>
+#include <BLAKE2s.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#define MAX_LEAVES      40
+#define CHUNK_SIZE      48
+#define PERF_LEAVES     32
+#define PERF_LOOPS      20
+
+// Leaves and roots of the 1 to 8 leaf trees from the RFC 6962 test suite.
+static uint8_t const rfcLeafData[] PROGMEM = {
+    0x00, 0x10, 0x20, 0x21, 0x30, 0x31, 0x40, 0x41,
+    0x42, 0x43, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55,
+    0x56, 0x57, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65,
+    0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d,
+    0x6e, 0x6f
+};
+static uint8_t const rfcLeafLens[8] PROGMEM = {0, 1, 1, 2, 2, 4, 8, 16};
+static uint8_t const rfcRoots[8][32] PROGMEM = {
+    {0x6e, 0x34, 0x0b, 0x9c, 0xff, 0xb3, 0x7a, 0x98,
+     0x9c, 0xa5, 0x44, 0xe6, 0xbb, 0x78, 0x0a, 0x2c,
+     0x78, 0x90, 0x1d, 0x3f, 0xb3, 0x37, 0x38, 0x76,
+     0x85, 0x11, 0xa3, 0x06, 0x17, 0xaf, 0xa0, 0x1d},
+    {0xfa, 0xc5, 0x42, 0x03, 0xe7, 0xcc, 0x69, 0x6c,
+     0xf0, 0xdf, 0xcb, 0x42, 0xc9, 0x2a, 0x1d, 0x9d,
+     0xba, 0xf7, 0x0a, 0xd9, 0xe6, 0x21, 0xf4, 0xbd,
+     0x8d, 0x98, 0x66, 0x2f, 0x00, 0xe3, 0xc1, 0x25},
+    {0xae, 0xb6, 0xbc, 0xfe, 0x27, 0x4b, 0x70, 0xa1,
+     0x4f, 0xb0, 0x67, 0xa5, 0xe5, 0x57, 0x82, 0x64,
+     0xdb, 0x0f, 0xa9, 0xb5, 0x1a, 0xf5, 0xe0, 0xba,
+     0x15, 0x91, 0x58, 0xf3, 0x29, 0xe0, 0x6e, 0x77},
+    {0xd3, 0x7e, 0xe4, 0x18, 0x97, 0x6d, 0xd9, 0x57,
+     0x53, 0xc1, 0xc7, 0x38, 0x62, 0xb9, 0x39, 0x8f,
+     0xa2, 0xa2, 0xcf, 0x9b, 0x4f, 0xf0, 0xfd, 0xfe,
+     0x8b, 0x30, 0xcd, 0x95, 0x20, 0x96, 0x14, 0xb7},
+    {0x4e, 0x3b, 0xbb, 0x1f, 0x7b, 0x47, 0x8d, 0xcf,
+     0xe7, 0x1f, 0xb6, 0x31, 0x63, 0x15, 0x19, 0xa3,
+     0xbc, 0xa1, 0x2c, 0x9a, 0xef, 0xca, 0x16, 0x12,
+     0xbf, 0xce, 0x4c, 0x13, 0xa8, 0x62, 0x64, 0xd4},
+    {0x76, 0xe6, 0x7d, 0xad, 0xbc, 0xdf, 0x1e, 0x10,
+     0xe1, 0xb7, 0x4d, 0xdc, 0x60, 0x8a, 0xbd, 0x2f,
+     0x98, 0xdf, 0xb1, 0x6f, 0xbc, 0xe7, 0x52, 0x77,
+     0xb5, 0x23, 0x2a, 0x12, 0x7f, 0x20, 0x87, 0xef},
+    {0xdd, 0xb8, 0x9b, 0xe4, 0x03, 0x80, 0x9e, 0x32,
+     0x57, 0x50, 0xd3, 0xd2, 0x63, 0xcd, 0x78, 0x92,
+     0x9c, 0x29, 0x42, 0xb7, 0x94, 0x2a, 0x34, 0xb7,
+     0x7e, 0x12, 0x2c, 0x95, 0x94, 0xa7, 0x4c, 0x8c},
+    {0x5d, 0xc9, 0xda, 0x79, 0xa7, 0x06, 0x59, 0xa9,
+     0xad, 0x55, 0x9c, 0xb7, 0x01, 0xde, 0xd9, 0xa2,
+     0xab, 0x9d, 0x82, 0x3a, 0xad, 0x2f, 0x49, 0x60,
+     0xcf, 0xe3, 0x70, 0xef, 0xf4, 0x60, 0x43, 0x28}
+};
+
+SHA256 sha256;
+BLAKE2s blake2s;
+SHA256x4 engine4;
+SHA256x8 engine8;
+
+uint8_t nodes[2 * MAX_LEAVES * 32 + 8 * 32];
+uint8_t nodes2[2 * MAX_LEAVES * 32 + 8 * 32];
+uint8_t chunks[MAX_LEAVES][CHUNK_SIZE];
+const void *chunkPtrs[MAX_LEAVES];
+size_t chunkLens[MAX_LEAVES];
+uint8_t proof[16 * 32];
+
+void testRFC6962()
+{
+    uint8_t data[sizeof(rfcLeafData)];
+    uint8_t root[32];
+    bool ok = true;
+
+    Serial.print("RFC 6962 ... ");
+
+    memcpy_P(data, rfcLeafData, sizeof(data));
+    for (uint8_t count = 1; count <= 8; ++count) {
+        MerkleTree tree(sha256, nodes, sizeof(nodes));
+        ok &= tree.setLeafCount(count);
+        size_t posn = 0;
+        for (uint8_t index = 0; index < count; ++index) {
+            uint8_t len = pgm_read_byte(&(rfcLeafLens[index]));
+            tree.setLeaf(index, data + posn, len);
+            posn += len;
+        }
+        memcpy_P(root, rfcRoots[count - 1], sizeof(root));
+        ok &= !memcmp(tree.root(), root, sizeof(root));
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void fillChunk(uint8_t index, uint8_t seed)
+{
+    for (uint8_t posn = 0; posn < CHUNK_SIZE; ++posn)
+        chunks[index][posn] = (uint8_t)(index * 13 + posn * 3 + seed);
+    chunkPtrs[index] = chunks[index];
+    chunkLens[index] = CHUNK_SIZE - (index % 5);
+}
+
+void fillChunks(uint8_t seed)
+{
+    for (uint8_t index = 0; index < MAX_LEAVES; ++index)
+        fillChunk(index, seed);
+}
+
+// Checks every proof in a tree, and some bad ones.
+bool checkProofs(MerkleTree &tree, Hash *hash)
+{
+    size_t count = tree.leafCount();
+    bool ok = true;
+    for (size_t index = 0; index < count; ++index) {
+        size_t len = tree.proof(index, proof, sizeof(proof));
+        ok &= (len == tree.proofSize(index));
+        ok &= MerkleTree::verify(*hash, tree.root(), count, index,
+                                 chunks[index], chunkLens[index], proof, len);
+
+        // Wrong chunk, wrong index, truncated proof, and modified proof.
+        ok &= !MerkleTree::verify(*hash, tree.root(), count, index,
+                                  chunks[index], chunkLens[index] - 1,
+                                  proof, len);
+        if (count > 1) {
+            ok &= !MerkleTree::verify(*hash, tree.root(), count,
+                                      (index + 1) % count, chunks[index],
+                                      chunkLens[index], proof, len);
+            ok &= !MerkleTree::verify(*hash, tree.root(), count, index,
+                                      chunks[index], chunkLens[index],
+                                      proof, len - tree.hashSize());
+            proof[len - 1] ^= 0x01;
+            ok &= !MerkleTree::verify(*hash, tree.root(), count, index,
+                                      chunks[index], chunkLens[index],
+                                      proof, len);
+        }
+    }
+    return ok;
+}
+
+void testTree(const char *name, Hash *hash)
+{
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    for (uint8_t count = 1; count <= MAX_LEAVES; ++count) {
+        // Build the tree one leaf at a time.
+        fillChunks(0);
+        MerkleTree tree(*hash, nodes, sizeof(nodes));
+        ok &= tree.setLeafCount(count);
+        for (uint8_t index = 0; index < count; ++index)
+            tree.setLeaf(index, chunks[index], chunkLens[index]);
+        ok &= checkProofs(tree, hash);
+
+        // Change a few leaves and compare with a tree built from scratch.
+        for (uint8_t index = 0; index < count; index += 3) {
+            fillChunk(index, 1);
+            tree.setLeaf(index, chunks[index], chunkLens[index]);
+        }
+        MerkleTree tree2(*hash, nodes2, sizeof(nodes2));
+        ok &= tree2.setLeafCount(count);
+        tree2.setLeaves(0, count, chunkPtrs, chunkLens);
+        ok &= !memcmp(tree.root(), tree2.root(), tree.hashSize());
+        ok &= checkProofs(tree2, hash);
+    }
+
+    // The storage must be large enough.
+    MerkleTree small(*hash, nodes, MerkleTree::storageSize(hash->hashSize(), 5) - 1);
+    ok &= !small.setLeafCount(5);
+    ok &= small.setLeafCount(4);
+    ok &= !small.setLeafCount(0);
+    ok &= (small.root() == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testEngine(const char *name, SHA256MultiCommon *engine)
+{
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    fillChunks(7);
+    for (uint8_t count = 1; count <= MAX_LEAVES; ++count) {
+        MerkleTree tree(sha256, nodes, sizeof(nodes));
+        MerkleTree tree2(sha256, nodes2, sizeof(nodes2));
+        tree2.setEngine(engine);
+        ok &= tree.setLeafCount(count);
+        ok &= tree2.setLeafCount(count);
+        ok &= !memcmp(tree.root(), tree2.root(), 32);
+        tree.setLeaves(0, count, chunkPtrs, chunkLens);
+        tree2.setLeaves(0, count, chunkPtrs, chunkLens);
+        ok &= !memcmp(nodes, nodes2, MerkleTree::storageSize(32, count));
+
+        // Update a range in the middle.
+        if (count > 4) {
+            tree.setLeaves(count / 4, count / 2, chunkPtrs, chunkLens);
+            tree2.setLeaves(count / 4, count / 2, chunkPtrs, chunkLens);
+            ok &= !memcmp(nodes, nodes2, MerkleTree::storageSize(32, count));
+        }
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfTree(const char *name, Hash *hash, SHA256MultiCommon *engine)
+{
+    unsigned long start;
+    unsigned long elapsedBuild;
+    unsigned long elapsedLeaf;
+    unsigned long elapsedVerify;
+    size_t len;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    fillChunks(3);
+    MerkleTree tree(*hash, nodes, sizeof(nodes));
+    tree.setEngine(engine);
+    tree.setLeafCount(PERF_LEAVES);
+
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count)
+        tree.setLeaves(0, PERF_LEAVES, chunkPtrs, chunkLens);
+    elapsedBuild = micros() - start;
+
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count)
+        tree.setLeaf(count % PERF_LEAVES, chunks[0], CHUNK_SIZE);
+    elapsedLeaf = micros() - start;
+
+    len = tree.proof(5, proof, sizeof(proof));
+    start = micros();
+    for (int count = 0; count < PERF_LOOPS; ++count) {
+        MerkleTree::verify(*hash, tree.root(), PERF_LEAVES, 5, chunks[5],
+                           chunkLens[5], proof, len);
+    }
+    elapsedVerify = micros() - start;
+
+    Serial.print(elapsedBuild / (double)PERF_LOOPS);
+    Serial.print("us build, ");
+    Serial.print(elapsedLeaf / (double)PERF_LOOPS);
+    Serial.print("us per leaf update, ");
+    Serial.print(elapsedVerify / (double)PERF_LOOPS);
+    Serial.println("us per proof check");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testRFC6962();
+    testTree("MerkleTree SHA256", &sha256);
+    testTree("MerkleTree BLAKE2s", &blake2s);
+    testEngine("MerkleTree SHA256x4", &engine4);
+    testEngine("MerkleTree SHA256x8", &engine8);
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfTree("MerkleTree SHA256", &sha256, 0);
+    perfTree("MerkleTree SHA256x8", &sha256, &engine8);
+    perfTree("MerkleTree BLAKE2s", &blake2s, 0);
+}
+
+void loop()
+{
+}
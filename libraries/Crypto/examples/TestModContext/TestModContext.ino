@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the ModContext class.
+*/
+
+#include <Crypto.h>
+#include <ModContext.h>
+#include <utility/ProgMemUtil.h>
+#include <string.h>
+
+#define LIMB_BITS       (sizeof(limb_t) * 8)
+#define NUM_LIMBS_32    ((32 + LIMB_BITS - 1) / LIMB_BITS)
+#define NUM_LIMBS_256   (256 / LIMB_BITS)
+#define NUM_LIMBS_1024  (1024 / LIMB_BITS)
+
+// The NIST P-256 prime, 2^256 - 2^224 + 2^192 + 2^96 - 1.
+static char const p256[] PROGMEM =
+    "115792089210356248762697446949407573530086143415290314195533631308867097853951";
+static char const p256_a[] PROGMEM =
+    "1577005607427962582381390281507430931907711526668214449040121971289097900030";
+static char const p256_b[] PROGMEM =
+    "114868137287362206738184082375390795628511995638480224572932426844044626855522";
+static char const p256_ab[] PROGMEM =
+    "96633376953146874811561574128846177305721949122696876428260422095046938012890";
+static char const p256_a_pow_b[] PROGMEM =
+    "10878058914762294307625906402650300208181137387068358370900092352420986842833";
+
+// Randomly generated 1024-bit RSA key with e = 65537.
+static char const rsa_n[] PROGMEM =
+    "98359291019569599018700591242374001071390190516913624281268407222355971764183"
+    "40884384162714646048414067759818656774933296550049538543157581375493953572847"
+    "67811224858361208988073156350755713255315298941449482489596426131964817096007"
+    "60989068299251903756732873235881534737872771524364432449429733606994215909423";
+static char const rsa_e[] PROGMEM = "65537";
+static char const rsa_d[] PROGMEM =
+    "96828453830806595051490090257171421138027082740737542117499943982250335387793"
+    "47526402078609958025322038080171815602611829859766942005110055046809335225281"
+    "64872918756762622778410126143715893256439933442447796211307199627818211206775"
+    "63965556239087875084992235799875289325504171962911588118312196033652784831281";
+static char const rsa_m[] PROGMEM =
+    "22557072334738445873914300002963338097699457341866928543821432289678682111983"
+    "65471685352193944448884830048906633111356469906260440938977651282037561446924"
+    "66740029694752038373720438404694812676764547724428766610312816760266766596440"
+    "78928183388135308794644946572215917918183942322371636770385142774457729648992";
+static char const rsa_c[] PROGMEM =
+    "52523557037234722708602247903524163005773583591163451316686312057226041717822"
+    "17315417881514084664023462150638693238833988710412500465591355255449804993200"
+    "01665926189818536334915620538798709637669467413510351557344511678370313369227"
+    "42848386752376870992374231818911610732334602179540780157261107494511323798415";
+
+ModContext ctx;
+limb_t modulus[MODCONTEXT_MAX_LIMBS];
+limb_t x[MODCONTEXT_MAX_LIMBS];
+limb_t y[MODCONTEXT_MAX_LIMBS];
+limb_t e[MODCONTEXT_MAX_LIMBS];
+limb_t result[MODCONTEXT_MAX_LIMBS];
+limb_t expected[MODCONTEXT_MAX_LIMBS];
+
+// Convert a decimal string in program memory into a big number.
+void fromString(limb_t *x, size_t xsize, const char *str)
+{
+    uint8_t ch;
+    size_t posn;
+    memset(x, 0, sizeof(limb_t) * xsize);
+    while ((ch = pgm_read_byte((uint8_t *)str)) != '\0') {
+        if (ch >= '0' && ch <= '9') {
+            // Quick and simple method to multiply by 10 and add the new digit.
+            dlimb_t carry = ch - '0';
+            for (posn = 0; posn < xsize; ++posn) {
+                carry += ((dlimb_t)x[posn]) * 10U;
+                x[posn] = (limb_t)carry;
+                carry >>= LIMB_BITS;
+            }
+        }
+        ++str;
+    }
+}
+
+bool check(const limb_t *x, const limb_t *y, size_t size)
+{
+    if (memcmp(x, y, size * sizeof(limb_t)) == 0) {
+        Serial.println("ok");
+        return true;
+    } else {
+        Serial.println("failed");
+        return false;
+    }
+}
+
+void testSetModulus()
+{
+    Serial.print("setModulus: ");
+    Serial.flush();
+    memset(modulus, 0, sizeof(modulus));
+    modulus[0] = 1;
+    bool ok = !ctx.setModulus(modulus, 1);
+    modulus[0] = 4;
+    ok = ok && !ctx.setModulus(modulus, 1);
+    modulus[0] = 7;
+    ok = ok && !ctx.setModulus(modulus, MODCONTEXT_MAX_LIMBS + 1);
+    ok = ok && ctx.setModulus(modulus, 1) && ctx.size() == 1;
+    ok = ok && ctx.setModulus(modulus, MODCONTEXT_MAX_LIMBS);
+    if (ok)
+        Serial.println("ok");
+    else
+        Serial.println("failed");
+}
+
+void testP256()
+{
+    fromString(modulus, NUM_LIMBS_256, p256);
+    ctx.setModulus(modulus, NUM_LIMBS_256);
+
+    Serial.print("P-256 modMul: ");
+    Serial.flush();
+    fromString(x, NUM_LIMBS_256, p256_a);
+    fromString(y, NUM_LIMBS_256, p256_b);
+    fromString(expected, NUM_LIMBS_256, p256_ab);
+    ctx.toMont(x, x);
+    ctx.toMont(y, y);
+    ctx.modMul(result, x, y);
+    ctx.fromMont(result, result);
+    check(result, expected, NUM_LIMBS_256);
+
+    Serial.print("P-256 modSquare: ");
+    Serial.flush();
+    ctx.modMul(expected, x, x);
+    ctx.modSquare(result, x);
+    check(result, expected, NUM_LIMBS_256);
+
+    Serial.print("P-256 modExp: ");
+    Serial.flush();
+    fromString(x, NUM_LIMBS_256, p256_a);
+    fromString(e, NUM_LIMBS_256, p256_b);
+    fromString(expected, NUM_LIMBS_256, p256_a_pow_b);
+    ctx.modExp(result, x, e, NUM_LIMBS_256);
+    check(result, expected, NUM_LIMBS_256);
+
+    // By Fermat's little theorem, a^(p - 1) mod p = 1.
+    Serial.print("P-256 Fermat: ");
+    Serial.flush();
+    fromString(e, NUM_LIMBS_256, p256);
+    e[0] -= 1;
+    memset(expected, 0, sizeof(expected));
+    expected[0] = 1;
+    ctx.modExp(result, x, e, NUM_LIMBS_256);
+    check(result, expected, NUM_LIMBS_256);
+}
+
+void testRSA()
+{
+#if MODCONTEXT_MAX_BITS >= 1024
+    fromString(modulus, NUM_LIMBS_1024, rsa_n);
+    ctx.setModulus(modulus, NUM_LIMBS_1024);
+
+    Serial.print("RSA-1024 encrypt: ");
+    Serial.flush();
+    fromString(x, NUM_LIMBS_1024, rsa_m);
+    fromString(expected, NUM_LIMBS_1024, rsa_c);
+    fromString(e, NUM_LIMBS_32, rsa_e);
+    ctx.modExp(result, x, e, NUM_LIMBS_32);
+    check(result, expected, NUM_LIMBS_1024);
+
+    Serial.print("RSA-1024 decrypt: ");
+    Serial.flush();
+    fromString(x, NUM_LIMBS_1024, rsa_c);
+    fromString(e, NUM_LIMBS_1024, rsa_d);
+    fromString(expected, NUM_LIMBS_1024, rsa_m);
+    unsigned long start = micros();
+    ctx.modExp(result, x, e, NUM_LIMBS_1024);
+    unsigned long elapsed = micros() - start;
+    check(result, expected, NUM_LIMBS_1024);
+
+    Serial.print("RSA-1024 private key operation ... ");
+    Serial.print(elapsed / 1000.0);
+    Serial.println("ms");
+#endif
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    testSetModulus();
+    testP256();
+    testRSA();
+
+    ctx.clear();
+}
+
+void loop()
+{
+}
@@ -18,10 +18,21 @@
 TransistorNoiseSource noise(A1);
 //RingOscillatorNoiseSource noise;
 
+// Uncomment to report how long the pool takes to fill up from boot and
+// the noise source statistics instead of printing random data.
+//#define REPORT_STATS 1
+
+// Number of milliseconds between statistics reports.
+#define REPORT_INTERVAL 10000
+
 bool calibrating = false;
 byte data[32];
 unsigned long startTime;
 size_t length = 48; // First block should wait for the pool to fill up.
+#if defined(REPORT_STATS)
+bool poolFull = false;
+unsigned long lastReport;
+#endif
 
 void setup() {
     Serial.begin(9600);
@@ -34,6 +45,9 @@ void setup() {
     RNG.addNoiseSource(noise);
 
     startTime = millis();
+#if defined(REPORT_STATS)
+    lastReport = startTime;
+#endif
 }
 
 void printHex(const byte *data, unsigned len)
@@ -65,6 +79,32 @@ void loop() {
     // Perform regular housekeeping on the random number generator.
     RNG.loop();
 
+#if defined(REPORT_STATS)
+    // Report the time to fill the pool once, and then the statistics for
+    // the noise source on a regular basis.
+    unsigned long now = millis();
+    if (!poolFull && RNG.available(48)) {
+        poolFull = true;
+        Serial.print("Pool full after ");
+        Serial.print((now - startTime) / 1000.0);
+        Serial.println("s");
+    }
+    if ((now - lastReport) >= REPORT_INTERVAL) {
+        lastReport = now;
+        Serial.print("samples=");
+        Serial.print(noise.sampleCount());
+        Serial.print(", credited=");
+        Serial.print(noise.creditedBits());
+        Serial.print(" bits (");
+        Serial.print(noise.creditedBits() * 1000.0 / (now - startTime));
+        Serial.print(" bits/s), rct failures=");
+        Serial.print(noise.repetitionFailures());
+        Serial.print(", apt failures=");
+        Serial.println(noise.proportionFailures());
+    }
+    return;
+#endif
+
     // Generate output whenever 32 bytes of entropy have been accumulated.
     // The first time through, we wait for 48 bytes for a full entropy pool.
     if (RNG.available(length)) {
@@ -73,6 +73,7 @@ static TestHashVector const testVectorHMAC_SHA1_2 = {
 };
 
 SHA1 sha1;
+SHA1 sha1Copy;
 
 byte buffer[128];
 
@@ -200,6 +201,38 @@ void testHMAC(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = strlen(test->data);
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -297,6 +330,7 @@ void setup()
     Serial.println("Test Vectors:");
     testHash(&sha1, &testVectorSHA1_1);
     testHash(&sha1, &testVectorSHA1_2);
+    testCopyState(&sha1, &sha1Copy, &testVectorSHA1_2);
     testHMAC(&sha1, &testVectorHMAC_SHA1_1);
     testHMAC(&sha1, &testVectorHMAC_SHA1_2);
     testHMAC(&sha1, (size_t)0);
@@ -77,6 +77,7 @@ static TestHashVector const testVectorHMAC_SHA256_2 = {
 };
 
 SHA256 sha256;
+SHA256 sha256Copy;
 
 byte buffer[128];
 
@@ -204,6 +205,38 @@ void testHMAC(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = strlen(test->data);
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -301,6 +334,7 @@ void setup()
     Serial.println("Test Vectors:");
     testHash(&sha256, &testVectorSHA256_1);
     testHash(&sha256, &testVectorSHA256_2);
+    testCopyState(&sha256, &sha256Copy, &testVectorSHA256_2);
     testHMAC(&sha256, &testVectorHMAC_SHA256_1);
     testHMAC(&sha256, &testVectorHMAC_SHA256_2);
     testHMAC(&sha256, (size_t)0);
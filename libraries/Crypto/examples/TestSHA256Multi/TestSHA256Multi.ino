@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the SHA256x4 and SHA256x8 multi-lane engines
+by comparing their results with the regular SHA256 implementation.
+*/
+
+#include <Crypto.h>
+#include <SHA256.h>
+#include <SHA256Multi.h>
+#include <string.h>
+
+#define NUM_JOBS        24
+#define MAX_MESSAGE_LEN 200
+#define PERF_MSG_LEN    64
+#define PERF_LOOPS      50
+
+SHA256x4 engine4;
+SHA256x8 engine8;
+SHA256 sha256;
+
+SHA256Job jobs[NUM_JOBS];
+uint8_t messages[NUM_JOBS][MAX_MESSAGE_LEN];
+uint8_t keys[NUM_JOBS][100];
+bool seen[NUM_JOBS];
+
+// Sets up a collection of jobs with a variety of message and key lengths.
+void setupJobs(bool hmac)
+{
+    static size_t const keyLens[] = {0, 16, 32, 64, 65, 100};
+    for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+        size_t len = (index * 37 + index / 3) % MAX_MESSAGE_LEN;
+        if (index == 1)
+            len = 55;       // Padding just fits in one block.
+        else if (index == 2)
+            len = 56;       // Padding needs a second block.
+        else if (index == 3)
+            len = 64;
+        else if (index == 4)
+            len = 54;       // Padding just fits with a prefix byte.
+        else if (index == 5)
+            len = 63;
+        for (size_t posn = 0; posn < len; ++posn)
+            messages[index][posn] = (uint8_t)(index * 7 + posn * 3);
+        for (size_t posn = 0; posn < sizeof(keys[index]); ++posn)
+            keys[index][posn] = (uint8_t)(index + posn * 5);
+        jobs[index].data = messages[index];
+        jobs[index].len = len;
+        if (hmac) {
+            jobs[index].key = keys[index];
+            jobs[index].keyLen = keyLens[index % 6];
+        } else {
+            jobs[index].key = 0;
+            jobs[index].keyLen = 0;
+        }
+        memset(jobs[index].hash, 0xAA, sizeof(jobs[index].hash));
+        seen[index] = false;
+    }
+}
+
+// Checks a finished job against the regular SHA256 implementation.
+// If "prefix" is not -1, then the job hashed that byte before the data.
+bool checkJob(SHA256Job *job, int prefix)
+{
+    uint8_t expected[32];
+    size_t index = job - jobs;
+    if (index >= NUM_JOBS || seen[index])
+        return false;
+    seen[index] = true;
+    if (job->key) {
+        sha256.resetHMAC(job->key, job->keyLen);
+        sha256.update(job->data, job->len);
+        sha256.finalizeHMAC(job->key, job->keyLen, expected, sizeof(expected));
+    } else {
+        uint8_t pre = (uint8_t)prefix;
+        sha256.reset();
+        if (prefix != -1)
+            sha256.update(&pre, 1);
+        sha256.update(job->data, job->len);
+        sha256.finalize(expected, sizeof(expected));
+    }
+    return memcmp(job->hash, expected, sizeof(expected)) == 0;
+}
+
+void testEngine(const char *name, SHA256MultiCommon *engine, bool hmac)
+{
+    SHA256Job *job;
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(hmac ? " HMAC ... " : " ... ");
+    Serial.flush();
+
+    setupJobs(hmac);
+    for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+        if ((job = engine->submit(&jobs[index])) != 0)
+            ok &= checkJob(job, -1);
+    }
+    while ((job = engine->flush()) != 0)
+        ok &= checkJob(job, -1);
+    for (uint8_t index = 0; index < NUM_JOBS; ++index)
+        ok &= seen[index];
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testPrefix(const char *name, SHA256MultiCommon *engine)
+{
+    SHA256Job *job;
+    bool ok = true;
+
+    Serial.print(name);
+    Serial.print(" prefix ... ");
+    Serial.flush();
+
+    // Each job uses its index as the prefix byte.
+    setupJobs(false);
+    for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+        if ((job = engine->submit(&jobs[index], index)) != 0)
+            ok &= checkJob(job, (int)(job - jobs));
+    }
+    while ((job = engine->flush()) != 0)
+        ok &= checkJob(job, (int)(job - jobs));
+    for (uint8_t index = 0; index < NUM_JOBS; ++index)
+        ok &= seen[index];
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfSingle()
+{
+    unsigned long start;
+    unsigned long elapsed;
+    uint8_t hash[32];
+
+    Serial.print("SHA256 ... ");
+    Serial.flush();
+
+    start = micros();
+    for (int loop = 0; loop < PERF_LOOPS; ++loop) {
+        for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+            sha256.reset();
+            sha256.update(messages[index], PERF_MSG_LEN);
+            sha256.finalize(hash, sizeof(hash));
+        }
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS));
+    Serial.print("us per byte, ");
+    Serial.print((PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void perfEngine(const char *name, SHA256MultiCommon *engine)
+{
+    unsigned long start;
+    unsigned long elapsed;
+
+    Serial.print(name);
+    Serial.print(" ... ");
+    Serial.flush();
+
+    setupJobs(false);
+    for (uint8_t index = 0; index < NUM_JOBS; ++index)
+        jobs[index].len = PERF_MSG_LEN;
+    start = micros();
+    for (int loop = 0; loop < PERF_LOOPS; ++loop) {
+        for (uint8_t index = 0; index < NUM_JOBS; ++index)
+            engine->submit(&jobs[index]);
+        while (engine->flush() != 0)
+            ;
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS));
+    Serial.print("us per byte, ");
+    Serial.print((PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testEngine("SHA256x4", &engine4, false);
+    testEngine("SHA256x4", &engine4, true);
+    testPrefix("SHA256x4", &engine4);
+    testEngine("SHA256x8", &engine8, false);
+    testEngine("SHA256x8", &engine8, true);
+    testPrefix("SHA256x8", &engine8);
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfSingle();
+    perfEngine("SHA256x4", &engine4);
+    perfEngine("SHA256x8", &engine8);
+}
+
+void loop()
+{
+}
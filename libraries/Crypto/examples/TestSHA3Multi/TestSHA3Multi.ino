@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the SHA3_256x4 multi-lane engine by comparing
+its results with the regular SHA3_256 implementation.
+*/
+
+#include <Crypto.h>
+#include <SHA3.h>
+#include <SHA3Multi.h>
+#include <string.h>
+
+#define NUM_JOBS        22
+#define MAX_MESSAGE_LEN 400
+#define PERF_MSG_LEN    64
+#define PERF_LOOPS      50
+
+SHA3_256x4 engine;
+SHA3_256 sha3;
+
+SHA3Job jobs[NUM_JOBS];
+uint8_t messages[NUM_JOBS][MAX_MESSAGE_LEN];
+bool seen[NUM_JOBS];
+
+// SHA3-256("abc") from FIPS 202.
+static uint8_t const abcHash[32] = {
+    0x3a, 0x98, 0x5d, 0xa7, 0x4f, 0xe2, 0x25, 0xb2,
+    0x04, 0x5c, 0x17, 0x2d, 0x6b, 0xd3, 0x90, 0xbd,
+    0x85, 0x5f, 0x08, 0x6e, 0x3e, 0x9d, 0x52, 0x5b,
+    0x46, 0xbf, 0xe2, 0x45, 0x11, 0x43, 0x15, 0x32
+};
+
+// Sets up a collection of jobs with a variety of message lengths.
+void setupJobs()
+{
+    for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+        size_t len = (index * 73 + index / 3) % MAX_MESSAGE_LEN;
+        if (index == 1)
+            len = 135;      // Padding just fits in one block.
+        else if (index == 2)
+            len = 136;      // Padding needs a second block.
+        else if (index == 3)
+            len = 137;
+        else if (index == 4)
+            len = 272;
+        for (size_t posn = 0; posn < len; ++posn)
+            messages[index][posn] = (uint8_t)(index * 7 + posn * 3);
+        jobs[index].data = messages[index];
+        jobs[index].len = len;
+        memset(jobs[index].hash, 0xAA, sizeof(jobs[index].hash));
+        seen[index] = false;
+    }
+}
+
+// Checks a finished job against the regular SHA3_256 implementation.
+bool checkJob(SHA3Job *job)
+{
+    uint8_t expected[32];
+    size_t index = job - jobs;
+    if (index >= NUM_JOBS || seen[index])
+        return false;
+    seen[index] = true;
+    sha3.reset();
+    sha3.update(job->data, job->len);
+    sha3.finalize(expected, sizeof(expected));
+    return memcmp(job->hash, expected, sizeof(expected)) == 0;
+}
+
+void testVector()
+{
+    SHA3Job job;
+
+    Serial.print("SHA3_256x4 abc ... ");
+    Serial.flush();
+
+    job.data = "abc";
+    job.len = 3;
+    engine.submit(&job);
+    if (engine.flush() == &job && engine.flush() == 0 &&
+            memcmp(job.hash, abcHash, sizeof(abcHash)) == 0)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testEngine()
+{
+    SHA3Job *job;
+    bool ok = true;
+
+    Serial.print("SHA3_256x4 ... ");
+    Serial.flush();
+
+    setupJobs();
+    for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+        if ((job = engine.submit(&jobs[index])) != 0)
+            ok &= checkJob(job);
+    }
+    while ((job = engine.flush()) != 0)
+        ok &= checkJob(job);
+    for (uint8_t index = 0; index < NUM_JOBS; ++index)
+        ok &= seen[index];
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfSingle()
+{
+    unsigned long start;
+    unsigned long elapsed;
+    uint8_t hash[32];
+
+    Serial.print("SHA3_256 ... ");
+    Serial.flush();
+
+    start = micros();
+    for (int loop = 0; loop < PERF_LOOPS; ++loop) {
+        for (uint8_t index = 0; index < NUM_JOBS; ++index) {
+            sha3.reset();
+            sha3.update(messages[index], PERF_MSG_LEN);
+            sha3.finalize(hash, sizeof(hash));
+        }
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS));
+    Serial.print("us per byte, ");
+    Serial.print((PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void perfEngine()
+{
+    unsigned long start;
+    unsigned long elapsed;
+
+    Serial.print("SHA3_256x4 ... ");
+    Serial.flush();
+
+    setupJobs();
+    for (uint8_t index = 0; index < NUM_JOBS; ++index)
+        jobs[index].len = PERF_MSG_LEN;
+    start = micros();
+    for (int loop = 0; loop < PERF_LOOPS; ++loop) {
+        for (uint8_t index = 0; index < NUM_JOBS; ++index)
+            engine.submit(&jobs[index]);
+        while (engine.flush() != 0)
+            ;
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS));
+    Serial.print("us per byte, ");
+    Serial.print((PERF_MSG_LEN * NUM_JOBS * (double)PERF_LOOPS * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testVector();
+    testEngine();
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfSingle();
+    perfEngine();
+}
+
+void loop()
+{
+}
@@ -123,6 +123,7 @@ static TestHashVector testVectorSHA3_256_5 = {
 };
 
 SHA3_256 sha3_256;
+SHA3_256 sha3_256Copy;
 
 bool testHash_N(Hash *hash, const struct TestHashVector *test, size_t inc)
 {
@@ -170,6 +171,38 @@ void testHash(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = test->dataSize;
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -295,6 +328,8 @@ void setup()
 
     Serial.print("State Size ...");
     Serial.println(sizeof(SHA3_256));
+    Serial.print("Keccak-p Implementation ... ");
+    Serial.println(KECCAKP_IMPL);
     Serial.println();
 
     Serial.println("Test Vectors:");
@@ -303,6 +338,7 @@ void setup()
     testHash(&sha3_256, &testVectorSHA3_256_3);
     testHash(&sha3_256, &testVectorSHA3_256_4);
     testHash(&sha3_256, &testVectorSHA3_256_5);
+    testCopyState(&sha3_256, &sha3_256Copy, &testVectorSHA3_256_2);
     testHMAC(&sha3_256, (size_t)0);
     testHMAC(&sha3_256, 1);
     testHMAC(&sha3_256, HASH_SIZE);
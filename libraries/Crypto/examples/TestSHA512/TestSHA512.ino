@@ -77,6 +77,7 @@ static TestHashVector const testVectorSHA512_3 = {
 };
 
 SHA512 sha512;
+SHA512 sha512Copy;
 
 byte buffer[BLOCK_SIZE + 2];
 
@@ -124,6 +125,38 @@ void testHash(Hash *hash, const struct TestHashVector *test)
         Serial.println("Failed");
 }
 
+// Hashes the first half of the data, forks the state with copyState(),
+// and then checks that both objects produce the same result.
+void testCopyState(Hash *hash, Hash *copy, const struct TestHashVector *test)
+{
+    size_t size = strlen(test->data);
+    size_t half = size / 2;
+    uint8_t value[HASH_SIZE];
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" copyState ... ");
+
+    hash->reset();
+    hash->update(test->data, half);
+    copy->reset();
+    copy->update("garbage", 7);
+    copy->copyState(*hash);
+
+    copy->update(test->data + half, size - half);
+    copy->finalize(value, sizeof(value));
+    ok = (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    hash->update(test->data + half, size - half);
+    hash->finalize(value, sizeof(value));
+    ok &= (memcmp(value, test->hash, sizeof(value)) == 0);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfHash(Hash *hash)
 {
     unsigned long start;
@@ -247,6 +280,7 @@ void setup()
     testHash(&sha512, &testVectorSHA512_1);
     testHash(&sha512, &testVectorSHA512_2);
     testHash(&sha512, &testVectorSHA512_3);
+    testCopyState(&sha512, &sha512Copy, &testVectorSHA512_2);
     testHMAC(&sha512, (size_t)0);
     testHMAC(&sha512, 1);
     testHMAC(&sha512, HASH_SIZE);
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the SHAKE, cSHAKE, and KMAC implementations
+to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <SHAKE.h>
+#include <string.h>
+
+#define MAX_OUTPUT_SIZE 64
+
+#define TYPE_SHAKE      0
+#define TYPE_KMAC       1
+#define TYPE_KMACXOF    2
+
+struct TestSHAKEVector
+{
+    const char *name;
+    uint8_t type;
+    uint16_t bits;
+    uint16_t dataLen;
+    uint8_t keyLen;
+    const char *function;
+    const char *custom;
+    uint16_t skip;
+    uint8_t outLen;
+    uint8_t output[MAX_OUTPUT_SIZE];
+};
+
+// Test vectors from the NIST SP 800-185 examples where available, and
+// others generated with a Python model of SP 800-185.  The data is the
+// byte sequence 0, 1, 2, ... and the key is 0x40, 0x41, 0x42, ...
+// The first "skip" bytes of output are discarded before comparing.
+static TestSHAKEVector const testVector1 = {
+    "SHAKE128 #1",
+    TYPE_SHAKE, 128, 0, 0,
+    "", "",
+    0, 32,
+    {0x7f, 0x9c, 0x2b, 0xa4, 0xe8, 0x8f, 0x82, 0x7d,
+     0x61, 0x60, 0x45, 0x50, 0x76, 0x05, 0x85, 0x3e,
+     0xd7, 0x3b, 0x80, 0x93, 0xf6, 0xef, 0xbc, 0x88,
+     0xeb, 0x1a, 0x6e, 0xac, 0xfa, 0x66, 0xef, 0x26}
+};
+static TestSHAKEVector const testVector2 = {
+    "SHAKE128 #2",
+    TYPE_SHAKE, 128, 200, 0,
+    "", "",
+    300, 32,
+    {0x37, 0x93, 0x42, 0xc5, 0x82, 0x28, 0x70, 0xda,
+     0x2c, 0x37, 0xea, 0x46, 0x4a, 0x0a, 0xd2, 0xd7,
+     0x78, 0x67, 0x8a, 0x33, 0xd4, 0x0b, 0xc0, 0x54,
+     0xdf, 0xe5, 0xf3, 0x9f, 0xcf, 0x3d, 0xae, 0x74}
+};
+static TestSHAKEVector const testVector3 = {
+    "SHAKE256 #1",
+    TYPE_SHAKE, 256, 0, 0,
+    "", "",
+    0, 64,
+    {0x46, 0xb9, 0xdd, 0x2b, 0x0b, 0xa8, 0x8d, 0x13,
+     0x23, 0x3b, 0x3f, 0xeb, 0x74, 0x3e, 0xeb, 0x24,
+     0x3f, 0xcd, 0x52, 0xea, 0x62, 0xb8, 0x1b, 0x82,
+     0xb5, 0x0c, 0x27, 0x64, 0x6e, 0xd5, 0x76, 0x2f,
+     0xd7, 0x5d, 0xc4, 0xdd, 0xd8, 0xc0, 0xf2, 0x00,
+     0xcb, 0x05, 0x01, 0x9d, 0x67, 0xb5, 0x92, 0xf6,
+     0xfc, 0x82, 0x1c, 0x49, 0x47, 0x9a, 0xb4, 0x86,
+     0x40, 0x29, 0x2e, 0xac, 0xb3, 0xb7, 0xc4, 0xbe}
+};
+static TestSHAKEVector const testVector4 = {
+    "SHAKE256 #2",
+    TYPE_SHAKE, 256, 137, 0,
+    "", "",
+    130, 64,
+    {0x1b, 0x51, 0x4f, 0xb9, 0x38, 0x28, 0xa2, 0x1b,
+     0xc9, 0x36, 0x8b, 0xc2, 0x4f, 0xe6, 0x38, 0x08,
+     0xd6, 0xbe, 0x56, 0x72, 0x48, 0xba, 0xe6, 0x1f,
+     0x38, 0xba, 0x3f, 0x9e, 0x67, 0x6b, 0xbe, 0x82,
+     0x75, 0xba, 0x47, 0xc2, 0xff, 0x92, 0xd7, 0x70,
+     0x46, 0x89, 0x44, 0xb9, 0x93, 0x3c, 0x96, 0x43,
+     0x54, 0x88, 0x22, 0x4a, 0xf2, 0x96, 0xb8, 0xb5,
+     0x42, 0xf9, 0xfd, 0x3d, 0xc0, 0xf9, 0xf8, 0xf2}
+};
+static TestSHAKEVector const testVector5 = {
+    "cSHAKE128 #1",
+    TYPE_SHAKE, 128, 4, 0,
+    "", "Email Signature",
+    0, 32,
+    {0xc1, 0xc3, 0x69, 0x25, 0xb6, 0x40, 0x9a, 0x04,
+     0xf1, 0xb5, 0x04, 0xfc, 0xbc, 0xa9, 0xd8, 0x2b,
+     0x40, 0x17, 0x27, 0x7c, 0xb5, 0xed, 0x2b, 0x20,
+     0x65, 0xfc, 0x1d, 0x38, 0x14, 0xd5, 0xaa, 0xf5}
+};
+static TestSHAKEVector const testVector6 = {
+    "cSHAKE256 #1",
+    TYPE_SHAKE, 256, 4, 0,
+    "", "Email Signature",
+    0, 64,
+    {0xd0, 0x08, 0x82, 0x8e, 0x2b, 0x80, 0xac, 0x9d,
+     0x22, 0x18, 0xff, 0xee, 0x1d, 0x07, 0x0c, 0x48,
+     0xb8, 0xe4, 0xc8, 0x7b, 0xff, 0x32, 0xc9, 0x69,
+     0x9d, 0x5b, 0x68, 0x96, 0xee, 0xe0, 0xed, 0xd1,
+     0x64, 0x02, 0x0e, 0x2b, 0xe0, 0x56, 0x08, 0x58,
+     0xd9, 0xc0, 0x0c, 0x03, 0x7e, 0x34, 0xa9, 0x69,
+     0x37, 0xc5, 0x61, 0xa7, 0x4c, 0x41, 0x2b, 0xb4,
+     0xc7, 0x46, 0x46, 0x95, 0x27, 0x28, 0x1c, 0x8c}
+};
+static TestSHAKEVector const testVector7 = {
+    "cSHAKE256 #2",
+    TYPE_SHAKE, 256, 200, 0,
+    "Name", "Email Signature",
+    150, 64,
+    {0x66, 0x0b, 0xa4, 0x67, 0xcb, 0xf0, 0xcd, 0x3c,
+     0x03, 0x0c, 0x3c, 0x9f, 0xe4, 0x52, 0x1a, 0x51,
+     0x38, 0x6d, 0xf3, 0xd9, 0xcd, 0x72, 0x12, 0xd3,
+     0xf4, 0x2a, 0x2d, 0xee, 0x0a, 0x31, 0x66, 0x09,
+     0x99, 0xd2, 0x3f, 0xf0, 0xc7, 0xbc, 0x56, 0x8f,
+     0x72, 0x4e, 0xb2, 0x91, 0xa4, 0x05, 0x9c, 0x53,
+     0x64, 0x7f, 0xa8, 0xb6, 0xc3, 0x72, 0xc9, 0x39,
+     0xc2, 0xc5, 0xba, 0x4d, 0xc1, 0xce, 0xff, 0xfc}
+};
+static TestSHAKEVector const testVector8 = {
+    "KMAC128 #1",
+    TYPE_KMAC, 128, 4, 32,
+    "", "",
+    0, 32,
+    {0xe5, 0x78, 0x0b, 0x0d, 0x3e, 0xa6, 0xf7, 0xd3,
+     0xa4, 0x29, 0xc5, 0x70, 0x6a, 0xa4, 0x3a, 0x00,
+     0xfa, 0xdb, 0xd7, 0xd4, 0x96, 0x28, 0x83, 0x9e,
+     0x31, 0x87, 0x24, 0x3f, 0x45, 0x6e, 0xe1, 0x4e}
+};
+static TestSHAKEVector const testVector9 = {
+    "KMAC128 #2",
+    TYPE_KMAC, 128, 4, 32,
+    "", "My Tagged Application",
+    0, 32,
+    {0x3b, 0x1f, 0xba, 0x96, 0x3c, 0xd8, 0xb0, 0xb5,
+     0x9e, 0x8c, 0x1a, 0x6d, 0x71, 0x88, 0x8b, 0x71,
+     0x43, 0x65, 0x1a, 0xf8, 0xba, 0x0a, 0x70, 0x70,
+     0xc0, 0x97, 0x9e, 0x28, 0x11, 0x32, 0x4a, 0xa5}
+};
+static TestSHAKEVector const testVector10 = {
+    "KMAC256 #1",
+    TYPE_KMAC, 256, 4, 32,
+    "", "My Tagged Application",
+    0, 64,
+    {0x20, 0xc5, 0x70, 0xc3, 0x13, 0x46, 0xf7, 0x03,
+     0xc9, 0xac, 0x36, 0xc6, 0x1c, 0x03, 0xcb, 0x64,
+     0xc3, 0x97, 0x0d, 0x0c, 0xfc, 0x78, 0x7e, 0x9b,
+     0x79, 0x59, 0x9d, 0x27, 0x3a, 0x68, 0xd2, 0xf7,
+     0xf6, 0x9d, 0x4c, 0xc3, 0xde, 0x9d, 0x10, 0x4a,
+     0x35, 0x16, 0x89, 0xf2, 0x7c, 0xf6, 0xf5, 0x95,
+     0x1f, 0x01, 0x03, 0xf3, 0x3f, 0x4f, 0x24, 0x87,
+     0x10, 0x24, 0xd9, 0xc2, 0x77, 0x73, 0xa8, 0xdd}
+};
+static TestSHAKEVector const testVector11 = {
+    "KMAC256 #2",
+    TYPE_KMAC, 256, 200, 32,
+    "", "My Tagged Application",
+    0, 64,
+    {0xb5, 0x86, 0x18, 0xf7, 0x1f, 0x92, 0xe1, 0xd5,
+     0x6c, 0x1b, 0x8c, 0x55, 0xdd, 0xd7, 0xcd, 0x18,
+     0x8b, 0x97, 0xb4, 0xca, 0x4d, 0x99, 0x83, 0x1e,
+     0xb2, 0x69, 0x9a, 0x83, 0x7d, 0xa2, 0xe4, 0xd9,
+     0x70, 0xfb, 0xac, 0xfd, 0xe5, 0x00, 0x33, 0xae,
+     0xa5, 0x85, 0xf1, 0xa2, 0x70, 0x85, 0x10, 0xc3,
+     0x2d, 0x07, 0x88, 0x08, 0x01, 0xbd, 0x18, 0x28,
+     0x98, 0xfe, 0x47, 0x68, 0x76, 0xfc, 0x89, 0x65}
+};
+static TestSHAKEVector const testVector12 = {
+    "KMACXOF128 #1",
+    TYPE_KMACXOF, 128, 4, 32,
+    "", "My Tagged Application",
+    0, 32,
+    {0x31, 0xa4, 0x45, 0x27, 0xb4, 0xed, 0x9f, 0x5c,
+     0x61, 0x01, 0xd1, 0x1d, 0xe6, 0xd2, 0x6f, 0x06,
+     0x20, 0xaa, 0x5c, 0x34, 0x1d, 0xef, 0x41, 0x29,
+     0x96, 0x57, 0xfe, 0x9d, 0xf1, 0xa3, 0xb1, 0x6c}
+};
+static TestSHAKEVector const testVector13 = {
+    "KMACXOF256 #1",
+    TYPE_KMACXOF, 256, 200, 32,
+    "", "My Tagged Application",
+    200, 64,
+    {0xcb, 0xe3, 0xb3, 0x03, 0xb2, 0x19, 0xf6, 0x7b,
+     0x48, 0x24, 0x8c, 0xbf, 0x14, 0xad, 0x7e, 0xb2,
+     0xc5, 0x12, 0x0f, 0xfe, 0xd4, 0x73, 0xe7, 0x3b,
+     0xda, 0x2a, 0x8b, 0x3e, 0x37, 0x83, 0x5b, 0x4c,
+     0x47, 0x11, 0xda, 0x0f, 0x02, 0x56, 0xf9, 0xbf,
+     0x9d, 0x33, 0xce, 0x5b, 0x0d, 0x6f, 0x5b, 0x6d,
+     0xba, 0xb0, 0x06, 0x27, 0x33, 0x01, 0xa5, 0xdf,
+     0x25, 0x5a, 0x44, 0xb3, 0x17, 0x68, 0x5e, 0x23}
+};
+
+SHAKE128 shake128;
+SHAKE256 shake256;
+KMAC128 kmac128;
+KMAC256 kmac256;
+
+byte buffer[128];
+
+// Supplies the data or output in chunks of "inc" bytes.
+bool testSHAKE_N(const struct TestSHAKEVector *test, size_t inc)
+{
+    uint8_t output[MAX_OUTPUT_SIZE];
+    size_t posn, len, index;
+    SHAKE *shake = (test->bits == 128) ? (SHAKE *)&shake128 : (SHAKE *)&shake256;
+    KMAC *kmac = (test->bits == 128) ? (KMAC *)&kmac128 : (KMAC *)&kmac256;
+
+    if (inc > sizeof(buffer))
+        inc = sizeof(buffer);
+
+    if (test->type == TYPE_SHAKE) {
+        shake->reset(test->function, strlen(test->function),
+                     test->custom, strlen(test->custom));
+    } else {
+        for (index = 0; index < test->keyLen; ++index)
+            buffer[index] = (uint8_t)(0x40 + index);
+        kmac->reset(buffer, test->keyLen, test->custom, strlen(test->custom));
+    }
+
+    for (posn = 0; posn < test->dataLen; posn += inc) {
+        len = test->dataLen - posn;
+        if (len > inc)
+            len = inc;
+        for (index = 0; index < len; ++index)
+            buffer[index] = (uint8_t)(posn + index);
+        if (test->type == TYPE_SHAKE)
+            shake->update(buffer, len);
+        else
+            kmac->update(buffer, len);
+    }
+
+    if (test->type == TYPE_KMAC) {
+        kmac->finalize(output, test->outLen);
+    } else {
+        for (posn = 0; posn < (size_t)(test->skip + test->outLen); posn += inc) {
+            len = test->skip + test->outLen - posn;
+            if (len > inc)
+                len = inc;
+            if (test->type == TYPE_SHAKE)
+                shake->extract(buffer, len);
+            else
+                kmac->extract(buffer, len);
+            for (index = 0; index < len; ++index) {
+                if ((posn + index) >= test->skip)
+                    output[posn + index - test->skip] = buffer[index];
+            }
+            }
+    }
+
+    return memcmp(output, test->output, test->outLen) == 0;
+}
+
+void testSHAKE(const struct TestSHAKEVector *test)
+{
+    bool ok;
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    ok  = testSHAKE_N(test, 1);
+    ok &= testSHAKE_N(test, 7);
+    ok &= testSHAKE_N(test, 64);
+    ok &= testSHAKE_N(test, 100);
+    ok &= testSHAKE_N(test, sizeof(buffer));
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfExtract(SHAKE *shake, const char *name)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print(name);
+    Serial.print(" extract ... ");
+
+    shake->reset();
+    shake->update("abc", 3);
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        shake->extract(buffer, sizeof(buffer));
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (sizeof(buffer) * 500.0));
+    Serial.print("us per byte, ");
+    Serial.print((sizeof(buffer) * 500.0 * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
+void perfKMAC(KMAC *kmac, const char *name)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    Serial.print(name);
+    Serial.print(" 32-byte key derivation ... ");
+
+    for (size_t posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (uint8_t)posn;
+
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        kmac->reset(buffer, 32, "label", 5);
+        kmac->update(buffer + 32, 16);
+        kmac->finalize(buffer + 64, 32);
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / 500.0);
+    Serial.print("us per op, ");
+    Serial.print((500.0 * 1000000.0) / elapsed);
+    Serial.println(" ops per second");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.print("State Sizes ... ");
+    Serial.print(sizeof(SHAKE128));
+    Serial.print(", ");
+    Serial.println(sizeof(KMAC128));
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testSHAKE(&testVector1);
+    testSHAKE(&testVector2);
+    testSHAKE(&testVector3);
+    testSHAKE(&testVector4);
+    testSHAKE(&testVector5);
+    testSHAKE(&testVector6);
+    testSHAKE(&testVector7);
+    testSHAKE(&testVector8);
+    testSHAKE(&testVector9);
+    testSHAKE(&testVector10);
+    testSHAKE(&testVector11);
+    testSHAKE(&testVector12);
+    testSHAKE(&testVector13);
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfExtract(&shake128, "SHAKE128");
+    perfExtract(&shake256, "SHAKE256");
+    perfKMAC(&kmac128, "KMAC128");
+    perfKMAC(&kmac256, "KMAC256");
+}
+
+void loop()
+{
+}
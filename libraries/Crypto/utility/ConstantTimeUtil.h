@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CONSTANTTIMEUTIL_H
+#define CRYPTO_CONSTANTTIMEUTIL_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Constant-time primitives for selecting and comparing secret values.
+// These are written to compile to straight-line code without "volatile":
+// the value barrier below hides the mask from the optimiser so that it
+// cannot prove the mask is 0 or all-ones and turn the arithmetic that
+// follows into a data-dependent branch.  All functions take unsigned types.
+
+#if defined(__GNUC__)
+#define ctBarrier(x)    __asm__ ("" : "+r"(x))
+#else
+#define ctBarrier(x)    do { } while (0)
+#endif
+
+// Returns all-ones if x is non-zero, or zero if x is zero.
+template <typename T>
+static inline T ctMask(T x)
+{
+    // The top bit of (x | -x) is set if and only if x is non-zero.
+    T m = (T)((x | (T)(0 - x)) >> (sizeof(T) * 8 - 1));
+    ctBarrier(m);
+    return (T)(0 - m);
+}
+
+#if defined(__AVR__) && defined(__GNUC__)
+
+// On AVR, "cp" sets the carry flag if x is non-zero and "sbc" then
+// smears the carry across the whole byte.
+template <>
+inline uint8_t ctMask<uint8_t>(uint8_t x)
+{
+    __asm__ ("cp __zero_reg__,%0\n\tsbc %0,%0" : "+r"(x));
+    return x;
+}
+
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+// On x86, "neg" sets the carry flag if x is non-zero and "sbb" then
+// smears the carry across the whole word.
+template <>
+inline uint32_t ctMask<uint32_t>(uint32_t x)
+{
+    __asm__ ("negl %0\n\tsbbl %0,%0" : "+r"(x) : : "cc");
+    return x;
+}
+
+#if defined(__x86_64__)
+template <>
+inline uint64_t ctMask<uint64_t>(uint64_t x)
+{
+    __asm__ ("negq %0\n\tsbbq %0,%0" : "+r"(x) : : "cc");
+    return x;
+}
+#endif
+
+#elif defined(__arm__) && defined(__GNUC__) && \
+      (defined(__thumb2__) || !defined(__thumb__))
+
+// On ARM and Thumb-2, "rsbs" clears the carry flag if x is non-zero
+// and "sbc" then smears the inverted carry across the whole word.
+template <>
+inline uint32_t ctMask<uint32_t>(uint32_t x)
+{
+    uint32_t t;
+    __asm__ ("rsbs %1, %0, #0\n\tsbc %0, %0, %0"
+             : "+r"(x), "=&r"(t) : : "cc");
+    return x;
+}
+
+#endif
+
+// Returns a if mask is all-ones, or b if mask is zero.
+template <typename T>
+static inline T ctSelect(T mask, T a, T b)
+{
+    return b ^ (mask & (a ^ b));
+}
+
+// Swaps the "size" elements of x and y if select is non-zero.
+template <typename T>
+static inline void ctSwap(T select, T *x, T *y, size_t size)
+{
+    T mask = ctMask(select);
+    while (size > 0) {
+        T dummy = mask & (*x ^ *y);
+        *x++ ^= dummy;
+        *y++ ^= dummy;
+        --size;
+    }
+}
+
+// Moves the "size" elements of y into x if select is non-zero.
+template <typename T>
+static inline void ctMove(T select, T *x, const T *y, size_t size)
+{
+    T mask = ctMask(select);
+    while (size > 0) {
+        *x ^= mask & (*x ^ *y);
+        ++x;
+        ++y;
+        --size;
+    }
+}
+
+#endif
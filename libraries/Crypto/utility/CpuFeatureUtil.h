@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CPUFEATUREUTIL_H
+#define CRYPTO_CPUFEATUREUTIL_H
+
+#include <inttypes.h>
+
+// Detection of optional instruction set extensions.  On x86 the SHA
+// extensions are detected at runtime with cpuid because the library may
+// be built for a generic target.  On ARMv8 the crypto extensions are
+// optional and there is no portable runtime check on bare-metal boards,
+// so they are only used when the compiler has been told they exist.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRYPTO_X86_SHA_EXT 1
+#else
+#define CRYPTO_X86_SHA_EXT 0
+#endif
+
+// AVX2 is also detected at runtime on x86, including the check that the
+// operating system saves the YMM registers on a context switch.
+#define CRYPTO_X86_AVX2 CRYPTO_X86_SHA_EXT
+
+// AVX-512F is detected in the same way, including the ZMM register state.
+#define CRYPTO_X86_AVX512 CRYPTO_X86_SHA_EXT
+
+// The AES-NI instructions are detected at runtime in the same way.
+#define CRYPTO_X86_AES_NI CRYPTO_X86_SHA_EXT
+
+#if defined(__ARM_NEON) && \
+    (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define CRYPTO_ARM_SHA_EXT 1
+#else
+#define CRYPTO_ARM_SHA_EXT 0
+#endif
+
+#if defined(__ARM_NEON) && \
+    (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define CRYPTO_ARM_AES_EXT 1
+#else
+#define CRYPTO_ARM_AES_EXT 0
+#endif
+
+#if CRYPTO_X86_SHA_EXT
+
+#include <cpuid.h>
+
+// Returns true if the processor supports the SHA extensions, together
+// with the SSSE3 and SSE4.1 instructions that the kernels also need.
+static inline bool cpuHasShaExt()
+{
+    static int8_t hasShaExt = -1;
+    if (hasShaExt < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        hasShaExt = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                (ecx & (1U << 9)) != 0 && (ecx & (1U << 19)) != 0 &&
+                __get_cpuid_max(0, 0) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if ((ebx & (1U << 29)) != 0)
+                hasShaExt = 1;
+        }
+    }
+    return hasShaExt != 0;
+}
+
+// Returns true if the processor and operating system support AVX2.
+static inline bool cpuHasAvx2()
+{
+    static int8_t hasAvx2 = -1;
+    if (hasAvx2 < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        hasAvx2 = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                (ecx & (1U << 27)) != 0 && (ecx & (1U << 28)) != 0 &&
+                __get_cpuid_max(0, 0) >= 7) {
+            // Check that XMM and YMM state are enabled in XCR0.
+            unsigned int xcr0lo, xcr0hi;
+            __asm__ __volatile__ ("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+            if ((xcr0lo & 0x06) == 0x06) {
+                __cpuid_count(7, 0, eax, ebx, ecx, edx);
+                if ((ebx & (1U << 5)) != 0)
+                    hasAvx2 = 1;
+            }
+        }
+    }
+    return hasAvx2 != 0;
+}
+
+// Returns true if the processor and operating system support AVX-512F.
+static inline bool cpuHasAvx512f()
+{
+    static int8_t hasAvx512f = -1;
+    if (hasAvx512f < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        hasAvx512f = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                (ecx & (1U << 27)) != 0 && __get_cpuid_max(0, 0) >= 7) {
+            // Check that XMM, YMM, opmask, and ZMM state are enabled in XCR0.
+            unsigned int xcr0lo, xcr0hi;
+            __asm__ __volatile__ ("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+            if ((xcr0lo & 0xE6) == 0xE6) {
+                __cpuid_count(7, 0, eax, ebx, ecx, edx);
+                if ((ebx & (1U << 16)) != 0)
+                    hasAvx512f = 1;
+            }
+        }
+    }
+    return hasAvx512f != 0;
+}
+
+// Returns true if the processor supports the AES-NI instructions.
+static inline bool cpuHasAesExt()
+{
+    static int8_t hasAesExt = -1;
+    if (hasAesExt < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        hasAesExt = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                (ecx & (1U << 25)) != 0 && (edx & (1U << 26)) != 0)
+            hasAesExt = 1;
+    }
+    return hasAesExt != 0;
+}
+
+#else
+
+#if CRYPTO_ARM_SHA_EXT
+static inline bool cpuHasShaExt()
+{
+    return true;
+}
+#endif
+
+#if CRYPTO_ARM_AES_EXT
+static inline bool cpuHasAesExt()
+{
+    return true;
+}
+#endif
+
+#endif
+
+#endif
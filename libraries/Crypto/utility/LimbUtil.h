@@ -40,6 +40,8 @@
 #define pgm_read_limb(x)    (pgm_read_word((x)))
 #elif BIGNUMBER_LIMB_32BIT
 #define pgm_read_limb(x)    (pgm_read_dword((x)))
+#elif BIGNUMBER_LIMB_64BIT
+#define pgm_read_limb(x)    (pgm_read_qword((x)))
 #endif
 
 // Expand a 32-bit value into a set of limbs depending upon the limb size.
@@ -56,4 +58,13 @@
 #define LIMB(value)     (value)
 #endif
 
+// Expand a pair of 32-bit values into a set of limbs.  The first value is
+// the least significant.  Constant tables use this form because a single
+// 32-bit value does not fill a 64-bit limb.
+#if BIGNUMBER_LIMB_64BIT
+#define LIMB_PAIR(x,y)  ((((uint64_t)(y)) << 32) | ((uint64_t)(x)))
+#else
+#define LIMB_PAIR(x,y)  LIMB((x)), LIMB((y))
+#endif
+
 #endif
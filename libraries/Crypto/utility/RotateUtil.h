@@ -32,7 +32,7 @@
 
 #if defined(__AVR__)
 #define CRYPTO_ROTATE32_COMPOSED 1
-#define CRYPTO_ROTATE64_COMPOSED 0
+#define CRYPTO_ROTATE64_COMPOSED 1
 #else
 #define CRYPTO_ROTATE32_COMPOSED 0
 #define CRYPTO_ROTATE64_COMPOSED 0
@@ -289,194 +289,371 @@
         (_temp >> (bits)) | (_temp << (64 - (bits))); \
     }))
 
+#if defined(__AVR__)
+
+// The building blocks for the composed rotations on AVR.  The word is split
+// into 32-bit halves so that inline assembly can address all eight bytes,
+// which turns rotations by a multiple of 8 bits into register moves.
+// The C shift operators would call out to libgcc for 64-bit operands.
+
+union rotate64_halves_t
+{
+    uint64_t q;
+    uint32_t w[2];
+};
+
+static inline uint64_t avrLeftRotate64_1(uint64_t x)
+{
+    rotate64_halves_t v;
+    v.q = x;
+    __asm__ (
+        "lsl %A0\n"
+        "rol %B0\n"
+        "rol %C0\n"
+        "rol %D0\n"
+        "rol %A1\n"
+        "rol %B1\n"
+        "rol %C1\n"
+        "rol %D1\n"
+        "adc %A0,__zero_reg__\n"
+        : "+r"(v.w[0]), "+r"(v.w[1])
+    );
+    return v.q;
+}
+
+static inline uint64_t avrRightRotate64_1(uint64_t x)
+{
+    rotate64_halves_t v;
+    v.q = x;
+    __asm__ (
+        "bst %A0,0\n"
+        "lsr %D1\n"
+        "ror %C1\n"
+        "ror %B1\n"
+        "ror %A1\n"
+        "ror %D0\n"
+        "ror %C0\n"
+        "ror %B0\n"
+        "ror %A0\n"
+        "bld %D1,7\n"
+        : "+r"(v.w[0]), "+r"(v.w[1])
+    );
+    return v.q;
+}
+
+static inline uint64_t avrLeftRotate64_8(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "mov %A0,%D3\n"
+        "mov %B0,%A2\n"
+        "mov %C0,%B2\n"
+        "mov %D0,%C2\n"
+        "mov %A1,%D2\n"
+        "mov %B1,%A3\n"
+        "mov %C1,%B3\n"
+        "mov %D1,%C3\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_16(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "movw %A0,%C3\n"
+        "movw %C0,%A2\n"
+        "movw %A1,%C2\n"
+        "movw %C1,%A3\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_24(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "mov %A0,%B3\n"
+        "mov %B0,%C3\n"
+        "mov %C0,%D3\n"
+        "mov %D0,%A2\n"
+        "mov %A1,%B2\n"
+        "mov %B1,%C2\n"
+        "mov %C1,%D2\n"
+        "mov %D1,%A3\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_32(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    out.w[0] = in.w[1];
+    out.w[1] = in.w[0];
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_40(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "mov %A0,%D2\n"
+        "mov %B0,%A3\n"
+        "mov %C0,%B3\n"
+        "mov %D0,%C3\n"
+        "mov %A1,%D3\n"
+        "mov %B1,%A2\n"
+        "mov %C1,%B2\n"
+        "mov %D1,%C2\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_48(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "movw %A0,%C2\n"
+        "movw %C0,%A3\n"
+        "movw %A1,%C3\n"
+        "movw %C1,%A2\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+static inline uint64_t avrLeftRotate64_56(uint64_t x)
+{
+    rotate64_halves_t in, out;
+    in.q = x;
+    __asm__ (
+        "mov %A0,%B2\n"
+        "mov %B0,%C2\n"
+        "mov %C0,%D2\n"
+        "mov %D0,%A3\n"
+        "mov %A1,%B3\n"
+        "mov %B1,%C3\n"
+        "mov %C1,%D3\n"
+        "mov %D1,%A2\n"
+        : "=&r"(out.w[0]), "=&r"(out.w[1])
+        : "r"(in.w[0]), "r"(in.w[1])
+    );
+    return out.q;
+}
+
+#define composedLeftRotate_64(a, bits)  (avrLeftRotate64_##bits((a)))
+#define composedRightRotate_64(a, bits) (avrRightRotate64_##bits((a)))
+
+#else
+
+#define composedLeftRotate_64(a, bits)  (leftRotate_64((a), (bits)))
+#define composedRightRotate_64(a, bits) (rightRotate_64((a), (bits)))
+
+#endif
+
 // Left rotate by 1.
-#define leftRotate1_64(a)  (leftRotate_64((a), 1))
+#define leftRotate1_64(a)  (composedLeftRotate_64((a), 1))
 
 // Left rotate by 2.
-#define leftRotate2_64(a)  (leftRotate_64(leftRotate_64((a), 1), 1))
+#define leftRotate2_64(a)  (composedLeftRotate_64(composedLeftRotate_64((a), 1), 1))
 
 // Left rotate by 3.
-#define leftRotate3_64(a)  (leftRotate_64(leftRotate_64(leftRotate_64((a), 1), 1), 1))
+#define leftRotate3_64(a)  (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 1), 1), 1))
 
 // Left rotate by 4.
-#define leftRotate4_64(a)  (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 1), 1), 1), 1))
+#define leftRotate4_64(a)  (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 1), 1), 1), 1))
 
 // Left rotate by 5: Rotate left by 8, then right by 3.
-#define leftRotate5_64(a)  (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 8), 1), 1), 1))
+#define leftRotate5_64(a)  (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 8), 1), 1), 1))
 
 // Left rotate by 6: Rotate left by 8, then right by 2.
-#define leftRotate6_64(a)  (rightRotate_64(rightRotate_64(leftRotate_64((a), 8), 1), 1))
+#define leftRotate6_64(a)  (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 8), 1), 1))
 
 // Left rotate by 7: Rotate left by 8, then right by 1.
-#define leftRotate7_64(a)  (rightRotate_64(leftRotate_64((a), 8), 1))
+#define leftRotate7_64(a)  (composedRightRotate_64(composedLeftRotate_64((a), 8), 1))
 
 // Left rotate by 8.
-#define leftRotate8_64(a)  (leftRotate_64((a), 8))
+#define leftRotate8_64(a)  (composedLeftRotate_64((a), 8))
 
 // Left rotate by 9: Rotate left by 8, then left by 1.
-#define leftRotate9_64(a)  (leftRotate_64(leftRotate_64((a), 8), 1))
+#define leftRotate9_64(a)  (composedLeftRotate_64(composedLeftRotate_64((a), 8), 1))
 
 // Left rotate by 10: Rotate left by 8, then left by 2.
-#define leftRotate10_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 8), 1), 1))
+#define leftRotate10_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 8), 1), 1))
 
 // Left rotate by 11: Rotate left by 8, then left by 3.
-#define leftRotate11_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 8), 1), 1), 1))
+#define leftRotate11_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 8), 1), 1), 1))
 
 // Left rotate by 12: Rotate left by 16, then right by 4.
-#define leftRotate12_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 16), 1), 1), 1), 1))
+#define leftRotate12_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 16), 1), 1), 1), 1))
 
 // Left rotate by 13: Rotate left by 16, then right by 3.
-#define leftRotate13_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 16), 1), 1), 1))
+#define leftRotate13_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 16), 1), 1), 1))
 
 // Left rotate by 14: Rotate left by 16, then right by 2.
-#define leftRotate14_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 16), 1), 1))
+#define leftRotate14_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 16), 1), 1))
 
 // Left rotate by 15: Rotate left by 16, then right by 1.
-#define leftRotate15_64(a) (rightRotate_64(leftRotate_64((a), 16), 1))
+#define leftRotate15_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 16), 1))
 
 // Left rotate by 16.
-#define leftRotate16_64(a) (leftRotate_64((a), 16))
+#define leftRotate16_64(a) (composedLeftRotate_64((a), 16))
 
 // Left rotate by 17: Rotate left by 16, then left by 1.
-#define leftRotate17_64(a) (leftRotate_64(leftRotate_64((a), 16), 1))
+#define leftRotate17_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 16), 1))
 
 // Left rotate by 18: Rotate left by 16, then left by 2.
-#define leftRotate18_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 16), 1), 1))
+#define leftRotate18_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 16), 1), 1))
 
 // Left rotate by 19: Rotate left by 16, then left by 3.
-#define leftRotate19_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 16), 1), 1), 1))
+#define leftRotate19_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 16), 1), 1), 1))
 
 // Left rotate by 20: Rotate left by 16, then left by 4.
-#define leftRotate20_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 16), 1), 1), 1), 1))
+#define leftRotate20_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 16), 1), 1), 1), 1))
 
 // Left rotate by 21: Rotate left by 24, then right by 3.
-#define leftRotate21_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 24), 1), 1), 1))
+#define leftRotate21_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 24), 1), 1), 1))
 
 // Left rotate by 22: Rotate left by 24, then right by 2.
-#define leftRotate22_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 24), 1), 1))
+#define leftRotate22_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 24), 1), 1))
 
 // Left rotate by 23: Rotate left by 24, then right by 1.
-#define leftRotate23_64(a) (rightRotate_64(leftRotate_64((a), 24), 1))
+#define leftRotate23_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 24), 1))
 
 // Left rotate by 24.
-#define leftRotate24_64(a) (leftRotate_64((a), 24))
+#define leftRotate24_64(a) (composedLeftRotate_64((a), 24))
 
 // Left rotate by 25: Rotate left by 24, then left by 1.
-#define leftRotate25_64(a) (leftRotate_64(leftRotate_64((a), 24), 1))
+#define leftRotate25_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 24), 1))
 
 // Left rotate by 26: Rotate left by 24, then left by 2.
-#define leftRotate26_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 24), 1), 1))
+#define leftRotate26_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 24), 1), 1))
 
 // Left rotate by 27: Rotate left by 24, then left by 3.
-#define leftRotate27_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 24), 1), 1), 1))
+#define leftRotate27_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 24), 1), 1), 1))
 
 // Left rotate by 28: Rotate left by 24, then left by 4.
-#define leftRotate28_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 24), 1), 1), 1), 1))
+#define leftRotate28_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 24), 1), 1), 1), 1))
 
 // Left rotate by 29: Rotate left by 32, then right by 3.
-#define leftRotate29_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 32), 1), 1), 1))
+#define leftRotate29_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 32), 1), 1), 1))
 
 // Left rotate by 30: Rotate left by 32, then right by 2.
-#define leftRotate30_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 32), 1), 1))
+#define leftRotate30_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 32), 1), 1))
 
 // Left rotate by 31: Rotate left by 32, then right by 1.
-#define leftRotate31_64(a) (rightRotate_64(leftRotate_64((a), 32), 1))
+#define leftRotate31_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 32), 1))
 
 // Left rotate by 32.
-#define leftRotate32_64(a) (leftRotate_64((a), 32))
+#define leftRotate32_64(a) (composedLeftRotate_64((a), 32))
 
 // Left rotate by 33: Rotate left by 32, then left by 1.
-#define leftRotate33_64(a) (leftRotate_64(leftRotate_64((a), 32), 1))
+#define leftRotate33_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 32), 1))
 
 // Left rotate by 34: Rotate left by 32, then left by 2.
-#define leftRotate34_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 32), 1), 1))
+#define leftRotate34_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 32), 1), 1))
 
 // Left rotate by 35: Rotate left by 32, then left by 3.
-#define leftRotate35_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 32), 1), 1), 1))
+#define leftRotate35_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 32), 1), 1), 1))
 
 // Left rotate by 36: Rotate left by 32, then left by 4.
-#define leftRotate36_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 32), 1), 1), 1), 1))
+#define leftRotate36_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 32), 1), 1), 1), 1))
 
 // Left rotate by 37: Rotate left by 40, then right by 3.
-#define leftRotate37_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 40), 1), 1), 1))
+#define leftRotate37_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 40), 1), 1), 1))
 
 // Left rotate by 38: Rotate left by 40, then right by 2.
-#define leftRotate38_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 40), 1), 1))
+#define leftRotate38_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 40), 1), 1))
 
 // Left rotate by 39: Rotate left by 40, then right by 1.
-#define leftRotate39_64(a) (rightRotate_64(leftRotate_64((a), 40), 1))
+#define leftRotate39_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 40), 1))
 
 // Left rotate by 40.
-#define leftRotate40_64(a) (leftRotate_64((a), 40))
+#define leftRotate40_64(a) (composedLeftRotate_64((a), 40))
 
 // Left rotate by 41: Rotate left by 40, then left by 1.
-#define leftRotate41_64(a) (leftRotate_64(leftRotate_64((a), 40), 1))
+#define leftRotate41_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 40), 1))
 
 // Left rotate by 42: Rotate left by 40, then left by 2.
-#define leftRotate42_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 40), 1), 1))
+#define leftRotate42_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 40), 1), 1))
 
 // Left rotate by 43: Rotate left by 40, then left by 3.
-#define leftRotate43_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 40), 1), 1), 1))
+#define leftRotate43_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 40), 1), 1), 1))
 
 // Left rotate by 44: Rotate left by 40, then left by 4.
-#define leftRotate44_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 40), 1), 1), 1), 1))
+#define leftRotate44_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 40), 1), 1), 1), 1))
 
 // Left rotate by 45: Rotate left by 48, then right by 3.
-#define leftRotate45_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 48), 1), 1), 1))
+#define leftRotate45_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 48), 1), 1), 1))
 
 // Left rotate by 46: Rotate left by 48, then right by 2.
-#define leftRotate46_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 48), 1), 1))
+#define leftRotate46_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 48), 1), 1))
 
 // Left rotate by 47: Rotate left by 48, then right by 1.
-#define leftRotate47_64(a) (rightRotate_64(leftRotate_64((a), 48), 1))
+#define leftRotate47_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 48), 1))
 
 // Left rotate by 48.
-#define leftRotate48_64(a) (leftRotate_64((a), 48))
+#define leftRotate48_64(a) (composedLeftRotate_64((a), 48))
 
 // Left rotate by 49: Rotate left by 48, then left by 1.
-#define leftRotate49_64(a) (leftRotate_64(leftRotate_64((a), 48), 1))
+#define leftRotate49_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 48), 1))
 
 // Left rotate by 50: Rotate left by 48, then left by 2.
-#define leftRotate50_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 48), 1), 1))
+#define leftRotate50_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 48), 1), 1))
 
 // Left rotate by 51: Rotate left by 48, then left by 3.
-#define leftRotate51_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 48), 1), 1), 1))
+#define leftRotate51_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 48), 1), 1), 1))
 
 // Left rotate by 52: Rotate left by 48, then left by 4.
-#define leftRotate52_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 48), 1), 1), 1), 1))
+#define leftRotate52_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 48), 1), 1), 1), 1))
 
 // Left rotate by 53: Rotate left by 56, then right by 3.
-#define leftRotate53_64(a) (rightRotate_64(rightRotate_64(rightRotate_64(leftRotate_64((a), 56), 1), 1), 1))
+#define leftRotate53_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 56), 1), 1), 1))
 
 // Left rotate by 54: Rotate left by 56, then right by 2.
-#define leftRotate54_64(a) (rightRotate_64(rightRotate_64(leftRotate_64((a), 56), 1), 1))
+#define leftRotate54_64(a) (composedRightRotate_64(composedRightRotate_64(composedLeftRotate_64((a), 56), 1), 1))
 
 // Left rotate by 55: Rotate left by 56, then right by 1.
-#define leftRotate55_64(a) (rightRotate_64(leftRotate_64((a), 56), 1))
+#define leftRotate55_64(a) (composedRightRotate_64(composedLeftRotate_64((a), 56), 1))
 
 // Left rotate by 56.
-#define leftRotate56_64(a) (leftRotate_64((a), 56))
+#define leftRotate56_64(a) (composedLeftRotate_64((a), 56))
 
 // Left rotate by 57: Rotate left by 56, then left by 1.
-#define leftRotate57_64(a) (leftRotate_64(leftRotate_64((a), 56), 1))
+#define leftRotate57_64(a) (composedLeftRotate_64(composedLeftRotate_64((a), 56), 1))
 
 // Left rotate by 58: Rotate left by 56, then left by 2.
-#define leftRotate58_64(a) (leftRotate_64(leftRotate_64(leftRotate_64((a), 56), 1), 1))
+#define leftRotate58_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 56), 1), 1))
 
 // Left rotate by 59: Rotate left by 56, then left by 3.
-#define leftRotate59_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 56), 1), 1), 1))
+#define leftRotate59_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 56), 1), 1), 1))
 
 // Left rotate by 60: Rotate left by 60, then left by 4.
-#define leftRotate60_64(a) (leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64(leftRotate_64((a), 56), 1), 1), 1), 1))
+#define leftRotate60_64(a) (composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64(composedLeftRotate_64((a), 56), 1), 1), 1), 1))
 
 // Left rotate by 61: Rotate right by 3.
-#define leftRotate61_64(a) (rightRotate_64(rightRotate_64(rightRotate_64((a), 1), 1), 1))
+#define leftRotate61_64(a) (composedRightRotate_64(composedRightRotate_64(composedRightRotate_64((a), 1), 1), 1))
 
 // Left rotate by 62: Rotate right by 2.
-#define leftRotate62_64(a) (rightRotate_64(rightRotate_64((a), 1), 1))
+#define leftRotate62_64(a) (composedRightRotate_64(composedRightRotate_64((a), 1), 1))
 
 // Left rotate by 63: Rotate right by 1.
-#define leftRotate63_64(a) (rightRotate_64((a), 1))
+#define leftRotate63_64(a) (composedRightRotate_64((a), 1))
 
 // Define the 64-bit right rotations in terms of left rotations.
 #define rightRotate1_64(a)  (leftRotate63_64((a)))
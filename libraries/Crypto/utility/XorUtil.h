@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_XORUTIL_H
+#define CRYPTO_XORUTIL_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+// Helpers for XOR'ing keystream and chaining values into data buffers.
+// On 8-bit AVR these are simple byte loops.  Elsewhere the bulk of the
+// data is processed a word at a time, or 16 bytes at a time with SSE2 or
+// NEON, with bytes only handled at the edges.  Copying and zeroing are
+// left to memcpy() and memset(), which are already word-wise.
+
+#if !defined(CRYPTO_XOR_SIMD)
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define CRYPTO_XOR_SIMD 1
+#else
+#define CRYPTO_XOR_SIMD 0
+#endif
+#endif
+#if CRYPTO_XOR_SIMD
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
+#if !defined(__AVR__)
+
+#if defined(__x86_64__) || defined(__aarch64__)
+typedef uint64_t xor_word_t;
+#else
+typedef uint32_t xor_word_t;
+#endif
+
+// Can word accesses be performed on unaligned addresses?
+#if !defined(CRYPTO_XOR_UNALIGNED)
+#if defined(__i386__) || defined(__x86_64__) || defined(__aarch64__) || \
+    defined(__ARM_FEATURE_UNALIGNED)
+#define CRYPTO_XOR_UNALIGNED 1
+#else
+#define CRYPTO_XOR_UNALIGNED 0
+#endif
+#endif
+
+// Aligned word accesses go via a type that may alias the byte buffers.
+#if defined(__GNUC__)
+typedef xor_word_t __attribute__((__may_alias__)) xor_alias_t;
+#else
+typedef xor_word_t xor_alias_t;
+#endif
+
+// Loads and stores words, which are aligned if the CPU needs them to be.
+static inline xor_word_t xorLoadWord(const uint8_t *p)
+{
+#if CRYPTO_XOR_UNALIGNED
+    xor_word_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+#else
+    return *((const xor_alias_t *)p);
+#endif
+}
+static inline void xorStoreWord(uint8_t *p, xor_word_t x)
+{
+#if CRYPTO_XOR_UNALIGNED
+    memcpy(p, &x, sizeof(x));
+#else
+    *((xor_alias_t *)p) = x;
+#endif
+}
+
+// Determines if three buffers can be processed a word at a time after
+// an initial run of "head" bytes, which is set to the number of bytes
+// required to align the buffers.
+static inline bool xorWordsOK(const uint8_t *a, const uint8_t *b,
+                              const uint8_t *c, size_t &head)
+{
+#if CRYPTO_XOR_UNALIGNED
+    (void)a;
+    (void)b;
+    (void)c;
+    head = 0;
+    return true;
+#else
+    const uintptr_t m = sizeof(xor_word_t) - 1;
+    if ((((uintptr_t)a ^ (uintptr_t)b) | ((uintptr_t)a ^ (uintptr_t)c)) & m)
+        return false;
+    head = (sizeof(xor_word_t) - ((uintptr_t)a & m)) & m;
+    return true;
+#endif
+}
+
+#endif // !__AVR__
+
+// dest = a ^ b.  The buffers may be identical but must not otherwise overlap.
+static inline void xorBytes(uint8_t *dest, const uint8_t *a,
+                            const uint8_t *b, size_t len)
+{
+#if CRYPTO_XOR_SIMD
+    while (len >= 16) {
+#if defined(__SSE2__)
+        __m128i x = _mm_loadu_si128((const __m128i *)a);
+        __m128i y = _mm_loadu_si128((const __m128i *)b);
+        _mm_storeu_si128((__m128i *)dest, _mm_xor_si128(x, y));
+#else
+        vst1q_u8(dest, veorq_u8(vld1q_u8(a), vld1q_u8(b)));
+#endif
+        dest += 16;
+        a += 16;
+        b += 16;
+        len -= 16;
+    }
+#endif
+#if !defined(__AVR__)
+    size_t head;
+    if (len >= sizeof(xor_word_t) && xorWordsOK(dest, a, b, head)) {
+        for (; head > 0 && len > 0; --head, --len)
+            *dest++ = *a++ ^ *b++;
+        while (len >= sizeof(xor_word_t)) {
+            xorStoreWord(dest, xorLoadWord(a) ^ xorLoadWord(b));
+            dest += sizeof(xor_word_t);
+            a += sizeof(xor_word_t);
+            b += sizeof(xor_word_t);
+            len -= sizeof(xor_word_t);
+        }
+    }
+#endif
+    while (len > 0) {
+        *dest++ = *a++ ^ *b++;
+        --len;
+    }
+}
+
+// dest ^= src.
+static inline void xorBytesInPlace(uint8_t *dest, const uint8_t *src, size_t len)
+{
+    xorBytes(dest, dest, src, len);
+}
+
+// Feedback for CFB encryption: state ^= src; dest = state.
+static inline void xorBytesFeedback(uint8_t *dest, uint8_t *state,
+                                    const uint8_t *src, size_t len)
+{
+#if !defined(__AVR__)
+    size_t head;
+    if (len >= sizeof(xor_word_t) && xorWordsOK(dest, state, src, head)) {
+        for (; head > 0 && len > 0; --head, --len) {
+            *state ^= *src++;
+            *dest++ = *state++;
+        }
+        while (len >= sizeof(xor_word_t)) {
+            xor_word_t x = xorLoadWord(state) ^ xorLoadWord(src);
+            xorStoreWord(state, x);
+            xorStoreWord(dest, x);
+            dest += sizeof(xor_word_t);
+            state += sizeof(xor_word_t);
+            src += sizeof(xor_word_t);
+            len -= sizeof(xor_word_t);
+        }
+    }
+#endif
+    while (len > 0) {
+        *state ^= *src++;
+        *dest++ = *state++;
+        --len;
+    }
+}
+
+// Chaining for CFB decryption: dest = state ^ src; state = src.
+// The "dest" and "src" buffers may be identical.
+static inline void xorBytesChain(uint8_t *dest, uint8_t *state,
+                                 const uint8_t *src, size_t len)
+{
+#if !defined(__AVR__)
+    size_t head;
+    if (len >= sizeof(xor_word_t) && xorWordsOK(dest, state, src, head)) {
+        for (; head > 0 && len > 0; --head, --len) {
+            uint8_t in = *src++;
+            *dest++ = *state ^ in;
+            *state++ = in;
+        }
+        while (len >= sizeof(xor_word_t)) {
+            xor_word_t in = xorLoadWord(src);
+            xorStoreWord(dest, xorLoadWord(state) ^ in);
+            xorStoreWord(state, in);
+            dest += sizeof(xor_word_t);
+            state += sizeof(xor_word_t);
+            src += sizeof(xor_word_t);
+            len -= sizeof(xor_word_t);
+        }
+    }
+#endif
+    while (len > 0) {
+        uint8_t in = *src++;
+        *dest++ = *state ^ in;
+        *state++ = in;
+        --len;
+    }
+}
+
+#endif
@@ -40,6 +40,27 @@
  * \sa DMD
  */
 
+/**
+ * \class StaticBitmap Bitmap.h <Bitmap.h>
+ * \brief Bitmap whose memory is allocated statically at compile time.
+ *
+ * The \a Width and \a Height template parameters give the size of the
+ * bitmap in pixels.  The pixel data is stored within the object itself
+ * rather than on the heap, so a global StaticBitmap is accounted for by
+ * the linker and is always valid:
+ *
+ * \code
+ * StaticBitmap<32, 16> bitmap;
+ * \endcode
+ *
+ * \sa Bitmap
+ */
+
+/**
+ * \fn StaticBitmap::StaticBitmap()
+ * \brief Constructs a new static bitmap and clears it to \ref Bitmap::Black.
+ */
+
 /**
  * \typedef Bitmap::Color
  * \brief Type that represents the color of a pixel in a bitmap.
@@ -83,19 +104,39 @@
  * \brief Constructs a new in-memory bitmap that is \a width x \a height
  * pixels in size.
  *
- * \sa width(), height(), isValid()
+ * If \a buffer is NULL, then the memory for the bitmap is allocated from
+ * the heap.  Otherwise \a buffer must point to at least
+ * BITMAP_BUFFER_SIZE(\a width, \a height) bytes of memory that will be
+ * used for the bitmap until it is destroyed.  A statically allocated
+ * buffer avoids fragmenting the heap and makes the memory usage known
+ * at link time:
+ *
+ * \code
+ * uint8_t buffer[BITMAP_BUFFER_SIZE(32, 16)];
+ * Bitmap bitmap(32, 16, buffer);
+ * \endcode
+ *
+ * The StaticBitmap template can be used to declare the bitmap and its
+ * buffer in one step.  The buffer is cleared to \ref Black in either case.
+ *
+ * \sa width(), height(), isValid(), StaticBitmap
  */
-Bitmap::Bitmap(int width, int height)
+Bitmap::Bitmap(int width, int height, uint8_t *buffer)
     : _width(width)
     , _height(height)
     , _stride((width + 7) / 8)
-    , fb(0)
+    , fb(buffer)
+    , ownBuffer(buffer == 0)
     , _font(0)
     , _textColor(White)
+    , _dirtyTop(0)
+    , _dirtyBottom(height - 1)
 {
-    // Allocate memory for the framebuffer and clear it (1 = pixel off).
+    // Allocate memory for the framebuffer if necessary and clear it
+    // (1 = pixel off).
     unsigned int size = _stride * _height;
-    fb = (uint8_t *)malloc(size);
+    if (!fb)
+        fb = (uint8_t *)malloc(size);
     if (fb)
         memset(fb, 0xFF, size);
 }
@@ -105,7 +146,7 @@ Bitmap::Bitmap(int width, int height)
  */
 Bitmap::~Bitmap()
 {
-    if (fb)
+    if (fb && ownBuffer)
         free(fb);
 }
 
@@ -178,6 +219,7 @@ void Bitmap::clear(Color color)
         memset(fb, 0xFF, size);
     else
         memset(fb, 0x00, size);
+    markDirty();
 }
 
 /**
@@ -210,6 +252,10 @@ void Bitmap::setPixel(int x, int y, Color color)
     if (((unsigned int)x) >= ((unsigned int)_width) ||
             ((unsigned int)y) >= ((unsigned int)_height))
         return;     // Pixel is off-screen.
+    if (y < _dirtyTop)
+        _dirtyTop = y;
+    if (y > _dirtyBottom)
+        _dirtyBottom = y;
     uint8_t *ptr = fb + y * _stride + (x >> 3);
     if (color)
         *ptr &= ~(((uint8_t)0x80) >> (x & 0x07));
@@ -224,6 +270,34 @@ void Bitmap::setPixel(int x, int y, Color color)
  */
 void Bitmap::drawLine(int x1, int y1, int x2, int y2, Color color)
 {
+    // Horizontal and vertical lines can be clipped and drawn directly.
+    if (y1 == y2) {
+        drawSpan(x1, x2, y1, color);
+        return;
+    }
+    if (x1 == x2) {
+        if (((unsigned int)x1) >= ((unsigned int)_width))
+            return;
+        if (y1 > y2) {
+            int temp = y1;
+            y1 = y2;
+            y2 = temp;
+        }
+        if (y1 < 0)
+            y1 = 0;
+        if (y2 >= _height)
+            y2 = _height - 1;
+        if (y1 > y2)
+            return;
+        markDirty(y1, y2);
+        uint8_t *ptr = fb + y1 * _stride + (x1 >> 3);
+        uint8_t mask = ((uint8_t)0x80) >> (x1 & 0x07);
+        uint8_t value = color ? 0x00 : 0xFF;
+        for (int y = y1; y <= y2; ++y, ptr += _stride)
+            *ptr = (*ptr & ~mask) | (value & mask);
+        return;
+    }
+
     // Midpoint line scan-conversion algorithm from "Computer Graphics:
     // Principles and Practice", Second Edition, Foley, van Dam, et al.
     int dx = x2 - x1;
@@ -242,6 +316,77 @@ void Bitmap::drawLine(int x1, int y1, int x2, int y2, Color color)
     } else {
         ystep = 1;
     }
+
+    // If the line is entirely on-screen, then step a byte pointer and mask
+    // along it rather than computing the address of every pixel.
+    if (((unsigned int)x1) < ((unsigned int)_width) &&
+            ((unsigned int)x2) < ((unsigned int)_width) &&
+            ((unsigned int)y1) < ((unsigned int)_height) &&
+            ((unsigned int)y2) < ((unsigned int)_height)) {
+        markDirty(y1, y2);
+        uint8_t *ptr = fb + y1 * _stride + (x1 >> 3);
+        uint8_t mask = ((uint8_t)0x80) >> (x1 & 0x07);
+        uint8_t value = color ? 0x00 : 0xFF;
+        int rowStep = (ystep > 0) ? _stride : -_stride;
+        int count;
+        *ptr = (*ptr & ~mask) | (value & mask);
+        if (dx >= dy) {
+            d = 2 * dy - dx;
+            incrE = 2 * dy;
+            incrNE = 2 * (dy - dx);
+            for (count = dx; count > 0; --count) {
+                if (d <= 0) {
+                    d += incrE;
+                } else {
+                    d += incrNE;
+                    ptr += rowStep;
+                }
+                if (xstep > 0) {
+                    mask >>= 1;
+                    if (!mask) {
+                        mask = 0x80;
+                        ++ptr;
+                    }
+                } else {
+                    mask <<= 1;
+                    if (!mask) {
+                        mask = 0x01;
+                        --ptr;
+                    }
+                }
+                *ptr = (*ptr & ~mask) | (value & mask);
+            }
+        } else {
+            d = 2 * dx - dy;
+            incrE = 2 * dx;
+            incrNE = 2 * (dx - dy);
+            for (count = dy; count > 0; --count) {
+                if (d <= 0) {
+                    d += incrE;
+                } else {
+                    d += incrNE;
+                    if (xstep > 0) {
+                        mask >>= 1;
+                        if (!mask) {
+                            mask = 0x80;
+                            ++ptr;
+                        }
+                    } else {
+                        mask <<= 1;
+                        if (!mask) {
+                            mask = 0x01;
+                            --ptr;
+                        }
+                    }
+                }
+                ptr += rowStep;
+                *ptr = (*ptr & ~mask) | (value & mask);
+            }
+        }
+        return;
+    }
+
+    // Partially off-screen: let setPixel() clip each point.
     if (dx >= dy) {
         d = 2 * dy - dx;
         incrE = 2 * dy;
@@ -371,6 +516,82 @@ void Bitmap::drawCircle(int centerX, int centerY, int radius, Color borderColor,
  * \sa drawCircle(), drawFilledRect()
  */
 
+// Copies "count" pixels between two rows of packed pixel data, starting
+// at bit offset "dstBit" in "dst" and "srcBit" in "src".  The copy is
+// performed in a direction that is safe if the two spans overlap.
+static void copyBits(uint8_t *dst, int dstBit, const uint8_t *src, int srcBit, int count)
+{
+    dst += dstBit >> 3;
+    dstBit &= 7;
+    src += srcBit >> 3;
+    srcBit &= 7;
+    int last = (dstBit + count - 1) >> 3;
+    int srcLast = (srcBit + count - 1) >> 3;
+    uint8_t firstMask = 0xFF >> dstBit;
+    uint8_t lastMask = 0xFF << (7 - ((dstBit + count - 1) & 7));
+    if (!last)
+        firstMask &= lastMask;
+
+    // If the bit offsets are the same, then only the partial bytes at
+    // either end need masking and the middle can be moved as a block.
+    if (dstBit == srcBit) {
+        uint8_t first = (dst[0] & ~firstMask) | (src[0] & firstMask);
+        if (last) {
+            uint8_t end = (dst[last] & ~lastMask) | (src[last] & lastMask);
+            memmove(dst + 1, src + 1, last - 1);
+            dst[last] = end;
+        }
+        dst[0] = first;
+        return;
+    }
+
+    // Shift each destination byte's worth of pixels out of the two source
+    // bytes that it straddles.  Source bytes outside the span only supply
+    // bits that are masked off, so they are never read.
+    int shift = srcBit - dstBit;
+    bool backwards = (dst > src || (dst == src && shift < 0));
+    int index = backwards ? last : 0;
+    int step = backwards ? -1 : 1;
+    for (int n = last; n >= 0; --n, index += step) {
+        uint8_t value;
+        if (shift > 0) {
+            value = src[index] << shift;
+            if (index < srcLast)
+                value |= src[index + 1] >> (8 - shift);
+        } else {
+            value = 0;
+            if (index > 0)
+                value = src[index - 1] << (8 + shift);
+            if (index <= srcLast)
+                value |= src[index] >> -shift;
+        }
+        uint8_t mask = 0xFF;
+        if (index == 0)
+            mask = firstMask;
+        else if (index == last)
+            mask = lastMask;
+        dst[index] = (dst[index] & ~mask) | (value & mask);
+    }
+}
+
+// Fills "count" pixels of a row of packed pixel data with the byte
+// "value", starting at bit offset "bit".
+static void fillBits(uint8_t *row, int bit, int count, uint8_t value)
+{
+    row += bit >> 3;
+    bit &= 7;
+    int last = (bit + count - 1) >> 3;
+    uint8_t firstMask = 0xFF >> bit;
+    uint8_t lastMask = 0xFF << (7 - ((bit + count - 1) & 7));
+    if (!last) {
+        firstMask &= lastMask;
+    } else {
+        memset(row + 1, value, last - 1);
+        row[last] = (row[last] & ~lastMask) | (value & lastMask);
+    }
+    row[0] = (row[0] & ~firstMask) | (value & firstMask);
+}
+
 /**
  * \brief Draws \a bitmap at (\a x, \a y) in \a color.
  *
@@ -420,7 +641,10 @@ void Bitmap::drawBitmap(int x, int y, const Bitmap &bitmap, Color color)
  * 0 in the \a bitmap are drawn with the inverse of \a color.  The pixel at
  * (\a x, \a y) will be the top-left corner of the drawn image.
  *
- * \sa drawInvertedBitmap(), fill()
+ * The \c gendither tool in the \c gen directory converts greyscale and
+ * color images into this format.
+ *
+ * \sa drawInvertedBitmap(), fill(), Dither
  */
 void Bitmap::drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color)
 {
@@ -447,6 +671,84 @@ void Bitmap::drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color)
     }
 }
 
+/**
+ * \brief Draws the run-length encoded \a bitmap at (\a x, \a y) in \a color.
+ *
+ * The \a bitmap must point to program memory.  The first two bytes are the
+ * width and height of the bitmap in pixels.  The rest of the data is a
+ * sequence of 4-bit run lengths, high nibble first, that describe the
+ * pixels from left to right and top to bottom, continuing from the end of
+ * one line onto the start of the next.  The runs alternate between 0 and
+ * 1 pixels, starting with 0.  A run length of 15 indicates 15 pixels
+ * that are followed by another run of the same value.
+ *
+ * Pixels that are 1 in the \a bitmap are drawn with \a color.  Pixels that
+ * are 0 in the \a bitmap are drawn with the inverse of \a color.  The pixel
+ * at (\a x, \a y) will be the top-left corner of the drawn image.
+ *
+ * The runs are decoded straight into the bitmap with one masked fill per
+ * run, so a compressed image is usually quicker to draw than the same
+ * image with drawBitmap().  The \c genrle tool in the \c gen directory
+ * converts PBM images into this format.
+ *
+ * \sa drawBitmap()
+ */
+void Bitmap::drawRLEBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color)
+{
+    uint8_t w = pgm_read_byte(bitmap);
+    uint8_t h = pgm_read_byte(bitmap + 1);
+    const uint8_t *data = ((const uint8_t *)bitmap) + 2;
+    uint8_t fgValue = color ? 0x00 : 0xFF;
+    bool foreground = false;
+    bool highNibble = true;
+    uint8_t bx = 0;
+    uint8_t by = 0;
+    if (!w || !h)
+        return;
+    markDirty(y, y + h - 1);
+    while (by < h) {
+        // Fetch the next run length.
+        uint8_t run;
+        if (highNibble) {
+            run = pgm_read_byte(data) >> 4;
+        } else {
+            run = pgm_read_byte(data) & 0x0F;
+            ++data;
+        }
+        highNibble = !highNibble;
+        uint8_t nextRun = run;
+
+        // Fill the run, which may wrap onto following lines.
+        uint8_t value = foreground ? fgValue : ~fgValue;
+        while (run > 0 && by < h) {
+            uint8_t span = w - bx;
+            if (span > run)
+                span = run;
+            int py = y + by;
+            if (py >= 0 && py < _height) {
+                int px = x + bx;
+                int count = span;
+                if (px < 0) {
+                    count += px;
+                    px = 0;
+                }
+                if ((px + count) > _width)
+                    count = _width - px;
+                if (count > 0)
+                    fillBits(fb + py * _stride, px, count, value);
+            }
+            bx += span;
+            run -= span;
+            if (bx >= w) {
+                bx = 0;
+                ++by;
+            }
+        }
+        if (nextRun != 15)
+            foreground = !foreground;
+    }
+}
+
 /**
  * \fn void Bitmap::drawInvertedBitmap(int x, int y, const Bitmap &bitmap)
  * \brief Draws \a bitmap at (\a x, \a y) in inverted colors.
@@ -474,22 +776,6 @@ void Bitmap::drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color)
  * \sa setFont(), drawText(), drawChar(), charWidth()
  */
 
-/**
- * \fn void Bitmap::setFont(Font font)
- * \brief Sets the \a font for use with drawText() and drawChar().
- *
- * \code
- * #include <DejaVuSans9.h>
- *
- * display.setFont(DejaVuSans9);
- * display.drawText(0, 0, "Hello");
- * \endcode
- *
- * New fonts can be generated with <a href="https://code.google.com/p/glcd-arduino/downloads/detail?name=GLCDFontCreator2.zip&can=2&q=">GLCDFontCreator2</a>.
- *
- * \sa font(), drawText(), drawChar()
- */
-
 /**
  * \fn Color Bitmap::textColor() const
  * \brief Returns the color that will be used for drawing text with
@@ -508,11 +794,49 @@ void Bitmap::drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color)
 
 #define fontIsFixed(font)   (pgm_read_byte((font)) == 0 && \
                              pgm_read_byte((font) + 1) == 0)
+#define fontIsIndexed(font) (pgm_read_byte((font)) == 0 && \
+                             pgm_read_byte((font) + 1) == 1)
 #define fontWidth(font)     (pgm_read_byte((font) + 2))
 #define fontHeight(font)    (pgm_read_byte((font) + 3))
 #define fontFirstChar(font) (pgm_read_byte((font) + 4))
 #define fontCharCount(font) (pgm_read_byte((font) + 5))
 
+/**
+ * \brief Sets the \a font for use with drawText() and drawChar().
+ *
+ * \code
+ * #include <DejaVuSans9.h>
+ *
+ * display.setFont(DejaVuSans9);
+ * display.drawText(0, 0, "Hello");
+ * \endcode
+ *
+ * New fonts can be generated with <a href="https://code.google.com/p/glcd-arduino/downloads/detail?name=GLCDFontCreator2.zip&can=2&q=">GLCDFontCreator2</a>
+ * or compiled from BDF bitmap fonts with the \c genfont utility in the
+ * \c gen directory.  Fonts from \c genfont include a table of glyph
+ * offsets, so drawChar() can find any character directly instead of
+ * walking the table of character widths.
+ *
+ * \sa font(), drawText(), drawChar()
+ */
+void Bitmap::setFont(Font font)
+{
+    _font = font;
+    if (font && !fontIsFixed(font) && !fontIsIndexed(font)) {
+        // Record the offset of the image for every 16th character in a
+        // variable-width font so that drawChar() does not need to walk
+        // the width table from the start for every character.
+        uint8_t count = fontCharCount(font);
+        uint8_t heightBytes = (fontHeight(font) + 7) >> 3;
+        uint16_t offset = 6 + count;
+        for (uint8_t index = 0; index < count; ++index) {
+            if (!(index & 0x0F) && (index >> 4) < BITMAP_GLYPH_INDEX_SIZE)
+                glyphIndex[index >> 4] = offset;
+            offset += pgm_read_byte(font + 6 + index) * heightBytes;
+        }
+    }
+}
+
 /**
  * \brief Draws the \a len characters of \a str at (\a x, \a y).
  *
@@ -605,18 +929,69 @@ int Bitmap::drawChar(int x, int y, char ch)
         // Fixed-width font.
         width = fontWidth(_font);
         image = ((const uint8_t *)_font) + 6 + index * heightBytes * width;
+    } else if (fontIsIndexed(_font)) {
+        // Variable-width font with a glyph offset table after the widths.
+        width = pgm_read_byte(_font + 6 + index);
+        const uint8_t *entry = ((const uint8_t *)_font) + 6 + count + index * 2;
+        image = ((const uint8_t *)_font) +
+                (pgm_read_byte(entry) | (pgm_read_byte(entry + 1) << 8));
     } else {
         // Variable-width font.
         width = pgm_read_byte(_font + 6 + index);
-        image = ((const uint8_t *)_font) + 6 + count;
-        for (uint8_t temp = 0; temp < index; ++temp) {
-            // Scan through all previous characters to find the starting
-            // location for this one.
+        uint8_t slot = index >> 4;
+        if (slot >= BITMAP_GLYPH_INDEX_SIZE)
+            slot = BITMAP_GLYPH_INDEX_SIZE - 1;
+        image = ((const uint8_t *)_font) + glyphIndex[slot];
+        for (uint8_t temp = slot << 4; temp < index; ++temp) {
+            // Scan through the previous characters since the last indexed
+            // one to find the starting location for this one.
             image += pgm_read_byte(_font + 6 + temp) * heightBytes;
         }
     }
     if ((x + width) <= 0 || (y + height) <= 0)
         return width;   // Character is off the top or left of the screen.
+    // Each byte of the glyph image is 8 vertical pixels of one column.
+    // If the glyph fits vertically, then write the columns straight into
+    // the framebuffer by stepping down a row at a time with a bit mask.
+    int rows = (heightBytes > 1 || height >= 8) ? height : height + 1;
+    if (y >= 0 && (y + rows) <= _height) {
+        if (x >= _width)
+            return width;
+        markDirty(y, y + rows - 1);
+        for (uint8_t cx = 0; cx < width; ++cx) {
+            int px = x + cx;
+            if (px < 0)
+                continue;
+            if (px >= _width)
+                break;
+            uint8_t *column = fb + y * _stride + (px >> 3);
+            uint8_t mask = ((uint8_t)0x80) >> (px & 0x07);
+            uint8_t fgBits = _textColor ? 0 : mask;
+            uint8_t bgBits = _textColor ? mask : 0;
+            for (uint8_t cy = 0; cy < heightBytes; ++cy) {
+                uint8_t value = pgm_read_byte(image + cy * width + cx);
+                int posn;
+                uint8_t bit;
+                if (heightBytes > 1 && cy == (heightBytes - 1)) {
+                    posn = height - 8;
+                    bit = cy * 8 - posn;
+                    value >>= bit;
+                } else {
+                    posn = cy * 8;
+                    bit = 0;
+                }
+                uint8_t *ptr = column + (posn + bit) * _stride;
+                for (; bit < 8 && (posn + bit) < rows; ++bit) {
+                    *ptr = (*ptr & ~mask) | ((value & 0x01) ? fgBits : bgBits);
+                    value >>= 1;
+                    ptr += _stride;
+                }
+            }
+        }
+        return width;
+    }
+
+    // The glyph is partially off the top or bottom, so plot each pixel.
     Color invColor = !_textColor;
     for (uint8_t cx = 0; cx < width; ++cx) {
         for (uint8_t cy = 0; cy < heightBytes; ++cy) {
@@ -741,8 +1116,8 @@ void Bitmap::copy(int x, int y, int width, int height, Bitmap *dest, int destX,
         // Copying to within the same bitmap, so copy in a direction
         // that will prevent problems with overlap.
         blit(x, y, x + width - 1, y + height - 1, destX, destY);
-    } else {
-        // Copying to a different bitmap.
+    } else if (!copyRegion(x, y, width, height, dest, destX, destY)) {
+        // Part of the source is off-screen, so copy pixel by pixel.
         while (height > 0) {
             for (int tempx = 0; tempx < width; ++tempx)
                 dest->setPixel(destX + tempx, destY, pixel(x + tempx, y));
@@ -761,10 +1136,29 @@ void Bitmap::copy(int x, int y, int width, int height, Bitmap *dest, int destX,
  */
 void Bitmap::fill(int x, int y, int width, int height, Color color)
 {
+    // Clamp the fill region to the extents of the bitmap.
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if ((x + width) > _width)
+        width = _width - x;
+    if ((y + height) > _height)
+        height = _height - y;
+    if (width <= 0 || height <= 0)
+        return;
+
+    // Fill whole bytes at a time, masking the partial bytes at either end.
+    uint8_t value = color ? 0x00 : 0xFF;
+    uint8_t *row = fb + y * _stride;
+    markDirty(y, y + height - 1);
     while (height > 0) {
-        for (int temp = 0; temp < width; ++temp)
-            setPixel(x + temp, y, color);
-        ++y;
+        fillBits(row, x, width, value);
+        row += _stride;
         --height;
     }
 }
@@ -860,15 +1254,25 @@ void Bitmap::scroll(int x, int y, int width, int height, int dx, int dy, Color f
     if (width <= 0 || height <= 0)
         return;
 
+    // Scrolling by more than the region size uncovers the whole region.
+    if (dx > width)
+        dx = width;
+    else if (dx < -width)
+        dx = -width;
+    if (dy > height)
+        dy = height;
+    else if (dy < -height)
+        dy = -height;
+
     // Scroll the region in the specified direction.
     if (dy < 0) {
         if (dx < 0)
-            blit(x - dx, y - dy, x + width - 1 + dx, y + height - 1 + dy, x, y);
+            blit(x - dx, y - dy, x + width - 1, y + height - 1, x, y);
         else
-            blit(x, y - dy, x + width - 1 - dx, y + height - 1 + dy, x + dx, y);
+            blit(x, y - dy, x + width - 1 - dx, y + height - 1, x + dx, y);
     } else {
         if (dx < 0)
-            blit(x - dx, y, x + width - 1 + dx, y + height - 1 - dy, x, y + dy);
+            blit(x - dx, y, x + width - 1, y + height - 1 - dy, x, y + dy);
         else
             blit(x, y, x + width - 1 - dx, y + height - 1 - dy, x + dx, y + dy);
     }
@@ -881,7 +1285,7 @@ void Bitmap::scroll(int x, int y, int width, int height, int dx, int dy, Color f
         else if (dx > 0)
             fill(x, y, dx, height + dy, fillColor);
     } else if (dy > 0) {
-        fill(x, y, width, -dy, fillColor);
+        fill(x, y, width, dy, fillColor);
         if (dx < 0)
             fill(x + width + dx, y + dy, -dx, height - dy, fillColor);
         else if (dx > 0)
@@ -909,18 +1313,96 @@ void Bitmap::invert(int x, int y, int width, int height)
     }
 }
 
+/**
+ * \fn bool Bitmap::isDirty() const
+ * \brief Returns true if any rows of the bitmap have been modified since
+ * the last call to clearDirty(); false otherwise.
+ *
+ * All of the drawing functions in this class record the range of rows
+ * that they modify, which allows the owner of the bitmap to copy or
+ * convert only the part of the bitmap that has changed.  DMD uses this
+ * to speed up DMD::swapBuffersAndCopy() and the wire-order shadow buffer.
+ *
+ * A newly constructed bitmap is entirely dirty.
+ *
+ * \sa dirtyTop(), dirtyBottom(), markDirty(), clearDirty()
+ */
+
+/**
+ * \fn int Bitmap::dirtyTop() const
+ * \brief Returns the top-most row that has been modified since the last
+ * call to clearDirty().
+ *
+ * The value is only meaningful if isDirty() returns true.
+ *
+ * \sa dirtyBottom(), isDirty()
+ */
+
+/**
+ * \fn int Bitmap::dirtyBottom() const
+ * \brief Returns the bottom-most row that has been modified since the last
+ * call to clearDirty().
+ *
+ * The value is only meaningful if isDirty() returns true.
+ *
+ * \sa dirtyTop(), isDirty()
+ */
+
+/**
+ * \brief Marks the rows between \a y1 and \a y2 inclusive as dirty.
+ *
+ * The drawing functions in this class mark rows automatically.  This
+ * function is needed only if the application modifies the pixels
+ * directly via data().  Rows outside the bitmap are ignored.
+ *
+ * \sa clearDirty(), isDirty()
+ */
+void Bitmap::markDirty(int y1, int y2)
+{
+    if (y1 > y2) {
+        int temp = y1;
+        y1 = y2;
+        y2 = temp;
+    }
+    if (y1 < 0)
+        y1 = 0;
+    if (y2 >= _height)
+        y2 = _height - 1;
+    if (y1 > y2)
+        return;
+    if (y1 < _dirtyTop)
+        _dirtyTop = y1;
+    if (y2 > _dirtyBottom)
+        _dirtyBottom = y2;
+}
+
+/**
+ * \fn void Bitmap::markDirty()
+ * \brief Marks the entire bitmap as dirty.
+ * \overload
+ */
+
+/**
+ * \fn void Bitmap::clearDirty()
+ * \brief Clears the record of dirty rows so that isDirty() returns false.
+ *
+ * \sa markDirty(), isDirty()
+ */
+
 void Bitmap::blit(int x1, int y1, int x2, int y2, int x3, int y3)
 {
+    if (copyRegion(x1, y1, x2 - x1 + 1, y2 - y1 + 1, this, x3, y3))
+        return;
     if (y3 < y1 || (y1 == y3 && x3 <= x1)) {
         for (int tempy = y1; tempy <= y2; ++tempy) {
-            int y = y1 - tempy + y3;
+            int y = tempy - y1 + y3;
             int x = x3 - x1;
             for (int tempx = x1; tempx <= x2; ++tempx)
                 setPixel(x + tempx, y, pixel(tempx, tempy));
         }
     } else {
         for (int tempy = y2; tempy >= y1; --tempy) {
-            int y = y1 - tempy + y3;
+            int y = tempy - y1 + y3;
             int x = x3 - x1;
             for (int tempx = x2; tempx >= x1; --tempx)
                 setPixel(x + tempx, y, pixel(tempx, tempy));
@@ -928,6 +1410,56 @@ void Bitmap::blit(int x1, int y1, int x2, int y2, int x3, int y3)
     }
 }
 
+// Copies a region of this bitmap to dest a row at a time, shifting the
+// pixels into place a byte at a time.  The destination is clipped to the
+// bounds of dest.  Returns false without copying anything if some of the
+// source is outside the bounds of this bitmap; the caller must then fall
+// back to copying pixel by pixel.
+bool Bitmap::copyRegion(int x, int y, int width, int height, Bitmap *dest, int destX, int destY)
+{
+    if (destX < 0) {
+        x -= destX;
+        width += destX;
+        destX = 0;
+    }
+    if (destY < 0) {
+        y -= destY;
+        height += destY;
+        destY = 0;
+    }
+    if ((destX + width) > dest->_width)
+        width = dest->_width - destX;
+    if ((destY + height) > dest->_height)
+        height = dest->_height - destY;
+    if (width <= 0 || height <= 0)
+        return true;
+    if (x < 0 || y < 0 || (x + width) > _width || (y + height) > _height)
+        return false;
+    dest->markDirty(destY, destY + height - 1);
+    if (dest == this && destY > y) {
+        // Copy from the bottom up so that overlapping rows are not
+        // overwritten before they have been copied.
+        const uint8_t *src = fb + (y + height - 1) * _stride;
+        uint8_t *dst = fb + (destY + height - 1) * _stride;
+        while (height > 0) {
+            copyBits(dst, destX, src, x, width);
+            src -= _stride;
+            dst -= _stride;
+            --height;
+        }
+    } else {
+        const uint8_t *src = fb + y * _stride;
+        uint8_t *dst = dest->fb + destY * dest->_stride;
+        while (height > 0) {
+            copyBits(dst, destX, src, x, width);
+            src += _stride;
+            dst += dest->_stride;
+            --height;
+        }
+    }
+    return true;
+}
+
 void Bitmap::drawCirclePoints(int centerX, int centerY, int radius, int x, int y, Color borderColor, Color fillColor)
 {
     if (x != y) {
@@ -941,10 +1473,10 @@ void Bitmap::drawCirclePoints(int centerX, int centerY, int radius, int x, int y
         setPixel(centerX - x, centerY + y, borderColor);
         if (fillColor != NoFill) {
             if (radius > 1) {
-                drawLine(centerX - x + 1, centerY + y, centerX + x - 1, centerY + y, fillColor);
-                drawLine(centerX - y + 1, centerY + x, centerX + y - 1, centerY + x, fillColor);
-                drawLine(centerX - x + 1, centerY - y, centerX + x - 1, centerY - y, fillColor);
-                drawLine(centerX - y + 1, centerY - x, centerX + y - 1, centerY - x, fillColor);
+                drawSpan(centerX - x + 1, centerX + x - 1, centerY + y, fillColor);
+                drawSpan(centerX - y + 1, centerX + y - 1, centerY + x, fillColor);
+                drawSpan(centerX - x + 1, centerX + x - 1, centerY - y, fillColor);
+                drawSpan(centerX - y + 1, centerX + y - 1, centerY - x, fillColor);
             } else if (radius == 1) {
                 setPixel(centerX, centerY, fillColor);
             }
@@ -956,11 +1488,32 @@ void Bitmap::drawCirclePoints(int centerX, int centerY, int radius, int x, int y
         setPixel(centerX - y, centerY + x, borderColor);
         if (fillColor != NoFill) {
             if (radius > 1) {
-                drawLine(centerX - x + 1, centerY + y, centerX + x - 1, centerY + y, fillColor);
-                drawLine(centerX - x + 1, centerY - y, centerX + x - 1, centerY - y, fillColor);
+                drawSpan(centerX - x + 1, centerX + x - 1, centerY + y, fillColor);
+                drawSpan(centerX - x + 1, centerX + x - 1, centerY - y, fillColor);
             } else if (radius == 1) {
                 setPixel(centerX, centerY, fillColor);
             }
         }
     }
 }
+
+// Draws a horizontal span of pixels between x1 and x2 inclusive on row y,
+// clipped to the bitmap.  The end points may be in either order.
+void Bitmap::drawSpan(int x1, int x2, int y, Color color)
+{
+    if (((unsigned int)y) >= ((unsigned int)_height))
+        return;
+    if (x1 > x2) {
+        int temp = x1;
+        x1 = x2;
+        x2 = temp;
+    }
+    if (x1 < 0)
+        x1 = 0;
+    if (x2 >= _width)
+        x2 = _width - 1;
+    if (x1 > x2)
+        return;
+    markDirty(y, y);
+    fillBits(fb + y * _stride, x1, x2 - x1 + 1, color ? 0x00 : 0xFF);
+}
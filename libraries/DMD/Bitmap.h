@@ -29,10 +29,19 @@
 class DMD;
 class String;
 
+// Number of entries in the glyph offset index for variable-width fonts.
+// Each entry covers 16 characters.
+#if !defined(BITMAP_GLYPH_INDEX_SIZE)
+#define BITMAP_GLYPH_INDEX_SIZE 8
+#endif
+
+// Number of bytes of memory needed for a width x height bitmap.
+#define BITMAP_BUFFER_SIZE(width, height)   ((((width) + 7) / 8) * (height))
+
 class Bitmap
 {
 public:
-    Bitmap(int width, int height);
+    Bitmap(int width, int height, uint8_t *buffer = 0);
     ~Bitmap();
 
     bool isValid() const { return fb != 0; }
@@ -66,11 +75,12 @@ public:
 
     void drawBitmap(int x, int y, const Bitmap &bitmap, Color color = White);
     void drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color = White);
+    void drawRLEBitmap(int x, int y, Bitmap::ProgMem bitmap, Color color = White);
     void drawInvertedBitmap(int x, int y, const Bitmap &bitmap);
     void drawInvertedBitmap(int x, int y, Bitmap::ProgMem bitmap);
 
     Font font() const { return _font; }
-    void setFont(Font font) { _font = font; }
+    void setFont(Font font);
 
     Color textColor() const { return _textColor; }
     void setTextColor(Color color) { _textColor = color; }
@@ -94,6 +104,13 @@ public:
 
     void invert(int x, int y, int width, int height);
 
+    bool isDirty() const { return _dirtyTop <= _dirtyBottom; }
+    int dirtyTop() const { return _dirtyTop; }
+    int dirtyBottom() const { return _dirtyBottom; }
+    void markDirty(int y1, int y2);
+    void markDirty() { _dirtyTop = 0; _dirtyBottom = _height - 1; }
+    void clearDirty() { _dirtyTop = _height; _dirtyBottom = -1; }
+
 private:
     // Disable copy constructor and operator=().
     Bitmap(const Bitmap &) {}
@@ -103,13 +120,31 @@ private:
     int _height;
     int _stride;
     uint8_t *fb;
+    bool ownBuffer;
     Font _font;
     Color _textColor;
+    int _dirtyTop;
+    int _dirtyBottom;
+    uint16_t glyphIndex[BITMAP_GLYPH_INDEX_SIZE];
 
     friend class DMD;
+    friend class HUB75DMD;
+    friend class GLCD;
 
     void blit(int x1, int y1, int x2, int y2, int x3, int y3);
+    bool copyRegion(int x, int y, int width, int height, Bitmap *dest, int destX, int destY);
     void drawCirclePoints(int centerX, int centerY, int radius, int x, int y, Color borderColor, Color fillColor);
+    void drawSpan(int x1, int x2, int y, Color color);
+};
+
+template <int Width, int Height>
+class StaticBitmap : public Bitmap
+{
+public:
+    StaticBitmap() : Bitmap(Width, Height, buffer) {}
+
+private:
+    uint8_t buffer[BITMAP_BUFFER_SIZE(Width, Height)];
 };
 
 inline void Bitmap::drawFilledRect(int x1, int y1, int x2, int y2, Color color)
@@ -21,6 +21,7 @@
  */
 
 #include "DMD.h"
+#include "DisplayList.h"
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
@@ -175,6 +176,13 @@
  * The downside of double buffering is that it uses twice as much main memory
  * to manage the contents of the screen.
  *
+ * Calling swapBuffers() from the main loop can still tear the image if the
+ * swap lands part-way through the four phases of a refresh cycle.  Use
+ * queueSwap() and waitForSwap() instead to have refresh() perform the swap
+ * just before it starts the next cycle.  A callback can be registered
+ * with setFrameCallback() to learn when the swap has occurred, and
+ * frameTime() reports the time between the last two frames.
+ *
  * \section dmd_multi Multiple panels
  *
  * Multiple panels can be daisy-chained together using ribbon cables.
@@ -205,6 +213,57 @@
  *
  * DMD display(4, 2);   // 4 panels wide, 2 panels high
  * \endcode
+ *
+ * \section dmd_chains Multiple chains
+ *
+ * The time taken by refresh() grows with the number of panels because
+ * all of the data is shifted through a single chain.  On ATmega168 and
+ * ATmega328 based boards, setChains(2) splits the display into two
+ * chains that are shifted out at the same time: the top half of the
+ * panel rows is connected as usual, and the bottom half is connected as
+ * though it were a separate display with its R line on D1 (TXD) and its
+ * CLK line on D4 (XCK).  Both chains share the A, B, SCLK and nOE lines.
+ * The second chain is driven by the USART in master SPI mode, so the
+ * Serial port cannot be used at the same time.
+ *
+ * \code
+ * DMD display(4, 4);   // 4 panels wide, 4 panels high
+ *
+ * void setup() {
+ *     display.setChains(2);
+ *     display.enableTimer1();
+ * }
+ * \endcode
+ *
+ * \section dmd_greyscale Greyscale
+ *
+ * The panels can only turn each LED on or off, but DMD can simulate
+ * 2 to 4 bits of brightness per pixel with binary code modulation.
+ * Each brightness bit is stored in its own bit plane, and refresh()
+ * shows the plane for bit N for 2^N times as long as the plane for
+ * bit 0.  Call setGreyscaleBits() before enableTimer1() because the
+ * timer runs faster to show all of the planes in the same refresh period:
+ *
+ * \code
+ * DMD display;
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     display.setGreyscaleBits(2);
+ *     display.enableTimer1();
+ *     display.setPixelLevel(0, 0, 1);     // One-third brightness.
+ *     display.setPixelLevel(1, 0, 3);     // Full brightness.
+ * }
+ * \endcode
+ *
+ * The drawing functions from Bitmap draw into the plane that was selected
+ * with setDrawPlane(), which is the most significant plane by default.
+ * Greyscale mode cannot be combined with double buffering or with the
+ * wire-order shadow buffer.
  */
 
 // Pins on the DMD connector board.
@@ -217,6 +276,15 @@
 #define DMD_PIN_SPI_MISO        MISO    // SPI Master In, Slave Out
 #define DMD_PIN_SPI_SCK         SCK     // SPI Serial Clock (CLK)
 
+// Pins for the second chain of panels, which is driven by USART0 in
+// master SPI mode.  Only the ATmega168/328 family has XCK0 on a header pin.
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__) || \
+    defined(__AVR_ATmega328__) || defined(__AVR_ATmega328P__)
+#define DMD_USART_CHAIN         1
+#define DMD_PIN_USART_TXD       1       // USART Transmit (R)
+#define DMD_PIN_USART_XCK       4       // USART Transfer Clock (CLK)
+#endif
+
 // Dimension information for the display.
 #define DMD_NUM_COLUMNS         32      // Number of columns in a panel.
 #define DMD_NUM_ROWS            16      // Number of rows in a panel.
@@ -225,6 +293,32 @@
 #define DMD_REFRESH_MS          5
 #define DMD_REFRESH_US          5000
 
+// Flip the bits in a byte.  Table generated by genflip.c
+static const uint8_t flipBits[256] PROGMEM = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0,
+    0x30, 0xB0, 0x70, 0xF0, 0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8,
+    0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 0x04, 0x84, 0x44, 0xC4,
+    0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC,
+    0x3C, 0xBC, 0x7C, 0xFC, 0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2,
+    0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2, 0x0A, 0x8A, 0x4A, 0xCA,
+    0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6,
+    0x36, 0xB6, 0x76, 0xF6, 0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE,
+    0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE, 0x01, 0x81, 0x41, 0xC1,
+    0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9,
+    0x39, 0xB9, 0x79, 0xF9, 0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5,
+    0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5, 0x0D, 0x8D, 0x4D, 0xCD,
+    0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3,
+    0x33, 0xB3, 0x73, 0xF3, 0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB,
+    0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB, 0x07, 0x87, 0x47, 0xC7,
+    0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF,
+    0x3F, 0xBF, 0x7F, 0xFF
+};
+
 /**
  * \brief Constructs a new dot matrix display handler for a display that
  * is \a widthPanels x \a heightPanels in size.
@@ -232,17 +326,68 @@
  * Note: the parameters to this constructor are specified in panels,
  * whereas width() and height() are specified in pixels.
  *
- * \sa width(), height()
+ * By default the frame buffer is allocated from the heap, as are the
+ * extra buffers for setDoubleBuffer() and setWireOrder() when they are
+ * enabled.  If \a buffer, \a backBuffer, or \a wireBuffer are not NULL,
+ * then they must each point to DMD_BUFFER_SIZE(\a widthPanels,
+ * \a heightPanels) bytes of statically allocated memory that will be
+ * used for the frame buffer, the double-buffering back buffer, and the
+ * wire-order shadow buffer respectively:
+ *
+ * \code
+ * uint8_t frames[2][DMD_BUFFER_SIZE(2, 1)];
+ * DMD display(2, 1, frames[0], frames[1]);
+ *
+ * void setup() {
+ *     display.setDoubleBuffer(true);
+ * }
+ * \endcode
+ *
+ * This avoids fragmenting the heap and makes the memory usage of the
+ * display known at link time.  The StaticDMD template declares the
+ * display and its buffers in one step.  The extra bit planes for
+ * setGreyscaleBits() are always allocated from the heap.
+ *
+ * \sa width(), height(), StaticDMD
  */
-DMD::DMD(int widthPanels, int heightPanels)
-    : Bitmap(widthPanels * DMD_NUM_COLUMNS, heightPanels * DMD_NUM_ROWS)
+DMD::DMD(int widthPanels, int heightPanels, uint8_t *buffer,
+         uint8_t *backBuffer, uint8_t *wireBuffer)
+    : Bitmap(widthPanels * DMD_NUM_COLUMNS, heightPanels * DMD_NUM_ROWS, buffer)
     , _doubleBuffer(false)
+    , synced(false)
+    , swapCopy(false)
+    , swapState(SwapIdle)
+    , swapTop(0)
+    , swapBottom(-1)
+    , pendingList(0)
+    , frameCallback(0)
+    , lastSwap(0)
+    , frames(0)
+    , _frameTime(0)
+    , _maxFrameTime(0)
     , phase(0)
     , fb0(0)
     , fb1(0)
     , displayfb(0)
+    , wirefb(0)
+    , staticBack(backBuffer)
+    , staticWire(wireBuffer)
     , lastRefresh(millis())
+    , sliceTime(DMD_REFRESH_US)
+    , _chains(1)
+    , _planes(1)
+    , plane(0)
+    , ticks(0)
+    , statsEnabled(false)
+    , statCalls(0)
+    , statMissed(0)
+    , statLast(0)
+    , statMax(0)
+    , statTotal(0)
+    , statStart(0)
 {
+    lowPlanes[0] = lowPlanes[1] = lowPlanes[2] = 0;
+
     // Both rendering and display are to fb0 initially.
     fb0 = displayfb = fb;
 
@@ -270,6 +415,17 @@ DMD::DMD(int widthPanels, int heightPanels)
     digitalWrite(DMD_PIN_LATCH, LOW);
     digitalWrite(DMD_PIN_OUTPUT_ENABLE, LOW);
     digitalWrite(DMD_PIN_SPI_MOSI, HIGH);
+
+    // Look up the port registers for the DMD-specific pins so that
+    // refresh() can latch the data without going through digitalWrite().
+    latchPort = portOutputRegister(digitalPinToPort(DMD_PIN_LATCH));
+    enablePort = portOutputRegister(digitalPinToPort(DMD_PIN_OUTPUT_ENABLE));
+    phaseLsbPort = portOutputRegister(digitalPinToPort(DMD_PIN_PHASE_LSB));
+    phaseMsbPort = portOutputRegister(digitalPinToPort(DMD_PIN_PHASE_MSB));
+    latchMask = digitalPinToBitMask(DMD_PIN_LATCH);
+    enableMask = digitalPinToBitMask(DMD_PIN_OUTPUT_ENABLE);
+    phaseLsbMask = digitalPinToBitMask(DMD_PIN_PHASE_LSB);
+    phaseMsbMask = digitalPinToBitMask(DMD_PIN_PHASE_MSB);
 }
 
 /**
@@ -277,10 +433,16 @@ DMD::DMD(int widthPanels, int heightPanels)
  */
 DMD::~DMD()
 {
-    if (fb0)
+    if (fb0 && ownBuffer)
         free(fb0);
-    if (fb1)
+    if (fb1 && fb1 != staticBack)
         free(fb1);
+    if (wirefb && wirefb != staticWire)
+        free(wirefb);
+    for (uint8_t index = 0; index < 3; ++index) {
+        if (lowPlanes[index])
+            free(lowPlanes[index]);
+    }
     fb = 0; // Don't free the buffer again in the base class.
 }
 
@@ -306,19 +468,26 @@ DMD::~DMD()
  * from simultaneous update of a single shared buffer.
  *
  * This function will allocate memory for the extra buffer when
- * \a doubleBuffer is true.  If there is insufficient memory for the
- * second screen buffer, then this class will revert to single-buffered mode.
+ * \a doubleBuffer is true, unless a static back buffer was passed to
+ * the constructor.  If there is insufficient memory for the second
+ * screen buffer, then this class will revert to single-buffered mode.
+ * Double-buffering is not available in greyscale mode.
  *
  * \sa doubleBuffer(), swapBuffers(), refresh()
  */
 void DMD::setDoubleBuffer(bool doubleBuffer)
 {
+    if (doubleBuffer && _planes > 1)
+        return;
     if (doubleBuffer != _doubleBuffer) {
         _doubleBuffer = doubleBuffer;
+        synced = false;
+        swapState = SwapIdle;
+        pendingList = 0;
         if (doubleBuffer) {
-            // Allocate a new back buffer.
+            // Allocate a new back buffer if we don't have a static one.
             unsigned int size = _stride * _height;
-            fb1 = (uint8_t *)malloc(size);
+            fb1 = staticBack ? staticBack : (uint8_t *)malloc(size);
 
             // Clear the new back buffer and then switch to it, leaving
             // the current contents of fb0 on the screen.
@@ -340,7 +509,8 @@ void DMD::setDoubleBuffer(bool doubleBuffer)
             sei();
 
             // Free the unnecessary buffer.
-            free(fb1);
+            if (fb1 != staticBack)
+                free(fb1);
             fb1 = 0;
         }
     }
@@ -362,19 +532,7 @@ void DMD::setDoubleBuffer(bool doubleBuffer)
  */
 void DMD::swapBuffers()
 {
-    if (_doubleBuffer) {
-        // Turn off interrupts while swapping buffers so that we don't
-        // accidentally try to refresh() in the middle of this code.
-        cli();
-        if (fb == fb0) {
-            fb = fb1;
-            displayfb = fb0;
-        } else {
-            fb = fb0;
-            displayfb = fb1;
-        }
-        sei();
-    }
+    exchangeBuffers(false);
 }
 
 /**
@@ -391,13 +549,609 @@ void DMD::swapBuffers()
  * frame to the next.  If the screen changes a lot between frames, then it
  * is usually better to explicitly clear() or fill() the new back buffer.
  *
+ * When this function is called twice in a row, only the rows that were
+ * drawn to in between are copied, as reported by Bitmap::dirtyTop() and
+ * Bitmap::dirtyBottom().  The wire-order shadow buffer is also updated
+ * for just those rows.  If the application modifies the back buffer
+ * directly via data(), then it must call markDirty() on the rows it
+ * changed.
+ *
  * \sa swapBuffers(), setDoubleBuffer()
  */
 void DMD::swapBuffersAndCopy()
 {
-    swapBuffers();
-    if (_doubleBuffer)
-        memcpy(fb, displayfb, _stride * _height);
+    exchangeBuffers(true);
+}
+
+/**
+ * \brief Queues a swap of the front and back buffers to occur at the start
+ * of the next refresh cycle.
+ *
+ * swapBuffers() swaps the buffers immediately, so if refresh() is called
+ * from an interrupt then the swap may land part-way through the scan of
+ * the four phases and tear the image.  This function instead arranges
+ * for refresh() to swap the buffers just before it sends phase 0.
+ * The application must then call waitForSwap() before drawing into the
+ * new back buffer:
+ *
+ * \code
+ * void loop() {
+ *     display.clear();
+ *     ...     // Draw the next frame.
+ *     display.queueSwap();
+ *     display.waitForSwap();
+ * }
+ * \endcode
+ *
+ * If \a copy is true, then waitForSwap() will copy the new front buffer
+ * into the new back buffer as for swapBuffersAndCopy().
+ *
+ * This function does nothing when doubleBuffer() is false.  The swap
+ * cannot be deferred when the wire-order shadow buffer is enabled because
+ * refresh() would need to convert the new frame itself, so in that case
+ * this function swaps the buffers immediately.
+ *
+ * \sa waitForSwap(), swapPending(), setFrameCallback(), swapBuffers()
+ */
+void DMD::queueSwap(bool copy)
+{
+    if (!_doubleBuffer)
+        return;
+    if (wirefb) {
+        exchangeBuffers(copy);
+        return;
+    }
+    waitForSwap();
+    dirtyRange(swapTop, swapBottom);
+    swapCopy = copy;
+    swapState = SwapQueued;
+}
+
+/**
+ * \fn bool DMD::swapPending() const
+ * \brief Returns true if a swap that was queued with queueSwap() or
+ * queueDisplayList() has not yet been performed by refresh(); false otherwise.
+ *
+ * If refresh() is being called from loop() rather than from an interrupt,
+ * then the application should keep calling loop() until this function
+ * returns false and then call waitForSwap().
+ *
+ * \sa queueSwap(), waitForSwap()
+ */
+
+/**
+ * \brief Waits for a swap that was queued with queueSwap() to be performed
+ * and then finishes preparing the new back buffer for drawing.
+ *
+ * This function returns immediately if no swap has been queued.  It must
+ * only be used when refresh() is called from an interrupt.
+ *
+ * \sa queueSwap(), swapPending()
+ */
+void DMD::waitForSwap()
+{
+    if (swapState == SwapIdle)
+        return;
+    while (swapState == SwapQueued)
+        ;   // Wait for refresh() to swap the buffers.
+    if (swapCopy && swapTop <= swapBottom) {
+        memcpy(fb + swapTop * _stride, displayfb + swapTop * _stride,
+               (swapBottom - swapTop + 1) * _stride);
+    }
+    synced = swapCopy || !_doubleBuffer;
+    clearDirty();
+    swapState = SwapIdle;
+}
+
+/**
+ * \brief Queues the display \a list to be rendered into the display at the
+ * start of the next refresh cycle.
+ *
+ * This provides tear-free updates when refresh() is called from an
+ * interrupt, without the memory for a second screen buffer.  The
+ * application records the commands for the next frame into \a list and
+ * refresh() replays them into the framebuffer just before it sends
+ * phase 0, so a partially drawn frame is never shown:
+ *
+ * \code
+ * DisplayList list(64);
+ *
+ * void loop() {
+ *     list.clear();
+ *     list.drawText(0, 0, "Hello");
+ *     display.queueDisplayList(&list);
+ *     display.waitForSwap();
+ * }
+ * \endcode
+ *
+ * The application must not modify \a list or draw into the display until
+ * waitForSwap() returns.  Alternating between two lists allows the next
+ * frame to be recorded while the current one is waiting to be rendered.
+ *
+ * If doubleBuffer() is true, then the list is rendered into the back buffer
+ * and the buffers are swapped.  If the wire-order shadow buffer is enabled,
+ * then refresh() also converts the new frame into wire order.  Rendering
+ * the list delays the first phase of the refresh cycle, so lists should
+ * be kept short.
+ *
+ * \sa DisplayList, waitForSwap(), swapPending(), queueSwap()
+ */
+void DMD::queueDisplayList(const DisplayList *list)
+{
+    waitForSwap();
+    if (!list)
+        return;
+    pendingList = list;
+    swapCopy = false;
+    swapState = SwapQueued;
+}
+
+/**
+ * \typedef DMD::FrameCallback
+ * \brief Type of a function that is called by refresh() when it swaps
+ * the buffers for a swap that was queued with queueSwap().
+ *
+ * The function is passed a pointer to the display and is usually called
+ * from an interrupt service routine, so it should do no more than notify
+ * the application that it can render the next frame.
+ */
+
+/**
+ * \fn void DMD::setFrameCallback(FrameCallback callback)
+ * \brief Sets the \a callback function to call when refresh() performs
+ * a swap that was queued with queueSwap().
+ *
+ * The \a callback may be null to disable it.
+ *
+ * \sa queueSwap(), frameCount()
+ */
+
+/**
+ * \brief Returns the number of queued swaps and display lists that refresh()
+ * has performed since the last call to resetFrameStats().
+ *
+ * \sa frameTime(), maxFrameTime(), queueSwap()
+ */
+unsigned long DMD::frameCount() const
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    unsigned long value = frames;
+    SREG = oldSREG;
+    return value;
+}
+
+/**
+ * \brief Returns the time in microseconds between the last two swaps
+ * that were performed by refresh() for queueSwap().
+ *
+ * \sa maxFrameTime(), frameCount()
+ */
+unsigned long DMD::frameTime() const
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    unsigned long value = _frameTime;
+    SREG = oldSREG;
+    return value;
+}
+
+/**
+ * \brief Returns the longest time in microseconds between two swaps that
+ * were performed by refresh() since the last call to resetFrameStats().
+ *
+ * \sa frameTime(), frameCount()
+ */
+unsigned long DMD::maxFrameTime() const
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    unsigned long value = _maxFrameTime;
+    SREG = oldSREG;
+    return value;
+}
+
+/**
+ * \brief Resets the frame statistics.
+ *
+ * \sa frameCount(), frameTime(), maxFrameTime()
+ */
+void DMD::resetFrameStats()
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    frames = 0;
+    _frameTime = 0;
+    _maxFrameTime = 0;
+    SREG = oldSREG;
+}
+
+/**
+ * \fn bool DMD::wireOrder() const
+ * \brief Returns true if refresh() is sending the display data from a
+ * wire-order shadow buffer; false otherwise.  The default is false.
+ *
+ * \sa setWireOrder(), updateWireOrder()
+ */
+
+/**
+ * \brief Enables or disables the wire-order shadow buffer according
+ * to \a wireOrder.
+ *
+ * Normally refresh() gathers the bytes for each phase from four rows of
+ * the display buffer and flips the bits of the bytes for panels that are
+ * upside-down.  When the wire-order buffer is enabled, the display buffer
+ * is instead converted ahead of time into a shadow buffer holding the
+ * bytes for each phase in the exact order and bit orientation that the
+ * panels expect.  refresh() then sends the shadow buffer as one linear
+ * stream, which is much quicker for large multi-panel displays.
+ *
+ * The conversion is performed by updateWireOrder(), which swapBuffers()
+ * and swapBuffersAndCopy() call automatically.  If the display is not
+ * double-buffered, then the application must call updateWireOrder()
+ * itself after drawing to make the changes visible.
+ *
+ * This function will allocate memory for the shadow buffer when
+ * \a wireOrder is true, unless a static shadow buffer was passed to
+ * the constructor.  If there is insufficient memory, then the
+ * shadow buffer will not be used.  The shadow buffer is not available
+ * in greyscale mode.
+ *
+ * \sa wireOrder(), updateWireOrder(), setDoubleBuffer()
+ */
+void DMD::setWireOrder(bool wireOrder)
+{
+    if (wireOrder && _planes > 1)
+        return;
+    if (wireOrder && !wirefb) {
+        // Allocate the shadow buffer and fill it before refresh() sees it.
+        uint8_t *buffer = staticWire;
+        if (!buffer)
+            buffer = (uint8_t *)malloc(_stride * _height);
+        if (buffer) {
+            cli();
+            wirefb = buffer;
+            sei();
+            convertWireOrder(0, _height - 1);
+            if (!_doubleBuffer) {
+                synced = true;
+                clearDirty();
+            }
+        }
+    } else if (!wireOrder && wirefb) {
+        uint8_t *buffer = wirefb;
+        cli();
+        wirefb = 0;
+        sei();
+        if (buffer != staticWire)
+            free(buffer);
+    }
+}
+
+/**
+ * \brief Converts the contents of the display buffer into the wire-order
+ * shadow buffer.
+ *
+ * This function does nothing if the shadow buffer is not enabled.
+ * If the display is double-buffered, then this function is called
+ * automatically by swapBuffers().
+ *
+ * If the display is single-buffered, then only the rows that have been
+ * drawn to since the last call are converted, as reported by
+ * Bitmap::dirtyTop() and Bitmap::dirtyBottom().
+ *
+ * \sa setWireOrder(), swapBuffers()
+ */
+void DMD::updateWireOrder()
+{
+    if (!wirefb)
+        return;
+    if (_doubleBuffer) {
+        convertWireOrder(0, _height - 1);
+    } else {
+        if (!synced)
+            convertWireOrder(0, _height - 1);
+        else if (isDirty())
+            convertWireOrder(dirtyTop(), dirtyBottom());
+        synced = true;
+        clearDirty();
+    }
+}
+
+/**
+ * \fn int DMD::chains() const
+ * \brief Returns the number of chains of panels that refresh() drives in
+ * parallel; 1 or 2.  The default is 1.
+ *
+ * \sa setChains()
+ */
+
+/**
+ * \brief Sets the number of chains of panels that refresh() drives in
+ * parallel to \a chains.
+ *
+ * When \a chains is 2, the top half of the panel rows are driven from
+ * the SPI port and the bottom half from the USART in master SPI mode.
+ * This is only possible on ATmega168 and ATmega328 based boards and if
+ * the display has an even number of panel rows; otherwise this function
+ * does nothing.  See \ref dmd_chains "Multiple chains" for how to connect
+ * the panels.
+ *
+ * \sa chains()
+ */
+void DMD::setChains(int chains)
+{
+#if defined(DMD_USART_CHAIN)
+    if (chains == _chains || chains < 1 || chains > 2)
+        return;
+    if (chains == 2 && (_height & 0x10) != 0)
+        return;
+    if (chains == 2) {
+        // Put USART0 into master SPI mode 0, MSB-first, at F_CPU / 2.
+        pinMode(DMD_PIN_USART_XCK, OUTPUT);
+        UBRR0 = 0;
+        UCSR0C = _BV(UMSEL01) | _BV(UMSEL00);
+        UCSR0B = _BV(TXEN0);
+        UBRR0 = 0;
+    }
+    cli();
+    _chains = chains;
+    sei();
+    if (chains == 1) {
+        // Return USART0 to its default asynchronous mode.
+        UCSR0B = 0;
+        UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    }
+    if (wirefb) {
+        // The chains change the order of the bytes in the shadow buffer.
+        convertWireOrder(0, _height - 1);
+    }
+#else
+    (void)chains;
+#endif
+}
+
+// Determines the range of rows that differ between the back buffer and
+// the display buffer.  The range is empty if top is greater than bottom.
+void DMD::dirtyRange(int &top, int &bottom) const
+{
+    if (!synced) {
+        top = 0;
+        bottom = _height - 1;
+    } else if (isDirty()) {
+        top = dirtyTop();
+        bottom = dirtyBottom();
+    } else {
+        top = _height;
+        bottom = -1;
+    }
+}
+
+// Swaps the front and back buffers, optionally copying the new front
+// buffer into the new back buffer.  If the back buffer was a copy of the
+// front buffer apart from the dirty rows, then only those rows need to be
+// converted into wire order and copied back.
+void DMD::exchangeBuffers(bool copy)
+{
+    if (!_doubleBuffer)
+        return;
+    waitForSwap();
+    int top, bottom;
+    dirtyRange(top, bottom);
+
+    // Turn off interrupts while swapping buffers so that we don't
+    // accidentally try to refresh() in the middle of this code.
+    cli();
+    if (fb == fb0) {
+        fb = fb1;
+        displayfb = fb0;
+    } else {
+        fb = fb0;
+        displayfb = fb1;
+    }
+    sei();
+
+    // Convert the new display buffer into the order that refresh() sends.
+    if (wirefb && top <= bottom)
+        convertWireOrder(top, bottom);
+
+    // Bring the new back buffer up to date with the display buffer.
+    if (copy && top <= bottom) {
+        memcpy(fb + top * _stride, displayfb + top * _stride,
+               (bottom - top + 1) * _stride);
+    }
+    synced = copy;
+    clearDirty();
+}
+
+// Converts the rows between top and bottom of the display buffer into
+// the wire-order shadow buffer.  The conversion is done in bands of 16
+// rows so the range is rounded outwards to the nearest band.
+void DMD::convertWireOrder(int top, int bottom)
+{
+    uint8_t *out = wirefb;
+    int stride4 = _stride * 4;
+    const uint8_t *data0;
+    const uint8_t *data1;
+    const uint8_t *data2;
+    const uint8_t *data3;
+    int chainHeight = _height / _chains;
+    bool flipRow = false;
+    for (uint8_t ph = 0; ph < 4; ++ph) {
+        // Lay out the bytes for each phase in the same order as refresh(),
+        // with the bytes for the second chain after those for the first.
+        for (int y = 0; y < _height; y += 16) {
+            if ((y % chainHeight) == 0)
+                flipRow = ((chainHeight & 0x10) == 0);
+            if ((y + 15) < top || y > bottom) {
+                // Nothing has changed in this band of rows.
+                out += stride4;
+                flipRow = !flipRow;
+            } else if (!flipRow) {
+                data0 = displayfb + _stride * (y + ph);
+                data1 = data0 + stride4;
+                data2 = data1 + stride4;
+                data3 = data2 + stride4;
+                for (int x = _stride; x > 0; --x) {
+                    *out++ = *data3++;
+                    *out++ = *data2++;
+                    *out++ = *data1++;
+                    *out++ = *data0++;
+                }
+                flipRow = true;
+            } else {
+                data0 = displayfb + _stride * (y + 16 - ph) - 1;
+                data1 = data0 - stride4;
+                data2 = data1 - stride4;
+                data3 = data2 - stride4;
+                for (int x = _stride; x > 0; --x) {
+                    *out++ = pgm_read_byte(&(flipBits[*data3--]));
+                    *out++ = pgm_read_byte(&(flipBits[*data2--]));
+                    *out++ = pgm_read_byte(&(flipBits[*data1--]));
+                    *out++ = pgm_read_byte(&(flipBits[*data0--]));
+                }
+                flipRow = false;
+            }
+        }
+    }
+}
+
+/**
+ * \fn int DMD::greyscaleBits() const
+ * \brief Returns the number of bits of brightness per pixel; 1 if the
+ * display is not in greyscale mode.
+ *
+ * \sa setGreyscaleBits()
+ */
+
+/**
+ * \brief Sets the number of bits of brightness per pixel to \a bits,
+ * between 1 and 4.
+ *
+ * A value of 1 turns off greyscale mode.  Otherwise an extra bit plane
+ * is allocated for each additional bit and initialized from the current
+ * display contents, so pixels that are already lit stay at full
+ * brightness.  If there is insufficient memory, then the display will
+ * stay in its current mode.
+ *
+ * Double buffering and the wire-order shadow buffer are turned off
+ * when greyscale mode is enabled.  If Timer1 is being used to refresh
+ * the display, then enableTimer1() must be called again afterwards.
+ *
+ * \sa greyscaleBits(), setPixelLevel(), setDrawPlane()
+ */
+void DMD::setGreyscaleBits(int bits)
+{
+    if (bits < 1)
+        bits = 1;
+    else if (bits > 4)
+        bits = 4;
+    if (bits == _planes)
+        return;
+
+    // Allocate the new low planes before we change anything else.
+    unsigned int size = _stride * _height;
+    uint8_t *newPlanes[3] = {0, 0, 0};
+    uint8_t index;
+    for (index = 0; index < (bits - 1); ++index) {
+        newPlanes[index] = (uint8_t *)malloc(size);
+        if (!newPlanes[index]) {
+            while (index > 0)
+                free(newPlanes[--index]);
+            return;
+        }
+    }
+    setDoubleBuffer(false);
+    setWireOrder(false);
+
+    // Switch to the new planes and then free the old ones.
+    uint8_t *oldPlanes[3];
+    for (index = 0; index < 3; ++index) {
+        if (newPlanes[index])
+            memcpy(newPlanes[index], fb0, size);
+        oldPlanes[index] = lowPlanes[index];
+    }
+    cli();
+    for (index = 0; index < 3; ++index)
+        lowPlanes[index] = newPlanes[index];
+    _planes = bits;
+    sliceTime = DMD_REFRESH_US / (unsigned long)((1 << bits) - 1);
+    plane = 0;
+    ticks = 0;
+    fb = fb0;
+    sei();
+    for (index = 0; index < 3; ++index) {
+        if (oldPlanes[index])
+            free(oldPlanes[index]);
+    }
+}
+
+/**
+ * \brief Selects the bit \a plane that the Bitmap drawing functions
+ * will draw into in greyscale mode.
+ *
+ * Plane 0 is the least significant bit of the brightness level and
+ * greyscaleBits() - 1 is the most significant bit, which is the default.
+ * Values that are out of range will select the most significant plane.
+ *
+ * \sa setPixelLevel(), setGreyscaleBits()
+ */
+void DMD::setDrawPlane(int plane)
+{
+    if (plane < 0 || plane >= _planes)
+        plane = _planes - 1;
+    fb = planeBuffer(plane);
+}
+
+/**
+ * \brief Returns the brightness level of the pixel at (\a x, \a y),
+ * between 0 and 2^greyscaleBits() - 1.
+ *
+ * Returns 0 if \a x or \a y is out of range.
+ *
+ * \sa setPixelLevel()
+ */
+uint8_t DMD::pixelLevel(int x, int y) const
+{
+    if (((unsigned int)x) >= ((unsigned int)_width) ||
+            ((unsigned int)y) >= ((unsigned int)_height))
+        return 0;
+    unsigned int offset = y * _stride + (x >> 3);
+    uint8_t mask = ((uint8_t)0x80) >> (x & 0x07);
+    uint8_t level = 0;
+    for (uint8_t index = 0; index < _planes; ++index) {
+        if (!(planeBuffer(index)[offset] & mask))
+            level |= (1 << index);
+    }
+    return level;
+}
+
+/**
+ * \brief Sets the brightness level of the pixel at (\a x, \a y) to
+ * \a level, between 0 and 2^greyscaleBits() - 1.
+ *
+ * The pixel is set in all bit planes regardless of setDrawPlane().
+ * If the display is not in greyscale mode, then any non-zero \a level
+ * turns the pixel on.
+ *
+ * \sa pixelLevel(), setGreyscaleBits()
+ */
+void DMD::setPixelLevel(int x, int y, uint8_t level)
+{
+    if (((unsigned int)x) >= ((unsigned int)_width) ||
+            ((unsigned int)y) >= ((unsigned int)_height))
+        return;     // Pixel is off-screen.
+    if (_planes == 1 && level)
+        level = 1;
+    unsigned int offset = y * _stride + (x >> 3);
+    uint8_t mask = ((uint8_t)0x80) >> (x & 0x07);
+    for (uint8_t index = 0; index < _planes; ++index) {
+        uint8_t *ptr = planeBuffer(index) + offset;
+        if (level & (1 << index))
+            *ptr &= ~mask;
+        else
+            *ptr |= mask;
+    }
 }
 
 /**
@@ -419,6 +1173,15 @@ void DMD::swapBuffersAndCopy()
  */
 void DMD::loop()
 {
+    if (_planes > 1) {
+        // The bit planes are refreshed in shorter slices in greyscale mode.
+        unsigned long currentTime = micros();
+        if ((currentTime - lastRefresh) >= sliceTime) {
+            lastRefresh = currentTime;
+            refresh();
+        }
+        return;
+    }
     unsigned long currentTime = millis();
     if ((currentTime - lastRefresh) >= DMD_REFRESH_MS) {
         lastRefresh = currentTime;
@@ -426,39 +1189,48 @@ void DMD::loop()
     }
 }
 
-// Send a single byte via SPI.
-static inline void spiSend(byte value)
+// Send a single byte via SPI once the previous byte has been sent.
+// The caller fetches the byte before we wait so that the memory and
+// program memory reads overlap with the transfer that is in progress.
+static inline void spiSend(byte value, bool &pending)
 {
+    if (pending) {
+        while (!(SPSR & _BV(SPIF)))
+            ;   // Wait for the previous transfer to complete.
+    }
     SPDR = value;
-    while (!(SPSR & _BV(SPIF)))
-        ;   // Wait for the transfer to complete.
+    pending = true;
 }
 
-// Flip the bits in a byte.  Table generated by genflip.c
-static const uint8_t flipBits[256] PROGMEM = {
-    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0,
-    0x30, 0xB0, 0x70, 0xF0, 0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8,
-    0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 0x04, 0x84, 0x44, 0xC4,
-    0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
-    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC,
-    0x3C, 0xBC, 0x7C, 0xFC, 0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2,
-    0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2, 0x0A, 0x8A, 0x4A, 0xCA,
-    0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
-    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6,
-    0x36, 0xB6, 0x76, 0xF6, 0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE,
-    0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE, 0x01, 0x81, 0x41, 0xC1,
-    0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
-    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9,
-    0x39, 0xB9, 0x79, 0xF9, 0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5,
-    0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5, 0x0D, 0x8D, 0x4D, 0xCD,
-    0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
-    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3,
-    0x33, 0xB3, 0x73, 0xF3, 0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB,
-    0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB, 0x07, 0x87, 0x47, 0xC7,
-    0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
-    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF,
-    0x3F, 0xBF, 0x7F, 0xFF
-};
+// Wait for the last byte to be sent via SPI.
+static inline void spiFlush(bool pending)
+{
+    if (pending) {
+        while (!(SPSR & _BV(SPIF)))
+            ;   // Wait for the transfer to complete.
+    }
+}
+
+#if defined(DMD_USART_CHAIN)
+
+// Send a byte to each chain.  The USART has a transmit buffer, so the
+// byte for the second chain is queued while the SPI byte is being sent.
+static inline void chainSend(byte value0, byte value1, bool &pending)
+{
+    spiSend(value0, pending);
+    while (!(UCSR0A & _BV(UDRE0)))
+        ;   // Wait for room in the USART transmit buffer.
+    UDR0 = value1;
+}
+
+// Wait for the last byte to be sent on the second chain.
+static inline void usartFlush()
+{
+    while (!(UCSR0A & _BV(TXC0)))
+        ;   // Wait for the USART transfer to complete.
+}
+
+#endif
 
 /**
  * \brief Refresh the display.
@@ -477,63 +1249,378 @@ static const uint8_t flipBits[256] PROGMEM = {
  */
 void DMD::refresh()
 {
+    if (!statsEnabled) {
+        refreshSlice();
+        return;
+    }
+    unsigned long start = micros();
+    bool sent = refreshSlice();
+    unsigned long elapsed = micros() - start;
+    ++statCalls;
+    if (!sent)
+        ++statMissed;
+    statLast = elapsed;
+    statTotal += elapsed;
+    if (elapsed > statMax)
+        statMax = elapsed;
+}
+
+// Performs the work for refresh().  Returns false if the refresh was
+// skipped because of a conflict on the SPI bus.
+bool DMD::refreshSlice()
+{
+    // Perform a queued swap at the start of a refresh cycle so that the
+    // new frame is never mixed with the previous one.
+    if (swapState == SwapQueued && phase == 0) {
+        const DisplayList *list = pendingList;
+        if (list)
+            list->render(this);
+        if (_doubleBuffer) {
+            if (fb == fb0) {
+                fb = fb1;
+                displayfb = fb0;
+            } else {
+                fb = fb0;
+                displayfb = fb1;
+            }
+        }
+        if (list) {
+            pendingList = 0;
+            if (wirefb)
+                convertWireOrder(0, _height - 1);
+        }
+        swapState = SwapDone;
+        unsigned long now = micros();
+        if (frames) {
+            _frameTime = now - lastSwap;
+            if (_frameTime > _maxFrameTime)
+                _maxFrameTime = _frameTime;
+        }
+        lastSwap = now;
+        ++frames;
+        if (frameCallback)
+            frameCallback(this);
+    }
+
+    // In greyscale mode, keep showing the current bit plane until it
+    // has been on for 2^N refresh slices.
+    const uint8_t *src = displayfb;
+    if (_planes > 1) {
+        if (ticks > 1) {
+            --ticks;
+            return true;
+        }
+        src = planeBuffer(plane);
+    }
+
     // Bail out if there is a conflict on the SPI bus.
     if (!digitalRead(DMD_PIN_SPI_SS))
-        return;
+        return false;
 
     // Transfer the data for the next group of interleaved rows.
     int stride4 = _stride * 4;
-    uint8_t *data0;
-    uint8_t *data1;
-    uint8_t *data2;
-    uint8_t *data3;
-    bool flipRow = ((_height & 0x10) == 0);
-    for (int y = 0; y < _height; y += 16) {
-        if (!flipRow) {
-            // The panels in this row are the right way up.
-            data0 = displayfb + _stride * (y + phase);
-            data1 = data0 + stride4;
-            data2 = data1 + stride4;
-            data3 = data2 + stride4;
-            for (int x = _stride; x > 0; --x) {
-                spiSend(*data3++);
-                spiSend(*data2++);
-                spiSend(*data1++);
-                spiSend(*data0++);
-            }
-            flipRow = true;
+    const uint8_t *data0;
+    const uint8_t *data1;
+    const uint8_t *data2;
+    const uint8_t *data3;
+    bool pending = false;
+#if defined(DMD_USART_CHAIN)
+    if (_chains > 1) {
+        // Shift out the data for the two chains side by side.  The first
+        // chain has the top half of the display and the second the bottom.
+        int chainHeight = _height >> 1;
+        int offset = _stride * chainHeight;
+        UCSR0A = _BV(TXC0);     // Clear the transmit complete flag.
+        if (wirefb) {
+            unsigned int size = ((unsigned int)(_stride * _height)) >> 3;
+            data0 = wirefb + size * 2 * phase;
+            data1 = data0 + size;
+            for (unsigned int n = size; n > 0; --n)
+                chainSend(*data0++, *data1++, pending);
         } else {
-            // The panels in this row are upside-down and reversed.
-            data0 = displayfb + _stride * (y + 16 - phase) - 1;
-            data1 = data0 - stride4;
-            data2 = data1 - stride4;
-            data3 = data2 - stride4;
-            for (int x = _stride; x > 0; --x) {
-                spiSend(pgm_read_byte(&(flipBits[*data3--])));
-                spiSend(pgm_read_byte(&(flipBits[*data2--])));
-                spiSend(pgm_read_byte(&(flipBits[*data1--])));
-                spiSend(pgm_read_byte(&(flipBits[*data0--])));
+            bool flipRow = ((chainHeight & 0x10) == 0);
+            for (int y = 0; y < chainHeight; y += 16) {
+                if (!flipRow) {
+                    data0 = src + _stride * (y + phase);
+                    data1 = data0 + stride4;
+                    data2 = data1 + stride4;
+                    data3 = data2 + stride4;
+                    for (int x = _stride; x > 0; --x) {
+                        chainSend(data3[0], data3[offset], pending);
+                        chainSend(data2[0], data2[offset], pending);
+                        chainSend(data1[0], data1[offset], pending);
+                        chainSend(data0[0], data0[offset], pending);
+                        ++data0;
+                        ++data1;
+                        ++data2;
+                        ++data3;
+                    }
+                    flipRow = true;
+                } else {
+                    data0 = src + _stride * (y + 16 - phase) - 1;
+                    data1 = data0 - stride4;
+                    data2 = data1 - stride4;
+                    data3 = data2 - stride4;
+                    for (int x = _stride; x > 0; --x) {
+                        chainSend(pgm_read_byte(&(flipBits[data3[0]])),
+                                  pgm_read_byte(&(flipBits[data3[offset]])), pending);
+                        chainSend(pgm_read_byte(&(flipBits[data2[0]])),
+                                  pgm_read_byte(&(flipBits[data2[offset]])), pending);
+                        chainSend(pgm_read_byte(&(flipBits[data1[0]])),
+                                  pgm_read_byte(&(flipBits[data1[offset]])), pending);
+                        chainSend(pgm_read_byte(&(flipBits[data0[0]])),
+                                  pgm_read_byte(&(flipBits[data0[offset]])), pending);
+                        --data0;
+                        --data1;
+                        --data2;
+                        --data3;
+                    }
+                    flipRow = false;
+                }
+            }
+        }
+        usartFlush();
+    } else
+#endif
+    if (wirefb) {
+        // The bytes for this phase are already in wire order.
+        unsigned int size = ((unsigned int)(_stride * _height)) >> 2;
+        data0 = wirefb + size * phase;
+        for (unsigned int n = size; n > 0; --n)
+            spiSend(*data0++, pending);
+    } else {
+        bool flipRow = ((_height & 0x10) == 0);
+        for (int y = 0; y < _height; y += 16) {
+            if (!flipRow) {
+                // The panels in this row are the right way up.
+                data0 = src + _stride * (y + phase);
+                data1 = data0 + stride4;
+                data2 = data1 + stride4;
+                data3 = data2 + stride4;
+                for (int x = _stride; x > 0; --x) {
+                    spiSend(*data3++, pending);
+                    spiSend(*data2++, pending);
+                    spiSend(*data1++, pending);
+                    spiSend(*data0++, pending);
+                }
+                flipRow = true;
+            } else {
+                // The panels in this row are upside-down and reversed.
+                data0 = src + _stride * (y + 16 - phase) - 1;
+                data1 = data0 - stride4;
+                data2 = data1 - stride4;
+                data3 = data2 - stride4;
+                for (int x = _stride; x > 0; --x) {
+                    spiSend(pgm_read_byte(&(flipBits[*data3--])), pending);
+                    spiSend(pgm_read_byte(&(flipBits[*data2--])), pending);
+                    spiSend(pgm_read_byte(&(flipBits[*data1--])), pending);
+                    spiSend(pgm_read_byte(&(flipBits[*data0--])), pending);
+                }
+                flipRow = false;
             }
-            flipRow = false;
         }
     }
 
+    // Wait for the last byte to be sent before latching it.
+    spiFlush(pending);
+
     // Latch the data from the shift registers onto the actual display.
-    digitalWrite(DMD_PIN_OUTPUT_ENABLE, LOW);
-    digitalWrite(DMD_PIN_LATCH, HIGH);
-    digitalWrite(DMD_PIN_LATCH, LOW);
+    // Interrupts are disabled while we modify the ports in case the
+    // application is using other pins on the same ports.
+    uint8_t oldSREG = SREG;
+    cli();
+    *enablePort &= ~enableMask;
+    *latchPort |= latchMask;
+    *latchPort &= ~latchMask;
     if (phase & 0x02)
-        digitalWrite(DMD_PIN_PHASE_MSB, HIGH);
+        *phaseMsbPort |= phaseMsbMask;
     else
-        digitalWrite(DMD_PIN_PHASE_MSB, LOW);
+        *phaseMsbPort &= ~phaseMsbMask;
     if (phase & 0x01)
-        digitalWrite(DMD_PIN_PHASE_LSB, HIGH);
+        *phaseLsbPort |= phaseLsbMask;
     else
-        digitalWrite(DMD_PIN_PHASE_LSB, LOW);
-    digitalWrite(DMD_PIN_OUTPUT_ENABLE, HIGH);
+        *phaseLsbPort &= ~phaseLsbMask;
+    *enablePort |= enableMask;
+    SREG = oldSREG;
+    if (_planes > 1) {
+        // Move on to the next bit plane, and then the next phase.
+        ticks = 1 << plane;
+        if (++plane < _planes)
+            return true;
+        plane = 0;
+    }
     phase = (phase + 1) & 0x03;
+    return true;
+}
+
+/**
+ * \fn bool DMD::refreshStatsEnabled() const
+ * \brief Returns true if refresh() is collecting timing statistics;
+ * false otherwise.  The default is false.
+ *
+ * \sa enableRefreshStats(), refreshStats()
+ */
+
+/**
+ * \brief Enables the collection of timing statistics by refresh().
+ *
+ * The statistics help size the number of panels that a particular CPU
+ * can drive, by measuring how much time refresh() takes out of each
+ * timer interrupt:
+ *
+ * \code
+ * DMDRefreshStats stats;
+ * display.enableRefreshStats();
+ * ...
+ * display.refreshStats(stats);
+ * Serial.print(stats.avgTime);
+ * Serial.print(" us per refresh, ");
+ * Serial.print(stats.rate);
+ * Serial.println(" refreshes per second");
+ * \endcode
+ *
+ * Collecting the statistics adds two calls to <tt>micros()</tt> to each
+ * refresh.  The statistics are reset when they are enabled.
+ *
+ * \sa disableRefreshStats(), refreshStats()
+ */
+void DMD::enableRefreshStats()
+{
+    resetRefreshStats();
+    statsEnabled = true;
 }
 
+/**
+ * \brief Disables the collection of timing statistics by refresh().
+ *
+ * The statistics that have already been collected are kept.
+ *
+ * \sa enableRefreshStats()
+ */
+void DMD::disableRefreshStats()
+{
+    statsEnabled = false;
+}
+
+/**
+ * \brief Gets the timing statistics for refresh() into \a stats.
+ *
+ * The times are measured with <tt>micros()</tt>, which has a resolution
+ * of 4 microseconds on 16 MHz boards.  Multiply by the CPU frequency in
+ * MHz for an approximate number of CPU cycles.
+ *
+ * \sa enableRefreshStats(), resetRefreshStats()
+ */
+void DMD::refreshStats(DMDRefreshStats &stats) const
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    stats.calls = statCalls;
+    stats.missed = statMissed;
+    stats.lastTime = statLast;
+    stats.maxTime = statMax;
+    unsigned long total = statTotal;
+    unsigned long start = statStart;
+    SREG = oldSREG;
+    stats.avgTime = stats.calls ? (total / stats.calls) : 0;
+    unsigned long period = micros() - start;
+    if (period >= 1000UL)
+        stats.rate = (unsigned long)(stats.calls * 1000000.0 / period);
+    else
+        stats.rate = 0;
+}
+
+/**
+ * \brief Resets the timing statistics for refresh().
+ *
+ * \sa refreshStats()
+ */
+void DMD::resetRefreshStats()
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    statCalls = 0;
+    statMissed = 0;
+    statLast = 0;
+    statMax = 0;
+    statTotal = 0;
+    statStart = micros();
+    SREG = oldSREG;
+}
+
+/**
+ * \class StaticDMD DMD.h <DMD.h>
+ * \brief Dot matrix display handler whose buffers are allocated
+ * statically at compile time.
+ *
+ * The \a WidthPanels and \a HeightPanels template parameters give the
+ * size of the display in panels.  If \a DoubleBuffer is true, then
+ * space is reserved for a back buffer and double-buffering is enabled.
+ * If \a WireOrder is true, then space is reserved for the wire-order
+ * shadow buffer and it is enabled.  The buffers are stored within the
+ * object itself, so a global StaticDMD never touches the heap and its
+ * memory usage is reported by the linker:
+ *
+ * \code
+ * StaticDMD<2, 1, true> display;
+ *
+ * void loop() {
+ *     display.clear();
+ *     display.drawText(0, 0, "Hello");
+ *     display.swapBuffers();
+ *     display.loop();
+ * }
+ * \endcode
+ *
+ * Double-buffering and the shadow buffer can still be turned off and
+ * on again at runtime with DMD::setDoubleBuffer() and DMD::setWireOrder().
+ *
+ * \sa DMD
+ */
+
+/**
+ * \fn StaticDMD::StaticDMD()
+ * \brief Constructs a new dot matrix display handler with static buffers.
+ */
+
+/**
+ * \class DMDRefreshStats DMD.h <DMD.h>
+ * \brief Timing statistics for DMD::refresh().
+ *
+ * \sa DMD::refreshStats()
+ */
+
+/**
+ * \var DMDRefreshStats::calls
+ * \brief Number of calls to DMD::refresh().
+ */
+
+/**
+ * \var DMDRefreshStats::missed
+ * \brief Number of calls that were skipped because the SPI bus was in use
+ * by another device.
+ */
+
+/**
+ * \var DMDRefreshStats::lastTime
+ * \brief Duration of the last call in microseconds.
+ */
+
+/**
+ * \var DMDRefreshStats::maxTime
+ * \brief Duration of the longest call in microseconds.
+ */
+
+/**
+ * \var DMDRefreshStats::avgTime
+ * \brief Average duration of each call in microseconds.
+ */
+
+/**
+ * \var DMDRefreshStats::rate
+ * \brief Number of calls per second.
+ */
+
 /**
  * \brief Enables Timer1 overflow interrupts for updating this display.
  *
@@ -562,8 +1649,10 @@ void DMD::refresh()
  */
 void DMD::enableTimer1()
 {
-    // Number of CPU cycles in the display's refresh period.
+    // Number of CPU cycles in the display's refresh period.  In greyscale
+    // mode, the period is divided into slices for the bit planes.
     unsigned long numCycles = (F_CPU / 2000000) * DMD_REFRESH_US;
+    numCycles /= (1 << _planes) - 1;
 
     // Determine the prescaler to be used.
     #define TIMER1_RESOLUTION  65536UL
@@ -25,10 +25,29 @@
 
 #include "Bitmap.h"
 
+class DisplayList;
+
+// Number of bytes of memory needed for one frame buffer of a display
+// that is widthPanels x heightPanels in size.
+#define DMD_BUFFER_SIZE(widthPanels, heightPanels) \
+    BITMAP_BUFFER_SIZE((widthPanels) * 32, (heightPanels) * 16)
+
+struct DMDRefreshStats
+{
+    unsigned long calls;
+    unsigned long missed;
+    unsigned long lastTime;
+    unsigned long maxTime;
+    unsigned long avgTime;
+    unsigned long rate;
+};
+
 class DMD : public Bitmap
 {
 public:
-    explicit DMD(int widthPanels = 1, int heightPanels = 1);
+    explicit DMD(int widthPanels = 1, int heightPanels = 1,
+                 uint8_t *buffer = 0, uint8_t *backBuffer = 0,
+                 uint8_t *wireBuffer = 0);
     ~DMD();
 
     bool doubleBuffer() const { return _doubleBuffer; }
@@ -36,9 +55,42 @@ public:
     void swapBuffers();
     void swapBuffersAndCopy();
 
+    void queueSwap(bool copy = false);
+    bool swapPending() const { return swapState == SwapQueued; }
+    void waitForSwap();
+
+    void queueDisplayList(const DisplayList *list);
+
+    typedef void (*FrameCallback)(DMD *display);
+    void setFrameCallback(FrameCallback callback) { frameCallback = callback; }
+
+    unsigned long frameCount() const;
+    unsigned long frameTime() const;
+    unsigned long maxFrameTime() const;
+    void resetFrameStats();
+
+    bool wireOrder() const { return wirefb != 0; }
+    void setWireOrder(bool wireOrder);
+    void updateWireOrder();
+
+    int chains() const { return _chains; }
+    void setChains(int chains);
+
+    int greyscaleBits() const { return _planes; }
+    void setGreyscaleBits(int bits);
+    void setDrawPlane(int plane);
+    uint8_t pixelLevel(int x, int y) const;
+    void setPixelLevel(int x, int y, uint8_t level);
+
     void loop();
     void refresh();
 
+    bool refreshStatsEnabled() const { return statsEnabled; }
+    void enableRefreshStats();
+    void disableRefreshStats();
+    void refreshStats(DMDRefreshStats &stats) const;
+    void resetRefreshStats();
+
     void enableTimer1();
     void disableTimer1();
 
@@ -52,12 +104,82 @@ private:
     DMD(const DMD &other) : Bitmap(other) {}
     DMD &operator=(const DMD &) { return *this; }
 
+    enum SwapState
+    {
+        SwapIdle,
+        SwapQueued,
+        SwapDone
+    };
+
     bool _doubleBuffer;
+    bool synced;
+    bool swapCopy;
+    volatile uint8_t swapState;
+    int swapTop;
+    int swapBottom;
+    const DisplayList *pendingList;
+    FrameCallback frameCallback;
+    unsigned long lastSwap;
+    unsigned long frames;
+    unsigned long _frameTime;
+    unsigned long _maxFrameTime;
     uint8_t phase;
     uint8_t *fb0;
     uint8_t *fb1;
     uint8_t *displayfb;
+    uint8_t *wirefb;
+    uint8_t *staticBack;
+    uint8_t *staticWire;
     unsigned long lastRefresh;
+    unsigned long sliceTime;
+    volatile uint8_t *latchPort;
+    volatile uint8_t *enablePort;
+    volatile uint8_t *phaseLsbPort;
+    volatile uint8_t *phaseMsbPort;
+    uint8_t latchMask;
+    uint8_t enableMask;
+    uint8_t phaseLsbMask;
+    uint8_t phaseMsbMask;
+    uint8_t _chains;
+    uint8_t _planes;
+    uint8_t plane;
+    uint8_t ticks;
+    uint8_t *lowPlanes[3];
+    bool statsEnabled;
+    unsigned long statCalls;
+    unsigned long statMissed;
+    unsigned long statLast;
+    unsigned long statMax;
+    unsigned long statTotal;
+    unsigned long statStart;
+
+    bool refreshSlice();
+    void dirtyRange(int &top, int &bottom) const;
+    void exchangeBuffers(bool copy);
+    void convertWireOrder(int top, int bottom);
+
+    uint8_t *planeBuffer(uint8_t index) const
+        { return index == (_planes - 1) ? fb0 : lowPlanes[index]; }
+};
+
+template <int WidthPanels = 1, int HeightPanels = 1,
+          bool DoubleBuffer = false, bool WireOrder = false>
+class StaticDMD : public DMD
+{
+public:
+    StaticDMD()
+        : DMD(WidthPanels, HeightPanels, buffers,
+              DoubleBuffer ? buffers + FrameSize : 0,
+              WireOrder ? buffers + FrameSize * (DoubleBuffer ? 2 : 1) : 0)
+    {
+        setDoubleBuffer(DoubleBuffer);
+        setWireOrder(WireOrder);
+    }
+
+private:
+    enum { FrameSize = DMD_BUFFER_SIZE(WidthPanels, HeightPanels) };
+
+    uint8_t buffers[FrameSize * (1 + DoubleBuffer + WireOrder)];
 };
 
 #endif
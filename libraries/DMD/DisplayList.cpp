@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DisplayList.h"
+#include <string.h>
+#include <stdlib.h>
+
+/**
+ * \class DisplayList DisplayList.h <DisplayList.h>
+ * \brief Records drawing commands for later replay into a Bitmap.
+ *
+ * Drawing into a DMD while refresh() is sending the same buffer from an
+ * interrupt can tear the image, and double buffering to avoid this needs
+ * a second copy of the framebuffer.  A display list instead records the
+ * commands for a frame in a few bytes, and DMD::queueDisplayList() has
+ * refresh() replay them into the framebuffer just before it starts the
+ * next refresh cycle:
+ *
+ * \code
+ * DisplayList list(64);
+ *
+ * void loop() {
+ *     list.clear();
+ *     list.setFont(DejaVuSans9);
+ *     list.drawText(0, 3, "Hello");
+ *     list.fill(0, 15, display.width(), 1, Bitmap::White);
+ *     display.queueDisplayList(&list);
+ *     display.waitForSwap();
+ * }
+ * \endcode
+ *
+ * Every list starts with a clear() of the destination.  The text for
+ * drawText() is copied into the list, but bitmaps and fonts are recorded
+ * as pointers into program memory.
+ *
+ * \sa DMD::queueDisplayList(), Bitmap
+ */
+
+// Command codes within the list.
+#define DL_CLEAR            0
+#define DL_SET_FONT         1
+#define DL_SET_TEXT_COLOR   2
+#define DL_FILL             3
+#define DL_DRAW_BITMAP      4
+#define DL_DRAW_RLE_BITMAP  5
+#define DL_DRAW_TEXT        6
+
+/**
+ * \brief Constructs a new display list with room for \a size bytes of
+ * commands.
+ *
+ * Each command takes between 2 and 10 bytes, plus the length of the
+ * text for drawText().
+ *
+ * \sa isValid()
+ */
+DisplayList::DisplayList(int size)
+    : buffer(0)
+    , _size(size)
+    , _length(0)
+{
+    if (size >= 2)
+        buffer = (uint8_t *)malloc(size);
+    if (!buffer)
+        _size = 0;
+    clear();
+}
+
+/**
+ * \brief Destroys this display list.
+ */
+DisplayList::~DisplayList()
+{
+    if (buffer)
+        free(buffer);
+}
+
+/**
+ * \fn bool DisplayList::isValid() const
+ * \brief Returns true if the memory for this display list is valid;
+ * false otherwise.
+ */
+
+/**
+ * \fn int DisplayList::size() const
+ * \brief Returns the maximum number of bytes of commands in this list.
+ *
+ * \sa length()
+ */
+
+/**
+ * \fn int DisplayList::length() const
+ * \brief Returns the number of bytes of commands that have been recorded.
+ *
+ * \sa size()
+ */
+
+/**
+ * \brief Discards all commands in the list and starts a new frame
+ * by recording a clear of the destination to \a color.
+ *
+ * \sa render()
+ */
+void DisplayList::clear(Bitmap::Color color)
+{
+    _length = 0;
+    uint8_t *cmd = reserve(DL_CLEAR, 1);
+    if (cmd)
+        cmd[0] = color;
+}
+
+/**
+ * \brief Records a change of the font for subsequent drawText() commands.
+ *
+ * Returns false if there is no room in the list.
+ *
+ * \sa drawText(), Bitmap::setFont()
+ */
+bool DisplayList::setFont(Bitmap::Font font)
+{
+    uint8_t *cmd = reserve(DL_SET_FONT, sizeof(font));
+    if (!cmd)
+        return false;
+    memcpy(cmd, &font, sizeof(font));
+    return true;
+}
+
+/**
+ * \brief Records a change of the color for subsequent drawText() commands.
+ *
+ * Returns false if there is no room in the list.
+ *
+ * \sa drawText(), Bitmap::setTextColor()
+ */
+bool DisplayList::setTextColor(Bitmap::Color color)
+{
+    uint8_t *cmd = reserve(DL_SET_TEXT_COLOR, 1);
+    if (!cmd)
+        return false;
+    cmd[0] = color;
+    return true;
+}
+
+// Stores a co-ordinate into a command.  Displays are never more than
+// 32767 pixels in size, so 16 bits is enough.
+static inline void putCoord(uint8_t *cmd, int value)
+{
+    int16_t coord = (int16_t)value;
+    memcpy(cmd, &coord, sizeof(coord));
+}
+
+static inline int getCoord(const uint8_t *cmd)
+{
+    int16_t coord;
+    memcpy(&coord, cmd, sizeof(coord));
+    return coord;
+}
+
+/**
+ * \brief Records a Bitmap::fill() of the \a width x \a height pixels
+ * starting at (\a x, \a y) with \a color.
+ *
+ * Returns false if there is no room in the list.
+ */
+bool DisplayList::fill(int x, int y, int width, int height, Bitmap::Color color)
+{
+    uint8_t *cmd = reserve(DL_FILL, 9);
+    if (!cmd)
+        return false;
+    putCoord(cmd, x);
+    putCoord(cmd + 2, y);
+    putCoord(cmd + 4, width);
+    putCoord(cmd + 6, height);
+    cmd[8] = color;
+    return true;
+}
+
+/**
+ * \brief Records a Bitmap::drawBitmap() of the program memory \a bitmap
+ * at (\a x, \a y) in \a color.
+ *
+ * Returns false if there is no room in the list.
+ *
+ * \sa drawRLEBitmap()
+ */
+bool DisplayList::drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Bitmap::Color color)
+{
+    uint8_t *cmd = reserve(DL_DRAW_BITMAP, 5 + sizeof(bitmap));
+    if (!cmd)
+        return false;
+    putCoord(cmd, x);
+    putCoord(cmd + 2, y);
+    cmd[4] = color;
+    memcpy(cmd + 5, &bitmap, sizeof(bitmap));
+    return true;
+}
+
+/**
+ * \brief Records a Bitmap::drawRLEBitmap() of the program memory \a bitmap
+ * at (\a x, \a y) in \a color.
+ *
+ * Returns false if there is no room in the list.
+ *
+ * \sa drawBitmap()
+ */
+bool DisplayList::drawRLEBitmap(int x, int y, Bitmap::ProgMem bitmap, Bitmap::Color color)
+{
+    uint8_t *cmd = reserve(DL_DRAW_RLE_BITMAP, 5 + sizeof(bitmap));
+    if (!cmd)
+        return false;
+    putCoord(cmd, x);
+    putCoord(cmd + 2, y);
+    cmd[4] = color;
+    memcpy(cmd + 5, &bitmap, sizeof(bitmap));
+    return true;
+}
+
+/**
+ * \brief Records a Bitmap::drawText() of the \a len characters of \a str
+ * at (\a x, \a y).
+ *
+ * If \a len is less than zero, then the actual length of \a str will be
+ * used.  The characters are copied into the list.  Returns false if there
+ * is no room in the list.
+ *
+ * \sa setFont(), setTextColor()
+ */
+bool DisplayList::drawText(int x, int y, const char *str, int len)
+{
+    if (len < 0)
+        len = strlen(str);
+    if (len > 255)
+        len = 255;
+    uint8_t *cmd = reserve(DL_DRAW_TEXT, 5 + len);
+    if (!cmd)
+        return false;
+    putCoord(cmd, x);
+    putCoord(cmd + 2, y);
+    cmd[4] = (uint8_t)len;
+    memcpy(cmd + 5, str, len);
+    return true;
+}
+
+/**
+ * \brief Replays the commands in this list into \a dest.
+ *
+ * The font and text color of \a dest are restored afterwards.
+ *
+ * \sa DMD::queueDisplayList()
+ */
+void DisplayList::render(Bitmap *dest) const
+{
+    Bitmap::Font oldFont = dest->font();
+    Bitmap::Color oldColor = dest->textColor();
+    const uint8_t *cmd = buffer;
+    const uint8_t *end = buffer + _length;
+    Bitmap::ProgMem bitmap;
+    Bitmap::Font font;
+    while (cmd < end) {
+        uint8_t op = *cmd++;
+        switch (op) {
+        case DL_CLEAR:
+            dest->clear(cmd[0]);
+            ++cmd;
+            break;
+        case DL_SET_FONT:
+            memcpy(&font, cmd, sizeof(font));
+            dest->setFont(font);
+            cmd += sizeof(font);
+            break;
+        case DL_SET_TEXT_COLOR:
+            dest->setTextColor(cmd[0]);
+            ++cmd;
+            break;
+        case DL_FILL:
+            dest->fill(getCoord(cmd), getCoord(cmd + 2),
+                       getCoord(cmd + 4), getCoord(cmd + 6), cmd[8]);
+            cmd += 9;
+            break;
+        case DL_DRAW_BITMAP:
+        case DL_DRAW_RLE_BITMAP:
+            memcpy(&bitmap, cmd + 5, sizeof(bitmap));
+            if (op == DL_DRAW_BITMAP)
+                dest->drawBitmap(getCoord(cmd), getCoord(cmd + 2), bitmap, cmd[4]);
+            else
+                dest->drawRLEBitmap(getCoord(cmd), getCoord(cmd + 2), bitmap, cmd[4]);
+            cmd += 5 + sizeof(bitmap);
+            break;
+        case DL_DRAW_TEXT:
+            dest->drawText(getCoord(cmd), getCoord(cmd + 2),
+                           (const char *)(cmd + 5), cmd[4]);
+            cmd += 5 + cmd[4];
+            break;
+        default:
+            cmd = end;
+            break;
+        }
+    }
+    dest->setFont(oldFont);
+    dest->setTextColor(oldColor);
+}
+
+// Reserves space for a command at the end of the list and returns a
+// pointer to its parameters, or null if there is no room.
+uint8_t *DisplayList::reserve(uint8_t op, int size)
+{
+    if ((_length + 1 + size) > _size)
+        return 0;
+    uint8_t *cmd = buffer + _length;
+    *cmd = op;
+    _length += 1 + size;
+    return cmd + 1;
+}
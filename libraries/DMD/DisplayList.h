@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DisplayList_h
+#define DisplayList_h
+
+#include "Bitmap.h"
+
+class DisplayList
+{
+public:
+    explicit DisplayList(int size);
+    ~DisplayList();
+
+    bool isValid() const { return buffer != 0; }
+
+    int size() const { return _size; }
+    int length() const { return _length; }
+
+    void clear(Bitmap::Color color = Bitmap::Black);
+
+    bool setFont(Bitmap::Font font);
+    bool setTextColor(Bitmap::Color color);
+
+    bool fill(int x, int y, int width, int height, Bitmap::Color color);
+    bool drawBitmap(int x, int y, Bitmap::ProgMem bitmap, Bitmap::Color color = Bitmap::White);
+    bool drawRLEBitmap(int x, int y, Bitmap::ProgMem bitmap, Bitmap::Color color = Bitmap::White);
+    bool drawText(int x, int y, const char *str, int len = -1);
+
+    void render(Bitmap *dest) const;
+
+private:
+    // Disable copy constructor and operator=().
+    DisplayList(const DisplayList &) {}
+    DisplayList &operator=(const DisplayList &) { return *this; }
+
+    uint8_t *buffer;
+    int _size;
+    int _length;
+
+    uint8_t *reserve(uint8_t op, int size);
+};
+
+#endif
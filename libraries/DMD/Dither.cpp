@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Dither.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \class Dither Dither.h <Dither.h>
+ * \brief Converts rows of greyscale or RGB pixels into monochrome with
+ * dithering.
+ *
+ * DMD::fromRGB() maps a single color to \ref Bitmap::White or
+ * \ref Bitmap::Black with a simple threshold, which turns photographs and
+ * gradients into solid blobs.  Dither instead spreads the difference
+ * between each pixel's brightness and the displayed color over the
+ * nearby pixels so that areas of intermediate brightness come out
+ * as patterns of lit and unlit pixels.
+ *
+ * Images are converted one row at a time from top to bottom, so an image
+ * can be streamed from an SD card or a serial port without holding all
+ * of it in memory:
+ *
+ * \code
+ * Dither dither(display.width());
+ * uint8_t rgb[32 * 3];
+ *
+ * for (int y = 0; y < display.height(); ++y) {
+ *     file.read(rgb, sizeof(rgb));
+ *     dither.drawRGBRow(&display, 0, y, rgb);
+ * }
+ * \endcode
+ *
+ * convertRow() and convertRGBRow() produce the packed rows of the format
+ * that is drawn by Bitmap::drawBitmap(), with 1 bits for lit pixels, for
+ * applications that want to store the result.  Images that are known
+ * ahead of time should instead be converted on the host with the
+ * <tt>gen/gendither</tt> tool, which uses the same arithmetic and so
+ * produces identical output.
+ *
+ * Three methods are supported: \ref Threshold compares each pixel
+ * against threshold(), \ref Ordered compares against a 4x4 Bayer matrix
+ * to produce a regular cross-hatched pattern, and \ref FloydSteinberg
+ * diffuses the error to the neighbouring pixels for the most detail.
+ * Floyd-Steinberg and ordered dithering carry state from one row to the
+ * next, so call reset() before starting on a new image.
+ *
+ * \sa Bitmap::drawBitmap(), DMD::fromRGB()
+ */
+
+/**
+ * \enum Dither::Method
+ * \brief Dithering method to use when converting pixels.
+ */
+
+/**
+ * \var Dither::Threshold
+ * \brief Pixels at or above threshold() are lit, with no dithering.
+ */
+
+/**
+ * \var Dither::Ordered
+ * \brief Pixels are compared against a 4x4 Bayer matrix that is
+ * centered on threshold().
+ */
+
+/**
+ * \var Dither::FloydSteinberg
+ * \brief The error for each pixel is diffused to the pixel on its right
+ * and the three pixels below it according to the Floyd-Steinberg weights.
+ */
+
+// 4x4 Bayer matrix for ordered dithering.
+static uint8_t const bayer[16] PROGMEM = {
+     0,  8,  2, 10,
+    12,  4, 14,  6,
+     3, 11,  1,  9,
+    15,  7, 13,  5
+};
+
+/**
+ * \brief Constructs a new converter for rows that are \a width pixels
+ * across, using the dithering \a method.
+ *
+ * \sa isValid(), setMethod()
+ */
+Dither::Dither(int width, Method method)
+    : _width(width)
+    , _row(0)
+    , _method(method)
+    , _threshold(128)
+    , errors(0)
+    , line(0)
+{
+    // Allocate the error row for Floyd-Steinberg with a spare entry at
+    // each end, followed by one packed row for drawRow().
+    unsigned int errorSize = (width + 2) * sizeof(int16_t);
+    uint8_t *buffer = (uint8_t *)malloc(errorSize + (width + 7) / 8);
+    if (buffer) {
+        errors = (int16_t *)buffer;
+        line = buffer + errorSize;
+        memset(errors, 0, errorSize);
+    }
+}
+
+/**
+ * \brief Destroys this converter.
+ */
+Dither::~Dither()
+{
+    free(errors);
+}
+
+/**
+ * \fn bool Dither::isValid() const
+ * \brief Returns true if the memory for this converter was allocated
+ * successfully; false otherwise.
+ */
+
+/**
+ * \fn int Dither::width() const
+ * \brief Returns the number of pixels in each row.
+ */
+
+/**
+ * \fn int Dither::row() const
+ * \brief Returns the number of rows that have been converted since the
+ * last call to reset().
+ */
+
+/**
+ * \fn Dither::Method Dither::method() const
+ * \brief Returns the dithering method; the default is \ref FloydSteinberg.
+ *
+ * \sa setMethod()
+ */
+
+/**
+ * \brief Sets the dithering \a method and resets the converter to the
+ * start of an image.
+ *
+ * \sa method(), reset()
+ */
+void Dither::setMethod(Method method)
+{
+    _method = method;
+    reset();
+}
+
+/**
+ * \fn uint8_t Dither::threshold() const
+ * \brief Returns the brightness level from 0 to 255 at which pixels
+ * are lit; the default is 128.
+ *
+ * \sa setThreshold()
+ */
+
+/**
+ * \fn void Dither::setThreshold(uint8_t threshold)
+ * \brief Sets the brightness level from 0 to 255 at which pixels are lit.
+ *
+ * Lower values make the image brighter.
+ *
+ * \sa threshold()
+ */
+
+/**
+ * \brief Resets the converter to the start of a new image.
+ */
+void Dither::reset()
+{
+    _row = 0;
+    if (errors)
+        memset(errors, 0, (_width + 2) * sizeof(int16_t));
+}
+
+/**
+ * \brief Converts the width() bytes of greyscale pixels in \a grey into
+ * the next row of \a packed monochrome pixels.
+ *
+ * The \a packed row is (width() + 7) / 8 bytes in size, with the leftmost
+ * pixel in the high bit of the first byte and 1 for lit pixels, which is
+ * the same layout as each row of a bitmap for Bitmap::drawBitmap().
+ *
+ * \sa convertRGBRow(), drawRow()
+ */
+void Dither::convertRow(uint8_t *packed, const uint8_t *grey)
+{
+    convert(packed, grey, 1);
+}
+
+/**
+ * \brief Converts the width() RGB pixels in \a rgb into the next row of
+ * \a packed monochrome pixels.
+ *
+ * The \a rgb buffer contains 3 bytes per pixel in the order red, green,
+ * and blue, which are converted into greyscale with luminance().
+ *
+ * \sa convertRow(), drawRGBRow()
+ */
+void Dither::convertRGBRow(uint8_t *packed, const uint8_t *rgb)
+{
+    convert(packed, rgb, 3);
+}
+
+/**
+ * \brief Converts the width() bytes of greyscale pixels in \a grey and
+ * draws them into \a dest at (\a x, \a y).
+ *
+ * Lit pixels are drawn in \a color and the others in the inverse of
+ * \a color.  Pixels that fall outside \a dest are clipped.
+ *
+ * \sa convertRow(), drawRGBRow()
+ */
+void Dither::drawRow(Bitmap *dest, int x, int y, const uint8_t *grey, Bitmap::Color color)
+{
+    if (!line)
+        return;
+    convert(line, grey, 1);
+    draw(dest, x, y, color);
+}
+
+/**
+ * \brief Converts the width() RGB pixels in \a rgb and draws them into
+ * \a dest at (\a x, \a y).
+ *
+ * \sa convertRGBRow(), drawRow()
+ */
+void Dither::drawRGBRow(Bitmap *dest, int x, int y, const uint8_t *rgb, Bitmap::Color color)
+{
+    if (!line)
+        return;
+    convert(line, rgb, 3);
+    draw(dest, x, y, color);
+}
+
+/**
+ * \brief Returns the brightness from 0 to 255 of the color (\a r, \a g, \a b).
+ *
+ * The components are weighted as for ITU-R BT.601 luma.
+ */
+uint8_t Dither::luminance(uint8_t r, uint8_t g, uint8_t b)
+{
+    return (uint8_t)((r * 77U + g * 150U + b * 29U) >> 8);
+}
+
+// Converts a row of pixels that are "step" bytes apart into packed form.
+void Dither::convert(uint8_t *packed, const uint8_t *data, uint8_t step)
+{
+    uint8_t value = 0;
+    uint8_t mask = 0x80;
+    int16_t right = 0;
+    int16_t diag = 0;
+    const uint8_t *pattern = bayer + (_row & 3) * 4;
+    Method method = _method;
+    if (!errors)
+        method = (method == Ordered) ? Ordered : Threshold;
+    else
+        errors[0] = 0;      // Discard the error pushed off the left edge.
+    for (int x = 0; x < _width; ++x, data += step) {
+        int16_t level;
+        if (step == 3)
+            level = luminance(data[0], data[1], data[2]);
+        else
+            level = data[0];
+        bool lit;
+        if (method == FloydSteinberg) {
+            // Diffuse the error by 7/16 to the right, and 3/16, 5/16, and
+            // 1/16 to the pixels below-left, below, and below-right.
+            level += errors[x + 1] + right;
+            lit = (level >= _threshold);
+            int16_t error = level - (lit ? 255 : 0);
+            right = (error * 7) / 16;
+            errors[x] += (error * 3) / 16;
+            errors[x + 1] = (error * 5) / 16 + diag;
+            diag = error / 16;
+        } else if (method == Ordered) {
+            int16_t limit = pgm_read_byte(pattern + (x & 3)) * 16 + 8 +
+                            _threshold - 128;
+            lit = (level >= limit);
+        } else {
+            lit = (level >= _threshold);
+        }
+        if (lit)
+            value |= mask;
+        mask >>= 1;
+        if (!mask) {
+            *packed++ = value;
+            value = 0;
+            mask = 0x80;
+        }
+    }
+    if (mask != 0x80)
+        *packed = value;
+    ++_row;
+}
+
+// Draws the packed row in "line" into the destination bitmap.
+void Dither::draw(Bitmap *dest, int x, int y, Bitmap::Color color)
+{
+    Bitmap::Color invColor = !color;
+    for (int bx = 0; bx < _width; ++bx) {
+        if (line[bx >> 3] & (0x80 >> (bx & 7)))
+            dest->setPixel(x + bx, y, color);
+        else
+            dest->setPixel(x + bx, y, invColor);
+    }
+}
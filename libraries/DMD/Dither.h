@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef Dither_h
+#define Dither_h
+
+#include "Bitmap.h"
+
+class Dither
+{
+public:
+    enum Method
+    {
+        Threshold,
+        Ordered,
+        FloydSteinberg
+    };
+
+    explicit Dither(int width, Method method = FloydSteinberg);
+    ~Dither();
+
+    bool isValid() const { return errors != 0; }
+
+    int width() const { return _width; }
+    int row() const { return _row; }
+
+    Method method() const { return _method; }
+    void setMethod(Method method);
+
+    uint8_t threshold() const { return _threshold; }
+    void setThreshold(uint8_t threshold) { _threshold = threshold; }
+
+    void reset();
+
+    void convertRow(uint8_t *packed, const uint8_t *grey);
+    void convertRGBRow(uint8_t *packed, const uint8_t *rgb);
+
+    void drawRow(Bitmap *dest, int x, int y, const uint8_t *grey, Bitmap::Color color = Bitmap::White);
+    void drawRGBRow(Bitmap *dest, int x, int y, const uint8_t *rgb, Bitmap::Color color = Bitmap::White);
+
+    static uint8_t luminance(uint8_t r, uint8_t g, uint8_t b);
+
+private:
+    // Disable copy constructor and operator=().
+    Dither(const Dither &) {}
+    Dither &operator=(const Dither &) { return *this; }
+
+    int _width;
+    int _row;
+    Method _method;
+    uint8_t _threshold;
+    int16_t *errors;
+    uint8_t *line;
+
+    void convert(uint8_t *packed, const uint8_t *data, uint8_t step);
+    void draw(Bitmap *dest, int x, int y, Bitmap::Color color);
+};
+
+#endif
@@ -0,0 +1,616 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "HUB75DMD.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <pins_arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include <stdlib.h>
+
+/**
+ * \class HUB75DMD HUB75DMD.h <HUB75DMD.h>
+ * \brief Handle RGB LED matrix panels with a HUB75 interface.
+ *
+ * This class drives the common 32x16 RGB LED matrix panels with a HUB75
+ * connector and 1/8 scan; i.e. rows y and y + 8 of each panel are lit at
+ * the same time.  Each panel has separate red, green, and blue shift
+ * registers for the top and bottom halves, which are loaded in parallel
+ * from six data pins.
+ *
+ * \section hub75_drawing Drawing
+ *
+ * HUB75DMD inherits from Bitmap, so all of the usual drawing functions
+ * are available.  The Bitmap acts as a one-bit stencil: shapes and text
+ * are drawn into it in \ref White as with DMD, and then paint() copies
+ * the drawn pixels into the display in a specific color and clears the
+ * stencil for the next shape:
+ *
+ * \code
+ * #include <HUB75DMD.h>
+ * #include <DejaVuSans9.h>
+ *
+ * HUB75DMD display;
+ *
+ * void setup() {
+ *     display.drawCircle(16, 8, 6);
+ *     display.paint(255, 0, 0);       // Red circle.
+ *     display.setFont(DejaVuSans9);
+ *     display.drawText(2, 3, "Hi");
+ *     display.paint(0, 255, 255);     // Cyan text.
+ * }
+ *
+ * void loop() {
+ *     display.loop();
+ * }
+ * \endcode
+ *
+ * Only the rows that were drawn to since the last paint() are examined,
+ * as reported by Bitmap::dirtyTop() and Bitmap::dirtyBottom().
+ * The setPixelColor(), fillColor(), and clearColor() functions modify the
+ * colors on the display directly.
+ *
+ * \section hub75_color Color depth
+ *
+ * Each of the red, green, and blue components is stored with 1 to 4 bits
+ * of brightness, as set by setColorBits().  The default is 2 bits, for
+ * 64 colors.  refresh() shows the bits with binary code modulation,
+ * displaying bit N for 2^N times as long as bit 0, so the refresh calls
+ * become more frequent as the number of bits increases.  Each bit takes
+ * 256 bytes of memory per panel.
+ *
+ * \section hub75_refresh Display refresh
+ *
+ * As with DMD, the display must either be refreshed by calling loop()
+ * regularly or by calling refresh() from the Timer1 overflow interrupt:
+ *
+ * \code
+ * HUB75DMD display;
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     display.setColorBits(4);
+ *     display.enableTimer1();
+ * }
+ * \endcode
+ *
+ * Call setColorBits() before enableTimer1() because the timer period
+ * depends upon the number of bits.
+ *
+ * \section hub75_wiring Wiring
+ *
+ * The six data lines must be on bits 2 to 7 of the same AVR port, so that
+ * refresh() can output all of them with a single write for each column.
+ * The framebuffer is stored in that layout so that no conversion is needed
+ * while refreshing.  The defaults are:
+ *
+ * <table>
+ * <tr><td>Signal</td><td>Uno</td><td>Mega</td></tr>
+ * <tr><td>R1, G1, B1</td><td>D2, D3, D4</td><td>D24, D25, D26</td></tr>
+ * <tr><td>R2, G2, B2</td><td>D5, D6, D7</td><td>D27, D28, D29</td></tr>
+ * <tr><td>A, B, C</td><td>A0, A1, A2</td><td>A0, A1, A2</td></tr>
+ * <tr><td>CLK</td><td>D8</td><td>D11</td></tr>
+ * <tr><td>LAT</td><td>A3</td><td>D10</td></tr>
+ * <tr><td>OE</td><td>D9</td><td>D9</td></tr>
+ * </table>
+ *
+ * Multiple panels are daisy-chained with the panels for each row of the
+ * display further along the chain than the row below it.  Columns are
+ * shifted out from left to right.
+ *
+ * \sa DMD, Bitmap
+ */
+
+// Pins for the HUB75 signals.  R1 to B2 must be bits 2 to 7 of one port.
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define HUB75_PIN_R1        24
+#define HUB75_PIN_G1        25
+#define HUB75_PIN_B1        26
+#define HUB75_PIN_R2        27
+#define HUB75_PIN_G2        28
+#define HUB75_PIN_B2        29
+#define HUB75_PIN_CLK       11
+#define HUB75_PIN_LAT       10
+#else
+#define HUB75_PIN_R1        2
+#define HUB75_PIN_G1        3
+#define HUB75_PIN_B1        4
+#define HUB75_PIN_R2        5
+#define HUB75_PIN_G2        6
+#define HUB75_PIN_B2        7
+#define HUB75_PIN_CLK       8
+#define HUB75_PIN_LAT       A3
+#endif
+#define HUB75_PIN_OE        9
+#define HUB75_PIN_A         A0
+#define HUB75_PIN_B         A1
+#define HUB75_PIN_C         A2
+
+// Bits for the colors in each byte of the framebuffer.
+#define HUB75_DATA_MASK     0xFC
+#define HUB75_TOP_MASK      0x1C    // R1, G1, B1
+#define HUB75_BOTTOM_MASK   0xE0    // R2, G2, B2
+
+// Panel dimension information.
+#define HUB75_NUM_COLUMNS   32      // Number of columns in a panel.
+#define HUB75_NUM_ROWS      16      // Number of rows in a panel.
+#define HUB75_SCAN_ROWS     8       // Number of rows driven in turn.
+
+// Refresh period for all rows and bits of the display.
+#define HUB75_REFRESH_US    10000
+
+/**
+ * \brief Constructs a new RGB display handler for a display that
+ * is \a widthPanels x \a heightPanels in size.
+ *
+ * \sa setColorBits()
+ */
+HUB75DMD::HUB75DMD(int widthPanels, int heightPanels)
+    : Bitmap(widthPanels * HUB75_NUM_COLUMNS, heightPanels * HUB75_NUM_ROWS)
+    , pixels(0)
+    , lineSize(widthPanels * heightPanels * HUB75_NUM_COLUMNS)
+    , _bits(0)
+    , row(0)
+    , plane(0)
+    , ticks(0)
+    , lastRefresh(millis())
+{
+    // Initialize the pins, with the output disabled.
+    static const uint8_t dataPins[] = {
+        HUB75_PIN_R1, HUB75_PIN_G1, HUB75_PIN_B1,
+        HUB75_PIN_R2, HUB75_PIN_G2, HUB75_PIN_B2
+    };
+    for (uint8_t index = 0; index < sizeof(dataPins); ++index) {
+        pinMode(dataPins[index], OUTPUT);
+        digitalWrite(dataPins[index], LOW);
+    }
+    pinMode(HUB75_PIN_CLK, OUTPUT);
+    pinMode(HUB75_PIN_LAT, OUTPUT);
+    pinMode(HUB75_PIN_OE, OUTPUT);
+    pinMode(HUB75_PIN_A, OUTPUT);
+    pinMode(HUB75_PIN_B, OUTPUT);
+    pinMode(HUB75_PIN_C, OUTPUT);
+    digitalWrite(HUB75_PIN_CLK, LOW);
+    digitalWrite(HUB75_PIN_LAT, LOW);
+    digitalWrite(HUB75_PIN_OE, HIGH);
+    digitalWrite(HUB75_PIN_A, LOW);
+    digitalWrite(HUB75_PIN_B, LOW);
+    digitalWrite(HUB75_PIN_C, LOW);
+
+    // Look up the port registers so that refresh() doesn't need to
+    // go through digitalWrite().
+    dataPort = portOutputRegister(digitalPinToPort(HUB75_PIN_R1));
+    clockPort = portOutputRegister(digitalPinToPort(HUB75_PIN_CLK));
+    latchPort = portOutputRegister(digitalPinToPort(HUB75_PIN_LAT));
+    enablePort = portOutputRegister(digitalPinToPort(HUB75_PIN_OE));
+    addrPort[0] = portOutputRegister(digitalPinToPort(HUB75_PIN_A));
+    addrPort[1] = portOutputRegister(digitalPinToPort(HUB75_PIN_B));
+    addrPort[2] = portOutputRegister(digitalPinToPort(HUB75_PIN_C));
+    clockMask = digitalPinToBitMask(HUB75_PIN_CLK);
+    latchMask = digitalPinToBitMask(HUB75_PIN_LAT);
+    enableMask = digitalPinToBitMask(HUB75_PIN_OE);
+    addrMask[0] = digitalPinToBitMask(HUB75_PIN_A);
+    addrMask[1] = digitalPinToBitMask(HUB75_PIN_B);
+    addrMask[2] = digitalPinToBitMask(HUB75_PIN_C);
+
+    // Allocate the color framebuffer.
+    setColorBits(2);
+}
+
+/**
+ * \brief Destroys this RGB display handler.
+ */
+HUB75DMD::~HUB75DMD()
+{
+    if (pixels)
+        free(pixels);
+}
+
+/**
+ * \fn int HUB75DMD::colorBits() const
+ * \brief Returns the number of bits of brightness for each of the red,
+ * green, and blue components; between 1 and 4.  The default is 2.
+ *
+ * \sa setColorBits()
+ */
+
+/**
+ * \brief Sets the number of bits of brightness for each of the red,
+ * green, and blue components to \a bits, between 1 and 4.
+ *
+ * The display is cleared to black.  If there is insufficient memory for
+ * \a bits, then this function will fall back to 1 bit.  If Timer1 is
+ * being used to refresh the display, then enableTimer1() must be called
+ * again afterwards.
+ *
+ * \sa colorBits(), enableTimer1()
+ */
+void HUB75DMD::setColorBits(int bits)
+{
+    if (bits < 1)
+        bits = 1;
+    else if (bits > 4)
+        bits = 4;
+
+    // Stop refresh() using the old framebuffer before it is freed.
+    uint8_t *buffer = pixels;
+    cli();
+    pixels = 0;
+    row = 0;
+    plane = 0;
+    ticks = 0;
+    sei();
+    if (buffer)
+        free(buffer);
+
+    unsigned int size = lineSize * HUB75_SCAN_ROWS;
+    buffer = (uint8_t *)malloc(size * bits);
+    if (!buffer) {
+        bits = 1;
+        buffer = (uint8_t *)malloc(size);
+    }
+    if (buffer)
+        memset(buffer, 0, size * bits);
+    cli();
+    pixels = buffer;
+    _bits = buffer ? bits : 0;
+    sei();
+}
+
+/**
+ * \brief Paints all \ref White pixels in the stencil bitmap onto the
+ * display with the color (\a r, \a g, \a b) and then clears the stencil
+ * to \ref Black.
+ *
+ * Only the rows between dirtyTop() and dirtyBottom() are examined.
+ *
+ * \sa setPixelColor(), fillColor()
+ */
+void HUB75DMD::paint(uint8_t r, uint8_t g, uint8_t b)
+{
+    if (!isDirty())
+        return;
+    uint8_t values[4];
+    colorPlanes(r, g, b, values);
+    unsigned int planeSize = lineSize * HUB75_SCAN_ROWS;
+    for (int y = dirtyTop(); y <= dirtyBottom(); ++y) {
+        uint8_t *line = data() + y * stride();
+        for (int bx = 0; bx < stride(); ++bx) {
+            uint8_t set = ~line[bx];
+            if (!set)
+                continue;
+            line[bx] = 0xFF;
+            if (!pixels)
+                continue;
+            for (uint8_t bit = 0; bit < 8; ++bit) {
+                if (!(set & (0x80 >> bit)))
+                    continue;
+                uint8_t chanMask;
+                uint8_t *ptr = pixelByte(bx * 8 + bit, y, chanMask);
+                for (uint8_t index = 0; index < _bits; ++index) {
+                    *ptr = (*ptr & ~chanMask) | (values[index] & chanMask);
+                    ptr += planeSize;
+                }
+            }
+        }
+    }
+    clearDirty();
+}
+
+/**
+ * \brief Gets the color of the pixel at (\a x, \a y) into \a r, \a g,
+ * and \a b, scaled to the range 0 to 255.
+ *
+ * Pixels that are off the display are returned as black.
+ *
+ * \sa setPixelColor()
+ */
+void HUB75DMD::pixelColor(int x, int y, uint8_t &r, uint8_t &g, uint8_t &b) const
+{
+    r = g = b = 0;
+    if (((unsigned int)x) >= ((unsigned int)width()) ||
+            ((unsigned int)y) >= ((unsigned int)height()) || !pixels)
+        return;
+    uint8_t chanMask;
+    const uint8_t *ptr = pixelByte(x, y, chanMask);
+    uint8_t shift = (chanMask == HUB75_TOP_MASK) ? 2 : 5;
+    unsigned int planeSize = lineSize * HUB75_SCAN_ROWS;
+    for (uint8_t index = 0; index < _bits; ++index) {
+        uint8_t value = *ptr >> shift;
+        r |= (value & 0x01) << index;
+        g |= ((value >> 1) & 0x01) << index;
+        b |= ((value >> 2) & 0x01) << index;
+        ptr += planeSize;
+    }
+    uint8_t max = (1 << _bits) - 1;
+    r = r * 255 / max;
+    g = g * 255 / max;
+    b = b * 255 / max;
+}
+
+/**
+ * \brief Sets the pixel at (\a x, \a y) to the color (\a r, \a g, \a b).
+ *
+ * Only the most significant colorBits() bits of each component are used.
+ *
+ * \sa pixelColor(), fillColor(), paint()
+ */
+void HUB75DMD::setPixelColor(int x, int y, uint8_t r, uint8_t g, uint8_t b)
+{
+    fillColor(x, y, 1, 1, r, g, b);
+}
+
+/**
+ * \brief Fills the \a width x \a height pixels starting at top-left
+ * corner (\a x, \a y) with the color (\a r, \a g, \a b).
+ *
+ * \sa clearColor(), setPixelColor()
+ */
+void HUB75DMD::fillColor(int x, int y, int width, int height, uint8_t r, uint8_t g, uint8_t b)
+{
+    // Clamp the fill region to the extents of the display.
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if ((x + width) > this->width())
+        width = this->width() - x;
+    if ((y + height) > this->height())
+        height = this->height() - y;
+    if (width <= 0 || height <= 0 || !pixels)
+        return;
+
+    uint8_t values[4];
+    colorPlanes(r, g, b, values);
+    unsigned int planeSize = lineSize * HUB75_SCAN_ROWS;
+    for (uint8_t index = 0; index < _bits; ++index) {
+        uint8_t value = values[index];
+        for (int py = y; py < (y + height); ++py) {
+            uint8_t chanMask;
+            uint8_t *ptr = pixelByte(x, py, chanMask) + index * planeSize;
+            for (int px = width; px > 0; --px, ++ptr)
+                *ptr = (*ptr & ~chanMask) | (value & chanMask);
+        }
+    }
+}
+
+/**
+ * \brief Clears the entire display to the color (\a r, \a g, \a b).
+ *
+ * The stencil bitmap is not affected; use Bitmap::clear() for that.
+ *
+ * \sa fillColor()
+ */
+void HUB75DMD::clearColor(uint8_t r, uint8_t g, uint8_t b)
+{
+    fillColor(0, 0, width(), height(), r, g, b);
+}
+
+/**
+ * \brief Performs regular display refresh activities from the
+ * application's main loop.
+ *
+ * \code
+ * HUB75DMD display;
+ *
+ * void loop() {
+ *     display.loop();
+ * }
+ * \endcode
+ *
+ * If you are using a timer interrupt service routine, then call
+ * refresh() in response to the interrupt instead of calling loop().
+ *
+ * \sa refresh()
+ */
+void HUB75DMD::loop()
+{
+    unsigned long currentTime = micros();
+    if ((currentTime - lastRefresh) >= sliceTime()) {
+        lastRefresh = currentTime;
+        refresh();
+    }
+}
+
+/**
+ * \brief Refresh the display.
+ *
+ * Each call shows the next bit of brightness for the next pair of rows,
+ * so this function must be called regularly at the rate given by the
+ * number of color bits.  It is usually called by loop(), but can also be
+ * called in response to a timer interrupt.
+ *
+ * The data for the new rows is shifted out while the previous rows are
+ * still lit, and then latched onto the display.
+ *
+ * \sa loop(), enableTimer1()
+ */
+void HUB75DMD::refresh()
+{
+    // Keep showing brightness bit N until it has been on for 2^N slices.
+    if (ticks > 1) {
+        --ticks;
+        return;
+    }
+    if (!pixels)
+        return;
+
+    // Shift out the six color bits for each column in parallel.  The other
+    // pins on the data and clock ports should not be modified by interrupt
+    // service routines while this is in progress.
+    const uint8_t *data = pixels + (plane * HUB75_SCAN_ROWS + row) * lineSize;
+    uint8_t other = *dataPort & ~HUB75_DATA_MASK;
+    uint8_t clockLow = *clockPort & ~clockMask;
+    uint8_t clockHigh = clockLow | clockMask;
+    for (int column = lineSize; column > 0; --column) {
+        *dataPort = other | *data++;
+        *clockPort = clockHigh;
+        *clockPort = clockLow;
+    }
+
+    // Latch the data onto the display and select the new rows.
+    // Interrupts are disabled while we modify the ports in case the
+    // application is using other pins on the same ports.
+    uint8_t oldSREG = SREG;
+    cli();
+    *enablePort |= enableMask;
+    for (uint8_t index = 0; index < 3; ++index) {
+        if (row & (1 << index))
+            *addrPort[index] |= addrMask[index];
+        else
+            *addrPort[index] &= ~addrMask[index];
+    }
+    *latchPort |= latchMask;
+    *latchPort &= ~latchMask;
+    *enablePort &= ~enableMask;
+    SREG = oldSREG;
+
+    // Move on to the next bit, and then the next pair of rows.
+    ticks = 1 << plane;
+    if (++plane >= _bits) {
+        plane = 0;
+        row = (row + 1) & (HUB75_SCAN_ROWS - 1);
+    }
+}
+
+/**
+ * \brief Enables Timer1 overflow interrupts for updating this display.
+ *
+ * The application must also provide an interrupt service routine for
+ * Timer1 that calls refresh():
+ *
+ * \code
+ * #include <HUB75DMD.h>
+ *
+ * HUB75DMD display;
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     display.enableTimer1();
+ * }
+ * \endcode
+ *
+ * If timer interrupts are being used to update the display, then it is
+ * unnecessary to call loop().
+ *
+ * \sa refresh(), disableTimer1(), setColorBits()
+ */
+void HUB75DMD::enableTimer1()
+{
+    // Number of CPU cycles in each refresh slice.
+    unsigned long numCycles = (F_CPU / 2000000) * sliceTime();
+
+    // Determine the prescaler to be used.
+    #define TIMER1_RESOLUTION  65536UL
+    uint8_t prescaler;
+    if (numCycles < TIMER1_RESOLUTION) {
+        // No prescaling required.
+        prescaler = _BV(CS10);
+    } else if (numCycles < TIMER1_RESOLUTION * 8) {
+        // Prescaler = 8.
+        prescaler = _BV(CS11);
+        numCycles >>= 3;
+    } else if (numCycles < TIMER1_RESOLUTION * 64) {
+        // Prescaler = 64.
+        prescaler = _BV(CS11) | _BV(CS10);
+        numCycles >>= 6;
+    } else if (numCycles < TIMER1_RESOLUTION * 256) {
+        // Prescaler = 256.
+        prescaler = _BV(CS12);
+        numCycles >>= 8;
+    } else {
+        // Prescaler = 1024.
+        prescaler = _BV(CS12) | _BV(CS10);
+        numCycles >>= 10;
+        if (numCycles >= TIMER1_RESOLUTION)
+            numCycles = TIMER1_RESOLUTION - 1;
+    }
+
+    // Configure Timer1 for the period we want.
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM13);
+    uint8_t saveSREG = SREG;
+    cli();
+    ICR1 = numCycles;
+    SREG = saveSREG;    // Implicit sei() if interrupts were on previously.
+    TCCR1B = (TCCR1B & ~(_BV(CS12) | _BV(CS11) | _BV(CS10))) | prescaler;
+
+    // Turn on the Timer1 overflow interrupt.
+    TIMSK1 |= _BV(TOIE1);
+}
+
+/**
+ * \brief Disables Timer1 overflow interrupts.
+ *
+ * \sa enableTimer1()
+ */
+void HUB75DMD::disableTimer1()
+{
+    // Turn off the Timer1 overflow interrupt.
+    TIMSK1 &= ~_BV(TOIE1);
+}
+
+// Returns a pointer to the framebuffer byte for the pixel at (x, y) in
+// the plane for bit 0, and the mask for the pixel's color bits.
+uint8_t *HUB75DMD::pixelByte(int x, int y, uint8_t &chanMask) const
+{
+    chanMask = (y & HUB75_SCAN_ROWS) ? HUB75_BOTTOM_MASK : HUB75_TOP_MASK;
+    return pixels + (y & (HUB75_SCAN_ROWS - 1)) * lineSize +
+           (y / HUB75_NUM_ROWS) * width() + x;
+}
+
+// Converts a color into the framebuffer byte values for each bit plane,
+// with the color in both the top and bottom halves.
+void HUB75DMD::colorPlanes(uint8_t r, uint8_t g, uint8_t b, uint8_t *values) const
+{
+    for (uint8_t index = 0; index < _bits; ++index) {
+        uint8_t shift = 8 - _bits + index;
+        uint8_t value = (((r >> shift) & 0x01) << 2) |
+                        (((g >> shift) & 0x01) << 3) |
+                        (((b >> shift) & 0x01) << 4);
+        values[index] = value | (value << 3);
+    }
+}
+
+// Returns the time in microseconds between calls to refresh().
+unsigned long HUB75DMD::sliceTime() const
+{
+    uint8_t bits = _bits ? _bits : 1;
+    return HUB75_REFRESH_US / (HUB75_SCAN_ROWS * ((1UL << bits) - 1));
+}
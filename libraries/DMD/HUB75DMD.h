@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HUB75DMD_h
+#define HUB75DMD_h
+
+#include "Bitmap.h"
+
+class HUB75DMD : public Bitmap
+{
+public:
+    explicit HUB75DMD(int widthPanels = 1, int heightPanels = 1);
+    ~HUB75DMD();
+
+    int colorBits() const { return _bits; }
+    void setColorBits(int bits);
+
+    void paint(uint8_t r, uint8_t g, uint8_t b);
+
+    void pixelColor(int x, int y, uint8_t &r, uint8_t &g, uint8_t &b) const;
+    void setPixelColor(int x, int y, uint8_t r, uint8_t g, uint8_t b);
+    void fillColor(int x, int y, int width, int height, uint8_t r, uint8_t g, uint8_t b);
+    void clearColor(uint8_t r = 0, uint8_t g = 0, uint8_t b = 0);
+
+    void loop();
+    void refresh();
+
+    void enableTimer1();
+    void disableTimer1();
+
+private:
+    // Disable copy constructor and operator=().
+    HUB75DMD(const HUB75DMD &other) : Bitmap(other) {}
+    HUB75DMD &operator=(const HUB75DMD &) { return *this; }
+
+    uint8_t *pixels;
+    int lineSize;
+    uint8_t _bits;
+    uint8_t row;
+    uint8_t plane;
+    uint8_t ticks;
+    unsigned long lastRefresh;
+    volatile uint8_t *dataPort;
+    volatile uint8_t *clockPort;
+    volatile uint8_t *latchPort;
+    volatile uint8_t *enablePort;
+    volatile uint8_t *addrPort[3];
+    uint8_t clockMask;
+    uint8_t latchMask;
+    uint8_t enableMask;
+    uint8_t addrMask[3];
+
+    uint8_t *pixelByte(int x, int y, uint8_t &chanMask) const;
+    void colorPlanes(uint8_t r, uint8_t g, uint8_t b, uint8_t *values) const;
+    unsigned long sliceTime() const;
+};
+
+#endif
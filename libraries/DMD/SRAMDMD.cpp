@@ -0,0 +1,800 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SRAMDMD.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <pins_arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include <stdlib.h>
+
+/**
+ * \class SRAMDMD SRAMDMD.h <SRAMDMD.h>
+ * \brief Handle large dot matrix displays with the frame buffer in
+ * external SPI SRAM.
+ *
+ * DMD keeps its frame buffer in main memory, which needs 64 bytes for
+ * every panel, or 128 bytes with double buffering.  A wall of 8 x 8 panels
+ * needs 4K for a single buffer and will not fit into an Arduino Uno at all.
+ * SRAMDMD instead keeps the frame buffer in a 23LC1024 128K serial SRAM
+ * that is connected to the same SPI bus as the panels; only the chip select
+ * pin of the SRAM needs to be supplied:
+ *
+ * \code
+ * #include <SRAMDMD.h>
+ *
+ * SRAMDMD display(A0, 8, 8);   // SRAM select on A0; 8 x 8 panels.
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     display.enableTimer1();
+ *     display.fill(0, 0, 128, 16, Bitmap::White);
+ *     display.flush();
+ * }
+ * \endcode
+ *
+ * The frame buffer is stored in the SRAM in the exact order and bit
+ * orientation that the panels expect, like the wire-order shadow buffer of
+ * DMD::setWireOrder().  refresh() starts a sequential read from the SRAM
+ * and sends each byte to the panels while the next byte is being read,
+ * so the data streams from the SRAM to the panels without passing through
+ * main memory.  The SRAM's command and address bytes are also shifted into
+ * the panels, but they fall off the end of the chain before the data is
+ * latched.
+ *
+ * Drawing operations go through a write-back cache of SRAMDMD_CACHE_LINES
+ * lines in main memory, where each line holds four rows of the display
+ * (width() / 2 bytes).  Changes only become visible once the cached lines
+ * have been written back to the SRAM, so call flush() after drawing or
+ * use double buffering, where swapBuffers() flushes the cache.
+ *
+ * SRAMDMD only provides a small set of drawing primitives.  Text and other
+ * complex shapes can be drawn into a small Bitmap in main memory and then
+ * copied onto the display with drawBitmap():
+ *
+ * \code
+ * Bitmap strip(64, 16);
+ * strip.setFont(DejaVuSans9);
+ * strip.clear();
+ * strip.drawText(0, 0, "Hello");
+ * display.drawBitmap(32, 48, strip);
+ * display.flush();
+ * \endcode
+ *
+ * refresh() does nothing if the SRAM is selected when it is called from
+ * an interrupt, so the drawing functions can be used at any time.  The
+ * transfers to and from the SRAM are broken up into lines for the same
+ * reason, which keeps refresh() from being held off for long.  Refreshes
+ * that are skipped will show up as a slight dimming of the display while
+ * the application is drawing heavily.
+ *
+ * SRAMDMD does not support multiple chains or greyscale.
+ *
+ * \sa DMD, Bitmap
+ */
+
+// Pins on the DMD connector board.
+#define DMD_PIN_PHASE_LSB       6       // A
+#define DMD_PIN_PHASE_MSB       7       // B
+#define DMD_PIN_LATCH           8       // SCLK
+#define DMD_PIN_OUTPUT_ENABLE   9       // nOE
+#define DMD_PIN_SPI_SS          SS      // SPI Slave Select
+#define DMD_PIN_SPI_MOSI        MOSI    // SPI Master Out, Slave In (R)
+#define DMD_PIN_SPI_MISO        MISO    // SPI Master In, Slave Out
+#define DMD_PIN_SPI_SCK         SCK     // SPI Serial Clock (CLK)
+
+// Dimension information for the display.
+#define DMD_NUM_COLUMNS         32      // Number of columns in a panel.
+#define DMD_NUM_ROWS            16      // Number of rows in a panel.
+
+// Refresh times.
+#define DMD_REFRESH_MS          5
+#define DMD_REFRESH_US          5000
+
+// Commands and size of the 23LC1024 serial SRAM.
+#define SRAM_CMD_READ           0x03
+#define SRAM_CMD_WRITE          0x02
+#define SRAM_CMD_WRITE_MODE     0x01
+#define SRAM_MODE_SEQUENTIAL    0x40
+#define SRAM_SIZE               131072UL
+
+// Transfers a byte over SPI and returns the byte that was received.
+static inline uint8_t spiTransfer(uint8_t value)
+{
+    SPDR = value;
+    while (!(SPSR & _BV(SPIF)))
+        ;   // Wait for the transfer to complete.
+    return SPDR;
+}
+
+// Flip the bits in a byte.
+static inline uint8_t flipBits(uint8_t value)
+{
+    value = (value >> 4) | (value << 4);
+    value = ((value & 0xCC) >> 2) | ((value & 0x33) << 2);
+    return ((value & 0xAA) >> 1) | ((value & 0x55) << 1);
+}
+
+// Sets count bits in a row starting at bit x to 0 or 1 according to value.
+static void fillBits(uint8_t *row, int x, int count, uint8_t value)
+{
+    row += x >> 3;
+    uint8_t bit = x & 7;
+    int last = (bit + count - 1) >> 3;
+    uint8_t firstMask = 0xFF >> bit;
+    uint8_t lastMask = 0xFF << (7 - ((bit + count - 1) & 7));
+    if (!last) {
+        firstMask &= lastMask;
+    } else {
+        memset(row + 1, value, last - 1);
+        row[last] = (row[last] & ~lastMask) | (value & lastMask);
+    }
+    row[0] = (row[0] & ~firstMask) | (value & firstMask);
+}
+
+/**
+ * \brief Constructs a new dot matrix display handler for a display that
+ * is \a widthPanels x \a heightPanels in size, with the frame buffer in
+ * the SRAM that is selected by \a csPin.
+ *
+ * The display is cleared to \ref Bitmap::Black "Black".  If there is
+ * insufficient main memory for the line cache, or the display is too
+ * large for the SRAM, then isValid() will return false.
+ *
+ * \sa isValid(), width(), height()
+ */
+SRAMDMD::SRAMDMD(uint8_t csPin, int widthPanels, int heightPanels)
+    : _width(widthPanels * DMD_NUM_COLUMNS)
+    , _height(heightPanels * DMD_NUM_ROWS)
+    , _stride((_width + 7) / 8)
+    , lineSize(_stride * 4)
+    , frameSize(((unsigned long)_stride) * _height)
+    , drawBase(0)
+    , displayBase(0)
+    , _doubleBuffer(false)
+    , phase(0)
+    , _csPin(csPin)
+    , useCount(0)
+    , lastRefresh(millis())
+    , cacheData(0)
+{
+    // Allocate memory for the line cache.
+    if (frameSize <= SRAM_SIZE)
+        cacheData = (uint8_t *)malloc(lineSize * SRAMDMD_CACHE_LINES);
+    for (uint8_t index = 0; index < SRAMDMD_CACHE_LINES; ++index) {
+        cache[index].data = cacheData ? cacheData + lineSize * index : 0;
+        cache[index].line = -1;
+        cache[index].dirty = false;
+        cache[index].used = 0;
+    }
+
+    // Initialize SPI to MSB-first, mode 0, clock divider = 2.
+    pinMode(DMD_PIN_SPI_SCK, OUTPUT);
+    pinMode(DMD_PIN_SPI_MOSI, OUTPUT);
+    pinMode(DMD_PIN_SPI_SS, OUTPUT);
+    pinMode(_csPin, OUTPUT);
+    digitalWrite(DMD_PIN_SPI_SCK, LOW);
+    digitalWrite(DMD_PIN_SPI_MOSI, LOW);
+    digitalWrite(DMD_PIN_SPI_SS, HIGH);
+    digitalWrite(_csPin, HIGH);
+    SPCR |= _BV(MSTR);
+    SPCR |= _BV(SPE);
+    SPCR &= ~(_BV(DORD));   // MSB-first
+    SPCR &= ~0x0C;          // Mode 0
+    SPCR &= ~0x03;          // Clock divider rate 2
+    SPSR |= 0x01;           // MSB of clock divider rate
+
+    // Initialize the DMD-specific pins.
+    pinMode(DMD_PIN_PHASE_LSB, OUTPUT);
+    pinMode(DMD_PIN_PHASE_MSB, OUTPUT);
+    pinMode(DMD_PIN_LATCH, OUTPUT);
+    pinMode(DMD_PIN_OUTPUT_ENABLE, OUTPUT);
+    digitalWrite(DMD_PIN_PHASE_LSB, LOW);
+    digitalWrite(DMD_PIN_PHASE_MSB, LOW);
+    digitalWrite(DMD_PIN_LATCH, LOW);
+    digitalWrite(DMD_PIN_OUTPUT_ENABLE, LOW);
+    digitalWrite(DMD_PIN_SPI_MOSI, HIGH);
+
+    // Look up the port registers for the DMD-specific pins so that
+    // refresh() can latch the data without going through digitalWrite().
+    latchPort = portOutputRegister(digitalPinToPort(DMD_PIN_LATCH));
+    enablePort = portOutputRegister(digitalPinToPort(DMD_PIN_OUTPUT_ENABLE));
+    phaseLsbPort = portOutputRegister(digitalPinToPort(DMD_PIN_PHASE_LSB));
+    phaseMsbPort = portOutputRegister(digitalPinToPort(DMD_PIN_PHASE_MSB));
+    latchMask = digitalPinToBitMask(DMD_PIN_LATCH);
+    enableMask = digitalPinToBitMask(DMD_PIN_OUTPUT_ENABLE);
+    phaseLsbMask = digitalPinToBitMask(DMD_PIN_PHASE_LSB);
+    phaseMsbMask = digitalPinToBitMask(DMD_PIN_PHASE_MSB);
+
+    // Put the SRAM into sequential mode and clear the frame buffer.
+    digitalWrite(_csPin, LOW);
+    spiTransfer(SRAM_CMD_WRITE_MODE);
+    spiTransfer(SRAM_MODE_SEQUENTIAL);
+    digitalWrite(_csPin, HIGH);
+    if (cacheData)
+        clear();
+}
+
+/**
+ * \brief Destroys this dot matrix display handler.
+ *
+ * Any drawing that is still in the line cache is discarded.
+ */
+SRAMDMD::~SRAMDMD()
+{
+    if (cacheData)
+        free(cacheData);
+}
+
+/**
+ * \fn bool SRAMDMD::isValid() const
+ * \brief Returns true if the line cache was allocated and the display
+ * fits within the SRAM; false otherwise.
+ */
+
+/**
+ * \fn int SRAMDMD::width() const
+ * \brief Returns the width of the display in pixels.
+ *
+ * \sa height(), stride()
+ */
+
+/**
+ * \fn int SRAMDMD::height() const
+ * \brief Returns the height of the display in pixels.
+ *
+ * \sa width()
+ */
+
+/**
+ * \fn int SRAMDMD::stride() const
+ * \brief Returns the number of bytes in each row of the display.
+ *
+ * \sa width()
+ */
+
+/**
+ * \fn bool SRAMDMD::doubleBuffer() const
+ * \brief Returns true if the display is double-buffered; false if
+ * single-buffered.  The default is false.
+ *
+ * \sa setDoubleBuffer(), swapBuffers()
+ */
+
+/**
+ * \brief Enables or disables double-buffering according to \a doubleBuffer.
+ *
+ * The second buffer is allocated in the SRAM, so double-buffering does not
+ * use any more main memory.  When it is enabled, the current contents of
+ * the display stay on the screen and drawing switches to a new back buffer
+ * that has been cleared to \ref Bitmap::Black "Black".  Double-buffering
+ * cannot be enabled if two frames will not fit into the SRAM.
+ *
+ * \sa doubleBuffer(), swapBuffers()
+ */
+void SRAMDMD::setDoubleBuffer(bool doubleBuffer)
+{
+    if (doubleBuffer == _doubleBuffer || !cacheData)
+        return;
+    if (doubleBuffer) {
+        if ((frameSize * 2) > SRAM_SIZE)
+            return;
+        flush();
+        drawBase = displayBase ? 0 : frameSize;
+        _doubleBuffer = true;
+        clear();
+    } else {
+        // Keep drawing to the buffer that is currently on the screen.
+        invalidate();
+        drawBase = displayBase;
+        _doubleBuffer = false;
+    }
+}
+
+/**
+ * \brief Swaps the buffers that are used for rendering to the display.
+ *
+ * When doubleBuffer() is false, this function does nothing.  Otherwise
+ * the line cache is flushed to the back buffer, which is then shown on
+ * the screen.  The new back buffer has the contents of the frame before
+ * last, so it will probably need to be re-initialized with clear() or
+ * fill() before drawing to it.
+ *
+ * \sa swapBuffersAndCopy(), setDoubleBuffer()
+ */
+void SRAMDMD::swapBuffers()
+{
+    if (!_doubleBuffer)
+        return;
+    flush();
+    invalidate();
+    unsigned long base = drawBase;
+    drawBase = displayBase;
+
+    // Turn off interrupts while swapping buffers so that refresh()
+    // does not see half of the new address.
+    cli();
+    displayBase = base;
+    sei();
+}
+
+/**
+ * \brief Swaps the buffers that are used for rendering to the display
+ * and copies the former back buffer contents to the new back buffer.
+ *
+ * This is slower than swapBuffers() because the entire frame is copied
+ * from one buffer in the SRAM to the other.
+ *
+ * \sa swapBuffers(), setDoubleBuffer()
+ */
+void SRAMDMD::swapBuffersAndCopy()
+{
+    if (!_doubleBuffer)
+        return;
+    swapBuffers();
+    copyFrame(displayBase, drawBase);
+}
+
+/**
+ * \brief Clears the display to \a color.
+ *
+ * The SRAM is filled directly, and any drawing that was still in the
+ * line cache is discarded.
+ *
+ * \sa fill()
+ */
+void SRAMDMD::clear(Color color)
+{
+    if (!cacheData)
+        return;
+    invalidate();
+    uint8_t value = (color == Bitmap::Black) ? 0xFF : 0x00;
+    for (unsigned long offset = 0; offset < frameSize; offset += lineSize) {
+        startTransfer(SRAM_CMD_WRITE, drawBase + offset);
+        for (unsigned int n = lineSize; n > 0; --n)
+            spiTransfer(value);
+        endTransfer();
+    }
+}
+
+/**
+ * \brief Returns the color of the pixel at (\a x, \a y); either
+ * \ref Bitmap::Black "Black" or \ref Bitmap::White "White".
+ *
+ * Returns \a Black if \a x or \a y is out of range.  The line containing
+ * the pixel will be loaded into the cache if necessary.
+ *
+ * \sa setPixel()
+ */
+SRAMDMD::Color SRAMDMD::pixel(int x, int y)
+{
+    if (((unsigned int)x) >= ((unsigned int)_width) ||
+            ((unsigned int)y) >= ((unsigned int)_height) || !cacheData)
+        return Bitmap::Black;
+    uint8_t *ptr = row(y, false) + (x >> 3);
+    if (*ptr & ((uint8_t)0x80) >> (x & 0x07))
+        return Bitmap::Black;
+    else
+        return Bitmap::White;
+}
+
+/**
+ * \brief Sets the pixel at (\a x, \a y) to \a color.
+ *
+ * \sa pixel(), fill()
+ */
+void SRAMDMD::setPixel(int x, int y, Color color)
+{
+    if (((unsigned int)x) >= ((unsigned int)_width) ||
+            ((unsigned int)y) >= ((unsigned int)_height) || !cacheData)
+        return;     // Pixel is off-screen.
+    uint8_t *ptr = row(y, true) + (x >> 3);
+    if (color)
+        *ptr &= ~(((uint8_t)0x80) >> (x & 0x07));
+    else
+        *ptr |= (((uint8_t)0x80) >> (x & 0x07));
+}
+
+/**
+ * \brief Fills the \a width x \a height pixels starting at top-left
+ * corner (\a x, \a y) with \a color.
+ *
+ * \sa clear(), setPixel()
+ */
+void SRAMDMD::fill(int x, int y, int width, int height, Color color)
+{
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if ((x + width) > _width)
+        width = _width - x;
+    if ((y + height) > _height)
+        height = _height - y;
+    if (width <= 0 || height <= 0 || !cacheData)
+        return;
+    uint8_t value = (color == Bitmap::Black) ? 0xFF : 0x00;
+    for (int ypos = y; ypos < (y + height); ++ypos)
+        fillBits(row(ypos, true), x, width, value);
+}
+
+/**
+ * \brief Draws \a bitmap at (\a x, \a y) in \a color.
+ *
+ * Bits that are set to \ref Bitmap::White "White" in the \a bitmap are
+ * drawn with \a color.  Bits that are set to \ref Bitmap::Black "Black"
+ * in the \a bitmap are drawn with the inverse of \a color.  The pixel at
+ * (\a x, \a y) will be the top-left corner of the drawn image, which is
+ * clipped to the display.
+ *
+ * \sa Bitmap::drawBitmap()
+ */
+void SRAMDMD::drawBitmap(int x, int y, const Bitmap &bitmap, Color color)
+{
+    int w = bitmap.width();
+    int s = bitmap.stride();
+    int h = bitmap.height();
+    if (!cacheData)
+        return;
+    for (int by = 0; by < h; ++by) {
+        int ypos = y + by;
+        if (((unsigned int)ypos) >= ((unsigned int)_height))
+            continue;
+        const uint8_t *line = bitmap.data() + by * s;
+        uint8_t *ptr = row(ypos, true);
+        for (int bx = 0; bx < w; ++bx) {
+            int xpos = x + bx;
+            if (((unsigned int)xpos) >= ((unsigned int)_width))
+                continue;
+            bool white = (line[bx >> 3] & (((uint8_t)0x80) >> (bx & 0x07))) == 0;
+            uint8_t mask = ((uint8_t)0x80) >> (xpos & 0x07);
+            if (white == (color != Bitmap::Black))
+                ptr[xpos >> 3] &= ~mask;
+            else
+                ptr[xpos >> 3] |= mask;
+        }
+    }
+}
+
+/**
+ * \brief Writes any modified lines in the cache back to the SRAM.
+ *
+ * When the display is single-buffered, the changes become visible
+ * on the next refresh().  The lines stay in the cache so that they
+ * can be drawn to again without reloading them.
+ *
+ * \sa swapBuffers()
+ */
+void SRAMDMD::flush()
+{
+    for (uint8_t index = 0; index < SRAMDMD_CACHE_LINES; ++index) {
+        if (cache[index].dirty)
+            writeLine(&cache[index]);
+    }
+}
+
+/**
+ * \brief Performs regular display refresh activities from the
+ * application's main loop.
+ *
+ * If you are using interrupts to refresh the display, then this
+ * function does not need to be called.
+ *
+ * \sa refresh(), enableTimer1()
+ */
+void SRAMDMD::loop()
+{
+    unsigned long currentTime = millis();
+    if ((currentTime - lastRefresh) >= DMD_REFRESH_MS) {
+        lastRefresh = currentTime;
+        refresh();
+    }
+}
+
+/**
+ * \brief Refresh the display.
+ *
+ * This function must be called at least once every 5 milliseconds for
+ * smooth non-flickering update of the display.  It is usually called
+ * by loop(), but can also be called in response to a timer interrupt.
+ *
+ * Each call sends the bytes for one of the four phases straight from the
+ * SRAM to the panels.  The call does nothing if the SPI bus or the SRAM
+ * is already in use.
+ *
+ * \sa loop(), enableTimer1()
+ */
+void SRAMDMD::refresh()
+{
+    // Bail out if there is a conflict on the SPI bus.
+    if (!digitalRead(DMD_PIN_SPI_SS) || !digitalRead(_csPin) || !cacheData)
+        return;
+
+    // Read the bytes for this phase from the SRAM and send each one to
+    // the panels while the next one is being read.
+    unsigned int size = (unsigned int)(frameSize >> 2);
+    startTransfer(SRAM_CMD_READ, displayBase + size * phase);
+    uint8_t value = spiTransfer(0xFF);
+    for (unsigned int n = size; n > 0; --n)
+        value = spiTransfer(value);
+    endTransfer();
+
+    // Latch the data from the shift registers onto the actual display.
+    // Interrupts are disabled while we modify the ports in case the
+    // application is using other pins on the same ports.
+    uint8_t oldSREG = SREG;
+    cli();
+    *enablePort &= ~enableMask;
+    *latchPort |= latchMask;
+    *latchPort &= ~latchMask;
+    if (phase & 0x02)
+        *phaseMsbPort |= phaseMsbMask;
+    else
+        *phaseMsbPort &= ~phaseMsbMask;
+    if (phase & 0x01)
+        *phaseLsbPort |= phaseLsbMask;
+    else
+        *phaseLsbPort &= ~phaseLsbMask;
+    *enablePort |= enableMask;
+    SREG = oldSREG;
+    phase = (phase + 1) & 0x03;
+}
+
+/**
+ * \brief Enables Timer1 overflow interrupts for updating this display.
+ *
+ * The application must also provide an interrupt service routine for
+ * Timer1 that calls refresh():
+ *
+ * \code
+ * #include <SRAMDMD.h>
+ *
+ * SRAMDMD display(A0);
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     display.enableTimer1();
+ * }
+ * \endcode
+ *
+ * If timer interrupts are being used to update the display, then it is
+ * unnecessary to call loop().
+ *
+ * \sa refresh(), disableTimer1()
+ */
+void SRAMDMD::enableTimer1()
+{
+    // Number of CPU cycles in the display's refresh period.
+    unsigned long numCycles = (F_CPU / 2000000) * DMD_REFRESH_US;
+
+    // Determine the prescaler to be used.
+    #define TIMER1_RESOLUTION  65536UL
+    uint8_t prescaler;
+    if (numCycles < TIMER1_RESOLUTION) {
+        // No prescaling required.
+        prescaler = _BV(CS10);
+    } else if (numCycles < TIMER1_RESOLUTION * 8) {
+        // Prescaler = 8.
+        prescaler = _BV(CS11);
+        numCycles >>= 3;
+    } else if (numCycles < TIMER1_RESOLUTION * 64) {
+        // Prescaler = 64.
+        prescaler = _BV(CS11) | _BV(CS10);
+        numCycles >>= 6;
+    } else if (numCycles < TIMER1_RESOLUTION * 256) {
+        // Prescaler = 256.
+        prescaler = _BV(CS12);
+        numCycles >>= 8;
+    } else {
+        // Prescaler = 1024.
+        prescaler = _BV(CS12) | _BV(CS10);
+        numCycles >>= 10;
+        if (numCycles >= TIMER1_RESOLUTION)
+            numCycles = TIMER1_RESOLUTION - 1;
+    }
+
+    // Configure Timer1 for the period we want.
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM13);
+    uint8_t saveSREG = SREG;
+    cli();
+    ICR1 = numCycles;
+    SREG = saveSREG;    // Implicit sei() if interrupts were on previously.
+    TCCR1B = (TCCR1B & ~(_BV(CS12) | _BV(CS11) | _BV(CS10))) | prescaler;
+
+    // Turn on the Timer1 overflow interrupt.
+    TIMSK1 |= _BV(TOIE1);
+}
+
+/**
+ * \brief Disables Timer1 overflow interrupts.
+ *
+ * \sa enableTimer1()
+ */
+void SRAMDMD::disableTimer1()
+{
+    // Turn off the Timer1 overflow interrupt.
+    TIMSK1 &= ~_BV(TOIE1);
+}
+
+// Returns a pointer to row y of the back buffer in the cache, loading
+// the line that contains it if necessary.  The line is marked as dirty
+// if write is true.
+uint8_t *SRAMDMD::row(int y, bool write)
+{
+    // Rows y, y + 4, y + 8, and y + 12 of a band of 16 rows are sent
+    // together in the same phase, so they are cached as one line.
+    // The rows are flipped in bands that are upside-down.
+    int band = y >> 4;
+    uint8_t r = y & 0x0F;
+    uint8_t ph = isFlipped(band) ? (3 - (r & 0x03)) : (r & 0x03);
+    int line = band * 4 + ph;
+
+    // Look for the line in the cache.  If it isn't there, then replace
+    // the least recently used line.
+    CacheLine *entry = 0;
+    for (uint8_t index = 0; index < SRAMDMD_CACHE_LINES; ++index) {
+        if (cache[index].line == line) {
+            entry = &cache[index];
+            break;
+        }
+        if (!entry || (useCount - cache[index].used) >
+                      (useCount - entry->used))
+            entry = &cache[index];
+    }
+    if (entry->line != line) {
+        if (entry->dirty)
+            writeLine(entry);
+        loadLine(entry, line);
+    }
+    entry->used = ++useCount;
+    if (write)
+        entry->dirty = true;
+    return entry->data + (r >> 2) * _stride;
+}
+
+// Loads a line from the back buffer in the SRAM into a cache entry,
+// converting it from wire order into four ordinary rows.
+void SRAMDMD::loadLine(CacheLine *entry, int line)
+{
+    uint8_t *data = entry->data;
+    bool flipped = isFlipped(line >> 2);
+    startTransfer(SRAM_CMD_READ, lineAddress(drawBase, line));
+    if (!flipped) {
+        for (int x = 0; x < _stride; ++x) {
+            data[x + _stride * 3] = spiTransfer(0xFF);
+            data[x + _stride * 2] = spiTransfer(0xFF);
+            data[x + _stride]     = spiTransfer(0xFF);
+            data[x]               = spiTransfer(0xFF);
+        }
+    } else {
+        for (int x = _stride - 1; x >= 0; --x) {
+            data[x]               = flipBits(spiTransfer(0xFF));
+            data[x + _stride]     = flipBits(spiTransfer(0xFF));
+            data[x + _stride * 2] = flipBits(spiTransfer(0xFF));
+            data[x + _stride * 3] = flipBits(spiTransfer(0xFF));
+        }
+    }
+    endTransfer();
+    entry->line = line;
+    entry->dirty = false;
+}
+
+// Writes a cache entry back to the SRAM in wire order.
+void SRAMDMD::writeLine(CacheLine *entry)
+{
+    const uint8_t *data = entry->data;
+    bool flipped = isFlipped(entry->line >> 2);
+    startTransfer(SRAM_CMD_WRITE, lineAddress(drawBase, entry->line));
+    if (!flipped) {
+        for (int x = 0; x < _stride; ++x) {
+            spiTransfer(data[x + _stride * 3]);
+            spiTransfer(data[x + _stride * 2]);
+            spiTransfer(data[x + _stride]);
+            spiTransfer(data[x]);
+        }
+    } else {
+        for (int x = _stride - 1; x >= 0; --x) {
+            spiTransfer(flipBits(data[x]));
+            spiTransfer(flipBits(data[x + _stride]));
+            spiTransfer(flipBits(data[x + _stride * 2]));
+            spiTransfer(flipBits(data[x + _stride * 3]));
+        }
+    }
+    endTransfer();
+    entry->dirty = false;
+}
+
+// Copies a frame from one buffer in the SRAM to another, a line at a
+// time through the first cache entry.  The cache must be empty.
+void SRAMDMD::copyFrame(unsigned long from, unsigned long to)
+{
+    uint8_t *data = cache[0].data;
+    for (unsigned long offset = 0; offset < frameSize; offset += lineSize) {
+        startTransfer(SRAM_CMD_READ, from + offset);
+        for (unsigned int n = 0; n < lineSize; ++n)
+            data[n] = spiTransfer(0xFF);
+        endTransfer();
+        startTransfer(SRAM_CMD_WRITE, to + offset);
+        for (unsigned int n = 0; n < lineSize; ++n)
+            spiTransfer(data[n]);
+        endTransfer();
+    }
+}
+
+// Discards the contents of the cache without writing them back.
+void SRAMDMD::invalidate()
+{
+    for (uint8_t index = 0; index < SRAMDMD_CACHE_LINES; ++index) {
+        cache[index].line = -1;
+        cache[index].dirty = false;
+    }
+}
+
+// Returns the address of a line within the buffer starting at base.
+// The bytes for each phase of refresh() are stored together, so the
+// lines for a phase follow each other in the SRAM.
+unsigned long SRAMDMD::lineAddress(unsigned long base, int line) const
+{
+    return base + (frameSize >> 2) * (line & 0x03) +
+           ((unsigned long)lineSize) * (line >> 2);
+}
+
+// Determines if a band of panels is upside-down.  Alternating rows of
+// panels are flipped, with the bottom row always the right way up.
+bool SRAMDMD::isFlipped(int band) const
+{
+    return (((_height >> 4) - 1 - band) & 0x01) != 0;
+}
+
+// Selects the SRAM and sends a command and address.
+void SRAMDMD::startTransfer(uint8_t command, unsigned long address)
+{
+    digitalWrite(_csPin, LOW);
+    spiTransfer(command);
+    spiTransfer((uint8_t)(address >> 16));
+    spiTransfer((uint8_t)(address >> 8));
+    spiTransfer((uint8_t)address);
+}
+
+// Deselects the SRAM at the end of a transfer.
+void SRAMDMD::endTransfer()
+{
+    digitalWrite(_csPin, HIGH);
+}
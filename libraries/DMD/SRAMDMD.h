@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRAMDMD_h
+#define SRAMDMD_h
+
+#include "Bitmap.h"
+
+// Number of lines of the display to cache in main memory while drawing.
+// Each line holds four rows of the display.
+#if !defined(SRAMDMD_CACHE_LINES)
+#define SRAMDMD_CACHE_LINES 4
+#endif
+
+class SRAMDMD
+{
+public:
+    explicit SRAMDMD(uint8_t csPin, int widthPanels = 1, int heightPanels = 1);
+    ~SRAMDMD();
+
+    typedef Bitmap::Color Color;
+
+    bool isValid() const { return cacheData != 0; }
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int stride() const { return _stride; }
+
+    bool doubleBuffer() const { return _doubleBuffer; }
+    void setDoubleBuffer(bool doubleBuffer);
+    void swapBuffers();
+    void swapBuffersAndCopy();
+
+    void clear(Color color = Bitmap::Black);
+
+    Color pixel(int x, int y);
+    void setPixel(int x, int y, Color color);
+
+    void fill(int x, int y, int width, int height, Color color);
+    void drawBitmap(int x, int y, const Bitmap &bitmap, Color color = Bitmap::White);
+
+    void flush();
+
+    void loop();
+    void refresh();
+
+    void enableTimer1();
+    void disableTimer1();
+
+private:
+    // Disable copy constructor and operator=().
+    SRAMDMD(const SRAMDMD &) {}
+    SRAMDMD &operator=(const SRAMDMD &) { return *this; }
+
+    struct CacheLine
+    {
+        uint8_t *data;
+        int line;
+        bool dirty;
+        unsigned int used;
+    };
+
+    int _width;
+    int _height;
+    int _stride;
+    unsigned int lineSize;
+    unsigned long frameSize;
+    unsigned long drawBase;
+    volatile unsigned long displayBase;
+    bool _doubleBuffer;
+    uint8_t phase;
+    uint8_t _csPin;
+    unsigned int useCount;
+    unsigned long lastRefresh;
+    uint8_t *cacheData;
+    CacheLine cache[SRAMDMD_CACHE_LINES];
+    volatile uint8_t *latchPort;
+    volatile uint8_t *enablePort;
+    volatile uint8_t *phaseLsbPort;
+    volatile uint8_t *phaseMsbPort;
+    uint8_t latchMask;
+    uint8_t enableMask;
+    uint8_t phaseLsbMask;
+    uint8_t phaseMsbMask;
+
+    uint8_t *row(int y, bool write);
+    void loadLine(CacheLine *entry, int line);
+    void writeLine(CacheLine *entry);
+    void copyFrame(unsigned long from, unsigned long to);
+    void invalidate();
+    unsigned long lineAddress(unsigned long base, int line) const;
+    bool isFlipped(int band) const;
+    void startTransfer(uint8_t command, unsigned long address);
+    void endTransfer();
+};
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Sprite.h"
+#include "SpriteScene.h"
+
+/**
+ * \class Sprite Sprite.h <Sprite.h>
+ * \brief Movable image that is composited onto a Bitmap by a SpriteScene.
+ *
+ * The image for a sprite is stored in program memory in the same format
+ * as Bitmap::drawBitmap(): the width and height in pixels followed by the
+ * rows of pixels, with each row byte-aligned.  An optional transparency
+ * mask has the same layout as the pixels but without the width and height.
+ * Pixels are drawn wherever the mask bit is 1: in color() if the image bit
+ * is 1, or in the inverse of color() if the image bit is 0.  If there is no
+ * mask, then the image is its own mask and the 0 bits are transparent.
+ *
+ * \code
+ * byte const ball[] PROGMEM = {
+ *     4, 4,
+ *     B01100000,
+ *     B11110000,
+ *     B11110000,
+ *     B01100000
+ * };
+ *
+ * Sprite sprite;
+ * sprite.setImage(ball);
+ * sprite.moveTo(10, 4);
+ * scene.add(&sprite);
+ * \endcode
+ *
+ * Changing the image, position, layer, visibility, or color of a sprite
+ * marks it as changed so that the next SpriteScene::render() redraws the
+ * area that the sprite used to cover and the area that it covers now.
+ *
+ * \sa SpriteScene
+ */
+
+// Returns 8 bits of a packed row starting at bit, with zeroes past the
+// end of the row.
+static uint8_t packedBits(const uint8_t *row, int bit, int stride)
+{
+    int index = bit >> 3;
+    uint8_t shift = bit & 0x07;
+    uint8_t value = (uint8_t)(pgm_read_byte(row + index) << shift);
+    if (shift && (index + 1) < stride)
+        value |= pgm_read_byte(row + index + 1) >> (8 - shift);
+    return value;
+}
+
+/**
+ * \brief Constructs a new sprite with no image at (0, 0) in layer 0.
+ *
+ * The sprite is visible and drawn in \ref Bitmap::White "White" by
+ * default, but nothing will be drawn until setImage() is called and the
+ * sprite is added to a SpriteScene.
+ *
+ * \sa setImage(), SpriteScene::add()
+ */
+Sprite::Sprite()
+    : _image(0)
+    , _mask(0)
+    , _x(0)
+    , _y(0)
+    , _layer(0)
+    , _visible(true)
+    , changed(false)
+    , drawn(false)
+    , _color(Bitmap::White)
+    , drawnX1(0)
+    , drawnY1(0)
+    , drawnX2(-1)
+    , drawnY2(-1)
+    , _scene(0)
+    , next(0)
+{
+}
+
+/**
+ * \brief Destroys this sprite, after removing it from its scene.
+ *
+ * The area that the sprite covered will be redrawn on the next render
+ * of the scene.
+ */
+Sprite::~Sprite()
+{
+    if (_scene)
+        _scene->remove(this);
+}
+
+/**
+ * \fn Bitmap::ProgMem Sprite::image() const
+ * \brief Returns the image for this sprite in program memory, or null if
+ * the sprite does not have an image.
+ *
+ * \sa setImage(), mask()
+ */
+
+/**
+ * \fn Bitmap::ProgMem Sprite::mask() const
+ * \brief Returns the transparency mask for this sprite in program memory,
+ * or null if the image is its own mask.
+ *
+ * \sa setImage(), image()
+ */
+
+/**
+ * \brief Sets the \a image and transparency \a mask for this sprite.
+ *
+ * Both \a image and \a mask must point to program memory.  If \a mask is
+ * null, then the 1 bits of \a image are drawn and the 0 bits are
+ * transparent.  Changing the image is the usual way to animate a sprite.
+ *
+ * \sa image(), mask()
+ */
+void Sprite::setImage(Bitmap::ProgMem image, Bitmap::ProgMem mask)
+{
+    if (image != _image || mask != _mask) {
+        _image = image;
+        _mask = mask;
+        changed = true;
+    }
+}
+
+/**
+ * \brief Returns the width of this sprite's image in pixels, or zero
+ * if the sprite does not have an image.
+ *
+ * \sa height()
+ */
+int Sprite::width() const
+{
+    return _image ? pgm_read_byte((const uint8_t *)_image) : 0;
+}
+
+/**
+ * \brief Returns the height of this sprite's image in pixels, or zero
+ * if the sprite does not have an image.
+ *
+ * \sa width()
+ */
+int Sprite::height() const
+{
+    return _image ? pgm_read_byte(((const uint8_t *)_image) + 1) : 0;
+}
+
+/**
+ * \fn int Sprite::x() const
+ * \brief Returns the x position of the top-left corner of this sprite.
+ *
+ * \sa y(), moveTo()
+ */
+
+/**
+ * \fn int Sprite::y() const
+ * \brief Returns the y position of the top-left corner of this sprite.
+ *
+ * \sa x(), moveTo()
+ */
+
+/**
+ * \brief Moves the top-left corner of this sprite to (\a x, \a y).
+ *
+ * The sprite may be partly or completely off-screen.
+ *
+ * \sa moveBy(), x(), y()
+ */
+void Sprite::moveTo(int x, int y)
+{
+    if (x != _x || y != _y) {
+        _x = x;
+        _y = y;
+        changed = true;
+    }
+}
+
+/**
+ * \fn void Sprite::moveBy(int dx, int dy)
+ * \brief Moves this sprite by \a dx pixels horizontally and \a dy pixels
+ * vertically.
+ *
+ * \sa moveTo()
+ */
+
+/**
+ * \fn uint8_t Sprite::layer() const
+ * \brief Returns the layer that this sprite is drawn in.  The default is 0.
+ *
+ * \sa setLayer()
+ */
+
+/**
+ * \brief Sets the \a layer that this sprite is drawn in.
+ *
+ * Sprites in higher layers are drawn on top of sprites in lower layers.
+ * Sprites in the same layer are drawn in the order that they were added
+ * to the scene, so the most recently added sprite is on top.
+ *
+ * \sa layer()
+ */
+void Sprite::setLayer(uint8_t layer)
+{
+    if (layer == _layer)
+        return;
+    SpriteScene *scene = _scene;
+    if (scene)
+        scene->unlink(this);
+    _layer = layer;
+    if (scene)
+        scene->insert(this);
+    changed = true;
+}
+
+/**
+ * \fn bool Sprite::isVisible() const
+ * \brief Returns true if this sprite is visible; false if it is hidden.
+ * The default is true.
+ *
+ * \sa setVisible()
+ */
+
+/**
+ * \brief Shows or hides this sprite according to \a visible.
+ *
+ * Hidden sprites are not drawn and never collide with other sprites.
+ *
+ * \sa isVisible()
+ */
+void Sprite::setVisible(bool visible)
+{
+    if (visible != _visible) {
+        _visible = visible;
+        changed = true;
+    }
+}
+
+/**
+ * \fn Bitmap::Color Sprite::color() const
+ * \brief Returns the color that this sprite is drawn in.  The default is
+ * \ref Bitmap::White "White".
+ *
+ * \sa setColor()
+ */
+
+/**
+ * \brief Sets the \a color that this sprite is drawn in.
+ *
+ * \sa color()
+ */
+void Sprite::setColor(Bitmap::Color color)
+{
+    if (color != _color) {
+        _color = color;
+        changed = true;
+    }
+}
+
+/**
+ * \brief Returns true if this sprite collides with \a other; false otherwise.
+ *
+ * The bounding boxes of the two sprites are compared first.  If they
+ * overlap, then the masks of the sprites are compared eight pixels at a
+ * time over the intersection, so the sprites only collide if an opaque
+ * pixel of one is on top of an opaque pixel of the other.  Hidden sprites
+ * and sprites without an image never collide.
+ *
+ * \sa SpriteScene::collision()
+ */
+bool Sprite::collidesWith(const Sprite &other) const
+{
+    if (&other == this || !_visible || !other._visible ||
+            !_image || !other._image)
+        return false;
+
+    // Find the intersection of the bounding boxes.
+    int x1 = _x > other._x ? _x : other._x;
+    int y1 = _y > other._y ? _y : other._y;
+    int x2 = _x + width() - 1;
+    int y2 = _y + height() - 1;
+    int otherX2 = other._x + other.width() - 1;
+    int otherY2 = other._y + other.height() - 1;
+    if (x2 > otherX2)
+        x2 = otherX2;
+    if (y2 > otherY2)
+        y2 = otherY2;
+    if (x1 > x2 || y1 > y2)
+        return false;
+
+    // Compare the masks within the intersection.
+    int stride = (width() + 7) >> 3;
+    int otherStride = (other.width() + 7) >> 3;
+    const uint8_t *mask = maskBits() + (y1 - _y) * stride;
+    const uint8_t *otherMask =
+        other.maskBits() + (y1 - other._y) * otherStride;
+    for (int y = y1; y <= y2; ++y) {
+        for (int x = x1; x <= x2; x += 8) {
+            int count = x2 - x + 1;
+            uint8_t limit = count >= 8 ? 0xFF : (uint8_t)(0xFF << (8 - count));
+            uint8_t bits = packedBits(mask, x - _x, stride);
+            uint8_t otherBits = packedBits(otherMask, x - other._x, otherStride);
+            if (bits & otherBits & limit)
+                return true;
+        }
+        mask += stride;
+        otherMask += otherStride;
+    }
+    return false;
+}
+
+/**
+ * \fn SpriteScene *Sprite::scene() const
+ * \brief Returns the scene that this sprite belongs to, or null if none.
+ *
+ * \sa SpriteScene::add()
+ */
+
+// Returns the start of the mask rows in program memory.
+const uint8_t *Sprite::maskBits() const
+{
+    if (_mask)
+        return (const uint8_t *)_mask;
+    else
+        return ((const uint8_t *)_image) + 2;
+}
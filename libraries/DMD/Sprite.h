@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef Sprite_h
+#define Sprite_h
+
+#include "Bitmap.h"
+
+class SpriteScene;
+
+class Sprite
+{
+public:
+    Sprite();
+    ~Sprite();
+
+    Bitmap::ProgMem image() const { return _image; }
+    Bitmap::ProgMem mask() const { return _mask; }
+    void setImage(Bitmap::ProgMem image, Bitmap::ProgMem mask = 0);
+
+    int width() const;
+    int height() const;
+
+    int x() const { return _x; }
+    int y() const { return _y; }
+    void moveTo(int x, int y);
+    void moveBy(int dx, int dy) { moveTo(_x + dx, _y + dy); }
+
+    uint8_t layer() const { return _layer; }
+    void setLayer(uint8_t layer);
+
+    bool isVisible() const { return _visible; }
+    void setVisible(bool visible);
+
+    Bitmap::Color color() const { return _color; }
+    void setColor(Bitmap::Color color);
+
+    bool collidesWith(const Sprite &other) const;
+
+    SpriteScene *scene() const { return _scene; }
+
+private:
+    // Disable copy constructor and operator=().
+    Sprite(const Sprite &) {}
+    Sprite &operator=(const Sprite &) { return *this; }
+
+    Bitmap::ProgMem _image;
+    Bitmap::ProgMem _mask;
+    int _x;
+    int _y;
+    uint8_t _layer;
+    bool _visible;
+    bool changed;
+    bool drawn;
+    Bitmap::Color _color;
+    int drawnX1;
+    int drawnY1;
+    int drawnX2;
+    int drawnY2;
+    SpriteScene *_scene;
+    Sprite *next;
+
+    friend class SpriteScene;
+
+    const uint8_t *maskBits() const;
+};
+
+#endif
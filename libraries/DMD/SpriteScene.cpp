@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SpriteScene.h"
+
+/**
+ * \class SpriteScene SpriteScene.h <SpriteScene.h>
+ * \brief Composites layers of sprites onto a Bitmap, redrawing only the
+ * areas that have changed.
+ *
+ * Games and animations normally clear the display and redraw every object
+ * on each frame, which costs the same however little has moved.  A
+ * SpriteScene instead keeps track of the rectangles that its sprites
+ * covered on the last frame and cover now.  render() restores the
+ * background within those rectangles and redraws the sprites that overlap
+ * them in layer order, so the cost of each frame depends on how much has
+ * moved rather than the size of the display:
+ *
+ * \code
+ * DMD display;
+ * SpriteScene scene;
+ * Sprite runner;
+ *
+ * void setup() {
+ *     runner.setImage(run1);
+ *     scene.add(&runner);
+ * }
+ *
+ * void loop() {
+ *     runner.setImage(frames[frame]);
+ *     runner.moveBy(1, 0);
+ *     scene.render(&display);
+ *     ...
+ * }
+ * \endcode
+ *
+ * The background is either a solid color or a separate Bitmap of the same
+ * size as the destination.  If the application draws to the destination
+ * directly, or changes the background bitmap, then it must call
+ * invalidate() for the affected area so that the sprites are drawn over
+ * the top again.  The first render() after the scene is created redraws
+ * the whole destination.
+ *
+ * The rows that are redrawn are reported through Bitmap::markDirty().
+ * When rendering to a double-buffered DMD, use DMD::swapBuffersAndCopy()
+ * so that the back buffer still has the previous frame in it.
+ *
+ * Up to SPRITE_SCENE_MAX_RECTS separate rectangles are tracked between
+ * renders; rectangles that touch are merged, and if there are too many
+ * then the last two are combined into their bounding box.
+ *
+ * \sa Sprite
+ */
+
+/**
+ * \brief Constructs a new empty scene with a \ref Bitmap::Black "Black"
+ * background.
+ */
+SpriteScene::SpriteScene()
+    : first(0)
+    , _background(0)
+    , _backgroundColor(Bitmap::Black)
+    , full(true)
+    , numRects(0)
+{
+}
+
+/**
+ * \brief Destroys this scene.
+ *
+ * The sprites are detached from the scene but are not destroyed.
+ */
+SpriteScene::~SpriteScene()
+{
+    Sprite *sprite = first;
+    while (sprite) {
+        Sprite *next = sprite->next;
+        sprite->_scene = 0;
+        sprite->next = 0;
+        sprite = next;
+    }
+}
+
+/**
+ * \brief Adds \a sprite to this scene.
+ *
+ * If \a sprite is in another scene, then it is removed from that scene
+ * first.  The sprite will be drawn on the next call to render().
+ *
+ * \sa remove()
+ */
+void SpriteScene::add(Sprite *sprite)
+{
+    if (sprite->_scene == this)
+        return;
+    if (sprite->_scene)
+        sprite->_scene->remove(sprite);
+    sprite->_scene = this;
+    sprite->drawn = false;
+    sprite->changed = true;
+    insert(sprite);
+}
+
+/**
+ * \brief Removes \a sprite from this scene.
+ *
+ * The area that the sprite covered will be restored to the background
+ * on the next call to render().
+ *
+ * \sa add()
+ */
+void SpriteScene::remove(Sprite *sprite)
+{
+    if (sprite->_scene != this)
+        return;
+    unlink(sprite);
+    addDrawn(sprite);
+    sprite->_scene = 0;
+    sprite->drawn = false;
+}
+
+/**
+ * \fn Bitmap *SpriteScene::background() const
+ * \brief Returns the background bitmap for this scene, or null if the
+ * background is a solid color.
+ *
+ * \sa setBackground(), backgroundColor()
+ */
+
+/**
+ * \brief Sets the \a background bitmap for this scene.
+ *
+ * The areas behind the sprites are copied from the same position in
+ * \a background, which should be the same size as the destination.
+ * If \a background is null, then backgroundColor() is used instead.
+ * The whole scene will be redrawn on the next call to render().
+ *
+ * \sa background(), setBackgroundColor()
+ */
+void SpriteScene::setBackground(Bitmap *background)
+{
+    _background = background;
+    full = true;
+}
+
+/**
+ * \fn Bitmap::Color SpriteScene::backgroundColor() const
+ * \brief Returns the color of the background when there is no background
+ * bitmap.  The default is \ref Bitmap::Black "Black".
+ *
+ * \sa setBackgroundColor(), background()
+ */
+
+/**
+ * \brief Sets the \a color of the background when there is no background
+ * bitmap.
+ *
+ * The whole scene will be redrawn on the next call to render().
+ *
+ * \sa backgroundColor(), setBackground()
+ */
+void SpriteScene::setBackgroundColor(Bitmap::Color color)
+{
+    _backgroundColor = color;
+    full = true;
+}
+
+/**
+ * \brief Returns the first sprite in this scene that collides with
+ * \a sprite, or null if there is no collision.
+ *
+ * The sprites are checked from the lowest layer to the highest.
+ * \a sprite itself is skipped, and it does not need to be in this scene.
+ *
+ * \sa Sprite::collidesWith()
+ */
+Sprite *SpriteScene::collision(const Sprite *sprite) const
+{
+    for (Sprite *other = first; other; other = other->next) {
+        if (other != sprite && sprite->collidesWith(*other))
+            return other;
+    }
+    return 0;
+}
+
+/**
+ * \brief Marks the whole scene as needing to be redrawn on the next call
+ * to render().
+ */
+void SpriteScene::invalidate()
+{
+    full = true;
+}
+
+/**
+ * \brief Marks the \a width x \a height pixels starting at top-left corner
+ * (\a x, \a y) as needing to be redrawn on the next call to render().
+ *
+ * This should be called after the application changes the background
+ * bitmap or draws into the destination directly.
+ */
+void SpriteScene::invalidate(int x, int y, int width, int height)
+{
+    if (width > 0 && height > 0)
+        addRect(x, y, x + width - 1, y + height - 1);
+}
+
+/**
+ * \brief Renders the changes to this scene since the last call onto
+ * \a dest.
+ *
+ * \sa invalidate()
+ */
+void SpriteScene::render(Bitmap *dest)
+{
+    // Collect the areas that have changed since the last render.
+    Sprite *sprite;
+    for (sprite = first; sprite; sprite = sprite->next) {
+        if (sprite->changed) {
+            addDrawn(sprite);
+            addCurrent(sprite);
+        }
+    }
+    if (full) {
+        rects[0].x1 = 0;
+        rects[0].y1 = 0;
+        rects[0].x2 = dest->width() - 1;
+        rects[0].y2 = dest->height() - 1;
+        numRects = 1;
+        full = false;
+    }
+
+    // Redraw the areas after clipping them to the destination.
+    for (uint8_t index = 0; index < numRects; ++index) {
+        Rect rect = rects[index];
+        if (rect.x1 < 0)
+            rect.x1 = 0;
+        if (rect.y1 < 0)
+            rect.y1 = 0;
+        if (rect.x2 >= dest->width())
+            rect.x2 = dest->width() - 1;
+        if (rect.y2 >= dest->height())
+            rect.y2 = dest->height() - 1;
+        if (rect.x1 <= rect.x2 && rect.y1 <= rect.y2)
+            renderRect(dest, rect);
+    }
+    numRects = 0;
+
+    // Remember where the sprites were drawn for next time.
+    for (sprite = first; sprite; sprite = sprite->next) {
+        sprite->changed = false;
+        if (sprite->_visible && sprite->_image) {
+            sprite->drawn = true;
+            sprite->drawnX1 = sprite->_x;
+            sprite->drawnY1 = sprite->_y;
+            sprite->drawnX2 = sprite->_x + sprite->width() - 1;
+            sprite->drawnY2 = sprite->_y + sprite->height() - 1;
+        } else {
+            sprite->drawn = false;
+        }
+    }
+}
+
+// Inserts a sprite into the list after all sprites in the same or
+// lower layers.
+void SpriteScene::insert(Sprite *sprite)
+{
+    Sprite **link = &first;
+    while (*link && (*link)->_layer <= sprite->_layer)
+        link = &((*link)->next);
+    sprite->next = *link;
+    *link = sprite;
+}
+
+// Unlinks a sprite from the list.
+void SpriteScene::unlink(Sprite *sprite)
+{
+    Sprite **link = &first;
+    while (*link && *link != sprite)
+        link = &((*link)->next);
+    if (*link)
+        *link = sprite->next;
+    sprite->next = 0;
+}
+
+// Adds a rectangle to the set of areas to be redrawn.  Rectangles that
+// overlap or touch an existing rectangle are merged with it.
+void SpriteScene::addRect(int x1, int y1, int x2, int y2)
+{
+    if (full)
+        return;
+    uint8_t index = 0;
+    while (index < numRects) {
+        Rect &rect = rects[index];
+        if (x1 <= (rect.x2 + 1) && (x2 + 1) >= rect.x1 &&
+                y1 <= (rect.y2 + 1) && (y2 + 1) >= rect.y1) {
+            // Merge with this rectangle and then check the others again.
+            if (rect.x1 < x1)
+                x1 = rect.x1;
+            if (rect.y1 < y1)
+                y1 = rect.y1;
+            if (rect.x2 > x2)
+                x2 = rect.x2;
+            if (rect.y2 > y2)
+                y2 = rect.y2;
+            rect = rects[--numRects];
+            index = 0;
+        } else {
+            ++index;
+        }
+    }
+    if (numRects >= SPRITE_SCENE_MAX_RECTS) {
+        // Too many rectangles, so combine with the last one.
+        const Rect &rect = rects[--numRects];
+        addRect(rect.x1 < x1 ? rect.x1 : x1, rect.y1 < y1 ? rect.y1 : y1,
+                rect.x2 > x2 ? rect.x2 : x2, rect.y2 > y2 ? rect.y2 : y2);
+        return;
+    }
+    rects[numRects].x1 = x1;
+    rects[numRects].y1 = y1;
+    rects[numRects].x2 = x2;
+    rects[numRects].y2 = y2;
+    ++numRects;
+}
+
+// Adds the area that a sprite covered on the last render.
+void SpriteScene::addDrawn(const Sprite *sprite)
+{
+    if (sprite->drawn) {
+        addRect(sprite->drawnX1, sprite->drawnY1,
+                sprite->drawnX2, sprite->drawnY2);
+    }
+}
+
+// Adds the area that a sprite covers now.
+void SpriteScene::addCurrent(const Sprite *sprite)
+{
+    if (sprite->_visible && sprite->_image) {
+        addRect(sprite->_x, sprite->_y, sprite->_x + sprite->width() - 1,
+                sprite->_y + sprite->height() - 1);
+    }
+}
+
+// Restores the background within a rectangle and draws the sprites
+// that overlap it from the lowest layer to the highest.
+void SpriteScene::renderRect(Bitmap *dest, const Rect &rect)
+{
+    int width = rect.x2 - rect.x1 + 1;
+    int height = rect.y2 - rect.y1 + 1;
+    if (_background)
+        _background->copy(rect.x1, rect.y1, width, height, dest, rect.x1, rect.y1);
+    else
+        dest->fill(rect.x1, rect.y1, width, height, _backgroundColor);
+    for (Sprite *sprite = first; sprite; sprite = sprite->next) {
+        if (sprite->_visible && sprite->_image)
+            drawSprite(dest, sprite, rect);
+    }
+    dest->markDirty(rect.y1, rect.y2);
+}
+
+// Draws the part of a sprite that is within a rectangle.
+void SpriteScene::drawSprite(Bitmap *dest, const Sprite *sprite, const Rect &rect)
+{
+    int x1 = sprite->_x;
+    int y1 = sprite->_y;
+    int x2 = x1 + sprite->width() - 1;
+    int y2 = y1 + sprite->height() - 1;
+    if (x1 < rect.x1)
+        x1 = rect.x1;
+    if (y1 < rect.y1)
+        y1 = rect.y1;
+    if (x2 > rect.x2)
+        x2 = rect.x2;
+    if (y2 > rect.y2)
+        y2 = rect.y2;
+    if (x1 > x2 || y1 > y2)
+        return;
+    int stride = (sprite->width() + 7) >> 3;
+    int destStride = dest->stride();
+    const uint8_t *image = ((const uint8_t *)sprite->_image) + 2 +
+                           (y1 - sprite->_y) * stride;
+    const uint8_t *mask = sprite->maskBits() + (y1 - sprite->_y) * stride;
+    uint8_t *row = dest->data() + y1 * destStride;
+    bool white = (sprite->_color != Bitmap::Black);
+    for (int y = y1; y <= y2; ++y) {
+        uint8_t imageBits = 0;
+        uint8_t maskBits = 0;
+        for (int x = x1; x <= x2; ++x) {
+            int bx = x - sprite->_x;
+            if (x == x1 || (bx & 0x07) == 0) {
+                imageBits = pgm_read_byte(image + (bx >> 3));
+                maskBits = pgm_read_byte(mask + (bx >> 3));
+            }
+            uint8_t bit = ((uint8_t)0x80) >> (bx & 0x07);
+            if (!(maskBits & bit))
+                continue;   // Transparent pixel.
+
+            // Pixels that are off have their bit set in the framebuffer.
+            uint8_t destBit = ((uint8_t)0x80) >> (x & 0x07);
+            if (((imageBits & bit) != 0) == white)
+                row[x >> 3] &= ~destBit;
+            else
+                row[x >> 3] |= destBit;
+        }
+        image += stride;
+        mask += stride;
+        row += destStride;
+    }
+}
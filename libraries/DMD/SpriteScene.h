@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SpriteScene_h
+#define SpriteScene_h
+
+#include "Sprite.h"
+
+// Maximum number of separate dirty rectangles to track between renders.
+#if !defined(SPRITE_SCENE_MAX_RECTS)
+#define SPRITE_SCENE_MAX_RECTS 8
+#endif
+
+class SpriteScene
+{
+public:
+    SpriteScene();
+    ~SpriteScene();
+
+    void add(Sprite *sprite);
+    void remove(Sprite *sprite);
+
+    Bitmap *background() const { return _background; }
+    void setBackground(Bitmap *background);
+
+    Bitmap::Color backgroundColor() const { return _backgroundColor; }
+    void setBackgroundColor(Bitmap::Color color);
+
+    Sprite *collision(const Sprite *sprite) const;
+
+    void invalidate();
+    void invalidate(int x, int y, int width, int height);
+
+    void render(Bitmap *dest);
+
+private:
+    // Disable copy constructor and operator=().
+    SpriteScene(const SpriteScene &) {}
+    SpriteScene &operator=(const SpriteScene &) { return *this; }
+
+    struct Rect
+    {
+        int x1;
+        int y1;
+        int x2;
+        int y2;
+    };
+
+    Sprite *first;
+    Bitmap *_background;
+    Bitmap::Color _backgroundColor;
+    bool full;
+    uint8_t numRects;
+    Rect rects[SPRITE_SCENE_MAX_RECTS];
+
+    void insert(Sprite *sprite);
+    void unlink(Sprite *sprite);
+    void addRect(int x1, int y1, int x2, int y2);
+    void addDrawn(const Sprite *sprite);
+    void addCurrent(const Sprite *sprite);
+    void renderRect(Bitmap *dest, const Rect &rect);
+    static void drawSprite(Bitmap *dest, const Sprite *sprite, const Rect &rect);
+
+    friend class Sprite;
+};
+
+#endif
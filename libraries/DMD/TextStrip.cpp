@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TextStrip.h"
+
+/**
+ * \class TextStrip TextStrip.h <TextStrip.h>
+ * \brief Pre-rendered strip of text for scrolling marquees.
+ *
+ * Scrolling a message across a display normally involves calling
+ * Bitmap::drawText() on every frame at a slightly different position,
+ * which rasterizes the same glyphs over and over.  TextStrip instead
+ * renders the text once into an off-screen Bitmap and then copies the
+ * visible part of it to the display with Bitmap::copy(), which moves
+ * whole bytes at a time.
+ *
+ * \code
+ * TextStrip strip;
+ * strip.setFont(DejaVuSans9);
+ * strip.setText("Eat at Joes!");
+ * for (int x = display.width(); x > -strip.width(); --x) {
+ *     display.clear();
+ *     strip.draw(&display, x, 3);
+ *     delay(50);
+ * }
+ * \endcode
+ *
+ * The strip is rendered on the next call to draw(), width() or height()
+ * after the font(), textColor() or text() changes.  If there is
+ * insufficient memory for the off-screen bitmap, then draw() falls back
+ * to drawing the text directly with Bitmap::drawText().
+ *
+ * \sa Bitmap
+ */
+
+/**
+ * \brief Constructs a new text strip with no font and empty text.
+ */
+TextStrip::TextStrip()
+    : _font(0)
+    , _textColor(Bitmap::White)
+    , strip(0)
+    , valid(false)
+{
+}
+
+/**
+ * \brief Destroys this text strip.
+ */
+TextStrip::~TextStrip()
+{
+    delete strip;
+}
+
+/**
+ * \fn Bitmap::Font TextStrip::font() const
+ * \brief Returns the font that is used to render the text, or null if
+ * no font has been set.
+ *
+ * \sa setFont()
+ */
+
+/**
+ * \brief Sets the \a font that is used to render the text.
+ *
+ * \sa font(), setText()
+ */
+void TextStrip::setFont(Bitmap::Font font)
+{
+    if (_font != font) {
+        _font = font;
+        invalidate();
+    }
+}
+
+/**
+ * \fn Bitmap::Color TextStrip::textColor() const
+ * \brief Returns the color that is used to render the text.  The default
+ * is \ref Bitmap::White.  The background is the inverse of this color.
+ *
+ * \sa setTextColor()
+ */
+
+/**
+ * \brief Sets the \a color that is used to render the text.
+ *
+ * \sa textColor()
+ */
+void TextStrip::setTextColor(Bitmap::Color color)
+{
+    if (_textColor != color) {
+        _textColor = color;
+        invalidate();
+    }
+}
+
+/**
+ * \fn const String &TextStrip::text() const
+ * \brief Returns the text that is rendered into this strip.
+ *
+ * \sa setText()
+ */
+
+/**
+ * \brief Sets the \a text that is rendered into this strip.
+ *
+ * The strip is not re-rendered if \a text is the same as the current text.
+ *
+ * \sa text(), setFont()
+ */
+void TextStrip::setText(const char *text)
+{
+    if (_text != text) {
+        _text = text;
+        invalidate();
+    }
+}
+
+/**
+ * \brief Sets the \a text that is rendered into this strip.
+ * \overload
+ */
+void TextStrip::setText(const String &text)
+{
+    if (_text != text) {
+        _text = text;
+        invalidate();
+    }
+}
+
+/**
+ * \brief Returns the width of the rendered text in pixels.
+ *
+ * \sa height(), Bitmap::textWidth()
+ */
+int TextStrip::width()
+{
+    render();
+    return strip ? strip->width() : 0;
+}
+
+/**
+ * \brief Returns the height of the rendered text in pixels.
+ *
+ * \sa width(), Bitmap::textHeight()
+ */
+int TextStrip::height()
+{
+    render();
+    return strip ? strip->height() : 0;
+}
+
+/**
+ * \brief Draws the text strip onto \a dest with its top-left corner
+ * at (\a x, \a y).
+ *
+ * Only the part of the strip that overlaps \a dest is copied, so \a x
+ * may be negative or beyond the right edge of \a dest when scrolling the
+ * text in or out.  Pixels of \a dest outside the strip are not modified.
+ */
+void TextStrip::draw(Bitmap *dest, int x, int y)
+{
+    render();
+    if (!strip) {
+        // No memory for the strip, so draw the text the slow way.
+        if (_font && _text.length()) {
+            Bitmap::Font oldFont = dest->font();
+            Bitmap::Color oldColor = dest->textColor();
+            dest->setFont(_font);
+            dest->setTextColor(_textColor);
+            dest->drawText(x, y, _text);
+            dest->setFont(oldFont);
+            dest->setTextColor(oldColor);
+        }
+        return;
+    }
+
+    // Clip the strip to the left and right edges of the destination so
+    // that Bitmap::copy() can move the rows a byte at a time.
+    int srcX = 0;
+    int width = strip->width();
+    if (x < 0) {
+        srcX = -x;
+        width += x;
+        x = 0;
+    }
+    if ((x + width) > dest->width())
+        width = dest->width() - x;
+    if (width > 0)
+        strip->copy(srcX, 0, width, strip->height(), dest, x, y);
+}
+
+/**
+ * \brief Forces the strip to be re-rendered the next time it is drawn.
+ *
+ * This is called automatically when the font, color, or text changes.
+ */
+void TextStrip::invalidate()
+{
+    valid = false;
+}
+
+void TextStrip::render()
+{
+    if (valid)
+        return;
+    valid = true;
+    delete strip;
+    strip = 0;
+    if (!_font || !_text.length())
+        return;
+
+    // Measure the text with an empty bitmap before allocating the strip.
+    Bitmap measure(0, 0);
+    measure.setFont(_font);
+    int width = measure.textWidth(_text);
+    int height = measure.textHeight();
+    if (width <= 0 || height <= 0)
+        return;
+
+    // Render the text into the strip.
+    strip = new Bitmap(width, height);
+    if (!strip || !strip->isValid()) {
+        delete strip;
+        strip = 0;
+        return;
+    }
+    strip->setFont(_font);
+    strip->setTextColor(_textColor);
+    strip->drawText(0, 0, _text);
+}
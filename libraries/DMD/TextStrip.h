@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TextStrip_h
+#define TextStrip_h
+
+#include "Bitmap.h"
+#include <WString.h>
+
+class TextStrip
+{
+public:
+    TextStrip();
+    ~TextStrip();
+
+    Bitmap::Font font() const { return _font; }
+    void setFont(Bitmap::Font font);
+
+    Bitmap::Color textColor() const { return _textColor; }
+    void setTextColor(Bitmap::Color color);
+
+    const String &text() const { return _text; }
+    void setText(const char *text);
+    void setText(const String &text);
+
+    int width();
+    int height();
+
+    void draw(Bitmap *dest, int x, int y);
+
+    void invalidate();
+
+private:
+    // Disable copy constructor and operator=().
+    TextStrip(const TextStrip &) {}
+    TextStrip &operator=(const TextStrip &) { return *this; }
+
+    Bitmap::Font _font;
+    Bitmap::Color _textColor;
+    String _text;
+    Bitmap *strip;
+    bool valid;
+
+    void render();
+};
+
+#endif
@@ -6,6 +6,7 @@ This example is placed into the public domain.
 */
 
 #include <DMD.h>
+#include <TextStrip.h>
 #include <DejaVuSans9.h>
 #include <DejaVuSansBold9.h>
 #include <DejaVuSansItalic9.h>
@@ -130,15 +131,18 @@ void drawMonoText()
 
 static const char message[] = "Eat at Joes!";
 
+TextStrip marquee;
+
 void drawMarquee()
 {
     int width = display.width();
-    display.setFont(DejaVuSans9);
-    int msgWidth = display.textWidth(message);
+    marquee.setFont(DejaVuSans9);
+    marquee.setText(message);
+    int msgWidth = marquee.width();
     int fullScroll = msgWidth + width + 1;
     for (int x = 0; x < fullScroll; ++x) {
         display.clear();
-        display.drawText(width - x, 3, message);
+        marquee.draw(&display, width - x, 3);
         delay(50);
     }
 }
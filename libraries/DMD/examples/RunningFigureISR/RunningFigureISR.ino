@@ -250,6 +250,7 @@ ISR(TIMER1_OVF_vect)
 }
 
 void setup() {
+    display.setDoubleBuffer(true);
     display.enableTimer1();
 }
 
@@ -259,5 +260,9 @@ void loop() {
     display.drawBitmap(x, 0, frames[frame]);
     frame = (frame + 1) % NUM_FRAMES;
 
+    // Show the new frame at the start of the next refresh cycle.
+    display.queueSwap();
+    display.waitForSwap();
+
     delay(ADVANCE_MS);
 }
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24SecureStorage.h"
+#include "../I2C/EEPROM24.h"
+
+/**
+ * \class EEPROM24SecureStorage EEPROM24SecureStorage.h <EEPROM24SecureStorage.h>
+ * \brief Encrypted and authenticated storage in an external 24LCXX
+ * I2C EEPROM.
+ *
+ * The following example keeps 4096 bytes of encrypted storage at the
+ * start of a 24LC256, with the data divided into 44-byte pages so that
+ * each copy of a page and its header fill one 64-byte page of the EEPROM.
+ * There are two copies of each page, which gives 32 pages of data:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <ChaChaPoly.h>
+ * #include <SoftI2C.h>
+ * #include <EEPROM24.h>
+ * #include <EEPROM24SecureStorage.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * EEPROM24 eeprom(bus, EEPROM_24LC256);
+ * EEPROM24SecureStorage storage(eeprom, 0, 4096);
+ * ChaChaPoly cipher;
+ * uint8_t page[44];
+ *
+ * void setup() {
+ *     cipher.setKey(storageKey, 32);
+ *     storage.begin(cipher, page, sizeof(page));
+ *     if (!storage.isFormatted())
+ *         storage.format();
+ * }
+ * \endcode
+ *
+ * An EEPROM that has been erased to 0xFF must be formatted with
+ * SecureStorage::format() before it is used.
+ *
+ * \sa SecureStorage, EEPROM24
+ */
+
+/**
+ * \brief Constructs a new secure storage object for an external EEPROM.
+ *
+ * \param eeprom The EEPROM to store the data in.
+ * \param address The address of the start of the storage area within
+ * the EEPROM.
+ * \param size The size of the storage area in bytes, including the
+ * two copies and the overhead of each page.
+ */
+EEPROM24SecureStorage::EEPROM24SecureStorage(EEPROM24 &eeprom,
+                                             unsigned long address,
+                                             unsigned long size)
+    : SecureStorage(size)
+    , _eeprom(&eeprom)
+    , _address(address)
+{
+}
+
+/**
+ * \brief Destroys this external EEPROM secure storage object.
+ */
+EEPROM24SecureStorage::~EEPROM24SecureStorage()
+{
+}
+
+bool EEPROM24SecureStorage::readRaw(unsigned long address, void *data, size_t len)
+{
+    return _eeprom->read(_address + address, data, len) == len;
+}
+
+bool EEPROM24SecureStorage::writeRaw(unsigned long address, const void *data, size_t len)
+{
+    return _eeprom->write(_address + address, data, len) == len;
+}
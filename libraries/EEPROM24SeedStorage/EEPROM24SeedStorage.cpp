@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24SeedStorage.h"
+#include "../I2C/EEPROM24.h"
+
+/**
+ * \class EEPROM24SeedStorage EEPROM24SeedStorage.h <EEPROM24SeedStorage.h>
+ * \brief Stores the random seed in an external 24LCXX I2C EEPROM.
+ *
+ * External EEPROM's are typically rated for more erase/write cycles than
+ * the internal EEPROM of an AVR microcontroller and keep the wear off the
+ * microcontroller itself.  The following example saves the seed to
+ * address 0 of a 24LC256 on the I2C bus:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <RNG.h>
+ * #include <SoftI2C.h>
+ * #include <EEPROM24.h>
+ * #include <EEPROM24SeedStorage.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * EEPROM24 eeprom(bus, EEPROM_24LC256);
+ * EEPROM24SeedStorage seedStorage(eeprom, 0);
+ *
+ * void setup() {
+ *     // Rotate the seed through 8 slots to spread out the wear.
+ *     RNG.begin("MyApp 1.0", seedStorage, 8);
+ * }
+ * \endcode
+ *
+ * Bytes that already hold the value being written are not rewritten.
+ *
+ * \sa SeedStorage, EEPROM24
+ */
+
+/**
+ * \brief Constructs a new seed storage object for an external EEPROM.
+ *
+ * \param eeprom The EEPROM to store the seed in.
+ * \param address The address of the start of the storage area within
+ * the EEPROM.
+ */
+EEPROM24SeedStorage::EEPROM24SeedStorage(EEPROM24 &eeprom, unsigned long address)
+    : _eeprom(&eeprom)
+    , _address(address)
+{
+}
+
+/**
+ * \brief Destroys this external EEPROM seed storage object.
+ */
+EEPROM24SeedStorage::~EEPROM24SeedStorage()
+{
+}
+
+uint8_t EEPROM24SeedStorage::read(unsigned int offset)
+{
+    return _eeprom->read(_address + offset);
+}
+
+void EEPROM24SeedStorage::write(unsigned int offset, uint8_t value)
+{
+    if (_eeprom->read(_address + offset) != value)
+        _eeprom->write(_address + offset, value);
+}
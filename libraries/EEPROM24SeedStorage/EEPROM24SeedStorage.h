@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_EEPROM24SEEDSTORAGE_H
+#define CRYPTO_EEPROM24SEEDSTORAGE_H
+
+#include "SeedStorage.h"
+
+class EEPROM24;
+
+class EEPROM24SeedStorage : public SeedStorage
+{
+public:
+    EEPROM24SeedStorage(EEPROM24 &eeprom, unsigned long address = 0);
+    virtual ~EEPROM24SeedStorage();
+
+    uint8_t read(unsigned int offset);
+    void write(unsigned int offset, uint8_t value);
+
+private:
+    EEPROM24 *_eeprom;
+    unsigned long _address;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24ImageSource.h"
+#include "../I2C/EEPROM24.h"
+
+/**
+ * \class EEPROM24ImageSource EEPROM24ImageSource.h <EEPROM24ImageSource.h>
+ * \brief Reads a firmware image from a 24LCXX EEPROM in the background.
+ *
+ * The reads are submitted to TwiI2C as asynchronous requests, so the
+ * TWI interrupt handler fills the buffer while the main loop is doing
+ * something else, such as hashing the previous chunk of the image in
+ * FirmwareVerifier:
+ *
+ * \code
+ * TwiI2C i2c(400000UL);
+ * EEPROM24 eeprom(i2c, EEPROM_24LC256);
+ * EEPROM24ImageSource source(eeprom, i2c);
+ *
+ * ISR(TWI_vect)
+ * {
+ *     i2c.handleInterrupt();
+ * }
+ * \endcode
+ *
+ * The \a bus must be the same TwiI2C object that \a eeprom was
+ * constructed with.  Queued writes on the EEPROM are completed before
+ * each read is started.
+ *
+ * \sa FirmwareVerifier, TwiI2C, EEPROM24
+ */
+
+/**
+ * \brief Constructs a new image source for \a eeprom on \a bus.
+ */
+EEPROM24ImageSource::EEPROM24ImageSource(EEPROM24 &eeprom, TwiI2C &bus)
+    : _eeprom(&eeprom)
+    , _bus(&bus)
+    , address(0)
+    , buffer(0)
+    , remaining(0)
+{
+    request.status = TwiI2C::Idle;
+    request.rxlen = 0;
+}
+
+/**
+ * \brief Destroys this image source after waiting for any read that
+ * is in progress.
+ */
+EEPROM24ImageSource::~EEPROM24ImageSource()
+{
+    // The bus still points at the request until it has finished.
+    while (request.status == TwiI2C::Pending)
+        ;
+}
+
+bool EEPROM24ImageSource::startRead(unsigned long offset, void *data, size_t len)
+{
+    unsigned long size = _eeprom->size();
+    if (request.status == TwiI2C::Pending || remaining)
+        return false;
+    if (offset >= size || len > (size - offset))
+        return false;
+    _eeprom->flush();
+    address = offset;
+    buffer = (uint8_t *)data;
+    remaining = len;
+    request.rxlen = 0;
+    return startPart();
+}
+
+uint8_t EEPROM24ImageSource::status()
+{
+    uint8_t status = request.status;
+    if (status == TwiI2C::Pending)
+        return Pending;
+    if (status == TwiI2C::Failed) {
+        remaining = 0;
+        return Failed;
+    }
+    address += request.rxlen;
+    buffer += request.rxlen;
+    remaining -= request.rxlen;
+    request.rxlen = 0;
+    if (!remaining)
+        return Done;
+    return startPart() ? Pending : Failed;
+}
+
+/**
+ * \internal
+ * \brief Submits the request for the next part of the current read.
+ *
+ * \return Returns false if the request could not be submitted.
+ */
+bool EEPROM24ImageSource::startPart()
+{
+    // Sequential reads don't cross the 64K blocks of the larger chips.
+    unsigned long count = remaining;
+    if (_eeprom->_mode == EE_BSEL_17BIT_ADDR ||
+            _eeprom->_mode == EE_BSEL_17BIT_ADDR_ALT) {
+        unsigned long blockLeft = 0x10000UL - (address & 0xFFFFUL);
+        if (count > blockLeft)
+            count = blockLeft;
+    }
+
+    unsigned int device;
+    request.txlen = _eeprom->formatAddress(address, addr, &device);
+    request.address = (uint8_t)device;
+    request.txbuf = addr;
+    request.rxbuf = buffer;
+    request.rxlen = (unsigned int)count;
+    request.callback = 0;
+    if (!_bus->submit(&request)) {
+        request.rxlen = 0;
+        remaining = 0;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FirmwareVerifier.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class FirmwareVerifier FirmwareVerifier.h <FirmwareVerifier.h>
+ * \brief Verifies the Ed25519ph signature on a firmware image while the
+ * image is being read.
+ *
+ * Reading an image into memory, hashing it, and then checking the
+ * signature one step after another takes the sum of the I/O time and the
+ * hashing time.  FirmwareVerifier splits the caller's buffer into two
+ * halves and reads the next chunk of the image into one half while it
+ * is hashing the chunk in the other half.  With an ImageSource that reads
+ * in the background, such as EEPROM24ImageSource, the hashing is hidden
+ * behind the I/O.  The signature check starts as soon as the last chunk
+ * has been hashed.
+ *
+ * \code
+ * uint8_t buffer[256];
+ * FirmwareVerifier verifier(buffer, sizeof(buffer));
+ * Ed25519::PublicKey vendorKey;
+ *
+ * void startUpdateCheck()
+ * {
+ *     vendorKey.setKey(vendorPublicKey);
+ *     verifier.begin(source, imageStart, imageLength, signature, vendorKey);
+ * }
+ *
+ * void loop()
+ * {
+ *     switch (verifier.loop()) {
+ *     case FirmwareVerifier::Valid:   installUpdate(); break;
+ *     case FirmwareVerifier::Invalid: rejectUpdate(); break;
+ *     case FirmwareVerifier::Failed:  retryLater(); break;
+ *     default: break;
+ *     }
+ *     ...
+ * }
+ * \endcode
+ *
+ * Signatures must be Ed25519ph signatures from Ed25519::signPrehash(),
+ * because a plain Ed25519 signature needs the whole image in memory.
+ * Ed25519ph defines the pre-hash to be SHA512, so other hash algorithms
+ * cannot be used.  A chunk size that is a multiple of the 128-byte SHA512
+ * block size is most efficient.
+ *
+ * \sa ImageSource, Ed25519::verifyPrehash()
+ */
+
+/**
+ * \brief Constructs a new firmware verifier.
+ *
+ * \param buffer Points to the buffer to read the image into.
+ * \param size The size of the buffer in bytes.  Each chunk of the image
+ * is half this size.
+ *
+ * The buffer must remain valid, and not be used for anything else,
+ * while a verification is in progress.
+ */
+FirmwareVerifier::FirmwareVerifier(void *buffer, size_t size)
+    : chunkSize(size / 2)
+    , _source(0)
+    , key(0)
+    , ctx(0)
+    , ctxLen(0)
+    , nextOffset(0)
+    , unread(0)
+    , _processed(0)
+    , _length(0)
+    , readLen(0)
+    , current(0)
+    , state(Idle)
+{
+    buffers[0] = (uint8_t *)buffer;
+    buffers[1] = ((uint8_t *)buffer) + chunkSize;
+}
+
+/**
+ * \brief Destroys this firmware verifier after clearing sensitive
+ * information.
+ */
+FirmwareVerifier::~FirmwareVerifier()
+{
+    clean(sig);
+}
+
+/**
+ * \brief Begins verifying a firmware image.
+ *
+ * \param source The source to read the image from.
+ * \param offset The offset of the start of the image in \a source.
+ * \param length The length of the image in bytes.
+ * \param signature The Ed25519ph signature on the image.
+ * \param publicKey The public key to check the signature with.
+ * \param context Points to the Ed25519ph context string, or NULL for none.
+ * \param contextLen The length of the context string in bytes.
+ *
+ * \return Returns false if the first read could not be started or the
+ * buffer is too small.
+ *
+ * The signature is copied, but \a source, \a publicKey, and \a context
+ * must remain valid until the verification has finished.  The first
+ * chunk is requested straight away; call loop() regularly to make
+ * progress on the rest.
+ *
+ * \sa loop(), end()
+ */
+bool FirmwareVerifier::begin(ImageSource &source, unsigned long offset,
+                             unsigned long length,
+                             const uint8_t signature[64],
+                             const Ed25519::PublicKey &publicKey,
+                             const void *context, size_t contextLen)
+{
+    end();
+    if (!chunkSize) {
+        state = Failed;
+        return false;
+    }
+    memcpy(sig, signature, sizeof(sig));
+    _source = &source;
+    key = &publicKey;
+    ctx = context;
+    ctxLen = contextLen;
+    nextOffset = offset;
+    unread = length;
+    _processed = 0;
+    _length = length;
+    current = 0;
+    hash.reset();
+    state = Busy;
+    if (!startRead()) {
+        state = Failed;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Abandons the current verification and clears the hash state.
+ *
+ * If a read is still in progress, then the source may go on writing to
+ * the buffer until the read finishes.
+ *
+ * \sa begin()
+ */
+void FirmwareVerifier::end()
+{
+    if (state != Idle) {
+        hash.clear();
+        clean(sig);
+        state = Idle;
+    }
+    readLen = 0;
+}
+
+/**
+ * \brief Performs the next step of the verification.
+ *
+ * \return Returns the status after this step: FirmwareVerifier::Busy if
+ * the verification is still in progress, FirmwareVerifier::Valid or
+ * FirmwareVerifier::Invalid when the signature has been checked, or
+ * FirmwareVerifier::Failed if the image could not be read.
+ *
+ * Each call hashes at most one chunk, during which the read of the next
+ * chunk is already in progress.  The call that hashes the last chunk
+ * also checks the signature, which takes much longer than the other steps.
+ *
+ * \sa status(), begin()
+ */
+uint8_t FirmwareVerifier::loop()
+{
+    if (state != Busy)
+        return state;
+
+    if (readLen) {
+        // Wait for the current chunk to arrive.
+        uint8_t status = _source->status();
+        if (status == ImageSource::Pending)
+            return state;
+        if (status != ImageSource::Done) {
+            state = Failed;
+            return state;
+        }
+
+        // Start reading the next chunk into the other buffer and then
+        // hash this chunk while the read is in progress.
+        uint8_t *data = buffers[current];
+        size_t len = readLen;
+        current ^= 1;
+        if (!startRead()) {
+            state = Failed;
+            return state;
+        }
+        hash.update(data, len);
+        _processed += len;
+        if (readLen)
+            return state;
+    }
+
+    // The whole image has been hashed, so check the signature.
+    if (Ed25519::verifyPrehash(sig, *key, hash, ctx, ctxLen))
+        state = Valid;
+    else
+        state = Invalid;
+    clean(sig);
+    return state;
+}
+
+/**
+ * \fn uint8_t FirmwareVerifier::status() const
+ * \brief Returns the status of the current verification without
+ * performing any more of it.
+ *
+ * \sa loop()
+ */
+
+/**
+ * \fn unsigned long FirmwareVerifier::processed() const
+ * \brief Returns the number of bytes of the image that have been hashed.
+ *
+ * \sa length()
+ */
+
+/**
+ * \fn unsigned long FirmwareVerifier::length() const
+ * \brief Returns the length of the image that is being verified.
+ *
+ * \sa processed()
+ */
+
+/**
+ * \internal
+ * \brief Starts reading the next chunk of the image into the buffer
+ * indicated by \c current.
+ *
+ * \return Returns false if the source could not start the read.
+ *
+ * Sets \c readLen to zero if there is nothing left to read.
+ */
+bool FirmwareVerifier::startRead()
+{
+    size_t len = chunkSize;
+    if (len > unread)
+        len = (size_t)unread;
+    readLen = len;
+    if (!len)
+        return true;
+    if (!_source->startRead(nextOffset, buffers[current], len)) {
+        readLen = 0;
+        return false;
+    }
+    nextOffset += len;
+    unread -= len;
+    return true;
+}
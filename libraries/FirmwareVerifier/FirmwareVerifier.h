@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_FIRMWAREVERIFIER_H
+#define CRYPTO_FIRMWAREVERIFIER_H
+
+#include "ImageSource.h"
+#include "Ed25519.h"
+#include "SHA512.h"
+
+class FirmwareVerifier
+{
+public:
+    FirmwareVerifier(void *buffer, size_t size);
+    ~FirmwareVerifier();
+
+    enum
+    {
+        Idle,
+        Busy,
+        Valid,
+        Invalid,
+        Failed
+    };
+
+    bool begin(ImageSource &source, unsigned long offset, unsigned long length,
+               const uint8_t signature[64], const Ed25519::PublicKey &publicKey,
+               const void *context = 0, size_t contextLen = 0);
+    void end();
+
+    uint8_t loop();
+    uint8_t status() const { return state; }
+
+    unsigned long processed() const { return _processed; }
+    unsigned long length() const { return _length; }
+
+private:
+    SHA512 hash;
+    uint8_t sig[64];
+    uint8_t *buffers[2];
+    size_t chunkSize;
+    ImageSource *_source;
+    const Ed25519::PublicKey *key;
+    const void *ctx;
+    size_t ctxLen;
+    unsigned long nextOffset;
+    unsigned long unread;
+    unsigned long _processed;
+    unsigned long _length;
+    size_t readLen;
+    uint8_t current;
+    uint8_t state;
+
+    bool startRead();
+
+    // Disable copy constructor and operator=().
+    FirmwareVerifier(const FirmwareVerifier &) {}
+    FirmwareVerifier &operator=(const FirmwareVerifier &) { return *this; }
+};
+
+#endif
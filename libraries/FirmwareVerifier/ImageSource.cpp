@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ImageSource.h"
+
+/**
+ * \class ImageSource ImageSource.h <ImageSource.h>
+ * \brief Abstract base class for sources of firmware images that can be
+ * read in the background.
+ *
+ * FirmwareVerifier uses this interface to read the next chunk of an
+ * image while it is hashing the previous one.  A source starts a read
+ * with startRead() and returns immediately; status() is then polled
+ * until the read is Done or has Failed.  Sources that sit on a bus with
+ * interrupt-driven or DMA transfers, such as EEPROM24ImageSource, get
+ * the full benefit.  A source for a device that can only be read with
+ * blocking calls can still perform the whole read in startRead() and
+ * report Done straight away; it just won't overlap with the hashing.
+ *
+ * \sa FirmwareVerifier, EEPROM24ImageSource
+ */
+
+/**
+ * \brief Constructs a new image source.
+ */
+ImageSource::ImageSource()
+{
+}
+
+/**
+ * \brief Destroys this image source.
+ */
+ImageSource::~ImageSource()
+{
+}
+
+/**
+ * \fn bool ImageSource::startRead(unsigned long offset, void *data, size_t len)
+ * \brief Starts reading a chunk of the image.
+ *
+ * \param offset The offset of the chunk within the source device.
+ * \param data The buffer to read the chunk into, which must remain
+ * valid until the read finishes.
+ * \param len The number of bytes to read.
+ *
+ * \return Returns false if the read could not be started, for example
+ * because \a offset and \a len are out of range for the device.
+ *
+ * Only one read is in progress at a time.
+ *
+ * \sa status()
+ */
+
+/**
+ * \fn uint8_t ImageSource::status()
+ * \brief Returns the status of the read that was started by startRead().
+ *
+ * \return Returns ImageSource::Pending while the read is in progress,
+ * ImageSource::Done when all of the data is in the buffer, or
+ * ImageSource::Failed if the device stopped responding.
+ *
+ * FirmwareVerifier calls this function regularly while a read is in
+ * progress, so the source can use it to move a multi-part read on to
+ * its next part.
+ */
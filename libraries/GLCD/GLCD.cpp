@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "GLCD.h"
+
+/**
+ * \class GLCD GLCD.h <GLCD.h>
+ * \brief Base class for monochrome graphics LCD and OLED modules that
+ * are drawn with Bitmap.
+ *
+ * GLCD keeps a copy of the screen in main memory and inherits all of the
+ * drawing and text functions of Bitmap, in the same way as DMD.  Drawing
+ * does not change the module until update() is called, which sends the
+ * rows between Bitmap::dirtyTop() and Bitmap::dirtyBottom() to the module
+ * and then clears the dirty range:
+ *
+ * \code
+ * #include <TwiI2C.h>
+ * #include <SSD1306.h>
+ * #include <DejaVuSans9.h>
+ *
+ * TwiI2C bus;
+ * SSD1306 display(bus);
+ *
+ * void setup() {
+ *     display.begin();
+ *     display.setFont(DejaVuSans9);
+ *     display.drawText(0, 0, "Hello");
+ *     display.update();
+ * }
+ * \endcode
+ *
+ * Most modules are organized into pages of 8 rows, so the dirty range is
+ * rounded outwards to whole pages and each page is sent as one burst with
+ * the module's column address auto-incrementing.  Drawing to a small part
+ * of the screen only costs the pages that it touches.
+ *
+ * The following modules are supported:
+ *
+ * \li SSD1306 OLED modules over I2C, through any I2CMaster.
+ * \li ST7920 graphics LCD modules over SPI.
+ * \li KS0108 graphics LCD modules over the 8-bit parallel interface.
+ *
+ * \sa Bitmap, SSD1306, ST7920, KS0108
+ */
+
+/**
+ * \brief Constructs a new graphics display handler that is \a width x
+ * \a height pixels in size.
+ *
+ * The whole screen is marked as dirty so that the first update() will
+ * send it to the module.
+ */
+GLCD::GLCD(int width, int height)
+    : Bitmap(width, height)
+{
+}
+
+/**
+ * \brief Destroys this graphics display handler.
+ */
+GLCD::~GLCD()
+{
+}
+
+/**
+ * \brief Sends the rows that have been drawn to since the last update
+ * to the module.
+ *
+ * \sa updateAll(), Bitmap::isDirty()
+ */
+void GLCD::update()
+{
+    if (!isDirty() || !isValid())
+        return;
+    writeRows(dirtyTop(), dirtyBottom());
+    clearDirty();
+}
+
+/**
+ * \brief Sends the whole screen to the module.
+ *
+ * This can be used to restore the module's contents after it has been
+ * reset or powered down.
+ *
+ * \sa update()
+ */
+void GLCD::updateAll()
+{
+    markDirty();
+    update();
+}
+
+/**
+ * \fn void GLCD::writeRows(int top, int bottom)
+ * \brief Writes the rows between \a top and \a bottom inclusive to
+ * the module.
+ *
+ * Subclasses may round the range outwards to suit the module's memory
+ * layout.
+ */
+
+/**
+ * \brief Converts 8 columns of a page of 8 rows into the column bytes
+ * that page-oriented modules expect.
+ *
+ * \param page The page to convert, covering rows page * 8 to page * 8 + 7.
+ * \param x The first column to convert, which must be a multiple of 8.
+ * \param out Returns the 8 column bytes, with bit 0 of each byte for the
+ * top row of the page and a 1 bit for a pixel that is on.
+ *
+ * Rows past the bottom of the screen are returned as off.
+ */
+void GLCD::pageBytes(int page, int x, uint8_t *out) const
+{
+    const uint8_t *in = data() + page * 8 * stride() + (x >> 3);
+    int rows = height() - page * 8;
+    if (rows > 8)
+        rows = 8;
+    for (uint8_t col = 0; col < 8; ++col)
+        out[col] = 0;
+    for (uint8_t row = 0; row < rows; ++row) {
+        // Set bits in the framebuffer are pixels that are off.
+        uint8_t bits = ~(*in);
+        uint8_t rowBit = 1 << row;
+        for (uint8_t col = 0; col < 8; ++col) {
+            if (bits & (0x80 >> col))
+                out[col] |= rowBit;
+        }
+        in += stride();
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "KS0108.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class KS0108 KS0108.h <KS0108.h>
+ * \brief Handle 128x64 KS0108 graphics LCD modules over the 8-bit
+ * parallel interface.
+ *
+ * The module has two controllers, one for each half of the screen, that
+ * are selected with CS1 and CS2.  The R/W line must be tied to GND because
+ * the module is only ever written to.  Modules differ in whether CS1 and
+ * CS2 are active high or active low; this class assumes active high,
+ * which is the most common.
+ *
+ * \code
+ * #include <KS0108.h>
+ *
+ * // RS, E, CS1, CS2, D0-D7
+ * KS0108 display(A2, A4, A0, A1, 8, 9, 10, 11, 4, 5, 6, 7);
+ *
+ * void setup() {
+ *     display.begin();
+ *     display.drawLine(0, 0, 127, 63);
+ *     display.update();
+ * }
+ * \endcode
+ *
+ * The controllers' memory is organized into pages of 8 rows with a
+ * column address that auto-increments, so update() sends each dirty page
+ * to each controller as one burst of 64 bytes after setting the address.
+ *
+ * \sa GLCD
+ */
+
+// Commands.
+#define KS0108_DISPLAY_OFF      0x3E
+#define KS0108_DISPLAY_ON       0x3F
+#define KS0108_START_LINE       0xC0
+#define KS0108_SET_PAGE         0xB8
+#define KS0108_SET_COLUMN       0x40
+
+/**
+ * \brief Constructs a new KS0108 display handler.
+ *
+ * \param rs The pin for the D/I (register select) line.
+ * \param enable The pin for the E (enable) line.
+ * \param cs1 The pin for the chip select of the left half of the screen.
+ * \param cs2 The pin for the chip select of the right half of the screen.
+ * \param d0 The pin for the D0 data line, and so on for \a d1 to \a d7.
+ *
+ * \sa begin()
+ */
+KS0108::KS0108(uint8_t rs, uint8_t enable, uint8_t cs1, uint8_t cs2,
+               uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+               uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
+    : GLCD(128, 64)
+    , _rs(rs)
+    , _enable(enable)
+{
+    _cs[0] = cs1;
+    _cs[1] = cs2;
+    _data[0] = d0;
+    _data[1] = d1;
+    _data[2] = d2;
+    _data[3] = d3;
+    _data[4] = d4;
+    _data[5] = d5;
+    _data[6] = d6;
+    _data[7] = d7;
+}
+
+/**
+ * \brief Initializes the module, clears the screen, and turns it on.
+ */
+void KS0108::begin()
+{
+    pinMode(_rs, OUTPUT);
+    pinMode(_enable, OUTPUT);
+    digitalWrite(_enable, LOW);
+    for (uint8_t index = 0; index < 2; ++index) {
+        pinMode(_cs[index], OUTPUT);
+        digitalWrite(_cs[index], LOW);
+    }
+    for (uint8_t index = 0; index < 8; ++index)
+        pinMode(_data[index], OUTPUT);
+    for (uint8_t chip = 0; chip < 2; ++chip) {
+        selectChip(chip);
+        send(KS0108_START_LINE, false);
+    }
+    clear();
+    updateAll();
+    setDisplayOn(true);
+}
+
+/**
+ * \brief Turns the module on or off according to \a on, without
+ * changing its contents.
+ */
+void KS0108::setDisplayOn(bool on)
+{
+    for (uint8_t chip = 0; chip < 2; ++chip) {
+        selectChip(chip);
+        send(on ? KS0108_DISPLAY_ON : KS0108_DISPLAY_OFF, false);
+    }
+}
+
+void KS0108::writeRows(int top, int bottom)
+{
+    uint8_t columns[8];
+    for (uint8_t page = top >> 3; page <= (bottom >> 3); ++page) {
+        for (uint8_t chip = 0; chip < 2; ++chip) {
+            selectChip(chip);
+            send(KS0108_SET_PAGE | page, false);
+            send(KS0108_SET_COLUMN, false);
+            for (int x = chip * 64; x < (chip + 1) * 64; x += 8) {
+                pageBytes(page, x, columns);
+                for (uint8_t index = 0; index < 8; ++index)
+                    send(columns[index], true);
+            }
+        }
+    }
+}
+
+// Selects one of the two controllers.
+void KS0108::selectChip(uint8_t chip)
+{
+    digitalWrite(_cs[chip], HIGH);
+    digitalWrite(_cs[chip ^ 1], LOW);
+}
+
+// Sends a command or data byte to the selected controller.
+void KS0108::send(uint8_t value, bool isData)
+{
+    digitalWrite(_rs, isData ? HIGH : LOW);
+    for (uint8_t index = 0; index < 8; ++index)
+        digitalWrite(_data[index], (value & (1 << index)) ? HIGH : LOW);
+    digitalWrite(_enable, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(_enable, LOW);
+    delayMicroseconds(KS0108_DELAY_US);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef KS0108_h
+#define KS0108_h
+
+#include "GLCD.h"
+
+// Time in microseconds for the module to execute each command or data byte.
+#if !defined(KS0108_DELAY_US)
+#define KS0108_DELAY_US 5
+#endif
+
+class KS0108 : public GLCD
+{
+public:
+    KS0108(uint8_t rs, uint8_t enable, uint8_t cs1, uint8_t cs2,
+           uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+           uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7);
+
+    void begin();
+
+    void setDisplayOn(bool on);
+
+protected:
+    void writeRows(int top, int bottom);
+
+private:
+    uint8_t _rs;
+    uint8_t _enable;
+    uint8_t _cs[2];
+    uint8_t _data[8];
+
+    void selectChip(uint8_t chip);
+    void send(uint8_t value, bool isData);
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SSD1306.h"
+#include <I2CMaster.h>
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class SSD1306 SSD1306.h <SSD1306.h>
+ * \brief Handle 128x64 and 128x32 SSD1306 OLED modules over I2C.
+ *
+ * The module is driven through any I2CMaster, such as TwiI2C or SoftI2C.
+ * update() sends the dirty pages in one burst per I2C transaction, with
+ * the module in horizontal addressing mode so that the column and page
+ * addresses are only sent once per update:
+ *
+ * \code
+ * #include <TwiI2C.h>
+ * #include <SSD1306.h>
+ *
+ * TwiI2C bus;
+ * SSD1306 display(bus);
+ *
+ * void setup() {
+ *     display.begin();
+ *     display.drawCircle(64, 32, 20);
+ *     display.update();
+ * }
+ * \endcode
+ *
+ * Sending the full 1K screen takes about 23 milliseconds at 400 kHz,
+ * so an animation that only touches a few pages can update much faster.
+ *
+ * \sa GLCD, I2CMaster
+ */
+
+// Control bytes that start each I2C transaction.
+#define SSD1306_CONTROL_COMMAND     0x00
+#define SSD1306_CONTROL_DATA        0x40
+
+// Commands.
+#define SSD1306_SET_CONTRAST        0x81
+#define SSD1306_DISPLAY_OFF         0xAE
+#define SSD1306_DISPLAY_ON          0xAF
+#define SSD1306_COLUMN_ADDRESS      0x21
+#define SSD1306_PAGE_ADDRESS        0x22
+
+// Maximum number of data bytes to send in each I2C transaction.
+#define SSD1306_MAX_BURST           128
+
+/**
+ * \brief Constructs a new SSD1306 display handler that is 128 pixels wide
+ * and \a height pixels high, on \a bus at the 7-bit I2C \a address.
+ *
+ * \a height should be 64 or 32.  The address is usually 0x3C, or 0x3D
+ * for modules with the address jumper changed.
+ *
+ * \sa begin()
+ */
+SSD1306::SSD1306(I2CMaster &bus, int height, unsigned int address)
+    : GLCD(128, height)
+    , _bus(&bus)
+    , _address(address)
+    , connected(false)
+{
+}
+
+/**
+ * \brief Initializes the module, clears the screen, and turns it on.
+ *
+ * Returns false if the module did not respond on the I2C bus.
+ *
+ * \sa isConnected()
+ */
+bool SSD1306::begin()
+{
+    static uint8_t const init[] PROGMEM = {
+        SSD1306_DISPLAY_OFF,
+        0xD5, 0x80,         // Clock divide ratio and oscillator frequency.
+        0xA8, 0x3F,         // Multiplex ratio (height - 1).
+        0xD3, 0x00,         // No display offset.
+        0x40,               // Display start line 0.
+        0x8D, 0x14,         // Enable the charge pump.
+        0x20, 0x00,         // Horizontal addressing mode.
+        0xA1,               // Column 127 is segment 0.
+        0xC8,               // Scan from COM[N-1] to COM0.
+        0xDA, 0x12,         // COM pin configuration.
+        SSD1306_SET_CONTRAST, 0xCF,
+        0xD9, 0xF1,         // Pre-charge period.
+        0xDB, 0x40,         // VCOMH deselect level.
+        0xA4,               // Display the RAM contents.
+        0xA6                // Normal, non-inverted display.
+    };
+    uint8_t cmds[sizeof(init)];
+    memcpy_P(cmds, init, sizeof(init));
+    if (height() <= 32) {
+        cmds[4] = 0x1F;
+        cmds[16] = 0x02;
+    }
+    command(cmds, sizeof(cmds));
+    if (!connected)
+        return false;
+    clear();
+    updateAll();
+    setDisplayOn(true);
+    return connected;
+}
+
+/**
+ * \fn unsigned int SSD1306::address() const
+ * \brief Returns the I2C address of the module.
+ */
+
+/**
+ * \fn bool SSD1306::isConnected() const
+ * \brief Returns true if the module acknowledged the last transaction;
+ * false otherwise.
+ */
+
+/**
+ * \brief Sets the \a contrast of the module between 0 and 255.
+ */
+void SSD1306::setContrast(uint8_t contrast)
+{
+    uint8_t cmds[2] = {SSD1306_SET_CONTRAST, contrast};
+    command(cmds, 2);
+}
+
+/**
+ * \brief Turns the module on or off according to \a on, without
+ * changing its contents.
+ */
+void SSD1306::setDisplayOn(bool on)
+{
+    uint8_t cmd = on ? SSD1306_DISPLAY_ON : SSD1306_DISPLAY_OFF;
+    command(&cmd, 1);
+}
+
+void SSD1306::writeRows(int top, int bottom)
+{
+    // Restrict the module's address window to the dirty pages so that
+    // they can be sent as one stream of bytes.
+    uint8_t firstPage = top >> 3;
+    uint8_t lastPage = bottom >> 3;
+    uint8_t cmds[6] = {
+        SSD1306_COLUMN_ADDRESS, 0, (uint8_t)(width() - 1),
+        SSD1306_PAGE_ADDRESS, firstPage, lastPage
+    };
+    command(cmds, 6);
+    if (!connected)
+        return;
+
+    // Send the pages in bursts that fit within the bus's transfer size.
+    unsigned int maxBytes = _bus->maxTransferSize() - 1;
+    if (maxBytes > SSD1306_MAX_BURST)
+        maxBytes = SSD1306_MAX_BURST;
+    unsigned int pending = 0;
+    uint8_t columns[8];
+    for (uint8_t page = firstPage; page <= lastPage; ++page) {
+        for (int x = 0; x < width(); x += 8) {
+            pageBytes(page, x, columns);
+            for (uint8_t index = 0; index < 8; ++index) {
+                if (!pending) {
+                    _bus->startWrite(_address);
+                    _bus->write(SSD1306_CONTROL_DATA);
+                }
+                _bus->write(columns[index]);
+                if (++pending >= maxBytes) {
+                    connected = _bus->endWrite();
+                    pending = 0;
+                    if (!connected)
+                        return;
+                }
+            }
+        }
+    }
+    if (pending)
+        connected = _bus->endWrite();
+}
+
+// Sends a sequence of commands to the module in one transaction.
+void SSD1306::command(const uint8_t *cmds, uint8_t len)
+{
+    _bus->startWrite(_address);
+    _bus->write(SSD1306_CONTROL_COMMAND);
+    while (len-- > 0)
+        _bus->write(*cmds++);
+    connected = _bus->endWrite();
+}
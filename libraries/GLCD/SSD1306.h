@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SSD1306_h
+#define SSD1306_h
+
+#include "GLCD.h"
+
+class I2CMaster;
+
+class SSD1306 : public GLCD
+{
+public:
+    explicit SSD1306(I2CMaster &bus, int height = 64, unsigned int address = 0x3C);
+
+    bool begin();
+
+    unsigned int address() const { return _address; }
+    bool isConnected() const { return connected; }
+
+    void setContrast(uint8_t contrast);
+    void setDisplayOn(bool on);
+
+protected:
+    void writeRows(int top, int bottom);
+
+private:
+    I2CMaster *_bus;
+    unsigned int _address;
+    bool connected;
+
+    void command(const uint8_t *cmds, uint8_t len);
+};
+
+#endif
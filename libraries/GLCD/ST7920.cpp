@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ST7920.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <pins_arduino.h>
+#include <avr/io.h>
+
+/**
+ * \class ST7920 ST7920.h <ST7920.h>
+ * \brief Handle 128x64 ST7920 graphics LCD modules over SPI.
+ *
+ * The module's serial interface is connected to the SPI bus: E (SCLK) to
+ * SCK, R/W (SID) to MOSI, and RS (CS) to \a csPin.  PSB must be tied low
+ * to select the serial interface.  The module does not drive MISO so it
+ * can share the bus with other SPI devices; the SPI settings are saved
+ * and restored around each update().
+ *
+ * \code
+ * #include <ST7920.h>
+ *
+ * ST7920 display(10);
+ *
+ * void setup() {
+ *     display.begin();
+ *     display.drawRect(0, 0, 127, 63);
+ *     display.update();
+ * }
+ * \endcode
+ *
+ * The module's graphics memory is organized as rows of 16-bit words with
+ * the most significant bit on the left, which matches Bitmap.  update()
+ * therefore sends each dirty row as one burst after setting its address.
+ * The module needs about 72 microseconds to execute each byte, so a full
+ * screen takes around 110 milliseconds but a single line of text only a
+ * few milliseconds.  Some modules are faster, in which case define
+ * ST7920_DELAY_US to a smaller value.
+ *
+ * \sa GLCD
+ */
+
+// Synchronization bytes that start each command or data byte.
+#define ST7920_SYNC_COMMAND     0xF8
+#define ST7920_SYNC_DATA        0xFA
+
+// Commands.
+#define ST7920_BASIC            0x30
+#define ST7920_DISPLAY_ON       0x0C
+#define ST7920_CLEAR            0x01
+#define ST7920_ENTRY_MODE       0x06
+#define ST7920_EXTENDED         0x34
+#define ST7920_GRAPHICS_ON      0x36
+#define ST7920_SET_ADDRESS      0x80
+
+/**
+ * \brief Constructs a new ST7920 display handler with its chip select
+ * on \a csPin.
+ *
+ * \sa begin()
+ */
+ST7920::ST7920(uint8_t csPin)
+    : GLCD(128, 64)
+    , _csPin(csPin)
+    , saveSPCR(0)
+    , saveSPSR(0)
+{
+}
+
+/**
+ * \brief Initializes the module, switches it into graphics mode, and
+ * clears the screen.
+ *
+ * The module needs about 40 milliseconds after power on before it can
+ * be initialized.
+ */
+void ST7920::begin()
+{
+    pinMode(_csPin, OUTPUT);
+    digitalWrite(_csPin, LOW);
+    pinMode(SCK, OUTPUT);
+    pinMode(MOSI, OUTPUT);
+    pinMode(SS, OUTPUT);
+
+    select();
+    send(ST7920_SYNC_COMMAND, ST7920_BASIC);
+    send(ST7920_SYNC_COMMAND, ST7920_BASIC);
+    send(ST7920_SYNC_COMMAND, ST7920_DISPLAY_ON);
+    send(ST7920_SYNC_COMMAND, ST7920_CLEAR);
+    delay(2);
+    send(ST7920_SYNC_COMMAND, ST7920_ENTRY_MODE);
+    send(ST7920_SYNC_COMMAND, ST7920_EXTENDED);
+    send(ST7920_SYNC_COMMAND, ST7920_GRAPHICS_ON);
+    deselect();
+    clear();
+    updateAll();
+}
+
+void ST7920::writeRows(int top, int bottom)
+{
+    // The module stays selected for the whole update.  The bottom half of the screen is addressed as though it was to
+    // the right of the top half.
+    const uint8_t *row = data() + top * stride();
+    for (int y = top; y <= bottom; ++y) {
+        if (y < 32) {
+            send(ST7920_SYNC_COMMAND, ST7920_SET_ADDRESS | y);
+            send(ST7920_SYNC_COMMAND, ST7920_SET_ADDRESS);
+        } else {
+            send(ST7920_SYNC_COMMAND, ST7920_SET_ADDRESS | (y - 32));
+            send(ST7920_SYNC_COMMAND, ST7920_SET_ADDRESS | 8);
+        }
+        for (int x = 0; x < stride(); ++x) {
+            // Set bits in the framebuffer are pixels that are off.
+            send(ST7920_SYNC_DATA, ~row[x]);
+        }
+        row += stride();
+    }
+    deselect();
+}
+
+// Selects the module and switches SPI to mode 3 at F_CPU / 16, which is
+// within the module's limits.  The previous SPI settings are saved.
+void ST7920::select()
+{
+    saveSPCR = SPCR;
+    saveSPSR = SPSR;
+    SPCR = _BV(SPE) | _BV(MSTR) | _BV(CPOL) | _BV(CPHA) | _BV(SPR0);
+    SPSR &= ~_BV(SPI2X);
+    digitalWrite(_csPin, HIGH);
+}
+
+// Deselects the module and restores the previous SPI settings.
+void ST7920::deselect()
+{
+    digitalWrite(_csPin, LOW);
+    SPCR = saveSPCR;
+    SPSR = saveSPSR;
+}
+
+// Sends a command or data byte to the module as three SPI bytes.
+void ST7920::send(uint8_t sync, uint8_t value)
+{
+    SPDR = sync;
+    while (!(SPSR & _BV(SPIF)))
+        ;   // Wait for the transfer to complete.
+    SPDR = value & 0xF0;
+    while (!(SPSR & _BV(SPIF)))
+        ;
+    SPDR = value << 4;
+    while (!(SPSR & _BV(SPIF)))
+        ;
+    delayMicroseconds(ST7920_DELAY_US);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ST7920_h
+#define ST7920_h
+
+#include "GLCD.h"
+
+// Time in microseconds for the module to execute each command or data byte.
+#if !defined(ST7920_DELAY_US)
+#define ST7920_DELAY_US 72
+#endif
+
+class ST7920 : public GLCD
+{
+public:
+    explicit ST7920(uint8_t csPin);
+
+    void begin();
+
+protected:
+    void writeRows(int top, int bottom);
+
+private:
+    uint8_t _csPin;
+    uint8_t saveSPCR;
+    uint8_t saveSPSR;
+
+    void send(uint8_t sync, uint8_t value);
+    void select();
+    void deselect();
+};
+
+#endif
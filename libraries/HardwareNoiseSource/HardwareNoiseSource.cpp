@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_STM32) && defined(RNG)
+// The STM32 device headers define RNG as a pointer to the random number
+// peripheral, which clashes with the global RNG object.  Capture the
+// pointer before RNG.h removes the macro.
+static inline RNG_TypeDef *stm32RngPeripheral() { return RNG; }
+#define STM32_RNG   (stm32RngPeripheral())
+#endif
+
+#include "HardwareNoiseSource.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class HardwareNoiseSource HardwareNoiseSource.h <HardwareNoiseSource.h>
+ * \brief Reads random data from the on-chip true random number generator
+ * of the microcontroller.
+ *
+ * Many 32-bit microcontrollers have a true random number generator (TRNG)
+ * peripheral based on the jitter of free-running ring oscillators.  On those
+ * parts this class stirs the output of the TRNG directly into the global
+ * random number pool, which will be full of entropy within a few
+ * milliseconds of the noise source being added to
+ * \link RNGClass RNG\endlink.  No external noise circuit is required.
+ * The following platforms are supported:
+ *
+ * <table>
+ * <tr><td>Platform</td><td>Peripheral</td></tr>
+ * <tr><td>ESP32</td><td>esp_random(), which is only truly random while
+ * the Wi-Fi or Bluetooth radio is running</td></tr>
+ * <tr><td>SAMD51 (Adafruit M4 boards, etc)</td><td>TRNG</td></tr>
+ * <tr><td>STM32 parts with an RNG peripheral</td><td>RNG, which must have
+ * a clock source configured by the board variant</td></tr>
+ * </table>
+ *
+ * On other platforms, including AVR and SAMD21, isSupported() returns false
+ * and the noise source stays in calibration mode without producing output.
+ *
+ * Each 32-byte block that is read from the TRNG is credited with 4 bits of
+ * entropy per byte, which is conservative for these peripherals but still
+ * fills the pool from a few blocks.  The raw bytes are passed through the
+ * continuous health tests before they are used.  Once the pool has been
+ * filled at startup, the TRNG is then read at most every 100 milliseconds
+ * to avoid spending time on the hashing in \link RNGClass::stir()
+ * RNG.stir()\endlink on every call to \link RNGClass::loop()
+ * RNG.loop()\endlink.
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <RNG.h>
+ * #include <HardwareNoiseSource.h>
+ *
+ * // Noise source to seed the random number generator.
+ * HardwareNoiseSource noise;
+ *
+ * void setup() {
+ *     RNG.begin("MyApp 1.0", 500);
+ *     RNG.addNoiseSource(noise);
+ * }
+ *
+ * void loop() {
+ *     RNG.loop();
+ * }
+ * \endcode
+ *
+ * \sa \link RNGClass RNG\endlink, NoiseSource, TransistorNoiseSource,
+ * RingOscillatorNoiseSource
+ */
+
+// Calibration states.
+#define NOISE_NOT_CALIBRATING   0
+#define NOISE_CALIBRATING       1
+
+// Number of bits of entropy to credit for each byte from the TRNG.
+#define HARDWARE_NOISE_CREDIT   4
+
+// Number of bits of credit to deliver as quickly as possible at startup.
+#define HARDWARE_NOISE_STARTUP  512
+
+// Minimum number of milliseconds between reads once the startup
+// credit has been delivered.
+#define HARDWARE_NOISE_INTERVAL 100
+
+// Number of polls to wait for the TRNG to generate a word.
+#define HARDWARE_NOISE_TIMEOUT  10000
+
+#if defined(ARDUINO_ARCH_ESP32)
+#define HARDWARE_NOISE_ESP32    1
+#elif defined(ARDUINO_ARCH_SAMD) && defined(TRNG)
+#define HARDWARE_NOISE_SAMD51   1
+#elif defined(STM32_RNG) && defined(RNG_CR_RNGEN)
+#define HARDWARE_NOISE_STM32    1
+#endif
+
+/**
+ * \brief Constructs a new hardware TRNG noise source.
+ *
+ * The TRNG peripheral is not started until the noise source is added to
+ * \link RNGClass RNG\endlink with
+ * \link RNGClass::addNoiseSource() RNG.addNoiseSource()\endlink.
+ */
+HardwareNoiseSource::HardwareNoiseSource()
+    : calState(NOISE_CALIBRATING)
+    , started(false)
+    , lastStir(0)
+{
+}
+
+HardwareNoiseSource::~HardwareNoiseSource()
+{
+    clean(buffer);
+}
+
+/**
+ * \brief Determine if the current platform has a supported TRNG peripheral.
+ *
+ * \return Returns true on ESP32, SAMD51, and STM32 parts with an RNG
+ * peripheral; false otherwise.
+ */
+bool HardwareNoiseSource::isSupported()
+{
+#if defined(HARDWARE_NOISE_ESP32) || defined(HARDWARE_NOISE_SAMD51) || \
+        defined(HARDWARE_NOISE_STM32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HardwareNoiseSource::calibrating() const
+{
+    return calState != NOISE_NOT_CALIBRATING;
+}
+
+void HardwareNoiseSource::stir()
+{
+    // Deliver the startup credit as fast as possible and then slow down.
+    unsigned long now = millis();
+    if (creditedBits() >= HARDWARE_NOISE_STARTUP &&
+            (now - lastStir) < HARDWARE_NOISE_INTERVAL)
+        return;
+    lastStir = now;
+
+    // Restart the peripheral if it has not been started or it has failed.
+    if (!started && !start())
+        return;
+
+    // Read a block of data from the TRNG and run the continuous health
+    // tests on every byte.  On failure, discard the block and recalibrate.
+    for (uint8_t posn = 0; posn < sizeof(buffer); posn += 4) {
+        uint32_t value;
+        if (!readWord(&value)) {
+            clean(buffer);
+            calState = NOISE_CALIBRATING;
+            started = false;
+            return;
+        }
+        memcpy(buffer + posn, &value, 4);
+        clean(value);
+    }
+    bool healthy = true;
+    for (uint8_t posn = 0; posn < sizeof(buffer); ++posn)
+        healthy &= healthTest(buffer[posn]);
+    if (healthy) {
+        output(buffer, sizeof(buffer), sizeof(buffer) * HARDWARE_NOISE_CREDIT);
+        calState = NOISE_NOT_CALIBRATING;
+    } else {
+        calState = NOISE_CALIBRATING;
+    }
+    clean(buffer);
+}
+
+/**
+ * \brief Starts the TRNG peripheral and stirs the first block of data
+ * into the global random number pool.
+ */
+void HardwareNoiseSource::added()
+{
+    start();
+    stir();
+}
+
+/**
+ * \internal
+ * \brief Starts the TRNG peripheral.
+ *
+ * \return Returns false if the platform does not have a supported TRNG.
+ */
+bool HardwareNoiseSource::start()
+{
+#if defined(HARDWARE_NOISE_ESP32)
+    // esp_random() is always available; nothing to do.
+    started = true;
+#elif defined(HARDWARE_NOISE_SAMD51)
+    // Turn on the peripheral clock and then enable the TRNG.
+    MCLK->APBCMASK.reg |= MCLK_APBCMASK_TRNG;
+    TRNG->CTRLA.reg = TRNG_CTRLA_ENABLE;
+    started = true;
+#elif defined(HARDWARE_NOISE_STM32)
+    // Turn on the peripheral clock and enable the RNG.  Toggling RNGEN
+    // also recovers from a seed error that was detected by the hardware.
+    __HAL_RCC_RNG_CLK_ENABLE();
+    STM32_RNG->CR &= ~RNG_CR_RNGEN;
+    STM32_RNG->SR = 0;
+    STM32_RNG->CR |= RNG_CR_RNGEN;
+    started = true;
+#endif
+    return started;
+}
+
+/**
+ * \internal
+ * \brief Reads a 32-bit word from the TRNG peripheral.
+ *
+ * \param value Returns the word that was read.
+ * \return Returns false if the peripheral is reporting an error or
+ * did not produce a word in time.
+ */
+bool HardwareNoiseSource::readWord(uint32_t *value)
+{
+#if defined(HARDWARE_NOISE_ESP32)
+    *value = esp_random();
+    return true;
+#elif defined(HARDWARE_NOISE_SAMD51)
+    for (unsigned int count = 0; count < HARDWARE_NOISE_TIMEOUT; ++count) {
+        if (TRNG->INTFLAG.bit.DATARDY) {
+            *value = TRNG->DATA.reg;
+            return true;
+        }
+    }
+    return false;
+#elif defined(HARDWARE_NOISE_STM32)
+    for (unsigned int count = 0; count < HARDWARE_NOISE_TIMEOUT; ++count) {
+        uint32_t status = STM32_RNG->SR;
+        if (status & (RNG_SR_SECS | RNG_SR_CECS))
+            return false;
+        if (status & RNG_SR_DRDY) {
+            *value = STM32_RNG->DR;
+            return true;
+        }
+    }
+    return false;
+#else
+    *value = 0;
+    return false;
+#endif
+}
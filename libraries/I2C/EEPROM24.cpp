@@ -22,6 +22,11 @@
 
 #include "EEPROM24.h"
 #include "I2CMaster.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
 
 /**
  * \class EEPROM24 EEPROM24.h <EEPROM24.h>
@@ -79,9 +84,58 @@
  * EEPROM24 eeprom1(i2c, EEPROM_24LC256, 1);
  * \endcode
  *
+ * \section eeprom24_async Asynchronous writes
+ *
+ * The EEPROM takes around 5 milliseconds to program each page, and
+ * write() waits for every page to finish before returning.  Writing
+ * a large block can therefore stall the application for tens of
+ * milliseconds.  queueWrite() instead adds the write to a queue and
+ * returns immediately.  The application then calls poll() from its
+ * main loop to send each page in turn while the EEPROM is ready:
+ *
+ * \code
+ * uint8_t logBuffer[256];
+ *
+ * void logWritten(EEPROM24 *eeprom, const void *data, size_t written)
+ * {
+ *     // The buffer can be reused now.
+ * }
+ *
+ * void loop() {
+ *     ...
+ *     if (logFull)
+ *         eeprom.queueWrite(logAddress, logBuffer, sizeof(logBuffer), logWritten);
+ *     eeprom.poll();
+ * }
+ * \endcode
+ *
+ * The data is not copied, so the caller must not modify it until the
+ * write has completed.  Call flush() to wait for all queued writes to
+ * reach the EEPROM.  read() and write() call flush() automatically so
+ * that they never see the EEPROM in a half-written state.
+ *
+ * \section eeprom24_timing Write cycle timing
+ *
+ * After each page is sent, the EEPROM ignores the bus until it has
+ * finished programming the page.  Rather than repeatedly probing the
+ * EEPROM while it is busy, which would keep the bus occupied and delay
+ * other devices, EEPROM24 waits for most of the expected write cycle
+ * time first and then probes at increasing intervals.  The expected
+ * time starts at EEPROM24_WRITE_TIME and then tracks the write cycle
+ * times that are actually observed.
+ *
+ * The observed times are available from lastWriteTime(),
+ * averageWriteTime(), and maxWriteTime().  Write cycle times that
+ * increase over the life of a part are a sign that it is wearing out.
+ *
  * \sa I2CMaster
  */
 
+// Shortest and longest intervals between probes for the end of a write
+// cycle, in microseconds.
+#define EEPROM24_MIN_PROBE  100
+#define EEPROM24_MAX_PROBE  1600
+
 /**
  * \brief Constructs a new EEPROM access object on \a bus for an EEPROM
  * of the specified \a type.
@@ -98,6 +152,18 @@ EEPROM24::EEPROM24(I2CMaster &bus, unsigned long type, uint8_t bank)
     , _pageSize((type >> 16) & 0x0FFF)
     , _mode((uint8_t)((type >> 28) & 0x0F))
     , i2cAddress(0x50)
+    , queueHead(0)
+    , queueLength(0)
+    , headWritten(0)
+    , writeStart(0)
+    , probeAt(0)
+    , probeInterval(EEPROM24_MIN_PROBE)
+    , _writeCycles(0)
+    , _lastWriteTime(0)
+    , _averageWriteTime(0)
+    , _maxWriteTime(0)
+    , busy(false)
+    , failed(false)
 {
     // Adjust the I2C address for the memory bank of the chip.
     switch (_mode) {
@@ -151,6 +217,7 @@ EEPROM24::EEPROM24(I2CMaster &bus, unsigned long type, uint8_t bank)
  */
 bool EEPROM24::available()
 {
+    flush();
     // Perform a "Current Address Read" on the EEPROM.  We don't care about
     // the returned byte.  We only care if the read request was ACK'ed or not.
     if (!_bus->startRead(i2cAddress, 1))
@@ -168,10 +235,14 @@ uint8_t EEPROM24::read(unsigned long address)
 {
     if (address >= _size)
         return 0;
-    writeAddress(address);
-    if (!_bus->startRead(i2cAddress, 1))
+    flush();
+    uint8_t addr[2];
+    unsigned int device;
+    uint8_t len = formatAddress(address, addr, &device);
+    uint8_t value;
+    if (!_bus->writeThenRead(device, addr, len, &value, 1))
         return 0;
-    return _bus->read();
+    return value;
 }
 
 /**
@@ -190,16 +261,13 @@ size_t EEPROM24::read(unsigned long address, void *data, size_t length)
         return 0;
     if ((address + length) > _size)
         length = (size_t)(_size - address);
-    writeAddress(address);
-    if (!_bus->startRead(i2cAddress, length))
+    flush();
+    uint8_t addr[2];
+    unsigned int device;
+    uint8_t len = formatAddress(address, addr, &device);
+    if (!_bus->writeThenRead(device, addr, len, data, length))
         return 0;
-    uint8_t *d = (uint8_t *)data;
-    unsigned int count = 0;
-    while (_bus->available()) {
-        *d++ = _bus->read();
-        ++count;
-    }
-    return count;
+    return length;
 }
 
 /**
@@ -214,6 +282,7 @@ bool EEPROM24::write(unsigned long address, uint8_t value)
 {
     if (address >= _size)
         return false;
+    flush();
     writeAddress(address);
     _bus->write(value);
     return waitForWrite();
@@ -238,6 +307,7 @@ size_t EEPROM24::write(unsigned long address, const void *data, size_t length)
         return 0;
     if ((address + length) > _size)
         length = (size_t)(_size - address);
+    flush();
     bool needAddress = true;
     size_t result = 0;
     size_t page = 0;
@@ -267,44 +337,278 @@ size_t EEPROM24::write(unsigned long address, const void *data, size_t length)
     return result + page;
 }
 
+/**
+ * \typedef EEPROM24::WriteCallback
+ * \brief Type of a function that is called by poll() when a write that
+ * was queued with queueWrite() has completed.
+ *
+ * The function is passed the EEPROM, the \a data pointer that was
+ * given to queueWrite(), and the number of bytes that were \a written.
+ * The count will be short if the EEPROM stopped responding.
+ */
+
+/**
+ * \brief Queues \a length bytes from a \a data buffer to be written to
+ * \a address in the EEPROM by poll(), and returns immediately.
+ *
+ * The \a data is not copied, so the buffer must remain valid and
+ * unmodified until the write completes.  If \a callback is not null,
+ * it will be called by poll() once the last byte has been sent.
+ *
+ * Returns false if \a address is out of range or there are already
+ * EEPROM24_QUEUE_SIZE writes in the queue.  If \a address + \a length is
+ * greater than size(), then the write will be truncated.
+ *
+ * \sa poll(), flush(), write()
+ */
+bool EEPROM24::queueWrite(unsigned long address, const void *data, size_t length,
+                          WriteCallback callback)
+{
+    if (address >= _size || queueLength >= EEPROM24_QUEUE_SIZE)
+        return false;
+    if ((address + length) > _size)
+        length = (size_t)(_size - address);
+    uint8_t index = queueHead + queueLength;
+    if (index >= EEPROM24_QUEUE_SIZE)
+        index -= EEPROM24_QUEUE_SIZE;
+    queue[index].address = address;
+    queue[index].data = (const uint8_t *)data;
+    queue[index].length = length;
+    queue[index].callback = callback;
+    ++queueLength;
+    return true;
+}
+
+/**
+ * \brief Performs the next step of the queued writes.
+ *
+ * Each call does a small, bounded amount of I2C traffic.  If the EEPROM
+ * is still programming the previous page, the call checks whether it
+ * has finished.  Otherwise it sends the next page of the write at the
+ * head of the queue.  The application should call this regularly from
+ * its main loop.
+ *
+ * Returns true if there is more work to do, or false if the queue is
+ * empty and the EEPROM has finished programming.
+ *
+ * \sa queueWrite(), flush(), isWritePending()
+ */
+bool EEPROM24::poll()
+{
+    if (busy) {
+        // Check if the EEPROM has finished programming the last page.
+        int8_t result = checkWriteCycle();
+        if (result > 0) {
+            busy = false;
+        } else if (result < 0) {
+            busy = false;
+            if (queueLength)
+                finishWrite(false);
+            else
+                failed = true;
+        }
+        return isWritePending();
+    }
+    if (!queueLength)
+        return false;
+
+    // Send the next page of the write at the head of the queue.
+    PendingWrite *w = &(queue[queueHead]);
+    if (headWritten >= w->length) {
+        finishWrite(true);
+        return isWritePending();
+    }
+    unsigned long address = w->address + headWritten;
+    size_t len = (size_t)(_pageSize - (address & (_pageSize - 1)));
+    if (len > (w->length - headWritten))
+        len = w->length - headWritten;
+    writeAddress(address);
+    const uint8_t *d = w->data + headWritten;
+    for (size_t posn = 0; posn < len; ++posn)
+        _bus->write(d[posn]);
+    if (_bus->endWrite())
+        headWritten += len;     // Page accepted; wait for it to program.
+    startWriteCycle();
+    busy = true;
+    return true;
+}
+
+/**
+ * \brief Waits for all queued writes to be written to the EEPROM.
+ *
+ * Returns true if all writes since the last call to flush() succeeded,
+ * or false if the EEPROM stopped responding during one of them.
+ *
+ * \sa queueWrite(), poll()
+ */
+bool EEPROM24::flush()
+{
+    while (poll())
+        ;   // Do nothing.
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+/**
+ * \fn unsigned long EEPROM24::writeCycles() const
+ * \brief Returns the number of write cycles that have completed since
+ * the last call to resetWriteTimes().
+ *
+ * \sa lastWriteTime(), averageWriteTime(), maxWriteTime()
+ */
+
+/**
+ * \fn unsigned long EEPROM24::lastWriteTime() const
+ * \brief Returns the time taken by the most recent write cycle in
+ * microseconds, or zero if no write cycles have been timed yet.
+ *
+ * The time is measured from the end of the write request to the first
+ * probe that the EEPROM acknowledges, so it may be longer than the
+ * actual write cycle time by up to the interval between probes.
+ *
+ * \sa averageWriteTime(), maxWriteTime()
+ */
+
+/**
+ * \fn unsigned long EEPROM24::averageWriteTime() const
+ * \brief Returns the moving average of the write cycle time in
+ * microseconds, or zero if no write cycles have been timed yet.
+ *
+ * Each new write cycle contributes 1/8 of its time to the average.
+ *
+ * \sa lastWriteTime(), maxWriteTime()
+ */
+
+/**
+ * \fn unsigned long EEPROM24::maxWriteTime() const
+ * \brief Returns the longest write cycle time that was seen since the
+ * last call to resetWriteTimes(), in microseconds.
+ *
+ * \sa lastWriteTime(), averageWriteTime()
+ */
+
+/**
+ * \brief Resets the write cycle timing statistics.
+ *
+ * \sa writeCycles(), averageWriteTime()
+ */
+void EEPROM24::resetWriteTimes()
+{
+    _writeCycles = 0;
+    _lastWriteTime = 0;
+    _averageWriteTime = 0;
+    _maxWriteTime = 0;
+}
+
+/**
+ * \fn bool EEPROM24::isWritePending() const
+ * \brief Returns true if there are queued writes or the EEPROM is still
+ * programming the last page; false if the EEPROM is idle.
+ *
+ * \sa poll(), flush()
+ */
+
 void EEPROM24::writeAddress(unsigned long address)
+{
+    uint8_t addr[2];
+    unsigned int device;
+    uint8_t len = formatAddress(address, addr, &device);
+    _bus->startWrite(device);
+    for (uint8_t posn = 0; posn < len; ++posn)
+        _bus->write(addr[posn]);
+}
+
+// Splits a memory address into the I2C device address, which may contain
+// block select bits, and the address bytes to send.  Returns the number
+// of address bytes in addr.
+uint8_t EEPROM24::formatAddress(unsigned long address, uint8_t *addr, unsigned int *device)
 {
     switch (_mode) {
-    case EE_BSEL_NONE:
-        _bus->startWrite(i2cAddress);
-        _bus->write((uint8_t)(address >> 8));
-        _bus->write((uint8_t)address);
-        break;
     case EE_BSEL_8BIT_ADDR:
-        _bus->startWrite(i2cAddress | (((uint8_t)(address >> 8)) & 0x07));
-        _bus->write((uint8_t)address);
-        break;
+        *device = i2cAddress | (((uint8_t)(address >> 8)) & 0x07);
+        addr[0] = (uint8_t)address;
+        return 1;
     case EE_BSEL_17BIT_ADDR:
-        _bus->startWrite(i2cAddress | (((uint8_t)(address >> 16)) & 0x01));
-        _bus->write((uint8_t)(address >> 8));
-        _bus->write((uint8_t)address);
+        *device = i2cAddress | (((uint8_t)(address >> 16)) & 0x01);
         break;
     case EE_BSEL_17BIT_ADDR_ALT:
-        _bus->startWrite(i2cAddress | (((uint8_t)(address >> 14)) & 0x04));
-        _bus->write((uint8_t)(address >> 8));
-        _bus->write((uint8_t)address);
+        *device = i2cAddress | (((uint8_t)(address >> 14)) & 0x04);
+        break;
+    default:
+        *device = i2cAddress;
         break;
     }
+    addr[0] = (uint8_t)(address >> 8);
+    addr[1] = (uint8_t)address;
+    return 2;
+}
+
+// Removes the write at the head of the queue and notifies the caller.
+void EEPROM24::finishWrite(bool ok)
+{
+    PendingWrite w = queue[queueHead];
+    size_t written = headWritten;
+    if (++queueHead >= EEPROM24_QUEUE_SIZE)
+        queueHead = 0;
+    --queueLength;
+    headWritten = 0;
+    if (!ok)
+        failed = true;
+    if (w.callback)
+        w.callback(this, w.data, written);
 }
 
 bool EEPROM24::waitForWrite()
 {
-    // 1000 iterations is going to be approximately 100ms when the I2C
-    // clock is 100 kHz.  If there has been no response in that time
-    // then we assume that the write has failed and timeout.
     if (!_bus->endWrite())
         return false;
-    unsigned count = 1000;
-    while (count > 0) {
-        _bus->startWrite(i2cAddress);
-        if (_bus->endWrite())
-            return true;
-        --count;
+    startWriteCycle();
+    int8_t result;
+    while ((result = checkWriteCycle()) == 0)
+        ;   // Do nothing.
+    return result > 0;
+}
+
+// Notes that the EEPROM has just started a write cycle.
+void EEPROM24::startWriteCycle()
+{
+    // Wait for 7/8 of the expected write time before the first probe.
+    unsigned long expected = _averageWriteTime;
+    if (!expected)
+        expected = EEPROM24_WRITE_TIME;
+    writeStart = micros();
+    probeAt = expected - expected / 8;
+    probeInterval = EEPROM24_MIN_PROBE;
+}
+
+// Checks whether the current write cycle has finished.  Returns 1 if it
+// has, 0 if it is still in progress, or -1 if it has timed out.  The bus
+// is only used when the next probe is due.
+int8_t EEPROM24::checkWriteCycle()
+{
+    unsigned long elapsed = micros() - writeStart;
+    if (elapsed < probeAt)
+        return 0;
+    _bus->startWrite(i2cAddress);
+    if (_bus->endWrite()) {
+        // Record the time, which may be late by up to one probe interval.
+        ++_writeCycles;
+        _lastWriteTime = elapsed;
+        if (_averageWriteTime)
+            _averageWriteTime = _averageWriteTime - _averageWriteTime / 8 + elapsed / 8;
+        else
+            _averageWriteTime = elapsed;
+        if (elapsed > _maxWriteTime)
+            _maxWriteTime = elapsed;
+        return 1;
     }
-    return false;
+    if (elapsed >= EEPROM24_WRITE_TIMEOUT)
+        return -1;
+
+    // Back off exponentially until the EEPROM responds.
+    probeAt = elapsed + probeInterval;
+    if (probeInterval < EEPROM24_MAX_PROBE)
+        probeInterval *= 2;
+    return 0;
 }
@@ -57,6 +57,22 @@ class I2CMaster;
 #define EEPROM_24LC1025 _EE24(131072UL, 128, EE_BSEL_17BIT_ADDR_ALT)
 #define EEPROM_24LC1026 _EE24(131072UL, 128, EE_BSEL_17BIT_ADDR)
 
+// Maximum number of asynchronous writes that can be queued at once.
+#if !defined(EEPROM24_QUEUE_SIZE)
+#define EEPROM24_QUEUE_SIZE     4
+#endif
+
+// Typical write cycle time in microseconds, used to decide when to first
+// check for the end of a write cycle until actual times have been seen.
+#if !defined(EEPROM24_WRITE_TIME)
+#define EEPROM24_WRITE_TIME     3000UL
+#endif
+
+// Time in microseconds after which a write cycle is assumed to have failed.
+#if !defined(EEPROM24_WRITE_TIMEOUT)
+#define EEPROM24_WRITE_TIMEOUT  100000UL
+#endif
+
 class EEPROM24
 {
 public:
@@ -73,15 +89,57 @@ public:
     bool write(unsigned long address, uint8_t value);
     size_t write(unsigned long address, const void *data, size_t length);
 
+    typedef void (*WriteCallback)(EEPROM24 *eeprom, const void *data, size_t written);
+
+    bool queueWrite(unsigned long address, const void *data, size_t length,
+                    WriteCallback callback = 0);
+    bool poll();
+    bool flush();
+    bool isWritePending() const { return queueLength != 0 || busy; }
+
+    unsigned long writeCycles() const { return _writeCycles; }
+    unsigned long lastWriteTime() const { return _lastWriteTime; }
+    unsigned long averageWriteTime() const { return _averageWriteTime; }
+    unsigned long maxWriteTime() const { return _maxWriteTime; }
+    void resetWriteTimes();
+
 private:
+    struct PendingWrite
+    {
+        unsigned long address;
+        const uint8_t *data;
+        size_t length;
+        WriteCallback callback;
+    };
+
     I2CMaster *_bus;
     unsigned long _size;
     unsigned long _pageSize;
     uint8_t _mode;
     uint8_t i2cAddress;
+    PendingWrite queue[EEPROM24_QUEUE_SIZE];
+    uint8_t queueHead;
+    uint8_t queueLength;
+    size_t headWritten;
+    unsigned long writeStart;
+    unsigned long probeAt;
+    unsigned int probeInterval;
+    unsigned long _writeCycles;
+    unsigned long _lastWriteTime;
+    unsigned long _averageWriteTime;
+    unsigned long _maxWriteTime;
+    bool busy;
+    bool failed;
+
+    friend class EEPROM24Reader;
+    friend class EEPROM24ImageSource;
 
     void writeAddress(unsigned long address);
+    uint8_t formatAddress(unsigned long address, uint8_t *addr, unsigned int *device);
     bool waitForWrite();
+    void startWriteCycle();
+    int8_t checkWriteCycle();
+    void finishWrite(bool ok);
 };
 
 #endif
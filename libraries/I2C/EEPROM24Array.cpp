@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24Array.h"
+#include "EEPROM24.h"
+
+/**
+ * \class EEPROM24Array EEPROM24Array.h <EEPROM24Array.h>
+ * \brief Stripes data across several 24LCXX EEPROM chips so that their
+ * write cycles overlap.
+ *
+ * Each page write to an EEPROM24 is followed by a programming cycle of
+ * around 5 milliseconds during which the chip ignores the bus.  With
+ * several chips on the same bus, the pages can be spread across the chips
+ * in turn so that one chip is sent its next page while the others are
+ * still programming:
+ *
+ * \code
+ * SoftI2C i2c(A4, A5);
+ * EEPROM24 eeprom0(i2c, EEPROM_24LC256, 0);
+ * EEPROM24 eeprom1(i2c, EEPROM_24LC256, 1);
+ * EEPROM24 eeprom2(i2c, EEPROM_24LC256, 2);
+ * EEPROM24 eeprom3(i2c, EEPROM_24LC256, 3);
+ * EEPROM24 *const chips[] = {&eeprom0, &eeprom1, &eeprom2, &eeprom3};
+ * EEPROM24Array eeprom(chips, 4);
+ *
+ * eeprom.write(0, logBuffer, sizeof(logBuffer));
+ * \endcode
+ *
+ * Page N of the array is stored in page N / count() of chip N % count().
+ * Long writes therefore keep all of the chips programming at the same time,
+ * and sustained write throughput goes up by close to the number of chips
+ * until the bus itself becomes the limit.  At 100 kHz, sending a 64-byte
+ * page takes about as long as programming it, so running the bus at 400 kHz
+ * is recommended for arrays with more than two chips.
+ *
+ * All of the chips should be of the same type.  The array has the page
+ * size of the first chip and count() times the size of the smallest chip.
+ * The chips can still be used on their own, but the data in an array is
+ * spread across them in a way that only makes sense through the array.
+ *
+ * \sa EEPROM24
+ */
+
+/**
+ * \brief Constructs a new array from \a count chips.
+ *
+ * \param chips Points to an array of pointers to the chips, in the order
+ * that pages should be striped across them.  The pointers are copied so
+ * the array itself does not need to stay valid.
+ * \param count The number of chips, between 1 and EEPROM24_ARRAY_MAX_CHIPS.
+ * Extra chips are ignored.
+ */
+EEPROM24Array::EEPROM24Array(EEPROM24 *const *chips, uint8_t count)
+    : _size(0)
+    , _pageSize(0)
+    , _count(0)
+{
+    if (count > EEPROM24_ARRAY_MAX_CHIPS)
+        count = EEPROM24_ARRAY_MAX_CHIPS;
+    if (!count)
+        return;
+    unsigned long chipSize = chips[0]->size();
+    for (uint8_t index = 0; index < count; ++index) {
+        _chips[index] = chips[index];
+        if (chips[index]->size() < chipSize)
+            chipSize = chips[index]->size();
+    }
+    _pageSize = chips[0]->pageSize();
+    _count = count;
+    _size = (chipSize / _pageSize) * _pageSize * count;
+}
+
+/**
+ * \fn unsigned long EEPROM24Array::size() const
+ * \brief Returns the total size of the array in bytes.
+ *
+ * \sa pageSize(), count()
+ */
+
+/**
+ * \fn unsigned long EEPROM24Array::pageSize() const
+ * \brief Returns the size of a single page in bytes, which is also the
+ * unit that is striped across the chips.
+ *
+ * \sa size()
+ */
+
+/**
+ * \fn uint8_t EEPROM24Array::count() const
+ * \brief Returns the number of chips in the array.
+ */
+
+/**
+ * \brief Returns true if all of the chips are available on the I2C bus;
+ * false otherwise.
+ *
+ * \sa EEPROM24::available()
+ */
+bool EEPROM24Array::available()
+{
+    if (!_count)
+        return false;
+    for (uint8_t index = 0; index < _count; ++index) {
+        if (!_chips[index]->available())
+            return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Reads a single byte from the array at \a address.
+ *
+ * \sa write()
+ */
+uint8_t EEPROM24Array::read(unsigned long address)
+{
+    if (address >= _size)
+        return 0;
+    unsigned long chipAddress;
+    size_t len;
+    EEPROM24 *chip = locate(address, &chipAddress, &len);
+    return chip->read(chipAddress);
+}
+
+/**
+ * \brief Reads a block of \a length bytes from the array at \a address
+ * into the specified \a data buffer.
+ *
+ * Returns the number of bytes that were read, which may be short if
+ * \a address + \a length is greater than size() or one of the chips
+ * is not available on the I2C bus.
+ *
+ * \sa write()
+ */
+size_t EEPROM24Array::read(unsigned long address, void *data, size_t length)
+{
+    if (address >= _size)
+        return 0;
+    if ((address + length) > _size)
+        length = (size_t)(_size - address);
+    uint8_t *d = (uint8_t *)data;
+    size_t result = 0;
+    while (length > 0) {
+        unsigned long chipAddress;
+        size_t len;
+        EEPROM24 *chip = locate(address, &chipAddress, &len);
+        if (len > length)
+            len = length;
+        if (chip->read(chipAddress, d, len) != len)
+            break;
+        d += len;
+        address += len;
+        length -= len;
+        result += len;
+    }
+    return result;
+}
+
+/**
+ * \brief Writes a byte \a value to \a address in the array.
+ *
+ * Returns true if the byte was written successfully, or false if
+ * \a address is out of range or the chip is not available on the I2C bus.
+ *
+ * \sa read()
+ */
+bool EEPROM24Array::write(unsigned long address, uint8_t value)
+{
+    if (address >= _size)
+        return false;
+    unsigned long chipAddress;
+    size_t len;
+    EEPROM24 *chip = locate(address, &chipAddress, &len);
+    return chip->write(chipAddress, value);
+}
+
+/**
+ * \brief Writes \a length bytes from a \a data buffer to \a address
+ * in the array.
+ *
+ * Returns the number of bytes that were written, which may be short if
+ * \a address + \a length is greater than size().  Returns zero if any of
+ * the chips stopped responding, because the pages that did reach the
+ * other chips are not contiguous.
+ *
+ * The pages are queued on the chips with EEPROM24::queueWrite() and
+ * all of the chips are polled until every page has been programmed,
+ * so that each chip's write cycle overlaps with the others.  Best
+ * performance will be achieved if \a address and \a length are a
+ * multiple of pageSize() * count().
+ *
+ * \sa read(), pageSize()
+ */
+size_t EEPROM24Array::write(unsigned long address, const void *data, size_t length)
+{
+    if (address >= _size)
+        return 0;
+    if ((address + length) > _size)
+        length = (size_t)(_size - address);
+
+    // Clear the status from any earlier queued writes on the chips.
+    bool ok = true;
+    for (uint8_t index = 0; index < _count; ++index)
+        _chips[index]->flush();
+
+    // Queue the pages on the chips in turn.  If a chip's queue is full,
+    // keep all of the chips working until it has room again.
+    const uint8_t *d = (const uint8_t *)data;
+    size_t remaining = length;
+    while (remaining > 0) {
+        unsigned long chipAddress;
+        size_t len;
+        EEPROM24 *chip = locate(address, &chipAddress, &len);
+        if (len > remaining)
+            len = remaining;
+        while (!chip->queueWrite(chipAddress, d, len))
+            pollAll();
+        pollAll();
+        d += len;
+        address += len;
+        remaining -= len;
+    }
+
+    // Wait for all of the chips to finish programming.
+    for (uint8_t index = 0; index < _count; ++index) {
+        if (!_chips[index]->flush())
+            ok = false;
+    }
+    return ok ? length : 0;
+}
+
+/**
+ * \brief Finds the chip and chip address for an address in the array.
+ *
+ * \param address The address within the array, which must be less
+ * than size().
+ * \param chipAddress Returns the address within the chip.
+ * \param length Returns the number of bytes from \a address to the end
+ * of its page.
+ *
+ * \return A pointer to the chip that holds \a address.
+ */
+EEPROM24 *EEPROM24Array::locate(unsigned long address,
+                                unsigned long *chipAddress,
+                                size_t *length) const
+{
+    unsigned long page = address / _pageSize;
+    unsigned long offset = address % _pageSize;
+    *chipAddress = (page / _count) * _pageSize + offset;
+    *length = (size_t)(_pageSize - offset);
+    return _chips[page % _count];
+}
+
+/**
+ * \brief Performs the next step of the queued writes on every chip.
+ */
+void EEPROM24Array::pollAll()
+{
+    for (uint8_t index = 0; index < _count; ++index)
+        _chips[index]->poll();
+}
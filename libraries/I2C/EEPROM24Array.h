@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EEPROM24Array_h
+#define EEPROM24Array_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class EEPROM24;
+
+// Maximum number of chips in an array, which is the number of bank
+// addresses that can be selected with the A0, A1, and A2 pins.
+#define EEPROM24_ARRAY_MAX_CHIPS    8
+
+class EEPROM24Array
+{
+public:
+    EEPROM24Array(EEPROM24 *const *chips, uint8_t count);
+
+    unsigned long size() const { return _size; }
+    unsigned long pageSize() const { return _pageSize; }
+    uint8_t count() const { return _count; }
+
+    bool available();
+
+    uint8_t read(unsigned long address);
+    size_t read(unsigned long address, void *data, size_t length);
+
+    bool write(unsigned long address, uint8_t value);
+    size_t write(unsigned long address, const void *data, size_t length);
+
+private:
+    EEPROM24 *_chips[EEPROM24_ARRAY_MAX_CHIPS];
+    unsigned long _size;
+    unsigned long _pageSize;
+    uint8_t _count;
+
+    EEPROM24 *locate(unsigned long address, unsigned long *chipAddress,
+                     size_t *length) const;
+    void pollAll();
+};
+
+#endif
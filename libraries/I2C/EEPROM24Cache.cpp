@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24Cache.h"
+#include "EEPROM24.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \class EEPROM24Cache EEPROM24Cache.h <EEPROM24Cache.h>
+ * \brief Write-back page cache in front of an EEPROM24.
+ *
+ * Each call to EEPROM24::write() costs a full programming cycle of
+ * around 5 milliseconds, and a cycle of wear on the page, even if only
+ * a single byte changed.  Applications that update several small
+ * fields in turn, such as configuration settings or counters, can
+ * instead route their writes through an EEPROM24Cache:
+ *
+ * \code
+ * SoftI2C i2c(A4, A5);
+ * EEPROM24 eeprom(i2c, EEPROM_24LC256);
+ * EEPROM24Cache cache(eeprom, 2);
+ *
+ * cache.write(CONFIG_BRIGHTNESS, brightness);
+ * cache.write(CONFIG_CONTRAST, contrast);
+ * cache.write(CONFIG_BOOT_COUNT, &bootCount, sizeof(bootCount));
+ * cache.flush();
+ * \endcode
+ *
+ * The cache holds a fixed number of whole EEPROM pages in RAM.  Writes
+ * modify the cached copy of the page and are only sent to the EEPROM
+ * when flush() is called or when the page is evicted to make room for
+ * another.  All of the changes to a page are then programmed in a single
+ * cycle.  Writes that don't change the stored value do not mark the page
+ * as dirty, so rewriting an unchanged configuration costs nothing.
+ *
+ * Reads are satisfied from the cache when the page is resident, and
+ * are otherwise passed straight through to the EEPROM without loading
+ * the page into the cache.
+ *
+ * Changes that have not been flushed are lost if the device is reset
+ * or loses power.  The application should call flush() at a suitable
+ * point, such as after saving a group of related settings.
+ *
+ * \sa EEPROM24
+ */
+
+/**
+ * \brief Constructs a new cache in front of \a eeprom that holds up to
+ * \a pages EEPROM pages in RAM.
+ *
+ * The cache will use \a pages * EEPROM24::pageSize() bytes of RAM for
+ * the page data, plus a few bytes of bookkeeping for each page.
+ * If the memory cannot be allocated, then the cache will pass all
+ * reads and writes directly through to \a eeprom.
+ */
+EEPROM24Cache::EEPROM24Cache(EEPROM24 &eeprom, uint8_t pages)
+    : _eeprom(&eeprom)
+    , buffer(0)
+    , entries(0)
+    , order(0)
+    , _pages(0)
+    , _pageSize((uint16_t)eeprom.pageSize())
+{
+    if (!pages)
+        return;
+    buffer = (uint8_t *)malloc(((size_t)pages) * _pageSize);
+    entries = (Page *)malloc(pages * sizeof(Page));
+    order = (uint8_t *)malloc(pages);
+    if (!buffer || !entries || !order) {
+        free(buffer);
+        free(entries);
+        free(order);
+        buffer = 0;
+        entries = 0;
+        order = 0;
+        return;
+    }
+    _pages = pages;
+    invalidate();
+}
+
+/**
+ * \brief Flushes any pending changes to the EEPROM and then destroys
+ * this cache.
+ */
+EEPROM24Cache::~EEPROM24Cache()
+{
+    flush();
+    free(buffer);
+    free(entries);
+    free(order);
+}
+
+/**
+ * \fn EEPROM24 *EEPROM24Cache::eeprom() const
+ * \brief Returns the EEPROM that this cache is in front of.
+ */
+
+/**
+ * \fn uint8_t EEPROM24Cache::pageCount() const
+ * \brief Returns the number of pages that this cache can hold, or zero
+ * if the cache memory could not be allocated.
+ */
+
+/**
+ * \brief Reads a single byte from the EEPROM at \a address.
+ *
+ * \sa EEPROM24::read()
+ */
+uint8_t EEPROM24Cache::read(unsigned long address)
+{
+    if (address >= _eeprom->size())
+        return 0;
+    int index = findPage(address / _pageSize);
+    if (index < 0)
+        return _eeprom->read(address);
+    return buffer[index * _pageSize + (address % _pageSize)];
+}
+
+/**
+ * \brief Reads a block of \a length bytes from the EEPROM at \a address
+ * into the specified \a data buffer.
+ *
+ * Returns the number of bytes that were read, which may be short if
+ * \a address + \a length is greater than the size of the EEPROM or if
+ * the EEPROM is not available on the I2C bus.
+ *
+ * \sa EEPROM24::read()
+ */
+size_t EEPROM24Cache::read(unsigned long address, void *data, size_t length)
+{
+    unsigned long size = _eeprom->size();
+    if (address >= size || !length)
+        return 0;
+    if ((address + length) > size)
+        length = (size_t)(size - address);
+    uint8_t *d = (uint8_t *)data;
+    size_t count = 0;
+    while (count < length) {
+        // Read up to the end of the current page, from either the cache
+        // or the EEPROM itself.
+        size_t offset = (size_t)(address % _pageSize);
+        size_t len = _pageSize - offset;
+        if (len > (length - count))
+            len = length - count;
+        int index = findPage(address / _pageSize);
+        if (index >= 0) {
+            memcpy(d, buffer + index * _pageSize + offset, len);
+        } else {
+            size_t actual = _eeprom->read(address, d, len);
+            if (actual != len)
+                return count + actual;
+        }
+        address += len;
+        d += len;
+        count += len;
+    }
+    return count;
+}
+
+/**
+ * \brief Writes a byte \a value to \a address in the EEPROM.
+ *
+ * The write is performed on the cached copy of the page, which is
+ * loaded from the EEPROM if it isn't already resident.  The change will
+ * reach the EEPROM the next time flush() is called or the page is
+ * evicted from the cache.
+ *
+ * Returns false if \a address is out of range or the page could not
+ * be loaded from the EEPROM.
+ *
+ * \sa read(), flush()
+ */
+bool EEPROM24Cache::write(unsigned long address, uint8_t value)
+{
+    return write(address, &value, 1) == 1;
+}
+
+/**
+ * \brief Writes \a length bytes from a \a data buffer to \a address
+ * in the EEPROM.
+ *
+ * The write is merged into the cached pages and will reach the EEPROM
+ * the next time flush() is called or the pages are evicted from the
+ * cache.  Pages that are completely overwritten are not read from the
+ * EEPROM first.
+ *
+ * Returns the number of bytes that were written, which may be short if
+ * \a address + \a length is greater than the size of the EEPROM or if
+ * a page could not be loaded from the EEPROM.
+ *
+ * \sa read(), flush()
+ */
+size_t EEPROM24Cache::write(unsigned long address, const void *data, size_t length)
+{
+    unsigned long size = _eeprom->size();
+    if (address >= size || !length)
+        return 0;
+    if ((address + length) > size)
+        length = (size_t)(size - address);
+    if (!_pages)
+        return _eeprom->write(address, data, length);
+    const uint8_t *d = (const uint8_t *)data;
+    size_t count = 0;
+    while (count < length) {
+        size_t offset = (size_t)(address % _pageSize);
+        size_t len = _pageSize - offset;
+        if (len > (length - count))
+            len = length - count;
+        int index = loadPage(address / _pageSize, len != _pageSize);
+        if (index < 0)
+            break;
+
+        // Trim the bytes from each end that already have the right value.
+        uint8_t *page = buffer + index * _pageSize;
+        size_t first = offset;
+        size_t last = offset + len;
+        const uint8_t *src = d - offset;
+        while (first < last && page[first] == src[first])
+            ++first;
+        while (last > first && page[last - 1] == src[last - 1])
+            --last;
+        if (first < last) {
+            memcpy(page + first, src + first, last - first);
+            Page *entry = &(entries[index]);
+            if (entry->dirtyStart >= entry->dirtyEnd) {
+                entry->dirtyStart = first;
+                entry->dirtyEnd = last;
+            } else {
+                if (first < entry->dirtyStart)
+                    entry->dirtyStart = first;
+                if (last > entry->dirtyEnd)
+                    entry->dirtyEnd = last;
+            }
+        }
+        address += len;
+        d += len;
+        count += len;
+    }
+    return count;
+}
+
+/**
+ * \brief Returns true if there are changes in the cache that have not
+ * been written to the EEPROM yet.
+ *
+ * \sa flush()
+ */
+bool EEPROM24Cache::isDirty() const
+{
+    for (uint8_t index = 0; index < _pages; ++index) {
+        if (entries[index].dirtyStart < entries[index].dirtyEnd)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * \brief Writes all pending changes in the cache to the EEPROM.
+ *
+ * Each dirty page is programmed with a single EEPROM write.  The pages
+ * remain in the cache afterwards to satisfy later reads and writes.
+ *
+ * Returns true if all changes were written, or false if the EEPROM
+ * did not accept one of the pages.  Pages that failed remain dirty and
+ * will be retried on the next call.
+ *
+ * \sa isDirty(), invalidate()
+ */
+bool EEPROM24Cache::flush()
+{
+    bool ok = true;
+    for (uint8_t index = 0; index < _pages; ++index) {
+        if (!writeBack(index))
+            ok = false;
+    }
+    return ok;
+}
+
+/**
+ * \brief Discards the contents of the cache, including any changes that
+ * have not been flushed to the EEPROM.
+ *
+ * This should be called if the EEPROM has been modified directly via
+ * EEPROM24::write() while pages were resident in the cache.
+ *
+ * \sa flush()
+ */
+void EEPROM24Cache::invalidate()
+{
+    for (uint8_t index = 0; index < _pages; ++index) {
+        entries[index].page = 0xFFFFFFFFUL;
+        entries[index].dirtyStart = 0;
+        entries[index].dirtyEnd = 0;
+        order[index] = index;
+    }
+}
+
+/**
+ * \internal
+ * \brief Returns the cache index of \a page, or -1 if it isn't resident.
+ */
+int EEPROM24Cache::findPage(unsigned long page) const
+{
+    for (uint8_t index = 0; index < _pages; ++index) {
+        if (entries[index].page == page)
+            return index;
+    }
+    return -1;
+}
+
+/**
+ * \internal
+ * \brief Makes \a page resident in the cache and returns its index.
+ *
+ * If \a fill is true, then the current contents of the page are read
+ * from the EEPROM.  Otherwise the caller is about to overwrite the
+ * entire page.  Returns -1 if the page could not be loaded or the
+ * least recently used page could not be written back to make room.
+ */
+int EEPROM24Cache::loadPage(unsigned long page, bool fill)
+{
+    int index = findPage(page);
+    if (index < 0) {
+        index = order[_pages - 1];
+        if (!writeBack(index))
+            return -1;
+        entries[index].page = 0xFFFFFFFFUL;
+        if (fill) {
+            size_t len = _eeprom->read(page * _pageSize,
+                                       buffer + index * _pageSize, _pageSize);
+            if (len != _pageSize)
+                return -1;
+        } else {
+            // The whole page will be written back, whatever its old value.
+            entries[index].dirtyStart = 0;
+            entries[index].dirtyEnd = _pageSize;
+        }
+        entries[index].page = page;
+    }
+    touch(index);
+    return index;
+}
+
+/**
+ * \internal
+ * \brief Writes the dirty part of the page at \a index back to the EEPROM.
+ */
+bool EEPROM24Cache::writeBack(uint8_t index)
+{
+    Page *entry = &(entries[index]);
+    if (entry->dirtyStart >= entry->dirtyEnd)
+        return true;
+    size_t len = entry->dirtyEnd - entry->dirtyStart;
+    if (_eeprom->write(entry->page * _pageSize + entry->dirtyStart,
+                       buffer + index * _pageSize + entry->dirtyStart,
+                       len) != len)
+        return false;
+    entry->dirtyStart = 0;
+    entry->dirtyEnd = 0;
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Marks the page at \a index as the most recently used.
+ */
+void EEPROM24Cache::touch(uint8_t index)
+{
+    uint8_t posn = 0;
+    while (order[posn] != index)
+        ++posn;
+    while (posn > 0) {
+        order[posn] = order[posn - 1];
+        --posn;
+    }
+    order[0] = index;
+}
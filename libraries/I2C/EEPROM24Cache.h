@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EEPROM24Cache_h
+#define EEPROM24Cache_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class EEPROM24;
+
+class EEPROM24Cache
+{
+public:
+    EEPROM24Cache(EEPROM24 &eeprom, uint8_t pages);
+    ~EEPROM24Cache();
+
+    EEPROM24 *eeprom() const { return _eeprom; }
+    uint8_t pageCount() const { return _pages; }
+
+    uint8_t read(unsigned long address);
+    size_t read(unsigned long address, void *data, size_t length);
+
+    bool write(unsigned long address, uint8_t value);
+    size_t write(unsigned long address, const void *data, size_t length);
+
+    bool isDirty() const;
+    bool flush();
+    void invalidate();
+
+private:
+    struct Page
+    {
+        unsigned long page;
+        uint16_t dirtyStart;
+        uint16_t dirtyEnd;
+    };
+
+    EEPROM24 *_eeprom;
+    uint8_t *buffer;
+    Page *entries;
+    uint8_t *order;
+    uint8_t _pages;
+    uint16_t _pageSize;
+
+    int findPage(unsigned long page) const;
+    int loadPage(unsigned long page, bool fill);
+    bool writeBack(uint8_t index);
+    void touch(uint8_t index);
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24Reader.h"
+#include "EEPROM24.h"
+#include "I2CMaster.h"
+
+/**
+ * \class EEPROM24Reader EEPROM24Reader.h <EEPROM24Reader.h>
+ * \brief Sequential reader for streaming large blocks of data from an
+ * EEPROM24.
+ *
+ * EEPROM24::read() sends the memory address to the EEPROM every time
+ * it is called, which adds 3 or 4 bytes of overhead to every read.
+ * When streaming a large asset such as a font, bitmap, or melody
+ * through a small buffer, that overhead can be significant.
+ * EEPROM24Reader instead keeps a single sequential read open on the
+ * I2C bus and fetches each byte as the caller asks for it:
+ *
+ * \code
+ * EEPROM24Reader reader(eeprom);
+ * reader.begin(frameAddress, frameCount * sizeof(frame));
+ * while (reader.remaining() > 0) {
+ *     reader.read(frame, sizeof(frame));
+ *     display.drawBitmap(0, 0, frame);
+ * }
+ * \endcode
+ *
+ * The read is only restarted when it reaches the bus master's
+ * I2CMaster::maxTransferSize() or the boundary between the 64 kByte
+ * blocks of a 24LC1025 or 24LC1026.
+ *
+ * While the read is open, the I2C bus is busy and cannot be used to talk
+ * to other devices.  Call end() to finish the read early, before using
+ * the bus for something else.  The read is ended automatically when the
+ * last byte has been read.
+ *
+ * \sa EEPROM24
+ */
+
+/**
+ * \brief Constructs a new sequential reader for \a eeprom.
+ */
+EEPROM24Reader::EEPROM24Reader(EEPROM24 &eeprom)
+    : _eeprom(&eeprom)
+    , _address(0)
+    , _remaining(0)
+    , chunk(0)
+{
+}
+
+/**
+ * \brief Destroys this reader, ending any read that is in progress.
+ */
+EEPROM24Reader::~EEPROM24Reader()
+{
+    end();
+}
+
+/**
+ * \brief Begins reading \a length bytes from the EEPROM at \a address.
+ *
+ * If \a length is zero, or goes beyond the end of the EEPROM, then the
+ * reader will stop at the end of the EEPROM.  Any queued writes on the
+ * EEPROM are completed first.  Returns false if \a address is out of
+ * range.
+ *
+ * The bus is not used until the first byte is read.
+ *
+ * \sa read(), end()
+ */
+bool EEPROM24Reader::begin(unsigned long address, unsigned long length)
+{
+    end();
+    unsigned long size = _eeprom->size();
+    if (address >= size)
+        return false;
+    if (!length || length > (size - address))
+        length = size - address;
+    _eeprom->flush();
+    _address = address;
+    _remaining = length;
+    return true;
+}
+
+/**
+ * \brief Ends the current read, releasing the I2C bus.
+ *
+ * \sa begin()
+ */
+void EEPROM24Reader::end()
+{
+    if (chunk) {
+        _eeprom->_bus->endRead();
+        chunk = 0;
+    }
+    _remaining = 0;
+}
+
+/**
+ * \fn unsigned long EEPROM24Reader::address() const
+ * \brief Returns the EEPROM address of the next byte that will be read.
+ */
+
+/**
+ * \fn unsigned long EEPROM24Reader::remaining() const
+ * \brief Returns the number of bytes that remain to be read.
+ */
+
+/**
+ * \brief Reads the next byte from the EEPROM.
+ *
+ * Returns the byte, or -1 if there are no bytes remaining or the EEPROM
+ * did not respond.
+ */
+int EEPROM24Reader::read()
+{
+    if (!_remaining || (!chunk && !startChunk()))
+        return -1;
+    uint8_t value = _eeprom->_bus->read();
+    ++_address;
+    --_remaining;
+    --chunk;
+    return value;
+}
+
+/**
+ * \brief Reads up to \a length bytes from the EEPROM into \a data.
+ *
+ * Returns the number of bytes that were read, which will be short at
+ * the end of the stream or if the EEPROM did not respond.
+ */
+size_t EEPROM24Reader::read(void *data, size_t length)
+{
+    I2CMaster *bus = _eeprom->_bus;
+    uint8_t *d = (uint8_t *)data;
+    size_t count = 0;
+    while (count < length && _remaining) {
+        if (!chunk && !startChunk())
+            break;
+
+        // Read as much of the current chunk as the caller wants.
+        unsigned int len = chunk;
+        if (len > (length - count))
+            len = (unsigned int)(length - count);
+        _address += len;
+        _remaining -= len;
+        chunk -= len;
+        count += len;
+        while (len-- > 0)
+            *d++ = bus->read();
+    }
+    return count;
+}
+
+/**
+ * \brief Skips over \a length bytes in the stream without reading them.
+ *
+ * The current read on the bus is ended and a new one is started at the
+ * new address when the next byte is read.
+ */
+void EEPROM24Reader::skip(unsigned long length)
+{
+    if (length > _remaining)
+        length = _remaining;
+    if (chunk) {
+        _eeprom->_bus->endRead();
+        chunk = 0;
+    }
+    _address += length;
+    _remaining -= length;
+}
+
+/**
+ * \internal
+ * \brief Starts a sequential read of the next chunk of the stream.
+ */
+bool EEPROM24Reader::startChunk()
+{
+    // Sequential reads don't cross the 64K blocks of the larger chips.
+    unsigned long count = _remaining;
+    if (_eeprom->_mode == EE_BSEL_17BIT_ADDR ||
+            _eeprom->_mode == EE_BSEL_17BIT_ADDR_ALT) {
+        unsigned long blockLeft = 0x10000UL - (_address & 0xFFFFUL);
+        if (count > blockLeft)
+            count = blockLeft;
+    }
+    I2CMaster *bus = _eeprom->_bus;
+    unsigned int max = bus->maxTransferSize();
+    if (count > max)
+        count = max;
+
+    uint8_t addr[2];
+    unsigned int device;
+    uint8_t len = _eeprom->formatAddress(_address, addr, &device);
+    bus->startWrite(device);
+    for (uint8_t posn = 0; posn < len; ++posn)
+        bus->write(addr[posn]);
+    if (!bus->startRead(device, (unsigned int)count)) {
+        _remaining = 0;
+        return false;
+    }
+    chunk = (unsigned int)count;
+    return true;
+}
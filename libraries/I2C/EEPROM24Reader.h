@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EEPROM24Reader_h
+#define EEPROM24Reader_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class EEPROM24;
+
+class EEPROM24Reader
+{
+public:
+    explicit EEPROM24Reader(EEPROM24 &eeprom);
+    ~EEPROM24Reader();
+
+    bool begin(unsigned long address, unsigned long length = 0);
+    void end();
+
+    unsigned long address() const { return _address; }
+    unsigned long remaining() const { return _remaining; }
+
+    int read();
+    size_t read(void *data, size_t length);
+    void skip(unsigned long length);
+
+private:
+    EEPROM24 *_eeprom;
+    unsigned long _address;
+    unsigned long _remaining;
+    unsigned int chunk;
+
+    bool startChunk();
+};
+
+#endif
@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EEPROM24Store.h"
+#include "EEPROM24.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \class EEPROM24Store EEPROM24Store.h <EEPROM24Store.h>
+ * \brief Wear-leveled key/value store in a region of an EEPROM24.
+ *
+ * Storing frequently updated values such as counters, settings, and
+ * random number seeds at fixed EEPROM addresses wears out the pages
+ * that hold the busiest values long before the rest of the chip.
+ * EEPROM24Store instead appends every update to a log that cycles
+ * through all pages of the region in turn, spreading the wear evenly:
+ *
+ * \code
+ * SoftI2C i2c(A4, A5);
+ * EEPROM24 eeprom(i2c, EEPROM_24LC256);
+ * EEPROM24Store store(eeprom, 0, 8192);
+ *
+ * #define KEY_BOOT_COUNT   0
+ * #define KEY_SEED         1
+ *
+ * void setup() {
+ *     if (!store.begin())
+ *         store.format();
+ *     unsigned long bootCount = 0;
+ *     store.get(KEY_BOOT_COUNT, &bootCount, sizeof(bootCount));
+ *     ++bootCount;
+ *     store.set(KEY_BOOT_COUNT, &bootCount, sizeof(bootCount));
+ * }
+ *
+ * void loop() {
+ *     store.poll();
+ *     ...
+ * }
+ * \endcode
+ *
+ * Keys are small integers between 0 and EEPROM24_STORE_KEYS - 1, and
+ * values are between 1 and maxValueLength() bytes in size.  The store
+ * keeps the EEPROM address of the latest value for each key in RAM,
+ * which begin() rebuilds at startup by reading each page of the region
+ * once.
+ *
+ * Each record consists of the key, the value length, a 16-bit sequence
+ * number, the value, and a CRC-8 over the preceding bytes.  A record
+ * that was only partially written when the power failed will fail the
+ * CRC check and is ignored by begin(), leaving the previous value of
+ * the key in place.
+ *
+ * set() programs the record in the background using
+ * EEPROM24::queueWrite() and returns without waiting for the EEPROM.
+ * The application should call poll() regularly to complete the write.
+ * When the current page fills up, the log moves onto the next page and
+ * any values that are still current in the page after that are copied
+ * along in the same page write.  This keeps one page ahead of the log
+ * free of live data at all times, so that the oldest page can always be
+ * reused without first compacting the whole region.
+ *
+ * The region should be at least twice the size of the live data plus
+ * two pages, or updates will spend most of their time copying values
+ * along.  The region must not be larger than 64 kBytes.
+ *
+ * \sa EEPROM24, EEPROM24Cache
+ */
+
+// Size of a record, excluding the value: key, length, sequence, and CRC.
+#define RECORD_OVERHEAD     5
+
+// Byte that marks the end of the records in a page.
+#define RECORD_END          0xFF
+
+// Marks a key that has no value in the index.
+#define NO_RECORD           0xFFFF
+
+// Returns true if sequence number a is newer than b.
+#define isNewer(a, b)       (((int16_t)((a) - (b))) > 0)
+
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    // CRC-8 with polynomial x^8 + x^2 + x + 1, initialized to 0xFF so that
+    // a record of all-zero bytes does not pass the check.
+    uint8_t crc = 0xFF;
+    while (len-- > 0) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            if (crc & 0x80)
+                crc = (crc << 1) ^ 0x07;
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * \brief Constructs a new key/value store on \a eeprom that occupies
+ * \a size bytes starting at \a start.
+ *
+ * The region is shrunk if necessary so that it starts and ends on a page
+ * boundary, and so that it is no larger than 64 kBytes.  The region must
+ * contain at least 2 pages.
+ *
+ * The store is not usable until begin() or format() has been called.
+ */
+EEPROM24Store::EEPROM24Store(EEPROM24 &eeprom, unsigned long start, unsigned long size)
+    : _eeprom(&eeprom)
+    , _start(0)
+    , _pageSize((uint16_t)eeprom.pageSize())
+    , _pages(0)
+    , headPage(0)
+    , headOffset(0)
+    , base(0)
+    , staged(0)
+    , seq(0)
+    , staging(0)
+    , failed(false)
+{
+    unsigned long end = start + size;
+    if (end > eeprom.size())
+        end = eeprom.size();
+    start = ((start + _pageSize - 1) / _pageSize) * _pageSize;
+    if (end > start && _pageSize > RECORD_OVERHEAD) {
+        size = end - start;
+        if (size > 65536UL)
+            size = 65536UL;
+        _start = start;
+        _pages = (uint16_t)(size / _pageSize);
+        staging = (uint8_t *)malloc(_pageSize);
+    }
+    for (uint8_t key = 0; key < EEPROM24_STORE_KEYS; ++key)
+        index[key] = NO_RECORD;
+}
+
+/**
+ * \brief Destroys this key/value store after waiting for any pending
+ * writes to finish.
+ */
+EEPROM24Store::~EEPROM24Store()
+{
+    if (staging) {
+        _eeprom->flush();
+        free(staging);
+    }
+}
+
+/**
+ * \brief Rebuilds the index of keys from the records in the EEPROM.
+ *
+ * This must be called once at startup before the store is used.
+ * Returns false if the region is too small or the EEPROM could not be
+ * read.
+ *
+ * A region that has never been used may contain leftover data that
+ * begin() cannot distinguish from records.  Call format() once to
+ * prepare a new region for use.
+ *
+ * \sa format()
+ */
+bool EEPROM24Store::begin()
+{
+    if (!staging || _pages < 2)
+        return false;
+    uint16_t seqs[EEPROM24_STORE_KEYS];
+    bool seen[EEPROM24_STORE_KEYS];
+    for (uint8_t key = 0; key < EEPROM24_STORE_KEYS; ++key) {
+        index[key] = NO_RECORD;
+        seen[key] = false;
+    }
+    bool found = false;
+    uint16_t newest = 0;
+    headPage = 0;
+    headOffset = 0;
+    for (uint16_t page = 0; page < _pages; ++page) {
+        unsigned long pageStart = ((unsigned long)page) * _pageSize;
+        if (_eeprom->read(_start + pageStart, staging, _pageSize) != _pageSize)
+            return false;
+
+        // Walk the records until the end marker or a damaged record.
+        uint16_t offset = 0;
+        while ((offset + RECORD_OVERHEAD) <= _pageSize) {
+            const uint8_t *record = staging + offset;
+            if (record[0] == RECORD_END)
+                break;
+            uint16_t size = RECORD_OVERHEAD + record[1];
+            if ((offset + size) > _pageSize)
+                break;
+            if (crc8(record, size - 1) != record[size - 1])
+                break;
+            uint16_t s = record[2] | (((uint16_t)(record[3])) << 8);
+            if (!found || isNewer(s, newest)) {
+                // The most recent record marks the head of the log.
+                found = true;
+                newest = s;
+                headPage = page;
+                headOffset = offset + size;
+            }
+            uint8_t key = record[0];
+            if (key < EEPROM24_STORE_KEYS && (!seen[key] || isNewer(s, seqs[key]))) {
+                seen[key] = true;
+                seqs[key] = s;
+                if (record[1])
+                    index[key] = (uint16_t)(pageStart + offset);
+                else
+                    index[key] = NO_RECORD;
+            }
+            offset += size;
+        }
+    }
+    seq = found ? newest + 1 : 0;
+    base = headOffset;
+    staged = 0;
+    failed = false;
+    return true;
+}
+
+/**
+ * \brief Erases all keys in the store.
+ *
+ * This marks the start of every page in the region as empty, which takes
+ * one EEPROM write cycle per page.  Returns false if the region is too
+ * small or the EEPROM did not accept one of the writes.
+ *
+ * \sa begin()
+ */
+bool EEPROM24Store::format()
+{
+    if (!staging || _pages < 2)
+        return false;
+    bool ok = true;
+    for (uint16_t page = 0; page < _pages; ++page) {
+        if (!_eeprom->write(_start + ((unsigned long)page) * _pageSize, RECORD_END))
+            ok = false;
+    }
+    for (uint8_t key = 0; key < EEPROM24_STORE_KEYS; ++key)
+        index[key] = NO_RECORD;
+    headPage = 0;
+    headOffset = 0;
+    base = 0;
+    staged = 0;
+    seq = 0;
+    failed = false;
+    return ok;
+}
+
+/**
+ * \brief Returns true if \a key currently has a value in the store.
+ *
+ * \sa get(), set(), remove()
+ */
+bool EEPROM24Store::contains(uint8_t key) const
+{
+    return key < EEPROM24_STORE_KEYS && index[key] != NO_RECORD;
+}
+
+/**
+ * \brief Reads the value of \a key into \a data, up to \a maxLength bytes.
+ *
+ * Returns the number of bytes that were copied into \a data, or zero if
+ * \a key does not have a value.
+ *
+ * \sa set(), contains()
+ */
+size_t EEPROM24Store::get(uint8_t key, void *data, size_t maxLength)
+{
+    if (key >= EEPROM24_STORE_KEYS || index[key] == NO_RECORD)
+        return 0;
+    unsigned long address = _start + index[key];
+    size_t len = _eeprom->read(address + 1);
+    if (len > maxLength)
+        len = maxLength;
+    return _eeprom->read(address + 4, data, len);
+}
+
+/**
+ * \brief Sets the value of \a key to the \a length bytes at \a data.
+ *
+ * The record is appended to the log and queued for writing with
+ * EEPROM24::queueWrite(), so this function usually returns before the
+ * EEPROM has been programmed.  A \a length of zero removes \a key.
+ *
+ * Returns false if \a key or \a length are out of range, or if there
+ * is no room for the record because the region is full of live values.
+ * Errors from the EEPROM itself are reported by flush().
+ *
+ * \sa get(), remove(), poll(), flush()
+ */
+bool EEPROM24Store::set(uint8_t key, const void *data, size_t length)
+{
+    if (key >= EEPROM24_STORE_KEYS || length > maxValueLength() || !staging)
+        return false;
+
+    // Wait for the previous record to leave the staging buffer.
+    if (!_eeprom->flush())
+        failed = true;
+
+    // Move onto the next page if the record won't fit in the current one.
+    uint16_t size = RECORD_OVERHEAD + length;
+    uint16_t attempts = 0;
+    while ((headOffset + size) > _pageSize) {
+        if (++attempts > _pages || !advance())
+            return false;
+    }
+    if (!append(key, data, (uint8_t)length))
+        return false;
+    return commit();
+}
+
+/**
+ * \brief Removes \a key from the store.
+ *
+ * Returns true if \a key was removed or did not have a value, or false if
+ * the removal could not be recorded.
+ *
+ * \sa set(), contains()
+ */
+bool EEPROM24Store::remove(uint8_t key)
+{
+    if (!contains(key))
+        return key < EEPROM24_STORE_KEYS;
+    return set(key, 0, 0);
+}
+
+/**
+ * \brief Returns the maximum length of a value, which depends upon the
+ * page size of the EEPROM.
+ *
+ * Values are never split across pages, so the maximum is the page size
+ * less the 5 bytes of record overhead, up to 255 bytes.
+ */
+size_t EEPROM24Store::maxValueLength() const
+{
+    if (_pageSize <= RECORD_OVERHEAD)
+        return 0;
+    size_t len = _pageSize - RECORD_OVERHEAD;
+    return len < 255 ? len : 255;
+}
+
+/**
+ * \brief Advances any write that is in progress and returns true if
+ * there is more work to do.
+ *
+ * This is a convenience for calling EEPROM24::poll() on the underlying
+ * EEPROM, and should be called regularly from the application's main
+ * loop after set() or remove().
+ *
+ * \sa flush()
+ */
+bool EEPROM24Store::poll()
+{
+    return _eeprom->poll();
+}
+
+/**
+ * \brief Waits for all pending records to be written to the EEPROM.
+ *
+ * Returns false if the EEPROM did not accept one of the records since
+ * the last call to flush().  The index may then refer to records that
+ * were never written; calling begin() will rebuild it from the records
+ * that are actually in the EEPROM.
+ *
+ * \sa poll()
+ */
+bool EEPROM24Store::flush()
+{
+    bool ok = _eeprom->flush() && !failed;
+    failed = false;
+    return ok;
+}
+
+/**
+ * \internal
+ * \brief Appends a record for \a key to the staging buffer.
+ */
+bool EEPROM24Store::append(uint8_t key, const void *data, uint8_t length)
+{
+    uint8_t *record = staging + staged;
+    record[0] = key;
+    record[1] = length;
+    if (length)
+        memcpy(record + 4, data, length);
+    finishRecord(record, length);
+    if (length)
+        index[key] = (uint16_t)(((unsigned long)headPage) * _pageSize + headOffset);
+    else
+        index[key] = NO_RECORD;
+    headOffset += RECORD_OVERHEAD + length;
+    staged += RECORD_OVERHEAD + length;
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Moves the head of the log onto the next page.
+ *
+ * The live records in the page after the new head page are copied into
+ * the new head page so that the following page is free for reuse by the
+ * next call.  Live records in the new head page itself are normally not
+ * present, but are preserved in case a previous copy was interrupted.
+ */
+bool EEPROM24Store::advance()
+{
+    if (!commit())
+        return false;
+    if (!_eeprom->flush())
+        failed = true;
+    headPage = (headPage + 1) < _pages ? headPage + 1 : 0;
+    headOffset = 0;
+    base = 0;
+    uint16_t next = (headPage + 1) < _pages ? headPage + 1 : 0;
+    return relocate(headPage) && relocate(next);
+}
+
+/**
+ * \internal
+ * \brief Copies the live records in \a page to the head of the log,
+ * for as long as they fit in the head page.
+ */
+bool EEPROM24Store::relocate(uint16_t page)
+{
+    for (uint8_t key = 0; key < EEPROM24_STORE_KEYS; ++key) {
+        if (index[key] == NO_RECORD || (index[key] / _pageSize) != page)
+            continue;
+        unsigned long address = _start + index[key];
+        uint8_t length = _eeprom->read(address + 1);
+        uint16_t size = RECORD_OVERHEAD + length;
+        if ((headOffset + size) > _pageSize)
+            continue;
+        uint8_t *record = staging + staged;
+        if (_eeprom->read(address, record, size - 1) != (size_t)(size - 1))
+            return false;
+        finishRecord(record, length);
+        index[key] = (uint16_t)(((unsigned long)headPage) * _pageSize + headOffset);
+        headOffset += size;
+        staged += size;
+    }
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Queues the staged records for writing to the head page.
+ *
+ * An end marker is written after the records if there is room for it.
+ */
+bool EEPROM24Store::commit()
+{
+    if (!staged)
+        return true;
+    size_t len = staged;
+    if (headOffset < _pageSize)
+        staging[len++] = RECORD_END;
+    unsigned long address = _start + ((unsigned long)headPage) * _pageSize + base;
+    base = headOffset;
+    staged = 0;
+    if (_eeprom->queueWrite(address, staging, len))
+        return true;
+    return _eeprom->write(address, staging, len) == len;
+}
+
+/**
+ * \internal
+ * \brief Fills in the sequence number and CRC of a \a record with a
+ * value of \a length bytes.
+ */
+void EEPROM24Store::finishRecord(uint8_t *record, uint8_t length)
+{
+    record[2] = (uint8_t)seq;
+    record[3] = (uint8_t)(seq >> 8);
+    ++seq;
+    record[4 + length] = crc8(record, 4 + length);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EEPROM24Store_h
+#define EEPROM24Store_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class EEPROM24;
+
+// Number of keys that can be stored, numbered from 0.  Each key uses
+// 2 bytes of RAM for the index.
+#if !defined(EEPROM24_STORE_KEYS)
+#define EEPROM24_STORE_KEYS     16
+#endif
+
+class EEPROM24Store
+{
+public:
+    EEPROM24Store(EEPROM24 &eeprom, unsigned long start, unsigned long size);
+    ~EEPROM24Store();
+
+    bool begin();
+    bool format();
+
+    bool contains(uint8_t key) const;
+    size_t get(uint8_t key, void *data, size_t maxLength);
+    bool set(uint8_t key, const void *data, size_t length);
+    bool remove(uint8_t key);
+
+    size_t maxValueLength() const;
+
+    bool poll();
+    bool flush();
+
+private:
+    EEPROM24 *_eeprom;
+    unsigned long _start;
+    uint16_t _pageSize;
+    uint16_t _pages;
+    uint16_t headPage;
+    uint16_t headOffset;
+    uint16_t base;
+    uint16_t staged;
+    uint16_t seq;
+    uint8_t *staging;
+    bool failed;
+    uint16_t index[EEPROM24_STORE_KEYS];
+
+    bool append(uint8_t key, const void *data, uint8_t length);
+    bool advance();
+    bool relocate(uint16_t page);
+    bool commit();
+    void finishRecord(uint8_t *record, uint8_t length);
+};
+
+#endif
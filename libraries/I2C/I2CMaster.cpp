@@ -21,12 +21,47 @@
  */
 
 #include "I2CMaster.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
 
 /**
  * \class I2CMaster I2CMaster.h <I2CMaster.h>
  * \brief Abstract base class for I2C master implementations.
  *
- * \sa SoftI2C
+ * \section i2c_stats Statistics
+ *
+ * Bus masters can optionally count the traffic on the bus, which can
+ * help to track down devices that are failing or hogging the bus.
+ * Counting is off by default.  To turn it on, pass a statistics block
+ * to setStatistics():
+ *
+ * \code
+ * SoftI2C i2c(A4, A5);
+ * I2CStatistics stats;
+ *
+ * void setup() {
+ *     memset(&stats, 0, sizeof(stats));
+ *     i2c.setStatistics(&stats);
+ * }
+ * \endcode
+ *
+ * The bus master then updates the following fields of the block:
+ *
+ * \li \c transactions: number of start and repeated start conditions.
+ * \li \c bytesWritten: number of bytes written, including addresses.
+ * \li \c bytesRead: number of bytes read.
+ * \li \c nacks: number of bytes that were not acknowledged by a slave.
+ * \li \c busErrors: number of clock stretch timeouts, lost arbitrations,
+ * and other bus errors.
+ * \li \c busyMicros: total time in microseconds between start and stop
+ * conditions.
+ *
+ * The block can be cleared at any time to start counting afresh.
+ *
+ * \sa SoftI2C, TwiI2C
  */
 
 /**
@@ -87,3 +122,106 @@
  *
  * \sa startRead(), available()
  */
+
+/**
+ * \brief Ends the current read operation early, before all of the bytes
+ * requested by startRead() have been read.
+ *
+ * The default implementation reads and discards the rest of the bytes.
+ * Subclasses should override this to read a single byte, acknowledge it
+ * with a NACK, and send the stop condition.
+ *
+ * \sa startRead(), read()
+ */
+void I2CMaster::endRead()
+{
+    while (available())
+        read();
+}
+
+/**
+ * \brief Writes \a txlen bytes from \a txbuf to the I2C slave at
+ * \a address and then reads \a rxlen bytes back into \a rxbuf.
+ *
+ * The read is started with a repeated start condition rather than a
+ * stop followed by a new start, which is the usual way to read a
+ * register from an I2C device: \a txbuf contains the register number
+ * and \a rxbuf receives the register contents.  If \a rxlen is zero,
+ * then the write is ended with a stop condition instead.
+ *
+ * Returns true if the slave acknowledged the request and all \a rxlen
+ * bytes were read; false otherwise.
+ *
+ * The default implementation is written in terms of startWrite(),
+ * write(), startRead(), and read().  Subclasses can override it to
+ * detect a NACK on the written bytes or to use a more efficient
+ * combined transfer.
+ *
+ * \sa startWrite(), startRead()
+ */
+/**
+ * \fn I2CStatistics *I2CMaster::statistics() const
+ * \brief Returns the block that is being used to count bus statistics,
+ * or null if statistics are not being counted.
+ *
+ * \sa setStatistics()
+ */
+
+/**
+ * \fn void I2CMaster::setStatistics(I2CStatistics *stats)
+ * \brief Sets the block to use to count bus statistics to \a stats.
+ *
+ * If \a stats is null, then statistics will no longer be counted.
+ * The block is not cleared by this function.
+ *
+ * \sa statistics()
+ */
+
+/**
+ * \brief Counts a start condition for the statistics, or a repeated start
+ * if \a restart is true.
+ *
+ * This is intended to be called by subclasses when statistics() is not
+ * null.
+ *
+ * \sa countStop()
+ */
+void I2CMaster::countStart(bool restart)
+{
+    ++(_stats->transactions);
+    if (!restart)
+        _busyStart = micros();
+}
+
+/**
+ * \brief Counts a stop condition for the statistics.
+ *
+ * This is intended to be called by subclasses when statistics() is not
+ * null.
+ *
+ * \sa countStart()
+ */
+void I2CMaster::countStop()
+{
+    _stats->busyMicros += micros() - _busyStart;
+}
+
+bool I2CMaster::writeThenRead(unsigned int address,
+                              const void *txbuf, unsigned int txlen,
+                              void *rxbuf, unsigned int rxlen)
+{
+    const uint8_t *tx = (const uint8_t *)txbuf;
+    startWrite(address);
+    while (txlen-- > 0)
+        write(*tx++);
+    if (!rxlen)
+        return endWrite();
+    if (!startRead(address, rxlen))
+        return false;
+    uint8_t *rx = (uint8_t *)rxbuf;
+    while (rxlen > 0 && available()) {
+        *rx++ = read();
+        --rxlen;
+    }
+    return rxlen == 0;
+}
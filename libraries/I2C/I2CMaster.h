@@ -25,17 +25,44 @@
 
 #include <inttypes.h>
 
+struct I2CStatistics
+{
+    unsigned long transactions;
+    unsigned long bytesWritten;
+    unsigned long bytesRead;
+    unsigned long nacks;
+    unsigned long busErrors;
+    unsigned long busyMicros;
+};
+
 class I2CMaster {
 public:
+    I2CMaster() : _stats(0), _busyStart(0) {}
+
     virtual unsigned int maxTransferSize() const = 0;
 
-    virtual void startWrite(unsigned int address);
+    virtual void startWrite(unsigned int address) = 0;
     virtual void write(uint8_t value) = 0;
     virtual bool endWrite() = 0;
 
     virtual bool startRead(unsigned int address, unsigned int count) = 0;
     virtual unsigned int available() = 0;
     virtual uint8_t read() = 0;
+    virtual void endRead();
+
+    virtual bool writeThenRead(unsigned int address,
+                               const void *txbuf, unsigned int txlen,
+                               void *rxbuf, unsigned int rxlen);
+
+    I2CStatistics *statistics() const { return _stats; }
+    void setStatistics(I2CStatistics *stats) { _stats = stats; }
+
+protected:
+    I2CStatistics *_stats;
+    unsigned long _busyStart;
+
+    void countStart(bool restart);
+    void countStop();
 };
 
 #endif
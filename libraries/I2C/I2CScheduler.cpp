@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "I2CScheduler.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/interrupt.h>
+
+/**
+ * \class I2CScheduler I2CScheduler.h <I2CScheduler.h>
+ * \brief Schedules asynchronous transactions from several devices that
+ * share a TwiI2C bus.
+ *
+ * When several devices share a bus, a long transfer for one device can
+ * delay a time-critical transfer for another.  I2CScheduler keeps a
+ * queue of pending transactions ordered by the priority of the device
+ * that submitted them, and hands them to TwiI2C::submit() one at a time.
+ * The next transaction is started from the completion interrupt of the
+ * previous one, so the bus is kept busy without involving the main loop.
+ *
+ * \code
+ * TwiI2C i2c(400000UL);
+ * I2CScheduler scheduler(i2c);
+ * I2CScheduler::Device rtcDevice;
+ * I2CScheduler::Device eepromDevice;
+ *
+ * ISR(TWI_vect)
+ * {
+ *     i2c.handleInterrupt();
+ * }
+ *
+ * void setup() {
+ *     scheduler.addDevice(&rtcDevice, 10);
+ *     scheduler.addDevice(&eepromDevice, 1);
+ * }
+ * \endcode
+ *
+ * Each transaction embeds a TwiI2C::Request that describes the transfer.
+ * The application fills in the address and buffer fields of the request,
+ * and optionally a callback, and then passes it to submit():
+ *
+ * \code
+ * I2CScheduler::Transaction rtcRead;
+ * uint8_t rtcRegister = 0;
+ * uint8_t rtcTime[3];
+ *
+ * rtcRead.request.address = 0x68;
+ * rtcRead.request.txbuf = &rtcRegister;
+ * rtcRead.request.txlen = 1;
+ * rtcRead.request.rxbuf = rtcTime;
+ * rtcRead.request.rxlen = 3;
+ * rtcRead.callback = timeReceived;
+ * scheduler.submit(&rtcDevice, &rtcRead);
+ * \endcode
+ *
+ * Transactions from a device with a higher priority number are started
+ * before those from devices with lower priorities.  Transactions of the
+ * same priority are started in the order they were submitted.  A
+ * transaction that has already started is never interrupted, so large
+ * transfers should be split into page-sized pieces to keep the latency
+ * of higher priority devices low.
+ *
+ * The scheduler also records the number of transactions, the number
+ * of bytes, and the time spent on the bus for each device.  This
+ * can be used to find the devices that are using up the bus capacity.
+ *
+ * \sa TwiI2C
+ */
+
+/**
+ * \brief Constructs a new transaction scheduler for \a bus.
+ */
+I2CScheduler::I2CScheduler(TwiI2C &bus)
+    : _bus(&bus)
+    , devices(0)
+    , current(0)
+    , pending(0)
+    , statsStart(0)
+{
+}
+
+/**
+ * \fn TwiI2C *I2CScheduler::bus() const
+ * \brief Returns the bus that this scheduler submits transactions to.
+ */
+
+/**
+ * \struct I2CScheduler::Device
+ * \brief Scheduling and statistics information for a device on the bus.
+ *
+ * The \c transactions, \c bytes, and \c busyMicros fields count the
+ * transactions that the device has completed since the last call to
+ * resetStatistics(), the number of bytes that they transferred, and the
+ * time that they spent on the bus in microseconds.  The other fields
+ * are used internally and are set by addDevice().
+ */
+
+/**
+ * \struct I2CScheduler::Transaction
+ * \brief Asynchronous transaction that is queued with I2CScheduler::submit().
+ *
+ * The caller fills in the \c address, \c txbuf, \c txlen, \c rxbuf, and
+ * \c rxlen fields of \c request, and the optional \c callback, before
+ * submitting the transaction.  The result is reported in
+ * \c request.status.  The other fields are used internally.
+ *
+ * The structure and its buffers must remain valid until the
+ * transaction has finished.
+ */
+
+/**
+ * \typedef I2CScheduler::TransactionCallback
+ * \brief Type of a function that is called from the TWI interrupt handler
+ * when a \a transaction finishes.
+ *
+ * The function may submit further transactions.
+ */
+
+/**
+ * \brief Adds \a device to this scheduler with a specific \a priority.
+ *
+ * Higher values of \a priority are scheduled first.  The statistics
+ * for \a device are reset to zero.
+ *
+ * \sa submit(), firstDevice()
+ */
+void I2CScheduler::addDevice(Device *device, uint8_t priority)
+{
+    device->priority = priority;
+    device->transactions = 0;
+    device->bytes = 0;
+    device->busyMicros = 0;
+    uint8_t save = SREG;
+    cli();
+    device->next = devices;
+    devices = device;
+    if (!statsStart)
+        statsStart = micros();
+    SREG = save;
+}
+
+/**
+ * \fn I2CScheduler::Device *I2CScheduler::firstDevice() const
+ * \brief Returns the first device in the list of devices that have been
+ * added to this scheduler, or null if there are no devices.
+ *
+ * The rest of the list can be found by following the \c next field of
+ * each device.  This is intended for reporting the statistics of all
+ * devices.
+ *
+ * \sa addDevice(), utilization()
+ */
+
+/**
+ * \brief Submits a \a transaction on behalf of \a device.
+ *
+ * Returns false if \a device or \a transaction is null, or if the
+ * address in the transaction's request is invalid.  Otherwise the
+ * transaction is queued and will be started once all pending
+ * transactions for devices of equal or higher priority have finished.
+ *
+ * \sa isBusy()
+ */
+bool I2CScheduler::submit(Device *device, Transaction *transaction)
+{
+    if (!device || !transaction || transaction->request.address >= 0x80)
+        return false;
+    transaction->device = device;
+    transaction->scheduler = this;
+    transaction->request.callback = finished;
+    transaction->request.status = TwiI2C::Pending;
+    uint8_t save = SREG;
+    cli();
+
+    // Insert after all pending transactions of the same or higher priority.
+    Transaction *prev = 0;
+    Transaction *next = pending;
+    while (next && next->device->priority >= device->priority) {
+        prev = next;
+        next = next->next;
+    }
+    transaction->next = next;
+    if (prev)
+        prev->next = transaction;
+    else
+        pending = transaction;
+
+    if (!current)
+        dispatch();
+    SREG = save;
+    return true;
+}
+
+/**
+ * \fn bool I2CScheduler::isBusy() const
+ * \brief Returns true if there is a transaction in progress or pending.
+ *
+ * \sa submit()
+ */
+
+/**
+ * \brief Resets the statistics for all devices to zero.
+ *
+ * \sa utilization()
+ */
+void I2CScheduler::resetStatistics()
+{
+    uint8_t save = SREG;
+    cli();
+    for (Device *device = devices; device; device = device->next) {
+        device->transactions = 0;
+        device->bytes = 0;
+        device->busyMicros = 0;
+    }
+    statsStart = micros();
+    SREG = save;
+}
+
+/**
+ * \brief Returns the percentage of time between 0 and 100 that \a device
+ * has occupied the bus since the last call to resetStatistics().
+ *
+ * The busy time counters will overflow after about 70 minutes, so the
+ * statistics should be reset more often than that.
+ *
+ * \sa resetStatistics()
+ */
+uint8_t I2CScheduler::utilization(const Device *device) const
+{
+    uint8_t save = SREG;
+    cli();
+    unsigned long busy = device->busyMicros;
+    unsigned long elapsed = micros() - statsStart;
+    SREG = save;
+    elapsed /= 100;
+    if (!elapsed)
+        return 0;
+    busy /= elapsed;
+    return busy < 100 ? (uint8_t)busy : 100;
+}
+
+/**
+ * \internal
+ * \brief Starts the next pending transaction, with interrupts disabled.
+ */
+void I2CScheduler::dispatch()
+{
+    Transaction *transaction = pending;
+    if (!transaction) {
+        current = 0;
+        return;
+    }
+    pending = transaction->next;
+    current = transaction;
+    transaction->started = micros();
+    _bus->submit(&(transaction->request));
+}
+
+/**
+ * \internal
+ * \brief Accounts for a finished \a request and starts the next one.
+ */
+void I2CScheduler::finished(TwiI2C *bus, TwiI2C::Request *request)
+{
+    // The request is the first member of the transaction structure.
+    Transaction *transaction = (Transaction *)request;
+    I2CScheduler *scheduler = transaction->scheduler;
+    Device *device = transaction->device;
+    device->busyMicros += micros() - transaction->started;
+    ++(device->transactions);
+    device->bytes += request->txlen + request->rxlen;
+    scheduler->current = 0;
+    scheduler->dispatch();
+    if (transaction->callback)
+        transaction->callback(transaction);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef I2CScheduler_h
+#define I2CScheduler_h
+
+#include "TwiI2C.h"
+
+class I2CScheduler
+{
+public:
+    explicit I2CScheduler(TwiI2C &bus);
+
+    struct Device
+    {
+        Device *next;
+        uint8_t priority;
+        unsigned long transactions;
+        unsigned long bytes;
+        unsigned long busyMicros;
+    };
+
+    struct Transaction;
+    typedef void (*TransactionCallback)(Transaction *transaction);
+
+    struct Transaction
+    {
+        TwiI2C::Request request;
+        TransactionCallback callback;
+        Device *device;
+        Transaction *next;
+        I2CScheduler *scheduler;
+        unsigned long started;
+    };
+
+    TwiI2C *bus() const { return _bus; }
+
+    void addDevice(Device *device, uint8_t priority);
+    Device *firstDevice() const { return devices; }
+
+    bool submit(Device *device, Transaction *transaction);
+    bool isBusy() const { return current != 0 || pending != 0; }
+
+    void resetStatistics();
+    uint8_t utilization(const Device *device) const;
+
+private:
+    TwiI2C *_bus;
+    Device *devices;
+    Transaction * volatile current;
+    Transaction * volatile pending;
+    unsigned long statsStart;
+
+    void dispatch();
+    static void finished(TwiI2C *bus, TwiI2C::Request *request);
+};
+
+#endif
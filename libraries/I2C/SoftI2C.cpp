@@ -27,6 +27,11 @@
 #include <WProgram.h>
 #endif
 
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <util/delay_basic.h>
+#endif
+
 /**
  * \class SoftI2C SoftI2C.h <SoftI2C.h>
  * \brief Bit-banged implementation of an I2C master.
@@ -35,31 +40,91 @@
  * of data and clock pins.  It is not restricted to pre-defined pins as
  * is the case for the standard Arduino two-wire interface.
  *
+ * Both lines are driven in open-drain fashion: a line is pulled low by
+ * making the pin an output, and released high by making it an input
+ * with the internal pull-up enabled.  External pull-up resistors will
+ * usually be needed for speeds above 100 kHz.  On AVR platforms, the
+ * pins are accessed directly through the port registers instead of
+ * via digitalWrite() and pinMode(), which is fast enough for Fast-mode
+ * operation at close to 400 kHz on a 16 MHz CPU.
+ *
+ * Slave devices may hold the clock line low to stretch the clock while
+ * they prepare data.  SoftI2C waits for the clock line to be released,
+ * giving up after roughly 25 milliseconds on a 16 MHz AVR, after which
+ * the transfer is reported as not acknowledged.
+ *
  * This implementation only implements the master side of the protocol.
- * It assumes that there is a single bus master, no arbitration, and
- * no clock stretching.
+ * It assumes that there is a single bus master and no arbitration.
  *
  * \sa I2CMaster
  */
 
-#define i2cDelay()  delayMicroseconds(5)
+// Number of polling iterations before giving up on a slave that is
+// stretching the clock.
+#define I2C_STRETCH_TIMEOUT     0xFFFFU
+
+// Approximate number of CPU cycles per half-bit spent outside
+// halfDelay() when using direct port access.
+#define I2C_HALF_BIT_OVERHEAD   24
 
 /**
- * \brief Constructs a new software I2C master on \a dataPin and \a clockPin.
+ * \brief Constructs a new software I2C master on \a dataPin and \a clockPin,
+ * with the bus running at up to \a speed Hz.
+ *
+ * \sa setSpeed()
  */
-SoftI2C::SoftI2C(uint8_t dataPin, uint8_t clockPin)
+SoftI2C::SoftI2C(uint8_t dataPin, uint8_t clockPin, unsigned long speed)
     : _dataPin(dataPin)
     , _clockPin(clockPin)
+    , _delay(0)
     , started(false)
     , acked(true)
     , inWrite(false)
     , readCount(0)
 {
-    // Initially set the CLOCK and DATA lines to be outputs in the high state.
-    pinMode(_clockPin, OUTPUT);
-    pinMode(_dataPin, OUTPUT);
-    digitalWrite(_clockPin, HIGH);
-    digitalWrite(_dataPin, HIGH);
+#if defined(__AVR__)
+    uint8_t port = digitalPinToPort(dataPin);
+    _dataOut = portOutputRegister(port);
+    _dataMode = portModeRegister(port);
+    _dataIn = portInputRegister(port);
+    _dataMask = digitalPinToBitMask(dataPin);
+    port = digitalPinToPort(clockPin);
+    _clockOut = portOutputRegister(port);
+    _clockMode = portModeRegister(port);
+    _clockIn = portInputRegister(port);
+    _clockMask = digitalPinToBitMask(clockPin);
+#endif
+    setSpeed(speed);
+
+    // Initially release the CLOCK and DATA lines to the high state.
+    dataHigh();
+    clockHigh();
+}
+
+/**
+ * \brief Sets the maximum \a speed of the I2C bus in Hz; typically
+ * 100000 for Standard-mode or 400000 for Fast-mode.
+ *
+ * The actual speed may be lower when the CPU cannot toggle the pins
+ * fast enough, or when slave devices stretch the clock.
+ */
+void SoftI2C::setSpeed(unsigned long speed)
+{
+    if (!speed)
+        speed = 100000UL;
+#if defined(__AVR__)
+    // Number of 4-cycle iterations of _delay_loop_2() per half-bit.
+    unsigned long cycles = F_CPU / (speed * 2);
+    if (cycles > I2C_HALF_BIT_OVERHEAD)
+        cycles = (cycles - I2C_HALF_BIT_OVERHEAD) / 4;
+    else
+        cycles = 0;
+    _delay = (cycles > 0xFFFFU) ? 0xFFFFU : (uint16_t)cycles;
+#else
+    // Number of microseconds per half-bit, rounded up.
+    unsigned long usecs = (500000UL + speed - 1) / speed;
+    _delay = (usecs > 0xFFFFU) ? 0xFFFFU : (uint16_t)usecs;
+#endif
 }
 
 unsigned int SoftI2C::maxTransferSize() const
@@ -69,29 +134,43 @@ unsigned int SoftI2C::maxTransferSize() const
 
 void SoftI2C::start()
 {
-    pinMode(_dataPin, OUTPUT);
+    if (_stats)
+        countStart(started);
     if (started) {
         // Already started, so send a restart condition.
-        digitalWrite(_dataPin, HIGH);
-        digitalWrite(_clockPin, HIGH);
-        i2cDelay();
+        dataHigh();
+        clockHigh();
+        halfDelay();
+    } else if (!readData()) {
+        // A slave is holding the data line low, probably because an
+        // earlier transfer was abandoned part-way through a byte.
+        // Clock it until it lets go, and then send a stop condition.
+        for (uint8_t count = 0; count < 9 && !readData(); ++count) {
+            clockLow();
+            halfDelay();
+            clockHigh();
+            halfDelay();
+        }
+        stop();
     }
-    digitalWrite(_dataPin, LOW);
-    i2cDelay();
-    digitalWrite(_clockPin, LOW);
-    i2cDelay();
+    dataLow();
+    halfDelay();
+    clockLow();
+    halfDelay();
     started = true;
     acked = true;
 }
 
 void SoftI2C::stop()
 {
-    pinMode(_dataPin, OUTPUT);
-    digitalWrite(_dataPin, LOW);
-    digitalWrite(_clockPin, HIGH);
-    i2cDelay();
-    digitalWrite(_dataPin, HIGH);
-    i2cDelay();
+    dataLow();
+    halfDelay();
+    clockHigh();
+    halfDelay();
+    dataHigh();
+    halfDelay();
+    if (_stats && started)
+        countStop();
     started = false;
     inWrite = false;
 }
@@ -122,8 +201,13 @@ void SoftI2C::write(uint8_t value)
         writeBit((value & mask) != 0);
         mask >>= 1;
     }
-    if (readBit())  // 0: ACK, 1: NACK
+    if (readBit()) { // 0: ACK, 1: NACK
         acked = false;
+        if (_stats)
+            ++(_stats->nacks);
+    }
+    if (_stats)
+        ++(_stats->bytesWritten);
 }
 
 bool SoftI2C::endWrite()
@@ -162,6 +246,8 @@ uint8_t SoftI2C::read()
     uint8_t value = 0;
     for (uint8_t bit = 0; bit < 8; ++bit)
         value = (value << 1) | readBit();
+    if (_stats)
+        ++(_stats->bytesRead);
     if (readCount > 1) {
         // More bytes left to read - send an ACK.
         writeBit(false);
@@ -175,28 +261,158 @@ uint8_t SoftI2C::read()
     return value;
 }
 
+void SoftI2C::endRead()
+{
+    // Reading the last byte sends the NACK and the stop condition.
+    if (readCount) {
+        readCount = 1;
+        SoftI2C::read();
+    }
+}
+
+bool SoftI2C::writeThenRead(unsigned int address,
+                            const void *txbuf, unsigned int txlen,
+                            void *rxbuf, unsigned int rxlen)
+{
+    const uint8_t *tx = (const uint8_t *)txbuf;
+    SoftI2C::startWrite(address);
+    while (txlen-- > 0)
+        SoftI2C::write(*tx++);
+    if (!rxlen || !acked) {
+        // Write only, or the slave rejected the write.  Stop here
+        // rather than sending a read request that will be ignored.
+        bool ok = acked;
+        stop();
+        return ok && !rxlen;
+    }
+    if (!SoftI2C::startRead(address, rxlen)) {
+        stop();
+        return false;
+    }
+    uint8_t *rx = (uint8_t *)rxbuf;
+    while (readCount > 0)
+        *rx++ = SoftI2C::read();
+    return true;
+}
+
 void SoftI2C::writeBit(bool bit)
 {
-    pinMode(_dataPin, OUTPUT);
     if (bit)
-        digitalWrite(_dataPin, HIGH);
+        dataHigh();
     else
-        digitalWrite(_dataPin, LOW);
-    i2cDelay();
-    digitalWrite(_clockPin, HIGH);
-    i2cDelay();
-    digitalWrite(_clockPin, LOW);
-    i2cDelay();
+        dataLow();
+    halfDelay();
+    if (!clockHigh())
+        acked = false;
+    halfDelay();
+    clockLow();
 }
 
 bool SoftI2C::readBit()
 {
+    dataHigh();
+    halfDelay();
+    if (!clockHigh())
+        acked = false;
+    bool bit = readData();
+    halfDelay();
+    clockLow();
+    return bit;
+}
+
+// Waits for half a bit period at the configured speed.
+inline void SoftI2C::halfDelay()
+{
+#if defined(__AVR__)
+    if (_delay)
+        _delay_loop_2(_delay);
+#else
+    delayMicroseconds(_delay);
+#endif
+}
+
+// Pulls the data line low.
+inline void SoftI2C::dataLow()
+{
+#if defined(__AVR__)
+    uint8_t save = SREG;
+    cli();
+    *_dataOut &= ~_dataMask;
+    *_dataMode |= _dataMask;
+    SREG = save;
+#else
+    digitalWrite(_dataPin, LOW);
+    pinMode(_dataPin, OUTPUT);
+#endif
+}
+
+// Releases the data line so that it can be pulled high.
+inline void SoftI2C::dataHigh()
+{
+#if defined(__AVR__)
+    uint8_t save = SREG;
+    cli();
+    *_dataMode &= ~_dataMask;
+    *_dataOut |= _dataMask;
+    SREG = save;
+#else
     pinMode(_dataPin, INPUT);
     digitalWrite(_dataPin, HIGH);
-    digitalWrite(_clockPin, HIGH);
-    bool bit = digitalRead(_dataPin);
-    i2cDelay();
+#endif
+}
+
+inline bool SoftI2C::readData()
+{
+#if defined(__AVR__)
+    return (*_dataIn & _dataMask) != 0;
+#else
+    return digitalRead(_dataPin);
+#endif
+}
+
+// Pulls the clock line low.
+inline void SoftI2C::clockLow()
+{
+#if defined(__AVR__)
+    uint8_t save = SREG;
+    cli();
+    *_clockOut &= ~_clockMask;
+    *_clockMode |= _clockMask;
+    SREG = save;
+#else
     digitalWrite(_clockPin, LOW);
-    i2cDelay();
-    return bit;
+    pinMode(_clockPin, OUTPUT);
+#endif
+}
+
+// Releases the clock line and waits for any slave that is stretching
+// the clock to let it go high.  Returns false on timeout.
+bool SoftI2C::clockHigh()
+{
+    unsigned int timeout = I2C_STRETCH_TIMEOUT;
+#if defined(__AVR__)
+    uint8_t save = SREG;
+    cli();
+    *_clockMode &= ~_clockMask;
+    *_clockOut |= _clockMask;
+    SREG = save;
+    while (!(*_clockIn & _clockMask)) {
+        if (--timeout == 0) {
+            if (_stats)
+                ++(_stats->busErrors);
+            return false;
+        }
+    }
+#else
+    pinMode(_clockPin, INPUT);
+    digitalWrite(_clockPin, HIGH);
+    while (!digitalRead(_clockPin)) {
+        if (--timeout == 0) {
+            if (_stats)
+                ++(_stats->busErrors);
+            return false;
+        }
+    }
+#endif
+    return true;
 }
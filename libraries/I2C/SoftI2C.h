@@ -27,7 +27,9 @@
 
 class SoftI2C : public I2CMaster {
 public:
-    SoftI2C(uint8_t dataPin, uint8_t clockPin);
+    SoftI2C(uint8_t dataPin, uint8_t clockPin, unsigned long speed = 100000UL);
+
+    void setSpeed(unsigned long speed);
 
     unsigned int maxTransferSize() const;
 
@@ -38,10 +40,26 @@ public:
     bool startRead(unsigned int address, unsigned int count);
     unsigned int available();
     uint8_t read();
+    void endRead();
+
+    bool writeThenRead(unsigned int address,
+                       const void *txbuf, unsigned int txlen,
+                       void *rxbuf, unsigned int rxlen);
 
 private:
     uint8_t _dataPin;
     uint8_t _clockPin;
+#if defined(__AVR__)
+    volatile uint8_t *_dataOut;
+    volatile uint8_t *_dataMode;
+    volatile uint8_t *_dataIn;
+    volatile uint8_t *_clockOut;
+    volatile uint8_t *_clockMode;
+    volatile uint8_t *_clockIn;
+    uint8_t _dataMask;
+    uint8_t _clockMask;
+#endif
+    uint16_t _delay;
     bool started;
     bool acked;
     bool inWrite;
@@ -51,6 +69,13 @@ private:
     void stop();
     void writeBit(bool bit);
     bool readBit();
+
+    void halfDelay();
+    void dataLow();
+    void dataHigh();
+    bool readData();
+    void clockLow();
+    bool clockHigh();
 };
 
 #endif
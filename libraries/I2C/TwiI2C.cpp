@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TwiI2C.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * \class TwiI2C TwiI2C.h <TwiI2C.h>
+ * \brief I2C master that uses the AVR's two-wire interface (TWI) hardware.
+ *
+ * This class drives the TWI registers of the AVR directly and so it
+ * is not limited by the 32-byte buffer of the standard Arduino Wire
+ * library, or by the 100 kHz clock of SoftI2C.  The bus speed can be
+ * set to 400 kHz for Fast-mode devices or up to 1 MHz for Fast-mode
+ * Plus devices, subject to the CPU clock and the bus pull-up resistors:
+ *
+ * \code
+ * TwiI2C i2c(400000UL);
+ * EEPROM24 eeprom(i2c, EEPROM_24LC256);
+ * \endcode
+ *
+ * The standard I2CMaster functions block until each byte has been
+ * transferred, just like SoftI2C, but the CPU is free to service
+ * interrupts while the hardware shifts the bits.
+ *
+ * \section twi_async Asynchronous transfers
+ *
+ * The application can also submit() transfer requests that are carried
+ * out entirely by the TWI interrupt while the main loop continues with
+ * other work.  Requests are queued in order and each consists of an
+ * optional write of \c txlen bytes followed by an optional read of
+ * \c rxlen bytes, joined by a repeated start condition.  The request
+ * structure and its buffers belong to the caller and must remain valid
+ * until the request's \c status changes from TwiI2C::Pending:
+ *
+ * \code
+ * TwiI2C i2c(400000UL);
+ * TwiI2C::Request rtcRequest;
+ * uint8_t rtcRegister = 0;
+ * uint8_t rtcTime[3];
+ *
+ * ISR(TWI_vect)
+ * {
+ *     i2c.handleInterrupt();
+ * }
+ *
+ * void loop() {
+ *     if (rtcRequest.status != TwiI2C::Pending) {
+ *         if (rtcRequest.status == TwiI2C::Done)
+ *             showTime(rtcTime);
+ *         rtcRequest.address = 0x68;
+ *         rtcRequest.txbuf = &rtcRegister;
+ *         rtcRequest.txlen = 1;
+ *         rtcRequest.rxbuf = rtcTime;
+ *         rtcRequest.rxlen = 3;
+ *         rtcRequest.callback = 0;
+ *         i2c.submit(&rtcRequest);
+ *     }
+ *     ...
+ * }
+ * \endcode
+ *
+ * The application must provide the interrupt handler for \c TWI_vect as
+ * shown above; this class does not define it so that it can co-exist in
+ * the same build as the Wire library.  The synchronous I2CMaster
+ * functions wait for the request queue to drain before using the bus,
+ * so drivers such as EEPROM24 and the RTC classes can be mixed
+ * freely with asynchronous requests from the main loop.
+ *
+ * Only 7-bit I2C addresses are supported.
+ *
+ * \sa I2CMaster, SoftI2C
+ */
+
+// TWI status codes from the AVR datasheet.
+#define TWI_START           0x08
+#define TWI_REP_START       0x10
+#define TWI_MT_SLA_ACK      0x18
+#define TWI_MT_SLA_NACK     0x20
+#define TWI_MT_DATA_ACK     0x28
+#define TWI_MT_DATA_NACK    0x30
+#define TWI_MR_SLA_ACK      0x40
+#define TWI_MR_SLA_NACK     0x48
+#define TWI_MR_DATA_ACK     0x50
+#define TWI_MR_DATA_NACK    0x58
+#define twiStatus()         (TWSR & 0xF8)
+
+// Number of polling iterations before a blocking operation gives up
+// on a stuck bus.
+#define TWI_TIMEOUT         0xFFFFU
+
+/**
+ * \brief Constructs a new TWI-based I2C master with the bus running
+ * at \a speed Hz.
+ *
+ * \sa setSpeed()
+ */
+TwiI2C::TwiI2C(unsigned long speed)
+    : queueHead(0)
+    , queueTail(0)
+    , posn(0)
+    , reading(false)
+    , started(false)
+    , acked(true)
+    , readCount(0)
+{
+#if defined(SDA) && defined(SCL)
+    // Enable the internal pull-ups, which is enough for short buses.
+    digitalWrite(SDA, HIGH);
+    digitalWrite(SCL, HIGH);
+#endif
+    setSpeed(speed);
+    TWCR = _BV(TWEN);
+}
+
+/**
+ * \brief Sets the speed of the I2C bus to \a speed Hz.
+ *
+ * The speed is rounded down to the nearest value that the TWI clock
+ * generator can produce from the CPU clock.  The fastest speed is
+ * F_CPU / 16, which is 1 MHz on a 16 MHz Arduino.  Speeds above
+ * 400 kHz require Fast-mode Plus devices and strong pull-up resistors.
+ */
+void TwiI2C::setSpeed(unsigned long speed)
+{
+    // SCL = F_CPU / (16 + 2 * TWBR * prescaler), where prescaler = 4^TWPS.
+    unsigned long divider = 0;
+    if (speed && speed < (F_CPU / 16))
+        divider = ((F_CPU / speed) - 15) / 2;
+    uint8_t prescale = 0;
+    while (divider > 255 && prescale < 3) {
+        divider = (divider + 3) / 4;
+        ++prescale;
+    }
+    TWSR = prescale;
+    TWBR = (divider > 255) ? 255 : (uint8_t)divider;
+}
+
+unsigned int TwiI2C::maxTransferSize() const
+{
+    return 0xFFFF;
+}
+
+void TwiI2C::startWrite(unsigned int address)
+{
+    waitIdle();
+    waitStop();
+    acked = false;
+    if (address >= 0x80)
+        return;
+    if (_stats)
+        countStart(started);
+    if (!command(_BV(TWSTA)))
+        return;
+    started = true;
+    TWDR = (uint8_t)(address << 1);
+    if (command(0) && twiStatus() == TWI_MT_SLA_ACK)
+        acked = true;
+    else if (_stats)
+        ++(_stats->nacks);
+    if (_stats)
+        ++(_stats->bytesWritten);
+}
+
+void TwiI2C::write(uint8_t value)
+{
+    if (!started)
+        return;
+    TWDR = value;
+    if (!command(0) || twiStatus() != TWI_MT_DATA_ACK) {
+        acked = false;
+        if (_stats)
+            ++(_stats->nacks);
+    }
+    if (_stats)
+        ++(_stats->bytesWritten);
+}
+
+bool TwiI2C::endWrite()
+{
+    stop();
+    return acked;
+}
+
+bool TwiI2C::startRead(unsigned int address, unsigned int count)
+{
+    waitIdle();
+    waitStop();
+    readCount = 0;
+    if (address >= 0x80) {
+        stop();
+        return false;
+    }
+    if (_stats)
+        countStart(started);
+    if (!command(_BV(TWSTA))) {
+        stop();
+        return false;
+    }
+    started = true;
+    TWDR = (uint8_t)((address << 1) | 0x01);
+    if (_stats)
+        ++(_stats->bytesWritten);
+    if (!command(0) || twiStatus() != TWI_MR_SLA_ACK) {
+        if (_stats)
+            ++(_stats->nacks);
+        stop();
+        return false;
+    }
+    readCount = count;
+    if (!count)
+        stop();
+    return true;
+}
+
+unsigned int TwiI2C::available()
+{
+    return readCount;
+}
+
+uint8_t TwiI2C::read()
+{
+    if (!readCount)
+        return 0;
+
+    // ACK every byte except the last, which gets a NACK and a stop.
+    uint8_t value = 0;
+    if (command(readCount > 1 ? _BV(TWEA) : 0))
+        value = TWDR;
+    if (_stats)
+        ++(_stats->bytesRead);
+    if (--readCount == 0)
+        stop();
+    return value;
+}
+
+void TwiI2C::endRead()
+{
+    // Reading the last byte sends the NACK and the stop condition.
+    if (readCount) {
+        readCount = 1;
+        TwiI2C::read();
+    }
+}
+
+/**
+ * \struct TwiI2C::Request
+ * \brief Asynchronous transfer request for TwiI2C::submit().
+ *
+ * \li \c address is the 7-bit I2C address of the slave device.
+ * \li \c txbuf and \c txlen give the bytes to write, if any.
+ * \li \c rxbuf and \c rxlen give the buffer to read into, if any.
+ * \li \c callback is called from the interrupt handler when the request
+ * has finished, or it can be null.
+ * \li \c status is set to TwiI2C::Pending by submit() and then changes to
+ * TwiI2C::Done or TwiI2C::Failed when the request finishes.  TwiI2C::Idle
+ * is zero, so a zero-initialized request has not finished a transfer.
+ *
+ * A request with both lengths set to zero probes for the presence of the
+ * slave device.  The \c next field is used internally.
+ */
+
+/**
+ * \typedef TwiI2C::RequestCallback
+ * \brief Type of a function that is called from the TWI interrupt handler
+ * when an asynchronous \a request on \a bus finishes.
+ *
+ * The function may submit() further requests, but must not use the
+ * blocking I2CMaster functions.
+ */
+
+/**
+ * \brief Submits an asynchronous transfer \a request to the queue.
+ *
+ * Returns false if \a request is null or its address is out of range.
+ * Otherwise the transfer will be performed by handleInterrupt() after
+ * any requests that were submitted before it.
+ *
+ * \sa isBusy(), waitIdle(), handleInterrupt()
+ */
+bool TwiI2C::submit(Request *request)
+{
+    if (!request || request->address >= 0x80)
+        return false;
+    request->next = 0;
+    request->status = Pending;
+    uint8_t save = SREG;
+    cli();
+    if (queueTail) {
+        queueTail->next = request;
+        queueTail = request;
+    } else {
+        queueHead = request;
+        queueTail = request;
+        waitStop();
+        startRequest(_BV(TWSTA));
+    }
+    SREG = save;
+    return true;
+}
+
+/**
+ * \fn bool TwiI2C::isBusy() const
+ * \brief Returns true if there are asynchronous requests in the queue
+ * that have not finished yet.
+ *
+ * \sa submit(), waitIdle()
+ */
+
+/**
+ * \brief Waits until all asynchronous requests have finished.
+ *
+ * Interrupts must be enabled, or this function will never return.
+ *
+ * \sa submit(), isBusy()
+ */
+void TwiI2C::waitIdle()
+{
+    while (queueHead != 0)
+        ;   // Do nothing.
+}
+
+/**
+ * \brief Advances the current asynchronous request.
+ *
+ * This must be called from the application's \c TWI_vect interrupt
+ * handler.
+ *
+ * \sa submit()
+ */
+void TwiI2C::handleInterrupt()
+{
+    Request *request = queueHead;
+    if (!request) {
+        // Spurious interrupt; leave the bus alone.
+        TWCR = _BV(TWEN);
+        return;
+    }
+    uint8_t control = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+    switch (twiStatus()) {
+    case TWI_START:
+    case TWI_REP_START:
+        if (_stats) {
+            countStart(twiStatus() == TWI_REP_START);
+            ++(_stats->bytesWritten);
+        }
+        TWDR = (uint8_t)((request->address << 1) | (reading ? 0x01 : 0x00));
+        TWCR = control;
+        break;
+
+    case TWI_MT_SLA_ACK:
+    case TWI_MT_DATA_ACK:
+        if (posn < request->txlen) {
+            if (_stats)
+                ++(_stats->bytesWritten);
+            TWDR = request->txbuf[posn++];
+            TWCR = control;
+        } else if (request->rxlen) {
+            // Switch to reading with a repeated start.
+            reading = true;
+            posn = 0;
+            TWCR = control | _BV(TWSTA);
+        } else {
+            finishRequest(Done);
+        }
+        break;
+
+    case TWI_MR_SLA_ACK:
+        TWCR = control | (request->rxlen > 1 ? _BV(TWEA) : 0);
+        break;
+
+    case TWI_MR_DATA_ACK:
+        request->rxbuf[posn++] = TWDR;
+        if (_stats)
+            ++(_stats->bytesRead);
+        TWCR = control | ((request->rxlen - posn) > 1 ? _BV(TWEA) : 0);
+        break;
+
+    case TWI_MR_DATA_NACK:
+        request->rxbuf[posn++] = TWDR;
+        if (_stats)
+            ++(_stats->bytesRead);
+        finishRequest(Done);
+        break;
+
+    case TWI_MT_SLA_NACK:
+    case TWI_MT_DATA_NACK:
+    case TWI_MR_SLA_NACK:
+        if (_stats)
+            ++(_stats->nacks);
+        finishRequest(Failed);
+        break;
+
+    default:
+        // Lost arbitration or bus error.
+        if (_stats)
+            ++(_stats->busErrors);
+        finishRequest(Failed);
+        break;
+    }
+}
+
+/**
+ * \internal
+ * \brief Issues a TWI \a control command and waits for it to complete.
+ *
+ * Returns false and resets the TWI if the bus appears to be stuck.
+ */
+bool TwiI2C::command(uint8_t control)
+{
+    TWCR = control | _BV(TWINT) | _BV(TWEN);
+    unsigned int timeout = TWI_TIMEOUT;
+    while (!(TWCR & _BV(TWINT))) {
+        if (--timeout == 0) {
+            TWCR = 0;
+            TWCR = _BV(TWEN);
+            if (_stats) {
+                ++(_stats->busErrors);
+                if (started)
+                    countStop();
+            }
+            started = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Sends a stop condition and waits for it to complete.
+ */
+void TwiI2C::stop()
+{
+    if (started) {
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+        waitStop();
+        if (_stats)
+            countStop();
+        started = false;
+    }
+}
+
+/**
+ * \internal
+ * \brief Waits for a pending stop condition to finish.
+ *
+ * The stop that ends an asynchronous request is issued from the interrupt
+ * handler without waiting, so the next transaction must not send a start
+ * condition until the TWI hardware has finished sending it.
+ */
+void TwiI2C::waitStop()
+{
+    unsigned int timeout = TWI_TIMEOUT;
+    while ((TWCR & _BV(TWSTO)) && --timeout != 0)
+        ;   // Do nothing.
+}
+
+/**
+ * \internal
+ * \brief Starts the request at the head of the queue by issuing \a control.
+ */
+void TwiI2C::startRequest(uint8_t control)
+{
+    Request *request = queueHead;
+    posn = 0;
+    reading = (request->txlen == 0 && request->rxlen != 0);
+    TWCR = control | _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+}
+
+/**
+ * \internal
+ * \brief Finishes the request at the head of the queue with \a status
+ * and moves onto the next request.
+ */
+void TwiI2C::finishRequest(uint8_t status)
+{
+    Request *request = queueHead;
+    queueHead = request->next;
+    if (_stats)
+        countStop();
+    if (queueHead) {
+        // Stop the current transfer and start the next in one step.
+        startRequest(_BV(TWSTO) | _BV(TWSTA));
+    } else {
+        queueTail = 0;
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+    }
+    request->status = status;
+    if (request->callback)
+        request->callback(this, request);
+}
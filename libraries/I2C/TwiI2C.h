@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TwiI2C_h
+#define TwiI2C_h
+
+#include "I2CMaster.h"
+
+class TwiI2C : public I2CMaster {
+public:
+    explicit TwiI2C(unsigned long speed = 100000UL);
+
+    void setSpeed(unsigned long speed);
+
+    unsigned int maxTransferSize() const;
+
+    void startWrite(unsigned int address);
+    void write(uint8_t value);
+    bool endWrite();
+
+    bool startRead(unsigned int address, unsigned int count);
+    unsigned int available();
+    uint8_t read();
+    void endRead();
+
+    struct Request;
+    typedef void (*RequestCallback)(TwiI2C *bus, Request *request);
+
+    struct Request
+    {
+        Request *next;
+        uint8_t address;
+        const uint8_t *txbuf;
+        unsigned int txlen;
+        uint8_t *rxbuf;
+        unsigned int rxlen;
+        RequestCallback callback;
+        volatile uint8_t status;
+    };
+
+    enum
+    {
+        Idle,
+        Pending,
+        Done,
+        Failed
+    };
+
+    bool submit(Request *request);
+    bool isBusy() const { return queueHead != 0; }
+    void waitIdle();
+
+    void handleInterrupt();
+
+private:
+    Request * volatile queueHead;
+    Request *queueTail;
+    unsigned int posn;
+    bool reading;
+    bool started;
+    bool acked;
+    unsigned int readCount;
+
+    bool command(uint8_t control);
+    void stop();
+    void waitStop();
+    void startRequest(uint8_t control);
+    void finishRequest(uint8_t status);
+};
+
+#endif
@@ -0,0 +1,58 @@
+/*
+This example demonstrates how to collect statistics about the traffic
+on an I2C bus.  It reads the time from a DS3232 realtime clock and a
+block of data from a 24LC256 EEPROM once a second, and dumps the bus
+statistics to the serial port.
+
+This example is placed into the public domain.
+*/
+
+#include <SoftI2C.h>
+#include <EEPROM24.h>
+#include <DS3232RTC.h>
+#include <string.h>
+
+SoftI2C i2c(A4, A5);
+DS3232RTC rtc(i2c);
+EEPROM24 eeprom(i2c, EEPROM_24LC256);
+I2CStatistics stats;
+
+void setup() {
+    Serial.begin(9600);
+    memset(&stats, 0, sizeof(stats));
+    i2c.setStatistics(&stats);
+}
+
+void loop() {
+    RTCTime time;
+    rtc.readTime(&time);
+
+    byte buffer[32];
+    bool eepromOK = eeprom.available();
+    if (eepromOK)
+        eeprom.read(0, buffer, sizeof(buffer));
+
+    Serial.print("EEPROM: ");
+    Serial.println(eepromOK ? "present" : "not responding");
+    Serial.print("Transactions: ");
+    Serial.println(stats.transactions);
+    Serial.print("Bytes written: ");
+    Serial.println(stats.bytesWritten);
+    Serial.print("Bytes read: ");
+    Serial.println(stats.bytesRead);
+    Serial.print("NACKs: ");
+    Serial.println(stats.nacks);
+    Serial.print("Bus errors: ");
+    Serial.println(stats.busErrors);
+    Serial.print("Bus busy: ");
+    Serial.print(stats.busyMicros);
+    Serial.println(" us");
+    if (stats.transactions) {
+        Serial.print("Average: ");
+        Serial.print(stats.busyMicros / stats.transactions);
+        Serial.println(" us per transaction");
+    }
+    Serial.println();
+
+    delay(1000);
+}
@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IRdecoder.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/pgmspace.h>
+
+/**
+ * \class IRdecoder IRdecoder.h <IRdecoder.h>
+ * \brief Decodes infrared remote control commands in several protocols
+ * at once.
+ *
+ * IRdecoder runs a state machine for each enabled protocol in parallel
+ * over the timings of the edges from an infrared receiver, so remote
+ * controls from different manufacturers can be used at the same time.
+ * The following protocols are supported:
+ *
+ * \li RC5 - Philips RC-5, 14 bits, Manchester encoded.
+ * \li RC6 - Philips RC-6 mode 0, 8-bit address and command.
+ * \li NEC - NEC pulse distance, 16-bit address and
+ * 8-bit command, with repeat codes.
+ * \li SIRC - Sony SIRC pulse width, 12-bit version with a
+ * 5-bit address and 7-bit command.
+ *
+ * Each protocol is described by a small table of timings in program memory,
+ * and all protocols of the same encoding share the same state machine.
+ *
+ * The easiest way to feed the decoder is to attach it to an IRreceiver,
+ * preferably in \ref ir_capture "input capture mode" so that the decoding
+ * is done outside of interrupt context:
+ *
+ * \code
+ * IRreceiver ir(IRreceiver::INPUT_CAPTURE);
+ * IRdecoder decoder;
+ *
+ * ISR(TIMER1_CAPT_vect)
+ * {
+ *     ir.handleCapture();
+ * }
+ *
+ * void setup() {
+ *     ir.setDecoder(&decoder);
+ * }
+ *
+ * void loop() {
+ *     ir.command();    // Processes the captured edges.
+ *     IRcode code;
+ *     if (decoder.read(&code)) {
+ *         ...
+ *     }
+ * }
+ * \endcode
+ *
+ * \sa IRreceiver, IRcode
+ */
+
+/**
+ * \class IRcode IRdecoder.h <IRdecoder.h>
+ * \brief Command that was received by IRdecoder.
+ */
+
+/**
+ * \var IRcode::protocol
+ * \brief The protocol that the command was received in, from
+ * IRdecoder::Protocol.
+ */
+
+/**
+ * \var IRcode::repeat
+ * \brief True if this is a repeat of the previous command because the
+ * button is being held down.
+ */
+
+/**
+ * \var IRcode::address
+ * \brief The address or system number from the command.
+ */
+
+/**
+ * \var IRcode::command
+ * \brief The command number from the command.
+ */
+
+/**
+ * \var IRcode::value
+ * \brief All of the bits in the command, in the order they were received.
+ */
+
+// Encodings.
+#define IR_MANCHESTER       0   // Bits are a pair of half-bits.
+#define IR_PULSE_DISTANCE   1   // Bit value is in the length of the space.
+#define IR_PULSE_WIDTH      2   // Bit value is in the length of the mark.
+
+// Flags.
+#define IR_LSB_FIRST        0x01    // Bits are sent least significant first.
+#define IR_MARK_IS_ZERO     0x02    // Manchester: mark then space is a 0.
+#define IR_IMPLICIT_START   0x04    // Manchester: first half-bit is idle.
+#define IR_CHECK_INVERTED   0x08    // Byte after the command is its inverse.
+
+#define IR_NO_BIT           0xFF
+
+// Timing descriptor for a protocol.  All times are in microseconds.
+struct IRProtocol
+{
+    uint8_t encoding;
+    uint8_t flags;
+    uint8_t bits;           // Number of bits in a frame.
+    uint8_t longBit;        // Manchester bit with double-length halves.
+    uint8_t toggleBit;      // Position of the toggle bit in the value.
+    uint8_t addressShift;
+    uint8_t addressBits;
+    uint8_t commandShift;
+    uint8_t commandBits;
+    unsigned int headerMark;
+    unsigned int headerSpace;
+    unsigned int repeatSpace;   // Header space of a repeat code.
+    unsigned int unit;          // Manchester half-bit time.
+    unsigned int zeroMark;
+    unsigned int zeroSpace;
+    unsigned int oneMark;
+    unsigned int oneSpace;
+};
+
+static IRProtocol const protocols[IRdecoder::PROTOCOL_COUNT] PROGMEM = {
+    // RC5: S1 S2 T A4-A0 C5-C0, 889us half-bits, 1 = space then mark.
+    {IR_MANCHESTER, IR_MARK_IS_ZERO | IR_IMPLICIT_START, 14,
+     IR_NO_BIT, 11, 6, 5, 0, 6,
+     0, 0, 0, 889, 0, 0, 0, 0},
+    // RC6 mode 0: leader, start bit, 3 mode bits, double-length trailer
+    // (toggle) bit, 8 address bits and 8 command bits.
+    {IR_MANCHESTER, 0, 21,
+     4, 16, 8, 8, 0, 8,
+     2666, 889, 0, 444, 0, 0, 0, 0},
+    // NEC: 16-bit address, 8-bit command, 8-bit inverted command.
+    {IR_PULSE_DISTANCE, IR_LSB_FIRST | IR_CHECK_INVERTED, 32,
+     IR_NO_BIT, IR_NO_BIT, 0, 16, 16, 8,
+     9000, 4500, 2250, 0, 560, 560, 560, 1690},
+    // Sony SIRC 12-bit: 7-bit command, 5-bit address.
+    {IR_PULSE_WIDTH, IR_LSB_FIRST, 12,
+     IR_NO_BIT, IR_NO_BIT, 7, 5, 0, 7,
+     2400, 600, 0, 0, 600, 600, 1200, 600}
+};
+
+// States.
+#define IR_IDLE             0
+#define IR_HEADER_SPACE     1
+#define IR_DATA             2
+#define IR_REPEAT           3
+
+// A space longer than this is the gap between frames.
+#define IR_GAP_TIME         6000UL
+
+// A frame without a toggle bit that is the same as the previous one
+// within this time is an auto-repeat.
+#define IR_REPEAT_TIME      150000UL
+
+static bool match(unsigned long duration, unsigned int expected)
+{
+    unsigned int tolerance = (expected >> 2) + 50;
+    return (duration + tolerance) >= expected &&
+           duration <= ((unsigned long)expected + tolerance);
+}
+
+/**
+ * \brief Constructs a new infrared decoder with all protocols enabled.
+ */
+IRdecoder::IRdecoder()
+    : lastEdge(0)
+    , enabled((1 << PROTOCOL_COUNT) - 1)
+    , afterGap(true)
+    , ready(false)
+{
+    for (uint8_t index = 0; index < PROTOCOL_COUNT; ++index) {
+        states[index].state = IR_IDLE;
+        states[index].haveLast = false;
+    }
+}
+
+/**
+ * \enum IRdecoder::Protocol
+ * \brief Protocols that are recognized by IRdecoder.
+ */
+
+/**
+ * \var IRdecoder::PROTOCOL_COUNT
+ * \brief Number of protocols that are recognized by IRdecoder.
+ */
+
+/**
+ * \fn void IRdecoder::enableProtocol(uint8_t protocol)
+ * \brief Enables decoding of \a protocol.
+ *
+ * All protocols are enabled by default.
+ *
+ * \sa disableProtocol(), isProtocolEnabled()
+ */
+
+/**
+ * \fn void IRdecoder::disableProtocol(uint8_t protocol)
+ * \brief Disables decoding of \a protocol.
+ *
+ * Disabling protocols that are not in use saves time on every edge and
+ * avoids false matches from noise.
+ *
+ * \sa enableProtocol(), isProtocolEnabled()
+ */
+
+/**
+ * \fn bool IRdecoder::isProtocolEnabled(uint8_t protocol) const
+ * \brief Returns true if decoding of \a protocol is enabled.
+ *
+ * \sa enableProtocol(), disableProtocol()
+ */
+
+/**
+ * \brief Processes an edge from the infrared receiver.
+ *
+ * \param value The new level of the receiver's output after the edge.
+ * The output is active-low, so LOW indicates the start of a mark.
+ * \param time The time of the edge in microseconds.
+ *
+ * IRreceiver calls this function automatically for each edge once the
+ * decoder has been attached with IRreceiver::setDecoder().
+ */
+void IRdecoder::edge(bool value, unsigned long time)
+{
+    unsigned long duration = time - lastEdge;
+    lastEdge = time;
+
+    // The segment that has just ended was a mark if the output is now HIGH.
+    bool mark = value;
+    if (!mark && duration >= IR_GAP_TIME) {
+        // Long space between frames, so start all protocols again.
+        for (uint8_t index = 0; index < PROTOCOL_COUNT; ++index)
+            states[index].state = IR_IDLE;
+        afterGap = true;
+        return;
+    }
+
+    for (uint8_t index = 0; index < PROTOCOL_COUNT; ++index) {
+        if (enabled & (1 << index))
+            step(index, mark, duration, time);
+    }
+    afterGap = false;
+}
+
+/**
+ * \brief Resets the state machines for all protocols, abandoning any
+ * partially received commands.
+ */
+void IRdecoder::reset()
+{
+    for (uint8_t index = 0; index < PROTOCOL_COUNT; ++index)
+        states[index].state = IR_IDLE;
+    afterGap = true;
+    ready = false;
+}
+
+/**
+ * \fn bool IRdecoder::available() const
+ * \brief Returns true if a command is available to be read with read().
+ */
+
+/**
+ * \brief Reads the next command from the decoder into \a code.
+ *
+ * Returns false if no command has been received since the last call.
+ * Only the most recent command is kept if read() is not called often
+ * enough.
+ */
+bool IRdecoder::read(IRcode *code)
+{
+    uint8_t sreg = SREG;
+    cli();
+    bool have = ready;
+    if (have) {
+        *code = result;
+        ready = false;
+    }
+    SREG = sreg;
+    return have;
+}
+
+/**
+ * \internal
+ * \brief Advances the state machine for \a protocol by one segment.
+ *
+ * \param protocol The index of the protocol.
+ * \param mark True if the segment was a mark, or false for a space.
+ * \param duration The length of the segment in microseconds.
+ * \param time The time at the end of the segment.
+ */
+void IRdecoder::step(uint8_t protocol, bool mark, unsigned long duration,
+                     unsigned long time)
+{
+    IRProtocol p;
+    memcpy_P(&p, &(protocols[protocol]), sizeof(p));
+    State *st = &(states[protocol]);
+
+    switch (st->state) {
+    case IR_IDLE:
+        if (p.headerMark) {
+            if (mark && match(duration, p.headerMark))
+                st->state = IR_HEADER_SPACE;
+            return;
+        }
+        if (!afterGap || !mark)
+            return;
+        // No header: the first half of the first bit was the idle space.
+        st->state = IR_DATA;
+        st->value = 0;
+        st->count = 0;
+        st->half = 1;
+        st->halfLeft = 0;
+        st->firstMark = false;
+        break;
+
+    case IR_HEADER_SPACE:
+        st->state = IR_IDLE;
+        if (mark)
+            return;
+        if (match(duration, p.headerSpace)) {
+            st->state = IR_DATA;
+            st->value = 0;
+            st->count = 0;
+            st->half = 0;
+            st->halfLeft = 0;
+        } else if (p.repeatSpace && match(duration, p.repeatSpace)) {
+            st->state = IR_REPEAT;
+        }
+        return;
+
+    case IR_REPEAT:
+        st->state = IR_IDLE;
+        if (mark && match(duration, p.zeroMark))
+            finish(protocol, st, true, time);
+        return;
+
+    case IR_DATA:
+        break;
+    }
+
+    if (p.encoding == IR_MANCHESTER) {
+        // Break the segment up into half-bit units.
+        uint8_t units = (uint8_t)((duration + p.unit / 2) / p.unit);
+        if (units == 0 || units > 4) {
+            st->state = IR_IDLE;
+            return;
+        }
+        while (units > 0) {
+            if (!st->halfLeft)
+                st->halfLeft = (st->count == p.longBit) ? 2 : 1;
+            uint8_t consume = (units < st->halfLeft) ? units : st->halfLeft;
+            units -= consume;
+            st->halfLeft -= consume;
+            if (st->halfLeft) {
+                // The level changed part-way through a half-bit.
+                st->state = IR_IDLE;
+                return;
+            }
+            if (st->half == 0) {
+                st->firstMark = mark;
+                st->half = 1;
+                if (mark && (st->count + 1) == p.bits) {
+                    // The final half of the frame is the idle space.
+                    st->value = (st->value << 1) |
+                                ((p.flags & IR_MARK_IS_ZERO) ? 0 : 1);
+                    finish(protocol, st, false, time);
+                    return;
+                }
+            } else {
+                if (st->firstMark == mark) {
+                    // Both halves at the same level is not a valid bit.
+                    st->state = IR_IDLE;
+                    return;
+                }
+                bool one = (st->firstMark != ((p.flags & IR_MARK_IS_ZERO) != 0));
+                st->value = (st->value << 1) | (one ? 1 : 0);
+                st->half = 0;
+                if (++(st->count) == p.bits) {
+                    finish(protocol, st, false, time);
+                    return;
+                }
+            }
+        }
+        return;
+    }
+
+    // Pulse distance and pulse width: alternating mark and space.
+    if (st->half == 0) {
+        if (!mark) {
+            st->state = IR_IDLE;
+            return;
+        }
+        if (p.encoding == IR_PULSE_DISTANCE) {
+            if (!match(duration, p.zeroMark)) {
+                st->state = IR_IDLE;
+            } else if (st->count == p.bits) {
+                // Stop mark after the last bit.
+                finish(protocol, st, false, time);
+            } else {
+                st->half = 1;
+            }
+            return;
+        }
+        uint8_t bit;
+        if (match(duration, p.zeroMark)) {
+            bit = 0;
+        } else if (match(duration, p.oneMark)) {
+            bit = 1;
+        } else {
+            st->state = IR_IDLE;
+            return;
+        }
+        if (p.flags & IR_LSB_FIRST)
+            st->value |= ((uint32_t)bit) << st->count;
+        else
+            st->value = (st->value << 1) | bit;
+        if (++(st->count) == p.bits)
+            finish(protocol, st, false, time);
+        else
+            st->half = 1;
+    } else {
+        if (mark) {
+            st->state = IR_IDLE;
+            return;
+        }
+        st->half = 0;
+        if (p.encoding == IR_PULSE_WIDTH) {
+            if (!match(duration, p.zeroSpace))
+                st->state = IR_IDLE;
+            return;
+        }
+        uint8_t bit;
+        if (match(duration, p.zeroSpace)) {
+            bit = 0;
+        } else if (match(duration, p.oneSpace)) {
+            bit = 1;
+        } else {
+            st->state = IR_IDLE;
+            return;
+        }
+        if (p.flags & IR_LSB_FIRST)
+            st->value |= ((uint32_t)bit) << st->count;
+        else
+            st->value = (st->value << 1) | bit;
+        ++(st->count);
+    }
+}
+
+/**
+ * \internal
+ * \brief Delivers the frame that was just completed for \a protocol.
+ */
+void IRdecoder::finish(uint8_t protocol, State *st, bool repeatCode,
+                       unsigned long time)
+{
+    IRProtocol p;
+    memcpy_P(&p, &(protocols[protocol]), sizeof(p));
+    st->state = IR_IDLE;
+
+    uint32_t value;
+    bool repeat;
+    if (repeatCode) {
+        // Repeat code for the last command that was received.
+        if (!st->haveLast || (time - st->lastTime) > IR_REPEAT_TIME)
+            return;
+        value = st->last;
+        repeat = true;
+    } else {
+        value = st->value;
+        if (p.flags & IR_CHECK_INVERTED) {
+            uint8_t cmd = (uint8_t)(value >> p.commandShift);
+            uint8_t inv = (uint8_t)(value >> (p.commandShift + 8));
+            if ((uint8_t)(cmd ^ inv) != 0xFF)
+                return;
+        }
+        if (!st->haveLast)
+            repeat = false;
+        else if (p.toggleBit != IR_NO_BIT)
+            repeat = (value == st->last);
+        else
+            repeat = (value == st->last) && (time - st->lastTime) <= IR_REPEAT_TIME;
+    }
+    st->last = value;
+    st->lastTime = time;
+    st->haveLast = true;
+
+    result.protocol = protocol;
+    result.repeat = repeat;
+    result.value = value;
+    result.address = (uint16_t)((value >> p.addressShift) &
+                                ((1UL << p.addressBits) - 1));
+    result.command = (uint16_t)((value >> p.commandShift) &
+                                ((1UL << p.commandBits) - 1));
+    ready = true;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IRdecoder_h
+#define IRdecoder_h
+
+#include <inttypes.h>
+
+struct IRcode
+{
+    uint8_t protocol;
+    bool repeat;
+    uint16_t address;
+    uint16_t command;
+    uint32_t value;
+};
+
+class IRdecoder
+{
+public:
+    IRdecoder();
+
+    enum Protocol
+    {
+        RC5,
+        RC6,
+        NEC,
+        SIRC
+    };
+
+    static const uint8_t PROTOCOL_COUNT = 4;
+
+    void enableProtocol(uint8_t protocol) { enabled |= (1 << protocol); }
+    void disableProtocol(uint8_t protocol) { enabled &= ~(1 << protocol); }
+    bool isProtocolEnabled(uint8_t protocol) const
+        { return (enabled & (1 << protocol)) != 0; }
+
+    void edge(bool value, unsigned long time);
+    void reset();
+
+    bool available() const { return ready; }
+    bool read(IRcode *code);
+
+private:
+    struct State
+    {
+        uint32_t value;
+        uint32_t last;
+        unsigned long lastTime;
+        uint8_t state;
+        uint8_t count;
+        uint8_t half;
+        uint8_t halfLeft;
+        bool firstMark;
+        bool haveLast;
+    };
+
+    State states[PROTOCOL_COUNT];
+    unsigned long lastEdge;
+    uint8_t enabled;
+    bool afterGap;
+    volatile bool ready;
+    IRcode result;
+
+    void step(uint8_t protocol, bool mark, unsigned long duration,
+              unsigned long time);
+    void finish(uint8_t protocol, State *st, bool repeatCode,
+                unsigned long time);
+};
+
+#endif
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IRlearner.h"
+#include "../I2C/EEPROM24.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class IRlearner IRlearner.h <IRlearner.h>
+ * \brief Learns raw infrared remote control codes so that they can be
+ * stored and replayed later.
+ *
+ * IRlearner records the timing of every mark and space in a frame from
+ * a remote control, whatever the protocol, so that it can be replayed
+ * with IRtransmitter.  This is useful for remote controls that are not
+ * understood by IRreceiver or IRdecoder.
+ *
+ * The learner is attached to an IRreceiver with IRreceiver::setLearner()
+ * and recording is started with start().  Once available() returns true,
+ * the frame is compressed with encode() into a compact byte string that
+ * can be saved in an EEPROM24 with save():
+ *
+ * \code
+ * IRreceiver ir;
+ * IRlearner learner;
+ * IRtransmitter irtx;
+ * uint8_t code[64];
+ *
+ * void setup() {
+ *     ir.setLearner(&learner);
+ *     irtx.begin();
+ *     learner.start();
+ * }
+ *
+ * void loop() {
+ *     if (learner.available()) {
+ *         if (learner.encode(code, sizeof(code)))
+ *             IRlearner::save(eeprom, 0, code);
+ *         learner.start();
+ *     }
+ *     ...
+ * }
+ * \endcode
+ *
+ * The encoded code can be passed to replay() later to transmit it again.
+ *
+ * \section ir_learn_format Encoded format
+ *
+ * Remote control protocols use timings that are small multiples of a
+ * basic time unit, such as 889 microseconds for RC-5 or 560 microseconds
+ * for NEC.  encode() estimates the unit from the shortest marks and spaces
+ * in the frame and quantizes every duration to a whole number of units.
+ * Most durations are then between 1 and 15 units and are stored in a
+ * single 4-bit nibble:
+ *
+ * \li Byte 0 is the total length of the encoded code in bytes.
+ * \li Bytes 1 and 2 are the time unit in microseconds, low byte first.
+ * \li Byte 3 is the number of marks and spaces.
+ * \li The remaining bytes are nibbles, high nibble first, one per mark or
+ * space.  A zero nibble is an escape that is followed by two more nibbles
+ * with an 8-bit number of units, for durations up to 255 units.
+ *
+ * A 32-bit NEC frame encodes into 39 bytes and an RC-5 frame into at most
+ * 18 bytes, so hundreds of codes will fit into a 32K EEPROM.
+ *
+ * \sa IRtransmitter, IRreceiver::setLearner()
+ */
+
+// A space that is longer than this ends the recording, in microseconds.
+#define IR_LEARN_GAP        20000UL
+
+#define IR_LEARN_HEADER     4
+
+static void putNibble(uint8_t *data, unsigned nibble, uint8_t value)
+{
+    if (nibble & 1)
+        data[nibble / 2] |= value;
+    else
+        data[nibble / 2] = value << 4;
+}
+
+static uint8_t getNibble(const uint8_t *data, unsigned nibble)
+{
+    if (nibble & 1)
+        return data[nibble / 2] & 0x0F;
+    else
+        return data[nibble / 2] >> 4;
+}
+
+/**
+ * \brief Constructs a new infrared learner that is not recording.
+ */
+IRlearner::IRlearner()
+    : recording(false)
+    , complete(false)
+    , started(false)
+    , count(0)
+    , lastEdge(0)
+    , lastSeen(0)
+{
+}
+
+/**
+ * \brief Starts recording the next frame from the remote control,
+ * discarding the previous recording.
+ *
+ * \sa stop(), available()
+ */
+void IRlearner::start()
+{
+    uint8_t sreg = SREG;
+    cli();
+    count = 0;
+    started = false;
+    complete = false;
+    recording = true;
+    SREG = sreg;
+}
+
+/**
+ * \brief Stops recording without waiting for a frame.
+ *
+ * \sa start()
+ */
+void IRlearner::stop()
+{
+    recording = false;
+}
+
+/**
+ * \fn bool IRlearner::isRecording() const
+ * \brief Returns true if the learner is waiting for or recording a frame.
+ */
+
+/**
+ * \brief Returns true if a complete frame has been recorded and can be
+ * retrieved with encode().
+ *
+ * The frame is complete once the line has been idle for 20 milliseconds
+ * after the last mark.
+ */
+bool IRlearner::available()
+{
+    if (recording && count) {
+        uint8_t sreg = SREG;
+        cli();
+        if ((micros() - lastSeen) > IR_LEARN_GAP) {
+            recording = false;
+            complete = true;
+        }
+        SREG = sreg;
+    }
+    return complete;
+}
+
+/**
+ * \brief Processes an edge from the infrared receiver.
+ *
+ * \param value The new level of the receiver's output after the edge,
+ * where LOW indicates the start of a mark.
+ * \param time The time of the edge in microseconds.
+ *
+ * IRreceiver calls this function automatically for each edge once the
+ * learner has been attached with IRreceiver::setLearner().
+ */
+void IRlearner::edge(bool value, unsigned long time)
+{
+    if (!recording)
+        return;
+    lastSeen = micros();
+    if (!started) {
+        // Wait for the first mark to start.
+        if (!value) {
+            started = true;
+            lastEdge = time;
+        }
+        return;
+    }
+    unsigned long duration = time - lastEdge;
+    lastEdge = time;
+    if (duration > IR_LEARN_GAP || count >= IR_TRANSMIT_MAX_SEGMENTS) {
+        // The start of another frame, or we have run out of room.
+        recording = false;
+        complete = true;
+        return;
+    }
+    segments[count] = duration < 0xFFFFU ? (uint16_t)duration : 0xFFFFU;
+    ++count;
+}
+
+/**
+ * \brief Compresses the recorded frame into \a data.
+ *
+ * \param data The buffer to write the encoded code to.
+ * \param maxLength The maximum number of bytes to write to \a data.
+ *
+ * \return Returns the length of the encoded code, or zero if there is
+ * no complete frame or it does not fit into \a maxLength bytes.
+ *
+ * \sa \ref ir_learn_format "Encoded format", length(), replay()
+ */
+uint8_t IRlearner::encode(uint8_t *data, uint8_t maxLength) const
+{
+    // A frame ends with a mark, so ignore a trailing space that may
+    // be left when the recording was truncated.
+    uint8_t num = count;
+    if (!complete || !num)
+        return 0;
+    if (!(num & 1))
+        --num;
+
+    // Estimate the time unit as the average of the shortest durations.
+    uint16_t shortest = 0xFFFFU;
+    uint8_t posn;
+    for (posn = 0; posn < num; ++posn) {
+        if (segments[posn] < shortest)
+            shortest = segments[posn];
+    }
+    uint32_t limit = ((uint32_t)shortest) * 3 / 2;
+    uint32_t total = 0;
+    uint8_t matches = 0;
+    for (posn = 0; posn < num; ++posn) {
+        if (segments[posn] <= limit) {
+            total += segments[posn];
+            ++matches;
+        }
+    }
+    uint16_t unit = (uint16_t)(total / matches);
+    if (!unit)
+        unit = 1;
+
+    // Quantize the durations and pack them into nibbles.
+    if (maxLength < IR_LEARN_HEADER)
+        return 0;
+    data[1] = (uint8_t)unit;
+    data[2] = (uint8_t)(unit >> 8);
+    data[3] = num;
+    unsigned nibble = IR_LEARN_HEADER * 2;
+    for (posn = 0; posn < num; ++posn) {
+        uint32_t units = (segments[posn] + unit / 2) / unit;
+        if (!units)
+            units = 1;
+        else if (units > 255)
+            units = 255;
+        uint8_t nibbles = (units < 16) ? 1 : 3;
+        if ((nibble + nibbles + 1) / 2 > maxLength)
+            return 0;
+        if (nibbles == 3) {
+            putNibble(data, nibble++, 0);
+            putNibble(data, nibble++, (uint8_t)(units >> 4));
+        }
+        putNibble(data, nibble++, (uint8_t)(units & 0x0F));
+    }
+    uint8_t len = (uint8_t)((nibble + 1) / 2);
+    data[0] = len;
+    return len;
+}
+
+/**
+ * \fn uint8_t IRlearner::length(const uint8_t *data)
+ * \brief Returns the length in bytes of the encoded code in \a data.
+ */
+
+/**
+ * \brief Replays an encoded code from \a data on \a transmitter.
+ *
+ * \return Returns false if the transmitter is busy or \a data is not
+ * a valid code.
+ *
+ * The transmitter must already have been started with the carrier
+ * frequency of the remote control, which cannot be learnt from a
+ * demodulating receiver.  Most remote controls use 36 or 38 kHz.
+ *
+ * \sa encode()
+ */
+bool IRlearner::replay(IRtransmitter &transmitter, const uint8_t *data)
+{
+    uint8_t len = data[0];
+    uint8_t num = data[3];
+    uint16_t unit = data[1] | (((uint16_t)data[2]) << 8);
+    if (len < IR_LEARN_HEADER || num > IR_TRANSMIT_MAX_SEGMENTS)
+        return false;
+
+    uint16_t timings[IR_TRANSMIT_MAX_SEGMENTS];
+    unsigned nibble = IR_LEARN_HEADER * 2;
+    unsigned end = len * 2;
+    for (uint8_t posn = 0; posn < num; ++posn) {
+        if (nibble >= end)
+            return false;
+        uint8_t value = getNibble(data, nibble++);
+        if (!value) {
+            // Escape: the number of units is in the next two nibbles.
+            if ((nibble + 2) > end)
+                return false;
+            value = getNibble(data, nibble++) << 4;
+            value |= getNibble(data, nibble++);
+        }
+        uint32_t duration = ((uint32_t)value) * unit;
+        timings[posn] = duration < 0xFFFFU ? (uint16_t)duration : 0xFFFFU;
+    }
+    return transmitter.sendRaw(timings, num);
+}
+
+/**
+ * \brief Saves the encoded code in \a data to \a eeprom at \a address.
+ *
+ * \return Returns true if the code was written.
+ *
+ * \sa load()
+ */
+bool IRlearner::save(EEPROM24 &eeprom, unsigned long address,
+                     const uint8_t *data)
+{
+    uint8_t len = data[0];
+    return eeprom.write(address, data, len) == len;
+}
+
+/**
+ * \brief Loads an encoded code from \a eeprom at \a address into \a data.
+ *
+ * \param eeprom The EEPROM to load from.
+ * \param address The address of the code in the EEPROM.
+ * \param data The buffer to load the code into.
+ * \param maxLength The size of \a data in bytes.
+ *
+ * \return Returns the length of the code, or zero if there is no valid
+ * code at \a address or it is larger than \a maxLength.
+ *
+ * \sa save(), replay()
+ */
+uint8_t IRlearner::load(EEPROM24 &eeprom, unsigned long address,
+                        uint8_t *data, uint8_t maxLength)
+{
+    uint8_t len = eeprom.read(address);
+    if (len < IR_LEARN_HEADER || len == 0xFF || len > maxLength)
+        return 0;
+    if (eeprom.read(address, data, len) != len)
+        return 0;
+    return len;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IRlearner_h
+#define IRlearner_h
+
+#include <inttypes.h>
+#include "IRtransmitter.h"
+
+class EEPROM24;
+
+class IRlearner
+{
+public:
+    IRlearner();
+
+    void start();
+    void stop();
+    bool isRecording() const { return recording; }
+    bool available();
+
+    void edge(bool value, unsigned long time);
+
+    uint8_t encode(uint8_t *data, uint8_t maxLength) const;
+
+    static uint8_t length(const uint8_t *data) { return data[0]; }
+    static bool replay(IRtransmitter &transmitter, const uint8_t *data);
+
+    static bool save(EEPROM24 &eeprom, unsigned long address,
+                     const uint8_t *data);
+    static uint8_t load(EEPROM24 &eeprom, unsigned long address,
+                        uint8_t *data, uint8_t maxLength);
+
+private:
+    volatile bool recording;
+    volatile bool complete;
+    bool started;
+    volatile uint8_t count;
+    unsigned long lastEdge;
+    volatile unsigned long lastSeen;
+    uint16_t segments[IR_TRANSMIT_MAX_SEGMENTS];
+};
+
+#endif
@@ -21,11 +21,17 @@
  */
 
 #include "IRreceiver.h"
+#include "IRdecoder.h"
+#include "IRlearner.h"
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
 #include <WProgram.h>
 #endif
+#include <stdlib.h>
+#if ISR_PROFILER
+#include <ISRProfiler.h>
+#endif
 
 /**
  * \class IRreceiver IRreceiver.h <IRreceiver.h>
@@ -60,10 +66,15 @@
  * IRreceiver ir(1);    // Interrupt 1 on pin D3
  * \endcode
  *
- * Currently this class can only handle a single instance of IRreceiver being
- * active in the application.  It isn't possible to have separate IRreceiver
- * instances on different pins.  Usually this won't be a problem because
- * the same receiver can process inputs from multiple remotes.
+ * Separate IRreceiver instances can be created on different interrupt
+ * pins, up to one per external interrupt.  Usually this won't be necessary
+ * because the same receiver can process inputs from multiple remotes.
+ *
+ * Received commands are placed into a small queue that holds up to
+ * \c IR_COMMAND_QUEUE_SIZE commands (4 by default) so that commands that
+ * arrive in quick succession are not lost if command() is not called
+ * in time.  If the queue fills up, then newer commands are discarded
+ * until the application catches up.
  *
  * The application retrieves incoming infrared commands by calling the
  * command() function.  The return value indicates the type of command:
@@ -153,37 +164,144 @@
  * The complete list of RC-5 system numbers and command codes is given in
  * the RC5.h header file.
  *
+ * \section ir_capture Input capture mode
+ *
+ * By default, the receiver decodes the signal inside a pin change
+ * interrupt using <tt>micros()</tt> to time the edges.  Other interrupt
+ * handlers, such as the DMD refresh, delay that interrupt and add jitter
+ * to the timing.  Input capture mode instead uses Timer1 to timestamp the
+ * edges in hardware on the ICP1 pin (D8 on the Arduino Uno).  The
+ * interrupt handler only stores the edge times in a ring buffer and the
+ * decoding is done later by command():
+ *
+ * \code
+ * IRreceiver ir(IRreceiver::INPUT_CAPTURE);
+ *
+ * ISR(TIMER1_CAPT_vect)
+ * {
+ *     ir.handleCapture();
+ * }
+ * \endcode
+ *
+ * The ring buffer holds \c IR_CAPTURE_BUFFER_SIZE edges, which is enough
+ * for one complete RC-5 command, so command() should be called at least
+ * every 25 milliseconds or so.  Timer1 cannot be used for anything else,
+ * such as DMD::enableTimer1(), while input capture mode is in use.
+ *
  * \sa \ref ir_dumpir "DumpIR Example"
  */
 
-static IRreceiver *receiver = 0;
+#define IR_MAX_INTERRUPTS   6
+
+static IRreceiver *receivers[IR_MAX_INTERRUPTS] = {0};
 
-void _IR_receive_interrupt(void)
+void _IR_receive_interrupt(uint8_t index)
 {
-    receiver->handleInterrupt();
+#if ISR_PROFILER
+    ISR_PROFILE(ISR_SLOT_IR);
+#endif
+    IRreceiver *receiver = receivers[index];
+    if (receiver)
+        receiver->handleInterrupt();
 }
 
+static void _IR_receive_interrupt0(void) { _IR_receive_interrupt(0); }
+static void _IR_receive_interrupt1(void) { _IR_receive_interrupt(1); }
+static void _IR_receive_interrupt2(void) { _IR_receive_interrupt(2); }
+static void _IR_receive_interrupt3(void) { _IR_receive_interrupt(3); }
+static void _IR_receive_interrupt4(void) { _IR_receive_interrupt(4); }
+static void _IR_receive_interrupt5(void) { _IR_receive_interrupt(5); }
+
+static void (* const receiveHandlers[IR_MAX_INTERRUPTS])(void) = {
+    _IR_receive_interrupt0,
+    _IR_receive_interrupt1,
+    _IR_receive_interrupt2,
+    _IR_receive_interrupt3,
+    _IR_receive_interrupt4,
+    _IR_receive_interrupt5
+};
+
 /**
  * \var IRreceiver::AUTO_REPEAT
  * \brief Flag that is added to the output of command() when the command
  * is an auto-repeated button press rather than the original button press.
  */
 
+/**
+ * \var IRreceiver::INPUT_CAPTURE
+ * \brief Interrupt number to pass to the constructor to receive on the
+ * Timer1 input capture pin instead of an external interrupt pin.
+ *
+ * \sa handleCapture()
+ */
+
+/**
+ * \brief Number of edges in the ring buffer for input capture mode;
+ * must be a power of two.
+ */
+#if !defined(IR_CAPTURE_BUFFER_SIZE)
+#define IR_CAPTURE_BUFFER_SIZE  32
+#endif
+
+// Timer1 runs at F_CPU / 64 in input capture mode.
+#define IR_CAPTURE_TICK_US      (64 / (F_CPU / 1000000UL))
+
+// Entries in the ring buffer hold the number of timer ticks since the
+// previous edge, with the top bit set for a rising edge.
+#define IR_CAPTURE_RISING       0x8000
+#define IR_CAPTURE_MAX_DELTA    0x7FFF
+
+#if (IR_COMMAND_QUEUE_SIZE & (IR_COMMAND_QUEUE_SIZE - 1)) != 0 || \
+        IR_COMMAND_QUEUE_SIZE > 128
+#error "IR_COMMAND_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
 /**
  * \brief Constructs a new infrared remote control receiver that is attached
  * to \a interruptNumber.
+ *
+ * If another receiver is already attached to \a interruptNumber, then
+ * this receiver replaces it.
  */
 IRreceiver::IRreceiver(int interruptNumber)
     : _system(0)
     , _systemFilter(-1)
+    , _time(0)
+    , interrupt(-1)
     , started(false)
     , halfChange(false)
     , lastChange(0)
     , bits(0)
     , bitCount(0)
-    , buffer(0)
+    , queueHead(0)
+    , queueTail(0)
     , lastBuffer(0)
+    , captureBuffer(0)
+    , captureHead(0)
+    , captureTail(0)
+    , lastCapture(0)
+    , captureTime(0)
+    , _decoder(0)
+    , _learner(0)
 {
+    if (interruptNumber == INPUT_CAPTURE) {
+        captureBuffer = (uint16_t *)malloc(IR_CAPTURE_BUFFER_SIZE * sizeof(uint16_t));
+        pin = 8;
+        pinMode(pin, INPUT);
+
+        // Run Timer1 freely at F_CPU / 64 with the noise canceler on and
+        // capture the first falling edge, which starts a pulse.
+        uint8_t sreg = SREG;
+        cli();
+        TCCR1A = 0;
+        TCCR1B = _BV(ICNC1) | _BV(CS11) | _BV(CS10);
+        TIFR1 = _BV(ICF1) | _BV(TOV1);
+        TIMSK1 = _BV(ICIE1);
+        SREG = sreg;
+        return;
+    }
+    if (interruptNumber < 0 || interruptNumber >= IR_MAX_INTERRUPTS)
+        interruptNumber = 0;
     switch (interruptNumber) {
     case 0: default:    pin = 2; break;
     case 1:             pin = 3; break;
@@ -192,8 +310,28 @@ IRreceiver::IRreceiver(int interruptNumber)
     case 4:             pin = 19; break;    // Arduino Mega only
     case 5:             pin = 18; break;    // Arduino Mega only
     }
-    receiver = this;
-    attachInterrupt(interruptNumber, _IR_receive_interrupt, CHANGE);
+    interrupt = interruptNumber;
+    receivers[interruptNumber] = this;
+    attachInterrupt(interruptNumber, receiveHandlers[interruptNumber], CHANGE);
+}
+
+/**
+ * \brief Destroys this infrared remote control receiver and detaches it
+ * from its interrupt.
+ */
+IRreceiver::~IRreceiver()
+{
+    if (captureBuffer) {
+        uint8_t sreg = SREG;
+        cli();
+        TIMSK1 = 0;
+        TCCR1B = 0;
+        SREG = sreg;
+        free(captureBuffer);
+    } else if (interrupt >= 0 && receivers[interrupt] == this) {
+        detachInterrupt(interrupt);
+        receivers[interrupt] = 0;
+    }
 }
 
 /**
@@ -210,28 +348,45 @@ IRreceiver::IRreceiver(int interruptNumber)
  * out commands from all but a specific system.
  *
  * The next call to command() will return -1 or the code for the next
- * button press.
+ * button press.  If several commands were received since the last call,
+ * they are returned one at a time in the order they arrived, and
+ * commandTime() reports when each was received.
  *
  * The header file <tt>RC5.h</tt> contains a list of command codes for
  * common remote controls.
  *
- * \sa system(), setSystemFilter()
+ * \sa system(), commandTime(), pending(), setSystemFilter()
  */
 int IRreceiver::command()
 {
     unsigned buf;
 
-    // Read the last-delivered sequence from the buffer and clear it.
-    cli();
-    buf = buffer;
-    buffer = 0;
-    sei();
+    // Decode the edges that were captured since the last call.
+    if (captureBuffer) {
+        uint8_t head = captureHead;
+        while (captureTail != head) {
+            uint16_t entry = captureBuffer[captureTail];
+            captureTail = (captureTail + 1) & (IR_CAPTURE_BUFFER_SIZE - 1);
+            captureTime += ((unsigned long)(entry & IR_CAPTURE_MAX_DELTA)) *
+                           IR_CAPTURE_TICK_US;
+            decode((entry & IR_CAPTURE_RISING) != 0, captureTime);
+        }
+    }
 
-    // Bail out if no sequence or it is not for us.
-    if (!buf) {
+    // Pop the oldest sequence from the queue.  Only the interrupt handler
+    // modifies queueHead and only we modify queueTail.  Both count freely
+    // and are masked when the arrays are indexed, so that all entries of
+    // the queue can be used.
+    uint8_t tail = queueTail;
+    if (tail == queueHead) {
         _system = -1;
         return -1;
     }
+    buf = queueBits[tail & (IR_COMMAND_QUEUE_SIZE - 1)];
+    _time = queueTime[tail & (IR_COMMAND_QUEUE_SIZE - 1)];
+    queueTail = tail + 1;
+
+    // Bail out if the sequence is not for us.
     if (_systemFilter != -1) {
         if (((buf >> 6) & 0x1F) != _systemFilter) {
             _system = -1;
@@ -269,6 +424,32 @@ int IRreceiver::command()
  * \sa command(), setSystemFilter()
  */
 
+/**
+ * \fn unsigned long IRreceiver::commandTime() const
+ * \brief Returns the value of millis() when the previous command() was
+ * received by the interrupt handler.
+ *
+ * In \ref ir_capture "input capture mode" commands are decoded by
+ * command() itself, so the time is when the edges were processed rather
+ * than when they arrived.
+ *
+ * \sa command(), pending()
+ */
+
+/**
+ * \brief Returns the number of commands that are waiting in the queue
+ * to be returned by command().
+ *
+ * In \ref ir_capture "input capture mode" this does not include
+ * commands whose edges have been captured but not yet decoded.
+ *
+ * \sa command()
+ */
+int IRreceiver::pending() const
+{
+    return (uint8_t)(queueHead - queueTail);
+}
+
 /**
  * \fn int IRreceiver::systemFilter() const
  * \brief Returns the system to filter commands against, or -1 if no
@@ -301,6 +482,47 @@ int IRreceiver::command()
  * \sa systemFilter(), system(), command()
  */
 
+/**
+ * \fn IRdecoder *IRreceiver::decoder() const
+ * \brief Returns the multi-protocol decoder that is attached to this
+ * receiver, or NULL if none.
+ *
+ * \sa setDecoder()
+ */
+
+/**
+ * \fn void IRreceiver::setDecoder(IRdecoder *decoder)
+ * \brief Attaches a multi-protocol \a decoder to this receiver.
+ *
+ * Every edge that is seen by the receiver is passed to IRdecoder::edge()
+ * in addition to the built-in RC-5 decoder.  In input capture mode the
+ * edges are passed on from command(), so command() must be called
+ * regularly even if only the IRdecoder results are of interest.
+ * Otherwise the decoder runs in interrupt context.
+ *
+ * Set \a decoder to NULL to detach the decoder.
+ *
+ * \sa decoder(), IRdecoder
+ */
+
+/**
+ * \fn IRlearner *IRreceiver::learner() const
+ * \brief Returns the raw code learner that is attached to this receiver,
+ * or NULL if none.
+ *
+ * \sa setLearner()
+ */
+
+/**
+ * \fn void IRreceiver::setLearner(IRlearner *learner)
+ * \brief Attaches a raw code \a learner to this receiver.
+ *
+ * Every edge that is seen by the receiver is passed to IRlearner::edge().
+ * Set \a learner to NULL to detach the learner.
+ *
+ * \sa learner(), IRlearner
+ */
+
 // Number of microseconds that the signal is HIGH or LOW for
 // indicating a bit.  A 1 bit is transmitted as LOW for 889us
 // followed by HIGH for 889us.  A 0 bit is HIGH, then LOW.
@@ -316,11 +538,57 @@ int IRreceiver::command()
 // within this time, then we have lost sync and need to restart.
 #define IR_MAX_TIME (IR_BIT_TIME * 4)
 
-// Protocol details from http://en.wikipedia.org/wiki/RC-5
+/**
+ * \brief Handles a Timer1 input capture event in input capture mode;
+ * must be called from the <tt>TIMER1_CAPT_vect</tt> interrupt handler.
+ *
+ * \sa \ref ir_capture "Input capture mode"
+ */
+void IRreceiver::handleCapture()
+{
+    uint16_t time = ICR1;
+    bool rising = (TCCR1B & _BV(ICES1)) != 0;
+
+    // Capture the opposite edge next.  Changing the edge can set the
+    // capture flag, so clear it afterwards.
+    TCCR1B ^= _BV(ICES1);
+    TIFR1 = _BV(ICF1);
+
+    // If the timer has overflowed and come back past the previous capture,
+    // then it has been a long time since the last edge.
+    uint16_t delta = time - lastCapture;
+    if (TIFR1 & _BV(TOV1)) {
+        TIFR1 = _BV(TOV1);
+        if (time >= lastCapture)
+            delta = IR_CAPTURE_MAX_DELTA;
+    }
+    if (delta > IR_CAPTURE_MAX_DELTA)
+        delta = IR_CAPTURE_MAX_DELTA;
+    lastCapture = time;
+
+    // Add the edge to the ring buffer, dropping it if the buffer is full.
+    if (!captureBuffer)
+        return;
+    uint8_t head = captureHead;
+    uint8_t next = (head + 1) & (IR_CAPTURE_BUFFER_SIZE - 1);
+    if (next != captureTail) {
+        captureBuffer[head] = delta | (rising ? IR_CAPTURE_RISING : 0);
+        captureHead = next;
+    }
+}
+
 void IRreceiver::handleInterrupt()
 {
-    bool value = digitalRead(pin);
-    unsigned long currentTime = micros();
+    decode(digitalRead(pin), micros());
+}
+
+// Protocol details from http://en.wikipedia.org/wiki/RC-5
+void IRreceiver::decode(bool value, unsigned long currentTime)
+{
+    if (_decoder)
+        _decoder->edge(value, currentTime);
+    if (_learner)
+        _learner->edge(value, currentTime);
     if (!value) {
         // Rising edge (input is active-LOW)
         if (started && (currentTime - lastChange) > IR_MAX_TIME) {
@@ -366,8 +634,14 @@ void IRreceiver::handleInterrupt()
         --bitCount;
         if (bitCount <= 0) {
             // All 14 bits have been received, so deliver the value.
+            // Drop it if the queue is full.
             started = false;
-            buffer = bits;
+            uint8_t head = queueHead;
+            if ((uint8_t)(head - queueTail) < IR_COMMAND_QUEUE_SIZE) {
+                queueBits[head & (IR_COMMAND_QUEUE_SIZE - 1)] = bits;
+                queueTime[head & (IR_COMMAND_QUEUE_SIZE - 1)] = millis();
+                queueHead = head + 1;
+            }
         }
     }
 }
@@ -26,34 +26,68 @@
 #include <inttypes.h>
 #include "RC5.h"
 
+class IRdecoder;
+class IRlearner;
+
+// Number of commands that the queue can hold; must be a power of two
+// no larger than 128.
+#if !defined(IR_COMMAND_QUEUE_SIZE)
+#define IR_COMMAND_QUEUE_SIZE   4
+#endif
+
 class IRreceiver
 {
 public:
     explicit IRreceiver(int interruptNumber = 0);
+    ~IRreceiver();
 
     static const int AUTO_REPEAT = 128;
+    static const int INPUT_CAPTURE = -1;
 
     int command();
     int system() const { return _system; }
+    unsigned long commandTime() const { return _time; }
+    int pending() const;
 
     int systemFilter() const { return _systemFilter; }
     void setSystemFilter(int system) { _systemFilter = system; }
 
+    void handleCapture();
+
+    IRdecoder *decoder() const { return _decoder; }
+    void setDecoder(IRdecoder *decoder) { _decoder = decoder; }
+
+    IRlearner *learner() const { return _learner; }
+    void setLearner(IRlearner *learner) { _learner = learner; }
+
 private:
     int _system;
     int _systemFilter;
+    unsigned long _time;
     uint8_t pin;
+    int8_t interrupt;
     bool started;
     bool halfChange;    // Value last changed half-way through bit cycle time.
     unsigned long lastChange;
     unsigned bits;
     int8_t bitCount;
-    volatile unsigned buffer;
+    unsigned queueBits[IR_COMMAND_QUEUE_SIZE];
+    unsigned long queueTime[IR_COMMAND_QUEUE_SIZE];
+    volatile uint8_t queueHead;
+    volatile uint8_t queueTail;
     unsigned lastBuffer;
+    uint16_t *captureBuffer;
+    volatile uint8_t captureHead;
+    uint8_t captureTail;
+    uint16_t lastCapture;
+    unsigned long captureTime;
+    IRdecoder *_decoder;
+    IRlearner *_learner;
 
     void handleInterrupt();
+    void decode(bool value, unsigned long currentTime);
 
-    friend void _IR_receive_interrupt(void);
+    friend void _IR_receive_interrupt(uint8_t index);
 };
 
 #endif
@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IRtransmitter.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class IRtransmitter IRtransmitter.h <IRtransmitter.h>
+ * \brief Transmits infrared remote control commands without blocking
+ * the CPU.
+ *
+ * IRtransmitter drives an infrared LED with a modulated carrier to send
+ * commands in the Philips RC-5 and NEC protocols, or arbitrary mark/space
+ * timings.  Each frame is first encoded into a table of mark and space
+ * durations and then played out in the background, so the application
+ * can keep refreshing a DMD display or talking to a radio while the
+ * frame is sent.
+ *
+ * On AVR-based Arduino boards the carrier is generated by Timer2 in
+ * fast PWM mode on the OC2B pin, which is D3 on the Arduino Uno and D9 on
+ * the Arduino Mega.  The LED should be connected to that pin through a
+ * suitable transistor driver.  The timer overflows once per carrier cycle
+ * and the overflow interrupt counts off the cycles in each mark and space.
+ * The application must call handleTimer() from the interrupt handler:
+ *
+ * \code
+ * #include <IRtransmitter.h>
+ * #include <RC5.h>
+ *
+ * IRtransmitter irtx;
+ *
+ * ISR(TIMER2_OVF_vect)
+ * {
+ *     irtx.handleTimer();
+ * }
+ *
+ * void setup() {
+ *     irtx.begin(IRtransmitter::CARRIER_RC5);
+ * }
+ *
+ * void loop() {
+ *     if (!irtx.isBusy())
+ *         irtx.sendRC5(RC5_SYS_TV, RC5_INC_VOLUME);
+ *     ...
+ * }
+ * \endcode
+ *
+ * Timer2 cannot be used for anything else, such as DMD::enableTimer2(),
+ * while the transmitter is in use.
+ *
+ * On ESP32 boards the carrier and the frame timing are generated by
+ * the RMT peripheral instead, and handleTimer() does not need to be called.
+ * The output pin and RMT channel are passed to begin().
+ *
+ * The sender is responsible for the gap between frames.  RC-5 frames
+ * should be repeated every 114 milliseconds while a button is held down,
+ * and NEC repeat codes every 108 milliseconds.
+ *
+ * \sa IRreceiver
+ */
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define IR_TRANSMIT_PIN     9
+#else
+#define IR_TRANSMIT_PIN     3
+#endif
+
+// Timer2 runs at F_CPU / 8 to generate the carrier.
+#define IR_TIMER_PRESCALE   8
+
+// RC-5 half-bit time in microseconds.
+#define IR_RC5_UNIT         889
+
+// NEC timings in microseconds.
+#define IR_NEC_HEADER_MARK  9000
+#define IR_NEC_HEADER_SPACE 4500
+#define IR_NEC_REPEAT_SPACE 2250
+#define IR_NEC_MARK         560
+#define IR_NEC_ZERO_SPACE   560
+#define IR_NEC_ONE_SPACE    1690
+
+/**
+ * \var IRtransmitter::CARRIER_RC5
+ * \brief Carrier frequency of 36 kHz that is used by RC-5 remote controls.
+ */
+
+/**
+ * \var IRtransmitter::CARRIER_NEC
+ * \brief Carrier frequency of 38 kHz that is used by NEC remote controls.
+ */
+
+/**
+ * \brief Constructs a new infrared transmitter.
+ *
+ * \sa begin()
+ */
+IRtransmitter::IRtransmitter()
+    : _carrier(CARRIER_NEC)
+    , count(0)
+    , toggle(false)
+    , overflow(false)
+#if defined(ARDUINO_ARCH_ESP32)
+    , channel(RMT_CHANNEL_0)
+#else
+    , busy(false)
+    , index(0)
+    , remaining(0)
+#endif
+{
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+/**
+ * \brief Starts the transmitter on \a pin with a \a carrier frequency in Hz,
+ * using RMT \a channel.
+ *
+ * \sa end()
+ */
+void IRtransmitter::begin(uint8_t pin, unsigned int carrier,
+                          rmt_channel_t channel)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, channel);
+    config.clk_div = 80;    // 1 microsecond per tick.
+    config.tx_config.carrier_en = true;
+    config.tx_config.carrier_freq_hz = carrier;
+    config.tx_config.carrier_duty_percent = 33;
+    config.tx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    rmt_config(&config);
+    rmt_driver_install(channel, 0, 0);
+    this->channel = channel;
+    _carrier = carrier;
+}
+
+/**
+ * \brief Stops the transmitter and releases the RMT channel.
+ *
+ * \sa begin()
+ */
+void IRtransmitter::end()
+{
+    rmt_driver_uninstall(channel);
+}
+
+#else
+
+/**
+ * \brief Starts the transmitter with a \a carrier frequency in Hz.
+ *
+ * The carrier is generated on the OC2B pin with a 33% duty cycle.
+ *
+ * \sa end()
+ */
+void IRtransmitter::begin(unsigned int carrier)
+{
+    _carrier = carrier;
+    pinMode(IR_TRANSMIT_PIN, OUTPUT);
+    digitalWrite(IR_TRANSMIT_PIN, LOW);
+
+    // Fast PWM with OCR2A as TOP, OC2B disconnected until a mark is sent.
+    uint8_t top = (uint8_t)(((F_CPU / IR_TIMER_PRESCALE) + carrier / 2) /
+                            carrier - 1);
+    uint8_t sreg = SREG;
+    cli();
+    TIMSK2 &= ~_BV(TOIE2);
+    TCCR2A = _BV(WGM21) | _BV(WGM20);
+    TCCR2B = _BV(WGM22) | _BV(CS21);
+    OCR2A = top;
+    OCR2B = top / 3;
+    SREG = sreg;
+    busy = false;
+}
+
+/**
+ * \brief Stops the transmitter and releases Timer2.
+ *
+ * Any frame that is currently being transmitted is abandoned.
+ *
+ * \sa begin()
+ */
+void IRtransmitter::end()
+{
+    uint8_t sreg = SREG;
+    cli();
+    TIMSK2 &= ~_BV(TOIE2);
+    TCCR2A = 0;
+    TCCR2B = 0;
+    busy = false;
+    SREG = sreg;
+    digitalWrite(IR_TRANSMIT_PIN, LOW);
+}
+
+#endif
+
+/**
+ * \fn unsigned int IRtransmitter::carrier() const
+ * \brief Returns the carrier frequency in Hz that was passed to begin().
+ */
+
+/**
+ * \brief Returns true if a frame is still being transmitted.
+ *
+ * The send functions will fail while the transmitter is busy.
+ */
+bool IRtransmitter::isBusy() const
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    return count != 0 && rmt_wait_tx_done(channel, 0) != ESP_OK;
+#else
+    return busy;
+#endif
+}
+
+/**
+ * \brief Sends an RC-5 command.
+ *
+ * \param system The system number between 0 and 31, from RC5.h.
+ * \param command The command number between 0 and 127, from RC5.h.
+ * \param repeat Set to true if this is an auto-repeat of the previous
+ * command because the button is still held down; false for a new
+ * button press.
+ *
+ * \return Returns false if the transmitter is busy with another frame.
+ *
+ * The toggle bit in the frame is flipped for each new button press so
+ * that the receiver can tell a new press from an auto-repeat.
+ */
+bool IRtransmitter::sendRC5(uint8_t system, uint8_t command, bool repeat)
+{
+    if (isBusy())
+        return false;
+    if (!repeat)
+        toggle = !toggle;
+
+    // S1, S2 (inverse of command bit 6), toggle, 5 system bits, 6 command bits.
+    uint16_t bits = 0x2000 | ((command & 0x40) ? 0 : 0x1000) |
+                    (toggle ? 0x0800 : 0) | ((system & 0x1F) << 6) |
+                    (command & 0x3F);
+    clear();
+    for (uint16_t mask = 0x2000; mask != 0; mask >>= 1) {
+        if (bits & mask) {
+            // 1 bit: space then mark.  The first space is the idle line.
+            if (mask != 0x2000)
+                space(IR_RC5_UNIT);
+            mark(IR_RC5_UNIT);
+        } else {
+            // 0 bit: mark then space.
+            mark(IR_RC5_UNIT);
+            space(IR_RC5_UNIT);
+        }
+    }
+    return start();
+}
+
+/**
+ * \brief Sends a NEC command.
+ *
+ * \param address The 16-bit address, sent low byte first.  Remote controls
+ * with an 8-bit address send the inverse of the address in the high byte.
+ * \param command The 8-bit command, which is followed by its inverse.
+ *
+ * \return Returns false if the transmitter is busy with another frame.
+ *
+ * \sa sendNECRepeat()
+ */
+bool IRtransmitter::sendNEC(uint16_t address, uint8_t command)
+{
+    if (isBusy())
+        return false;
+    uint32_t bits = address | (((uint32_t)command) << 16) |
+                    (((uint32_t)(uint8_t)~command) << 24);
+    clear();
+    mark(IR_NEC_HEADER_MARK);
+    space(IR_NEC_HEADER_SPACE);
+    for (uint8_t bit = 0; bit < 32; ++bit) {
+        mark(IR_NEC_MARK);
+        space((bits & 1) ? IR_NEC_ONE_SPACE : IR_NEC_ZERO_SPACE);
+        bits >>= 1;
+    }
+    mark(IR_NEC_MARK);
+    return start();
+}
+
+/**
+ * \brief Sends a NEC repeat code, indicating that the button for the
+ * previous sendNEC() command is still held down.
+ *
+ * \return Returns false if the transmitter is busy with another frame.
+ *
+ * \sa sendNEC()
+ */
+bool IRtransmitter::sendNECRepeat()
+{
+    if (isBusy())
+        return false;
+    clear();
+    mark(IR_NEC_HEADER_MARK);
+    space(IR_NEC_REPEAT_SPACE);
+    mark(IR_NEC_MARK);
+    return start();
+}
+
+/**
+ * \brief Sends a raw sequence of mark and space \a timings.
+ *
+ * \param timings Array of \a length durations in microseconds, starting
+ * with a mark and alternating between marks and spaces.
+ * \param length Number of durations in \a timings, up to
+ * \c IR_TRANSMIT_MAX_SEGMENTS.
+ *
+ * \return Returns false if the transmitter is busy with another frame,
+ * or \a length is too large.
+ */
+bool IRtransmitter::sendRaw(const uint16_t *timings, uint8_t length)
+{
+    if (isBusy())
+        return false;
+    clear();
+    for (uint8_t posn = 0; posn < length; ++posn) {
+        if (posn & 1)
+            space(timings[posn]);
+        else
+            mark(timings[posn]);
+    }
+    return start();
+}
+
+/**
+ * \brief Handles a Timer2 overflow while a frame is being transmitted;
+ * must be called from the <tt>TIMER2_OVF_vect</tt> interrupt handler.
+ *
+ * This function does nothing on ESP32 boards.
+ */
+void IRtransmitter::handleTimer()
+{
+#if !defined(ARDUINO_ARCH_ESP32)
+    // One carrier cycle has passed.
+    if (--remaining)
+        return;
+    if (++index >= count) {
+        // End of the frame: turn off the carrier and the interrupt.
+        TCCR2A &= ~(_BV(COM2B1) | _BV(COM2B0));
+        TIMSK2 &= ~_BV(TOIE2);
+        busy = false;
+        return;
+    }
+    remaining = segments[index];
+    if (index & 1)
+        TCCR2A &= ~(_BV(COM2B1) | _BV(COM2B0));
+    else
+        TCCR2A |= _BV(COM2B1);
+#endif
+}
+
+/**
+ * \internal
+ * \brief Clears the table of marks and spaces before encoding a frame.
+ */
+void IRtransmitter::clear()
+{
+    count = 0;
+    overflow = false;
+}
+
+/**
+ * \internal
+ * \brief Adds a mark of \a duration microseconds to the table, merging
+ * it with the previous mark if there is one.
+ */
+void IRtransmitter::mark(unsigned int duration)
+{
+    if (count & 1) {
+        segments[count - 1] += duration;
+    } else if (count < IR_TRANSMIT_MAX_SEGMENTS) {
+        segments[count++] = duration;
+    } else {
+        overflow = true;
+    }
+}
+
+/**
+ * \internal
+ * \brief Adds a space of \a duration microseconds to the table, merging
+ * it with the previous space if there is one.
+ */
+void IRtransmitter::space(unsigned int duration)
+{
+    if (!count) {
+        // Leading spaces are the idle line.
+    } else if (!(count & 1)) {
+        segments[count - 1] += duration;
+    } else if (count < IR_TRANSMIT_MAX_SEGMENTS) {
+        segments[count++] = duration;
+    } else {
+        overflow = true;
+    }
+}
+
+/**
+ * \internal
+ * \brief Starts transmitting the table of marks and spaces.
+ */
+bool IRtransmitter::start()
+{
+    // A trailing space is the idle line, so there is no need to send it.
+    if (!(count & 1) && count)
+        --count;
+    if (overflow || !count)
+        return false;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    uint8_t numItems = 0;
+    for (uint8_t posn = 0; posn < count; posn += 2) {
+        rmt_item32_t *item = &(items[numItems++]);
+        item->level0 = 1;
+        item->duration0 = segments[posn];
+        item->level1 = 0;
+        item->duration1 = (posn + 1) < count ? segments[posn + 1] : 0;
+    }
+    rmt_write_items(channel, items, numItems, false);
+#else
+    // Convert the durations into carrier cycles.
+    for (uint8_t posn = 0; posn < count; ++posn) {
+        uint16_t cycles = (uint16_t)
+            ((((uint32_t)segments[posn]) * _carrier + 500000UL) / 1000000UL);
+        segments[posn] = cycles ? cycles : 1;
+    }
+
+    // Start the first mark at the beginning of a carrier cycle.
+    uint8_t sreg = SREG;
+    cli();
+    index = 0;
+    remaining = segments[0];
+    busy = true;
+    TCNT2 = 0;
+    TIFR2 = _BV(TOV2);
+    TCCR2A |= _BV(COM2B1);
+    TIMSK2 |= _BV(TOIE2);
+    SREG = sreg;
+#endif
+    return true;
+}
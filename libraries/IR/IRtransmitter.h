@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IRtransmitter_h
+#define IRtransmitter_h
+
+#include <inttypes.h>
+
+// Maximum number of marks and spaces in a frame; a NEC frame needs 67.
+#if !defined(IR_TRANSMIT_MAX_SEGMENTS)
+#define IR_TRANSMIT_MAX_SEGMENTS    68
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/rmt.h>
+#endif
+
+class IRtransmitter
+{
+public:
+    IRtransmitter();
+
+    static const unsigned int CARRIER_RC5 = 36000;
+    static const unsigned int CARRIER_NEC = 38000;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    void begin(uint8_t pin, unsigned int carrier = CARRIER_NEC,
+               rmt_channel_t channel = RMT_CHANNEL_0);
+#else
+    void begin(unsigned int carrier = CARRIER_NEC);
+#endif
+    void end();
+
+    unsigned int carrier() const { return _carrier; }
+
+    bool isBusy() const;
+
+    bool sendRC5(uint8_t system, uint8_t command, bool repeat = false);
+    bool sendNEC(uint16_t address, uint8_t command);
+    bool sendNECRepeat();
+    bool sendRaw(const uint16_t *timings, uint8_t length);
+
+    void handleTimer();
+
+private:
+    unsigned int _carrier;
+    uint8_t count;
+    bool toggle;
+    bool overflow;
+#if defined(ARDUINO_ARCH_ESP32)
+    rmt_channel_t channel;
+    rmt_item32_t items[(IR_TRANSMIT_MAX_SEGMENTS + 1) / 2];
+#else
+    volatile bool busy;
+    uint8_t index;
+    uint16_t remaining;
+#endif
+    uint16_t segments[IR_TRANSMIT_MAX_SEGMENTS];
+
+    void clear();
+    void mark(unsigned int duration);
+    void space(unsigned int duration);
+    bool start();
+};
+
+#endif
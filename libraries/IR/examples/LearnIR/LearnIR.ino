@@ -0,0 +1,73 @@
+/*
+This example learns raw codes from any infrared remote control and
+replays them.  Send "L<n>" on the serial port and press a button on the
+remote to learn code slot n (0 to 9), or "P<n>" to replay it.  The codes
+are stored in a 24LC256 EEPROM on A4/A5 so they survive a reset.
+
+This example is placed into the public domain.
+*/
+
+#include <IRreceiver.h>
+#include <IRlearner.h>
+#include <IRtransmitter.h>
+#include <SoftI2C.h>
+#include <EEPROM24.h>
+
+#define SLOT_SIZE   64
+#define NUM_SLOTS   10
+
+IRreceiver ir;
+IRlearner learner;
+IRtransmitter irtx;
+SoftI2C i2c(A4, A5);
+EEPROM24 eeprom(i2c, EEPROM_24LC256);
+uint8_t code[SLOT_SIZE];
+int learnSlot = -1;
+
+ISR(TIMER2_OVF_vect)
+{
+    irtx.handleTimer();
+}
+
+void setup() {
+    Serial.begin(9600);
+    ir.setLearner(&learner);
+    irtx.begin(IRtransmitter::CARRIER_NEC);
+}
+
+void loop() {
+    if (Serial.available() >= 2) {
+        char cmd = Serial.read();
+        int slot = Serial.read() - '0';
+        if (slot < 0 || slot >= NUM_SLOTS) {
+            Serial.println("Invalid slot");
+        } else if (cmd == 'L' || cmd == 'l') {
+            Serial.print("Press a button to learn slot ");
+            Serial.println(slot);
+            learnSlot = slot;
+            learner.start();
+        } else if (cmd == 'P' || cmd == 'p') {
+            if (!IRlearner::load(eeprom, slot * SLOT_SIZE, code, sizeof(code)))
+                Serial.println("Slot is empty");
+            else if (!IRlearner::replay(irtx, code))
+                Serial.println("Cannot replay code");
+            else
+                Serial.println("Sent");
+        }
+    }
+
+    ir.command();   // Discard RC-5 commands; we only want raw codes.
+    if (learnSlot >= 0 && learner.available()) {
+        uint8_t len = learner.encode(code, sizeof(code));
+        if (!len) {
+            Serial.println("Code is too long");
+        } else if (IRlearner::save(eeprom, learnSlot * SLOT_SIZE, code)) {
+            Serial.print("Learnt ");
+            Serial.print(len);
+            Serial.println(" bytes");
+        } else {
+            Serial.println("EEPROM write failed");
+        }
+        learnSlot = -1;
+    }
+}
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ISRProfiler.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/interrupt.h>
+#include <string.h>
+
+/**
+ * \class ISRProfilerClass ISRProfiler.h <ISRProfiler.h>
+ * \brief Measures how much time is spent in interrupt service routines.
+ *
+ * Several libraries install interrupt service routines that compete for
+ * the CPU: DMD::refresh() from Timer1 or Timer2, IRreceiver's external
+ * interrupt, the PowerSave watchdog, and the noise sources' ADC and input
+ * capture interrupts.  The global \ref ISRProfiler object records how
+ * often each of them runs, how long it takes, how deeply it was nested
+ * inside other interrupts, and optionally how long it waited before it
+ * started running.  From this the application can work out whether a
+ * combination of features leaves enough CPU for the main loop.
+ *
+ * Profiling is off by default and costs nothing.  Define
+ * <tt>ISR_PROFILER</tt> to 1 in the build flags to turn it on for the
+ * libraries' own interrupt service routines, and mark the application's
+ * interrupt service routines with ISR_PROFILE() and a slot number from
+ * <tt>ISR_SLOT_USER</tt> upwards:
+ *
+ * \code
+ * #include <DMD.h>
+ * #include <ISRProfiler.h>
+ *
+ * #define SLOT_DMD    ISR_SLOT_USER
+ *
+ * DMD display;
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     ISR_PROFILE(SLOT_DMD);
+ *     display.refresh();
+ * }
+ *
+ * void setup() {
+ *     Serial.begin(9600);
+ *     ISRProfiler.setName(SLOT_DMD, F("DMD"));
+ *     display.enableTimer1();
+ * }
+ *
+ * void loop() {
+ *     ...
+ *     ISRProfiler.report(Serial);
+ * }
+ * \endcode
+ *
+ * ISR_PROFILE() times the rest of the enclosing block, including any
+ * early return.  The time spent in nested interrupts is subtracted from
+ * the time of the interrupt that they interrupted, so the sum of the
+ * cpuShare() values is the total load.  Times are measured with
+ * micros(), which has a resolution of 4 microseconds (64 cycles) on
+ * a 16 MHz AVR, and each measurement adds about 10 microseconds of
+ * overhead to the interrupt.
+ *
+ * The latency of an interrupt is the time between the event and the
+ * first instruction of the interrupt service routine, and is mostly
+ * made up of other interrupts and code that runs with interrupts
+ * disabled.  It cannot be measured in general, but a timer interrupt
+ * can work it out from how far the timer has counted since it fired
+ * and pass it to ISR_PROFILE_LATENCY().  For example, with Timer2 in
+ * normal mode and a prescaler of 128 on a 16 MHz AVR:
+ *
+ * \code
+ * ISR(TIMER2_OVF_vect)
+ * {
+ *     ISR_PROFILE_LATENCY(SLOT_DMD, TCNT2 * 8);
+ *     ISR_PROFILE(SLOT_DMD);
+ *     display.refresh();
+ * }
+ * \endcode
+ *
+ * \sa ISRProfileStats
+ */
+
+/**
+ * \struct ISRProfileStats ISRProfiler.h <ISRProfiler.h>
+ * \brief Statistics for one interrupt service routine, as reported by
+ * ISRProfiler.stats().
+ *
+ * All times are in microseconds.
+ *
+ * \var ISRProfileStats::count
+ * \brief Number of times the interrupt service routine has run.
+ *
+ * \var ISRProfileStats::totalTime
+ * \brief Total time spent in the interrupt service routine, not including
+ * the time spent in other interrupts that were nested inside it.
+ *
+ * \var ISRProfileStats::maxTime
+ * \brief Longest time that the interrupt service routine took to run,
+ * including nested interrupts.  This is the worst-case latency that it
+ * can add to other interrupts.
+ *
+ * \var ISRProfileStats::maxLatency
+ * \brief Longest latency passed to ISR_PROFILE_LATENCY().
+ *
+ * \var ISRProfileStats::maxNesting
+ * \brief Deepest level of nesting seen when the interrupt service routine
+ * was entered.  The value 1 indicates that it has never interrupted
+ * another profiled interrupt service routine.
+ */
+
+/**
+ * \brief Global interrupt profiler instance.
+ */
+ISRProfilerClass ISRProfiler;
+
+/**
+ * \brief Constructs a new interrupt profiler.
+ *
+ * This constructor is called automatically for the global \ref ISRProfiler
+ * object and should not be called by the application.
+ */
+ISRProfilerClass::ISRProfilerClass()
+    : resetTime(0)
+    , depth(0)
+{
+    memset(slots, 0, sizeof(slots));
+    memset(names, 0, sizeof(names));
+    names[ISR_SLOT_WDT] = F("WDT");
+    names[ISR_SLOT_IR] = F("IR");
+    names[ISR_SLOT_ADC] = F("ADC");
+    names[ISR_SLOT_CAPTURE] = F("Capture");
+}
+
+/**
+ * \brief Returns the name of \a slot, or NULL if it does not have a name.
+ *
+ * \sa setName(), report()
+ */
+const __FlashStringHelper *ISRProfilerClass::name(uint8_t slot) const
+{
+    if (slot >= ISR_PROFILER_MAX_SLOTS)
+        return 0;
+    return names[slot];
+}
+
+/**
+ * \brief Sets the \a name of \a slot for report().
+ *
+ * The \a name is normally a string in program memory created with F().
+ * The slots for the interrupt service routines in the libraries are
+ * named automatically.
+ *
+ * \sa name(), report()
+ */
+void ISRProfilerClass::setName(uint8_t slot, const __FlashStringHelper *name)
+{
+    if (slot < ISR_PROFILER_MAX_SLOTS)
+        names[slot] = name;
+}
+
+/**
+ * \brief Clears the statistics for all slots and starts a new
+ * measurement period.
+ *
+ * The period is measured with micros(), so reset() should be called at
+ * least once every 70 minutes to keep cpuShare() accurate.
+ *
+ * \sa elapsed()
+ */
+void ISRProfilerClass::reset()
+{
+    uint8_t save = SREG;
+    cli();
+    memset(slots, 0, sizeof(slots));
+    resetTime = micros();
+    SREG = save;
+}
+
+/**
+ * \brief Returns the number of microseconds since the last call to reset().
+ *
+ * \sa reset(), cpuShare()
+ */
+unsigned long ISRProfilerClass::elapsed() const
+{
+    return micros() - resetTime;
+}
+
+/**
+ * \brief Copies the statistics for \a slot into \a stats.
+ *
+ * Returns false if \a slot is out of range.
+ *
+ * \sa cpuShare(), report()
+ */
+bool ISRProfilerClass::stats(uint8_t slot, ISRProfileStats &stats) const
+{
+    if (slot >= ISR_PROFILER_MAX_SLOTS)
+        return false;
+    uint8_t save = SREG;
+    cli();
+    stats = slots[slot];
+    SREG = save;
+    return true;
+}
+
+/**
+ * \brief Returns the share of the CPU that \a slot has used since the
+ * last call to reset(), in tenths of a percent.
+ *
+ * \sa stats(), elapsed()
+ */
+unsigned int ISRProfilerClass::cpuShare(uint8_t slot) const
+{
+    ISRProfileStats info;
+    if (!stats(slot, info))
+        return 0;
+    unsigned long period = elapsed();
+    if (!period)
+        return 0;
+
+    // Scale down both values to avoid overflow when multiplying by 1000.
+    unsigned long total = info.totalTime;
+    while (total >= 4000000UL) {
+        total >>= 1;
+        period >>= 1;
+    }
+    if (!period)
+        return 0;
+    return (unsigned int)((total * 1000UL) / period);
+}
+
+/**
+ * \brief Prints the statistics for every slot that has run to \a out.
+ *
+ * The report is comma-separated values with a header line and then one
+ * line per interrupt service routine, with the name, count, average and
+ * maximum time in microseconds, maximum latency, maximum nesting depth,
+ * and percentage of CPU since the last reset():
+ *
+ * \code
+ * isr,count,avg_us,max_us,max_latency_us,max_nesting,cpu_percent
+ * DMD,4210,198,212,36,1,20.3
+ * IR,57,16,20,0,2,0.0
+ * \endcode
+ *
+ * \sa stats(), cpuShare()
+ */
+void ISRProfilerClass::report(Print &out) const
+{
+    out.println(F("isr,count,avg_us,max_us,max_latency_us,max_nesting,cpu_percent"));
+    for (uint8_t slot = 0; slot < ISR_PROFILER_MAX_SLOTS; ++slot) {
+        ISRProfileStats info;
+        stats(slot, info);
+        if (!info.count)
+            continue;
+        if (names[slot]) {
+            out.print(names[slot]);
+        } else {
+            out.print(F("ISR"));
+            out.print(slot);
+        }
+        out.print(',');
+        out.print(info.count);
+        out.print(',');
+        out.print(info.totalTime / info.count);
+        out.print(',');
+        out.print(info.maxTime);
+        out.print(',');
+        out.print(info.maxLatency);
+        out.print(',');
+        out.print(info.maxNesting);
+        out.print(',');
+        unsigned int share = cpuShare(slot);
+        out.print(share / 10);
+        out.print('.');
+        out.println(share % 10);
+    }
+}
+
+/**
+ * \brief Records entry to the interrupt service routine for \a slot.
+ *
+ * This is normally called via ISR_PROFILE() rather than directly,
+ * and must be paired with a call to exit().
+ *
+ * \sa exit()
+ */
+void ISRProfilerClass::enter(uint8_t slot)
+{
+    uint8_t save = SREG;
+    cli();
+    uint8_t level = depth;
+    if (level < ISR_PROFILER_MAX_DEPTH) {
+        startTime[level] = micros();
+        childTime[level] = 0;
+    }
+    depth = ++level;
+    if (slot < ISR_PROFILER_MAX_SLOTS && level > slots[slot].maxNesting)
+        slots[slot].maxNesting = level;
+    SREG = save;
+}
+
+/**
+ * \brief Records exit from the interrupt service routine for \a slot.
+ *
+ * \sa enter()
+ */
+void ISRProfilerClass::exit(uint8_t slot)
+{
+    uint8_t save = SREG;
+    cli();
+    uint8_t level = depth;
+    if (level > 0) {
+        depth = --level;
+        if (level < ISR_PROFILER_MAX_DEPTH) {
+            unsigned long duration = micros() - startTime[level];
+            if (level > 0)
+                childTime[level - 1] += duration;
+            if (slot < ISR_PROFILER_MAX_SLOTS) {
+                ISRProfileStats *info = &(slots[slot]);
+                ++(info->count);
+                info->totalTime += duration - childTime[level];
+                if (duration > info->maxTime)
+                    info->maxTime = duration;
+            }
+        }
+    }
+    SREG = save;
+}
+
+/**
+ * \brief Records that the interrupt service routine for \a slot started
+ * \a us microseconds after the event that triggered it.
+ *
+ * This is normally called via ISR_PROFILE_LATENCY() rather than directly.
+ */
+void ISRProfilerClass::latency(uint8_t slot, unsigned long us)
+{
+    if (slot >= ISR_PROFILER_MAX_SLOTS)
+        return;
+    uint8_t save = SREG;
+    cli();
+    if (us > slots[slot].maxLatency)
+        slots[slot].maxLatency = us;
+    SREG = save;
+}
+
+/**
+ * \class ISRProfileScope ISRProfiler.h <ISRProfiler.h>
+ * \brief Times the enclosing block of an interrupt service routine.
+ *
+ * This class is normally used via the ISR_PROFILE() macro, which
+ * compiles to nothing when <tt>ISR_PROFILER</tt> is 0.
+ *
+ * \sa ISRProfilerClass
+ */
+
+/**
+ * \fn ISRProfileScope::ISRProfileScope(uint8_t slot)
+ * \brief Records entry to the interrupt service routine for \a slot.
+ */
+
+/**
+ * \fn ISRProfileScope::~ISRProfileScope()
+ * \brief Records exit from the interrupt service routine.
+ */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ISRProfiler_h
+#define ISRProfiler_h
+
+#include <inttypes.h>
+
+class Print;
+class __FlashStringHelper;
+
+// Set to 1 in the build flags to profile the interrupt service routines
+// in the libraries and those marked with ISR_PROFILE() by the application.
+#if !defined(ISR_PROFILER)
+#define ISR_PROFILER            0
+#endif
+
+// Number of interrupt service routines that can be profiled.
+#if !defined(ISR_PROFILER_MAX_SLOTS)
+#define ISR_PROFILER_MAX_SLOTS  8
+#endif
+
+// Maximum depth of nested interrupt service routines that can be timed.
+#if !defined(ISR_PROFILER_MAX_DEPTH)
+#define ISR_PROFILER_MAX_DEPTH  4
+#endif
+
+// Slots for the interrupt service routines within the libraries.
+#define ISR_SLOT_WDT            0   // PowerSave watchdog timer
+#define ISR_SLOT_IR             1   // IRreceiver external interrupt
+#define ISR_SLOT_ADC            2   // TransistorNoiseSource ADC conversion
+#define ISR_SLOT_CAPTURE        3   // RingOscillatorNoiseSource input capture
+#define ISR_SLOT_USER           4   // First slot for the application
+
+struct ISRProfileStats
+{
+    unsigned long count;
+    unsigned long totalTime;
+    unsigned long maxTime;
+    unsigned long maxLatency;
+    uint8_t maxNesting;
+};
+
+class ISRProfilerClass
+{
+public:
+    ISRProfilerClass();
+
+    const __FlashStringHelper *name(uint8_t slot) const;
+    void setName(uint8_t slot, const __FlashStringHelper *name);
+
+    void reset();
+
+    unsigned long elapsed() const;
+    bool stats(uint8_t slot, ISRProfileStats &stats) const;
+    unsigned int cpuShare(uint8_t slot) const;
+
+    void report(Print &out) const;
+
+    void enter(uint8_t slot);
+    void exit(uint8_t slot);
+    void latency(uint8_t slot, unsigned long us);
+
+private:
+    ISRProfileStats slots[ISR_PROFILER_MAX_SLOTS];
+    const __FlashStringHelper *names[ISR_PROFILER_MAX_SLOTS];
+    unsigned long startTime[ISR_PROFILER_MAX_DEPTH];
+    unsigned long childTime[ISR_PROFILER_MAX_DEPTH];
+    unsigned long resetTime;
+    volatile uint8_t depth;
+};
+
+extern ISRProfilerClass ISRProfiler;
+
+class ISRProfileScope
+{
+public:
+    explicit ISRProfileScope(uint8_t slot) : _slot(slot) { ISRProfiler.enter(slot); }
+    ~ISRProfileScope() { ISRProfiler.exit(_slot); }
+
+private:
+    uint8_t _slot;
+};
+
+#if ISR_PROFILER
+#define ISR_PROFILE(slot)               ISRProfileScope isrProfileScope_((slot))
+#define ISR_PROFILE_LATENCY(slot, us)   ISRProfiler.latency((slot), (us))
+#else
+#define ISR_PROFILE(slot)               do { ; } while (0)
+#define ISR_PROFILE_LATENCY(slot, us)   do { ; } while (0)
+#endif
+
+#endif
@@ -39,6 +39,9 @@
  * BoolField ledField(mainForm, "Status LED", "On", "Off", true);
  * \endcode
  *
+ * To save RAM, the strings can be placed in program memory instead;
+ * see Field for an example.
+ *
  * \image html FormBool.png
  *
  * To actually toggle the LED, the application's main loop() function
@@ -76,6 +79,28 @@
  */
 BoolField::BoolField(const String &label)
     : Field(label)
+    , _flashTrueLabel(0)
+    , _flashFalseLabel(0)
+    , _printLen(0)
+    , _value(false)
+{
+}
+
+/**
+ * \brief Constructs a new boolean field with a specific \a label in
+ * program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * The initial value() will be false.
+ *
+ * \sa Form::addField()
+ */
+BoolField::BoolField(const __FlashStringHelper *label)
+    : Field(label)
+    , _flashTrueLabel(0)
+    , _flashFalseLabel(0)
     , _printLen(0)
     , _value(false)
 {
@@ -95,6 +120,27 @@ BoolField::BoolField(Form &form, const String &label, const String &trueLabel, c
     : Field(form, label)
     , _trueLabel(trueLabel)
     , _falseLabel(falseLabel)
+    , _flashTrueLabel(0)
+    , _flashFalseLabel(0)
+    , _printLen(0)
+    , _value(value)
+{
+}
+
+/**
+ * \brief Constructs a new boolean field with a specific \a label and
+ * attaches it to a \a form, with all strings in program memory.
+ *
+ * The initial value() of the field is set to the parameter \a value.
+ * When value() is true, \a trueLabel will be displayed on the screen.
+ * When value() is false, \a falseLabel will be displayed on the screen.
+ *
+ * \sa value()
+ */
+BoolField::BoolField(Form &form, const __FlashStringHelper *label, const __FlashStringHelper *trueLabel, const __FlashStringHelper *falseLabel, bool value)
+    : Field(form, label)
+    , _flashTrueLabel(trueLabel)
+    , _flashFalseLabel(falseLabel)
     , _printLen(0)
     , _value(value)
 {
@@ -138,7 +184,7 @@ void BoolField::setValue(bool value)
 }
 
 /**
- * \fn const String &BoolField::trueLabel() const
+ * \fn String BoolField::trueLabel() const
  * \brief Returns the string that is displayed when value() is true.
  *
  * \sa setTrueLabel(), falseLabel()
@@ -153,12 +199,27 @@ void BoolField::setValue(bool value)
 void BoolField::setTrueLabel(const String &trueLabel)
 {
     _trueLabel = trueLabel;
+    _flashTrueLabel = 0;
+    if (isCurrent())
+        printValue();
+}
+
+/**
+ * \brief Sets the string that is displayed when value() is true to
+ * \a trueLabel in program memory.
+ *
+ * \sa trueLabel(), setFalseLabel()
+ */
+void BoolField::setTrueLabel(const __FlashStringHelper *trueLabel)
+{
+    _trueLabel = String();
+    _flashTrueLabel = trueLabel;
     if (isCurrent())
         printValue();
 }
 
 /**
- * \fn const String &BoolField::falseLabel() const
+ * \fn String BoolField::falseLabel() const
  * \brief Returns the string that is displayed when value() is false.
  *
  * \sa setFalseLabel(), trueLabel()
@@ -173,6 +234,21 @@ void BoolField::setTrueLabel(const String &trueLabel)
 void BoolField::setFalseLabel(const String &falseLabel)
 {
     _falseLabel = falseLabel;
+    _flashFalseLabel = 0;
+    if (isCurrent())
+        printValue();
+}
+
+/**
+ * \brief Sets the string that is displayed when value() is false to
+ * \a falseLabel in program memory.
+ *
+ * \sa falseLabel(), setTrueLabel()
+ */
+void BoolField::setFalseLabel(const __FlashStringHelper *falseLabel)
+{
+    _falseLabel = String();
+    _flashFalseLabel = falseLabel;
     if (isCurrent())
         printValue();
 }
@@ -181,17 +257,12 @@ void BoolField::printValue()
 {
     unsigned int len;
     lcd()->setCursor(0, 1);
-    if (_value) {
-        lcd()->print(_trueLabel);
-        len = _trueLabel.length();
-        while (len++ < _printLen)
-            lcd()->write(' ');
-        _printLen = _trueLabel.length();
-    } else {
-        lcd()->print(_falseLabel);
-        len = _falseLabel.length();
-        while (len++ < _printLen)
-            lcd()->write(' ');
-        _printLen = _falseLabel.length();
-    }
+    if (_value)
+        len = printString(_trueLabel, _flashTrueLabel);
+    else
+        len = printString(_falseLabel, _flashFalseLabel);
+    unsigned int newLen = len;
+    while (len++ < _printLen)
+        lcd()->write(' ');
+    _printLen = newLen;
 }
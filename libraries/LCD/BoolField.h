@@ -28,7 +28,9 @@
 class BoolField : public Field {
 public:
     explicit BoolField(const String &label);
+    explicit BoolField(const __FlashStringHelper *label);
     BoolField(Form &form, const String &label, const String &trueLabel, const String &falseLabel, bool value);
+    BoolField(Form &form, const __FlashStringHelper *label, const __FlashStringHelper *trueLabel, const __FlashStringHelper *falseLabel, bool value);
 
     int dispatch(int event);
 
@@ -37,15 +39,19 @@ public:
     bool value() const { return _value; }
     void setValue(bool value);
 
-    const String &trueLabel() const { return _trueLabel; }
+    String trueLabel() const { return stringValue(_trueLabel, _flashTrueLabel); }
     void setTrueLabel(const String &trueLabel);
+    void setTrueLabel(const __FlashStringHelper *trueLabel);
 
-    const String &falseLabel() const { return _falseLabel; }
+    String falseLabel() const { return stringValue(_falseLabel, _flashFalseLabel); }
     void setFalseLabel(const String &falseLabel);
+    void setFalseLabel(const __FlashStringHelper *falseLabel);
 
 private:
     String _trueLabel;
     String _falseLabel;
+    const __FlashStringHelper *_flashTrueLabel;
+    const __FlashStringHelper *_flashFalseLabel;
     int _printLen;
     bool _value;
 
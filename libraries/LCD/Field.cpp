@@ -21,11 +21,33 @@
  */
 
 #include "Field.h"
+#include <avr/pgmspace.h>
 
 /**
  * \class Field Field.h <Field.h>
  * \brief Manages a single data input/output field within a Form.
  *
+ * Labels can be placed in program memory to save RAM in sketches that
+ * have a lot of fields.  The <tt>F()</tt> macro cannot be used outside
+ * of a function, so labels for global fields are declared with
+ * <tt>PROGMEM</tt> and passed as <tt>const __FlashStringHelper *</tt>:
+ *
+ * \code
+ * const char volumeLabel[] PROGMEM = "Volume";
+ * const char percent[] PROGMEM = "%";
+ *
+ * Form mainForm(lcd);
+ * IntField volumeField(mainForm, (const __FlashStringHelper *)volumeLabel,
+ *                      0, 100, 5, 85, (const __FlashStringHelper *)percent);
+ * \endcode
+ *
+ * Inside a function, <tt>F()</tt> can be used directly; for example,
+ * <tt>field.setLabel(F("Volume"))</tt>.
+ *
+ * Fields only draw themselves on the LCD when they are the current
+ * field of a visible form, so values and labels can be updated at any
+ * time without touching the display.
+ *
  * \sa Form, BoolField, IntField, ListField, TextField, TimeField
  */
 
@@ -39,6 +61,7 @@
  */
 Field::Field(const String &label)
     : _label(label)
+    , _flashLabel(0)
     , _form(0)
     , next(0)
     , prev(0)
@@ -51,6 +74,36 @@ Field::Field(const String &label)
  */
 Field::Field(Form &form, const String &label)
     : _label(label)
+    , _flashLabel(0)
+    , _form(0)
+    , next(0)
+    , prev(0)
+{
+    form.addField(this);
+}
+
+/**
+ * \brief Constructs a new field with a \a label in program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * \sa Form::addField()
+ */
+Field::Field(const __FlashStringHelper *label)
+    : _flashLabel(label)
+    , _form(0)
+    , next(0)
+    , prev(0)
+{
+}
+
+/**
+ * \brief Constructs a new field with a \a label in program memory and
+ * attaches it to a \a form.
+ */
+Field::Field(Form &form, const __FlashStringHelper *label)
+    : _flashLabel(label)
     , _form(0)
     , next(0)
     , prev(0)
@@ -115,7 +168,7 @@ int Field::dispatch(int event)
  */
 void Field::enterField(bool reverse)
 {
-    lcd()->print(_label);
+    printString(_label, _flashLabel);
 }
 
 /**
@@ -132,11 +185,16 @@ void Field::exitField()
 }
 
 /**
- * \fn const String &Field::label() const
  * \brief Returns the label to display in the first line of this field.
  *
+ * If the label is in program memory, then a copy of it is returned.
+ *
  * \sa setLabel()
  */
+String Field::label() const
+{
+    return stringValue(_label, _flashLabel);
+}
 
 /**
  * \brief Sets the \a label to display in the first line of this field.
@@ -145,18 +203,30 @@ void Field::exitField()
  */
 void Field::setLabel(const String &label)
 {
-    if (isCurrent()) {
-        unsigned int prevLen = _label.length();
-        unsigned int newLen = label.length();
-        _label = label;
-        lcd()->setCursor(0, 0);
-        lcd()->print(label);
-        while (newLen++ < prevLen)
-            lcd()->write(' ');
-        updateCursor();
-    } else {
-        _label = label;
-    }
+    unsigned int prevLen = labelLength();
+    _label = label;
+    _flashLabel = 0;
+    if (isCurrent())
+        redrawLabel(prevLen);
+}
+
+/**
+ * \brief Sets the \a label to display in the first line of this field
+ * to a string in program memory.
+ *
+ * \code
+ * field.setLabel(F("New label"));
+ * \endcode
+ *
+ * \sa label()
+ */
+void Field::setLabel(const __FlashStringHelper *label)
+{
+    unsigned int prevLen = labelLength();
+    _label = String();
+    _flashLabel = label;
+    if (isCurrent())
+        redrawLabel(prevLen);
 }
 
 /**
@@ -192,3 +262,111 @@ void Field::updateCursor()
 {
     // Nothing to do here.
 }
+
+/**
+ * \brief Returns the multiplier to apply to value changes for the
+ * current button event.
+ *
+ * The multiplier is 1 for the initial press and for the first few
+ * auto-repeats, and then grows to 2, 5, and finally 10 the longer
+ * the button is held down.  Subclasses use this to reach distant
+ * values quickly.
+ *
+ * \sa Form::repeatCount()
+ */
+int Field::acceleration() const
+{
+    int repeats = _form ? _form->repeatCount() : 0;
+    if (repeats < 5)
+        return 1;
+    else if (repeats < 10)
+        return 2;
+    else if (repeats < 20)
+        return 5;
+    else
+        return 10;
+}
+
+/**
+ * \brief Prints \a flashStr to the LCD if it is not null, or \a str
+ * otherwise.
+ *
+ * Returns the number of characters that were printed.  This is intended
+ * for subclasses that allow their strings to be placed in either RAM or
+ * program memory.
+ *
+ * \sa stringValue(), stringLength()
+ */
+unsigned int Field::printString(const String &str, const __FlashStringHelper *flashStr)
+{
+    if (!flashStr) {
+        lcd()->print(str);
+        return str.length();
+    }
+    const char *p = reinterpret_cast<const char *>(flashStr);
+    unsigned int len = 0;
+    char ch;
+    while ((ch = pgm_read_byte(p)) != 0) {
+        lcd()->write(ch);
+        ++len;
+        ++p;
+    }
+    return len;
+}
+
+/**
+ * \brief Returns a copy of \a flashStr if it is not null, or \a str
+ * otherwise.
+ *
+ * \sa printString(), stringLength()
+ */
+String Field::stringValue(const String &str, const __FlashStringHelper *flashStr)
+{
+    if (!flashStr)
+        return str;
+    String result;
+    const char *p = reinterpret_cast<const char *>(flashStr);
+    char ch;
+    result.reserve(strlen_P(p));
+    while ((ch = pgm_read_byte(p)) != 0) {
+        result += ch;
+        ++p;
+    }
+    return result;
+}
+
+/**
+ * \brief Returns the length of \a flashStr if it is not null, or the
+ * length of \a str otherwise.
+ *
+ * \sa printString(), stringValue()
+ */
+unsigned int Field::stringLength(const String &str, const __FlashStringHelper *flashStr)
+{
+    if (flashStr)
+        return strlen_P(reinterpret_cast<const char *>(flashStr));
+    return str.length();
+}
+
+/**
+ * \internal
+ * \brief Returns the number of characters in the label.
+ */
+unsigned int Field::labelLength() const
+{
+    return stringLength(_label, _flashLabel);
+}
+
+/**
+ * \internal
+ * \brief Redraws the label, blanking out the rest of the previous label
+ * which was \a prevLen characters in length.
+ */
+void Field::redrawLabel(unsigned int prevLen)
+{
+    lcd()->setCursor(0, 0);
+    unsigned int newLen = printString(_label, _flashLabel);
+    while (newLen++ < prevLen)
+        lcd()->write(' ');
+    updateCursor();
+}
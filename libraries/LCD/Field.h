@@ -28,7 +28,9 @@
 class Field {
 public:
     explicit Field(const String &label);
+    explicit Field(const __FlashStringHelper *label);
     Field(Form &form, const String &label);
+    Field(Form &form, const __FlashStringHelper *label);
     ~Field();
 
     Form *form() const { return _form; }
@@ -38,8 +40,9 @@ public:
     virtual void enterField(bool reverse);
     virtual void exitField();
 
-    const String &label() const { return _label; }
+    String label() const;
     void setLabel(const String &label);
+    void setLabel(const __FlashStringHelper *label);
 
     bool isCurrent() const;
 
@@ -48,12 +51,22 @@ protected:
 
     virtual void updateCursor();
 
+    int acceleration() const;
+
+    unsigned int printString(const String &str, const __FlashStringHelper *flashStr);
+    static String stringValue(const String &str, const __FlashStringHelper *flashStr);
+    static unsigned int stringLength(const String &str, const __FlashStringHelper *flashStr);
+
 private:
     String _label;
+    const __FlashStringHelper *_flashLabel;
     Form *_form;
     Field *next;
     Field *prev;
 
+    unsigned int labelLength() const;
+    void redrawLabel(unsigned int prevLen);
+
     friend class Form;
 };
 
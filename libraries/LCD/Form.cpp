@@ -29,6 +29,38 @@
  *
  * See the \ref lcd_form "Form example" for more information on
  * creating an application that uses forms and fields.
+ *
+ * \section form_repeat Auto-repeat and change notification
+ *
+ * When the LCD's buttons are scanned in the background with
+ * LCD::enableButtonScan() and LCD::setButtonRepeat(), holding down Up or
+ * Down delivers a stream of repeated presses to dispatch().  The form
+ * counts the repeats (see repeatCount()) and IntField and TimeField
+ * use the count to take larger steps the longer the button is held,
+ * so that large ranges can be covered quickly.
+ *
+ * Rather than checking every field after each call to dispatch(), the
+ * application can register a callback that is told which field the user
+ * has changed:
+ *
+ * \code
+ * void formChanged(Form *form, Field *field)
+ * {
+ *     if (field == &volumeField)
+ *         setVolume(volumeField.value());
+ * }
+ *
+ * void setup() {
+ *     lcd.enableButtonScan();
+ *     lcd.setButtonRepeat(500, 100);
+ *     mainForm.setChangedCallback(formChanged);
+ *     mainForm.show();
+ * }
+ *
+ * void loop() {
+ *     mainForm.dispatch(lcd.getButton());
+ * }
+ * \endcode
  */
 
 /**
@@ -49,6 +81,10 @@ Form::Form(LiquidCrystal &lcd)
     , first(0)
     , last(0)
     , current(0)
+    , visible(false)
+    , lastPress(LCD_BUTTON_NONE)
+    , repeats(0)
+    , changedCallback(0)
 {
 }
 
@@ -94,12 +130,31 @@ Form::~Form()
  *
  * This function handles the Left and Right buttons to navigate between fields.
  *
+ * If a callback has been set with setChangedCallback(), then it is called
+ * with the current field before returning FORM_CHANGED.
+ *
  * \sa Field::dispatch(), LCD::getButton(), currentField(), isCurrent()
  */
 int Form::dispatch(int event)
 {
+    // Count repeated presses of the same button with no release between.
+    if (event > 0) {
+        if (event == lastPress) {
+            if (repeats < 255)
+                ++repeats;
+        } else {
+            lastPress = event;
+            repeats = 0;
+        }
+    } else if (event < 0) {
+        lastPress = LCD_BUTTON_NONE;
+        repeats = 0;
+    }
+
     if (current) {
         int exitval = current->dispatch(event);
+        if (exitval == FORM_CHANGED && changedCallback)
+            changedCallback(this, current);
         if (exitval >= 0)
             return exitval;
     }
@@ -235,7 +290,9 @@ void Form::setCurrentField(Field *field)
         bool reverse = false;
         if (current) {
             current->exitField();
-            if (field->next == current)
+            if (!field)
+                reverse = false;
+            else if (field->next == current)
                 reverse = true;
             else if (!field->next && current == first)
                 reverse = true;
@@ -306,3 +363,34 @@ void Form::hide()
  *
  * \sa show(), hide()
  */
+
+/**
+ * \typedef Form::ChangedCallback
+ * \brief Type of a function that is called by dispatch() when the user
+ * changes the value of a field.
+ *
+ * The function is passed the form and the field that changed.
+ */
+
+/**
+ * \fn void Form::setChangedCallback(ChangedCallback callback)
+ * \brief Sets the \a callback function to call when dispatch() is about
+ * to return FORM_CHANGED.
+ *
+ * The \a callback may be null to disable it.  The callback is not called
+ * when the application changes a field's value itself.
+ *
+ * \sa dispatch()
+ */
+
+/**
+ * \fn int Form::repeatCount() const
+ * \brief Returns the number of times that the button in the last press
+ * event passed to dispatch() has auto-repeated.
+ *
+ * The count is zero for the initial press and is reset when the button
+ * is released or a different button is pressed.  Repeats only occur when
+ * the LCD's buttons are scanned with auto-repeat enabled.
+ *
+ * \sa LCD::setButtonRepeat(), Field::acceleration()
+ */
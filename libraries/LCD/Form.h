@@ -52,12 +52,20 @@ public:
     void hide();
     bool isVisible() const { return visible; }
 
+    typedef void (*ChangedCallback)(Form *form, Field *field);
+    void setChangedCallback(ChangedCallback callback) { changedCallback = callback; }
+
+    int repeatCount() const { return repeats; }
+
 private:
     LiquidCrystal *_lcd;
     Field *first;
     Field *last;
     Field *current;
     bool visible;
+    int8_t lastPress;
+    uint8_t repeats;
+    ChangedCallback changedCallback;
 
     friend class Field;
 };
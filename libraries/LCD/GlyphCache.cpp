@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "GlyphCache.h"
+#include "LCD.h"
+#include <avr/pgmspace.h>
+
+/**
+ * \class GlyphCache GlyphCache.h <GlyphCache.h>
+ * \brief Shares the LCD's 8 custom character slots between any number
+ * of glyphs.
+ *
+ * The HD44780 only has room for 8 user-defined characters.  Sketches
+ * that draw bar graphs or icons often need more than that, and end up
+ * calling LCD::createChar() for every slot each time the screen is
+ * updated.  Each call rewrites 8 bytes of character memory.
+ *
+ * GlyphCache assigns slots to glyphs on demand.  The application gives
+ * each of its glyphs a numeric identifier and asks the cache for the
+ * character code to write:
+ *
+ * \code
+ * LCD lcd;
+ * GlyphCache glyphs(lcd);
+ *
+ * static uint8_t const bars[6][8] PROGMEM = { ... };
+ *
+ * void drawBar(int level) {
+ *     lcd.write(glyphs.glyph(level, bars[level], true));
+ * }
+ * \endcode
+ *
+ * The bitmap is only sent to the LCD if the glyph is not already in a
+ * slot.  When all slots are in use, the least recently used glyph is
+ * replaced.  If the LCD has a shadow buffer (LCD::enableShadow()), then
+ * glyphs whose character codes are visible on the screen are kept in
+ * preference to those that are not, so that replacing a glyph does not
+ * change the appearance of text that is already on the screen.
+ *
+ * The cache assumes that it owns all 8 slots.  If the application calls
+ * LCD::createChar() itself, then it should call invalidate() afterwards.
+ *
+ * \sa LCD::createChar()
+ */
+
+/**
+ * \brief Constructs a new glyph cache for \a lcd.
+ *
+ * Initially no glyphs are resident.
+ */
+GlyphCache::GlyphCache(LCD &lcd)
+    : _lcd(&lcd)
+{
+    invalidate();
+}
+
+/**
+ * \brief Returns the character code to write to the LCD to display the
+ * glyph \a id, uploading \a bitmap to the LCD if necessary.
+ *
+ * The \a bitmap consists of 8 bytes, one for each row of the character
+ * from top to bottom, with the lower 5 bits of each byte providing the
+ * pixels.  This is the same format as for LCD::createChar().
+ * If \a progmem is true, then \a bitmap is in program memory.
+ *
+ * The return value is between 0 and 7.  The application is responsible
+ * for giving different glyphs different identifiers.
+ *
+ * \sa slot()
+ */
+uint8_t GlyphCache::glyph(uint8_t id, const uint8_t *bitmap, bool progmem)
+{
+    int index = slot(id);
+    if (index >= 0) {
+        touch(index);
+        return index;
+    }
+    index = chooseSlot();
+    uint8_t charmap[8];
+    for (uint8_t row = 0; row < 8; ++row) {
+        if (progmem)
+            charmap[row] = pgm_read_byte(bitmap + row);
+        else
+            charmap[row] = bitmap[row];
+    }
+    _lcd->createChar(index, charmap);
+    ids[index] = id;
+    resident |= (1 << index);
+    touch(index);
+    return index;
+}
+
+/**
+ * \brief Returns the slot that currently holds glyph \a id, or -1 if
+ * the glyph is not resident.
+ *
+ * \sa glyph()
+ */
+int GlyphCache::slot(uint8_t id) const
+{
+    for (uint8_t index = 0; index < GLYPH_CACHE_SLOTS; ++index) {
+        if ((resident & (1 << index)) != 0 && ids[index] == id)
+            return index;
+    }
+    return -1;
+}
+
+/**
+ * \brief Forgets all resident glyphs so that they will be uploaded
+ * again the next time they are used.
+ *
+ * This should be called if the application modifies the LCD's custom
+ * characters without going through the cache.
+ */
+void GlyphCache::invalidate()
+{
+    resident = 0;
+    for (uint8_t index = 0; index < GLYPH_CACHE_SLOTS; ++index) {
+        ids[index] = 0;
+        order[index] = index;
+    }
+}
+
+/**
+ * \internal
+ * \brief Chooses the slot to use for a new glyph.
+ *
+ * Free slots are used first, then the least recently used slot that
+ * is not visible on the screen, and finally the least recently used slot.
+ */
+uint8_t GlyphCache::chooseSlot() const
+{
+    uint8_t index;
+    for (index = 0; index < GLYPH_CACHE_SLOTS; ++index) {
+        if ((resident & (1 << index)) == 0)
+            return index;
+    }
+    if (_lcd->shadow) {
+        uint8_t posn;
+        for (posn = GLYPH_CACHE_SLOTS; posn > 0; --posn) {
+            index = order[posn - 1];
+            if (!isVisible(index))
+                return index;
+        }
+    }
+    return order[GLYPH_CACHE_SLOTS - 1];
+}
+
+/**
+ * \internal
+ * \brief Determines if the character code for \a slot appears anywhere
+ * in the LCD's shadow buffer.
+ */
+bool GlyphCache::isVisible(uint8_t slot) const
+{
+    const uint8_t *cell = _lcd->shadow;
+    unsigned int size = _lcd->numCols * _lcd->numRows;
+    while (size-- > 0) {
+        // Character codes 8 to 15 are aliases for 0 to 7.
+        if ((*cell++ & 0xF7) == slot)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * \internal
+ * \brief Marks \a slot as the most recently used.
+ */
+void GlyphCache::touch(uint8_t slot)
+{
+    uint8_t posn = 0;
+    while (order[posn] != slot)
+        ++posn;
+    while (posn > 0) {
+        order[posn] = order[posn - 1];
+        --posn;
+    }
+    order[0] = slot;
+}
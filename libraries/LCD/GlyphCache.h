@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef GlyphCache_h
+#define GlyphCache_h
+
+#include <inttypes.h>
+
+class LCD;
+
+#define GLYPH_CACHE_SLOTS   8
+
+class GlyphCache {
+public:
+    explicit GlyphCache(LCD &lcd);
+
+    uint8_t glyph(uint8_t id, const uint8_t *bitmap, bool progmem = false);
+    int slot(uint8_t id) const;
+
+    void invalidate();
+
+private:
+    LCD *_lcd;
+    uint8_t ids[GLYPH_CACHE_SLOTS];
+    uint8_t order[GLYPH_CACHE_SLOTS];
+    uint8_t resident;
+
+    uint8_t chooseSlot() const;
+    bool isVisible(uint8_t slot) const;
+    void touch(uint8_t slot);
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "I2CLiquidCrystal.h"
+#include <I2CMaster.h>
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class I2CLiquidCrystal I2CLiquidCrystal.h <I2CLiquidCrystal.h>
+ * \brief Character LCD that is connected via a PCF8574 I2C backpack.
+ *
+ * Many HD44780-compatible character displays are sold with a small
+ * "backpack" board that drives the display from a PCF8574 I/O expander,
+ * so that only the two I2C lines are needed.  This class sends the
+ * display's commands and data through an I2CMaster, so it works with
+ * SoftI2C or any other I2C master implementation:
+ *
+ * \code
+ * SoftI2C bus(A4, A5);
+ * I2CLiquidCrystal lcd(bus);
+ *
+ * void setup() {
+ *     lcd.begin(16, 2);
+ *     lcd.print("Hello, world!");
+ * }
+ * \endcode
+ *
+ * The expander's outputs are assumed to be wired in the most common
+ * arrangement: P0 = RS, P1 = R/W, P2 = E, P3 = back light, and
+ * P4..P7 = D4..D7.  The default I2C address is 0x27, which is the
+ * address of the PCF8574 with all address jumpers open.  Backpacks that
+ * use the PCF8574A are usually at 0x3F instead.
+ *
+ * Unlike the parallel LiquidCrystal constructors, the constructor does
+ * not talk to the display because the I2C bus may not be ready yet.
+ * The application must call begin() from its <tt>setup()</tt> function.
+ *
+ * Every nibble normally needs two writes to the expander, one to raise
+ * the enable line and one to lower it.  Each character is sent as a
+ * single I2C transaction containing both of its nibbles, and strings
+ * that are printed with Print::print() are sent as a single transaction
+ * (or as few as the bus master's maxTransferSize() allows).  This avoids
+ * the start, address, and stop overhead for every byte and makes a full
+ * 16x2 update over a 100 kHz bus take around 15 milliseconds.
+ *
+ * The R/W line is held low, so the busy flag is not polled.  The I2C
+ * transfer time for each byte is longer than the time that the display
+ * needs to execute a normal command.
+ *
+ * \sa LCD, I2CMaster
+ */
+
+// Bits in the PCF8574 output register.
+#define I2CLCD_RS           0x01
+#define I2CLCD_RW           0x02
+#define I2CLCD_EN           0x04
+#define I2CLCD_BACKLIGHT    0x08
+
+/**
+ * \brief Constructs a new LCD object that communicates via the PCF8574
+ * at \a address on \a bus.
+ *
+ * \sa begin()
+ */
+I2CLiquidCrystal::I2CLiquidCrystal(I2CMaster &bus, unsigned int address)
+    : _bus(&bus)
+    , _address(address)
+    , maxBytes(0)
+    , pending(0)
+    , backlight(I2CLCD_BACKLIGHT)
+    , batching(false)
+    , connected(false)
+{
+}
+
+/**
+ * \brief Initializes the LCD to \a cols columns and \a rows rows, with
+ * the character size \a charsize.
+ *
+ * The display is cleared and the back light is set to its current
+ * state, which is on by default.
+ *
+ * \sa isConnected()
+ */
+void I2CLiquidCrystal::begin(uint8_t cols, uint8_t rows, uint8_t charsize)
+{
+    maxBytes = _bus->maxTransferSize();
+    pending = 0;
+    batching = false;
+
+    // Put the expander into a known state with E low.
+    _bus->startWrite(_address);
+    _bus->write(backlight);
+    connected = _bus->endWrite();
+
+    LiquidCrystal::begin(cols, rows, charsize);
+}
+
+/**
+ * \fn unsigned int I2CLiquidCrystal::address() const
+ * \brief Returns the I2C address of the PCF8574 on the backpack.
+ */
+
+/**
+ * \fn bool I2CLiquidCrystal::isBacklightOn() const
+ * \brief Returns true if the back light is on; false if it is off.
+ *
+ * \sa backlightOn(), backlightOff()
+ */
+
+/**
+ * \brief Turns the back light on.
+ *
+ * \sa backlightOff(), isBacklightOn()
+ */
+void I2CLiquidCrystal::backlightOn()
+{
+    backlight = I2CLCD_BACKLIGHT;
+    _bus->startWrite(_address);
+    _bus->write(backlight);
+    connected = _bus->endWrite();
+}
+
+/**
+ * \brief Turns the back light off.
+ *
+ * \sa backlightOn(), isBacklightOn()
+ */
+void I2CLiquidCrystal::backlightOff()
+{
+    backlight = 0;
+    _bus->startWrite(_address);
+    _bus->write(backlight);
+    connected = _bus->endWrite();
+}
+
+/**
+ * \fn bool I2CLiquidCrystal::isConnected() const
+ * \brief Returns true if the backpack acknowledged the last I2C write;
+ * false if it did not respond.
+ *
+ * This can be used after begin() to check that the backpack is present
+ * at address().
+ */
+
+/**
+ * \brief Writes the \a size bytes in \a buffer to the display as a
+ * single I2C transaction.
+ *
+ * This is called by Print::print() for strings, so that the whole string
+ * is sent at once rather than as one I2C transaction per character.
+ */
+#if defined(ARDUINO) && ARDUINO >= 100
+size_t I2CLiquidCrystal::write(const uint8_t *buffer, size_t size)
+#else
+void I2CLiquidCrystal::write(const uint8_t *buffer, size_t size)
+#endif
+{
+    startBatch();
+#if defined(ARDUINO) && ARDUINO >= 100
+    size_t n = Print::write(buffer, size);
+    endBatch();
+    return n;
+#else
+    Print::write(buffer, size);
+    endBatch();
+#endif
+}
+
+/**
+ * \internal
+ * \brief Sends the byte \a value to the display, as data if \a mode is
+ * HIGH or as a command if \a mode is LOW.
+ */
+void I2CLiquidCrystal::transmit(uint8_t value, uint8_t mode)
+{
+    uint8_t rs = mode ? I2CLCD_RS : 0;
+    writeNibble((value & 0xF0) | rs);
+    writeNibble((value << 4) | rs);
+    if (!batching)
+        endBatch();
+}
+
+/**
+ * \internal
+ * \brief Sends the single nibble \a value as a command, for the 4-bit
+ * initialization sequence in LiquidCrystal::begin().
+ */
+void I2CLiquidCrystal::transmitNibble(uint8_t value)
+{
+    writeNibble(value << 4);
+    if (!batching)
+        endBatch();
+}
+
+/**
+ * \internal
+ * \brief Starts batching nibbles into a single I2C transaction.
+ */
+void I2CLiquidCrystal::startBatch()
+{
+    batching = true;
+}
+
+/**
+ * \internal
+ * \brief Ends the current I2C transaction, if any.
+ */
+void I2CLiquidCrystal::endBatch()
+{
+    batching = false;
+    if (pending) {
+        connected = _bus->endWrite();
+        pending = 0;
+    }
+}
+
+/**
+ * \internal
+ * \brief Pulses \a bits onto the expander with E high and then E low.
+ *
+ * The transaction is split if it would exceed the bus master's
+ * maximum transfer size.
+ */
+void I2CLiquidCrystal::writeNibble(uint8_t bits)
+{
+    bits |= backlight;
+    if (!pending)
+        _bus->startWrite(_address);
+    _bus->write(bits | I2CLCD_EN);
+    _bus->write(bits);
+    pending += 2;
+    if ((pending + 2) > maxBytes) {
+        connected = _bus->endWrite();
+        pending = 0;
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef I2CLiquidCrystal_h
+#define I2CLiquidCrystal_h
+
+#include "utility/LiquidCrystal.h"
+
+class I2CMaster;
+
+class I2CLiquidCrystal : public LiquidCrystal {
+public:
+    explicit I2CLiquidCrystal(I2CMaster &bus, unsigned int address = 0x27);
+
+    void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
+
+    unsigned int address() const { return _address; }
+
+    bool isBacklightOn() const { return backlight != 0; }
+    void backlightOn();
+    void backlightOff();
+
+    bool isConnected() const { return connected; }
+
+#if defined(ARDUINO) && ARDUINO >= 100
+    size_t write(const uint8_t *buffer, size_t size);
+#else
+    void write(const uint8_t *buffer, size_t size);
+#endif
+    using LiquidCrystal::write;
+
+protected:
+    void transmit(uint8_t value, uint8_t mode);
+    void transmitNibble(uint8_t value);
+
+private:
+    I2CMaster *_bus;
+    unsigned int _address;
+    unsigned int maxBytes;
+    unsigned int pending;
+    uint8_t backlight;
+    bool batching;
+    bool connected;
+
+    void startBatch();
+    void endBatch();
+    void writeNibble(uint8_t bits);
+};
+
+#endif
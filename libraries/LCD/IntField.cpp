@@ -49,6 +49,9 @@
  * IntField speedField(mainForm, "Speed", 0, 2000, 15, 450, " rpm");
  * \endcode
  *
+ * The label and suffix can also be placed in program memory to save RAM;
+ * see Field for an example.
+ *
  * \image html FormInt.png
  *
  * Use TextField for read-only fields that report integer values but
@@ -75,6 +78,30 @@ IntField::IntField(const String &label)
     , _stepValue(1)
     , _value(0)
     , _printLen(0)
+    , _flashSuffix(0)
+{
+}
+
+/**
+ * \brief Constructs a new integer field with a specific \a label in
+ * program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * Initially, value() is 0, minValue() is 0, maxValue() is 100,
+ * stepValue() is 1, and suffix() is an empty string.
+ *
+ * \sa Form::addField()
+ */
+IntField::IntField(const __FlashStringHelper *label)
+    : Field(label)
+    , _minValue(0)
+    , _maxValue(100)
+    , _stepValue(1)
+    , _value(0)
+    , _printLen(0)
+    , _flashSuffix(0)
 {
 }
 
@@ -92,6 +119,25 @@ IntField::IntField(Form &form, const String &label, int minValue, int maxValue,
     , _stepValue(stepValue)
     , _value(value)
     , _printLen(0)
+    , _flashSuffix(0)
+{
+}
+
+/**
+ * \brief Constructs a new integer field with a specific \a label in
+ * program memory, \a minValue, \a maxValue, \a stepValue, and \a value,
+ * and attaches it to a \a form.
+ *
+ * The suffix() is initially set to an empty string.
+ */
+IntField::IntField(Form &form, const __FlashStringHelper *label, int minValue, int maxValue, int stepValue, int value)
+    : Field(form, label)
+    , _minValue(minValue)
+    , _maxValue(maxValue)
+    , _stepValue(stepValue)
+    , _value(value)
+    , _printLen(0)
+    , _flashSuffix(0)
 {
 }
 
@@ -108,19 +154,41 @@ IntField::IntField(Form &form, const String &label, int minValue, int maxValue,
     , _value(value)
     , _printLen(0)
     , _suffix(suffix)
+    , _flashSuffix(0)
+{
+}
+
+/**
+ * \brief Constructs a new integer field with a specific \a label,
+ * \a minValue, \a maxValue, \a stepValue, \a value, and \a suffix
+ * and attaches it to a \a form.  The \a label and \a suffix are in
+ * program memory.
+ */
+IntField::IntField(Form &form, const __FlashStringHelper *label, int minValue, int maxValue, int stepValue, int value, const __FlashStringHelper *suffix)
+    : Field(form, label)
+    , _minValue(minValue)
+    , _maxValue(maxValue)
+    , _stepValue(stepValue)
+    , _value(value)
+    , _printLen(0)
+    , _flashSuffix(suffix)
 {
 }
 
 int IntField::dispatch(int event)
 {
-    if (event == LCD_BUTTON_UP) {
-        setValue(_value + _stepValue);
-        return FORM_CHANGED;
-    } else if (event == LCD_BUTTON_DOWN) {
-        setValue(_value - _stepValue);
-        return FORM_CHANGED;
-    }
-    return -1;
+    long step = ((long)_stepValue) * acceleration();
+    if (event == LCD_BUTTON_DOWN)
+        step = -step;
+    else if (event != LCD_BUTTON_UP)
+        return -1;
+    long value = _value + step;
+    if (value < _minValue)
+        value = _minValue;
+    else if (value > _maxValue)
+        value = _maxValue;
+    setValue((int)value);
+    return FORM_CHANGED;
 }
 
 void IntField::enterField(bool reverse)
@@ -209,7 +277,7 @@ void IntField::setValue(int value)
 }
 
 /**
- * \fn const String &IntField::suffix() const
+ * \fn String IntField::suffix() const
  * \brief Returns the suffix string to be displayed after the field's value.
  *
  * \sa setSuffix()
@@ -231,19 +299,49 @@ void IntField::setValue(int value)
 void IntField::setSuffix(const String &suffix)
 {
     _suffix = suffix;
+    _flashSuffix = 0;
+    if (isCurrent())
+        printValue();
+}
+
+/**
+ * \brief Sets the \a suffix string in program memory to be displayed
+ * after the field's value.
+ *
+ * \code
+ * field.setSuffix(F(" rpm"));
+ * \endcode
+ *
+ * \sa suffix()
+ */
+void IntField::setSuffix(const __FlashStringHelper *suffix)
+{
+    _suffix = String();
+    _flashSuffix = suffix;
     if (isCurrent())
         printValue();
 }
 
 void IntField::printValue()
 {
-    String str(_value);
-    if (_suffix.length())
-        str += _suffix;
+    // Format the value directly rather than via String to avoid
+    // allocating memory every time the value changes.
+    char buf[8];
+    unsigned int posn = sizeof(buf);
+    unsigned int value = (_value < 0) ? -(unsigned int)_value : _value;
+    do {
+        buf[--posn] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    if (_value < 0)
+        buf[--posn] = '-';
     lcd()->setCursor(0, 1);
-    lcd()->print(str);
-    unsigned int len = str.length();
+    unsigned int len = sizeof(buf) - posn;
+    while (posn < sizeof(buf))
+        lcd()->write(buf[posn++]);
+    len += printString(_suffix, _flashSuffix);
+    unsigned int newLen = len;
     while (len++ < _printLen)
         lcd()->write(' ');
-    _printLen = str.length();
+    _printLen = newLen;
 }
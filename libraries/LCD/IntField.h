@@ -28,8 +28,11 @@
 class IntField : public Field {
 public:
     explicit IntField(const String &label);
+    explicit IntField(const __FlashStringHelper *label);
     IntField(Form &form, const String &label, int minValue, int maxValue, int stepValue, int value);
+    IntField(Form &form, const __FlashStringHelper *label, int minValue, int maxValue, int stepValue, int value);
     IntField(Form &form, const String &label, int minValue, int maxValue, int stepValue, int value, const String &suffix);
+    IntField(Form &form, const __FlashStringHelper *label, int minValue, int maxValue, int stepValue, int value, const __FlashStringHelper *suffix);
 
     int dispatch(int event);
 
@@ -47,8 +50,9 @@ public:
     int value() const { return _value; }
     void setValue(int value);
 
-    const String &suffix() const { return _suffix; }
+    String suffix() const { return stringValue(_suffix, _flashSuffix); }
     void setSuffix(const String &suffix);
+    void setSuffix(const __FlashStringHelper *suffix);
 
 private:
     int _minValue;
@@ -57,6 +61,7 @@ private:
     int _value;
     int _printLen;
     String _suffix;
+    const __FlashStringHelper *_flashSuffix;
 
     void printValue();
 };
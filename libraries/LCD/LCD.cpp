@@ -22,6 +22,12 @@
 
 #include "LCD.h"
 #include <avr/pgmspace.h>
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
@@ -32,6 +38,7 @@
 #define LCD_BUTTON_PIN          A0       // Button state is on A0
 
 #define DEBOUNCE_DELAY          10      // Delay in ms to debounce buttons
+#define SLEEP_GRACE             (DEBOUNCE_DELAY * 2) // Awake time between sleeps
 
 /**
  * \class LCD LCD.h <LCD.h>
@@ -91,6 +98,120 @@
  * The back light pin is configured for output the first time the
  * application calls getButton().
  *
+ * \section lcd_shadow Shadow buffer
+ *
+ * Each character that is written to the LCD takes around 100
+ * microseconds to send, but most updates to a Form only change a few of
+ * the characters on the screen.  When enableShadow() is called, the LCD
+ * keeps a copy of the characters that are on the screen and only sends
+ * the characters that have changed, moving the cursor only when
+ * necessary to skip over characters that are already correct:
+ *
+ * \code
+ * LCD lcd;
+ *
+ * void setup() {
+ *     lcd.enableShadow();
+ * }
+ * \endcode
+ *
+ * The shadow buffer assumes that text is written left to right with
+ * autoscroll turned off, which is how Form and Field use the display.
+ * If the cursor is visible, then the application should call setCursor()
+ * after printing to position it, as skipped characters do not move the
+ * hardware cursor.
+ *
+ * \section lcd_queue Asynchronous output
+ *
+ * Normally every character and command is sent to the LCD immediately,
+ * stalling the caller for around 100 microseconds each and for 2
+ * milliseconds for clear().  When enableQueue() is called, they are
+ * placed into a queue instead and loop() sends them one at a time as
+ * the LCD becomes ready.  loop() can be called from the application's
+ * main loop or from a timer interrupt:
+ *
+ * \code
+ * LCD lcd;
+ *
+ * void setup() {
+ *     lcd.enableQueue();
+ * }
+ *
+ * void loop() {
+ *     lcd.loop();
+ *     ...
+ * }
+ * \endcode
+ *
+ * If the queue fills up, then the caller waits for room.  Call flush()
+ * to wait for everything in the queue to be sent.
+ *
+ * \section lcd_button_scan Background button scanning
+ *
+ * getButton() normally reads the buttons with <tt>analogRead()</tt>,
+ * which stalls the caller for around 100 microseconds per call, and
+ * the quality of the debouncing depends upon how often the application
+ * calls it.  When enableButtonScan() is called, the buttons are sampled
+ * by scanButtons() from a periodic interrupt instead.  Each change in
+ * button state is debounced and placed into a small queue, and
+ * getButton() simply removes the next event from the queue:
+ *
+ * \code
+ * LCD lcd;
+ *
+ * ISR(TIMER0_COMPB_vect)
+ * {
+ *     lcd.scanButtons();
+ * }
+ *
+ * void setup() {
+ *     lcd.enableButtonScan();
+ * }
+ * \endcode
+ *
+ * enableButtonScan() uses the spare compare-B interrupt on Timer0, which
+ * fires once every 1.024 milliseconds without disturbing
+ * <tt>millis()</tt>.  scanButtons() can instead be called from some other
+ * periodic interrupt, such as the one that refreshes a DMD display.
+ * While scanning is enabled, the application must not call
+ * <tt>analogRead()</tt> because scanButtons() owns the ADC.
+ *
+ * Button scanning can also generate auto-repeat events while a button is
+ * held down; see setButtonRepeat().
+ *
+ * \section lcd_sleep Sleeping while the screen is saved
+ *
+ * Battery-powered sketches can put the CPU to sleep while the screen saver
+ * is active.  The application supplies a function that sleeps for a short
+ * period, usually with sleepFor() from the \ref power_save "PowerSave"
+ * library, and getButton() calls it instead of returning straight away
+ * whenever the screen is saved and no button is pressed:
+ *
+ * \code
+ * #include <PowerSave.h>
+ *
+ * void lcdSleep(LCD *lcd)
+ * {
+ *     sleepFor(SLEEP_120_MS, SLEEP_MODE_PWR_DOWN);
+ * }
+ *
+ * void setup() {
+ *     lcd.enableScreenSaver();
+ *     lcd.setSleepCallback(lcdSleep);
+ * }
+ * \endcode
+ *
+ * Each time the CPU wakes up, getButton() stays awake for long enough to
+ * see whether a button has been pressed, and then sleeps again.  A press
+ * therefore takes up to one sleep period to be noticed.  The rest of
+ * <tt>loop()</tt> still runs once per period, and <tt>millis()</tt> does
+ * not advance while the CPU is in power-down mode.
+ *
+ * The buttons share a single analog input, and the voltages for some of
+ * them are not low enough to be read as a digital LOW.  A pin change
+ * interrupt therefore cannot reliably wake the CPU, so the watchdog timer
+ * that sleepFor() uses is relied upon instead.
+ *
  * \sa Form, \ref lcd_hello_world "Hello World Example"
  */
 
@@ -141,9 +262,31 @@
  * \endcode
  */
 
+/**
+ * \fn LCD::LCD(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+ * \brief Initialize the LCD display with custom pins, including a
+ * R/W pin.
+ *
+ * When the R/W line of the LCD is connected to a pin rather than to
+ * ground, each command waits for the LCD's busy flag to clear instead
+ * of waiting for the worst-case execution time.  This makes clear()
+ * in particular much faster.  The Freetronics LCD shield ties R/W to
+ * ground, so this constructor is only useful with custom wiring.
+ *
+ * \code
+ * LCD lcd(8,10,9,4,5,6,7);
+ * \endcode
+ */
+
 
 void LCD::init()
 {
+    // The shadow buffer and queue are off until they are enabled.
+    shadow = 0;
+    queue = 0;
+    col = row = 0;
+    hwCol = hwRow = 0;
+
     // The Freetronics display is 16x2.
     begin(16, 2);
 
@@ -166,6 +309,45 @@ void LCD::init()
     lastRestore = millis();
     screenSaved = false;
     mode = DisplayOff;
+    sleepCallback = 0;
+    lastWake = 0;
+
+    // Background button scanning is off until it is enabled.
+    scanning = false;
+    scanButton = LCD_BUTTON_NONE;
+    scanRepeat = 0;
+    repeatDelay = 0;
+    repeatRate = 0;
+    eventHead = eventTail = 0;
+}
+
+/**
+ * \brief Destroys this LCD object.
+ */
+LCD::~LCD()
+{
+    disableButtonScan();
+    disableQueue();
+    if (shadow)
+        free(shadow);
+}
+
+/**
+ * \brief Initializes the LCD to \a cols columns and \a rows rows, with
+ * the character size \a charsize.
+ *
+ * The LCD constructors call begin(16, 2), which is correct for the
+ * Freetronics LCD shield.  The display is cleared.
+ */
+void LCD::begin(uint8_t cols, uint8_t rows, uint8_t charsize)
+{
+    bool hadShadow = (shadow != 0);
+    disableShadow();
+    numCols = cols;
+    numRows = rows;
+    LiquidCrystal::begin(cols, rows, charsize);
+    if (hadShadow)
+        enableShadow();
 }
 
 /**
@@ -333,6 +515,36 @@ void LCD::disableScreenSaver()
  * \sa enableScreenSaver()
  */
 
+/**
+ * \typedef LCD::SleepCallback
+ * \brief Type of a function that is called by getButton() to put the
+ * CPU to sleep while the screen is saved.
+ *
+ * The function is passed a pointer to the LCD and should sleep for a
+ * short period, typically between 60 milliseconds and 1 second.
+ *
+ * \sa setSleepCallback()
+ */
+
+/**
+ * \fn void LCD::setSleepCallback(SleepCallback callback)
+ * \brief Sets the \a callback function that getButton() calls to put the
+ * CPU to sleep while the screen saver is active.
+ *
+ * The \a callback may be null to disable sleeping, which is the default.
+ *
+ * \code
+ * void lcdSleep(LCD *lcd)
+ * {
+ *     sleepFor(SLEEP_120_MS, SLEEP_MODE_PWR_DOWN);
+ * }
+ *
+ * lcd.setSleepCallback(lcdSleep);
+ * \endcode
+ *
+ * \sa enableScreenSaver(), getButton(), sleepFor()
+ */
+
 // Button mapping table generated by genlookup.c
 static unsigned char const buttonMappings[] PROGMEM = {
     2, 0, 0, 0, 3, 0, 0, 0, 0, 4, 4, 0, 0, 0, 0, 1,
@@ -363,7 +575,12 @@ static unsigned char const buttonMappings[] PROGMEM = {
  * This function debounces the button state automatically so there is no
  * need for the caller to worry about spurious button events.
  *
- * \sa enableScreenSaver(), display(), Form::dispatch()
+ * If enableButtonScan() has been called, then this function returns the
+ * next event that was queued by scanButtons() without reading the
+ * buttons itself.  Auto-repeat events are reported as further presses
+ * of the held button, with no intervening release.
+ *
+ * \sa enableScreenSaver(), display(), Form::dispatch(), enableButtonScan()
  */
 int LCD::getButton()
 {
@@ -371,16 +588,33 @@ int LCD::getButton()
     if (!backlightInit)
         display();
 
-    // Read the currently pressed button.
-    int button = mapButton(analogRead(LCD_BUTTON_PIN));
-
-    // Debounce the button state.
+    int button;
     unsigned long currentTime = millis();
-    if (button != debounceButton)
-        lastDebounce = currentTime;
-    debounceButton = button;
-    if ((currentTime - lastDebounce) < DEBOUNCE_DELAY)
-        button = prevButton;
+    if (scanning) {
+        // Fetch the next debounced event from scanButtons().
+        int event = popButton();
+        if (event > 0 && prevButton != LCD_BUTTON_NONE) {
+            // Auto-repeat of the button that is already held down.
+            lastRestore = currentTime;
+            return eatRelease ? LCD_BUTTON_NONE : event;
+        } else if (event > 0) {
+            button = event;
+        } else if (event < 0) {
+            button = LCD_BUTTON_NONE;
+        } else {
+            button = prevButton;
+        }
+    } else {
+        // Read the currently pressed button.
+        button = mapButton(analogRead(LCD_BUTTON_PIN));
+
+        // Debounce the button state.
+        if (button != debounceButton)
+            lastDebounce = currentTime;
+        debounceButton = button;
+        if ((currentTime - lastDebounce) < DEBOUNCE_DELAY)
+            button = prevButton;
+    }
 
     // Process the button event if the state has changed.
     if (prevButton == LCD_BUTTON_NONE && button != LCD_BUTTON_NONE) {
@@ -420,8 +654,418 @@ int LCD::getButton()
         return button;
     } else {
         if (!screenSaved && prevButton == LCD_BUTTON_NONE &&
-                timeout != 0 && (currentTime - lastRestore) >= timeout)
+                timeout != 0 && (currentTime - lastRestore) >= timeout) {
             noDisplay();    // Activate screen saver.
+            lastWake = currentTime;
+        } else if (screenSaved && sleepCallback &&
+                   prevButton == LCD_BUTTON_NONE &&
+                   debounceButton == LCD_BUTTON_NONE &&
+                   (currentTime - lastWake) >= SLEEP_GRACE) {
+            // Nothing is happening, so let the application sleep.
+            sleepCallback(this);
+            lastWake = millis();
+        }
         return LCD_BUTTON_NONE;
     }
 }
+
+/**
+ * \brief Enables the shadow buffer so that only the characters that
+ * have changed are sent to the LCD.
+ *
+ * The display is cleared so that the shadow buffer starts off in sync
+ * with the screen.  If there is insufficient memory for the shadow
+ * buffer, then the LCD continues to send every character.
+ *
+ * \sa disableShadow(), isShadowed()
+ */
+void LCD::enableShadow()
+{
+    if (shadow)
+        return;
+    shadow = (uint8_t *)malloc(numCols * numRows);
+    if (shadow)
+        clear();
+}
+
+/**
+ * \brief Disables the shadow buffer and frees its memory.
+ *
+ * \sa enableShadow(), isShadowed()
+ */
+void LCD::disableShadow()
+{
+    if (!shadow)
+        return;
+    free(shadow);
+    shadow = 0;
+    if (hwCol != col || hwRow != row)
+        LiquidCrystal::setCursor(col, row);
+}
+
+/**
+ * \fn bool LCD::isShadowed() const
+ * \brief Returns true if the shadow buffer is enabled; false otherwise.
+ *
+ * \sa enableShadow()
+ */
+
+/**
+ * \brief Clears the display and moves the cursor to the top-left corner.
+ *
+ * \sa home(), setCursor()
+ */
+void LCD::clear()
+{
+    LiquidCrystal::clear();
+    if (shadow)
+        memset(shadow, ' ', numCols * numRows);
+    col = row = 0;
+    hwCol = hwRow = 0;
+}
+
+/**
+ * \brief Moves the cursor to the top-left corner and undoes any shifts
+ * of the display.
+ *
+ * \sa clear(), setCursor()
+ */
+void LCD::home()
+{
+    LiquidCrystal::home();
+    col = row = 0;
+    hwCol = hwRow = 0;
+}
+
+/**
+ * \brief Moves the cursor to \a col and \a row.
+ *
+ * If the shadow buffer is enabled and the LCD's cursor is already at the
+ * position, then no command is sent.
+ *
+ * \sa clear(), enableShadow()
+ */
+void LCD::setCursor(uint8_t col, uint8_t row)
+{
+    if (row >= numRows)
+        row = numRows - 1;
+    this->col = col;
+    this->row = row;
+    if (!shadow || hwCol != col || hwRow != row) {
+        LiquidCrystal::setCursor(col, row);
+        hwCol = col;
+        hwRow = row;
+    }
+}
+
+/**
+ * \brief Defines the custom character at \a location to \a charmap.
+ *
+ * After this call, the next character that is written will be sent
+ * with a cursor position to return to the display memory.
+ */
+void LCD::createChar(uint8_t location, uint8_t charmap[])
+{
+    // The bitmap is sent with write(), which must bypass the shadow buffer.
+    uint8_t *saved = shadow;
+    shadow = 0;
+    LiquidCrystal::createChar(location, charmap);
+    shadow = saved;
+    hwCol = 0xFF;   // The LCD's address now points into character memory.
+}
+
+/**
+ * \brief Writes the character \a c at the cursor position and moves the
+ * cursor one position to the right.
+ *
+ * If the shadow buffer is enabled and \a c is already on the screen at
+ * the cursor position, then nothing is sent to the LCD.
+ *
+ * \sa enableShadow()
+ */
+#if defined(ARDUINO) && ARDUINO >= 100
+size_t LCD::write(uint8_t c)
+#else
+void LCD::write(uint8_t c)
+#endif
+{
+    if (shadow) {
+        if (col < numCols) {
+            uint8_t *cell = shadow + row * numCols + col;
+            if (*cell == c) {
+                ++col;
+#if defined(ARDUINO) && ARDUINO >= 100
+                return 1;
+#else
+                return;
+#endif
+            }
+            *cell = c;
+        }
+        if (hwCol != col || hwRow != row)
+            LiquidCrystal::setCursor(col, row);
+        ++col;
+        hwCol = col;
+        hwRow = row;
+    }
+#if defined(ARDUINO) && ARDUINO >= 100
+    return LiquidCrystal::write(c);
+#else
+    LiquidCrystal::write(c);
+#endif
+}
+
+/**
+ * \brief Enables asynchronous output with a queue of \a size entries.
+ *
+ * Each entry takes two bytes of memory.  If there is insufficient memory
+ * for the queue, then output remains synchronous.
+ *
+ * \sa disableQueue(), loop(), flush()
+ */
+void LCD::enableQueue(uint8_t size)
+{
+    if (queue || size < 2)
+        return;
+    queue = (uint16_t *)malloc(size * sizeof(uint16_t));
+    if (queue)
+        setQueue(queue, size);
+}
+
+/**
+ * \brief Sends anything that is still in the queue and then returns
+ * to synchronous output.
+ *
+ * \sa enableQueue()
+ */
+void LCD::disableQueue()
+{
+    if (!queue)
+        return;
+    setQueue(0, 0);
+    free(queue);
+    queue = 0;
+}
+
+/**
+ * \fn bool LCD::isQueued() const
+ * \brief Returns true if asynchronous output is enabled; false otherwise.
+ *
+ * \sa enableQueue()
+ */
+
+/**
+ * \fn void LCD::loop()
+ * \brief Sends the next queued command or character if the LCD is ready
+ * for it.
+ *
+ * This function never waits, so it can be called from the application's
+ * main loop or from a timer interrupt service routine.  It does nothing
+ * if asynchronous output is not enabled.
+ *
+ * \sa enableQueue(), flush()
+ */
+
+/**
+ * \fn void LCD::flush()
+ * \brief Waits until all queued commands and characters have been sent.
+ *
+ * \sa enableQueue(), loop()
+ */
+
+/**
+ * \brief Enables background scanning of the buttons.
+ *
+ * The ADC is configured to sample the button input, and the compare-B
+ * interrupt on Timer0 is enabled.  The application must provide an
+ * interrupt service routine that calls scanButtons():
+ *
+ * \code
+ * ISR(TIMER0_COMPB_vect)
+ * {
+ *     lcd.scanButtons();
+ * }
+ * \endcode
+ *
+ * Any button events that have not been fetched by getButton() are
+ * discarded.
+ *
+ * \sa disableButtonScan(), scanButtons(), getButton()
+ */
+void LCD::enableButtonScan()
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    scanButton = prevButton;
+    debounceButton = prevButton;
+    lastDebounce = millis();
+    eventHead = eventTail = 0;
+    scanning = true;
+#if defined(__AVR__)
+    // Select the button input, referenced to AVcc, and start the
+    // first conversion.  The ADC clock has already been set up by
+    // the Arduino core.
+    uint8_t channel = LCD_BUTTON_PIN;
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+    if (channel >= 54)
+        channel -= 54;
+#else
+    if (channel >= 14)
+        channel -= 14;
+#endif
+    ADMUX = _BV(REFS0) | (channel & 0x07);
+    ADCSRA |= _BV(ADEN) | _BV(ADSC);
+
+    // Piggy-back on Timer0, which is already running for millis().
+    OCR0B = 0x80;
+    TIFR0 = _BV(OCF0B);
+    TIMSK0 |= _BV(OCIE0B);
+#endif
+    SREG = oldSREG;
+}
+
+/**
+ * \brief Disables background scanning of the buttons and returns to
+ * reading them with <tt>analogRead()</tt> in getButton().
+ *
+ * \sa enableButtonScan()
+ */
+void LCD::disableButtonScan()
+{
+    if (!scanning)
+        return;
+    uint8_t oldSREG = SREG;
+    cli();
+#if defined(__AVR__)
+    TIMSK0 &= ~_BV(OCIE0B);
+#endif
+    scanning = false;
+    SREG = oldSREG;
+#if defined(__AVR__)
+    // Let any conversion in progress finish so that analogRead()
+    // does not pick up a stale result.
+    while (ADCSRA & _BV(ADSC))
+        ;
+#endif
+}
+
+/**
+ * \fn bool LCD::isButtonScanned() const
+ * \brief Returns true if the buttons are being scanned in the background.
+ *
+ * \sa enableButtonScan()
+ */
+
+/**
+ * \brief Sets the auto-repeat parameters for background button scanning.
+ *
+ * When a button is held down for \a delay milliseconds, scanButtons()
+ * queues a further press event for it every \a rate milliseconds until
+ * it is released.  If \a delay or \a rate is zero, then auto-repeat is
+ * disabled, which is the default.
+ *
+ * \code
+ * lcd.setButtonRepeat(500, 100);
+ * \endcode
+ *
+ * \sa enableButtonScan(), getButton()
+ */
+void LCD::setButtonRepeat(unsigned int delay, unsigned int rate)
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    if (delay && rate) {
+        repeatDelay = delay;
+        repeatRate = rate;
+    } else {
+        repeatDelay = 0;
+        repeatRate = 0;
+    }
+    SREG = oldSREG;
+}
+
+/**
+ * \brief Samples the buttons and queues any debounced change in state.
+ *
+ * This function is intended to be called from an interrupt service
+ * routine around once a millisecond.  It does not wait for the ADC;
+ * if the previous conversion has not finished yet, it returns
+ * immediately.  Each call collects the result of the previous
+ * conversion and then starts the next one.
+ *
+ * \sa enableButtonScan(), getButton()
+ */
+void LCD::scanButtons()
+{
+    if (!scanning)
+        return;
+#if defined(__AVR__)
+    if (ADCSRA & _BV(ADSC))
+        return;
+    int value = ADC;
+    ADCSRA |= _BV(ADSC);
+    processButton(mapButton(value), millis());
+#endif
+}
+
+/**
+ * \internal
+ * \brief Runs the debounce state machine for a new raw \a button
+ * sample that was taken at \a currentTime.
+ */
+void LCD::processButton(int button, unsigned long currentTime)
+{
+    if (button != debounceButton) {
+        // Input is still changing; wait for it to settle.
+        debounceButton = button;
+        lastDebounce = currentTime;
+        return;
+    }
+    if (button != scanButton) {
+        if ((currentTime - lastDebounce) < DEBOUNCE_DELAY)
+            return;
+        if (scanButton != LCD_BUTTON_NONE)
+            queueButton(-scanButton);
+        if (button != LCD_BUTTON_NONE)
+            queueButton(button);
+        scanButton = button;
+        scanRepeat = currentTime + repeatDelay;
+    } else if (button != LCD_BUTTON_NONE && repeatDelay &&
+               ((long)(currentTime - scanRepeat)) >= 0) {
+        queueButton(button);
+        scanRepeat = currentTime + repeatRate;
+    }
+}
+
+/**
+ * \internal
+ * \brief Adds \a button to the event queue, dropping it if the queue
+ * is full.
+ */
+void LCD::queueButton(int button)
+{
+    uint8_t next = eventTail + 1;
+    if (next >= LCD_BUTTON_QUEUE_SIZE)
+        next = 0;
+    if (next == eventHead)
+        return;
+    events[eventTail] = (int8_t)button;
+    eventTail = next;
+}
+
+/**
+ * \internal
+ * \brief Removes the next event from the queue, or returns
+ * LCD_BUTTON_NONE if the queue is empty.
+ */
+int LCD::popButton()
+{
+    uint8_t head = eventHead;
+    if (head == eventTail)
+        return LCD_BUTTON_NONE;
+    int button = events[head];
+    if (++head >= LCD_BUTTON_QUEUE_SIZE)
+        head = 0;
+    eventHead = head;
+    return button;
+}
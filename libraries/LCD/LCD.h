@@ -45,6 +45,11 @@
 #define LCD_BUTTON_DOWN_RELEASED    -4
 #define LCD_BUTTON_SELECT_RELEASED  -5
 
+// Number of button events that can be queued by scanButtons().
+#if !defined(LCD_BUTTON_QUEUE_SIZE)
+#define LCD_BUTTON_QUEUE_SIZE       8
+#endif
+
 class LCD : public LiquidCrystal {
 public:
     LCD() : LiquidCrystal(8, 9, 4, 5, 6, 7) { init(); }
@@ -52,6 +57,12 @@ public:
     LCD(uint8_t rs, uint8_t enable,
         uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
       : LiquidCrystal(rs, enable, d0, d1, d2, d3) { init(); }
+    LCD(uint8_t rs, uint8_t rw, uint8_t enable,
+        uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+      : LiquidCrystal(rs, rw, enable, d0, d1, d2, d3) { init(); }
+    ~LCD();
+
+    void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
 
     uint8_t backlightPin() const { return _backlightPin; }
     void setBacklightPin(uint8_t pin);
@@ -73,8 +84,38 @@ public:
     void disableScreenSaver();
     bool isScreenSaved() const { return screenSaved; }
 
+    typedef void (*SleepCallback)(LCD *lcd);
+    void setSleepCallback(SleepCallback callback) { sleepCallback = callback; }
+
     int getButton();
 
+    void enableButtonScan();
+    void disableButtonScan();
+    bool isButtonScanned() const { return scanning; }
+    void setButtonRepeat(unsigned int delay, unsigned int rate);
+    void scanButtons();
+
+    void enableShadow();
+    void disableShadow();
+    bool isShadowed() const { return shadow != 0; }
+
+    void enableQueue(uint8_t size = 32);
+    void disableQueue();
+    bool isQueued() const { return queue != 0; }
+    void loop() { drainQueue(); }
+    void flush() { flushQueue(); }
+
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void createChar(uint8_t location, uint8_t charmap[]);
+#if defined(ARDUINO) && ARDUINO >= 100
+    size_t write(uint8_t c);
+#else
+    void write(uint8_t c);
+#endif
+    using LiquidCrystal::write;
+
 private:
     uint8_t _backlightPin;
     bool backlightInit;
@@ -84,10 +125,33 @@ private:
     unsigned long lastRestore;
     unsigned long lastDebounce;
     bool screenSaved;
+    SleepCallback sleepCallback;
+    unsigned long lastWake;
     bool eatRelease;
     ScreenSaverMode mode;
+    uint8_t *shadow;
+    uint16_t *queue;
+    uint8_t numCols;
+    uint8_t numRows;
+    uint8_t col;
+    uint8_t row;
+    uint8_t hwCol;
+    uint8_t hwRow;
+    bool scanning;
+    int8_t scanButton;
+    unsigned long scanRepeat;
+    unsigned int repeatDelay;
+    unsigned int repeatRate;
+    volatile int8_t events[LCD_BUTTON_QUEUE_SIZE];
+    volatile uint8_t eventHead;
+    volatile uint8_t eventTail;
 
     void init();
+    void processButton(int button, unsigned long currentTime);
+    void queueButton(int button);
+    int popButton();
+
+    friend class GlyphCache;
 };
 
 #endif
@@ -70,6 +70,26 @@ ListField::ListField(const String &label)
 {
 }
 
+/**
+ * \brief Constructs a new list field with a specific \a label in
+ * program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * Initially, items() is null and value() is -1.
+ *
+ * \sa Form::addField()
+ */
+ListField::ListField(const __FlashStringHelper *label)
+    : Field(label)
+    , _items(0)
+    , _itemCount(0)
+    , _value(-1)
+    , _printLen(0)
+{
+}
+
 /**
  * \brief Constructs a new list field with a specific \a label,
  * list of \a items, and \a value, and attaches it to a \a form.
@@ -84,6 +104,21 @@ ListField::ListField(Form &form, const String &label, ListItems items, int value
     setItems(items);
 }
 
+/**
+ * \brief Constructs a new list field with a specific \a label in
+ * program memory, list of \a items, and \a value, and attaches it
+ * to a \a form.
+ */
+ListField::ListField(Form &form, const __FlashStringHelper *label, ListItems items, int value)
+    : Field(form, label)
+    , _items(0)
+    , _itemCount(0)
+    , _value(value)
+    , _printLen(0)
+{
+    setItems(items);
+}
+
 int ListField::dispatch(int event)
 {
     if (event == LCD_BUTTON_DOWN) {
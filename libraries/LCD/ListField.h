@@ -32,7 +32,9 @@ typedef const PROGMEM ListItem *ListItems;
 class ListField : public Field {
 public:
     explicit ListField(const String &label);
+    explicit ListField(const __FlashStringHelper *label);
     ListField(Form &form, const String &label, ListItems items, int value = 0);
+    ListField(Form &form, const __FlashStringHelper *label, ListItems items, int value = 0);
 
     int dispatch(int event);
 
@@ -68,6 +68,22 @@ TextField::TextField(const String &label)
 {
 }
 
+/**
+ * \brief Constructs a new text field with a specific \a label in
+ * program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * The initial value() will be the empty string.
+ *
+ * \sa Form::addField()
+ */
+TextField::TextField(const __FlashStringHelper *label)
+    : Field(label)
+{
+}
+
 /**
  * \brief Constructs a new text field with a specific \a label and \a value
  * attaches it to a \a form.
@@ -80,6 +96,18 @@ TextField::TextField(Form &form, const String &label, const String &value)
 {
 }
 
+/**
+ * \brief Constructs a new text field with a specific \a label in
+ * program memory and \a value, and attaches it to a \a form.
+ *
+ * \sa value()
+ */
+TextField::TextField(Form &form, const __FlashStringHelper *label, const String &value)
+    : Field(form, label)
+    , _value(value)
+{
+}
+
 void TextField::enterField(bool reverse)
 {
     Field::enterField(reverse);
@@ -28,7 +28,9 @@
 class TextField : public Field {
 public:
     explicit TextField(const String &label);
+    explicit TextField(const __FlashStringHelper *label);
     TextField(Form &form, const String &label, const String &value);
+    TextField(Form &form, const __FlashStringHelper *label, const String &value);
 
     void enterField(bool reverse);
 
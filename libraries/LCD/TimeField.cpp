@@ -89,6 +89,28 @@ TimeField::TimeField(const String &label)
 {
 }
 
+/**
+ * \brief Constructs a new time field with a specific \a label in
+ * program memory.
+ *
+ * The field is initially not associated with a Form.  The field can be
+ * added to a form later using Form::addField().
+ *
+ * Initially value() is 0, maxHours() is 24, and isReadOnly() is
+ * TIMEFIELD_READ_WRITE.
+ *
+ * \sa Form::addField()
+ */
+TimeField::TimeField(const __FlashStringHelper *label)
+    : Field(label)
+    , _value(0)
+    , _maxHours(24)
+    , _printLen(0)
+    , _readOnly(false)
+    , editField(EDIT_HOUR)
+{
+}
+
 /**
  * \brief Constructs a new boolean field with a specific \a label and
  * attaches it to a \a form.
@@ -112,6 +134,29 @@ TimeField::TimeField(Form &form, const String &label, int maxHours, bool readOnl
 {
 }
 
+/**
+ * \brief Constructs a new time field with a specific \a label in
+ * program memory and attaches it to a \a form.
+ *
+ * The initial value() of the field will be 0.  The value() will be limited
+ * to be less than \a maxHours * 60 * 60 seconds.
+ *
+ * If \a readOnly is TIMEFIELD_READ_ONLY, then the field will display times
+ * but not allow them to be modified by the user.  If \a readOnly is
+ * TIMEFIELD_READ_WRITE, then the field will modifiable by the user.
+ *
+ * \sa value()
+ */
+TimeField::TimeField(Form &form, const __FlashStringHelper *label, int maxHours, bool readOnly)
+    : Field(form, label)
+    , _value(0)
+    , _maxHours(maxHours)
+    , _printLen(0)
+    , _readOnly(readOnly)
+    , editField(EDIT_HOUR)
+{
+}
+
 int TimeField::dispatch(int event)
 {
     unsigned long newValue;
@@ -119,58 +164,62 @@ int TimeField::dispatch(int event)
         return -1;
     if (event == LCD_BUTTON_UP) {
         newValue = _value;
-        if (editField == EDIT_HOUR) {
-            newValue += 60 * 60;
-        } else if (editField == EDIT_MINUTE_TENS) {
-            if (((newValue / 60) % 60) >= 50)
-                newValue -= 50 * 60;
-            else
-                newValue += 10 * 60;
-        } else if (editField == EDIT_MINUTE) {
-            if (((newValue / 60) % 60) == 59)
-                newValue -= 59 * 60;
-            else
-                newValue += 60;
-        } else if (editField == EDIT_SECOND_TENS) {
-            if ((newValue % 60) >= 50)
-                newValue -= 50;
-            else
-                newValue += 10;
-        } else {
-            if ((newValue % 60) == 59)
-                newValue -= 59;
-            else
-                newValue += 1;
+        for (int step = acceleration(); step > 0; --step) {
+            if (editField == EDIT_HOUR) {
+                newValue += 60 * 60;
+            } else if (editField == EDIT_MINUTE_TENS) {
+                if (((newValue / 60) % 60) >= 50)
+                    newValue -= 50 * 60;
+                else
+                    newValue += 10 * 60;
+            } else if (editField == EDIT_MINUTE) {
+                if (((newValue / 60) % 60) == 59)
+                    newValue -= 59 * 60;
+                else
+                    newValue += 60;
+            } else if (editField == EDIT_SECOND_TENS) {
+                if ((newValue % 60) >= 50)
+                    newValue -= 50;
+                else
+                    newValue += 10;
+            } else {
+                if ((newValue % 60) == 59)
+                    newValue -= 59;
+                else
+                    newValue += 1;
+            }
         }
         setValue(newValue);
         return FORM_CHANGED;
     } else if (event == LCD_BUTTON_DOWN) {
         newValue = _value;
-        if (editField == EDIT_HOUR) {
-            if (newValue < 60 * 60)
-                newValue += ((unsigned long)(_maxHours - 1)) * 60 * 60;
-            else
-                newValue -= 60 * 60;
-        } else if (editField == EDIT_MINUTE_TENS) {
-            if (((newValue / 60) % 60) < 10)
-                newValue += 50 * 60;
-            else
-                newValue -= 10 * 60;
-        } else if (editField == EDIT_MINUTE) {
-            if (((newValue / 60) % 60) == 0)
-                newValue += 59 * 60;
-            else
-                newValue -= 60;
-        } else if (editField == EDIT_SECOND_TENS) {
-            if ((newValue % 60) < 10)
-                newValue += 50;
-            else
-                newValue -= 10;
-        } else {
-            if ((newValue % 60) == 0)
-                newValue += 59;
-            else
-                newValue -= 1;
+        for (int step = acceleration(); step > 0; --step) {
+            if (editField == EDIT_HOUR) {
+                if (newValue < 60 * 60)
+                    newValue += ((unsigned long)(_maxHours - 1)) * 60 * 60;
+                else
+                    newValue -= 60 * 60;
+            } else if (editField == EDIT_MINUTE_TENS) {
+                if (((newValue / 60) % 60) < 10)
+                    newValue += 50 * 60;
+                else
+                    newValue -= 10 * 60;
+            } else if (editField == EDIT_MINUTE) {
+                if (((newValue / 60) % 60) == 0)
+                    newValue += 59 * 60;
+                else
+                    newValue -= 60;
+            } else if (editField == EDIT_SECOND_TENS) {
+                if ((newValue % 60) < 10)
+                    newValue += 50;
+                else
+                    newValue -= 10;
+            } else {
+                if ((newValue % 60) == 0)
+                    newValue += 59;
+                else
+                    newValue -= 1;
+            }
         }
         setValue(newValue);
         return FORM_CHANGED;
@@ -31,7 +31,9 @@
 class TimeField : public Field {
 public:
     explicit TimeField(const String &label);
+    explicit TimeField(const __FlashStringHelper *label);
     TimeField(Form &form, const String &label, int maxHours, bool readOnly);
+    TimeField(Form &form, const __FlashStringHelper *label, int maxHours, bool readOnly);
 
     int dispatch(int event);
 
@@ -8,6 +8,14 @@
 #else
 #include <WProgram.h>
 #endif
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+
+// flags for entries in the asynchronous output queue
+#define LCD_QUEUE_DATA 0x0100   // send with RS high
+#define LCD_QUEUE_SLOW 0x0200   // clear/home, which take up to 1.52ms
 
 // When the display powers up, it is configured as follows:
 //
@@ -54,12 +62,42 @@ LiquidCrystal::LiquidCrystal(uint8_t rs,  uint8_t enable,
   init(1, rs, 255, enable, d0, d1, d2, d3, 0, 0, 0, 0);
 }
 
+// for subclasses that talk to the controller some other way, such as
+// over I2C.  they must override transmit() and transmitNibble().
+LiquidCrystal::LiquidCrystal()
+{
+  _rs_pin = 255;
+  _rw_pin = 255;
+  _enable_pin = 255;
+  _pollbusy = 0;
+  _queue = 0;
+  _qsize = 0;
+  _qhead = _qtail = 0;
+  _qdraining = 0;
+  _qtime = 0;
+  _qwait = 0;
+  _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+  _numlines = 1;
+  _currline = 0;
+#if defined(__AVR__)
+  _dataport = 0;
+  _datamode = 0;
+#endif
+}
+
 void LiquidCrystal::init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t enable,
 			 uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
 			 uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
 {
   _rs_pin = rs;
   _rw_pin = rw;
+  _pollbusy = 0;
+  _queue = 0;
+  _qsize = 0;
+  _qhead = _qtail = 0;
+  _qdraining = 0;
+  _qtime = 0;
+  _qwait = 0;
   _enable_pin = enable;
   
   _data_pins[0] = d0;
@@ -77,6 +115,31 @@ void LiquidCrystal::init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t en
     pinMode(_rw_pin, OUTPUT);
   }
   pinMode(_enable_pin, OUTPUT);
+
+#if defined(__AVR__)
+  // if all of the data pins are on the same port, then each nibble or
+  // byte can be written with a single masked register update
+  uint8_t count = fourbitmode ? 4 : 8;
+  uint8_t port = digitalPinToPort(_data_pins[0]);
+  uint8_t i;
+  _dataport = 0;
+  _datamode = 0;
+  _datamask = 0;
+  for (i = 0; i < count; i++) {
+    if (digitalPinToPort(_data_pins[i]) != port)
+      break;
+    _databits[i] = digitalPinToBitMask(_data_pins[i]);
+    _datamask |= _databits[i];
+  }
+  if (i == count && port != NOT_A_PIN) {
+    _dataport = portOutputRegister(port);
+    _datamode = portModeRegister(port);
+  }
+  _rsport = portOutputRegister(digitalPinToPort(_rs_pin));
+  _rsmask = digitalPinToBitMask(_rs_pin);
+  _enableport = portOutputRegister(digitalPinToPort(_enable_pin));
+  _enablemask = digitalPinToBitMask(_enable_pin);
+#endif
   
   if (fourbitmode)
     _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
@@ -93,6 +156,17 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
   _numlines = lines;
   _currline = 0;
 
+  // the busy flag can't be trusted until initialization is complete
+  _pollbusy = 0;
+
+  // the initialization sequence relies on fixed delays, so bypass
+  // the asynchronous queue until it is done
+  uint8_t qsize = _qsize;
+  if (qsize) {
+    flushQueue();
+    _qsize = 0;
+  }
+
   // for some 1 line displays you can select a 10 pixel high font
   if ((dotsize != 0) && (lines == 1)) {
     _displayfunction |= LCD_5x10DOTS;
@@ -103,8 +177,10 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
   // before sending commands. Arduino can turn on way befer 4.5V so we'll wait 50
   delayMicroseconds(50000); 
   // Now we pull both RS and R/W low to begin commands
-  digitalWrite(_rs_pin, LOW);
-  digitalWrite(_enable_pin, LOW);
+  if (_enable_pin != 255) {
+    digitalWrite(_rs_pin, LOW);
+    digitalWrite(_enable_pin, LOW);
+  }
   if (_rw_pin != 255) { 
     digitalWrite(_rw_pin, LOW);
   }
@@ -115,19 +191,19 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
     // figure 24, pg 46
 
     // we start in 8bit mode, try to set 4 bit mode
-    write4bits(0x03);
+    transmitNibble(0x03);
     delayMicroseconds(4500); // wait min 4.1ms
 
     // second try
-    write4bits(0x03);
+    transmitNibble(0x03);
     delayMicroseconds(4500); // wait min 4.1ms
     
     // third go!
-    write4bits(0x03); 
+    transmitNibble(0x03); 
     delayMicroseconds(150);
 
     // finally, set to 4-bit interface
-    write4bits(0x02); 
+    transmitNibble(0x02); 
   } else {
     // this is according to the hitachi HD44780 datasheet
     // page 45 figure 23
@@ -159,19 +235,37 @@ void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
   // set the entry mode
   command(LCD_ENTRYMODESET | _displaymode);
 
+  // if the R/W pin is wired, poll the busy flag from now on instead
+  // of waiting for the worst-case time after each command
+  if (_rw_pin != 255) {
+    _pollbusy = 1;
+  }
+  _qtime = micros();
+  _qwait = 0;
+  _qsize = qsize;
 }
 
 /********** high level commands, for the user! */
 void LiquidCrystal::clear()
 {
+  if (_qsize) {
+    enqueue(LCD_CLEARDISPLAY | LCD_QUEUE_SLOW);
+    return;
+  }
   command(LCD_CLEARDISPLAY);  // clear display, set cursor position to zero
-  delayMicroseconds(2000);  // this command takes a long time!
+  if (!_pollbusy)
+    delayMicroseconds(2000);  // this command takes a long time!
 }
 
 void LiquidCrystal::home()
 {
+  if (_qsize) {
+    enqueue(LCD_RETURNHOME | LCD_QUEUE_SLOW);
+    return;
+  }
   command(LCD_RETURNHOME);  // set cursor position to zero
-  delayMicroseconds(2000);  // this command takes a long time!
+  if (!_pollbusy)
+    delayMicroseconds(2000);  // this command takes a long time!
 }
 
 void LiquidCrystal::setCursor(uint8_t col, uint8_t row)
@@ -281,7 +375,29 @@ inline void LiquidCrystal::write(uint8_t value) {
 
 // write either command or data, with automatic 4/8-bit selection
 void LiquidCrystal::send(uint8_t value, uint8_t mode) {
+  if (_qsize) {
+    enqueue(value | (mode ? LCD_QUEUE_DATA : 0));
+    return;
+  }
+  if (_pollbusy) {
+    waitBusy();
+  }
+  transmit(value, mode);
+}
+
+// put the value onto the wire without waiting for the controller
+void LiquidCrystal::transmit(uint8_t value, uint8_t mode) {
+#if defined(__AVR__)
+  uint8_t oldSREG = SREG;
+  cli();
+  if (mode)
+    *_rsport |= _rsmask;
+  else
+    *_rsport &= ~_rsmask;
+  SREG = oldSREG;
+#else
   digitalWrite(_rs_pin, mode);
+#endif
 
   // if there is a RW pin indicated, set it low to Write
   if (_rw_pin != 255) { 
@@ -296,28 +412,181 @@ void LiquidCrystal::send(uint8_t value, uint8_t mode) {
   }
 }
 
+// put a single nibble onto the wire with RS low, for the start of
+// the 4-bit initialization sequence
+void LiquidCrystal::transmitNibble(uint8_t value) {
+  write4bits(value);
+}
+
 void LiquidCrystal::pulseEnable(void) {
+#if defined(__AVR__)
+  uint8_t oldSREG = SREG;
+  cli();
+  *_enableport &= ~_enablemask;
+  SREG = oldSREG;
+  delayMicroseconds(1);    
+  cli();
+  *_enableport |= _enablemask;
+  SREG = oldSREG;
+  delayMicroseconds(1);    // enable pulse must be >450ns
+  cli();
+  *_enableport &= ~_enablemask;
+  SREG = oldSREG;
+#else
   digitalWrite(_enable_pin, LOW);
   delayMicroseconds(1);    
   digitalWrite(_enable_pin, HIGH);
   delayMicroseconds(1);    // enable pulse must be >450ns
   digitalWrite(_enable_pin, LOW);
-  delayMicroseconds(100);   // commands need > 37us to settle
+#endif
+  if (!_pollbusy && !_qsize)
+    delayMicroseconds(100);   // commands need > 37us to settle
+}
+
+// wait for the busy flag (DB7) to clear.  gives up after 5ms in case
+// the display is not responding, so that the sketch doesn't hang.
+void LiquidCrystal::waitBusy() {
+  unsigned long start = micros();
+  while (readBusy() && (micros() - start) < 5000)
+    ;
+}
+
+// read the busy flag (DB7) once.  returns non-zero if the controller
+// is still executing the last command.
+uint8_t LiquidCrystal::readBusy() {
+  uint8_t eightbit = (_displayfunction & LCD_8BITMODE);
+  uint8_t count = eightbit ? 8 : 4;
+  for (int i = 0; i < count; i++) {
+    pinMode(_data_pins[i], INPUT);
+  }
+  digitalWrite(_rs_pin, LOW);
+  digitalWrite(_rw_pin, HIGH);
+
+  digitalWrite(_enable_pin, HIGH);
+  delayMicroseconds(1);    // data is valid 360ns after enable rises
+  uint8_t busy = digitalRead(_data_pins[count - 1]);
+  digitalWrite(_enable_pin, LOW);
+  delayMicroseconds(1);
+  if (!eightbit) {
+    // clock out the second nibble, which holds the rest of the address
+    digitalWrite(_enable_pin, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(_enable_pin, LOW);
+    delayMicroseconds(1);
+  }
+
+  // write4bits() and write8bits() switch the data pins back to outputs
+  digitalWrite(_rw_pin, LOW);
+  return busy;
+}
+
+/*********** asynchronous output queue */
+
+// switch to queueing commands and data in "queue", which has room for
+// "size" entries.  a null queue or zero size returns to synchronous output.
+// anything that was already queued is sent first.
+void LiquidCrystal::setQueue(uint16_t *queue, uint8_t size) {
+  if (_qsize) {
+    flushQueue();
+  }
+  _qsize = 0;   // stop drainQueue() looking at the queue while it changes
+  _queue = queue;
+  _qhead = _qtail = 0;
+  if (queue && size > 1) {
+    _qsize = size;
+  }
+}
+
+// send the next queued entry if the controller is ready for it.  never
+// waits, so it is safe to call from loop() or a timer interrupt.
+// returns true if there are still entries in the queue.
+bool LiquidCrystal::drainQueue() {
+  if (!_qsize || _qdraining) {
+    return _qsize && _qhead != _qtail;
+  }
+  if (_qhead == _qtail) {
+    return false;
+  }
+  _qdraining = 1;
+  uint8_t ready;
+  if (_pollbusy) {
+    ready = !readBusy() || (micros() - _qtime) >= 5000;
+  } else {
+    ready = (micros() - _qtime) >= _qwait;
+  }
+  if (ready) {
+    uint16_t entry = _queue[_qhead];
+    transmit(entry & 0xFF, (entry & LCD_QUEUE_DATA) ? HIGH : LOW);
+    _qtime = micros();
+    _qwait = (entry & LCD_QUEUE_SLOW) ? 2000 : 50;
+    uint8_t next = _qhead + 1;
+    if (next >= _qsize) {
+      next = 0;
+    }
+    _qhead = next;
+  }
+  _qdraining = 0;
+  return _qhead != _qtail;
+}
+
+// wait until everything in the queue has been sent
+void LiquidCrystal::flushQueue() {
+  while (drainQueue())
+    ;
+}
+
+// add an entry to the queue, waiting for room if it is full
+void LiquidCrystal::enqueue(uint16_t entry) {
+  uint8_t next = _qtail + 1;
+  if (next >= _qsize) {
+    next = 0;
+  }
+  while (next == _qhead) {
+    drainQueue();
+  }
+  _queue[_qtail] = entry;
+  _qtail = next;
+}
+
+// write the low "count" bits of value to the data pins in one go if
+// they are all on the same port.  returns zero if they are scattered.
+uint8_t LiquidCrystal::writePort(uint8_t value, uint8_t count) {
+#if defined(__AVR__)
+  if (!_dataport)
+    return 0;
+  uint8_t bits = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (value & (1 << i))
+      bits |= _databits[i];
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  *_datamode |= _datamask;  // readBusy() may have left them as inputs
+  *_dataport = (*_dataport & ~_datamask) | bits;
+  SREG = oldSREG;
+  return 1;
+#else
+  return 0;
+#endif
 }
 
 void LiquidCrystal::write4bits(uint8_t value) {
-  for (int i = 0; i < 4; i++) {
-    pinMode(_data_pins[i], OUTPUT);
-    digitalWrite(_data_pins[i], (value >> i) & 0x01);
+  if (!writePort(value, 4)) {
+    for (int i = 0; i < 4; i++) {
+      pinMode(_data_pins[i], OUTPUT);
+      digitalWrite(_data_pins[i], (value >> i) & 0x01);
+    }
   }
 
   pulseEnable();
 }
 
 void LiquidCrystal::write8bits(uint8_t value) {
-  for (int i = 0; i < 8; i++) {
-    pinMode(_data_pins[i], OUTPUT);
-    digitalWrite(_data_pins[i], (value >> i) & 0x01);
+  if (!writePort(value, 8)) {
+    for (int i = 0; i < 8; i++) {
+      pinMode(_data_pins[i], OUTPUT);
+      digitalWrite(_data_pins[i], (value >> i) & 0x01);
+    }
   }
   
   pulseEnable();
@@ -61,8 +61,8 @@ public:
     
   void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
 
-  void clear();
-  void home();
+  virtual void clear();
+  virtual void home();
 
   void noDisplay();
   void display();
@@ -77,8 +77,8 @@ public:
   void autoscroll();
   void noAutoscroll();
 
-  void createChar(uint8_t, uint8_t[]);
-  void setCursor(uint8_t, uint8_t); 
+  virtual void createChar(uint8_t, uint8_t[]);
+  virtual void setCursor(uint8_t, uint8_t); 
 #if defined(ARDUINO) && ARDUINO >= 100
   virtual size_t write(uint8_t);
 #else
@@ -87,11 +87,25 @@ public:
   void command(uint8_t);
   
   using Print::write;
+protected:
+  LiquidCrystal();
+
+  void setQueue(uint16_t *queue, uint8_t size);
+  bool drainQueue();
+  void flushQueue();
+
+  // transport hooks, for subclasses that don't drive the pins directly
+  virtual void transmit(uint8_t, uint8_t);
+  virtual void transmitNibble(uint8_t);
 private:
   void send(uint8_t, uint8_t);
+  void enqueue(uint16_t);
   void write4bits(uint8_t);
   void write8bits(uint8_t);
   void pulseEnable();
+  uint8_t writePort(uint8_t value, uint8_t count);
+  void waitBusy();
+  uint8_t readBusy();
 
   uint8_t _rs_pin; // LOW: command.  HIGH: character.
   uint8_t _rw_pin; // LOW: write to LCD.  HIGH: read from LCD.
@@ -103,8 +117,31 @@ private:
   uint8_t _displaymode;
 
   uint8_t _initialized;
+  uint8_t _pollbusy; // non-zero once the busy flag can be read back
 
   uint8_t _numlines,_currline;
+
+#if defined(__AVR__)
+  // direct port access for the data pins when they share a port, and
+  // for the RS and enable pins, so that we can avoid digitalWrite()
+  volatile uint8_t *_dataport; // null if the data pins are scattered
+  volatile uint8_t *_datamode;
+  uint8_t _datamask;
+  uint8_t _databits[8];
+  volatile uint8_t *_rsport;
+  volatile uint8_t *_enableport;
+  uint8_t _rsmask;
+  uint8_t _enablemask;
+#endif
+
+  // ring buffer of pending commands and data for asynchronous output.
+  // each entry is the byte in the low 8 bits, with the flags below.
+  uint16_t *_queue;
+  uint8_t _qsize; // zero when output is synchronous
+  volatile uint8_t _qhead, _qtail;
+  volatile uint8_t _qdraining;
+  unsigned long _qtime;
+  unsigned int _qwait;
 };
 
 #endif
@@ -21,6 +21,9 @@
  */
 
 #include "Melody.h"
+#include "Synth.h"
+#include "../I2C/EEPROM24.h"
+#include <avr/pgmspace.h>
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
 #else
@@ -66,6 +69,15 @@
  * one note to the next.  It will not block the application while
  * notes are playing.
  *
+ * The speed of the melody is set with setTempo() as the number of quarter
+ * notes per minute, and setArticulation() sets how much of each note's
+ * time is spent sounding the note rather than in the gap before the next
+ * note.  The default tempo of 185 and articulation of \ref NORMAL give
+ * a whole note that sounds for about one second followed by a gap of
+ * about 300 milliseconds.  The note times are looked up in a table that is recomputed only
+ * when the tempo changes, so playing a note does not need any division
+ * for the usual note lengths.
+ *
  * The number of loops can also be specified with setLoopDuration() which
  * sets a maximum amount of time that the melody will play before stopping.
  * The following example plays the melody for no more than 60 seconds:
@@ -77,23 +89,104 @@
  *     melody.play();
  * }
  * \endcode
+ *
+ * By default the melody is played with tone(), which can only play one
+ * note at a time, and the note timing depends upon how often run() is
+ * called.  For sample-accurate timing, or to play several melodies at
+ * once, attach the melody to a voice of a Synth with setSynth().
+ * The notes are then queued ahead on the synthesizer by run() and played
+ * by the synthesizer's interrupt handler.
+ *
+ * Instead of calling run() from the application's main loop, the melody
+ * can be added to a LoopScheduler, which will only dispatch the melody
+ * when the current note ends, or periodically to top up the synthesizer's
+ * note queue.
+ *
+ * \section melody_packed Packed melodies
+ *
+ * The \c notes and \c lengths arrays take 3 bytes of RAM per note.
+ * Long tunes can instead be stored in a packed format of about one byte
+ * per note in program memory with setMelody_P(), or in an external
+ * EEPROM24 with setMelody(EEPROM24 &, unsigned long, unsigned int).
+ * Packed notes are decoded one at a time as the melody plays:
+ *
+ * \code
+ * const uint8_t tune[] PROGMEM = {
+ *     MELODY_OCTAVE(4), MELODY_NOTE(MELODY_C, MELODY_LEN_4),
+ *     MELODY_OCTAVE(3), MELODY_NOTE(MELODY_G, MELODY_LEN_8),
+ *     MELODY_NOTE(MELODY_G, MELODY_LEN_8),
+ *     MELODY_NOTE(MELODY_A, MELODY_LEN_4),
+ *     MELODY_NOTE(MELODY_G, MELODY_LEN_4),
+ *     MELODY_NOTE(MELODY_REST, MELODY_LEN_4),
+ *     MELODY_NOTE(MELODY_B, MELODY_LEN_4),
+ *     MELODY_OCTAVE(4), MELODY_NOTE(MELODY_C, MELODY_LEN_4),
+ *     MELODY_NOTE(MELODY_REST, MELODY_LEN_2)
+ * };
+ *
+ * melody.setMelody_P(tune, sizeof(tune));
+ * \endcode
+ *
+ * Each byte has the note within the current octave in the low nibble
+ * (\c MELODY_C to \c MELODY_B, or \c MELODY_REST) and the length code
+ * in the high nibble (\c MELODY_LEN_1 for a whole note to
+ * \c MELODY_LEN_64, or \c MELODY_LEN_3 to \c MELODY_LEN_48 for
+ * triplets).  \c MELODY_OCTAVE() changes the octave for the following
+ * notes; the octave is 4 at the start of the melody.  The pack() function
+ * converts a melody in the array format into the packed format, for
+ * example to write it into an EEPROM.
  */
 
+// Frequencies of the notes in octave 8, from C8 to B8.
+static unsigned int const octave8[12] PROGMEM = {
+    4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+// Note lengths for each length code in the packed format.
+static uint8_t const packedLengths[16] PROGMEM = {
+    1, 2, 4, 8, 16, 32, 64, 3, 6, 12, 24, 48, 4, 4, 4, 4
+};
+
+#define MELODY_CMD_OCTAVE       0x0D
+#define MELODY_DEFAULT_OCTAVE   4
+
+// Number of milliseconds between top-ups of the synthesizer note queue
+// when the melody is run from a LoopScheduler.
+#define MELODY_SYNTH_POLL       10
+
+static unsigned int noteFrequency(uint8_t octave, uint8_t note)
+{
+    unsigned int freq = pgm_read_word(&(octave8[note]));
+    uint8_t shift = 8 - octave;
+    if (!shift)
+        return freq;
+    return (freq + (1 << (shift - 1))) >> shift;
+}
+
 /**
  * \brief Constructs a new melody playing object for \a pin.
  */
 Melody::Melody(uint8_t pin)
     : _pin(pin)
     , playing(false)
+    , queuedAll(false)
+    , octave(MELODY_DEFAULT_OCTAVE)
+    , _articulation(NORMAL)
+    , _voice(0)
+    , _tempo(DEFAULT_TEMPO)
+    , _synth(0)
     , _loopCount(0)
     , loopsLeft(0)
     , notes(0)
     , lengths(0)
+    , eeprom(0)
+    , address(0)
+    , fetch(0)
     , size(0)
     , posn(0)
     , duration(0)
     , startNote(0)
 {
+    setTempo(DEFAULT_TEMPO);
 }
 
 /**
@@ -131,13 +224,88 @@ Melody::Melody(uint8_t pin)
 void Melody::setLoopDuration(unsigned long ms)
 {
     unsigned long duration = 0;
-    for (unsigned int index = 0; index < size; ++index)
-        duration += (1000 / lengths[index]) * 13 / 10;
+    unsigned int savePosn = posn;
+    uint8_t saveOctave = octave;
+    int note;
+    uint8_t length;
+    rewind();
+    while (readNote(&note, &length))
+        duration += slotTime(length);
+    posn = savePosn;
+    octave = saveOctave;
+    if (!duration)
+        duration = 1;
     _loopCount = (int)(ms / duration);
     if (!_loopCount)
         _loopCount = 1;     // Play the melody at least once.
 }
 
+/**
+ * \var Melody::DEFAULT_TEMPO
+ * \brief Default tempo of 185 quarter notes per minute.
+ */
+
+/**
+ * \fn unsigned int Melody::tempo() const
+ * \brief Returns the tempo of the melody in quarter notes per minute.
+ *
+ * \sa setTempo()
+ */
+
+/**
+ * \brief Sets the tempo of the melody to \a bpm quarter notes per minute.
+ *
+ * The tempo is clamped to be between 4 and 1000.  The new tempo takes
+ * effect from the next note.
+ *
+ * \sa tempo(), setArticulation()
+ */
+void Melody::setTempo(unsigned int bpm)
+{
+    if (bpm < 4)
+        bpm = 4;
+    else if (bpm > 1000)
+        bpm = 1000;
+    _tempo = bpm;
+    uint16_t whole = (uint16_t)(240000UL / bpm);
+    for (uint8_t code = 0; code < 12; ++code)
+        slots[code] = whole / pgm_read_byte(&(packedLengths[code]));
+}
+
+/**
+ * \var Melody::LEGATO
+ * \brief Articulation where notes sound for their full length with no gap.
+ */
+
+/**
+ * \var Melody::NORMAL
+ * \brief Default articulation where notes sound for 77% of their length.
+ */
+
+/**
+ * \var Melody::STACCATO
+ * \brief Articulation where notes sound for half of their length.
+ */
+
+/**
+ * \fn uint8_t Melody::articulation() const
+ * \brief Returns the articulation of the melody as the fraction of each
+ * note's length that the note sounds for, in units of 1/128.
+ *
+ * \sa setArticulation()
+ */
+
+/**
+ * \fn void Melody::setArticulation(uint8_t articulation)
+ * \brief Sets the \a articulation of the melody as the fraction of each
+ * note's length that the note sounds for, in units of 1/128.
+ *
+ * The values \ref LEGATO, \ref NORMAL, and \ref STACCATO are provided for
+ * common articulations.  The rest of the note's length is silent.
+ *
+ * \sa articulation(), setTempo()
+ */
+
 /**
  * \brief Starts playing the melody, or restarts it if already playing.
  *
@@ -149,9 +317,14 @@ void Melody::play()
     if (size == 0)
         return;         // No melody to play.
     loopsLeft = _loopCount;
-    posn = 0;
+    rewind();
     playing = true;
-    nextNote();
+    queuedAll = false;
+    if (_synth)
+        queueNotes();
+    else
+        nextNote();
+    reschedule();
 }
 
 /**
@@ -165,9 +338,14 @@ void Melody::playOnce()
     if (size == 0)
         return;         // No melody to play.
     loopsLeft = 1;
-    posn = 0;
+    rewind();
     playing = true;
-    nextNote();
+    queuedAll = false;
+    if (_synth)
+        queueNotes();
+    else
+        nextNote();
+    reschedule();
 }
 
 /**
@@ -180,7 +358,11 @@ void Melody::stop()
     if (!playing)
         return;
     playing = false;
-    noTone(_pin);
+    if (_synth)
+        _synth->stop(_voice);
+    else
+        noTone(_pin);
+    unschedule();
 }
 
 /**
@@ -202,6 +384,142 @@ void Melody::setMelody(const int *notes, const uint8_t *lengths, unsigned int si
     this->notes = notes;
     this->lengths = lengths;
     this->size = size;
+    fetch = 0;
+}
+
+/**
+ * \brief Sets the melody to the \a size bytes of \a packed data in
+ * program memory.
+ *
+ * If a melody is currently playing, then this function will stop playback.
+ *
+ * \sa \ref melody_packed "Packed melodies", play()
+ */
+void Melody::setMelody_P(const uint8_t *packed, unsigned int size)
+{
+    stop();
+    this->lengths = packed;
+    this->size = size;
+    fetch = fetchProgmem;
+}
+
+/**
+ * \brief Sets the melody to the \a size bytes of packed data that start
+ * at \a address in \a eeprom.
+ *
+ * The notes are read from the EEPROM one at a time as they are played.
+ * If a melody is currently playing, then this function will stop playback.
+ *
+ * \sa \ref melody_packed "Packed melodies", pack(), play()
+ */
+void Melody::setMelody(EEPROM24 &eeprom, unsigned long address, unsigned int size)
+{
+    stop();
+    this->eeprom = &eeprom;
+    this->address = address;
+    this->size = size;
+    fetch = fetchEEPROM;
+}
+
+/**
+ * \brief Converts a melody from the array format into the packed format.
+ *
+ * \param packed The buffer to write the packed melody to.
+ * \param maxSize The size of the \a packed buffer in bytes.
+ * \param notes The frequencies of the notes, as for setMelody().
+ * \param lengths The lengths of the notes, as for setMelody().
+ * \param size The number of notes in \a notes and \a lengths.
+ *
+ * \return Returns the number of bytes that were written to \a packed,
+ * or zero if \a maxSize is too small.
+ *
+ * Each frequency is rounded to the nearest note between octaves 0 and 8,
+ * and each length to the nearest length that the packed format supports.
+ *
+ * \sa \ref melody_packed "Packed melodies", setMelody_P()
+ */
+unsigned int Melody::pack(uint8_t *packed, unsigned int maxSize,
+                          const int *notes, const uint8_t *lengths,
+                          unsigned int size)
+{
+    unsigned int out = 0;
+    uint8_t currentOctave = MELODY_DEFAULT_OCTAVE;
+    for (unsigned int index = 0; index < size; ++index) {
+        // Find the nearest note to the frequency.
+        uint8_t bestNote = MELODY_REST;
+        uint8_t bestOctave = currentOctave;
+        if (notes[index] > 0) {
+            unsigned int bestDiff = 0xFFFFU;
+            for (uint8_t oct = 0; oct <= 8; ++oct) {
+                for (uint8_t note = 0; note < 12; ++note) {
+                    int diff = (int)noteFrequency(oct, note) - notes[index];
+                    unsigned int absDiff = (unsigned int)(diff < 0 ? -diff : diff);
+                    if (absDiff < bestDiff) {
+                        bestDiff = absDiff;
+                        bestNote = note + MELODY_C;
+                        bestOctave = oct;
+                    }
+                }
+            }
+        }
+
+        // Find the nearest length in milliseconds.
+        uint8_t bestCode = MELODY_LEN_4;
+        unsigned int bestDiff = 0xFFFFU;
+        unsigned int ms = 1000 / lengths[index];
+        for (uint8_t code = 0; code <= MELODY_LEN_48; ++code) {
+            int diff = (int)(1000 / pgm_read_byte(&(packedLengths[code]))) - (int)ms;
+            unsigned int absDiff = (unsigned int)(diff < 0 ? -diff : diff);
+            if (absDiff < bestDiff) {
+                bestDiff = absDiff;
+                bestCode = code;
+            }
+        }
+
+        // Change octaves if necessary and output the note.
+        if (bestNote != MELODY_REST && bestOctave != currentOctave) {
+            if (out >= maxSize)
+                return 0;
+            packed[out++] = MELODY_OCTAVE(bestOctave);
+            currentOctave = bestOctave;
+        }
+        if (out >= maxSize)
+            return 0;
+        packed[out++] = MELODY_NOTE(bestNote, bestCode);
+    }
+    return out;
+}
+
+/**
+ * \fn Synth *Melody::synth() const
+ * \brief Returns the synthesizer that this melody is played on, or NULL
+ * if the melody is played with tone().
+ *
+ * \sa setSynth(), voice()
+ */
+
+/**
+ * \fn uint8_t Melody::voice() const
+ * \brief Returns the synthesizer voice that this melody is played on.
+ *
+ * \sa setSynth(), synth()
+ */
+
+/**
+ * \brief Plays this melody on \a voice of \a synth instead of with tone().
+ *
+ * The output pin that was passed to the constructor is ignored while the
+ * melody is attached to a synthesizer.  Set \a synth to NULL to go back
+ * to tone().  If a melody is currently playing, then this function will
+ * stop playback.
+ *
+ * \sa synth(), Synth
+ */
+void Melody::setSynth(Synth *synth, uint8_t voice)
+{
+    stop();
+    _synth = synth;
+    _voice = voice;
 }
 
 /**
@@ -210,30 +528,186 @@ void Melody::setMelody(const int *notes, const uint8_t *lengths, unsigned int si
  * This function must be called by the application's main <tt>loop()</tt>
  * function to cause the melody to advance from note to note.  It will not
  * block the application while notes are playing.
+ *
+ * When the melody is attached to a Synth, this function keeps the
+ * synthesizer's note queue topped up and need only be called often
+ * enough to stay ahead of the queue.
  */
 void Melody::run()
 {
     if (!playing)
         return;
+    if (_synth) {
+        queueNotes();
+        return;
+    }
     if ((millis() - startNote) >= duration) {
         noTone(_pin);
         nextNote();
     }
 }
 
+/**
+ * \brief Runs the melody control loop from a LoopScheduler.
+ */
+void Melody::dispatch()
+{
+    run();
+    reschedule();
+}
+
+/**
+ * \internal
+ * \brief Sets the scheduler deadline for the end of the current note,
+ * or for the next synthesizer queue top-up.
+ */
+void Melody::reschedule()
+{
+    if (!scheduler())
+        return;
+    if (!playing)
+        unschedule();
+    else if (_synth)
+        scheduleAt(millis() + MELODY_SYNTH_POLL);
+    else
+        scheduleAt(startNote + duration);
+}
+
+/**
+ * \internal
+ * \brief Fetches the byte at \a posn from a packed melody in program memory.
+ */
+uint8_t Melody::fetchProgmem(const Melody *melody, unsigned int posn)
+{
+    return pgm_read_byte(melody->lengths + posn);
+}
+
+/**
+ * \internal
+ * \brief Fetches the byte at \a posn from a packed melody in an EEPROM.
+ *
+ * This is called through a function pointer so that sketches that never
+ * play melodies from an EEPROM do not need to link against EEPROM24.
+ */
+uint8_t Melody::fetchEEPROM(const Melody *melody, unsigned int posn)
+{
+    return melody->eeprom->read(melody->address + posn);
+}
+
+/**
+ * \internal
+ * \brief Rewinds the melody to the start.
+ */
+void Melody::rewind()
+{
+    posn = 0;
+    octave = MELODY_DEFAULT_OCTAVE;
+}
+
+/**
+ * \internal
+ * \brief Reads the next \a note and \a length from the melody.
+ *
+ * Returns false at the end of the melody.
+ */
+bool Melody::readNote(int *note, uint8_t *length)
+{
+    if (!fetch) {
+        if (posn >= size)
+            return false;
+        *note = notes[posn];
+        *length = lengths[posn];
+        ++posn;
+        return true;
+    }
+    while (posn < size) {
+        uint8_t value = fetch(this, posn++);
+        uint8_t code = value & 0x0F;
+        if (code == MELODY_CMD_OCTAVE) {
+            octave = value >> 4;
+            if (octave > 8)
+                octave = 8;
+        } else if (code <= MELODY_B) {
+            if (code == MELODY_REST)
+                *note = NOTE_REST;
+            else
+                *note = (int)noteFrequency(octave, code - MELODY_C);
+            *length = pgm_read_byte(&(packedLengths[value >> 4]));
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \internal
+ * \brief Returns the time in milliseconds for a note of \a length at
+ * the current tempo, including the gap after the note.
+ */
+unsigned int Melody::slotTime(uint8_t length) const
+{
+    for (uint8_t code = 0; code < 12; ++code) {
+        if (pgm_read_byte(&(packedLengths[code])) == length)
+            return slots[code];
+    }
+    return slots[0] / length;   // Unusual length, so compute it.
+}
+
+/**
+ * \internal
+ * \brief Returns the time that a note sounds for within its \a slot time.
+ */
+unsigned int Melody::soundTime(unsigned int slot) const
+{
+    return (unsigned int)((((uint32_t)slot) * _articulation) >> 7);
+}
+
 void Melody::nextNote()
 {
-    if (posn >= size) {
+    int note;
+    uint8_t length;
+    if (!readNote(&note, &length)) {
         if (loopsLeft != 0 && --loopsLeft <= 0) {
             stop();
             return;
         }
-        posn = 0;
+        rewind();
+        if (!readNote(&note, &length)) {
+            stop();
+            return;
+        }
     }
-    duration = 1000 / lengths[posn];
-    if (notes[posn] != NOTE_REST)
-        tone(_pin, notes[posn], duration);
-    ++posn;
-    duration = duration * 13 / 10;      // i.e., duration * 1.3
+    duration = slotTime(length);
+    unsigned int sound = soundTime(duration);
+    if (note != NOTE_REST && sound)
+        tone(_pin, note, sound);
     startNote = millis();
 }
+
+void Melody::queueNotes()
+{
+    // Each note is queued with a rest for the gap before the next note.
+    int note;
+    uint8_t length;
+    while (!queuedAll && _synth->queueSpace(_voice) >= 2) {
+        if (!readNote(&note, &length)) {
+            if (loopsLeft != 0 && --loopsLeft <= 0) {
+                queuedAll = true;
+                break;
+            }
+            rewind();
+            if (!readNote(&note, &length)) {
+                queuedAll = true;
+                break;
+            }
+        }
+        unsigned int slot = slotTime(length);
+        unsigned int sound = soundTime(slot);
+        _synth->queueNote(_voice, note, sound);
+        _synth->queueNote(_voice, NOTE_REST, slot - sound);
+    }
+
+    // Stop once the synthesizer has played the last note.
+    if (queuedAll && !_synth->isBusy(_voice))
+        playing = false;
+}
@@ -24,6 +24,7 @@
 #define Melody_h
 
 #include <inttypes.h>
+#include "../BlinkLED/LoopScheduler.h"
 
 // Note frequencies from http://arduino.cc/en/Tutorial/Tone
 #define NOTE_B0  31
@@ -119,7 +120,42 @@
 // Special note value that indicates a rest.
 #define NOTE_REST 0
 
-class Melody {
+// Packed melody format: one byte per note, with the note within the
+// current octave in the low nibble and the length code in the high nibble.
+#define MELODY_REST     0
+#define MELODY_C        1
+#define MELODY_CS       2
+#define MELODY_D        3
+#define MELODY_DS       4
+#define MELODY_E        5
+#define MELODY_F        6
+#define MELODY_FS       7
+#define MELODY_G        8
+#define MELODY_GS       9
+#define MELODY_A        10
+#define MELODY_AS       11
+#define MELODY_B        12
+
+#define MELODY_LEN_1    0
+#define MELODY_LEN_2    1
+#define MELODY_LEN_4    2
+#define MELODY_LEN_8    3
+#define MELODY_LEN_16   4
+#define MELODY_LEN_32   5
+#define MELODY_LEN_64   6
+#define MELODY_LEN_3    7
+#define MELODY_LEN_6    8
+#define MELODY_LEN_12   9
+#define MELODY_LEN_24   10
+#define MELODY_LEN_48   11
+
+#define MELODY_NOTE(note, length)   ((uint8_t)(((length) << 4) | (note)))
+#define MELODY_OCTAVE(octave)       ((uint8_t)(((octave) << 4) | 0x0D))
+
+class Synth;
+class EEPROM24;
+
+class Melody : public ScheduledTask {
 public:
     Melody(uint8_t pin);
 
@@ -130,27 +166,71 @@ public:
 
     void setLoopDuration(unsigned long ms);
 
+    static const unsigned int DEFAULT_TEMPO = 185;
+
+    unsigned int tempo() const { return _tempo; }
+    void setTempo(unsigned int bpm);
+
+    static const uint8_t LEGATO = 128;
+    static const uint8_t NORMAL = 98;
+    static const uint8_t STACCATO = 64;
+
+    uint8_t articulation() const { return _articulation; }
+    void setArticulation(uint8_t articulation) { _articulation = articulation; }
+
     void play();
     void playOnce();
     void stop();
 
     void setMelody(const int *notes, const uint8_t *lengths, unsigned int size);
+    void setMelody_P(const uint8_t *packed, unsigned int size);
+    void setMelody(EEPROM24 &eeprom, unsigned long address, unsigned int size);
+
+    static unsigned int pack(uint8_t *packed, unsigned int maxSize,
+                             const int *notes, const uint8_t *lengths,
+                             unsigned int size);
+
+    Synth *synth() const { return _synth; }
+    uint8_t voice() const { return _voice; }
+    void setSynth(Synth *synth, uint8_t voice = 0);
 
     void run();
 
+protected:
+    void dispatch();
+
 private:
     uint8_t _pin;
     bool playing;
+    bool queuedAll;
+    uint8_t octave;
+    uint8_t _articulation;
+    uint8_t _voice;
+    unsigned int _tempo;
+    uint16_t slots[12];
+    Synth *_synth;
     int _loopCount;
     int loopsLeft;
     const int *notes;
     const uint8_t *lengths;
+    EEPROM24 *eeprom;
+    unsigned long address;
+    uint8_t (*fetch)(const Melody *melody, unsigned int posn);
     unsigned int size;
     unsigned int posn;
     unsigned long duration;
     unsigned long startNote;
 
+    static uint8_t fetchProgmem(const Melody *melody, unsigned int posn);
+    static uint8_t fetchEEPROM(const Melody *melody, unsigned int posn);
+
+    void rewind();
+    bool readNote(int *note, uint8_t *length);
+    unsigned int slotTime(uint8_t length) const;
+    unsigned int soundTime(unsigned int slot) const;
     void nextNote();
+    void queueNotes();
+    void reschedule();
 };
 
 #endif
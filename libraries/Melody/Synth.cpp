@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Synth.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/pgmspace.h>
+
+/**
+ * \class Synth Synth.h <Synth.h>
+ * \brief Interrupt-driven synthesizer that mixes several voices into a
+ * PWM audio output.
+ *
+ * Synth generates up to \c SYNTH_VOICES voices (4 by default) of square
+ * or wavetable waveforms and mixes them into an 8-bit PWM output on the
+ * OC2B pin, which is D3 on the Arduino Uno and D9 on the Arduino Mega.
+ * A simple RC low-pass filter on the pin followed by an amplifier gives
+ * good results; a piezo buzzer can also be connected directly.
+ *
+ * Timer2 runs in phase-correct PWM mode at 31.25 kHz and a new sample
+ * is generated on every second overflow, giving a sample rate of
+ * 15625 Hz.  Each voice has a queue of \c SYNTH_QUEUE_SIZE notes
+ * (8 by default) that are played back to back by the interrupt handler,
+ * so note timing is accurate to the sample and does not depend upon how
+ * often the application's <tt>loop()</tt> runs.  The application must
+ * call handleTimer() from the interrupt handler:
+ *
+ * \code
+ * #include <Synth.h>
+ * #include <Melody.h>
+ *
+ * Synth synth;
+ * Melody melody1(3);
+ * Melody melody2(3);
+ *
+ * ISR(TIMER2_OVF_vect)
+ * {
+ *     synth.handleTimer();
+ * }
+ *
+ * void setup() {
+ *     synth.begin();
+ *     synth.setWaveform(1, Synth::sine());
+ *     melody1.setMelody(tune, tuneLengths, sizeof(tuneLengths));
+ *     melody1.setSynth(&synth, 0);
+ *     melody2.setMelody(bass, bassLengths, sizeof(bassLengths));
+ *     melody2.setSynth(&synth, 1);
+ *     melody1.play();
+ *     melody2.play();
+ * }
+ *
+ * void loop() {
+ *     melody1.run();
+ *     melody2.run();
+ * }
+ * \endcode
+ *
+ * Notes can also be queued directly with queueNote().
+ *
+ * Timer2 cannot be used for anything else, such as DMD::enableTimer2()
+ * or IRtransmitter, while the synthesizer is in use.
+ *
+ * \sa Melody
+ */
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define SYNTH_PIN       9
+#else
+#define SYNTH_PIN       3
+#endif
+
+// Wavetables are 256 signed samples covering one cycle of the waveform.
+// Table generated by gensine.c
+static int8_t const sineTable[256] PROGMEM = {
+    0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+    49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+    90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+    117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+    127, 127, 127, 127, 126, 126, 126, 125, 125, 124, 123, 122, 122, 121, 120, 118,
+    117, 116, 115, 113, 112, 111, 109, 107, 106, 104, 102, 100, 98, 96, 94, 92,
+    90, 88, 85, 83, 81, 78, 76, 73, 71, 68, 65, 63, 60, 57, 54, 51,
+    49, 46, 43, 40, 37, 34, 31, 28, 25, 22, 19, 16, 12, 9, 6, 3,
+    0, -3, -6, -9, -12, -16, -19, -22, -25, -28, -31, -34, -37, -40, -43, -46,
+    -49, -51, -54, -57, -60, -63, -65, -68, -71, -73, -76, -78, -81, -83, -85, -88,
+    -90, -92, -94, -96, -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+    -117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100, -98, -96, -94, -92,
+    -90, -88, -85, -83, -81, -78, -76, -73, -71, -68, -65, -63, -60, -57, -54, -51,
+    -49, -46, -43, -40, -37, -34, -31, -28, -25, -22, -19, -16, -12, -9, -6, -3
+};
+
+/**
+ * \var Synth::VOICES
+ * \brief Number of voices that are mixed by the synthesizer, from the
+ * \c SYNTH_VOICES macro.
+ */
+
+/**
+ * \var Synth::SAMPLE_RATE
+ * \brief Number of samples per second that are generated by the
+ * synthesizer.
+ */
+
+/**
+ * \brief Constructs a new synthesizer with all voices set to square
+ * waves at full volume.
+ *
+ * \sa begin()
+ */
+Synth::Synth()
+    : sample(128)
+    , odd(false)
+{
+    for (uint8_t index = 0; index < SYNTH_VOICES; ++index) {
+        Voice *v = &(voices[index]);
+        v->phase = 0;
+        v->increment = 0;
+        v->remaining = 0;
+        v->volume = 255;
+        v->wave = 0;
+        v->head = 0;
+        v->tail = 0;
+    }
+}
+
+/**
+ * \brief Starts the synthesizer on Timer2.
+ *
+ * \sa end()
+ */
+void Synth::begin()
+{
+    pinMode(SYNTH_PIN, OUTPUT);
+    uint8_t sreg = SREG;
+    cli();
+    TCCR2A = _BV(COM2B1) | _BV(WGM20);  // Phase-correct PWM on OC2B.
+    TCCR2B = _BV(CS20);                 // No prescaling.
+    OCR2B = 128;
+    TIFR2 = _BV(TOV2);
+    TIMSK2 |= _BV(TOIE2);
+    SREG = sreg;
+}
+
+/**
+ * \brief Stops the synthesizer and releases Timer2.
+ *
+ * \sa begin()
+ */
+void Synth::end()
+{
+    uint8_t sreg = SREG;
+    cli();
+    TIMSK2 &= ~_BV(TOIE2);
+    TCCR2A = 0;
+    TCCR2B = 0;
+    SREG = sreg;
+    digitalWrite(SYNTH_PIN, LOW);
+}
+
+/**
+ * \fn uint8_t Synth::volume(uint8_t voice) const
+ * \brief Returns the volume of \a voice between 0 and 255.
+ *
+ * \sa setVolume()
+ */
+
+/**
+ * \fn void Synth::setVolume(uint8_t voice, uint8_t volume)
+ * \brief Sets the \a volume of \a voice between 0 and 255.
+ *
+ * The output of all voices is mixed with equal weight, so a single voice
+ * at full volume uses 1 / VOICES of the output range.
+ *
+ * \sa volume()
+ */
+
+/**
+ * \fn const int8_t *Synth::waveform(uint8_t voice) const
+ * \brief Returns the wavetable for \a voice, or NULL for a square wave.
+ *
+ * \sa setWaveform()
+ */
+
+/**
+ * \fn void Synth::setWaveform(uint8_t voice, const int8_t *wavetable)
+ * \brief Sets the \a wavetable for \a voice.
+ *
+ * The \a wavetable must be an array of 256 signed samples in program
+ * memory that covers one cycle of the waveform, or NULL for a square wave.
+ *
+ * \sa waveform(), sine()
+ */
+
+/**
+ * \brief Returns a built-in sine wave table for use with setWaveform().
+ */
+const int8_t *Synth::sine()
+{
+    return sineTable;
+}
+
+/**
+ * \brief Queues a note on \a voice.
+ *
+ * \param voice The voice to play the note on, between 0 and VOICES - 1.
+ * \param frequency The frequency of the note in Hz, or \c NOTE_REST (zero)
+ * for a rest.
+ * \param ms The length of the note in milliseconds, up to about 4 seconds.
+ *
+ * \return Returns false if the queue for \a voice is full.
+ *
+ * The note starts as soon as the previous note on the same voice ends,
+ * or immediately if the voice is idle.
+ *
+ * \sa queueSpace(), isBusy(), stop()
+ */
+bool Synth::queueNote(uint8_t voice, unsigned int frequency, unsigned int ms)
+{
+    Voice *v = &(voices[voice]);
+    uint8_t head = v->head;
+    uint8_t next = (head + 1) & (SYNTH_QUEUE_SIZE - 1);
+    if (next == v->tail)
+        return false;
+    uint32_t samples = ((uint32_t)ms) * SAMPLE_RATE / 1000UL;
+    if (!samples)
+        return true;
+    v->queue[head].increment =
+        (uint16_t)((((uint32_t)frequency) << 16) / SAMPLE_RATE);
+    v->queue[head].samples = samples < 0xFFFFU ? (uint16_t)samples : 0xFFFFU;
+    v->head = next;
+    return true;
+}
+
+/**
+ * \brief Returns the number of notes that can be added to the queue for
+ * \a voice before it is full.
+ *
+ * \sa queueNote()
+ */
+uint8_t Synth::queueSpace(uint8_t voice) const
+{
+    const Voice *v = &(voices[voice]);
+    return (v->tail - v->head - 1) & (SYNTH_QUEUE_SIZE - 1);
+}
+
+/**
+ * \brief Returns true if \a voice is playing a note or has notes queued.
+ *
+ * \sa queueNote(), stop()
+ */
+bool Synth::isBusy(uint8_t voice) const
+{
+    const Voice *v = &(voices[voice]);
+    return v->remaining != 0 || v->head != v->tail;
+}
+
+/**
+ * \brief Stops the current note on \a voice and discards its queue.
+ *
+ * \sa queueNote()
+ */
+void Synth::stop(uint8_t voice)
+{
+    Voice *v = &(voices[voice]);
+    uint8_t sreg = SREG;
+    cli();
+    v->tail = v->head;
+    v->remaining = 0;
+    v->increment = 0;
+    SREG = sreg;
+}
+
+/**
+ * \brief Handles a Timer2 overflow; must be called from the
+ * <tt>TIMER2_OVF_vect</tt> interrupt handler.
+ */
+void Synth::handleTimer()
+{
+    // Generate a sample on every second overflow.
+    odd = !odd;
+    if (odd)
+        return;
+
+    // Output the sample that was mixed last time to keep the latency
+    // constant, and then mix the next one.
+    OCR2B = sample;
+    int16_t mix = 0;
+    for (uint8_t index = 0; index < SYNTH_VOICES; ++index) {
+        Voice *v = &(voices[index]);
+        uint16_t remaining = v->remaining;
+        if (!remaining) {
+            // Start the next note in the queue, if any.
+            uint8_t tail = v->tail;
+            if (tail == v->head) {
+                v->increment = 0;
+                continue;
+            }
+            v->increment = v->queue[tail].increment;
+            remaining = v->queue[tail].samples;
+            v->tail = (tail + 1) & (SYNTH_QUEUE_SIZE - 1);
+        }
+        v->remaining = remaining - 1;
+        if (!v->increment)
+            continue;       // Rest.
+        v->phase += v->increment;
+        int8_t value;
+        if (v->wave)
+            value = (int8_t)pgm_read_byte(v->wave + (v->phase >> 8));
+        else
+            value = (v->phase & 0x8000) ? 127 : -127;
+        mix += (((int16_t)value) * v->volume) >> 8;
+    }
+    sample = (uint8_t)(128 + mix / SYNTH_VOICES);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef Synth_h
+#define Synth_h
+
+#include <inttypes.h>
+
+#if !defined(SYNTH_VOICES)
+#define SYNTH_VOICES        4
+#endif
+
+// Number of notes that can be queued on each voice; must be a power of two.
+#if !defined(SYNTH_QUEUE_SIZE)
+#define SYNTH_QUEUE_SIZE    8
+#endif
+
+class Synth
+{
+public:
+    Synth();
+
+    static const uint8_t VOICES = SYNTH_VOICES;
+    static const unsigned int SAMPLE_RATE = 15625;
+
+    void begin();
+    void end();
+
+    uint8_t volume(uint8_t voice) const { return voices[voice].volume; }
+    void setVolume(uint8_t voice, uint8_t volume)
+        { voices[voice].volume = volume; }
+
+    const int8_t *waveform(uint8_t voice) const { return voices[voice].wave; }
+    void setWaveform(uint8_t voice, const int8_t *wavetable)
+        { voices[voice].wave = wavetable; }
+
+    static const int8_t *sine();
+
+    bool queueNote(uint8_t voice, unsigned int frequency, unsigned int ms);
+    uint8_t queueSpace(uint8_t voice) const;
+    bool isBusy(uint8_t voice) const;
+    void stop(uint8_t voice);
+
+    void handleTimer();
+
+private:
+    struct Note
+    {
+        uint16_t increment;
+        uint16_t samples;
+    };
+    struct Voice
+    {
+        uint16_t phase;
+        uint16_t increment;
+        volatile uint16_t remaining;
+        uint8_t volume;
+        const int8_t *wave;
+        Note queue[SYNTH_QUEUE_SIZE];
+        volatile uint8_t head;
+        volatile uint8_t tail;
+    };
+
+    Voice voices[SYNTH_VOICES];
+    uint8_t sample;
+    bool odd;
+};
+
+#endif
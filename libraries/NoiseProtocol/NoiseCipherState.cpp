@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "NoiseCipherState.h"
+#include "Crypto.h"
+#include "utility/EndianUtil.h"
+#include <string.h>
+#include <limits.h>
+
+/**
+ * \class NoiseCipherState NoiseCipherState.h <NoiseCipherState.h>
+ * \brief CipherState object from the Noise protocol framework.
+ *
+ * This class encrypts and decrypts the messages of a Noise session with
+ * ChaChaPoly and a 64-bit message nonce.  It is used while the handshake
+ * is in progress and then NoiseHandshakeState::split() produces a pair
+ * for the transport messages that follow.
+ *
+ * Messages are limited to 65535 bytes by the Noise specification.
+ * On platforms where int is 16 bits, such as AVR, the limit is 32767.
+ *
+ * Reference: https://noiseprotocol.org/noise.html
+ *
+ * \sa NoiseHandshakeState
+ */
+
+/** @cond */
+
+// Maximum length of a Noise message, including the authentication tag.
+#if INT_MAX < 65535
+#define NOISE_MAX_MESSAGE_LEN INT_MAX
+#else
+#define NOISE_MAX_MESSAGE_LEN 65535
+#endif
+
+// Nonce value that is reserved for rekey().
+#define NOISE_MAX_NONCE 0xFFFFFFFFFFFFFFFFULL
+
+/** @endcond */
+
+/**
+ * \brief Constructs a new cipher state with no key.
+ */
+NoiseCipherState::NoiseCipherState()
+    : n(0)
+    , haveKey(false)
+{
+}
+
+/**
+ * \brief Destroys this cipher state after clearing the key.
+ */
+NoiseCipherState::~NoiseCipherState()
+{
+}
+
+/**
+ * \brief Sets the key for this cipher state and resets the nonce to zero.
+ *
+ * \param key The 32-byte key to use.
+ */
+void NoiseCipherState::setKey(const uint8_t key[32])
+{
+    cipher.setKey(key, 32);
+    n = 0;
+    haveKey = true;
+}
+
+/**
+ * \fn bool NoiseCipherState::hasKey() const
+ * \brief Determine if this cipher state has a key.
+ *
+ * \return Returns true if setKey() has been called; false if messages
+ * are passed through without being encrypted.
+ */
+
+/**
+ * \fn void NoiseCipherState::setNonce(uint64_t nonce)
+ * \brief Sets the nonce to use for the next message.
+ *
+ * \param nonce The nonce value.
+ *
+ * This is normally only needed by transports that deliver messages out
+ * of order and send the nonce value alongside each message.
+ */
+
+/**
+ * \fn uint64_t NoiseCipherState::nonce() const
+ * \brief Returns the nonce that will be used for the next message.
+ */
+
+/**
+ * \brief Encrypts a message with associated data.
+ *
+ * \param output The output buffer for the ciphertext and tag, which may
+ * be the same as \a input.
+ * \param maxOutputLen The maximum number of bytes that can be written
+ * to \a output.
+ * \param ad Points to the associated data to authenticate.
+ * \param adLen The length of the associated data.
+ * \param input Points to the plaintext to encrypt.
+ * \param inputLen The length of the plaintext.
+ *
+ * \return The number of bytes written to \a output, which is
+ * \a inputLen + 16 if there is a key or \a inputLen if there is
+ * no key; or -1 if \a output is too small or the nonce has run out.
+ *
+ * \sa decryptWithAd()
+ */
+int NoiseCipherState::encryptWithAd(uint8_t *output, size_t maxOutputLen,
+                                    const uint8_t *ad, size_t adLen,
+                                    const uint8_t *input, size_t inputLen)
+{
+    if (!haveKey) {
+        if (inputLen > maxOutputLen || inputLen > NOISE_MAX_MESSAGE_LEN)
+            return -1;
+        memmove(output, input, inputLen);
+        return (int)inputLen;
+    }
+    if (inputLen > (NOISE_MAX_MESSAGE_LEN - 16) ||
+            (inputLen + 16) > maxOutputLen || n == NOISE_MAX_NONCE)
+        return -1;
+    startMessage(n, ad, adLen);
+    cipher.encrypt(output, input, inputLen);
+    cipher.computeTag(output + inputLen, 16);
+    ++n;
+    return (int)(inputLen + 16);
+}
+
+/**
+ * \brief Decrypts a message with associated data.
+ *
+ * \param output The output buffer for the plaintext, which may be the
+ * same as \a input.
+ * \param maxOutputLen The maximum number of bytes that can be written
+ * to \a output.
+ * \param ad Points to the associated data to authenticate.
+ * \param adLen The length of the associated data.
+ * \param input Points to the ciphertext and tag to decrypt.
+ * \param inputLen The length of the ciphertext, including the tag.
+ *
+ * \return The number of bytes written to \a output; or -1 if the
+ * message is invalid, \a output is too small, or the nonce has run out.
+ * If the message is invalid, then \a output is cleared.
+ * The nonce is not incremented if the message is invalid.
+ *
+ * \sa encryptWithAd()
+ */
+int NoiseCipherState::decryptWithAd(uint8_t *output, size_t maxOutputLen,
+                                    const uint8_t *ad, size_t adLen,
+                                    const uint8_t *input, size_t inputLen)
+{
+    if (!haveKey) {
+        if (inputLen > maxOutputLen || inputLen > NOISE_MAX_MESSAGE_LEN)
+            return -1;
+        memmove(output, input, inputLen);
+        return (int)inputLen;
+    }
+    if (inputLen < 16 || inputLen > NOISE_MAX_MESSAGE_LEN)
+        return -1;
+    inputLen -= 16;
+    if (inputLen > maxOutputLen || n == NOISE_MAX_NONCE)
+        return -1;
+    startMessage(n, ad, adLen);
+    cipher.decrypt(output, input, inputLen);
+    if (!cipher.checkTag(input + inputLen, 16)) {
+        clean(output, inputLen);
+        return -1;
+    }
+    ++n;
+    return (int)inputLen;
+}
+
+/**
+ * \brief Changes the key to a new value derived from the current key.
+ *
+ * The new key is derived by encrypting 32 zero bytes with the maximum
+ * nonce value, as specified by section 11.3 of the Noise specification.
+ * The nonce for the next message is not changed.
+ */
+void NoiseCipherState::rekey()
+{
+    uint8_t key[32];
+    if (!haveKey)
+        return;
+    memset(key, 0, sizeof(key));
+    startMessage(NOISE_MAX_NONCE, 0, 0);
+    cipher.encrypt(key, key, sizeof(key));
+    cipher.setKey(key, sizeof(key));
+    clean(key);
+}
+
+/**
+ * \brief Clears the key and resets the nonce to zero.
+ */
+void NoiseCipherState::clear()
+{
+    cipher.clear();
+    n = 0;
+    haveKey = false;
+}
+
+/**
+ * \internal
+ * \brief Starts encrypting or decrypting a message.
+ *
+ * \param nonce The nonce to use for the message.
+ * \param ad Points to the associated data.
+ * \param adLen The length of the associated data.
+ */
+void NoiseCipherState::startMessage(uint64_t nonce, const uint8_t *ad,
+                                    size_t adLen)
+{
+    // The Noise nonce for ChaChaPoly is 32 bits of zeroes followed by
+    // the 64-bit nonce in little-endian.  That is the same as setting
+    // the 64-bit IV for the original ChaCha with a zero block counter.
+    uint64_t iv = htole64(nonce);
+    cipher.setIV((const uint8_t *)&iv, sizeof(iv));
+    if (adLen)
+        cipher.addAuthData(ad, adLen);
+}
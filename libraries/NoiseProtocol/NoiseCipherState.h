@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_NOISECIPHERSTATE_H
+#define CRYPTO_NOISECIPHERSTATE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "ChaChaPoly.h"
+
+class NoiseCipherState
+{
+public:
+    NoiseCipherState();
+    ~NoiseCipherState();
+
+    void setKey(const uint8_t key[32]);
+    bool hasKey() const { return haveKey; }
+
+    void setNonce(uint64_t nonce) { n = nonce; }
+    uint64_t nonce() const { return n; }
+
+    int encryptWithAd(uint8_t *output, size_t maxOutputLen,
+                      const uint8_t *ad, size_t adLen,
+                      const uint8_t *input, size_t inputLen);
+    int decryptWithAd(uint8_t *output, size_t maxOutputLen,
+                      const uint8_t *ad, size_t adLen,
+                      const uint8_t *input, size_t inputLen);
+
+    void rekey();
+
+    void clear();
+
+private:
+    ChaChaPoly cipher;
+    uint64_t n;
+    bool haveKey;
+
+    void startMessage(uint64_t nonce, const uint8_t *ad, size_t adLen);
+
+    // Disable copy constructor and operator=().
+    NoiseCipherState(const NoiseCipherState &) {}
+    NoiseCipherState &operator=(const NoiseCipherState &) { return *this; }
+};
+
+#endif
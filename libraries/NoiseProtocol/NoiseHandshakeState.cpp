@@ -0,0 +1,963 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "NoiseHandshakeState.h"
+#include "Curve25519.h"
+#include "Crypto.h"
+#include "RNG.h"
+#include "utility/ProgMemUtil.h"
+#include <string.h>
+
+/**
+ * \class NoiseHandshakeState NoiseHandshakeState.h <NoiseHandshakeState.h>
+ * \brief Handshake engine for the Noise protocol framework.
+ *
+ * This class runs the handshake phase of a Noise protocol based on
+ * Curve25519, ChaChaPoly, and BLAKE2s.  The XX, IK, and NK handshake
+ * patterns are supported:
+ *
+ * \li XX: both parties send their static public key during the handshake.
+ * \li IK: the initiator already knows the responder's static public key
+ * and sends its own static public key in the first message.
+ * \li NK: the initiator already knows the responder's static public key
+ * and the initiator is anonymous.
+ *
+ * Once the handshake has finished, split() derives a pair of
+ * NoiseCipherState objects for the transport messages:
+ *
+ * \code
+ * NoiseHandshakeState handshake;
+ * NoiseCipherState tx, rx;
+ *
+ * handshake.setLocalKeyPair(privateKey, publicKey);
+ * handshake.start(NoiseHandshakeState::XX, NoiseHandshakeState::Initiator);
+ * for (;;) {
+ *     NoiseHandshakeState::Action action = handshake.action();
+ *     if (action == NoiseHandshakeState::WriteMessage) {
+ *         int len = handshake.writeMessage(buf, sizeof(buf), 0, 0);
+ *         // Send "len" bytes from "buf" to the other party.
+ *         ...
+ *     } else if (action == NoiseHandshakeState::ReadMessage) {
+ *         // Receive a message from the other party into "buf".
+ *         ...
+ *         handshake.readMessage(payload, sizeof(payload), buf, len);
+ *     } else {
+ *         break;
+ *     }
+ * }
+ * if (!handshake.split(tx, rx, &ticket)) {
+ *     // The handshake failed.
+ *     ...
+ * }
+ * \endcode
+ *
+ * The protocol names are "Noise_XX_25519_ChaChaPoly_BLAKE2s",
+ * "Noise_IK_25519_ChaChaPoly_BLAKE2s", and "Noise_NK_25519_ChaChaPoly_BLAKE2s",
+ * which interoperate with other implementations of the Noise framework.
+ *
+ * \section noise_resume Session resumption
+ *
+ * Every handshake can produce a NoiseTicket in split().  Both parties
+ * derive the same ticket from the final chaining key and handshake hash,
+ * so there is nothing extra to send.  The responder stores the ticket
+ * indexed by its \a id, and the initiator keeps it for the next connection.
+ * The Resume pattern then reconnects without any Curve25519 operations,
+ * which can save several seconds per connection on AVR:
+ *
+ * \code
+ * -> ticket_id, nonce_i, payload
+ * <- nonce_r, payload
+ * \endcode
+ *
+ * The ticket secret is mixed in as a pre-shared key, and the random nonces
+ * from both parties are mixed into the chaining key so that each resumed
+ * session has fresh keys.  The responder extracts the ticket identifier
+ * from the first message with ticketId(), looks up the ticket, and passes
+ * it to setTicket() before calling start().
+ *
+ * The Resume pattern is an extension to the Noise framework and uses the
+ * protocol name "NoiseResume_ChaChaPoly_BLAKE2s".  It does not provide
+ * forward secrecy with respect to the ticket: anyone who later learns
+ * the ticket secret can decrypt the resumed session.  The payload of the
+ * first message can also be replayed to the responder.  Each ticket
+ * should therefore be used only once.  Resumed handshakes produce a new
+ * ticket in split() which replaces the old one, and the responder
+ * should delete the old ticket once it has been used.
+ *
+ * Reference: https://noiseprotocol.org/noise.html
+ *
+ * \sa NoiseCipherState
+ */
+
+/**
+ * \struct NoiseTicket NoiseHandshakeState.h <NoiseHandshakeState.h>
+ * \brief Session ticket for resuming a Noise session without DH operations.
+ *
+ * \var NoiseTicket::id
+ * \brief Public identifier for the ticket, which is sent in the clear.
+ *
+ * \var NoiseTicket::secret
+ * \brief Secret key for resuming the session.
+ */
+
+/** @cond */
+
+// Handshake tokens.
+#define NOISE_TOKEN_E       1   // Ephemeral public key.
+#define NOISE_TOKEN_S       2   // Static public key.
+#define NOISE_TOKEN_EE      3   // DH(e, re)
+#define NOISE_TOKEN_ES      4   // DH(e, rs) or DH(s, re)
+#define NOISE_TOKEN_SE      5   // DH(s, re) or DH(e, rs)
+#define NOISE_TOKEN_SS      6   // DH(s, rs)
+#define NOISE_TOKEN_TICKET  7   // Ticket identifier and secret.
+#define NOISE_TOKEN_NONCE   8   // Random nonce for resumption.
+#define NOISE_TOKEN_FLIP    0xFE // End of message.
+#define NOISE_TOKEN_END     0xFF // End of the handshake.
+
+static uint8_t const tokensXX[] PROGMEM = {
+    NOISE_TOKEN_E, NOISE_TOKEN_FLIP,
+    NOISE_TOKEN_E, NOISE_TOKEN_EE, NOISE_TOKEN_S, NOISE_TOKEN_ES,
+    NOISE_TOKEN_FLIP,
+    NOISE_TOKEN_S, NOISE_TOKEN_SE, NOISE_TOKEN_END
+};
+static uint8_t const tokensIK[] PROGMEM = {
+    NOISE_TOKEN_E, NOISE_TOKEN_ES, NOISE_TOKEN_S, NOISE_TOKEN_SS,
+    NOISE_TOKEN_FLIP,
+    NOISE_TOKEN_E, NOISE_TOKEN_EE, NOISE_TOKEN_SE, NOISE_TOKEN_END
+};
+static uint8_t const tokensNK[] PROGMEM = {
+    NOISE_TOKEN_E, NOISE_TOKEN_ES, NOISE_TOKEN_FLIP,
+    NOISE_TOKEN_E, NOISE_TOKEN_EE, NOISE_TOKEN_END
+};
+static uint8_t const tokensResume[] PROGMEM = {
+    NOISE_TOKEN_TICKET, NOISE_TOKEN_NONCE, NOISE_TOKEN_FLIP,
+    NOISE_TOKEN_NONCE, NOISE_TOKEN_END
+};
+
+static char const nameXX[] PROGMEM = "Noise_XX_25519_ChaChaPoly_BLAKE2s";
+static char const nameIK[] PROGMEM = "Noise_IK_25519_ChaChaPoly_BLAKE2s";
+static char const nameNK[] PROGMEM = "Noise_NK_25519_ChaChaPoly_BLAKE2s";
+static char const nameResume[] PROGMEM = "NoiseResume_ChaChaPoly_BLAKE2s";
+
+// Bits for the "flags" field.
+#define NOISE_FLAG_LOCAL_STATIC     0x01
+#define NOISE_FLAG_REMOTE_STATIC    0x02
+#define NOISE_FLAG_TICKET           0x04
+#define NOISE_FLAG_INITIATOR        0x08
+#define NOISE_FLAG_FIXED_EPHEMERAL  0x10
+
+/** @endcond */
+
+/**
+ * \brief Constructs a new handshake state.
+ */
+NoiseHandshakeState::NoiseHandshakeState()
+    : tokens(0)
+    , act(NoAction)
+    , flags(0)
+{
+}
+
+/**
+ * \brief Destroys this handshake state after clearing all keys.
+ */
+NoiseHandshakeState::~NoiseHandshakeState()
+{
+    clear();
+}
+
+/**
+ * \enum NoiseHandshakeState::Pattern
+ * \brief Handshake patterns that are supported by this class.
+ *
+ * \var NoiseHandshakeState::XX
+ * \brief Mutual authentication with static keys sent in the handshake.
+ *
+ * \var NoiseHandshakeState::IK
+ * \brief Mutual authentication where the initiator knows the responder's
+ * static key in advance.
+ *
+ * \var NoiseHandshakeState::NK
+ * \brief Anonymous initiator that knows the responder's static key in
+ * advance.
+ *
+ * \var NoiseHandshakeState::Resume
+ * \brief Resumption of an earlier session with a NoiseTicket.
+ */
+
+/**
+ * \enum NoiseHandshakeState::Role
+ * \brief Role of this party in the handshake.
+ *
+ * \var NoiseHandshakeState::Initiator
+ * \brief This party sends the first handshake message.
+ *
+ * \var NoiseHandshakeState::Responder
+ * \brief This party receives the first handshake message.
+ */
+
+/**
+ * \enum NoiseHandshakeState::Action
+ * \brief Next action that the application should perform.
+ *
+ * \var NoiseHandshakeState::NoAction
+ * \brief The handshake has not been started, or split() has been called.
+ *
+ * \var NoiseHandshakeState::WriteMessage
+ * \brief The application should call writeMessage().
+ *
+ * \var NoiseHandshakeState::ReadMessage
+ * \brief The application should call readMessage().
+ *
+ * \var NoiseHandshakeState::Split
+ * \brief The handshake has finished and the application should call split().
+ *
+ * \var NoiseHandshakeState::Failed
+ * \brief The handshake has failed and all keys have been cleared.
+ */
+
+/**
+ * \brief Sets the local static key pair.
+ *
+ * \param privateKey The 32-byte Curve25519 private key.
+ * \param publicKey The 32-byte Curve25519 public key.
+ *
+ * The key pair must be set before start() for the XX and IK patterns,
+ * or for the responder in the NK pattern.
+ *
+ * \sa generateLocalKeyPair(), localPublicKey()
+ */
+void NoiseHandshakeState::setLocalKeyPair(const uint8_t privateKey[32],
+                                          const uint8_t publicKey[32])
+{
+    memcpy(s.priv, privateKey, 32);
+    memcpy(s.pub, publicKey, 32);
+    flags |= NOISE_FLAG_LOCAL_STATIC;
+}
+
+/**
+ * \brief Generates a new local static key pair.
+ *
+ * The key pair is generated with Curve25519::dh1(), so the global random
+ * number pool must have sufficient entropy.  Use localPublicKey() to get
+ * the new public key, which is normally stored by the application along
+ * with its private key rather than generated for each handshake.
+ *
+ * \sa setLocalKeyPair()
+ */
+void NoiseHandshakeState::generateLocalKeyPair()
+{
+    Curve25519::dh1(s.pub, s.priv);
+    flags |= NOISE_FLAG_LOCAL_STATIC;
+}
+
+/**
+ * \fn const uint8_t *NoiseHandshakeState::localPublicKey() const
+ * \brief Returns the 32-byte local static public key.
+ */
+
+/**
+ * \brief Sets the remote party's static public key.
+ *
+ * \param publicKey The 32-byte Curve25519 public key.
+ *
+ * This must be called before start() by the initiator in the IK and
+ * NK patterns.
+ *
+ * \sa remotePublicKey()
+ */
+void NoiseHandshakeState::setRemotePublicKey(const uint8_t publicKey[32])
+{
+    memcpy(rs, publicKey, 32);
+    flags |= NOISE_FLAG_REMOTE_STATIC;
+}
+
+/**
+ * \fn const uint8_t *NoiseHandshakeState::remotePublicKey() const
+ * \brief Returns the 32-byte static public key of the remote party.
+ *
+ * For the XX pattern, and for the responder in the IK pattern, the key
+ * is only valid once it has been received in the handshake.  The
+ * application should check that the key belongs to an authorised party.
+ */
+
+/**
+ * \brief Sets the ticket for the Resume pattern.
+ *
+ * \param ticket The ticket from an earlier call to split().
+ *
+ * \sa ticketId(), split()
+ */
+void NoiseHandshakeState::setTicket(const NoiseTicket &ticket)
+{
+    memcpy(&(this->ticket), &ticket, sizeof(NoiseTicket));
+    flags |= NOISE_FLAG_TICKET;
+}
+
+/**
+ * \brief Gets the ticket identifier from the first message of a Resume
+ * handshake.
+ *
+ * \param message Points to the first handshake message.
+ * \param len The length of the message.
+ *
+ * \return A pointer to the 16-byte ticket identifier within \a message,
+ * or NULL if \a message is too short.
+ *
+ * \sa setTicket()
+ */
+const uint8_t *NoiseHandshakeState::ticketId(const uint8_t *message, size_t len)
+{
+    return len >= 16 ? message : 0;
+}
+
+/**
+ * \brief Starts a new handshake.
+ *
+ * \param pattern The handshake pattern to use.
+ * \param role The role of this party in the handshake.
+ * \param prologue Points to prologue data that both parties must agree on,
+ * such as a protocol version string, or NULL for none.
+ * \param prologueLen The length of the \a prologue.
+ *
+ * \return Returns true if the handshake was started; or false if the keys
+ * or ticket that \a pattern needs have not been supplied.
+ *
+ * \sa action(), setLocalKeyPair(), setRemotePublicKey(), setTicket()
+ */
+bool NoiseHandshakeState::start(Pattern pattern, Role role,
+                                const void *prologue, size_t prologueLen)
+{
+    const char *name;
+    size_t nameLen;
+    uint8_t need;
+    bool preMessage = false;
+
+    // Determine the tokens and the keys that are needed for the pattern.
+    bool initiator = (role == Initiator);
+    switch (pattern) {
+    case XX:
+        tokens = tokensXX;
+        name = nameXX;
+        nameLen = sizeof(nameXX) - 1;
+        need = NOISE_FLAG_LOCAL_STATIC;
+        break;
+    case IK:
+        tokens = tokensIK;
+        name = nameIK;
+        nameLen = sizeof(nameIK) - 1;
+        need = NOISE_FLAG_LOCAL_STATIC;
+        if (initiator)
+            need |= NOISE_FLAG_REMOTE_STATIC;
+        preMessage = true;
+        break;
+    case NK:
+        tokens = tokensNK;
+        name = nameNK;
+        nameLen = sizeof(nameNK) - 1;
+        need = initiator ? NOISE_FLAG_REMOTE_STATIC : NOISE_FLAG_LOCAL_STATIC;
+        preMessage = true;
+        break;
+    case Resume:
+        tokens = tokensResume;
+        name = nameResume;
+        nameLen = sizeof(nameResume) - 1;
+        need = NOISE_FLAG_TICKET;
+        break;
+    default:
+        return false;
+    }
+    if ((flags & need) != need) {
+        tokens = 0;
+        return false;
+    }
+    if (initiator)
+        flags |= NOISE_FLAG_INITIATOR;
+    else
+        flags &= ~NOISE_FLAG_INITIATOR;
+
+    // Initialize the symmetric state from the protocol name.  Names that
+    // are longer than the hash output are hashed, and shorter names are
+    // padded with zeroes.
+    if (nameLen <= sizeof(h)) {
+        memset(h, 0, sizeof(h));
+        memcpy_P(h, name, nameLen);
+    } else {
+        uint8_t buf[40];
+        memcpy_P(buf, name, nameLen);
+        hash.reset();
+        hash.update(buf, nameLen);
+        hash.finalize(h, sizeof(h));
+    }
+    memcpy(ck, h, sizeof(h));
+    cipher.clear();
+
+    // Mix in the prologue and the responder's pre-message static key.
+    mixHash(prologue, prologueLen);
+    if (preMessage)
+        mixHash(initiator ? rs : s.pub, 32);
+
+    act = initiator ? WriteMessage : ReadMessage;
+    return true;
+}
+
+/**
+ * \fn NoiseHandshakeState::Action NoiseHandshakeState::action() const
+ * \brief Returns the next action that the application should perform.
+ */
+
+/**
+ * \brief Writes the next handshake message.
+ *
+ * \param output The output buffer for the message.
+ * \param maxOutputLen The maximum number of bytes that can be written
+ * to \a output.
+ * \param payload Points to the payload to send with the message,
+ * which is encrypted if a key has been established.
+ * \param payloadLen The length of the payload.
+ *
+ * \return The length of the message in \a output, or -1 if the message
+ * could not be written.  If \a output is too small, then the handshake
+ * fails and action() will return Failed.
+ *
+ * \sa readMessage(), action()
+ */
+int NoiseHandshakeState::writeMessage(uint8_t *output, size_t maxOutputLen,
+                                      const uint8_t *payload, size_t payloadLen)
+{
+    size_t posn = 0;
+    uint8_t token;
+    int len;
+
+    if (act != WriteMessage)
+        return -1;
+
+    // Process the tokens for this message.
+    for (;;) {
+        token = pgm_read_byte(tokens);
+        ++tokens;
+        if (token == NOISE_TOKEN_FLIP || token == NOISE_TOKEN_END)
+            break;
+        if (!writeToken(token, output, maxOutputLen, posn)) {
+            fail();
+            return -1;
+        }
+    }
+
+    // Encrypt the payload.
+    len = encryptAndHash(output + posn, maxOutputLen - posn,
+                         payload, payloadLen);
+    if (len < 0) {
+        fail();
+        return -1;
+    }
+    act = (token == NOISE_TOKEN_END) ? Split : ReadMessage;
+    return (int)(posn + len);
+}
+
+/**
+ * \brief Reads the next handshake message.
+ *
+ * \param payload The output buffer for the payload of the message.
+ * \param maxPayloadLen The maximum number of bytes that can be written
+ * to \a payload.
+ * \param input Points to the message to read.
+ * \param inputLen The length of the message.
+ *
+ * \return The length of the payload, or -1 if the message could not be
+ * read.  If the message is invalid, then the handshake fails and action()
+ * will return Failed.
+ *
+ * \sa writeMessage(), action()
+ */
+int NoiseHandshakeState::readMessage(uint8_t *payload, size_t maxPayloadLen,
+                                     const uint8_t *input, size_t inputLen)
+{
+    size_t posn = 0;
+    uint8_t token;
+    int len;
+
+    if (act != ReadMessage)
+        return -1;
+
+    // Process the tokens for this message.
+    for (;;) {
+        token = pgm_read_byte(tokens);
+        ++tokens;
+        if (token == NOISE_TOKEN_FLIP || token == NOISE_TOKEN_END)
+            break;
+        if (!readToken(token, input, inputLen, posn)) {
+            fail();
+            return -1;
+        }
+    }
+
+    // Decrypt the payload.
+    len = decryptAndHash(payload, maxPayloadLen, input + posn, inputLen - posn);
+    if (len < 0) {
+        fail();
+        return -1;
+    }
+    act = (token == NOISE_TOKEN_END) ? Split : WriteMessage;
+    return len;
+}
+
+/**
+ * \brief Splits the final handshake state into two cipher states for
+ * the transport messages.
+ *
+ * \param tx The cipher state for messages sent by this party.
+ * \param rx The cipher state for messages received by this party.
+ * \param ticket Returns a ticket for resuming the session later,
+ * or NULL if a ticket is not required.
+ *
+ * \return Returns true if the cipher states were set; or false if the
+ * handshake has not finished.
+ *
+ * The keys in the handshake state are cleared, apart from the remote
+ * static public key and the handshake hash.
+ *
+ * \sa handshakeHash(), remotePublicKey()
+ */
+bool NoiseHandshakeState::split(NoiseCipherState &tx, NoiseCipherState &rx,
+                                NoiseTicket *ticket)
+{
+    uint8_t k1[32];
+    uint8_t k2[32];
+
+    if (act != Split)
+        return false;
+
+    // Derive the ticket from the chaining key and the handshake hash.
+    // The different input keying material separates it from the keys
+    // for the transport messages.
+    if (ticket) {
+        hkdf(k1, k2, 0, h, sizeof(h));
+        memcpy(ticket->id, k1, sizeof(ticket->id));
+        memcpy(ticket->secret, k2, sizeof(ticket->secret));
+    }
+
+    // Derive the keys for the transport messages.
+    hkdf(k1, k2, 0, 0, 0);
+    if (flags & NOISE_FLAG_INITIATOR) {
+        tx.setKey(k1);
+        rx.setKey(k2);
+    } else {
+        tx.setKey(k2);
+        rx.setKey(k1);
+    }
+    clean(k1);
+    clean(k2);
+
+    // Clean up everything except h and rs.
+    hash.clear();
+    cipher.clear();
+    clean(ck);
+    clean(s);
+    clean(e);
+    clean(re);
+    clean(this->ticket);
+    flags &= NOISE_FLAG_REMOTE_STATIC;
+    act = NoAction;
+    return true;
+}
+
+/**
+ * \fn const uint8_t *NoiseHandshakeState::handshakeHash() const
+ * \brief Returns the 32-byte handshake hash.
+ *
+ * After split(), this value uniquely identifies the session and can be
+ * used for channel binding.
+ */
+
+/**
+ * \brief Clears all keys and resets this object to its initial state.
+ */
+void NoiseHandshakeState::clear()
+{
+    hash.clear();
+    cipher.clear();
+    clean(ck);
+    clean(h);
+    clean(s);
+    clean(e);
+    clean(rs);
+    clean(re);
+    clean(ticket);
+    tokens = 0;
+    act = NoAction;
+    flags = 0;
+}
+
+/**
+ * \internal
+ * \brief Sets a fixed ephemeral private key for testing purposes.
+ *
+ * \param privateKey The 32-byte ephemeral private key.
+ *
+ * The key is also used as the random nonce in the Resume pattern.
+ */
+void NoiseHandshakeState::setFixedEphemeralKey(const uint8_t privateKey[32])
+{
+    memcpy(e.priv, privateKey, 32);
+    flags |= NOISE_FLAG_FIXED_EPHEMERAL;
+}
+
+/**
+ * \internal
+ * \brief Writes a token to the current handshake message.
+ *
+ * \param token The token to write.
+ * \param output The output buffer for the message.
+ * \param maxOutputLen The maximum length of the message.
+ * \param posn The current position in \a output, which is updated.
+ *
+ * \return Returns false if the message is too short or a DH failed.
+ */
+bool NoiseHandshakeState::writeToken(uint8_t token, uint8_t *output,
+                                     size_t maxOutputLen, size_t &posn)
+{
+    bool initiator = (flags & NOISE_FLAG_INITIATOR) != 0;
+    size_t space = maxOutputLen - posn;
+    int len;
+
+    switch (token) {
+    case NOISE_TOKEN_E:
+        if (space < 32)
+            return false;
+        if (flags & NOISE_FLAG_FIXED_EPHEMERAL) {
+            e.priv[0] &= 0xF8;
+            e.priv[31] = (e.priv[31] & 0x7F) | 0x40;
+            Curve25519::eval(e.pub, e.priv, 0);
+        } else {
+            Curve25519::dh1(e.pub, e.priv);
+        }
+        memcpy(output + posn, e.pub, 32);
+        mixHash(e.pub, 32);
+        posn += 32;
+        return true;
+
+    case NOISE_TOKEN_S:
+        len = encryptAndHash(output + posn, space, s.pub, 32);
+        if (len < 0)
+            return false;
+        posn += len;
+        return true;
+
+    case NOISE_TOKEN_TICKET:
+        if (space < sizeof(ticket.id))
+            return false;
+        memcpy(output + posn, ticket.id, sizeof(ticket.id));
+        mixHash(ticket.id, sizeof(ticket.id));
+        mixKeyAndHash(ticket.secret, sizeof(ticket.secret));
+        posn += sizeof(ticket.id);
+        return true;
+
+    case NOISE_TOKEN_NONCE:
+        if (space < 32)
+            return false;
+        if (flags & NOISE_FLAG_FIXED_EPHEMERAL)
+            memcpy(output + posn, e.priv, 32);
+        else
+            RNG.rand(output + posn, 32);
+        mixHash(output + posn, 32);
+        mixKey(output + posn, 32);
+        posn += 32;
+        return true;
+
+    default:
+        return dhToken(token, initiator);
+    }
+}
+
+/**
+ * \internal
+ * \brief Reads a token from the current handshake message.
+ *
+ * \param token The token to read.
+ * \param input Points to the message.
+ * \param inputLen The length of the message.
+ * \param posn The current position in \a input, which is updated.
+ *
+ * \return Returns false if the message is invalid or a DH failed.
+ */
+bool NoiseHandshakeState::readToken(uint8_t token, const uint8_t *input,
+                                    size_t inputLen, size_t &posn)
+{
+    bool initiator = (flags & NOISE_FLAG_INITIATOR) != 0;
+    size_t avail = inputLen - posn;
+    size_t len;
+
+    switch (token) {
+    case NOISE_TOKEN_E:
+        if (avail < 32)
+            return false;
+        memcpy(re, input + posn, 32);
+        mixHash(re, 32);
+        posn += 32;
+        return true;
+
+    case NOISE_TOKEN_S:
+        len = cipher.hasKey() ? 48 : 32;
+        if (avail < len)
+            return false;
+        if (decryptAndHash(rs, 32, input + posn, len) != 32)
+            return false;
+        flags |= NOISE_FLAG_REMOTE_STATIC;
+        posn += len;
+        return true;
+
+    case NOISE_TOKEN_TICKET:
+        if (avail < sizeof(ticket.id))
+            return false;
+        if (!secure_compare(input + posn, ticket.id, sizeof(ticket.id)))
+            return false;
+        mixHash(ticket.id, sizeof(ticket.id));
+        mixKeyAndHash(ticket.secret, sizeof(ticket.secret));
+        posn += sizeof(ticket.id);
+        return true;
+
+    case NOISE_TOKEN_NONCE:
+        if (avail < 32)
+            return false;
+        mixHash(input + posn, 32);
+        mixKey(input + posn, 32);
+        posn += 32;
+        return true;
+
+    default:
+        return dhToken(token, initiator);
+    }
+}
+
+/**
+ * \internal
+ * \brief Performs the DH operation for a token.
+ *
+ * \param token The token: ee, es, se, or ss.
+ * \param initiator Set to true if this party is the initiator.
+ *
+ * \return Returns false if the DH failed or the token is unknown.
+ */
+bool NoiseHandshakeState::dhToken(uint8_t token, bool initiator)
+{
+    switch (token) {
+    case NOISE_TOKEN_EE:
+        return dh(e.priv, re);
+    case NOISE_TOKEN_ES:
+        return initiator ? dh(e.priv, rs) : dh(s.priv, re);
+    case NOISE_TOKEN_SE:
+        return initiator ? dh(s.priv, re) : dh(e.priv, rs);
+    case NOISE_TOKEN_SS:
+        return dh(s.priv, rs);
+    default:
+        return false;
+    }
+}
+
+/**
+ * \internal
+ * \brief Performs a DH operation and mixes the result into the keys.
+ *
+ * \param priv The local private key.
+ * \param pub The remote public key.
+ *
+ * \return Returns false if \a pub is not a valid public key.
+ */
+bool NoiseHandshakeState::dh(const uint8_t *priv, const uint8_t *pub)
+{
+    uint8_t k[32];
+    uint8_t f[32];
+    memcpy(k, pub, 32);
+    memcpy(f, priv, 32);
+    f[0] &= 0xF8;
+    f[31] = (f[31] & 0x7F) | 0x40;
+    bool ok = Curve25519::dh2(k, f);
+    mixKey(k, 32);
+    clean(k);
+    return ok;
+}
+
+/**
+ * \internal
+ * \brief Encrypts data with the handshake key and mixes the result
+ * into the handshake hash.
+ *
+ * \param output The output buffer for the ciphertext.
+ * \param maxOutputLen The maximum number of bytes that can be written
+ * to \a output.
+ * \param input Points to the plaintext.
+ * \param inputLen The length of the plaintext.
+ *
+ * \return The length of the ciphertext, or -1 on error.
+ */
+int NoiseHandshakeState::encryptAndHash(uint8_t *output, size_t maxOutputLen,
+                                        const uint8_t *input, size_t inputLen)
+{
+    int len = cipher.encryptWithAd(output, maxOutputLen, h, sizeof(h),
+                                   input, inputLen);
+    if (len >= 0)
+        mixHash(output, len);
+    return len;
+}
+
+/**
+ * \internal
+ * \brief Decrypts data with the handshake key and mixes the ciphertext
+ * into the handshake hash.
+ *
+ * \param output The output buffer for the plaintext.
+ * \param maxOutputLen The maximum number of bytes that can be written
+ * to \a output.
+ * \param input Points to the ciphertext.
+ * \param inputLen The length of the ciphertext.
+ *
+ * \return The length of the plaintext, or -1 on error.
+ */
+int NoiseHandshakeState::decryptAndHash(uint8_t *output, size_t maxOutputLen,
+                                        const uint8_t *input, size_t inputLen)
+{
+    // Compute the new hash first in case the decryption is in place.
+    uint8_t newh[32];
+    hash.reset();
+    hash.update(h, sizeof(h));
+    hash.update(input, inputLen);
+    hash.finalize(newh, sizeof(newh));
+    int len = cipher.decryptWithAd(output, maxOutputLen, h, sizeof(h),
+                                   input, inputLen);
+    if (len >= 0)
+        memcpy(h, newh, sizeof(h));
+    clean(newh);
+    return len;
+}
+
+/**
+ * \internal
+ * \brief Mixes data into the handshake hash.
+ *
+ * \param data Points to the data to mix in.
+ * \param len The length of the data.
+ */
+void NoiseHandshakeState::mixHash(const void *data, size_t len)
+{
+    hash.reset();
+    hash.update(h, sizeof(h));
+    hash.update(data, len);
+    hash.finalize(h, sizeof(h));
+}
+
+/**
+ * \internal
+ * \brief Mixes input keying material into the chaining key and sets a
+ * new handshake key.
+ *
+ * \param ikm Points to the input keying material.
+ * \param len The length of the input keying material.
+ */
+void NoiseHandshakeState::mixKey(const uint8_t *ikm, size_t len)
+{
+    uint8_t k[32];
+    hkdf(ck, k, 0, ikm, len);
+    cipher.setKey(k);
+    clean(k);
+}
+
+/**
+ * \internal
+ * \brief Mixes a pre-shared key into the chaining key, the handshake
+ * hash, and the handshake key.
+ *
+ * \param ikm Points to the pre-shared key.
+ * \param len The length of the pre-shared key.
+ */
+void NoiseHandshakeState::mixKeyAndHash(const uint8_t *ikm, size_t len)
+{
+    uint8_t temph[32];
+    uint8_t k[32];
+    hkdf(ck, temph, k, ikm, len);
+    mixHash(temph, sizeof(temph));
+    cipher.setKey(k);
+    clean(temph);
+    clean(k);
+}
+
+/**
+ * \internal
+ * \brief Derives two or three outputs from the chaining key with HKDF.
+ *
+ * \param out1 The first output, which may be the same as \a ck.
+ * \param out2 The second output.
+ * \param out3 The third output, or NULL if only two are needed.
+ * \param ikm Points to the input keying material.
+ * \param len The length of the input keying material.
+ */
+void NoiseHandshakeState::hkdf(uint8_t *out1, uint8_t *out2, uint8_t *out3,
+                               const uint8_t *ikm, size_t len)
+{
+    uint8_t temp[32];
+    uint8_t counter;
+    hmac(temp, ck, ikm, len, 0, 0);
+    counter = 1;
+    hmac(out1, temp, 0, 0, &counter, 1);
+    counter = 2;
+    hmac(out2, temp, out1, 32, &counter, 1);
+    if (out3) {
+        counter = 3;
+        hmac(out3, temp, out2, 32, &counter, 1);
+    }
+    clean(temp);
+}
+
+/**
+ * \internal
+ * \brief Computes HMAC-BLAKE2s over the concatenation of two buffers.
+ *
+ * \param out The 32-byte output, which may be the same as \a key or
+ * \a data1.
+ * \param key The 32-byte key.
+ * \param data1 Points to the first buffer.
+ * \param len1 The length of the first buffer.
+ * \param data2 Points to the second buffer.
+ * \param len2 The length of the second buffer.
+ */
+void NoiseHandshakeState::hmac(uint8_t *out, const uint8_t *key,
+                               const uint8_t *data1, size_t len1,
+                               const uint8_t *data2, size_t len2)
+{
+    uint8_t k[32];
+    memcpy(k, key, sizeof(k));
+    hash.resetHMAC(k, sizeof(k));
+    hash.update(data1, len1);
+    hash.update(data2, len2);
+    hash.finalizeHMAC(k, sizeof(k), out, 32);
+    clean(k);
+}
+
+/**
+ * \internal
+ * \brief Fails the handshake and clears all keys.
+ */
+void NoiseHandshakeState::fail()
+{
+    clear();
+    act = Failed;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_NOISEHANDSHAKESTATE_H
+#define CRYPTO_NOISEHANDSHAKESTATE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "NoiseCipherState.h"
+#include "BLAKE2s.h"
+
+struct NoiseTicket
+{
+    uint8_t id[16];
+    uint8_t secret[32];
+};
+
+class NoiseHandshakeState
+{
+public:
+    NoiseHandshakeState();
+    ~NoiseHandshakeState();
+
+    enum Pattern
+    {
+        XX,
+        IK,
+        NK,
+        Resume
+    };
+
+    enum Role
+    {
+        Initiator,
+        Responder
+    };
+
+    enum Action
+    {
+        NoAction,
+        WriteMessage,
+        ReadMessage,
+        Split,
+        Failed
+    };
+
+    void setLocalKeyPair(const uint8_t privateKey[32], const uint8_t publicKey[32]);
+    void generateLocalKeyPair();
+    const uint8_t *localPublicKey() const { return s.pub; }
+
+    void setRemotePublicKey(const uint8_t publicKey[32]);
+    const uint8_t *remotePublicKey() const { return rs; }
+
+    void setTicket(const NoiseTicket &ticket);
+    static const uint8_t *ticketId(const uint8_t *message, size_t len);
+
+    bool start(Pattern pattern, Role role, const void *prologue = 0,
+               size_t prologueLen = 0);
+
+    Action action() const { return act; }
+
+    int writeMessage(uint8_t *output, size_t maxOutputLen,
+                     const uint8_t *payload, size_t payloadLen);
+    int readMessage(uint8_t *payload, size_t maxPayloadLen,
+                    const uint8_t *input, size_t inputLen);
+
+    bool split(NoiseCipherState &tx, NoiseCipherState &rx,
+               NoiseTicket *ticket = 0);
+
+    const uint8_t *handshakeHash() const { return h; }
+
+    void clear();
+
+#if defined(TEST_NOISE_HANDSHAKE)
+public:
+#else
+private:
+#endif
+    void setFixedEphemeralKey(const uint8_t privateKey[32]);
+
+private:
+    struct KeyPair
+    {
+        uint8_t priv[32];
+        uint8_t pub[32];
+    };
+
+    BLAKE2s hash;
+    NoiseCipherState cipher;
+    uint8_t ck[32];
+    uint8_t h[32];
+    KeyPair s;
+    KeyPair e;
+    uint8_t rs[32];
+    uint8_t re[32];
+    NoiseTicket ticket;
+    const uint8_t *tokens;
+    Action act;
+    uint8_t flags;
+
+    bool writeToken(uint8_t token, uint8_t *output, size_t maxOutputLen,
+                    size_t &posn);
+    bool readToken(uint8_t token, const uint8_t *input, size_t inputLen,
+                   size_t &posn);
+    bool dhToken(uint8_t token, bool initiator);
+    bool dh(const uint8_t *priv, const uint8_t *pub);
+    int encryptAndHash(uint8_t *output, size_t maxOutputLen,
+                       const uint8_t *input, size_t inputLen);
+    int decryptAndHash(uint8_t *output, size_t maxOutputLen,
+                       const uint8_t *input, size_t inputLen);
+    void mixHash(const void *data, size_t len);
+    void mixKey(const uint8_t *ikm, size_t len);
+    void mixKeyAndHash(const uint8_t *ikm, size_t len);
+    void hkdf(uint8_t *out1, uint8_t *out2, uint8_t *out3,
+              const uint8_t *ikm, size_t len);
+    void hmac(uint8_t *out, const uint8_t *key,
+              const uint8_t *data1, size_t len1,
+              const uint8_t *data2, size_t len2);
+    void fail();
+
+    // Disable copy constructor and operator=().
+    NoiseHandshakeState(const NoiseHandshakeState &) {}
+    NoiseHandshakeState &operator=(const NoiseHandshakeState &) { return *this; }
+};
+
+#endif
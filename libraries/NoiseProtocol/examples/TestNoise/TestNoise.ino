@@ -0,0 +1,639 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the Noise protocol handshake implementation
+to verify correct behaviour.
+
+The test vectors use the keys, prologue, and payloads from the cacophony
+test suite for Noise_XX, Noise_IK, and Noise_NK with 25519, ChaChaPoly,
+and BLAKE2s.  There are six messages in each vector; the ones after the
+handshake are transport messages from split(), alternating in direction.
+
+The vectors and the two handshake objects need more RAM than an Arduino Uno
+has, so use an Arduino Mega, Due, or ESP board.
+*/
+
+// Needed to gain access to NoiseHandshakeState::setFixedEphemeralKey().
+#define TEST_NOISE_HANDSHAKE 1
+
+#include <Crypto.h>
+#include <NoiseHandshakeState.h>
+#include <RNG.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#define NUM_MESSAGES 6
+#define MAX_MESSAGE_LEN 112
+
+struct TestMessage
+{
+    uint8_t len;
+    uint8_t data[MAX_MESSAGE_LEN];
+};
+
+struct TestVector
+{
+    const char *name;
+    NoiseHandshakeState::Pattern pattern;
+    uint8_t handshakeMessages;
+    TestMessage messages[NUM_MESSAGES];
+    uint8_t handshakeHash[32];
+};
+
+static char const prologue[] = "John Galt";
+static char const * const payloads[NUM_MESSAGES] = {
+    "Ludwig von Mises",
+    "Murray Rothbard",
+    "F. A. Hayek",
+    "Carl Menger",
+    "Jean-Baptiste Say",
+    "Eugen Bohm von Bawerk"
+};
+
+static uint8_t const initStaticPrivate[32] PROGMEM = {
+    0xe6, 0x1e, 0xf9, 0x91, 0x9c, 0xde, 0x45, 0xdd,
+    0x5f, 0x82, 0x16, 0x64, 0x04, 0xbd, 0x08, 0xe3,
+    0x8b, 0xce, 0xb5, 0xdf, 0xdf, 0xde, 0xd0, 0xa3,
+    0x4c, 0x8d, 0xf7, 0xed, 0x54, 0x22, 0x14, 0xd1
+};
+static uint8_t const initStaticPublic[32] PROGMEM = {
+    0x6b, 0xc3, 0x82, 0x2a, 0x2a, 0xa7, 0xf4, 0xe6,
+    0x98, 0x1d, 0x65, 0x38, 0x69, 0x2b, 0x3c, 0xdf,
+    0x3e, 0x6d, 0xf9, 0xee, 0xa6, 0xed, 0x26, 0x9e,
+    0xb4, 0x1d, 0x93, 0xc2, 0x27, 0x57, 0xb7, 0x5a
+};
+static uint8_t const initEphemeralPrivate[32] PROGMEM = {
+    0x89, 0x3e, 0x28, 0xb9, 0xdc, 0x6c, 0xa8, 0xd6,
+    0x11, 0xab, 0x66, 0x47, 0x54, 0xb8, 0xce, 0xb7,
+    0xba, 0xc5, 0x11, 0x73, 0x49, 0xa4, 0x43, 0x9a,
+    0x6b, 0x05, 0x69, 0xda, 0x97, 0x7c, 0x46, 0x4a
+};
+static uint8_t const respStaticPrivate[32] PROGMEM = {
+    0x4a, 0x3a, 0xcb, 0xfd, 0xb1, 0x63, 0xde, 0xc6,
+    0x51, 0xdf, 0xa3, 0x19, 0x4d, 0xec, 0xe6, 0x76,
+    0xd4, 0x37, 0x02, 0x9c, 0x62, 0xa4, 0x08, 0xb4,
+    0xc5, 0xea, 0x91, 0x14, 0x24, 0x6e, 0x48, 0x93
+};
+static uint8_t const respStaticPublic[32] PROGMEM = {
+    0x31, 0xe0, 0x30, 0x3f, 0xd6, 0x41, 0x8d, 0x2f,
+    0x8c, 0x0e, 0x78, 0xb9, 0x1f, 0x22, 0xe8, 0xca,
+    0xed, 0x0f, 0xbe, 0x48, 0x65, 0x6d, 0xcf, 0x47,
+    0x67, 0xe4, 0x83, 0x4f, 0x70, 0x1b, 0x8f, 0x62
+};
+static uint8_t const respEphemeralPrivate[32] PROGMEM = {
+    0xbb, 0xdb, 0x4c, 0xdb, 0xd3, 0x09, 0xf1, 0xa1,
+    0xf2, 0xe1, 0x45, 0x69, 0x67, 0xfe, 0x28, 0x8c,
+    0xad, 0xd6, 0xf7, 0x12, 0xd6, 0x5d, 0xc7, 0xb7,
+    0x79, 0x3d, 0x5e, 0x63, 0xda, 0x6b, 0x37, 0x5b
+};
+
+static TestVector const testVectorNoiseXX PROGMEM = {
+    "Noise_XX_25519_ChaChaPoly_BLAKE2s",
+    NoiseHandshakeState::XX,
+    3,
+    {{48, {0xca, 0x35, 0xde, 0xf5, 0xae, 0x56, 0xce, 0xc3,
+          0x3d, 0xc2, 0x03, 0x67, 0x31, 0xab, 0x14, 0x89,
+          0x6b, 0xc4, 0xc7, 0x5d, 0xbb, 0x07, 0xa6, 0x1f,
+          0x87, 0x9f, 0x8e, 0x3a, 0xfa, 0x4c, 0x79, 0x44,
+          0x4c, 0x75, 0x64, 0x77, 0x69, 0x67, 0x20, 0x76,
+          0x6f, 0x6e, 0x20, 0x4d, 0x69, 0x73, 0x65, 0x73}},
+     {111, {0x95, 0xeb, 0xc6, 0x0d, 0x2b, 0x1f, 0xa6, 0x72,
+           0xc1, 0xf4, 0x6a, 0x8a, 0xa2, 0x65, 0xef, 0x51,
+           0xbf, 0xe3, 0x8e, 0x7c, 0xcb, 0x39, 0xec, 0x5b,
+           0xe3, 0x40, 0x69, 0xf1, 0x44, 0x80, 0x88, 0x43,
+           0x7c, 0x36, 0x5e, 0xb3, 0x62, 0xa1, 0xc9, 0x91,
+           0xb0, 0x55, 0x7f, 0xe8, 0xa7, 0xfb, 0x18, 0x7d,
+           0x99, 0x34, 0x67, 0x65, 0xd9, 0x3e, 0xc6, 0x3d,
+           0xb6, 0xc1, 0xb0, 0x15, 0x04, 0xeb, 0xee, 0xc5,
+           0x5a, 0x22, 0x98, 0xd2, 0xdb, 0xff, 0x80, 0xef,
+           0xf0, 0x34, 0xd2, 0x05, 0x95, 0x15, 0x3f, 0x63,
+           0xa1, 0x96, 0xa6, 0xce, 0xad, 0x1e, 0x11, 0xb2,
+           0xbb, 0x13, 0xe3, 0x36, 0xfa, 0x13, 0x61, 0x6d,
+           0xd3, 0xe8, 0xb0, 0xa0, 0x70, 0xc8, 0x82, 0xed,
+           0x3f, 0x1a, 0x78, 0xc7, 0xc0, 0x6c, 0x93}},
+     {75, {0x46, 0xc3, 0x30, 0x7d, 0xe8, 0x3b, 0x01, 0x42,
+          0x58, 0x71, 0x7d, 0x97, 0x78, 0x1c, 0x1f, 0x50,
+          0x93, 0x6d, 0x8b, 0x7d, 0x50, 0xc0, 0x72, 0x2a,
+          0x17, 0x39, 0x65, 0x4d, 0x10, 0x39, 0x2d, 0x41,
+          0x5b, 0x67, 0x0c, 0x11, 0x4f, 0x79, 0xb9, 0xa4,
+          0xf8, 0x05, 0x41, 0x57, 0x0f, 0x77, 0xce, 0x88,
+          0x80, 0x2e, 0xfa, 0x42, 0x20, 0xcf, 0xf7, 0x33,
+          0xe7, 0xb5, 0x66, 0x8b, 0xa3, 0x80, 0x59, 0xec,
+          0x90, 0x4b, 0x4b, 0x8e, 0xef, 0x94, 0x48, 0x08,
+          0x5f, 0xaf, 0x51}},
+     {27, {0xd5, 0xe8, 0x3a, 0xdf, 0xaa, 0xc5, 0xdc, 0x32,
+          0x4a, 0x68, 0xf1, 0x86, 0x2d, 0xf5, 0x45, 0x49,
+          0xe5, 0x6d, 0x20, 0x9f, 0xba, 0x70, 0x72, 0x05,
+          0xf3, 0x28, 0xb2}},
+     {33, {0xd1, 0x02, 0xc9, 0x02, 0x9b, 0x1f, 0x55, 0xc7,
+          0x88, 0xf5, 0x61, 0xba, 0x77, 0x37, 0xaf, 0xbc,
+          0xce, 0xf9, 0xc9, 0xf1, 0xbf, 0x2f, 0x23, 0x81,
+          0x67, 0xfd, 0x40, 0xba, 0x9c, 0x1c, 0x13, 0x48,
+          0x67}},
+     {37, {0xcb, 0x1c, 0xe8, 0x09, 0x60, 0x38, 0x2c, 0xf4,
+          0x5d, 0x5e, 0x74, 0x0f, 0xfb, 0x72, 0x4d, 0x14,
+          0x32, 0xf0, 0x31, 0x0b, 0x20, 0xde, 0xa3, 0x4d,
+          0xdf, 0x6f, 0x4c, 0x9f, 0xd4, 0xe2, 0xa0, 0x00,
+          0xa0, 0xc6, 0x3a, 0xd8, 0xb1}}},
+    {0x6c, 0x4c, 0x56, 0xcf, 0x71, 0x61, 0x2f, 0x72,
+     0xd0, 0x5c, 0xeb, 0x96, 0xc0, 0x15, 0x5e, 0x6f,
+     0x4e, 0xa5, 0x4a, 0x26, 0xb5, 0x04, 0xc9, 0x3d,
+     0xe6, 0x32, 0xa2, 0xdb, 0x4a, 0x49, 0xd2, 0x00}
+};
+static TestVector const testVectorNoiseIK PROGMEM = {
+    "Noise_IK_25519_ChaChaPoly_BLAKE2s",
+    NoiseHandshakeState::IK,
+    2,
+    {{112, {0xca, 0x35, 0xde, 0xf5, 0xae, 0x56, 0xce, 0xc3,
+           0x3d, 0xc2, 0x03, 0x67, 0x31, 0xab, 0x14, 0x89,
+           0x6b, 0xc4, 0xc7, 0x5d, 0xbb, 0x07, 0xa6, 0x1f,
+           0x87, 0x9f, 0x8e, 0x3a, 0xfa, 0x4c, 0x79, 0x44,
+           0x0b, 0x03, 0xdd, 0xc7, 0xaa, 0xc5, 0x12, 0x3d,
+           0x06, 0xa1, 0xb2, 0x3b, 0x71, 0x67, 0x0e, 0x32,
+           0xe7, 0x6c, 0x28, 0x23, 0x9a, 0x7c, 0xa4, 0xac,
+           0x8f, 0x78, 0x4d, 0xe7, 0xe4, 0x4c, 0x1a, 0xdb,
+           0xfc, 0x6e, 0x83, 0xfe, 0xf7, 0x35, 0x2a, 0x58,
+           0xd9, 0xd5, 0x61, 0x57, 0x40, 0x0c, 0x0a, 0x73,
+           0x7b, 0x1d, 0x17, 0x1c, 0xe3, 0x68, 0x22, 0x9c,
+           0x7b, 0x75, 0x2a, 0xc2, 0x5b, 0x8f, 0xaf, 0x4e,
+           0xca, 0x69, 0x0f, 0x6d, 0x89, 0x6f, 0x54, 0x3b,
+           0xe0, 0x2c, 0x99, 0x6a, 0xb2, 0xb8, 0x6b, 0x76}},
+     {63, {0x95, 0xeb, 0xc6, 0x0d, 0x2b, 0x1f, 0xa6, 0x72,
+          0xc1, 0xf4, 0x6a, 0x8a, 0xa2, 0x65, 0xef, 0x51,
+          0xbf, 0xe3, 0x8e, 0x7c, 0xcb, 0x39, 0xec, 0x5b,
+          0xe3, 0x40, 0x69, 0xf1, 0x44, 0x80, 0x88, 0x43,
+          0xd9, 0xb5, 0xa8, 0x92, 0x7f, 0x0a, 0xc9, 0x65,
+          0x5e, 0xf7, 0x68, 0x33, 0xbc, 0x7e, 0x55, 0x61,
+          0xf4, 0x2e, 0x69, 0x1a, 0xc8, 0x40, 0x4e, 0xfd,
+          0x6f, 0xbd, 0x63, 0x08, 0xb6, 0xa2, 0x7c}},
+     {27, {0x2c, 0x25, 0x6e, 0xd0, 0x8f, 0xcd, 0x08, 0xc2,
+          0x98, 0x0f, 0x95, 0x4e, 0xe4, 0xbe, 0xac, 0xcb,
+          0x61, 0xc9, 0x58, 0x13, 0x40, 0xf5, 0xdd, 0x2f,
+          0xd1, 0xcf, 0x3b}},
+     {27, {0xd6, 0x03, 0x3f, 0x70, 0xee, 0xe2, 0x09, 0x45,
+          0xc7, 0xc9, 0xdb, 0xa3, 0x04, 0xe3, 0x97, 0xee,
+          0x3b, 0x28, 0x4f, 0xf5, 0xe0, 0x0f, 0xd9, 0xef,
+          0xb0, 0x95, 0xd3}},
+     {33, {0xa9, 0xc0, 0x68, 0xca, 0x5d, 0x8b, 0xab, 0xf7,
+          0x25, 0x60, 0x65, 0x2d, 0x8e, 0x85, 0x1a, 0xdb,
+          0xfa, 0xc3, 0x5c, 0x8a, 0x66, 0xe8, 0x10, 0xd5,
+          0x60, 0x86, 0x31, 0x73, 0xe9, 0x6a, 0xdf, 0x4c,
+          0xfe}},
+     {37, {0x2a, 0x09, 0xd8, 0xf4, 0x59, 0xe5, 0x92, 0xe7,
+          0x40, 0xfd, 0xd2, 0xed, 0xdc, 0x99, 0xbd, 0xaf,
+          0xb0, 0x4e, 0x13, 0xa2, 0x6f, 0x11, 0x7a, 0x7b,
+          0xec, 0x73, 0x86, 0x18, 0x90, 0xa0, 0x8e, 0x78,
+          0xa3, 0xee, 0x94, 0xef, 0xcb}}},
+    {0x48, 0xf3, 0xcb, 0x8b, 0xc9, 0x31, 0x9d, 0xa4,
+     0xba, 0x1e, 0x99, 0x33, 0x99, 0x1b, 0x1c, 0x4e,
+     0xd4, 0x03, 0x4f, 0x1f, 0x12, 0x6a, 0x76, 0xd3,
+     0xa1, 0xfb, 0xcf, 0xd7, 0xf9, 0x42, 0x48, 0xd4}
+};
+static TestVector const testVectorNoiseNK PROGMEM = {
+    "Noise_NK_25519_ChaChaPoly_BLAKE2s",
+    NoiseHandshakeState::NK,
+    2,
+    {{64, {0xca, 0x35, 0xde, 0xf5, 0xae, 0x56, 0xce, 0xc3,
+          0x3d, 0xc2, 0x03, 0x67, 0x31, 0xab, 0x14, 0x89,
+          0x6b, 0xc4, 0xc7, 0x5d, 0xbb, 0x07, 0xa6, 0x1f,
+          0x87, 0x9f, 0x8e, 0x3a, 0xfa, 0x4c, 0x79, 0x44,
+          0x54, 0xae, 0x76, 0x12, 0xd1, 0x72, 0x4a, 0xf4,
+          0x2a, 0xdb, 0x13, 0x01, 0x60, 0xa9, 0xa9, 0x4e,
+          0x67, 0xb5, 0xb1, 0x69, 0xb4, 0xe0, 0x0c, 0x18,
+          0x9f, 0x64, 0x67, 0xcd, 0x17, 0xeb, 0x7c, 0xad}},
+     {63, {0x95, 0xeb, 0xc6, 0x0d, 0x2b, 0x1f, 0xa6, 0x72,
+          0xc1, 0xf4, 0x6a, 0x8a, 0xa2, 0x65, 0xef, 0x51,
+          0xbf, 0xe3, 0x8e, 0x7c, 0xcb, 0x39, 0xec, 0x5b,
+          0xe3, 0x40, 0x69, 0xf1, 0x44, 0x80, 0x88, 0x43,
+          0x98, 0x6a, 0x5c, 0x92, 0x93, 0x37, 0xe3, 0x37,
+          0xac, 0x8b, 0x4a, 0x07, 0x4a, 0xf1, 0x2a, 0xb9,
+          0xf7, 0x63, 0x18, 0xa5, 0xf1, 0x8c, 0x8b, 0x59,
+          0x9a, 0x44, 0x3a, 0xf0, 0x73, 0x83, 0xce}},
+     {27, {0x55, 0x00, 0x27, 0xc7, 0xa5, 0xd4, 0x50, 0x01,
+          0x7b, 0xcb, 0x5e, 0x12, 0xb8, 0x25, 0x3b, 0x1c,
+          0x53, 0xfd, 0x22, 0x13, 0xae, 0xda, 0x84, 0x89,
+          0x1d, 0x5f, 0x95}},
+     {27, {0xdf, 0xbc, 0xe0, 0xc3, 0x82, 0x10, 0xcc, 0xee,
+          0x35, 0xe8, 0x30, 0xac, 0xa9, 0xdd, 0x8b, 0x8b,
+          0x39, 0x97, 0xb9, 0x33, 0xe7, 0x5b, 0xfc, 0x88,
+          0x64, 0xb7, 0x59}},
+     {33, {0x4c, 0x48, 0x7a, 0x88, 0x33, 0x0c, 0x7c, 0x65,
+          0xe4, 0x4d, 0x43, 0x0a, 0xdd, 0xf3, 0xd9, 0x2d,
+          0x2a, 0x15, 0xb0, 0x81, 0xa2, 0x89, 0x2b, 0x96,
+          0x69, 0x3e, 0x00, 0xb6, 0x8a, 0xec, 0x0a, 0xda,
+          0xc2}},
+     {37, {0x47, 0x1c, 0xb9, 0xf8, 0x25, 0x2d, 0x8a, 0x7e,
+          0xb2, 0x5c, 0x93, 0xf4, 0xb4, 0xae, 0xbd, 0xbf,
+          0x25, 0xe5, 0xba, 0xa2, 0x3f, 0x64, 0xc9, 0x4a,
+          0xd3, 0x25, 0x12, 0x8c, 0x22, 0x3f, 0xa4, 0xb9,
+          0x0a, 0x33, 0x49, 0xd0, 0xd2}}},
+    {0xd7, 0x24, 0x4d, 0x97, 0x40, 0x66, 0xaa, 0xe2,
+     0x37, 0x6f, 0x7b, 0xa5, 0x53, 0x4f, 0x60, 0xa6,
+     0xe4, 0xe8, 0x2c, 0xd7, 0xc9, 0x75, 0x1e, 0x22,
+     0x6c, 0xae, 0x39, 0x28, 0xe6, 0xb4, 0x9f, 0x14}
+};
+
+static TestVector testVector;
+
+NoiseHandshakeState initiator;
+NoiseHandshakeState responder;
+NoiseCipherState initiatorTx;
+NoiseCipherState initiatorRx;
+NoiseCipherState responderTx;
+NoiseCipherState responderRx;
+NoiseTicket initiatorTicket;
+NoiseTicket responderTicket;
+
+uint8_t message[MAX_MESSAGE_LEN];
+uint8_t payload[MAX_MESSAGE_LEN];
+
+void loadKey(uint8_t *key, const uint8_t *progmemKey)
+{
+    memcpy_P(key, progmemKey, 32);
+}
+
+bool startHandshake(NoiseHandshakeState::Pattern pattern, bool fixed)
+{
+    uint8_t priv[32];
+    uint8_t pub[32];
+
+    initiator.clear();
+    responder.clear();
+
+    if (pattern != NoiseHandshakeState::NK) {
+        loadKey(priv, initStaticPrivate);
+        loadKey(pub, initStaticPublic);
+        initiator.setLocalKeyPair(priv, pub);
+    }
+    loadKey(priv, respStaticPrivate);
+    loadKey(pub, respStaticPublic);
+    responder.setLocalKeyPair(priv, pub);
+    if (pattern != NoiseHandshakeState::XX)
+        initiator.setRemotePublicKey(pub);
+
+    if (fixed) {
+        loadKey(priv, initEphemeralPrivate);
+        initiator.setFixedEphemeralKey(priv);
+        loadKey(priv, respEphemeralPrivate);
+        responder.setFixedEphemeralKey(priv);
+    }
+
+    memset(priv, 0, sizeof(priv));
+    if (!initiator.start(pattern, NoiseHandshakeState::Initiator,
+                         prologue, sizeof(prologue) - 1))
+        return false;
+    return responder.start(pattern, NoiseHandshakeState::Responder,
+                           prologue, sizeof(prologue) - 1);
+}
+
+// Runs the handshake, flipping a bit in message "tamper" before it is read.
+// Returns the number of messages that were exchanged, or -1 on failure.
+// A payload that is sent in the clear can be modified without the reader
+// noticing, but the change to the handshake hash will cause the next
+// message to fail.
+int runHandshake(int tamper = -1)
+{
+    NoiseHandshakeState *writer = &initiator;
+    NoiseHandshakeState *reader = &responder;
+    NoiseHandshakeState *temp;
+    int num = 0;
+    int len;
+    while (writer->action() == NoiseHandshakeState::WriteMessage) {
+        len = writer->writeMessage(message, sizeof(message),
+                                   (const uint8_t *)(payloads[num]),
+                                   strlen(payloads[num]));
+        if (len < 0)
+            return -1;
+        if (tamper == num)
+            message[len - 1] ^= 0x01;
+        len = reader->readMessage(payload, sizeof(payload), message, len);
+        if (len < 0)
+            return -1;
+        if (tamper != num && (len != (int)strlen(payloads[num]) ||
+                memcmp(payload, payloads[num], len) != 0))
+            return -1;
+        temp = writer;
+        writer = reader;
+        reader = temp;
+        ++num;
+    }
+    if (initiator.action() != NoiseHandshakeState::Split ||
+            responder.action() != NoiseHandshakeState::Split)
+        return -1;
+    if (!initiator.split(initiatorTx, initiatorRx, &initiatorTicket))
+        return -1;
+    if (!responder.split(responderTx, responderRx, &responderTicket))
+        return -1;
+    return num;
+}
+
+bool sendTransport(NoiseCipherState &tx, NoiseCipherState &rx,
+                   const char *data, const TestMessage *expected)
+{
+    size_t dataLen = strlen(data);
+    int len = tx.encryptWithAd(message, sizeof(message), 0, 0,
+                               (const uint8_t *)data, dataLen);
+    if (len < 0)
+        return false;
+    if (expected) {
+        if (len != expected->len || memcmp(message, expected->data, len) != 0)
+            return false;
+    }
+    len = rx.decryptWithAd(payload, sizeof(payload), 0, 0, message, len);
+    return len == (int)dataLen && memcmp(payload, data, len) == 0;
+}
+
+bool checkMessage(uint8_t num)
+{
+    const TestMessage *expected = &(testVector.messages[num]);
+    const char *data = payloads[num];
+    NoiseHandshakeState *writer;
+    NoiseHandshakeState *reader;
+    int len;
+    if (num % 2) {
+        writer = &responder;
+        reader = &initiator;
+    } else {
+        writer = &initiator;
+        reader = &responder;
+    }
+    len = writer->writeMessage(message, sizeof(message),
+                               (const uint8_t *)data, strlen(data));
+    if (len != expected->len || memcmp(message, expected->data, len) != 0)
+        return false;
+    len = reader->readMessage(payload, sizeof(payload), message, len);
+    return len == (int)strlen(data) && memcmp(payload, data, len) == 0;
+}
+
+void testVectorNoise(const struct TestVector *test)
+{
+    bool ok;
+    uint8_t num;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+
+    Serial.print(testVector.name);
+    Serial.print(" ... ");
+
+    ok = startHandshake(testVector.pattern, true);
+    for (num = 0; ok && num < testVector.handshakeMessages; ++num)
+        ok = checkMessage(num);
+    if (ok) {
+        ok = initiator.action() == NoiseHandshakeState::Split &&
+             responder.action() == NoiseHandshakeState::Split;
+    }
+    if (ok) {
+        ok = initiator.split(initiatorTx, initiatorRx, &initiatorTicket) &&
+             responder.split(responderTx, responderRx, &responderTicket);
+    }
+    if (ok) {
+        ok = memcmp(initiator.handshakeHash(), testVector.handshakeHash, 32) == 0 &&
+             memcmp(responder.handshakeHash(), testVector.handshakeHash, 32) == 0;
+    }
+    for (; ok && num < NUM_MESSAGES; ++num) {
+        if (num % 2) {
+            ok = sendTransport(responderTx, initiatorRx, payloads[num],
+                               &(testVector.messages[num]));
+        } else {
+            ok = sendTransport(initiatorTx, responderRx, payloads[num],
+                               &(testVector.messages[num]));
+        }
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testTamper(NoiseHandshakeState::Pattern pattern, const char *name)
+{
+    bool ok = true;
+    int num;
+
+    Serial.print(name);
+    Serial.print(" tampered ... ");
+
+    // Each handshake message should be rejected and fail the handshake
+    // if its payload has been modified in transit.
+    for (num = 0; ok; ++num) {
+        ok = startHandshake(pattern, false);
+        if (!ok)
+            break;
+        if (runHandshake(num) >= 0)
+            ok = false;
+        else
+            ok = initiator.action() == NoiseHandshakeState::Failed ||
+                 responder.action() == NoiseHandshakeState::Failed;
+        if (ok && (num + 1) >= (pattern == NoiseHandshakeState::XX ? 3 : 2))
+            break;
+    }
+
+    // Modified transport messages should also be rejected.
+    if (ok) {
+        ok = startHandshake(pattern, false) && runHandshake() > 0;
+    }
+    if (ok) {
+        int len = initiatorTx.encryptWithAd(message, sizeof(message), 0, 0,
+                                            (const uint8_t *)payloads[0],
+                                            strlen(payloads[0]));
+        message[3] ^= 0x01;
+        ok = responderRx.decryptWithAd(payload, sizeof(payload), 0, 0,
+                                       message, len) < 0;
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+bool resumeSession(bool tamper)
+{
+    const uint8_t *id;
+    int len;
+
+    initiator.clear();
+    responder.clear();
+    initiator.setTicket(initiatorTicket);
+    if (!initiator.start(NoiseHandshakeState::Resume,
+                         NoiseHandshakeState::Initiator))
+        return false;
+    len = initiator.writeMessage(message, sizeof(message),
+                                 (const uint8_t *)payloads[0],
+                                 strlen(payloads[0]));
+    if (len < 0)
+        return false;
+    if (tamper)
+        message[len - 1] ^= 0x01;
+
+    // The responder looks up the ticket by the identifier in the message.
+    id = NoiseHandshakeState::ticketId(message, len);
+    if (!id || memcmp(id, responderTicket.id, sizeof(responderTicket.id)) != 0)
+        return false;
+    responder.setTicket(responderTicket);
+    if (!responder.start(NoiseHandshakeState::Resume,
+                         NoiseHandshakeState::Responder))
+        return false;
+    len = responder.readMessage(payload, sizeof(payload), message, len);
+    if (len != (int)strlen(payloads[0]) || memcmp(payload, payloads[0], len) != 0)
+        return false;
+
+    len = responder.writeMessage(message, sizeof(message),
+                                 (const uint8_t *)payloads[1],
+                                 strlen(payloads[1]));
+    if (len < 0)
+        return false;
+    len = initiator.readMessage(payload, sizeof(payload), message, len);
+    if (len != (int)strlen(payloads[1]) || memcmp(payload, payloads[1], len) != 0)
+        return false;
+    if (initiator.action() != NoiseHandshakeState::Split ||
+            responder.action() != NoiseHandshakeState::Split)
+        return false;
+    if (!initiator.split(initiatorTx, initiatorRx, &initiatorTicket))
+        return false;
+    if (!responder.split(responderTx, responderRx, &responderTicket))
+        return false;
+    return sendTransport(initiatorTx, responderRx, payloads[2], 0) &&
+           sendTransport(responderTx, initiatorRx, payloads[3], 0);
+}
+
+void testResume()
+{
+    NoiseTicket previous;
+    bool ok;
+    int round;
+
+    Serial.print("Resume ... ");
+
+    // Start with a full XX handshake to get the first ticket.
+    ok = startHandshake(NoiseHandshakeState::XX, false) && runHandshake() > 0;
+    ok = ok && memcmp(&initiatorTicket, &responderTicket, sizeof(NoiseTicket)) == 0;
+
+    // Resume a few times; the ticket should be rotated each time.
+    for (round = 0; ok && round < 3; ++round) {
+        previous = initiatorTicket;
+        ok = resumeSession(false);
+        if (ok) {
+            ok = memcmp(&initiatorTicket, &responderTicket, sizeof(NoiseTicket)) == 0 &&
+                 memcmp(&initiatorTicket, &previous, sizeof(NoiseTicket)) != 0;
+        }
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+
+    Serial.print("Resume tampered ... ");
+    ok = !resumeSession(true) &&
+         responder.action() == NoiseHandshakeState::Failed;
+    if (ok) {
+        // The wrong ticket secret should also fail the resumption.
+        initiatorTicket.secret[0] ^= 0x01;
+        ok = !resumeSession(false) &&
+             responder.action() == NoiseHandshakeState::Failed;
+        initiatorTicket.secret[0] ^= 0x01;
+    }
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void perfHandshake(NoiseHandshakeState::Pattern pattern, const char *name)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int len;
+
+    Serial.print(name);
+    Serial.print(" handshake ... ");
+
+    start = micros();
+    len = -1;
+    if (startHandshake(pattern, false))
+        len = runHandshake();
+    elapsed = micros() - start;
+
+    if (len < 0) {
+        Serial.println("Failed");
+        return;
+    }
+    Serial.print(elapsed / 1000.0);
+    Serial.println("ms per handshake");
+}
+
+void perfResume()
+{
+    unsigned long start;
+    unsigned long elapsed;
+    bool ok;
+
+    Serial.print("Resume handshake ... ");
+
+    start = micros();
+    ok = resumeSession(false);
+    elapsed = micros() - start;
+
+    if (!ok) {
+        Serial.println("Failed");
+        return;
+    }
+    Serial.print(elapsed / 1000.0);
+    Serial.println("ms per handshake");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    RNG.begin("TestNoise 1.0", 500);
+
+    Serial.print("State Size ... ");
+    Serial.println(sizeof(NoiseHandshakeState));
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testVectorNoise(&testVectorNoiseXX);
+    testVectorNoise(&testVectorNoiseIK);
+    testVectorNoise(&testVectorNoiseNK);
+    testTamper(NoiseHandshakeState::XX, "Noise_XX");
+    testTamper(NoiseHandshakeState::IK, "Noise_IK");
+    testTamper(NoiseHandshakeState::NK, "Noise_NK");
+    testResume();
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfHandshake(NoiseHandshakeState::XX, "Noise_XX");
+    perfHandshake(NoiseHandshakeState::IK, "Noise_IK");
+    perfHandshake(NoiseHandshakeState::NK, "Noise_NK");
+    perfResume();
+}
+
+void loop()
+{
+}
@@ -25,6 +25,10 @@
 #include <avr/sleep.h>
 #include <avr/power.h>
 #include <avr/interrupt.h>
+#include <string.h>
+#if ISR_PROFILER
+#include <ISRProfiler.h>
+#endif
 
 /**
  * \defgroup power_save Power saving utility functions
@@ -44,10 +48,40 @@
  * reduce power consumption compared to pins that are left floating.
  */
 
+static unsigned long sleepDurationFor(unsigned long ms, uint8_t *duration);
+static unsigned long durationMs(uint8_t duration);
+static void beginSleep();
+static void endSleep(uint8_t mode, unsigned long start, uint8_t duration,
+                     uint8_t wokeBy);
+static void releaseWatchdog();
+
+// Set by the watchdog interrupt so that idleFor() can tell whether it
+// woke up at the end of the sleep period or because of another interrupt.
+static volatile bool watchdogWoke = false;
+
+// Background tick function and period from setWatchdogTick().
+static void (*volatile watchdogTick)() = 0;
+static uint8_t watchdogTickPeriod = SLEEP_15_MS;
+
+#if POWER_SAVE_STATS
+static PowerSaveStats stats;
+static unsigned long activeStart = 0;
+#endif
+
 /** @cond */
 ISR(WDT_vect)
 {
+#if ISR_PROFILER
+    ISR_PROFILE(ISR_SLOT_WDT);
+#endif
+    // Background ticks run the watchdog in interrupt-only mode, which is
+    // left running.  Sleeps arm it in reset mode, so turn that off again.
+    if (watchdogTick && !(WDTCSR & (1 << WDE))) {
+        (*watchdogTick)();
+        return;
+    }
     wdt_disable();
+    watchdogWoke = true;
 }
 /** @endcond */
 
@@ -119,6 +153,14 @@ ISR(WDT_vect)
  * \ingroup power_save
  */
 
+/**
+ * \var SLEEP_FOREVER
+ * \brief Sleep without the watchdog, until woken by some other interrupt.
+ * \ingroup power_save
+ *
+ * This is normally used with sleepUntil().
+ */
+
 /**
  * \brief Puts the CPU to sleep for a specific \a duration.
  * \ingroup power_save
@@ -131,13 +173,21 @@ ISR(WDT_vect)
  */
 void sleepFor(SleepDuration duration, uint8_t mode)
 {
+    beginSleep();
+    unsigned long start = millis();
+    watchdogWoke = false;
+
     // Turn off the analog to digital converter.
     ADCSRA &= ~(1 << ADEN);
     power_adc_disable();
 
     // Turn on the watchdog timer for the desired duration.
-    wdt_enable(duration);
-    WDTCSR |= (1 << WDIE);
+    if (duration < SLEEP_FOREVER) {
+        wdt_enable(duration);
+        WDTCSR |= (1 << WDIE);
+    } else {
+        wdt_disable();
+    }
 
     // Put the device to sleep, including turning off the Brown Out Detector.
     set_sleep_mode(mode);
@@ -154,6 +204,599 @@ void sleepFor(SleepDuration duration, uint8_t mode)
     // Turn the analog to digital converter back on.
     power_adc_enable();
     ADCSRA |= (1 << ADEN);
+
+    // Resume the background ticks if the sleep interrupted them.
+    if (watchdogTick)
+        releaseWatchdog();
+
+    endSleep(mode, start, duration, watchdogWoke ? WAKE_WATCHDOG : WAKE_NONE);
+}
+
+/**
+ * \brief Puts the CPU to sleep for the longest SleepDuration that is no
+ * more than \a ms milliseconds.
+ * \ingroup power_save
+ *
+ * Returns false without sleeping if \a ms is less than the shortest
+ * duration of 15 milliseconds.  This is intended for sleeping until the
+ * next deadline of a LoopScheduler:
+ *
+ * \code
+ * void loop() {
+ *     scheduler.loop();
+ *     sleepUpTo(scheduler.timeUntilNext());
+ * }
+ * \endcode
+ *
+ * The \a mode parameter indicates the mode to use when the device is
+ * sleeping.  The default is SLEEP_MODE_IDLE.
+ *
+ * \sa sleepFor()
+ */
+bool sleepUpTo(unsigned long ms, uint8_t mode)
+{
+    uint8_t duration;
+    if (!sleepDurationFor(ms, &duration))
+        return false;
+    sleepFor((SleepDuration)duration, mode);
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Finds the longest SleepDuration that is no more than \a ms
+ * milliseconds and returns its length in milliseconds, or zero if \a ms
+ * is shorter than SLEEP_15_MS.
+ */
+static unsigned long sleepDurationFor(unsigned long ms, uint8_t *duration)
+{
+    if (ms < 15)
+        return 0;
+    uint8_t d = SLEEP_15_MS;
+    unsigned long dms = 15;
+    while (d < SLEEP_8_SEC) {
+        uint8_t next = d + 1;
+        unsigned long nextMs = durationMs(next);
+        if (ms < nextMs)
+            break;
+        d = next;
+        dms = nextMs;
+    }
+    *duration = d;
+    return dms;
+}
+
+// The Arduino core's millisecond counter, which is updated by the
+// Timer0 overflow interrupt in wiring.c.
+extern volatile unsigned long timer0_millis;
+
+/**
+ * \brief Idles the CPU for up to \a ms milliseconds without losing
+ * track of millis().
+ * \ingroup power_save
+ *
+ * This is intended for "tickless" idle loops that sleep until the next
+ * deadline of a LoopScheduler:
+ *
+ * \code
+ * void loop() {
+ *     scheduler.loop();
+ *     idleFor(scheduler.timeUntilNext());
+ * }
+ * \endcode
+ *
+ * If \a ms is at least 15 milliseconds, then the CPU is put into \a mode
+ * (SLEEP_MODE_PWR_DOWN by default) for the longest SleepDuration that fits
+ * within \a ms, and then this function returns so that the application
+ * can check its deadlines again.  Timer0 stops in the deeper sleep modes,
+ * so when the watchdog wakes the CPU, the length of the sleep is added to
+ * millis().  The watchdog oscillator is only accurate to about 10%, so the
+ * corrected millis() will drift by a similar amount while asleep.
+ *
+ * If \a ms is less than 15 milliseconds, or \a mode is SLEEP_MODE_IDLE,
+ * then the CPU is put into SLEEP_MODE_IDLE until \a ms milliseconds
+ * have passed.  Timer0 keeps running in this mode and wakes the CPU every
+ * millisecond, so millis() does not need to be corrected.
+ *
+ * If an interrupt other than the watchdog wakes the CPU from a deeper
+ * sleep mode, then the time spent asleep cannot be measured and millis()
+ * is not corrected.  This function returns early in that case so that
+ * the application can deal with the interrupt.
+ *
+ * Deeper sleep modes also stop the PWM outputs and Timer2, so fades,
+ * tone() and the timer-driven refresh modes of other classes will pause
+ * while asleep.  Pass SLEEP_MODE_IDLE as \a mode if they must keep running.
+ *
+ * Returns the number of milliseconds that were added to millis() to
+ * correct for the time spent in the deeper sleep mode.
+ *
+ * \sa sleepFor(), sleepUpTo()
+ */
+unsigned long idleFor(unsigned long ms, uint8_t mode)
+{
+    // Sleep for as much of the time as possible in the deeper mode.
+    uint8_t duration;
+    unsigned long dms = 0;
+    if (mode != SLEEP_MODE_IDLE)
+        dms = sleepDurationFor(ms, &duration);
+    if (dms) {
+        watchdogWoke = false;
+        sleepFor((SleepDuration)duration, mode);
+        if (!watchdogWoke) {
+            // Woken by some other interrupt, so return to the application.
+            releaseWatchdog();
+            return 0;
+        }
+        uint8_t sreg = SREG;
+        cli();
+        timer0_millis += dms;
+        SREG = sreg;
+#if POWER_SAVE_STATS
+        activeStart += dms;
+#endif
+        return dms;
+    }
+
+    // Idle away short periods with Timer0 still running.
+    if (!ms)
+        return 0;
+    beginSleep();
+    unsigned long start = millis();
+    while ((millis() - start) < ms) {
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_mode();
+    }
+    endSleep(SLEEP_MODE_IDLE, start, SLEEP_FOREVER, WAKE_NONE);
+    return 0;
+}
+
+/**
+ * \enum WakeSource
+ * \brief Sources that can wake the CPU from sleepUntil().
+ * \ingroup power_save
+ *
+ * The values are bit flags that can be combined with the | operator.
+ *
+ * \sa sleepUntil()
+ */
+
+/**
+ * \var WAKE_NONE
+ * \brief No wake source.
+ * \ingroup power_save
+ */
+
+/**
+ * \var WAKE_WATCHDOG
+ * \brief The maximum sleep duration expired.
+ * \ingroup power_save
+ */
+
+/**
+ * \var WAKE_INT0
+ * \brief External interrupt 0 was held LOW (D2 on the Arduino Uno).
+ * \ingroup power_save
+ *
+ * This is suitable for active-low sources such as push buttons to GND,
+ * the INT/SQW output of a DS3232 alarm, or an IR receiver module.
+ */
+
+/**
+ * \var WAKE_INT1
+ * \brief External interrupt 1 was held LOW (D3 on the Arduino Uno).
+ * \ingroup power_save
+ */
+
+/**
+ * \var WAKE_PIN_CHANGE
+ * \brief One of the pins armed with wakeOnPinChange() changed state.
+ * \ingroup power_save
+ */
+
+/**
+ * \var WAKE_SERIAL
+ * \brief The start bit of a byte arrived on the serial receive pin (D0).
+ * \ingroup power_save
+ *
+ * The USART is stopped in the deeper sleep modes, so the byte whose start
+ * bit woke the CPU is normally lost.  The sender should transmit a
+ * dummy byte first, or wait for a response before sending real data.
+ */
+
+static volatile uint8_t wokeBy = WAKE_NONE;
+static uint8_t wakeGroups = 0;
+static uint8_t serialGroup = 0xFF;
+
+/** @cond */
+static void int0Wake()
+{
+    // LOW level interrupts keep firing while the line is low.
+    detachInterrupt(0);
+    wokeBy |= WAKE_INT0;
+}
+
+static void int1Wake()
+{
+    detachInterrupt(1);
+    wokeBy |= WAKE_INT1;
+}
+/** @endcond */
+
+/**
+ * \brief Arms or disarms \a pin as a pin change wake source for
+ * sleepUntil().
+ * \ingroup power_save
+ *
+ * If \a enable is true, then changes on \a pin will wake the CPU when
+ * sleepUntil() is called with WAKE_PIN_CHANGE.  If \a enable is false,
+ * then \a pin is disarmed.
+ *
+ * The pin change interrupt vector for the pin must be handled by the
+ * application, which should call pinChangeWake() with the number of
+ * the vector:
+ *
+ * \code
+ * ISR(PCINT0_vect)
+ * {
+ *     pinChangeWake(0);
+ * }
+ *
+ * void setup() {
+ *     pinMode(8, INPUT_PULLUP);
+ *     wakeOnPinChange(8);
+ * }
+ * \endcode
+ *
+ * On the Arduino Uno, vector 0 handles D8 to D13, vector 1 handles
+ * A0 to A5, and vector 2 handles D0 to D7.
+ *
+ * \sa sleepUntil(), pinChangeWake()
+ */
+void wakeOnPinChange(uint8_t pin, bool enable)
+{
+    volatile uint8_t *pcmsk = digitalPinToPCMSK(pin);
+    if (!pcmsk)
+        return;     // Pin does not support pin change interrupts.
+    uint8_t mask = _BV(digitalPinToPCMSKbit(pin));
+    uint8_t group = _BV(digitalPinToPCICRbit(pin));
+    uint8_t sreg = SREG;
+    cli();
+    if (enable) {
+        *pcmsk |= mask;
+        wakeGroups |= group;
+    } else {
+        *pcmsk &= ~mask;
+        if (!(*pcmsk))
+            wakeGroups &= ~group;
+    }
+    SREG = sreg;
+}
+
+/**
+ * \brief Records that pin change interrupt \a group has fired.
+ * \ingroup power_save
+ *
+ * This must be called from the application's <tt>PCINTn_vect</tt>
+ * interrupt handler for each pin change group that is used with
+ * wakeOnPinChange() or WAKE_SERIAL.  While sleepUntil() is waiting for
+ * WAKE_SERIAL, changes on any pin in the same group as the serial
+ * receive pin are reported as WAKE_SERIAL.
+ *
+ * \sa wakeOnPinChange()
+ */
+void pinChangeWake(uint8_t group)
+{
+    if (group == serialGroup)
+        wokeBy |= WAKE_SERIAL;
+    else
+        wokeBy |= WAKE_PIN_CHANGE;
+}
+
+/**
+ * \brief Puts the CPU to sleep until one of \a wakeSources occurs or
+ * \a maxDuration expires.
+ * \ingroup power_save
+ *
+ * The \a wakeSources are a combination of WakeSource flags.  External
+ * interrupts and pin changes are armed together with the watchdog, so
+ * the CPU wakes as soon as a button is pressed, an RTC alarm fires, or
+ * an IR command starts to arrive, rather than at the end of the next
+ * watchdog period:
+ *
+ * \code
+ * uint8_t woke = sleepUntil(WAKE_INT0 | WAKE_INT1, SLEEP_8_SEC);
+ * if (woke & WAKE_INT0) {
+ *     // Button pressed.
+ * }
+ * if (woke & WAKE_WATCHDOG) {
+ *     // Time for a periodic sensor reading.
+ * }
+ * \endcode
+ *
+ * If \a maxDuration is SLEEP_FOREVER, then the watchdog is not used and
+ * the CPU will only wake for \a wakeSources.  The \a mode is the sleep
+ * mode to use, which defaults to SLEEP_MODE_PWR_DOWN.
+ *
+ * WAKE_INT0 and WAKE_INT1 use attachInterrupt() with a LOW level trigger,
+ * which is the only kind that can wake the CPU from power-down.  Any
+ * handler that the application has attached to the interrupt is replaced.
+ * WAKE_SERIAL uses a pin change interrupt on the serial receive pin, so
+ * like WAKE_PIN_CHANGE it requires a <tt>PCINTn_vect</tt> handler that
+ * calls pinChangeWake(); on the Arduino Uno that is PCINT2_vect.
+ *
+ * Returns the WakeSource flags for the sources that woke the CPU.  If
+ * the CPU was woken by some other interrupt, then the return value is
+ * WAKE_NONE.  Unlike idleFor(), millis() is not corrected for the time
+ * spent asleep.
+ *
+ * \sa wakeOnPinChange(), sleepFor()
+ */
+uint8_t sleepUntil(uint8_t wakeSources, SleepDuration maxDuration, uint8_t mode)
+{
+    beginSleep();
+    unsigned long start = millis();
+
+    // Arm the requested external interrupts and pin change groups.
+    wokeBy = WAKE_NONE;
+    watchdogWoke = false;
+    if (wakeSources & WAKE_INT0)
+        attachInterrupt(0, int0Wake, LOW);
+    if (wakeSources & WAKE_INT1)
+        attachInterrupt(1, int1Wake, LOW);
+    uint8_t pcicr = PCICR;
+    uint8_t groups = 0;
+    bool serialArmed = false;
+    if (wakeSources & WAKE_PIN_CHANGE)
+        groups |= wakeGroups;
+    if ((wakeSources & WAKE_SERIAL) && digitalPinToPCMSK(0)) {
+        volatile uint8_t *pcmsk = digitalPinToPCMSK(0);
+        uint8_t mask = _BV(digitalPinToPCMSKbit(0));
+        serialArmed = !(*pcmsk & mask);
+        *pcmsk |= mask;
+        serialGroup = digitalPinToPCICRbit(0);
+        groups |= _BV(serialGroup);
+    }
+    PCIFR = groups;     // Clear stale pin change flags.
+    PCICR = pcicr | groups;
+
+    // Turn off the analog to digital converter.
+    ADCSRA &= ~(1 << ADEN);
+    power_adc_disable();
+
+    // Arm the watchdog.
+    if (maxDuration < SLEEP_FOREVER) {
+        wdt_enable(maxDuration);
+        WDTCSR |= (1 << WDIE);
+    } else {
+        wdt_disable();
+    }
+
+    // Put the device to sleep, unless a wake source fired while arming.
+    set_sleep_mode(mode);
+    cli();
+    if (wokeBy == WAKE_NONE && !watchdogWoke) {
+        sleep_enable();
+#if defined(sleep_bod_disable)
+        sleep_bod_disable();
+#endif
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+
+    // Disarm everything that was armed above.
+    releaseWatchdog();
+    if (wakeSources & WAKE_INT0)
+        detachInterrupt(0);
+    if (wakeSources & WAKE_INT1)
+        detachInterrupt(1);
+    PCICR = pcicr;
+    if (serialArmed)
+        *digitalPinToPCMSK(0) &= ~_BV(digitalPinToPCMSKbit(0));
+    serialGroup = 0xFF;
+
+    // Turn the analog to digital converter back on.
+    power_adc_enable();
+    ADCSRA |= (1 << ADEN);
+
+    uint8_t result = wokeBy;
+    if (watchdogWoke)
+        result |= WAKE_WATCHDOG;
+    endSleep(mode, start, maxDuration, result);
+    return result;
+}
+
+/**
+ * \struct PowerSaveStats
+ * \brief Sleep and wake accounting that is kept by the PowerSave functions.
+ * \ingroup power_save
+ *
+ * The sleepTime and sleepCount arrays are indexed by the sleep mode
+ * shifted right by 1; for example <tt>sleepTime[SLEEP_MODE_PWR_DOWN >> 1]</tt>
+ * is the total time spent in power-down mode.  The wakeCount array is
+ * indexed by the bit number of the WakeSource that woke the CPU, with
+ * index 5 counting wake-ups from other interrupts.  The tagCount array
+ * counts the calls to powerSaveTag() for each tag.
+ *
+ * All times are in milliseconds.  The time spent in a deeper sleep mode
+ * is only known when the watchdog woke the CPU; time in SLEEP_MODE_IDLE
+ * is measured with millis().  The activeTime field is the total time
+ * spent outside of the sleep functions.
+ *
+ * The accounting can be removed by defining \c POWER_SAVE_STATS to 0
+ * in PowerSave.h.
+ *
+ * \sa powerSaveStats(), resetPowerSaveStats(), powerSaveTag()
+ */
+
+/**
+ * \internal
+ * \brief Returns the length of \a duration in milliseconds, or zero
+ * for SLEEP_FOREVER.
+ *
+ * Durations from SLEEP_15_MS double each time, but from SLEEP_250_MS
+ * onwards they are based on 250 rather than 240 milliseconds.
+ */
+static unsigned long durationMs(uint8_t duration)
+{
+    if (duration < SLEEP_250_MS)
+        return 15UL << duration;
+    else if (duration < SLEEP_FOREVER)
+        return 250UL << (duration - SLEEP_250_MS);
+    else
+        return 0;
+}
+
+/**
+ * \brief Calls \a func from the watchdog interrupt every \a period
+ * in the background.
+ * \ingroup power_save
+ *
+ * The watchdog is run in interrupt-only mode, so it will not reset the
+ * device, and \a func is called from interrupt context.  This is used
+ * by WatchdogNoiseSource to measure the jitter between the watchdog
+ * oscillator and the main clock, but it can also be used as a slow
+ * periodic timer that keeps running in SLEEP_MODE_PWR_DOWN.
+ *
+ * The background ticks are suspended while sleepFor(), idleFor() and
+ * sleepUntil() use the watchdog for their own timing, and resume when
+ * the sleep ends.  Pass NULL as \a func to stop the ticks.
+ *
+ * \sa sleepFor()
+ */
+void setWatchdogTick(void (*func)(), SleepDuration period)
+{
+    watchdogTick = func;
+    watchdogTickPeriod = period;
+    releaseWatchdog();
+}
+
+/**
+ * \internal
+ * \brief Turns off the watchdog after a sleep, or returns it to the
+ * background ticks from setWatchdogTick() if they are active.
+ */
+static void releaseWatchdog()
+{
+    if (!watchdogTick || watchdogTickPeriod >= SLEEP_FOREVER) {
+        wdt_disable();
+        return;
+    }
+    uint8_t prescale = watchdogTickPeriod & 0x07;
+#if defined(WDP3)
+    if (watchdogTickPeriod & 0x08)
+        prescale |= (1 << WDP3);
+#endif
+    uint8_t sreg = SREG;
+    cli();
+    wdt_reset();
+    WDTCSR = (1 << WDCE) | (1 << WDE);
+    WDTCSR = (1 << WDIE) | prescale;
+    SREG = sreg;
+}
+
+/**
+ * \internal
+ * \brief Accounts for the active time before a sleep.
+ */
+static void beginSleep()
+{
+#if POWER_SAVE_STATS
+    stats.activeTime += millis() - activeStart;
+#endif
+}
+
+/**
+ * \internal
+ * \brief Accounts for a sleep in \a mode that started at \a start
+ * with a maximum of \a duration, and was woken by \a wokeBy.
+ */
+static void endSleep(uint8_t mode, unsigned long start, uint8_t duration,
+                     uint8_t wokeBy)
+{
+#if POWER_SAVE_STATS
+    uint8_t index = (mode >> 1) & 0x07;
+    unsigned long now = millis();
+    if (mode == SLEEP_MODE_IDLE)
+        stats.sleepTime[index] += now - start;
+    else if (wokeBy & WAKE_WATCHDOG)
+        stats.sleepTime[index] += durationMs(duration);
+    ++(stats.sleepCount[index]);
+    uint8_t source = 0;
+    while (source < 5 && !(wokeBy & (1 << source)))
+        ++source;
+    ++(stats.wakeCount[source]);
+    activeStart = now;
+#endif
+}
+
+/**
+ * \brief Returns the sleep and wake accounting since the program started
+ * or since the last call to resetPowerSaveStats().
+ * \ingroup power_save
+ *
+ * The activeTime field is brought up to date before returning.
+ *
+ * \sa resetPowerSaveStats(), PowerSaveStats
+ */
+const PowerSaveStats &powerSaveStats()
+{
+#if POWER_SAVE_STATS
+    beginSleep();
+    activeStart = millis();
+    return stats;
+#else
+    static PowerSaveStats const empty = {0};
+    return empty;
+#endif
+}
+
+/**
+ * \brief Resets all of the sleep and wake accounting to zero.
+ * \ingroup power_save
+ *
+ * \sa powerSaveStats()
+ */
+void resetPowerSaveStats()
+{
+#if POWER_SAVE_STATS
+    memset(&stats, 0, sizeof(stats));
+    activeStart = millis();
+#endif
+}
+
+/**
+ * \brief Counts an activity \a tag in the power accounting.
+ * \ingroup power_save
+ *
+ * Applications can tag the work that they do between sleeps so that the
+ * wake-ups can be related to what caused them:
+ *
+ * \code
+ * #define TAG_BLINK   0
+ * #define TAG_SENSOR  1
+ *
+ * void loop() {
+ *     if (sensorReady()) {
+ *         readSensor();
+ *         powerSaveTag(TAG_SENSOR);
+ *     }
+ *     ...
+ *     idleFor(scheduler.timeUntilNext());
+ * }
+ * \endcode
+ *
+ * The \a tag must be less than \c POWER_SAVE_TAGS, which is 8 by default.
+ *
+ * \sa powerSaveStats()
+ */
+void powerSaveTag(uint8_t tag)
+{
+#if POWER_SAVE_STATS
+    if (tag < POWER_SAVE_TAGS)
+        ++(stats.tagCount[tag]);
+#endif
 }
 
 /*\@}*/
@@ -28,6 +28,17 @@
 #else
 #include <WProgram.h>
 #endif
+#include <avr/sleep.h>
+
+// Set to 0 to remove the sleep and wake accounting from PowerSave.
+#if !defined(POWER_SAVE_STATS)
+#define POWER_SAVE_STATS    1
+#endif
+
+// Number of application-defined activity tags for powerSaveTag().
+#if !defined(POWER_SAVE_TAGS)
+#define POWER_SAVE_TAGS     8
+#endif
 
 inline void unusedPin(uint8_t pin)
 {
@@ -46,9 +57,42 @@ enum SleepDuration
     SLEEP_1_SEC,
     SLEEP_2_SEC,
     SLEEP_4_SEC,
-    SLEEP_8_SEC
+    SLEEP_8_SEC,
+    SLEEP_FOREVER
+};
+
+enum WakeSource
+{
+    WAKE_NONE       = 0x00,
+    WAKE_WATCHDOG   = 0x01,
+    WAKE_INT0       = 0x02,
+    WAKE_INT1       = 0x04,
+    WAKE_PIN_CHANGE = 0x08,
+    WAKE_SERIAL     = 0x10
 };
 
 void sleepFor(SleepDuration duration, uint8_t mode = 0);
+bool sleepUpTo(unsigned long ms, uint8_t mode = 0);
+unsigned long idleFor(unsigned long ms, uint8_t mode = SLEEP_MODE_PWR_DOWN);
+
+void wakeOnPinChange(uint8_t pin, bool enable = true);
+void pinChangeWake(uint8_t group);
+uint8_t sleepUntil(uint8_t wakeSources, SleepDuration maxDuration = SLEEP_FOREVER,
+                   uint8_t mode = SLEEP_MODE_PWR_DOWN);
+
+void setWatchdogTick(void (*func)(), SleepDuration period = SLEEP_15_MS);
+
+struct PowerSaveStats
+{
+    unsigned long activeTime;
+    unsigned long sleepTime[8];
+    unsigned int sleepCount[8];
+    unsigned int wakeCount[6];
+    unsigned int tagCount[POWER_SAVE_TAGS];
+};
+
+const PowerSaveStats &powerSaveStats();
+void resetPowerSaveStats();
+void powerSaveTag(uint8_t tag);
 
 #endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "AlarmScheduler.h"
+#include "DS3232RTC.h"
+
+/**
+ * \class AlarmScheduler AlarmScheduler.h <AlarmScheduler.h>
+ * \brief Multiplexes any number of software alarms onto one of the
+ * hardware alarms in a DS3232 realtime clock chip.
+ *
+ * Events are kept in a queue sorted by their due time, in seconds since
+ * the Unix epoch (see RTC::toEpoch()).  The scheduler programs the time
+ * of the earliest event into the DS3232's hardware alarm and enables the
+ * alarm interrupt, so that the application can sleep until the INT pin
+ * is asserted instead of polling the time.  When the interrupt occurs,
+ * the application calls dispatch() to run the callbacks for all events
+ * that are due, after which the next event is armed.
+ *
+ * \code
+ * SoftI2C bus(A4, A5);
+ * DS3232RTC rtc(bus);
+ * AlarmScheduler scheduler(rtc);
+ * AlarmScheduler::Event reading;
+ * volatile bool alarmFired = false;
+ *
+ * void takeReading(AlarmScheduler *scheduler, AlarmScheduler::Event *event)
+ * {
+ *     ...
+ * }
+ *
+ * void onAlarm()
+ * {
+ *     alarmFired = true;
+ * }
+ *
+ * void setup()
+ * {
+ *     RTCDate date;
+ *     RTCTime time;
+ *     rtc.readDateTime(&date, &time);
+ *     reading.when = RTC::toEpoch(&date, &time) + 60;
+ *     reading.interval = 15 * 60;     // Repeat every 15 minutes.
+ *     reading.callback = takeReading;
+ *     scheduler.add(&reading);
+ *     attachInterrupt(0, onAlarm, FALLING);
+ * }
+ *
+ * void loop()
+ * {
+ *     if (alarmFired) {
+ *         alarmFired = false;
+ *         scheduler.dispatch();
+ *     }
+ *     sleepFor(SLEEP_8_SEC);
+ * }
+ * \endcode
+ *
+ * The hardware alarm matches on the hour and minute, so events are
+ * dispatched at the start of the minute after they become due, up to 59
+ * seconds late.  Events that are more than a day away are handled by
+ * re-arming the alarm each time it fires until the event is due.
+ *
+ * The scheduler takes over the hardware alarm selected by \a alarmNum (0 or
+ * 1) and the corresponding alarm slot in the clock's non-volatile memory.
+ * The DS3232RTC object must be constructed without a 1 Hz pin because the
+ * DS3232 shares its INT pin with the square wave output.  If the DS3232
+ * chip is not present, alarms still work if dispatch() is called regularly.
+ *
+ * \sa DS3232RTC::enableAlarmInterrupts(), RTC::toEpoch()
+ */
+
+/**
+ * \typedef AlarmScheduler::EventCallback
+ * \brief Function that is called when an event becomes due.
+ *
+ * \param scheduler The scheduler that dispatched the event.
+ * \param event The event that is due.  For a one-shot event, the callback
+ * may modify the event and add() it again.
+ */
+
+/**
+ * \var AlarmScheduler::Event::next
+ * \brief Next event in the queue; managed by the scheduler.
+ */
+
+/**
+ * \var AlarmScheduler::Event::when
+ * \brief Time that the event is due, in seconds since the Unix epoch.
+ */
+
+/**
+ * \var AlarmScheduler::Event::interval
+ * \brief Number of seconds between repeats of the event, or zero for
+ * a one-shot event.
+ */
+
+/**
+ * \var AlarmScheduler::Event::callback
+ * \brief Function to call when the event is due, or null for none.
+ */
+
+/**
+ * \brief Constructs a new alarm scheduler for the DS3232 realtime clock
+ * \a rtc, using the hardware alarm \a alarmNum (0 or 1).
+ */
+AlarmScheduler::AlarmScheduler(DS3232RTC &rtc, uint8_t alarmNum)
+    : _rtc(&rtc)
+    , events(0)
+    , _alarmNum(alarmNum)
+    , interruptsEnabled(false)
+    , dispatching(false)
+{
+}
+
+/**
+ * \fn DS3232RTC *AlarmScheduler::rtc() const
+ * \brief Returns the realtime clock that this scheduler uses.
+ */
+
+/**
+ * \fn uint8_t AlarmScheduler::alarmNum() const
+ * \brief Returns the number of the hardware alarm that this scheduler uses.
+ */
+
+/**
+ * \fn AlarmScheduler::Event *AlarmScheduler::nextEvent() const
+ * \brief Returns the next event that is due, or null if the queue is empty.
+ *
+ * The rest of the queue can be traversed with Event::next.
+ */
+
+/**
+ * \brief Adds \a event to the queue of pending events.
+ *
+ * The \a event must remain valid until it has been dispatched, or until
+ * it is removed with remove().  Repeating events stay in the queue until
+ * they are removed.  If the event is already due, it is dispatched
+ * immediately, or when the current callback returns if add() is called
+ * from an event callback.
+ *
+ * \sa remove(), dispatch()
+ */
+void AlarmScheduler::add(Event *event)
+{
+    insert(event);
+    if (events == event && !dispatching)
+        dispatch();
+}
+
+/**
+ * \brief Removes \a event from the queue of pending events.
+ *
+ * Returns false if \a event was not in the queue.
+ *
+ * \sa add()
+ */
+bool AlarmScheduler::remove(Event *event)
+{
+    Event **prev = &events;
+    while (*prev && *prev != event)
+        prev = &((*prev)->next);
+    if (!(*prev))
+        return false;
+    bool wasFirst = (events == event);
+    *prev = event->next;
+    event->next = 0;
+    if (wasFirst)
+        arm();
+    return true;
+}
+
+/**
+ * \brief Dispatches all events that are due and arms the hardware alarm
+ * for the next event.
+ *
+ * This function should be called after the DS3232 raises its alarm
+ * interrupt.  It is safe to call it at other times as well, for example
+ * from a periodic wakeup, in which case only the events that are due will
+ * be dispatched.  It must not be called from an interrupt handler as it
+ * performs I2C transactions with the realtime clock.
+ *
+ * \sa add()
+ */
+void AlarmScheduler::dispatch()
+{
+    // Clear the alarm flags in the chip so that INT is released.
+    _rtc->firedAlarm();
+
+    dispatching = true;
+    for (;;) {
+        RTCDate date;
+        RTCTime time;
+        _rtc->readDateTime(&date, &time);
+        uint32_t now = RTC::toEpoch(&date, &time);
+
+        Event *event = events;
+        if (!event || event->when > now)
+            break;
+        events = event->next;
+        event->next = 0;
+        if (event->interval) {
+            // Skip any repeats that were missed while we were not looking.
+            event->when += ((now - event->when) / event->interval + 1) *
+                           event->interval;
+            insert(event);
+        }
+        if (event->callback)
+            (*(event->callback))(this, event);
+    }
+    dispatching = false;
+
+    arm();
+}
+
+/**
+ * \internal
+ * \brief Inserts \a event into the queue in order of due time.
+ *
+ * Events with the same due time are dispatched in the order they were added.
+ */
+void AlarmScheduler::insert(Event *event)
+{
+    Event **prev = &events;
+    while (*prev && (*prev)->when <= event->when)
+        prev = &((*prev)->next);
+    event->next = *prev;
+    *prev = event;
+}
+
+/**
+ * \internal
+ * \brief Programs the hardware alarm with the time of the next event.
+ */
+void AlarmScheduler::arm()
+{
+    RTCAlarm alarm;
+    alarm.day = 0;
+    alarm.dow = 0;
+    alarm.second = 0;
+    if (events) {
+        // The alarm matches at the start of a minute, so round the due
+        // time up so that the event has become due when the alarm fires.
+        RTCDate date;
+        RTCTime time;
+        RTC::fromEpoch(events->when + 59, &date, &time);
+        alarm.hour = time.hour;
+        alarm.minute = time.minute;
+        alarm.flags = 0x01;
+    } else {
+        alarm.hour = 0;
+        alarm.minute = 0;
+        alarm.flags = 0;
+    }
+    _rtc->writeAlarm(_alarmNum, &alarm);
+    if (!interruptsEnabled) {
+        _rtc->enableAlarmInterrupts();
+        interruptsEnabled = true;
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef AlarmScheduler_h
+#define AlarmScheduler_h
+
+#include <inttypes.h>
+
+class DS3232RTC;
+
+class AlarmScheduler
+{
+public:
+    explicit AlarmScheduler(DS3232RTC &rtc, uint8_t alarmNum = 0);
+
+    struct Event;
+    typedef void (*EventCallback)(AlarmScheduler *scheduler, Event *event);
+
+    struct Event
+    {
+        Event *next;
+        uint32_t when;
+        uint32_t interval;
+        EventCallback callback;
+    };
+
+    DS3232RTC *rtc() const { return _rtc; }
+    uint8_t alarmNum() const { return _alarmNum; }
+
+    void add(Event *event);
+    bool remove(Event *event);
+    Event *nextEvent() const { return events; }
+
+    void dispatch();
+
+private:
+    DS3232RTC *_rtc;
+    Event *events;
+    uint8_t _alarmNum;
+    bool interruptsEnabled;
+    bool dispatching;
+
+    void insert(Event *event);
+    void arm();
+};
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CachedRTC.h"
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+ * \class CachedRTC CachedRTC.h <CachedRTC.h>
+ * \brief Software clock that caches the time from another realtime clock.
+ *
+ * Reading the time from a realtime clock chip such as DS3232RTC costs
+ * an I2C transaction every time.  CachedRTC reads the time and date from
+ * the underlying clock once and then advances its own copy, so that
+ * readTime(), readDate() and readDateTime() only need a few memory
+ * accesses.  The cached copy is re-synchronized from the underlying
+ * clock every resyncInterval() seconds.
+ *
+ * The best accuracy is obtained by connecting the 1 Hz square wave output
+ * of the realtime clock chip to an interrupt pin and calling tick() from
+ * the interrupt handler on every falling edge:
+ *
+ * \code
+ * SoftI2C i2c(A4, A5);
+ * DS3232RTC rtc(i2c, 2);
+ * CachedRTC clock(rtc);
+ *
+ * void onTick()
+ * {
+ *     clock.tick();
+ * }
+ *
+ * void setup()
+ * {
+ *     attachInterrupt(digitalPinToInterrupt(2), onTick, FALLING);
+ * }
+ * \endcode
+ *
+ * The clock then advances exactly once per second in step with the chip,
+ * and millisecond() interpolates between edges using millis().  If tick()
+ * is never called, the cached clock is advanced using millis() alone.
+ * If tick() has been called before but the edges stop arriving for more
+ * than two seconds, the clock falls back to reading the underlying clock.
+ *
+ * Alarms, NVRAM and the temperature are passed straight through to the
+ * underlying clock.  Writing the time or date updates the underlying clock
+ * and forces a re-synchronization on the next read.
+ *
+ * \sa RTC, DS1307RTC, DS3231RTC, DS3232RTC
+ */
+
+/**
+ * \brief Default number of seconds between re-synchronizations with
+ * the underlying realtime clock.
+ */
+#if !defined(CACHED_RTC_RESYNC_INTERVAL)
+#define CACHED_RTC_RESYNC_INTERVAL  3600UL
+#endif
+
+// Number of milliseconds without an edge before tick() is considered
+// to have stopped.
+#define CACHED_RTC_EDGE_TIMEOUT     2000UL
+
+/**
+ * \brief Constructs a new cached clock that takes its time and date
+ * from \a rtc.
+ *
+ * The time is not read from \a rtc until the first call to sync(),
+ * readTime(), readDate(), readDateTime() or hasUpdates().
+ */
+CachedRTC::CachedRTC(RTC &rtc)
+    : _rtc(&rtc)
+    , _resyncInterval(CACHED_RTC_RESYNC_INTERVAL)
+    , _sinceSync(0)
+    , _edgeMillis(0)
+    , _tickMillis(0)
+    , _ticks(0)
+    , _edgeDriven(false)
+    , _synced(false)
+    , _updated(false)
+{
+    _date.day = 1;
+    _date.month = 1;
+    _date.year = 2000;
+    _time.hour = 0;
+    _time.minute = 0;
+    _time.second = 0;
+}
+
+/**
+ * \fn RTC *CachedRTC::source() const
+ * \brief Returns the underlying realtime clock that this object caches.
+ */
+
+/**
+ * \fn unsigned long CachedRTC::resyncInterval() const
+ * \brief Returns the number of seconds between re-synchronizations with
+ * the underlying realtime clock.
+ *
+ * The default is 3600, or once an hour.
+ *
+ * \sa setResyncInterval(), sync()
+ */
+
+/**
+ * \fn void CachedRTC::setResyncInterval(unsigned long seconds)
+ * \brief Sets the number of \a seconds between re-synchronizations with
+ * the underlying realtime clock.
+ *
+ * \sa resyncInterval(), sync()
+ */
+
+/**
+ * \brief Re-synchronizes the cached time and date with the underlying
+ * realtime clock immediately.
+ *
+ * This is called automatically every resyncInterval() seconds.
+ *
+ * \sa resyncInterval()
+ */
+void CachedRTC::sync()
+{
+    // Discard edges that occurred before the read.  Edges that occur
+    // during the read are counted because the chip latches its time
+    // registers at the start of the I2C transaction.
+    noInterrupts();
+    _ticks = 0;
+    interrupts();
+    _rtc->readDateTime(&_date, &_time);
+    _edgeMillis = millis();
+    _sinceSync = 0;
+    _synced = true;
+    _updated = true;
+}
+
+/**
+ * \brief Advances the clock on a falling edge of the 1 Hz square wave
+ * from the realtime clock chip.
+ *
+ * This function is intended to be called from an interrupt handler.
+ * It only records the edge; the cached time is advanced the next time
+ * it is read.
+ */
+void CachedRTC::tick()
+{
+    if (_ticks != 0xFFFF)
+        ++_ticks;
+    _tickMillis = millis();
+    _edgeDriven = true;
+}
+
+/**
+ * \brief Returns the number of milliseconds since the start of the
+ * current second, between 0 and 999.
+ *
+ * When tick() is in use, this is measured from the last 1 Hz edge.
+ * Immediately after a re-synchronization and before the next edge,
+ * the value is measured from the time of the re-synchronization instead.
+ */
+unsigned int CachedRTC::millisecond()
+{
+    update();
+    unsigned long elapsed = millis() - _edgeMillis;
+    return elapsed < 1000 ? (unsigned int)elapsed : 999;
+}
+
+/**
+ * \brief Returns true if the cached time has changed since the last call
+ * to this function.
+ */
+bool CachedRTC::hasUpdates()
+{
+    update();
+    bool updated = _updated;
+    _updated = false;
+    return updated;
+}
+
+void CachedRTC::readTime(RTCTime *value)
+{
+    update();
+    *value = _time;
+}
+
+void CachedRTC::readDate(RTCDate *value)
+{
+    update();
+    *value = _date;
+}
+
+void CachedRTC::readDateTime(RTCDate *date, RTCTime *time)
+{
+    update();
+    *date = _date;
+    *time = _time;
+}
+
+void CachedRTC::writeTime(const RTCTime *value)
+{
+    _rtc->writeTime(value);
+    _synced = false;
+}
+
+void CachedRTC::writeDate(const RTCDate *value)
+{
+    _rtc->writeDate(value);
+    _synced = false;
+}
+
+void CachedRTC::readAlarm(uint8_t alarmNum, RTCAlarm *value)
+{
+    _rtc->readAlarm(alarmNum, value);
+}
+
+void CachedRTC::writeAlarm(uint8_t alarmNum, const RTCAlarm *value)
+{
+    _rtc->writeAlarm(alarmNum, value);
+}
+
+int CachedRTC::byteCount() const
+{
+    return _rtc->byteCount();
+}
+
+uint8_t CachedRTC::readByte(uint8_t offset)
+{
+    return _rtc->readByte(offset);
+}
+
+void CachedRTC::writeByte(uint8_t offset, uint8_t value)
+{
+    _rtc->writeByte(offset, value);
+}
+
+void CachedRTC::readBytes(uint8_t offset, uint8_t *data, uint8_t len)
+{
+    _rtc->readBytes(offset, data, len);
+}
+
+void CachedRTC::writeBytes(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+    _rtc->writeBytes(offset, data, len);
+}
+
+int CachedRTC::readTemperature()
+{
+    return _rtc->readTemperature();
+}
+
+int CachedRTC::readAgingOffset()
+{
+    return _rtc->readAgingOffset();
+}
+
+bool CachedRTC::writeAgingOffset(int8_t value)
+{
+    return _rtc->writeAgingOffset(value);
+}
+
+/**
+ * \internal
+ * \brief Brings the cached time up to date with the edges and millis()
+ * since the last update.
+ */
+void CachedRTC::update()
+{
+    if (!_synced) {
+        sync();
+        return;
+    }
+
+    // Collect the edges that were recorded by the interrupt handler.
+    noInterrupts();
+    unsigned long seconds = _ticks;
+    unsigned long tickMillis = _tickMillis;
+    bool edgeDriven = _edgeDriven;
+    _ticks = 0;
+    interrupts();
+
+    unsigned long now = millis();
+    if (seconds) {
+        _edgeMillis = tickMillis;
+    } else if (edgeDriven) {
+        // The edges have stopped arriving, so read the time directly.
+        if ((now - _edgeMillis) >= CACHED_RTC_EDGE_TIMEOUT)
+            sync();
+        return;
+    } else {
+        // No 1 Hz input is in use, so advance on millis() alone.
+        seconds = (now - _edgeMillis) / 1000;
+        if (!seconds)
+            return;
+        _edgeMillis += seconds * 1000;
+    }
+
+    // Re-synchronize if the interval has expired rather than stepping
+    // the cached time through all of the missed seconds.
+    if ((_sinceSync + seconds) >= _resyncInterval) {
+        sync();
+        return;
+    }
+    _sinceSync += seconds;
+    while (seconds-- > 0)
+        advance();
+    _updated = true;
+}
+
+/**
+ * \internal
+ * \brief Advances the cached time and date by one second.
+ */
+void CachedRTC::advance()
+{
+    if (++(_time.second) < 60)
+        return;
+    _time.second = 0;
+    if (++(_time.minute) < 60)
+        return;
+    _time.minute = 0;
+    if (++(_time.hour) < 24)
+        return;
+    _time.hour = 0;
+    uint8_t month = _date.month;
+    adjustDays(&_date, INCREMENT);
+    if (_date.month < month)
+        ++(_date.year);
+}
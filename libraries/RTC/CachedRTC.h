@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CachedRTC_h
+#define CachedRTC_h
+
+#include "RTC.h"
+
+class CachedRTC : public RTC {
+public:
+    explicit CachedRTC(RTC &rtc);
+
+    RTC *source() const { return _rtc; }
+
+    unsigned long resyncInterval() const { return _resyncInterval; }
+    void setResyncInterval(unsigned long seconds) { _resyncInterval = seconds; }
+
+    void sync();
+    void tick();
+
+    unsigned int millisecond();
+
+    bool hasUpdates();
+
+    void readTime(RTCTime *value);
+    void readDate(RTCDate *value);
+    void readDateTime(RTCDate *date, RTCTime *time);
+
+    void writeTime(const RTCTime *value);
+    void writeDate(const RTCDate *value);
+
+    void readAlarm(uint8_t alarmNum, RTCAlarm *value);
+    void writeAlarm(uint8_t alarmNum, const RTCAlarm *value);
+
+    int byteCount() const;
+    uint8_t readByte(uint8_t offset);
+    void writeByte(uint8_t offset, uint8_t value);
+    void readBytes(uint8_t offset, uint8_t *data, uint8_t len);
+    void writeBytes(uint8_t offset, const uint8_t *data, uint8_t len);
+
+    int readTemperature();
+
+    int readAgingOffset();
+    bool writeAgingOffset(int8_t value);
+
+private:
+    RTC *_rtc;
+    RTCDate _date;
+    RTCTime _time;
+    unsigned long _resyncInterval;
+    unsigned long _sinceSync;
+    unsigned long _edgeMillis;
+    volatile unsigned long _tickMillis;
+    volatile unsigned int _ticks;
+    volatile bool _edgeDriven;
+    bool _synced;
+    bool _updated;
+
+    void update();
+    void advance();
+};
+
+#endif
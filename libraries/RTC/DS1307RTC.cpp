@@ -27,6 +27,7 @@
 #else
 #include <WProgram.h>
 #endif
+#include <string.h>
 
 /**
  * \class DS1307RTC DS1307RTC.h <DS1307RTC.h>
@@ -48,6 +49,10 @@
  * then the contents of NVRAM will be cleared.  Any previous contents
  * will be lost.
  *
+ * The alarm settings are read from the chip's NVRAM once when the object
+ * is constructed and are cached in memory after that, so readAlarm()
+ * does not need to touch the I2C bus.
+ *
  * \sa RTC, DS3232RTC
  */
 
@@ -87,10 +92,10 @@ DS1307RTC::DS1307RTC(I2CMaster &bus, uint8_t oneHzPin)
     , _isRealTime(true)
 {
     // Make sure the CH bit in register 0 is off or the clock won't update.
-    _bus->startWrite(DS1307_I2C_ADDRESS);
-    _bus->write(DS1307_SECOND);
-    if (_bus->startRead(DS1307_I2C_ADDRESS, 1)) {
-        uint8_t value = _bus->read();
+    uint8_t reg = DS1307_SECOND;
+    uint8_t data;
+    if (_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, &data, 1)) {
+        uint8_t value = data;
         if ((value & 0x80) != 0)
             writeRegister(DS1307_SECOND, value & 0x7F);
     } else {
@@ -157,12 +162,12 @@ inline uint8_t fromHourBCD(uint8_t value)
 void DS1307RTC::readTime(RTCTime *value)
 {
     if (_isRealTime) {
-        _bus->startWrite(DS1307_I2C_ADDRESS);
-        _bus->write(DS1307_SECOND);
-        if (_bus->startRead(DS1307_I2C_ADDRESS, 3)) {
-            value->second = fromBCD(_bus->read() & 0x7F);
-            value->minute = fromBCD(_bus->read());
-            value->hour = fromHourBCD(_bus->read());
+        uint8_t reg = DS1307_SECOND;
+        uint8_t data[3];
+        if (_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, data, 3)) {
+            value->second = fromBCD(data[0] & 0x7F);
+            value->minute = fromBCD(data[1]);
+            value->hour = fromHourBCD(data[2]);
         } else {
             // RTC chip is not responding.
             value->second = 0;
@@ -180,12 +185,12 @@ void DS1307RTC::readDate(RTCDate *value)
         RTC::readDate(value);
         return;
     }
-    _bus->startWrite(DS1307_I2C_ADDRESS);
-    _bus->write(DS1307_DATE);
-    if (_bus->startRead(DS1307_I2C_ADDRESS, 3)) {
-        value->day = fromBCD(_bus->read());
-        value->month = fromBCD(_bus->read());
-        value->year = fromBCD(_bus->read()) + 2000;
+    uint8_t reg = DS1307_DATE;
+    uint8_t data[3];
+    if (_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, data, 3)) {
+        value->day = fromBCD(data[0]);
+        value->month = fromBCD(data[1]);
+        value->year = fromBCD(data[2]) + 2000;
     } else {
         // RTC chip is not responding.
         value->day = 1;
@@ -194,6 +199,32 @@ void DS1307RTC::readDate(RTCDate *value)
     }
 }
 
+void DS1307RTC::readDateTime(RTCDate *date, RTCTime *time)
+{
+    if (!_isRealTime) {
+        RTC::readDateTime(date, time);
+        return;
+    }
+    uint8_t reg = DS1307_SECOND;
+    uint8_t data[7];
+    if (_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, data, 7)) {
+        time->second = fromBCD(data[0] & 0x7F);
+        time->minute = fromBCD(data[1]);
+        time->hour = fromHourBCD(data[2]);
+        date->day = fromBCD(data[4]);
+        date->month = fromBCD(data[5]);
+        date->year = fromBCD(data[6]) + 2000;
+    } else {
+        // RTC chip is not responding.
+        time->second = 0;
+        time->minute = 0;
+        time->hour = 0;
+        date->day = 1;
+        date->month = 1;
+        date->year = 2000;
+    }
+}
+
 inline uint8_t toBCD(uint8_t value)
 {
     return ((value / 10) << 4) + (value % 10);
@@ -230,18 +261,12 @@ void DS1307RTC::writeDate(const RTCDate *value)
 void DS1307RTC::readAlarm(uint8_t alarmNum, RTCAlarm *value)
 {
     if (_isRealTime) {
-        _bus->startWrite(DS1307_I2C_ADDRESS);
-        _bus->write(DS1307_ALARMS + alarmNum * DS1307_ALARM_SIZE);
-        if (_bus->startRead(DS1307_I2C_ADDRESS, 3)) {
-            value->hour = fromBCD(_bus->read());
-            value->minute = fromBCD(_bus->read());
-            value->flags = _bus->read();
-        } else {
-            // RTC chip is not responding.
-            value->hour = 0;
-            value->minute = 0;
-            value->flags = 0;
-        }
+        // The chip only stores the hour, minute, and flags.
+        RTCAlarm alarm;
+        RTC::readAlarm(alarmNum, &alarm);
+        value->hour = alarm.hour;
+        value->minute = alarm.minute;
+        value->flags = alarm.flags;
     } else {
         RTC::readAlarm(alarmNum, value);
     }
@@ -256,6 +281,7 @@ void DS1307RTC::writeAlarm(uint8_t alarmNum, const RTCAlarm *value)
         _bus->write(toBCD(value->minute));
         _bus->write(value->flags);
         _bus->endWrite();
+        RTC::writeAlarm(alarmNum, value);
     } else {
         RTC::writeAlarm(alarmNum, value);
     }
@@ -282,10 +308,48 @@ void DS1307RTC::writeByte(uint8_t offset, uint8_t value)
         RTC::writeByte(offset, value);
 }
 
+void DS1307RTC::readBytes(uint8_t offset, uint8_t *data, uint8_t len)
+{
+    if (!_isRealTime) {
+        RTC::readBytes(offset, data, len);
+        return;
+    }
+    uint8_t reg = DS1307_NVRAM + offset;
+    if (!_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, data, len))
+        memset(data, 0, len);   // RTC chip is not responding.
+}
+
+void DS1307RTC::writeBytes(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+    if (!_isRealTime) {
+        RTC::writeBytes(offset, data, len);
+        return;
+    }
+    _bus->startWrite(DS1307_I2C_ADDRESS);
+    _bus->write(DS1307_NVRAM + offset);
+    while (len-- > 0)
+        _bus->write(*data++);
+    _bus->endWrite();
+}
+
 void DS1307RTC::initAlarms()
 {
-    uint8_t value = readRegister(DS1307_ALARM_MAGIC);
-    if (value != (0xB0 + ALARM_COUNT)) {
+    // Read all of the alarms and the magic number in one transfer
+    // to populate the alarm settings that are cached in memory.
+    uint8_t reg = DS1307_ALARMS;
+    uint8_t data[ALARM_COUNT * DS1307_ALARM_SIZE + 1];
+    if (!_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, data, sizeof(data)))
+        data[sizeof(data) - 1] = 0;
+    if (data[sizeof(data) - 1] == (0xB0 + ALARM_COUNT)) {
+        RTCAlarm alarm;
+        memset(&alarm, 0, sizeof(alarm));
+        for (uint8_t index = 0; index < ALARM_COUNT; ++index) {
+            alarm.hour = fromBCD(data[index * DS1307_ALARM_SIZE]);
+            alarm.minute = fromBCD(data[index * DS1307_ALARM_SIZE + 1]);
+            alarm.flags = data[index * DS1307_ALARM_SIZE + 2];
+            RTC::writeAlarm(index, &alarm);
+        }
+    } else {
         // This is the first time we have used this clock chip,
         // so initialize all alarms to their default state.
         RTCAlarm alarm;
@@ -308,11 +372,10 @@ void DS1307RTC::initAlarms()
 
 uint8_t DS1307RTC::readRegister(uint8_t reg)
 {
-    _bus->startWrite(DS1307_I2C_ADDRESS);
-    _bus->write(reg);
-    if (!_bus->startRead(DS1307_I2C_ADDRESS, 1))
+    uint8_t data;
+    if (!_bus->writeThenRead(DS1307_I2C_ADDRESS, &reg, 1, &data, 1))
         return 0;   // RTC chip is not responding.
-    return _bus->read();
+    return data;
 }
 
 bool DS1307RTC::writeRegister(uint8_t reg, uint8_t value)
@@ -37,6 +37,7 @@ public:
 
     void readTime(RTCTime *value);
     void readDate(RTCDate *value);
+    void readDateTime(RTCDate *date, RTCTime *time);
 
     void writeTime(const RTCTime *value);
     void writeDate(const RTCDate *value);
@@ -47,6 +48,8 @@ public:
     int byteCount() const;
     uint8_t readByte(uint8_t offset);
     void writeByte(uint8_t offset, uint8_t value);
+    void readBytes(uint8_t offset, uint8_t *data, uint8_t len);
+    void writeBytes(uint8_t offset, const uint8_t *data, uint8_t len);
 
 private:
     I2CMaster *_bus;
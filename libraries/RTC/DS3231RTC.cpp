@@ -129,10 +129,10 @@ DS3231RTC::DS3231RTC(I2CMaster &bus, uint8_t oneHzPin)
   , _isRealTime(true)
   , alarmInterrupts(false) {
   // Probe the device and configure it for our use.
-  _bus->startWrite(DS3231_I2C_ADDRESS);
-  _bus->write(DS3231_CONTROL);
-  if ( _bus->startRead(DS3231_I2C_ADDRESS, 1) ) {
-    uint8_t value = _bus->read() & DS3231_CONV;
+  uint8_t reg = DS3231_CONTROL;
+  uint8_t data;
+  if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, &data, 1) ) {
+    uint8_t value = data & DS3231_CONV;
     if ( oneHzPin != 255 ) {
       value |= DS3231_BBSQW | DS3231_RS_1HZ;
     }
@@ -206,12 +206,12 @@ inline uint8_t fromHourBCD(uint8_t value) {
 
 void DS3231RTC::readTime(RTCTime* value) {
   if ( _isRealTime ) {
-    _bus->startWrite(DS3231_I2C_ADDRESS);
-    _bus->write(DS3231_SECOND);
-    if ( _bus->startRead(DS3231_I2C_ADDRESS, 3) ) {
-      value->second = fromBCD( _bus->read() );
-      value->minute = fromBCD( _bus->read() );
-      value->hour = fromHourBCD( _bus->read() );
+    uint8_t reg = DS3231_SECOND;
+    uint8_t data[3];
+    if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, data, 3) ) {
+      value->second = fromBCD( data[0] );
+      value->minute = fromBCD( data[1] );
+      value->hour = fromHourBCD( data[2] );
     }
     else {
       // RTC chip is not responding.
@@ -230,12 +230,12 @@ void DS3231RTC::readDate(RTCDate* value) {
     RTC::readDate(value);
     return;
   }
-  _bus->startWrite(DS3231_I2C_ADDRESS);
-  _bus->write(DS3231_DATE);
-  if ( _bus->startRead(DS3231_I2C_ADDRESS, 3) ) {
-    value->day = fromBCD( _bus->read() );
-    value->month = fromBCD(_bus->read() & 0x7F);     // Strip century bit.
-    value->year = fromBCD( _bus->read() ) + 2000;
+  uint8_t reg = DS3231_DATE;
+  uint8_t data[3];
+  if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, data, 3) ) {
+    value->day = fromBCD( data[0] );
+    value->month = fromBCD(data[1] & 0x7F);     // Strip century bit.
+    value->year = fromBCD( data[2] ) + 2000;
   }
   else {
     // RTC chip is not responding.
@@ -245,6 +245,32 @@ void DS3231RTC::readDate(RTCDate* value) {
   }
 }
 
+void DS3231RTC::readDateTime(RTCDate* date, RTCTime* time) {
+  if ( !_isRealTime ) {
+    RTC::readDateTime(date, time);
+    return;
+  }
+  uint8_t reg = DS3231_SECOND;
+  uint8_t data[7];
+  if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, data, 7) ) {
+    time->second = fromBCD( data[0] );
+    time->minute = fromBCD( data[1] );
+    time->hour = fromHourBCD( data[2] );
+    date->day = fromBCD( data[4] );
+    date->month = fromBCD(data[5] & 0x7F);      // Strip century bit.
+    date->year = fromBCD( data[6] ) + 2000;
+  }
+  else {
+    // RTC chip is not responding.
+    time->second = 0;
+    time->minute = 0;
+    time->hour = 0;
+    date->day = 1;
+    date->month = 1;
+    date->year = 2000;
+  }
+}
+
 inline uint8_t toBCD(uint8_t value) {
   return ( (value / 10) << 4 ) + (value % 10);
 }
@@ -280,14 +306,14 @@ void DS3231RTC::writeDate(const RTCDate* value) {
 void DS3231RTC::readAlarm(uint8_t alarmNum, RTCAlarm* value) {
   if ( _isRealTime ) {
     uint8_t reg_value = readRegister(DS3231_CONTROL);
-    _bus->startWrite(DS3231_I2C_ADDRESS);
+    uint8_t data[4];
     if ( 0 == alarmNum ) {
-      _bus->write(DS3231_ALARM_0);
-      if ( _bus->startRead(DS3231_I2C_ADDRESS, 4) ) {
-        alarmSecondValues(_bus->read(), value);
-        alarmMinuteValues(_bus->read(), value);
-        alarmHourValues(_bus->read(), value);
-        alarmDayValues(_bus->read(), value);
+      uint8_t reg = DS3231_ALARM_0;
+      if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, data, 4) ) {
+        alarmSecondValues(data[0], value);
+        alarmMinuteValues(data[1], value);
+        alarmHourValues(data[2], value);
+        alarmDayValues(data[3], value);
         value->flags &= ~0x80;
         value->flags |= (reg_value & 0x01) << 6;
       }
@@ -300,12 +326,12 @@ void DS3231RTC::readAlarm(uint8_t alarmNum, RTCAlarm* value) {
       }
     }
     else if ( 1 == alarmNum ) {
-      _bus->write(DS3231_ALARM_1);
-      if ( _bus->startRead(DS3231_I2C_ADDRESS, 3) ) {
+      uint8_t reg = DS3231_ALARM_1;
+      if ( _bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, data, 3) ) {
         value->second = 0;
-        alarmMinuteValues(_bus->read(), value);
-        alarmHourValues(_bus->read(), value);
-        alarmDayValues(_bus->read(), value);
+        alarmMinuteValues(data[0], value);
+        alarmHourValues(data[1], value);
+        alarmDayValues(data[2], value);
         value->flags |= 0x80;
         value->flags |= (reg_value & 0x02) << 5;
       }
@@ -477,6 +503,29 @@ int DS3231RTC::readTemperature() {
   }
 }
 
+int DS3231RTC::readAgingOffset() {
+  if ( _isRealTime ) {
+    return (signed char)readRegister(DS3231_AGING_OFFSET);
+  }
+  else {
+    return NO_AGING_OFFSET;
+  }
+}
+
+bool DS3231RTC::writeAgingOffset(int8_t value) {
+  if ( !_isRealTime || !writeRegister(DS3231_AGING_OFFSET, (uint8_t)value) ) {
+    return false;
+  }
+
+  // Force a temperature conversion so that the new offset is applied
+  // to the oscillator immediately rather than at the next conversion.
+  uint8_t control = readRegister(DS3231_CONTROL);
+  if ( !(readRegister(DS3231_STATUS) & DS3231_BSY) ) {
+    writeRegister(DS3231_CONTROL, control | DS3231_CONV);
+  }
+  return true;
+}
+
 /**
  * \brief Enables the generation of interrupts for alarms 0 and 1.
  *
@@ -581,12 +630,11 @@ void DS3231RTC::disable32kHzOutput() {
 }
 
 uint8_t DS3231RTC::readRegister(uint8_t reg) {
-  _bus->startWrite(DS3231_I2C_ADDRESS);
-  _bus->write(reg);
-  if ( !_bus->startRead(DS3231_I2C_ADDRESS, 1) ) {
+  uint8_t data;
+  if ( !_bus->writeThenRead(DS3231_I2C_ADDRESS, &reg, 1, &data, 1) ) {
     return 0;       // RTC chip is not responding.
   }
-  return _bus->read();
+  return data;
 }
 
 bool DS3231RTC::writeRegister(uint8_t reg, uint8_t value) {
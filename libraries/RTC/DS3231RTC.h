@@ -44,6 +44,7 @@ class DS3231RTC : public RTC {
 
   void readTime(RTCTime* value);
   void readDate(RTCDate* value);
+  void readDateTime(RTCDate* date, RTCTime* time);
 
   void writeTime(const RTCTime* value);
   void writeDate(const RTCDate* value);
@@ -54,6 +55,9 @@ class DS3231RTC : public RTC {
 
   int  readTemperature();
 
+  int  readAgingOffset();
+  bool writeAgingOffset(int8_t value);
+
   void enableAlarmInterrupts();
   void disableAlarmInterrupts();
   int  firedAlarm();
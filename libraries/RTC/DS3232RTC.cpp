@@ -27,6 +27,7 @@
 #else
 #include <WProgram.h>
 #endif
+#include <string.h>
 
 /**
  * \class DS3232RTC DS3232RTC.h <DS3232RTC.h>
@@ -49,6 +50,14 @@
  * The DS3232 uses a 2-digit year so this class is limited to dates between
  * 2000 and 2099 inclusive.
  *
+ * The control and status registers and the alarm settings are mirrored
+ * in memory when the object is constructed, so changing the alarms or
+ * the 32 kHz output is a single write to the chip and reading back the
+ * alarms does not touch the I2C bus at all.  Only the flags that the
+ * DS3232 itself changes, such as the fired alarm flags, are read from
+ * the chip each time.  As a consequence, this object assumes that it is
+ * the only thing configuring the chip.
+ *
  * Note: if this class has not been used with the DS3232 chip before,
  * then the contents of NVRAM will be cleared.  Any previous contents
  * will be lost.
@@ -105,6 +114,7 @@
 #define DS3232_BSY          0x04
 #define DS3232_A2F          0x02
 #define DS3232_A1F          0x01
+#define DS3232_FLAGS        (DS3232_OSF | DS3232_A2F | DS3232_A1F)
 
 // Alarm storage at the end of the RTC's NVRAM.
 #define DS3232_ALARM_SIZE   3
@@ -129,18 +139,19 @@ DS3232RTC::DS3232RTC(I2CMaster &bus, uint8_t oneHzPin)
     , prevOneHz(false)
     , _isRealTime(true)
     , alarmInterrupts(false)
+    , control(0)
+    , status(DS3232_CRATE_64)
 {
     // Probe the device and configure it for our use.
-    _bus->startWrite(DS3232_I2C_ADDRESS);
-    _bus->write(DS3232_CONTROL);
-    if (_bus->startRead(DS3232_I2C_ADDRESS, 1)) {
-        uint8_t value = _bus->read() & DS3232_CONV;
+    uint8_t reg = DS3232_CONTROL;
+    uint8_t data;
+    if (_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, &data, 1)) {
         if (oneHzPin != 255)
-            value |= DS3232_BBSQW | DS3232_RS_1HZ;
+            control = DS3232_BBSQW | DS3232_RS_1HZ;
         _bus->startWrite(DS3232_I2C_ADDRESS);
         _bus->write(DS3232_CONTROL);
-        _bus->write(value);
-        _bus->write(DS3232_CRATE_64);
+        _bus->write(control | (data & DS3232_CONV));
+        _bus->write(status);
         _bus->endWrite();
     } else {
         // Did not get an acknowledgement from the RTC chip.
@@ -205,12 +216,12 @@ inline uint8_t fromHourBCD(uint8_t value)
 void DS3232RTC::readTime(RTCTime *value)
 {
     if (_isRealTime) {
-        _bus->startWrite(DS3232_I2C_ADDRESS);
-        _bus->write(DS3232_SECOND);
-        if (_bus->startRead(DS3232_I2C_ADDRESS, 3)) {
-            value->second = fromBCD(_bus->read());
-            value->minute = fromBCD(_bus->read());
-            value->hour = fromHourBCD(_bus->read());
+        uint8_t reg = DS3232_SECOND;
+        uint8_t data[3];
+        if (_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, data, 3)) {
+            value->second = fromBCD(data[0]);
+            value->minute = fromBCD(data[1]);
+            value->hour = fromHourBCD(data[2]);
         } else {
             // RTC chip is not responding.
             value->second = 0;
@@ -228,12 +239,12 @@ void DS3232RTC::readDate(RTCDate *value)
         RTC::readDate(value);
         return;
     }
-    _bus->startWrite(DS3232_I2C_ADDRESS);
-    _bus->write(DS3232_DATE);
-    if (_bus->startRead(DS3232_I2C_ADDRESS, 3)) {
-        value->day = fromBCD(_bus->read());
-        value->month = fromBCD(_bus->read() & 0x7F); // Strip century bit.
-        value->year = fromBCD(_bus->read()) + 2000;
+    uint8_t reg = DS3232_DATE;
+    uint8_t data[3];
+    if (_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, data, 3)) {
+        value->day = fromBCD(data[0]);
+        value->month = fromBCD(data[1] & 0x7F); // Strip century bit.
+        value->year = fromBCD(data[2]) + 2000;
     } else {
         // RTC chip is not responding.
         value->day = 1;
@@ -242,6 +253,32 @@ void DS3232RTC::readDate(RTCDate *value)
     }
 }
 
+void DS3232RTC::readDateTime(RTCDate *date, RTCTime *time)
+{
+    if (!_isRealTime) {
+        RTC::readDateTime(date, time);
+        return;
+    }
+    uint8_t reg = DS3232_SECOND;
+    uint8_t data[7];
+    if (_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, data, 7)) {
+        time->second = fromBCD(data[0]);
+        time->minute = fromBCD(data[1]);
+        time->hour = fromHourBCD(data[2]);
+        date->day = fromBCD(data[4]);
+        date->month = fromBCD(data[5] & 0x7F); // Strip century bit.
+        date->year = fromBCD(data[6]) + 2000;
+    } else {
+        // RTC chip is not responding.
+        time->second = 0;
+        time->minute = 0;
+        time->hour = 0;
+        date->day = 1;
+        date->month = 1;
+        date->year = 2000;
+    }
+}
+
 inline uint8_t toBCD(uint8_t value)
 {
     return ((value / 10) << 4) + (value % 10);
@@ -278,18 +315,12 @@ void DS3232RTC::writeDate(const RTCDate *value)
 void DS3232RTC::readAlarm(uint8_t alarmNum, RTCAlarm *value)
 {
     if (_isRealTime) {
-        _bus->startWrite(DS3232_I2C_ADDRESS);
-        _bus->write(DS3232_ALARMS + alarmNum * DS3232_ALARM_SIZE);
-        if (_bus->startRead(DS3232_I2C_ADDRESS, 3)) {
-            value->hour = fromBCD(_bus->read());
-            value->minute = fromBCD(_bus->read());
-            value->flags = _bus->read();
-        } else {
-            // RTC chip is not responding.
-            value->hour = 0;
-            value->minute = 0;
-            value->flags = 0;
-        }
+        // The chip only stores the hour, minute, and flags.
+        RTCAlarm alarm;
+        RTC::readAlarm(alarmNum, &alarm);
+        value->hour = alarm.hour;
+        value->minute = alarm.minute;
+        value->flags = alarm.flags;
     } else {
         RTC::readAlarm(alarmNum, value);
     }
@@ -305,6 +336,7 @@ void DS3232RTC::writeAlarm(uint8_t alarmNum, const RTCAlarm *value)
         _bus->write(toBCD(value->minute));
         _bus->write(value->flags);
         _bus->endWrite();
+        RTC::writeAlarm(alarmNum, value);
 
         // Keep the DS3232's built-in alarms in sync with the first two alarms.
         if (alarmNum == 0) {
@@ -353,6 +385,30 @@ void DS3232RTC::writeByte(uint8_t offset, uint8_t value)
         RTC::writeByte(offset, value);
 }
 
+void DS3232RTC::readBytes(uint8_t offset, uint8_t *data, uint8_t len)
+{
+    if (!_isRealTime) {
+        RTC::readBytes(offset, data, len);
+        return;
+    }
+    uint8_t reg = DS3232_NVRAM + offset;
+    if (!_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, data, len))
+        memset(data, 0, len);   // RTC chip is not responding.
+}
+
+void DS3232RTC::writeBytes(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+    if (!_isRealTime) {
+        RTC::writeBytes(offset, data, len);
+        return;
+    }
+    _bus->startWrite(DS3232_I2C_ADDRESS);
+    _bus->write(DS3232_NVRAM + offset);
+    while (len-- > 0)
+        _bus->write(*data++);
+    _bus->endWrite();
+}
+
 int DS3232RTC::readTemperature()
 {
     if (_isRealTime) {
@@ -363,6 +419,26 @@ int DS3232RTC::readTemperature()
     }
 }
 
+int DS3232RTC::readAgingOffset()
+{
+    if (_isRealTime)
+        return (signed char)readRegister(DS3232_AGING_OFFSET);
+    else
+        return NO_AGING_OFFSET;
+}
+
+bool DS3232RTC::writeAgingOffset(int8_t value)
+{
+    if (!_isRealTime || !writeRegister(DS3232_AGING_OFFSET, (uint8_t)value))
+        return false;
+
+    // Force a temperature conversion so that the new offset is applied
+    // to the oscillator immediately rather than at the next conversion.
+    if (!(readRegister(DS3232_STATUS) & DS3232_BSY))
+        writeRegister(DS3232_CONTROL, control | DS3232_CONV);
+    return true;
+}
+
 /**
  * \brief Enables the generation of interrupts for alarms 0 and 1.
  *
@@ -393,9 +469,8 @@ void DS3232RTC::enableAlarmInterrupts()
 void DS3232RTC::disableAlarmInterrupts()
 {
     if (alarmInterrupts) {
-        uint8_t value = readRegister(DS3232_CONTROL);
-        value &= ~(DS3232_INTCN | DS3232_A2IE | DS3232_A1IE);
-        writeRegister(DS3232_CONTROL, value);
+        control &= ~(DS3232_INTCN | DS3232_A2IE | DS3232_A1IE);
+        writeRegister(DS3232_CONTROL, control);
         alarmInterrupts = false;
     }
 }
@@ -430,8 +505,10 @@ int DS3232RTC::firedAlarm()
         alarm = -1;
     }
     if (alarm != -1) {
-        value &= ~(DS3232_A1F | DS3232_A2F);
-        writeRegister(DS3232_STATUS, value);
+        // Writing 1 to a flag leaves it unchanged, so only the flags
+        // that we saw are cleared and any that fire meanwhile are kept.
+        value &= DS3232_A1F | DS3232_A2F;
+        writeRegister(DS3232_STATUS, status | (DS3232_FLAGS & ~value));
     }
     return alarm;
 }
@@ -444,9 +521,8 @@ int DS3232RTC::firedAlarm()
 void DS3232RTC::enable32kHzOutput()
 {
     if (_isRealTime) {
-        uint8_t value = readRegister(DS3232_STATUS);
-        value |= DS3232_BB32KHZ | DS3232_EN32KHZ;
-        writeRegister(DS3232_STATUS, value);
+        status |= DS3232_BB32KHZ | DS3232_EN32KHZ;
+        writeRegister(DS3232_STATUS, status | DS3232_FLAGS);
     }
 }
 
@@ -458,16 +534,29 @@ void DS3232RTC::enable32kHzOutput()
 void DS3232RTC::disable32kHzOutput()
 {
     if (_isRealTime) {
-        uint8_t value = readRegister(DS3232_STATUS);
-        value &= ~(DS3232_BB32KHZ | DS3232_EN32KHZ);
-        writeRegister(DS3232_STATUS, value);
+        status &= ~(DS3232_BB32KHZ | DS3232_EN32KHZ);
+        writeRegister(DS3232_STATUS, status | DS3232_FLAGS);
     }
 }
 
 void DS3232RTC::initAlarms()
 {
-    uint8_t value = readRegister(DS3232_ALARM_MAGIC);
-    if (value != (0xB0 + ALARM_COUNT)) {
+    // Read all of the alarms and the magic number in one transfer
+    // to populate the alarm settings that are cached in memory.
+    uint8_t reg = DS3232_ALARMS;
+    uint8_t data[ALARM_COUNT * DS3232_ALARM_SIZE + 1];
+    if (!_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, data, sizeof(data)))
+        data[sizeof(data) - 1] = 0;
+    if (data[sizeof(data) - 1] == (0xB0 + ALARM_COUNT)) {
+        RTCAlarm alarm;
+        memset(&alarm, 0, sizeof(alarm));
+        for (uint8_t index = 0; index < ALARM_COUNT; ++index) {
+            alarm.hour = fromBCD(data[index * DS3232_ALARM_SIZE]);
+            alarm.minute = fromBCD(data[index * DS3232_ALARM_SIZE + 1]);
+            alarm.flags = data[index * DS3232_ALARM_SIZE + 2];
+            RTC::writeAlarm(index, &alarm);
+        }
+    } else {
         // This is the first time we have used this clock chip,
         // so initialize all alarms to their default state.
         RTCAlarm alarm;
@@ -490,11 +579,10 @@ void DS3232RTC::initAlarms()
 
 uint8_t DS3232RTC::readRegister(uint8_t reg)
 {
-    _bus->startWrite(DS3232_I2C_ADDRESS);
-    _bus->write(reg);
-    if (!_bus->startRead(DS3232_I2C_ADDRESS, 1))
+    uint8_t data;
+    if (!_bus->writeThenRead(DS3232_I2C_ADDRESS, &reg, 1, &data, 1))
         return 0;   // RTC chip is not responding.
-    return _bus->read();
+    return data;
 }
 
 bool DS3232RTC::writeRegister(uint8_t reg, uint8_t value)
@@ -505,22 +593,19 @@ bool DS3232RTC::writeRegister(uint8_t reg, uint8_t value)
     return _bus->endWrite();
 }
 
-#define DS3232_ALARM1_FLAGS (DS3232_ALARMS + 2)
-#define DS3232_ALARM2_FLAGS (DS3232_ALARMS + DS3232_ALARM_SIZE + 2)
-
 void DS3232RTC::updateAlarmInterrupts()
 {
-    bool alarm1Enabled = ((readRegister(DS3232_ALARM1_FLAGS) & 0x01) != 0);
-    bool alarm2Enabled = ((readRegister(DS3232_ALARM2_FLAGS) & 0x01) != 0);
-    uint8_t value = readRegister(DS3232_CONTROL);
-    value |= DS3232_INTCN;
-    if (alarm1Enabled)
-        value |= DS3232_A1IE;
+    RTCAlarm alarm1, alarm2;
+    RTC::readAlarm(0, &alarm1);
+    RTC::readAlarm(1, &alarm2);
+    control |= DS3232_INTCN;
+    if (alarm1.flags & 0x01)
+        control |= DS3232_A1IE;
     else
-        value &= ~DS3232_A1IE;
-    if (alarm2Enabled)
-        value |= DS3232_A2IE;
+        control &= ~DS3232_A1IE;
+    if (alarm2.flags & 0x01)
+        control |= DS3232_A2IE;
     else
-        value &= ~DS3232_A2IE;
-    writeRegister(DS3232_CONTROL, value);
+        control &= ~DS3232_A2IE;
+    writeRegister(DS3232_CONTROL, control);
 }
@@ -37,6 +37,7 @@ public:
 
     void readTime(RTCTime *value);
     void readDate(RTCDate *value);
+    void readDateTime(RTCDate *date, RTCTime *time);
 
     void writeTime(const RTCTime *value);
     void writeDate(const RTCDate *value);
@@ -47,9 +48,14 @@ public:
     int byteCount() const;
     uint8_t readByte(uint8_t offset);
     void writeByte(uint8_t offset, uint8_t value);
+    void readBytes(uint8_t offset, uint8_t *data, uint8_t len);
+    void writeBytes(uint8_t offset, const uint8_t *data, uint8_t len);
 
     int readTemperature();
 
+    int readAgingOffset();
+    bool writeAgingOffset(int8_t value);
+
     void enableAlarmInterrupts();
     void disableAlarmInterrupts();
     int firedAlarm();
@@ -63,6 +69,8 @@ private:
     bool prevOneHz;
     bool _isRealTime;
     bool alarmInterrupts;
+    uint8_t control;
+    uint8_t status;
 
     void initAlarms();
 
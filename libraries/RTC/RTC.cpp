@@ -139,7 +139,7 @@ bool RTC::hasUpdates()
 /**
  * \brief Reads the current time from the realtime clock into \a value.
  *
- * \sa writeTime(), readDate()
+ * \sa writeTime(), readDate(), readDateTime()
  */
 void RTC::readTime(RTCTime *value)
 {
@@ -171,6 +171,25 @@ void RTC::readDate(RTCDate *value)
     *value = date;
 }
 
+/**
+ * \brief Reads the current date and time from the realtime clock into
+ * \a date and \a time.
+ *
+ * Realtime clock chips implement this with a single burst read of the
+ * time and date registers, which is faster than calling readTime() and
+ * readDate() separately and cannot tear if the clock rolls over midnight
+ * between the two calls.
+ *
+ * The default implementation calls readTime() and then readDate().
+ *
+ * \sa readTime(), readDate()
+ */
+void RTC::readDateTime(RTCDate *date, RTCTime *time)
+{
+    readTime(time);
+    readDate(date);
+}
+
 /**
  * \brief Updates the time in the realtime clock to match \a value.
  *
@@ -242,7 +261,7 @@ int RTC::byteCount() const
  *
  * The \a offset parameter must be between 0 and byteCount() - 1.
  *
- * \sa writeByte(), byteCount()
+ * \sa writeByte(), byteCount(), readBytes()
  */
 uint8_t RTC::readByte(uint8_t offset)
 {
@@ -257,7 +276,7 @@ uint8_t RTC::readByte(uint8_t offset)
  *
  * The \a offset parameter must be between 0 and byteCount() - 1.
  *
- * \sa readByte(), byteCount()
+ * \sa readByte(), byteCount(), writeBytes()
  */
 void RTC::writeByte(uint8_t offset, uint8_t value)
 {
@@ -272,6 +291,40 @@ void RTC::writeByte(uint8_t offset, uint8_t value)
     }
 }
 
+/**
+ * \brief Reads \a len bytes starting at \a offset within the realtime
+ * clock's non-volatile memory into \a data.
+ *
+ * The range \a offset to \a offset + \a len - 1 must lie between 0 and
+ * byteCount() - 1.  Realtime clock chips implement this with a single
+ * sequential read rather than one I2C transaction per byte.  The default
+ * implementation calls readByte() for each byte.
+ *
+ * \sa writeBytes(), readByte()
+ */
+void RTC::readBytes(uint8_t offset, uint8_t *data, uint8_t len)
+{
+    while (len-- > 0)
+        *data++ = readByte(offset++);
+}
+
+/**
+ * \brief Writes \a len bytes from \a data starting at \a offset within
+ * the realtime clock's non-volatile memory.
+ *
+ * The range \a offset to \a offset + \a len - 1 must lie between 0 and
+ * byteCount() - 1.  Realtime clock chips implement this with a single
+ * sequential write rather than one I2C transaction per byte.  The default
+ * implementation calls writeByte() for each byte.
+ *
+ * \sa readBytes(), writeByte()
+ */
+void RTC::writeBytes(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+    while (len-- > 0)
+        writeByte(offset++, *data++);
+}
+
 /**
  * \var RTC::NO_TEMPERATURE
  * \brief Value that is returned from readTemperature() if the realtime
@@ -290,6 +343,42 @@ int RTC::readTemperature()
     return NO_TEMPERATURE;
 }
 
+/**
+ * \var RTC::NO_AGING_OFFSET
+ * \brief Value that is returned from readAgingOffset() if the realtime
+ * clock chip does not have an aging offset register.
+ */
+
+/**
+ * \brief Reads the value of the aging offset register that trims the
+ * frequency of the realtime clock's crystal oscillator.
+ *
+ * Returns a value between -128 and 127, or NO_AGING_OFFSET if the
+ * realtime clock chip does not support an aging offset.  On the DS3231
+ * and DS3232, one unit is approximately 0.1 ppm, with positive values
+ * slowing the clock down.
+ *
+ * \sa writeAgingOffset(), RTCCalibrator
+ */
+int RTC::readAgingOffset()
+{
+    return NO_AGING_OFFSET;
+}
+
+/**
+ * \brief Writes \a value to the aging offset register that trims the
+ * frequency of the realtime clock's crystal oscillator.
+ *
+ * Returns false if the realtime clock chip does not support an aging
+ * offset.
+ *
+ * \sa readAgingOffset(), RTCCalibrator
+ */
+bool RTC::writeAgingOffset(int8_t value)
+{
+    return false;
+}
+
 /**
  * \var RTC::INCREMENT
  * \brief Increment the day, month, or year in a call to adjustDays(), adjustMonths(), or adjustYears().
@@ -409,6 +498,163 @@ RTC::DayOfWeek RTC::dayOfWeek(const RTCDate *date)
     return (DayOfWeek)((daynum % 7) + 1);
 }
 
+/**
+ * \brief Converts \a date and \a time into the number of seconds since
+ * midnight on 1 Jan, 1970 (the Unix epoch).
+ *
+ * The conversion uses arithmetic only, with no loops over the years
+ * or months, and is valid for dates between 1970 and 2105 inclusive.
+ * No time zone adjustment is performed.
+ *
+ * \sa fromEpoch(), adjustSeconds()
+ */
+uint32_t RTC::toEpoch(const RTCDate *date, const RTCTime *time)
+{
+    // Count from 1 Mar of year zero so that the leap day falls at the
+    // end of the year, then rebase the day number on 1 Jan, 1970.
+    unsigned int year = date->year;
+    unsigned int month = date->month;
+    if (month <= 2) {
+        --year;
+        month += 9;
+    } else {
+        month -= 3;
+    }
+    unsigned int era = year / 400;
+    unsigned int yoe = year - era * 400;
+    unsigned int doy = (153 * month + 2) / 5 + date->day - 1;
+    unsigned long doe = yoe * 365UL + yoe / 4 - yoe / 100 + doy;
+    unsigned long days = era * 146097UL + doe - 719468UL;
+    return days * 86400UL + time->hour * 3600UL +
+           time->minute * 60U + time->second;
+}
+
+/**
+ * \brief Converts \a epoch, in seconds since midnight on 1 Jan, 1970,
+ * into \a date and \a time.
+ *
+ * \sa toEpoch(), adjustSeconds()
+ */
+void RTC::fromEpoch(uint32_t epoch, RTCDate *date, RTCTime *time)
+{
+    unsigned long days = epoch / 86400UL;
+    unsigned long secs = epoch - days * 86400UL;
+    time->hour = (uint8_t)(secs / 3600U);
+    secs -= time->hour * 3600UL;
+    time->minute = (uint8_t)(secs / 60U);
+    time->second = (uint8_t)(secs - time->minute * 60U);
+
+    // Inverse of the day number calculation in toEpoch().
+    days += 719468UL;
+    unsigned int era = (unsigned int)(days / 146097UL);
+    unsigned long doe = days - era * 146097UL;
+    unsigned int yoe = (unsigned int)
+        ((doe - doe / 1460 + doe / 36524 - doe / 146096) / 365);
+    unsigned int doy = (unsigned int)
+        (doe - (yoe * 365UL + yoe / 4 - yoe / 100));
+    unsigned int mp = (5 * doy + 2) / 153;
+    date->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    date->month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    date->year = yoe + era * 400 + (date->month <= 2 ? 1 : 0);
+}
+
+/**
+ * \brief Adjusts \a date and \a time forwards or backwards by \a seconds.
+ *
+ * This is equivalent to converting to epoch time with toEpoch(),
+ * adding \a seconds, and converting back with fromEpoch().
+ *
+ * \sa toEpoch(), fromEpoch(), adjustDays()
+ */
+void RTC::adjustSeconds(RTCDate *date, RTCTime *time, long seconds)
+{
+    fromEpoch(toEpoch(date, time) + (uint32_t)seconds, date, time);
+}
+
+/**
+ * \brief Reads the current date and time and returns it as the number of
+ * seconds since midnight on 1 Jan, 1970.
+ *
+ * This uses a single call to readDateTime(), which is a single burst read
+ * on realtime clock chips.
+ *
+ * \sa toEpoch(), readDateTime()
+ */
+uint32_t RTC::readEpoch()
+{
+    RTCDate date;
+    RTCTime time;
+    readDateTime(&date, &time);
+    return toEpoch(&date, &time);
+}
+
+/**
+ * \brief Packs \a date and \a time into a 32-bit timestamp.
+ *
+ * The fields are stored in bit fields from the year down to the second,
+ * so packed timestamps sort in time order and can be compared directly.
+ * Packing and unpacking only needs shifts and masks, which is cheaper than
+ * toEpoch() and fromEpoch() when the timestamps do not need arithmetic.
+ * The year must be between 2000 and 2063.
+ *
+ * \sa fromPacked(), toEpoch()
+ */
+uint32_t RTC::toPacked(const RTCDate *date, const RTCTime *time)
+{
+    // Layout: YYYYYYMM MMDDDDDh hhhhmmmm mmssssss
+    return (((uint32_t)(date->year - 2000)) << 26) |
+           (((uint32_t)(date->month)) << 22) |
+           (((uint32_t)(date->day)) << 17) |
+           (((uint32_t)(time->hour)) << 12) |
+           (((unsigned int)(time->minute)) << 6) |
+           time->second;
+}
+
+/**
+ * \brief Unpacks a 32-bit timestamp that was created by toPacked()
+ * into \a date and \a time.
+ *
+ * \sa toPacked()
+ */
+void RTC::fromPacked(uint32_t packed, RTCDate *date, RTCTime *time)
+{
+    date->year = (unsigned int)(packed >> 26) + 2000;
+    date->month = (uint8_t)((packed >> 22) & 0x0F);
+    date->day = (uint8_t)((packed >> 17) & 0x1F);
+    time->hour = (uint8_t)((packed >> 12) & 0x1F);
+    time->minute = (uint8_t)((packed >> 6) & 0x3F);
+    time->second = (uint8_t)(packed & 0x3F);
+}
+
+/**
+ * \brief Encodes \a epoch as a 16-bit offset in seconds from \a base.
+ *
+ * \param base The epoch time at the start of a block of records, which
+ * would normally be stored once in the block's header.
+ * \param epoch The epoch time to encode.
+ * \param delta Returns the encoded offset.
+ * \return Returns false if \a epoch is before \a base or more than 65535
+ * seconds (about 18 hours) after it, in which case the application should
+ * start a new block with a new base.
+ *
+ * \sa fromDelta(), readEpoch()
+ */
+bool RTC::toDelta(uint32_t base, uint32_t epoch, uint16_t *delta)
+{
+    if (epoch < base || (epoch - base) > 0xFFFFUL)
+        return false;
+    *delta = (uint16_t)(epoch - base);
+    return true;
+}
+
+/**
+ * \fn uint32_t RTC::fromDelta(uint32_t base, uint16_t delta)
+ * \brief Decodes a 16-bit \a delta from toDelta() back into the epoch
+ * time relative to \a base.
+ *
+ * \sa toDelta()
+ */
+
 /**
  * \class RTCTime RTC.h <RTC.h>
  * \brief Stores time information from a realtime clock chip.
@@ -25,6 +25,12 @@
 
 #include <inttypes.h>
 
+// The SAMD device headers define RTC as the address of the on-chip RTC
+// peripheral, which collides with the name of this class.
+#if defined(ARDUINO_ARCH_SAMD) && defined(RTC)
+#undef RTC
+#endif
+
 struct RTCTime
 {
     uint8_t hour;
@@ -70,6 +76,7 @@ public:
 
     virtual void readTime(RTCTime *value);
     virtual void readDate(RTCDate *value);
+    virtual void readDateTime(RTCDate *date, RTCTime *time);
 
     virtual void writeTime(const RTCTime *value);
     virtual void writeDate(const RTCDate *value);
@@ -82,11 +89,18 @@ public:
     virtual int byteCount() const;
     virtual uint8_t readByte(uint8_t offset);
     virtual void writeByte(uint8_t offset, uint8_t value);
+    virtual void readBytes(uint8_t offset, uint8_t *data, uint8_t len);
+    virtual void writeBytes(uint8_t offset, const uint8_t *data, uint8_t len);
 
     static const int NO_TEMPERATURE = 32767;
 
     virtual int readTemperature();
 
+    static const int NO_AGING_OFFSET = 32767;
+
+    virtual int readAgingOffset();
+    virtual bool writeAgingOffset(int8_t value);
+
     // Flags for adjustDays(), adjustMonths(), and adjustYears().
     static const uint8_t INCREMENT = 0x0000;
     static const uint8_t DECREMENT = 0x0001;
@@ -98,6 +112,18 @@ public:
 
     static DayOfWeek dayOfWeek(const RTCDate *date);
 
+    static uint32_t toEpoch(const RTCDate *date, const RTCTime *time);
+    static void fromEpoch(uint32_t epoch, RTCDate *date, RTCTime *time);
+    static void adjustSeconds(RTCDate *date, RTCTime *time, long seconds);
+
+    uint32_t readEpoch();
+
+    static uint32_t toPacked(const RTCDate *date, const RTCTime *time);
+    static void fromPacked(uint32_t packed, RTCDate *date, RTCTime *time);
+
+    static bool toDelta(uint32_t base, uint32_t epoch, uint16_t *delta);
+    static uint32_t fromDelta(uint32_t base, uint16_t delta) { return base + delta; }
+
 private:
     unsigned long midnight;
     RTCDate date;
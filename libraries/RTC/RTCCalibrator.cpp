@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RTCCalibrator.h"
+#include "RTC.h"
+
+/**
+ * \class RTCCalibrator RTCCalibrator.h <RTCCalibrator.h>
+ * \brief Measures the drift of a realtime clock against an external time
+ * reference and corrects it with the clock's aging offset.
+ *
+ * The DS3231 and DS3232 compensate for temperature internally, but each
+ * crystal still has a small fixed frequency error that grows as it ages.
+ * This class compares the realtime clock with an accurate external time
+ * reference, such as NTP via a network gateway or a GPS receiver, and
+ * programs the aging offset register to cancel the measured drift.
+ * A clock that has been calibrated needs to be re-synchronized with the
+ * reference far less often.
+ *
+ * References are supplied as seconds since the Unix epoch.  The first
+ * reference is passed to start(), and later references to sample() or
+ * calibrate():
+ *
+ * \code
+ * DS3232RTC rtc(bus);
+ * RTCCalibrator calibrator(rtc);
+ *
+ * void onTimeReceived(uint32_t ntpTime)
+ * {
+ *     if (!calibrator.isStarted())
+ *         calibrator.start(ntpTime);
+ *     else if (calibrator.calibrate(ntpTime))
+ *         setClock(ntpTime);
+ * }
+ * \endcode
+ *
+ * The realtime clock can only be read to the nearest second, so the
+ * resolution of the measurement is 1 second divided by the elapsed time.
+ * For example, 1 day gives a resolution of about 11.6 ppm and 10 days
+ * gives about 1.2 ppm.  Supplying references that are aligned with the
+ * second boundary, such as the time of a GPS PPS edge, reduces the error.
+ * calibrate() will not program the aging offset until minimumInterval()
+ * seconds have elapsed since start().
+ *
+ * \sa RTC::readAgingOffset(), RTC::writeAgingOffset()
+ */
+
+/**
+ * \brief Default minimum number of seconds to measure the drift over
+ * before calibrate() adjusts the aging offset.
+ */
+#if !defined(RTC_CALIBRATION_INTERVAL)
+#define RTC_CALIBRATION_INTERVAL    (7UL * 86400UL)
+#endif
+
+// Aging offset units per part per billion of drift, as a divisor.
+#define RTC_AGING_PPB               100
+
+/**
+ * \brief Constructs a new calibrator for \a rtc.
+ */
+RTCCalibrator::RTCCalibrator(RTC &rtc)
+    : _rtc(&rtc)
+    , _startReference(0)
+    , _startClock(0)
+    , _elapsed(0)
+    , _drift(0)
+    , _minInterval(RTC_CALIBRATION_INTERVAL)
+    , _started(false)
+{
+}
+
+/**
+ * \fn RTC *RTCCalibrator::rtc() const
+ * \brief Returns the realtime clock that is being calibrated.
+ */
+
+/**
+ * \brief Starts a new drift measurement at the time \a reference.
+ *
+ * \param reference The current time from the external reference, in
+ * seconds since the Unix epoch.
+ *
+ * \sa sample(), calibrate()
+ */
+void RTCCalibrator::start(uint32_t reference)
+{
+    RTCDate date;
+    RTCTime time;
+    _rtc->readDateTime(&date, &time);
+    _startReference = reference;
+    _startClock = RTC::toEpoch(&date, &time);
+    _elapsed = 0;
+    _drift = 0;
+    _started = true;
+}
+
+/**
+ * \fn bool RTCCalibrator::isStarted() const
+ * \brief Returns true if start() has been called to begin a measurement.
+ */
+
+/**
+ * \brief Takes a sample of the realtime clock against the time \a reference
+ * and updates the drift measurement.
+ *
+ * \param reference The current time from the external reference, in
+ * seconds since the Unix epoch.
+ * \return Returns true if the drift was updated, or false if start() has
+ * not been called or \a reference is not after the start reference.
+ *
+ * \sa drift(), elapsed(), calibrate()
+ */
+bool RTCCalibrator::sample(uint32_t reference)
+{
+    if (!_started || reference <= _startReference)
+        return false;
+    RTCDate date;
+    RTCTime time;
+    _rtc->readDateTime(&date, &time);
+    uint32_t clockElapsed = RTC::toEpoch(&date, &time) - _startClock;
+    _elapsed = reference - _startReference;
+    long error = (int32_t)(clockElapsed - _elapsed);
+    _drift = (long)(((int64_t)error * 1000000000LL) / (int64_t)_elapsed);
+    return true;
+}
+
+/**
+ * \fn uint32_t RTCCalibrator::elapsed() const
+ * \brief Returns the number of reference seconds that were measured over
+ * by the last call to sample().
+ */
+
+/**
+ * \fn long RTCCalibrator::drift() const
+ * \brief Returns the drift that was measured by the last call to sample(),
+ * in parts per billion.
+ *
+ * Positive values indicate that the realtime clock is running fast.
+ */
+
+/**
+ * \fn unsigned long RTCCalibrator::minimumInterval() const
+ * \brief Returns the minimum number of seconds to measure over before
+ * calibrate() will adjust the aging offset.
+ *
+ * The default is 7 days.
+ *
+ * \sa setMinimumInterval()
+ */
+
+/**
+ * \fn void RTCCalibrator::setMinimumInterval(unsigned long seconds)
+ * \brief Sets the minimum number of \a seconds to measure over before
+ * calibrate() will adjust the aging offset.
+ *
+ * \sa minimumInterval()
+ */
+
+/**
+ * \brief Samples the realtime clock against \a reference and corrects the
+ * aging offset if enough time has elapsed since start().
+ *
+ * \param reference The current time from the external reference, in
+ * seconds since the Unix epoch.
+ * \return Returns true if the aging offset was updated, in which case a
+ * new measurement is started at \a reference.  Returns false if the
+ * measurement needs more time or the clock does not support an aging
+ * offset.
+ *
+ * The time in the realtime clock is not changed, so the application
+ * should set it from \a reference after a successful calibration.
+ *
+ * \sa sample(), drift()
+ */
+bool RTCCalibrator::calibrate(uint32_t reference)
+{
+    if (!sample(reference) || _elapsed < _minInterval)
+        return false;
+    int offset = _rtc->readAgingOffset();
+    if (offset == RTC::NO_AGING_OFFSET)
+        return false;
+
+    // A positive offset slows the oscillator, so a clock that is running
+    // fast needs the offset to be increased.  Round to the nearest unit.
+    long adjust;
+    if (_drift >= 0)
+        adjust = (_drift + RTC_AGING_PPB / 2) / RTC_AGING_PPB;
+    else
+        adjust = -((-_drift + RTC_AGING_PPB / 2) / RTC_AGING_PPB);
+    long value = offset + adjust;
+    if (value > 127)
+        value = 127;
+    else if (value < -128)
+        value = -128;
+    if (value != offset && !_rtc->writeAgingOffset((int8_t)value))
+        return false;
+    start(reference);
+    return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RTCCalibrator_h
+#define RTCCalibrator_h
+
+#include <inttypes.h>
+
+class RTC;
+
+class RTCCalibrator
+{
+public:
+    explicit RTCCalibrator(RTC &rtc);
+
+    RTC *rtc() const { return _rtc; }
+
+    void start(uint32_t reference);
+    bool isStarted() const { return _started; }
+
+    bool sample(uint32_t reference);
+
+    uint32_t elapsed() const { return _elapsed; }
+    long drift() const { return _drift; }
+
+    unsigned long minimumInterval() const { return _minInterval; }
+    void setMinimumInterval(unsigned long seconds) { _minInterval = seconds; }
+
+    bool calibrate(uint32_t reference);
+
+private:
+    RTC *_rtc;
+    uint32_t _startReference;
+    uint32_t _startClock;
+    uint32_t _elapsed;
+    long _drift;
+    unsigned long _minInterval;
+    bool _started;
+};
+
+#endif
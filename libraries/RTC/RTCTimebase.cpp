@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RTCTimebase.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * \class RTCTimebase RTCTimebase.h <RTCTimebase.h>
+ * \brief High-resolution timebase that counts the 32.768 kHz output of
+ * a realtime clock chip.
+ *
+ * The 32 kHz output of the DS3231 and DS3232, turned on with
+ * DS3232RTC::enable32kHzOutput(), is temperature compensated and far more
+ * stable than the crystal or resonator that clocks the microcontroller.
+ * This class feeds that output into the T1 external clock input of Timer1
+ * (D5 on the Arduino Uno) so that it can be used for timestamps with a
+ * resolution of 1/32768 second, or about 30.5 microseconds, that do not
+ * drift with the microcontroller's clock.
+ *
+ * Timer1 is 16 bits wide, so the application must count the overflows by
+ * calling handleOverflow() from the Timer1 overflow interrupt:
+ *
+ * \code
+ * #include <SoftI2C.h>
+ * #include <DS3232RTC.h>
+ * #include <RTCTimebase.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * DS3232RTC rtc(bus);
+ * RTCTimebase timebase;
+ *
+ * ISR(TIMER1_OVF_vect)
+ * {
+ *     timebase.handleOverflow();
+ * }
+ *
+ * void setup() {
+ *     rtc.enable32kHzOutput();
+ *     timebase.begin();
+ * }
+ *
+ * void loop() {
+ *     uint32_t start = timebase.ticks();
+ *     ...
+ *     uint32_t elapsed = RTCTimebase::ticksToMicros(timebase.ticks() - start);
+ * }
+ * \endcode
+ *
+ * External events can be timestamped without software latency by
+ * connecting them to the ICP1 input capture pin (D8 on the Arduino Uno)
+ * and calling handleCapture() from the Timer1 capture interrupt, after
+ * which the timestamp is available from captureTicks():
+ *
+ * \code
+ * ISR(TIMER1_CAPT_vect)
+ * {
+ *     timebase.handleCapture();
+ * }
+ * \endcode
+ *
+ * The 32 kHz output of the DS3232 is open-drain, so the T1 pin needs a
+ * pull-up resistor if the clock module does not already have one.
+ * Timer1 keeps counting in the idle sleep mode, but not in the power-down
+ * mode used by sleepFor().  This class cannot be used at the same time as
+ * anything else that needs Timer1, such as DMD::enableTimer1().
+ *
+ * \sa DS3232RTC::enable32kHzOutput(), DS3231RTC::enable32kHzOutput()
+ */
+
+/**
+ * \var RTCTimebase::FREQUENCY
+ * \brief Number of ticks per second.
+ */
+
+/**
+ * \brief Constructs a new timebase.  The timebase does not count until
+ * begin() is called.
+ */
+RTCTimebase::RTCTimebase()
+    : _overflows(0)
+    , _capture(0)
+    , _captured(false)
+    , _running(false)
+{
+}
+
+/**
+ * \brief Starts Timer1 counting the 32 kHz input on the T1 pin.
+ *
+ * The tick count is reset to zero.
+ *
+ * \sa end()
+ */
+void RTCTimebase::begin()
+{
+    uint8_t sreg = SREG;
+    cli();
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    _overflows = 0;
+    _captured = false;
+    TIFR1 = _BV(TOV1) | _BV(ICF1);
+    TIMSK1 |= _BV(TOIE1);
+    TCCR1B = _BV(CS12) | _BV(CS11) | _BV(CS10);   // External clock, rising.
+    SREG = sreg;
+    _running = true;
+}
+
+/**
+ * \brief Stops Timer1 and turns off its interrupts.
+ *
+ * \sa begin()
+ */
+void RTCTimebase::end()
+{
+    TCCR1B = 0;
+    TIMSK1 &= ~(_BV(TOIE1) | _BV(ICIE1));
+    _running = false;
+}
+
+/**
+ * \fn bool RTCTimebase::isRunning() const
+ * \brief Returns true if the timebase has been started with begin().
+ */
+
+/**
+ * \brief Returns the number of 32 kHz ticks since begin() was called.
+ *
+ * The count wraps around after about 36 hours, so intervals should be
+ * computed by subtracting two tick counts.
+ *
+ * \sa micros(), ticksToMicros()
+ */
+uint32_t RTCTimebase::ticks()
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t low = TCNT1;
+    uint16_t high = _overflows;
+    if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+        // The counter has overflowed but the interrupt has not run yet.
+        ++high;
+    }
+    SREG = sreg;
+    return (((uint32_t)high) << 16) | low;
+}
+
+/**
+ * \fn uint32_t RTCTimebase::micros()
+ * \brief Returns the number of microseconds since begin() was called.
+ *
+ * The value increases in steps of about 30.5 microseconds.  It is
+ * computed from ticks() and so it does not wrap at the same point as
+ * the Arduino <tt>micros()</tt> function; use ticks() and ticksToMicros()
+ * for intervals that may be longer than an hour.
+ */
+
+/**
+ * \brief Converts a number of 32 kHz \a ticks into microseconds, rounding down.
+ */
+uint32_t RTCTimebase::ticksToMicros(uint32_t ticks)
+{
+    // 1000000 / 32768 == 15625 / 512; split to avoid overflow.
+    return (ticks >> 9) * 15625UL + (((ticks & 0x01FF) * 15625UL) >> 9);
+}
+
+/**
+ * \brief Enables timestamping of edges on the ICP1 input capture pin.
+ *
+ * \param risingEdge Set to true to capture rising edges, or false to
+ * capture falling edges.
+ *
+ * \sa disableCapture(), handleCapture(), captureTicks()
+ */
+void RTCTimebase::enableCapture(bool risingEdge)
+{
+    uint8_t sreg = SREG;
+    cli();
+    if (risingEdge)
+        TCCR1B |= _BV(ICES1);
+    else
+        TCCR1B &= ~_BV(ICES1);
+    _captured = false;
+    TIFR1 = _BV(ICF1);
+    TIMSK1 |= _BV(ICIE1);
+    SREG = sreg;
+}
+
+/**
+ * \brief Disables timestamping of edges on the ICP1 input capture pin.
+ *
+ * \sa enableCapture()
+ */
+void RTCTimebase::disableCapture()
+{
+    TIMSK1 &= ~_BV(ICIE1);
+}
+
+/**
+ * \fn bool RTCTimebase::hasCapture() const
+ * \brief Returns true if an edge has been captured since the last call
+ * to captureTicks().
+ */
+
+/**
+ * \brief Returns the tick count at the last captured edge and clears
+ * hasCapture().
+ *
+ * \sa hasCapture(), enableCapture()
+ */
+uint32_t RTCTimebase::captureTicks()
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t value = _capture;
+    _captured = false;
+    SREG = sreg;
+    return value;
+}
+
+/**
+ * \fn void RTCTimebase::handleOverflow()
+ * \brief Counts an overflow of Timer1; must be called from the
+ * <tt>TIMER1_OVF_vect</tt> interrupt handler.
+ */
+
+/**
+ * \brief Records the tick count of a captured edge; must be called from
+ * the <tt>TIMER1_CAPT_vect</tt> interrupt handler.
+ */
+void RTCTimebase::handleCapture()
+{
+    uint16_t low = ICR1;
+    uint16_t high = _overflows;
+    if ((TIFR1 & _BV(TOV1)) && low < 0x8000)
+        ++high;
+    _capture = (((uint32_t)high) << 16) | low;
+    _captured = true;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RTCTimebase_h
+#define RTCTimebase_h
+
+#include <inttypes.h>
+
+class RTCTimebase
+{
+public:
+    RTCTimebase();
+
+    static const unsigned long FREQUENCY = 32768UL;
+
+    void begin();
+    void end();
+    bool isRunning() const { return _running; }
+
+    uint32_t ticks();
+    uint32_t micros() { return ticksToMicros(ticks()); }
+
+    static uint32_t ticksToMicros(uint32_t ticks);
+
+    void enableCapture(bool risingEdge = true);
+    void disableCapture();
+    bool hasCapture() const { return _captured; }
+    uint32_t captureTicks();
+
+    void handleOverflow() { ++_overflows; }
+    void handleCapture();
+
+private:
+    volatile uint16_t _overflows;
+    volatile uint32_t _capture;
+    volatile bool _captured;
+    bool _running;
+};
+
+#endif
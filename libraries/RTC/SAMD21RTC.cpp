@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+// The SAMD device headers define RTC as a pointer to the RTC peripheral,
+// which clashes with the RTC class.  Capture the pointer before RTC.h
+// removes the macro.
+#include <Arduino.h>
+static inline Rtc *samdRtcPeripheral() { return RTC; }
+#define SAMD_RTC    (samdRtcPeripheral())
+
+#endif
+
+#include "SAMD21RTC.h"
+
+/**
+ * \class SAMD21RTC SAMD21RTC.h <SAMD21RTC.h>
+ * \brief Realtime clock that uses the on-chip RTC peripheral of the
+ * SAMD21 microcontroller.
+ *
+ * The Arduino Zero, M0 and MKR boards have a calendar RTC peripheral
+ * that is clocked from the 32.768 kHz crystal.  Reading the time is a
+ * memory-mapped register access with no I2C traffic, so there is no need
+ * for an external clock chip such as the DS3232 on those boards.
+ *
+ * \code
+ * SAMD21RTC rtc;
+ *
+ * void setup() {
+ *     rtc.begin();
+ * }
+ * \endcode
+ *
+ * Alarm 0 is mirrored into the peripheral's ALARM0 compare register,
+ * matching on the hour, minute and second.  Alarms 1 to 3 are stored in
+ * main memory only and must be checked by the application.  When alarm
+ * interrupts are enabled with enableAlarmInterrupts(), the application
+ * must call handleInterrupt() from the RTC interrupt handler:
+ *
+ * \code
+ * void RTC_Handler(void)
+ * {
+ *     rtc.handleInterrupt();
+ * }
+ * \endcode
+ *
+ * The peripheral does not have any battery-backed memory, so the time is
+ * lost when power is removed and the non-volatile memory functions
+ * readByte() and writeByte() fall back to main memory as for RTC.
+ * The year is limited to 2000 to 2063 by the 6-bit year field.
+ *
+ * This class is only available when compiling for SAMD boards.
+ *
+ * \sa RTC, DS3232RTC
+ */
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+// Base year for the 6-bit YEAR field of the CLOCK register.
+#define SAMD21RTC_BASE_YEAR     2000
+
+static inline void syncRTC()
+{
+    while (SAMD_RTC->MODE2.STATUS.bit.SYNCBUSY)
+        ;   // Wait for register synchronization to complete.
+}
+
+/**
+ * \brief Constructs a new handler for the on-chip RTC peripheral.
+ *
+ * The peripheral is not configured until begin() is called.
+ */
+SAMD21RTC::SAMD21RTC()
+    : prevSecond(0xFF)
+    , alarmFired(false)
+    , alarmInterrupts(false)
+{
+}
+
+/**
+ * \brief Starts the 32.768 kHz crystal oscillator and configures the RTC
+ * peripheral in clock/calendar mode.
+ *
+ * If the peripheral is already running, for example after a software reset,
+ * then the current time is preserved.
+ */
+void SAMD21RTC::begin()
+{
+    PM->APBAMASK.reg |= PM_APBAMASK_RTC;
+
+    // Start the external 32.768 kHz crystal oscillator if the core
+    // has not already done so.
+    if (!SYSCTRL->XOSC32K.bit.ENABLE) {
+        SYSCTRL->XOSC32K.reg = SYSCTRL_XOSC32K_ONDEMAND |
+                               SYSCTRL_XOSC32K_RUNSTDBY |
+                               SYSCTRL_XOSC32K_EN32K |
+                               SYSCTRL_XOSC32K_XTALEN |
+                               SYSCTRL_XOSC32K_STARTUP(6) |
+                               SYSCTRL_XOSC32K_ENABLE;
+        while (!SYSCTRL->PCLKSR.bit.XOSC32KRDY)
+            ;
+    }
+
+    // Divide the crystal by 32 on GCLK2 to give 1024 Hz for the RTC.
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(2) | GCLK_GENDIV_DIV(4);
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_GENEN | GCLK_GENCTRL_SRC_XOSC32K |
+                        GCLK_GENCTRL_ID(2) | GCLK_GENCTRL_DIVSEL;
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+    GCLK->CLKCTRL.reg = (uint16_t)(GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2 |
+                                   GCLK_CLKCTRL_ID(RTC_GCLK_ID));
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+
+    if (!SAMD_RTC->MODE2.CTRL.bit.ENABLE ||
+            SAMD_RTC->MODE2.CTRL.bit.MODE != RTC_MODE2_CTRL_MODE_CLOCK_Val) {
+        SAMD_RTC->MODE2.CTRL.reg &= ~RTC_MODE2_CTRL_ENABLE;
+        syncRTC();
+        SAMD_RTC->MODE2.CTRL.reg = RTC_MODE2_CTRL_MODE_CLOCK |
+                              RTC_MODE2_CTRL_PRESCALER_DIV1024;
+        syncRTC();
+
+        // Start at midnight on 1 Jan, 2000.
+        SAMD_RTC->MODE2.CLOCK.reg = RTC_MODE2_CLOCK_DAY(1) |
+                               RTC_MODE2_CLOCK_MONTH(1);
+        syncRTC();
+        SAMD_RTC->MODE2.CTRL.reg |= RTC_MODE2_CTRL_ENABLE;
+        syncRTC();
+    }
+
+    // Continuous read synchronization makes CLOCK reads immediate.
+    SAMD_RTC->MODE2.READREQ.reg = RTC_READREQ_RCONT | RTC_READREQ_RREQ;
+    syncRTC();
+}
+
+bool SAMD21RTC::hasUpdates()
+{
+    uint8_t second = SAMD_RTC->MODE2.CLOCK.bit.SECOND;
+    if (second != prevSecond) {
+        prevSecond = second;
+        return true;
+    }
+    return false;
+}
+
+void SAMD21RTC::readTime(RTCTime *value)
+{
+    uint32_t clock = SAMD_RTC->MODE2.CLOCK.reg;
+    value->second = (clock & RTC_MODE2_CLOCK_SECOND_Msk) >> RTC_MODE2_CLOCK_SECOND_Pos;
+    value->minute = (clock & RTC_MODE2_CLOCK_MINUTE_Msk) >> RTC_MODE2_CLOCK_MINUTE_Pos;
+    value->hour = (clock & RTC_MODE2_CLOCK_HOUR_Msk) >> RTC_MODE2_CLOCK_HOUR_Pos;
+}
+
+void SAMD21RTC::readDate(RTCDate *value)
+{
+    uint32_t clock = SAMD_RTC->MODE2.CLOCK.reg;
+    value->day = (clock & RTC_MODE2_CLOCK_DAY_Msk) >> RTC_MODE2_CLOCK_DAY_Pos;
+    value->month = (clock & RTC_MODE2_CLOCK_MONTH_Msk) >> RTC_MODE2_CLOCK_MONTH_Pos;
+    value->year = ((clock & RTC_MODE2_CLOCK_YEAR_Msk) >> RTC_MODE2_CLOCK_YEAR_Pos) +
+                  SAMD21RTC_BASE_YEAR;
+}
+
+void SAMD21RTC::readDateTime(RTCDate *date, RTCTime *time)
+{
+    // A single register read cannot tear across a rollover.
+    uint32_t clock = SAMD_RTC->MODE2.CLOCK.reg;
+    time->second = (clock & RTC_MODE2_CLOCK_SECOND_Msk) >> RTC_MODE2_CLOCK_SECOND_Pos;
+    time->minute = (clock & RTC_MODE2_CLOCK_MINUTE_Msk) >> RTC_MODE2_CLOCK_MINUTE_Pos;
+    time->hour = (clock & RTC_MODE2_CLOCK_HOUR_Msk) >> RTC_MODE2_CLOCK_HOUR_Pos;
+    date->day = (clock & RTC_MODE2_CLOCK_DAY_Msk) >> RTC_MODE2_CLOCK_DAY_Pos;
+    date->month = (clock & RTC_MODE2_CLOCK_MONTH_Msk) >> RTC_MODE2_CLOCK_MONTH_Pos;
+    date->year = ((clock & RTC_MODE2_CLOCK_YEAR_Msk) >> RTC_MODE2_CLOCK_YEAR_Pos) +
+                 SAMD21RTC_BASE_YEAR;
+}
+
+void SAMD21RTC::writeTime(const RTCTime *value)
+{
+    uint32_t clock = SAMD_RTC->MODE2.CLOCK.reg;
+    clock &= ~(RTC_MODE2_CLOCK_SECOND_Msk | RTC_MODE2_CLOCK_MINUTE_Msk |
+               RTC_MODE2_CLOCK_HOUR_Msk);
+    clock |= RTC_MODE2_CLOCK_SECOND(value->second) |
+             RTC_MODE2_CLOCK_MINUTE(value->minute) |
+             RTC_MODE2_CLOCK_HOUR(value->hour);
+    SAMD_RTC->MODE2.CLOCK.reg = clock;
+    syncRTC();
+}
+
+void SAMD21RTC::writeDate(const RTCDate *value)
+{
+    uint32_t clock = SAMD_RTC->MODE2.CLOCK.reg;
+    clock &= ~(RTC_MODE2_CLOCK_DAY_Msk | RTC_MODE2_CLOCK_MONTH_Msk |
+               RTC_MODE2_CLOCK_YEAR_Msk);
+    clock |= RTC_MODE2_CLOCK_DAY(value->day) |
+             RTC_MODE2_CLOCK_MONTH(value->month) |
+             RTC_MODE2_CLOCK_YEAR(value->year - SAMD21RTC_BASE_YEAR);
+    SAMD_RTC->MODE2.CLOCK.reg = clock;
+    syncRTC();
+}
+
+void SAMD21RTC::writeAlarm(uint8_t alarmNum, const RTCAlarm *value)
+{
+    RTC::writeAlarm(alarmNum, value);
+    if (alarmNum == 0)
+        updateAlarm();
+}
+
+/**
+ * \brief Enables the generation of interrupts for alarm 0.
+ *
+ * The application is responsible for implementing <tt>RTC_Handler()</tt>
+ * and calling handleInterrupt() from it.  The interrupt will wake the
+ * microcontroller from standby sleep.
+ *
+ * \sa disableAlarmInterrupts(), firedAlarm(), handleInterrupt()
+ */
+void SAMD21RTC::enableAlarmInterrupts()
+{
+    alarmInterrupts = true;
+    updateAlarm();
+    NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/**
+ * \brief Disables the generation of interrupts for alarm 0.
+ *
+ * \sa enableAlarmInterrupts()
+ */
+void SAMD21RTC::disableAlarmInterrupts()
+{
+    alarmInterrupts = false;
+    SAMD_RTC->MODE2.INTENCLR.reg = RTC_MODE2_INTENCLR_ALARM0;
+    NVIC_DisableIRQ(RTC_IRQn);
+}
+
+/**
+ * \brief Determines if alarm 0 has fired since the last call.
+ *
+ * Returns 0 if alarm 0 has fired, or -1 if it has not.  The fired alarm
+ * state will be cleared, ready for the next call.  This function can be
+ * polled without enabling alarm interrupts.
+ *
+ * \sa enableAlarmInterrupts()
+ */
+int SAMD21RTC::firedAlarm()
+{
+    bool fired = alarmFired;
+    if (SAMD_RTC->MODE2.INTFLAG.bit.ALARM0) {
+        SAMD_RTC->MODE2.INTFLAG.reg = RTC_MODE2_INTFLAG_ALARM0;
+        fired = true;
+    }
+    alarmFired = false;
+    return fired ? 0 : -1;
+}
+
+/**
+ * \brief Handles an interrupt from the RTC peripheral; must be called
+ * from <tt>RTC_Handler()</tt> when alarm interrupts are enabled.
+ *
+ * \sa enableAlarmInterrupts(), firedAlarm()
+ */
+void SAMD21RTC::handleInterrupt()
+{
+    if (SAMD_RTC->MODE2.INTFLAG.bit.ALARM0) {
+        SAMD_RTC->MODE2.INTFLAG.reg = RTC_MODE2_INTFLAG_ALARM0;
+        alarmFired = true;
+    }
+}
+
+/**
+ * \internal
+ * \brief Mirrors alarm 0 into the ALARM0 compare register.
+ */
+void SAMD21RTC::updateAlarm()
+{
+    RTCAlarm alarm;
+    RTC::readAlarm(0, &alarm);
+    if (alarm.flags & 0x01) {
+        SAMD_RTC->MODE2.Mode2Alarm[0].ALARM.reg =
+            RTC_MODE2_ALARM_SECOND(0) |
+            RTC_MODE2_ALARM_MINUTE(alarm.minute) |
+            RTC_MODE2_ALARM_HOUR(alarm.hour);
+        syncRTC();
+        SAMD_RTC->MODE2.Mode2Alarm[0].MASK.reg = RTC_MODE2_MASK_SEL_HHMMSS;
+        syncRTC();
+        if (alarmInterrupts)
+            SAMD_RTC->MODE2.INTENSET.reg = RTC_MODE2_INTENSET_ALARM0;
+    } else {
+        SAMD_RTC->MODE2.Mode2Alarm[0].MASK.reg = RTC_MODE2_MASK_SEL_OFF;
+        syncRTC();
+        SAMD_RTC->MODE2.INTENCLR.reg = RTC_MODE2_INTENCLR_ALARM0;
+    }
+    SAMD_RTC->MODE2.INTFLAG.reg = RTC_MODE2_INTFLAG_ALARM0;
+}
+
+#endif // ARDUINO_ARCH_SAMD
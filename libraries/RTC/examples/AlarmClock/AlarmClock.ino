@@ -123,8 +123,7 @@ void setup() {
     // Set the initial time and date and find the next alarm to be triggered.
     RTCTime time;
     RTCDate date;
-    rtc.readTime(&time);
-    rtc.readDate(&date);
+    rtc.readDateTime(&date, &time);
     frontScreen.setTime(time);
     frontScreen.setDate(date);
     findNextAlarm();
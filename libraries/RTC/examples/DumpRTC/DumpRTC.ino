@@ -44,8 +44,7 @@ void setup() {
 void loop() {
     RTCTime time;
     RTCDate date;
-    rtc.readTime(&time);
-    rtc.readDate(&date);
+    rtc.readDateTime(&date, &time);
 
     Serial.print("Time: ");
     printDec2(time.hour);
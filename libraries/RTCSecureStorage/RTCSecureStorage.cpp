@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RTCSecureStorage.h"
+#include "../RTC/RTC.h"
+
+/**
+ * \class RTCSecureStorage RTCSecureStorage.h <RTCSecureStorage.h>
+ * \brief Encrypted and authenticated storage in the battery-backed
+ * memory of a realtime clock chip.
+ *
+ * The battery-backed memory of a clock chip is small, but it does not
+ * wear out and can be read by anyone with access to the I2C bus.  The
+ * following example uses the 236 bytes of a DS3232 as two 39-byte pages,
+ * each of which has two copies:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <ChaChaPoly.h>
+ * #include <SoftI2C.h>
+ * #include <DS3232RTC.h>
+ * #include <RTCSecureStorage.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * DS3232RTC rtc(bus);
+ * RTCSecureStorage storage(rtc, 0, 236);
+ * ChaChaPoly cipher;
+ * uint8_t page[39];
+ *
+ * void setup() {
+ *     cipher.setKey(storageKey, 32);
+ *     storage.begin(cipher, page, sizeof(page));
+ *     if (!storage.isFormatted())
+ *         storage.format();
+ * }
+ * \endcode
+ *
+ * Memory that has been cleared to zero must be formatted with
+ * SecureStorage::format() before it is used.
+ *
+ * \sa SecureStorage, RTC::readBytes(), RTC::writeBytes()
+ */
+
+/**
+ * \brief Constructs a new secure storage object for a realtime clock.
+ *
+ * \param rtc The realtime clock to store the data in.
+ * \param offset The offset of the start of the storage area within the
+ * clock's non-volatile memory.
+ * \param size The size of the storage area in bytes, including the
+ * two copies and the overhead of each page.
+ */
+RTCSecureStorage::RTCSecureStorage(RTC &rtc, uint8_t offset, uint8_t size)
+    : SecureStorage(size)
+    , _rtc(&rtc)
+    , _offset(offset)
+{
+}
+
+/**
+ * \brief Destroys this realtime clock secure storage object.
+ */
+RTCSecureStorage::~RTCSecureStorage()
+{
+}
+
+bool RTCSecureStorage::readRaw(unsigned long address, void *data, size_t len)
+{
+    _rtc->readBytes((uint8_t)(_offset + address), (uint8_t *)data, (uint8_t)len);
+    return true;
+}
+
+bool RTCSecureStorage::writeRaw(unsigned long address, const void *data, size_t len)
+{
+    _rtc->writeBytes((uint8_t)(_offset + address), (const uint8_t *)data, (uint8_t)len);
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_RTCSECURESTORAGE_H
+#define CRYPTO_RTCSECURESTORAGE_H
+
+#include "SecureStorage.h"
+
+class RTC;
+
+class RTCSecureStorage : public SecureStorage
+{
+public:
+    RTCSecureStorage(RTC &rtc, uint8_t offset, uint8_t size);
+    virtual ~RTCSecureStorage();
+
+protected:
+    bool readRaw(unsigned long address, void *data, size_t len);
+    bool writeRaw(unsigned long address, const void *data, size_t len);
+
+private:
+    RTC *_rtc;
+    uint8_t _offset;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RTCSeedStorage.h"
+#include "../RTC/RTC.h"
+
+/**
+ * \class RTCSeedStorage RTCSeedStorage.h <RTCSeedStorage.h>
+ * \brief Stores the random seed in the battery-backed memory of a
+ * realtime clock chip.
+ *
+ * The non-volatile memory of clock chips such as the DS1307 and DS3232 is
+ * battery-backed SRAM that does not wear out and that can be written much
+ * faster than EEPROM, so the seed can be saved more often with a shorter
+ * \link RNGClass::setAutoSaveTime() RNG.setAutoSaveTime()\endlink.
+ * A single seed slot is all that is needed:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <RNG.h>
+ * #include <SoftI2C.h>
+ * #include <DS3232RTC.h>
+ * #include <RTCSeedStorage.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * DS3232RTC rtc(bus);
+ * RTCSeedStorage seedStorage(rtc, 0);
+ *
+ * void setup() {
+ *     RNG.begin("MyApp 1.0", seedStorage);
+ *     RNG.setAutoSaveTime(5);
+ * }
+ * \endcode
+ *
+ * The memory area starting at the offset must hold at least
+ * \link RNGClass::SEED_SIZE RNGClass::SEED_SIZE\endlink bytes, which
+ * rules out the software-only RTC class.  The DS1307 has 56 bytes.
+ *
+ * \note The seed is not protected against someone who can read the
+ * clock's memory over the I2C bus, which is also true of the other
+ * kinds of seed storage.
+ *
+ * \sa SeedStorage, RTC::readByte(), RTC::writeByte()
+ */
+
+/**
+ * \brief Constructs a new seed storage object for a realtime clock.
+ *
+ * \param rtc The realtime clock to store the seed in.
+ * \param offset The offset of the start of the storage area within the
+ * clock's non-volatile memory.
+ */
+RTCSeedStorage::RTCSeedStorage(RTC &rtc, uint8_t offset)
+    : _rtc(&rtc)
+    , _offset(offset)
+{
+}
+
+/**
+ * \brief Destroys this realtime clock seed storage object.
+ */
+RTCSeedStorage::~RTCSeedStorage()
+{
+}
+
+uint8_t RTCSeedStorage::read(unsigned int offset)
+{
+    return _rtc->readByte((uint8_t)(_offset + offset));
+}
+
+void RTCSeedStorage::write(unsigned int offset, uint8_t value)
+{
+    _rtc->writeByte((uint8_t)(_offset + offset), value);
+}
@@ -24,6 +24,9 @@
 #include "Crypto.h"
 #include "RNG.h"
 #include <Arduino.h>
+#if ISR_PROFILER
+#include <ISRProfiler.h>
+#endif
 
 /**
  * \class RingOscillatorNoiseSource RingOscillatorNoiseSource.h <RingOscillatorNoiseSource.h>
@@ -94,6 +97,15 @@
  *
  * For more information, see the documentation for \link RNGClass RNG\endlink.
  *
+ * While calibrating, the class measures the distribution of the two
+ * lowest bits of the capture deltas.  If the second-lowest bit looks
+ * as balanced as the lowest, then both bits are used from each capture;
+ * otherwise only the lowest bit is used.  The choice can be queried with
+ * captureBits().  The class also samples faster when the random number
+ * pool is short of entropy: captures are buffered in the background and
+ * all of them are processed on each call to stir() until the pool is full,
+ * after which only a single block of captures is processed per call.
+ *
  * \sa \link RNGClass RNG\endlink, NoiseSource, TransistorNoiseSource
  */
 
@@ -104,18 +116,24 @@
 #define RING_PIN        49
 #define RING_CAPT_vect  TIMER4_CAPT_vect
 #define RING_ICR        ICR4
+#define RING_TIMSK      TIMSK4
+#define RING_ICIE       ICIE4
 #elif defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega16U4__)
 // Arduino Leonardo - input capture on Timer1 and D4/PD4.
 #define RING_TIMER      1
 #define RING_PIN        4
 #define RING_CAPT_vect  TIMER1_CAPT_vect
 #define RING_ICR        ICR1
+#define RING_TIMSK      TIMSK1
+#define RING_ICIE       ICIE1
 #else
 // Assuming Arduino Uno or equivalent - input capture on TIMER1 and D8/PB0.
 #define RING_TIMER      1
 #define RING_PIN        8
 #define RING_CAPT_vect  TIMER1_CAPT_vect
 #define RING_ICR        ICR1
+#define RING_TIMSK      TIMSK1
+#define RING_ICIE       ICIE1
 #endif
 
 // Calibration states.
@@ -126,10 +144,30 @@
 // then assume that the oscillator is stopped or disconnected.
 #define RING_DISCONNECT_TIME    200
 
+// Number of 16-bit blocks of capture bits that can be buffered by the
+// interrupt service routine before it pauses to wait for stir().
+#define RING_FIFO_SIZE          4
+
+// Number of captures to measure during calibration before deciding
+// how many low-order bits to use from each capture.
+#define RING_STAT_SAMPLES       512
+
+// Calculate a percentage of the calibration sample count.
+#define RING_STAT_PCT(num)      ((unsigned int)(((long)RING_STAT_SAMPLES) * (num) / 100L))
+
+// Number of bytes to ask RNG.available() for to determine if the
+// random number pool is full of entropy.
+#define RING_POOL_FULL          48
+
 RingOscillatorNoiseSource::RingOscillatorNoiseSource()
     : calState(NOISE_CALIBRATING)
+    , bitsPerCapture(1)
     , lastSignal(millis())
 {
+    // The raw jitter bits carry less entropy than a transistor noise
+    // source, so use the health test cutoffs for 0.125 bits per sample.
+    setHealthCutoffs(161, 979);
+
     // Initialize the bit collection routines.
     restart();
 
@@ -180,78 +218,191 @@ bool RingOscillatorNoiseSource::calibrating() const
     return calState == NOISE_CALIBRATING;
 }
 
-static uint16_t volatile out = 0;
-static uint8_t volatile outBits = 0;
+/**
+ * \fn uint8_t RingOscillatorNoiseSource::captureBits() const
+ * \brief Returns the number of low-order bits that are being used from
+ * each timer capture; either 1 or 2.
+ *
+ * This is decided at the end of calibration based on the observed
+ * distribution of the capture jitter.
+ */
+
+static uint16_t volatile fifo[RING_FIFO_SIZE];
+static uint8_t volatile fifoHead = 0;
+static uint8_t volatile fifoCount = 0;
 
 // Interrupt service routine for the timer's input capture interrupt.
 ISR(RING_CAPT_vect)
 {
+#if ISR_PROFILER
+    ISR_PROFILE(ISR_SLOT_CAPTURE);
+#endif
     // We are interested in the jitter; that is the difference in
     // time between one rising edge and the next in the signal.
-    // Extract a single bit from the jitter and add it to the
-    // rolling "out" buffer for the main code to process later.
-    // If the buffer overflows, we discard bits and keep going.
+    // Extract the two lowest bits of the jitter and add them to the
+    // rolling "out" buffer.  Once 8 captures have been collected, the
+    // buffer is queued for the main code to process later.  If the queue
+    // fills up, then we stop capturing until stir() has drained it.
     static uint16_t prev = 0;
+    static uint16_t out = 0;
+    static uint8_t outBits = 0;
     uint16_t next = RING_ICR;
-    out = (out << 1) | ((next - prev) & 1);
+    out = (out << 2) | ((next - prev) & 3);
     prev = next;
-    ++outBits;
+    if ((outBits += 2) >= 16) {
+        uint8_t count = fifoCount;
+        fifo[(fifoHead + count) % RING_FIFO_SIZE] = out;
+        fifoCount = ++count;
+        if (count >= RING_FIFO_SIZE)
+            RING_TIMSK &= ~(1 << RING_ICIE);
+        outBits = 0;
+    }
 }
 
 void RingOscillatorNoiseSource::stir()
 {
-    // If the "out" buffer is full, then convert the bits.  Turn off
-    // interrupts while we read the "out" buffer and reset "outBits".
+    // Process every queued block while calibrating or while the random
+    // number pool is short of entropy.  Once the pool is full, process
+    // only one block per call which lets the capture interrupt pause
+    // and reduces the CPU load from the oscillator.
     unsigned long now = millis();
-    cli();
-    if (outBits >= 16) {
-        uint16_t bits = out;
-        outBits = 0;
-        sei();
-        for (uint8_t index = 0; index < 8; ++index) {
-            // Collect two bits of input and remove bias using the Von Neumann
-            // method.  If both bits are the same, then discard both.
-            // Otherwise choose one of the bits and output that one.
-            // We have to do this carefully so that instruction timing does
-            // not reveal the value of the bit that is chosen.
-            if ((bits ^ (bits << 1)) & 0x8000) {
-                // The bits are different: add the top-most to the buffer.
-                if (posn < sizeof(buffer)) {
-                    buffer[posn] = (buffer[posn] >> 1) |
-                                   (((uint8_t)(bits >> 8)) & (uint8_t)0x80);
-                    if (++bitNum >= 8) {
-                        ++posn;
-                        bitNum = 0;
-                    }
-                }
-            }
-            bits = bits << 2;
+    uint8_t blocks = RING_FIFO_SIZE;
+    if (calState == NOISE_NOT_CALIBRATING && RNG.available(RING_POOL_FULL))
+        blocks = 1;
+    bool gotBlock = false;
+    while (blocks-- > 0) {
+        // Turn off interrupts while we remove a block from the queue.
+        cli();
+        if (!fifoCount) {
+            sei();
+            break;
         }
-    } else {
-        // The "out" buffer isn't full yet.  Re-enable interrupts.
+        uint16_t word = fifo[fifoHead];
+        fifo[fifoHead] = 0;
+        fifoHead = (fifoHead + 1) % RING_FIFO_SIZE;
+        --fifoCount;
+        RING_TIMSK |= (1 << RING_ICIE);
         sei();
+        gotBlock = true;
 
-        // If it has been too long since the last useful block,
-        // then go back to calibrating.  The oscillator may be
-        // stopped or disconnected.
-        if (calState == NOISE_NOT_CALIBRATING) {
-            if ((now - lastSignal) >= RING_DISCONNECT_TIME) {
-                restart();
-                calState = NOISE_CALIBRATING;
-            }
+        // Process the bits.  Stop if the health tests have failed.
+        if (!addBits(word))
+            return;
+
+        // If the buffer is full, then stir it into the random number pool.
+        // We credit 1 bit of entropy for every 8 bits of output because
+        // ring oscillators aren't quite as good as a true noise source.
+        // We have to collect a lot more data to get something random enough.
+        if (posn >= sizeof(buffer)) {
+            output(buffer, posn, posn);
+            restart();
+            calState = NOISE_NOT_CALIBRATING;
+            lastSignal = now;
         }
     }
 
-    // If the buffer is full, then stir it into the random number pool.
-    // We credit 1 bit of entropy for every 8 bits of output because
-    // ring oscillators aren't quite as good as a true noise source.
-    // We have to collect a lot more data to get something random enough.
-    if (posn >= sizeof(buffer)) {
-        output(buffer, posn, posn);
+    // If it has been too long since the last useful block,
+    // then go back to calibrating.  The oscillator may be
+    // stopped or disconnected.
+    if (!gotBlock && calState == NOISE_NOT_CALIBRATING) {
+        if ((now - lastSignal) >= RING_DISCONNECT_TIME) {
+            restart();
+            calState = NOISE_CALIBRATING;
+        }
+    }
+}
+
+/**
+ * \internal
+ * \brief Adds a block of 8 captures to the output buffer.
+ *
+ * \param word The block, with the two lowest bits of each capture.
+ *
+ * \return Returns false if the raw bits failed the health tests.
+ */
+bool RingOscillatorNoiseSource::addBits(uint16_t word)
+{
+    if (calState == NOISE_CALIBRATING)
+        calibrate(word);
+
+    // Extract the raw bits that we want to use.  The lowest bit of each
+    // capture is packed into the top half of "bits" and the second-lowest
+    // into the bottom half.  This way the Von Neumann pairs below always
+    // compare the same bit position from two consecutive captures.
+    uint16_t bits = 0;
+    for (uint8_t index = 0; index < 8; ++index) {
+        bits |= ((word >> (index * 2)) & 1) << (index + 8);
+        bits |= ((word >> (index * 2 + 1)) & 1) << index;
+    }
+    uint8_t count = (bitsPerCapture > 1) ? 16 : 8;
+
+    // Run the continuous health tests on the raw bits.  If they fail,
+    // then the oscillator may be stuck or locked to another signal.
+    // Discard the bits that we have collected and recalibrate using
+    // only the lowest bit of each capture until proven otherwise.
+    bool healthy = true;
+    for (uint8_t index = 0; index < count; ++index)
+        healthy &= healthTest((uint8_t)((bits >> (15 - index)) & 1));
+    if (!healthy) {
         restart();
-        calState = NOISE_NOT_CALIBRATING;
-        lastSignal = now;
+        calState = NOISE_CALIBRATING;
+        bitsPerCapture = 1;
+        return false;
+    }
+
+    for (uint8_t index = 0; index < count; index += 2) {
+        // Collect two bits of input and remove bias using the Von Neumann
+        // method.  If both bits are the same, then discard both.
+        // Otherwise choose one of the bits and output that one.
+        // We have to do this carefully so that instruction timing does
+        // not reveal the value of the bit that is chosen.
+        if ((bits ^ (bits << 1)) & 0x8000) {
+            // The bits are different: add the top-most to the buffer.
+            if (posn < sizeof(buffer)) {
+                buffer[posn] = (buffer[posn] >> 1) |
+                               (((uint8_t)(bits >> 8)) & (uint8_t)0x80);
+                if (++bitNum >= 8) {
+                    ++posn;
+                    bitNum = 0;
+                }
+            }
+        }
+        bits = bits << 2;
+    }
+    return true;
+}
+
+/**
+ * \internal
+ * \brief Measures the distribution of the second-lowest capture bit
+ * during calibration to decide how many bits to use from each capture.
+ *
+ * \param word The block, with the two lowest bits of each capture.
+ *
+ * The second-lowest bit is used if it is roughly balanced between 0 and 1
+ * and changes from one capture to the next roughly half of the time.
+ * A bit that is stuck or that alternates in a regular pattern will fail.
+ */
+void RingOscillatorNoiseSource::calibrate(uint16_t word)
+{
+    for (uint8_t index = 0; index < 8; ++index) {
+        uint8_t bit = (uint8_t)((word >> (index * 2 + 1)) & 1);
+        statOnes += bit;
+        statChanges += bit ^ lastStatBit;
+        lastStatBit = bit;
     }
+    statCount += 8;
+    if (statCount < RING_STAT_SAMPLES)
+        return;
+    if (statOnes >= RING_STAT_PCT(40) && statOnes <= RING_STAT_PCT(60) &&
+            statChanges >= RING_STAT_PCT(40) &&
+            statChanges <= RING_STAT_PCT(60))
+        bitsPerCapture = 2;
+    else
+        bitsPerCapture = 1;
+    statCount = 0;
+    statOnes = 0;
+    statChanges = 0;
 }
 
 void RingOscillatorNoiseSource::restart()
@@ -260,4 +411,8 @@ void RingOscillatorNoiseSource::restart()
     prevBit = 0;
     posn = 0;
     bitNum = 0;
+    lastStatBit = 0;
+    statCount = 0;
+    statOnes = 0;
+    statChanges = 0;
 }
@@ -36,15 +36,24 @@ public:
 
     void stir();
 
+    uint8_t captureBits() const { return bitsPerCapture; }
+
 private:
     uint8_t prevBit;
     uint8_t posn;
     uint8_t bitNum;
     uint8_t calState;
     uint8_t buffer[32];
+    uint8_t bitsPerCapture;
+    uint8_t lastStatBit;
+    unsigned int statCount;
+    unsigned int statOnes;
+    unsigned int statChanges;
     unsigned long lastSignal;
 
     void restart();
+    bool addBits(uint16_t word);
+    void calibrate(uint16_t word);
 };
 
 #endif
@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SecureStorage.h"
+#include "AuthenticatedCipher.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class SecureStorage SecureStorage.h <SecureStorage.h>
+ * \brief Abstract base class for encrypted and authenticated storage
+ * that is divided into independently updated pages.
+ *
+ * Encrypting a block of configuration data or log records as a single
+ * message means that it has to be re-encrypted and written out in full
+ * every time a byte changes.  This class divides the storage into pages
+ * instead.  Each page is encrypted separately with an AuthenticatedCipher
+ * such as ChaChaPoly or GCM, so that read() only needs to decrypt the pages
+ * that it is reading from, and write() only re-encrypts the pages that
+ * have changed.
+ *
+ * The most recently used page is kept decrypted in a buffer supplied to
+ * begin().  Changes are made in the buffer and are written back by
+ * flush(), or when read() or write() moves on to a different page:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <ChaChaPoly.h>
+ * #include <SoftI2C.h>
+ * #include <EEPROM24.h>
+ * #include <EEPROM24SecureStorage.h>
+ *
+ * SoftI2C bus(A4, A5);
+ * EEPROM24 eeprom(bus, EEPROM_24LC256);
+ * EEPROM24SecureStorage storage(eeprom, 0, 4096);
+ * ChaChaPoly cipher;
+ * uint8_t page[64];
+ *
+ * void setup() {
+ *     cipher.setKey(storageKey, 32);
+ *     storage.begin(cipher, page, sizeof(page));
+ *     if (!storage.isFormatted())
+ *         storage.format();
+ *     storage.read(CONFIG_OFFSET, &config, sizeof(config));
+ *     ...
+ *     config.volume = 7;
+ *     storage.write(CONFIG_OFFSET, &config, sizeof(config));
+ *     storage.flush();
+ * }
+ * \endcode
+ *
+ * Each page has two slots in the underlying storage, each of which holds
+ * a copy of the page in pageSize() + PAGE_OVERHEAD bytes: a 4-byte version
+ * number, the 16-byte authentication tag, and the encrypted contents.
+ * Writes alternate between the slots, so the previous copy of a page is
+ * left intact until the new copy has been completely written.  The nonce
+ * for each copy is made up of the page number and the version, so a page
+ * that is copied to a different location will fail to authenticate.
+ *
+ * The version is a single counter for the whole storage area that is
+ * incremented on every page write.  The header with the new version is
+ * written before the encrypted contents, and begin() recovers the counter
+ * by scanning every header for the highest version, including headers
+ * whose copy was interrupted by a power failure.  A version is therefore
+ * not used twice for the same page as long as the storage area is not
+ * rolled back to an earlier state while the device is powered off.  This
+ * class cannot detect such a rollback on its own.  Storage that an
+ * attacker can replace or restore wholesale needs a key that changes when
+ * it is erased, or a version counter that is kept somewhere else.
+ *
+ * Slots that have never been written, whose headers are all 0x00 or all
+ * 0xFF, have no tag and cannot be told apart from a copy that has been
+ * erased by someone else.  A page with no authenticated copy is treated
+ * as not present: read() returns false, and write() can only replace it
+ * as a whole.  New storage should be initialized with format(), which
+ * writes an authenticated page of zeroes to every page.  isFormatted()
+ * reports whether that has been done.
+ *
+ * If power is lost while a page is being written, the new copy will fail
+ * to authenticate and read() falls back to the previous copy.  The
+ * previous copy is also what someone who corrupts the newest copy will
+ * get, so this class only guarantees that a page read back is one that was
+ * written for that page, not that it is the latest version.
+ *
+ * \sa EEPROM24SecureStorage, RTCSecureStorage
+ */
+
+/**
+ * \var SecureStorage::PAGE_OVERHEAD
+ * \brief Number of bytes of extra storage that are needed for each copy
+ * of a page to hold the version number and the authentication tag.
+ *
+ * Every page has two copies, so it occupies a total of
+ * 2 * (pageSize() + PAGE_OVERHEAD) bytes of the underlying storage.
+ */
+
+// Page number that indicates that no page is in the buffer.
+#define SECURE_STORAGE_NO_PAGE  0xFFFFFFFFUL
+
+// Version numbers of a slot that has never been written, which are the
+// values that erased EEPROM and cleared battery-backed memory read back as.
+// Real versions start at 1.
+#define SECURE_STORAGE_EMPTY    0xFFFFFFFFUL
+#define SECURE_STORAGE_CLEARED  0
+
+// Size of the authentication tag on each page.
+#define SECURE_STORAGE_TAG_SIZE 16
+
+// Number of slots that hold copies of each page.
+#define SECURE_STORAGE_SLOTS    2
+
+// Extracts the version number from a page header.
+static uint32_t headerVersion(const uint8_t *header)
+{
+    return ((uint32_t)(header[0])) |
+           (((uint32_t)(header[1])) << 8) |
+           (((uint32_t)(header[2])) << 16) |
+           (((uint32_t)(header[3])) << 24);
+}
+
+// Determines if a version number indicates a slot that has never been written.
+static inline bool isBlankVersion(uint32_t pageVersion)
+{
+    return pageVersion == SECURE_STORAGE_EMPTY ||
+           pageVersion == SECURE_STORAGE_CLEARED;
+}
+
+/**
+ * \brief Constructs a new secure storage object.
+ *
+ * \param rawSize The size of the underlying storage in bytes.
+ */
+SecureStorage::SecureStorage(unsigned long rawSize)
+    : cipher(0)
+    , page(0)
+    , _pageSize(0)
+    , _pageCount(0)
+    , rawSize(rawSize)
+    , current(SECURE_STORAGE_NO_PAGE)
+    , version(0)
+    , target(0)
+    , dirty(false)
+{
+}
+
+/**
+ * \brief Destroys this secure storage object.
+ *
+ * The page buffer is cleared but changes that have not been written
+ * with flush() are lost.
+ */
+SecureStorage::~SecureStorage()
+{
+    if (page)
+        clean(page, _pageSize);
+}
+
+/**
+ * \brief Starts using the storage with a specific cipher and page buffer.
+ *
+ * \param cipher The authenticated cipher to encrypt the pages with, which
+ * must already have been given its key with setKey().  The cipher's
+ * nonce must be able to hold 12 bytes, which is true of ChaChaPoly and GCM.
+ * \param page Buffer that holds the decrypted contents of a page.
+ * \param pageSize The size of the \a page buffer, which is also the
+ * number of bytes of data in each page.
+ *
+ * \return Returns false if the storage is too small for a single page,
+ * or if the page headers could not be read to recover the version number.
+ *
+ * Smaller pages make updates cheaper but give up more of the storage
+ * to the PAGE_OVERHEAD of each copy.  On an EEPROM24, a page size that
+ * is 20 bytes less than a multiple of the EEPROM's own page size avoids
+ * splitting writes.
+ *
+ * \sa isFormatted(), format()
+ *
+ * The \a cipher and \a page must remain valid for as long as the storage
+ * is in use.  The \a cipher should not be used for anything else.
+ */
+bool SecureStorage::begin(AuthenticatedCipher &cipher, uint8_t *page,
+                          size_t pageSize)
+{
+    if (this->page)
+        clean(this->page, _pageSize);
+    this->cipher = &cipher;
+    this->page = page;
+    _pageSize = pageSize;
+    _pageCount = 0;
+    current = SECURE_STORAGE_NO_PAGE;
+    version = 0;
+    dirty = false;
+    if (!pageSize ||
+            rawSize < SECURE_STORAGE_SLOTS * (pageSize + PAGE_OVERHEAD))
+        return false;
+
+    // Find the highest version number that has been used so far.  This
+    // includes the headers of copies that failed to authenticate because
+    // the power was lost, as their version was in use all the same.
+    unsigned long count =
+        rawSize / (SECURE_STORAGE_SLOTS * (pageSize + PAGE_OVERHEAD));
+    _pageCount = count;
+    for (unsigned long index = 0; index < count; ++index) {
+        for (uint8_t slot = 0; slot < SECURE_STORAGE_SLOTS; ++slot) {
+            uint8_t header[4];
+            if (!readRaw(slotAddress(index, slot), header, 4)) {
+                _pageCount = 0;
+                return false;
+            }
+            uint32_t pageVersion = headerVersion(header);
+            if (pageVersion != SECURE_STORAGE_EMPTY && pageVersion > version)
+                version = pageVersion;
+        }
+    }
+    return true;
+}
+
+/**
+ * \fn bool SecureStorage::isFormatted() const
+ * \brief Determines if any page of the storage has ever been written.
+ *
+ * \return Returns false if every slot of the storage was blank when begin()
+ * was called and nothing has been written since, as for a new device.
+ *
+ * \sa format(), begin()
+ */
+
+/**
+ * \brief Formats the storage by writing a page of zeroes to every page.
+ *
+ * \return Returns false if a page could not be written.
+ *
+ * A page with no authenticated copy cannot be read, so new storage must
+ * be formatted before it is used.  This can also be used to erase the
+ * contents of all pages.  Changes in the page buffer that have not been
+ * written with flush() are lost.
+ *
+ * Do not format the storage just because read() failed; that would let
+ * anyone who can corrupt a page erase the whole storage area.
+ *
+ * \sa isFormatted()
+ */
+bool SecureStorage::format()
+{
+    if (!page)
+        return false;
+    clear();
+    for (unsigned long index = 0; index < _pageCount; ++index) {
+        if (!loadPage(index, true))
+            return false;
+        memset(page, 0, _pageSize);
+        dirty = true;
+        if (!flushPage())
+            return false;
+    }
+    clear();
+    return true;
+}
+
+/**
+ * \fn size_t SecureStorage::pageSize() const
+ * \brief Returns the number of bytes of data in each page.
+ */
+
+/**
+ * \fn unsigned long SecureStorage::pageCount() const
+ * \brief Returns the number of pages that fit in the underlying storage.
+ */
+
+/**
+ * \fn unsigned long SecureStorage::size() const
+ * \brief Returns the number of bytes of data that can be stored.
+ */
+
+/**
+ * \brief Reads and decrypts data from the storage.
+ *
+ * \param offset The offset of the data to read.
+ * \param data The buffer to read the data into.
+ * \param len The number of bytes to read.
+ *
+ * \return Returns true if the data was read; or false if the range is
+ * outside the storage, or neither copy of a page authenticated.
+ *
+ * Only the pages that contain the requested range are decrypted.  Pages
+ * that have never been written also fail to authenticate; see format().
+ *
+ * \sa write()
+ */
+bool SecureStorage::read(unsigned long offset, void *data, size_t len)
+{
+    uint8_t *d = (uint8_t *)data;
+    if (offset > size() || len > (size() - offset))
+        return false;
+    while (len > 0) {
+        unsigned long index = offset / _pageSize;
+        size_t posn = (size_t)(offset % _pageSize);
+        size_t templen = _pageSize - posn;
+        if (templen > len)
+            templen = len;
+        if (!loadPage(index, false))
+            return false;
+        memcpy(d, page + posn, templen);
+        d += templen;
+        offset += templen;
+        len -= templen;
+    }
+    return true;
+}
+
+/**
+ * \brief Writes data to the storage.
+ *
+ * \param offset The offset to write the data to.
+ * \param data The data to write.
+ * \param len The number of bytes to write.
+ *
+ * \return Returns true if the data was written; or false if the range is
+ * outside the storage, neither copy of a page that is partly overwritten
+ * authenticated, or a page could not be written back.
+ *
+ * The data is copied into the page buffer and the page is marked as
+ * dirty.  Dirty pages are encrypted and written back when the buffer is
+ * needed for another page, or by flush().  Pages that are entirely
+ * replaced by \a data are not read first.
+ *
+ * \sa read(), flush()
+ */
+bool SecureStorage::write(unsigned long offset, const void *data, size_t len)
+{
+    const uint8_t *d = (const uint8_t *)data;
+    if (offset > size() || len > (size() - offset))
+        return false;
+    while (len > 0) {
+        unsigned long index = offset / _pageSize;
+        size_t posn = (size_t)(offset % _pageSize);
+        size_t templen = _pageSize - posn;
+        if (templen > len)
+            templen = len;
+        if (!loadPage(index, templen == _pageSize))
+            return false;
+        memcpy(page + posn, d, templen);
+        dirty = true;
+        d += templen;
+        offset += templen;
+        len -= templen;
+    }
+    return true;
+}
+
+/**
+ * \brief Encrypts and writes back the page in the buffer if it is dirty.
+ *
+ * \return Returns false if the page could not be written, or the version
+ * counter has been exhausted.  The page remains dirty in the buffer on
+ * failure so that the write can be retried.
+ *
+ * \sa write()
+ */
+bool SecureStorage::flush()
+{
+    return flushPage();
+}
+
+/**
+ * \brief Clears the page buffer without writing it back.
+ *
+ * Changes that have not been written with flush() are lost.
+ */
+void SecureStorage::clear()
+{
+    if (page)
+        clean(page, _pageSize);
+    current = SECURE_STORAGE_NO_PAGE;
+    dirty = false;
+}
+
+/**
+ * \fn bool SecureStorage::readRaw(unsigned long address, void *data, size_t len)
+ * \brief Reads raw bytes from the underlying storage.
+ *
+ * \param address The address within the storage area to read from.
+ * \param data The buffer to read into.
+ * \param len The number of bytes to read.
+ *
+ * \return Returns false if the bytes could not be read.
+ */
+
+/**
+ * \fn bool SecureStorage::writeRaw(unsigned long address, const void *data, size_t len)
+ * \brief Writes raw bytes to the underlying storage.
+ *
+ * \param address The address within the storage area to write to.
+ * \param data The bytes to write.
+ * \param len The number of bytes to write.
+ *
+ * \return Returns false if the bytes could not be written.
+ */
+
+/**
+ * \brief Returns the address of a copy of a page within the underlying storage.
+ *
+ * \param index The page number.
+ * \param slot The slot for the copy, 0 or 1.
+ */
+unsigned long SecureStorage::slotAddress(unsigned long index, uint8_t slot) const
+{
+    return (index * SECURE_STORAGE_SLOTS + slot) * (_pageSize + PAGE_OVERHEAD);
+}
+
+/**
+ * \brief Sets the cipher's nonce for a specific version of a page.
+ *
+ * \param index The page number.
+ * \param pageVersion The version number of the page.
+ */
+void SecureStorage::setNonce(unsigned long index, uint32_t pageVersion)
+{
+    uint8_t iv[12];
+    iv[0] = (uint8_t)index;
+    iv[1] = (uint8_t)(index >> 8);
+    iv[2] = (uint8_t)(index >> 16);
+    iv[3] = (uint8_t)(index >> 24);
+    iv[4] = (uint8_t)pageVersion;
+    iv[5] = (uint8_t)(pageVersion >> 8);
+    iv[6] = (uint8_t)(pageVersion >> 16);
+    iv[7] = (uint8_t)(pageVersion >> 24);
+    iv[8] = 0;
+    iv[9] = 0;
+    iv[10] = 0;
+    iv[11] = 0;
+    cipher->setIV(iv, sizeof(iv));
+}
+
+/**
+ * \brief Loads a page into the buffer, writing back the previous page.
+ *
+ * \param index The page number to load.
+ * \param overwrite Set to true if the caller is about to replace the
+ * entire page, in which case the old contents are not read.
+ *
+ * \return Returns false if the previous page could not be written back
+ * or the headers of the new page could not be read, or if \a overwrite
+ * is false and neither copy of the new page authenticated.
+ *
+ * The newer copy is tried first, and then the older copy if the newer one
+ * was interrupted while it was being written.  The next flush of the page
+ * goes to the slot that did not provide the contents.  When \a overwrite
+ * is true the copies are not checked and the older one is replaced.
+ */
+bool SecureStorage::loadPage(unsigned long index, bool overwrite)
+{
+    if (index == current)
+        return true;
+    if (!flushPage())
+        return false;
+    current = SECURE_STORAGE_NO_PAGE;
+
+    // Read the version numbers and tags of both copies.
+    uint8_t header[SECURE_STORAGE_SLOTS][PAGE_OVERHEAD];
+    uint32_t pageVersion[SECURE_STORAGE_SLOTS];
+    uint8_t slot;
+    for (slot = 0; slot < SECURE_STORAGE_SLOTS; ++slot) {
+        if (!readRaw(slotAddress(index, slot), header[slot], PAGE_OVERHEAD))
+            return false;
+        pageVersion[slot] = headerVersion(header[slot]);
+        if (isBlankVersion(pageVersion[slot]))
+            pageVersion[slot] = 0;
+    }
+    uint8_t newest = (pageVersion[1] > pageVersion[0]) ? 1 : 0;
+    if (overwrite) {
+        target = newest ^ 1;
+        current = index;
+        return true;
+    }
+
+    // Read and decrypt the newest copy, and then check the tag.  If that
+    // fails, then try the other copy.
+    for (uint8_t attempt = 0; attempt < SECURE_STORAGE_SLOTS; ++attempt) {
+        slot = newest ^ attempt;
+        if (!pageVersion[slot])
+            continue;
+        if (!readRaw(slotAddress(index, slot) + PAGE_OVERHEAD, page, _pageSize))
+            break;
+        setNonce(index, pageVersion[slot]);
+        cipher->decrypt(page, page, _pageSize);
+        if (cipher->checkTag(header[slot] + 4, SECURE_STORAGE_TAG_SIZE)) {
+            target = slot ^ 1;
+            current = index;
+            return true;
+        }
+    }
+    clean(page, _pageSize);
+    return false;
+}
+
+/**
+ * \brief Encrypts and writes back the page in the buffer if it is dirty.
+ *
+ * \return Returns false if the page could not be written.
+ */
+bool SecureStorage::flushPage()
+{
+    if (!dirty)
+        return true;
+    if (version >= (SECURE_STORAGE_EMPTY - 1))
+        return false;
+
+    // Encrypt the page in place with the next version number.
+    uint32_t pageVersion = ++version;
+    uint8_t header[PAGE_OVERHEAD];
+    header[0] = (uint8_t)pageVersion;
+    header[1] = (uint8_t)(pageVersion >> 8);
+    header[2] = (uint8_t)(pageVersion >> 16);
+    header[3] = (uint8_t)(pageVersion >> 24);
+    setNonce(current, pageVersion);
+    cipher->encrypt(page, page, _pageSize);
+    cipher->computeTag(header + 4, SECURE_STORAGE_TAG_SIZE);
+
+    // Write the header before the contents, and into the slot that does
+    // not hold the copy that we loaded.  If the write is interrupted, then
+    // the version has been recorded for begin() before any ciphertext that
+    // uses it, and the previous copy of the page is still intact.
+    unsigned long address = slotAddress(current, target);
+    bool ok = writeRaw(address, header, sizeof(header)) &&
+              writeRaw(address + PAGE_OVERHEAD, page, _pageSize);
+
+    // Decrypt the page again so that the buffer can still be used.
+    setNonce(current, pageVersion);
+    cipher->decrypt(page, page, _pageSize);
+    clean(header);
+    if (ok) {
+        target ^= 1;
+        dirty = false;
+    }
+    return ok;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_SECURESTORAGE_H
+#define CRYPTO_SECURESTORAGE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class AuthenticatedCipher;
+
+class SecureStorage
+{
+public:
+    virtual ~SecureStorage();
+
+    bool begin(AuthenticatedCipher &cipher, uint8_t *page, size_t pageSize);
+
+    size_t pageSize() const { return _pageSize; }
+    unsigned long pageCount() const { return _pageCount; }
+    unsigned long size() const { return _pageCount * _pageSize; }
+
+    bool isFormatted() const { return version != 0; }
+    bool format();
+
+    bool read(unsigned long offset, void *data, size_t len);
+    bool write(unsigned long offset, const void *data, size_t len);
+    bool flush();
+
+    void clear();
+
+    static const size_t PAGE_OVERHEAD = 20;
+
+protected:
+    explicit SecureStorage(unsigned long rawSize);
+
+    virtual bool readRaw(unsigned long address, void *data, size_t len) = 0;
+    virtual bool writeRaw(unsigned long address, const void *data, size_t len) = 0;
+
+private:
+    AuthenticatedCipher *cipher;
+    uint8_t *page;
+    size_t _pageSize;
+    unsigned long _pageCount;
+    unsigned long rawSize;
+    unsigned long current;
+    uint32_t version;
+    uint8_t target;
+    bool dirty;
+
+    unsigned long slotAddress(unsigned long index, uint8_t slot) const;
+    void setNonce(unsigned long index, uint32_t pageVersion);
+    bool loadPage(unsigned long index, bool overwrite);
+    bool flushPage();
+
+    // Disable copy constructor and operator=().
+    SecureStorage(const SecureStorage &) {}
+    SecureStorage &operator=(const SecureStorage &) { return *this; }
+};
+
+#endif
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the SecureStorage class to verify correct
+behaviour.  The storage is simulated in RAM so that the power can be
+"lost" part way through a write.
+*/
+
+#include <Crypto.h>
+#include <ChaChaPoly.h>
+#include <SecureStorage.h>
+#include <string.h>
+
+#define PAGE_SIZE   28
+#define NUM_PAGES   4
+#define SLOT_SIZE   (PAGE_SIZE + SecureStorage::PAGE_OVERHEAD)
+#define RAW_SIZE    (NUM_PAGES * 2 * SLOT_SIZE)
+#define MAX_NONCES  128
+
+// The raw storage outlives each SecureStorage object, so creating a new
+// object and calling begin() simulates a restart of the device.
+uint8_t rawData[RAW_SIZE];
+
+// Number of bytes that can be written before the power fails, or -1
+// if the power stays on.
+long powerBudget = -1;
+
+// Nonces of ciphertext and tags that have reached the raw storage.
+uint8_t usedNonces[MAX_NONCES][8];
+uint8_t numNonces = 0;
+uint8_t pendingNonce[8];
+bool pending = false;
+bool nonceReused = false;
+
+// Cipher that remembers the nonce of the last encryption so that the
+// storage can tell which nonce is being written out.
+class LoggingChaChaPoly : public ChaChaPoly
+{
+public:
+    bool setIV(const uint8_t *iv, size_t len)
+    {
+        memcpy(lastIV, iv, sizeof(lastIV));
+        return ChaChaPoly::setIV(iv, len);
+    }
+
+    void encrypt(uint8_t *output, const uint8_t *input, size_t len)
+    {
+        memcpy(pendingNonce, lastIV, sizeof(pendingNonce));
+        pending = true;
+        ChaChaPoly::encrypt(output, input, len);
+    }
+
+private:
+    uint8_t lastIV[8];
+};
+
+// Records that the pending nonce has been used on the storage.
+void useNonce()
+{
+    if (!pending)
+        return;
+    pending = false;
+    for (uint8_t posn = 0; posn < numNonces; ++posn) {
+        if (!memcmp(usedNonces[posn], pendingNonce, sizeof(pendingNonce))) {
+            nonceReused = true;
+            return;
+        }
+    }
+    if (numNonces < MAX_NONCES)
+        memcpy(usedNonces[numNonces++], pendingNonce, sizeof(pendingNonce));
+}
+
+class RAMSecureStorage : public SecureStorage
+{
+public:
+    RAMSecureStorage() : SecureStorage(RAW_SIZE) {}
+
+protected:
+    bool readRaw(unsigned long address, void *data, size_t len)
+    {
+        memcpy(data, rawData + address, len);
+        return true;
+    }
+
+    bool writeRaw(unsigned long address, const void *data, size_t len)
+    {
+        const uint8_t *d = (const uint8_t *)data;
+        while (len > 0) {
+            if (powerBudget == 0)
+                return false;
+            if (powerBudget > 0)
+                --powerBudget;
+            // Anything after the version number is a tag or ciphertext.
+            if ((address % SLOT_SIZE) >= 4)
+                useNonce();
+            rawData[address++] = *d++;
+            --len;
+        }
+        return true;
+    }
+};
+
+static uint8_t const key[32] = {
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f
+};
+
+LoggingChaChaPoly cipher;
+uint8_t page[PAGE_SIZE];
+uint8_t buffer[PAGE_SIZE * NUM_PAGES];
+uint8_t expected[PAGE_SIZE * NUM_PAGES];
+uint8_t saved[2 * SLOT_SIZE];
+
+// Starts the storage again as though the device had been reset.
+bool restart(RAMSecureStorage &storage)
+{
+    powerBudget = -1;
+    pending = false;
+    cipher.setKey(key, sizeof(key));
+    return storage.begin(cipher, page, sizeof(page));
+}
+
+bool checkContents(RAMSecureStorage &storage)
+{
+    if (!storage.read(0, buffer, sizeof(buffer)))
+        return false;
+    return memcmp(buffer, expected, sizeof(buffer)) == 0;
+}
+
+bool writePage(RAMSecureStorage &storage, uint8_t index, uint8_t value)
+{
+    memset(buffer, value, PAGE_SIZE);
+    return storage.write(index * PAGE_SIZE, buffer, PAGE_SIZE) &&
+           storage.flush();
+}
+
+bool readPage(RAMSecureStorage &storage, uint8_t index, uint8_t value)
+{
+    uint8_t posn;
+    if (!storage.read(index * PAGE_SIZE, buffer, PAGE_SIZE))
+        return false;
+    for (posn = 0; posn < PAGE_SIZE; ++posn) {
+        if (buffer[posn] != value)
+            return false;
+    }
+    return true;
+}
+
+uint8_t *slotData(uint8_t index, uint8_t slot)
+{
+    return rawData + (index * 2 + slot) * SLOT_SIZE;
+}
+
+// Returns the slot holding the newer copy of a page.
+uint8_t newestSlot(uint8_t index)
+{
+    uint8_t *s0 = slotData(index, 0);
+    uint8_t *s1 = slotData(index, 1);
+    uint32_t v0 = ((uint32_t)s0[0]) | (((uint32_t)s0[1]) << 8) |
+                  (((uint32_t)s0[2]) << 16) | (((uint32_t)s0[3]) << 24);
+    uint32_t v1 = ((uint32_t)s1[0]) | (((uint32_t)s1[1]) << 8) |
+                  (((uint32_t)s1[2]) << 16) | (((uint32_t)s1[3]) << 24);
+    return (v1 > v0) ? 1 : 0;
+}
+
+void testFormat()
+{
+    RAMSecureStorage storage;
+    bool ok;
+
+    Serial.print("Format ... ");
+
+    memset(rawData, 0xFF, sizeof(rawData));
+    memset(expected, 0, sizeof(expected));
+    ok = restart(storage) && storage.pageCount() == NUM_PAGES;
+    ok = ok && !storage.isFormatted() && !storage.read(0, buffer, 1);
+    ok = ok && storage.format() && storage.isFormatted();
+    ok = ok && checkContents(storage);
+    ok = ok && restart(storage) && storage.isFormatted();
+    ok = ok && checkContents(storage);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testReadWrite()
+{
+    RAMSecureStorage storage;
+    bool ok;
+    uint16_t posn;
+
+    Serial.print("Read and write ... ");
+
+    ok = restart(storage);
+    for (posn = 0; posn < sizeof(expected); ++posn)
+        expected[posn] = (uint8_t)(posn * 7 + 1);
+
+    // Write across page boundaries in odd-sized pieces.
+    for (posn = 0; ok && posn < sizeof(expected); posn += 11) {
+        size_t len = sizeof(expected) - posn;
+        if (len > 11)
+            len = 11;
+        ok = storage.write(posn, expected + posn, len);
+    }
+    ok = ok && storage.flush() && checkContents(storage);
+    ok = ok && restart(storage) && checkContents(storage);
+
+    // Each update goes to the other copy of the page.
+    uint8_t slot = newestSlot(1);
+    for (posn = 0; ok && posn < 5; ++posn) {
+        expected[PAGE_SIZE + 3] = (uint8_t)posn;
+        ok = storage.write(PAGE_SIZE + 3, expected + PAGE_SIZE + 3, 1) &&
+             storage.flush();
+        slot ^= 1;
+        ok = ok && newestSlot(1) == slot;
+        ok = ok && restart(storage) && checkContents(storage);
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testTornWrite()
+{
+    RAMSecureStorage storage;
+    bool ok;
+    long budget;
+    uint8_t value;
+
+    Serial.print("Torn writes ... ");
+
+    // Lose the power after every possible number of bytes while writing
+    // page 2, then restart and write the page again.  The page must hold
+    // either the old or the new contents, and no nonce that reached the
+    // storage may be used again.
+    ok = restart(storage) && writePage(storage, 2, 0x33);
+    memset(expected + 2 * PAGE_SIZE, 0x33, PAGE_SIZE);
+    for (budget = 0; ok && budget <= (long)SLOT_SIZE; ++budget) {
+        value = (uint8_t)(0x40 + budget);
+        powerBudget = budget;
+        if (writePage(storage, 2, value) != (budget == (long)SLOT_SIZE))
+            ok = false;
+        else if (budget == (long)SLOT_SIZE)
+            memset(expected + 2 * PAGE_SIZE, value, PAGE_SIZE);
+        ok = ok && restart(storage) && checkContents(storage);
+
+        value ^= 0x80;
+        ok = ok && writePage(storage, 2, value);
+        memset(expected + 2 * PAGE_SIZE, value, PAGE_SIZE);
+        ok = ok && restart(storage) && checkContents(storage);
+    }
+    ok = ok && !nonceReused;
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testTamper()
+{
+    RAMSecureStorage storage;
+    bool ok;
+    uint8_t slot;
+
+    Serial.print("Tampering ... ");
+
+    // Give page 1 an older and a newer copy.
+    ok = restart(storage) && writePage(storage, 1, 0x11) &&
+         writePage(storage, 1, 0x22);
+    memcpy(saved, slotData(1, 0), sizeof(saved));
+    slot = newestSlot(1);
+
+    // Corrupting the newer copy falls back to the older copy.
+    slotData(1, slot)[SLOT_SIZE - 1] ^= 0x01;
+    ok = ok && restart(storage) && readPage(storage, 1, 0x11);
+    slotData(1, slot ^ 1)[SLOT_SIZE - 1] ^= 0x01;
+    ok = ok && restart(storage) && !storage.read(PAGE_SIZE, buffer, 1);
+
+    // Erased or cleared pages do not read back as zeroes.
+    memset(slotData(1, 0), 0xFF, sizeof(saved));
+    ok = ok && restart(storage) && !storage.read(PAGE_SIZE, buffer, 1);
+    memset(slotData(1, 0), 0x00, sizeof(saved));
+    ok = ok && restart(storage) && !storage.read(PAGE_SIZE, buffer, 1);
+
+    // A page that is copied to another location does not authenticate.
+    memcpy(slotData(1, 0), saved, sizeof(saved));
+    memcpy(slotData(3, 0), saved, sizeof(saved));
+    ok = ok && restart(storage) && !storage.read(3 * PAGE_SIZE, buffer, 1);
+    ok = ok && readPage(storage, 1, 0x22);
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testFormat();
+    testReadWrite();
+    testTornWrite();
+    testTamper();
+}
+
+void loop()
+{
+}
@@ -24,6 +24,13 @@
 #include "RNG.h"
 #include "Crypto.h"
 #include <Arduino.h>
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+#if ISR_PROFILER
+#include <ISRProfiler.h>
+#endif
 
 /**
  * \class TransistorNoiseSource TransistorNoiseSource.h <TransistorNoiseSource.h>
@@ -72,6 +79,22 @@
  * }
  * \endcode
  *
+ * By default stir() performs a single analogRead() every time it is called,
+ * which blocks for about 100us and limits the rate at which entropy
+ * is collected to the rate at which RNGClass::loop() is called.
+ * On AVR platforms, startSampling() can be used to put the ADC into
+ * free-running mode instead.  The noise pin is then sampled in the
+ * background from the ADC interrupt and stir() processes whole chunks
+ * of samples at a time:
+ *
+ * \code
+ * void setup() {
+ *     RNG.begin("MyApp 1.0", 500);
+ *     RNG.addNoiseSource(noise);
+ *     noise.startSampling();
+ * }
+ * \endcode
+ *
  * \sa \link RNGClass RNG\endlink, NoiseSource, RingOscillatorNoiseSource
  */
 
@@ -126,6 +149,9 @@ to the new median level as the circuit's properties change.
 // the noise source to be considered as operating correctly.
 #define NOISE_SPREAD        (ADC_NUM / 8)
 
+// Number of samples in each chunk that is collected by the ADC interrupt.
+#define ADC_CHUNK_BITS      128
+
 // Calibration states.
 #define NOISE_NOT_CALIBRATING   0
 #define NOISE_CALIBRATING       1
@@ -139,6 +165,7 @@ TransistorNoiseSource::TransistorNoiseSource(uint8_t pin)
     : threshold(ADC_NUM / 2)
     , _pin(pin)
     , calState(NOISE_CALIBRATING)
+    , sampling(false)
 {
     // Configure the pin as an analog input with no pull-up.
     pinMode(pin, INPUT);
@@ -150,6 +177,7 @@ TransistorNoiseSource::TransistorNoiseSource(uint8_t pin)
 
 TransistorNoiseSource::~TransistorNoiseSource()
 {
+    stopSampling();
     restart();
 }
 
@@ -159,21 +187,245 @@ bool TransistorNoiseSource::calibrating() const
 }
 
 void TransistorNoiseSource::stir()
+{
+#if defined(__AVR__) && defined(ADCSRA)
+    if (sampling) {
+        stirSamples();
+        return;
+    }
+#endif
+    addValue(analogRead(_pin));
+}
+
+#if defined(__AVR__) && defined(ADCSRA)
+
+// State that is shared with the ADC interrupt service routine.  Samples
+// are converted into raw bits against the threshold and stored in one of
+// two chunks.  While one chunk is being processed by stir() the other
+// is being filled.  If both chunks are full, then samples are discarded.
+static uint8_t volatile adcChunks[2][ADC_CHUNK_BITS / 8];
+static uint8_t volatile adcReady = 0;
+static uint8_t volatile adcFill = 0;
+static uint8_t volatile adcPosn = 0;
+static int volatile adcThreshold = ADC_NUM / 2;
+static int volatile adcMin = ADC_NUM - 1;
+static int volatile adcMax = 0;
+static TransistorNoiseSource *adcOwner = 0;
+
+// Interrupt service routine for the ADC conversion complete interrupt.
+ISR(ADC_vect)
+{
+#if ISR_PROFILER
+    ISR_PROFILE(ISR_SLOT_ADC);
+#endif
+    int value = ADC;
+    if (value < adcMin)
+        adcMin = value;
+    if (value > adcMax)
+        adcMax = value;
+    uint8_t fill = adcFill;
+    if (adcReady & (1 << fill))
+        return;
+    uint8_t posn = adcPosn;
+    uint8_t volatile *chunk = adcChunks[fill] + (posn / 8);
+    *chunk = (*chunk << 1) | (((adcThreshold - value) >> 15) & 1);
+    if (++posn >= ADC_CHUNK_BITS) {
+        adcReady |= (1 << fill);
+        adcFill = fill ^ 1;
+        posn = 0;
+    }
+    adcPosn = posn;
+}
+
+#endif
+
+/**
+ * \brief Starts sampling the noise pin in the background from the
+ * ADC interrupt.
+ *
+ * \return Returns true if background sampling has started, or false if
+ * it is not supported on this platform or another TransistorNoiseSource
+ * object is already sampling in the background.
+ *
+ * While background sampling is active, the ADC is in free-running mode
+ * with a prescaler of 128, which produces about 9600 samples per second
+ * on a 16MHz Arduino.  analogRead() must not be used on any pin while
+ * sampling because it would reprogram the ADC underneath the interrupt.
+ * This class defines the interrupt service routine for ADC_vect, so the
+ * application cannot use that interrupt for itself.
+ *
+ * stir() must still be called regularly, by way of RNGClass::loop(),
+ * to process the samples.  Each call processes all chunks of 128 samples
+ * that have been collected since the last call.  If stir() is not called
+ * often enough, then the interrupt will discard samples until it is.
+ *
+ * \sa stopSampling(), isSampling()
+ */
+bool TransistorNoiseSource::startSampling()
+{
+#if defined(__AVR__) && defined(ADCSRA)
+    if (sampling)
+        return true;
+    if (adcOwner)
+        return false;
+    adcOwner = this;
+    sampling = true;
+    restart();
+
+    // Determine the ADC channel to use.  The Arduino core accepts either
+    // channel numbers or pin numbers when calling analogRead().
+    uint8_t channel = _pin;
+    if (channel >= A0)
+        channel -= A0;
+
+    // Stop any conversion that may be in progress.
+    ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+    while (ADCSRA & _BV(ADSC))
+        ;
+
+    // Reset the chunk state for the interrupt service routine.
+    adcReady = 0;
+    adcFill = 0;
+    adcPosn = 0;
+    adcThreshold = threshold;
+    adcMin = ADC_NUM - 1;
+    adcMax = 0;
+
+    // Select AVcc as the reference and the noise pin as the input, and put
+    // the ADC into free-running mode with the conversion complete interrupt.
+#if defined(MUX5)
+    ADCSRB = (channel & 0x08) ? _BV(MUX5) : 0;
+#elif defined(ADCSRB)
+    ADCSRB = 0;
+#endif
+    ADMUX = _BV(REFS0) | (channel & 0x07);
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+             _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Stops sampling the noise pin in the background.
+ *
+ * The ADC is returned to single conversion mode so that analogRead()
+ * can be used again.  Partially collected data is discarded.
+ *
+ * \sa startSampling(), isSampling()
+ */
+void TransistorNoiseSource::stopSampling()
+{
+#if defined(__AVR__) && defined(ADCSRA)
+    if (!sampling)
+        return;
+    ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+    while (ADCSRA & _BV(ADSC))
+        ;
+    ADCSRA |= _BV(ADIF);
+    adcOwner = 0;
+    sampling = false;
+    clean((void *)adcChunks, sizeof(adcChunks));
+    restart();
+#endif
+}
+
+/**
+ * \fn bool TransistorNoiseSource::isSampling() const
+ * \brief Determine if the noise pin is being sampled in the background.
+ *
+ * \sa startSampling(), stopSampling()
+ */
+
+/**
+ * \internal
+ * \brief Processes the chunks of samples that have been collected
+ * by the ADC interrupt.
+ */
+void TransistorNoiseSource::stirSamples()
+{
+#if defined(__AVR__) && defined(ADCSRA)
+    for (uint8_t index = 0; index < 2; ++index) {
+        if (!(adcReady & (1 << index)))
+            continue;
+
+        // Fold the minimum and maximum seen by the interrupt into the
+        // values for the current bucket.
+        cli();
+        if (adcMin < minValue)
+            minValue = adcMin;
+        if (adcMax > maxValue)
+            maxValue = adcMax;
+        adcMin = ADC_NUM - 1;
+        adcMax = 0;
+        sei();
+
+        // Process the raw bits in the chunk and then hand it back
+        // to the interrupt service routine.
+        uint8_t volatile *chunk = adcChunks[index];
+        bool healthy = true;
+        for (uint8_t posn = 0; posn < ADC_CHUNK_BITS && healthy; ++posn) {
+            uint8_t bit = (chunk[posn / 8] >> (7 - (posn % 8))) & 1;
+            healthy = addBit(bit);
+            if (healthy && count >= SAMPLES_NUM) {
+                finishBucket();
+                adcThreshold = threshold;
+            }
+        }
+        clean((void *)chunk, ADC_CHUNK_BITS / 8);
+        cli();
+        adcReady &= ~(1 << index);
+        sei();
+    }
+#endif
+}
+
+/**
+ * \internal
+ * \brief Adds a single ADC value to the current bucket.
+ *
+ * \param value The value that was read from the ADC.
+ */
+void TransistorNoiseSource::addValue(int value)
 {
     // Keep track of the minimum and maximum while generating data
     // so that we can detect when the input voltage falls too low
     // for the circuit to generate noise.
-    int value = analogRead(_pin);
     if (value < minValue)
         minValue = value;
     if (value > maxValue)
         maxValue = value;
 
+    // Convert the value into a raw bit against the threshold.
+    uint8_t bit = ((threshold - value) >> 15) & 1; // Subtract and extract sign.
+    if (addBit(bit) && count >= SAMPLES_NUM)
+        finishBucket();
+}
+
+/**
+ * \internal
+ * \brief Adds a single raw bit to the current bucket.
+ *
+ * \param bit The raw bit, which is 1 if the sample was above the threshold.
+ *
+ * \return Returns false if the bit failed the health tests and the
+ * bucket was discarded.
+ */
+bool TransistorNoiseSource::addBit(uint8_t bit)
+{
+    // If the raw bits fail the continuous health tests, then the noise
+    // source may be stuck or degraded.  Discard the bucket and recalibrate.
+    if (!healthTest(bit)) {
+        restart();
+        calState = NOISE_CALIBRATING;
+        return false;
+    }
+
     // Collect two bits of input and remove bias using the Von Neumann method.
     // If both bits are the same, then discard both.  Otherwise choose one
     // of the bits and output that one.  We have to do this carefully so that
     // instruction timing does not reveal the value of the bit that is chosen.
-    uint8_t bit = ((threshold - value) >> 15) & 1; // Subtract and extract sign.
     if (count & 1) {
         if (prevBit ^ bit) {
             // The bits are different: add the new bit to the buffer.
@@ -191,11 +443,16 @@ void TransistorNoiseSource::stir()
 
     // Keep a count of the number of raw 1 bits.
     ones += bit;
+    ++count;
+    return true;
+}
 
-    // Bail out if we haven't collected enough samples for a full bucket yet.
-    if (++count < SAMPLES_NUM)
-        return;
-
+/**
+ * \internal
+ * \brief Evaluates a full bucket of samples and adjusts the threshold.
+ */
+void TransistorNoiseSource::finishBucket()
+{
     // If the maximum minus the minimum is too small, then there probably
     // is no signal or the input voltage is insufficient to generate noise.
     // Discard the entire bucket and return to calibration.
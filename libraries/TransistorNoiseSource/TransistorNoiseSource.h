@@ -36,6 +36,10 @@ public:
 
     void stir();
 
+    bool startSampling();
+    void stopSampling();
+    bool isSampling() const { return sampling; }
+
 private:
     int threshold;
     uint8_t _pin;
@@ -48,8 +52,13 @@ private:
     int maxValue;
     int count;
     int ones;
+    bool sampling;
 
     void restart();
+    bool addBit(uint8_t bit);
+    void addValue(int value);
+    void finishBucket();
+    void stirSamples();
 };
 
 #endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "WatchdogNoiseSource.h"
+#include "Crypto.h"
+#include "RNG.h"
+#include "PowerSave.h"
+#include <Arduino.h>
+
+/**
+ * \class WatchdogNoiseSource WatchdogNoiseSource.h <WatchdogNoiseSource.h>
+ * \brief Processes the jitter between the watchdog oscillator and the
+ * main clock as a noise source.
+ *
+ * This class needs no external components, which makes it useful on boards
+ * that have no spare analog input for TransistorNoiseSource and no spare
+ * timer for RingOscillatorNoiseSource.  The watchdog timer on AVR devices
+ * runs from its own 128kHz RC oscillator, which drifts and jitters relative
+ * to the crystal that drives the CPU.  On every watchdog interrupt the class
+ * samples the low byte of Timer0, which the Arduino core is already running
+ * for millis(), and stirs the samples into the random number pool.
+ *
+ * The watchdog interrupt is shared with the \ref power_save "PowerSave"
+ * functions by way of setWatchdogTick().  Sampling is paused while the
+ * application sleeps with sleepFor(), idleFor() or sleepUntil(), and resumes
+ * when they return.  The watchdog fires about 64 times a second and each
+ * sample is credited with 1 bit of entropy, so this noise source provides
+ * about 64 bits of entropy per second.  The system will have enough entropy
+ * to generate 256 bits of key material about 4 seconds after startup.
+ *
+ * \note The quality of the jitter depends upon the board and its operating
+ * conditions.  Timer0 only counts once every 64 CPU cycles, so the jitter
+ * needs to be larger than that to be useful.  The samples are checked with
+ * the continuous health tests, but the output of this class must still be
+ * whitened with \link RNGClass RNG\endlink before it is used for
+ * cryptography.  A transistor noise source is usually the better option
+ * when the board can accommodate it.
+ *
+ * The example below shows how to initialize the noise source and use it
+ * with \link RNGClass RNG\endlink:
+ *
+ * \code
+ * #include <Crypto.h>
+ * #include <RNG.h>
+ * #include <PowerSave.h>
+ * #include <WatchdogNoiseSource.h>
+ *
+ * // Noise source to seed the random number generator.
+ * WatchdogNoiseSource noise;
+ *
+ * void setup() {
+ *     // Initialize the random number generator with the application tag
+ *     // "MyApp 1.0" and load the previous seed from EEPROM address 500.
+ *     RNG.begin("MyApp 1.0", 500);
+ *
+ *     // Add the noise source to the list of sources known to RNG.
+ *     // This starts the background sampling from the watchdog interrupt.
+ *     RNG.addNoiseSource(noise);
+ *
+ *     // ...
+ * }
+ *
+ * void loop() {
+ *     // ...
+ *
+ *     // Perform regular housekeeping on the random number generator.
+ *     RNG.loop();
+ *
+ *     // ...
+ * }
+ * \endcode
+ *
+ * Only one WatchdogNoiseSource can be active at a time, and the application
+ * cannot use setWatchdogTick() for its own purposes while it is active.
+ *
+ * \sa \link RNGClass RNG\endlink, NoiseSource, TransistorNoiseSource,
+ * RingOscillatorNoiseSource, setWatchdogTick()
+ */
+
+// Calibration states.
+#define NOISE_NOT_CALIBRATING   0
+#define NOISE_CALIBRATING       1
+
+// Number of samples that can be buffered by the watchdog interrupt.
+#define WATCHDOG_SAMPLES        16
+
+// If there is no watchdog sample for this many milliseconds, then assume
+// that the watchdog ticks have been stopped.
+#define WATCHDOG_DISCONNECT_TIME    200
+
+static uint8_t volatile wdtSamples[WATCHDOG_SAMPLES];
+static uint8_t volatile wdtCount = 0;
+
+// Called from the watchdog interrupt to record the skew between the
+// watchdog oscillator and the main clock.  If the buffer overflows,
+// we discard samples until stir() catches up.
+static void watchdogSample()
+{
+    uint8_t count = wdtCount;
+    if (count < WATCHDOG_SAMPLES) {
+        wdtSamples[count] = TCNT0;
+        wdtCount = count + 1;
+    }
+}
+
+/**
+ * \brief Constructs a new watchdog jitter noise source.
+ *
+ * Sampling does not start until the noise source is added to
+ * \link RNGClass RNG\endlink with
+ * \link RNGClass::addNoiseSource() RNG.addNoiseSource()\endlink.
+ */
+WatchdogNoiseSource::WatchdogNoiseSource()
+    : calState(NOISE_CALIBRATING)
+    , lastSignal(0)
+{
+    // Each sample is credited with 1 bit of entropy, so use the health
+    // test cutoffs for a min-entropy of 1 bit per sample.
+    setHealthCutoffs(21, 589);
+
+    // Initialize the sample collection routines.
+    restart();
+}
+
+WatchdogNoiseSource::~WatchdogNoiseSource()
+{
+    // Stop the watchdog ticks and clean up.
+    setWatchdogTick(0);
+    restart();
+}
+
+bool WatchdogNoiseSource::calibrating() const
+{
+    return calState == NOISE_CALIBRATING;
+}
+
+void WatchdogNoiseSource::stir()
+{
+    // Copy the samples out of the interrupt buffer.  Turn off interrupts
+    // while we read the buffer and reset "wdtCount".
+    unsigned long now = millis();
+    uint8_t raw[WATCHDOG_SAMPLES];
+    cli();
+    uint8_t count = wdtCount;
+    for (uint8_t index = 0; index < count; ++index)
+        raw[index] = wdtSamples[index];
+    wdtCount = 0;
+    sei();
+
+    if (!count) {
+        // If it has been too long since the last sample, then go back
+        // to calibrating.  The watchdog ticks may have been stopped.
+        if (calState == NOISE_NOT_CALIBRATING) {
+            if ((now - lastSignal) >= WATCHDOG_DISCONNECT_TIME) {
+                restart();
+                calState = NOISE_CALIBRATING;
+            }
+        }
+        return;
+    }
+    lastSignal = now;
+
+    for (uint8_t index = 0; index < count; ++index) {
+        // Run the continuous health tests on the raw samples.  If they fail,
+        // then the watchdog may have locked to the main clock.  Discard the
+        // samples that we have collected and recalibrate.
+        if (!healthTest(raw[index])) {
+            restart();
+            calState = NOISE_CALIBRATING;
+            continue;
+        }
+
+        // Add the sample to the buffer.  Once the buffer is full, stir it
+        // into the random number pool with 1 bit of credit per sample.
+        buffer[posn++] = raw[index];
+        if (posn >= sizeof(buffer)) {
+            output(buffer, posn, posn);
+            restart();
+            calState = NOISE_NOT_CALIBRATING;
+        }
+    }
+    clean(raw);
+}
+
+/**
+ * \brief Starts sampling the watchdog jitter in the background.
+ */
+void WatchdogNoiseSource::added()
+{
+    restart();
+    cli();
+    wdtCount = 0;
+    sei();
+    lastSignal = millis();
+    setWatchdogTick(watchdogSample);
+}
+
+/**
+ * \brief Restarts the sample collection process.
+ */
+void WatchdogNoiseSource::restart()
+{
+    clean(buffer);
+    posn = 0;
+}
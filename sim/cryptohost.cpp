@@ -0,0 +1,692 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Host build, test vectors, and benchmarks for the Crypto library.
+//
+// The Makefile in this directory builds the library as a static archive
+// in obj/libcrypto.a and links this program against it:
+//
+//   make cryptohost
+//
+// Usage: cryptohost check
+//        cryptohost bench
+//
+// "make check" runs "cryptohost check" and also builds every Test sketch
+// in libraries/Crypto/examples unchanged with sketchhost.cpp and runs it.
+//
+// On x86 hosts ChaCha::hashCore2() uses SSE2, SHA256 uses the SHA
+// extensions or an SSE2 message schedule, and KeccakCore uses AVX-512
+// when the processor has it.  Add -DCRYPTO_CHACHA_SSE2=0,
+// -DCRYPTO_SHA256_SSE2=0, or -DCRYPTO_KECCAK_AVX512=0 to CXXFLAGS to
+// build without them.
+//
+// "check" runs the RFC and FIPS test vectors for SHA256, SHA3-256,
+// ChaCha20, Poly1305, ChaChaPoly, and Curve25519.  It compares every
+// SHA256 and KeccakCore implementation that the host supports against
+// the portable one for random messages of every length up to 300 bytes,
+// using SHA3-256 and SHAKE128 output for KeccakCore.  It also compares
+// ChaCha::hashCore2() against two calls to the scalar ChaCha::hashCore()
+// for random inputs.  The counters include those where the low word
+// carries into the high word and those where the 64-bit counter wraps.
+// ChaCha::encrypt() is compared with a keystream built from hashCore() in
+// the same way.  The exit status is non-zero if any check fails.
+//
+// "bench" times each primitive and prints comma-separated values with one
+// line per operation, like the BenchmarkCrypto example.  "hashCore x2" and
+// "hashCore2" process the same two blocks, so their ratio is the speedup
+// of the two-block core over the scalar single-block core.  SHA256 and
+// SHA3-256 are timed with each implementation that the host supports.
+
+#include <Arduino.h>
+#include <Crypto.h>
+#include <SHA256.h>
+#include <SHA3.h>
+#include <SHAKE.h>
+#include <KeccakCore.h>
+#include <ChaCha.h>
+#include <ChaChaPoly.h>
+#include <Poly1305.h>
+#include <Curve25519.h>
+#include <avr/eeprom.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#if !defined(CRYPTO_CHACHA_SSE2)
+#if defined(__SSE2__)
+#define CRYPTO_CHACHA_SSE2 1
+#else
+#define CRYPTO_CHACHA_SSE2 0
+#endif
+#endif
+
+// Simulated pins and EEPROM for the parts of the library that use them.
+uint8_t simPorts[SIM_NUM_PORTS];
+static uint8_t eeprom[4096];
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (value)
+        *portOutputRegister(digitalPinToPort(pin)) |= digitalPinToBitMask(pin);
+    else
+        *portOutputRegister(digitalPinToPort(pin)) &= ~digitalPinToBitMask(pin);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (*portOutputRegister(digitalPinToPort(pin)) &
+            digitalPinToBitMask(pin)) != 0;
+}
+
+static std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(unsigned long)
+{
+}
+
+void delayMicroseconds(unsigned int)
+{
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return eeprom[(uintptr_t)addr % sizeof(eeprom)];
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom[(uintptr_t)addr % sizeof(eeprom)] = value;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom[(uintptr_t)addr % sizeof(eeprom)] = value;
+}
+
+// RFC 8439 test vectors for ChaCha20, Poly1305, and ChaCha20-Poly1305.
+static char const sunscreen[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only "
+    "one tip for the future, sunscreen would be it.";
+static uint8_t const chachaCiphertext[] = {
+    0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80,
+    0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+    0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2,
+    0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+    0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab,
+    0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+    0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab,
+    0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+    0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61,
+    0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+    0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06,
+    0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+    0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6,
+    0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+    0x87, 0x4d
+};
+static uint8_t const aeadCiphertext[] = {
+    0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb,
+    0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+    0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe,
+    0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+    0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12,
+    0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+    0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29,
+    0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+    0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c,
+    0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+    0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94,
+    0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+    0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d,
+    0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+    0x61, 0x16
+};
+static uint8_t const aeadTag[] = {
+    0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a,
+    0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91
+};
+
+static int failures;
+
+static void check(const char *name, bool ok)
+{
+    printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok)
+        ++failures;
+}
+
+static bool parseHex(uint8_t *out, const char *hex, size_t len)
+{
+    for (size_t posn = 0; posn < len; ++posn) {
+        unsigned value;
+        if (sscanf(hex + posn * 2, "%2x", &value) != 1)
+            return false;
+        out[posn] = (uint8_t)value;
+    }
+    return true;
+}
+
+static bool equalHex(const uint8_t *data, const char *hex, size_t len)
+{
+    uint8_t expected[64];
+    return parseHex(expected, hex, len) && !memcmp(data, expected, len);
+}
+
+// Simple deterministic generator for the random comparison inputs.
+static uint32_t randomState = 0x12345678;
+
+static uint32_t nextRandom()
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void checkSHA256()
+{
+    SHA256 sha256;
+    uint8_t hash[32];
+
+    sha256.update("abc", 3);
+    sha256.finalize(hash, sizeof(hash));
+    check("SHA256 abc", equalHex(hash,
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", 32));
+
+    sha256.reset();
+    sha256.update("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+    sha256.finalize(hash, sizeof(hash));
+    check("SHA256 448-bit", equalHex(hash,
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", 32));
+}
+
+// Names of the SHA256 and KeccakCore implementations, indexed by the
+// Implementation enums.
+static const char *const sha256Names[] = {"portable", "SSE2", "hardware"};
+static const char *const keccakNames[] = {"portable", "AVX-512"};
+
+static void checkSHA256Kernels()
+{
+    SHA256 sha256;
+    static uint8_t message[300];
+    uint8_t expected[32];
+    uint8_t actual[32];
+    char name[64];
+
+    for (size_t posn = 0; posn < sizeof(message); ++posn)
+        message[posn] = (uint8_t)nextRandom();
+
+    SHA256::Implementation saved = SHA256::implementation();
+    for (int impl = SHA256::Vector; impl <= SHA256::Hardware; ++impl) {
+        snprintf(name, sizeof(name), "SHA256 %s vs portable", sha256Names[impl]);
+        if (!SHA256::setImplementation((SHA256::Implementation)impl)) {
+            printf("%s: not available\n", name);
+            continue;
+        }
+
+        // Every length up to 300 bytes covers one to six chunks and
+        // both ways of padding the last one.
+        bool ok = true;
+        for (size_t len = 0; len <= sizeof(message); ++len) {
+            SHA256::setImplementation(SHA256::Portable);
+            sha256.reset();
+            sha256.update(message, len);
+            sha256.finalize(expected, sizeof(expected));
+            SHA256::setImplementation((SHA256::Implementation)impl);
+            sha256.reset();
+            sha256.update(message, len);
+            sha256.finalize(actual, sizeof(actual));
+            if (memcmp(actual, expected, sizeof(actual)) != 0) {
+                printf("SHA256 %s mismatch: length %u\n",
+                       sha256Names[impl], (unsigned)len);
+                ok = false;
+            }
+        }
+        check(name, ok);
+    }
+    SHA256::setImplementation(saved);
+}
+
+static void checkSHA3()
+{
+    SHA3_256 sha3;
+    uint8_t hash[32];
+
+    sha3.update("abc", 3);
+    sha3.finalize(hash, sizeof(hash));
+    check("SHA3-256 abc", equalHex(hash,
+        "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532", 32));
+}
+
+// Hashes "message" with SHA3-256 and then squeezes "output" from SHAKE128,
+// so that the permutation is used for absorbing, padding, and extracting.
+static void keccakOutputs(uint8_t *hash, uint8_t *output, size_t outLen,
+                          const uint8_t *message, size_t len)
+{
+    SHA3_256 sha3;
+    SHAKE128 shake;
+
+    sha3.update(message, len);
+    sha3.finalize(hash, 32);
+    shake.update(message, len);
+    shake.extract(output, outLen);
+}
+
+static void checkKeccakKernels()
+{
+    static uint8_t message[300];
+    static uint8_t expected[32 + 500];
+    static uint8_t actual[sizeof(expected)];
+    char name[64];
+
+    for (size_t posn = 0; posn < sizeof(message); ++posn)
+        message[posn] = (uint8_t)nextRandom();
+
+    KeccakCore::Implementation saved = KeccakCore::implementation();
+    snprintf(name, sizeof(name), "Keccak %s vs portable",
+             keccakNames[KeccakCore::Vector]);
+    if (!KeccakCore::setImplementation(KeccakCore::Vector)) {
+        printf("%s: not available\n", name);
+        return;
+    }
+    bool ok = true;
+    for (size_t len = 0; len <= sizeof(message); ++len) {
+        KeccakCore::setImplementation(KeccakCore::Portable);
+        keccakOutputs(expected, expected + 32, sizeof(expected) - 32,
+                      message, len);
+        KeccakCore::setImplementation(KeccakCore::Vector);
+        keccakOutputs(actual, actual + 32, sizeof(actual) - 32,
+                      message, len);
+        if (memcmp(actual, expected, sizeof(actual)) != 0) {
+            printf("Keccak %s mismatch: length %u\n",
+                   keccakNames[KeccakCore::Vector], (unsigned)len);
+            ok = false;
+        }
+    }
+    check(name, ok);
+    KeccakCore::setImplementation(saved);
+}
+
+static void checkChaCha()
+{
+    ChaCha chacha;
+    uint8_t key[32];
+    uint8_t nonce[12];
+    uint8_t counter[4] = {1, 0, 0, 0};
+    uint8_t output[sizeof(sunscreen) - 1];
+
+    for (uint8_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = posn;
+    parseHex(nonce, "000000000000004a00000000", sizeof(nonce));
+    chacha.setKey(key, sizeof(key));
+    chacha.setIV(nonce, sizeof(nonce));
+    chacha.setCounter(counter, sizeof(counter));
+    chacha.encrypt(output, (const uint8_t *)sunscreen, sizeof(output));
+    check("ChaCha20 RFC 8439",
+          !memcmp(output, chachaCiphertext, sizeof(output)));
+}
+
+static void checkPoly1305()
+{
+    Poly1305 poly1305;
+    uint8_t key[32];
+    uint8_t tag[16];
+
+    parseHex(key, "85d6be7857556d337f4452fe42d506a8"
+                  "0103808afb0db2fd4abff6af4149f51b", sizeof(key));
+    poly1305.reset(key);
+    poly1305.update("Cryptographic Forum Research Group", 34);
+    poly1305.finalize(key + 16, tag, sizeof(tag));
+    check("Poly1305 RFC 8439",
+          equalHex(tag, "a8061dc1305136c6c22b8baf0c0127a9", sizeof(tag)));
+}
+
+static void checkChaChaPoly()
+{
+    ChaChaPoly aead;
+    uint8_t key[32];
+    uint8_t iv[12];
+    uint8_t ad[12];
+    uint8_t output[sizeof(sunscreen) - 1];
+    uint8_t tag[16];
+
+    for (uint8_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = 0x80 + posn;
+    parseHex(iv, "070000004041424344454647", sizeof(iv));
+    parseHex(ad, "50515253c0c1c2c3c4c5c6c7", sizeof(ad));
+    aead.setKey(key, sizeof(key));
+    aead.setIV(iv, sizeof(iv));
+    aead.addAuthData(ad, sizeof(ad));
+    aead.encrypt(output, (const uint8_t *)sunscreen, sizeof(output));
+    aead.computeTag(tag, sizeof(tag));
+    check("ChaChaPoly RFC 8439",
+          !memcmp(output, aeadCiphertext, sizeof(output)) &&
+          !memcmp(tag, aeadTag, sizeof(tag)));
+
+    aead.setKey(key, sizeof(key));
+    aead.setIV(iv, sizeof(iv));
+    aead.addAuthData(ad, sizeof(ad));
+    aead.decrypt(output, aeadCiphertext, sizeof(output));
+    bool ok = !memcmp(output, sunscreen, sizeof(output)) &&
+              aead.checkTag(aeadTag, sizeof(aeadTag));
+    tag[0] ^= 0x01;
+    aead.setKey(key, sizeof(key));
+    aead.setIV(iv, sizeof(iv));
+    aead.addAuthData(ad, sizeof(ad));
+    aead.decrypt(output, aeadCiphertext, sizeof(output));
+    ok = ok && !aead.checkTag(tag, sizeof(tag));
+    check("ChaChaPoly RFC 8439 decrypt", ok);
+}
+
+// Clamps a Curve25519 scalar as described in RFC 7748.
+static void clampScalar(uint8_t *scalar)
+{
+    scalar[0] &= 0xF8;
+    scalar[31] = (scalar[31] & 0x7F) | 0x40;
+}
+
+static void checkCurve25519()
+{
+    uint8_t scalar[32];
+    uint8_t point[32];
+    uint8_t result[32];
+
+    // RFC 7748, section 5.2.
+    parseHex(scalar, "a546e36bf0527c9d3b16154b82465edd"
+                     "62144c0ac1fc5a18506a2244ba449ac4", 32);
+    clampScalar(scalar);
+    parseHex(point, "e6db6867583030db3594c1a424b15f7c"
+                    "726624ec26b3353b10a903a6d0ab1c4c", 32);
+    bool ok = Curve25519::eval(result, scalar, point) && equalHex(result,
+        "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552", 32);
+    parseHex(scalar, "4b66e9d4d1b4673c5ad22691957d6af5"
+                     "c11b6421e0ea01d42ca4169e7918ba0d", 32);
+    clampScalar(scalar);
+    parseHex(point, "e5210f12786811d3f4b7959d0538ae2c"
+                    "31dbe7106fc03c3efc4cd549c715a493", 32);
+    ok = ok && Curve25519::eval(result, scalar, point) && equalHex(result,
+        "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957", 32);
+    check("Curve25519 RFC 7748", ok);
+
+    // RFC 7748, section 6.1: Alice's public key.
+    parseHex(scalar, "77076d0a7318a57d3c16c17251b26645"
+                     "df4c2f87ebc0992ab177fba51db92c2a", 32);
+    clampScalar(scalar);
+    ok = Curve25519::eval(result, scalar, 0) && equalHex(result,
+        "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a", 32);
+    check("Curve25519 RFC 7748 base point", ok);
+}
+
+// Counters that exercise the carry from word 12 into word 13.
+static const uint32_t counterWords[][2] = {
+    {0x00000000, 0x00000000},
+    {0xFFFFFFFE, 0x00000000},
+    {0xFFFFFFFF, 0x00000000},
+    {0xFFFFFFFF, 0x12345678},
+    {0xFFFFFFFF, 0xFFFFFFFF}
+};
+#define NUM_COUNTERS (sizeof(counterWords) / sizeof(counterWords[0]))
+
+static void checkHashCore2()
+{
+    static const uint8_t roundCounts[] = {8, 12, 20};
+    uint32_t input[16];
+    uint32_t next[16];
+    uint32_t expected[32];
+    uint32_t output[32];
+    bool ok = true;
+
+    for (unsigned trial = 0; trial < 1000; ++trial) {
+        for (uint8_t posn = 0; posn < 16; ++posn)
+            input[posn] = nextRandom();
+        if (trial < NUM_COUNTERS) {
+            input[12] = htole32(counterWords[trial][0]);
+            input[13] = htole32(counterWords[trial][1]);
+        }
+        uint64_t counter = ((uint64_t)le32toh(input[13]) << 32) |
+                           le32toh(input[12]);
+        memcpy(next, input, sizeof(next));
+        next[12] = htole32((uint32_t)(counter + 1));
+        next[13] = htole32((uint32_t)((counter + 1) >> 32));
+        for (uint8_t r = 0; r < sizeof(roundCounts); ++r) {
+            ChaCha::hashCore(expected, input, roundCounts[r]);
+            ChaCha::hashCore(expected + 16, next, roundCounts[r]);
+            ChaCha::hashCore2(output, input, roundCounts[r]);
+            if (memcmp(output, expected, sizeof(output)) != 0) {
+                printf("hashCore2 mismatch: trial %u, %d rounds\n",
+                       trial, roundCounts[r]);
+                ok = false;
+            }
+        }
+    }
+    check(CRYPTO_CHACHA_SSE2 ? "ChaCha hashCore2 SSE2 vs scalar"
+                             : "ChaCha hashCore2 vs scalar", ok);
+}
+
+static void checkChaChaStream()
+{
+    ChaCha chacha;
+    uint8_t key[32];
+    uint8_t iv[8];
+    uint8_t counterBytes[8];
+    uint32_t block[16];
+    uint32_t keystream[16];
+    static uint8_t input[1000];
+    static uint8_t output[sizeof(input)];
+    bool ok = true;
+
+    for (uint8_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)nextRandom();
+    for (uint8_t posn = 0; posn < sizeof(iv); ++posn)
+        iv[posn] = (uint8_t)nextRandom();
+    for (size_t posn = 0; posn < sizeof(input); ++posn)
+        input[posn] = (uint8_t)nextRandom();
+
+    for (unsigned c = 0; c < NUM_COUNTERS; ++c) {
+        uint64_t counter = ((uint64_t)counterWords[c][1] << 32) |
+                           counterWords[c][0];
+        for (uint8_t posn = 0; posn < 8; ++posn)
+            counterBytes[posn] = (uint8_t)(counter >> (posn * 8));
+
+        // Encrypt in odd-sized pieces to mix partial and whole blocks.
+        chacha.setKey(key, sizeof(key));
+        chacha.setIV(iv, sizeof(iv));
+        chacha.setCounter(counterBytes, sizeof(counterBytes));
+        size_t done = 0;
+        size_t piece = 1;
+        while (done < sizeof(input)) {
+            size_t len = sizeof(input) - done;
+            if (len > piece)
+                len = piece;
+            chacha.encrypt(output + done, input + done, len);
+            done += len;
+            piece = piece * 3 + 1;
+        }
+
+        // Build the expected keystream one block at a time.
+        memcpy(block, "expand 32-byte k", 16);
+        memcpy(block + 4, key, sizeof(key));
+        memcpy(block + 14, iv, sizeof(iv));
+        for (size_t posn = 0; posn < sizeof(input); posn += 64) {
+            block[12] = htole32((uint32_t)counter);
+            block[13] = htole32((uint32_t)(counter >> 32));
+            ChaCha::hashCore(keystream, block, 20);
+            for (size_t i = 0; i < 64 && (posn + i) < sizeof(input); ++i) {
+                if (output[posn + i] !=
+                        (input[posn + i] ^ ((const uint8_t *)keystream)[i]))
+                    ok = false;
+            }
+            ++counter;
+        }
+    }
+    check("ChaCha encrypt vs scalar keystream", ok);
+}
+
+static int runChecks()
+{
+    failures = 0;
+    checkSHA256();
+    checkSHA256Kernels();
+    checkSHA3();
+    checkKeccakKernels();
+    checkChaCha();
+    checkPoly1305();
+    checkChaChaPoly();
+    checkCurve25519();
+    checkHashCore2();
+    checkChaChaStream();
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
+
+// Times "func" until at least 200ms have elapsed and prints the average.
+template <typename Func>
+static void bench(const char *name, size_t bytes, Func func)
+{
+    typedef std::chrono::steady_clock clock;
+    unsigned long count = 0;
+    clock::time_point start = clock::now();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < 16; ++i)
+            func();
+        count += 16;
+        elapsed = std::chrono::duration<double, std::nano>
+            (clock::now() - start).count();
+    } while (elapsed < 200e6);
+    double ns = elapsed / count;
+    printf("%s,%lu,%.1f,%.1f\n", name, (unsigned long)bytes, ns,
+           bytes ? (bytes * 1000.0 / ns) : 0.0);
+}
+
+static int runBenchmarks()
+{
+    static uint8_t buffer[1024];
+    static uint32_t block[16];
+    static uint32_t next[16];
+    static uint32_t output[32];
+    static uint8_t key[32];
+    static uint8_t tag[16];
+    static uint8_t point[32];
+    char name[64];
+    SHA256 sha256;
+    SHA3_256 sha3;
+    ChaCha chacha;
+    Poly1305 poly1305;
+    ChaChaPoly aead;
+
+    for (size_t posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (uint8_t)posn;
+    for (uint8_t posn = 0; posn < 16; ++posn)
+        block[posn] = next[posn] = nextRandom();
+    next[12] = block[12] + 1;
+    for (uint8_t posn = 0; posn < sizeof(key); ++posn)
+        key[posn] = (uint8_t)nextRandom();
+    chacha.setKey(key, sizeof(key));
+    chacha.setIV(key, 8);
+    aead.setKey(key, sizeof(key));
+    aead.setIV(key, 12);
+
+    printf("operation,bytes_per_call,ns_per_call,mb_per_sec\n");
+    fprintf(stderr, "ChaCha hashCore2 is %s\n",
+            CRYPTO_CHACHA_SSE2 ? "SSE2" : "scalar");
+    fprintf(stderr, "SHA256 is %s, Keccak is %s\n",
+            sha256Names[SHA256::implementation()],
+            keccakNames[KeccakCore::implementation()]);
+    bench("SHA256 update 1K", sizeof(buffer), [&]() {
+        sha256.update(buffer, sizeof(buffer));
+    });
+    bench("SHA256 finalize", 0, [&]() {
+        sha256.reset();
+        sha256.finalize(tag, sizeof(tag));
+    });
+    SHA256::Implementation sha256Default = SHA256::implementation();
+    for (int impl = SHA256::Portable; impl <= SHA256::Hardware; ++impl) {
+        if (!SHA256::setImplementation((SHA256::Implementation)impl))
+            continue;
+        snprintf(name, sizeof(name), "SHA256 update 1K %s", sha256Names[impl]);
+        bench(name, sizeof(buffer), [&]() {
+            sha256.update(buffer, sizeof(buffer));
+        });
+    }
+    SHA256::setImplementation(sha256Default);
+    KeccakCore::Implementation keccakDefault = KeccakCore::implementation();
+    for (int impl = KeccakCore::Portable; impl <= KeccakCore::Vector; ++impl) {
+        if (!KeccakCore::setImplementation((KeccakCore::Implementation)impl))
+            continue;
+        snprintf(name, sizeof(name), "SHA3-256 update 1K %s", keccakNames[impl]);
+        bench(name, sizeof(buffer), [&]() {
+            sha3.update(buffer, sizeof(buffer));
+        });
+    }
+    KeccakCore::setImplementation(keccakDefault);
+    bench("ChaCha20 hashCore x2", 128, [&]() {
+        ChaCha::hashCore(output, block, 20);
+        ChaCha::hashCore(output + 16, next, 20);
+    });
+    bench("ChaCha20 hashCore2", 128, [&]() {
+        ChaCha::hashCore2(output, block, 20);
+    });
+    bench("ChaCha20 encrypt 1K", sizeof(buffer), [&]() {
+        chacha.encrypt(buffer, buffer, sizeof(buffer));
+    });
+    bench("Poly1305 update 1K", sizeof(buffer), [&]() {
+        poly1305.update(buffer, sizeof(buffer));
+    });
+    bench("ChaChaPoly encrypt 1K", sizeof(buffer), [&]() {
+        aead.encrypt(buffer, buffer, sizeof(buffer));
+    });
+    bench("Curve25519 eval", 0, [&]() {
+        Curve25519::eval(point, key, 0);
+    });
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && !strcmp(argv[1], "check"))
+        return runChecks();
+    if (argc == 2 && !strcmp(argv[1], "bench"))
+        return runBenchmarks();
+    fprintf(stderr, "Usage: %s check\n", argv[0]);
+    fprintf(stderr, "       %s bench\n", argv[0]);
+    return 1;
+}
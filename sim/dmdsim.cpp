@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Host-side simulator and benchmark suite for Bitmap and DMD.
+//
+// Build from this directory with "make dmdsim", which runs:
+//
+//   g++ -O2 -std=gnu++11 -DARDUINO=100 -Istub -I../libraries/DMD -o dmdsim dmdsim.cpp
+//       ../libraries/DMD/Bitmap.cpp ../libraries/DMD/DMD.cpp
+//       ../libraries/DMD/DisplayList.cpp
+//
+// Usage: dmdsim check
+//        dmdsim bench
+//        dmdsim frames directory
+//
+// The stubs in "stub" replace the Arduino core, PROGMEM, the digital pins
+// and the SPI data register.  Each byte that DMD::refresh() writes to SPDR
+// is shifted into a simulated chain of panels, and the chain is decoded
+// back into pixels using the phase that refresh() selects on the A and B
+// pins.  After four refreshes the decoded image is what the panels show.
+//
+// "check" draws a test scene into displays of several sizes, with and
+// without double buffering and the wire-order shadow buffer, and compares
+// the decoded panels with the frame buffer.  The exit status is non-zero
+// if any of them differ, so it can be run automatically after changes to
+// the rendering code.
+//
+// "bench" times each drawing primitive and a full refresh cycle for a
+// range of panel counts and prints comma-separated values with one line
+// per operation, like the BenchmarkCrypto example.  The times are for the
+// host CPU, so only compare results from the same machine; the number of
+// SPI bytes per refresh is exact.
+//
+// "frames" renders a short animation and writes what the panels show
+// as PBM images that can be viewed or converted with netpbm tools.
+
+#include <Arduino.h>
+#include <DMD.h>
+#include <DisplayList.h>
+#include <DejaVuSans9.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+// Pins on the DMD connector board that select the phase.
+#define PIN_PHASE_LSB   6
+#define PIN_PHASE_MSB   7
+
+// Simulated registers and pins.
+uint8_t simPorts[SIM_NUM_PORTS];
+SimSPI SPDR;
+uint8_t SPSR = _BV(SPIF);
+uint8_t SPCR, SREG;
+uint8_t TCCR1A, TCCR1B, TIMSK1;
+uint8_t TCCR2A, TCCR2B, TCNT2, TIMSK2;
+uint16_t ICR1;
+
+// Bytes that have been shifted into the chain of panels since the
+// last call to startRefresh().
+static std::vector<uint8_t> chain;
+static unsigned long spiBytes;
+
+SimSPI &SimSPI::operator=(uint8_t value)
+{
+    chain.push_back(value);
+    ++spiBytes;
+    return *this;
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (value)
+        *portOutputRegister(digitalPinToPort(pin)) |= digitalPinToBitMask(pin);
+    else
+        *portOutputRegister(digitalPinToPort(pin)) &= ~digitalPinToBitMask(pin);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (*portOutputRegister(digitalPinToPort(pin)) &
+            digitalPinToBitMask(pin)) != 0;
+}
+
+static std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(unsigned long)
+{
+}
+
+void delayMicroseconds(unsigned int)
+{
+}
+
+// Reverses the bits in a byte, for panels that are upside-down.
+static uint8_t flipBits(uint8_t value)
+{
+    uint8_t result = 0;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (value & (1 << bit))
+            result |= 0x80 >> bit;
+    }
+    return result;
+}
+
+// Decodes the bytes for one phase of a refresh into the rows of the
+// panels, in the same layout as Bitmap.  This mirrors the order in which
+// DMD::refresh() sends the bytes, with alternate rows of panels rotated.
+static void decodePhase(const uint8_t *wire, int phase, int stride,
+                        int height, uint8_t *panels)
+{
+    int stride4 = stride * 4;
+    bool flipRow = ((height & 0x10) == 0);
+    for (int y = 0; y < height; y += 16) {
+        if (!flipRow) {
+            uint8_t *data0 = panels + stride * (y + phase);
+            for (int x = 0; x < stride; ++x) {
+                data0[x + stride4 * 3] = *wire++;
+                data0[x + stride4 * 2] = *wire++;
+                data0[x + stride4] = *wire++;
+                data0[x] = *wire++;
+            }
+        } else {
+            uint8_t *data0 = panels + stride * (y + 16 - phase) - 1;
+            for (int x = 0; x < stride; ++x) {
+                data0[-x - stride4 * 3] = flipBits(*wire++);
+                data0[-x - stride4 * 2] = flipBits(*wire++);
+                data0[-x - stride4] = flipBits(*wire++);
+                data0[-x] = flipBits(*wire++);
+            }
+        }
+        flipRow = !flipRow;
+    }
+}
+
+// Runs a full refresh cycle of four phases and decodes what the panels
+// show into "panels".  Returns false if a refresh sent the wrong amount
+// of data or skipped a phase.
+static bool capture(DMD &display, std::vector<uint8_t> &panels)
+{
+    int stride = display.stride();
+    int height = display.height();
+    size_t size = (size_t)(stride * height / 4);
+    panels.assign(stride * height, 0xFF);
+    uint8_t seen = 0;
+    for (int count = 0; count < 4; ++count) {
+        chain.clear();
+        display.refresh();
+        if (chain.size() < size)
+            return false;
+        int phase = digitalRead(PIN_PHASE_LSB) |
+                    (digitalRead(PIN_PHASE_MSB) << 1);
+        seen |= 1 << phase;
+        decodePhase(chain.data() + chain.size() - size, phase,
+                    stride, height, panels.data());
+    }
+    return seen == 0x0F;
+}
+
+// Writes the panel contents as a raw PBM image, with lit LEDs in black.
+static bool writePBM(const char *filename, const std::vector<uint8_t> &panels,
+                     int width, int height)
+{
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+        return false;
+    fprintf(file, "P4\n%d %d\n", width, height);
+    for (size_t index = 0; index < panels.size(); ++index)
+        fputc(panels[index] ^ 0xFF, file);
+    fclose(file);
+    return true;
+}
+
+// Running figure from the RunningFigure example.
+static byte const figure[] PROGMEM = {
+    16, 16,
+    0x00, 0x0C,
+    0x00, 0x1E,
+    0x07, 0xFE,
+    0x0F, 0xFE,
+    0x1C, 0xFC,
+    0x01, 0xFC,
+    0x01, 0xF0,
+    0x03, 0xF8,
+    0x07, 0x18,
+    0x0E, 0x70,
+    0x1C, 0x60,
+    0x38, 0x00,
+    0x70, 0x00,
+    0x60, 0x00,
+    0x40, 0x00,
+    0x00, 0x00
+};
+
+// Draws a test scene that depends on "frame" and touches every primitive.
+static void drawScene(Bitmap &bitmap, int frame)
+{
+    int w = bitmap.width();
+    int h = bitmap.height();
+    bitmap.clear();
+    bitmap.drawRect(0, 0, w - 1, h - 1);
+    bitmap.drawLine(0, 0, w - 1, h - 1);
+    bitmap.drawLine(w - 1, 0, 0, h - 1);
+    bitmap.drawCircle(w / 2, h / 2, h / 3);
+    bitmap.drawBitmap((frame * 3) % w, 0, figure);
+    bitmap.setFont(DejaVuSans9);
+    bitmap.drawText(w - ((frame * 2) % (w + 40)), h - 10, "Hello DMD");
+    bitmap.invert(2, 2, 10, 5);
+}
+
+// Checks that the panels show the frame buffer for one display setup.
+static bool checkDisplay(int widthPanels, int heightPanels,
+                         bool doubleBuffer, bool wireOrder)
+{
+    DMD display(widthPanels, heightPanels);
+    const char *mode = doubleBuffer ? "double" : "single";
+    const char *order = wireOrder ? "wire-order" : "direct";
+    display.setDoubleBuffer(doubleBuffer);
+    display.setWireOrder(wireOrder);
+    std::vector<uint8_t> panels;
+    bool ok = true;
+    for (int frame = 0; frame < 3 && ok; ++frame) {
+        drawScene(display, frame);
+        if (doubleBuffer)
+            display.swapBuffersAndCopy();
+        else
+            display.updateWireOrder();
+        size_t size = display.stride() * display.height();
+        std::vector<uint8_t> expected
+            (display.data(), display.data() + size);
+        if (!capture(display, panels) || panels != expected)
+            ok = false;
+    }
+    printf("%dx%d %s %s: %s\n", widthPanels, heightPanels, mode, order,
+           ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static int runChecks()
+{
+    static const int sizes[][2] = {
+        {1, 1}, {2, 1}, {1, 2}, {2, 2}, {4, 3}, {8, 4}
+    };
+    int failures = 0;
+    for (size_t index = 0; index < sizeof(sizes) / sizeof(sizes[0]); ++index) {
+        for (int mode = 0; mode < 4; ++mode) {
+            if (!checkDisplay(sizes[index][0], sizes[index][1],
+                              (mode & 1) != 0, (mode & 2) != 0))
+                ++failures;
+        }
+    }
+    if (failures)
+        printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
+
+// Times calls to "func" and prints a line of CSV for them.
+template <typename Func>
+static void bench(const char *name, int widthPanels, int heightPanels,
+                  Func func)
+{
+    // Run the operation for at least 100 milliseconds.
+    unsigned long count = 0;
+    unsigned long bytes = spiBytes;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        for (int iter = 0; iter < 16; ++iter)
+            func();
+        count += 16;
+        elapsed = std::chrono::duration<double, std::nano>
+            (std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 100000000.0);
+    printf("%s,%dx%d,%.1f,%lu\n", name, widthPanels, heightPanels,
+           elapsed / count, (spiBytes - bytes) / count);
+}
+
+static int runBenchmarks()
+{
+    static const int sizes[][2] = {{1, 1}, {2, 1}, {4, 2}, {8, 4}};
+    printf("operation,panels,ns_per_call,spi_bytes_per_call\n");
+    for (size_t index = 0; index < sizeof(sizes) / sizeof(sizes[0]); ++index) {
+        int wp = sizes[index][0];
+        int hp = sizes[index][1];
+        DMD display(wp, hp);
+        int w = display.width();
+        int h = display.height();
+        display.setFont(DejaVuSans9);
+        bench("clear", wp, hp, [&]() { display.clear(); });
+        bench("drawLine", wp, hp, [&]() { display.drawLine(0, 0, w - 1, h - 1); });
+        bench("drawRect", wp, hp, [&]() { display.drawRect(0, 0, w - 1, h - 1); });
+        bench("drawFilledRect", wp, hp, [&]() { display.drawFilledRect(0, 0, w - 1, h - 1); });
+        bench("drawCircle", wp, hp, [&]() { display.drawCircle(w / 2, h / 2, h / 2 - 1); });
+        bench("drawFilledCircle", wp, hp, [&]() { display.drawFilledCircle(w / 2, h / 2, h / 2 - 1); });
+        bench("drawBitmap", wp, hp, [&]() { display.drawBitmap(5, 0, figure); });
+        bench("drawText", wp, hp, [&]() { display.drawText(0, 0, "Hello World"); });
+        bench("scroll", wp, hp, [&]() { display.scroll(-1, 0); });
+        bench("invert", wp, hp, [&]() { display.invert(0, 0, w, h); });
+        bench("refresh", wp, hp, [&]() {
+            for (int phase = 0; phase < 4; ++phase)
+                display.refresh();
+        });
+        display.setWireOrder(true);
+        if (display.wireOrder()) {
+            bench("updateWireOrder", wp, hp, [&]() {
+                display.markDirty();
+                display.updateWireOrder();
+            });
+            bench("refreshWireOrder", wp, hp, [&]() {
+                for (int phase = 0; phase < 4; ++phase)
+                    display.refresh();
+            });
+        }
+        chain.clear();
+    }
+    return 0;
+}
+
+static int writeFrames(const char *directory)
+{
+    DMD display(2, 2);
+    std::vector<uint8_t> panels;
+    char filename[1024];
+    for (int frame = 0; frame < 32; ++frame) {
+        drawScene(display, frame);
+        if (!capture(display, panels)) {
+            fprintf(stderr, "refresh failed on frame %d\n", frame);
+            return 1;
+        }
+        snprintf(filename, sizeof(filename), "%s/frame%03d.pbm",
+                 directory, frame);
+        if (!writePBM(filename, panels, display.width(), display.height())) {
+            perror(filename);
+            return 1;
+        }
+        chain.clear();
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && !strcmp(argv[1], "check"))
+        return runChecks();
+    if (argc == 2 && !strcmp(argv[1], "bench"))
+        return runBenchmarks();
+    if (argc == 3 && !strcmp(argv[1], "frames"))
+        return writeFrames(argv[2]);
+    fprintf(stderr, "Usage: %s check\n", argv[0]);
+    fprintf(stderr, "       %s bench\n", argv[0]);
+    fprintf(stderr, "       %s frames directory\n", argv[0]);
+    return 1;
+}
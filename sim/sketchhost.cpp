@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Runs an Arduino example sketch on the host.
+//
+// The sketch is compiled unchanged as C++ with Arduino.h included first,
+// as the Arduino IDE does, and linked with this file and the library it
+// uses.  The Makefile in this directory does this for every Test sketch
+// in libraries/Crypto/examples:
+//
+//   g++ -O2 -std=gnu++11 -DARDUINO=100 -Istub -I../libraries/Crypto
+//       -include Arduino.h -x c++ ../libraries/Crypto/examples/TestSHA256/TestSHA256.ino
+//       -x none sketchhost.cpp obj/libcrypto.a -o obj/TestSHA256
+//
+// Serial output goes to standard output.  main() calls setup() and then
+// loop() once, which is enough for the Test sketches because they do all
+// of their work in setup().
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <chrono>
+
+HardwareSerial Serial;
+
+// Simulated pins and EEPROM for the parts of the library that use them.
+uint8_t simPorts[SIM_NUM_PORTS];
+static uint8_t eeprom[4096];
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (value)
+        *portOutputRegister(digitalPinToPort(pin)) |= digitalPinToBitMask(pin);
+    else
+        *portOutputRegister(digitalPinToPort(pin)) &= ~digitalPinToBitMask(pin);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (*portOutputRegister(digitalPinToPort(pin)) &
+            digitalPinToBitMask(pin)) != 0;
+}
+
+static std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(unsigned long)
+{
+}
+
+void delayMicroseconds(unsigned int)
+{
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return eeprom[(uintptr_t)addr % sizeof(eeprom)];
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom[(uintptr_t)addr % sizeof(eeprom)] = value;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom[(uintptr_t)addr % sizeof(eeprom)] = value;
+}
+
+void setup();
+void loop();
+
+int main()
+{
+    setup();
+    loop();
+    fflush(stdout);
+    return 0;
+}
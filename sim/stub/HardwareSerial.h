@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+// Host stand-in for the serial port, which writes to standard output so
+// that example sketches can be run on the host unchanged.
+
+#ifndef SIM_HardwareSerial_h
+#define SIM_HardwareSerial_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DEC             10
+#define HEX             16
+#define OCT             8
+#define BIN             2
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() { fflush(stdout); }
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c) { putchar(c); return 1; }
+    size_t write(const uint8_t *buf, size_t size)
+        { return fwrite(buf, 1, size, stdout); }
+
+    size_t print(const char *str) { return fputs(str, stdout) >= 0 ? strlen(str) : 0; }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+    size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(T value, int format)
+        { size_t n = print(value, format); return n + println(); }
+
+private:
+    size_t printNumber(unsigned long n, int base);
+};
+
+inline size_t HardwareSerial::print(long n, int base)
+{
+    if (base == DEC && n < 0)
+        return print('-') + printNumber(-(unsigned long)n, base);
+    return printNumber((unsigned long)n, base);
+}
+
+inline size_t HardwareSerial::printNumber(unsigned long n, int base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *str = buf + sizeof(buf) - 1;
+    *str = '\0';
+    if (base < 2)
+        base = 10;
+    do {
+        int digit = (int)(n % base);
+        n /= base;
+        *--str = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    } while (n);
+    return print(str);
+}
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Simulated AVR registers.  Writing to SPDR shifts a byte into the
+// simulated chain of panels; all other registers are plain variables.
+
+#ifndef SIM_avr_io_h
+#define SIM_avr_io_h
+
+#include <inttypes.h>
+
+#define _BV(bit)    (1 << (bit))
+
+class SimSPI
+{
+public:
+    SimSPI &operator=(uint8_t value);
+    operator uint8_t() const { return 0xFF; }
+};
+
+extern SimSPI SPDR;
+extern uint8_t SPSR, SPCR, SREG;
+extern uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern uint8_t TCCR2A, TCCR2B, TCNT2, TIMSK2;
+extern uint16_t ICR1;
+
+// SPI register bits.  SPIF always reads as set because transfers
+// complete immediately.
+#define SPIF        7
+#define SPE         6
+#define DORD        5
+#define MSTR        4
+#define CPOL        3
+#define CPHA        2
+#define SPR1        1
+#define SPR0        0
+#define SPI2X       0
+
+// Timer register bits.
+#define CS10        0
+#define CS11        1
+#define CS12        2
+#define WGM13       4
+#define TOIE1       0
+#define CS20        0
+#define CS21        1
+#define CS22        2
+#define TOIE2       0
+
+#endif
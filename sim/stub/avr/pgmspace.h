@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SIM_avr_pgmspace_h
+#define SIM_avr_pgmspace_h
+
+#include <inttypes.h>
+#include <string.h>
+
+// Program memory is ordinary memory on the host.
+#define PROGMEM
+#define PGM_P               const char *
+#define PGM_VOID_P          const void *
+// The Crypto library defines these itself when it is not built for AVR.
+#if !defined(pgm_read_byte)
+#define pgm_read_byte(addr) (*((const uint8_t *)(addr)))
+#define pgm_read_word(addr) (*((const uint16_t *)(addr)))
+#define memcpy_P(d, s, n)   memcpy((d), (s), (n))
+#endif
+#define strlen_P(s)         strlen((s))
+
+#endif